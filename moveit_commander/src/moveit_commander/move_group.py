@@ -38,6 +38,7 @@ from moveit_msgs.msg import MoveItErrorCodes, TrajectoryConstraints, PlannerInte
 from sensor_msgs.msg import JointState
 import rospy
 import tf
+import numpy
 from moveit_ros_planning_interface import _moveit_move_group_interface
 from exception import MoveItCommanderException
 import conversions
@@ -106,6 +107,19 @@ class MoveGroupCommander(object):
         """ Get the current configuration of the group as a list (these are values published on /joint_states) """
         return self._g.get_current_joint_values()
 
+    def get_current_joint_values_array(self):
+        """ Get the current configuration of the group as a numpy array. This avoids creating a Python float per value """
+        return numpy.frombuffer(self._g.get_current_joint_values_buffer(), dtype=numpy.float64)
+
+    def get_cached_joint_values(self):
+        """ Get the most recently received configuration of the group as a list, without waiting for a new joint state.
+        Returns an empty list if no joint state was received yet """
+        return self._g.get_cached_joint_values()
+
+    def get_current_state_version(self):
+        """ Get a counter that increases whenever a new state of the robot is received (0 if none was received yet) """
+        return self._g.get_current_state_version()
+
     def get_current_pose(self, end_effector_link = ""):
         """ Get the current pose of the end-effector of the group. Throws an exception if there is not end-effector. """
         if len(end_effector_link) > 0 or self.has_end_effector_link():
@@ -570,6 +584,44 @@ class MoveGroupCommander(object):
         """ Set the support surface name for a place operation """
         self._g.set_support_surface_name(value)
 
+    def get_trajectory_arrays(self, trajectory):
+        """ Get the joint trajectory of a RobotTrajectory (a message or as returned serialized by the bindings) as a tuple
+        (joint names, positions, velocities, times from start). Positions and velocities are numpy arrays with one
+        row per point; velocities are empty unless all points have them. """
+        if isinstance(trajectory, RobotTrajectory):
+            trajectory = conversions.msg_to_string(trajectory)
+        (names, positions, velocities, times) = self._g.get_trajectory_arrays(trajectory)
+        times = numpy.frombuffer(times, dtype=numpy.float64)
+        positions = numpy.frombuffer(positions, dtype=numpy.float64).reshape(len(times), len(names))
+        velocities = numpy.frombuffer(velocities, dtype=numpy.float64)
+        if len(velocities) > 0:
+            velocities = velocities.reshape(len(times), len(names))
+        return (names, positions, velocities, times)
+
+    def plan_arrays(self, joints = None):
+        """ Like plan(), but return the planned joint trajectory as (joint names, positions, velocities, times from
+        start) numpy arrays, without converting the plan to a Python message """
+        if joints is not None:
+            if type(joints) is JointState:
+                self.set_joint_value_target(joints)
+            elif type(joints) is Pose:
+                self.set_pose_target(joints)
+            else:
+                try:
+                    self.set_joint_value_target(self.get_remembered_joint_values()[joints])
+                except:
+                    self.set_joint_value_target(joints)
+        return self.get_trajectory_arrays(self._g.compute_plan())
+
+    def get_jacobian_matrix(self, joint_values, reference_point = None):
+        """ Get the 6 x n Jacobian of the end-effector link (linear rows first) for the given joint values of the group,
+        as a numpy array. The reference point is given in the frame of the link and defaults to its origin. """
+        buf = self._g.get_jacobian_matrix(list(joint_values), [] if reference_point is None else list(reference_point))
+        jacobian = numpy.frombuffer(buf, dtype=numpy.float64)
+        if len(jacobian) == 0:
+            raise MoveItCommanderException("Unable to compute the Jacobian for the given joint values")
+        return jacobian.reshape(6, len(jacobian) // 6)
+
     def retime_trajectory(self, ref_state_in, traj_in, velocity_scaling_factor):
         ser_ref_state_in = conversions.msg_to_string(ref_state_in)
         ser_traj_in = conversions.msg_to_string(traj_in)
@@ -215,6 +215,17 @@ class PlanningSceneInterface(object):
             aco.object.id = name
         self._pub_aco.publish(aco)
 
+    def start_scene_mirror(self):
+        """
+        Keep a local copy of the world of move_group's planning scene, so that queries about world objects do not need
+        to call move_group. Returns False if the initial scene could not be retrieved.
+        """
+        return self._psi.start_scene_mirror()
+
+    def stop_scene_mirror(self):
+        """ Stop mirroring the world; queries about world objects call move_group again """
+        self._psi.stop_scene_mirror()
+
     def get_known_object_names(self, with_type = False):
         """
         Get the names of all known objects in the world. If with_type is set to true, only return objects that have a known type.
@@ -37,8 +37,10 @@
 #ifndef MOVEIT_BACKGROUND_PROCESSING_
 #define MOVEIT_BACKGROUND_PROCESSING_
 
+#include <atomic>
 #include <deque>
 #include <string>
+#include <vector>
 #include <boost/thread.hpp>
 #include <boost/function.hpp>
 #include <boost/noncopyable.hpp>
@@ -53,7 +55,10 @@ namespace tools
 {
 /** \brief This class provides simple API for executing background
     jobs. A queue of jobs is created and the specified jobs are
-    executed in order, one at a time. */
+    executed by a pool of threads (a single thread by default, in
+    which case jobs run one at a time). Jobs of higher priority are
+    started first; jobs of equal priority are started in the order
+    they were added. */
 class BackgroundProcessing : private boost::noncopyable
 {
 public:
@@ -68,6 +73,17 @@ public:
     COMPLETE
   };
 
+  /** \brief Priority classes for jobs */
+  enum JobPriority
+  {
+    HIGH = 0,
+    NORMAL = 1,
+    LOW = 2
+  };
+
+  /** \brief Identifier of a job, as returned by addJob() */
+  typedef unsigned long int JobId;
+
   /** \brief The signature for callback triggered when job events take place: the event that took place and the name of
    * the job */
   typedef boost::function<void(JobEvent, const std::string&)> JobUpdateCallback;
@@ -75,18 +91,37 @@ public:
   /** \brief The signature for job callbacks */
   typedef boost::function<void()> JobCallback;
 
-  /** \brief Constructor. The background thread is activated automatically. */
-  BackgroundProcessing();
+  /** \brief Constructor. \e thread_count background threads (at least one) are activated automatically. */
+  explicit BackgroundProcessing(unsigned int thread_count = 1);
 
-  /** \brief Finishes currently executing job, clears the remaining queue. */
+  /** \brief Finishes currently executing jobs, clears the remaining queue. */
   ~BackgroundProcessing();
 
-  /** \brief Add a job to the queue of jobs to execute. A name is also specifies for the job */
-  void addJob(const JobCallback& job, const std::string& name);
+  /** \brief Add a job to the queue of jobs to execute. A name is also specifies for the job.
+      If \e coalesce is true, jobs with the same name that have not started yet are removed from the queue,
+      so only the most recent one is executed. Returns the identifier of the job. */
+  JobId addJob(const JobCallback& job, const std::string& name, JobPriority priority = NORMAL, bool coalesce = false);
+
+  /** \brief Cancel a job. A job that did not start yet is removed from the queue. A job that is running is flagged,
+      which it can check with isCurrentJobCancelled(). Returns false if the job is neither queued nor running. */
+  bool cancelJob(JobId id);
 
-  /** \brief Get the size of the queue of jobs (includes currently processed job). */
+  /** \brief Cancel all queued and running jobs named \e name, as cancelJob() does. Returns the number of jobs
+   * cancelled. */
+  std::size_t cancelJobs(const std::string& name);
+
+  /** \brief Called from within a job, check if cancelJob() was called for it. Returns false outside of jobs. */
+  static bool isCurrentJobCancelled();
+
+  /** \brief Get the size of the queue of jobs (includes currently processed jobs). */
   std::size_t getJobCount() const;
 
+  /** \brief Get the number of threads executing jobs */
+  std::size_t getThreadCount() const
+  {
+    return processing_threads_.size();
+  }
+
   /** \brief Clear the queue of jobs */
   void clear();
 
@@ -97,19 +132,38 @@ public:
   void clearJobUpdateEvent();
 
 private:
-  std::unique_ptr<boost::thread> processing_thread_;
+  struct Job
+  {
+    JobCallback callback;
+    std::string name;
+    JobId id;
+    std::shared_ptr<std::atomic<bool> > cancelled;
+  };
+
+  std::vector<std::unique_ptr<boost::thread> > processing_threads_;
   bool run_processing_thread_;
 
   mutable boost::mutex action_lock_;
   boost::condition_variable new_action_condition_;
-  std::deque<JobCallback> actions_;
-  std::deque<std::string> action_names_;
 
-  JobUpdateCallback queue_change_event_;
+  /** \brief The queued jobs, one queue per priority class */
+  std::deque<Job> actions_[LOW + 1];
+
+  /** \brief The jobs being executed */
+  std::vector<Job> running_;
 
-  bool processing_;
+  JobId next_job_id_;
+
+  JobUpdateCallback queue_change_event_;
 
   void processingThread();
+
+  /** \brief Remove the queued jobs for which \e predicate holds; the names of removed jobs are appended to \e removed.
+      Must be called with action_lock_ held. */
+  template <typename Predicate>
+  void removeQueuedJobs(const Predicate& predicate, std::vector<std::string>& removed);
+
+  void notifyRemoved(const std::vector<std::string>& removed);
 };
 }
 }
@@ -0,0 +1,94 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef MOVEIT_BACKGROUND_PROCESSING_THREAD_BUDGET_
+#define MOVEIT_BACKGROUND_PROCESSING_THREAD_BUDGET_
+
+#include <string>
+#include <boost/noncopyable.hpp>
+
+namespace moveit
+{
+namespace tools
+{
+/** \brief Process wide budget for the threads of MoveIt's parallel sections (batched collision checks, IK races,
+    parallel path validation, ...). Each section reserves its threads before starting them and hands them back when
+    it is done. Sections running at the same time then share the cores instead of each starting one thread per core,
+    and a section started from within another one's thread gets only what the budget has left. A section is always
+    granted at least the calling thread itself.
+
+    Budgets can also be set for subsystems, so e.g. collision checking never takes more than a given number of
+    threads, no matter how much of the overall budget is free. */
+class ThreadBudget : private boost::noncopyable
+{
+public:
+  /** \brief The threads granted to one parallel section, handed back to the budget when destroyed */
+  class Reservation : private boost::noncopyable
+  {
+  public:
+    /** \brief Reserve up to \e requested threads (including the calling thread) for \e subsystem; 0 requests as
+        many threads as the budget allows */
+    Reservation(const std::string& subsystem, unsigned int requested);
+    ~Reservation();
+
+    /** \brief The number of threads granted, at least 1 */
+    unsigned int getThreads() const
+    {
+      return threads_;
+    }
+
+  private:
+    std::string subsystem_;
+    unsigned int threads_;
+  };
+
+  /** \brief The total number of threads parallel sections may use at once. By default, one per core */
+  static unsigned int getConcurrency();
+
+  /** \brief Set the total number of threads parallel sections may use at once; 0 restores one per core */
+  static void setConcurrency(unsigned int threads);
+
+  /** \brief The number of threads \e subsystem may use at once; 0 if only the overall budget applies */
+  static unsigned int getSubsystemLimit(const std::string& subsystem);
+
+  /** \brief Set the number of threads \e subsystem may use at once; 0 removes the limit */
+  static void setSubsystemLimit(const std::string& subsystem, unsigned int threads);
+
+  /** \brief The number of threads currently reserved by parallel sections */
+  static unsigned int getThreadsInUse();
+};
+}
+}
+
+#endif
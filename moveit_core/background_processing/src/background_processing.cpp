@@ -36,24 +36,35 @@
 
 #include <moveit/background_processing/background_processing.h>
 #include <ros/console.h>
+#include <algorithm>
 
 namespace moveit
 {
 namespace tools
 {
-BackgroundProcessing::BackgroundProcessing()
+namespace
 {
-  // spin a thread that will process user events
+// the cancellation flag of the job executed by the calling thread, if any
+thread_local const std::atomic<bool>* current_job_cancelled = nullptr;
+}
+
+BackgroundProcessing::BackgroundProcessing(unsigned int thread_count) : next_job_id_(0)
+{
+  // spin the threads that will process user events
   run_processing_thread_ = true;
-  processing_ = false;
-  processing_thread_.reset(new boost::thread(boost::bind(&BackgroundProcessing::processingThread, this)));
+  for (unsigned int i = 0; i < std::max(thread_count, 1u); ++i)
+    processing_threads_.emplace_back(new boost::thread(boost::bind(&BackgroundProcessing::processingThread, this)));
 }
 
 BackgroundProcessing::~BackgroundProcessing()
 {
-  run_processing_thread_ = false;
+  {
+    boost::mutex::scoped_lock _(action_lock_);
+    run_processing_thread_ = false;
+  }
   new_action_condition_.notify_all();
-  processing_thread_->join();
+  for (std::size_t i = 0; i < processing_threads_.size(); ++i)
+    processing_threads_[i]->join();
 }
 
 void BackgroundProcessing::processingThread()
@@ -62,69 +73,170 @@ void BackgroundProcessing::processingThread()
 
   while (run_processing_thread_)
   {
-    while (actions_.empty() && run_processing_thread_)
+    // pick the oldest job of the highest priority class
+    std::deque<Job>* queue = nullptr;
+    for (std::size_t p = 0; p <= LOW && !queue; ++p)
+      if (!actions_[p].empty())
+        queue = &actions_[p];
+    if (!queue)
+    {
       new_action_condition_.wait(ulock);
+      continue;
+    }
+
+    Job job = queue->front();
+    queue->pop_front();
+    running_.push_back(job);
 
-    while (!actions_.empty())
+    // make sure we are unlocked while we process the event
+    ulock.unlock();
+    current_job_cancelled = job.cancelled.get();
+    try
+    {
+      ROS_DEBUG_NAMED("background_processing", "Begin executing '%s'", job.name.c_str());
+      job.callback();
+      ROS_DEBUG_NAMED("background_processing", "Done executing '%s'", job.name.c_str());
+    }
+    catch (std::exception& ex)
     {
-      JobCallback fn = actions_.front();
-      std::string action_name = action_names_.front();
-      actions_.pop_front();
-      action_names_.pop_front();
-      processing_ = true;
-
-      // make sure we are unlocked while we process the event
-      action_lock_.unlock();
-      try
+      ROS_ERROR_NAMED("background_processing", "Exception caught while processing action '%s': %s", job.name.c_str(),
+                      ex.what());
+    }
+    current_job_cancelled = nullptr;
+
+    ulock.lock();
+    for (std::size_t i = 0; i < running_.size(); ++i)
+      if (running_[i].id == job.id)
+      {
+        running_.erase(running_.begin() + i);
+        break;
+      }
+    JobUpdateCallback event = queue_change_event_;
+    ulock.unlock();
+    if (event)
+      event(COMPLETE, job.name);
+    ulock.lock();
+  }
+}
+
+BackgroundProcessing::JobId BackgroundProcessing::addJob(const JobCallback& job, const std::string& name,
+                                                         JobPriority priority, bool coalesce)
+{
+  JobId id;
+  std::vector<std::string> removed;
+  JobUpdateCallback event;
+  {
+    boost::mutex::scoped_lock _(action_lock_);
+    if (coalesce)
+      removeQueuedJobs([&name](const Job& j) { return j.name == name; }, removed);
+    Job j;
+    j.callback = job;
+    j.name = name;
+    j.id = id = next_job_id_++;
+    j.cancelled = std::make_shared<std::atomic<bool> >(false);
+    actions_[priority].push_back(j);
+    new_action_condition_.notify_one();
+    event = queue_change_event_;
+  }
+  notifyRemoved(removed);
+  if (event)
+    event(ADD, name);
+  return id;
+}
+
+template <typename Predicate>
+void BackgroundProcessing::removeQueuedJobs(const Predicate& predicate, std::vector<std::string>& removed)
+{
+  for (std::size_t p = 0; p <= LOW; ++p)
+    for (std::deque<Job>::iterator it = actions_[p].begin(); it != actions_[p].end();)
+      if (predicate(*it))
       {
-        ROS_DEBUG_NAMED("background_processing", "Begin executing '%s'", action_name.c_str());
-        fn();
-        ROS_DEBUG_NAMED("background_processing", "Done executing '%s'", action_name.c_str());
+        removed.push_back(it->name);
+        it = actions_[p].erase(it);
       }
-      catch (std::exception& ex)
+      else
+        ++it;
+}
+
+void BackgroundProcessing::notifyRemoved(const std::vector<std::string>& removed)
+{
+  if (removed.empty())
+    return;
+  JobUpdateCallback event;
+  {
+    boost::mutex::scoped_lock _(action_lock_);
+    event = queue_change_event_;
+  }
+  if (event)
+    for (std::size_t i = 0; i < removed.size(); ++i)
+      event(REMOVE, removed[i]);
+}
+
+bool BackgroundProcessing::cancelJob(JobId id)
+{
+  std::vector<std::string> removed;
+  bool found = false;
+  {
+    boost::mutex::scoped_lock _(action_lock_);
+    removeQueuedJobs([id](const Job& j) { return j.id == id; }, removed);
+    found = !removed.empty();
+    for (std::size_t i = 0; i < running_.size(); ++i)
+      if (running_[i].id == id)
       {
-        ROS_ERROR_NAMED("background_processing", "Exception caught while processing action '%s': %s",
-                        action_name.c_str(), ex.what());
+        running_[i].cancelled->store(true);
+        found = true;
       }
-      processing_ = false;
-      if (queue_change_event_)
-        queue_change_event_(COMPLETE, action_name);
-      action_lock_.lock();
-    }
   }
+  notifyRemoved(removed);
+  return found;
 }
 
-void BackgroundProcessing::addJob(const boost::function<void()>& job, const std::string& name)
+std::size_t BackgroundProcessing::cancelJobs(const std::string& name)
 {
+  std::vector<std::string> removed;
+  std::size_t count = 0;
   {
     boost::mutex::scoped_lock _(action_lock_);
-    actions_.push_back(job);
-    action_names_.push_back(name);
-    new_action_condition_.notify_all();
+    removeQueuedJobs([&name](const Job& j) { return j.name == name; }, removed);
+    count = removed.size();
+    for (std::size_t i = 0; i < running_.size(); ++i)
+      if (running_[i].name == name)
+      {
+        running_[i].cancelled->store(true);
+        ++count;
+      }
   }
-  if (queue_change_event_)
-    queue_change_event_(ADD, name);
+  notifyRemoved(removed);
+  return count;
+}
+
+bool BackgroundProcessing::isCurrentJobCancelled()
+{
+  return current_job_cancelled && current_job_cancelled->load();
 }
 
 void BackgroundProcessing::clear()
 {
-  bool update = false;
-  std::deque<std::string> removed;
+  std::vector<std::string> removed;
   {
     boost::mutex::scoped_lock _(action_lock_);
-    update = !actions_.empty();
-    actions_.clear();
-    action_names_.swap(removed);
+    for (std::size_t p = 0; p <= LOW; ++p)
+    {
+      for (std::size_t i = 0; i < actions_[p].size(); ++i)
+        removed.push_back(actions_[p][i].name);
+      actions_[p].clear();
+    }
   }
-  if (update && queue_change_event_)
-    for (std::deque<std::string>::iterator it = removed.begin(); it != removed.end(); ++it)
-      queue_change_event_(REMOVE, *it);
+  notifyRemoved(removed);
 }
 
 std::size_t BackgroundProcessing::getJobCount() const
 {
   boost::mutex::scoped_lock _(action_lock_);
-  return actions_.size() + (processing_ ? 1 : 0);
+  std::size_t count = running_.size();
+  for (std::size_t p = 0; p <= LOW; ++p)
+    count += actions_[p].size();
+  return count;
 }
 
 void BackgroundProcessing::setJobUpdateEvent(const JobUpdateCallback& event)
@@ -139,4 +251,4 @@ void BackgroundProcessing::clearJobUpdateEvent()
 }
 
 }  // end of namespace tools
-}  // end of namespace moveit
\ No newline at end of file
+}  // end of namespace moveit
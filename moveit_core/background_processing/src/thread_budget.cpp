@@ -0,0 +1,142 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/background_processing/thread_budget.h>
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <map>
+
+namespace moveit
+{
+namespace tools
+{
+namespace
+{
+struct Budget
+{
+  Budget() : concurrency(0), in_use(0)
+  {
+  }
+
+  boost::mutex lock;
+  unsigned int concurrency;
+  unsigned int in_use;
+  std::map<std::string, unsigned int> subsystem_limits;
+  std::map<std::string, unsigned int> subsystem_in_use;
+};
+
+Budget& getBudget()
+{
+  static Budget budget;
+  return budget;
+}
+
+unsigned int effectiveConcurrency(const Budget& budget)
+{
+  return budget.concurrency > 0 ? budget.concurrency : std::max(1u, boost::thread::hardware_concurrency());
+}
+}
+
+ThreadBudget::Reservation::Reservation(const std::string& subsystem, unsigned int requested)
+  : subsystem_(subsystem), threads_(1)
+{
+  // the calling thread runs anyway; there is nothing to account for if it is all the section asks for
+  if (requested == 1)
+    return;
+
+  Budget& budget = getBudget();
+  boost::mutex::scoped_lock slock(budget.lock);
+  const unsigned int concurrency = effectiveConcurrency(budget);
+  unsigned int available = budget.in_use < concurrency ? concurrency - budget.in_use : 0;
+  std::map<std::string, unsigned int>::const_iterator limit = budget.subsystem_limits.find(subsystem_);
+  if (limit != budget.subsystem_limits.end())
+  {
+    const unsigned int used = budget.subsystem_in_use[subsystem_];
+    available = std::min(available, limit->second > used ? limit->second - used : 0);
+  }
+  threads_ = std::max(1u, requested == 0 ? available : std::min(requested, available));
+  budget.in_use += threads_;
+  budget.subsystem_in_use[subsystem_] += threads_;
+}
+
+ThreadBudget::Reservation::~Reservation()
+{
+  if (threads_ == 1)
+    return;
+  Budget& budget = getBudget();
+  boost::mutex::scoped_lock slock(budget.lock);
+  budget.in_use -= threads_;
+  budget.subsystem_in_use[subsystem_] -= threads_;
+}
+
+unsigned int ThreadBudget::getConcurrency()
+{
+  Budget& budget = getBudget();
+  boost::mutex::scoped_lock slock(budget.lock);
+  return effectiveConcurrency(budget);
+}
+
+void ThreadBudget::setConcurrency(unsigned int threads)
+{
+  Budget& budget = getBudget();
+  boost::mutex::scoped_lock slock(budget.lock);
+  budget.concurrency = threads;
+}
+
+unsigned int ThreadBudget::getSubsystemLimit(const std::string& subsystem)
+{
+  Budget& budget = getBudget();
+  boost::mutex::scoped_lock slock(budget.lock);
+  std::map<std::string, unsigned int>::const_iterator limit = budget.subsystem_limits.find(subsystem);
+  return limit != budget.subsystem_limits.end() ? limit->second : 0;
+}
+
+void ThreadBudget::setSubsystemLimit(const std::string& subsystem, unsigned int threads)
+{
+  Budget& budget = getBudget();
+  boost::mutex::scoped_lock slock(budget.lock);
+  if (threads == 0)
+    budget.subsystem_limits.erase(subsystem);
+  else
+    budget.subsystem_limits[subsystem] = threads;
+}
+
+unsigned int ThreadBudget::getThreadsInUse()
+{
+  Budget& budget = getBudget();
+  boost::mutex::scoped_lock slock(budget.lock);
+  return budget.in_use;
+}
+}
+}
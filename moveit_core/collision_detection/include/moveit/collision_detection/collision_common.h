@@ -232,6 +232,8 @@ enum DistanceRequestType
 }
 typedef DistanceRequestTypes::DistanceRequestType DistanceRequestType;
 
+struct DistanceResultsData;
+
 struct DistanceRequest
 {
   DistanceRequest()
@@ -242,8 +244,11 @@ struct DistanceRequest
     , active_components_only(nullptr)
     , acm(nullptr)
     , distance_threshold(std::numeric_limits<double>::max())
+    , early_termination_distance(-std::numeric_limits<double>::max())
+    , warm_start(nullptr)
     , verbose(false)
     , compute_gradient(false)
+    , compact_pairs(false)
   {
   }
 
@@ -283,12 +288,25 @@ struct DistanceRequest
   /// If set this can significantly to reduce number of queries.
   double distance_threshold;
 
+  /// Stop the query as soon as a pair closer than this distance is found (e.g. a safety margin). The reported
+  /// minimum distance is then only guaranteed to be below this value, not to be the global minimum.
+  double early_termination_distance;
+
+  /// Result of a previous query, typically for a nearby state (type GLOBAL only). The pair that was closest then is
+  /// evaluated first, so its distance bounds the search over all other pairs from the start.
+  const DistanceResultsData* warm_start;
+
   /// Log debug information
   bool verbose;
 
   /// Indicate if gradient should be calculated between each object.
   /// This is the normalized vector connecting the closest points on the two objects.
   bool compute_gradient;
+
+  /// With type SINGLE, store the result of each pair in DistanceResult::pairs instead of DistanceResult::distances.
+  /// This avoids building the map keyed by name pairs, for callers such as trajectory optimizers that query the
+  /// distances of all pairs within \e distance_threshold at every iteration.
+  bool compact_pairs;
 };
 
 struct DistanceResultsData
@@ -358,6 +376,72 @@ struct DistanceResultsData
 
 typedef std::map<const std::pair<std::string, std::string>, std::vector<DistanceResultsData> > DistanceMap;
 
+/** \brief The closest distance of each pair of bodies, as parallel arrays indexed by pair
+ *  (see DistanceRequest::compact_pairs). Entry \e i has the same meaning as the fields of DistanceResultsData. */
+struct DistancePairs
+{
+  /// Number of pairs
+  std::size_t size() const
+  {
+    return distances.size();
+  }
+
+  /// Remove all pairs; the arrays keep their capacity so a result reused across queries rarely allocates
+  void clear()
+  {
+    distances.clear();
+    normals.clear();
+    for (int k = 0; k < 2; ++k)
+    {
+      nearest_points[k].clear();
+      link_names[k].clear();
+      body_types[k].clear();
+    }
+  }
+
+  /// Store \e data as entry \e index, which is either an existing entry or size() to append one
+  void set(std::size_t index, const DistanceResultsData& data)
+  {
+    if (index == distances.size())
+    {
+      distances.push_back(data.distance);
+      normals.push_back(data.normal);
+      for (int k = 0; k < 2; ++k)
+      {
+        nearest_points[k].push_back(data.nearest_points[k]);
+        link_names[k].push_back(data.link_names[k]);
+        body_types[k].push_back(data.body_types[k]);
+      }
+    }
+    else
+    {
+      distances[index] = data.distance;
+      normals[index] = data.normal;
+      for (int k = 0; k < 2; ++k)
+      {
+        nearest_points[k][index] = data.nearest_points[k];
+        link_names[k][index] = data.link_names[k];
+        body_types[k][index] = data.body_types[k];
+      }
+    }
+  }
+
+  /// Signed distance of each pair (negative for penetration, if DistanceRequest::enable_signed_distance is set)
+  std::vector<double> distances;
+
+  /// Normalized vector from the first to the second body of each pair; the gradient of the distance
+  std::vector<Eigen::Vector3d> normals;
+
+  /// The nearest points on the first and the second body of each pair
+  std::vector<Eigen::Vector3d> nearest_points[2];
+
+  /// Names of the first and the second body of each pair
+  std::vector<std::string> link_names[2];
+
+  /// Types of the first and the second body of each pair
+  std::vector<BodyType> body_types[2];
+};
+
 struct DistanceResult
 {
   DistanceResult() : collision(false)
@@ -373,12 +457,16 @@ struct DistanceResult
   /// A map of distance data for each link in the req.active_components_only
   DistanceMap distances;
 
+  /// Distance data for each pair of bodies, filled instead of \e distances if DistanceRequest::compact_pairs is set
+  DistancePairs pairs;
+
   /// Clear structure data
   void clear()
   {
     collision = false;
     minimum_distance.clear();
     distances.clear();
+    pairs.clear();
   }
 };
 }
@@ -41,10 +41,13 @@
 #include <moveit/macros/class_forward.h>
 #include <moveit_msgs/AllowedCollisionMatrix.h>
 #include <boost/function.hpp>
+#include <cstdint>
 #include <iostream>
 #include <vector>
 #include <string>
 #include <map>
+#include <memory>
+#include <unordered_map>
 
 namespace collision_detection
 {
@@ -73,6 +76,7 @@ enum Type
 typedef boost::function<bool(collision_detection::Contact&)> DecideContactFn;
 
 MOVEIT_CLASS_FORWARD(AllowedCollisionMatrix);
+MOVEIT_CLASS_FORWARD(CompiledAllowedCollisionMatrix);
 
 /** @class AllowedCollisionMatrix
  *  @brief Definition of a structure for the allowed collision matrix. All elements in the collision world are referred
@@ -270,12 +274,117 @@ public:
   /** @brief Print the allowed collision matrix */
   void print(std::ostream& out) const;
 
+  /** @brief Get a compiled view of the current content of the matrix, for repeated calls to getAllowedCollision().
+   *  The view is built on first use and shared until the matrix is modified; it does not follow later changes. */
+  CompiledAllowedCollisionMatrixConstPtr getCompiled() const;
+
 private:
+  friend class CompiledAllowedCollisionMatrix;
+
+  /** @brief Drop the compiled view; called by every function that modifies the matrix */
+  void invalidateCompiled()
+  {
+    std::atomic_store(&compiled_, CompiledAllowedCollisionMatrixConstPtr());
+  }
+
   std::map<std::string, std::map<std::string, AllowedCollision::Type> > entries_;
   std::map<std::string, std::map<std::string, DecideContactFn> > allowed_contacts_;
 
   std::map<std::string, AllowedCollision::Type> default_entries_;
   std::map<std::string, DecideContactFn> default_allowed_contacts_;
+
+  /** @brief Compiled view of the entries above, accessed through std::atomic_load/store */
+  mutable CompiledAllowedCollisionMatrixConstPtr compiled_;
+};
+
+/** @class CompiledAllowedCollisionMatrix
+ *  @brief Immutable view of an AllowedCollisionMatrix meant for the narrow phase of collision checking. Every name
+ *  known to the matrix is mapped to a dense index and the result of AllowedCollisionMatrix::getAllowedCollision()
+ *  (defaults included) is resolved once for every pair, so a query is two hash lookups and a table read.
+ *  Predicates for AllowedCollision::CONDITIONAL entries are not stored; get them from the source matrix. */
+class CompiledAllowedCollisionMatrix
+{
+public:
+  /** @brief A set of elements, used to decide with isAlwaysAllowed() whether an element needs to be checked against
+   *  any of them */
+  struct ElementSet
+  {
+    ElementSet() : unknown(false)
+    {
+    }
+
+    /// One bit per index of the view
+    std::vector<std::uint64_t> bits;
+
+    /// True if the set contains names the view does not know
+    bool unknown;
+  };
+
+  CompiledAllowedCollisionMatrix(const AllowedCollisionMatrix& acm);
+
+  /** @brief Get the index of \e name, or -1 if the matrix has neither entries nor a default value for it */
+  int getIndex(const std::string& name) const
+  {
+    auto it = indices_.find(name);
+    return it == indices_.end() ? -1 : it->second;
+  }
+
+  /** @brief Get the number of names known to the view */
+  std::size_t getSize() const
+  {
+    return size_;
+  }
+
+  /** @brief Same as AllowedCollisionMatrix::getAllowedCollision() for elements given by index (-1 for unknown) */
+  bool getAllowedCollision(int index1, int index2, AllowedCollision::Type& allowed_collision) const
+  {
+    unsigned char v;
+    if (index1 >= 0 && index2 >= 0)
+      v = pairs_[index1 * size_ + index2];
+    else if (index1 >= 0)
+      v = defaults_[index1];
+    else if (index2 >= 0)
+      v = defaults_[index2];
+    else
+      return false;
+    if (v == UNKNOWN)
+      return false;
+    allowed_collision = static_cast<AllowedCollision::Type>(v - 1);
+    return true;
+  }
+
+  /** @brief Same as AllowedCollisionMatrix::getAllowedCollision() */
+  bool getAllowedCollision(const std::string& name1, const std::string& name2,
+                           AllowedCollision::Type& allowed_collision) const
+  {
+    return getAllowedCollision(getIndex(name1), getIndex(name2), allowed_collision);
+  }
+
+  /** @brief Add \e name to \e set */
+  void addToSet(const std::string& name, ElementSet& set) const;
+
+  /** @brief Return true if collisions between the element \e index and every element of \e set are
+   *  AllowedCollision::ALWAYS allowed, in both orders. Unknown elements (index -1) are never always allowed. */
+  bool isAlwaysAllowed(int index, const ElementSet& set) const;
+
+private:
+  /// Table value for pairs the matrix has no answer for; other values are AllowedCollision::Type + 1
+  static const unsigned char UNKNOWN = 0;
+
+  std::unordered_map<std::string, int> indices_;
+  std::size_t size_;
+
+  /// Resolved value for every ordered pair of indices, row-major
+  std::vector<unsigned char> pairs_;
+
+  /// Default value of each index, used when the other element of a pair is unknown
+  std::vector<unsigned char> defaults_;
+
+  /// Number of 64 bit words in a row of \e always_
+  std::size_t words_;
+
+  /// For every index, a row with the bits of the indices it is always allowed to collide with
+  std::vector<std::uint64_t> always_;
 };
 }
 
@@ -155,6 +155,34 @@ public:
                                    const robot_state::RobotState& state1, const robot_state::RobotState& state2,
                                    const AllowedCollisionMatrix& acm) const = 0;
 
+  /** \brief Check a batch of robot states for collisions with the world. Self collisions are not checked.
+   *  \e res is resized to the number of states and the result for \e states[i] is accumulated in \e res[i], exactly
+   *  as a call to checkRobotCollision() would do. States whose result already reports a collision (and no further
+   *  contacts are needed) are skipped. The default implementation simply calls checkRobotCollision() for every state;
+   *  derived classes may reuse data structures across the batch and distribute the states over multiple threads.
+   *  @param req A CollisionRequest object that encapsulates the collision request, used for all states
+   *  @param res The CollisionResult objects, one for each state
+   *  @param robot The collision model for the robot
+   *  @param states The kinematic states for which checks are being made
+   *  @param acm The allowed collision matrix (may be NULL). */
+  virtual void checkRobotCollisionBatch(const CollisionRequest& req, std::vector<CollisionResult>& res,
+                                        const CollisionRobot& robot,
+                                        const std::vector<const robot_state::RobotState*>& states,
+                                        const AllowedCollisionMatrix* acm = NULL) const;
+
+  /** \brief Check a batch of robot states for self collisions and collisions with the world.
+   *  The result for \e states[i] is accumulated in \e res[i], as checkCollision() would do. The default
+   *  implementation checks self collisions state by state and then calls checkRobotCollisionBatch().
+   *  @param req A CollisionRequest object that encapsulates the collision request, used for all states
+   *  @param res The CollisionResult objects, one for each state
+   *  @param robot The collision model for the robot
+   *  @param states The kinematic states for which checks are being made
+   *  @param acm The allowed collision matrix (may be NULL). */
+  virtual void checkCollisionBatch(const CollisionRequest& req, std::vector<CollisionResult>& res,
+                                   const CollisionRobot& robot,
+                                   const std::vector<const robot_state::RobotState*>& states,
+                                   const AllowedCollisionMatrix* acm = NULL) const;
+
   /** \brief Check whether a given set of objects is in collision with objects from another world.
    *  Any contacts are considered.
    *  @param req A CollisionRequest object that encapsulates the collision request
@@ -258,6 +286,12 @@ public:
    * Passing NULL will result in a new empty world being created. */
   virtual void setWorld(const WorldPtr& world);
 
+  /** \brief Do the expensive part of creating the collision geometry for \e shape (e.g., building the bounding volume
+   * hierarchy of a mesh) without touching the world. This is safe to call from any thread while the world is in use.
+   * As long as the returned handle is held, adding a shape with the same content to the world is cheap.
+   * The default implementation does nothing and returns an empty handle. */
+  virtual std::shared_ptr<const void> prepareShape(const shapes::ShapeConstPtr& shape) const;
+
   /** access the world geometry */
   const WorldPtr& getWorld()
   {
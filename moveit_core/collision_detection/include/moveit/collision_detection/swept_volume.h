@@ -0,0 +1,130 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef MOVEIT_COLLISION_DETECTION_SWEPT_VOLUME_
+#define MOVEIT_COLLISION_DETECTION_SWEPT_VOLUME_
+
+#include <moveit/collision_detection/world.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/macros/class_forward.h>
+#include <geometric_shapes/bodies.h>
+#include <cstdint>
+#include <vector>
+
+namespace collision_detection
+{
+MOVEIT_CLASS_FORWARD(SweptVolume);
+
+/** @brief A voxelized approximation of the space the robot sweeps through along a trajectory, one voxel set per
+    trajectory segment.
+
+    Computing a swept volume is expensive (forward kinematics for densely sampled states and rasterization of every
+    collision shape), but it only depends on the robot and the trajectory. Trajectories that are executed many times
+    can keep their swept volume and be checked against the current world with a lookup per voxel instead of collision
+    checks per waypoint.
+
+    The approximation is conservative: every voxel touched by a collision shape of the robot or its attached bodies
+    during a segment belongs to that segment, and world geometry is rasterized the same way. Missing an intersection
+    therefore proves the segment free of collisions with the world, while an intersection only means the segment may
+    be in collision and should be checked exactly (e.g., with planning_scene::PlanningScene::isPathValid()). Meshes are
+    approximated by their convex hull. Self collisions are not covered. */
+class SweptVolume
+{
+public:
+  /** @brief A voxel, identified by its integer coordinates packed into 21 bits each */
+  typedef std::uint64_t VoxelKey;
+
+  /** @brief The voxels of an environment, sorted and without duplicates, as filled by rasterizeWorld() */
+  typedef std::vector<VoxelKey> Occupancy;
+
+  /** @brief Create an empty swept volume with cubic voxels of edge length \e resolution (in meters). The voxel
+      coordinates are bounded, so the volume covers roughly +-10^6 voxels around the origin along each axis. */
+  explicit SweptVolume(double resolution);
+
+  double getResolution() const
+  {
+    return resolution_;
+  }
+
+  /** @brief Compute the swept volume of \e trajectory, replacing any previous content. Segment i covers the motion
+      from waypoint i to waypoint i + 1; a trajectory with a single waypoint has one segment for it. Intermediate
+      states are interpolated in joint space until consecutive samples move no shape by more than the resolution.
+      The bodies attached to each segment's first waypoint are included. Collision shapes are padded by \e padding. */
+  void compute(const robot_trajectory::RobotTrajectory& trajectory, double padding = 0.0);
+
+  std::size_t getSegmentCount() const
+  {
+    return segments_.size();
+  }
+
+  /** @brief The sorted voxels of segment \e segment */
+  const std::vector<VoxelKey>& getSegmentVoxels(std::size_t segment) const
+  {
+    return segments_[segment];
+  }
+
+  /** @brief Rasterize the world objects (including octomaps) of \e world onto the grid of this swept volume. The
+      result can be shared by all swept volumes with the same resolution. Planes cannot be rasterized and are
+      skipped with a warning. */
+  void rasterizeWorld(const World& world, Occupancy& occupied) const;
+
+  /** @brief Find the first segment that shares a voxel with \e occupied. Returns -1 if there is none. */
+  int findFirstIntersectingSegment(const Occupancy& occupied) const;
+
+  /** @brief Check whether segment \e segment shares a voxel with \e occupied */
+  bool intersects(std::size_t segment, const Occupancy& occupied) const;
+
+  /** @brief The key of the voxel containing \e point */
+  VoxelKey getVoxelKey(const Eigen::Vector3d& point) const;
+
+  /** @brief The center of the voxel identified by \e key */
+  Eigen::Vector3d getVoxelCenter(VoxelKey key) const;
+
+private:
+  VoxelKey makeKey(long x, long y, long z) const;
+  long toIndex(double coordinate) const;
+
+  /* Add the voxels whose centers are inside \e body, which is expected to be padded enough to include every voxel
+     it touches */
+  void rasterizeBody(const bodies::Body& body, std::vector<VoxelKey>& keys) const;
+
+  /* Add the voxels that overlap the axis-aligned box with the given corners */
+  void rasterizeBox(const Eigen::Vector3d& min, const Eigen::Vector3d& max, std::vector<VoxelKey>& keys) const;
+
+  double resolution_;
+  std::vector<std::vector<VoxelKey> > segments_;
+};
+}
+
+#endif
@@ -65,7 +65,8 @@ public:
 
   /** \brief A copy constructor.
    * \e other should not be changed while the copy constructor is running
-   * This does copy on write and should be quick. */
+   * This does copy on write and takes constant time: the object map itself is shared until either world is modified,
+   * and then only the modified objects are copied. */
   World(const World& other);
 
   ~World();
@@ -118,22 +119,22 @@ public:
   /** iterator pointing to first change */
   const_iterator begin() const
   {
-    return objects_.begin();
+    return objects_->begin();
   }
   /** iterator pointing to end of changes */
   const_iterator end() const
   {
-    return objects_.end();
+    return objects_->end();
   }
   /** number of changes stored */
   std::size_t size() const
   {
-    return objects_.size();
+    return objects_->size();
   }
   /** find changes for a named object */
   const_iterator find(const std::string& id) const
   {
-    return objects_.find(id);
+    return objects_->find(id);
   }
 
   /** \brief Check if a particular object exists in the collision world*/
@@ -251,6 +252,12 @@ private:
   /** send notification of change to all objects. */
   void notifyAll(Action action);
 
+  typedef std::map<std::string, ObjectPtr> ObjectMap;
+
+  /** \brief Make sure that the object map is known only to this instance of the World, copying it if it is shared
+   * with other instances. Must be called before modifying the map or any object in it. */
+  ObjectMap& uniqueObjects();
+
   /** \brief Make sure that the object named \e id is known only to this
    * instance of the World. If the object is known outside of it, a
    * clone is made so that it can be safely modified later on. */
@@ -260,8 +267,8 @@ private:
   virtual void addToObjectInternal(const ObjectPtr& obj, const shapes::ShapeConstPtr& shape,
                                    const Eigen::Affine3d& pose);
 
-  /** The objects maintained in the world */
-  std::map<std::string, ObjectPtr> objects_;
+  /** The objects maintained in the world; possibly shared with copies of this world. Never NULL */
+  std::shared_ptr<ObjectMap> objects_;
 
   /* observers to call when something changes */
   class Observer
@@ -0,0 +1,129 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef MOVEIT_COLLISION_DETECTION_WORLD_INDEX_
+#define MOVEIT_COLLISION_DETECTION_WORLD_INDEX_
+
+#include <moveit/collision_detection/world.h>
+#include <moveit/macros/class_forward.h>
+#include <moveit/robot_model/aabb.h>
+#include <boost/thread/mutex.hpp>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace collision_detection
+{
+MOVEIT_CLASS_FORWARD(WorldIndex);
+
+/** @brief A bounding volume hierarchy over the axis-aligned bounding boxes of the objects in a World, for region and
+    proximity queries that would otherwise scan every object.
+
+    Like WorldDiff, the index observes the world: the box of an object is recomputed when the object changes, and the
+    hierarchy is rebuilt from the boxes by the first query after a change. Queries are answered from the boxes, so they
+    are conservative: an object is reported in a region if its box overlaps it, and distances are distances to boxes.
+    Objects containing planes have no bounds and are reported by every region query. Queries may be called from
+    several threads, but not concurrently with changes to the world. */
+class WorldIndex
+{
+public:
+  WorldIndex();
+
+  /** @brief Index the objects of \e world */
+  WorldIndex(const WorldPtr& world);
+
+  ~WorldIndex();
+
+  /** @brief Index the objects of \e world instead of the current one, if any */
+  void setWorld(const WorldPtr& world);
+
+  /** @brief Stop observing the world and forget all objects */
+  void reset();
+
+  /** @brief Get the box around the object \e id. Returns false if the object is not known or is unbounded. */
+  bool getObjectBounds(const std::string& id, Eigen::Vector3d& min, Eigen::Vector3d& max) const;
+
+  /** @brief Get the objects whose boxes overlap the box from \e min to \e max or, if \e contained is true, lie
+      entirely within it */
+  std::vector<std::string> getObjectsInBox(const Eigen::Vector3d& min, const Eigen::Vector3d& max,
+                                           bool contained = false) const;
+
+  /** @brief Get the objects whose boxes are at most \e radius from \e center */
+  std::vector<std::string> getObjectsInSphere(const Eigen::Vector3d& center, double radius) const;
+
+  /** @brief Get the object whose box is closest to \e point, and the distance to that box (0 inside it). Returns false
+      if there are no bounded objects. */
+  bool getNearestObject(const Eigen::Vector3d& point, std::string& id, double& distance) const;
+
+private:
+  struct Entry
+  {
+    std::string id;
+    moveit::core::AABB box;
+  };
+
+  /* A node of the hierarchy: either an inner node with two children, or a leaf over a range of entries */
+  struct Node
+  {
+    moveit::core::AABB box;
+    int children[2];  // -1 for leaves
+    std::size_t begin, end;
+  };
+
+  void notify(const World::ObjectConstPtr& obj, World::Action action);
+  static bool computeBounds(const World::Object& obj, moveit::core::AABB& box);
+
+  /** Rebuild the hierarchy if objects changed since it was built. Must be called with lock_ held. */
+  void ensureBuilt() const;
+  int build(std::size_t begin, std::size_t end) const;
+
+  template <typename Overlaps, typename Accept>
+  void collect(const Overlaps& overlaps, const Accept& accept, std::vector<std::string>& ids) const;
+
+  std::weak_ptr<World> world_;
+  World::ObserverHandle observer_handle_;
+
+  /* the boxes of the bounded objects, and the ids of the unbounded ones */
+  std::map<std::string, moveit::core::AABB> bounds_;
+  std::set<std::string> unbounded_;
+
+  mutable boost::mutex lock_;
+  mutable bool dirty_;
+  mutable std::vector<Entry> entries_;
+  mutable std::vector<Node> nodes_;
+};
+}
+
+#endif
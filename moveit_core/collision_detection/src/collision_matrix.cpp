@@ -37,6 +37,7 @@
 #include <moveit/collision_detection/collision_matrix.h>
 #include <boost/bind.hpp>
 #include <iomanip>
+#include <set>
 
 namespace collision_detection
 {
@@ -79,6 +80,7 @@ AllowedCollisionMatrix::AllowedCollisionMatrix(const AllowedCollisionMatrix& acm
   allowed_contacts_ = acm.allowed_contacts_;
   default_entries_ = acm.default_entries_;
   default_allowed_contacts_ = acm.default_allowed_contacts_;
+  compiled_ = std::atomic_load(&acm.compiled_);
 }
 
 bool AllowedCollisionMatrix::getEntry(const std::string& name1, const std::string& name2, DecideContactFn& fn) const
@@ -124,6 +126,7 @@ void AllowedCollisionMatrix::setEntry(const std::string& name1, const std::strin
 {
   const AllowedCollision::Type v = allowed ? AllowedCollision::ALWAYS : AllowedCollision::NEVER;
   entries_[name1][name2] = entries_[name2][name1] = v;
+  invalidateCompiled();
 
   // remove boost::function pointers, if any
   auto it = allowed_contacts_.find(name1);
@@ -146,6 +149,7 @@ void AllowedCollisionMatrix::setEntry(const std::string& name1, const std::strin
 {
   entries_[name1][name2] = entries_[name2][name1] = AllowedCollision::CONDITIONAL;
   allowed_contacts_[name1][name2] = allowed_contacts_[name2][name1] = fn;
+  invalidateCompiled();
 }
 
 void AllowedCollisionMatrix::removeEntry(const std::string& name)
@@ -156,10 +160,12 @@ void AllowedCollisionMatrix::removeEntry(const std::string& name)
     entry.second.erase(name);
   for (auto& allowed_contact : allowed_contacts_)
     allowed_contact.second.erase(name);
+  invalidateCompiled();
 }
 
 void AllowedCollisionMatrix::removeEntry(const std::string& name1, const std::string& name2)
 {
+  invalidateCompiled();
   auto jt = entries_.find(name1);
   if (jt != entries_.end())
   {
@@ -223,6 +229,7 @@ void AllowedCollisionMatrix::setEntry(bool allowed)
   for (auto& entry : entries_)
     for (auto& it2 : entry.second)
       it2.second = v;
+  invalidateCompiled();
 }
 
 void AllowedCollisionMatrix::setDefaultEntry(const std::string& name, bool allowed)
@@ -230,12 +237,14 @@ void AllowedCollisionMatrix::setDefaultEntry(const std::string& name, bool allow
   const AllowedCollision::Type v = allowed ? AllowedCollision::ALWAYS : AllowedCollision::NEVER;
   default_entries_[name] = v;
   default_allowed_contacts_.erase(name);
+  invalidateCompiled();
 }
 
 void AllowedCollisionMatrix::setDefaultEntry(const std::string& name, const DecideContactFn& fn)
 {
   default_entries_[name] = AllowedCollision::CONDITIONAL;
   default_allowed_contacts_[name] = fn;
+  invalidateCompiled();
 }
 
 bool AllowedCollisionMatrix::getDefaultEntry(const std::string& name, AllowedCollision::Type& allowed_collision) const
@@ -320,6 +329,106 @@ void AllowedCollisionMatrix::clear()
   allowed_contacts_.clear();
   default_entries_.clear();
   default_allowed_contacts_.clear();
+  invalidateCompiled();
+}
+
+CompiledAllowedCollisionMatrixConstPtr AllowedCollisionMatrix::getCompiled() const
+{
+  CompiledAllowedCollisionMatrixConstPtr compiled = std::atomic_load(&compiled_);
+  if (!compiled)
+  {
+    // concurrent callers may both build a view; they are identical, so whichever is stored last is fine
+    compiled = std::make_shared<CompiledAllowedCollisionMatrix>(*this);
+    std::atomic_store(&compiled_, compiled);
+  }
+  return compiled;
+}
+
+const unsigned char CompiledAllowedCollisionMatrix::UNKNOWN;
+
+CompiledAllowedCollisionMatrix::CompiledAllowedCollisionMatrix(const AllowedCollisionMatrix& acm)
+{
+  std::set<std::string> names;
+  for (const auto& entry : acm.entries_)
+  {
+    names.insert(entry.first);
+    for (const auto& it2 : entry.second)
+      names.insert(it2.first);
+  }
+  for (const auto& default_entry : acm.default_entries_)
+    names.insert(default_entry.first);
+
+  size_ = names.size();
+  indices_.reserve(size_);
+  for (const std::string& name : names)
+    indices_.emplace(name, static_cast<int>(indices_.size()));
+
+  defaults_.assign(size_, UNKNOWN);
+  for (const auto& default_entry : acm.default_entries_)
+    defaults_[indices_[default_entry.first]] = default_entry.second + 1;
+
+  // default values take precedence over entries, the same way getAllowedCollision() resolves them
+  pairs_.assign(size_ * size_, UNKNOWN);
+  for (std::size_t i = 0; i < size_; ++i)
+    for (std::size_t j = 0; j < size_; ++j)
+    {
+      const unsigned char d1 = defaults_[i];
+      const unsigned char d2 = defaults_[j];
+      if (d1 == UNKNOWN || d2 == UNKNOWN)
+        pairs_[i * size_ + j] = d1 == UNKNOWN ? d2 : d1;
+      else if (d1 == AllowedCollision::NEVER + 1 || d2 == AllowedCollision::NEVER + 1)
+        pairs_[i * size_ + j] = AllowedCollision::NEVER + 1;
+      else if (d1 == AllowedCollision::CONDITIONAL + 1 || d2 == AllowedCollision::CONDITIONAL + 1)
+        pairs_[i * size_ + j] = AllowedCollision::CONDITIONAL + 1;
+      else
+        pairs_[i * size_ + j] = AllowedCollision::ALWAYS + 1;
+    }
+
+  for (const auto& entry : acm.entries_)
+  {
+    const std::size_t i = indices_[entry.first];
+    if (defaults_[i] != UNKNOWN)
+      continue;
+    for (const auto& it2 : entry.second)
+    {
+      const std::size_t j = indices_[it2.first];
+      if (defaults_[j] == UNKNOWN)
+        pairs_[i * size_ + j] = it2.second + 1;
+    }
+  }
+
+  words_ = (size_ + 63) / 64;
+  always_.assign(size_ * words_, 0);
+  for (std::size_t i = 0; i < size_; ++i)
+    for (std::size_t j = 0; j < size_; ++j)
+      if (pairs_[i * size_ + j] == AllowedCollision::ALWAYS + 1 &&
+          pairs_[j * size_ + i] == AllowedCollision::ALWAYS + 1)
+        always_[i * words_ + j / 64] |= std::uint64_t(1) << (j % 64);
+}
+
+void CompiledAllowedCollisionMatrix::addToSet(const std::string& name, ElementSet& set) const
+{
+  int index = getIndex(name);
+  if (index < 0)
+  {
+    set.unknown = true;
+    return;
+  }
+  set.bits.resize(words_, 0);
+  set.bits[index / 64] |= std::uint64_t(1) << (index % 64);
+}
+
+bool CompiledAllowedCollisionMatrix::isAlwaysAllowed(int index, const ElementSet& set) const
+{
+  if (index < 0)
+    return false;
+  if (set.unknown && defaults_[index] != AllowedCollision::ALWAYS + 1)
+    return false;
+  const std::uint64_t* row = &always_[index * words_];
+  for (std::size_t w = 0; w < set.bits.size(); ++w)
+    if (set.bits[w] & ~row[w])
+      return false;
+  return true;
 }
 
 void AllowedCollisionMatrix::getAllEntryNames(std::vector<std::string>& names) const
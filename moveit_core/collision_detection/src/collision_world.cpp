@@ -84,6 +84,37 @@ void CollisionWorld::checkCollision(const CollisionRequest& req, CollisionResult
     checkRobotCollision(req, res, robot, state1, state2, acm);
 }
 
+void CollisionWorld::checkRobotCollisionBatch(const CollisionRequest& req, std::vector<CollisionResult>& res,
+                                              const CollisionRobot& robot,
+                                              const std::vector<const robot_state::RobotState*>& states,
+                                              const AllowedCollisionMatrix* acm) const
+{
+  res.resize(states.size());
+  for (std::size_t i = 0; i < states.size(); ++i)
+  {
+    if (res[i].collision && !(req.contacts && res[i].contacts.size() < req.max_contacts))
+      continue;
+    if (acm)
+      checkRobotCollision(req, res[i], robot, *states[i], *acm);
+    else
+      checkRobotCollision(req, res[i], robot, *states[i]);
+  }
+}
+
+void CollisionWorld::checkCollisionBatch(const CollisionRequest& req, std::vector<CollisionResult>& res,
+                                         const CollisionRobot& robot,
+                                         const std::vector<const robot_state::RobotState*>& states,
+                                         const AllowedCollisionMatrix* acm) const
+{
+  res.resize(states.size());
+  for (std::size_t i = 0; i < states.size(); ++i)
+    if (acm)
+      robot.checkSelfCollision(req, res[i], *states[i], *acm);
+    else
+      robot.checkSelfCollision(req, res[i], *states[i]);
+  checkRobotCollisionBatch(req, res, robot, states, acm);
+}
+
 void CollisionWorld::setWorld(const WorldPtr& world)
 {
   world_ = world;
@@ -93,4 +124,9 @@ void CollisionWorld::setWorld(const WorldPtr& world)
   world_const_ = world;
 }
 
+std::shared_ptr<const void> CollisionWorld::prepareShape(const shapes::ShapeConstPtr& shape) const
+{
+  return std::shared_ptr<const void>();
+}
+
 }  // end of namespace collision_detection
\ No newline at end of file
@@ -0,0 +1,329 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/collision_detection/swept_volume.h>
+#include <geometric_shapes/shapes.h>
+#include <octomap/octomap.h>
+#include <ros/console.h>
+#include <algorithm>
+#include <cmath>
+
+namespace collision_detection
+{
+namespace
+{
+const unsigned int KEY_BITS = 21;
+const long KEY_OFFSET = 1l << (KEY_BITS - 1);
+const long KEY_MASK = (1l << KEY_BITS) - 1;
+
+// samples of a segment are refined at most this many times, in case a joint moves a shape very far
+const unsigned int MAX_REFINEMENT_DEPTH = 16;
+
+/* A collision shape of the robot, ready to be rasterized at the poses of a segment */
+struct SweptBody
+{
+  bodies::BodyPtr body;
+  double radius;  // of the bounding sphere around the shape origin
+};
+
+bodies::BodyPtr createSweptBody(const shapes::ShapeConstPtr& shape, double padding, double& radius)
+{
+  bodies::BodyPtr body(bodies::createBodyFromShape(shape.get()));
+  if (body)
+  {
+    body->setPadding(padding);
+    bodies::BoundingSphere sphere;
+    body->computeBoundingSphere(sphere);
+    radius = sphere.center.norm() + sphere.radius;
+  }
+  return body;
+}
+
+/* Samples the states of one segment densely enough for consecutive poses of every shape to be within a resolution */
+class SegmentSampler
+{
+public:
+  SegmentSampler(const robot_state::RobotState& from, const robot_state::RobotState& to,
+                 robot_state::RobotState& state, const std::vector<SweptBody>& bodies,
+                 const std::vector<const robot_model::LinkModel*>& links, double resolution)
+    : from_(from), to_(to), state_(state), bodies_(bodies), links_(links), resolution_(resolution)
+  {
+  }
+
+  /* fill poses with the poses of all bodies at interpolation parameter t */
+  void sample(double t, EigenSTL::vector_Affine3d& poses)
+  {
+    from_.interpolate(to_, t, state_);
+    state_.update();
+    poses.clear();
+    for (const robot_model::LinkModel* link : links_)
+      for (std::size_t j = 0; j < link->getShapes().size(); ++j)
+        poses.push_back(state_.getCollisionBodyTransform(link, j));
+    std::vector<const robot_state::AttachedBody*> attached;
+    state_.getAttachedBodies(attached);
+    for (const robot_state::AttachedBody* body : attached)
+      poses.insert(poses.end(), body->getGlobalCollisionBodyTransforms().begin(),
+                   body->getGlobalCollisionBodyTransforms().end());
+  }
+
+  double maxDisplacement(const EigenSTL::vector_Affine3d& poses0, const EigenSTL::vector_Affine3d& poses1) const
+  {
+    double d = 0.0;
+    for (std::size_t i = 0; i < bodies_.size(); ++i)
+      if (bodies_[i].body)
+      {
+        double angle = Eigen::AngleAxisd(poses0[i].linear().transpose() * poses1[i].linear()).angle();
+        d = std::max(d, (poses1[i].translation() - poses0[i].translation()).norm() + angle * bodies_[i].radius);
+      }
+    return d;
+  }
+
+  /* call rasterize for the poses of states between t0 and t1 (exclusive) until consecutive samples are close */
+  template <typename Rasterize>
+  void refine(double t0, const EigenSTL::vector_Affine3d& poses0, double t1, const EigenSTL::vector_Affine3d& poses1,
+              unsigned int depth, Rasterize& rasterize)
+  {
+    if (depth >= MAX_REFINEMENT_DEPTH || maxDisplacement(poses0, poses1) <= resolution_)
+      return;
+    double tm = 0.5 * (t0 + t1);
+    EigenSTL::vector_Affine3d posesm;
+    sample(tm, posesm);
+    rasterize(posesm);
+    refine(t0, poses0, tm, posesm, depth + 1, rasterize);
+    refine(tm, posesm, t1, poses1, depth + 1, rasterize);
+  }
+
+private:
+  const robot_state::RobotState& from_;
+  const robot_state::RobotState& to_;
+  robot_state::RobotState& state_;
+  const std::vector<SweptBody>& bodies_;
+  const std::vector<const robot_model::LinkModel*>& links_;
+  double resolution_;
+};
+}
+
+SweptVolume::SweptVolume(double resolution) : resolution_(resolution)
+{
+}
+
+long SweptVolume::toIndex(double coordinate) const
+{
+  long index = (long)std::floor(coordinate / resolution_);
+  return std::max(-KEY_OFFSET, std::min(KEY_OFFSET - 1, index));
+}
+
+SweptVolume::VoxelKey SweptVolume::makeKey(long x, long y, long z) const
+{
+  return ((VoxelKey)(x + KEY_OFFSET) << (2 * KEY_BITS)) | ((VoxelKey)(y + KEY_OFFSET) << KEY_BITS) |
+         (VoxelKey)(z + KEY_OFFSET);
+}
+
+SweptVolume::VoxelKey SweptVolume::getVoxelKey(const Eigen::Vector3d& point) const
+{
+  return makeKey(toIndex(point.x()), toIndex(point.y()), toIndex(point.z()));
+}
+
+Eigen::Vector3d SweptVolume::getVoxelCenter(VoxelKey key) const
+{
+  long x = (long)((key >> (2 * KEY_BITS)) & KEY_MASK) - KEY_OFFSET;
+  long y = (long)((key >> KEY_BITS) & KEY_MASK) - KEY_OFFSET;
+  long z = (long)(key & KEY_MASK) - KEY_OFFSET;
+  return Eigen::Vector3d(x + 0.5, y + 0.5, z + 0.5) * resolution_;
+}
+
+void SweptVolume::rasterizeBody(const bodies::Body& body, std::vector<VoxelKey>& keys) const
+{
+  bodies::BoundingSphere sphere;
+  body.computeBoundingSphere(sphere);
+  const Eigen::Vector3d radius(sphere.radius, sphere.radius, sphere.radius);
+  const Eigen::Vector3d min = sphere.center - radius;
+  const Eigen::Vector3d max = sphere.center + radius;
+  const long x1 = toIndex(max.x()), y1 = toIndex(max.y()), z1 = toIndex(max.z());
+  for (long x = toIndex(min.x()); x <= x1; ++x)
+    for (long y = toIndex(min.y()); y <= y1; ++y)
+      for (long z = toIndex(min.z()); z <= z1; ++z)
+        if (body.containsPoint(Eigen::Vector3d(x + 0.5, y + 0.5, z + 0.5) * resolution_))
+          keys.push_back(makeKey(x, y, z));
+}
+
+void SweptVolume::rasterizeBox(const Eigen::Vector3d& min, const Eigen::Vector3d& max,
+                               std::vector<VoxelKey>& keys) const
+{
+  const long x1 = toIndex(max.x()), y1 = toIndex(max.y()), z1 = toIndex(max.z());
+  for (long x = toIndex(min.x()); x <= x1; ++x)
+    for (long y = toIndex(min.y()); y <= y1; ++y)
+      for (long z = toIndex(min.z()); z <= z1; ++z)
+        keys.push_back(makeKey(x, y, z));
+}
+
+void SweptVolume::compute(const robot_trajectory::RobotTrajectory& trajectory, double padding)
+{
+  segments_.clear();
+  const std::size_t count = trajectory.getWayPointCount();
+  if (count == 0)
+    return;
+
+  // a voxel touched by a shape has its center within half a diagonal of it; the shapes also move by up to one
+  // resolution between consecutive samples
+  const double inflation = padding + resolution_ * (0.5 * std::sqrt(3.0) + 0.5);
+
+  // one entry per collision shape, in the order SegmentSampler::sample() reports the poses; unsupported shapes have
+  // no body
+  const std::vector<const robot_model::LinkModel*>& links =
+      trajectory.getRobotModel()->getLinkModelsWithCollisionGeometry();
+  std::vector<SweptBody> link_bodies;
+  for (const robot_model::LinkModel* link : links)
+    for (const shapes::ShapeConstPtr& shape : link->getShapes())
+    {
+      SweptBody b;
+      b.radius = 0.0;
+      b.body = createSweptBody(shape, inflation, b.radius);
+      link_bodies.push_back(b);
+    }
+
+  segments_.resize(std::max<std::size_t>(count - 1, 1));
+  robot_state::RobotState state(trajectory.getWayPoint(0));
+  for (std::size_t s = 0; s < segments_.size(); ++s)
+  {
+    const robot_state::RobotState& from = trajectory.getWayPoint(s);
+    const robot_state::RobotState& to = trajectory.getWayPoint(std::min(s + 1, count - 1));
+    state = from;
+
+    std::vector<SweptBody> bodies = link_bodies;
+    std::vector<const robot_state::AttachedBody*> attached;
+    state.getAttachedBodies(attached);
+    for (const robot_state::AttachedBody* body : attached)
+      for (const shapes::ShapeConstPtr& shape : body->getShapes())
+      {
+        SweptBody b;
+        b.radius = 0.0;
+        b.body = createSweptBody(shape, inflation, b.radius);
+        bodies.push_back(b);
+      }
+
+    std::vector<VoxelKey>& keys = segments_[s];
+    auto rasterize = [this, &bodies, &keys](const EigenSTL::vector_Affine3d& poses) {
+      for (std::size_t i = 0; i < bodies.size(); ++i)
+        if (bodies[i].body)
+        {
+          bodies[i].body->setPose(poses[i]);
+          rasterizeBody(*bodies[i].body, keys);
+        }
+    };
+
+    SegmentSampler sampler(from, to, state, bodies, links, resolution_);
+    EigenSTL::vector_Affine3d poses0, poses1;
+    sampler.sample(0.0, poses0);
+    rasterize(poses0);
+    if (count > 1)
+    {
+      sampler.sample(1.0, poses1);
+      rasterize(poses1);
+      sampler.refine(0.0, poses0, 1.0, poses1, 0, rasterize);
+    }
+
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  }
+}
+
+void SweptVolume::rasterizeWorld(const World& world, Occupancy& occupied) const
+{
+  occupied.clear();
+  const double inflation = 0.5 * std::sqrt(3.0) * resolution_;
+  for (const std::pair<const std::string, World::ObjectPtr>& object : world)
+    for (std::size_t i = 0; i < object.second->shapes_.size(); ++i)
+    {
+      const shapes::ShapeConstPtr& shape = object.second->shapes_[i];
+      const Eigen::Affine3d& pose = object.second->shape_poses_[i];
+      if (shape->type == shapes::OCTREE)
+      {
+        const std::shared_ptr<const octomap::OcTree>& octree =
+            static_cast<const shapes::OcTree*>(shape.get())->octree;
+        // the extents of the rotated cells along each axis, per unit of cell size
+        const Eigen::Vector3d extents = 0.5 * pose.linear().cwiseAbs() * Eigen::Vector3d::Ones();
+        for (octomap::OcTree::leaf_iterator it = octree->begin_leafs(), end = octree->end_leafs(); it != end; ++it)
+          if (octree->isNodeOccupied(*it))
+          {
+            const Eigen::Vector3d center = pose * Eigen::Vector3d(it.getX(), it.getY(), it.getZ());
+            const Eigen::Vector3d half = extents * it.getSize();
+            rasterizeBox(center - half, center + half, occupied);
+          }
+      }
+      else if (shape->type == shapes::PLANE)
+        ROS_WARN_NAMED("collision_detection", "Planes cannot be rasterized; ignoring a plane of object '%s'",
+                       object.first.c_str());
+      else
+      {
+        double radius;
+        bodies::BodyPtr body = createSweptBody(shape, inflation, radius);
+        if (body)
+        {
+          body->setPose(pose);
+          rasterizeBody(*body, occupied);
+        }
+      }
+    }
+
+  std::sort(occupied.begin(), occupied.end());
+  occupied.erase(std::unique(occupied.begin(), occupied.end()), occupied.end());
+}
+
+bool SweptVolume::intersects(std::size_t segment, const Occupancy& occupied) const
+{
+  const std::vector<VoxelKey>& keys = segments_[segment];
+  if (keys.empty() || occupied.empty() || keys.back() < occupied.front() || occupied.back() < keys.front())
+    return false;
+  // both sets are sorted, so each lookup can start where the previous one ended
+  Occupancy::const_iterator it = occupied.begin();
+  for (VoxelKey key : keys)
+  {
+    it = std::lower_bound(it, occupied.end(), key);
+    if (it == occupied.end())
+      return false;
+    if (*it == key)
+      return true;
+  }
+  return false;
+}
+
+int SweptVolume::findFirstIntersectingSegment(const Occupancy& occupied) const
+{
+  for (std::size_t s = 0; s < segments_.size(); ++s)
+    if (intersects(s, occupied))
+      return (int)s;
+  return -1;
+}
+}
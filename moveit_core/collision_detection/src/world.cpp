@@ -39,13 +39,12 @@
 
 namespace collision_detection
 {
-World::World()
+World::World() : objects_(new ObjectMap())
 {
 }
 
-World::World(const World& other)
+World::World(const World& other) : objects_(other.objects_)
 {
-  objects_ = other.objects_;
 }
 
 World::~World()
@@ -76,7 +75,7 @@ void World::addToObject(const std::string& id, const std::vector<shapes::ShapeCo
 
   int action = ADD_SHAPE;
 
-  ObjectPtr& obj = objects_[id];
+  ObjectPtr& obj = uniqueObjects()[id];
   if (!obj)
   {
     obj.reset(new Object(id));
@@ -95,7 +94,7 @@ void World::addToObject(const std::string& id, const shapes::ShapeConstPtr& shap
 {
   int action = ADD_SHAPE;
 
-  ObjectPtr& obj = objects_[id];
+  ObjectPtr& obj = uniqueObjects()[id];
   if (!obj)
   {
     obj.reset(new Object(id));
@@ -111,20 +110,27 @@ void World::addToObject(const std::string& id, const shapes::ShapeConstPtr& shap
 std::vector<std::string> World::getObjectIds() const
 {
   std::vector<std::string> id;
-  for (const auto& object : objects_)
+  for (const auto& object : *objects_)
     id.push_back(object.first);
   return id;
 }
 
 World::ObjectConstPtr World::getObject(const std::string& id) const
 {
-  auto it = objects_.find(id);
-  if (it == objects_.end())
+  auto it = objects_->find(id);
+  if (it == objects_->end())
     return ObjectConstPtr();
   else
     return it->second;
 }
 
+World::ObjectMap& World::uniqueObjects()
+{
+  if (!objects_.unique())
+    objects_.reset(new ObjectMap(*objects_));
+  return *objects_;
+}
+
 void World::ensureUnique(ObjectPtr& obj)
 {
   if (obj && !obj.unique())
@@ -133,22 +139,23 @@ void World::ensureUnique(ObjectPtr& obj)
 
 bool World::hasObject(const std::string& id) const
 {
-  return objects_.find(id) != objects_.end();
+  return objects_->find(id) != objects_->end();
 }
 
 bool World::moveShapeInObject(const std::string& id, const shapes::ShapeConstPtr& shape, const Eigen::Affine3d& pose)
 {
-  auto it = objects_.find(id);
-  if (it != objects_.end())
+  auto it = objects_->find(id);
+  if (it != objects_->end())
   {
     unsigned int n = it->second->shapes_.size();
     for (unsigned int i = 0; i < n; ++i)
       if (it->second->shapes_[i] == shape)
       {
-        ensureUnique(it->second);
-        it->second->shape_poses_[i] = pose;
+        ObjectPtr& obj = uniqueObjects()[id];
+        ensureUnique(obj);
+        obj->shape_poses_[i] = pose;
 
-        notify(it->second, MOVE_SHAPE);
+        notify(obj, MOVE_SHAPE);
         return true;
       }
   }
@@ -157,27 +164,29 @@ bool World::moveShapeInObject(const std::string& id, const shapes::ShapeConstPtr
 
 bool World::moveObject(const std::string& id, const Eigen::Affine3d& transform)
 {
-  auto it = objects_.find(id);
-  if (it == objects_.end())
+  if (!hasObject(id))
     return false;
-  ensureUnique(it->second);
-  for (size_t i = 0, n = it->second->shapes_.size(); i < n; ++i)
+  ObjectPtr& obj = uniqueObjects()[id];
+  ensureUnique(obj);
+  for (size_t i = 0, n = obj->shapes_.size(); i < n; ++i)
   {
-    it->second->shape_poses_[i] = transform * it->second->shape_poses_[i];
+    obj->shape_poses_[i] = transform * obj->shape_poses_[i];
   }
-  notify(it->second, MOVE_SHAPE);
+  notify(obj, MOVE_SHAPE);
   return true;
 }
 
 bool World::removeShapeFromObject(const std::string& id, const shapes::ShapeConstPtr& shape)
 {
-  auto it = objects_.find(id);
-  if (it != objects_.end())
+  auto it = objects_->find(id);
+  if (it != objects_->end())
   {
     unsigned int n = it->second->shapes_.size();
     for (unsigned int i = 0; i < n; ++i)
       if (it->second->shapes_[i] == shape)
       {
+        ObjectMap& objects = uniqueObjects();
+        it = objects.find(id);
         ensureUnique(it->second);
         it->second->shapes_.erase(it->second->shapes_.begin() + i);
         it->second->shape_poses_.erase(it->second->shape_poses_.begin() + i);
@@ -185,7 +194,7 @@ bool World::removeShapeFromObject(const std::string& id, const shapes::ShapeCons
         if (it->second->shapes_.empty())
         {
           notify(it->second, DESTROY);
-          objects_.erase(it);
+          objects.erase(it);
         }
         else
         {
@@ -199,20 +208,20 @@ bool World::removeShapeFromObject(const std::string& id, const shapes::ShapeCons
 
 bool World::removeObject(const std::string& id)
 {
-  auto it = objects_.find(id);
-  if (it != objects_.end())
-  {
-    notify(it->second, DESTROY);
-    objects_.erase(it);
-    return true;
-  }
-  return false;
+  if (!hasObject(id))
+    return false;
+  ObjectMap& objects = uniqueObjects();
+  auto it = objects.find(id);
+  notify(it->second, DESTROY);
+  objects.erase(it);
+  return true;
 }
 
 void World::clearObjects()
 {
   notifyAll(DESTROY);
-  objects_.clear();
+  // other worlds may still share the old map, so start a new one instead of clearing it
+  objects_.reset(new ObjectMap());
 }
 
 World::ObserverHandle World::addObserver(const ObserverCallbackFn& callback)
@@ -237,7 +246,7 @@ void World::removeObserver(ObserverHandle observer_handle)
 
 void World::notifyAll(Action action)
 {
-  for (std::map<std::string, ObjectPtr>::const_iterator it = objects_.begin(); it != objects_.end(); ++it)
+  for (ObjectMap::const_iterator it = objects_->begin(); it != objects_->end(); ++it)
     notify(it->second, action);
 }
 
@@ -254,7 +263,7 @@ void World::notifyObserverAllObjects(const ObserverHandle observer_handle, Actio
     if (observer == observer_handle.observer_)
     {
       // call the callback for each object
-      for (const auto& object : objects_)
+      for (const auto& object : *objects_)
         observer->callback_(object.second, action);
       break;
     }
@@ -0,0 +1,316 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/collision_detection/world_index.h>
+#include <geometric_shapes/shapes.h>
+#include <geometric_shapes/shape_operations.h>
+#include <octomap/octomap.h>
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace collision_detection
+{
+namespace
+{
+// leaves hold at most this many entries
+const std::size_t LEAF_SIZE = 4;
+}
+
+WorldIndex::WorldIndex() : dirty_(false)
+{
+}
+
+WorldIndex::WorldIndex(const WorldPtr& world) : dirty_(false)
+{
+  setWorld(world);
+}
+
+WorldIndex::~WorldIndex()
+{
+  WorldPtr old_world = world_.lock();
+  if (old_world)
+    old_world->removeObserver(observer_handle_);
+}
+
+void WorldIndex::setWorld(const WorldPtr& world)
+{
+  reset();
+  std::weak_ptr<World>(world).swap(world_);
+  observer_handle_ = world->addObserver(boost::bind(&WorldIndex::notify, this, _1, _2));
+  world->notifyObserverAllObjects(observer_handle_, World::CREATE | World::ADD_SHAPE);
+}
+
+void WorldIndex::reset()
+{
+  WorldPtr old_world = world_.lock();
+  if (old_world)
+    old_world->removeObserver(observer_handle_);
+  world_.reset();
+
+  boost::mutex::scoped_lock slock(lock_);
+  bounds_.clear();
+  unbounded_.clear();
+  entries_.clear();
+  nodes_.clear();
+  dirty_ = false;
+}
+
+void WorldIndex::notify(const World::ObjectConstPtr& obj, World::Action action)
+{
+  boost::mutex::scoped_lock slock(lock_);
+  dirty_ = true;
+  if (action == World::DESTROY)
+  {
+    bounds_.erase(obj->id_);
+    unbounded_.erase(obj->id_);
+    return;
+  }
+
+  moveit::core::AABB box;
+  if (computeBounds(*obj, box))
+  {
+    bounds_[obj->id_] = box;
+    unbounded_.erase(obj->id_);
+  }
+  else
+  {
+    bounds_.erase(obj->id_);
+    unbounded_.insert(obj->id_);
+  }
+}
+
+bool WorldIndex::computeBounds(const World::Object& obj, moveit::core::AABB& box)
+{
+  box.setEmpty();
+  for (std::size_t i = 0; i < obj.shapes_.size(); ++i)
+  {
+    const shapes::Shape* shape = obj.shapes_[i].get();
+    const Eigen::Affine3d& pose = obj.shape_poses_[i];
+    if (shape->type == shapes::PLANE)
+      return false;
+    if (shape->type == shapes::MESH)
+    {
+      // the vertices give a tighter box than the extents of the mesh, which need not be centered at its origin
+      const shapes::Mesh* mesh = static_cast<const shapes::Mesh*>(shape);
+      for (unsigned int k = 0; k < mesh->vertex_count; ++k)
+        box.extend(pose * Eigen::Vector3d(mesh->vertices[3 * k], mesh->vertices[3 * k + 1], mesh->vertices[3 * k + 2]));
+    }
+    else if (shape->type == shapes::OCTREE)
+    {
+      const std::shared_ptr<const octomap::OcTree>& octree = static_cast<const shapes::OcTree*>(shape)->octree;
+      if (!octree || octree->size() == 0)
+        continue;
+      double min_x, min_y, min_z, max_x, max_y, max_z;
+      octree->getMetricMin(min_x, min_y, min_z);
+      octree->getMetricMax(max_x, max_y, max_z);
+      const Eigen::Vector3d min(min_x, min_y, min_z), max(max_x, max_y, max_z);
+      box.extendWithTransformedBox(pose * Eigen::Translation3d(0.5 * (min + max)), max - min);
+    }
+    else
+      // the other shapes are centered at their origin
+      box.extendWithTransformedBox(pose, shapes::computeShapeExtents(shape));
+  }
+  return true;
+}
+
+void WorldIndex::ensureBuilt() const
+{
+  if (!dirty_)
+    return;
+  dirty_ = false;
+  entries_.clear();
+  nodes_.clear();
+  for (std::map<std::string, moveit::core::AABB>::const_iterator it = bounds_.begin(); it != bounds_.end(); ++it)
+    if (!it->second.isEmpty())
+    {
+      Entry e;
+      e.id = it->first;
+      e.box = it->second;
+      entries_.push_back(e);
+    }
+  if (!entries_.empty())
+  {
+    nodes_.reserve(2 * entries_.size() / LEAF_SIZE + 1);
+    build(0, entries_.size());
+  }
+}
+
+int WorldIndex::build(std::size_t begin, std::size_t end) const
+{
+  int index = nodes_.size();
+  nodes_.push_back(Node());
+  moveit::core::AABB box;
+  for (std::size_t i = begin; i < end; ++i)
+    box.extend(entries_[i].box);
+  nodes_[index].box = box;
+  nodes_[index].begin = begin;
+  nodes_[index].end = end;
+  nodes_[index].children[0] = nodes_[index].children[1] = -1;
+  if (end - begin <= LEAF_SIZE)
+    return index;
+
+  // split at the median of the box centers along the longest side
+  int axis;
+  box.sizes().maxCoeff(&axis);
+  std::size_t middle = begin + (end - begin) / 2;
+  std::nth_element(entries_.begin() + begin, entries_.begin() + middle, entries_.begin() + end,
+                   [axis](const Entry& a, const Entry& b) { return a.box.center()[axis] < b.box.center()[axis]; });
+  int left = build(begin, middle);
+  int right = build(middle, end);
+  nodes_[index].children[0] = left;
+  nodes_[index].children[1] = right;
+  return index;
+}
+
+template <typename Overlaps, typename Accept>
+void WorldIndex::collect(const Overlaps& overlaps, const Accept& accept, std::vector<std::string>& ids) const
+{
+  if (nodes_.empty())
+    return;
+  std::vector<int> stack(1, 0);
+  while (!stack.empty())
+  {
+    const Node& node = nodes_[stack.back()];
+    stack.pop_back();
+    if (!overlaps(node.box))
+      continue;
+    if (node.children[0] < 0)
+    {
+      for (std::size_t i = node.begin; i < node.end; ++i)
+        if (accept(entries_[i].box))
+          ids.push_back(entries_[i].id);
+    }
+    else
+    {
+      stack.push_back(node.children[0]);
+      stack.push_back(node.children[1]);
+    }
+  }
+}
+
+bool WorldIndex::getObjectBounds(const std::string& id, Eigen::Vector3d& min, Eigen::Vector3d& max) const
+{
+  boost::mutex::scoped_lock slock(lock_);
+  std::map<std::string, moveit::core::AABB>::const_iterator it = bounds_.find(id);
+  if (it == bounds_.end() || it->second.isEmpty())
+    return false;
+  min = it->second.min();
+  max = it->second.max();
+  return true;
+}
+
+std::vector<std::string> WorldIndex::getObjectsInBox(const Eigen::Vector3d& min, const Eigen::Vector3d& max,
+                                                     bool contained) const
+{
+  const Eigen::AlignedBox3d query(min, max);
+  std::vector<std::string> ids;
+  boost::mutex::scoped_lock slock(lock_);
+  ensureBuilt();
+  collect([&query](const Eigen::AlignedBox3d& box) { return query.intersects(box); },
+          [&query, contained](const Eigen::AlignedBox3d& box) {
+            return contained ? query.contains(box) : query.intersects(box);
+          },
+          ids);
+  if (!contained)
+    ids.insert(ids.end(), unbounded_.begin(), unbounded_.end());
+  return ids;
+}
+
+std::vector<std::string> WorldIndex::getObjectsInSphere(const Eigen::Vector3d& center, double radius) const
+{
+  const double radius2 = radius * radius;
+  std::vector<std::string> ids;
+  boost::mutex::scoped_lock slock(lock_);
+  ensureBuilt();
+  auto near = [&center, radius2](const Eigen::AlignedBox3d& box) {
+    return box.squaredExteriorDistance(center) <= radius2;
+  };
+  collect(near, near, ids);
+  ids.insert(ids.end(), unbounded_.begin(), unbounded_.end());
+  return ids;
+}
+
+bool WorldIndex::getNearestObject(const Eigen::Vector3d& point, std::string& id, double& distance) const
+{
+  boost::mutex::scoped_lock slock(lock_);
+  ensureBuilt();
+  if (nodes_.empty())
+    return false;
+
+  // depth first, closer child first, skipping nodes that cannot hold anything closer than the best entry so far
+  double best = std::numeric_limits<double>::infinity();
+  std::size_t best_entry = 0;
+  std::vector<std::pair<double, int> > stack(1, std::make_pair(nodes_[0].box.squaredExteriorDistance(point), 0));
+  while (!stack.empty())
+  {
+    const std::pair<double, int> top = stack.back();
+    stack.pop_back();
+    if (top.first >= best)
+      continue;
+    const Node& node = nodes_[top.second];
+    if (node.children[0] < 0)
+    {
+      for (std::size_t i = node.begin; i < node.end; ++i)
+      {
+        double d = entries_[i].box.squaredExteriorDistance(point);
+        if (d < best)
+        {
+          best = d;
+          best_entry = i;
+        }
+      }
+      continue;
+    }
+    double d0 = nodes_[node.children[0]].box.squaredExteriorDistance(point);
+    double d1 = nodes_[node.children[1]].box.squaredExteriorDistance(point);
+    // the closer child goes on top of the stack
+    if (d0 < d1)
+    {
+      stack.push_back(std::make_pair(d1, node.children[1]));
+      stack.push_back(std::make_pair(d0, node.children[0]));
+    }
+    else
+    {
+      stack.push_back(std::make_pair(d0, node.children[0]));
+      stack.push_back(std::make_pair(d1, node.children[1]));
+    }
+  }
+  id = entries_[best_entry].id;
+  distance = std::sqrt(best);
+  return true;
+}
+
+}  // end of namespace collision_detection
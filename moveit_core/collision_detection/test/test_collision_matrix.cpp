@@ -0,0 +1,147 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2012, Willow Garage, Inc.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Willow Garage nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <gtest/gtest.h>
+#include <moveit/collision_detection/collision_matrix.h>
+#include <boost/bind.hpp>
+
+using namespace collision_detection;
+
+static bool alwaysAllowed(Contact&)
+{
+  return true;
+}
+
+static void expectSameAnswers(const AllowedCollisionMatrix& acm, const std::vector<std::string>& names)
+{
+  CompiledAllowedCollisionMatrixConstPtr compiled = acm.getCompiled();
+  for (const std::string& name1 : names)
+    for (const std::string& name2 : names)
+    {
+      AllowedCollision::Type expected = AllowedCollision::NEVER, actual = AllowedCollision::NEVER;
+      bool found_expected = acm.getAllowedCollision(name1, name2, expected);
+      bool found_actual = compiled->getAllowedCollision(name1, name2, actual);
+      EXPECT_EQ(found_expected, found_actual) << name1 << " / " << name2;
+      if (found_expected && found_actual)
+      {
+        EXPECT_EQ(expected, actual) << name1 << " / " << name2;
+      }
+    }
+}
+
+TEST(CompiledAllowedCollisionMatrix, MatchesEntriesAndDefaults)
+{
+  AllowedCollisionMatrix acm;
+  acm.setEntry("a", "b", true);
+  acm.setEntry("a", "c", false);
+  acm.setEntry("b", "c", boost::bind(&alwaysAllowed, _1));
+  acm.setEntry("c", "d", true);
+  acm.setDefaultEntry("d", false);
+  acm.setDefaultEntry("e", true);
+  acm.setDefaultEntry("f", boost::bind(&alwaysAllowed, _1));
+
+  std::vector<std::string> names = { "a", "b", "c", "d", "e", "f", "unknown" };
+  expectSameAnswers(acm, names);
+
+  AllowedCollision::Type type;
+  EXPECT_FALSE(acm.getCompiled()->getAllowedCollision("unknown", "other", type));
+  EXPECT_TRUE(acm.getCompiled()->getAllowedCollision("unknown", "e", type));
+  EXPECT_EQ(AllowedCollision::ALWAYS, type);
+}
+
+TEST(CompiledAllowedCollisionMatrix, FollowsModifications)
+{
+  AllowedCollisionMatrix acm;
+  acm.setEntry("a", "b", true);
+  CompiledAllowedCollisionMatrixConstPtr first = acm.getCompiled();
+  EXPECT_EQ(first, acm.getCompiled());
+
+  acm.setEntry("a", "b", false);
+  EXPECT_NE(first, acm.getCompiled());
+  AllowedCollision::Type type;
+  EXPECT_TRUE(first->getAllowedCollision("a", "b", type));
+  EXPECT_EQ(AllowedCollision::ALWAYS, type);
+  EXPECT_TRUE(acm.getCompiled()->getAllowedCollision("a", "b", type));
+  EXPECT_EQ(AllowedCollision::NEVER, type);
+
+  acm.removeEntry("a");
+  EXPECT_FALSE(acm.getCompiled()->getAllowedCollision("a", "b", type));
+
+  acm.setDefaultEntry("b", true);
+  std::vector<std::string> names = { "a", "b", "c" };
+  expectSameAnswers(acm, names);
+
+  AllowedCollisionMatrix copy(acm);
+  expectSameAnswers(copy, names);
+  copy.clear();
+  EXPECT_EQ(0u, copy.getCompiled()->getSize());
+  expectSameAnswers(acm, names);
+}
+
+TEST(CompiledAllowedCollisionMatrix, AlwaysAllowedSets)
+{
+  AllowedCollisionMatrix acm;
+  acm.setEntry("link", "table", true);
+  acm.setEntry("link", "box", true);
+  acm.setEntry("link", "part", false);
+  acm.setDefaultEntry("floor", true);
+
+  CompiledAllowedCollisionMatrixConstPtr compiled = acm.getCompiled();
+  CompiledAllowedCollisionMatrix::ElementSet set;
+  EXPECT_TRUE(compiled->isAlwaysAllowed(compiled->getIndex("link"), set));
+
+  compiled->addToSet("table", set);
+  compiled->addToSet("box", set);
+  compiled->addToSet("floor", set);
+  EXPECT_TRUE(compiled->isAlwaysAllowed(compiled->getIndex("link"), set));
+  EXPECT_FALSE(compiled->isAlwaysAllowed(compiled->getIndex("part"), set));
+  EXPECT_FALSE(compiled->isAlwaysAllowed(compiled->getIndex("unknown"), set));
+  EXPECT_TRUE(compiled->isAlwaysAllowed(compiled->getIndex("floor"), set));
+
+  CompiledAllowedCollisionMatrix::ElementSet with_part = set;
+  compiled->addToSet("part", with_part);
+  EXPECT_FALSE(compiled->isAlwaysAllowed(compiled->getIndex("link"), with_part));
+
+  CompiledAllowedCollisionMatrix::ElementSet with_unknown = set;
+  compiled->addToSet("unknown", with_unknown);
+  EXPECT_FALSE(compiled->isAlwaysAllowed(compiled->getIndex("link"), with_unknown));
+  EXPECT_TRUE(compiled->isAlwaysAllowed(compiled->getIndex("floor"), with_unknown));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,154 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <gtest/gtest.h>
+#include <moveit/collision_detection/swept_volume.h>
+#include <urdf_parser/urdf_parser.h>
+#include <geometric_shapes/shapes.h>
+#include <octomap/octomap.h>
+
+namespace
+{
+const std::string URDF = "<?xml version=\"1.0\" ?>"
+                         "<robot name=\"cube\">"
+                         "  <link name=\"base_link\">"
+                         "    <collision>"
+                         "      <origin rpy=\"0 0 0\" xyz=\"0 0 0\"/>"
+                         "      <geometry><box size=\"0.2 0.2 0.2\"/></geometry>"
+                         "    </collision>"
+                         "  </link>"
+                         "</robot>";
+
+const std::string SRDF = "<?xml version=\"1.0\" ?>"
+                         "<robot name=\"cube\">"
+                         "  <virtual_joint name=\"base_joint\" child_link=\"base_link\" parent_frame=\"odom\" "
+                         "type=\"planar\"/>"
+                         "</robot>";
+
+robot_model::RobotModelPtr loadModel()
+{
+  urdf::ModelInterfaceSharedPtr urdf_model = urdf::parseURDF(URDF);
+  srdf::ModelSharedPtr srdf_model(new srdf::Model());
+  srdf_model->initString(*urdf_model, SRDF);
+  return robot_model::RobotModelPtr(new robot_model::RobotModel(urdf_model, srdf_model));
+}
+
+/* the cube moves along x through the given positions */
+robot_trajectory::RobotTrajectory makeTrajectory(const robot_model::RobotModelConstPtr& model,
+                                                  const std::vector<double>& positions)
+{
+  robot_trajectory::RobotTrajectory trajectory(model, "");
+  robot_state::RobotState state(model);
+  state.setToDefaultValues();
+  for (double x : positions)
+  {
+    state.setVariablePosition("base_joint/x", x);
+    state.update();
+    trajectory.addSuffixWayPoint(state, 0.1);
+  }
+  return trajectory;
+}
+}
+
+TEST(SweptVolume, VoxelKeys)
+{
+  collision_detection::SweptVolume volume(0.05);
+  Eigen::Vector3d point(1.01, -2.32, 0.07);
+  Eigen::Vector3d center = volume.getVoxelCenter(volume.getVoxelKey(point));
+  EXPECT_LE((center - point).cwiseAbs().maxCoeff(), 0.025 + 1e-9);
+  EXPECT_EQ(volume.getVoxelKey(center), volume.getVoxelKey(point));
+  EXPECT_NE(volume.getVoxelKey(point), volume.getVoxelKey(point + Eigen::Vector3d(0.05, 0.0, 0.0)));
+}
+
+TEST(SweptVolume, SegmentsAgainstWorld)
+{
+  robot_model::RobotModelPtr model = loadModel();
+  const double positions[] = { 0.0, 1.0, 2.0 };
+  robot_trajectory::RobotTrajectory trajectory =
+      makeTrajectory(model, std::vector<double>(positions, positions + 3));
+
+  collision_detection::SweptVolume volume(0.05);
+  volume.compute(trajectory);
+  ASSERT_EQ(volume.getSegmentCount(), 2u);
+  EXPECT_FALSE(volume.getSegmentVoxels(0).empty());
+
+  collision_detection::World world;
+  collision_detection::SweptVolume::Occupancy occupied;
+  volume.rasterizeWorld(world, occupied);
+  EXPECT_TRUE(occupied.empty());
+  EXPECT_EQ(volume.findFirstIntersectingSegment(occupied), -1);
+
+  // an obstacle next to the path
+  Eigen::Affine3d pose(Eigen::Translation3d(1.5, 1.0, 0.0));
+  world.addToObject("aside", shapes::ShapeConstPtr(new shapes::Box(0.1, 0.1, 0.1)), pose);
+  volume.rasterizeWorld(world, occupied);
+  EXPECT_FALSE(occupied.empty());
+  EXPECT_EQ(volume.findFirstIntersectingSegment(occupied), -1);
+
+  // an obstacle in the middle of the second segment, away from the waypoints
+  pose = Eigen::Translation3d(1.5, 0.0, 0.0);
+  world.addToObject("ahead", shapes::ShapeConstPtr(new shapes::Box(0.1, 0.1, 0.1)), pose);
+  volume.rasterizeWorld(world, occupied);
+  EXPECT_FALSE(volume.intersects(0, occupied));
+  EXPECT_TRUE(volume.intersects(1, occupied));
+  EXPECT_EQ(volume.findFirstIntersectingSegment(occupied), 1);
+}
+
+TEST(SweptVolume, Octomap)
+{
+  robot_model::RobotModelPtr model = loadModel();
+  const double positions[] = { 0.0, 1.0 };
+  collision_detection::SweptVolume volume(0.05);
+  volume.compute(makeTrajectory(model, std::vector<double>(positions, positions + 2)));
+
+  std::shared_ptr<octomap::OcTree> octree(new octomap::OcTree(0.02));
+  octree->updateNode(octomap::point3d(0.5, 0.5, 0.0), true);
+  collision_detection::World world;
+  world.addToObject("<octomap>", shapes::ShapeConstPtr(new shapes::OcTree(octree)), Eigen::Affine3d::Identity());
+
+  collision_detection::SweptVolume::Occupancy occupied;
+  volume.rasterizeWorld(world, occupied);
+  EXPECT_FALSE(occupied.empty());
+  EXPECT_EQ(volume.findFirstIntersectingSegment(occupied), -1);
+
+  octree->updateNode(octomap::point3d(0.5, 0.0, 0.0), true);
+  volume.rasterizeWorld(world, occupied);
+  EXPECT_EQ(volume.findFirstIntersectingSegment(occupied), 0);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -365,6 +365,37 @@ TEST(World, TrackChanges)
   EXPECT_EQ(4, ta3.cnt_);
 }
 
+TEST(World, CopyOnWrite)
+{
+  collision_detection::World world;
+
+  shapes::ShapePtr ball(new shapes::Sphere(1.0));
+  shapes::ShapePtr box(new shapes::Box(1, 2, 3));
+  world.addToObject("ball", ball, Eigen::Affine3d::Identity());
+  world.addToObject("box", box, Eigen::Affine3d::Identity());
+
+  collision_detection::World copy(world);
+  EXPECT_EQ(2, copy.size());
+  EXPECT_EQ(world.getObject("ball"), copy.getObject("ball"));
+
+  // only the modified object is copied
+  copy.moveShapeInObject("ball", ball, Eigen::Affine3d(Eigen::Translation3d(0, 0, 1)));
+  EXPECT_NE(world.getObject("ball"), copy.getObject("ball"));
+  EXPECT_EQ(world.getObject("box"), copy.getObject("box"));
+  EXPECT_TRUE(world.getObject("ball")->shape_poses_[0].isApprox(Eigen::Affine3d::Identity()));
+  EXPECT_FALSE(copy.getObject("ball")->shape_poses_[0].isApprox(Eigen::Affine3d::Identity()));
+
+  // changes to the original are not visible in the copy
+  world.removeObject("box");
+  world.addToObject("cyl", shapes::ShapePtr(new shapes::Cylinder(4, 5)), Eigen::Affine3d::Identity());
+  EXPECT_TRUE(copy.hasObject("box"));
+  EXPECT_FALSE(copy.hasObject("cyl"));
+
+  copy.clearObjects();
+  EXPECT_EQ(0, copy.size());
+  EXPECT_EQ(2, world.size());
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,131 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <gtest/gtest.h>
+#include <moveit/collision_detection/world_index.h>
+#include <geometric_shapes/shapes.h>
+#include <algorithm>
+
+namespace
+{
+Eigen::Affine3d at(double x, double y, double z)
+{
+  return Eigen::Affine3d(Eigen::Translation3d(x, y, z));
+}
+
+bool contains(const std::vector<std::string>& ids, const std::string& id)
+{
+  return std::find(ids.begin(), ids.end(), id) != ids.end();
+}
+}
+
+TEST(WorldIndex, TracksObjects)
+{
+  collision_detection::WorldPtr world(new collision_detection::World);
+  shapes::ShapePtr box(new shapes::Box(1, 1, 1));
+  world->addToObject("existing", box, at(10, 0, 0));
+
+  collision_detection::WorldIndex index(world);
+  Eigen::Vector3d min, max;
+  ASSERT_TRUE(index.getObjectBounds("existing", min, max));
+  EXPECT_NEAR(9.5, min.x(), 1e-9);
+  EXPECT_NEAR(10.5, max.x(), 1e-9);
+
+  world->addToObject("added", box, at(0, 0, 0));
+  std::vector<std::string> ids = index.getObjectsInBox(Eigen::Vector3d(-1, -1, -1), Eigen::Vector3d(1, 1, 1));
+  ASSERT_EQ(1u, ids.size());
+  EXPECT_EQ("added", ids[0]);
+
+  world->moveShapeInObject("added", box, at(20, 0, 0));
+  EXPECT_TRUE(index.getObjectsInBox(Eigen::Vector3d(-1, -1, -1), Eigen::Vector3d(1, 1, 1)).empty());
+  EXPECT_EQ(1u, index.getObjectsInBox(Eigen::Vector3d(19, -1, -1), Eigen::Vector3d(21, 1, 1)).size());
+
+  world->removeObject("added");
+  EXPECT_TRUE(index.getObjectsInBox(Eigen::Vector3d(19, -1, -1), Eigen::Vector3d(21, 1, 1)).empty());
+  EXPECT_FALSE(index.getObjectBounds("added", min, max));
+}
+
+TEST(WorldIndex, MatchesLinearScan)
+{
+  collision_detection::WorldPtr world(new collision_detection::World);
+  collision_detection::WorldIndex index(world);
+  shapes::ShapePtr ball(new shapes::Sphere(0.1));
+  for (int i = 0; i < 10; ++i)
+    for (int j = 0; j < 10; ++j)
+      world->addToObject("ball_" + std::to_string(i) + "_" + std::to_string(j), ball, at(i, j, 0));
+
+  // overlapping and contained boxes
+  std::vector<std::string> ids = index.getObjectsInBox(Eigen::Vector3d(1.95, 2.85, -1), Eigen::Vector3d(4.05, 3.15, 1));
+  EXPECT_EQ(3u, ids.size());
+  EXPECT_TRUE(contains(ids, "ball_2_3"));
+  EXPECT_TRUE(contains(ids, "ball_3_3"));
+  EXPECT_TRUE(contains(ids, "ball_4_3"));
+  ids = index.getObjectsInBox(Eigen::Vector3d(1.95, 2.85, -1), Eigen::Vector3d(4.05, 3.15, 1), true);
+  EXPECT_EQ(1u, ids.size());
+  EXPECT_TRUE(contains(ids, "ball_3_3"));
+
+  ids = index.getObjectsInSphere(Eigen::Vector3d(5, 5, 0), 0.95);
+  EXPECT_EQ(5u, ids.size());
+  EXPECT_TRUE(contains(ids, "ball_5_5"));
+  EXPECT_TRUE(contains(ids, "ball_4_5"));
+  EXPECT_TRUE(contains(ids, "ball_5_6"));
+
+  std::string nearest;
+  double distance;
+  ASSERT_TRUE(index.getNearestObject(Eigen::Vector3d(7.2, 1.6, 0), nearest, distance));
+  EXPECT_EQ("ball_7_2", nearest);
+  ASSERT_TRUE(index.getNearestObject(Eigen::Vector3d(-3, 0, 0), nearest, distance));
+  EXPECT_EQ("ball_0_0", nearest);
+  EXPECT_NEAR(2.9, distance, 1e-9);
+}
+
+TEST(WorldIndex, PlanesAreUnbounded)
+{
+  collision_detection::WorldPtr world(new collision_detection::World);
+  collision_detection::WorldIndex index(world);
+  shapes::ShapePtr plane(new shapes::Plane(0, 0, 1, 0));
+  world->addToObject("floor", plane, Eigen::Affine3d::Identity());
+
+  EXPECT_TRUE(contains(index.getObjectsInBox(Eigen::Vector3d(5, 5, 5), Eigen::Vector3d(6, 6, 6)), "floor"));
+  EXPECT_FALSE(contains(index.getObjectsInBox(Eigen::Vector3d(5, 5, 5), Eigen::Vector3d(6, 6, 6), true), "floor"));
+  std::string nearest;
+  double distance;
+  EXPECT_FALSE(index.getNearestObject(Eigen::Vector3d::Zero(), nearest, distance));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
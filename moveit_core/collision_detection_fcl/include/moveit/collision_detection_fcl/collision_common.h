@@ -40,9 +40,11 @@
 #include <moveit/collision_detection/world.h>
 #include <moveit/collision_detection/collision_world.h>
 #include <moveit/macros/class_forward.h>
+#include <moveit/collision_detection_fcl/occupancy_pyramid.h>
 #include <fcl/broadphase/broadphase.h>
 #include <fcl/collision.h>
 #include <fcl/distance.h>
+#include <fcl/continuous_collision.h>
 #include <memory>
 #include <set>
 
@@ -111,6 +113,10 @@ struct CollisionGeometryData
     const World::Object* obj;
     const void* raw;
   } ptr;
+
+  /** \brief For octrees in the world, the coarse occupancy used to skip pairs before FCL traverses the tree. It is
+   *  replaced whenever the world reports a change of the object, so access it with std::atomic_load/store */
+  OccupancyPyramidConstPtr occupancy;
 };
 
 struct CollisionData
@@ -122,6 +128,8 @@ struct CollisionData
   CollisionData(const CollisionRequest* req, CollisionResult* res, const AllowedCollisionMatrix* acm)
     : req_(req), active_components_only_(NULL), res_(res), acm_(acm), done_(false)
   {
+    if (acm_)
+      compiled_acm_ = acm_->getCompiled();
   }
 
   ~CollisionData()
@@ -145,14 +153,32 @@ struct CollisionData
   /// The user specified collision matrix (may be NULL)
   const AllowedCollisionMatrix* acm_;
 
+  /// Compiled view of \e acm_ used to filter pairs (NULL if \e acm_ is NULL)
+  CompiledAllowedCollisionMatrixConstPtr compiled_acm_;
+
   /// Flag indicating whether collision checking is complete
   bool done_;
 };
 
+/** \brief Data for continuous collision checks. The broadphase holds collision objects that bound the volume swept by
+ *  the moving bodies; \e motions_ maps each of them to the collision objects of the body at the start and at the end of
+ *  the motion. Objects not found in \e motions_ are static. */
+struct ContinuousCollisionData : public CollisionData
+{
+  ContinuousCollisionData(const CollisionRequest* req, CollisionResult* res, const AllowedCollisionMatrix* acm)
+    : CollisionData(req, res, acm)
+  {
+  }
+
+  std::map<const fcl::CollisionObject*, std::pair<const fcl::CollisionObject*, const fcl::CollisionObject*> > motions_;
+};
+
 struct DistanceData
 {
   DistanceData(const DistanceRequest* req, DistanceResult* res) : req(req), res(res), done(false)
   {
+    if (req->acm)
+      compiled_acm = req->acm->getCompiled();
   }
   ~DistanceData()
   {
@@ -164,6 +190,12 @@ struct DistanceData
   /// Distance query results information
   DistanceResult* res;
 
+  /// Compiled view of the collision matrix of the request (NULL if the request has none)
+  CompiledAllowedCollisionMatrixConstPtr compiled_acm;
+
+  /// With DistanceRequest::compact_pairs, the index in DistanceResult::pairs of each pair of bodies found so far
+  std::map<std::pair<const void*, const void*>, std::size_t> pair_indices;
+
   /// Indicates if distance query is finished.
   bool done;
 };
@@ -206,6 +238,10 @@ struct FCLGeometry
 
   std::shared_ptr<fcl::CollisionGeometry> collision_geometry_;
   CollisionGeometryDataPtr collision_geometry_data_;
+
+  /** \brief The shared geometry \e collision_geometry_ was copied from, if any (e.g., a mesh BVH built once for all
+   * meshes with the same content). Kept so the shared copy stays cached while it is in use. */
+  std::shared_ptr<const fcl::CollisionGeometry> source_geometry_;
 };
 
 typedef std::shared_ptr<fcl::CollisionObject> FCLCollisionObjectPtr;
@@ -219,6 +255,9 @@ struct FCLObject
 
   std::vector<FCLCollisionObjectPtr> collision_objects_;
   std::vector<FCLGeometryConstPtr> collision_geometry_;
+
+  /// For objects of attached bodies, the shape each entry of collision_geometry_ was created for
+  std::vector<shapes::ShapeConstPtr> attached_shapes_;
 };
 
 struct FCLManager
@@ -231,6 +270,19 @@ bool collisionCallback(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void*
 
 bool distanceCallback(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void* data, double& min_dist);
 
+/** \brief Evaluate the pair named in the request's warm start (if any) between the objects of \e obj1 and \e obj2,
+ * so that later broadphase queries with the same \e data start from a tight distance bound */
+void distanceWarmStart(const FCLObject& obj1, const FCLObject& obj2, DistanceData& data);
+
+/** \brief Callback for continuous collision checks; \e data must point to a ContinuousCollisionData */
+bool continuousCollisionCallback(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void* data);
+
+/** \brief Fill \e swept with objects that bound the volume swept by the objects of \e start as they move to the
+ *  corresponding objects of \e end, and record the motions in \e data. \e start and \e end must hold the same
+ *  geometries in the same order. */
+void constructSweptFCLObject(const FCLObject& start, const FCLObject& end, FCLObject& swept,
+                             ContinuousCollisionData& data);
+
 FCLGeometryConstPtr createCollisionGeometry(const shapes::ShapeConstPtr& shape, const robot_model::LinkModel* link,
                                             int shape_index);
 FCLGeometryConstPtr createCollisionGeometry(const shapes::ShapeConstPtr& shape, const robot_state::AttachedBody* ab,
@@ -245,6 +297,10 @@ FCLGeometryConstPtr createCollisionGeometry(const shapes::ShapeConstPtr& shape,
                                             const World::Object* obj);
 void cleanCollisionGeometryCache();
 
+/** \brief Build the BVH of \e shape, if it is a mesh, so that creating a world object geometry for a mesh with the
+    same content while the returned handle is held only copies it. Thread safe. */
+std::shared_ptr<const void> prepareCollisionGeometry(const shapes::ShapeConstPtr& shape);
+
 inline void transform2fcl(const Eigen::Affine3d& b, fcl::Transform3f& f)
 {
   Eigen::Quaterniond q(b.rotation());
@@ -38,6 +38,7 @@
 #define MOVEIT_COLLISION_DETECTION_FCL_COLLISION_ROBOT_
 
 #include <moveit/collision_detection_fcl/collision_common.h>
+#include <boost/thread/tss.hpp>
 
 namespace collision_detection
 {
@@ -85,18 +86,68 @@ public:
 
 protected:
   virtual void updatedPaddingOrScaling(const std::vector<std::string>& links);
-  void constructFCLObject(const robot_state::RobotState& state, FCLObject& fcl_obj) const;
+  /** \brief Fill \e fcl_obj with the collision objects of the robot links and attached bodies at \e state. If
+   *  \e active_links is given, only those links and the bodies attached to them are included; such objects cannot be
+   *  passed to updateFCLObject(). */
+  void constructFCLObject(const robot_state::RobotState& state, FCLObject& fcl_obj,
+                          const std::set<const robot_model::LinkModel*>* active_links = nullptr) const;
+
+  /** \brief Update \e fcl_obj, previously filled by constructFCLObject(), to reflect \e state. The collision objects for
+   *  the robot links are reused and only get their transforms updated; so are the objects for attached bodies, unless
+   *  \e state carries different bodies than the state \e fcl_obj was built for. */
+  void updateFCLObject(const robot_state::RobotState& state, FCLObject& fcl_obj) const;
+
+  /** \brief Append the collision objects for the bodies attached to \e state to \e fcl_obj; only for the ones
+   *  attached to \e active_links, if given. */
+  void constructAttachedBodyFCLObjects(const robot_state::RobotState& state, FCLObject& fcl_obj,
+                                       const std::set<const robot_model::LinkModel*>* active_links = nullptr) const;
+
+  /** \brief Move the collision objects of attached bodies in \e fcl_obj, those from index \e first on, to the poses of
+   *  the bodies attached to \e state. This only succeeds if the objects were constructed for exactly these bodies and
+   *  shapes; otherwise false is returned and \e fcl_obj is left unchanged. The moved objects are appended to
+   *  \e updated, if given. */
+  bool updateAttachedBodyFCLObjects(const robot_state::RobotState& state, FCLObject& fcl_obj, std::size_t first,
+                                    std::vector<fcl::CollisionObject*>* updated) const;
   void allocSelfCollisionBroadPhase(const robot_state::RobotState& state, FCLManager& manager) const;
+
+  /** \brief Get the self collision broadphase of the calling thread, updated to reflect \e state. The broadphase is kept
+   *  between calls and only the collision objects of links whose transforms changed since the previous query of this
+   *  thread are moved in it. The returned reference is only valid until the next call from the same thread. */
+  FCLManager& getSelfCollisionBroadPhase(const robot_state::RobotState& state) const;
   void getAttachedBodyObjects(const robot_state::AttachedBody* ab, std::vector<FCLGeometryConstPtr>& geoms) const;
 
   void checkSelfCollisionHelper(const CollisionRequest& req, CollisionResult& res, const robot_state::RobotState& state,
                                 const AllowedCollisionMatrix* acm) const;
+  void checkSelfCollisionHelper(const CollisionRequest& req, CollisionResult& res,
+                                const robot_state::RobotState& state1, const robot_state::RobotState& state2,
+                                const AllowedCollisionMatrix* acm) const;
   void checkOtherCollisionHelper(const CollisionRequest& req, CollisionResult& res,
                                  const robot_state::RobotState& state, const CollisionRobot& other_robot,
                                  const robot_state::RobotState& other_state, const AllowedCollisionMatrix* acm) const;
 
   std::vector<FCLGeometryConstPtr> geoms_;
   std::vector<FCLCollisionObjectConstPtr> fcl_objs_;
+
+private:
+  /** \brief A self collision broadphase kept by one thread between queries */
+  struct SelfCollisionCache
+  {
+    /// The value of cache_id_ the broadphase was built for
+    std::size_t cache_id_;
+
+    /// The number of collision objects that correspond to robot links (they are stored first in manager_.object_)
+    std::size_t link_object_count_;
+
+    /// The transforms the link collision objects were last placed at
+    EigenSTL::vector_Affine3d link_transforms_;
+
+    FCLManager manager_;
+  };
+
+  /// Identifies this instance and the version of geoms_; changes whenever cached broadphases become invalid
+  std::size_t cache_id_;
+
+  mutable boost::thread_specific_ptr<SelfCollisionCache> self_collision_cache_;
 };
 }
 
@@ -60,6 +60,14 @@ public:
   virtual void checkRobotCollision(const CollisionRequest& req, CollisionResult& res, const CollisionRobot& robot,
                                    const robot_state::RobotState& state1, const robot_state::RobotState& state2,
                                    const AllowedCollisionMatrix& acm) const;
+  virtual void checkRobotCollisionBatch(const CollisionRequest& req, std::vector<CollisionResult>& res,
+                                        const CollisionRobot& robot,
+                                        const std::vector<const robot_state::RobotState*>& states,
+                                        const AllowedCollisionMatrix* acm = NULL) const;
+  virtual void checkCollisionBatch(const CollisionRequest& req, std::vector<CollisionResult>& res,
+                                   const CollisionRobot& robot,
+                                   const std::vector<const robot_state::RobotState*>& states,
+                                   const AllowedCollisionMatrix* acm = NULL) const;
   virtual void checkWorldCollision(const CollisionRequest& req, CollisionResult& res,
                                    const CollisionWorld& other_world) const;
   virtual void checkWorldCollision(const CollisionRequest& req, CollisionResult& res, const CollisionWorld& other_world,
@@ -73,16 +81,50 @@ public:
 
   virtual void setWorld(const WorldPtr& world);
 
+  virtual std::shared_ptr<const void> prepareShape(const shapes::ShapeConstPtr& shape) const override;
+
 protected:
   void checkWorldCollisionHelper(const CollisionRequest& req, CollisionResult& res, const CollisionWorld& other_world,
                                  const AllowedCollisionMatrix* acm) const;
   void checkRobotCollisionHelper(const CollisionRequest& req, CollisionResult& res, const CollisionRobot& robot,
                                  const robot_state::RobotState& state, const AllowedCollisionMatrix* acm) const;
+  void checkRobotCollisionHelper(const CollisionRequest& req, CollisionResult& res, const CollisionRobot& robot,
+                                 const robot_state::RobotState& state, const FCLObject& fcl_obj,
+                                 const AllowedCollisionMatrix* acm) const;
+  void checkRobotCollisionHelper(const CollisionRequest& req, CollisionResult& res, const CollisionRobot& robot,
+                                 const robot_state::RobotState& state1, const robot_state::RobotState& state2,
+                                 const AllowedCollisionMatrix* acm) const;
+
+  /** \brief Check all \e states, reusing one FCLObject per thread. Self collisions are checked as well if \e self is
+   *  true */
+  void checkCollisionBatchHelper(const CollisionRequest& req, std::vector<CollisionResult>& res,
+                                 const CollisionRobot& robot, const std::vector<const robot_state::RobotState*>& states,
+                                 const AllowedCollisionMatrix* acm, bool self) const;
+
+  /** \brief Conservative pre-check for robot collision checks: return false if no sphere bounding a link geometry of
+   *  \e robot at \e state overlaps the bounding box of a world object, in which case no contact is possible. The
+   *  spheres are the ones FCL itself bounds rotated geometries with, so the check never rejects a pair the broadphase
+   *  would report. States with attached bodies always return true. If \e active_links is given, only those links
+   *  and the bodies attached to them are considered. */
+  bool mayCollideWithRobot(const CollisionRobotFCL& robot, const robot_state::RobotState& state,
+                           const std::set<const robot_model::LinkModel*>* active_links = nullptr) const;
+
+  /** \brief The links moved by the group of \e req, or NULL if the request is not for a group. Contacts of other
+   *  links are not reported for such requests, the same as the collision callback does. */
+  static const std::set<const robot_model::LinkModel*>* activeLinks(const CollisionRequest& req,
+                                                                   const CollisionRobot& robot);
+
+  /** \brief Whether the robot body \e data describes is one of \e active_links or attached to one of them */
+  static bool isActive(const CollisionGeometryData& data, const std::set<const robot_model::LinkModel*>& active_links);
 
   void constructFCLObject(const World::Object* obj, FCLObject& fcl_obj) const;
   void updateFCLObject(const std::string& id);
 
-  std::unique_ptr<fcl::BroadPhaseCollisionManager> manager_;
+  /** \brief Make sure the broadphase manager is not shared with a copy of this world before modifying it */
+  void ensureUniqueManager();
+
+  /** \brief The broadphase manager. Copies of a world share it until one of them changes */
+  std::shared_ptr<fcl::BroadPhaseCollisionManager> manager_;
   std::map<std::string, FCLObject> fcl_objs_;
 
 private:
@@ -0,0 +1,102 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#ifndef MOVEIT_COLLISION_DETECTION_FCL_OCCUPANCY_PYRAMID_
+#define MOVEIT_COLLISION_DETECTION_FCL_OCCUPANCY_PYRAMID_
+
+#include <moveit/macros/class_forward.h>
+#include <Eigen/Geometry>
+#include <vector>
+
+namespace octomap
+{
+class OcTree;
+}
+
+namespace collision_detection
+{
+MOVEIT_CLASS_FORWARD(OccupancyPyramid);
+
+/** \brief A hierarchy of coarse occupancy grids over a set of occupied boxes (e.g., the occupied leaves of an octree).
+ *
+ * The finest grid has at most \e max_cells cells along each axis, and every coarser level halves the number of cells
+ * until a single cell covers everything. A cell is marked if any box touches it, so the pyramid can only report
+ * occupancy conservatively: if mayBeOccupied() returns false for a region, no box intersects it. */
+class OccupancyPyramid
+{
+public:
+  /** \brief Build the pyramid over \e boxes; cells are never smaller than \e resolution */
+  OccupancyPyramid(const std::vector<Eigen::AlignedBox3d>& boxes, double resolution, unsigned int max_cells = 128);
+
+  /** \brief Return false only if no box intersects the axis aligned box spanned by \e min and \e max */
+  bool mayBeOccupied(const Eigen::Vector3d& min, const Eigen::Vector3d& max) const;
+
+  /** \brief The number of levels; 0 if there are no boxes */
+  std::size_t getLevelCount() const
+  {
+    return levels_.size();
+  }
+
+  /** \brief The size of the cells at the finest level */
+  double getCellSize() const
+  {
+    return levels_.empty() ? 0.0 : levels_.front().cell_size;
+  }
+
+private:
+  struct Level
+  {
+    double cell_size;
+    int size[3];
+    std::vector<bool> cells;
+
+    bool get(int x, int y, int z) const
+    {
+      return cells[(static_cast<std::size_t>(z) * size[1] + y) * size[0] + x];
+    }
+  };
+
+  bool mayBeOccupied(std::size_t level, int x, int y, int z, const Eigen::Vector3d& min,
+                     const Eigen::Vector3d& max) const;
+
+  Eigen::Vector3d origin_;
+  std::vector<Level> levels_;
+};
+
+/** \brief Build a pyramid over the leaves of \e octree that FCL considers occupied */
+OccupancyPyramidPtr createOccupancyPyramid(const octomap::OcTree& octree);
+}
+
+#endif
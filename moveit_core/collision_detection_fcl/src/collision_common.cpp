@@ -39,19 +39,19 @@
 #include <fcl/BVH/BVH_model.h>
 #include <fcl/shape/geometric_shapes.h>
 #include <fcl/octree.h>
+#include <moveit/profiler/probes.h>
 #include <boost/thread/mutex.hpp>
+#include <boost/functional/hash.hpp>
 #include <memory>
+#include <limits>
 
 namespace collision_detection
 {
-bool collisionCallback(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void* data)
+/* Decide whether the pair of bodies needs to be checked at all. If collisions between the bodies are only
+   conditionally allowed, \e dcf is set to the function that decides which contacts are acceptable. */
+static bool checkBodyPair(const CollisionGeometryData* cd1, const CollisionGeometryData* cd2, CollisionData* cdata,
+                          DecideContactFn& dcf)
 {
-  CollisionData* cdata = reinterpret_cast<CollisionData*>(data);
-  if (cdata->done_)
-    return true;
-  const CollisionGeometryData* cd1 = static_cast<const CollisionGeometryData*>(o1->collisionGeometry()->getUserData());
-  const CollisionGeometryData* cd2 = static_cast<const CollisionGeometryData*>(o2->collisionGeometry()->getUserData());
-
   // do not collision check geoms part of the same object / link / attached body
   if (cd1->sameObject(*cd2))
     return false;
@@ -75,12 +75,11 @@ bool collisionCallback(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void*
   }
 
   // use the collision matrix (if any) to avoid certain collision checks
-  DecideContactFn dcf;
   bool always_allow_collision = false;
-  if (cdata->acm_)
+  if (cdata->compiled_acm_)
   {
     AllowedCollision::Type type;
-    bool found = cdata->acm_->getAllowedCollision(cd1->getID(), cd2->getID(), type);
+    bool found = cdata->compiled_acm_->getAllowedCollision(cd1->getID(), cd2->getID(), type);
     if (found)
     {
       // if we have an entry in the collision matrix, we read it
@@ -136,14 +135,13 @@ bool collisionCallback(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void*
   }
 
   // if collisions are always allowed, we are done
-  if (always_allow_collision)
-    return false;
-
-  if (cdata->req_->verbose)
-    ROS_DEBUG_NAMED("collision_detection.fcl", "Actually checking collisions between %s and %s", cd1->getID().c_str(),
-                    cd2->getID().c_str());
+  return !always_allow_collision;
+}
 
-  // see if we need to compute a contact
+/* Compute how many more contacts should be stored for the pair of bodies */
+static std::size_t wantedContactCount(const CollisionGeometryData* cd1, const CollisionGeometryData* cd2,
+                                      CollisionData* cdata)
+{
   std::size_t want_contact_count = 0;
   if (cdata->req_->contacts)
     if (cdata->res_->contact_count < cdata->req_->max_contacts)
@@ -163,6 +161,88 @@ bool collisionCallback(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void*
         want_contact_count =
             std::min(cdata->req_->max_contacts_per_pair - have, cdata->req_->max_contacts - cdata->res_->contact_count);
     }
+  return want_contact_count;
+}
+
+/* Check whether the collision query can stop, given the contacts found so far */
+static void updateCollisionDone(CollisionData* cdata)
+{
+  if (cdata->res_->collision)
+    if (!cdata->req_->contacts || cdata->res_->contact_count >= cdata->req_->max_contacts)
+    {
+      if (!cdata->req_->cost)
+        cdata->done_ = true;
+      if (cdata->req_->verbose)
+        ROS_INFO_NAMED("collision_detection.fcl",
+                       "Collision checking is considered complete (collision was found and %u contacts are stored)",
+                       (unsigned int)cdata->res_->contact_count);
+    }
+
+  if (!cdata->done_ && cdata->req_->is_done)
+  {
+    cdata->done_ = cdata->req_->is_done(*cdata->res_);
+    if (cdata->done_ && cdata->req_->verbose)
+      ROS_INFO_NAMED("collision_detection.fcl", "Collision checking is considered complete due to external callback. "
+                                                "%s was found. %u contacts are stored.",
+                     cdata->res_->collision ? "Collision" : "No collision", (unsigned int)cdata->res_->contact_count);
+  }
+}
+
+/* Check whether the bounding box of \e other touches an occupied region of the octree \e octree_obj, if it is one */
+static bool octreeMayCollide(const fcl::CollisionObject* octree_obj, const CollisionGeometryData* octree_data,
+                             const fcl::CollisionObject* other)
+{
+  OccupancyPyramidConstPtr occupancy = std::atomic_load(&octree_data->occupancy);
+  if (!occupancy)
+    return true;
+
+  // express the world aligned bounding box of the other object in the frame of the octree
+  const fcl::AABB& aabb = other->getAABB();
+  const fcl::Matrix3f& r = octree_obj->getRotation();
+  const fcl::Vec3f& t = octree_obj->getTranslation();
+  Eigen::Vector3d min = Eigen::Vector3d::Constant(std::numeric_limits<double>::infinity());
+  Eigen::Vector3d max = -min;
+  for (int c = 0; c < 8; ++c)
+  {
+    const fcl::Vec3f d = fcl::Vec3f((c & 1) ? aabb.max_[0] : aabb.min_[0], (c & 2) ? aabb.max_[1] : aabb.min_[1],
+                                    (c & 4) ? aabb.max_[2] : aabb.min_[2]) -
+                         t;
+    for (int k = 0; k < 3; ++k)
+    {
+      const double v = r(0, k) * d[0] + r(1, k) * d[1] + r(2, k) * d[2];
+      min[k] = std::min(min[k], v);
+      max[k] = std::max(max[k], v);
+    }
+  }
+  return occupancy->mayBeOccupied(min, max);
+}
+
+bool collisionCallback(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void* data)
+{
+  CollisionData* cdata = reinterpret_cast<CollisionData*>(data);
+  if (cdata->done_)
+    return true;
+  const CollisionGeometryData* cd1 = static_cast<const CollisionGeometryData*>(o1->collisionGeometry()->getUserData());
+  const CollisionGeometryData* cd2 = static_cast<const CollisionGeometryData*>(o2->collisionGeometry()->getUserData());
+
+  // skip pairs of geoms that belong to the same body or are allowed to collide
+  DecideContactFn dcf;
+  if (!checkBodyPair(cd1, cd2, cdata, dcf))
+    return false;
+
+  // octrees are screened with their occupancy pyramid first; cost sources also come from uncertain cells
+  if (!cdata->req_->cost && (!octreeMayCollide(o1, cd1, o2) || !octreeMayCollide(o2, cd2, o1)))
+  {
+    MOVEIT_PROBE_COUNT("CollisionWorldFCL::octree pair skipped", 1);
+    return false;
+  }
+
+  if (cdata->req_->verbose)
+    ROS_DEBUG_NAMED("collision_detection.fcl", "Actually checking collisions between %s and %s", cd1->getID().c_str(),
+                    cd2->getID().c_str());
+
+  // see if we need to compute a contact
+  std::size_t want_contact_count = wantedContactCount(cd1, cd2, cdata);
 
   if (dcf)
   {
@@ -325,29 +405,160 @@ bool collisionCallback(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void*
     }
   }
 
-  if (cdata->res_->collision)
-    if (!cdata->req_->contacts || cdata->res_->contact_count >= cdata->req_->max_contacts)
+  updateCollisionDone(cdata);
+
+  return cdata->done_;
+}
+
+bool continuousCollisionCallback(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void* data)
+{
+  ContinuousCollisionData* cdata = reinterpret_cast<ContinuousCollisionData*>(data);
+  if (cdata->done_)
+    return true;
+  const CollisionGeometryData* cd1 = static_cast<const CollisionGeometryData*>(o1->collisionGeometry()->getUserData());
+  const CollisionGeometryData* cd2 = static_cast<const CollisionGeometryData*>(o2->collisionGeometry()->getUserData());
+
+  // skip pairs of geoms that belong to the same body or are allowed to collide
+  DecideContactFn dcf;
+  if (!checkBodyPair(cd1, cd2, cdata, dcf))
+    return false;
+
+  // the broadphase only holds bounding volumes for moving bodies; look up the actual motions
+  const fcl::CollisionObject* start1 = o1;
+  const fcl::CollisionObject* end1 = o1;
+  const fcl::CollisionObject* start2 = o2;
+  const fcl::CollisionObject* end2 = o2;
+  auto it = cdata->motions_.find(o1);
+  if (it != cdata->motions_.end())
+  {
+    start1 = it->second.first;
+    end1 = it->second.second;
+  }
+  it = cdata->motions_.find(o2);
+  if (it != cdata->motions_.end())
+  {
+    start2 = it->second.first;
+    end2 = it->second.second;
+  }
+  const fcl::CollisionGeometry* g1 = start1->collisionGeometry().get();
+  const fcl::CollisionGeometry* g2 = start2->collisionGeometry().get();
+
+  if (cdata->req_->verbose)
+    ROS_DEBUG_NAMED("collision_detection.fcl", "Actually checking continuous collisions between %s and %s",
+                    cd1->getID().c_str(), cd2->getID().c_str());
+
+  fcl::ContinuousCollisionRequest ccd_req(10, 0.0001, fcl::CCDM_LINEAR, fcl::GST_LIBCCD,
+                                          fcl::CCDC_CONSERVATIVE_ADVANCEMENT);
+  fcl::ContinuousCollisionResult ccd_res;
+  if (fcl::continuousCollide(g1, start1->getTransform(), end1->getTransform(), g2, start2->getTransform(),
+                             end2->getTransform(), ccd_req, ccd_res) < 0.0)
+  {
+    // conservative advancement is not available for all pairs of geometry types (e.g., octrees);
+    // in that case the motion is sampled instead
+    ccd_req.ccd_solver_type = fcl::CCDC_NAIVE;
+    ccd_res = fcl::ContinuousCollisionResult();
+    fcl::continuousCollide(g1, start1->getTransform(), end1->getTransform(), g2, start2->getTransform(),
+                           end2->getTransform(), ccd_req, ccd_res);
+  }
+  if (!ccd_res.is_collide)
+    return false;
+
+  std::size_t want_contact_count = wantedContactCount(cd1, cd2, cdata);
+  if (dcf || want_contact_count > 0)
+  {
+    // compute the contacts at the time of contact, if any are available there
+    fcl::CollisionResult col_result;
+    fcl::collide(g1, ccd_res.contact_tf1, g2, ccd_res.contact_tf2,
+                 fcl::CollisionRequest(dcf ? std::numeric_limits<size_t>::max() : want_contact_count, true),
+                 col_result);
+    std::vector<Contact> contacts;
+    for (std::size_t i = 0; i < col_result.numContacts(); ++i)
     {
-      if (!cdata->req_->cost)
-        cdata->done_ = true;
-      if (cdata->req_->verbose)
-        ROS_INFO_NAMED("collision_detection.fcl",
-                       "Collision checking is considered complete (collision was found and %u contacts are stored)",
-                       (unsigned int)cdata->res_->contact_count);
+      Contact c;
+      fcl2contact(col_result.getContact(i), c);
+      contacts.push_back(c);
+    }
+    if (contacts.empty())
+    {
+      // conservative advancement stops just before the bodies touch
+      Contact c;
+      const fcl::Vec3f& t1 = ccd_res.contact_tf1.getTranslation();
+      const fcl::Vec3f& t2 = ccd_res.contact_tf2.getTranslation();
+      c.pos = Eigen::Vector3d((t1[0] + t2[0]) / 2.0, (t1[1] + t2[1]) / 2.0, (t1[2] + t2[2]) / 2.0);
+      c.normal = Eigen::Vector3d::Zero();
+      c.depth = 0.0;
+      c.body_name_1 = cd1->getID();
+      c.body_type_1 = cd1->type;
+      c.body_name_2 = cd2->getID();
+      c.body_type_2 = cd2->type;
+      contacts.push_back(c);
     }
 
-  if (!cdata->done_ && cdata->req_->is_done)
-  {
-    cdata->done_ = cdata->req_->is_done(*cdata->res_);
-    if (cdata->done_ && cdata->req_->verbose)
-      ROS_INFO_NAMED("collision_detection.fcl", "Collision checking is considered complete due to external callback. "
-                                                "%s was found. %u contacts are stored.",
-                     cdata->res_->collision ? "Collision" : "No collision", (unsigned int)cdata->res_->contact_count);
+    const std::pair<std::string, std::string>& pc = cd1->getID() < cd2->getID() ?
+                                                        std::make_pair(cd1->getID(), cd2->getID()) :
+                                                        std::make_pair(cd2->getID(), cd1->getID());
+    bool collision = !dcf;
+    for (std::size_t i = 0; i < contacts.size(); ++i)
+    {
+      // if we have a decider for allowed contacts, only contacts that are not allowed count
+      if (dcf && dcf(contacts[i]))
+        continue;
+      collision = true;
+      if (want_contact_count > 0)
+      {
+        --want_contact_count;
+        cdata->res_->contacts[pc].push_back(contacts[i]);
+        cdata->res_->contact_count++;
+      }
+    }
+    if (!collision)
+      return false;
   }
 
+  cdata->res_->collision = true;
+  if (cdata->req_->verbose)
+    ROS_INFO_NAMED("collision_detection.fcl", "Found a continuous collision between '%s' (type '%s') and '%s' "
+                                              "(type '%s') at time %lf of the motion",
+                   cd1->getID().c_str(), cd1->getTypeString().c_str(), cd2->getID().c_str(),
+                   cd2->getTypeString().c_str(), ccd_res.time_of_contact);
+
+  updateCollisionDone(cdata);
   return cdata->done_;
 }
 
+void constructSweptFCLObject(const FCLObject& start, const FCLObject& end, FCLObject& swept,
+                             ContinuousCollisionData& data)
+{
+  std::size_t count = std::min(start.collision_objects_.size(), end.collision_objects_.size());
+  swept.collision_objects_.reserve(count);
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    const fcl::CollisionObject* s = start.collision_objects_[i].get();
+    const fcl::CollisionObject* e = end.collision_objects_[i].get();
+    const fcl::CollisionGeometry* g = s->collisionGeometry().get();
+
+    fcl::AABB aabb = s->getAABB();
+    aabb += e->getAABB();
+
+    // while the body rotates, its points can leave the boxes of the two end poses;
+    // they stay within the arc length of the point furthest from the body origin
+    const fcl::Quaternion3f& q1 = s->getQuatRotation();
+    const fcl::Quaternion3f& q2 = e->getQuatRotation();
+    double cos_half = fabs(q1.getW() * q2.getW() + q1.getX() * q2.getX() + q1.getY() * q2.getY() +
+                           q1.getZ() * q2.getZ());
+    double angle = 2.0 * acos(std::min(1.0, cos_half));
+    double margin = (g->aabb_center.length() + g->aabb_radius) * angle;
+    aabb.expand(fcl::Vec3f(margin, margin, margin));
+
+    std::shared_ptr<fcl::CollisionGeometry> box(new fcl::Box(aabb.width(), aabb.height(), aabb.depth()));
+    box->setUserData(g->getUserData());
+    box->computeLocalAABB();
+    FCLCollisionObjectPtr co(new fcl::CollisionObject(box, fcl::Transform3f(aabb.center())));
+    swept.collision_objects_.push_back(co);
+    data.motions_[co.get()] = std::make_pair(s, e);
+  }
+}
+
 struct FCLShapeCache
 {
   using ShapeKey = std::weak_ptr<const shapes::Shape>;
@@ -387,10 +598,26 @@ struct FCLShapeCache
   boost::mutex lock_;
 };
 
+/* The distance below which pairs still need to be evaluated. For GLOBAL requests this is the best distance found so
+   far. With signed distances, penetrating pairs must still be visited to find the deepest one, so the bound is kept
+   positive. */
+static double distanceBound(const DistanceData* cdata)
+{
+  double bound = cdata->req->distance_threshold;
+  if (cdata->req->type == DistanceRequestType::GLOBAL)
+    bound = std::min(bound, cdata->res->minimum_distance.distance);
+  if (cdata->req->enable_signed_distance)
+    bound = std::max(bound, std::numeric_limits<double>::epsilon());
+  return bound;
+}
+
 bool distanceCallback(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void* data, double& min_dist)
 {
   DistanceData* cdata = reinterpret_cast<DistanceData*>(data);
 
+  // let the broadphase skip pairs whose bounding volumes are already farther apart than needed
+  min_dist = distanceBound(cdata);
+
   const CollisionGeometryData* cd1 = static_cast<const CollisionGeometryData*>(o1->collisionGeometry()->getUserData());
   const CollisionGeometryData* cd2 = static_cast<const CollisionGeometryData*>(o2->collisionGeometry()->getUserData());
 
@@ -420,11 +647,11 @@ bool distanceCallback(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void*
 
   // use the collision matrix (if any) to avoid certain distance checks
   bool always_allow_collision = false;
-  if (cdata->req->acm)
+  if (cdata->compiled_acm)
   {
     AllowedCollision::Type type;
 
-    bool found = cdata->req->acm->getAllowedCollision(cd1->getID(), cd2->getID(), type);
+    bool found = cdata->compiled_acm->getAllowedCollision(cd1->getID(), cd2->getID(), type);
     if (found)
     {
       // if we have an entry in the collision matrix, we read it
@@ -478,13 +705,32 @@ bool distanceCallback(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void*
 
   fcl::DistanceResult fcl_result;
   DistanceResultsData dist_result;
-  double dist_threshold = cdata->req->distance_threshold;
+  double dist_threshold = distanceBound(cdata);
 
-  const std::pair<std::string, std::string>& pc = cd1->getID() < cd2->getID() ?
-                                                      std::make_pair(cd1->getID(), cd2->getID()) :
-                                                      std::make_pair(cd2->getID(), cd1->getID());
+  // compact results identify bodies by the object they were created from instead of by name
+  const bool compact = cdata->req->compact_pairs && cdata->req->type == DistanceRequestType::SINGLE;
+  std::pair<const void*, const void*> pair_key;
+  std::size_t pair_index = cdata->res->pairs.size();
+  std::pair<std::string, std::string> pc;
+  DistanceMap::iterator it = cdata->res->distances.end();
 
-  DistanceMap::iterator it = cdata->res->distances.find(pc);
+  if (compact)
+  {
+    pair_key = std::less<const void*>()(cd1->ptr.raw, cd2->ptr.raw) ? std::make_pair(cd1->ptr.raw, cd2->ptr.raw) :
+                                                                       std::make_pair(cd2->ptr.raw, cd1->ptr.raw);
+    auto pt = cdata->pair_indices.find(pair_key);
+    if (pt != cdata->pair_indices.end())
+    {
+      pair_index = pt->second;
+      dist_threshold = cdata->res->pairs.distances[pair_index];
+    }
+  }
+  else
+  {
+    pc = cd1->getID() < cd2->getID() ? std::make_pair(cd1->getID(), cd2->getID()) :
+                                       std::make_pair(cd2->getID(), cd1->getID());
+    it = cdata->res->distances.find(pc);
+  }
 
   if (it != cdata->res->distances.end())
   {
@@ -496,10 +742,6 @@ bool distanceCallback(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void*
         return cdata->done;
       }
     }
-    else if (cdata->req->type == DistanceRequestType::GLOBAL)
-    {
-      dist_threshold = cdata->res->minimum_distance.distance;
-    }
     else if (cdata->req->type == DistanceRequestType::SINGLE)
     {
       dist_threshold = it->second[0].distance;
@@ -507,7 +749,8 @@ bool distanceCallback(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void*
   }
 
   fcl_result.min_distance = dist_threshold;
-  double d = fcl::distance(o1, o2, fcl::DistanceRequest(cdata->req->enable_nearest_points), fcl_result);
+  const bool nearest_points = cdata->req->enable_nearest_points || cdata->req->compute_gradient;
+  double d = fcl::distance(o1, o2, fcl::DistanceRequest(nearest_points), fcl_result);
 
   // Check if either object is already in the map. If not add it or if present
   // check to see if the new distance is closer. If closer remove the existing
@@ -517,11 +760,11 @@ bool distanceCallback(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void*
     dist_result.distance = fcl_result.min_distance;
     dist_result.nearest_points[0] = Eigen::Vector3d(fcl_result.nearest_points[0].data.vs);
     dist_result.nearest_points[1] = Eigen::Vector3d(fcl_result.nearest_points[1].data.vs);
-    dist_result.link_names[0] = cd1->ptr.obj->id_;
-    dist_result.link_names[1] = cd2->ptr.obj->id_;
+    dist_result.link_names[0] = cd1->getID();
+    dist_result.link_names[1] = cd2->getID();
     dist_result.body_types[0] = cd1->type;
     dist_result.body_types[1] = cd2->type;
-    if (cdata->req->enable_nearest_points)
+    if (nearest_points)
     {
       dist_result.normal = (dist_result.nearest_points[1] - dist_result.nearest_points[0]).normalized();
     }
@@ -569,7 +812,13 @@ bool distanceCallback(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void*
       cdata->res->collision = true;
     }
 
-    if (cdata->req->type != DistanceRequestType::GLOBAL)
+    if (compact)
+    {
+      if (pair_index == cdata->res->pairs.size())
+        cdata->pair_indices[pair_key] = pair_index;
+      cdata->res->pairs.set(pair_index, dist_result);
+    }
+    else if (cdata->req->type != DistanceRequestType::GLOBAL)
     {
       if (it == cdata->res->distances.end())
       {
@@ -586,7 +835,7 @@ bool distanceCallback(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void*
         }
         else if (cdata->req->type == DistanceRequestType::SINGLE)
         {
-          if (it->second[0].distance < dist_result.distance)
+          if (dist_result.distance < it->second[0].distance)
             it->second[0] = dist_result;
         }
         else if (cdata->req->type == DistanceRequestType::LIMITED)
@@ -601,11 +850,194 @@ bool distanceCallback(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void*
     {
       cdata->done = true;
     }
+
+    if (dist_result.distance < cdata->req->early_termination_distance)
+    {
+      cdata->done = true;
+    }
+    min_dist = distanceBound(cdata);
   }
 
   return cdata->done;
 }
 
+void distanceWarmStart(const FCLObject& obj1, const FCLObject& obj2, DistanceData& data)
+{
+  const DistanceResultsData* warm_start = data.req->warm_start;
+  if (!warm_start || data.req->type != DistanceRequestType::GLOBAL)
+    return;
+  const std::string& name1 = warm_start->link_names[0];
+  const std::string& name2 = warm_start->link_names[1];
+
+  for (std::size_t i = 0; !data.done && i < obj1.collision_objects_.size(); ++i)
+  {
+    fcl::CollisionObject* o1 = obj1.collision_objects_[i].get();
+    const std::string& id1 = static_cast<const CollisionGeometryData*>(o1->collisionGeometry()->getUserData())->getID();
+    if (id1 != name1 && id1 != name2)
+      continue;
+    for (std::size_t j = 0; !data.done && j < obj2.collision_objects_.size(); ++j)
+    {
+      fcl::CollisionObject* o2 = obj2.collision_objects_[j].get();
+      const std::string& id2 =
+          static_cast<const CollisionGeometryData*>(o2->collisionGeometry()->getUserData())->getID();
+      if ((id1 == name1 && id2 == name2) || (id1 == name2 && id2 == name1))
+      {
+        double min_dist = std::numeric_limits<double>::max();
+        distanceCallback(o1, o2, &data, min_dist);
+      }
+    }
+  }
+}
+
+/* Cache of mesh BVHs keyed by mesh content rather than by shape pointer, so identical meshes (the same model loaded
+   into several scenes, or the same link padded by the same amount) only build their BVH once. Geometries carry
+   per-owner user data, so users get a copy of the cached BVH; copying is much cheaper than building the hierarchy. */
+template <typename BV>
+struct FCLMeshCache
+{
+  using BVHModelConstPtr = std::shared_ptr<const fcl::BVHModel<BV>>;
+  using MeshMap = std::multimap<std::size_t, std::weak_ptr<const fcl::BVHModel<BV>>>;
+
+  FCLMeshCache() : clean_count_(0)
+  {
+  }
+
+  static std::size_t hashMesh(const shapes::Mesh* mesh)
+  {
+    std::size_t seed = 0;
+    boost::hash_combine(seed, mesh->vertex_count);
+    boost::hash_combine(seed, mesh->triangle_count);
+    boost::hash_range(seed, mesh->vertices, mesh->vertices + 3 * mesh->vertex_count);
+    boost::hash_range(seed, mesh->triangles, mesh->triangles + 3 * mesh->triangle_count);
+    return seed;
+  }
+
+  static bool sameMesh(const fcl::BVHModel<BV>& model, const shapes::Mesh* mesh)
+  {
+    if (model.num_vertices != (int)mesh->vertex_count || model.num_tris != (int)mesh->triangle_count)
+      return false;
+    for (unsigned int i = 0; i < mesh->vertex_count; ++i)
+      for (unsigned int j = 0; j < 3; ++j)
+        if (model.vertices[i][j] != mesh->vertices[3 * i + j])
+          return false;
+    for (unsigned int i = 0; i < mesh->triangle_count; ++i)
+      for (unsigned int j = 0; j < 3; ++j)
+        if (model.tri_indices[i][j] != mesh->triangles[3 * i + j])
+          return false;
+    return true;
+  }
+
+  /* find a BVH for \e mesh; must be called with lock_ held */
+  BVHModelConstPtr find(std::size_t hash, const shapes::Mesh* mesh) const
+  {
+    std::pair<typename MeshMap::const_iterator, typename MeshMap::const_iterator> range = map_.equal_range(hash);
+    for (typename MeshMap::const_iterator it = range.first; it != range.second; ++it)
+    {
+      BVHModelConstPtr model = it->second.lock();
+      if (model && sameMesh(*model, mesh))
+        return model;
+    }
+    return BVHModelConstPtr();
+  }
+
+  /* add a BVH to the cache; must be called with lock_ held */
+  void insert(std::size_t hash, const BVHModelConstPtr& model)
+  {
+    map_.insert(std::make_pair(hash, model));
+    if (++clean_count_ > MAX_CLEAN_COUNT)
+    {
+      clean_count_ = 0;
+      for (typename MeshMap::iterator it = map_.begin(); it != map_.end();)
+        if (it->second.expired())
+          map_.erase(it++);
+        else
+          ++it;
+    }
+  }
+
+  static const unsigned int MAX_CLEAN_COUNT = 100;  // every this many insertions expired entries are removed
+  MeshMap map_;
+  unsigned int clean_count_;
+  boost::mutex lock_;
+};
+
+template <typename BV>
+FCLMeshCache<BV>& GetMeshCache()
+{
+  static FCLMeshCache<BV> cache;
+  return cache;
+}
+
+/* Get the shared BVH for \e mesh, building it if no mesh with the same content is cached */
+template <typename BV>
+std::shared_ptr<const fcl::BVHModel<BV>> getMeshBVH(const shapes::Mesh* mesh)
+{
+  FCLMeshCache<BV>& cache = GetMeshCache<BV>();
+  std::size_t hash = FCLMeshCache<BV>::hashMesh(mesh);
+  {
+    boost::mutex::scoped_lock slock(cache.lock_);
+    std::shared_ptr<const fcl::BVHModel<BV>> model = cache.find(hash, mesh);
+    if (model)
+      return model;
+  }
+
+  // build outside the lock; other threads may be building different meshes
+  std::shared_ptr<fcl::BVHModel<BV>> g(new fcl::BVHModel<BV>());
+  std::vector<fcl::Triangle> tri_indices(mesh->triangle_count);
+  for (unsigned int i = 0; i < mesh->triangle_count; ++i)
+    tri_indices[i] = fcl::Triangle(mesh->triangles[3 * i], mesh->triangles[3 * i + 1], mesh->triangles[3 * i + 2]);
+
+  std::vector<fcl::Vec3f> points(mesh->vertex_count);
+  for (unsigned int i = 0; i < mesh->vertex_count; ++i)
+    points[i] = fcl::Vec3f(mesh->vertices[3 * i], mesh->vertices[3 * i + 1], mesh->vertices[3 * i + 2]);
+
+  g->beginModel();
+  g->addSubModel(points, tri_indices);
+  g->endModel();
+  g->computeLocalAABB();
+
+  boost::mutex::scoped_lock slock(cache.lock_);
+  // another thread may have built the same mesh in the meantime; keep only one copy
+  std::shared_ptr<const fcl::BVHModel<BV>> model = cache.find(hash, mesh);
+  if (model)
+    return model;
+  cache.insert(hash, g);
+  return g;
+}
+
+/* Get the shared BVH for \e scaled, a scaled or padded copy of \e mesh: the triangles are the same and only the
+   vertices moved. Rather than building a new hierarchy, the one of \e mesh is copied and its bounding volumes are
+   refit to the moved vertices, which makes changing the padding of a link much cheaper. */
+template <typename BV>
+std::shared_ptr<const fcl::BVHModel<BV>> getScaledMeshBVH(const shapes::Mesh* mesh, const shapes::Mesh* scaled)
+{
+  FCLMeshCache<BV>& cache = GetMeshCache<BV>();
+  std::size_t hash = FCLMeshCache<BV>::hashMesh(scaled);
+  {
+    boost::mutex::scoped_lock slock(cache.lock_);
+    std::shared_ptr<const fcl::BVHModel<BV>> model = cache.find(hash, scaled);
+    if (model)
+      return model;
+  }
+
+  std::shared_ptr<const fcl::BVHModel<BV>> base = getMeshBVH<BV>(mesh);
+  std::shared_ptr<fcl::BVHModel<BV>> g(new fcl::BVHModel<BV>(*base));
+  if (g->beginUpdateModel() != fcl::BVH_OK)
+    return getMeshBVH<BV>(scaled);
+  for (unsigned int i = 0; i < scaled->vertex_count; ++i)
+    g->updateVertex(fcl::Vec3f(scaled->vertices[3 * i], scaled->vertices[3 * i + 1], scaled->vertices[3 * i + 2]));
+  if (g->endUpdateModel(true, true) != fcl::BVH_OK)
+    return getMeshBVH<BV>(scaled);
+  g->computeLocalAABB();
+
+  boost::mutex::scoped_lock slock(cache.lock_);
+  std::shared_ptr<const fcl::BVHModel<BV>> model = cache.find(hash, scaled);
+  if (model)
+    return model;
+  cache.insert(hash, g);
+  return g;
+}
+
 /* We template the function so we get a different cache for each of the template arguments combinations */
 template <typename BV, typename T>
 FCLShapeCache& GetShapeCache()
@@ -743,6 +1175,7 @@ FCLGeometryConstPtr createCollisionGeometry(const shapes::ShapeConstPtr& shape,
   }
 
   fcl::CollisionGeometry* cg_g = nullptr;
+  std::shared_ptr<const fcl::CollisionGeometry> source;
   if (shape->type == shapes::PLANE)  // shapes that directly produce CollisionGeometry
   {
     // handle cases individually
@@ -789,24 +1222,14 @@ FCLGeometryConstPtr createCollisionGeometry(const shapes::ShapeConstPtr& shape,
       break;
       case shapes::MESH:
       {
-        auto g = new fcl::BVHModel<BV>();
         const shapes::Mesh* mesh = static_cast<const shapes::Mesh*>(shape.get());
         if (mesh->vertex_count > 0 && mesh->triangle_count > 0)
         {
-          std::vector<fcl::Triangle> tri_indices(mesh->triangle_count);
-          for (unsigned int i = 0; i < mesh->triangle_count; ++i)
-            tri_indices[i] =
-                fcl::Triangle(mesh->triangles[3 * i], mesh->triangles[3 * i + 1], mesh->triangles[3 * i + 2]);
-
-          std::vector<fcl::Vec3f> points(mesh->vertex_count);
-          for (unsigned int i = 0; i < mesh->vertex_count; ++i)
-            points[i] = fcl::Vec3f(mesh->vertices[3 * i], mesh->vertices[3 * i + 1], mesh->vertices[3 * i + 2]);
-
-          g->beginModel();
-          g->addSubModel(points, tri_indices);
-          g->endModel();
+          source = getMeshBVH<BV>(mesh);
+          cg_g = new fcl::BVHModel<BV>(*static_cast<const fcl::BVHModel<BV>*>(source.get()));
         }
-        cg_g = g;
+        else
+          cg_g = new fcl::BVHModel<BV>();
       }
       break;
       case shapes::OCTREE:
@@ -824,7 +1247,9 @@ FCLGeometryConstPtr createCollisionGeometry(const shapes::ShapeConstPtr& shape,
   if (cg_g)
   {
     cg_g->computeLocalAABB();
-    FCLGeometryConstPtr res(new FCLGeometry(cg_g, data, shape_index));
+    FCLGeometry* fg = new FCLGeometry(cg_g, data, shape_index);
+    fg->source_geometry_ = source;
+    FCLGeometryConstPtr res(fg);
     boost::mutex::scoped_lock slock(cache.lock_);
     cache.map_[wptr] = res;
     cache.bumpUseCount();
@@ -862,6 +1287,17 @@ FCLGeometryConstPtr createCollisionGeometry(const shapes::ShapeConstPtr& shape,
   {
     shapes::ShapePtr scaled_shape(shape->clone());
     scaled_shape->scaleAndPadd(scale, padding);
+
+    // scaling and padding keep the triangles of a mesh, so its BVH is refit instead of built; the hierarchy is kept
+    // alive here until the geometry below picks it up from the mesh cache
+    std::shared_ptr<const fcl::BVHModel<BV>> refit;
+    if (shape->type == shapes::MESH)
+    {
+      const shapes::Mesh* mesh = static_cast<const shapes::Mesh*>(shape.get());
+      const shapes::Mesh* scaled_mesh = static_cast<const shapes::Mesh*>(scaled_shape.get());
+      if (mesh->vertex_count > 0 && mesh->triangle_count > 0 && mesh->vertex_count == scaled_mesh->vertex_count)
+        refit = getScaledMeshBVH<BV>(mesh, scaled_mesh);
+    }
     return createCollisionGeometry<BV, T>(scaled_shape, data, shape_index);
   }
 }
@@ -897,6 +1333,17 @@ void cleanCollisionGeometryCache()
     cache2.bumpUseCount(true);
   }
 }
+
+std::shared_ptr<const void> prepareCollisionGeometry(const shapes::ShapeConstPtr& shape)
+{
+  if (!shape || shape->type != shapes::MESH)
+    return std::shared_ptr<const void>();
+  const shapes::Mesh* mesh = static_cast<const shapes::Mesh*>(shape.get());
+  if (mesh->vertex_count == 0 || mesh->triangle_count == 0)
+    return std::shared_ptr<const void>();
+  // world objects use this bounding volume type (see createCollisionGeometry() for World::Object)
+  return getMeshBVH<fcl::OBBRSS>(mesh);
+}
 }
 
 void collision_detection::CollisionData::enableGroup(const robot_model::RobotModelConstPtr& kmodel)
@@ -926,4 +1373,5 @@ void collision_detection::FCLObject::clear()
 {
   collision_objects_.clear();
   collision_geometry_.clear();
+  attached_shapes_.clear();
 }
@@ -35,11 +35,24 @@
 /* Author: Ioan Sucan */
 
 #include <moveit/collision_detection_fcl/collision_robot_fcl.h>
+#include <moveit/profiler/probes.h>
+#include <atomic>
 
 namespace collision_detection
 {
+namespace
+{
+// Thread specific data is keyed by address, so a new instance may see caches left behind by a destroyed one. Unique
+// ids make sure these are never mistaken for valid caches.
+std::size_t nextCacheId()
+{
+  static std::atomic<std::size_t> next_id(0);
+  return ++next_id;
+}
+}
+
 CollisionRobotFCL::CollisionRobotFCL(const robot_model::RobotModelConstPtr& model, double padding, double scale)
-  : CollisionRobot(model, padding, scale)
+  : CollisionRobot(model, padding, scale), cache_id_(nextCacheId())
 {
   const std::vector<const robot_model::LinkModel*>& links = robot_model_->getLinkModelsWithCollisionGeometry();
   std::size_t index;
@@ -68,7 +81,8 @@ CollisionRobotFCL::CollisionRobotFCL(const robot_model::RobotModelConstPtr& mode
     }
 }
 
-CollisionRobotFCL::CollisionRobotFCL(const CollisionRobotFCL& other) : CollisionRobot(other)
+CollisionRobotFCL::CollisionRobotFCL(const CollisionRobotFCL& other)
+  : CollisionRobot(other), cache_id_(nextCacheId())
 {
   geoms_ = other.geoms_;
   fcl_objs_ = other.fcl_objs_;
@@ -86,7 +100,8 @@ void CollisionRobotFCL::getAttachedBodyObjects(const robot_state::AttachedBody*
   }
 }
 
-void CollisionRobotFCL::constructFCLObject(const robot_state::RobotState& state, FCLObject& fcl_obj) const
+void CollisionRobotFCL::constructFCLObject(const robot_state::RobotState& state, FCLObject& fcl_obj,
+                                           const std::set<const robot_model::LinkModel*>* active_links) const
 {
   fcl_obj.collision_objects_.reserve(geoms_.size());
   fcl::Transform3f fcl_tf;
@@ -94,6 +109,8 @@ void CollisionRobotFCL::constructFCLObject(const robot_state::RobotState& state,
   for (std::size_t i = 0; i < geoms_.size(); ++i)
     if (geoms_[i] && geoms_[i]->collision_geometry_)
     {
+      if (active_links && active_links->find(geoms_[i]->collision_geometry_data_->ptr.link) == active_links->end())
+        continue;
       transform2fcl(state.getCollisionBodyTransform(geoms_[i]->collision_geometry_data_->ptr.link,
                                                     geoms_[i]->collision_geometry_data_->shape_index),
                     fcl_tf);
@@ -103,25 +120,115 @@ void CollisionRobotFCL::constructFCLObject(const robot_state::RobotState& state,
       fcl_obj.collision_objects_.push_back(FCLCollisionObjectPtr(collObj));
     }
 
-  // TODO: Implement a method for caching fcl::CollisionObject's for robot_state::AttachedBody's
+  constructAttachedBodyFCLObjects(state, fcl_obj, active_links);
+}
+
+void CollisionRobotFCL::updateFCLObject(const robot_state::RobotState& state, FCLObject& fcl_obj) const
+{
+  fcl::Transform3f fcl_tf;
+  std::size_t k = 0;
+
+  for (std::size_t i = 0; i < geoms_.size(); ++i)
+    if (geoms_[i] && geoms_[i]->collision_geometry_)
+    {
+      // if the object was not constructed for this robot (or the geometry changed since), start from scratch
+      if (k >= fcl_obj.collision_objects_.size() ||
+          fcl_obj.collision_objects_[k]->collisionGeometry() != geoms_[i]->collision_geometry_)
+      {
+        fcl_obj.clear();
+        constructFCLObject(state, fcl_obj);
+        return;
+      }
+      transform2fcl(state.getCollisionBodyTransform(geoms_[i]->collision_geometry_data_->ptr.link,
+                                                    geoms_[i]->collision_geometry_data_->shape_index),
+                    fcl_tf);
+      fcl::CollisionObject* collObj = fcl_obj.collision_objects_[k++].get();
+      collObj->setTransform(fcl_tf);
+      collObj->computeAABB();
+    }
+
+  // the objects for links always come first; everything after them belongs to attached bodies
+  if (updateAttachedBodyFCLObjects(state, fcl_obj, k, nullptr))
+    return;
+  fcl_obj.collision_objects_.resize(k);
+  fcl_obj.collision_geometry_.clear();
+  fcl_obj.attached_shapes_.clear();
+  constructAttachedBodyFCLObjects(state, fcl_obj);
+}
+
+void CollisionRobotFCL::constructAttachedBodyFCLObjects(
+    const robot_state::RobotState& state, FCLObject& fcl_obj,
+    const std::set<const robot_model::LinkModel*>* active_links) const
+{
+  fcl::Transform3f fcl_tf;
+
   std::vector<const robot_state::AttachedBody*> ab;
   state.getAttachedBodies(ab);
   for (auto& body : ab)
   {
-    std::vector<FCLGeometryConstPtr> objs;
-    getAttachedBodyObjects(body, objs);
+    if (active_links && active_links->find(body->getAttachedLink()) == active_links->end())
+      continue;
+    const std::vector<shapes::ShapeConstPtr>& shapes = body->getShapes();
     const EigenSTL::vector_Affine3d& ab_t = body->getGlobalCollisionBodyTransforms();
-    for (std::size_t k = 0; k < objs.size(); ++k)
-      if (objs[k]->collision_geometry_)
+    for (std::size_t k = 0; k < shapes.size(); ++k)
+    {
+      FCLGeometryConstPtr g = createCollisionGeometry(shapes[k], body, k);
+      if (g && g->collision_geometry_)
       {
         transform2fcl(ab_t[k], fcl_tf);
         fcl_obj.collision_objects_.push_back(
-            FCLCollisionObjectPtr(new fcl::CollisionObject(objs[k]->collision_geometry_, fcl_tf)));
+            FCLCollisionObjectPtr(new fcl::CollisionObject(g->collision_geometry_, fcl_tf)));
         // we copy the shared ptr to the CollisionGeometryData, as this is not stored by the class itself,
-        // and would be destroyed when objs goes out of scope.
-        fcl_obj.collision_geometry_.push_back(objs[k]);
+        // and would be destroyed when g goes out of scope.
+        fcl_obj.collision_geometry_.push_back(g);
+        // holding the shape also guarantees a different shape is never mistaken for this one
+        fcl_obj.attached_shapes_.push_back(shapes[k]);
       }
+    }
+  }
+}
+
+bool CollisionRobotFCL::updateAttachedBodyFCLObjects(const robot_state::RobotState& state, FCLObject& fcl_obj,
+                                                     std::size_t first,
+                                                     std::vector<fcl::CollisionObject*>* updated) const
+{
+  const std::size_t count = fcl_obj.attached_shapes_.size();
+  if (first + count != fcl_obj.collision_objects_.size() || count != fcl_obj.collision_geometry_.size())
+    return false;
+
+  std::vector<const robot_state::AttachedBody*> ab;
+  state.getAttachedBodies(ab);
+
+  // the objects are reusable if they were created for the same bodies, carrying the same shapes, in the same order
+  std::size_t m = 0;
+  for (auto& body : ab)
+  {
+    const std::vector<shapes::ShapeConstPtr>& shapes = body->getShapes();
+    for (std::size_t k = 0; k < shapes.size(); ++k, ++m)
+      if (m >= count || fcl_obj.attached_shapes_[m] != shapes[k] ||
+          fcl_obj.collision_geometry_[m]->collision_geometry_data_->ptr.ab != body ||
+          fcl_obj.collision_geometry_[m]->collision_geometry_data_->shape_index != (int)k)
+        return false;
+  }
+  if (m != count)
+    return false;
+
+  fcl::Transform3f fcl_tf;
+  m = 0;
+  for (auto& body : ab)
+  {
+    const EigenSTL::vector_Affine3d& ab_t = body->getGlobalCollisionBodyTransforms();
+    for (std::size_t k = 0; k < ab_t.size(); ++k, ++m)
+    {
+      transform2fcl(ab_t[k], fcl_tf);
+      fcl::CollisionObject* collObj = fcl_obj.collision_objects_[first + m].get();
+      collObj->setTransform(fcl_tf);
+      collObj->computeAABB();
+      if (updated)
+        updated->push_back(collObj);
+    }
   }
+  return true;
 }
 
 void CollisionRobotFCL::allocSelfCollisionBroadPhase(const robot_state::RobotState& state, FCLManager& manager) const
@@ -134,6 +241,74 @@ void CollisionRobotFCL::allocSelfCollisionBroadPhase(const robot_state::RobotSta
   // manager.manager_->update();
 }
 
+FCLManager& CollisionRobotFCL::getSelfCollisionBroadPhase(const robot_state::RobotState& state) const
+{
+  SelfCollisionCache* cache = self_collision_cache_.get();
+  if (!cache)
+  {
+    cache = new SelfCollisionCache();
+    self_collision_cache_.reset(cache);
+    cache->cache_id_ = 0;
+  }
+
+  FCLManager& manager = cache->manager_;
+  if (cache->cache_id_ != cache_id_ || !manager.manager_)
+  {
+    // (re)build the broadphase from scratch
+    allocSelfCollisionBroadPhase(state, manager);
+    cache->cache_id_ = cache_id_;
+    cache->link_object_count_ = 0;
+    cache->link_transforms_.clear();
+    for (std::size_t i = 0; i < geoms_.size(); ++i)
+      if (geoms_[i] && geoms_[i]->collision_geometry_)
+      {
+        cache->link_transforms_.push_back(state.getCollisionBodyTransform(
+            geoms_[i]->collision_geometry_data_->ptr.link, geoms_[i]->collision_geometry_data_->shape_index));
+        cache->link_object_count_++;
+      }
+    return manager;
+  }
+
+  // move only the link objects whose transform changed since the previous query
+  std::vector<fcl::CollisionObject*> updated;
+  fcl::Transform3f fcl_tf;
+  std::size_t k = 0;
+  for (std::size_t i = 0; i < geoms_.size(); ++i)
+    if (geoms_[i] && geoms_[i]->collision_geometry_)
+    {
+      const Eigen::Affine3d& tf = state.getCollisionBodyTransform(geoms_[i]->collision_geometry_data_->ptr.link,
+                                                                  geoms_[i]->collision_geometry_data_->shape_index);
+      if (tf.matrix() != cache->link_transforms_[k].matrix())
+      {
+        cache->link_transforms_[k] = tf;
+        transform2fcl(tf, fcl_tf);
+        fcl::CollisionObject* collObj = manager.object_.collision_objects_[k].get();
+        collObj->setTransform(fcl_tf);
+        collObj->computeAABB();
+        updated.push_back(collObj);
+      }
+      ++k;
+    }
+
+  // objects of bodies that are still attached are only moved; if the attached bodies changed, they are replaced
+  if (!updateAttachedBodyFCLObjects(state, manager.object_, cache->link_object_count_, &updated))
+  {
+    for (std::size_t i = cache->link_object_count_; i < manager.object_.collision_objects_.size(); ++i)
+      manager.manager_->unregisterObject(manager.object_.collision_objects_[i].get());
+    manager.object_.collision_objects_.resize(cache->link_object_count_);
+    manager.object_.collision_geometry_.clear();
+    manager.object_.attached_shapes_.clear();
+    constructAttachedBodyFCLObjects(state, manager.object_);
+    for (std::size_t i = cache->link_object_count_; i < manager.object_.collision_objects_.size(); ++i)
+      manager.manager_->registerObject(manager.object_.collision_objects_[i].get());
+  }
+
+  if (!updated.empty())
+    manager.manager_->update(updated);
+
+  return manager;
+}
+
 void CollisionRobotFCL::checkSelfCollision(const CollisionRequest& req, CollisionResult& res,
                                            const robot_state::RobotState& state) const
 {
@@ -151,22 +326,46 @@ void CollisionRobotFCL::checkSelfCollision(const CollisionRequest& req, Collisio
                                            const robot_state::RobotState& state1,
                                            const robot_state::RobotState& state2) const
 {
-  ROS_ERROR_NAMED("collision_detection.fcl", "FCL continuous collision checking not yet implemented");
+  checkSelfCollisionHelper(req, res, state1, state2, nullptr);
 }
 
 void CollisionRobotFCL::checkSelfCollision(const CollisionRequest& req, CollisionResult& res,
                                            const robot_state::RobotState& state1, const robot_state::RobotState& state2,
                                            const AllowedCollisionMatrix& acm) const
 {
-  ROS_ERROR_NAMED("collision_detection.fcl", "FCL continuous collision checking not yet implemented");
+  checkSelfCollisionHelper(req, res, state1, state2, &acm);
 }
 
 void CollisionRobotFCL::checkSelfCollisionHelper(const CollisionRequest& req, CollisionResult& res,
-                                                 const robot_state::RobotState& state,
+                                                 const robot_state::RobotState& state1,
+                                                 const robot_state::RobotState& state2,
                                                  const AllowedCollisionMatrix* acm) const
 {
+  FCLObject start, end;
+  constructFCLObject(state1, start);
+  constructFCLObject(state2, end);
+  if (start.collision_objects_.size() != end.collision_objects_.size())
+  {
+    ROS_ERROR_NAMED("collision_detection.fcl", "Continuous collision checking requires the same attached bodies at "
+                                               "both ends of the motion");
+    return;
+  }
+
+  ContinuousCollisionData cd(&req, &res, acm);
+  cd.enableGroup(getRobotModel());
   FCLManager manager;
-  allocSelfCollisionBroadPhase(state, manager);
+  manager.manager_.reset(new fcl::DynamicAABBTreeCollisionManager());
+  constructSweptFCLObject(start, end, manager.object_, cd);
+  manager.object_.registerTo(manager.manager_.get());
+  manager.manager_->collide(&cd, &continuousCollisionCallback);
+}
+
+void CollisionRobotFCL::checkSelfCollisionHelper(const CollisionRequest& req, CollisionResult& res,
+                                                 const robot_state::RobotState& state,
+                                                 const AllowedCollisionMatrix* acm) const
+{
+  MOVEIT_PROBE_SCOPE("CollisionRobotFCL::checkSelfCollision");
+  FCLManager& manager = getSelfCollisionBroadPhase(state);
   CollisionData cd(&req, &res, acm);
   cd.enableGroup(getRobotModel());
   manager.manager_->collide(&cd, &collisionCallback);
@@ -223,8 +422,7 @@ void CollisionRobotFCL::checkOtherCollisionHelper(const CollisionRequest& req, C
                                                   const robot_state::RobotState& other_state,
                                                   const AllowedCollisionMatrix* acm) const
 {
-  FCLManager manager;
-  allocSelfCollisionBroadPhase(state, manager);
+  FCLManager& manager = getSelfCollisionBroadPhase(state);
 
   const CollisionRobotFCL& fcl_rob = dynamic_cast<const CollisionRobotFCL&>(other_robot);
   FCLObject other_fcl_obj;
@@ -271,30 +469,34 @@ void CollisionRobotFCL::updatedPaddingOrScaling(const std::vector<std::string>&
     else
       ROS_ERROR_NAMED("collision_detection.fcl", "Updating padding or scaling for unknown link: '%s'", link.c_str());
   }
+
+  // broadphases cached by any thread refer to the old geometry
+  cache_id_ = nextCacheId();
 }
 
 void CollisionRobotFCL::distanceSelf(const DistanceRequest& req, DistanceResult& res,
                                      const robot_state::RobotState& state) const
 {
-  FCLManager manager;
-  allocSelfCollisionBroadPhase(state, manager);
+  FCLManager& manager = getSelfCollisionBroadPhase(state);
   DistanceData drd(&req, &res);
 
-  manager.manager_->distance(&drd, &distanceCallback);
+  distanceWarmStart(manager.object_, manager.object_, drd);
+  if (!drd.done)
+    manager.manager_->distance(&drd, &distanceCallback);
 }
 
 void CollisionRobotFCL::distanceOther(const DistanceRequest& req, DistanceResult& res,
                                       const robot_state::RobotState& state, const CollisionRobot& other_robot,
                                       const robot_state::RobotState& other_state) const
 {
-  FCLManager manager;
-  allocSelfCollisionBroadPhase(state, manager);
+  FCLManager& manager = getSelfCollisionBroadPhase(state);
 
   const CollisionRobotFCL& fcl_rob = dynamic_cast<const CollisionRobotFCL&>(other_robot);
   FCLObject other_fcl_obj;
   fcl_rob.constructFCLObject(other_state, other_fcl_obj);
 
   DistanceData drd(&req, &res);
+  distanceWarmStart(manager.object_, other_fcl_obj, drd);
   for (std::size_t i = 0; !drd.done && i < other_fcl_obj.collision_objects_.size(); ++i)
     manager.manager_->distance(other_fcl_obj.collision_objects_[i].get(), &drd, &distanceCallback);
 }
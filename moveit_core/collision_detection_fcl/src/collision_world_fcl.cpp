@@ -40,7 +40,11 @@
 #include <fcl/traversal/traversal_node_bvhs.h>
 #include <fcl/traversal/traversal_node_setup.h>
 #include <fcl/collision_node.h>
+#include <moveit/profiler/probes.h>
+#include <moveit/background_processing/thread_budget.h>
 #include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <atomic>
 
 namespace collision_detection
 {
@@ -70,14 +74,9 @@ CollisionWorldFCL::CollisionWorldFCL(const WorldPtr& world) : CollisionWorld(wor
 CollisionWorldFCL::CollisionWorldFCL(const CollisionWorldFCL& other, const WorldPtr& world)
   : CollisionWorld(other, world)
 {
-  auto m = new fcl::DynamicAABBTreeCollisionManager();
-  // m->tree_init_level = 2;
-  manager_.reset(m);
-
+  // share the broadphase structure of other until either world changes; see ensureUniqueManager()
+  manager_ = other.manager_;
   fcl_objs_ = other.fcl_objs_;
-  for (auto& fcl_obj : fcl_objs_)
-    fcl_obj.second.registerTo(manager_.get());
-  // manager_->update();
 
   // request notifications about changes to new world
   observer_handle_ = getWorld()->addObserver(boost::bind(&CollisionWorldFCL::notifyObjectChange, this, _1, _2));
@@ -105,7 +104,7 @@ void CollisionWorldFCL::checkRobotCollision(const CollisionRequest& req, Collisi
                                             const CollisionRobot& robot, const robot_state::RobotState& state1,
                                             const robot_state::RobotState& state2) const
 {
-  ROS_ERROR_NAMED("collision_detection.fcl", "FCL continuous collision checking not yet implemented");
+  checkRobotCollisionHelper(req, res, robot, state1, state2, nullptr);
 }
 
 void CollisionWorldFCL::checkRobotCollision(const CollisionRequest& req, CollisionResult& res,
@@ -113,7 +112,32 @@ void CollisionWorldFCL::checkRobotCollision(const CollisionRequest& req, Collisi
                                             const robot_state::RobotState& state2,
                                             const AllowedCollisionMatrix& acm) const
 {
-  ROS_ERROR_NAMED("collision_detection.fcl", "FCL continuous collision checking not yet implemented");
+  checkRobotCollisionHelper(req, res, robot, state1, state2, &acm);
+}
+
+void CollisionWorldFCL::checkRobotCollisionHelper(const CollisionRequest& req, CollisionResult& res,
+                                                  const CollisionRobot& robot, const robot_state::RobotState& state1,
+                                                  const robot_state::RobotState& state2,
+                                                  const AllowedCollisionMatrix* acm) const
+{
+  MOVEIT_PROBE_SCOPE("CollisionWorldFCL::checkRobotCollision (continuous)");
+  const CollisionRobotFCL& robot_fcl = dynamic_cast<const CollisionRobotFCL&>(robot);
+  FCLObject start, end;
+  robot_fcl.constructFCLObject(state1, start);
+  robot_fcl.constructFCLObject(state2, end);
+  if (start.collision_objects_.size() != end.collision_objects_.size())
+  {
+    ROS_ERROR_NAMED("collision_detection.fcl", "Continuous collision checking requires the same attached bodies at "
+                                               "both ends of the motion");
+    return;
+  }
+
+  ContinuousCollisionData cd(&req, &res, acm);
+  cd.enableGroup(robot.getRobotModel());
+  FCLObject swept;
+  constructSweptFCLObject(start, end, swept, cd);
+  for (std::size_t i = 0; !cd.done_ && i < swept.collision_objects_.size(); ++i)
+    manager_->collide(swept.collision_objects_[i].get(), &cd, &continuousCollisionCallback);
 }
 
 void CollisionWorldFCL::checkRobotCollisionHelper(const CollisionRequest& req, CollisionResult& res,
@@ -122,12 +146,101 @@ void CollisionWorldFCL::checkRobotCollisionHelper(const CollisionRequest& req, C
 {
   const CollisionRobotFCL& robot_fcl = dynamic_cast<const CollisionRobotFCL&>(robot);
   FCLObject fcl_obj;
-  robot_fcl.constructFCLObject(state, fcl_obj);
+  // in free space the robot objects are not built at all; the helper then only computes the distance, if requested.
+  // When checking for a group, only the objects of the bodies it moves are built.
+  const std::set<const robot_model::LinkModel*>* active_links = activeLinks(req, robot);
+  if (mayCollideWithRobot(robot_fcl, state, active_links))
+    robot_fcl.constructFCLObject(state, fcl_obj, active_links);
+  checkRobotCollisionHelper(req, res, robot, state, fcl_obj, acm);
+}
+
+const std::set<const robot_model::LinkModel*>* CollisionWorldFCL::activeLinks(const CollisionRequest& req,
+                                                                             const CollisionRobot& robot)
+{
+  const robot_model::RobotModelConstPtr& model = robot.getRobotModel();
+  return model->hasJointModelGroup(req.group_name) ?
+             &model->getJointModelGroup(req.group_name)->getUpdatedLinkModelsSet() :
+             nullptr;
+}
+
+bool CollisionWorldFCL::isActive(const CollisionGeometryData& data,
+                                 const std::set<const robot_model::LinkModel*>& active_links)
+{
+  const robot_model::LinkModel* link = data.type == BodyTypes::ROBOT_LINK ?
+                                           data.ptr.link :
+                                           (data.type == BodyTypes::ROBOT_ATTACHED ? data.ptr.ab->getAttachedLink() :
+                                                                                     nullptr);
+  return link && active_links.find(link) != active_links.end();
+}
 
+bool CollisionWorldFCL::mayCollideWithRobot(const CollisionRobotFCL& robot, const robot_state::RobotState& state,
+                                            const std::set<const robot_model::LinkModel*>* active_links) const
+{
+  std::vector<const robot_state::AttachedBody*> attached_bodies;
+  state.getAttachedBodies(attached_bodies);
+  for (const robot_state::AttachedBody* body : attached_bodies)
+    if (!active_links || active_links->find(body->getAttachedLink()) != active_links->end())
+      return true;
+
+  for (std::size_t i = 0; i < robot.geoms_.size(); ++i)
+  {
+    if (!robot.geoms_[i] || !robot.geoms_[i]->collision_geometry_)
+      continue;
+    const fcl::CollisionGeometry& geometry = *robot.geoms_[i]->collision_geometry_;
+    const CollisionGeometryData& data = *robot.geoms_[i]->collision_geometry_data_;
+    // contacts of links the group does not move are discarded anyway
+    if (active_links && !isActive(data, *active_links))
+      continue;
+    const Eigen::Vector3d center =
+        state.getCollisionBodyTransform(data.ptr.link, data.shape_index) *
+        Eigen::Vector3d(geometry.aabb_center[0], geometry.aabb_center[1], geometry.aabb_center[2]);
+    const double radius2 = geometry.aabb_radius * geometry.aabb_radius;
+
+    for (const auto& world_obj : fcl_objs_)
+      for (const FCLCollisionObjectPtr& obj : world_obj.second.collision_objects_)
+      {
+        // squared distance from the center of the sphere to the box
+        const fcl::AABB& aabb = obj->getAABB();
+        double d2 = 0.0;
+        for (int k = 0; k < 3; ++k)
+        {
+          const double d = std::max(std::max(aabb.min_[k] - center[k], center[k] - aabb.max_[k]), 0.0);
+          d2 += d * d;
+        }
+        if (d2 <= radius2)
+          return true;
+      }
+  }
+  return false;
+}
+
+void CollisionWorldFCL::checkRobotCollisionHelper(const CollisionRequest& req, CollisionResult& res,
+                                                  const CollisionRobot& robot, const robot_state::RobotState& state,
+                                                  const FCLObject& fcl_obj, const AllowedCollisionMatrix* acm) const
+{
+  MOVEIT_PROBE_SCOPE("CollisionWorldFCL::checkRobotCollision");
   CollisionData cd(&req, &res, acm);
   cd.enableGroup(robot.getRobotModel());
+
+  // robot bodies that are always allowed to collide with every world object would only produce pairs that the
+  // callback discards, so they are not passed to the broadphase at all
+  CompiledAllowedCollisionMatrix::ElementSet world_objects;
+  if (cd.compiled_acm_)
+    for (const auto& world_obj : fcl_objs_)
+      cd.compiled_acm_->addToSet(world_obj.first, world_objects);
+
   for (std::size_t i = 0; !cd.done_ && i < fcl_obj.collision_objects_.size(); ++i)
-    manager_->collide(fcl_obj.collision_objects_[i].get(), &cd, &collisionCallback);
+  {
+    fcl::CollisionObject* obj = fcl_obj.collision_objects_[i].get();
+    const CollisionGeometryData* data =
+        static_cast<const CollisionGeometryData*>(obj->collisionGeometry()->getUserData());
+    // when checking for a group, only the bodies it moves can report contacts, so the others are not queried at all
+    if (cd.active_components_only_ && !isActive(*data, *cd.active_components_only_))
+      continue;
+    if (cd.compiled_acm_ && cd.compiled_acm_->isAlwaysAllowed(cd.compiled_acm_->getIndex(data->getID()), world_objects))
+      continue;
+    manager_->collide(obj, &cd, &collisionCallback);
+  }
 
   if (req.distance)
   {
@@ -142,6 +255,78 @@ void CollisionWorldFCL::checkRobotCollisionHelper(const CollisionRequest& req, C
   }
 }
 
+void CollisionWorldFCL::checkRobotCollisionBatch(const CollisionRequest& req, std::vector<CollisionResult>& res,
+                                                 const CollisionRobot& robot,
+                                                 const std::vector<const robot_state::RobotState*>& states,
+                                                 const AllowedCollisionMatrix* acm) const
+{
+  checkCollisionBatchHelper(req, res, robot, states, acm, false);
+}
+
+void CollisionWorldFCL::checkCollisionBatch(const CollisionRequest& req, std::vector<CollisionResult>& res,
+                                            const CollisionRobot& robot,
+                                            const std::vector<const robot_state::RobotState*>& states,
+                                            const AllowedCollisionMatrix* acm) const
+{
+  checkCollisionBatchHelper(req, res, robot, states, acm, true);
+}
+
+void CollisionWorldFCL::checkCollisionBatchHelper(const CollisionRequest& req, std::vector<CollisionResult>& res,
+                                                  const CollisionRobot& robot,
+                                                  const std::vector<const robot_state::RobotState*>& states,
+                                                  const AllowedCollisionMatrix* acm, bool self) const
+{
+  MOVEIT_PROBE_SCOPE("CollisionWorldFCL::checkCollisionBatch");
+  const CollisionRobotFCL& robot_fcl = dynamic_cast<const CollisionRobotFCL&>(robot);
+  res.resize(states.size());
+
+  // states are handed out one at a time, so threads that hit cheap states keep picking up work
+  std::atomic<std::size_t> next(0);
+  const std::set<const robot_model::LinkModel*>* active_links = activeLinks(req, robot);
+  auto worker = [&]() {
+    FCLObject fcl_obj;
+    const FCLObject no_objects;
+    for (std::size_t i = next++; i < states.size(); i = next++)
+    {
+      if (self)
+      {
+        if (acm)
+          robot.checkSelfCollision(req, res[i], *states[i], *acm);
+        else
+          robot.checkSelfCollision(req, res[i], *states[i]);
+      }
+      if (res[i].collision && !(req.contacts && res[i].contacts.size() < req.max_contacts))
+        continue;
+      if (!mayCollideWithRobot(robot_fcl, *states[i], active_links))
+      {
+        checkRobotCollisionHelper(req, res[i], robot, *states[i], no_objects, acm);
+        continue;
+      }
+      if (fcl_obj.collision_objects_.empty())
+        robot_fcl.constructFCLObject(*states[i], fcl_obj);
+      else
+        robot_fcl.updateFCLObject(*states[i], fcl_obj);
+      checkRobotCollisionHelper(req, res[i], robot, *states[i], fcl_obj, acm);
+    }
+  };
+
+  moveit::tools::ThreadBudget::Reservation reservation(
+      "collision", std::min<std::size_t>(moveit::tools::ThreadBudget::getConcurrency(),
+                                         std::max<std::size_t>(states.size(), 1)));
+  std::size_t thread_count = reservation.getThreads();
+  if (thread_count <= 1)
+  {
+    worker();
+    return;
+  }
+
+  boost::thread_group threads;
+  for (std::size_t t = 1; t < thread_count; ++t)
+    threads.create_thread(worker);
+  worker();
+  threads.join_all();
+}
+
 void CollisionWorldFCL::checkWorldCollision(const CollisionRequest& req, CollisionResult& res,
                                             const CollisionWorld& other_world) const
 {
@@ -158,6 +343,7 @@ void CollisionWorldFCL::checkWorldCollisionHelper(const CollisionRequest& req, C
                                                   const CollisionWorld& other_world,
                                                   const AllowedCollisionMatrix* acm) const
 {
+  MOVEIT_PROBE_SCOPE("CollisionWorldFCL::checkWorldCollision");
   const CollisionWorldFCL& other_fcl_world = dynamic_cast<const CollisionWorldFCL&>(other_world);
   CollisionData cd(&req, &res, acm);
   manager_->collide(other_fcl_world.manager_.get(), &cd, &collisionCallback);
@@ -181,6 +367,11 @@ void CollisionWorldFCL::constructFCLObject(const World::Object* obj, FCLObject&
     FCLGeometryConstPtr g = createCollisionGeometry(obj->shapes_[i], obj);
     if (g)
     {
+      // the octree may have changed in place, so its occupancy is computed again whenever the object is updated
+      if (obj->shapes_[i]->type == shapes::OCTREE)
+        std::atomic_store(&g->collision_geometry_data_->occupancy,
+                          OccupancyPyramidConstPtr(createOccupancyPyramid(
+                              *static_cast<const shapes::OcTree*>(obj->shapes_[i].get())->octree)));
       auto co = new fcl::CollisionObject(g->collision_geometry_, transform2fcl(obj->shape_poses_[i]));
       fcl_obj.collision_objects_.push_back(FCLCollisionObjectPtr(co));
       fcl_obj.collision_geometry_.push_back(g);
@@ -188,8 +379,21 @@ void CollisionWorldFCL::constructFCLObject(const World::Object* obj, FCLObject&
   }
 }
 
+void CollisionWorldFCL::ensureUniqueManager()
+{
+  if (manager_.unique())
+    return;
+  auto m = new fcl::DynamicAABBTreeCollisionManager();
+  // m->tree_init_level = 2;
+  manager_.reset(m);
+  for (auto& fcl_obj : fcl_objs_)
+    fcl_obj.second.registerTo(manager_.get());
+}
+
 void CollisionWorldFCL::updateFCLObject(const std::string& id)
 {
+  ensureUniqueManager();
+
   // remove FCL objects that correspond to this object
   auto jt = fcl_objs_.find(id);
   if (jt != fcl_objs_.end())
@@ -232,8 +436,9 @@ void CollisionWorldFCL::setWorld(const WorldPtr& world)
   getWorld()->removeObserver(observer_handle_);
 
   // clear out objects from old world
-  manager_->clear();
   fcl_objs_.clear();
+  ensureUniqueManager();
+  manager_->clear();
   cleanCollisionGeometryCache();
 
   CollisionWorld::setWorld(world);
@@ -245,6 +450,11 @@ void CollisionWorldFCL::setWorld(const WorldPtr& world)
   getWorld()->notifyObserverAllObjects(observer_handle_, World::CREATE);
 }
 
+std::shared_ptr<const void> CollisionWorldFCL::prepareShape(const shapes::ShapeConstPtr& shape) const
+{
+  return prepareCollisionGeometry(shape);
+}
+
 void CollisionWorldFCL::notifyObjectChange(const ObjectConstPtr& obj, World::Action action)
 {
   if (action == World::DESTROY)
@@ -252,6 +462,7 @@ void CollisionWorldFCL::notifyObjectChange(const ObjectConstPtr& obj, World::Act
     auto it = fcl_objs_.find(obj->id_);
     if (it != fcl_objs_.end())
     {
+      ensureUniqueManager();
       it->second.unregisterFrom(manager_.get());
       it->second.clear();
       fcl_objs_.erase(it);
@@ -269,11 +480,19 @@ void CollisionWorldFCL::notifyObjectChange(const ObjectConstPtr& obj, World::Act
 void CollisionWorldFCL::distanceRobot(const DistanceRequest& req, DistanceResult& res, const CollisionRobot& robot,
                                       const robot_state::RobotState& state) const
 {
+  MOVEIT_PROBE_SCOPE("CollisionWorldFCL::distanceRobot");
   const CollisionRobotFCL& robot_fcl = dynamic_cast<const CollisionRobotFCL&>(robot);
   FCLObject fcl_obj;
   robot_fcl.constructFCLObject(state, fcl_obj);
 
   DistanceData drd(&req, &res);
+  if (req.warm_start)
+    for (std::size_t k = 0; k < 2; ++k)
+    {
+      auto it = fcl_objs_.find(req.warm_start->link_names[k]);
+      if (it != fcl_objs_.end())
+        distanceWarmStart(fcl_obj, it->second, drd);
+    }
   for (std::size_t i = 0; !drd.done && i < fcl_obj.collision_objects_.size(); ++i)
     manager_->distance(fcl_obj.collision_objects_[i].get(), &drd, &distanceCallback);
 }
@@ -283,7 +502,19 @@ void CollisionWorldFCL::distanceWorld(const DistanceRequest& req, DistanceResult
 {
   const CollisionWorldFCL& other_fcl_world = dynamic_cast<const CollisionWorldFCL&>(world);
   DistanceData drd(&req, &res);
-  manager_->distance(other_fcl_world.manager_.get(), &drd, &distanceCallback);
+  if (req.warm_start)
+  {
+    auto it1 = fcl_objs_.find(req.warm_start->link_names[0]);
+    auto it2 = other_fcl_world.fcl_objs_.find(req.warm_start->link_names[1]);
+    if (it1 != fcl_objs_.end() && it2 != other_fcl_world.fcl_objs_.end())
+      distanceWarmStart(it1->second, it2->second, drd);
+    it1 = fcl_objs_.find(req.warm_start->link_names[1]);
+    it2 = other_fcl_world.fcl_objs_.find(req.warm_start->link_names[0]);
+    if (it1 != fcl_objs_.end() && it2 != other_fcl_world.fcl_objs_.end())
+      distanceWarmStart(it1->second, it2->second, drd);
+  }
+  if (!drd.done)
+    manager_->distance(other_fcl_world.manager_.get(), &drd, &distanceCallback);
 }
 
 }  // end of namespace collision_detection
\ No newline at end of file
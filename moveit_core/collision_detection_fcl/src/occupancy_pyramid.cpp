@@ -0,0 +1,148 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/collision_detection_fcl/occupancy_pyramid.h>
+#include <octomap/OcTree.h>
+#include <algorithm>
+#include <cmath>
+
+namespace collision_detection
+{
+OccupancyPyramid::OccupancyPyramid(const std::vector<Eigen::AlignedBox3d>& boxes, double resolution,
+                                   unsigned int max_cells)
+  : origin_(Eigen::Vector3d::Zero())
+{
+  if (boxes.empty())
+    return;
+
+  Eigen::AlignedBox3d bounds;
+  for (std::size_t i = 0; i < boxes.size(); ++i)
+    bounds.extend(boxes[i]);
+  origin_ = bounds.min();
+
+  // the finest level uses the resolution of the boxes, unless that needs too many cells
+  const Eigen::Vector3d extent = bounds.sizes();
+  double cell_size = std::max(resolution, 1e-6);
+  while (extent.maxCoeff() / cell_size > max_cells)
+    cell_size *= 2.0;
+
+  Level finest;
+  finest.cell_size = cell_size;
+  for (int k = 0; k < 3; ++k)
+    finest.size[k] = std::max(1, (int)std::ceil(extent[k] / cell_size));
+  finest.cells.resize((std::size_t)finest.size[0] * finest.size[1] * finest.size[2], false);
+
+  for (std::size_t i = 0; i < boxes.size(); ++i)
+  {
+    int lo[3], hi[3];
+    for (int k = 0; k < 3; ++k)
+    {
+      lo[k] = std::max(0, (int)std::floor((boxes[i].min()[k] - origin_[k]) / cell_size));
+      hi[k] = std::min(finest.size[k] - 1, (int)std::floor((boxes[i].max()[k] - origin_[k]) / cell_size));
+    }
+    for (int z = lo[2]; z <= hi[2]; ++z)
+      for (int y = lo[1]; y <= hi[1]; ++y)
+        for (int x = lo[0]; x <= hi[0]; ++x)
+          finest.cells[((std::size_t)z * finest.size[1] + y) * finest.size[0] + x] = true;
+  }
+  levels_.push_back(finest);
+
+  // every coarser cell is occupied if any of its (up to) eight children is
+  while (levels_.back().size[0] > 1 || levels_.back().size[1] > 1 || levels_.back().size[2] > 1)
+  {
+    const Level& fine = levels_.back();
+    Level coarse;
+    coarse.cell_size = fine.cell_size * 2.0;
+    for (int k = 0; k < 3; ++k)
+      coarse.size[k] = (fine.size[k] + 1) / 2;
+    coarse.cells.resize((std::size_t)coarse.size[0] * coarse.size[1] * coarse.size[2], false);
+    for (int z = 0; z < fine.size[2]; ++z)
+      for (int y = 0; y < fine.size[1]; ++y)
+        for (int x = 0; x < fine.size[0]; ++x)
+          if (fine.get(x, y, z))
+            coarse.cells[((std::size_t)(z / 2) * coarse.size[1] + y / 2) * coarse.size[0] + x / 2] = true;
+    levels_.push_back(coarse);
+  }
+}
+
+bool OccupancyPyramid::mayBeOccupied(const Eigen::Vector3d& min, const Eigen::Vector3d& max) const
+{
+  if (levels_.empty())
+    return false;
+  return mayBeOccupied(levels_.size() - 1, 0, 0, 0, min, max);
+}
+
+bool OccupancyPyramid::mayBeOccupied(std::size_t level, int x, int y, int z, const Eigen::Vector3d& min,
+                                     const Eigen::Vector3d& max) const
+{
+  const Level& l = levels_[level];
+  if (!l.get(x, y, z))
+    return false;
+
+  // the cells touching the boundary of the finest grid extend beyond it, which keeps the test conservative
+  const Eigen::Vector3d cell_min = origin_ + Eigen::Vector3d(x, y, z) * l.cell_size;
+  const Eigen::Vector3d cell_max = cell_min + Eigen::Vector3d::Constant(l.cell_size);
+  if ((cell_min.array() > max.array()).any() || (cell_max.array() < min.array()).any())
+    return false;
+  if (level == 0)
+    return true;
+
+  const Level& fine = levels_[level - 1];
+  for (int dz = 0; dz < 2; ++dz)
+    for (int dy = 0; dy < 2; ++dy)
+      for (int dx = 0; dx < 2; ++dx)
+      {
+        int cx = 2 * x + dx, cy = 2 * y + dy, cz = 2 * z + dz;
+        if (cx < fine.size[0] && cy < fine.size[1] && cz < fine.size[2] &&
+            mayBeOccupied(level - 1, cx, cy, cz, min, max))
+          return true;
+      }
+  return false;
+}
+
+OccupancyPyramidPtr createOccupancyPyramid(const octomap::OcTree& octree)
+{
+  // fcl::OcTree reports collisions with the nodes at or above the occupancy threshold of the tree, like octomap does
+  std::vector<Eigen::AlignedBox3d> boxes;
+  for (octomap::OcTree::leaf_iterator it = octree.begin_leafs(), end = octree.end_leafs(); it != end; ++it)
+    if (octree.isNodeOccupied(*it))
+    {
+      const Eigen::Vector3d center(it.getX(), it.getY(), it.getZ());
+      const Eigen::Vector3d half = Eigen::Vector3d::Constant(it.getSize() / 2.0);
+      boxes.push_back(Eigen::AlignedBox3d(center - half, center + half));
+    }
+  return OccupancyPyramidPtr(new OccupancyPyramid(boxes, octree.getResolution()));
+}
+}
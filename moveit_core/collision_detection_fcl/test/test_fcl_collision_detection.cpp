@@ -176,6 +176,47 @@ TEST_F(FclCollisionDetectionTester, LinksInCollision)
   ASSERT_TRUE(res3.collision);
 }
 
+TEST_F(FclCollisionDetectionTester, RepeatedSelfCollisionChecks)
+{
+  collision_detection::CollisionRequest req;
+
+  robot_state::RobotState free_state(kmodel_);
+  free_state.setToDefaultValues();
+  free_state.update();
+
+  robot_state::RobotState colliding_state(free_state);
+  Eigen::Affine3d offset = Eigen::Affine3d::Identity();
+  offset.translation().x() = .01;
+  colliding_state.updateStateWithLinkAt("r_gripper_palm_link", Eigen::Affine3d::Identity());
+  colliding_state.updateStateWithLinkAt("l_gripper_palm_link", offset);
+  colliding_state.update();
+  acm_->setEntry("r_gripper_palm_link", "l_gripper_palm_link", false);
+
+  // the broadphase kept between checks has to follow the links back and forth
+  for (unsigned int i = 0; i < 3; ++i)
+  {
+    collision_detection::CollisionResult res1;
+    crobot_->checkSelfCollision(req, res1, colliding_state, *acm_);
+    EXPECT_TRUE(res1.collision);
+
+    collision_detection::CollisionResult res2;
+    crobot_->checkSelfCollision(req, res2, free_state, *acm_);
+    EXPECT_FALSE(res2.collision);
+  }
+
+  // changing the padding invalidates the broadphase
+  crobot_->setLinkPadding("r_gripper_palm_link", 0.1);
+  crobot_->setLinkPadding("l_gripper_palm_link", 0.1);
+  robot_state::RobotState close_state(free_state);
+  offset.translation().x() = .15;
+  close_state.updateStateWithLinkAt("r_gripper_palm_link", Eigen::Affine3d::Identity());
+  close_state.updateStateWithLinkAt("l_gripper_palm_link", offset);
+  close_state.update();
+  collision_detection::CollisionResult res3;
+  crobot_->checkSelfCollision(req, res3, close_state, *acm_);
+  EXPECT_TRUE(res3.collision);
+}
+
 TEST_F(FclCollisionDetectionTester, ContactReporting)
 {
   collision_detection::CollisionRequest req;
@@ -367,6 +408,53 @@ TEST_F(FclCollisionDetectionTester, AttachedBodyTester)
   ASSERT_TRUE(res.collision);
 }
 
+TEST_F(FclCollisionDetectionTester, RepeatedAttachedBodyChecks)
+{
+  collision_detection::CollisionRequest req;
+  acm_.reset(new collision_detection::AllowedCollisionMatrix(kmodel_->getLinkModelNames(), true));
+  acm_->setEntry("box", "l_gripper_palm_link", false);
+
+  robot_state::RobotState kstate(kmodel_);
+  kstate.setToDefaultValues();
+  kstate.update();
+
+  std::vector<shapes::ShapeConstPtr> shapes(2, shapes::ShapeConstPtr(new shapes::Box(.05, .05, .05)));
+  EigenSTL::vector_Affine3d poses(2, Eigen::Affine3d::Identity());
+  poses[1].translation().z() = 0.5;
+  kstate.attachBody("box", shapes, poses, std::vector<std::string>(), "r_gripper_palm_link");
+
+  Eigen::Affine3d touching = Eigen::Affine3d::Identity();
+  touching.translation().x() = .01;
+  Eigen::Affine3d far = Eigen::Affine3d::Identity();
+  far.translation().x() = 2.0;
+  kstate.updateStateWithLinkAt("r_gripper_palm_link", Eigen::Affine3d::Identity());
+
+  // the attached body objects are kept between checks and have to follow the body back and forth
+  for (unsigned int i = 0; i < 3; ++i)
+  {
+    kstate.updateStateWithLinkAt("l_gripper_palm_link", touching);
+    kstate.update();
+    collision_detection::CollisionResult res1;
+    crobot_->checkSelfCollision(req, res1, kstate, *acm_);
+    EXPECT_TRUE(res1.collision);
+
+    kstate.updateStateWithLinkAt("l_gripper_palm_link", far);
+    kstate.update();
+    collision_detection::CollisionResult res2;
+    crobot_->checkSelfCollision(req, res2, kstate, *acm_);
+    EXPECT_FALSE(res2.collision);
+  }
+
+  // reattaching the body at a different pose has to be picked up as well
+  kstate.clearAttachedBody("box");
+  poses[0].translation().x() = 2.0;
+  kstate.attachBody("box", shapes, poses, std::vector<std::string>(), "r_gripper_palm_link");
+  kstate.update();
+  collision_detection::CollisionResult res3;
+  crobot_->checkSelfCollision(req, res3, kstate, *acm_);
+  EXPECT_TRUE(res3.collision);
+}
+
 TEST_F(FclCollisionDetectionTester, DiffSceneTester)
 {
   robot_state::RobotState kstate(kmodel_);
@@ -576,6 +664,221 @@ TEST_F(FclCollisionDetectionTester, TestChangingShapeSize)
   }
 }
 
+TEST_F(FclCollisionDetectionTester, ContinuousCollision)
+{
+  robot_state::RobotState state1(kmodel_);
+  state1.setToDefaultValues();
+  state1.update();
+
+  robot_state::RobotState state2(state1);
+  const robot_model::JointModelGroup* arm = kmodel_->getJointModelGroup("right_arm");
+  std::vector<double> positions;
+  state2.copyJointGroupPositions(arm, positions);
+  positions[0] += 0.5;
+  state2.setJointGroupPositions(arm, positions);
+  state2.update();
+
+  // nothing in the world and all self collisions allowed
+  collision_detection::CollisionRequest req;
+  collision_detection::CollisionResult res1;
+  cworld_->checkCollision(req, res1, *crobot_, state1, state2, *acm_);
+  EXPECT_FALSE(res1.collision);
+
+  // an obstacle far away from the robot
+  Eigen::Affine3d pose = Eigen::Affine3d::Identity();
+  pose.translation().x() = 10.0;
+  cworld_->getWorld()->addToObject("box", shapes::ShapeConstPtr(new shapes::Box(1.0, 1.0, 1.0)), pose);
+  collision_detection::CollisionResult res2;
+  cworld_->checkRobotCollision(req, res2, *crobot_, state1, state2, *acm_);
+  EXPECT_FALSE(res2.collision);
+
+  // an obstacle the robot is in collision with at the start of the motion
+  cworld_->getWorld()->moveShapeInObject("box", cworld_->getWorld()->getObject("box")->shapes_[0],
+                                         Eigen::Affine3d::Identity());
+  collision_detection::CollisionResult res3;
+  req.contacts = true;
+  cworld_->checkRobotCollision(req, res3, *crobot_, state1, state2, *acm_);
+  EXPECT_TRUE(res3.collision);
+  EXPECT_GE(res3.contact_count, 1u);
+}
+
+TEST_F(FclCollisionDetectionTester, BatchMatchesSingleChecks)
+{
+  shapes::ShapePtr shape(new shapes::Box(.1, .1, .1));
+  Eigen::Affine3d pose = Eigen::Affine3d::Identity();
+  pose.translation().x() = 1.0;
+  cworld_->getWorld()->addToObject("box", shape, pose);
+
+  random_numbers::RandomNumberGenerator rng(42);
+  std::vector<robot_state::RobotStatePtr> states;
+  std::vector<const robot_state::RobotState*> state_ptrs;
+  for (unsigned int i = 0; i < 50; ++i)
+  {
+    states.push_back(robot_state::RobotStatePtr(new robot_state::RobotState(kmodel_)));
+    states.back()->setToRandomPositions(kmodel_->getJointModelGroup("right_arm"), rng);
+    states.back()->update();
+    state_ptrs.push_back(states.back().get());
+  }
+
+  collision_detection::CollisionRequest req;
+  std::vector<collision_detection::CollisionResult> batch_res;
+  cworld_->checkCollisionBatch(req, batch_res, *crobot_, state_ptrs, acm_.get());
+  ASSERT_EQ(states.size(), batch_res.size());
+
+  std::vector<collision_detection::CollisionResult> world_res;
+  cworld_->checkRobotCollisionBatch(req, world_res, *crobot_, state_ptrs, acm_.get());
+  ASSERT_EQ(states.size(), world_res.size());
+
+  for (std::size_t i = 0; i < states.size(); ++i)
+  {
+    collision_detection::CollisionResult res;
+    cworld_->checkCollision(req, res, *crobot_, *states[i], *acm_);
+    EXPECT_EQ(res.collision, batch_res[i].collision);
+
+    collision_detection::CollisionResult wres;
+    cworld_->checkRobotCollision(req, wres, *crobot_, *states[i], *acm_);
+    EXPECT_EQ(wres.collision, world_res[i].collision);
+  }
+}
+
+TEST_F(FclCollisionDetectionTester, GroupRestrictedWorldChecks)
+{
+  robot_state::RobotState kstate(kmodel_);
+  kstate.setToDefaultValues();
+  kstate.update();
+
+  // a slab through the base does not touch any link the right arm moves
+  shapes::ShapePtr slab(new shapes::Box(1.0, 1.0, .05));
+  cworld_->getWorld()->addToObject("box", slab,
+                                   kstate.getGlobalLinkTransform("base_link") * Eigen::Translation3d(0.0, 0.0, 0.05));
+
+  collision_detection::CollisionRequest req;
+  collision_detection::CollisionResult res;
+  cworld_->checkRobotCollision(req, res, *crobot_, kstate, *acm_);
+  EXPECT_TRUE(res.collision);
+
+  req.group_name = "right_arm";
+  res.clear();
+  cworld_->checkRobotCollision(req, res, *crobot_, kstate, *acm_);
+  EXPECT_FALSE(res.collision);
+
+  std::vector<collision_detection::CollisionResult> batch_res;
+  std::vector<const robot_state::RobotState*> states(1, &kstate);
+  cworld_->checkRobotCollisionBatch(req, batch_res, *crobot_, states, acm_.get());
+  ASSERT_EQ(1u, batch_res.size());
+  EXPECT_FALSE(batch_res[0].collision);
+
+  // a box around the gripper does
+  cworld_->getWorld()->removeObject("box");
+  shapes::ShapePtr box(new shapes::Box(.3, .3, .3));
+  cworld_->getWorld()->addToObject("box", box, kstate.getGlobalLinkTransform("r_gripper_palm_link"));
+  res.clear();
+  cworld_->checkRobotCollision(req, res, *crobot_, kstate, *acm_);
+  EXPECT_TRUE(res.collision);
+
+  batch_res.clear();
+  cworld_->checkRobotCollisionBatch(req, batch_res, *crobot_, states, acm_.get());
+  ASSERT_EQ(1u, batch_res.size());
+  EXPECT_TRUE(batch_res[0].collision);
+}
+
+TEST_F(FclCollisionDetectionTester, DistanceWarmStartAndEarlyTermination)
+{
+  shapes::ShapePtr shape(new shapes::Box(.1, .1, .1));
+  Eigen::Affine3d pose = Eigen::Affine3d::Identity();
+  pose.translation().x() = 1.0;
+  cworld_->getWorld()->addToObject("box", shape, pose);
+
+  robot_state::RobotState kstate(kmodel_);
+  kstate.setToDefaultValues();
+  kstate.update();
+
+  collision_detection::DistanceRequest req;
+  req.acm = acm_.get();
+  collision_detection::DistanceResult res;
+  cworld_->distanceRobot(req, res, *crobot_, kstate);
+  ASSERT_LT(res.minimum_distance.distance, std::numeric_limits<double>::max());
+  EXPECT_TRUE(res.minimum_distance.link_names[0] == "box" || res.minimum_distance.link_names[1] == "box");
+
+  // warm starting from the previous closest pair gives the same answer
+  collision_detection::DistanceResultsData previous = res.minimum_distance;
+  req.warm_start = &previous;
+  collision_detection::DistanceResult warm_res;
+  cworld_->distanceRobot(req, warm_res, *crobot_, kstate);
+  EXPECT_NEAR(res.minimum_distance.distance, warm_res.minimum_distance.distance, 1e-9);
+
+  // with an early termination distance beyond the minimum, any pair below it is acceptable
+  req.warm_start = nullptr;
+  req.early_termination_distance = res.minimum_distance.distance + 1.0;
+  collision_detection::DistanceResult early_res;
+  cworld_->distanceRobot(req, early_res, *crobot_, kstate);
+  EXPECT_LT(early_res.minimum_distance.distance, req.early_termination_distance);
+  EXPECT_GE(early_res.minimum_distance.distance, res.minimum_distance.distance - 1e-9);
+}
+
+TEST_F(FclCollisionDetectionTester, CompactDistancePairs)
+{
+  shapes::ShapePtr shape(new shapes::Box(.1, .1, .1));
+  Eigen::Affine3d pose = Eigen::Affine3d::Identity();
+  pose.translation().x() = 1.5;
+  cworld_->getWorld()->addToObject("box", shape, pose);
+
+  robot_state::RobotState kstate(kmodel_);
+  kstate.setToDefaultValues();
+  kstate.update();
+
+  collision_detection::DistanceRequest req;
+  req.acm = acm_.get();
+  req.type = collision_detection::DistanceRequestType::SINGLE;
+  req.distance_threshold = 2.0;
+  req.compute_gradient = true;
+  collision_detection::DistanceResult res;
+  cworld_->distanceRobot(req, res, *crobot_, kstate);
+  ASSERT_FALSE(res.distances.empty());
+  EXPECT_EQ(0u, res.pairs.size());
+
+  // the compact result holds the same pairs, without the map
+  req.compact_pairs = true;
+  collision_detection::DistanceResult compact_res;
+  cworld_->distanceRobot(req, compact_res, *crobot_, kstate);
+  EXPECT_TRUE(compact_res.distances.empty());
+  ASSERT_EQ(res.distances.size(), compact_res.pairs.size());
+  EXPECT_NEAR(res.minimum_distance.distance, compact_res.minimum_distance.distance, 1e-9);
+  for (std::size_t i = 0; i < compact_res.pairs.size(); ++i)
+  {
+    const std::string& name1 = compact_res.pairs.link_names[0][i];
+    const std::string& name2 = compact_res.pairs.link_names[1][i];
+    auto it = res.distances.find(name1 < name2 ? std::make_pair(name1, name2) : std::make_pair(name2, name1));
+    ASSERT_TRUE(it != res.distances.end());
+    EXPECT_NEAR(it->second[0].distance, compact_res.pairs.distances[i], 1e-9);
+    EXPECT_NEAR(1.0, compact_res.pairs.normals[i].norm(), 1e-6);
+  }
+}
+
+TEST_F(FclCollisionDetectionTester, SharedMeshGeometry)
+{
+  shapes::ShapeConstPtr kinect1(shapes::createMeshFromResource(kinect_dae_resource_));
+  shapes::ShapeConstPtr kinect2(shapes::createMeshFromResource(kinect_dae_resource_));
+  collision_detection::World::Object obj1("kinect1");
+  collision_detection::World::Object obj2("kinect2");
+
+  // distinct shapes with the same content share one BVH, but keep their own user data
+  collision_detection::FCLGeometryConstPtr g1 = collision_detection::createCollisionGeometry(kinect1, &obj1);
+  collision_detection::FCLGeometryConstPtr g2 = collision_detection::createCollisionGeometry(kinect2, &obj2);
+  ASSERT_TRUE(g1 && g2);
+  EXPECT_TRUE(g1->source_geometry_);
+  EXPECT_EQ(g1->source_geometry_, g2->source_geometry_);
+  EXPECT_NE(g1->collision_geometry_, g2->collision_geometry_);
+  EXPECT_NE(g1->collision_geometry_->getUserData(), g2->collision_geometry_->getUserData());
+
+  // padded meshes are shared among equal padding values only
+  collision_detection::FCLGeometryConstPtr p1 = collision_detection::createCollisionGeometry(kinect1, 1.0, 0.01, &obj1);
+  collision_detection::FCLGeometryConstPtr p2 = collision_detection::createCollisionGeometry(kinect2, 1.0, 0.01, &obj2);
+  ASSERT_TRUE(p1 && p2);
+  EXPECT_EQ(p1->source_geometry_, p2->source_geometry_);
+  EXPECT_NE(p1->source_geometry_, g1->source_geometry_);
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
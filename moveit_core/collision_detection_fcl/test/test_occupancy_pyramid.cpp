@@ -0,0 +1,89 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/collision_detection_fcl/occupancy_pyramid.h>
+#include <gtest/gtest.h>
+
+using collision_detection::OccupancyPyramid;
+
+static Eigen::AlignedBox3d cube(double x, double y, double z, double size)
+{
+  return Eigen::AlignedBox3d(Eigen::Vector3d(x, y, z), Eigen::Vector3d(x + size, y + size, z + size));
+}
+
+TEST(OccupancyPyramid, Empty)
+{
+  OccupancyPyramid pyramid(std::vector<Eigen::AlignedBox3d>(), 0.1);
+  EXPECT_EQ(0u, pyramid.getLevelCount());
+  EXPECT_FALSE(pyramid.mayBeOccupied(Eigen::Vector3d::Constant(-10.0), Eigen::Vector3d::Constant(10.0)));
+}
+
+TEST(OccupancyPyramid, SeparatesBoxes)
+{
+  std::vector<Eigen::AlignedBox3d> boxes;
+  boxes.push_back(cube(0.0, 0.0, 0.0, 0.1));
+  boxes.push_back(cube(2.0, 2.0, 2.0, 0.1));
+  OccupancyPyramid pyramid(boxes, 0.1);
+  EXPECT_GT(pyramid.getLevelCount(), 1u);
+
+  // regions that touch either box are reported
+  EXPECT_TRUE(pyramid.mayBeOccupied(Eigen::Vector3d(0.05, 0.05, 0.05), Eigen::Vector3d(0.06, 0.06, 0.06)));
+  EXPECT_TRUE(pyramid.mayBeOccupied(Eigen::Vector3d(1.9, 1.9, 1.9), Eigen::Vector3d(2.05, 2.05, 2.05)));
+  EXPECT_TRUE(pyramid.mayBeOccupied(Eigen::Vector3d::Constant(-1.0), Eigen::Vector3d::Constant(3.0)));
+
+  // the space between them and outside of them is free
+  EXPECT_FALSE(pyramid.mayBeOccupied(Eigen::Vector3d(0.8, 0.8, 0.8), Eigen::Vector3d(1.2, 1.2, 1.2)));
+  EXPECT_FALSE(pyramid.mayBeOccupied(Eigen::Vector3d(-1.0, -1.0, -1.0), Eigen::Vector3d(-0.5, -0.5, -0.5)));
+  EXPECT_FALSE(pyramid.mayBeOccupied(Eigen::Vector3d(3.0, 3.0, 3.0), Eigen::Vector3d(4.0, 4.0, 4.0)));
+}
+
+TEST(OccupancyPyramid, LimitsCells)
+{
+  std::vector<Eigen::AlignedBox3d> boxes;
+  boxes.push_back(cube(0.0, 0.0, 0.0, 0.01));
+  boxes.push_back(cube(10.0, 0.0, 0.0, 0.01));
+  OccupancyPyramid pyramid(boxes, 0.01, 64);
+  EXPECT_LE(10.01 / pyramid.getCellSize(), 64.0);
+
+  // coarse cells are conservative, but never report a box that does not exist
+  EXPECT_TRUE(pyramid.mayBeOccupied(Eigen::Vector3d(0.0, 0.0, 0.0), Eigen::Vector3d(0.001, 0.001, 0.001)));
+  EXPECT_FALSE(pyramid.mayBeOccupied(Eigen::Vector3d(4.0, 0.0, 0.0), Eigen::Vector3d(6.0, 0.01, 0.01)));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -41,6 +41,8 @@
 #include <moveit/collision_detection/collision_world.h>
 #include <moveit/collision_distance_field/collision_distance_field_types.h>
 #include <moveit/collision_distance_field/collision_robot_distance_field.h>
+#include <cstdint>
+#include <unordered_map>
 
 namespace collision_detection
 {
@@ -56,6 +58,12 @@ public:
   {
     std::map<std::string, std::vector<PosedBodyPointDecompositionPtr>> posed_body_point_decompositions_;
     distance_field::DistanceFieldPtr distance_field_;
+
+    /** \brief The voxels occupied by each object, as sorted, unique voxel keys */
+    std::map<std::string, std::vector<std::uint64_t>> object_voxels_;
+
+    /** \brief The number of objects occupying each obstacle voxel of the field */
+    std::unordered_map<std::uint64_t, unsigned int> voxel_counts_;
   };
 
   CollisionWorldDistanceField(Eigen::Vector3d size = Eigen::Vector3d(DEFAULT_SIZE_X, DEFAULT_SIZE_Y, DEFAULT_SIZE_Z),
@@ -162,6 +170,7 @@ public:
 
   collision_detection::GroupStateRepresentationConstPtr getLastGroupStateRepresentation() const
   {
+    boost::mutex::scoped_lock slock(last_gsr_lock_);
     return last_gsr_;
   }
 
@@ -179,6 +188,13 @@ protected:
   void updateDistanceObject(const std::string& id, CollisionWorldDistanceField::DistanceFieldCacheEntryPtr& dfce,
                             EigenSTL::vector_Vector3d& add_points, EigenSTL::vector_Vector3d& subtract_points);
 
+  /** \brief Record that object \e id now occupies the voxels of \e points (none if the object was removed).
+      The centers of the voxels that no object occupies any more are added to \e freed, and the ones that no object
+      occupied before to \e occupied; only these need to be updated in the distance field. */
+  static void updateObjectVoxels(const std::string& id, DistanceFieldCacheEntry& dfce,
+                                 const EigenSTL::vector_Vector3d& points, EigenSTL::vector_Vector3d& freed,
+                                 EigenSTL::vector_Vector3d& occupied);
+
   bool getEnvironmentCollisions(const CollisionRequest& req, CollisionResult& res,
                                 const distance_field::DistanceFieldConstPtr& env_distance_field,
                                 GroupStateRepresentationPtr& gsr) const;
@@ -188,6 +204,8 @@ protected:
 
   static void notifyObjectChange(CollisionWorldDistanceField* self, const ObjectConstPtr& obj, World::Action action);
 
+  void setLastGroupStateRepresentation(const GroupStateRepresentationPtr& gsr) const;
+
   Eigen::Vector3d size_;
   Eigen::Vector3d origin_;
   bool use_signed_distance_field_;
@@ -197,7 +215,8 @@ protected:
 
   mutable boost::mutex update_cache_lock_;
   DistanceFieldCacheEntryPtr distance_field_cache_entry_;
-  GroupStateRepresentationPtr last_gsr_;
+  mutable boost::mutex last_gsr_lock_;
+  mutable GroupStateRepresentationPtr last_gsr_;
   World::ObserverHandle observer_handle_;
 };
 }
@@ -137,14 +137,19 @@ bool collision_detection::getCollisionSphereGradients(const distance_field::Dist
 {
   // assumes gradient is properly initialized
 
+  // look up all spheres at once, which avoids the virtual calls getDistanceGradient() makes per cell
+  std::vector<double> distances;
+  EigenSTL::vector_Vector3d gradients;
+  std::vector<bool> in_bounds;
+  distance_field->getDistanceGradients(sphere_centers, distances, gradients, in_bounds);
+
   bool in_collision = false;
   for (unsigned int i = 0; i < sphere_list.size(); i++)
   {
-    Eigen::Vector3d p = sphere_centers[i];
-    Eigen::Vector3d grad;
-    bool in_bounds;
-    double dist = distance_field->getDistanceGradient(p.x(), p.y(), p.z(), grad.x(), grad.y(), grad.z(), in_bounds);
-    if (!in_bounds && grad.norm() > EPSILON)
+    const Eigen::Vector3d& p = sphere_centers[i];
+    const Eigen::Vector3d& grad = gradients[i];
+    double dist = distances[i];
+    if (!in_bounds[i] && grad.norm() > EPSILON)
     {
       ROS_DEBUG("Collision sphere point is out of bounds %lf, %lf, %lf", p.x(), p.y(), p.z());
       return true;
@@ -195,14 +200,17 @@ bool collision_detection::getCollisionSphereCollision(const distance_field::Dist
                                                       const EigenSTL::vector_Vector3d& sphere_centers,
                                                       double maximum_value, double tolerance)
 {
+  std::vector<double> distances;
+  EigenSTL::vector_Vector3d gradients;
+  std::vector<bool> in_bounds;
+  distance_field->getDistanceGradients(sphere_centers, distances, gradients, in_bounds);
+
   for (unsigned int i = 0; i < sphere_list.size(); i++)
   {
-    Eigen::Vector3d p = sphere_centers[i];
-    Eigen::Vector3d grad;
-    bool in_bounds = true;
-    double dist = distance_field->getDistanceGradient(p.x(), p.y(), p.z(), grad.x(), grad.y(), grad.z(), in_bounds);
+    const Eigen::Vector3d& grad = gradients[i];
+    double dist = distances[i];
 
-    if (!in_bounds && grad.norm() > 0)
+    if (!in_bounds[i] && grad.norm() > 0)
     {
       ROS_DEBUG("Collision sphere point is out of bounds");
       return true;
@@ -224,13 +232,16 @@ bool collision_detection::getCollisionSphereCollision(const distance_field::Dist
                                                       std::vector<unsigned int>& colls)
 {
   colls.clear();
+  std::vector<double> distances;
+  EigenSTL::vector_Vector3d gradients;
+  std::vector<bool> in_bounds;
+  distance_field->getDistanceGradients(sphere_centers, distances, gradients, in_bounds);
+
   for (unsigned int i = 0; i < sphere_list.size(); i++)
   {
-    Eigen::Vector3d p = sphere_centers[i];
-    Eigen::Vector3d grad;
-    bool in_bounds = true;
-    double dist = distance_field->getDistanceGradient(p.x(), p.y(), p.z(), grad.x(), grad.y(), grad.z(), in_bounds);
-    if (!in_bounds && (grad.norm() > 0))
+    const Eigen::Vector3d& grad = gradients[i];
+    double dist = distances[i];
+    if (!in_bounds[i] && (grad.norm() > 0))
     {
       ROS_DEBUG("Collision sphere point is out of bounds");
       return true;
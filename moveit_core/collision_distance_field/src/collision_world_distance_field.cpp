@@ -39,6 +39,8 @@
 #include <moveit/collision_distance_field/collision_common_distance_field.h>
 #include <moveit/distance_field/propagation_distance_field.h>
 #include <boost/bind.hpp>
+#include <algorithm>
+#include <iterator>
 #include <memory>
 
 namespace collision_detection
@@ -143,7 +145,7 @@ void CollisionWorldDistanceField::checkCollision(const CollisionRequest& req, Co
     return;
   }
 
-  (const_cast<CollisionWorldDistanceField*>(this))->last_gsr_ = gsr;
+  setLastGroupStateRepresentation(gsr);
 }
 
 void CollisionWorldDistanceField::checkCollision(const CollisionRequest& req, CollisionResult& res,
@@ -186,7 +188,7 @@ void CollisionWorldDistanceField::checkCollision(const CollisionRequest& req, Co
     return;
   }
 
-  (const_cast<CollisionWorldDistanceField*>(this))->last_gsr_ = gsr;
+  setLastGroupStateRepresentation(gsr);
 }
 
 void CollisionWorldDistanceField::checkRobotCollision(const CollisionRequest& req, CollisionResult& res,
@@ -215,7 +217,7 @@ void CollisionWorldDistanceField::checkRobotCollision(const CollisionRequest& re
       cdr.updateGroupStateRepresentationState(state, gsr);
     }
     getEnvironmentCollisions(req, res, env_distance_field, gsr);
-    (const_cast<CollisionWorldDistanceField*>(this))->last_gsr_ = gsr;
+    setLastGroupStateRepresentation(gsr);
 
     // checkRobotCollisionHelper(req, res, robot, state, &acm);
   }
@@ -253,7 +255,7 @@ void CollisionWorldDistanceField::checkRobotCollision(const CollisionRequest& re
       cdr.updateGroupStateRepresentationState(state, gsr);
     }
     getEnvironmentCollisions(req, res, env_distance_field, gsr);
-    (const_cast<CollisionWorldDistanceField*>(this))->last_gsr_ = gsr;
+    setLastGroupStateRepresentation(gsr);
 
     // checkRobotCollisionHelper(req, res, robot, state, &acm);
   }
@@ -264,6 +266,13 @@ void CollisionWorldDistanceField::checkRobotCollision(const CollisionRequest& re
   }
 }
 
+void CollisionWorldDistanceField::setLastGroupStateRepresentation(const GroupStateRepresentationPtr& gsr) const
+{
+  // checks may run concurrently on the same world (e.g. one per thread in CHOMP), so guard the shared pointer
+  boost::mutex::scoped_lock slock(last_gsr_lock_);
+  last_gsr_ = gsr;
+}
+
 void CollisionWorldDistanceField::getCollisionGradients(const CollisionRequest& req, CollisionResult& res,
                                                         const CollisionRobot& robot,
                                                         const robot_state::RobotState& state,
@@ -292,7 +301,7 @@ void CollisionWorldDistanceField::getCollisionGradients(const CollisionRequest&
     return;
   }
 
-  (const_cast<CollisionWorldDistanceField*>(this))->last_gsr_ = gsr;
+  setLastGroupStateRepresentation(gsr);
 }
 
 void CollisionWorldDistanceField::getAllCollisions(const CollisionRequest& req, CollisionResult& res,
@@ -322,7 +331,7 @@ void CollisionWorldDistanceField::getAllCollisions(const CollisionRequest& req,
     return;
   }
 
-  (const_cast<CollisionWorldDistanceField*>(this))->last_gsr_ = gsr;
+  setLastGroupStateRepresentation(gsr);
 }
 
 bool CollisionWorldDistanceField::getEnvironmentCollisions(
@@ -477,22 +486,17 @@ void CollisionWorldDistanceField::notifyObjectChange(CollisionWorldDistanceField
   EigenSTL::vector_Vector3d subtract_points;
   self->updateDistanceObject(obj->id_, self->distance_field_cache_entry_, add_points, subtract_points);
 
-  if (action == World::DESTROY)
-  {
-    self->distance_field_cache_entry_->distance_field_->removePointsFromField(subtract_points);
-  }
-  else if (action & (World::MOVE_SHAPE | World::REMOVE_SHAPE))
-  {
-    self->distance_field_cache_entry_->distance_field_->removePointsFromField(subtract_points);
-    self->distance_field_cache_entry_->distance_field_->addPointsToField(add_points);
-  }
-  else
-  {
-    self->distance_field_cache_entry_->distance_field_->addPointsToField(add_points);
-  }
-
-  ROS_DEBUG_NAMED("collision_distance_field", "Modifying object %s took %lf s", obj->id_.c_str(),
-                  (ros::WallTime::now() - n).toSec());
+  // only the voxels that change state are passed on to the field: moving an object propagates from the voxels it
+  // left and entered, not from all of its voxels, and voxels shared with other objects stay obstacles
+  EigenSTL::vector_Vector3d freed, occupied;
+  updateObjectVoxels(obj->id_, *self->distance_field_cache_entry_, add_points, freed, occupied);
+  if (!freed.empty())
+    self->distance_field_cache_entry_->distance_field_->removePointsFromField(freed);
+  if (!occupied.empty())
+    self->distance_field_cache_entry_->distance_field_->addPointsToField(occupied);
+
+  ROS_DEBUG_NAMED("collision_distance_field", "Modifying object %s (%zu voxels freed, %zu occupied) took %lf s",
+                  obj->id_.c_str(), freed.size(), occupied.size(), (ros::WallTime::now() - n).toSec());
 }
 
 void CollisionWorldDistanceField::updateDistanceObject(const std::string& id, DistanceFieldCacheEntryPtr& dfce,
@@ -555,13 +559,72 @@ CollisionWorldDistanceField::DistanceFieldCacheEntryPtr CollisionWorldDistanceFi
 
   EigenSTL::vector_Vector3d add_points;
   EigenSTL::vector_Vector3d subtract_points;
+  EigenSTL::vector_Vector3d freed, occupied;
   for (World::const_iterator it = getWorld()->begin(); it != getWorld()->end(); ++it)
   {
+    add_points.clear();
     updateDistanceObject(it->first, dfce, add_points, subtract_points);
+    updateObjectVoxels(it->first, *dfce, add_points, freed, occupied);
   }
-  dfce->distance_field_->addPointsToField(add_points);
+  dfce->distance_field_->addPointsToField(occupied);
   return dfce;
 }
+
+void CollisionWorldDistanceField::updateObjectVoxels(const std::string& id, DistanceFieldCacheEntry& dfce,
+                                                     const EigenSTL::vector_Vector3d& points,
+                                                     EigenSTL::vector_Vector3d& freed,
+                                                     EigenSTL::vector_Vector3d& occupied)
+{
+  const distance_field::DistanceField& field = *dfce.distance_field_;
+  std::vector<std::uint64_t> voxels;
+  voxels.reserve(points.size());
+  for (std::size_t i = 0; i < points.size(); ++i)
+  {
+    int x, y, z;
+    if (field.worldToGrid(points[i].x(), points[i].y(), points[i].z(), x, y, z))
+      voxels.push_back((static_cast<std::uint64_t>(x) << 42) | (static_cast<std::uint64_t>(y) << 21) |
+                       static_cast<std::uint64_t>(z));
+  }
+  std::sort(voxels.begin(), voxels.end());
+  voxels.erase(std::unique(voxels.begin(), voxels.end()), voxels.end());
+
+  static const std::vector<std::uint64_t> NONE;
+  std::map<std::string, std::vector<std::uint64_t>>::iterator it = dfce.object_voxels_.find(id);
+  const std::vector<std::uint64_t>& previous = it != dfce.object_voxels_.end() ? it->second : NONE;
+
+  std::vector<std::uint64_t> left, entered;
+  std::set_difference(previous.begin(), previous.end(), voxels.begin(), voxels.end(), std::back_inserter(left));
+  std::set_difference(voxels.begin(), voxels.end(), previous.begin(), previous.end(), std::back_inserter(entered));
+
+  const std::uint64_t mask = (1ull << 21) - 1;
+  Eigen::Vector3d center;
+  for (std::size_t i = 0; i < left.size(); ++i)
+  {
+    std::unordered_map<std::uint64_t, unsigned int>::iterator count = dfce.voxel_counts_.find(left[i]);
+    if (count == dfce.voxel_counts_.end() || --count->second > 0)
+      continue;
+    dfce.voxel_counts_.erase(count);
+    field.gridToWorld(left[i] >> 42, (left[i] >> 21) & mask, left[i] & mask, center.x(), center.y(), center.z());
+    freed.push_back(center);
+  }
+  for (std::size_t i = 0; i < entered.size(); ++i)
+    if (++dfce.voxel_counts_[entered[i]] == 1)
+    {
+      field.gridToWorld(entered[i] >> 42, (entered[i] >> 21) & mask, entered[i] & mask, center.x(), center.y(),
+                        center.z());
+      occupied.push_back(center);
+    }
+
+  if (voxels.empty())
+  {
+    if (it != dfce.object_voxels_.end())
+      dfce.object_voxels_.erase(it);
+  }
+  else if (it != dfce.object_voxels_.end())
+    it->second.swap(voxels);
+  else
+    dfce.object_voxels_[id].swap(voxels);
+}
 }
 
 #include <moveit/collision_distance_field/collision_detector_allocator_distance_field.h>
@@ -245,6 +245,26 @@ public:
    */
   virtual bool project(robot_state::RobotState& state, unsigned int max_attempts) = 0;
 
+  /**
+   * \brief Draw up to \e count samples, appending the successful ones to \e states.
+   *
+   * Each sample starts from a copy of \e reference_state, gets up to \e max_attempts attempts and is updated before
+   * being stored. If \e filter is given, only samples that satisfy it are kept, so callers get states that are ready
+   * to use without checking them one at a time. The default implementation calls sample() repeatedly; samplers are
+   * not thread-safe, so to sample in parallel use one sampler instance per thread.
+   *
+   * @param [in] count The number of samples to draw
+   * @param [in] reference_state The state samples start from, also used as reference for transforms
+   * @param [out] states The vector the samples are appended to
+   * @param [in] max_attempts The maximum number of attempts for each sample
+   * @param [in] filter If not NULL, samples that do not satisfy these constraints are discarded
+   *
+   * @return The number of samples appended to \e states
+   */
+  virtual std::size_t sampleBatch(std::size_t count, const robot_state::RobotState& reference_state,
+                                  std::vector<robot_state::RobotStatePtr>& states, unsigned int max_attempts,
+                                  const kinematic_constraints::KinematicConstraintSet* filter = NULL);
+
   /**
    * \brief Returns whether or not the constraint sampler is valid or not.
    * To be valid, the joint model group must be available in the kinematic model and configure() must have successfully
@@ -269,6 +289,24 @@ public:
     verbose_ = verbose;
   }
 
+  /** \brief Get the number of threads sample() may use */
+  unsigned int getSamplingThreads() const
+  {
+    return sampling_threads_;
+  }
+
+  /**
+   * \brief Let sample() spread its work over up to \e threads threads
+   * (0 for one per core). Samplers that cannot use more than one thread
+   * ignore this. Only use values other than 1 (the default) with
+   * kinematics solvers that can be called concurrently and validity
+   * callbacks that are thread safe.
+   */
+  virtual void setSamplingThreads(unsigned int threads)
+  {
+    sampling_threads_ = threads;
+  }
+
   /**
    * \brief Get the name of the constraint sampler, for debugging purposes
    * should be in CamelCase format.
@@ -292,6 +330,7 @@ protected:
   robot_state::GroupStateValidityCallbackFn group_state_validity_callback_; /**< \brief Holds the callback for state
                                                                                validity */
   bool verbose_;                                                            /**< \brief True if verbosity is on */
+  unsigned int sampling_threads_; /**< \brief The number of threads sample() may use */
 };
 }
 
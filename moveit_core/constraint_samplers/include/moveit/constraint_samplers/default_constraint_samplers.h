@@ -192,7 +192,6 @@ protected:
 
   virtual void clear();
 
-  random_numbers::RandomNumberGenerator random_number_generator_; /**< \brief Random number generator used to sample */
   std::vector<JointInfo> bounds_; /**< \brief The bounds for any joint with bounds that are more restrictive than the
                                      joint limits */
 
@@ -440,6 +439,11 @@ public:
    * procedure max_attempt times.  If in any iteration a valid pose
    * cannot be sample within max_attempts time, it will return false.
    *
+   * If setSamplingThreads() allows more than one thread, the attempts
+   * are raced across threads, each with its own random seeds and copy
+   * of the state for the validity callback, and the first valid
+   * sample stops the others once their current IK call returns.
+   *
    * @param jsg The joint state group in question.  Must match the group passed in the constructor or will return false.
    * @param ks A reference state that will be used for transforming the IK poses
    * @param max_attempts The number of attempts to both sample and try IK
@@ -510,15 +514,27 @@ protected:
   bool callIK(const geometry_msgs::Pose& ik_query,
               const kinematics::KinematicsBase::IKCallbackFn& adapted_ik_validity_callback, double timeout,
               robot_state::RobotState& state, bool use_as_seed);
+
+  /** \brief Same as above, but random seeds are drawn from \e rng rather than the sampler's own generator */
+  bool callIK(const geometry_msgs::Pose& ik_query,
+              const kinematics::KinematicsBase::IKCallbackFn& adapted_ik_validity_callback, double timeout,
+              robot_state::RobotState& state, bool use_as_seed, random_numbers::RandomNumberGenerator& rng);
+
+  /** \brief Same as the public samplePose(), but drawing from \e rng rather than the sampler's own generator */
+  bool samplePose(Eigen::Vector3d& pos, Eigen::Quaterniond& quat, const robot_state::RobotState& ks,
+                  unsigned int max_attempts, random_numbers::RandomNumberGenerator& rng);
+
+  /** \brief Sample a pose using \e rng and express it as a query for the IK solver's base and tip frames */
+  bool sampleIKQuery(const robot_state::RobotState& reference_state, unsigned int max_attempts,
+                     random_numbers::RandomNumberGenerator& rng, geometry_msgs::Pose& ik_query);
   bool sampleHelper(robot_state::RobotState& state, const robot_state::RobotState& reference_state,
                     unsigned int max_attempts, bool project);
   bool validate(robot_state::RobotState& state) const;
 
-  random_numbers::RandomNumberGenerator random_number_generator_; /**< \brief Random generator used by the sampler */
-  IKSamplingPose sampling_pose_;                                  /**< \brief Holder for the pose used for sampling */
-  kinematics::KinematicsBaseConstPtr kb_;                         /**< \brief Holds the kinematics solver */
-  double ik_timeout_;                                             /**< \brief Holds the timeout associated with IK */
-  std::string ik_frame_;                                          /**< \brief Holds the base from of the IK solver */
+  IKSamplingPose sampling_pose_;          /**< \brief Holder for the pose used for sampling */
+  kinematics::KinematicsBaseConstPtr kb_; /**< \brief Holds the kinematics solver */
+  double ik_timeout_;                     /**< \brief Holds the timeout associated with IK */
+  std::string ik_frame_;                  /**< \brief Holds the base from of the IK solver */
   bool transform_ik_; /**< \brief True if the frame associated with the kinematic model is different than the base frame
                          of the IK solver */
   bool need_eef_to_ik_tip_transform_; /**< \brief True if the tip frame of the inverse kinematic is different than the
@@ -143,6 +143,11 @@ public:
    * passed in as an argument.  If any sampler fails, the sample fails
    * altogether.
    *
+   * If setSamplingThreads() allows more than one thread, consecutive
+   * samplers whose groups update disjoint links and do not depend on
+   * each other's frames are run concurrently, each on its own copy of
+   * the state, and their values are merged afterwards.
+   *
    * @param [in] state State where the group sample is written to
    * @param [in] reference_state Reference kinematic state that will be passed through to samplers
    * @param [in] max_attempts Max attempts, which will be passed through to samplers
@@ -154,6 +159,9 @@ public:
 
   virtual bool project(robot_state::RobotState& state, unsigned int max_attempts);
 
+  /** \brief Sets the thread count for this sampler and all the samplers it contains */
+  virtual void setSamplingThreads(unsigned int threads);
+
   /**
    * \brief Get the name of the constraint sampler, for debugging purposes
    * should be in CamelCase format.
@@ -166,7 +174,14 @@ public:
   }
 
 protected:
+  /** \brief sample() for more than one thread, running independent samplers side by side */
+  bool sampleConcurrently(robot_state::RobotState& state, const robot_state::RobotState& reference_state,
+                          unsigned int max_attempts);
+
   std::vector<ConstraintSamplerPtr> samplers_; /**< \brief Holder for sorted internal list of samplers*/
+
+  /** \brief The index in samplers_ each run of independent samplers starts at, followed by samplers_.size() */
+  std::vector<std::size_t> stage_starts_;
 };
 }
 
@@ -38,7 +38,7 @@
 
 constraint_samplers::ConstraintSampler::ConstraintSampler(const planning_scene::PlanningSceneConstPtr& scene,
                                                           const std::string& group_name)
-  : is_valid_(false), scene_(scene), verbose_(false)
+  : is_valid_(false), scene_(scene), verbose_(false), sampling_threads_(1)
 {
   jmg_ = scene->getRobotModel()->getJointModelGroup(group_name);
   if (!jmg_)
@@ -52,3 +52,28 @@ void constraint_samplers::ConstraintSampler::clear()
   is_valid_ = false;
   frame_depends_.clear();
 }
+
+std::size_t constraint_samplers::ConstraintSampler::sampleBatch(
+    std::size_t count, const robot_state::RobotState& reference_state, std::vector<robot_state::RobotStatePtr>& states,
+    unsigned int max_attempts, const kinematic_constraints::KinematicConstraintSet* filter)
+{
+  std::size_t added = 0;
+  robot_state::RobotStatePtr state;
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    // reuse the previous state if it was rejected
+    if (!state)
+      state.reset(new robot_state::RobotState(reference_state));
+    else
+      *state = reference_state;
+    if (!sample(*state, reference_state, max_attempts))
+      continue;
+    state->update();
+    if (filter && !filter->isSatisfied(*state))
+      continue;
+    states.push_back(state);
+    state.reset();
+    ++added;
+  }
+  return added;
+}
@@ -35,10 +35,13 @@
 /* Author: Ioan Sucan */
 
 #include <moveit/constraint_samplers/default_constraint_samplers.h>
+#include <moveit/background_processing/thread_budget.h>
 #include <set>
 #include <cassert>
 #include <eigen_conversions/eigen_msg.h>
 #include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <atomic>
 
 namespace constraint_samplers
 {
@@ -157,19 +160,21 @@ bool JointConstraintSampler::sample(robot_state::RobotState& state,
     return false;
   }
 
+  random_numbers::RandomNumberGenerator& rng = moveit::core::getThreadRandomNumberGenerator();
+
   // sample the unbounded joints first (in case some joint variables are bounded)
   std::vector<double> v;
   for (std::size_t i = 0; i < unbounded_.size(); ++i)
   {
     v.resize(unbounded_[i]->getVariableCount());
-    unbounded_[i]->getVariableRandomPositions(random_number_generator_, &v[0]);
+    unbounded_[i]->getVariableRandomPositions(rng, &v[0]);
     for (std::size_t j = 0; j < v.size(); ++j)
       values_[uindex_[i] + j] = v[j];
   }
 
   // enforce the constraints for the constrained components (could be all of them)
   for (std::size_t i = 0; i < bounds_.size(); ++i)
-    values_[bounds_[i].index_] = random_number_generator_.uniformReal(bounds_[i].min_bound_, bounds_[i].max_bound_);
+    values_[bounds_[i].index_] = rng.uniformReal(bounds_[i].min_bound_, bounds_[i].max_bound_);
 
   state.setJointGroupPositions(jmg_, values_);
 
@@ -413,6 +418,12 @@ bool IKConstraintSampler::loadIKSolver()
 
 bool IKConstraintSampler::samplePose(Eigen::Vector3d& pos, Eigen::Quaterniond& quat, const robot_state::RobotState& ks,
                                      unsigned int max_attempts)
+{
+  return samplePose(pos, quat, ks, max_attempts, moveit::core::getThreadRandomNumberGenerator());
+}
+
+bool IKConstraintSampler::samplePose(Eigen::Vector3d& pos, Eigen::Quaterniond& quat, const robot_state::RobotState& ks,
+                                     unsigned int max_attempts, random_numbers::RandomNumberGenerator& rng)
 {
   if (ks.dirtyLinkTransforms())
   {
@@ -429,9 +440,9 @@ bool IKConstraintSampler::samplePose(Eigen::Vector3d& pos, Eigen::Quaterniond& q
     if (!b.empty())
     {
       bool found = false;
-      std::size_t k = random_number_generator_.uniformInteger(0, b.size() - 1);
+      std::size_t k = rng.uniformInteger(0, b.size() - 1);
       for (std::size_t i = 0; i < b.size(); ++i)
-        if (b[(i + k) % b.size()]->samplePointInside(random_number_generator_, max_attempts, pos))
+        if (b[(i + k) % b.size()]->samplePointInside(rng, max_attempts, pos))
         {
           found = true;
           break;
@@ -466,13 +477,13 @@ bool IKConstraintSampler::samplePose(Eigen::Vector3d& pos, Eigen::Quaterniond& q
   {
     // sample a rotation matrix within the allowed bounds
     double angle_x =
-        2.0 * (random_number_generator_.uniform01() - 0.5) *
+        2.0 * (rng.uniform01() - 0.5) *
         (sampling_pose_.orientation_constraint_->getXAxisTolerance() - std::numeric_limits<double>::epsilon());
     double angle_y =
-        2.0 * (random_number_generator_.uniform01() - 0.5) *
+        2.0 * (rng.uniform01() - 0.5) *
         (sampling_pose_.orientation_constraint_->getYAxisTolerance() - std::numeric_limits<double>::epsilon());
     double angle_z =
-        2.0 * (random_number_generator_.uniform01() - 0.5) *
+        2.0 * (rng.uniform01() - 0.5) *
         (sampling_pose_.orientation_constraint_->getZAxisTolerance() - std::numeric_limits<double>::epsilon());
     Eigen::Affine3d diff(Eigen::AngleAxisd(angle_x, Eigen::Vector3d::UnitX()) *
                          Eigen::AngleAxisd(angle_y, Eigen::Vector3d::UnitY()) *
@@ -493,7 +504,7 @@ bool IKConstraintSampler::samplePose(Eigen::Vector3d& pos, Eigen::Quaterniond& q
   {
     // sample a random orientation
     double q[4];
-    random_number_generator_.quaternion(q);
+    rng.quaternion(q);
     quat = Eigen::Quaterniond(q[3], q[0], q[1], q[2]);
   }
 
@@ -529,6 +540,49 @@ bool IKConstraintSampler::sample(robot_state::RobotState& state, const robot_sta
   return sampleHelper(state, reference_state, max_attempts, false);
 }
 
+bool IKConstraintSampler::sampleIKQuery(const robot_state::RobotState& reference_state, unsigned int max_attempts,
+                                        random_numbers::RandomNumberGenerator& rng, geometry_msgs::Pose& ik_query)
+{
+  // sample a point in the constraint region
+  Eigen::Vector3d point;
+  Eigen::Quaterniond quat;
+  if (!samplePose(point, quat, reference_state, max_attempts, rng))
+  {
+    if (verbose_)
+      ROS_INFO_NAMED("constraint_samplers", "IK constraint sampler was unable to produce a pose to run IK for");
+    return false;
+  }
+
+  // we now have the transform we wish to perform IK for, in the planning frame
+  if (transform_ik_)
+  {
+    // we need to convert this transform to the frame expected by the IK solver
+    // both the planning frame and the frame for the IK are assumed to be robot links
+    Eigen::Affine3d ikq(Eigen::Translation3d(point) * quat.toRotationMatrix());
+    ikq = reference_state.getFrameTransform(ik_frame_).inverse() * ikq;
+    point = ikq.translation();
+    quat = Eigen::Quaterniond(ikq.rotation());
+  }
+
+  if (need_eef_to_ik_tip_transform_)
+  {
+    // After sampling the pose needs to be transformed to the ik chain tip
+    Eigen::Affine3d ikq(Eigen::Translation3d(point) * quat.toRotationMatrix());
+    ikq = ikq * eef_to_ik_tip_transform_;
+    point = ikq.translation();
+    quat = Eigen::Quaterniond(ikq.rotation());
+  }
+
+  ik_query.position.x = point.x();
+  ik_query.position.y = point.y();
+  ik_query.position.z = point.z();
+  ik_query.orientation.x = quat.x();
+  ik_query.orientation.y = quat.y();
+  ik_query.orientation.z = quat.z();
+  ik_query.orientation.w = quat.w();
+  return true;
+}
+
 bool IKConstraintSampler::sampleHelper(robot_state::RobotState& state, const robot_state::RobotState& reference_state,
                                        unsigned int max_attempts, bool project)
 {
@@ -538,6 +592,65 @@ bool IKConstraintSampler::sampleHelper(robot_state::RobotState& state, const rob
     return false;
   }
 
+  unsigned int threads = sampling_threads_;
+  if (threads == 0)
+    threads = moveit::tools::ThreadBudget::getConcurrency();
+  threads = std::max(1u, std::min(threads, max_attempts));
+  moveit::tools::ThreadBudget::Reservation reservation("constraint_samplers", threads);
+  threads = reservation.getThreads();
+
+  if (threads > 1)
+  {
+    // race the attempts across threads, each with its own random generator and copy of the state; reference_state
+    // may be the same object as state, so the winning values are only written back once all threads are done
+    std::atomic<unsigned int> next_attempt(0);
+    std::atomic<bool> stop(false);
+    bool found = false;
+    std::vector<double> solution;
+    boost::mutex solution_lock;
+    auto worker = [&](boost::uint32_t rng_seed) {
+      random_numbers::RandomNumberGenerator rng(rng_seed);
+      robot_state::RobotState thread_state(state);
+      kinematics::KinematicsBase::IKCallbackFn adapted_ik_validity_callback;
+      if (group_state_validity_callback_)
+        adapted_ik_validity_callback =
+            boost::bind(&samplingIkCallbackFnAdapter, &thread_state, jmg_, group_state_validity_callback_, _1, _2, _3);
+      unsigned int a;
+      while (!stop && (a = next_attempt++) < max_attempts)
+      {
+        geometry_msgs::Pose ik_query;
+        if (!sampleIKQuery(reference_state, max_attempts, rng, ik_query))
+        {
+          stop = true;
+          return;
+        }
+        if (callIK(ik_query, adapted_ik_validity_callback, ik_timeout_, thread_state, project && a == 0, rng))
+        {
+          boost::mutex::scoped_lock slock(solution_lock);
+          if (!found)
+          {
+            thread_state.copyJointGroupPositions(jmg_, solution);
+            found = true;
+            stop = true;
+          }
+          return;
+        }
+      }
+    };
+    std::vector<boost::uint32_t> rng_seeds(threads);
+    random_numbers::RandomNumberGenerator& rng = moveit::core::getThreadRandomNumberGenerator();
+    for (unsigned int t = 0; t < threads; ++t)
+      rng_seeds[t] = rng.uniformInteger(0, std::numeric_limits<int>::max());
+    boost::thread_group workers;
+    for (unsigned int t = 1; t < threads; ++t)
+      workers.create_thread(boost::bind<void>(worker, rng_seeds[t]));
+    worker(rng_seeds[0]);
+    workers.join_all();
+    if (found)
+      state.setJointGroupPositions(jmg_, solution);
+    return found;
+  }
+
   kinematics::KinematicsBase::IKCallbackFn adapted_ik_validity_callback;
   if (group_state_validity_callback_)
     adapted_ik_validity_callback =
@@ -545,44 +658,9 @@ bool IKConstraintSampler::sampleHelper(robot_state::RobotState& state, const rob
 
   for (unsigned int a = 0; a < max_attempts; ++a)
   {
-    // sample a point in the constraint region
-    Eigen::Vector3d point;
-    Eigen::Quaterniond quat;
-    if (!samplePose(point, quat, reference_state, max_attempts))
-    {
-      if (verbose_)
-        ROS_INFO_NAMED("constraint_samplers", "IK constraint sampler was unable to produce a pose to run IK for");
-      return false;
-    }
-
-    // we now have the transform we wish to perform IK for, in the planning frame
-    if (transform_ik_)
-    {
-      // we need to convert this transform to the frame expected by the IK solver
-      // both the planning frame and the frame for the IK are assumed to be robot links
-      Eigen::Affine3d ikq(Eigen::Translation3d(point) * quat.toRotationMatrix());
-      ikq = reference_state.getFrameTransform(ik_frame_).inverse() * ikq;
-      point = ikq.translation();
-      quat = Eigen::Quaterniond(ikq.rotation());
-    }
-
-    if (need_eef_to_ik_tip_transform_)
-    {
-      // After sampling the pose needs to be transformed to the ik chain tip
-      Eigen::Affine3d ikq(Eigen::Translation3d(point) * quat.toRotationMatrix());
-      ikq = ikq * eef_to_ik_tip_transform_;
-      point = ikq.translation();
-      quat = Eigen::Quaterniond(ikq.rotation());
-    }
-
     geometry_msgs::Pose ik_query;
-    ik_query.position.x = point.x();
-    ik_query.position.y = point.y();
-    ik_query.position.z = point.z();
-    ik_query.orientation.x = quat.x();
-    ik_query.orientation.y = quat.y();
-    ik_query.orientation.z = quat.z();
-    ik_query.orientation.w = quat.w();
+    if (!sampleIKQuery(reference_state, max_attempts, moveit::core::getThreadRandomNumberGenerator(), ik_query))
+      return false;
 
     if (callIK(ik_query, adapted_ik_validity_callback, ik_timeout_, state, project && a == 0))
       return true;
@@ -607,6 +685,15 @@ bool IKConstraintSampler::validate(robot_state::RobotState& state) const
 bool IKConstraintSampler::callIK(const geometry_msgs::Pose& ik_query,
                                  const kinematics::KinematicsBase::IKCallbackFn& adapted_ik_validity_callback,
                                  double timeout, robot_state::RobotState& state, bool use_as_seed)
+{
+  return callIK(ik_query, adapted_ik_validity_callback, timeout, state, use_as_seed,
+                moveit::core::getThreadRandomNumberGenerator());
+}
+
+bool IKConstraintSampler::callIK(const geometry_msgs::Pose& ik_query,
+                                 const kinematics::KinematicsBase::IKCallbackFn& adapted_ik_validity_callback,
+                                 double timeout, robot_state::RobotState& state, bool use_as_seed,
+                                 random_numbers::RandomNumberGenerator& rng)
 {
   const std::vector<unsigned int>& ik_joint_bijection = jmg_->getKinematicsSolverJointBijection();
   std::vector<double> seed(ik_joint_bijection.size(), 0.0);
@@ -616,7 +703,7 @@ bool IKConstraintSampler::callIK(const geometry_msgs::Pose& ik_query,
     state.copyJointGroupPositions(jmg_, vals);
   else
     // sample a seed value
-    jmg_->getVariableRandomPositions(random_number_generator_, vals);
+    jmg_->getVariableRandomPositions(rng, vals);
 
   assert(vals.size() == ik_joint_bijection.size());
   for (std::size_t i = 0; i < ik_joint_bijection.size(); ++i)
@@ -36,6 +36,7 @@
 
 #include <moveit/constraint_samplers/union_constraint_sampler.h>
 #include <moveit/constraint_samplers/default_constraint_samplers.h>
+#include <boost/thread.hpp>
 #include <algorithm>
 
 namespace constraint_samplers
@@ -104,6 +105,19 @@ struct OrderSamplers
   }
 };
 
+namespace
+{
+// true if some link b depends on is updated by a
+bool dependsOn(const ConstraintSampler& b, const std::set<std::string>& a_updates)
+{
+  const std::vector<std::string>& fd = b.getFrameDependency();
+  for (std::size_t i = 0; i < fd.size(); ++i)
+    if (a_updates.count(fd[i]))
+      return true;
+  return false;
+}
+}
+
 UnionConstraintSampler::UnionConstraintSampler(const planning_scene::PlanningSceneConstPtr& scene,
                                                const std::string& group_name,
                                                const std::vector<ConstraintSamplerPtr>& samplers)
@@ -121,6 +135,30 @@ UnionConstraintSampler::UnionConstraintSampler(const planning_scene::PlanningSce
     ROS_DEBUG_NAMED("constraint_samplers", "Union sampler for group '%s' includes sampler for group '%s'",
                     jmg_->getName().c_str(), samplers_[i]->getJointModelGroup()->getName().c_str());
   }
+
+  // split the sorted samplers into runs that could be sampled in any order: a sampler starts a new run when it
+  // shares updated links with the current run or either depends on the frames the other updates
+  std::vector<std::set<std::string> > updates(samplers_.size());
+  for (std::size_t i = 0; i < samplers_.size(); ++i)
+  {
+    const std::vector<std::string>& links = samplers_[i]->getJointModelGroup()->getUpdatedLinkModelNames();
+    updates[i].insert(links.begin(), links.end());
+    bool independent = !stage_starts_.empty();
+    for (std::size_t j = independent ? stage_starts_.back() : i; j < i && independent; ++j)
+      independent = !dependsOn(*samplers_[i], updates[j]) && !dependsOn(*samplers_[j], updates[i]) &&
+                    std::find_first_of(updates[i].begin(), updates[i].end(), updates[j].begin(), updates[j].end()) ==
+                        updates[i].end();
+    if (!independent)
+      stage_starts_.push_back(i);
+  }
+  stage_starts_.push_back(samplers_.size());
+}
+
+void UnionConstraintSampler::setSamplingThreads(unsigned int threads)
+{
+  ConstraintSampler::setSamplingThreads(threads);
+  for (std::size_t i = 0; i < samplers_.size(); ++i)
+    samplers_[i]->setSamplingThreads(threads);
 }
 
 bool UnionConstraintSampler::sample(robot_state::RobotState& state, const robot_state::RobotState& reference_state,
@@ -129,6 +167,9 @@ bool UnionConstraintSampler::sample(robot_state::RobotState& state, const robot_
   state = reference_state;
   state.setToRandomPositions(jmg_);
 
+  if (sampling_threads_ != 1)
+    return sampleConcurrently(state, reference_state, max_attempts);
+
   if (!samplers_.empty())
   {
     if (!samplers_[0]->sample(state, reference_state, max_attempts))
@@ -147,6 +188,54 @@ bool UnionConstraintSampler::sample(robot_state::RobotState& state, const robot_
   return true;
 }
 
+bool UnionConstraintSampler::sampleConcurrently(robot_state::RobotState& state,
+                                                const robot_state::RobotState& reference_state,
+                                                unsigned int max_attempts)
+{
+  for (std::size_t s = 0; s + 1 < stage_starts_.size(); ++s)
+  {
+    std::size_t begin = stage_starts_[s];
+    std::size_t end = stage_starts_[s + 1];
+    // only the very first sampler is given the caller's reference state, as in the sequential case; the others
+    // need clean link transforms in the state they sample from
+    state.updateLinkTransforms();
+    const robot_state::RobotState& stage_reference = begin == 0 ? reference_state : state;
+    if (end - begin == 1)
+    {
+      if (!samplers_[begin]->sample(state, stage_reference, max_attempts))
+        return false;
+      continue;
+    }
+
+    // the samplers in this run neither write the same links nor read each other's frames, so each can sample into
+    // its own copy of the state and the group values are merged afterwards
+    std::vector<robot_state::RobotStatePtr> results(end - begin);
+    std::vector<char> sampled(end - begin, 0);
+    for (std::size_t i = begin; i < end; ++i)
+      results[i - begin].reset(new robot_state::RobotState(state));
+    auto worker = [&](std::size_t i) {
+      robot_state::RobotState& result = *results[i - begin];
+      sampled[i - begin] = samplers_[i]->sample(result, i == 0 ? reference_state : result, max_attempts);
+    };
+    boost::thread_group workers;
+    for (std::size_t i = begin + 1; i < end; ++i)
+      workers.create_thread(boost::bind<void>(worker, i));
+    worker(begin);
+    workers.join_all();
+
+    std::vector<double> values;
+    for (std::size_t i = begin; i < end; ++i)
+    {
+      if (!sampled[i - begin])
+        return false;
+      const robot_model::JointModelGroup* group = samplers_[i]->getJointModelGroup();
+      results[i - begin]->copyJointGroupPositions(group, values);
+      state.setJointGroupPositions(group, values);
+    }
+  }
+  return true;
+}
+
 bool UnionConstraintSampler::project(robot_state::RobotState& state, unsigned int max_attempts)
 {
   for (std::size_t i = 0; i < samplers_.size(); ++i)
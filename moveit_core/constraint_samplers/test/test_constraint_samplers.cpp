@@ -274,6 +274,40 @@ TEST_F(LoadPlanningModelsPr2, JointConstraintsSamplerSimple)
   }
 }
 
+TEST_F(LoadPlanningModelsPr2, JointConstraintsSamplerBatch)
+{
+  robot_state::RobotState ks(kmodel);
+  ks.setToDefaultValues();
+
+  moveit_msgs::Constraints c;
+  c.joint_constraints.resize(1);
+  c.joint_constraints[0].joint_name = "r_shoulder_pan_joint";
+  c.joint_constraints[0].position = 0.42;
+  c.joint_constraints[0].tolerance_above = 0.01;
+  c.joint_constraints[0].tolerance_below = 0.05;
+  c.joint_constraints[0].weight = 1.0;
+
+  constraint_samplers::JointConstraintSampler jcs(ps, "right_arm");
+  EXPECT_TRUE(jcs.configure(c));
+
+  std::vector<robot_state::RobotStatePtr> states;
+  EXPECT_EQ(jcs.sampleBatch(50, ks, states, 1), 50u);
+  EXPECT_EQ(states.size(), 50u);
+
+  kinematic_constraints::KinematicConstraintSet kset(kmodel);
+  kset.add(c, ps->getTransforms());
+  for (std::size_t i = 0; i < states.size(); ++i)
+    EXPECT_TRUE(kset.decide(*states[i]).satisfied);
+
+  // a filter that cannot be satisfied together with the sampled constraints rejects every sample
+  moveit_msgs::Constraints other = c;
+  other.joint_constraints[0].position = -0.42;
+  kinematic_constraints::KinematicConstraintSet filter(kmodel);
+  filter.add(other, ps->getTransforms());
+  EXPECT_EQ(jcs.sampleBatch(10, ks, states, 1, &filter), 0u);
+  EXPECT_EQ(states.size(), 50u);
+}
+
 TEST_F(LoadPlanningModelsPr2, IKConstraintsSamplerSimple)
 {
   robot_state::Transforms& tf = ps->getTransformsNonConst();
@@ -627,6 +661,66 @@ TEST_F(LoadPlanningModelsPr2, UnionConstraintSampler)
   EXPECT_EQ(ikcs_test->getJointModelGroup()->getName(), "right_arm");
 }
 
+TEST_F(LoadPlanningModelsPr2, UnionConstraintSamplerConcurrent)
+{
+  robot_state::RobotState ks(kmodel);
+  ks.setToDefaultValues();
+  ks.update();
+
+  robot_state::RobotState ks_const(kmodel);
+  ks_const.setToDefaultValues();
+  ks_const.update();
+
+  robot_state::Transforms& tf = ps->getTransformsNonConst();
+
+  moveit_msgs::PositionConstraint pcm;
+  pcm.link_name = "l_wrist_roll_link";
+  pcm.constraint_region.primitives.resize(1);
+  pcm.constraint_region.primitives[0].type = shape_msgs::SolidPrimitive::SPHERE;
+  pcm.constraint_region.primitives[0].dimensions.resize(1);
+  pcm.constraint_region.primitives[0].dimensions[0] = 0.001;
+  pcm.constraint_region.primitive_poses.resize(1);
+  pcm.constraint_region.primitive_poses[0].position.x = 0.55;
+  pcm.constraint_region.primitive_poses[0].position.y = 0.2;
+  pcm.constraint_region.primitive_poses[0].position.z = 1.25;
+  pcm.constraint_region.primitive_poses[0].orientation.w = 1.0;
+  pcm.weight = 1.0;
+  pcm.header.frame_id = kmodel->getModelFrame();
+
+  kinematic_constraints::PositionConstraint left_pc(kmodel);
+  EXPECT_TRUE(left_pc.configure(pcm, tf));
+
+  pcm.link_name = "r_wrist_roll_link";
+  pcm.constraint_region.primitive_poses[0].position.y = -0.2;
+  kinematic_constraints::PositionConstraint right_pc(kmodel);
+  EXPECT_TRUE(right_pc.configure(pcm, tf));
+
+  constraint_samplers::IKConstraintSamplerPtr left(new constraint_samplers::IKConstraintSampler(ps, "left_arm"));
+  EXPECT_TRUE(left->configure(constraint_samplers::IKSamplingPose(left_pc)));
+  constraint_samplers::IKConstraintSamplerPtr right(new constraint_samplers::IKConstraintSampler(ps, "right_arm"));
+  EXPECT_TRUE(right->configure(constraint_samplers::IKSamplingPose(right_pc)));
+
+  std::vector<constraint_samplers::ConstraintSamplerPtr> cspv;
+  cspv.push_back(left);
+  cspv.push_back(right);
+  constraint_samplers::UnionConstraintSampler ucs(ps, "arms", cspv);
+
+  // the arms are independent, so they are sampled side by side; the test solvers are not thread safe, so each arm
+  // keeps a single IK thread
+  ucs.setSamplingThreads(2);
+  EXPECT_EQ(2u, left->getSamplingThreads());
+  left->setSamplingThreads(1);
+  right->setSamplingThreads(1);
+
+  for (int t = 0; t < 10; ++t)
+  {
+    EXPECT_TRUE(ucs.sample(ks, ks_const, 100));
+    ks.update();
+    EXPECT_TRUE(left_pc.decide(ks).satisfied);
+    EXPECT_TRUE(right_pc.decide(ks).satisfied);
+  }
+}
+
 TEST_F(LoadPlanningModelsPr2, PoseConstraintSamplerManager)
 {
   robot_state::RobotState ks(kmodel);
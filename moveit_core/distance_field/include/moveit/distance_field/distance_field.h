@@ -180,9 +180,10 @@ public:
    * This function uses the Body class in the geometric_shapes package
    * to determine the set of obstacle points, with the exception of
    * OcTrees as mentioned.  A bounding sphere is computed given the
-   * shape; the bounding sphere is iterated through in 3D at the
-   * resolution of the distance_field, with each point tested for
-   * point inclusion.  For more information about the behavior of
+   * shape; the bounding sphere is scanned at the resolution of the
+   * distance_field one line at a time, split across
+   * getShapeRasterizationThreads() threads, and all the points are
+   * added in one call to \ref addPointsToField.  For more information about the behavior of
    * bodies and poses please see the documentation for
    * geometric_shapes.
    *
@@ -323,6 +324,33 @@ public:
    */
   double getDistanceGradient(double x, double y, double z, double& gradient_x, double& gradient_y, double& gradient_z,
                              bool& in_bounds) const;
+
+  /**
+   * \brief Gets the distances and gradients at many points at once.
+   *
+   * Without interpolation, the results are those of
+   * getDistanceGradient() for each point, but the cells are looked
+   * up in one batch through getCellDistances(), which derived
+   * classes implement without a virtual call per cell.
+   *
+   * With interpolation, the distance is interpolated trilinearly
+   * between the centers of the eight cells around the point, and the
+   * gradient is the gradient of that interpolation. Both then vary
+   * continuously with the point. Points whose eight cells are not all
+   * within the field are out of bounds.
+   *
+   * Points out of bounds get the uninitialized distance and a zero
+   * gradient.
+   *
+   * @param [in] points The locations to query
+   * @param [out] distances The distance at each point
+   * @param [out] gradients The gradient at each point
+   * @param [out] in_bounds Whether each point is valid for gradient purposes
+   * @param [in] interpolate Whether to interpolate trilinearly
+   */
+  void getDistanceGradients(const EigenSTL::vector_Vector3d& points, std::vector<double>& distances,
+                            EigenSTL::vector_Vector3d& gradients, std::vector<bool>& in_bounds,
+                            bool interpolate = false) const;
   /**
    * \brief Gets the distance to the closest obstacle at the given
    * integer cell location. The particulars of this function are
@@ -581,6 +609,25 @@ public:
     return resolution_;
   }
 
+  /**
+   * \brief Sets the number of threads shapes are rasterized with by
+   * addShapeToField(), moveShapeInField() and removeShapeFromField().
+   *
+   * @param [in] threads The number of threads; 0 (the default) uses one per core
+   */
+  void setShapeRasterizationThreads(unsigned int threads)
+  {
+    shape_rasterization_threads_ = threads;
+  }
+
+  /**
+   * \brief Gets the number of threads shapes are rasterized with
+   */
+  unsigned int getShapeRasterizationThreads() const
+  {
+    return shape_rasterization_threads_;
+  }
+
   /**
    * \brief Gets a distance value for an invalid cell.
    *
@@ -615,6 +662,17 @@ protected:
   void setPoint(int xCell, int yCell, int zCell, double dist, geometry_msgs::Point& point, std_msgs::ColorRGBA& color,
                 double max_distance) const;
 
+  /**
+   * \brief Gets the distances of many cells, as getDistance() would
+   * for each. Used by getDistanceGradients(); the default calls
+   * getDistance() for every cell.
+   *
+   * @param [in] cells The cells, which must all be valid
+   * @param [in] count The number of cells
+   * @param [out] distances Room for \e count distances
+   */
+  virtual void getCellDistances(const Eigen::Vector3i* cells, std::size_t count, double* distances) const;
+
   double size_x_;            /**< \brief X size of the distance field */
   double size_y_;            /**< \brief Y size of the distance field */
   double size_z_;            /**< \brief Z size of the distance field */
@@ -623,6 +681,9 @@ protected:
   double origin_z_;          /**< \brief Z origin of the distance field */
   double resolution_;        /**< \brief Resolution of the distance field */
   int inv_twice_resolution_; /**< \brief Computed value 1.0/(2.0*resolution_) */
+
+  /** \brief Threads used to find the points of shapes */
+  unsigned int shape_rasterization_threads_;
 };
 
 }  // namespace distance_field
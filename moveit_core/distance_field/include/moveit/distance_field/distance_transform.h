@@ -0,0 +1,130 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef MOVEIT_DISTANCE_FIELD_DISTANCE_TRANSFORM_
+#define MOVEIT_DISTANCE_FIELD_DISTANCE_TRANSFORM_
+
+#include <moveit/macros/class_forward.h>
+#include <string>
+#include <vector>
+
+namespace distance_field
+{
+MOVEIT_CLASS_FORWARD(DistanceTransform);
+
+/**
+ * \brief Computes exact squared Euclidean distance transforms of
+ * dense voxel grids.
+ *
+ * PropagationDistanceField hands updates that recompute the whole
+ * field to an instance of this class (see
+ * PropagationDistanceField::setExactTransform()), so that
+ * implementations running on other devices, such as a GPU, can be
+ * plugged in from outside this library.
+ *
+ * Grids are flat arrays of x_num * y_num * z_num cells, where cell
+ * (x, y, z) is at index (x * y_num + y) * z_num + z.
+ */
+class DistanceTransform
+{
+public:
+  /** \brief The squared distance of cells when the grid has no sites */
+  static const int NO_SITE;
+
+  virtual ~DistanceTransform()
+  {
+  }
+
+  /** \brief The name of this implementation, for logging */
+  virtual std::string getName() const = 0;
+
+  /**
+   * \brief Computes the distance transform of a grid.
+   *
+   * @param [in] sites For every cell, whether it is a site (non-zero)
+   * @param [in] x_num The number of cells along x
+   * @param [in] y_num The number of cells along y
+   * @param [in] z_num The number of cells along z
+   * @param [out] distance_sq For every cell, the squared distance in
+   * cells to the closest site, or NO_SITE if there is none
+   * @param [out] closest For every cell, the index of the closest
+   * site, or -1 if there is none
+   */
+  virtual void compute(const std::vector<unsigned char>& sites, int x_num, int y_num, int z_num,
+                       std::vector<int>& distance_sq, std::vector<int>& closest) const = 0;
+
+  /**
+   * \brief One-dimensional squared distance transform of the sampled
+   * function \e f (Felzenszwalb and Huttenlocher, "Distance
+   * Transforms of Sampled Functions").
+   *
+   * Entries of \e f equal to NO_SITE are not sites. For every q,
+   * d[q] is the minimum over all sites p of (q - p)^2 + f[p] and
+   * arg[q] is the minimizing p, or -1 if there are no sites.
+   *
+   * @param v Scratch space of \e n elements
+   * @param z Scratch space of \e n + 1 elements
+   */
+  static void transformLine(const int* f, int n, int* d, int* arg, int* v, double* z);
+};
+
+MOVEIT_CLASS_FORWARD(SeparableDistanceTransform);
+
+/**
+ * \brief The CPU implementation of DistanceTransform: one pass of
+ * transformLine() along each axis, with the lines of every pass split
+ * across threads.
+ */
+class SeparableDistanceTransform : public DistanceTransform
+{
+public:
+  /** @param [in] threads The number of threads; 0 is treated as 1 */
+  SeparableDistanceTransform(unsigned int threads = 1) : threads_(threads > 0 ? threads : 1)
+  {
+  }
+
+  std::string getName() const override
+  {
+    return "separable";
+  }
+
+  void compute(const std::vector<unsigned char>& sites, int x_num, int y_num, int z_num,
+               std::vector<int>& distance_sq, std::vector<int>& closest) const override;
+
+private:
+  unsigned int threads_;
+};
+}
+
+#endif
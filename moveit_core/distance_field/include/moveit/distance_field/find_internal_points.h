@@ -47,12 +47,20 @@ namespace distance_field
  * assuming the body is a convex shape.  If the body is not convex then its
  * convex hull is used.
  *
+ * The grid is scanned one line parallel to the z axis at a time: each line
+ * is intersected with the body once and only the samples next to the
+ * intersections are tested with containsPoint(), which gives the same
+ * points as testing every sample.
+ *
  * @param [in] body The body to discretize
  * @param [in] resolution The resolution at which to test
  * @param [out] points The points internal to the body are appended to thiss
  *                   vector.
+ * @param [in] threads The number of threads to split the lines across; 0
+ *                   uses one per core.  Small bodies are always done serially.
  */
-void findInternalPointsConvex(const bodies::Body& body, double resolution, EigenSTL::vector_Vector3d& points);
+void findInternalPointsConvex(const bodies::Body& body, double resolution, EigenSTL::vector_Vector3d& points,
+                              unsigned int threads = 1);
 }
 
 #endif
@@ -39,6 +39,7 @@
 
 #include <moveit/distance_field/voxel_grid.h>
 #include <moveit/distance_field/distance_field.h>
+#include <moveit/distance_field/distance_transform.h>
 #include <vector>
 #include <list>
 #include <Eigen/Core>
@@ -383,7 +384,7 @@ public:
    */
   const PropDistanceFieldVoxel& getCell(int x, int y, int z) const
   {
-    return voxel_grid_->getCell(x, y, z);
+    return getVoxelGrid().getCell(x, y, z);
   }
 
   /**
@@ -406,19 +407,19 @@ public:
    */
   const PropDistanceFieldVoxel* getNearestCell(int x, int y, int z, double& dist, Eigen::Vector3i& pos) const
   {
-    const PropDistanceFieldVoxel* cell = &voxel_grid_->getCell(x, y, z);
+    const PropDistanceFieldVoxel* cell = &getVoxelGrid().getCell(x, y, z);
     if (cell->distance_square_ > 0)
     {
       dist = sqrt_table_[cell->distance_square_];
       pos = cell->closest_point_;
-      const PropDistanceFieldVoxel* ncell = &voxel_grid_->getCell(pos.x(), pos.y(), pos.z());
+      const PropDistanceFieldVoxel* ncell = &getVoxelGrid().getCell(pos.x(), pos.y(), pos.z());
       return ncell == cell ? NULL : ncell;
     }
     if (cell->negative_distance_square_ > 0)
     {
       dist = -sqrt_table_[cell->negative_distance_square_];
       pos = cell->closest_negative_point_;
-      const PropDistanceFieldVoxel* ncell = &voxel_grid_->getCell(pos.x(), pos.y(), pos.z());
+      const PropDistanceFieldVoxel* ncell = &getVoxelGrid().getCell(pos.x(), pos.y(), pos.z());
       return ncell == cell ? NULL : ncell;
     }
     dist = 0.0;
@@ -441,6 +442,89 @@ public:
     return max_distance_sq_;
   }
 
+  /**
+   * \brief Sets the number of threads used to update the field.
+   *
+   * With a single thread (the default), every update propagates
+   * wavefronts from the changed voxels. With more threads, updates
+   * that change so many voxels that their wavefronts would cover the
+   * whole grid instead recompute the field with an exact Euclidean
+   * distance transform (Felzenszwalb and Huttenlocher), whose passes
+   * are split across the threads. Smaller updates still use the
+   * incremental propagation, so both can be mixed freely.
+   *
+   * @param [in] threads The number of threads; 0 is treated as 1
+   */
+  void setPropagationThreads(unsigned int threads)
+  {
+    propagation_threads_ = threads > 0 ? threads : 1;
+  }
+
+  /**
+   * \brief Gets the number of threads used to update the field.
+   */
+  unsigned int getPropagationThreads() const
+  {
+    return propagation_threads_;
+  }
+
+  /**
+   * \brief Sets the distance transform that recomputes the whole
+   * field on large updates, e.g. one that runs on a GPU.
+   *
+   * Once a transform is set, updates large enough to be cheaper as a
+   * full recomputation (such as a new octomap) are handed to it even
+   * with a single propagation thread. An empty pointer restores the
+   * built-in transform controlled by setPropagationThreads().
+   *
+   * @param [in] transform The transform to use
+   */
+  void setExactTransform(const DistanceTransformConstPtr& transform)
+  {
+    exact_transform_ = transform;
+  }
+
+  /**
+   * \brief Gets the distance transform set with setExactTransform(),
+   * if any.
+   */
+  const DistanceTransformConstPtr& getExactTransform() const
+  {
+    return exact_transform_;
+  }
+
+  /**
+   * \brief Sets whether voxels are stored in blocks allocated on
+   * demand.
+   *
+   * Only voxels within the maximum distance of obstacles are then
+   * stored, which lets large volumes at fine resolutions fit in
+   * memory. Reads of other voxels return the unoccupied value. The
+   * negative distances and the exact transform used with several
+   * propagation threads touch every voxel, so they allocate
+   * everything. Changing the storage clears the field.
+   *
+   * @param [in] sparse Whether to store voxels sparsely
+   */
+  void setSparseStorage(bool sparse);
+
+  /**
+   * \brief Gets whether voxels are stored in blocks allocated on
+   * demand.
+   */
+  bool getSparseStorage() const
+  {
+    return sparse_storage_;
+  }
+
+  /**
+   * \brief Gets the number of voxels storage is allocated for.
+   */
+  std::size_t getAllocatedCellCount() const
+  {
+    return voxel_grid_->getAllocatedCellCount();
+  }
+
 private:
   typedef std::set<Eigen::Vector3i, compareEigen_Vector3i> VoxelSet; /**< \brief Typedef for set of integer indices */
 
@@ -482,6 +566,43 @@ private:
    */
   void propagateNegative();
 
+  /**
+   * \brief Decides whether an update of \e changed_voxels obstacle
+   * voxels is cheaper to perform by recomputing the whole field.
+   *
+   * @param changed_voxels The number of voxels being added or removed
+   *
+   * @return True if the full parallel transform should be used
+   */
+  bool useExactTransform(std::size_t changed_voxels) const;
+
+  /**
+   * \brief Recomputes the whole field from its obstacle voxels (all
+   * voxels with a distance_square_ of 0), using
+   * propagation_threads_ threads. Negative distances are recomputed
+   * as well if they are propagated.
+   */
+  void computeExactTransform();
+
+  /**
+   * \brief Runs one pass of the distance transform along \e axis, for
+   * the lines whose outermost coordinate is in [\e begin, \e end).
+   *
+   * @param negative Whether to compute the negative distances
+   * @param axis The axis along which the lines of this pass run
+   * @param begin First outer coordinate to process
+   * @param end One past the last outer coordinate to process
+   */
+  void computeExactTransformLines(bool negative, int axis, int begin, int end);
+
+  /**
+   * \brief Recomputes the distances (or the negative distances) of
+   * the whole field with exact_transform_.
+   *
+   * @param negative Whether to compute the negative distances
+   */
+  void applyExactTransform(bool negative);
+
   /**
    * \brief Determines distance based on actual voxel data
    *
@@ -491,6 +612,12 @@ private:
    */
   virtual double getDistance(const PropDistanceFieldVoxel& object) const;
 
+  /**
+   * \brief Reads the distances of many cells straight from the voxel
+   * grid, for getDistanceGradients()
+   */
+  void getCellDistances(const Eigen::Vector3i* cells, std::size_t count, double* distances) const override;
+
   /**
    * \brief Helper function to get a single number in a 27 connected
    * 3D voxel grid given dx, dy, and dz values.
@@ -546,6 +673,12 @@ private:
 
   bool propagate_negative_; /**< \brief Whether or not to propagate negative distances */
 
+  /** \brief Read access to the voxels that does not allocate blocks of sparse storage */
+  const VoxelGrid<PropDistanceFieldVoxel>& getVoxelGrid() const
+  {
+    return *voxel_grid_;
+  }
+
   VoxelGrid<PropDistanceFieldVoxel>::Ptr voxel_grid_; /**< \brief Actual container for distance data */
 
   /// \brief Structure used to hold propagation frontier
@@ -581,6 +714,10 @@ private:
 
   std::vector<Eigen::Vector3i> direction_number_to_direction_; /**< \brief Holds conversion from direction number to
                                                                   integer changes */
+
+  unsigned int propagation_threads_; /**< \brief Number of threads used by computeExactTransform() */
+  DistanceTransformConstPtr exact_transform_; /**< \brief Replaces the built-in transform if set */
+  bool sparse_storage_;              /**< \brief Whether voxel_grid_ allocates blocks of voxels on demand */
 };
 
 ////////////////////////// inline functions follow ////////////////////////////////////////
@@ -39,6 +39,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <vector>
 #include <Eigen/Core>
 #include <moveit/macros/declare_ptr.h>
 
@@ -57,6 +58,10 @@ enum Dimension
  * given resolution, where the data is supplied as a template
  * parameter.
  *
+ * A sparse grid stores the cells in blocks of 8x8x8 that are only
+ * allocated when a cell in them is first accessed for writing; until
+ * then, every cell of a block reads as the value of the last reset().
+ * This suits large volumes where most cells keep that value.
  */
 template <typename T>
 class VoxelGrid
@@ -88,9 +93,11 @@ public:
    *
    * @param [in] default_object An object that will be returned for any
    * future queries that are not valid
+   *
+   * @param [in] sparse Whether to allocate blocks of cells on demand
    */
   VoxelGrid(double size_x, double size_y, double size_z, double resolution, double origin_x, double origin_y,
-            double origin_z, T default_object);
+            double origin_z, T default_object, bool sparse = false);
   virtual ~VoxelGrid();
 
   /**
@@ -117,9 +124,11 @@ public:
    * @param [in] origin_x Minimum point along the X axis of the volume
    * @param [in] origin_y Minimum point along the Y axis of the volume
    * @param [in] origin_z Minimum point along the Z axis of the volume
+   *
+   * @param [in] sparse Whether to allocate blocks of cells on demand
    */
   void resize(double size_x, double size_y, double size_z, double resolution, double origin_x, double origin_y,
-              double origin_z, T default_object);
+              double origin_z, T default_object, bool sparse = false);
 
   /**
    * \brief Operator that gets the value of the given location (x, y,
@@ -153,6 +162,10 @@ public:
    *
    * @return The data in the indicated cell.  If x,y,z is invalid then
    * corruption and/or SEGFAULTS will occur.
+   *
+   * On a sparse grid the non-const versions allocate the block of the
+   * cell, and must not be called from several threads at once unless
+   * allocateAllCells() was called first.
    */
   T& getCell(int x, int y, int z);
   T& getCell(const Eigen::Vector3i& pos);
@@ -183,10 +196,21 @@ public:
   /**
    * \brief Sets every cell in the voxel grid to the supplied data
    *
+   * On a sparse grid this releases all blocks.
+   *
    * @param [in] initial The template variable to which to set the data
    */
   void reset(const T& initial);
 
+  /** \brief Whether blocks of cells are allocated on demand */
+  bool isSparse() const;
+
+  /** \brief The number of cells storage is allocated for; all of them for a dense grid */
+  std::size_t getAllocatedCellCount() const;
+
+  /** \brief Allocates every block of a sparse grid. Does nothing for a dense grid. */
+  void allocateAllCells();
+
   /**
    * \brief Gets the size in arbitrary units of the indicated dimension
    *
@@ -300,6 +324,29 @@ protected:
   int stride1_;            /**< \brief The step to take when stepping between consecutive X members in the 1D array */
   int stride2_; /**< \brief The step to take when stepping between consecutive Y members given an X in the 1D array */
 
+  static const int BLOCK_BITS = 3;                /**< \brief log2 of the block size of a sparse grid */
+  static const int BLOCK_SIZE = 1 << BLOCK_BITS;  /**< \brief The number of cells along each block edge */
+  static const int BLOCK_MASK = BLOCK_SIZE - 1;   /**< \brief Masks the index of a cell within its block */
+  static const int BLOCK_CELLS = BLOCK_SIZE * BLOCK_SIZE * BLOCK_SIZE; /**< \brief The number of cells per block */
+
+  bool sparse_;                      /**< \brief Whether blocks_ holds the data instead of data_ */
+  std::vector<T*> blocks_;           /**< \brief The blocks of a sparse grid (x, y, z order), NULL until allocated */
+  T background_;                     /**< \brief The value read from cells of blocks that are not allocated */
+  int num_blocks_[3];                /**< \brief The number of blocks in each dimension (in Dimension order) */
+  std::size_t num_allocated_blocks_; /**< \brief The number of allocated blocks */
+
+  /** \brief Frees all blocks of a sparse grid */
+  void releaseBlocks();
+
+  /** \brief Gets the index of the block of a cell, with no validity check */
+  int blockRef(int x, int y, int z) const;
+
+  /** \brief Gets the index of a cell within its block */
+  int cellInBlockRef(int x, int y, int z) const;
+
+  /** \brief Gets a cell of a sparse grid, allocating its block if needed */
+  T& getSparseCell(int x, int y, int z);
+
   /**
    * \brief Gets the 1D index into the array, with no validity check.
    *
@@ -341,14 +388,14 @@ protected:
 
 template <typename T>
 VoxelGrid<T>::VoxelGrid(double size_x, double size_y, double size_z, double resolution, double origin_x,
-                        double origin_y, double origin_z, T default_object)
-  : data_(NULL)
+                        double origin_y, double origin_z, T default_object, bool sparse)
+  : data_(NULL), sparse_(false), num_allocated_blocks_(0)
 {
-  resize(size_x, size_y, size_z, resolution, origin_x, origin_y, origin_z, default_object);
+  resize(size_x, size_y, size_z, resolution, origin_x, origin_y, origin_z, default_object, sparse);
 }
 
 template <typename T>
-VoxelGrid<T>::VoxelGrid() : data_(NULL)
+VoxelGrid<T>::VoxelGrid() : data_(NULL), sparse_(false), num_allocated_blocks_(0)
 {
   for (int i = DIM_X; i <= DIM_Z; ++i)
   {
@@ -356,6 +403,7 @@ VoxelGrid<T>::VoxelGrid() : data_(NULL)
     origin_[i] = 0;
     origin_minus_[i] = 0;
     num_cells_[i] = 0;
+    num_blocks_[i] = 0;
   }
   resolution_ = 1.0;
   oo_resolution_ = 1.0 / resolution_;
@@ -366,10 +414,12 @@ VoxelGrid<T>::VoxelGrid() : data_(NULL)
 
 template <typename T>
 void VoxelGrid<T>::resize(double size_x, double size_y, double size_z, double resolution, double origin_x,
-                          double origin_y, double origin_z, T default_object)
+                          double origin_y, double origin_z, T default_object, bool sparse)
 {
   delete[] data_;
   data_ = NULL;
+  releaseBlocks();
+  blocks_.clear();
 
   size_[DIM_X] = size_x;
   size_[DIM_Y] = size_y;
@@ -395,7 +445,19 @@ void VoxelGrid<T>::resize(double size_x, double size_y, double size_z, double re
   stride2_ = num_cells_[DIM_Z];
 
   // initialize the data:
-  if (num_cells_total_ > 0)
+  sparse_ = sparse;
+  if (sparse_)
+  {
+    std::size_t num_blocks_total = 1;
+    for (int i = DIM_X; i <= DIM_Z; ++i)
+    {
+      num_blocks_[i] = (std::max(num_cells_[i], 0) + BLOCK_SIZE - 1) >> BLOCK_BITS;
+      num_blocks_total *= num_blocks_[i];
+    }
+    blocks_.assign(num_cells_total_ > 0 ? num_blocks_total : 0, NULL);
+    background_ = default_object;
+  }
+  else if (num_cells_total_ > 0)
     data_ = new T[num_cells_total_];
 }
 
@@ -403,6 +465,68 @@ template <typename T>
 VoxelGrid<T>::~VoxelGrid()
 {
   delete[] data_;
+  releaseBlocks();
+}
+
+template <typename T>
+void VoxelGrid<T>::releaseBlocks()
+{
+  for (std::size_t i = 0; i < blocks_.size(); ++i)
+  {
+    delete[] blocks_[i];
+    blocks_[i] = NULL;
+  }
+  num_allocated_blocks_ = 0;
+}
+
+template <typename T>
+inline int VoxelGrid<T>::blockRef(int x, int y, int z) const
+{
+  return ((x >> BLOCK_BITS) * num_blocks_[DIM_Y] + (y >> BLOCK_BITS)) * num_blocks_[DIM_Z] + (z >> BLOCK_BITS);
+}
+
+template <typename T>
+inline int VoxelGrid<T>::cellInBlockRef(int x, int y, int z) const
+{
+  return ((x & BLOCK_MASK) << (2 * BLOCK_BITS)) | ((y & BLOCK_MASK) << BLOCK_BITS) | (z & BLOCK_MASK);
+}
+
+template <typename T>
+inline T& VoxelGrid<T>::getSparseCell(int x, int y, int z)
+{
+  T*& block = blocks_[blockRef(x, y, z)];
+  if (!block)
+  {
+    block = new T[BLOCK_CELLS];
+    std::fill(block, block + BLOCK_CELLS, background_);
+    ++num_allocated_blocks_;
+  }
+  return block[cellInBlockRef(x, y, z)];
+}
+
+template <typename T>
+inline bool VoxelGrid<T>::isSparse() const
+{
+  return sparse_;
+}
+
+template <typename T>
+std::size_t VoxelGrid<T>::getAllocatedCellCount() const
+{
+  if (!sparse_)
+    return num_cells_total_ > 0 ? num_cells_total_ : 0;
+  return num_allocated_blocks_ * BLOCK_CELLS;
+}
+
+template <typename T>
+void VoxelGrid<T>::allocateAllCells()
+{
+  if (!sparse_)
+    return;
+  for (int x = 0; x < num_blocks_[DIM_X]; ++x)
+    for (int y = 0; y < num_blocks_[DIM_Y]; ++y)
+      for (int z = 0; z < num_blocks_[DIM_Z]; ++z)
+        getSparseCell(x << BLOCK_BITS, y << BLOCK_BITS, z << BLOCK_BITS);
 }
 
 template <typename T>
@@ -479,37 +603,44 @@ inline const T& VoxelGrid<T>::operator()(const Eigen::Vector3d& pos) const
 template <typename T>
 inline T& VoxelGrid<T>::getCell(int x, int y, int z)
 {
+  if (sparse_)
+    return getSparseCell(x, y, z);
   return data_[ref(x, y, z)];
 }
 
 template <typename T>
 inline const T& VoxelGrid<T>::getCell(int x, int y, int z) const
 {
+  if (sparse_)
+  {
+    const T* block = blocks_[blockRef(x, y, z)];
+    return block ? block[cellInBlockRef(x, y, z)] : background_;
+  }
   return data_[ref(x, y, z)];
 }
 
 template <typename T>
 inline T& VoxelGrid<T>::getCell(const Eigen::Vector3i& pos)
 {
-  return data_[ref(pos.x(), pos.y(), pos.z())];
+  return getCell(pos.x(), pos.y(), pos.z());
 }
 
 template <typename T>
 inline const T& VoxelGrid<T>::getCell(const Eigen::Vector3i& pos) const
 {
-  return data_[ref(pos.x(), pos.y(), pos.z())];
+  return getCell(pos.x(), pos.y(), pos.z());
 }
 
 template <typename T>
 inline void VoxelGrid<T>::setCell(int x, int y, int z, const T& obj)
 {
-  data_[ref(x, y, z)] = obj;
+  getCell(x, y, z) = obj;
 }
 
 template <typename T>
 inline void VoxelGrid<T>::setCell(const Eigen::Vector3i& pos, const T& obj)
 {
-  data_[ref(pos.x(), pos.y(), pos.z())] = obj;
+  getCell(pos.x(), pos.y(), pos.z()) = obj;
 }
 
 template <typename T>
@@ -541,7 +672,13 @@ inline double VoxelGrid<T>::getLocationFromCell(Dimension dim, int cell) const
 template <typename T>
 inline void VoxelGrid<T>::reset(const T& initial)
 {
-  std::fill(data_, data_ + num_cells_total_, initial);
+  if (sparse_)
+  {
+    releaseBlocks();
+    background_ = initial;
+  }
+  else
+    std::fill(data_, data_ + num_cells_total_, initial);
 }
 
 template <typename T>
@@ -54,6 +54,7 @@ DistanceField::DistanceField(double size_x, double size_y, double size_z, double
   , origin_z_(origin_z)
   , resolution_(resolution)
   , inv_twice_resolution_(1.0 / (2.0 * resolution_))
+  , shape_rasterization_threads_(0)
 {
 }
 
@@ -85,6 +86,101 @@ double DistanceField::getDistanceGradient(double x, double y, double z, double&
   return getDistance(gx, gy, gz);
 }
 
+void DistanceField::getDistanceGradients(const EigenSTL::vector_Vector3d& points, std::vector<double>& distances,
+                                         EigenSTL::vector_Vector3d& gradients, std::vector<bool>& in_bounds,
+                                         bool interpolate) const
+{
+  const std::size_t n = points.size();
+  distances.assign(n, getUninitializedDistance());
+  gradients.assign(n, Eigen::Vector3d::Zero());
+  in_bounds.assign(n, false);
+  if (n == 0)
+    return;
+
+  // the center of cell (0, 0, 0); cell indices are the rounded offsets from it in units of the resolution
+  Eigen::Vector3d first_center;
+  gridToWorld(0, 0, 0, first_center.x(), first_center.y(), first_center.z());
+  const Eigen::Vector3i num_cells(getXNumCells(), getYNumCells(), getZNumCells());
+  const double inv_resolution = 1.0 / resolution_;
+
+  // the cells each point needs: the cell and its six neighbors, or the eight cells around the point
+  const int per_point = interpolate ? 8 : 7;
+  std::vector<std::size_t> valid;
+  std::vector<Eigen::Vector3i> cells;
+  std::vector<Eigen::Vector3d> fractions;
+  valid.reserve(n);
+  cells.reserve(n * per_point);
+  fractions.reserve(interpolate ? n : 0);
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    const Eigen::Vector3d g = (points[i] - first_center) * inv_resolution;
+    if (interpolate)
+    {
+      const Eigen::Vector3i c(static_cast<int>(floor(g.x())), static_cast<int>(floor(g.y())),
+                              static_cast<int>(floor(g.z())));
+      if ((c.array() < 0).any() || (c.array() >= num_cells.array() - 1).any())
+        continue;
+      valid.push_back(i);
+      fractions.push_back(g - c.cast<double>());
+      for (int corner = 0; corner < 8; ++corner)
+        cells.push_back(c + Eigen::Vector3i(corner >> 2, (corner >> 1) & 1, corner & 1));
+    }
+    else
+    {
+      const Eigen::Vector3i c(static_cast<int>(floor(g.x() + 0.5)), static_cast<int>(floor(g.y() + 0.5)),
+                              static_cast<int>(floor(g.z() + 0.5)));
+      // we need extra padding of 1 to get gradients
+      if ((c.array() < 1).any() || (c.array() >= num_cells.array() - 1).any())
+        continue;
+      valid.push_back(i);
+      cells.push_back(c);
+      for (int axis = 0; axis < 3; ++axis)
+      {
+        cells.push_back(c + Eigen::Vector3i::Unit(axis));
+        cells.push_back(c - Eigen::Vector3i::Unit(axis));
+      }
+    }
+  }
+  if (valid.empty())
+    return;
+
+  std::vector<double> d(cells.size());
+  getCellDistances(&cells[0], cells.size(), &d[0]);
+
+  for (std::size_t k = 0; k < valid.size(); ++k)
+  {
+    const std::size_t i = valid[k];
+    const double* v = &d[k * per_point];
+    in_bounds[i] = true;
+    if (interpolate)
+    {
+      // v[(ix << 2) | (iy << 1) | iz] is the distance at corner (ix, iy, iz)
+      const double tx = fractions[k].x(), ty = fractions[k].y(), tz = fractions[k].z();
+      const double x00 = v[0] + (v[4] - v[0]) * tx, x01 = v[1] + (v[5] - v[1]) * tx;
+      const double x10 = v[2] + (v[6] - v[2]) * tx, x11 = v[3] + (v[7] - v[3]) * tx;
+      const double y0 = x00 + (x10 - x00) * ty, y1 = x01 + (x11 - x01) * ty;
+      distances[i] = y0 + (y1 - y0) * tz;
+
+      const double dx0 = (v[4] - v[0]) + ((v[6] - v[2]) - (v[4] - v[0])) * ty;
+      const double dx1 = (v[5] - v[1]) + ((v[7] - v[3]) - (v[5] - v[1])) * ty;
+      gradients[i].x() = (dx0 + (dx1 - dx0) * tz) * inv_resolution;
+      gradients[i].y() = ((x10 - x00) + ((x11 - x01) - (x10 - x00)) * tz) * inv_resolution;
+      gradients[i].z() = (y1 - y0) * inv_resolution;
+    }
+    else
+    {
+      distances[i] = v[0];
+      gradients[i] = Eigen::Vector3d(v[1] - v[2], v[3] - v[4], v[5] - v[6]) * inv_twice_resolution_;
+    }
+  }
+}
+
+void DistanceField::getCellDistances(const Eigen::Vector3i* cells, std::size_t count, double* distances) const
+{
+  for (std::size_t i = 0; i < count; ++i)
+    distances[i] = getDistance(cells[i].x(), cells[i].y(), cells[i].z());
+}
+
 void DistanceField::getIsoSurfaceMarkers(double min_distance, double max_distance, const std::string& frame_id,
                                          const ros::Time stamp, visualization_msgs::Marker& inf_marker) const
 {
@@ -210,7 +306,7 @@ bool DistanceField::getShapePoints(const shapes::Shape* shape, const Eigen::Affi
   {
     bodies::Body* body = bodies::createBodyFromShape(shape);
     body->setPose(pose);
-    findInternalPointsConvex(*body, resolution_, *points);
+    findInternalPointsConvex(*body, resolution_, *points, shape_rasterization_threads_);
     delete body;
   }
   return true;
@@ -295,10 +391,10 @@ void DistanceField::moveShapeInField(const shapes::Shape* shape, const Eigen::Af
   bodies::Body* body = bodies::createBodyFromShape(shape);
   body->setPose(old_pose);
   EigenSTL::vector_Vector3d old_point_vec;
-  findInternalPointsConvex(*body, resolution_, old_point_vec);
+  findInternalPointsConvex(*body, resolution_, old_point_vec, shape_rasterization_threads_);
   body->setPose(new_pose);
   EigenSTL::vector_Vector3d new_point_vec;
-  findInternalPointsConvex(*body, resolution_, new_point_vec);
+  findInternalPointsConvex(*body, resolution_, new_point_vec, shape_rasterization_threads_);
   delete body;
   updatePointsInField(old_point_vec, new_point_vec);
 }
@@ -318,7 +414,7 @@ void DistanceField::removeShapeFromField(const shapes::Shape* shape, const Eigen
   bodies::Body* body = bodies::createBodyFromShape(shape);
   body->setPose(pose);
   EigenSTL::vector_Vector3d point_vec;
-  findInternalPointsConvex(*body, resolution_, point_vec);
+  findInternalPointsConvex(*body, resolution_, point_vec, shape_rasterization_threads_);
   delete body;
   removePointsFromField(point_vec);
 }
@@ -0,0 +1,152 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/distance_field/distance_transform.h>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <limits>
+
+namespace distance_field
+{
+namespace
+{
+// transforms the lines along axis whose coordinate on the outer axis is in [begin, end); the lines of a pass are
+// disjoint, so several of these can run at once
+void transformLines(int axis, int outer_axis, int inner_axis, int begin, int end, const int* num, const int* stride,
+                    std::vector<int>* distance_sq, std::vector<int>* closest)
+{
+  const int n = num[axis];
+  std::vector<int> f(n), d(n), arg(n), v(n), c(n);
+  std::vector<double> z(n + 1);
+
+  for (int o = begin; o < end; ++o)
+    for (int i = 0; i < num[inner_axis]; ++i)
+    {
+      const int base = o * stride[outer_axis] + i * stride[inner_axis];
+      for (int q = 0; q < n; ++q)
+      {
+        f[q] = (*distance_sq)[base + q * stride[axis]];
+        c[q] = (*closest)[base + q * stride[axis]];
+      }
+
+      DistanceTransform::transformLine(&f[0], n, &d[0], &arg[0], &v[0], &z[0]);
+
+      // continue from the closest sites found by the previous passes
+      for (int q = 0; q < n; ++q)
+      {
+        (*distance_sq)[base + q * stride[axis]] = d[q];
+        (*closest)[base + q * stride[axis]] = arg[q] >= 0 ? c[arg[q]] : -1;
+      }
+    }
+}
+}
+
+const int DistanceTransform::NO_SITE = std::numeric_limits<int>::max();
+
+void DistanceTransform::transformLine(const int* f, int n, int* d, int* arg, int* v, double* z)
+{
+  int k = -1;
+  double s = 0.0;
+  for (int q = 0; q < n; ++q)
+  {
+    if (f[q] == NO_SITE)
+      continue;
+    // remove the parabolas of the lower envelope that the one rooted at q hides
+    while (k >= 0)
+    {
+      const int p = v[k];
+      s = ((static_cast<double>(f[q]) + q * q) - (static_cast<double>(f[p]) + p * p)) / (2.0 * (q - p));
+      if (s > z[k])
+        break;
+      --k;
+    }
+    ++k;
+    v[k] = q;
+    z[k] = k == 0 ? -std::numeric_limits<double>::infinity() : s;
+    z[k + 1] = std::numeric_limits<double>::infinity();
+  }
+
+  if (k < 0)
+  {
+    std::fill(d, d + n, NO_SITE);
+    std::fill(arg, arg + n, -1);
+    return;
+  }
+
+  k = 0;
+  for (int q = 0; q < n; ++q)
+  {
+    while (z[k + 1] < q)
+      ++k;
+    d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+    arg[q] = v[k];
+  }
+}
+
+void SeparableDistanceTransform::compute(const std::vector<unsigned char>& sites, int x_num, int y_num, int z_num,
+                                         std::vector<int>& distance_sq, std::vector<int>& closest) const
+{
+  const std::size_t cells = static_cast<std::size_t>(x_num) * y_num * z_num;
+  distance_sq.resize(cells);
+  closest.resize(cells);
+  for (std::size_t i = 0; i < cells; ++i)
+  {
+    distance_sq[i] = sites[i] ? 0 : NO_SITE;
+    closest[i] = sites[i] ? static_cast<int>(i) : -1;
+  }
+
+  // the squared distances are separable: one pass along each axis, starting with the contiguous z lines. The lines of
+  // every pass are split across the threads along their outer coordinate
+  const int num[3] = { x_num, y_num, z_num };
+  const int stride[3] = { y_num * z_num, z_num, 1 };
+  for (int axis = 2; axis >= 0; --axis)
+  {
+    const int outer_axis = axis == 0 ? 1 : 0;
+    const int inner_axis = axis == 2 ? 1 : 2;
+    const int outer = num[outer_axis];
+    const int threads = std::min<int>(threads_, outer);
+    if (threads <= 1)
+    {
+      transformLines(axis, outer_axis, inner_axis, 0, outer, num, stride, &distance_sq, &closest);
+      continue;
+    }
+    boost::thread_group group;
+    for (int t = 0; t < threads; ++t)
+      group.create_thread(boost::bind(&transformLines, axis, outer_axis, inner_axis, outer * t / threads,
+                                      outer * (t + 1) / threads, num, stride, &distance_sq, &closest));
+    group.join_all();
+  }
+}
+}
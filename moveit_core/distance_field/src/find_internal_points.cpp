@@ -35,9 +35,78 @@
 /* Author: Acorn Pooley */
 
 #include <moveit/distance_field/find_internal_points.h>
+#include <moveit/background_processing/thread_budget.h>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
+
+namespace
+{
+// below this many grid columns per thread, spawning threads costs more than it saves
+static const std::size_t MIN_COLUMNS_PER_THREAD = 256;
+
+// the sample values along one axis, accumulated the same way the original triple loop did
+void computeAxisSamples(double start, double end, double resolution, std::vector<double>& samples)
+{
+  for (double v = start; v <= end; v += resolution)
+    samples.push_back(v);
+}
+
+// Cast one ray along +z per (x, y) column and emit the samples between where it enters and leaves the body.
+// The ends of each interval are settled with containsPoint(), so the output matches testing every sample.
+void rasterizeColumns(const bodies::Body* body, const std::vector<double>* xs, const std::vector<double>* ys,
+                      const std::vector<double>* zs, std::size_t x_begin, std::size_t x_end,
+                      EigenSTL::vector_Vector3d* points)
+{
+  const Eigen::Vector3d dir(0.0, 0.0, 1.0);
+  const int num_z = zs->size();
+  EigenSTL::vector_Vector3d intersections;
+  Eigen::Vector3d pt;
+  for (std::size_t i = x_begin; i < x_end; ++i)
+  {
+    pt.x() = (*xs)[i];
+    for (std::size_t j = 0; j < ys->size(); ++j)
+    {
+      pt.y() = (*ys)[j];
+      intersections.clear();
+      if (!body->intersectsRay(Eigen::Vector3d(pt.x(), pt.y(), zs->front() - 1.0), dir, &intersections) ||
+          intersections.empty())
+        continue;
+
+      double z_min = intersections[0].z();
+      double z_max = z_min;
+      for (std::size_t k = 1; k < intersections.size(); ++k)
+      {
+        z_min = std::min(z_min, intersections[k].z());
+        z_max = std::max(z_max, intersections[k].z());
+      }
+
+      int lo = std::lower_bound(zs->begin(), zs->end(), z_min) - zs->begin();
+      int hi = (std::upper_bound(zs->begin(), zs->end(), z_max) - zs->begin()) - 1;
+
+      // the body is convex, so only the samples next to the intersections can disagree with containsPoint()
+      auto inside = [&](int k) { return body->containsPoint(Eigen::Vector3d(pt.x(), pt.y(), (*zs)[k])); };
+      while (lo > 0 && inside(lo - 1))
+        --lo;
+      while (hi + 1 < num_z && inside(hi + 1))
+        ++hi;
+      while (lo <= hi && !inside(lo))
+        ++lo;
+      while (hi >= lo && !inside(hi))
+        --hi;
+
+      for (int k = lo; k <= hi; ++k)
+      {
+        pt.z() = (*zs)[k];
+        points->push_back(pt);
+      }
+    }
+  }
+}
+}
 
 void distance_field::findInternalPointsConvex(const bodies::Body& body, double resolution,
-                                              EigenSTL::vector_Vector3d& points)
+                                              EigenSTL::vector_Vector3d& points, unsigned int threads)
 {
   bodies::BoundingSphere sphere;
   body.computeBoundingSphere(sphere);
@@ -47,18 +116,39 @@ void distance_field::findInternalPointsConvex(const bodies::Body& body, double r
   double xval_e = sphere.center.x() + sphere.radius + resolution;
   double yval_e = sphere.center.y() + sphere.radius + resolution;
   double zval_e = sphere.center.z() + sphere.radius + resolution;
-  Eigen::Vector3d pt;
-  for (pt.x() = xval_s; pt.x() <= xval_e; pt.x() += resolution)
+
+  std::vector<double> xs, ys, zs;
+  computeAxisSamples(xval_s, xval_e, resolution, xs);
+  computeAxisSamples(yval_s, yval_e, resolution, ys);
+  computeAxisSamples(zval_s, zval_e, resolution, zs);
+  if (xs.empty() || ys.empty() || zs.empty())
+    return;
+
+  if (threads == 0)
+    threads = moveit::tools::ThreadBudget::getConcurrency();
+  threads = std::min<std::size_t>(threads, std::max<std::size_t>(1, xs.size() * ys.size() / MIN_COLUMNS_PER_THREAD));
+  threads = std::min<std::size_t>(threads, xs.size());
+  moveit::tools::ThreadBudget::Reservation reservation("distance_field", threads);
+  threads = reservation.getThreads();
+
+  if (threads <= 1)
   {
-    for (pt.y() = yval_s; pt.y() <= yval_e; pt.y() += resolution)
-    {
-      for (pt.z() = zval_s; pt.z() <= zval_e; pt.z() += resolution)
-      {
-        if (body.containsPoint(pt))
-        {
-          points.push_back(pt);
-        }
-      }
-    }
+    rasterizeColumns(&body, &xs, &ys, &zs, 0, xs.size(), &points);
+    return;
   }
+
+  // each thread takes a contiguous range of x slices; concatenating in order keeps the serial output order
+  std::vector<EigenSTL::vector_Vector3d> thread_points(threads);
+  boost::thread_group workers;
+  for (unsigned int t = 0; t < threads; ++t)
+    workers.create_thread(boost::bind(&rasterizeColumns, &body, &xs, &ys, &zs, t * xs.size() / threads,
+                                      (t + 1) * xs.size() / threads, &thread_points[t]));
+  workers.join_all();
+
+  std::size_t total = points.size();
+  for (unsigned int t = 0; t < threads; ++t)
+    total += thread_points[t].size();
+  points.reserve(total);
+  for (unsigned int t = 0; t < threads; ++t)
+    points.insert(points.end(), thread_points[t].begin(), thread_points[t].end());
 }
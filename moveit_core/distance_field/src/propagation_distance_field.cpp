@@ -40,6 +40,10 @@
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/copy.hpp>
 #include <boost/iostreams/filter/zlib.hpp>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <limits>
 
 namespace distance_field
 {
@@ -49,6 +53,8 @@ PropagationDistanceField::PropagationDistanceField(double size_x, double size_y,
   : DistanceField(size_x, size_y, size_z, resolution, origin_x, origin_y, origin_z)
   , propagate_negative_(propagate_negative)
   , max_distance_(max_distance)
+  , propagation_threads_(1)
+  , sparse_storage_(false)
 {
   initialize();
 }
@@ -61,6 +67,8 @@ PropagationDistanceField::PropagationDistanceField(const octomap::OcTree& octree
   , propagate_negative_(propagate_negative_distances)
   , max_distance_(max_distance)
   , max_distance_sq_(0)  // avoid gcc warning about uninitialized value
+  , propagation_threads_(1)
+  , sparse_storage_(false)
 {
   initialize();
   addOcTreeToField(&octree);
@@ -68,7 +76,11 @@ PropagationDistanceField::PropagationDistanceField(const octomap::OcTree& octree
 
 PropagationDistanceField::PropagationDistanceField(std::istream& is, double max_distance,
                                                    bool propagate_negative_distances)
-  : DistanceField(0, 0, 0, 0, 0, 0, 0), propagate_negative_(propagate_negative_distances), max_distance_(max_distance)
+  : DistanceField(0, 0, 0, 0, 0, 0, 0)
+  , propagate_negative_(propagate_negative_distances)
+  , max_distance_(max_distance)
+  , propagation_threads_(1)
+  , sparse_storage_(false)
 {
   readFromStream(is);
 }
@@ -77,7 +89,8 @@ void PropagationDistanceField::initialize()
 {
   max_distance_sq_ = ceil(max_distance_ / resolution_) * ceil(max_distance_ / resolution_);
   voxel_grid_.reset(new VoxelGrid<PropDistanceFieldVoxel>(size_x_, size_y_, size_z_, resolution_, origin_x_, origin_y_,
-                                                          origin_z_, PropDistanceFieldVoxel(max_distance_sq_, 0)));
+                                                          origin_z_, PropDistanceFieldVoxel(max_distance_sq_, 0),
+                                                          sparse_storage_));
 
   initNeighborhoods();
 
@@ -229,6 +242,20 @@ void PropagationDistanceField::removePointsFromField(const EigenSTL::vector_Vect
 void PropagationDistanceField::addNewObstacleVoxels(const std::vector<Eigen::Vector3i>& voxel_points)
 {
   int initial_update_direction = getDirectionNumber(0, 0, 0);
+  if (useExactTransform(voxel_points.size()))
+  {
+    for (unsigned int i = 0; i < voxel_points.size(); i++)
+    {
+      PropDistanceFieldVoxel& voxel =
+          voxel_grid_->getCell(voxel_points[i].x(), voxel_points[i].y(), voxel_points[i].z());
+      voxel.distance_square_ = 0;
+      voxel.closest_point_ = voxel_points[i];
+      voxel.update_direction_ = initial_update_direction;
+    }
+    computeExactTransform();
+    return;
+  }
+
   bucket_queue_[0].reserve(voxel_points.size());
   std::vector<Eigen::Vector3i> negative_stack;
   if (propagate_negative_)
@@ -315,6 +342,20 @@ void PropagationDistanceField::removeObstacleVoxels(const std::vector<Eigen::Vec
   std::vector<Eigen::Vector3i> negative_stack;
   int initial_update_direction = getDirectionNumber(0, 0, 0);
 
+  if (useExactTransform(voxel_points.size()))
+  {
+    for (unsigned int i = 0; i < voxel_points.size(); i++)
+    {
+      PropDistanceFieldVoxel& voxel =
+          voxel_grid_->getCell(voxel_points[i].x(), voxel_points[i].y(), voxel_points[i].z());
+      voxel.distance_square_ = max_distance_sq_;
+      voxel.closest_point_ = voxel_points[i];
+      voxel.update_direction_ = initial_update_direction;
+    }
+    computeExactTransform();
+    return;
+  }
+
   stack.reserve(getXNumCells() * getYNumCells() * getZNumCells());
   bucket_queue_[0].reserve(voxel_points.size());
   if (propagate_negative_)
@@ -395,6 +436,151 @@ void PropagationDistanceField::removeObstacleVoxels(const std::vector<Eigen::Vec
   }
 }
 
+bool PropagationDistanceField::useExactTransform(std::size_t changed_voxels) const
+{
+  if (propagation_threads_ < 2 && !exact_transform_)
+    return false;
+  // the wavefront of every changed voxel covers a ball of radius max_distance_ (about 4 r^3 cells); once all of them
+  // together could visit more cells than the grid has, recomputing the whole field is the cheaper option
+  const double radius = sqrt(static_cast<double>(max_distance_sq_));
+  const double cells = static_cast<double>(getXNumCells()) * getYNumCells() * getZNumCells();
+  return 4.0 * radius * radius * radius * changed_voxels >= cells;
+}
+
+void PropagationDistanceField::computeExactTransform()
+{
+  // every voxel is written, and blocks cannot be allocated from several threads at once
+  voxel_grid_->allocateAllCells();
+
+  if (exact_transform_)
+  {
+    for (int sign = 0; sign < (propagate_negative_ ? 2 : 1); ++sign)
+      applyExactTransform(sign == 1);
+    return;
+  }
+
+  // the squared distances are separable: one pass of one-dimensional transforms along each axis. The lines of a pass
+  // are independent, so each pass is split across the threads along its outermost coordinate
+  for (int sign = 0; sign < (propagate_negative_ ? 2 : 1); ++sign)
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      const int outer = axis == 2 ? getXNumCells() : getZNumCells();
+      const int threads = std::min<int>(propagation_threads_, outer);
+      if (threads <= 1)
+      {
+        computeExactTransformLines(sign == 1, axis, 0, outer);
+        continue;
+      }
+      boost::thread_group group;
+      for (int t = 0; t < threads; ++t)
+        group.create_thread(boost::bind(&PropagationDistanceField::computeExactTransformLines, this, sign == 1, axis,
+                                        outer * t / threads, outer * (t + 1) / threads));
+      group.join_all();
+    }
+}
+
+void PropagationDistanceField::applyExactTransform(bool negative)
+{
+  int PropDistanceFieldVoxel::*distance =
+      negative ? &PropDistanceFieldVoxel::negative_distance_square_ : &PropDistanceFieldVoxel::distance_square_;
+  Eigen::Vector3i PropDistanceFieldVoxel::*closest =
+      negative ? &PropDistanceFieldVoxel::closest_negative_point_ : &PropDistanceFieldVoxel::closest_point_;
+
+  // the sites are the obstacle voxels, or the free voxels for negative distances
+  const int x_num = getXNumCells(), y_num = getYNumCells(), z_num = getZNumCells();
+  std::vector<unsigned char> sites(static_cast<std::size_t>(x_num) * y_num * z_num);
+  std::size_t index = 0;
+  for (int x = 0; x < x_num; ++x)
+    for (int y = 0; y < y_num; ++y)
+      for (int z = 0; z < z_num; ++z, ++index)
+        sites[index] = (voxel_grid_->getCell(x, y, z).distance_square_ == 0) != negative;
+
+  std::vector<int> distance_sq, closest_site;
+  exact_transform_->compute(sites, x_num, y_num, z_num, distance_sq, closest_site);
+
+  // leave voxels out of range as the incremental propagation would
+  index = 0;
+  for (int x = 0; x < x_num; ++x)
+    for (int y = 0; y < y_num; ++y)
+      for (int z = 0; z < z_num; ++z, ++index)
+      {
+        PropDistanceFieldVoxel& voxel = voxel_grid_->getCell(x, y, z);
+        if (closest_site[index] < 0 || distance_sq[index] > max_distance_sq_)
+        {
+          voxel.*distance = max_distance_sq_;
+          (voxel.*closest).x() = PropDistanceFieldVoxel::UNINITIALIZED;
+          (voxel.*closest).y() = PropDistanceFieldVoxel::UNINITIALIZED;
+          (voxel.*closest).z() = PropDistanceFieldVoxel::UNINITIALIZED;
+          continue;
+        }
+        const int site = closest_site[index];
+        voxel.*distance = distance_sq[index];
+        voxel.*closest = Eigen::Vector3i(site / (y_num * z_num), (site / z_num) % y_num, site % z_num);
+      }
+}
+
+void PropagationDistanceField::computeExactTransformLines(bool negative, int axis, int begin, int end)
+{
+  int PropDistanceFieldVoxel::*distance =
+      negative ? &PropDistanceFieldVoxel::negative_distance_square_ : &PropDistanceFieldVoxel::distance_square_;
+  Eigen::Vector3i PropDistanceFieldVoxel::*closest =
+      negative ? &PropDistanceFieldVoxel::closest_negative_point_ : &PropDistanceFieldVoxel::closest_point_;
+
+  // lines along x and y are grouped by z, lines along z by x
+  const int n = axis == 0 ? getXNumCells() : (axis == 1 ? getYNumCells() : getZNumCells());
+  const int inner = axis == 1 ? getXNumCells() : getYNumCells();
+  std::vector<int> f(n), d(n), arg(n), v(n);
+  std::vector<double> z(n + 1);
+  std::vector<Eigen::Vector3i> points(n);
+
+  for (int o = begin; o < end; ++o)
+    for (int i = 0; i < inner; ++i)
+    {
+      for (int q = 0; q < n; ++q)
+      {
+        const Eigen::Vector3i loc = axis == 0 ? Eigen::Vector3i(q, i, o) :
+                                                (axis == 1 ? Eigen::Vector3i(i, q, o) : Eigen::Vector3i(o, i, q));
+        const PropDistanceFieldVoxel& voxel = voxel_grid_->getCell(loc.x(), loc.y(), loc.z());
+        if (axis == 0)
+        {
+          // the sites are the obstacle voxels, or the free voxels for negative distances
+          f[q] = ((voxel.distance_square_ == 0) != negative) ? 0 : DistanceTransform::NO_SITE;
+          points[q] = loc;
+        }
+        else
+        {
+          // continue from the closest points found by the previous pass
+          f[q] = voxel.*distance;
+          points[q] = voxel.*closest;
+        }
+      }
+
+      DistanceTransform::transformLine(&f[0], n, &d[0], &arg[0], &v[0], &z[0]);
+
+      for (int q = 0; q < n; ++q)
+      {
+        const Eigen::Vector3i loc = axis == 0 ? Eigen::Vector3i(q, i, o) :
+                                                (axis == 1 ? Eigen::Vector3i(i, q, o) : Eigen::Vector3i(o, i, q));
+        PropDistanceFieldVoxel& voxel = voxel_grid_->getCell(loc.x(), loc.y(), loc.z());
+        voxel.*distance = d[q];
+        if (arg[q] >= 0)
+        {
+          voxel.*closest = points[arg[q]];
+          (voxel.*closest)[axis] = arg[q];
+        }
+
+        // after the last pass, leave voxels out of range as the incremental propagation would
+        if (axis == 2 && d[q] > max_distance_sq_)
+        {
+          voxel.*distance = max_distance_sq_;
+          (voxel.*closest).x() = PropDistanceFieldVoxel::UNINITIALIZED;
+          (voxel.*closest).y() = PropDistanceFieldVoxel::UNINITIALIZED;
+          (voxel.*closest).z() = PropDistanceFieldVoxel::UNINITIALIZED;
+        }
+      }
+    }
+}
+
 void PropagationDistanceField::propagatePositive()
 {
   // now process the queue:
@@ -518,6 +704,9 @@ void PropagationDistanceField::propagateNegative()
 void PropagationDistanceField::reset()
 {
   voxel_grid_->reset(PropDistanceFieldVoxel(max_distance_sq_, 0));
+  // the closest unoccupied voxels are only used by the negative propagation; leave sparse storage unallocated
+  if (voxel_grid_->isSparse() && !propagate_negative_)
+    return;
   for (int x = 0; x < getXNumCells(); x++)
   {
     for (int y = 0; y < getYNumCells(); y++)
@@ -535,6 +724,16 @@ void PropagationDistanceField::reset()
   // object_voxel_locations_.clear();
 }
 
+void PropagationDistanceField::setSparseStorage(bool sparse)
+{
+  if (sparse == sparse_storage_)
+    return;
+  sparse_storage_ = sparse;
+  voxel_grid_->resize(size_x_, size_y_, size_z_, resolution_, origin_x_, origin_y_, origin_z_,
+                      PropDistanceFieldVoxel(max_distance_sq_, 0), sparse_storage_);
+  reset();
+}
+
 void PropagationDistanceField::initNeighborhoods()
 {
   // first initialize the direction number mapping:
@@ -608,9 +807,17 @@ double PropagationDistanceField::getDistance(double x, double y, double z) const
   return getDistance((*voxel_grid_.get())(x, y, z));
 }
 
+void PropagationDistanceField::getCellDistances(const Eigen::Vector3i* cells, std::size_t count,
+                                                double* distances) const
+{
+  const VoxelGrid<PropDistanceFieldVoxel>& grid = getVoxelGrid();
+  for (std::size_t i = 0; i < count; ++i)
+    distances[i] = PropagationDistanceField::getDistance(grid.getCell(cells[i]));
+}
+
 double PropagationDistanceField::getDistance(int x, int y, int z) const
 {
-  return getDistance(voxel_grid_->getCell(x, y, z));
+  return getDistance(getVoxelGrid().getCell(x, y, z));
 }
 
 bool PropagationDistanceField::isCellValid(int x, int y, int z) const
@@ -42,8 +42,10 @@
 #include <geometric_shapes/body_operations.h>
 #include <eigen_conversions/eigen_msg.h>
 #include <octomap/octomap.h>
+#include <random_numbers/random_numbers.h>
 #include <ros/console.h>
 
+#include <algorithm>
 #include <memory>
 
 using namespace distance_field;
@@ -651,6 +653,63 @@ TEST(TestSignedPropagationDistanceField, TestShape)
   ASSERT_TRUE(areDistanceFieldsDistancesEqual(df, test_df));
 }
 
+// tests every sample of the bounding sphere, as findInternalPointsConvex() used to
+static void findInternalPointsBruteForce(const bodies::Body& body, double res, EigenSTL::vector_Vector3d& points)
+{
+  bodies::BoundingSphere sphere;
+  body.computeBoundingSphere(sphere);
+  Eigen::Vector3d start, end;
+  for (int i = 0; i < 3; ++i)
+  {
+    start[i] = std::floor((sphere.center[i] - sphere.radius - res) / res) * res;
+    end[i] = sphere.center[i] + sphere.radius + res;
+  }
+  Eigen::Vector3d pt;
+  for (pt.x() = start.x(); pt.x() <= end.x(); pt.x() += res)
+    for (pt.y() = start.y(); pt.y() <= end.y(); pt.y() += res)
+      for (pt.z() = start.z(); pt.z() <= end.z(); pt.z() += res)
+        if (body.containsPoint(pt))
+          points.push_back(pt);
+}
+
+TEST(TestFindInternalPoints, TestScanline)
+{
+  shapes::Sphere sphere(0.3);
+  shapes::Box box(0.4, 0.2, 0.6);
+  shapes::Cylinder cylinder(0.15, 0.5);
+  std::vector<const shapes::Shape*> shapes = { &sphere, &box, &cylinder };
+  Eigen::Affine3d pose = Eigen::Translation3d(0.43, -0.21, 0.77) *
+                         Eigen::Quaterniond(Eigen::AngleAxisd(0.6, Eigen::Vector3d(1.0, 2.0, 0.5).normalized()));
+
+  for (std::size_t i = 0; i < shapes.size(); ++i)
+  {
+    std::unique_ptr<bodies::Body> body(bodies::createBodyFromShape(shapes[i]));
+    body->setPose(pose);
+    EigenSTL::vector_Vector3d expected;
+    findInternalPointsBruteForce(*body, 0.02, expected);
+    ASSERT_FALSE(expected.empty());
+
+    for (unsigned int threads = 1; threads <= 4; threads += 3)
+    {
+      EigenSTL::vector_Vector3d points;
+      findInternalPointsConvex(*body, 0.02, points, threads);
+      ASSERT_EQ(expected.size(), points.size());
+      for (std::size_t j = 0; j < points.size(); ++j)
+        EXPECT_TRUE(expected[j].isApprox(points[j], 1e-9));
+    }
+  }
+
+  // shape rasterization in the field agrees whatever the thread count
+  PropagationDistanceField serial_df(width, height, depth, resolution, origin_x, origin_y, origin_z, max_dist);
+  PropagationDistanceField parallel_df(width, height, depth, resolution, origin_x, origin_y, origin_z, max_dist);
+  serial_df.setShapeRasterizationThreads(1);
+  parallel_df.setShapeRasterizationThreads(4);
+  Eigen::Affine3d field_pose = Eigen::Translation3d(0.5, 0.5, 0.5) * Eigen::Quaterniond::Identity();
+  serial_df.addShapeToField(&box, field_pose);
+  parallel_df.addShapeToField(&box, field_pose);
+  EXPECT_TRUE(areDistanceFieldsDistancesEqual(serial_df, parallel_df));
+}
+
 static const double PERF_WIDTH = 3.0;
 static const double PERF_HEIGHT = 3.0;
 static const double PERF_DEPTH = 4.0;
@@ -787,6 +846,182 @@ TEST(TestSignedPropagationDistanceField, TestPerformance)
          wd.toSec() / (bad_vec.size() * 1.0));
 }
 
+// compares every cell against a brute force computation over the obstacle voxels; the closest points must be obstacles
+void check_exact_distance_field(const PropagationDistanceField& df)
+{
+  std::vector<Eigen::Vector3i> obstacles, free_cells;
+  for (int x = 0; x < df.getXNumCells(); x++)
+    for (int y = 0; y < df.getYNumCells(); y++)
+      for (int z = 0; z < df.getZNumCells(); z++)
+        if (df.getCell(x, y, z).distance_square_ == 0)
+          obstacles.push_back(Eigen::Vector3i(x, y, z));
+        else
+          free_cells.push_back(Eigen::Vector3i(x, y, z));
+
+  int max_sq = df.getMaximumDistanceSquared();
+  for (int x = 0; x < df.getXNumCells(); x++)
+    for (int y = 0; y < df.getYNumCells(); y++)
+      for (int z = 0; z < df.getZNumCells(); z++)
+      {
+        const PropDistanceFieldVoxel& voxel = df.getCell(x, y, z);
+        const std::vector<Eigen::Vector3i>& sites = voxel.distance_square_ == 0 ? free_cells : obstacles;
+        int best = max_sq;
+        for (std::size_t i = 0; i < sites.size(); ++i)
+          best = std::min(best, dist_sq(sites[i].x() - x, sites[i].y() - y, sites[i].z() - z));
+        if (voxel.distance_square_ != 0)
+        {
+          ASSERT_EQ(voxel.distance_square_, best) << x << " " << y << " " << z;
+          if (best < max_sq)
+            ASSERT_EQ(df.getCell(voxel.closest_point_.x(), voxel.closest_point_.y(), voxel.closest_point_.z())
+                          .distance_square_,
+                      0);
+        }
+        else
+          ASSERT_EQ(voxel.negative_distance_square_, best) << x << " " << y << " " << z;
+      }
+}
+
+TEST(TestSignedPropagationDistanceField, TestParallelPropagation)
+{
+  PropagationDistanceField df(width, height, depth, resolution / 2.0, origin_x, origin_y, origin_z, max_dist, true);
+  df.setPropagationThreads(4);
+  EXPECT_EQ(df.getPropagationThreads(), 4u);
+
+  random_numbers::RandomNumberGenerator rng(42);
+  EigenSTL::vector_Vector3d points;
+  for (unsigned int i = 0; i < 60; i++)
+    points.push_back(Eigen::Vector3d(rng.uniformReal(0.0, width), rng.uniformReal(0.0, height),
+                                     rng.uniformReal(0.0, depth)));
+  df.addPointsToField(points);
+  check_exact_distance_field(df);
+
+  // large removals recompute the field as well
+  EigenSTL::vector_Vector3d removed(points.begin(), points.begin() + 40);
+  df.removePointsFromField(removed);
+  check_exact_distance_field(df);
+}
+
+TEST(TestSignedPropagationDistanceField, TestExternalTransform)
+{
+  // an external transform takes over large updates even with a single propagation thread
+  PropagationDistanceField df(width, height, depth, resolution / 2.0, origin_x, origin_y, origin_z, max_dist, true);
+  DistanceTransformConstPtr transform(new SeparableDistanceTransform(2));
+  df.setExactTransform(transform);
+  EXPECT_EQ(df.getExactTransform(), transform);
+  EXPECT_EQ(df.getPropagationThreads(), 1u);
+
+  random_numbers::RandomNumberGenerator rng(7);
+  EigenSTL::vector_Vector3d points;
+  for (unsigned int i = 0; i < 60; i++)
+    points.push_back(Eigen::Vector3d(rng.uniformReal(0.0, width), rng.uniformReal(0.0, height),
+                                     rng.uniformReal(0.0, depth)));
+  df.addPointsToField(points);
+  check_exact_distance_field(df);
+
+  // the field matches the one built by the incremental propagation
+  PropagationDistanceField reference(width, height, depth, resolution / 2.0, origin_x, origin_y, origin_z, max_dist,
+                                     true);
+  reference.addPointsToField(points);
+  for (int x = 0; x < df.getXNumCells(); x++)
+    for (int y = 0; y < df.getYNumCells(); y++)
+      for (int z = 0; z < df.getZNumCells(); z++)
+      {
+        ASSERT_EQ(reference.getCell(x, y, z).distance_square_, df.getCell(x, y, z).distance_square_);
+        ASSERT_EQ(reference.getCell(x, y, z).negative_distance_square_, df.getCell(x, y, z).negative_distance_square_);
+      }
+
+  EigenSTL::vector_Vector3d removed(points.begin(), points.begin() + 40);
+  df.removePointsFromField(removed);
+  check_exact_distance_field(df);
+}
+
+TEST(TestPropagationDistanceField, TestBatchLookup)
+{
+  PropagationDistanceField df(width, height, depth, resolution, origin_x, origin_y, origin_z, max_dist);
+  EigenSTL::vector_Vector3d obstacles;
+  obstacles.push_back(point1);
+  obstacles.push_back(point3);
+  df.addPointsToField(obstacles);
+
+  random_numbers::RandomNumberGenerator rng(7);
+  EigenSTL::vector_Vector3d points;
+  for (unsigned int i = 0; i < 500; i++)
+    points.push_back(Eigen::Vector3d(rng.uniformReal(-0.2, width + 0.2), rng.uniformReal(-0.2, height + 0.2),
+                                     rng.uniformReal(-0.2, depth + 0.2)));
+
+  // without interpolation, the batch gives the results of the single lookups
+  std::vector<double> distances;
+  EigenSTL::vector_Vector3d gradients;
+  std::vector<bool> in_bounds;
+  df.getDistanceGradients(points, distances, gradients, in_bounds);
+  ASSERT_EQ(points.size(), distances.size());
+  for (std::size_t i = 0; i < points.size(); ++i)
+  {
+    Eigen::Vector3d grad;
+    bool inb;
+    const Eigen::Vector3d& p = points[i];
+    double dist = df.getDistanceGradient(p.x(), p.y(), p.z(), grad.x(), grad.y(), grad.z(), inb);
+    EXPECT_EQ(inb, in_bounds[i]);
+    EXPECT_NEAR(dist, distances[i], 1e-9);
+    EXPECT_NEAR(0.0, (grad - gradients[i]).norm(), 1e-9);
+  }
+
+  // with interpolation, cell centers keep their distance, and the gradient matches finite differences
+  double wx, wy, wz;
+  df.gridToWorld(3, 4, 2, wx, wy, wz);
+  EigenSTL::vector_Vector3d query(1, Eigen::Vector3d(wx, wy, wz));
+  query.push_back(Eigen::Vector3d(wx + 0.5 * resolution, wy, wz));
+  df.getDistanceGradients(query, distances, gradients, in_bounds, true);
+  ASSERT_TRUE(in_bounds[0]);
+  EXPECT_NEAR(df.getDistance(3, 4, 2), distances[0], 1e-9);
+  EXPECT_NEAR(0.5 * (df.getDistance(3, 4, 2) + df.getDistance(4, 4, 2)), distances[1], 1e-9);
+
+  const double h = 1e-5;
+  for (std::size_t i = 0; i < points.size(); ++i)
+  {
+    EigenSTL::vector_Vector3d probe(1, points[i]);
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      probe.push_back(points[i] + h * Eigen::Vector3d::Unit(axis));
+      probe.push_back(points[i] - h * Eigen::Vector3d::Unit(axis));
+    }
+    df.getDistanceGradients(probe, distances, gradients, in_bounds, true);
+    if (!in_bounds[0] || std::find(in_bounds.begin(), in_bounds.end(), false) != in_bounds.end())
+      continue;
+    for (int axis = 0; axis < 3; ++axis)
+      EXPECT_NEAR((distances[1 + 2 * axis] - distances[2 + 2 * axis]) / (2 * h), gradients[0][axis], 1e-3);
+  }
+}
+
+TEST(TestPropagationDistanceField, TestSparseStorage)
+{
+  // a few points in one corner of a large grid, so that most blocks stay unallocated
+  PropagationDistanceField dense(4.0, 4.0, 2.0, resolution, origin_x, origin_y, origin_z, max_dist);
+  PropagationDistanceField sparse(4.0, 4.0, 2.0, resolution, origin_x, origin_y, origin_z, max_dist);
+  sparse.setSparseStorage(true);
+  EXPECT_TRUE(sparse.getSparseStorage());
+  EXPECT_EQ(0u, sparse.getAllocatedCellCount());
+
+  EigenSTL::vector_Vector3d points;
+  points.push_back(point1);
+  points.push_back(point2);
+  points.push_back(point3);
+  dense.addPointsToField(points);
+  sparse.addPointsToField(points);
+  check_exact_distance_field(sparse);
+
+  for (int x = 0; x < dense.getXNumCells(); x++)
+    for (int y = 0; y < dense.getYNumCells(); y++)
+      for (int z = 0; z < dense.getZNumCells(); z++)
+        ASSERT_EQ(dense.getCell(x, y, z).distance_square_, sparse.getCell(x, y, z).distance_square_);
+  EXPECT_LT(sparse.getAllocatedCellCount() * 10, dense.getAllocatedCellCount());
+
+  sparse.removePointsFromField(points);
+  EXPECT_EQ(max_dist_sq_in_voxels, sparse.getCell(1, 0, 0).distance_square_);
+  sparse.reset();
+  EXPECT_EQ(0u, sparse.getAllocatedCellCount());
+}
+
 TEST(TestSignedPropagationDistanceField, TestOcTree)
 {
   PropagationDistanceField df(PERF_WIDTH, PERF_HEIGHT, PERF_DEPTH, PERF_RESOLUTION, PERF_ORIGIN_X, PERF_ORIGIN_Y,
@@ -95,6 +95,48 @@ TEST(TestVoxelGrid, TestReadWrite)
       }
 }
 
+TEST(TestVoxelGrid, TestSparse)
+{
+  VoxelGrid<int> vg(12.5, 6.25, 3.125, 0.125, 0, 0, 0, -100, true);
+  EXPECT_TRUE(vg.isSparse());
+  EXPECT_EQ(100, vg.getNumCells(DIM_X));
+  EXPECT_EQ(50, vg.getNumCells(DIM_Y));
+  EXPECT_EQ(25, vg.getNumCells(DIM_Z));
+  vg.reset(7);
+  EXPECT_EQ(0u, vg.getAllocatedCellCount());
+
+  // reads of a const grid do not allocate
+  const VoxelGrid<int>& cvg = vg;
+  EXPECT_EQ(7, cvg.getCell(99, 49, 24));
+  EXPECT_EQ(0u, vg.getAllocatedCellCount());
+
+  // writes allocate one block, and the rest of the block keeps the reset value
+  vg.setCell(99, 49, 24, 3);
+  vg.getCell(96, 48, 24) = 4;
+  EXPECT_EQ(512u, vg.getAllocatedCellCount());
+  EXPECT_EQ(3, cvg.getCell(99, 49, 24));
+  EXPECT_EQ(4, cvg.getCell(96, 48, 24));
+  EXPECT_EQ(7, cvg.getCell(97, 48, 24));
+  EXPECT_EQ(7, cvg.getCell(0, 0, 0));
+
+  // world queries see the same cells
+  int x, y, z;
+  EXPECT_TRUE(vg.worldToGrid(12.375, 6.125, 3.0, x, y, z));
+  EXPECT_EQ(99, x);
+  EXPECT_EQ(49, y);
+  EXPECT_EQ(24, z);
+  EXPECT_EQ(3, vg(12.375, 6.125, 3.0));
+  EXPECT_EQ(-100, vg(20.0, 0.0, 0.0));
+
+  vg.reset(1);
+  EXPECT_EQ(0u, vg.getAllocatedCellCount());
+  EXPECT_EQ(1, cvg.getCell(99, 49, 24));
+
+  vg.allocateAllCells();
+  EXPECT_EQ(13u * 7u * 4u * 512u, vg.getAllocatedCellCount());
+  EXPECT_EQ(1, cvg.getCell(50, 25, 12));
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -42,9 +42,11 @@
 #include <kdl/chainidsolver_recursive_newton_euler.hpp>
 
 #include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
 #include <geometry_msgs/Vector3.h>
 #include <geometry_msgs/Wrench.h>
 
+#include <boost/function.hpp>
 #include <memory>
 
 /** \brief This namespace includes the dynamics_solver library */
@@ -115,6 +117,42 @@ public:
   bool getPayloadTorques(const std::vector<double>& joint_angles, double payload,
                          std::vector<double>& joint_torques) const;
 
+  /**
+   * @brief Get the torques required to follow a trajectory, for all of its waypoints at once.
+   * Waypoint velocities and accelerations are used when set (zero otherwise) and the payload
+   * is attached to the origin of the last link of this group, as in getPayloadTorques()
+   * @param trajectory The trajectory to evaluate; its robot model must match the one of this solver
+   * @param payload The payload for which to compute torques (in kg)
+   * @param torques The resulting joint torques, one vector per waypoint; existing storage is reused
+   * @param threads The number of threads to evaluate waypoints with (0 uses all hardware threads)
+   * @return False if the trajectory does not match this solver or the torques could not be computed
+   */
+  bool getTrajectoryTorques(const robot_trajectory::RobotTrajectory& trajectory, double payload,
+                            std::vector<std::vector<double> >& torques, unsigned int threads = 1) const;
+
+  /**
+   * @brief Get the torques required to hold every waypoint of a trajectory at rest with the given payload,
+   * i.e., the torques due to gravity only; waypoint velocities and accelerations are ignored
+   * @param trajectory The trajectory to evaluate; its robot model must match the one of this solver
+   * @param payload The payload for which to compute torques (in kg)
+   * @param torques The resulting joint torques, one vector per waypoint; existing storage is reused
+   * @param threads The number of threads to evaluate waypoints with (0 uses all hardware threads)
+   * @return False if the trajectory does not match this solver or the torques could not be computed
+   */
+  bool getTrajectoryStaticTorques(const robot_trajectory::RobotTrajectory& trajectory, double payload,
+                                  std::vector<std::vector<double> >& torques, unsigned int threads = 1) const;
+
+  /**
+   * @brief Get the maximum payload (in kg) for every waypoint of a trajectory, as computed by getMaxPayload()
+   * @param trajectory The trajectory to evaluate; its robot model must match the one of this solver
+   * @param payloads The computed maximum payload for each waypoint
+   * @param joint_saturated The first saturated joint for each waypoint
+   * @param threads The number of threads to evaluate waypoints with (0 uses all hardware threads)
+   * @return False if the trajectory does not match this solver or the payloads could not be computed
+   */
+  bool getTrajectoryMaxPayload(const robot_trajectory::RobotTrajectory& trajectory, std::vector<double>& payloads,
+                               std::vector<unsigned int>& joint_saturated, unsigned int threads = 1) const;
+
   /**
    * @brief Get maximum torques for this group
    * @return Vector of max torques
@@ -136,6 +174,19 @@ public:
   }
 
 private:
+  struct Workspace;
+  typedef boost::function<bool(Workspace&, std::size_t)> WaypointFn;
+
+  bool computeWaypointTorques(Workspace& ws, const robot_state::RobotState& waypoint, bool use_motion,
+                              double payload_force, double* torques) const;
+  bool computeWaypointMaxPayload(Workspace& ws, const robot_state::RobotState& waypoint, double& payload,
+                                 unsigned int& joint_saturated) const;
+  bool computeTrajectoryTorques(const robot_trajectory::RobotTrajectory& trajectory, bool use_motion, double payload,
+                                std::vector<std::vector<double> >& torques, unsigned int threads) const;
+  bool forEachWaypoint(const robot_trajectory::RobotTrajectory& trajectory, unsigned int threads,
+                       const WaypointFn& fn) const;
+  void processWaypoints(const WaypointFn& fn, std::size_t begin, std::size_t end, bool* result) const;
+
   std::shared_ptr<KDL::ChainIdSolver_RNE> chain_id_solver_;  // KDL chain inverse dynamics
   KDL::Chain kdl_chain_;                                     // KDL chain
 
@@ -148,7 +199,8 @@ private:
   unsigned int num_joints_, num_segments_;  // number of joints in group, number of segments in group
   std::vector<double> max_torques_;         // vector of max torques
 
-  double gravity_;  // Norm of the gravity vector passed in initialize()
+  double gravity_;              // Norm of the gravity vector passed in initialize()
+  KDL::Vector gravity_vector_;  // Gravity vector passed in initialize()
 };
 }
 #endif
@@ -35,6 +35,7 @@
 /* Author: Sachin Chitta */
 
 #include <moveit/dynamics_solver/dynamics_solver.h>
+#include <moveit/background_processing/thread_budget.h>
 
 // KDL
 #include <kdl/jntarray.hpp>
@@ -45,6 +46,11 @@
 #include <kdl/chainjnttojacsolver.hpp>
 #include <kdl/tree.hpp>
 
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <algorithm>
+#include <memory>
+
 namespace dynamics_solver
 {
 namespace
@@ -136,6 +142,7 @@ DynamicsSolver::DynamicsSolver(const robot_model::RobotModelConstPtr& robot_mode
   KDL::Vector gravity(gravity_vector.x, gravity_vector.y,
                       gravity_vector.z);  // \todo Not sure if KDL expects the negative of this (Sachin)
   gravity_ = gravity.Norm();
+  gravity_vector_ = gravity;
   ROS_DEBUG_NAMED("dynamics_solver", "Gravity norm set to %f", gravity_);
 
   chain_id_solver_.reset(new KDL::ChainIdSolver_RNE(kdl_chain_, gravity));
@@ -312,6 +319,188 @@ bool DynamicsSolver::getPayloadTorques(const std::vector<double>& joint_angles,
   return getTorques(joint_angles, joint_velocities, joint_accelerations, wrenches, joint_torques);
 }
 
+/** \brief Per-thread scratch data for evaluating waypoints without allocating memory for each of them */
+struct DynamicsSolver::Workspace
+{
+  Workspace(const DynamicsSolver& solver)
+    : id_solver_(solver.kdl_chain_, solver.gravity_vector_)
+    , q_(solver.num_joints_)
+    , qdot_(solver.num_joints_)
+    , qdotdot_(solver.num_joints_)
+    , torques_(solver.num_joints_)
+    , wrenches_(solver.num_segments_)
+    , zero_torques_(solver.num_joints_)
+    , unit_torques_(solver.num_joints_)
+    , state_(*solver.state_)
+  {
+  }
+
+  KDL::ChainIdSolver_RNE id_solver_;  // the KDL solver keeps internal state, so each thread needs its own
+  KDL::JntArray q_, qdot_, qdotdot_, torques_;
+  KDL::Wrenches wrenches_;
+  std::vector<double> zero_torques_, unit_torques_;
+  robot_state::RobotState state_;  // used to compute the payload direction in the frame of the tip link
+};
+
+bool DynamicsSolver::computeWaypointTorques(Workspace& ws, const robot_state::RobotState& waypoint, bool use_motion,
+                                            double payload_force, double* torques) const
+{
+  waypoint.copyJointGroupPositions(joint_model_group_, ws.q_.data.data());
+  if (use_motion && waypoint.hasVelocities())
+    waypoint.copyJointGroupVelocities(joint_model_group_, ws.qdot_.data.data());
+  else
+    ws.qdot_.data.setZero();
+  if (use_motion && waypoint.hasAccelerations())
+    waypoint.copyJointGroupAccelerations(joint_model_group_, ws.qdotdot_.data.data());
+  else
+    ws.qdotdot_.data.setZero();
+
+  std::fill(ws.wrenches_.begin(), ws.wrenches_.end(), KDL::Wrench::Zero());
+  if (payload_force != 0.0)
+  {
+    ws.state_.setJointGroupPositions(joint_model_group_, ws.q_.data.data());
+    const Eigen::Affine3d& base_frame = ws.state_.getFrameTransform(base_name_);
+    const Eigen::Affine3d& tip_frame = ws.state_.getFrameTransform(tip_name_);
+    const Eigen::Vector3d force =
+        (tip_frame.inverse() * base_frame).rotation() * Eigen::Vector3d(0.0, 0.0, payload_force);
+    ws.wrenches_.back().force = KDL::Vector(force.x(), force.y(), force.z());
+  }
+
+  if (ws.id_solver_.CartToJnt(ws.q_, ws.qdot_, ws.qdotdot_, ws.wrenches_, ws.torques_) < 0)
+  {
+    ROS_ERROR_NAMED("dynamics_solver", "Something went wrong computing torques");
+    return false;
+  }
+
+  for (unsigned int i = 0; i < num_joints_; ++i)
+    torques[i] = ws.torques_(i);
+  return true;
+}
+
+bool DynamicsSolver::computeWaypointMaxPayload(Workspace& ws, const robot_state::RobotState& waypoint,
+                                               double& payload, unsigned int& joint_saturated) const
+{
+  if (!computeWaypointTorques(ws, waypoint, false, 0.0, &ws.zero_torques_[0]))
+    return false;
+
+  for (unsigned int i = 0; i < num_joints_; ++i)
+    if (fabs(ws.zero_torques_[i]) >= max_torques_[i])
+    {
+      payload = 0.0;
+      joint_saturated = i;
+      return true;
+    }
+
+  if (!computeWaypointTorques(ws, waypoint, false, 1.0, &ws.unit_torques_[0]))
+    return false;
+
+  double min_payload = std::numeric_limits<double>::max();
+  for (unsigned int i = 0; i < num_joints_; ++i)
+  {
+    const double delta = ws.unit_torques_[i] - ws.zero_torques_[i];
+    const double payload_joint = std::max<double>((max_torques_[i] - ws.zero_torques_[i]) / delta,
+                                                  (-max_torques_[i] - ws.zero_torques_[i]) / delta);
+    if (payload_joint < min_payload)
+    {
+      min_payload = payload_joint;
+      joint_saturated = i;
+    }
+  }
+  payload = min_payload / gravity_;
+  return true;
+}
+
+void DynamicsSolver::processWaypoints(const WaypointFn& fn, std::size_t begin, std::size_t end, bool* result) const
+{
+  Workspace ws(*this);
+  for (std::size_t i = begin; i < end; ++i)
+    if (!fn(ws, i))
+    {
+      *result = false;
+      return;
+    }
+  *result = true;
+}
+
+bool DynamicsSolver::forEachWaypoint(const robot_trajectory::RobotTrajectory& trajectory, unsigned int threads,
+                                     const WaypointFn& fn) const
+{
+  if (!joint_model_group_)
+  {
+    ROS_DEBUG_NAMED("dynamics_solver", "Did not construct DynamicsSolver object properly. "
+                                       "Check error logs.");
+    return false;
+  }
+  if (trajectory.getRobotModel()->getName() != robot_model_->getName() ||
+      trajectory.getRobotModel()->getVariableCount() != robot_model_->getVariableCount())
+  {
+    ROS_ERROR_NAMED("dynamics_solver", "Trajectory is for robot '%s' but the dynamics solver is for robot '%s'",
+                    trajectory.getRobotModel()->getName().c_str(), robot_model_->getName().c_str());
+    return false;
+  }
+
+  const std::size_t count = trajectory.getWayPointCount();
+  if (threads == 0)
+    threads = moveit::tools::ThreadBudget::getConcurrency();
+  threads = std::min<std::size_t>(threads, std::max<std::size_t>(count, 1));
+  moveit::tools::ThreadBudget::Reservation reservation("dynamics", threads);
+  threads = reservation.getThreads();
+
+  if (threads == 1)
+  {
+    bool result;
+    processWaypoints(fn, 0, count, &result);
+    return result;
+  }
+
+  // each thread evaluates a contiguous block of waypoints with its own workspace
+  std::unique_ptr<bool[]> results(new bool[threads]);
+  boost::thread_group workers;
+  for (unsigned int t = 0; t < threads; ++t)
+    workers.create_thread(boost::bind(&DynamicsSolver::processWaypoints, this, boost::cref(fn), t * count / threads,
+                                      (t + 1) * count / threads, &results[t]));
+  workers.join_all();
+  return std::find(results.get(), results.get() + threads, false) == results.get() + threads;
+}
+
+bool DynamicsSolver::computeTrajectoryTorques(const robot_trajectory::RobotTrajectory& trajectory, bool use_motion,
+                                              double payload, std::vector<std::vector<double> >& torques,
+                                              unsigned int threads) const
+{
+  torques.resize(trajectory.getWayPointCount());
+  for (std::size_t i = 0; i < torques.size(); ++i)
+    torques[i].resize(num_joints_);
+
+  const double payload_force = payload * gravity_;
+  return forEachWaypoint(trajectory, threads, [&](Workspace& ws, std::size_t i) {
+    return computeWaypointTorques(ws, trajectory.getWayPoint(i), use_motion, payload_force, &torques[i][0]);
+  });
+}
+
+bool DynamicsSolver::getTrajectoryTorques(const robot_trajectory::RobotTrajectory& trajectory, double payload,
+                                          std::vector<std::vector<double> >& torques, unsigned int threads) const
+{
+  return computeTrajectoryTorques(trajectory, true, payload, torques, threads);
+}
+
+bool DynamicsSolver::getTrajectoryStaticTorques(const robot_trajectory::RobotTrajectory& trajectory, double payload,
+                                                std::vector<std::vector<double> >& torques, unsigned int threads) const
+{
+  return computeTrajectoryTorques(trajectory, false, payload, torques, threads);
+}
+
+bool DynamicsSolver::getTrajectoryMaxPayload(const robot_trajectory::RobotTrajectory& trajectory,
+                                             std::vector<double>& payloads, std::vector<unsigned int>& joint_saturated,
+                                             unsigned int threads) const
+{
+  payloads.resize(trajectory.getWayPointCount());
+  joint_saturated.resize(trajectory.getWayPointCount());
+
+  return forEachWaypoint(trajectory, threads, [&](Workspace& ws, std::size_t i) {
+    return computeWaypointMaxPayload(ws, trajectory.getWayPoint(i), payloads[i], joint_saturated[i]);
+  });
+}
+
 const std::vector<double>& DynamicsSolver::getMaxTorques() const
 {
   return max_torques_;
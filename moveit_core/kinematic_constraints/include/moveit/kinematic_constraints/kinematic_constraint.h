@@ -46,7 +46,9 @@
 #include <geometric_shapes/bodies.h>
 #include <moveit_msgs/Constraints.h>
 
+#include <boost/thread/tss.hpp>
 #include <iostream>
+#include <memory>
 #include <vector>
 
 /** \brief Representation and evaluation of kinematic constraints */
@@ -832,8 +834,23 @@ protected:
    */
   bool decideContact(const collision_detection::Contact& contact) const;
 
+  /** \brief The collision world holding the visibility cone, kept by one thread between evaluations */
+  struct ConeCache
+  {
+    /** \brief The value of cache_id_ the world was built for */
+    std::size_t cache_id_;
+
+    /** \brief The cone currently in the world */
+    shapes::ShapeConstPtr cone_;
+
+    collision_detection::CollisionWorldPtr world_;
+    collision_detection::AllowedCollisionMatrix acm_;
+  };
+
   collision_detection::CollisionRobotPtr collision_robot_; /**< \brief A copy of the collision robot maintained for
                                                               collision checking the cone against robot links */
+  std::size_t cache_id_; /**< \brief Changes whenever the cone worlds cached by threads become invalid */
+  mutable boost::thread_specific_ptr<ConeCache> cone_cache_; /**< \brief The cone world of each thread */
   bool mobile_sensor_frame_;    /**< \brief True if the sensor is a non-fixed frame relative to the transform frame */
   bool mobile_target_frame_;    /**< \brief True if the target is a non-fixed frame relative to the transform frame */
   std::string target_frame_id_; /**< \brief The target frame id */
@@ -963,6 +980,24 @@ public:
   ConstraintEvaluationResult decide(const robot_state::RobotState& state,
                                     std::vector<ConstraintEvaluationResult>& results, bool verbose = false) const;
 
+  /**
+   * \brief Determines whether all constraints are satisfied by state,
+   * stopping at the first constraint that is not.
+   *
+   * Unlike decide(), no distance is accumulated, so constraints after
+   * a failing one need not be evaluated. The constraints are tried in
+   * an order that adapts to how often each of them rejected states so
+   * far and how long it took to evaluate, so that the cheapest likely
+   * rejection is found first. Use this when only feasibility matters,
+   * e.g. when checking path constraints while planning.
+   *
+   * @param [in] state The state to test
+   * @param [in] verbose Whether or not to make each constraint give debug output
+   *
+   * @return True if all constraints are satisfied, false otherwise
+   */
+  bool isSatisfied(const robot_state::RobotState& state, bool verbose = false) const;
+
   /**
    * \brief Whether or not another KinematicConstraintSet is equal to
    * this one.
@@ -1054,6 +1089,12 @@ public:
   }
 
 protected:
+  /** \brief Measured rejection rates and costs of the constraints, used to order them in isSatisfied() */
+  struct EvaluationStatistics;
+
+  /** \brief Start measuring the constraints anew; called whenever the set of constraints changes */
+  void resetStatistics();
+
   robot_model::RobotModelConstPtr robot_model_; /**< \brief The kinematic model used for by the Set */
   std::vector<KinematicConstraintPtr>
       kinematic_constraints_; /**<  \brief Shared pointers to all the member constraints */
@@ -1067,6 +1108,7 @@ protected:
   std::vector<moveit_msgs::VisibilityConstraint> visibility_constraints_;   /**<  \brief Messages corresponding to all
                                                                                internal visibility constraints */
   moveit_msgs::Constraints all_constraints_; /**<  \brief Messages corresponding to all internal constraints */
+  std::shared_ptr<EvaluationStatistics> statistics_; /**<  \brief Statistics for the current constraints */
 };
 }
 
@@ -43,6 +43,9 @@
 #include <boost/math/constants/constants.hpp>
 #include <eigen_conversions/eigen_msg.h>
 #include <boost/bind.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <limits>
 #include <memory>
 
@@ -645,13 +648,14 @@ void OrientationConstraint::print(std::ostream& out) const
 }
 
 VisibilityConstraint::VisibilityConstraint(const robot_model::RobotModelConstPtr& model)
-  : KinematicConstraint(model), collision_robot_(new collision_detection::CollisionRobotFCL(model))
+  : KinematicConstraint(model), collision_robot_(new collision_detection::CollisionRobotFCL(model)), cache_id_(0)
 {
   type_ = VISIBILITY_CONSTRAINT;
 }
 
 void VisibilityConstraint::clear()
 {
+  ++cache_id_;
   mobile_sensor_frame_ = false;
   mobile_target_frame_ = false;
   target_frame_id_ = "";
@@ -980,28 +984,48 @@ ConstraintEvaluationResult VisibilityConstraint::decide(const robot_state::Robot
     }
   }
 
-  shapes::Mesh* m = getVisibilityCone(state);
-  if (!m)
-    return ConstraintEvaluationResult(false, 0.0);
+  // the world holding the cone and the matrix deciding its contacts are kept between evaluations; when neither
+  // frame moves with the robot the cone itself never changes either, so its BVH is only built once per thread
+  ConeCache* cache = cone_cache_.get();
+  if (!cache)
+  {
+    cache = new ConeCache();
+    cone_cache_.reset(cache);
+    cache->cache_id_ = cache_id_ - 1;
+  }
+  if (cache->cache_id_ != cache_id_)
+  {
+    cache->world_.reset(new collision_detection::CollisionWorldFCL());
+    cache->acm_ = collision_detection::AllowedCollisionMatrix();
+    cache->acm_.setDefaultEntry("cone", boost::bind(&VisibilityConstraint::decideContact, this, _1));
+    cache->cone_.reset();
+    cache->cache_id_ = cache_id_;
+  }
 
-  // add the visibility cone as an object
-  collision_detection::CollisionWorldFCL collision_world;
-  collision_world.getWorld()->addToObject("cone", shapes::ShapeConstPtr(m), Eigen::Affine3d::Identity());
+  if (!cache->cone_ || mobile_sensor_frame_ || mobile_target_frame_)
+  {
+    shapes::Mesh* m = getVisibilityCone(state);
+    if (!m)
+      return ConstraintEvaluationResult(false, 0.0);
+
+    // add the visibility cone as an object
+    cache->cone_.reset(m);
+    cache->world_->getWorld()->removeObject("cone");
+    cache->world_->getWorld()->addToObject("cone", cache->cone_, Eigen::Affine3d::Identity());
+  }
 
   // check for collisions between the robot and the cone
   collision_detection::CollisionRequest req;
   collision_detection::CollisionResult res;
-  collision_detection::AllowedCollisionMatrix acm;
-  acm.setDefaultEntry("cone", boost::bind(&VisibilityConstraint::decideContact, this, _1));
   req.contacts = true;
   req.verbose = verbose;
   req.max_contacts = 1;
-  collision_world.checkRobotCollision(req, res, *collision_robot_, state, acm);
+  cache->world_->checkRobotCollision(req, res, *collision_robot_, state, cache->acm_);
 
   if (verbose)
   {
     std::stringstream ss;
-    m->print(ss);
+    cache->cone_->print(ss);
     ROS_INFO_NAMED("kinematic_constraints", "Visibility constraint %ssatisfied. Visibility cone approximation:\n %s",
                    res.collision ? "not " : "", ss.str().c_str());
   }
@@ -1053,6 +1077,83 @@ void KinematicConstraintSet::clear()
   position_constraints_.clear();
   orientation_constraints_.clear();
   visibility_constraints_.clear();
+  statistics_.reset();
+}
+
+struct KinematicConstraintSet::EvaluationStatistics
+{
+  EvaluationStatistics(const std::vector<KinematicConstraintPtr>& constraints)
+    : calls_(0)
+    , evaluations_(constraints.size())
+    , rejections_(constraints.size())
+    , timed_evaluations_(constraints.size())
+    , time_ns_(constraints.size())
+    , default_cost_(constraints.size())
+  {
+    std::vector<std::size_t>* order = new std::vector<std::size_t>(constraints.size());
+    for (std::size_t i = 0; i < constraints.size(); ++i)
+    {
+      (*order)[i] = i;
+      // rough relative costs, used until a constraint has been timed
+      switch (constraints[i]->getType())
+      {
+        case KinematicConstraint::JOINT_CONSTRAINT:
+          default_cost_[i] = 50.0;
+          break;
+        case KinematicConstraint::ORIENTATION_CONSTRAINT:
+          default_cost_[i] = 200.0;
+          break;
+        case KinematicConstraint::POSITION_CONSTRAINT:
+          default_cost_[i] = 400.0;
+          break;
+        default:
+          default_cost_[i] = 50000.0;
+          break;
+      }
+    }
+    // start from the cheapest constraints
+    std::stable_sort(order->begin(), order->end(),
+                     [this](std::size_t a, std::size_t b) { return default_cost_[a] < default_cost_[b]; });
+    order_.reset(order);
+  }
+
+  /** \brief Sort the constraints by decreasing probability of rejection per unit of time spent evaluating them */
+  void reorder()
+  {
+    std::vector<double> score(evaluations_.size());
+    for (std::size_t i = 0; i < score.size(); ++i)
+    {
+      const double evaluations = evaluations_[i].load(std::memory_order_relaxed);
+      const double rejections = rejections_[i].load(std::memory_order_relaxed);
+      const double timed = timed_evaluations_[i].load(std::memory_order_relaxed);
+      const double cost = timed > 0 ? std::max(1.0, time_ns_[i].load(std::memory_order_relaxed) / timed) :
+                                      default_cost_[i];
+      score[i] = (rejections + 1.0) / (evaluations + 2.0) / cost;
+    }
+    std::vector<std::size_t>* order = new std::vector<std::size_t>(*std::atomic_load(&order_));
+    std::stable_sort(order->begin(), order->end(),
+                     [&score](std::size_t a, std::size_t b) { return score[a] > score[b]; });
+    std::atomic_store(&order_, std::shared_ptr<const std::vector<std::size_t> >(order));
+  }
+
+  /** \brief Number of calls to isSatisfied() */
+  std::atomic<unsigned int> calls_;
+
+  std::vector<std::atomic<unsigned int> > evaluations_;
+  std::vector<std::atomic<unsigned int> > rejections_;
+
+  /** \brief Only every few evaluations are timed, to keep the clock out of the cost of cheap constraints */
+  std::vector<std::atomic<unsigned int> > timed_evaluations_;
+  std::vector<std::atomic<unsigned long long> > time_ns_;
+  std::vector<double> default_cost_;
+
+  /** \brief The order in which to evaluate the constraints; replaced atomically by reorder() */
+  std::shared_ptr<const std::vector<std::size_t> > order_;
+};
+
+void KinematicConstraintSet::resetStatistics()
+{
+  statistics_.reset(new EvaluationStatistics(kinematic_constraints_));
 }
 
 bool KinematicConstraintSet::add(const std::vector<moveit_msgs::JointConstraint>& jc)
@@ -1067,6 +1168,7 @@ bool KinematicConstraintSet::add(const std::vector<moveit_msgs::JointConstraint>
     joint_constraints_.push_back(jc[i]);
     all_constraints_.joint_constraints.push_back(jc[i]);
   }
+  resetStatistics();
   return result;
 }
 
@@ -1083,6 +1185,7 @@ bool KinematicConstraintSet::add(const std::vector<moveit_msgs::PositionConstrai
     position_constraints_.push_back(pc[i]);
     all_constraints_.position_constraints.push_back(pc[i]);
   }
+  resetStatistics();
   return result;
 }
 
@@ -1099,6 +1202,7 @@ bool KinematicConstraintSet::add(const std::vector<moveit_msgs::OrientationConst
     orientation_constraints_.push_back(oc[i]);
     all_constraints_.orientation_constraints.push_back(oc[i]);
   }
+  resetStatistics();
   return result;
 }
 
@@ -1115,6 +1219,7 @@ bool KinematicConstraintSet::add(const std::vector<moveit_msgs::VisibilityConstr
     visibility_constraints_.push_back(vc[i]);
     all_constraints_.visibility_constraints.push_back(vc[i]);
   }
+  resetStatistics();
   return result;
 }
 
@@ -1156,6 +1261,43 @@ ConstraintEvaluationResult KinematicConstraintSet::decide(const robot_state::Rob
   return result;
 }
 
+bool KinematicConstraintSet::isSatisfied(const robot_state::RobotState& state, bool verbose) const
+{
+  if (kinematic_constraints_.empty())
+    return true;
+
+  EvaluationStatistics& stats = *statistics_;
+  const unsigned int call = stats.calls_.fetch_add(1, std::memory_order_relaxed);
+  // time each constraint on one call out of 16
+  const bool timed = (call & 15) == 0;
+  std::shared_ptr<const std::vector<std::size_t> > order = std::atomic_load(&stats.order_);
+
+  bool satisfied = true;
+  for (std::size_t k = 0; k < order->size() && satisfied; ++k)
+  {
+    const std::size_t i = (*order)[k];
+    if (timed)
+    {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      satisfied = kinematic_constraints_[i]->decide(state, verbose).satisfied;
+      stats.time_ns_[i].fetch_add(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(),
+          std::memory_order_relaxed);
+      stats.timed_evaluations_[i].fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+      satisfied = kinematic_constraints_[i]->decide(state, verbose).satisfied;
+    stats.evaluations_[i].fetch_add(1, std::memory_order_relaxed);
+    if (!satisfied)
+      stats.rejections_[i].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // adapt the order while the statistics are young, then only occasionally
+  if (order->size() > 1 && ((call < 4096 && (call & 255) == 255) || (call & 65535) == 65535))
+    stats.reorder();
+  return satisfied;
+}
+
 void KinematicConstraintSet::print(std::ostream& out) const
 {
   out << kinematic_constraints_.size() << " kinematic constraints" << std::endl;
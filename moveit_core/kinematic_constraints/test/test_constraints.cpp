@@ -805,6 +805,51 @@ TEST_F(LoadPlanningModelsPr2, VisibilityConstraintsPR2)
   EXPECT_FALSE(vc.decide(ks, true).satisfied);
 }
 
+TEST_F(LoadPlanningModelsPr2, VisibilityConstraintsCachedCone)
+{
+  robot_state::RobotState ks(kmodel);
+  ks.setToDefaultValues();
+  ks.update();
+  robot_state::Transforms tf(kmodel->getModelFrame());
+
+  // a cone fixed in the model frame, passing through the workspace of the right arm
+  moveit_msgs::VisibilityConstraint vcm;
+  vcm.sensor_pose.header.frame_id = "base_footprint";
+  vcm.sensor_pose.pose.position.x = 0.6;
+  vcm.sensor_pose.pose.position.y = -0.2;
+  vcm.sensor_pose.pose.position.z = 1.5;
+  vcm.sensor_pose.pose.orientation.y = 1.0;
+  vcm.target_pose.header.frame_id = "base_footprint";
+  vcm.target_pose.pose.position.x = 0.6;
+  vcm.target_pose.pose.position.y = -0.2;
+  vcm.target_pose.pose.orientation.w = 1.0;
+  vcm.target_radius = .1;
+  vcm.cone_sides = 10;
+  vcm.sensor_view_direction = moveit_msgs::VisibilityConstraint::SENSOR_Z;
+  vcm.weight = 1.0;
+
+  kinematic_constraints::VisibilityConstraint vc(kmodel);
+  EXPECT_TRUE(vc.configure(vcm, tf));
+
+  // the cone is reused between evaluations; results must match a freshly configured constraint
+  random_numbers::RandomNumberGenerator rng(42);
+  for (int i = 0; i < 20; ++i)
+  {
+    ks.setToRandomPositions(kmodel->getJointModelGroup("right_arm"), rng);
+    ks.update();
+    kinematic_constraints::VisibilityConstraint fresh(kmodel);
+    EXPECT_TRUE(fresh.configure(vcm, tf));
+    EXPECT_EQ(fresh.decide(ks).satisfied, vc.decide(ks).satisfied);
+  }
+
+  // reconfiguring replaces the cached cone
+  vcm.target_radius = .05;
+  EXPECT_TRUE(vc.configure(vcm, tf));
+  kinematic_constraints::VisibilityConstraint fresh(kmodel);
+  EXPECT_TRUE(fresh.configure(vcm, tf));
+  EXPECT_EQ(fresh.decide(ks).satisfied, vc.decide(ks).satisfied);
+}
+
 TEST_F(LoadPlanningModelsPr2, TestKinematicConstraintSet)
 {
   robot_state::RobotState ks(kmodel);
@@ -871,6 +916,63 @@ TEST_F(LoadPlanningModelsPr2, TestKinematicConstraintSet)
   EXPECT_FALSE(kcs.decide(ks).satisfied);
 }
 
+TEST_F(LoadPlanningModelsPr2, TestKinematicConstraintSetIsSatisfied)
+{
+  robot_state::RobotState ks(kmodel);
+  ks.setToDefaultValues();
+  ks.update();
+  robot_state::Transforms tf(kmodel->getModelFrame());
+
+  kinematic_constraints::KinematicConstraintSet kcs(kmodel);
+  EXPECT_TRUE(kcs.isSatisfied(ks));
+
+  std::vector<moveit_msgs::JointConstraint> jcv(2);
+  jcv[0].joint_name = "l_shoulder_pan_joint";
+  jcv[0].position = 0.5;
+  jcv[0].tolerance_above = 0.5;
+  jcv[0].tolerance_below = 0.5;
+  jcv[0].weight = 1.0;
+  jcv[1] = jcv[0];
+  jcv[1].joint_name = "l_elbow_flex_joint";
+  jcv[1].position = -1.0;
+  EXPECT_TRUE(kcs.add(jcv));
+
+  std::vector<moveit_msgs::PositionConstraint> pcv(1);
+  pcv[0].link_name = "l_wrist_roll_link";
+  pcv[0].header.frame_id = kmodel->getModelFrame();
+  pcv[0].constraint_region.primitives.resize(1);
+  pcv[0].constraint_region.primitives[0].type = shape_msgs::SolidPrimitive::SPHERE;
+  pcv[0].constraint_region.primitives[0].dimensions.resize(1, 0.3);
+  pcv[0].constraint_region.primitive_poses.resize(1);
+  pcv[0].constraint_region.primitive_poses[0].position.x = 0.55;
+  pcv[0].constraint_region.primitive_poses[0].position.y = 0.2;
+  pcv[0].constraint_region.primitive_poses[0].position.z = 1.25;
+  pcv[0].constraint_region.primitive_poses[0].orientation.w = 1.0;
+  pcv[0].weight = 1.0;
+  EXPECT_TRUE(kcs.add(pcv, tf));
+
+  // enough evaluations for the set to reorder its constraints a few times
+  random_numbers::RandomNumberGenerator rng(7);
+  const robot_model::JointModelGroup* group = kmodel->getJointModelGroup("left_arm");
+  unsigned int satisfied = 0;
+  for (int i = 0; i < 2000; ++i)
+  {
+    ks.setToRandomPositions(group, rng);
+    ks.update();
+    bool expected = kcs.decide(ks).satisfied;
+    EXPECT_EQ(expected, kcs.isSatisfied(ks));
+    if (expected)
+      ++satisfied;
+  }
+  EXPECT_LT(satisfied, 2000u);
+
+  // the order is recomputed for new constraints
+  kcs.clear();
+  EXPECT_TRUE(kcs.isSatisfied(ks));
+  EXPECT_TRUE(kcs.add(jcv));
+  EXPECT_EQ(kcs.decide(ks).satisfied, kcs.isSatisfied(ks));
+}
+
 TEST_F(LoadPlanningModelsPr2, TestKinematicConstraintSetEquality)
 {
   robot_state::RobotState ks(kmodel);
@@ -40,6 +40,7 @@
 #include <geometry_msgs/PoseStamped.h>
 #include <moveit_msgs/MoveItErrorCodes.h>
 #include <moveit/macros/class_forward.h>
+#include <eigen_stl_containers/eigen_stl_vector_container.h>
 #include <ros/node_handle.h>
 
 #include <boost/function.hpp>
@@ -318,6 +319,25 @@ public:
     return false;
   }
 
+  /**
+   * @brief Solve IK for a batch of independent poses of the tip link, e.g. for reachability analysis or for the
+   * waypoints of a Cartesian path. The default implementation calls searchPositionIK() once per pose; solvers that
+   * can reuse their internal data structures across queries, or solve several queries in parallel, should override it.
+   * @param ik_poses the desired poses of the tip link, expressed in the base frame of the solver
+   * @param ik_seed_states either one seed per pose, or a single seed that is used for all poses
+   * @param timeout The amount of time (in seconds) available to the solver for each pose
+   * @param solutions the solution vectors; the entries of poses that could not be solved are left empty
+   * @param error_codes the error code of each query
+   * @param options container for other IK options
+   * @return True if a solution was found for every pose, false otherwise
+   */
+  virtual bool searchPositionIKBatch(const EigenSTL::vector_Affine3d& ik_poses,
+                                     const std::vector<std::vector<double> >& ik_seed_states, double timeout,
+                                     std::vector<std::vector<double> >& solutions,
+                                     std::vector<moveit_msgs::MoveItErrorCodes>& error_codes,
+                                     const kinematics::KinematicsQueryOptions& options =
+                                         kinematics::KinematicsQueryOptions()) const;
+
   /**
    * @brief Given a set of joint angles and a set of links, compute their pose
    * @param link_names A set of links for which FK needs to be computed
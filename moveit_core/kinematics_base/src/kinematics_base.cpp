@@ -36,6 +36,7 @@
 
 #include <moveit/kinematics_base/kinematics_base.h>
 #include <moveit/robot_model/joint_model_group.h>
+#include <eigen_conversions/eigen_msg.h>
 
 namespace kinematics
 {
@@ -171,4 +172,36 @@ bool KinematicsBase::getPositionIK(const std::vector<geometry_msgs::Pose>& ik_po
   return true;
 }
 
+bool KinematicsBase::searchPositionIKBatch(const EigenSTL::vector_Affine3d& ik_poses,
+                                           const std::vector<std::vector<double> >& ik_seed_states, double timeout,
+                                           std::vector<std::vector<double> >& solutions,
+                                           std::vector<moveit_msgs::MoveItErrorCodes>& error_codes,
+                                           const KinematicsQueryOptions& options) const
+{
+  solutions.assign(ik_poses.size(), std::vector<double>());
+  error_codes.resize(ik_poses.size());
+  if (ik_seed_states.size() != 1 && ik_seed_states.size() != ik_poses.size())
+  {
+    ROS_ERROR_NAMED("kinematics_base", "Expected 1 or %u seed states for the IK batch, but %u were given",
+                    (unsigned int)ik_poses.size(), (unsigned int)ik_seed_states.size());
+    for (std::size_t i = 0; i < error_codes.size(); ++i)
+      error_codes[i].val = moveit_msgs::MoveItErrorCodes::NO_IK_SOLUTION;
+    return false;
+  }
+
+  bool all_solved = true;
+  geometry_msgs::Pose ik_pose;
+  for (std::size_t i = 0; i < ik_poses.size(); ++i)
+  {
+    tf::poseEigenToMsg(ik_poses[i], ik_pose);
+    const std::vector<double>& seed = ik_seed_states.size() == 1 ? ik_seed_states[0] : ik_seed_states[i];
+    if (!searchPositionIK(ik_pose, seed, timeout, solutions[i], error_codes[i], options))
+    {
+      solutions[i].clear();
+      all_solved = false;
+    }
+  }
+  return all_solved;
+}
+
 }  // end of namespace kinematics
@@ -79,6 +79,19 @@ public:
                               const robot_model::JointModelGroup* joint_model_group, double& manipulability_index,
                               bool translation = false) const;
 
+  /**
+   * @brief Get the manipulability index for a given group at many joint configurations. This computes the same values
+   * as getManipulabilityIndex(), but reuses the Jacobian storage for all states and uses fixed-size matrices for groups
+   * with 6 or 7 joints, so no memory is allocated per state.
+   * @param states Complete kinematic states for the robot, with up to date link transforms
+   * @param joint_model_group A pointer to the desired joint model group
+   * @param manipulability_indices The computed manipulability = sqrt(det(JJ^T)) for each state
+   * @return False if the group is not a chain
+   */
+  bool getManipulabilityIndices(const std::vector<const robot_state::RobotState*>& states,
+                                const robot_model::JointModelGroup* joint_model_group,
+                                std::vector<double>& manipulability_indices, bool translation = false) const;
+
   /**
    * @brief Get the (translation) manipulability ellipsoid for a given group at a given joint configuration
    * @param state Complete kinematic state for the robot
@@ -40,6 +40,44 @@
 
 namespace kinematics_metrics
 {
+namespace
+{
+// sqrt(det(JJ^T)), using the first Rows rows of a Jacobian with Cols columns known at compile time
+template <int Rows, int Cols>
+double fixedSizeManipulabilityIndex(const Eigen::MatrixXd& jacobian)
+{
+  const Eigen::Map<const Eigen::Matrix<double, 6, Cols> > full(jacobian.data());
+  const Eigen::Matrix<double, Rows, Cols> part = full.template topRows<Rows>();
+  const Eigen::Matrix<double, Rows, Rows> matrix = part * part.transpose();
+  return sqrt(matrix.determinant());
+}
+
+double computeManipulabilityIndex(const Eigen::MatrixXd& jacobian, bool translation)
+{
+  // the common cases of 6 and 7 joints do not need any dynamic allocation
+  if (jacobian.rows() == 6 && jacobian.cols() == 6)
+    return translation ? fixedSizeManipulabilityIndex<3, 6>(jacobian) : fixedSizeManipulabilityIndex<6, 6>(jacobian);
+  if (jacobian.rows() == 6 && jacobian.cols() == 7)
+    return translation ? fixedSizeManipulabilityIndex<3, 7>(jacobian) : fixedSizeManipulabilityIndex<6, 7>(jacobian);
+
+  const Eigen::MatrixXd jacobian_part = translation ? jacobian.topLeftCorner(3, jacobian.cols()) : jacobian;
+  if (jacobian.cols() < 6)
+  {
+    Eigen::JacobiSVD<Eigen::MatrixXd> svdsolver(jacobian_part);
+    Eigen::MatrixXd singular_values = svdsolver.singularValues();
+    double manipulability_index = 1.0;
+    for (unsigned int i = 0; i < singular_values.rows(); ++i)
+    {
+      ROS_DEBUG_NAMED("kinematics_metrics", "Singular value: %d %f", i, singular_values(i, 0));
+      manipulability_index *= singular_values(i, 0);
+    }
+    return manipulability_index;
+  }
+  Eigen::MatrixXd matrix = jacobian_part * jacobian_part.transpose();
+  return sqrt(matrix.determinant());
+}
+}
+
 double KinematicsMetrics::getJointLimitsPenalty(const robot_state::RobotState& state,
                                                 const robot_model::JointModelGroup* joint_model_group) const
 {
@@ -74,14 +112,15 @@ double KinematicsMetrics::getJointLimitsPenalty(const robot_state::RobotState& s
     }
     const double* joint_values = state.getJointPositions(joint_model_vector[i]);
     const robot_model::JointModel::Bounds& bounds = joint_model_vector[i]->getVariableBounds();
-    std::vector<double> lower_bounds, upper_bounds;
-    for (std::size_t j = 0; j < bounds.size(); ++j)
+    // floating joints, the only ones with more than 3 variables, are skipped above
+    double lower_bounds[3], upper_bounds[3];
+    for (std::size_t j = 0; j < bounds.size() && j < 3; ++j)
     {
-      lower_bounds.push_back(bounds[j].min_position_);
-      upper_bounds.push_back(bounds[j].max_position_);
+      lower_bounds[j] = bounds[j].min_position_;
+      upper_bounds[j] = bounds[j].max_position_;
     }
-    double lower_bound_distance = joint_model_vector[i]->distance(joint_values, &lower_bounds[0]);
-    double upper_bound_distance = joint_model_vector[i]->distance(joint_values, &upper_bounds[0]);
+    double lower_bound_distance = joint_model_vector[i]->distance(joint_values, lower_bounds);
+    double upper_bound_distance = joint_model_vector[i]->distance(joint_values, upper_bounds);
     double range = lower_bound_distance + upper_bound_distance;
     if (range <= boost::math::tools::epsilon<double>())
       continue;
@@ -113,50 +152,31 @@ bool KinematicsMetrics::getManipulabilityIndex(const robot_state::RobotState& st
   Eigen::MatrixXd jacobian = state.getJacobian(joint_model_group);
   // Get joint limits penalty
   double penalty = getJointLimitsPenalty(state, joint_model_group);
-  if (translation)
+  // Get manipulability index
+  manipulability_index = penalty * computeManipulabilityIndex(jacobian, translation);
+  return true;
+}
+
+bool KinematicsMetrics::getManipulabilityIndices(const std::vector<const robot_state::RobotState*>& states,
+                                                 const robot_model::JointModelGroup* joint_model_group,
+                                                 std::vector<double>& manipulability_indices, bool translation) const
+{
+  // state.getJacobian() only works for chain groups.
+  if (!joint_model_group->isChain())
   {
-    if (jacobian.cols() < 6)
-    {
-      Eigen::JacobiSVD<Eigen::MatrixXd> svdsolver(jacobian.topLeftCorner(3, jacobian.cols()));
-      Eigen::MatrixXd singular_values = svdsolver.singularValues();
-      manipulability_index = 1.0;
-      for (unsigned int i = 0; i < singular_values.rows(); ++i)
-      {
-        ROS_DEBUG_NAMED("kinematics_metrics", "Singular value: %d %f", i, singular_values(i, 0));
-        manipulability_index *= singular_values(i, 0);
-      }
-      // Get manipulability index
-      manipulability_index = penalty * manipulability_index;
-    }
-    else
-    {
-      Eigen::MatrixXd jacobian_2 = jacobian.topLeftCorner(3, jacobian.cols());
-      Eigen::MatrixXd matrix = jacobian_2 * jacobian_2.transpose();
-      // Get manipulability index
-      manipulability_index = penalty * sqrt(matrix.determinant());
-    }
+    return false;
   }
-  else
+
+  manipulability_indices.resize(states.size());
+  const robot_model::LinkModel* tip = joint_model_group->getLinkModels().back();
+  const Eigen::Vector3d reference_point_position(0.0, 0.0, 0.0);
+  Eigen::MatrixXd jacobian;  // keeps its storage across states
+  for (std::size_t i = 0; i < states.size(); ++i)
   {
-    if (jacobian.cols() < 6)
-    {
-      Eigen::JacobiSVD<Eigen::MatrixXd> svdsolver(jacobian);
-      Eigen::MatrixXd singular_values = svdsolver.singularValues();
-      manipulability_index = 1.0;
-      for (unsigned int i = 0; i < singular_values.rows(); ++i)
-      {
-        ROS_DEBUG_NAMED("kinematics_metrics", "Singular value: %d %f", i, singular_values(i, 0));
-        manipulability_index *= singular_values(i, 0);
-      }
-      // Get manipulability index
-      manipulability_index = penalty * manipulability_index;
-    }
-    else
-    {
-      Eigen::MatrixXd matrix = jacobian * jacobian.transpose();
-      // Get manipulability index
-      manipulability_index = penalty * sqrt(matrix.determinant());
-    }
+    if (!states[i]->getJacobian(joint_model_group, tip, reference_point_position, jacobian, false))
+      return false;
+    manipulability_indices[i] =
+        getJointLimitsPenalty(*states[i], joint_model_group) * computeManipulabilityIndex(jacobian, translation);
   }
   return true;
 }
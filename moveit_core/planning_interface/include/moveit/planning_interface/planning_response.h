@@ -41,9 +41,15 @@
 #include <moveit_msgs/MoveItErrorCodes.h>
 #include <moveit_msgs/MotionPlanResponse.h>
 #include <moveit_msgs/MotionPlanDetailedResponse.h>
+#include <boost/function.hpp>
 
 namespace planning_interface
 {
+/** \brief Receives a solution found while the planner is still running, together with its cost. The trajectory is a
+ * geometric path without timing information. The callback is invoked from the planning thread(s). */
+typedef boost::function<void(const robot_trajectory::RobotTrajectoryPtr& trajectory, double cost)>
+    IntermediateSolutionCallback;
+
 struct MotionPlanResponse
 {
   MotionPlanResponse() : planning_time_(0.0)
@@ -55,6 +61,9 @@ struct MotionPlanResponse
   robot_trajectory::RobotTrajectoryPtr trajectory_;
   double planning_time_;
   moveit_msgs::MoveItErrorCodes error_code_;
+
+  /// If set, planners that improve their solution over time (e.g. RRT*, BIT*) report each improvement here
+  IntermediateSolutionCallback intermediate_solution_callback_;
 };
 
 struct MotionPlanDetailedResponse
@@ -40,6 +40,7 @@
 #include <moveit/macros/class_forward.h>
 #include <moveit/planning_interface/planning_interface.h>
 #include <moveit/planning_scene/planning_scene.h>
+#include <moveit/profiler/probes.h>
 #include <boost/function.hpp>
 
 /** \brief Generic interface to adapting motion planning requests */
@@ -69,6 +70,15 @@ public:
     return "";
   }
 
+  /** \brief Cheap check whether this adapter has anything to do for \e req. When this returns false, chains call the
+      next stage directly instead of adaptAndPlan(), so adapters that only fix up requests can skip copying states
+      and requests that are fine as they are. The default is to always run the adapter. */
+  virtual bool isNeeded(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                        const planning_interface::MotionPlanRequest& req) const
+  {
+    return true;
+  }
+
   bool adaptAndPlan(const planning_interface::PlannerManagerPtr& planner,
                     const planning_scene::PlanningSceneConstPtr& planning_scene,
                     const planning_interface::MotionPlanRequest& req,
@@ -98,10 +108,10 @@ public:
   {
   }
 
-  void addAdapter(const PlanningRequestAdapterConstPtr& adapter)
-  {
-    adapters_.push_back(adapter);
-  }
+  /** \brief Append \e adapter to the chain. While probes are enabled, the time spent in each adapter (not including
+      the adapters that follow it and the planner) is recorded under the probe "PlanningRequestAdapter::<description>".
+   */
+  void addAdapter(const PlanningRequestAdapterConstPtr& adapter);
 
   bool adaptAndPlan(const planning_interface::PlannerManagerPtr& planner,
                     const planning_scene::PlanningSceneConstPtr& planning_scene,
@@ -115,6 +125,7 @@ public:
 
 private:
   std::vector<PlanningRequestAdapterConstPtr> adapters_;
+  std::vector<moveit::tools::probes::ProbeId> probes_;
 };
 }
 
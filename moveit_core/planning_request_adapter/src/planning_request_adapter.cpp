@@ -37,6 +37,7 @@
 #include <moveit/planning_request_adapter/planning_request_adapter.h>
 #include <boost/bind.hpp>
 #include <algorithm>
+#include <chrono>
 
 // we could really use some c++11 lambda functions here :)
 
@@ -49,9 +50,16 @@ bool callPlannerInterfaceSolve(const planning_interface::PlannerManager* planner
                                const planning_interface::MotionPlanRequest& req,
                                planning_interface::MotionPlanResponse& res)
 {
-  planning_interface::PlanningContextPtr context = planner->getPlanningContext(planning_scene, req, res.error_code_);
+  planning_interface::PlanningContextPtr context;
+  {
+    MOVEIT_PROBE_SPAN("PlannerManager::getPlanningContext");
+    context = planner->getPlanningContext(planning_scene, req, res.error_code_);
+  }
   if (context)
+  {
+    MOVEIT_PROBE_SPAN("PlanningContext::solve");
     return context->solve(res);
+  }
   else
     return false;
 }
@@ -87,6 +95,8 @@ bool callAdapter1(const PlanningRequestAdapter* adapter, const planning_interfac
 {
   try
   {
+    if (!adapter->isNeeded(planning_scene, req))
+      return callPlannerInterfaceSolve(planner.get(), planning_scene, req, res);
     return adapter->adaptAndPlan(planner, planning_scene, req, res, added_path_index);
   }
   catch (std::exception& ex)
@@ -105,6 +115,9 @@ bool callAdapter2(const PlanningRequestAdapter* adapter, const PlanningRequestAd
 {
   try
   {
+    // checked when the adapter is reached, as the adapters before it may have changed the request
+    if (!adapter->isNeeded(planning_scene, req))
+      return planner(planning_scene, req, res);
     return adapter->adaptAndPlan(planner, planning_scene, req, res, added_path_index);
   }
   catch (std::exception& ex)
@@ -115,6 +128,49 @@ bool callAdapter2(const PlanningRequestAdapter* adapter, const PlanningRequestAd
     return planner(planning_scene, req, res);
   }
 }
+
+inline std::uint64_t now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// call the remaining stages of the chain and add the time spent in them to nested_ns
+bool callNested(const PlanningRequestAdapter::PlannerFn& planner, std::uint64_t* nested_ns,
+                const planning_scene::PlanningSceneConstPtr& planning_scene,
+                const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res)
+{
+  std::uint64_t start = now();
+  bool result = planner(planning_scene, req, res);
+  *nested_ns += now() - start;
+  return result;
+}
+
+// like callAdapter2(), but record the time spent in the adapter itself under the given probe
+bool callTimedAdapter(const PlanningRequestAdapter* adapter, moveit::tools::probes::ProbeId probe,
+                      const PlanningRequestAdapter::PlannerFn& planner,
+                      const planning_scene::PlanningSceneConstPtr& planning_scene,
+                      const planning_interface::MotionPlanRequest& req, planning_interface::MotionPlanResponse& res,
+                      std::vector<std::size_t>& added_path_index)
+{
+  std::uint64_t nested_ns = 0;
+  std::uint64_t start = now();
+  bool result = callAdapter2(adapter, boost::bind(&callNested, planner, &nested_ns, _1, _2, _3), planning_scene, req,
+                             res, added_path_index);
+  std::uint64_t end = now();
+  if (moveit::tools::probes::isEnabled())
+    moveit::tools::probes::record(probe, start, end - start - nested_ns);
+  // the span covers the nested stages as well, so they show up inside it in a trace
+  if (moveit::tools::probes::RequestTrace* trace = moveit::tools::probes::getCurrentRequestTrace())
+    trace->addSpan(probe, start, end - start);
+  return result;
+}
+}
+
+void PlanningRequestAdapterChain::addAdapter(const PlanningRequestAdapterConstPtr& adapter)
+{
+  adapters_.push_back(adapter);
+  probes_.push_back(moveit::tools::probes::registerProbe("PlanningRequestAdapter::" + adapter->getDescription()));
 }
 
 bool PlanningRequestAdapterChain::adaptAndPlan(const planning_interface::PlannerManagerPtr& planner,
@@ -145,10 +201,21 @@ bool PlanningRequestAdapterChain::adaptAndPlan(const planning_interface::Planner
 
     // if there are adapters, construct a function pointer for each, in order,
     // so that in the end we have a nested sequence of function pointers that call the adapters in the correct order.
-    PlanningRequestAdapter::PlannerFn fn = boost::bind(&callAdapter1, adapters_.back().get(), planner, _1, _2, _3,
-                                                       boost::ref(added_path_index_each.back()));
-    for (int i = adapters_.size() - 2; i >= 0; --i)
-      fn = boost::bind(&callAdapter2, adapters_[i].get(), fn, _1, _2, _3, boost::ref(added_path_index_each[i]));
+    PlanningRequestAdapter::PlannerFn fn;
+    if (moveit::tools::probes::isEnabled() || moveit::tools::probes::getCurrentRequestTrace())
+    {
+      fn = boost::bind(&callPlannerInterfaceSolve, planner.get(), _1, _2, _3);
+      for (int i = adapters_.size() - 1; i >= 0; --i)
+        fn = boost::bind(&callTimedAdapter, adapters_[i].get(), probes_[i], fn, _1, _2, _3,
+                         boost::ref(added_path_index_each[i]));
+    }
+    else
+    {
+      fn = boost::bind(&callAdapter1, adapters_.back().get(), planner, _1, _2, _3,
+                       boost::ref(added_path_index_each.back()));
+      for (int i = adapters_.size() - 2; i >= 0; --i)
+        fn = boost::bind(&callAdapter2, adapters_[i].get(), fn, _1, _2, _3, boost::ref(added_path_index_each[i]));
+    }
     bool result = fn(planning_scene, req, res);
     added_path_index.clear();
 
@@ -97,6 +97,7 @@ public:
                 collision_detection::WorldPtr world = collision_detection::WorldPtr(new collision_detection::World()));
 
   static const std::string OCTOMAP_NS;
+  static const std::string OCTOMAP_DELTA_ID;
   static const std::string DEFAULT_SCENE_NAME;
 
   ~PlanningScene();
@@ -220,6 +221,47 @@ public:
    * body id or a collision object */
   bool knowsFrameTransform(const robot_state::RobotState& state, const std::string& id) const;
 
+  /** \brief A frame resolved once by resolveFrame(), so repeated getFrameTransform() calls do not look it up by name.
+      A handle must be resolved again when the world, the attached bodies or the fixed transforms change. */
+  struct FrameHandle
+  {
+    FrameHandle() : link(nullptr), fixed_frame(-1)
+    {
+    }
+
+    /** \brief Whether a transform was known for the frame when it was resolved */
+    bool isValid() const
+    {
+      return link || !attached_body.empty() || object || fixed_frame >= 0;
+    }
+
+    /** \brief Set if the frame is a link of the robot */
+    const robot_model::LinkModel* link;
+
+    /** \brief Set if the frame is a body attached to the robot; looked up in the state passed to getFrameTransform() */
+    std::string attached_body;
+
+    /** \brief Set if the frame is a collision object in the world */
+    collision_detection::World::ObjectConstPtr object;
+
+    /** \brief Set if the frame is one of the fixed transforms of the scene */
+    robot_state::Transforms::FrameId fixed_frame;
+  };
+
+  /** \brief Resolve the frame \e id the same way getFrameTransform() does, using the attached bodies of \e state.
+      The handle is not valid if no transform is known for \e id. */
+  FrameHandle resolveFrame(const robot_state::RobotState& state, const std::string& id) const;
+
+  /** \brief Resolve the frame \e id using the attached bodies of the current state */
+  FrameHandle resolveFrame(const std::string& id) const
+  {
+    return resolveFrame(getCurrentState(), id);
+  }
+
+  /** \brief Get the transform of a frame resolved with resolveFrame(). The link transforms of \e state must be up to
+      date. Return identity if the handle is not valid. */
+  const Eigen::Affine3d& getFrameTransform(const robot_state::RobotState& state, const FrameHandle& frame) const;
+
   /**@}*/
 
   /**
@@ -421,6 +463,23 @@ public:
                       const robot_state::RobotState& kstate,
                       const collision_detection::AllowedCollisionMatrix& acm) const;
 
+  /** \brief Check whether the robot is in collision (with the environment or self collision) anywhere along the motion
+      from \e state1 to \e state2 (continuous collision checking). The collision transforms of both states are
+      expected to be up to date and both states need to have the same attached bodies. */
+  void checkCollisionContinuous(const collision_detection::CollisionRequest& req,
+                                collision_detection::CollisionResult& res, const robot_state::RobotState& state1,
+                                const robot_state::RobotState& state2) const
+  {
+    checkCollisionContinuous(req, res, state1, state2, getAllowedCollisionMatrix());
+  }
+
+  /** \brief Check whether the robot is in collision anywhere along the motion from \e state1 to \e state2, with
+      respect to a given allowed collision matrix (\e acm). */
+  void checkCollisionContinuous(const collision_detection::CollisionRequest& req,
+                                collision_detection::CollisionResult& res, const robot_state::RobotState& state1,
+                                const robot_state::RobotState& state2,
+                                const collision_detection::AllowedCollisionMatrix& acm) const;
+
   /** \brief Check whether the current state is in collision,
       but use a collision_detection::CollisionRobot instance that has no padding.
       Since the function is non-const, the current state transforms are also updated if needed. */
@@ -710,6 +769,11 @@ public:
   /** \brief Construct a message (\e octomap) with the octomap data from the planning_scene */
   bool getOctomapMsg(octomap_msgs::OctomapWithPose& octomap) const;
 
+  /** \brief Construct a message (\e delta) containing only the leaves of \e octree that changed since change detection
+      was last reset. The message id is OCTOMAP_DELTA_ID; processOctomapMsg() applies it on top of the octomap already
+      in the receiving scene. Change detection must be enabled on \e octree. */
+  static void getOctomapDeltaMsg(const octomap::OcTree& octree, octomap_msgs::Octomap& delta);
+
   /** \brief Construct a vector of messages (\e object_colors) with the colors of the objects from the planning_scene */
   void getObjectColorMsgs(std::vector<moveit_msgs::ObjectColor>& object_colors) const;
 
@@ -729,6 +793,25 @@ public:
   bool usePlanningSceneMsg(const moveit_msgs::PlanningScene& scene);
 
   bool processCollisionObjectMsg(const moveit_msgs::CollisionObject& object);
+
+  /** \brief The geometry of an ADD or APPEND collision object message, decoded by prepareCollisionObjectMsg() */
+  struct PreparedCollisionObject
+  {
+    std::vector<shapes::ShapeConstPtr> shapes_;
+    EigenSTL::vector_Affine3d poses_;  // relative to the frame of the message
+    std::vector<std::shared_ptr<const void> > handles_;  // keep the preprocessing of the collision detectors alive
+  };
+
+  /** \brief Decode the shapes of an ADD or APPEND collision object message and let all collision detectors of this
+      scene preprocess them (e.g., build mesh BVHs). The scene is not modified, so this can run without holding the
+      lock that protects the scene, as long as collision detectors are not added concurrently. Other operations need
+      no preparation and always succeed. */
+  bool prepareCollisionObjectMsg(const moveit_msgs::CollisionObject& object, PreparedCollisionObject& prepared) const;
+
+  /** \brief Same as processCollisionObjectMsg(), but with the geometry of an ADD or APPEND message taken from
+      \e prepared instead of being decoded from the message. The object is added in a single step. */
+  bool processCollisionObjectMsg(const moveit_msgs::CollisionObject& object, const PreparedCollisionObject& prepared);
+
   bool processAttachedCollisionObjectMsg(const moveit_msgs::AttachedCollisionObject& object);
 
   bool processPlanningSceneWorldMsg(const moveit_msgs::PlanningSceneWorld& world);
@@ -813,6 +896,21 @@ public:
     return motion_feasibility_;
   }
 
+  /** \brief Set the number of threads isPathValid() spreads the waypoints of a trajectory over. 1 (the default) checks
+   * them in order in the calling thread; 0 uses one thread per hardware thread. With several threads, waypoints are
+   * checked coarse to fine (the ends and the middle first, then the points in between) and all threads stop at the
+   * first invalid waypoint unless all invalid indices are requested. The state feasibility predicate must then be
+   * thread safe. Scenes created by diff() inherit this setting. */
+  void setPathValidationThreads(unsigned int threads)
+  {
+    path_validation_threads_ = threads;
+  }
+
+  unsigned int getPathValidationThreads() const
+  {
+    return path_validation_threads_;
+  }
+
   /** \brief Check if a given state is feasible, in accordance to the feasibility predicate specified by
    * setStateFeasibilityPredicate(). Returns true if no feasibility predicate was specified. */
   bool isStateFeasible(const moveit_msgs::RobotState& state, bool verbose = false) const;
@@ -961,6 +1059,20 @@ private:
   static robot_model::RobotModelPtr createRobotModel(const urdf::ModelInterfaceSharedPtr& urdf_model,
                                                      const srdf::ModelConstSharedPtr& srdf_model);
 
+  /* helper function to apply an octomap delta message on top of the current octomap, placed at pose \e t */
+  void processOctomapDeltaMsg(const octomap_msgs::Octomap& delta, const Eigen::Affine3d& t);
+
+  /* check a waypoint of a path for collisions, feasibility and the path constraints */
+  bool isWayPointValid(const robot_state::RobotState& state,
+                       const kinematic_constraints::KinematicConstraintSet& path_constraints, const std::string& group,
+                       bool verbose) const;
+
+  /* isPathValid() spread over \e threads threads, see setPathValidationThreads() */
+  bool isPathValidParallel(const robot_trajectory::RobotTrajectory& trajectory,
+                           const kinematic_constraints::KinematicConstraintSet& path_constraints,
+                           const std::vector<moveit_msgs::Constraints>& goal_constraints, const std::string& group,
+                           bool verbose, std::vector<std::size_t>* invalid_index, std::size_t threads) const;
+
   MOVEIT_CLASS_FORWARD(CollisionDetector);
 
   /* \brief A set of compatible collision detectors */
@@ -1022,6 +1134,8 @@ private:
   StateFeasibilityFn state_feasibility_;
   MotionFeasibilityFn motion_feasibility_;
 
+  unsigned int path_validation_threads_;
+
   std::unique_ptr<ObjectColorMap> object_colors_;
 
   // a map of object types
@@ -42,15 +42,24 @@
 #include <moveit/trajectory_processing/trajectory_tools.h>
 #include <moveit/robot_state/conversions.h>
 #include <moveit/exceptions/exceptions.h>
+#include <moveit/background_processing/thread_budget.h>
 #include <moveit/robot_state/attached_body.h>
+#include <moveit/profiler/probes.h>
 #include <octomap_msgs/conversions.h>
 #include <eigen_conversions/eigen_msg.h>
+#include <boost/thread/thread.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
 #include <memory>
 #include <set>
 
 namespace planning_scene
 {
 const std::string PlanningScene::OCTOMAP_NS = "<octomap>";
+const std::string PlanningScene::OCTOMAP_DELTA_ID = "OcTreeDelta";
 const std::string PlanningScene::DEFAULT_SCENE_NAME = "(noname)";
 
 class SceneTransforms : public robot_state::Transforms
@@ -82,6 +91,10 @@ public:
     return scene_->getFrameTransform(from_frame);
   }
 
+  // the lookups by frame id only consider the fixed transforms
+  using Transforms::canTransform;
+  using Transforms::getTransform;
+
 private:
   bool knowsObject(const std::string& id) const
   {
@@ -151,6 +164,7 @@ PlanningScene::~PlanningScene()
 void PlanningScene::initialize()
 {
   name_ = DEFAULT_SCENE_NAME;
+  path_validation_threads_ = 1;
 
   ftf_.reset(new SceneTransforms(this));
 
@@ -190,6 +204,7 @@ PlanningScene::PlanningScene(const PlanningSceneConstPtr& parent) : parent_(pare
     name_ = parent_->getName() + "+";
 
   kmodel_ = parent_->kmodel_;
+  path_validation_threads_ = parent_->path_validation_threads_;
 
   // maintain a separate world.  Copy on write ensures that most of the object
   // info is shared until it is modified.
@@ -526,6 +541,7 @@ void PlanningScene::checkCollision(const collision_detection::CollisionRequest&
                                    collision_detection::CollisionResult& res,
                                    const robot_state::RobotState& kstate) const
 {
+  MOVEIT_PROBE_SCOPE("PlanningScene::checkCollision");
   // check collision with the world using the padded version
   getCollisionWorld()->checkRobotCollision(req, res, *getCollisionRobot(), kstate, getAllowedCollisionMatrix());
 
@@ -549,6 +565,7 @@ void PlanningScene::checkCollision(const collision_detection::CollisionRequest&
                                    collision_detection::CollisionResult& res, const robot_state::RobotState& kstate,
                                    const collision_detection::AllowedCollisionMatrix& acm) const
 {
+  MOVEIT_PROBE_SCOPE("PlanningScene::checkCollision");
   // check collision with the world using the padded version
   getCollisionWorld()->checkRobotCollision(req, res, *getCollisionRobot(), kstate, acm);
 
@@ -557,6 +574,20 @@ void PlanningScene::checkCollision(const collision_detection::CollisionRequest&
     getCollisionRobotUnpadded()->checkSelfCollision(req, res, kstate, acm);
 }
 
+void PlanningScene::checkCollisionContinuous(const collision_detection::CollisionRequest& req,
+                                             collision_detection::CollisionResult& res,
+                                             const robot_state::RobotState& state1,
+                                             const robot_state::RobotState& state2,
+                                             const collision_detection::AllowedCollisionMatrix& acm) const
+{
+  // check collision with the world using the padded version
+  getCollisionWorld()->checkRobotCollision(req, res, *getCollisionRobot(), state1, state2, acm);
+
+  // do self-collision checking with the unpadded version of the robot
+  if (!res.collision || (req.contacts && res.contacts.size() < req.max_contacts))
+    getCollisionRobotUnpadded()->checkSelfCollision(req, res, state1, state2, acm);
+}
+
 void PlanningScene::checkCollisionUnpadded(const collision_detection::CollisionRequest& req,
                                            collision_detection::CollisionResult& res)
 {
@@ -898,6 +929,39 @@ bool PlanningScene::getOctomapMsg(octomap_msgs::OctomapWithPose& octomap) const
   return false;
 }
 
+namespace
+{
+// a delta record is the leaf key followed by its log-odds; NaN log-odds mark a pruned (deleted) leaf
+const std::size_t OCTOMAP_DELTA_RECORD_SIZE = 3 * sizeof(octomap::key_type) + sizeof(float);
+}
+
+void PlanningScene::getOctomapDeltaMsg(const octomap::OcTree& octree, octomap_msgs::Octomap& delta)
+{
+  delta = octomap_msgs::Octomap();
+  delta.id = OCTOMAP_DELTA_ID;
+  delta.binary = false;
+  delta.resolution = octree.getResolution();
+
+  std::size_t count = 0;
+  for (octomap::KeyBoolMap::const_iterator it = octree.changedKeysBegin(); it != octree.changedKeysEnd(); ++it)
+    ++count;
+  delta.data.resize(count * OCTOMAP_DELTA_RECORD_SIZE);
+
+  int8_t* out = delta.data.data();
+  for (octomap::KeyBoolMap::const_iterator it = octree.changedKeysBegin(); it != octree.changedKeysEnd(); ++it)
+  {
+    const octomap::OcTreeNode* node = octree.search(it->first);
+    float log_odds = node ? node->getLogOdds() : std::numeric_limits<float>::quiet_NaN();
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+      std::memcpy(out, &it->first.k[i], sizeof(octomap::key_type));
+      out += sizeof(octomap::key_type);
+    }
+    std::memcpy(out, &log_odds, sizeof(float));
+    out += sizeof(float);
+  }
+}
+
 void PlanningScene::getObjectColorMsgs(std::vector<moveit_msgs::ObjectColor>& object_colors) const
 {
   object_colors.clear();
@@ -1307,6 +1371,15 @@ bool PlanningScene::usePlanningSceneMsg(const moveit_msgs::PlanningScene& scene_
 
 void PlanningScene::processOctomapMsg(const octomap_msgs::Octomap& map)
 {
+  if (map.id == OCTOMAP_DELTA_ID)
+  {
+    if (!map.header.frame_id.empty())
+      processOctomapDeltaMsg(map, getTransforms().getTransform(map.header.frame_id));
+    else
+      processOctomapDeltaMsg(map, Eigen::Affine3d::Identity());
+    return;
+  }
+
   // each octomap replaces any previous one
   world_->removeObject(OCTOMAP_NS);
 
@@ -1346,6 +1419,14 @@ void PlanningScene::removeAllCollisionObjects()
 
 void PlanningScene::processOctomapMsg(const octomap_msgs::OctomapWithPose& map)
 {
+  if (map.octomap.id == OCTOMAP_DELTA_ID)
+  {
+    Eigen::Affine3d p;
+    tf::poseMsgToEigen(map.origin, p);
+    processOctomapDeltaMsg(map.octomap, getTransforms().getTransform(map.header.frame_id) * p);
+    return;
+  }
+
   // each octomap replaces any previous one
   world_->removeObject(OCTOMAP_NS);
 
@@ -1367,6 +1448,53 @@ void PlanningScene::processOctomapMsg(const octomap_msgs::OctomapWithPose& map)
   world_->addToObject(OCTOMAP_NS, shapes::ShapeConstPtr(new shapes::OcTree(om)), p);
 }
 
+void PlanningScene::processOctomapDeltaMsg(const octomap_msgs::Octomap& delta, const Eigen::Affine3d& t)
+{
+  collision_detection::CollisionWorld::ObjectConstPtr map = world_->getObject(OCTOMAP_NS);
+  if (!map || map->shapes_.size() != 1)
+  {
+    ROS_WARN_NAMED("planning_scene", "Received an octomap delta but there is no octomap to apply it to. Ignoring.");
+    return;
+  }
+  const shapes::OcTree* o = static_cast<const shapes::OcTree*>(map->shapes_[0].get());
+  if (std::fabs(o->octree->getResolution() - delta.resolution) > std::numeric_limits<float>::epsilon())
+  {
+    ROS_ERROR_NAMED("planning_scene", "Octomap delta has resolution %lf but the current octomap has resolution %lf. "
+                                      "Ignoring.",
+                    delta.resolution, o->octree->getResolution());
+    return;
+  }
+  if (delta.data.size() % OCTOMAP_DELTA_RECORD_SIZE != 0)
+  {
+    ROS_ERROR_NAMED("planning_scene", "Malformed octomap delta of %u bytes. Ignoring.",
+                    (unsigned int)delta.data.size());
+    return;
+  }
+
+  // the current octree may be shared with other scenes, so the delta is applied to a copy
+  std::shared_ptr<octomap::OcTree> om(new octomap::OcTree(*o->octree));
+  map.reset();
+  const int8_t* in = delta.data.data();
+  const int8_t* end = in + delta.data.size();
+  while (in != end)
+  {
+    octomap::OcTreeKey key;
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+      std::memcpy(&key.k[i], in, sizeof(octomap::key_type));
+      in += sizeof(octomap::key_type);
+    }
+    float log_odds;
+    std::memcpy(&log_odds, in, sizeof(float));
+    in += sizeof(float);
+    if (std::isnan(log_odds))
+      om->deleteNode(key);
+    else
+      om->setNodeValue(key, log_odds);
+  }
+  processOctomapPtr(om, t);
+}
+
 void PlanningScene::processOctomapPtr(const std::shared_ptr<const octomap::OcTree>& octree, const Eigen::Affine3d& t)
 {
   collision_detection::CollisionWorld::ObjectConstPtr map = world_->getObject(OCTOMAP_NS);
@@ -1381,6 +1509,10 @@ void PlanningScene::processOctomapPtr(const std::shared_ptr<const octomap::OcTre
         // if the pose changed, we update it
         if (map->shape_poses_[0].isApprox(t, std::numeric_limits<double>::epsilon() * 100.0))
         {
+          // the octree was modified in place; let the collision worlds know so they can refresh derived data
+          shapes::ShapeConstPtr shape = map->shapes_[0];
+          map.reset();
+          world_->moveShapeInObject(OCTOMAP_NS, shape, t);
           if (world_diff_)
             world_diff_->set(OCTOMAP_NS, collision_detection::World::DESTROY | collision_detection::World::CREATE |
                                              collision_detection::World::ADD_SHAPE);
@@ -1654,39 +1786,119 @@ bool PlanningScene::processAttachedCollisionObjectMsg(const moveit_msgs::Attache
   return false;
 }
 
-bool PlanningScene::processCollisionObjectMsg(const moveit_msgs::CollisionObject& object)
+namespace
 {
-  if (object.id == OCTOMAP_NS)
+/* decode the shapes of an ADD or APPEND collision object message */
+bool decodeCollisionObjectShapes(const moveit_msgs::CollisionObject& object,
+                                 PlanningScene::PreparedCollisionObject& prepared)
+{
+  if (object.primitives.empty() && object.meshes.empty() && object.planes.empty())
   {
-    ROS_ERROR_NAMED("planning_scene", "The ID '%s' cannot be used for collision objects (name reserved)",
-                    OCTOMAP_NS.c_str());
+    ROS_ERROR_NAMED("planning_scene", "There are no shapes specified in the collision object message");
     return false;
   }
 
-  if (object.operation == moveit_msgs::CollisionObject::ADD || object.operation == moveit_msgs::CollisionObject::APPEND)
+  if (object.primitives.size() != object.primitive_poses.size())
+  {
+    ROS_ERROR_NAMED("planning_scene", "Number of primitive shapes does not match number of poses "
+                                      "in collision object message");
+    return false;
+  }
+
+  if (object.meshes.size() != object.mesh_poses.size())
+  {
+    ROS_ERROR_NAMED("planning_scene", "Number of meshes does not match number of poses in collision object message");
+    return false;
+  }
+
+  if (object.planes.size() != object.plane_poses.size())
+  {
+    ROS_ERROR_NAMED("planning_scene", "Number of planes does not match number of poses in collision object message");
+    return false;
+  }
+
+  prepared.shapes_.clear();
+  prepared.poses_.clear();
+  prepared.handles_.clear();
+  for (std::size_t i = 0; i < object.primitives.size(); ++i)
   {
-    if (object.primitives.empty() && object.meshes.empty() && object.planes.empty())
+    shapes::Shape* s = shapes::constructShapeFromMsg(object.primitives[i]);
+    if (s)
     {
-      ROS_ERROR_NAMED("planning_scene", "There are no shapes specified in the collision object message");
-      return false;
+      Eigen::Affine3d p;
+      tf::poseMsgToEigen(object.primitive_poses[i], p);
+      prepared.shapes_.push_back(shapes::ShapeConstPtr(s));
+      prepared.poses_.push_back(p);
     }
-
-    if (object.primitives.size() != object.primitive_poses.size())
+  }
+  for (std::size_t i = 0; i < object.meshes.size(); ++i)
+  {
+    shapes::Shape* s = shapes::constructShapeFromMsg(object.meshes[i]);
+    if (s)
     {
-      ROS_ERROR_NAMED("planning_scene", "Number of primitive shapes does not match number of poses "
-                                        "in collision object message");
-      return false;
+      Eigen::Affine3d p;
+      tf::poseMsgToEigen(object.mesh_poses[i], p);
+      prepared.shapes_.push_back(shapes::ShapeConstPtr(s));
+      prepared.poses_.push_back(p);
+    }
+  }
+  for (std::size_t i = 0; i < object.planes.size(); ++i)
+  {
+    shapes::Shape* s = shapes::constructShapeFromMsg(object.planes[i]);
+    if (s)
+    {
+      Eigen::Affine3d p;
+      tf::poseMsgToEigen(object.plane_poses[i], p);
+      prepared.shapes_.push_back(shapes::ShapeConstPtr(s));
+      prepared.poses_.push_back(p);
     }
+  }
+  return true;
+}
+}
+
+bool PlanningScene::prepareCollisionObjectMsg(const moveit_msgs::CollisionObject& object,
+                                              PreparedCollisionObject& prepared) const
+{
+  if (object.operation != moveit_msgs::CollisionObject::ADD && object.operation != moveit_msgs::CollisionObject::APPEND)
+    return true;
+  if (!decodeCollisionObjectShapes(object, prepared))
+    return false;
 
-    if (object.meshes.size() != object.mesh_poses.size())
+  for (const auto& detector : collision_)
+    for (std::size_t i = 0; i < prepared.shapes_.size(); ++i)
     {
-      ROS_ERROR_NAMED("planning_scene", "Number of meshes does not match number of poses in collision object message");
-      return false;
+      std::shared_ptr<const void> handle = detector.second->cworld_const_->prepareShape(prepared.shapes_[i]);
+      if (handle)
+        prepared.handles_.push_back(handle);
     }
+  return true;
+}
+
+bool PlanningScene::processCollisionObjectMsg(const moveit_msgs::CollisionObject& object)
+{
+  PreparedCollisionObject prepared;
+  if (object.operation == moveit_msgs::CollisionObject::ADD || object.operation == moveit_msgs::CollisionObject::APPEND)
+    if (!decodeCollisionObjectShapes(object, prepared))
+      return false;
+  return processCollisionObjectMsg(object, prepared);
+}
 
-    if (object.planes.size() != object.plane_poses.size())
+bool PlanningScene::processCollisionObjectMsg(const moveit_msgs::CollisionObject& object,
+                                              const PreparedCollisionObject& prepared)
+{
+  if (object.id == OCTOMAP_NS)
+  {
+    ROS_ERROR_NAMED("planning_scene", "The ID '%s' cannot be used for collision objects (name reserved)",
+                    OCTOMAP_NS.c_str());
+    return false;
+  }
+
+  if (object.operation == moveit_msgs::CollisionObject::ADD || object.operation == moveit_msgs::CollisionObject::APPEND)
+  {
+    if (prepared.shapes_.size() != prepared.poses_.size())
     {
-      ROS_ERROR_NAMED("planning_scene", "Number of planes does not match number of poses in collision object message");
+      ROS_ERROR_NAMED("planning_scene", "Number of prepared shapes does not match number of poses");
       return false;
     }
 
@@ -1695,37 +1907,11 @@ bool PlanningScene::processCollisionObjectMsg(const moveit_msgs::CollisionObject
       world_->removeObject(object.id);
 
     const Eigen::Affine3d& t = getTransforms().getTransform(object.header.frame_id);
-
-    for (std::size_t i = 0; i < object.primitives.size(); ++i)
-    {
-      shapes::Shape* s = shapes::constructShapeFromMsg(object.primitives[i]);
-      if (s)
-      {
-        Eigen::Affine3d p;
-        tf::poseMsgToEigen(object.primitive_poses[i], p);
-        world_->addToObject(object.id, shapes::ShapeConstPtr(s), t * p);
-      }
-    }
-    for (std::size_t i = 0; i < object.meshes.size(); ++i)
-    {
-      shapes::Shape* s = shapes::constructShapeFromMsg(object.meshes[i]);
-      if (s)
-      {
-        Eigen::Affine3d p;
-        tf::poseMsgToEigen(object.mesh_poses[i], p);
-        world_->addToObject(object.id, shapes::ShapeConstPtr(s), t * p);
-      }
-    }
-    for (std::size_t i = 0; i < object.planes.size(); ++i)
-    {
-      shapes::Shape* s = shapes::constructShapeFromMsg(object.planes[i]);
-      if (s)
-      {
-        Eigen::Affine3d p;
-        tf::poseMsgToEigen(object.plane_poses[i], p);
-        world_->addToObject(object.id, shapes::ShapeConstPtr(s), t * p);
-      }
-    }
+    EigenSTL::vector_Affine3d poses(prepared.poses_.size());
+    for (std::size_t i = 0; i < poses.size(); ++i)
+      poses[i] = t * prepared.poses_[i];
+    // all shapes are added at once, so observers see the complete object
+    world_->addToObject(object.id, prepared.shapes_, poses);
     if (!object.type.key.empty() || !object.type.db.empty())
       setObjectType(object.id, object.type);
     return true;
@@ -1817,7 +2003,7 @@ const Eigen::Affine3d& PlanningScene::getFrameTransform(const robot_state::Robot
                                                         const std::string& id) const
 {
   if (!id.empty() && id[0] == '/')
-    return getFrameTransform(id.substr(1));
+    return getFrameTransform(state, id.substr(1));
   if (state.knowsFrameTransform(id))
     return state.getFrameTransform(id);
   if (getWorld()->hasObject(id))
@@ -1843,7 +2029,7 @@ bool PlanningScene::knowsFrameTransform(const std::string& id) const
 bool PlanningScene::knowsFrameTransform(const robot_state::RobotState& state, const std::string& id) const
 {
   if (!id.empty() && id[0] == '/')
-    return knowsFrameTransform(id.substr(1));
+    return knowsFrameTransform(state, id.substr(1));
   if (state.knowsFrameTransform(id))
     return true;
   if (getWorld()->hasObject(id))
@@ -1854,6 +2040,44 @@ bool PlanningScene::knowsFrameTransform(const robot_state::RobotState& state, co
   return getTransforms().Transforms::canTransform(id);
 }
 
+PlanningScene::FrameHandle PlanningScene::resolveFrame(const robot_state::RobotState& state,
+                                                       const std::string& id) const
+{
+  if (!id.empty() && id[0] == '/')
+    return resolveFrame(state, id.substr(1));
+
+  FrameHandle frame;
+  const std::string& model_frame = getRobotModel()->getModelFrame();
+  if (id.size() + 1 == model_frame.size() && model_frame.compare(1, id.size(), id) == 0)
+    frame.fixed_frame = getTransforms().getFrameId(model_frame);
+  else if (getRobotModel()->hasLinkModel(id))
+    frame.link = getRobotModel()->getLinkModel(id);
+  else if (state.knowsFrameTransform(id))
+    frame.attached_body = id;
+  else if (getWorld()->hasObject(id) && !getWorld()->getObject(id)->shape_poses_.empty())
+  {
+    frame.object = getWorld()->getObject(id);
+    if (frame.object->shape_poses_.size() > 1)
+      ROS_WARN_NAMED("planning_scene", "More than one shapes in object '%s'. Using first one to decide transform",
+                     id.c_str());
+  }
+  else
+    frame.fixed_frame = getTransforms().getFrameId(id);
+  return frame;
+}
+
+const Eigen::Affine3d& PlanningScene::getFrameTransform(const robot_state::RobotState& state,
+                                                        const FrameHandle& frame) const
+{
+  if (frame.link)
+    return state.getGlobalLinkTransform(frame.link);
+  if (!frame.attached_body.empty())
+    return state.getFrameTransform(frame.attached_body);
+  if (frame.object)
+    return frame.object->shape_poses_[0];
+  return getTransforms().Transforms::getTransform(frame.fixed_frame);
+}
+
 bool PlanningScene::hasObjectType(const std::string& id) const
 {
   if (object_types_)
@@ -2027,7 +2251,7 @@ bool PlanningScene::isStateConstrained(const moveit_msgs::RobotState& state,
 bool PlanningScene::isStateConstrained(const robot_state::RobotState& state,
                                        const kinematic_constraints::KinematicConstraintSet& constr, bool verbose) const
 {
-  return constr.decide(state, verbose).satisfied;
+  return constr.isSatisfied(state, verbose);
 }
 
 bool PlanningScene::isStateValid(const robot_state::RobotState& state, const std::string& group, bool verbose) const
@@ -2123,19 +2347,21 @@ bool PlanningScene::isPathValid(const robot_trajectory::RobotTrajectory& traject
   kinematic_constraints::KinematicConstraintSet ks_p(getRobotModel());
   ks_p.add(path_constraints, getTransforms());
   std::size_t n_wp = trajectory.getWayPointCount();
+
+  unsigned int threads = path_validation_threads_;
+  if (threads == 0)
+    threads = moveit::tools::ThreadBudget::getConcurrency();
+  moveit::tools::ThreadBudget::Reservation reservation("path_validation",
+                                                       std::min<std::size_t>(threads, std::max<std::size_t>(n_wp, 1)));
+  threads = reservation.getThreads();
+  if (threads > 1 && n_wp > 2)
+    return isPathValidParallel(trajectory, ks_p, goal_constraints, group, verbose, invalid_index, threads);
+
   for (std::size_t i = 0; i < n_wp; ++i)
   {
     const robot_state::RobotState& st = trajectory.getWayPoint(i);
 
-    bool this_state_valid = true;
-    if (isStateColliding(st, group, verbose))
-      this_state_valid = false;
-    if (!isStateFeasible(st, verbose))
-      this_state_valid = false;
-    if (!ks_p.empty() && !ks_p.decide(st, verbose).satisfied)
-      this_state_valid = false;
-
-    if (!this_state_valid)
+    if (!isWayPointValid(st, ks_p, group, verbose))
     {
       if (invalid_index)
         invalid_index->push_back(i);
@@ -2169,6 +2395,105 @@ bool PlanningScene::isPathValid(const robot_trajectory::RobotTrajectory& traject
   return result;
 }
 
+bool PlanningScene::isWayPointValid(const robot_state::RobotState& state,
+                                    const kinematic_constraints::KinematicConstraintSet& path_constraints,
+                                    const std::string& group, bool verbose) const
+{
+  bool valid = true;
+  if (isStateColliding(state, group, verbose))
+    valid = false;
+  if (!isStateFeasible(state, verbose))
+    valid = false;
+  if (!path_constraints.empty() && !path_constraints.isSatisfied(state, verbose))
+    valid = false;
+  return valid;
+}
+
+bool PlanningScene::isPathValidParallel(const robot_trajectory::RobotTrajectory& trajectory,
+                                        const kinematic_constraints::KinematicConstraintSet& path_constraints,
+                                        const std::vector<moveit_msgs::Constraints>& goal_constraints,
+                                        const std::string& group, bool verbose, std::vector<std::size_t>* invalid_index,
+                                        std::size_t threads) const
+{
+  const std::size_t n_wp = trajectory.getWayPointCount();
+
+  // the goal only involves the last state and is cheap compared to the path, so it is checked up front
+  bool goal_satisfied = goal_constraints.empty();
+  for (std::size_t k = 0; !goal_satisfied && k < goal_constraints.size(); ++k)
+    goal_satisfied = isStateConstrained(trajectory.getWayPoint(n_wp - 1), goal_constraints[k]);
+  if (!goal_satisfied)
+  {
+    if (verbose)
+      ROS_INFO_NAMED("planning_scene", "Goal not satisfied");
+    if (!invalid_index)
+      return false;
+  }
+
+  // coarse to fine: both ends, then the middle, then the quarters and so on; collisions tend to extend over several
+  // consecutive waypoints, so this finds one with few checks
+  std::vector<std::size_t> order;
+  order.reserve(n_wp);
+  std::vector<bool> queued(n_wp, false);
+  order.push_back(0);
+  order.push_back(n_wp - 1);
+  queued[0] = queued[n_wp - 1] = true;
+  std::size_t step = 1;
+  while (step < n_wp)
+    step *= 2;
+  for (; step > 1; step /= 2)
+    for (std::size_t i = step / 2; i < n_wp; i += step)
+      if (!queued[i])
+      {
+        queued[i] = true;
+        order.push_back(i);
+      }
+
+  std::atomic<std::size_t> next(0);
+  std::atomic<bool> failed(false);
+  std::vector<std::vector<std::size_t> > invalid(threads);
+  auto worker = [&](std::size_t t) {
+    // waypoints that were not updated are checked on a copy of this thread's own
+    std::unique_ptr<robot_state::RobotState> local;
+    for (std::size_t k = next++; k < order.size(); k = next++)
+    {
+      if (failed && !invalid_index)
+        return;
+      const robot_state::RobotState* st = &trajectory.getWayPoint(order[k]);
+      if (st->dirtyCollisionBodyTransforms())
+      {
+        if (local)
+          *local = *st;
+        else
+          local.reset(new robot_state::RobotState(*st));
+        local->update();
+        st = local.get();
+      }
+      if (!isWayPointValid(*st, path_constraints, group, verbose))
+      {
+        failed = true;
+        invalid[t].push_back(order[k]);
+      }
+    }
+  };
+
+  boost::thread_group workers;
+  for (std::size_t t = 1; t < threads; ++t)
+    workers.create_thread([&worker, t]() { worker(t); });
+  worker(0);
+  workers.join_all();
+
+  if (invalid_index)
+  {
+    // report the same indices in the same order as the sequential check
+    for (std::size_t t = 0; t < threads; ++t)
+      invalid_index->insert(invalid_index->end(), invalid[t].begin(), invalid[t].end());
+    std::sort(invalid_index->begin(), invalid_index->end());
+    if (!goal_satisfied)
+      invalid_index->push_back(n_wp - 1);
+  }
+  return !failed && goal_satisfied;
+}
+
 bool PlanningScene::isPathValid(const robot_trajectory::RobotTrajectory& trajectory,
                                 const moveit_msgs::Constraints& path_constraints,
                                 const moveit_msgs::Constraints& goal_constraints, const std::string& group,
@@ -37,6 +37,7 @@
 #include <gtest/gtest.h>
 #include <moveit/planning_scene/planning_scene.h>
 #include <urdf_parser/urdf_parser.h>
+#include <octomap_msgs/conversions.h>
 #include <fstream>
 #include <string>
 #include <boost/filesystem/path.hpp>
@@ -167,6 +168,160 @@ TEST(PlanningScene, isStateValid)
   }
 }
 
+TEST(PlanningScene, OctomapDelta)
+{
+  srdf::ModelSharedPtr srdf_model(new srdf::Model());
+  urdf::ModelInterfaceSharedPtr urdf_model;
+  loadRobotModel(urdf_model);
+
+  planning_scene::PlanningScene sender(urdf_model, srdf_model);
+  planning_scene::PlanningScene receiver(urdf_model, srdf_model);
+
+  std::shared_ptr<octomap::OcTree> tree(new octomap::OcTree(0.1));
+  tree->updateNode(octomap::point3d(1.0, 0.0, 0.5), true);
+  tree->updateNode(octomap::point3d(1.0, 0.2, 0.5), true);
+  sender.processOctomapPtr(tree, Eigen::Affine3d::Identity());
+
+  // keyframe
+  moveit_msgs::PlanningScene ps_msg;
+  sender.getPlanningSceneMsg(ps_msg);
+  receiver.setPlanningSceneDiffMsg(ps_msg);
+
+  tree->enableChangeDetection(true);
+  tree->resetChangeDetection();
+  tree->updateNode(octomap::point3d(-1.0, 0.0, 0.5), true);
+  tree->updateNode(octomap::point3d(1.0, 0.2, 0.5), false);
+
+  moveit_msgs::PlanningScene delta_msg;
+  delta_msg.is_diff = true;
+  delta_msg.world.octomap.header.frame_id = sender.getPlanningFrame();
+  delta_msg.world.octomap.origin.orientation.w = 1.0;
+  planning_scene::PlanningScene::getOctomapDeltaMsg(*tree, delta_msg.world.octomap.octomap);
+  EXPECT_EQ(delta_msg.world.octomap.octomap.id, planning_scene::PlanningScene::OCTOMAP_DELTA_ID);
+  EXPECT_FALSE(delta_msg.world.octomap.octomap.data.empty());
+  receiver.setPlanningSceneDiffMsg(delta_msg);
+
+  collision_detection::CollisionWorld::ObjectConstPtr map =
+      receiver.getWorld()->getObject(planning_scene::PlanningScene::OCTOMAP_NS);
+  ASSERT_TRUE(map);
+  ASSERT_EQ(map->shapes_.size(), 1);
+  const octomap::OcTree& received = *static_cast<const shapes::OcTree*>(map->shapes_[0].get())->octree;
+  for (octomap::OcTree::leaf_iterator it = tree->begin_leafs(); it != tree->end_leafs(); ++it)
+  {
+    const octomap::OcTreeNode* node = received.search(it.getKey());
+    ASSERT_TRUE(node != NULL);
+    EXPECT_FLOAT_EQ(node->getLogOdds(), it->getLogOdds());
+  }
+  EXPECT_FALSE(received.isNodeOccupied(received.search(octomap::point3d(1.0, 0.2, 0.5))));
+}
+
+TEST(PlanningScene, ResolveFrame)
+{
+  urdf::ModelInterfaceSharedPtr urdf_model;
+  srdf::ModelSharedPtr srdf_model(new srdf::Model());
+  loadRobotModels(urdf_model, srdf_model);
+  planning_scene::PlanningScene ps(urdf_model, srdf_model);
+
+  robot_state::RobotState& state = ps.getCurrentStateNonConst();
+  state.setToRandomPositions();
+  state.update();
+
+  Eigen::Affine3d box_pose(Eigen::Translation3d(1.0, 0.5, 0.2));
+  ps.getWorldNonConst()->addToObject("box", shapes::ShapeConstPtr(new shapes::Box(0.1, 0.1, 0.1)), box_pose);
+  Eigen::Affine3d fixed_pose(Eigen::Translation3d(-1.0, 0.0, 2.0));
+  ps.getTransformsNonConst().setTransform(fixed_pose, "/fixed_frame");
+
+  const char* frames[] = { "r_gripper_palm_link", "/base_link", "box", "fixed_frame",
+                           ps.getRobotModel()->getModelFrame().c_str() };
+  for (std::size_t i = 0; i < sizeof(frames) / sizeof(frames[0]); ++i)
+  {
+    planning_scene::PlanningScene::FrameHandle frame = ps.resolveFrame(frames[i]);
+    EXPECT_TRUE(frame.isValid()) << frames[i];
+    EXPECT_TRUE(ps.getFrameTransform(state, frame).isApprox(ps.getFrameTransform(state, frames[i]))) << frames[i];
+  }
+  EXPECT_TRUE(ps.getFrameTransform(state, ps.resolveFrame("box")).isApprox(box_pose));
+  EXPECT_FALSE(ps.resolveFrame("unknown_frame").isValid());
+}
+
+TEST(PlanningScene, PrepareCollisionObject)
+{
+  urdf::ModelInterfaceSharedPtr urdf_model;
+  srdf::ModelSharedPtr srdf_model(new srdf::Model());
+  loadRobotModels(urdf_model, srdf_model);
+  planning_scene::PlanningScene ps(urdf_model, srdf_model);
+
+  moveit_msgs::CollisionObject co;
+  co.id = "part";
+  co.header.frame_id = ps.getPlanningFrame();
+  co.operation = moveit_msgs::CollisionObject::ADD;
+  co.primitives.resize(1);
+  co.primitives[0].type = shape_msgs::SolidPrimitive::BOX;
+  co.primitives[0].dimensions.assign(3, 0.1);
+  co.primitive_poses.resize(1);
+  co.primitive_poses[0].orientation.w = 1.0;
+  co.meshes.resize(1);
+  co.meshes[0].vertices.resize(4);
+  co.meshes[0].vertices[1].x = 0.1;
+  co.meshes[0].vertices[2].y = 0.1;
+  co.meshes[0].vertices[3].z = 0.1;
+  const unsigned int triangles[4][3] = { { 0, 1, 2 }, { 0, 1, 3 }, { 0, 2, 3 }, { 1, 2, 3 } };
+  co.meshes[0].triangles.resize(4);
+  for (std::size_t i = 0; i < 4; ++i)
+    for (std::size_t j = 0; j < 3; ++j)
+      co.meshes[0].triangles[i].vertex_indices[j] = triangles[i][j];
+  co.mesh_poses.resize(1);
+  co.mesh_poses[0].position.x = 1.0;
+  co.mesh_poses[0].orientation.w = 1.0;
+
+  planning_scene::PlanningScene::PreparedCollisionObject prepared;
+  ASSERT_TRUE(ps.prepareCollisionObjectMsg(co, prepared));
+  EXPECT_EQ(prepared.shapes_.size(), 2u);
+  EXPECT_EQ(prepared.handles_.size(), 1u);  // the mesh BVH of the FCL detector
+  EXPECT_FALSE(ps.getWorld()->hasObject("part"));
+
+  ASSERT_TRUE(ps.processCollisionObjectMsg(co, prepared));
+  collision_detection::World::ObjectConstPtr obj = ps.getWorld()->getObject("part");
+  ASSERT_TRUE(obj);
+  ASSERT_EQ(obj->shapes_.size(), 2u);
+  EXPECT_DOUBLE_EQ(obj->shape_poses_[1].translation().x(), 1.0);
+
+  // mismatching poses are rejected before anything is decoded
+  co.mesh_poses.clear();
+  EXPECT_FALSE(ps.prepareCollisionObjectMsg(co, prepared));
+}
+
+TEST(PlanningScene, ParallelPathValidation)
+{
+  urdf::ModelInterfaceSharedPtr urdf_model;
+  srdf::ModelSharedPtr srdf_model(new srdf::Model());
+  loadRobotModels(urdf_model, srdf_model);
+  planning_scene::PlanningScenePtr ps_ptr(new planning_scene::PlanningScene(urdf_model, srdf_model));
+  planning_scene::PlanningScene& ps = *ps_ptr;
+  Eigen::Affine3d box_pose(Eigen::Translation3d(0.6, -0.2, 0.8));
+  ps.getWorldNonConst()->addToObject("box", shapes::ShapeConstPtr(new shapes::Box(0.4, 0.4, 0.4)), box_pose);
+
+  random_numbers::RandomNumberGenerator rng(7);
+  const robot_model::JointModelGroup* arm = ps.getRobotModel()->getJointModelGroup("right_arm");
+  robot_trajectory::RobotTrajectory trajectory(ps.getRobotModel(), "right_arm");
+  robot_state::RobotState state(ps.getCurrentState());
+  for (unsigned int i = 0; i < 40; ++i)
+  {
+    state.setToRandomPositions(arm, rng);
+    state.update();
+    trajectory.addSuffixWayPoint(state, 0.1);
+  }
+
+  std::vector<std::size_t> sequential, parallel;
+  bool valid = ps.isPathValid(trajectory, "", false, &sequential);
+  ps.setPathValidationThreads(4);
+  EXPECT_EQ(valid, ps.isPathValid(trajectory, "", false, &parallel));
+  EXPECT_EQ(sequential, parallel);
+  EXPECT_EQ(valid, ps.isPathValid(trajectory));
+
+  // a diff inherits the setting
+  EXPECT_EQ(ps.diff()->getPathValidationThreads(), 4u);
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
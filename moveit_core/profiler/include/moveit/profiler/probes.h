@@ -0,0 +1,393 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#ifndef MOVEIT_PROFILER_PROBES_
+#define MOVEIT_PROFILER_PROBES_
+
+/** Probes can be compiled out entirely by defining MOVEIT_ENABLE_PROBES to 0.
+    Otherwise they are compiled in but cost a single relaxed load while disabled at runtime. */
+#ifndef MOVEIT_ENABLE_PROBES
+#define MOVEIT_ENABLE_PROBES 1
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace moveit
+{
+namespace tools
+{
+/** \brief Low-overhead instrumentation for hot code paths.
+
+    Unlike moveit::tools::Profiler, probes are identified by small integers that are registered once per call site
+    (see MOVEIT_PROBE_SCOPE()). Each thread accumulates its measurements in its own counters without taking any lock;
+    the counters of all threads are only combined when statistics are requested. When enabled, the duration of every
+    scoped probe can additionally be recorded to a per-thread ring buffer and exported in the Chrome trace event
+    format, which is understood by chrome://tracing and Perfetto. */
+namespace probes
+{
+/** \brief Identifier of a registered probe */
+typedef std::uint16_t ProbeId;
+
+/** \brief The maximum number of probes that can be registered */
+static const std::size_t MAX_PROBES = 128;
+
+/** \brief Number of buckets of the duration histograms. Bucket \e i counts durations in [2^i, 2^(i+1)) nanoseconds;
+    the last bucket also counts all longer durations. */
+static const std::size_t HISTOGRAM_BUCKETS = 32;
+
+/** \brief Number of events kept per thread while tracing. Older events are overwritten. */
+static const std::size_t TRACE_BUFFER_SIZE = 1 << 15;
+
+/** \brief Identifier returned when no more probes can be registered. Measurements for it are discarded. */
+static const ProbeId INVALID_PROBE = MAX_PROBES;
+
+/** \brief Number of spans kept per request trace. Later spans are dropped, the totals are still updated. */
+static const std::size_t MAX_TRACE_SPANS = 4096;
+
+/** \brief Register a probe named \e name and return its identifier. Registering the same name twice returns the
+    same identifier. This function is thread-safe but takes a lock: call it once per call site, not in hot loops. */
+ProbeId registerProbe(const std::string& name);
+
+/** \brief Turn collection of measurements on or off (off by default) */
+void setEnabled(bool enabled);
+
+/** \brief Check if measurements are being collected */
+inline bool isEnabled();
+
+/** \brief Turn recording of trace events on or off (off by default). Events are only recorded while probes are
+    enabled as well. */
+void setTracing(bool tracing);
+
+/** \brief Check if trace events are being recorded */
+inline bool isTracing();
+
+/** \brief Add \e times to the counter of probe \e id in the calling thread */
+void count(ProbeId id, std::uint64_t times = 1);
+
+/** \brief Add a measured duration to the counters of probe \e id in the calling thread. \e start_ns is only used
+    for trace events and is measured relative to the steady clock epoch. */
+void record(ProbeId id, std::uint64_t start_ns, std::uint64_t duration_ns);
+
+/** \brief Aggregated measurements of a probe over all threads */
+struct ProbeStats
+{
+  /** \brief The name the probe was registered with */
+  std::string name;
+
+  /** \brief The number of times the probe was hit (timed scopes and counts) */
+  std::uint64_t count;
+
+  /** \brief The number of timed scopes that contributed to the durations below */
+  std::uint64_t timed;
+
+  /** \brief The total duration of the timed scopes, in seconds */
+  double total;
+
+  /** \brief The shortest duration of a timed scope, in seconds */
+  double shortest;
+
+  /** \brief The longest duration of a timed scope, in seconds */
+  double longest;
+
+  /** \brief Histogram of the durations, see HISTOGRAM_BUCKETS */
+  std::vector<std::uint64_t> histogram;
+};
+
+/** \brief Combine the counters of all threads, including threads that already exited. Only probes that were hit
+    are reported. */
+std::vector<ProbeStats> getStats();
+
+/** \brief Get the measurements taken by the calling thread only. Only probes that were hit are reported. */
+std::vector<ProbeStats> getThreadStats();
+
+/** \brief Estimate the duration below which the given \e fraction of the timed scopes of \e stats fall, in seconds.
+    This is the upper bound of the histogram bucket containing that fraction, capped at the longest duration. */
+double percentile(const ProbeStats& stats, double fraction);
+
+/** \brief Reset all counters and discard recorded trace events. Measurements taken by other threads while the
+    reset is in progress may survive it. */
+void reset();
+
+/** \brief Print the aggregated statistics of all probes that were hit */
+void printStats(std::ostream& out = std::cout);
+
+/** \brief Print the aggregated statistics of all probes using ROS_INFO */
+void consoleStats();
+
+/** \brief Write the recorded trace events of all threads as a Chrome trace event JSON document. Tracing should be
+    turned off first, as events recorded concurrently may otherwise be corrupted in the output. */
+void writeChromeTrace(std::ostream& out);
+
+/** \brief Write the recorded trace events to the file \e filename. Returns false if the file could not be written. */
+bool writeChromeTrace(const std::string& filename);
+
+/** \brief The measurements taken on behalf of a single request, such as a motion plan request handled by move_group.
+
+    While a trace is current in a thread (see ScopedRequestTrace), the scopes marked with MOVEIT_PROBE_SPAN() in that
+    thread are kept as individual spans of the trace. While probes are enabled, every other measurement taken in that
+    thread is additionally added to the per-probe totals of the trace, so the time spent in e.g. collision checking is
+    accounted for without recording each check. The same trace can be current in several threads at once.
+    Traces must be owned by a std::shared_ptr, so that code handing a request over to another thread can keep its
+    trace alive. */
+class RequestTrace : public std::enable_shared_from_this<RequestTrace>
+{
+public:
+  /** \brief A scope measured while the trace was current */
+  struct Span
+  {
+    /** \brief The name of the probe of the scope */
+    std::string name;
+
+    /** \brief The time the scope was entered, in seconds since the creation of the trace */
+    double start;
+
+    /** \brief The time spent in the scope, in seconds */
+    double duration;
+
+    /** \brief The index of the thread the scope was measured in, as used in the Chrome traces */
+    unsigned int thread;
+  };
+
+  explicit RequestTrace(const std::string& id);
+
+  /** \brief The identifier of the request */
+  const std::string& getId() const
+  {
+    return id_;
+  }
+
+  /** \brief The time since the trace was created, in seconds */
+  double getElapsed() const;
+
+  /** \brief The spans recorded so far, in the order they were completed */
+  std::vector<Span> getSpans() const;
+
+  /** \brief The totals of the probes hit while the trace was current. Only the counts and the total durations are
+      tracked per request, so \e shortest, \e longest and \e histogram are not filled in. */
+  std::vector<ProbeStats> getStats() const;
+
+  /** \brief Write the spans as a Chrome trace event JSON document */
+  void writeChromeTrace(std::ostream& out) const;
+
+  /** \brief Write the spans to the file \e filename. Returns false if the file could not be written. */
+  bool writeChromeTrace(const std::string& filename) const;
+
+  /** \brief Add a span for probe \e id, measured by the calling thread */
+  void addSpan(ProbeId id, std::uint64_t start_ns, std::uint64_t duration_ns);
+
+  /** \brief Add \e times hits of probe \e id to the totals; \e duration_ns is the time they took, if they were timed */
+  void add(ProbeId id, std::uint64_t times, std::uint64_t duration_ns, bool timed);
+
+private:
+  struct RecordedSpan
+  {
+    ProbeId id;
+    unsigned int thread;
+    std::uint64_t start_ns;
+    std::uint64_t duration_ns;
+  };
+
+  std::string id_;
+  std::uint64_t start_ns_;
+  mutable std::mutex lock_;
+  std::vector<RecordedSpan> spans_;
+  std::atomic<std::uint64_t> count_[MAX_PROBES];
+  std::atomic<std::uint64_t> timed_[MAX_PROBES];
+  std::atomic<std::uint64_t> total_ns_[MAX_PROBES];
+};
+
+typedef std::shared_ptr<RequestTrace> RequestTracePtr;
+
+/** \brief The request trace that is current in the calling thread, if any */
+inline RequestTrace* getCurrentRequestTrace();
+
+/// @cond IGNORE
+namespace detail
+{
+extern std::atomic<bool> enabled;
+extern std::atomic<bool> tracing;
+extern thread_local RequestTrace* current_trace;
+
+inline std::uint64_t now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+}
+/// @endcond
+
+inline bool isEnabled()
+{
+  return detail::enabled.load(std::memory_order_relaxed);
+}
+
+inline bool isTracing()
+{
+  return detail::tracing.load(std::memory_order_relaxed);
+}
+
+inline RequestTrace* getCurrentRequestTrace()
+{
+  return detail::current_trace;
+}
+
+/** \brief Make \e trace the current request trace of the calling thread for the lifetime of this object. The trace
+    that was current before is restored afterwards. Passing NULL suspends tracing for the scope. */
+class ScopedRequestTrace
+{
+public:
+  explicit ScopedRequestTrace(RequestTrace* trace) : previous_(detail::current_trace)
+  {
+    detail::current_trace = trace;
+  }
+
+  ~ScopedRequestTrace()
+  {
+    detail::current_trace = previous_;
+  }
+
+private:
+  ScopedRequestTrace(const ScopedRequestTrace&);
+  ScopedRequestTrace& operator=(const ScopedRequestTrace&);
+
+  RequestTrace* previous_;
+};
+
+/** \brief Measure the time spent in the current scope for probe \e id, if probes are enabled when the scope is
+    entered */
+class ScopedProbe
+{
+public:
+  explicit ScopedProbe(ProbeId id) : id_(id), start_(isEnabled() ? detail::now() : 0)
+  {
+  }
+
+  ~ScopedProbe()
+  {
+    if (start_)
+      record(id_, start_, detail::now() - start_);
+  }
+
+private:
+  ScopedProbe(const ScopedProbe&);
+  ScopedProbe& operator=(const ScopedProbe&);
+
+  ProbeId id_;
+  std::uint64_t start_;
+};
+
+/** \brief Like ScopedProbe, but the scope is also added as a span to the current request trace. This is meant for the
+    stages of handling a request, not for code that runs many times per request. */
+class ScopedSpan
+{
+public:
+  explicit ScopedSpan(ProbeId id)
+    : id_(id), trace_(detail::current_trace), start_(isEnabled() || trace_ ? detail::now() : 0)
+  {
+  }
+
+  ~ScopedSpan()
+  {
+    if (!start_)
+      return;
+    std::uint64_t duration = detail::now() - start_;
+    if (isEnabled())
+      record(id_, start_, duration);
+    if (trace_)
+      trace_->addSpan(id_, start_, duration);
+  }
+
+private:
+  ScopedSpan(const ScopedSpan&);
+  ScopedSpan& operator=(const ScopedSpan&);
+
+  ProbeId id_;
+  RequestTrace* trace_;
+  std::uint64_t start_;
+};
+}
+}
+}
+
+#define MOVEIT_PROBE_CONCAT_(a, b) a##b
+#define MOVEIT_PROBE_CONCAT(a, b) MOVEIT_PROBE_CONCAT_(a, b)
+
+#if MOVEIT_ENABLE_PROBES
+
+/** \brief Measure the time spent in the rest of the enclosing scope under the probe \e name.
+    The probe is registered the first time the statement is executed. */
+#define MOVEIT_PROBE_SCOPE(name)                                                                                       \
+  static const ::moveit::tools::probes::ProbeId MOVEIT_PROBE_CONCAT(moveit_probe_id_, __LINE__) =                      \
+      ::moveit::tools::probes::registerProbe(name);                                                                    \
+  ::moveit::tools::probes::ScopedProbe MOVEIT_PROBE_CONCAT(moveit_probe_, __LINE__)(                                   \
+      MOVEIT_PROBE_CONCAT(moveit_probe_id_, __LINE__))
+
+/** \brief Same as MOVEIT_PROBE_SCOPE(), but the scope is also kept as a span of the current request trace */
+#define MOVEIT_PROBE_SPAN(name)                                                                                        \
+  static const ::moveit::tools::probes::ProbeId MOVEIT_PROBE_CONCAT(moveit_probe_id_, __LINE__) =                      \
+      ::moveit::tools::probes::registerProbe(name);                                                                    \
+  ::moveit::tools::probes::ScopedSpan MOVEIT_PROBE_CONCAT(moveit_probe_, __LINE__)(                                    \
+      MOVEIT_PROBE_CONCAT(moveit_probe_id_, __LINE__))
+
+/** \brief Add \e times to the counter of the probe \e name */
+#define MOVEIT_PROBE_COUNT(name, times)                                                                                \
+  do                                                                                                                   \
+  {                                                                                                                    \
+    if (::moveit::tools::probes::isEnabled())                                                                          \
+    {                                                                                                                  \
+      static const ::moveit::tools::probes::ProbeId moveit_probe_id = ::moveit::tools::probes::registerProbe(name);    \
+      ::moveit::tools::probes::count(moveit_probe_id, times);                                                          \
+    }                                                                                                                  \
+  } while (0)
+
+#else
+
+#define MOVEIT_PROBE_SCOPE(name)
+#define MOVEIT_PROBE_SPAN(name)
+#define MOVEIT_PROBE_COUNT(name, times)                                                                                \
+  do                                                                                                                   \
+  {                                                                                                                    \
+  } while (0)
+
+#endif
+
+#endif
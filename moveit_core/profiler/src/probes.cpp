@@ -0,0 +1,615 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/profiler/probes.h>
+#include <ros/console.h>
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <unistd.h>
+
+namespace moveit
+{
+namespace tools
+{
+namespace probes
+{
+namespace detail
+{
+std::atomic<bool> enabled(false);
+std::atomic<bool> tracing(false);
+thread_local RequestTrace* current_trace = nullptr;
+}
+
+/// @cond IGNORE
+namespace
+{
+// Counters are only written by the thread that owns them, so plain loads and stores suffice to update them.
+// They are atomic so that other threads can read them while statistics are aggregated.
+inline void add(std::atomic<std::uint64_t>& value, std::uint64_t delta)
+{
+  value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+inline std::size_t histogramBucket(std::uint64_t duration_ns)
+{
+  std::size_t bucket = 0;
+#ifdef __GNUC__
+  if (duration_ns > 1)
+    bucket = 63 - __builtin_clzll(duration_ns);
+#else
+  while (duration_ns >>= 1)
+    ++bucket;
+#endif
+  return std::min(bucket, HISTOGRAM_BUCKETS - 1);
+}
+
+struct Counters
+{
+  std::atomic<std::uint64_t> count;
+  std::atomic<std::uint64_t> timed;
+  std::atomic<std::uint64_t> total_ns;
+  std::atomic<std::uint64_t> shortest_ns;
+  std::atomic<std::uint64_t> longest_ns;
+  std::atomic<std::uint64_t> histogram[HISTOGRAM_BUCKETS];
+
+  void clear()
+  {
+    count.store(0, std::memory_order_relaxed);
+    timed.store(0, std::memory_order_relaxed);
+    total_ns.store(0, std::memory_order_relaxed);
+    shortest_ns.store(std::numeric_limits<std::uint64_t>::max(), std::memory_order_relaxed);
+    longest_ns.store(0, std::memory_order_relaxed);
+    for (std::size_t i = 0; i < HISTOGRAM_BUCKETS; ++i)
+      histogram[i].store(0, std::memory_order_relaxed);
+  }
+
+  // only called with the registry locked, for counters no thread writes to concurrently
+  void merge(const Counters& other)
+  {
+    add(count, other.count.load(std::memory_order_relaxed));
+    add(timed, other.timed.load(std::memory_order_relaxed));
+    add(total_ns, other.total_ns.load(std::memory_order_relaxed));
+    shortest_ns.store(std::min(shortest_ns.load(std::memory_order_relaxed),
+                               other.shortest_ns.load(std::memory_order_relaxed)),
+                      std::memory_order_relaxed);
+    longest_ns.store(
+        std::max(longest_ns.load(std::memory_order_relaxed), other.longest_ns.load(std::memory_order_relaxed)),
+        std::memory_order_relaxed);
+    for (std::size_t i = 0; i < HISTOGRAM_BUCKETS; ++i)
+      add(histogram[i], other.histogram[i].load(std::memory_order_relaxed));
+  }
+};
+
+std::string escape(const std::string& name)
+{
+  std::string result;
+  for (std::size_t i = 0; i < name.size(); ++i)
+  {
+    if (name[i] == '"' || name[i] == '\\')
+      result += '\\';
+    if (static_cast<unsigned char>(name[i]) >= 0x20)
+      result += name[i];
+  }
+  return result;
+}
+
+std::string padded(std::uint64_t fraction)
+{
+  char buffer[4] = { char('0' + fraction / 100), char('0' + fraction / 10 % 10), char('0' + fraction % 10), 0 };
+  return buffer;
+}
+
+// write one complete ("X") event of a Chrome trace; times are in nanoseconds
+void writeChromeEvent(std::ostream& out, bool first, const std::string& name, int pid, unsigned int thread,
+                      std::uint64_t start_ns, std::uint64_t duration_ns)
+{
+  out << (first ? "\n" : ",\n") << "{\"name\":\"" << escape(name) << "\",\"cat\":\"moveit\",\"ph\":\"X\""
+      << ",\"ts\":" << start_ns / 1000 << "." << padded(start_ns % 1000) << ",\"dur\":" << duration_ns / 1000 << "."
+      << padded(duration_ns % 1000) << ",\"pid\":" << pid << ",\"tid\":" << thread << "}";
+}
+
+struct TraceEvent
+{
+  ProbeId id;
+  unsigned int thread;
+  std::uint64_t start_ns;
+  std::uint64_t duration_ns;
+};
+
+struct ThreadData
+{
+  explicit ThreadData(unsigned int index) : index(index), events(nullptr), head(0)
+  {
+    clear();
+  }
+
+  ~ThreadData()
+  {
+    delete[] events.load(std::memory_order_relaxed);
+  }
+
+  void clear()
+  {
+    for (std::size_t i = 0; i < MAX_PROBES; ++i)
+      counters[i].clear();
+    head.store(0, std::memory_order_relaxed);
+  }
+
+  void trace(ProbeId id, std::uint64_t start_ns, std::uint64_t duration_ns)
+  {
+    // the ring buffer is only allocated for threads that record trace events
+    TraceEvent* buffer = events.load(std::memory_order_relaxed);
+    if (!buffer)
+    {
+      buffer = new TraceEvent[TRACE_BUFFER_SIZE];
+      events.store(buffer, std::memory_order_release);
+    }
+    std::uint64_t h = head.load(std::memory_order_relaxed);
+    TraceEvent& e = buffer[h % TRACE_BUFFER_SIZE];
+    e.id = id;
+    e.thread = index;
+    e.start_ns = start_ns;
+    e.duration_ns = duration_ns;
+    head.store(h + 1, std::memory_order_release);
+  }
+
+  template <typename Function>
+  void forEachEvent(const Function& f) const
+  {
+    const TraceEvent* buffer = events.load(std::memory_order_acquire);
+    std::uint64_t h = head.load(std::memory_order_acquire);
+    if (!buffer)
+      return;
+    for (std::uint64_t i = h > TRACE_BUFFER_SIZE ? h - TRACE_BUFFER_SIZE : 0; i < h; ++i)
+      f(buffer[i % TRACE_BUFFER_SIZE]);
+  }
+
+  unsigned int index;
+  Counters counters[MAX_PROBES];
+  std::atomic<TraceEvent*> events;
+  std::atomic<std::uint64_t> head;
+};
+
+class Registry
+{
+public:
+  Registry() : retired_(0), next_thread_index_(1)
+  {
+  }
+
+  ProbeId registerProbe(const std::string& name)
+  {
+    std::lock_guard<std::mutex> slock(lock_);
+    std::map<std::string, ProbeId>::const_iterator it = ids_.find(name);
+    if (it != ids_.end())
+      return it->second;
+    if (names_.size() >= MAX_PROBES)
+    {
+      ROS_WARN_NAMED("probes", "Cannot register probe '%s': at most %u probes are supported", name.c_str(),
+                     (unsigned int)MAX_PROBES);
+      return INVALID_PROBE;
+    }
+    ProbeId id = names_.size();
+    names_.push_back(name);
+    ids_[name] = id;
+    return id;
+  }
+
+  ThreadData* addThread()
+  {
+    std::lock_guard<std::mutex> slock(lock_);
+    threads_.push_back(new ThreadData(next_thread_index_++));
+    return threads_.back();
+  }
+
+  // fold the measurements of a thread that exits into the retired counters
+  void retireThread(ThreadData* data)
+  {
+    std::lock_guard<std::mutex> slock(lock_);
+    for (std::size_t i = 0; i < MAX_PROBES; ++i)
+      retired_.counters[i].merge(data->counters[i]);
+    data->forEachEvent([this](const TraceEvent& e) { retired_events_.push_back(e); });
+    while (retired_events_.size() > TRACE_BUFFER_SIZE)
+      retired_events_.pop_front();
+    threads_.erase(std::remove(threads_.begin(), threads_.end(), data), threads_.end());
+    delete data;
+  }
+
+  std::vector<ProbeStats> getStats()
+  {
+    std::lock_guard<std::mutex> slock(lock_);
+    std::vector<ProbeStats> stats;
+    for (std::size_t id = 0; id < names_.size(); ++id)
+    {
+      Counters combined;
+      combined.clear();
+      combined.merge(retired_.counters[id]);
+      for (std::size_t i = 0; i < threads_.size(); ++i)
+        combined.merge(threads_[i]->counters[id]);
+      if (combined.count.load(std::memory_order_relaxed) > 0)
+        stats.push_back(makeStats(names_[id], combined));
+    }
+    return stats;
+  }
+
+  std::vector<ProbeStats> getStats(const ThreadData& data)
+  {
+    std::lock_guard<std::mutex> slock(lock_);
+    std::vector<ProbeStats> stats;
+    for (std::size_t id = 0; id < names_.size(); ++id)
+      if (data.counters[id].count.load(std::memory_order_relaxed) > 0)
+        stats.push_back(makeStats(names_[id], data.counters[id]));
+    return stats;
+  }
+
+  std::vector<std::string> getNames()
+  {
+    std::lock_guard<std::mutex> slock(lock_);
+    return names_;
+  }
+
+  void reset()
+  {
+    std::lock_guard<std::mutex> slock(lock_);
+    retired_.clear();
+    retired_events_.clear();
+    for (std::size_t i = 0; i < threads_.size(); ++i)
+      threads_[i]->clear();
+  }
+
+  void writeChromeTrace(std::ostream& out)
+  {
+    std::lock_guard<std::mutex> slock(lock_);
+    const int pid = getpid();
+    bool first = true;
+    auto write_event = [&](const TraceEvent& e) {
+      if (e.id >= names_.size())
+        return;
+      writeChromeEvent(out, first, names_[e.id], pid, e.thread, e.start_ns, e.duration_ns);
+      first = false;
+    };
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    for (std::size_t i = 0; i < retired_events_.size(); ++i)
+      write_event(retired_events_[i]);
+    for (std::size_t i = 0; i < threads_.size(); ++i)
+      threads_[i]->forEachEvent(write_event);
+    out << "\n]}\n";
+  }
+
+private:
+  static ProbeStats makeStats(const std::string& name, const Counters& c)
+  {
+    ProbeStats s;
+    s.name = name;
+    s.count = c.count.load(std::memory_order_relaxed);
+    s.timed = c.timed.load(std::memory_order_relaxed);
+    s.total = c.total_ns.load(std::memory_order_relaxed) * 1e-9;
+    s.shortest = s.timed ? c.shortest_ns.load(std::memory_order_relaxed) * 1e-9 : 0.0;
+    s.longest = c.longest_ns.load(std::memory_order_relaxed) * 1e-9;
+    s.histogram.resize(HISTOGRAM_BUCKETS);
+    for (std::size_t i = 0; i < HISTOGRAM_BUCKETS; ++i)
+      s.histogram[i] = c.histogram[i].load(std::memory_order_relaxed);
+    return s;
+  }
+
+  std::mutex lock_;
+  std::vector<std::string> names_;
+  std::map<std::string, ProbeId> ids_;
+  std::vector<ThreadData*> threads_;
+  ThreadData retired_;
+  std::deque<TraceEvent> retired_events_;
+  unsigned int next_thread_index_;
+};
+
+// never destroyed, so that threads exiting during shutdown can still retire their data
+Registry& registry()
+{
+  static Registry* r = new Registry();
+  return *r;
+}
+
+struct ThreadHandle
+{
+  ThreadHandle() : data(nullptr)
+  {
+  }
+
+  ~ThreadHandle()
+  {
+    if (data)
+      registry().retireThread(data);
+  }
+
+  ThreadData* data;
+};
+
+thread_local ThreadHandle thread_handle;
+
+inline ThreadData& localData()
+{
+  if (!thread_handle.data)
+    thread_handle.data = registry().addThread();
+  return *thread_handle.data;
+}
+
+struct SortByTotal
+{
+  bool operator()(const ProbeStats& a, const ProbeStats& b) const
+  {
+    return a.total > b.total || (a.total == b.total && a.count > b.count);
+  }
+};
+}
+/// @endcond
+
+ProbeId registerProbe(const std::string& name)
+{
+  return registry().registerProbe(name);
+}
+
+void setEnabled(bool enabled)
+{
+  detail::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void setTracing(bool tracing)
+{
+  detail::tracing.store(tracing, std::memory_order_relaxed);
+}
+
+void count(ProbeId id, std::uint64_t times)
+{
+  if (id >= MAX_PROBES)
+    return;
+  add(localData().counters[id].count, times);
+  if (RequestTrace* trace = detail::current_trace)
+    trace->add(id, times, 0, false);
+}
+
+void record(ProbeId id, std::uint64_t start_ns, std::uint64_t duration_ns)
+{
+  if (id >= MAX_PROBES)
+    return;
+  ThreadData& data = localData();
+  Counters& c = data.counters[id];
+  add(c.count, 1);
+  add(c.timed, 1);
+  add(c.total_ns, duration_ns);
+  if (duration_ns < c.shortest_ns.load(std::memory_order_relaxed))
+    c.shortest_ns.store(duration_ns, std::memory_order_relaxed);
+  if (duration_ns > c.longest_ns.load(std::memory_order_relaxed))
+    c.longest_ns.store(duration_ns, std::memory_order_relaxed);
+  add(c.histogram[histogramBucket(duration_ns)], 1);
+  if (isTracing())
+    data.trace(id, start_ns, duration_ns);
+  if (RequestTrace* trace = detail::current_trace)
+    trace->add(id, 1, duration_ns, true);
+}
+
+std::vector<ProbeStats> getStats()
+{
+  return registry().getStats();
+}
+
+std::vector<ProbeStats> getThreadStats()
+{
+  return registry().getStats(localData());
+}
+
+double percentile(const ProbeStats& s, double fraction)
+{
+  std::uint64_t target = static_cast<std::uint64_t>(fraction * s.timed);
+  std::uint64_t seen = 0;
+  for (std::size_t i = 0; i < s.histogram.size(); ++i)
+  {
+    seen += s.histogram[i];
+    if (seen > target)
+      return std::min(static_cast<double>(2ull << i) * 1e-9, s.longest);
+  }
+  return s.longest;
+}
+
+void reset()
+{
+  registry().reset();
+}
+
+void printStats(std::ostream& out)
+{
+  std::vector<ProbeStats> stats = getStats();
+  std::sort(stats.begin(), stats.end(), SortByTotal());
+
+  out << std::endl << " *** Probe statistics" << std::endl;
+  for (std::size_t i = 0; i < stats.size(); ++i)
+  {
+    const ProbeStats& s = stats[i];
+    out << s.name << ": " << s.count << " hits";
+    if (s.timed > 0)
+      out << ", " << s.total << "s total, [" << s.shortest << "s --> " << s.longest << "s], " << s.total / s.timed
+          << "s on average, median < " << percentile(s, 0.5) << "s, 99% < " << percentile(s, 0.99) << "s";
+    out << std::endl;
+  }
+  out << std::endl;
+}
+
+void consoleStats()
+{
+  std::stringstream ss;
+  printStats(ss);
+  ROS_INFO_STREAM_NAMED("probes", ss.str());
+}
+
+void writeChromeTrace(std::ostream& out)
+{
+  registry().writeChromeTrace(out);
+}
+
+bool writeChromeTrace(const std::string& filename)
+{
+  std::ofstream out(filename.c_str());
+  if (!out.good())
+  {
+    ROS_ERROR_NAMED("probes", "Unable to open '%s' for writing the trace", filename.c_str());
+    return false;
+  }
+  writeChromeTrace(out);
+  out.close();
+  return !out.fail();
+}
+
+RequestTrace::RequestTrace(const std::string& id) : id_(id), start_ns_(detail::now())
+{
+  for (std::size_t i = 0; i < MAX_PROBES; ++i)
+  {
+    count_[i].store(0, std::memory_order_relaxed);
+    timed_[i].store(0, std::memory_order_relaxed);
+    total_ns_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+double RequestTrace::getElapsed() const
+{
+  return (detail::now() - start_ns_) * 1e-9;
+}
+
+void RequestTrace::addSpan(ProbeId id, std::uint64_t start_ns, std::uint64_t duration_ns)
+{
+  if (id >= MAX_PROBES)
+    return;
+  RecordedSpan span;
+  span.id = id;
+  span.thread = localData().index;
+  span.start_ns = start_ns;
+  span.duration_ns = duration_ns;
+  std::lock_guard<std::mutex> slock(lock_);
+  if (spans_.size() < MAX_TRACE_SPANS)
+    spans_.push_back(span);
+}
+
+void RequestTrace::add(ProbeId id, std::uint64_t times, std::uint64_t duration_ns, bool timed)
+{
+  if (id >= MAX_PROBES)
+    return;
+  // unlike the per-thread counters, these can be updated by several threads at once
+  count_[id].fetch_add(times, std::memory_order_relaxed);
+  if (timed)
+  {
+    timed_[id].fetch_add(times, std::memory_order_relaxed);
+    total_ns_[id].fetch_add(duration_ns, std::memory_order_relaxed);
+  }
+}
+
+std::vector<RequestTrace::Span> RequestTrace::getSpans() const
+{
+  std::vector<std::string> names = registry().getNames();
+  std::vector<Span> spans;
+  std::lock_guard<std::mutex> slock(lock_);
+  spans.reserve(spans_.size());
+  for (std::size_t i = 0; i < spans_.size(); ++i)
+  {
+    if (spans_[i].id >= names.size())
+      continue;
+    Span s;
+    s.name = names[spans_[i].id];
+    s.start = spans_[i].start_ns > start_ns_ ? (spans_[i].start_ns - start_ns_) * 1e-9 : 0.0;
+    s.duration = spans_[i].duration_ns * 1e-9;
+    s.thread = spans_[i].thread;
+    spans.push_back(s);
+  }
+  return spans;
+}
+
+std::vector<ProbeStats> RequestTrace::getStats() const
+{
+  std::vector<std::string> names = registry().getNames();
+  std::vector<ProbeStats> stats;
+  for (std::size_t id = 0; id < names.size(); ++id)
+  {
+    std::uint64_t count = count_[id].load(std::memory_order_relaxed);
+    if (count == 0)
+      continue;
+    ProbeStats s;
+    s.name = names[id];
+    s.count = count;
+    s.timed = timed_[id].load(std::memory_order_relaxed);
+    s.total = total_ns_[id].load(std::memory_order_relaxed) * 1e-9;
+    s.shortest = 0.0;
+    s.longest = 0.0;
+    stats.push_back(s);
+  }
+  std::sort(stats.begin(), stats.end(), SortByTotal());
+  return stats;
+}
+
+void RequestTrace::writeChromeTrace(std::ostream& out) const
+{
+  std::vector<std::string> names = registry().getNames();
+  const int pid = getpid();
+  std::lock_guard<std::mutex> slock(lock_);
+  out << "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"request\":\"" << escape(id_) << "\"},\"traceEvents\":[";
+  bool first = true;
+  for (std::size_t i = 0; i < spans_.size(); ++i)
+    if (spans_[i].id < names.size())
+    {
+      writeChromeEvent(out, first, names[spans_[i].id], pid, spans_[i].thread, spans_[i].start_ns,
+                       spans_[i].duration_ns);
+      first = false;
+    }
+  out << "\n]}\n";
+}
+
+bool RequestTrace::writeChromeTrace(const std::string& filename) const
+{
+  std::ofstream out(filename.c_str());
+  if (!out.good())
+  {
+    ROS_ERROR_NAMED("probes", "Unable to open '%s' for writing the trace of request '%s'", filename.c_str(),
+                    id_.c_str());
+    return false;
+  }
+  writeChromeTrace(out);
+  out.close();
+  return !out.fail();
+}
+
+}  // end of namespace probes
+}  // end of namespace tools
+}  // end of namespace moveit
@@ -0,0 +1,170 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#ifndef MOVEIT_REACHABILITY_MAP_REACHABILITY_MAP_
+#define MOVEIT_REACHABILITY_MAP_REACHABILITY_MAP_
+
+#include <moveit/robot_state/robot_state.h>
+#include <moveit/macros/class_forward.h>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <Eigen/Geometry>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace reachability_map
+{
+MOVEIT_CLASS_FORWARD(ReachabilityMap);
+
+/** \brief A voxel grid of the poses a group can reach with its tip link.
+
+    Poses are expressed relative to the base link of the group: the parent link of the group's root joint. For every
+    voxel, the map keeps one bit per approach direction, the direction of the z axis of the tip link, discretized into
+    DIRECTION_COUNT bins spread evenly over the sphere. A bit is set once some configuration of the group was found to
+    put the tip link inside the voxel, pointing along a direction of that bin.
+
+    Maps are meant to be built offline with sample() and solve(), saved, and loaded at runtime with load(), which maps
+    the file into memory instead of reading it. The map is conservative in one direction only: a cleared bit means no
+    configuration was found, not that none exists. */
+class ReachabilityMap
+{
+public:
+  /** \brief The number of approach direction bins kept per voxel */
+  static const unsigned int DIRECTION_COUNT = 32;
+
+  /** \brief Construct an empty map of the box [\e min_corner, \e max_corner] in the frame of \e base_link, with cubic
+      voxels of size \e resolution */
+  ReachabilityMap(const std::string& group_name, const std::string& base_link, const std::string& tip_link,
+                  const Eigen::Vector3d& min_corner, const Eigen::Vector3d& max_corner, double resolution);
+
+  /** \brief Construct an empty map for \e group, covering a cube around its base link that contains every pose the
+      tip link can reach, assuming the reach is at most the sum of the lengths of the group's link chain. Returns an
+      empty pointer if the group has no single tip link. */
+  static ReachabilityMapPtr create(const robot_model::JointModelGroup* group, double resolution);
+
+  /** \brief Map a file written by save() into memory. Returns an empty pointer and reports an error on failure. */
+  static ReachabilityMapPtr load(const std::string& filename);
+
+  /** \brief Write the map to \e filename */
+  bool save(const std::string& filename) const;
+
+  const std::string& getGroupName() const
+  {
+    return group_name_;
+  }
+
+  const std::string& getBaseLink() const
+  {
+    return base_link_;
+  }
+
+  const std::string& getTipLink() const
+  {
+    return tip_link_;
+  }
+
+  double getResolution() const
+  {
+    return resolution_;
+  }
+
+  const Eigen::Vector3d& getMinCorner() const
+  {
+    return min_corner_;
+  }
+
+  /** \brief The number of voxels along \e axis */
+  unsigned int getCellCount(unsigned int axis) const
+  {
+    return size_[axis];
+  }
+
+  /** \brief Record that the tip link can be at \e tip_pose, expressed in the frame of the base link */
+  void markReachable(const Eigen::Affine3d& tip_pose);
+
+  /** \brief True if the voxel and approach direction of \e tip_pose, expressed in the frame of the base link, were
+      found to be reachable */
+  bool isReachable(const Eigen::Affine3d& tip_pose) const;
+
+  /** \brief Like isReachable(), for a pose of the tip link expressed in the model frame; the base link is placed
+      according to \e state */
+  bool isReachable(const robot_state::RobotState& state, const Eigen::Affine3d& tip_pose) const;
+
+  /** \brief The fraction of approach directions found to be reachable at \e position, expressed in the frame of the
+      base link. This is 0 outside the map. */
+  double getReachabilityIndex(const Eigen::Vector3d& position) const;
+
+  /** \brief Fill the map with the tip poses of \e samples random configurations of the group, using \e threads
+      threads (0 for one per core). The other joints of the robot keep their values from \e state. */
+  void sample(const robot_state::RobotState& state, std::size_t samples, unsigned int threads = 0);
+
+  /** \brief Try IK for the center of every voxel and every approach direction not yet marked reachable, with
+      \e roll_steps rotations around the approach direction, using \e threads threads (0 for one per core). Voxels
+      without any reachable direction are skipped unless \e all_voxels is set, so this is best run after sample(). */
+  void solve(const robot_state::RobotState& state, unsigned int roll_steps = 4, bool all_voxels = false,
+             unsigned int threads = 0);
+
+  /** \brief The unit vector at the center of approach direction bin \e bin */
+  static const Eigen::Vector3d& getDirection(unsigned int bin);
+
+  /** \brief The approach direction bin that contains the unit vector \e direction */
+  static unsigned int getDirectionBin(const Eigen::Vector3d& direction);
+
+private:
+  ReachabilityMap();
+
+  bool getCellIndex(const Eigen::Vector3d& position, std::size_t& index) const;
+
+  /** \brief Copy mapped data into cells_, so that the map can be modified */
+  void makeWritable();
+
+  const robot_model::JointModelGroup* getGroup(const robot_state::RobotState& state) const;
+
+  std::string group_name_;
+  std::string base_link_;
+  std::string tip_link_;
+  Eigen::Vector3d min_corner_;
+  double resolution_;
+  unsigned int size_[3];
+
+  /** \brief The direction bits of each voxel, x varying fastest; either cells_ or the mapped file */
+  const std::uint32_t* data_;
+  std::vector<std::uint32_t> cells_;
+  std::unique_ptr<boost::iostreams::mapped_file_source> file_;
+};
+}
+
+#endif
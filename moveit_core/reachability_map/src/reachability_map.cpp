@@ -0,0 +1,392 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/reachability_map/reachability_map.h>
+#include <moveit/background_processing/thread_budget.h>
+#include <boost/math/constants/constants.hpp>
+#include <boost/thread.hpp>
+#include <ros/console.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace reachability_map
+{
+namespace
+{
+const char FILE_MAGIC[8] = { 'M', 'V', 'T', 'R', 'M', 'A', 'P', '1' };
+
+/** \brief The fixed size header at the start of a map file; the voxel data follows immediately */
+struct FileHeader
+{
+  char magic[8];
+  std::uint32_t direction_count;
+  std::uint32_t size[3];
+  double min_corner[3];
+  double resolution;
+  char group_name[128];
+  char base_link[128];
+  char tip_link[128];
+};
+// keeps the voxel data that follows the header aligned
+static_assert(sizeof(FileHeader) % 8 == 0, "FileHeader must be a multiple of 8 bytes");
+
+bool copyName(const std::string& name, char* field, std::size_t field_size)
+{
+  if (name.size() >= field_size)
+    return false;
+  std::memset(field, 0, field_size);
+  std::memcpy(field, name.c_str(), name.size());
+  return true;
+}
+
+std::string readName(const char* field, std::size_t field_size)
+{
+  return std::string(field, strnlen(field, field_size));
+}
+
+/** \brief The rotation with \e direction as its z axis, turned by \e roll around it */
+Eigen::Matrix3d directionRotation(const Eigen::Vector3d& direction, double roll)
+{
+  Eigen::Vector3d x = std::fabs(direction.x()) < 0.9 ? Eigen::Vector3d::UnitX() : Eigen::Vector3d::UnitY();
+  x = (x - direction * direction.dot(x)).normalized();
+  Eigen::Matrix3d r;
+  r.col(0) = x;
+  r.col(1) = direction.cross(x);
+  r.col(2) = direction;
+  return r * Eigen::AngleAxisd(roll, Eigen::Vector3d::UnitZ()).toRotationMatrix();
+}
+}
+
+ReachabilityMap::ReachabilityMap() : resolution_(0.0), data_(NULL)
+{
+  size_[0] = size_[1] = size_[2] = 0;
+}
+
+ReachabilityMap::ReachabilityMap(const std::string& group_name, const std::string& base_link,
+                                 const std::string& tip_link, const Eigen::Vector3d& min_corner,
+                                 const Eigen::Vector3d& max_corner, double resolution)
+  : group_name_(group_name), base_link_(base_link), tip_link_(tip_link), min_corner_(min_corner)
+  , resolution_(resolution)
+{
+  for (unsigned int i = 0; i < 3; ++i)
+    size_[i] = std::max(1, static_cast<int>(std::ceil((max_corner[i] - min_corner[i]) / resolution_)));
+  cells_.resize(static_cast<std::size_t>(size_[0]) * size_[1] * size_[2], 0);
+  data_ = cells_.data();
+}
+
+ReachabilityMapPtr ReachabilityMap::create(const robot_model::JointModelGroup* group, double resolution)
+{
+  std::string tip;
+  const kinematics::KinematicsBaseConstPtr& solver = group->getSolverInstance();
+  if (solver && solver->getTipFrames().size() == 1)
+    tip = solver->getTipFrames()[0];
+  else if (group->isChain() && !group->getLinkModels().empty())
+    tip = group->getLinkModels().back()->getName();
+  if (!tip.empty() && tip[0] == '/')
+    tip = tip.substr(1);
+  if (tip.empty() || !group->getParentModel().hasLinkModel(tip))
+  {
+    ROS_ERROR_NAMED("reachability_map", "Group '%s' does not have a single tip link", group->getName().c_str());
+    return ReachabilityMapPtr();
+  }
+
+  const robot_model::LinkModel* base = group->getCommonRoot()->getParentLinkModel();
+  const std::string& base_link = base ? base->getName() : group->getParentModel().getModelFrame();
+
+  // the tip cannot be further from the base than the sum of the offsets between the joints of the chain
+  double reach = resolution;
+  const std::vector<const robot_model::LinkModel*>& links = group->getLinkModels();
+  for (std::size_t i = 0; i < links.size(); ++i)
+    reach += links[i]->getJointOriginTransform().translation().norm();
+  return ReachabilityMapPtr(new ReachabilityMap(group->getName(), base_link, tip, -Eigen::Vector3d::Constant(reach),
+                                                Eigen::Vector3d::Constant(reach), resolution));
+}
+
+ReachabilityMapPtr ReachabilityMap::load(const std::string& filename)
+{
+  ReachabilityMapPtr map(new ReachabilityMap());
+  try
+  {
+    map->file_.reset(new boost::iostreams::mapped_file_source(filename));
+  }
+  catch (std::exception& ex)
+  {
+    ROS_ERROR_NAMED("reachability_map", "Unable to map reachability map '%s': %s", filename.c_str(), ex.what());
+    return ReachabilityMapPtr();
+  }
+
+  FileHeader header;
+  if (map->file_->size() < sizeof(header))
+  {
+    ROS_ERROR_NAMED("reachability_map", "File '%s' is not a reachability map", filename.c_str());
+    return ReachabilityMapPtr();
+  }
+  std::memcpy(&header, map->file_->data(), sizeof(header));
+  if (std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0 || header.direction_count != DIRECTION_COUNT)
+  {
+    ROS_ERROR_NAMED("reachability_map", "File '%s' is not a reachability map of a supported version",
+                    filename.c_str());
+    return ReachabilityMapPtr();
+  }
+
+  std::size_t cell_count = 1;
+  for (unsigned int i = 0; i < 3; ++i)
+  {
+    map->size_[i] = header.size[i];
+    map->min_corner_[i] = header.min_corner[i];
+    cell_count *= header.size[i];
+  }
+  if (map->file_->size() != sizeof(header) + cell_count * sizeof(std::uint32_t))
+  {
+    ROS_ERROR_NAMED("reachability_map", "Reachability map '%s' is truncated", filename.c_str());
+    return ReachabilityMapPtr();
+  }
+  map->resolution_ = header.resolution;
+  map->group_name_ = readName(header.group_name, sizeof(header.group_name));
+  map->base_link_ = readName(header.base_link, sizeof(header.base_link));
+  map->tip_link_ = readName(header.tip_link, sizeof(header.tip_link));
+  map->data_ = reinterpret_cast<const std::uint32_t*>(map->file_->data() + sizeof(header));
+  return map;
+}
+
+bool ReachabilityMap::save(const std::string& filename) const
+{
+  FileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+  header.direction_count = DIRECTION_COUNT;
+  for (unsigned int i = 0; i < 3; ++i)
+  {
+    header.size[i] = size_[i];
+    header.min_corner[i] = min_corner_[i];
+  }
+  header.resolution = resolution_;
+  if (!copyName(group_name_, header.group_name, sizeof(header.group_name)) ||
+      !copyName(base_link_, header.base_link, sizeof(header.base_link)) ||
+      !copyName(tip_link_, header.tip_link, sizeof(header.tip_link)))
+  {
+    ROS_ERROR_NAMED("reachability_map", "Names are too long to be stored in a reachability map");
+    return false;
+  }
+
+  std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(data_),
+            static_cast<std::size_t>(size_[0]) * size_[1] * size_[2] * sizeof(std::uint32_t));
+  if (!out)
+  {
+    ROS_ERROR_NAMED("reachability_map", "Unable to write reachability map '%s'", filename.c_str());
+    return false;
+  }
+  return true;
+}
+
+const Eigen::Vector3d& ReachabilityMap::getDirection(unsigned int bin)
+{
+  // a Fibonacci lattice spreads the bin centers evenly over the sphere
+  static const EigenSTL::vector_Vector3d directions = []() {
+    EigenSTL::vector_Vector3d d(DIRECTION_COUNT);
+    const double golden_angle = boost::math::constants::pi<double>() * (3.0 - std::sqrt(5.0));
+    for (unsigned int i = 0; i < DIRECTION_COUNT; ++i)
+    {
+      double z = 1.0 - (2.0 * i + 1.0) / DIRECTION_COUNT;
+      double r = std::sqrt(1.0 - z * z);
+      d[i] = Eigen::Vector3d(r * std::cos(golden_angle * i), r * std::sin(golden_angle * i), z);
+    }
+    return d;
+  }();
+  return directions[bin];
+}
+
+unsigned int ReachabilityMap::getDirectionBin(const Eigen::Vector3d& direction)
+{
+  unsigned int best = 0;
+  double best_dot = -2.0;
+  for (unsigned int i = 0; i < DIRECTION_COUNT; ++i)
+  {
+    double dot = getDirection(i).dot(direction);
+    if (dot > best_dot)
+    {
+      best_dot = dot;
+      best = i;
+    }
+  }
+  return best;
+}
+
+bool ReachabilityMap::getCellIndex(const Eigen::Vector3d& position, std::size_t& index) const
+{
+  std::size_t cell[3];
+  for (unsigned int i = 0; i < 3; ++i)
+  {
+    double c = std::floor((position[i] - min_corner_[i]) / resolution_);
+    if (!(c >= 0.0 && c < size_[i]))
+      return false;
+    cell[i] = static_cast<std::size_t>(c);
+  }
+  index = cell[0] + size_[0] * (cell[1] + size_[1] * cell[2]);
+  return true;
+}
+
+void ReachabilityMap::makeWritable()
+{
+  if (!file_)
+    return;
+  cells_.assign(data_, data_ + static_cast<std::size_t>(size_[0]) * size_[1] * size_[2]);
+  data_ = cells_.data();
+  file_.reset();
+}
+
+void ReachabilityMap::markReachable(const Eigen::Affine3d& tip_pose)
+{
+  std::size_t index;
+  if (!getCellIndex(tip_pose.translation(), index))
+    return;
+  makeWritable();
+  cells_[index] |= 1u << getDirectionBin(tip_pose.linear().col(2));
+}
+
+bool ReachabilityMap::isReachable(const Eigen::Affine3d& tip_pose) const
+{
+  std::size_t index;
+  if (!getCellIndex(tip_pose.translation(), index))
+    return false;
+  return data_[index] & (1u << getDirectionBin(tip_pose.linear().col(2)));
+}
+
+bool ReachabilityMap::isReachable(const robot_state::RobotState& state, const Eigen::Affine3d& tip_pose) const
+{
+  return isReachable(state.getFrameTransform(base_link_).inverse(Eigen::Isometry) * tip_pose);
+}
+
+double ReachabilityMap::getReachabilityIndex(const Eigen::Vector3d& position) const
+{
+  std::size_t index;
+  if (!getCellIndex(position, index))
+    return 0.0;
+  std::uint32_t bits = data_[index];
+  unsigned int count = 0;
+  for (; bits; bits &= bits - 1)
+    ++count;
+  return static_cast<double>(count) / DIRECTION_COUNT;
+}
+
+const robot_model::JointModelGroup* ReachabilityMap::getGroup(const robot_state::RobotState& state) const
+{
+  const robot_model::JointModelGroup* group = state.getRobotModel()->getJointModelGroup(group_name_);
+  if (!group)
+    ROS_ERROR_NAMED("reachability_map", "Robot has no group '%s'", group_name_.c_str());
+  return group;
+}
+
+void ReachabilityMap::sample(const robot_state::RobotState& state, std::size_t samples, unsigned int threads)
+{
+  const robot_model::JointModelGroup* group = getGroup(state);
+  if (!group)
+    return;
+  makeWritable();
+  moveit::tools::ThreadBudget::Reservation reservation("reachability_map", threads);
+  threads = reservation.getThreads();
+
+  // every thread marks its samples in a grid of its own, merged when it is done
+  boost::mutex merge_lock;
+  boost::thread_group workers;
+  for (unsigned int t = 0; t < threads; ++t)
+    workers.create_thread([this, &state, &merge_lock, group, samples, threads, t]() {
+      robot_state::RobotState work_state(state);
+      random_numbers::RandomNumberGenerator rng(t + 1);
+      std::vector<std::uint32_t> cells(cells_.size(), 0);
+      for (std::size_t i = t; i < samples; i += threads)
+      {
+        work_state.setToRandomPositions(group, rng);
+        work_state.updateLinkTransforms();
+        Eigen::Affine3d pose = work_state.getGlobalLinkTransform(base_link_).inverse(Eigen::Isometry) *
+                               work_state.getGlobalLinkTransform(tip_link_);
+        std::size_t index;
+        if (getCellIndex(pose.translation(), index))
+          cells[index] |= 1u << getDirectionBin(pose.linear().col(2));
+      }
+      boost::mutex::scoped_lock slock(merge_lock);
+      for (std::size_t i = 0; i < cells.size(); ++i)
+        cells_[i] |= cells[i];
+    });
+  workers.join_all();
+}
+
+void ReachabilityMap::solve(const robot_state::RobotState& state, unsigned int roll_steps, bool all_voxels,
+                            unsigned int threads)
+{
+  const robot_model::JointModelGroup* group = getGroup(state);
+  if (!group)
+    return;
+  makeWritable();
+  moveit::tools::ThreadBudget::Reservation reservation("reachability_map", threads);
+  threads = reservation.getThreads();
+  roll_steps = std::max(1u, roll_steps);
+
+  // voxels are interleaved between threads; each voxel is only ever written by one of them
+  boost::thread_group workers;
+  for (unsigned int t = 0; t < threads; ++t)
+    workers.create_thread([this, &state, group, roll_steps, all_voxels, threads, t]() {
+      robot_state::RobotState work_state(state);
+      work_state.update();
+      const Eigen::Affine3d base = work_state.getGlobalLinkTransform(base_link_);
+      const double roll_step = 2.0 * boost::math::constants::pi<double>() / roll_steps;
+      for (std::size_t i = t; i < cells_.size(); i += threads)
+      {
+        if (!all_voxels && cells_[i] == 0)
+          continue;
+        Eigen::Affine3d pose = Eigen::Affine3d::Identity();
+        pose.translation() = min_corner_ + resolution_ * (Eigen::Vector3d(i % size_[0], (i / size_[0]) % size_[1],
+                                                                           i / (size_[0] * size_[1])) +
+                                                          Eigen::Vector3d::Constant(0.5));
+        for (unsigned int bin = 0; bin < DIRECTION_COUNT; ++bin)
+          if (!(cells_[i] & (1u << bin)))
+            for (unsigned int r = 0; r < roll_steps; ++r)
+            {
+              pose.linear() = directionRotation(getDirection(bin), r * roll_step);
+              if (work_state.setFromIK(group, base * pose, tip_link_, 1, 0.0))
+              {
+                cells_[i] |= 1u << bin;
+                break;
+              }
+            }
+      }
+    });
+  workers.join_all();
+}
+}
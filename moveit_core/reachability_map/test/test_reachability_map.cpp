@@ -0,0 +1,114 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/reachability_map/reachability_map.h>
+#include <gtest/gtest.h>
+#include <boost/filesystem.hpp>
+
+using namespace reachability_map;
+
+TEST(ReachabilityMap, DirectionBins)
+{
+  for (unsigned int i = 0; i < ReachabilityMap::DIRECTION_COUNT; ++i)
+  {
+    EXPECT_NEAR(ReachabilityMap::getDirection(i).norm(), 1.0, 1e-9);
+    EXPECT_EQ(i, ReachabilityMap::getDirectionBin(ReachabilityMap::getDirection(i)));
+  }
+}
+
+TEST(ReachabilityMap, MarkAndQuery)
+{
+  ReachabilityMap map("arm", "base", "tip", Eigen::Vector3d(-1.0, -1.0, -1.0), Eigen::Vector3d(1.0, 1.0, 1.0), 0.1);
+  EXPECT_EQ(20u, map.getCellCount(0));
+  EXPECT_EQ(20u, map.getCellCount(2));
+
+  Eigen::Affine3d pose = Eigen::Affine3d::Identity();
+  pose.translation() = Eigen::Vector3d(0.33, -0.21, 0.5);
+  EXPECT_FALSE(map.isReachable(pose));
+  EXPECT_EQ(0.0, map.getReachabilityIndex(pose.translation()));
+
+  map.markReachable(pose);
+  EXPECT_TRUE(map.isReachable(pose));
+  EXPECT_EQ(1.0 / ReachabilityMap::DIRECTION_COUNT, map.getReachabilityIndex(pose.translation()));
+
+  // same voxel, opposite approach direction
+  Eigen::Affine3d flipped = pose * Eigen::AngleAxisd(M_PI, Eigen::Vector3d::UnitX());
+  EXPECT_FALSE(map.isReachable(flipped));
+
+  // same direction, rotated around it
+  Eigen::Affine3d rolled = pose * Eigen::AngleAxisd(1.0, Eigen::Vector3d::UnitZ());
+  EXPECT_TRUE(map.isReachable(rolled));
+
+  // outside of the map
+  pose.translation() = Eigen::Vector3d(1.5, 0.0, 0.0);
+  map.markReachable(pose);
+  EXPECT_FALSE(map.isReachable(pose));
+}
+
+TEST(ReachabilityMap, SaveAndLoad)
+{
+  ReachabilityMap map("arm", "base", "tip", Eigen::Vector3d(-0.5, -0.5, 0.0), Eigen::Vector3d(0.5, 0.5, 1.0), 0.05);
+  Eigen::Affine3d pose(Eigen::AngleAxisd(0.4, Eigen::Vector3d::UnitY()));
+  pose.translation() = Eigen::Vector3d(0.1, 0.2, 0.3);
+  map.markReachable(pose);
+
+  std::string filename = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+  ASSERT_TRUE(map.save(filename));
+
+  ReachabilityMapPtr loaded = ReachabilityMap::load(filename);
+  ASSERT_TRUE(static_cast<bool>(loaded));
+  EXPECT_EQ("arm", loaded->getGroupName());
+  EXPECT_EQ("base", loaded->getBaseLink());
+  EXPECT_EQ("tip", loaded->getTipLink());
+  EXPECT_EQ(map.getResolution(), loaded->getResolution());
+  for (unsigned int i = 0; i < 3; ++i)
+    EXPECT_EQ(map.getCellCount(i), loaded->getCellCount(i));
+  EXPECT_TRUE(loaded->isReachable(pose));
+  EXPECT_FALSE(loaded->isReachable(Eigen::Affine3d::Identity()));
+
+  // a mapped map can still be extended
+  loaded->markReachable(Eigen::Affine3d::Identity());
+  EXPECT_TRUE(loaded->isReachable(Eigen::Affine3d::Identity()));
+  EXPECT_TRUE(loaded->isReachable(pose));
+  boost::filesystem::remove(filename);
+
+  EXPECT_FALSE(static_cast<bool>(ReachabilityMap::load(filename)));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -44,6 +44,7 @@
 #include <iostream>
 #include <moveit_msgs/JointLimits.h>
 #include <random_numbers/random_numbers.h>
+#include <moveit/robot_model/thread_random_numbers.h>
 #include <Eigen/Geometry>
 
 namespace moveit
@@ -250,6 +251,13 @@ public:
     getVariableRandomPositions(rng, values, variable_bounds_);
   }
 
+  /** \brief Provide random values for the joint variables (within default bounds), drawn from the random number
+   * generator of the calling thread. Enough memory is assumed to be allocated. */
+  void getVariableRandomPositions(double* values) const
+  {
+    getVariableRandomPositions(getThreadRandomNumberGenerator(), values, variable_bounds_);
+  }
+
   /** \brief Provide random values for the joint variables (within specified bounds). Enough memory is assumed to be
    * allocated. */
   virtual void getVariableRandomPositions(random_numbers::RandomNumberGenerator& rng, double* values,
@@ -297,6 +305,31 @@ public:
       Return true if changes were made. */
   virtual bool enforcePositionBounds(double* values, const Bounds& other_bounds) const = 0;
 
+  /** \brief Check a single position \e value against \e bounds, up to some margin. This is how prismatic and
+      non-continuous revolute joints check their bounds; it is exposed so that loops over such joints can be written
+      without virtual calls. */
+  static bool satisfiesSinglePositionBounds(double value, const VariableBounds& bounds, double margin)
+  {
+    return !(value < bounds.min_position_ - margin || value > bounds.max_position_ + margin);
+  }
+
+  /** \brief Clamp a single position \e value to \e bounds, the way prismatic and non-continuous revolute joints
+      enforce their bounds. Return true if \e value was changed. */
+  static bool enforceSinglePositionBounds(double& value, const VariableBounds& bounds)
+  {
+    if (value < bounds.min_position_)
+    {
+      value = bounds.min_position_;
+      return true;
+    }
+    if (value > bounds.max_position_)
+    {
+      value = bounds.max_position_;
+      return true;
+    }
+    return false;
+  }
+
   /** \brief Check if the set of velocities for the variables of this joint are within bounds. */
   bool satisfiesVelocityBounds(const double* values, double margin = 0.0) const
   {
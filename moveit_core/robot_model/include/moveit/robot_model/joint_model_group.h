@@ -41,6 +41,7 @@
 #include <moveit/robot_model/joint_model.h>
 #include <moveit/robot_model/link_model.h>
 #include <moveit/kinematics_base/kinematics_base.h>
+#include <moveit/macros/class_forward.h>
 #include <srdfdom/model.h>
 #include <boost/function.hpp>
 #include <set>
@@ -51,6 +52,8 @@ namespace core
 {
 class RobotModel;
 class JointModelGroup;
+class RevoluteJointModel;
+MOVEIT_CLASS_FORWARD(IKSeedGenerator);
 
 /** \brief Function type that allocates a kinematics solver for a particular group */
 typedef boost::function<kinematics::KinematicsBasePtr(const JointModelGroup*)> SolverAllocatorFn;
@@ -333,6 +336,13 @@ public:
     getVariableRandomPositions(rng, &values[0], active_joint_models_bounds_);
   }
 
+  /** \brief Compute random values for the state of the joint group, using the random number generator of the calling
+   * thread */
+  void getVariableRandomPositions(std::vector<double>& values) const
+  {
+    getVariableRandomPositions(getThreadRandomNumberGenerator(), values);
+  }
+
   /** \brief Compute random values for the state of the joint group */
   void getVariableRandomPositionsNearBy(random_numbers::RandomNumberGenerator& rng, double* values, const double* near,
                                         const double distance) const
@@ -513,6 +523,14 @@ public:
     return active_joint_models_bounds_;
   }
 
+  /** \brief For each active joint, whether it is a prismatic or a non-continuous revolute joint. The single position of
+      such a joint is clamped to its bounds, so its bounds are checked and enforced inline instead of through a virtual
+      call. */
+  const std::vector<unsigned char>& getActiveJointModelsSimpleBounds() const
+  {
+    return active_joint_models_simple_bounds_;
+  }
+
   const std::pair<KinematicsSolver, KinematicsSolverMap>& getGroupKinematics() const
   {
     return group_kinematics_;
@@ -563,6 +581,34 @@ public:
   /** \brief Set the default IK attempts */
   void setDefaultIKAttempts(unsigned int ik_attempts);
 
+  /** \brief Get the generator of the seeds RobotState::setFromIK() retries from; empty if random seeds are used */
+  const IKSeedGeneratorConstPtr& getIKSeedGenerator() const
+  {
+    return ik_seed_generator_;
+  }
+
+  /** \brief Set the generator of the seeds RobotState::setFromIK() retries from after the first attempt, which
+      always starts at the current state. An empty pointer restores random seeds. */
+  void setIKSeedGenerator(const IKSeedGeneratorConstPtr& generator)
+  {
+    ik_seed_generator_ = generator;
+  }
+
+  /** \brief Get the number of threads RobotState::setFromIK() runs attempts on */
+  unsigned int getIKSeedThreads() const
+  {
+    return ik_seed_threads_;
+  }
+
+  /** \brief Let RobotState::setFromIK() run up to \e threads attempts at once, each from its own seed, and keep the
+      first solution that passes the validity callback (0 for one thread per core). Only use this with kinematics
+      solvers whose searchPositionIK() can be called concurrently, and validity callbacks that are thread safe. The
+      default is 1, which tries the seeds one after the other. */
+  void setIKSeedThreads(unsigned int threads)
+  {
+    ik_seed_threads_ = threads;
+  }
+
   /** \brief Return the mapping between the order of the joints in this group and the order of the joints in the
      kinematics solver.
       An element bijection[i] at index \e i in this array, maps the variable at index bijection[i] in this group to
@@ -636,6 +682,9 @@ protected:
   /** \brief The bounds for all the active joint models */
   JointBoundsVector active_joint_models_bounds_;
 
+  /** \brief For each active joint model, whether its bounds are enforced by clamping a single position */
+  std::vector<unsigned char> active_joint_models_simple_bounds_;
+
   /** \brief The list of index values this group includes, with respect to a full robot state; this includes mimic
    * joints. */
   std::vector<int> variable_index_list_;
@@ -720,6 +769,19 @@ protected:
 
   bool is_single_dof_;
 
+  /** \brief True if all active joints are revolute or prismatic and there are no mimic joints. The group state then
+      holds one variable per active joint and distance() and interpolate() use flat loops over the variables instead
+      of calling the joint models */
+  bool use_flat_kernels_;
+
+  /** \brief For the flat kernels: the distance factor of each variable; 0 for continuous joints, which wrap around and
+      are handled separately */
+  std::vector<double> flat_distance_factors_;
+
+  /** \brief For the flat kernels: the variables of continuous joints, and the joints themselves */
+  std::vector<std::size_t> flat_continuous_variables_;
+  std::vector<const RevoluteJointModel*> flat_continuous_joints_;
+
   struct GroupMimicUpdate
   {
     GroupMimicUpdate(int s, int d, double f, double o) : src(s), dest(d), factor(f), offset(o)
@@ -735,6 +797,10 @@ protected:
 
   std::pair<KinematicsSolver, KinematicsSolverMap> group_kinematics_;
 
+  /** \brief The seeds setFromIK() retries from, and the number of threads it tries them on */
+  IKSeedGeneratorConstPtr ik_seed_generator_;
+  unsigned int ik_seed_threads_;
+
   srdf::Model::Group config_;
 
   /** \brief The set of default states specified for this group in the SRDF */
@@ -52,8 +52,14 @@
 #include <moveit/robot_model/prismatic_joint_model.h>
 
 #include <Eigen/Geometry>
+#include <boost/function.hpp>
 #include <iostream>
 
+namespace shapes
+{
+class Mesh;
+}
+
 /** \brief Main namespace for MoveIt! */
 namespace moveit
 {
@@ -67,9 +73,17 @@ MOVEIT_CLASS_FORWARD(RobotModel);
 class RobotModel
 {
 public:
+  /** \brief Loads the mesh \e resource scaled by \e scale; returns NULL on failure */
+  typedef boost::function<shapes::Mesh*(const std::string& resource, const Eigen::Vector3d& scale)> MeshLoaderFn;
+
   /** \brief Construct a kinematic model from a parsed description and a list of planning groups */
   RobotModel(const urdf::ModelInterfaceSharedPtr& urdf_model, const srdf::ModelConstSharedPtr& srdf_model);
 
+  /** \brief Construct a kinematic model from a parsed description and a list of planning groups, loading the meshes
+      of the links with \e mesh_loader instead of shapes::createMeshFromResource() (e.g. from a cache) */
+  RobotModel(const urdf::ModelInterfaceSharedPtr& urdf_model, const srdf::ModelConstSharedPtr& srdf_model,
+             const MeshLoaderFn& mesh_loader);
+
   /** \brief Destructor. Clear all memory. */
   ~RobotModel();
 
@@ -415,6 +429,14 @@ public:
     return active_joint_models_bounds_;
   }
 
+  /** \brief For each active joint, whether it is a prismatic or a non-continuous revolute joint. The single position of
+      such a joint is clamped to its bounds, so its bounds are checked and enforced inline instead of through a virtual
+      call. */
+  const std::vector<unsigned char>& getActiveJointModelsSimpleBounds() const
+  {
+    return active_joint_models_simple_bounds_;
+  }
+
   void getMissingVariableNames(const std::vector<std::string>& variables,
                                std::vector<std::string>& missing_variables) const;
 
@@ -457,6 +479,9 @@ protected:
 
   urdf::ModelInterfaceSharedPtr urdf_;
 
+  /** \brief Used to load the meshes of links while the model is built; shapes::createMeshFromResource() if empty */
+  MeshLoaderFn mesh_loader_;
+
   // LINKS
 
   /** \brief The first physical link for the robot */
@@ -544,6 +569,9 @@ protected:
   /** \brief The bounds for all the active joint models */
   JointBoundsVector active_joint_models_bounds_;
 
+  /** \brief For each active joint model, whether its bounds are enforced by clamping a single position */
+  std::vector<unsigned char> active_joint_models_simple_bounds_;
+
   /** \brief The joints that correspond to each variable index */
   std::vector<const JointModel*> joints_of_variable_;
 
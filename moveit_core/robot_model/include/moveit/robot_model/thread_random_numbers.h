@@ -0,0 +1,60 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef MOVEIT_ROBOT_MODEL_THREAD_RANDOM_NUMBERS_
+#define MOVEIT_ROBOT_MODEL_THREAD_RANDOM_NUMBERS_
+
+#include <random_numbers/random_numbers.h>
+#include <cstdint>
+
+namespace moveit
+{
+namespace core
+{
+/** \brief Get the random number generator of the calling thread. It is created on first use, so sampling code can
+    draw random numbers without allocating and seeding a generator per state or sampler, and without sharing one
+    between threads. Unless a seed base was set with setRandomSeedBase(), the generator gets a random seed. */
+random_numbers::RandomNumberGenerator& getThreadRandomNumberGenerator();
+
+/** \brief Replace the random number generator of the calling thread by one seeded with \e seed. Seeding each worker
+    thread this way makes its random numbers reproducible regardless of the order in which the threads start. */
+void setThreadRandomSeed(std::uint32_t seed);
+
+/** \brief Seed the random number generators created from now on (by threads that did not use theirs yet) with
+    \e seed, \e seed + 1, ... in the order in which they are created */
+void setRandomSeedBase(std::uint32_t seed);
+}
+}
+
+#endif
@@ -41,6 +41,7 @@
 #include <moveit/exceptions/exceptions.h>
 #include <boost/lexical_cast.hpp>
 #include <algorithm>
+#include <cmath>
 #include "order_robot_model_items.inc"
 
 namespace moveit
@@ -106,6 +107,7 @@ JointModelGroup::JointModelGroup(const std::string& group_name, const srdf::Mode
   , is_contiguous_index_list_(true)
   , is_chain_(false)
   , is_single_dof_(true)
+  , ik_seed_threads_(1)
   , config_(config)
 {
   // sort joints in Depth-First order
@@ -131,6 +133,10 @@ JointModelGroup::JointModelGroup(const std::string& group_name, const srdf::Mode
         active_joint_model_name_vector_.push_back(joint_model_vector_[i]->getName());
         active_joint_model_start_index_.push_back(variable_count_);
         active_joint_models_bounds_.push_back(&joint_model_vector_[i]->getVariableBounds());
+        active_joint_models_simple_bounds_.push_back(
+            joint_model_vector_[i]->getType() == JointModel::PRISMATIC ||
+            (joint_model_vector_[i]->getType() == JointModel::REVOLUTE &&
+             !static_cast<const RevoluteJointModel*>(joint_model_vector_[i])->isContinuous()));
       }
       else
         mimic_joints_.push_back(joint_model_vector_[i]);
@@ -179,6 +185,26 @@ JointModelGroup::JointModelGroup(const std::string& group_name, const srdf::Mode
         break;
       }
 
+  // groups of revolute and prismatic joints only (most arms) evaluate distances and interpolate with flat loops
+  use_flat_kernels_ = !active_joint_model_vector_.empty() && mimic_joints_.empty();
+  for (std::size_t i = 0; use_flat_kernels_ && i < active_joint_model_vector_.size(); ++i)
+    if (active_joint_model_vector_[i]->getType() != JointModel::REVOLUTE &&
+        active_joint_model_vector_[i]->getType() != JointModel::PRISMATIC)
+      use_flat_kernels_ = false;
+  if (use_flat_kernels_)
+    for (std::size_t i = 0; i < active_joint_model_vector_.size(); ++i)
+    {
+      const JointModel* joint = active_joint_model_vector_[i];
+      if (joint->getType() == JointModel::REVOLUTE && static_cast<const RevoluteJointModel*>(joint)->isContinuous())
+      {
+        flat_distance_factors_.push_back(0.0);
+        flat_continuous_variables_.push_back(i);
+        flat_continuous_joints_.push_back(static_cast<const RevoluteJointModel*>(joint));
+      }
+      else
+        flat_distance_factors_.push_back(joint->getDistanceFactor());
+    }
+
   // when updating/sampling a group state only, only mimic joints that have their parent within the group get updated.
   for (std::size_t i = 0; i < mimic_joints_.size(); ++i)
     // if the joint we mimic is also in this group, we will need to do updates when sampling
@@ -376,9 +402,17 @@ bool JointModelGroup::satisfiesPositionBounds(const double* state, const JointBo
 {
   assert(active_joint_bounds.size() == active_joint_model_vector_.size());
   for (std::size_t i = 0; i < active_joint_model_vector_.size(); ++i)
-    if (!active_joint_model_vector_[i]->satisfiesPositionBounds(state + active_joint_model_start_index_[i],
-                                                                *active_joint_bounds[i], margin))
+  {
+    if (active_joint_models_simple_bounds_[i])
+    {
+      if (!JointModel::satisfiesSinglePositionBounds(state[active_joint_model_start_index_[i]],
+                                                     (*active_joint_bounds[i])[0], margin))
+        return false;
+    }
+    else if (!active_joint_model_vector_[i]->satisfiesPositionBounds(state + active_joint_model_start_index_[i],
+                                                                     *active_joint_bounds[i], margin))
       return false;
+  }
   return true;
 }
 
@@ -387,9 +421,17 @@ bool JointModelGroup::enforcePositionBounds(double* state, const JointBoundsVect
   assert(active_joint_bounds.size() == active_joint_model_vector_.size());
   bool change = false;
   for (std::size_t i = 0; i < active_joint_model_vector_.size(); ++i)
-    if (active_joint_model_vector_[i]->enforcePositionBounds(state + active_joint_model_start_index_[i],
-                                                             *active_joint_bounds[i]))
+  {
+    if (active_joint_models_simple_bounds_[i])
+    {
+      if (JointModel::enforceSinglePositionBounds(state[active_joint_model_start_index_[i]],
+                                                  (*active_joint_bounds[i])[0]))
+        change = true;
+    }
+    else if (active_joint_model_vector_[i]->enforcePositionBounds(state + active_joint_model_start_index_[i],
+                                                                  *active_joint_bounds[i]))
       change = true;
+  }
   if (change)
     updateMimicJoints(state);
   return change;
@@ -407,6 +449,22 @@ double JointModelGroup::getMaximumExtent(const JointBoundsVector& active_joint_b
 double JointModelGroup::distance(const double* state1, const double* state2) const
 {
   double d = 0.0;
+  if (use_flat_kernels_)
+  {
+    // this loop has no calls and no branches, so the compiler can vectorize it
+    const std::size_t n = flat_distance_factors_.size();
+    for (std::size_t i = 0; i < n; ++i)
+      d += flat_distance_factors_[i] * std::fabs(state1[i] - state2[i]);
+    // the qualified calls for continuous joints are not virtual
+    for (std::size_t j = 0; j < flat_continuous_joints_.size(); ++j)
+    {
+      const std::size_t i = flat_continuous_variables_[j];
+      d += flat_continuous_joints_[j]->getDistanceFactor() *
+           flat_continuous_joints_[j]->RevoluteJointModel::distance(state1 + i, state2 + i);
+    }
+    return d;
+  }
+
   for (std::size_t i = 0; i < active_joint_model_vector_.size(); ++i)
     d += active_joint_model_vector_[i]->getDistanceFactor() *
          active_joint_model_vector_[i]->distance(state1 + active_joint_model_start_index_[i],
@@ -416,6 +474,19 @@ double JointModelGroup::distance(const double* state1, const double* state2) con
 
 void JointModelGroup::interpolate(const double* from, const double* to, double t, double* state) const
 {
+  if (use_flat_kernels_)
+  {
+    const std::size_t n = flat_distance_factors_.size();
+    for (std::size_t i = 0; i < n; ++i)
+      state[i] = from[i] + (to[i] - from[i]) * t;
+    for (std::size_t j = 0; j < flat_continuous_joints_.size(); ++j)
+    {
+      const std::size_t i = flat_continuous_variables_[j];
+      flat_continuous_joints_[j]->RevoluteJointModel::interpolate(from + i, to + i, t, state + i);
+    }
+    return;
+  }
+
   // we interpolate values only for active joint models (non-mimic)
   for (std::size_t i = 0; i < active_joint_model_vector_.size(); ++i)
     active_joint_model_vector_[i]->interpolate(from + active_joint_model_start_index_[i],
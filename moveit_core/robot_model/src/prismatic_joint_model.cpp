@@ -74,7 +74,7 @@ void PrismaticJointModel::getVariableDefaultPositions(double* values, const Boun
 
 bool PrismaticJointModel::satisfiesPositionBounds(const double* values, const Bounds& bounds, double margin) const
 {
-  return !(values[0] < bounds[0].min_position_ - margin || values[0] > bounds[0].max_position_ + margin);
+  return satisfiesSinglePositionBounds(values[0], bounds[0], margin);
 }
 
 void PrismaticJointModel::getVariableRandomPositions(random_numbers::RandomNumberGenerator& rng, double* values,
@@ -93,17 +93,7 @@ void PrismaticJointModel::getVariableRandomPositionsNearBy(random_numbers::Rando
 
 bool PrismaticJointModel::enforcePositionBounds(double* values, const Bounds& bounds) const
 {
-  if (values[0] < bounds[0].min_position_)
-  {
-    values[0] = bounds[0].min_position_;
-    return true;
-  }
-  else if (values[0] > bounds[0].max_position_)
-  {
-    values[0] = bounds[0].max_position_;
-    return true;
-  }
-  return false;
+  return enforceSinglePositionBounds(values[0], bounds[0]);
 }
 
 double PrismaticJointModel::distance(const double* values1, const double* values2) const
@@ -171,7 +171,7 @@ bool RevoluteJointModel::satisfiesPositionBounds(const double* values, const Bou
   if (continuous_)
     return true;
   else
-    return !(values[0] < bounds[0].min_position_ - margin || values[0] > bounds[0].max_position_ + margin);
+    return satisfiesSinglePositionBounds(values[0], bounds[0], margin);
 }
 
 bool RevoluteJointModel::enforcePositionBounds(double* values, const Bounds& bounds) const
@@ -190,18 +190,7 @@ bool RevoluteJointModel::enforcePositionBounds(double* values, const Bounds& bou
     }
   }
   else
-  {
-    if (values[0] < bounds[0].min_position_)
-    {
-      values[0] = bounds[0].min_position_;
-      return true;
-    }
-    else if (values[0] > bounds[0].max_position_)
-    {
-      values[0] = bounds[0].max_position_;
-      return true;
-    }
-  }
+    return enforceSinglePositionBounds(values[0], bounds[0]);
   return false;
 }
 
@@ -58,6 +58,16 @@ RobotModel::RobotModel(const urdf::ModelInterfaceSharedPtr& urdf_model, const sr
   buildModel(*urdf_model, *srdf_model);
 }
 
+RobotModel::RobotModel(const urdf::ModelInterfaceSharedPtr& urdf_model, const srdf::ModelConstSharedPtr& srdf_model,
+                       const MeshLoaderFn& mesh_loader)
+  : mesh_loader_(mesh_loader)
+{
+  root_joint_ = nullptr;
+  urdf_ = urdf_model;
+  srdf_ = srdf_model;
+  buildModel(*urdf_model, *srdf_model);
+}
+
 RobotModel::~RobotModel()
 {
   for (JointModelGroupMap::iterator it = joint_model_group_map_.begin(); it != joint_model_group_map_.end(); ++it)
@@ -274,6 +284,10 @@ void RobotModel::buildJointInfo()
         active_joint_model_vector_.push_back(joint_model_vector_[i]);
         active_joint_model_vector_const_.push_back(joint_model_vector_[i]);
         active_joint_models_bounds_.push_back(&joint_model_vector_[i]->getVariableBounds());
+        active_joint_models_simple_bounds_.push_back(
+            joint_model_vector_[i]->getType() == JointModel::PRISMATIC ||
+            (joint_model_vector_[i]->getType() == JointModel::REVOLUTE &&
+             !static_cast<const RevoluteJointModel*>(joint_model_vector_[i])->isContinuous()));
       }
 
       if (joint_model_vector_[i]->getType() == JointModel::REVOLUTE &&
@@ -1054,7 +1068,8 @@ shapes::ShapePtr RobotModel::constructShape(const urdf::Geometry* geom)
       if (!mesh->filename.empty())
       {
         Eigen::Vector3d scale(mesh->scale.x, mesh->scale.y, mesh->scale.z);
-        shapes::Mesh* m = shapes::createMeshFromResource(mesh->filename, scale);
+        shapes::Mesh* m = mesh_loader_ ? mesh_loader_(mesh->filename, scale) :
+                                         shapes::createMeshFromResource(mesh->filename, scale);
         result = m;
       }
     }
@@ -1224,9 +1239,17 @@ bool RobotModel::satisfiesPositionBounds(const double* state, const JointBoundsV
 {
   assert(active_joint_bounds.size() == active_joint_model_vector_.size());
   for (std::size_t i = 0; i < active_joint_model_vector_.size(); ++i)
-    if (!active_joint_model_vector_[i]->satisfiesPositionBounds(state + active_joint_model_start_index_[i],
-                                                                *active_joint_bounds[i], margin))
+  {
+    if (active_joint_models_simple_bounds_[i])
+    {
+      if (!JointModel::satisfiesSinglePositionBounds(state[active_joint_model_start_index_[i]],
+                                                     (*active_joint_bounds[i])[0], margin))
+        return false;
+    }
+    else if (!active_joint_model_vector_[i]->satisfiesPositionBounds(state + active_joint_model_start_index_[i],
+                                                                     *active_joint_bounds[i], margin))
       return false;
+  }
   return true;
 }
 
@@ -1235,9 +1258,17 @@ bool RobotModel::enforcePositionBounds(double* state, const JointBoundsVector& a
   assert(active_joint_bounds.size() == active_joint_model_vector_.size());
   bool change = false;
   for (std::size_t i = 0; i < active_joint_model_vector_.size(); ++i)
-    if (active_joint_model_vector_[i]->enforcePositionBounds(state + active_joint_model_start_index_[i],
-                                                             *active_joint_bounds[i]))
+  {
+    if (active_joint_models_simple_bounds_[i])
+    {
+      if (JointModel::enforceSinglePositionBounds(state[active_joint_model_start_index_[i]],
+                                                  (*active_joint_bounds[i])[0]))
+        change = true;
+    }
+    else if (active_joint_model_vector_[i]->enforcePositionBounds(state + active_joint_model_start_index_[i],
+                                                                  *active_joint_bounds[i]))
       change = true;
+  }
   if (change)
     updateMimicJoints(state);
   return change;
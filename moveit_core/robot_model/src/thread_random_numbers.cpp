@@ -0,0 +1,77 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/robot_model/thread_random_numbers.h>
+#include <boost/thread/mutex.hpp>
+#include <memory>
+
+namespace moveit
+{
+namespace core
+{
+namespace
+{
+boost::mutex seed_mutex;
+bool have_seed_base = false;
+std::uint32_t next_seed = 0;
+
+thread_local std::unique_ptr<random_numbers::RandomNumberGenerator> thread_rng;
+}
+
+random_numbers::RandomNumberGenerator& getThreadRandomNumberGenerator()
+{
+  if (!thread_rng)
+  {
+    boost::mutex::scoped_lock lock(seed_mutex);
+    if (have_seed_base)
+      thread_rng.reset(new random_numbers::RandomNumberGenerator(next_seed++));
+    else
+      thread_rng.reset(new random_numbers::RandomNumberGenerator());
+  }
+  return *thread_rng;
+}
+
+void setThreadRandomSeed(std::uint32_t seed)
+{
+  thread_rng.reset(new random_numbers::RandomNumberGenerator(seed));
+}
+
+void setRandomSeedBase(std::uint32_t seed)
+{
+  boost::mutex::scoped_lock lock(seed_mutex);
+  have_seed_base = true;
+  next_seed = seed;
+}
+}
+}
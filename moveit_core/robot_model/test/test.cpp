@@ -35,10 +35,12 @@
 /* Author: Ioan Sucan */
 
 #include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_model/thread_random_numbers.h>
 #include <urdf_parser/urdf_parser.h>
 #include <fstream>
 #include <gtest/gtest.h>
 #include <boost/filesystem/path.hpp>
+#include <boost/thread.hpp>
 #include <moveit/profiler/profiler.h>
 #include <moveit_resources/config.h>
 
@@ -102,6 +104,64 @@ TEST_F(LoadPlanningModelsPr2, Model)
   moveit::tools::Profiler::Status();
 }
 
+TEST_F(LoadPlanningModelsPr2, GroupDistanceAndInterpolation)
+{
+  // the arm consists of revolute joints only, some of them continuous, so it uses the flat kernels
+  const moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup("left_arm");
+  ASSERT_TRUE(jmg);
+  ASSERT_FALSE(jmg->getContinuousJointModels().empty());
+
+  random_numbers::RandomNumberGenerator rng(42);
+  const std::vector<const moveit::core::JointModel*>& joints = jmg->getActiveJointModels();
+  std::vector<double> a, b, interpolated(jmg->getVariableCount()), expected(jmg->getVariableCount());
+  for (int k = 0; k < 100; ++k)
+  {
+    jmg->getVariableRandomPositions(rng, a);
+    jmg->getVariableRandomPositions(rng, b);
+    const double t = rng.uniform01();
+
+    double expected_distance = 0.0;
+    for (std::size_t i = 0; i < joints.size(); ++i)
+    {
+      expected_distance += joints[i]->getDistanceFactor() * joints[i]->distance(&a[i], &b[i]);
+      joints[i]->interpolate(&a[i], &b[i], t, &expected[i]);
+    }
+    EXPECT_NEAR(jmg->distance(&a[0], &b[0]), expected_distance, 1e-12);
+
+    jmg->interpolate(&a[0], &b[0], t, &interpolated[0]);
+    for (std::size_t i = 0; i < expected.size(); ++i)
+      EXPECT_DOUBLE_EQ(interpolated[i], expected[i]);
+  }
+}
+
+TEST_F(LoadPlanningModelsPr2, ThreadRandomNumbers)
+{
+  const moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup("left_arm");
+  ASSERT_TRUE(jmg);
+
+  // a thread seeded explicitly draws the same values as a generator with that seed
+  std::vector<double> expected, values;
+  random_numbers::RandomNumberGenerator rng(17);
+  jmg->getVariableRandomPositions(rng, expected);
+  moveit::core::setThreadRandomSeed(17);
+  jmg->getVariableRandomPositions(values);
+  EXPECT_EQ(expected, values);
+
+  // every thread has its own generator
+  random_numbers::RandomNumberGenerator* main_rng = &moveit::core::getThreadRandomNumberGenerator();
+  EXPECT_EQ(main_rng, &moveit::core::getThreadRandomNumberGenerator());
+  random_numbers::RandomNumberGenerator* other_rng = nullptr;
+  std::vector<double> other_values;
+  boost::thread worker([&] {
+    other_rng = &moveit::core::getThreadRandomNumberGenerator();
+    moveit::core::setThreadRandomSeed(17);
+    jmg->getVariableRandomPositions(other_values);
+  });
+  worker.join();
+  EXPECT_NE(main_rng, other_rng);
+  EXPECT_EQ(expected, other_values);
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,121 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#ifndef MOVEIT_CORE_ROBOT_STATE_BATCH_FORWARD_KINEMATICS_
+#define MOVEIT_CORE_ROBOT_STATE_BATCH_FORWARD_KINEMATICS_
+
+#include <moveit/robot_model/robot_model.h>
+#include <vector>
+
+namespace moveit
+{
+namespace core
+{
+class RobotState;
+
+MOVEIT_CLASS_FORWARD(BatchForwardKinematics);
+
+/** \brief Evaluate the forward kinematics of many states of the same robot model at once.
+
+    Link transforms are computed in a structure-of-arrays layout: each of the 12 elements of a link's 3x4 affine
+    transform (the column-major rotation followed by the translation) is stored contiguously for all states. The
+    kernels for revolute, prismatic and fixed joints are plain loops over the states, which the compiler vectorizes.
+    Chains of fixed joints are collapsed when the model is loaded, so each link is computed directly from its nearest
+    ancestor whose transform actually depends on the joint values. Planar, floating and root joints go through
+    JointModel::computeTransform(). */
+class BatchForwardKinematics
+{
+public:
+  /** \brief The number of values stored per link transform */
+  static const std::size_t TRANSFORM_SIZE = 12;
+
+  /** \brief The number of states evaluated together by update() */
+  static const std::size_t BATCH_SIZE = 16;
+
+  BatchForwardKinematics(const RobotModelConstPtr& robot_model);
+
+  const RobotModelConstPtr& getRobotModel() const
+  {
+    return robot_model_;
+  }
+
+  /** \brief Compute the global transforms of all links for \e count states.
+
+      \e positions holds the full variable vectors of the states, variable-major: the value of variable \e v in state
+      \e k is positions[v * count + k]. Mimic joints are expected to be consistent. \e transforms must have room for
+      getLinkModelCount() * TRANSFORM_SIZE * count values; element \e e of the transform of link \e l in state \e k is
+      written to transforms[(l * TRANSFORM_SIZE + e) * count + k]. */
+  void computeLinkTransforms(const double* positions, std::size_t count, double* transforms) const;
+
+  /** \brief Extract the transform of link \e link_index in state \e k from the output of computeLinkTransforms() */
+  static void getLinkTransform(const double* transforms, std::size_t count, std::size_t link_index, std::size_t k,
+                               Eigen::Affine3d& transform);
+
+  /** \brief Update the link transforms of all \e states, as RobotState::updateLinkTransforms() would. The states must
+      all use the robot model this instance was constructed with. */
+  void update(const std::vector<RobotState*>& states) const;
+
+private:
+  enum LinkType
+  {
+    FIXED,
+    REVOLUTE,
+    PRISMATIC,
+    GENERIC
+  };
+
+  struct LinkEntry
+  {
+    LinkType type;
+
+    /** \brief The link this one is computed from; -1 for the root link */
+    int anchor;
+
+    const JointModel* joint;
+
+    /** \brief The fixed transform from the anchor to the joint frame (3x4, column major) */
+    double origin[TRANSFORM_SIZE];
+
+    /** \brief For revolute joints, the rotation axis; for prismatic joints, the translation axis in the anchor frame */
+    double axis[3];
+  };
+
+  RobotModelConstPtr robot_model_;
+  std::vector<LinkEntry> links_;
+};
+}
+}
+
+#endif
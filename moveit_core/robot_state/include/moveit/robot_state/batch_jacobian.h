@@ -0,0 +1,137 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef MOVEIT_CORE_ROBOT_STATE_BATCH_JACOBIAN_
+#define MOVEIT_CORE_ROBOT_STATE_BATCH_JACOBIAN_
+
+#include <moveit/robot_state/batch_forward_kinematics.h>
+#include <Eigen/StdVector>
+#include <vector>
+
+namespace moveit
+{
+namespace core
+{
+class RobotState;
+
+MOVEIT_CLASS_FORWARD(BatchJacobian);
+
+/** \brief A list of Jacobians with \e Columns columns (Eigen::Dynamic for any number) */
+template <int Columns>
+using JacobianVector =
+    std::vector<Eigen::Matrix<double, 6, Columns>, Eigen::aligned_allocator<Eigen::Matrix<double, 6, Columns> > >;
+
+/** \brief Evaluate the Jacobian of a point on a link, and optionally its time derivative, for many states at once.
+
+    The Jacobians are the same as the ones of RobotState::getJacobian() (without the quaternion representation):
+    rows are the linear and angular velocity of the point in the frame of the parent link of the group's root, columns
+    are the variables of the group. They are built from the link transforms of a BatchForwardKinematics pass, so
+    transforms are computed once per state and shared by all columns. The group must be a chain of revolute and
+    prismatic joints.
+
+    The computation is templated on the number of columns, so that the Jacobians can be fixed-size Eigen matrices
+    for the common cases; it is instantiated for 6 and 7 columns and for Eigen::Dynamic. */
+class BatchJacobian
+{
+public:
+  /** \brief Prepare the evaluation of the Jacobian of \e reference_point_position (in the frame of \e link), for the
+      variables of \e group */
+  BatchJacobian(const RobotModelConstPtr& robot_model, const JointModelGroup* group, const LinkModel* link,
+                const Eigen::Vector3d& reference_point_position = Eigen::Vector3d::Zero());
+
+  /** \brief False if the group and link are not supported, in which case nothing can be computed */
+  bool isValid() const
+  {
+    return valid_;
+  }
+
+  /** \brief The number of columns of the Jacobians (the number of variables of the group) */
+  std::size_t getColumnCount() const
+  {
+    return columns_;
+  }
+
+  /** \brief Compute the Jacobians of \e count states.
+
+      \e positions holds the full variable vectors of the states, variable-major, as for
+      BatchForwardKinematics::computeLinkTransforms(). \e jacobians must have room for \e count matrices. If \e
+      derivatives is not NULL, the time derivatives of the Jacobians are written there too, for the variable
+      velocities in \e velocities (same layout as \e positions). */
+  template <int Columns>
+  bool compute(const double* positions, const double* velocities, std::size_t count,
+               Eigen::Matrix<double, 6, Columns>* jacobians, Eigen::Matrix<double, 6, Columns>* derivatives) const;
+
+  /** \brief Compute the Jacobians (and their time derivatives, for the velocities of the states, if \e derivatives
+      is not NULL) of \e states, e.g. the waypoints of a trajectory. Link transforms of the states are not used nor
+      updated. */
+  template <int Columns>
+  bool compute(const std::vector<const RobotState*>& states, JacobianVector<Columns>& jacobians,
+               JacobianVector<Columns>* derivatives = nullptr) const;
+
+private:
+  struct JointEntry
+  {
+    bool revolute;
+
+    /** \brief The link whose transform is the joint frame */
+    int link_index;
+
+    /** \brief The variable of the joint, in the full variable vector */
+    int variable_index;
+
+    /** \brief The column of the joint in the Jacobian */
+    int column;
+
+    /** \brief The joint axis, in the joint frame */
+    Eigen::Vector3d axis;
+  };
+
+  RobotModelConstPtr robot_model_;
+  BatchForwardKinematics fk_;
+  std::size_t columns_;
+  bool valid_;
+
+  /** \brief The link the Jacobians are expressed in; -1 for the model frame */
+  int reference_link_index_;
+
+  int link_index_;
+  Eigen::Vector3d reference_point_position_;
+
+  /** \brief The joints that move the link, from the root of the group towards the link */
+  std::vector<JointEntry> joints_;
+};
+}
+}
+
+#endif
@@ -0,0 +1,123 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#ifndef MOVEIT_CORE_ROBOT_STATE_COMPACT_ROBOT_STATE_
+#define MOVEIT_CORE_ROBOT_STATE_COMPACT_ROBOT_STATE_
+
+#include <moveit/robot_state/robot_state.h>
+#include <vector>
+
+namespace moveit
+{
+namespace core
+{
+MOVEIT_CLASS_FORWARD(CompactRobotState);
+
+/** \brief A lightweight representation of a robot state that only stores the variable positions, in single precision.
+
+    This is intended for planners and containers that hold very many states (roadmaps, long trajectories), where the
+    velocities, accelerations and the transform buffers of a full RobotState dominate memory use. Anything that needs
+    transforms goes through a full RobotState kept per thread (getScratchState()), into which the positions are loaded
+    on demand; forward kinematics is then computed lazily as usual. */
+class CompactRobotState
+{
+public:
+  /** \brief Construct a state for \e robot_model. The positions are not initialized. */
+  CompactRobotState(const RobotModelConstPtr& robot_model);
+
+  /** \brief Construct a compact copy of the positions of \e state */
+  explicit CompactRobotState(const RobotState& state);
+
+  const RobotModelConstPtr& getRobotModel() const
+  {
+    return robot_model_;
+  }
+
+  std::size_t getVariableCount() const
+  {
+    return position_.size();
+  }
+
+  const float* getVariablePositions() const
+  {
+    return position_.data();
+  }
+
+  double getVariablePosition(std::size_t index) const
+  {
+    return position_[index];
+  }
+
+  void setVariablePosition(std::size_t index, double value)
+  {
+    position_[index] = static_cast<float>(value);
+  }
+
+  /** \brief Copy the positions of \e state, which must use the same robot model */
+  void setFromRobotState(const RobotState& state);
+
+  /** \brief Set the positions of \e state, which must use the same robot model. The transforms of \e state are
+      marked dirty. */
+  void copyToRobotState(RobotState& state) const;
+
+  /** \brief Get a full state with the positions of this one, for computing transforms and everything else the compact
+      representation does not provide.
+
+      The returned state is shared by all compact states used from the calling thread: it is only valid until the next
+      call to getScratchState() (or a function using it) on this thread. Repeated calls for the same positions do not
+      invalidate the transforms computed so far. Alternating between robot models on one thread reallocates the
+      scratch state. */
+  const RobotState& getScratchState() const;
+
+  /** \brief Get the global transform of \e link, computed on the scratch state. The reference has the same lifetime
+      as the one returned by getScratchState(). */
+  const Eigen::Affine3d& getGlobalLinkTransform(const LinkModel* link) const
+  {
+    return getScratchState().getGlobalLinkTransform(link);
+  }
+
+  const Eigen::Affine3d& getGlobalLinkTransform(const std::string& link_name) const
+  {
+    return getGlobalLinkTransform(robot_model_->getLinkModel(link_name));
+  }
+
+private:
+  RobotModelConstPtr robot_model_;
+  std::vector<float> position_;
+};
+}
+}
+
+#endif
@@ -38,6 +38,7 @@
 #define MOVEIT_ROBOT_STATE_CONVERSIONS_
 
 #include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_state/variable_set_handle.h>
 #include <moveit/transforms/transforms.h>
 #include <moveit_msgs/RobotState.h>
 #include <moveit_msgs/RobotTrajectory.h>
@@ -46,6 +47,34 @@ namespace moveit
 {
 namespace core
 {
+/**
+ * @brief Caches the variable indices for the joint names of a message, for converting many messages with the same
+ *        names (e.g. a joint state stream or the points of a trajectory) without looking up every name every time.
+ *        A context is not thread-safe; use one per thread or stream.
+ */
+class ConversionContext
+{
+public:
+  /**
+   * @brief Get the indices in \e model of the variables called \e names. The indices are only looked up again when
+   *        the model or the names differ from the previous call. An exception is thrown if a variable is not known.
+   */
+  const std::vector<int>& getVariableIndices(const RobotModelConstPtr& model, const std::vector<std::string>& names)
+  {
+    return getVariables(model, names).getVariableIndices();
+  }
+
+  /**
+   * @brief Get the handle for the variables called \e names in \e model, which is only constructed again when the
+   *        model or the names differ from the previous call. An exception is thrown if a variable is not known.
+   */
+  const VariableSetHandle& getVariables(const RobotModelConstPtr& model, const std::vector<std::string>& names);
+
+private:
+  std::vector<std::string> names_;
+  VariableSetHandlePtr variables_;
+};
+
 /**
  * @brief Convert a joint state to a MoveIt! robot state
  * @param joint_state The input joint state to be converted
@@ -54,6 +83,16 @@ namespace core
  */
 bool jointStateToRobotState(const sensor_msgs::JointState& joint_state, RobotState& state);
 
+/**
+ * @brief Convert a joint state to a MoveIt! robot state, using the variable indices cached in \e context
+ * @param joint_state The input joint state to be converted
+ * @param state The resultant MoveIt! robot state
+ * @param context The conversion context reused for consecutive messages
+ * @return True if successful, false if failed for any reason
+ */
+bool jointStateToRobotState(const sensor_msgs::JointState& joint_state, RobotState& state,
+                            ConversionContext& context);
+
 /**
  * @brief Convert a robot state msg (with accompanying extra transforms) to a MoveIt! robot state
  * @param tf An instance of a transforms object
@@ -75,6 +114,17 @@ bool robotStateMsgToRobotState(const Transforms& tf, const moveit_msgs::RobotSta
 bool robotStateMsgToRobotState(const moveit_msgs::RobotState& robot_state, RobotState& state,
                                bool copy_attached_bodies = true);
 
+/**
+ * @brief Convert a robot state msg to a MoveIt! robot state, using the variable indices cached in \e context
+ * @param robot_state The input robot state msg
+ * @param state The resultant MoveIt! robot state
+ * @param context The conversion context reused for consecutive messages
+ * @param copy_attached_bodies Flag to include attached objects in robot state copy
+ * @return True if successful, false if failed for any reason
+ */
+bool robotStateMsgToRobotState(const moveit_msgs::RobotState& robot_state, RobotState& state,
+                               ConversionContext& context, bool copy_attached_bodies = true);
+
 /**
  * @brief Convert a MoveIt! robot state to a robot state message
  * @param state The input MoveIt! robot state object
@@ -84,6 +134,17 @@ bool robotStateMsgToRobotState(const moveit_msgs::RobotState& robot_state, Robot
 void robotStateToRobotStateMsg(const RobotState& state, moveit_msgs::RobotState& robot_state,
                                bool copy_attached_bodies = true);
 
+/**
+ * @brief Convert a MoveIt! robot state to a robot state message that is reused for consecutive states. The joint
+ *        names already in the message are kept if they are those of the model, so only the values are written.
+ * @param state The input MoveIt! robot state object
+ * @param robot_state The resultant RobotState *message
+ * @param context The conversion context reused for consecutive messages
+ * @param copy_attached_bodies Flag to include attached objects in robot state copy
+ */
+void robotStateToRobotStateMsg(const RobotState& state, moveit_msgs::RobotState& robot_state,
+                               ConversionContext& context, bool copy_attached_bodies = true);
+
 /**
  * @brief Convert AttachedBodies to AttachedCollisionObjects
  * @param attached_bodies The input MoveIt! attached body objects
@@ -109,6 +170,17 @@ void robotStateToJointStateMsg(const RobotState& state, sensor_msgs::JointState&
 bool jointTrajPointToRobotState(const trajectory_msgs::JointTrajectory& trajectory, std::size_t point_id,
                                 RobotState& state);
 
+/**
+ * @brief Convert a joint trajectory point to a MoveIt! robot state, using the variable indices cached in \e context
+ * @param joint_trajectory The input msg
+ * @param point_id The index of the trajectory point in the joint trajectory.
+ * @param state The resultant MoveIt! robot state
+ * @param context The conversion context reused for the points of the trajectory
+ * @return True if successful, false if failed for any reason
+ */
+bool jointTrajPointToRobotState(const trajectory_msgs::JointTrajectory& trajectory, std::size_t point_id,
+                                RobotState& state, ConversionContext& context);
+
 /**
  * @brief Convert a MoveIt! robot state to common separated values (CSV) on a single line that is
  *        outputted to a stream e.g. for file saving
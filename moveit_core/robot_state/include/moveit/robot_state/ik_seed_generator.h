@@ -0,0 +1,181 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef MOVEIT_CORE_ROBOT_STATE_IK_SEED_GENERATOR_
+#define MOVEIT_CORE_ROBOT_STATE_IK_SEED_GENERATOR_
+
+#include <moveit/robot_state/robot_state.h>
+#include <boost/thread/mutex.hpp>
+#include <deque>
+#include <vector>
+
+namespace moveit
+{
+namespace core
+{
+MOVEIT_CLASS_FORWARD(HaltonIKSeedGenerator);
+MOVEIT_CLASS_FORWARD(FixedIKSeedGenerator);
+MOVEIT_CLASS_FORWARD(SolutionCacheIKSeedGenerator);
+MOVEIT_CLASS_FORWARD(CompositeIKSeedGenerator);
+
+/** \brief Chooses the seeds RobotState::setFromIK() retries the kinematics solver from.
+
+    The first attempt always starts at the current state; the generator is asked for the seeds of the following ones.
+    Generators are set per group with JointModelGroup::setIKSeedGenerator(). When the group lets setFromIK() run
+    attempts concurrently (JointModelGroup::setIKSeedThreads()), getSeed() and addSolution() are called from several
+    threads at once. */
+class IKSeedGenerator
+{
+public:
+  virtual ~IKSeedGenerator();
+
+  /** \brief Fill \e seed with values for the variables of \e group, in the order of the group, to start attempt
+      \e attempt (counting from 1) from. \e poses are the requested poses of the links or frames \e tips, in the model
+      frame, and \e state is the state setFromIK() was called on. Return false to fall back to a random seed. */
+  virtual bool getSeed(const RobotState& state, const JointModelGroup* group, const EigenSTL::vector_Affine3d& poses,
+                       const std::vector<std::string>& tips, unsigned int attempt,
+                       random_numbers::RandomNumberGenerator& rng, std::vector<double>& seed) const = 0;
+
+  /** \brief Called with the group variable values of every solution setFromIK() returns. Does nothing by default. */
+  virtual void addSolution(const JointModelGroup* group, const EigenSTL::vector_Affine3d& poses,
+                           const std::vector<std::string>& tips, const std::vector<double>& solution) const;
+};
+
+/** \brief Seeds taken from a Halton sequence over the bounds of the group's single variable joints, so that
+    successive attempts start far from each other instead of possibly close together as random seeds may. Variables
+    of other joints and of joints with unbounded positions are sampled at random. */
+class HaltonIKSeedGenerator : public IKSeedGenerator
+{
+public:
+  /** \brief Start the sequence at element \e offset + 1 */
+  HaltonIKSeedGenerator(unsigned int offset = 0);
+
+  bool getSeed(const RobotState& state, const JointModelGroup* group, const EigenSTL::vector_Affine3d& poses,
+               const std::vector<std::string>& tips, unsigned int attempt, random_numbers::RandomNumberGenerator& rng,
+               std::vector<double>& seed) const override;
+
+  /** \brief The radical inverse of \e index in base \e base, the element \e index of the one dimensional Halton
+      sequence in that base */
+  static double getRadicalInverse(unsigned int index, unsigned int base);
+
+private:
+  unsigned int offset_;
+  std::vector<unsigned int> primes_;
+};
+
+/** \brief A fixed list of seeds tried in order, such as the previous solutions along a trajectory or solutions read
+    from a cache. Once the list is exhausted, random seeds are used. */
+class FixedIKSeedGenerator : public IKSeedGenerator
+{
+public:
+  FixedIKSeedGenerator();
+
+  /** \brief Replace the seeds; each has the values of the group variables, in the order of the group */
+  void setSeeds(const std::vector<std::vector<double> >& seeds);
+
+  void addSeed(const std::vector<double>& seed);
+
+  void clear();
+
+  bool getSeed(const RobotState& state, const JointModelGroup* group, const EigenSTL::vector_Affine3d& poses,
+               const std::vector<std::string>& tips, unsigned int attempt, random_numbers::RandomNumberGenerator& rng,
+               std::vector<double>& seed) const override;
+
+private:
+  mutable boost::mutex lock_;
+  std::vector<std::vector<double> > seeds_;
+};
+
+/** \brief Remembers the solutions setFromIK() returns and seeds later queries from the solutions of the closest
+    previous queries: attempt \e k starts at the solution whose poses were the \e k th closest to the requested ones.
+    Only queries for the same group and tips are compared. */
+class SolutionCacheIKSeedGenerator : public IKSeedGenerator
+{
+public:
+  /** \brief Keep at most \e max_size solutions, forgetting the oldest first. The distance between two sets of poses
+      is the sum over the tips of the distance between the origins plus \e rotation_weight times the rotation
+      angle. */
+  SolutionCacheIKSeedGenerator(std::size_t max_size = 1000, double rotation_weight = 0.5);
+
+  bool getSeed(const RobotState& state, const JointModelGroup* group, const EigenSTL::vector_Affine3d& poses,
+               const std::vector<std::string>& tips, unsigned int attempt, random_numbers::RandomNumberGenerator& rng,
+               std::vector<double>& seed) const override;
+
+  void addSolution(const JointModelGroup* group, const EigenSTL::vector_Affine3d& poses,
+                   const std::vector<std::string>& tips, const std::vector<double>& solution) const override;
+
+  /** \brief The number of solutions kept */
+  std::size_t getSize() const;
+
+  void clear();
+
+private:
+  struct Entry
+  {
+    const JointModelGroup* group;
+    std::vector<std::string> tips;
+    EigenSTL::vector_Affine3d poses;
+    std::vector<double> solution;
+  };
+
+  double distance(const Entry& entry, const EigenSTL::vector_Affine3d& poses) const;
+
+  std::size_t max_size_;
+  double rotation_weight_;
+  mutable boost::mutex lock_;
+  mutable std::deque<Entry> entries_;
+};
+
+/** \brief Combines several generators by taking turns: attempt 1 is seeded by the first generator, attempt 2 by the
+    second, and so on, so that with concurrent attempts the strategies run side by side. Solutions are passed on to
+    all generators. */
+class CompositeIKSeedGenerator : public IKSeedGenerator
+{
+public:
+  CompositeIKSeedGenerator(const std::vector<IKSeedGeneratorConstPtr>& generators);
+
+  bool getSeed(const RobotState& state, const JointModelGroup* group, const EigenSTL::vector_Affine3d& poses,
+               const std::vector<std::string>& tips, unsigned int attempt, random_numbers::RandomNumberGenerator& rng,
+               std::vector<double>& seed) const override;
+
+  void addSolution(const JointModelGroup* group, const EigenSTL::vector_Affine3d& poses,
+                   const std::vector<std::string>& tips, const std::vector<double>& solution) const override;
+
+private:
+  std::vector<IKSeedGeneratorConstPtr> generators_;
+};
+}
+}
+
+#endif
@@ -39,6 +39,7 @@
 #define MOVEIT_CORE_ROBOT_STATE_
 
 #include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_model/thread_random_numbers.h>
 #include <moveit/robot_state/attached_body.h>
 #include <moveit/macros/deprecation.h>
 #include <sensor_msgs/JointState.h>
@@ -55,6 +56,9 @@ namespace core
 {
 MOVEIT_CLASS_FORWARD(RobotState);
 
+class BatchForwardKinematics;
+class VariableSetHandle;
+
 /** \brief Signature for functions that can verify that if the group \e joint_group in \e robot_state is set to \e
    joint_group_variable_values
     the state is valid or not. Returns true if the state is valid. This call is allowed to modify \e robot_state (e.g.,
@@ -103,6 +107,23 @@ struct MaxEEFStep
   double rotation;     // Radians
 };
 
+/** \brief Struct for enabling adaptive step sizes in computeCartesianPath
+
+    If max_joint_step is non-zero, the Cartesian step starts at MaxEEFStep and is scaled between min_scale and
+    max_scale: it grows while the joint-space distance between consecutive points stays below half of max_joint_step
+    and shrinks when it exceeds max_joint_step, e.g. close to singularities. */
+struct AdaptiveEEFStep
+{
+  explicit AdaptiveEEFStep(double max_joint_step = 0.0, double min_scale = 0.125, double max_scale = 8.0)
+    : max_joint_step(max_joint_step), min_scale(min_scale), max_scale(max_scale)
+  {
+  }
+
+  double max_joint_step;  // joint-space distance, as computed by RobotState::distance()
+  double min_scale;
+  double max_scale;
+};
+
 /** \brief Representation of a robot's state. This includes position,
     velocity, acceleration and effort.
 
@@ -131,9 +152,23 @@ public:
   /** \brief Copy constructor. */
   RobotState(const RobotState& other);
 
+  /** \brief Move constructor. Takes over the memory and the attached bodies of \e other, which may only be assigned
+      to or destroyed afterwards. */
+  RobotState(RobotState&& other);
+
   /** \brief Copy operator */
   RobotState& operator=(const RobotState& other);
 
+  /** \brief Move operator. Takes over the memory and the attached bodies of \e other, which may only be assigned to
+      or destroyed afterwards. Both states have to be constructed for the same robot model. */
+  RobotState& operator=(RobotState&& other);
+
+  /** \brief Copy only the joint positions of \e other, which has to be constructed for the same robot model.
+      Velocities, accelerations and efforts are dropped, all transforms are marked dirty and the attached bodies of
+      this state are kept as they are. This is much cheaper than the copy operator when only the configuration is
+      needed. */
+  void copyPositionsFrom(const RobotState& other);
+
   /** \brief Get the robot model this state is constructed for. */
   const RobotModelConstPtr& getRobotModel() const
   {
@@ -1034,6 +1069,8 @@ as the new values that correspond to the group */
       is available for each sub-group, then the joint values can be set by computing inverse kinematics.
       The poses are assumed to be in the reference frame of the kinematic model. The poses are assumed
       to be in the same order as the order of the sub-groups in this group. Returns true on success.
+      The first attempt starts at the current state, the others at seeds from the group's IKSeedGenerator, or random
+      ones if it has none. With JointModelGroup::setIKSeedThreads(), attempts run concurrently.
       @param poses The poses the last link in each chain needs to achieve
       @param tips The names of the frames for which IK is attempted.
       @param consistency_limits This specifies the desired distance between the solution and the seed state
@@ -1139,6 +1176,19 @@ as the new values that correspond to the group */
                               const Eigen::Affine3d& target, bool global_reference_frame, const MaxEEFStep& max_step,
                               const JumpThreshold& jump_threshold,
                               const GroupStateValidityCallbackFn& validCallback = GroupStateValidityCallbackFn(),
+                              const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions())
+  {
+    return computeCartesianPath(group, traj, link, target, global_reference_frame, max_step, AdaptiveEEFStep(),
+                                jump_threshold, validCallback, options);
+  }
+
+  /** \brief Compute the sequence of joint values that correspond to a straight Cartesian path to \e target, with the
+     step between consecutive points adapted to the joint-space motion it causes (see AdaptiveEEFStep). Where the
+     motion is easy, fewer IK queries are needed; near singularities, the path is sampled more densely. */
+  double computeCartesianPath(const JointModelGroup* group, std::vector<RobotStatePtr>& traj, const LinkModel* link,
+                              const Eigen::Affine3d& target, bool global_reference_frame, const MaxEEFStep& max_step,
+                              const AdaptiveEEFStep& adaptive_step, const JumpThreshold& jump_threshold,
+                              const GroupStateValidityCallbackFn& validCallback = GroupStateValidityCallbackFn(),
                               const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions());
 
   double computeCartesianPath(const JointModelGroup* group, std::vector<RobotStatePtr>& traj, const LinkModel* link,
@@ -1161,6 +1211,19 @@ as the new values that correspond to the group */
                               const EigenSTL::vector_Affine3d& waypoints, bool global_reference_frame,
                               const MaxEEFStep& max_step, const JumpThreshold& jump_threshold,
                               const GroupStateValidityCallbackFn& validCallback = GroupStateValidityCallbackFn(),
+                              const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions())
+  {
+    return computeCartesianPath(group, traj, link, waypoints, global_reference_frame, max_step, AdaptiveEEFStep(),
+                                jump_threshold, validCallback, options);
+  }
+
+  /** \brief Compute the sequence of joint values that perform a general Cartesian path through \e waypoints, with
+     adaptive step sizes between consecutive points (see AdaptiveEEFStep). */
+  double computeCartesianPath(const JointModelGroup* group, std::vector<RobotStatePtr>& traj, const LinkModel* link,
+                              const EigenSTL::vector_Affine3d& waypoints, bool global_reference_frame,
+                              const MaxEEFStep& max_step, const AdaptiveEEFStep& adaptive_step,
+                              const JumpThreshold& jump_threshold,
+                              const GroupStateValidityCallbackFn& validCallback = GroupStateValidityCallbackFn(),
                               const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions());
 
   double computeCartesianPath(const JointModelGroup* group, std::vector<RobotStatePtr>& traj, const LinkModel* link,
@@ -1667,19 +1730,17 @@ as the new values that correspond to the group */
   void computeAABB(std::vector<double>& aabb) const;
 
   /** \brief Compute an axis-aligned bounding box that contains the current state.
-      The format for \e aabb is (minx, maxx, miny, maxy, minz, maxz) */
-  void computeAABB(std::vector<double>& aabb)
-  {
-    updateLinkTransforms();
-    static_cast<const RobotState*>(this)->computeAABB(aabb);
-  }
+      The format for \e aabb is (minx, maxx, miny, maxy, minz, maxz).
 
-  /** \brief Return the instance of a random number generator */
+      The boxes of the links are cached in the state, and only the ones of links whose transforms changed since the
+      previous call are computed again, so calling this repeatedly while part of the robot moves is cheap. */
+  void computeAABB(std::vector<double>& aabb);
+
+  /** \brief Return the instance of a random number generator. This is the generator of the calling thread (see
+      getThreadRandomNumberGenerator()), so states do not need to allocate and seed their own. */
   random_numbers::RandomNumberGenerator& getRandomNumberGenerator()
   {
-    if (!rng_)
-      rng_ = new random_numbers::RandomNumberGenerator();
-    return *rng_;
+    return getThreadRandomNumberGenerator();
   }
 
   /** \brief Get the transformation matrix from the model frame to the frame identified by \e id */
@@ -1748,10 +1809,28 @@ as the new values that correspond to the group */
   std::string getStateTreeString(const std::string& prefix = "") const;
 
 private:
+  friend class BatchForwardKinematics;
+  friend class VariableSetHandle;
+
   void allocMemory();
 
   void copyFrom(const RobotState& other);
 
+  /** \brief Enforce the bounds of the active \e joints; \e simple_bounds tells which of them only clamp a single
+      position, as returned by getActiveJointModelsSimpleBounds() */
+  void enforceBoundsInternal(const std::vector<const JointModel*>& joints,
+                             const std::vector<unsigned char>& simple_bounds);
+  bool satisfiesBoundsInternal(const std::vector<const JointModel*>& joints,
+                               const std::vector<unsigned char>& simple_bounds, double margin) const;
+
+  /** \brief Take over the memory and the attached bodies of \e other, assuming this state owns neither */
+  void moveFrom(RobotState& other);
+
+  void markDirtyLinkAABBs(const JointModel* joint)
+  {
+    dirty_link_aabbs_ = dirty_link_aabbs_ == nullptr ? joint : robot_model_->getCommonRoot(dirty_link_aabbs_, joint);
+  }
+
   void markDirtyJointTransforms(const JointModel* joint)
   {
     dirty_joint_transforms_[joint->getJointIndex()] = 1;
@@ -1841,6 +1920,13 @@ private:
   const JointModel* dirty_link_transforms_;
   const JointModel* dirty_collision_body_transforms_;
 
+  /** \brief The root of the links whose boxes in link_aabbs_ are out of date */
+  const JointModel* dirty_link_aabbs_;
+
+  /** \brief The boxes of the links, six values per link index in the format of computeAABB(). Only allocated when the
+      non-const computeAABB() is first called, and not copied with the state. */
+  std::vector<double> link_aabbs_;
+
   Eigen::Affine3d* variable_joint_transforms_;         // this points to an element in transforms_, so it is aligned
   Eigen::Affine3d* global_link_transforms_;            // this points to an element in transforms_, so it is aligned
   Eigen::Affine3d* global_collision_body_transforms_;  // this points to an element in transforms_, so it is aligned
@@ -1852,13 +1938,6 @@ private:
   /** \brief This event is called when there is a change in the attached bodies for this state;
       The event specifies the body that changed and whether it was just attached or about to be detached. */
   AttachedBodyCallback attached_body_update_callback_;
-
-  /** \brief For certain operations a state needs a random number generator. However, it may be slightly expensive
-      to allocate the random number generator if many state instances are generated. For this reason, the generator
-      is allocated on a need basis, by the getRandomNumberGenerator() function. Never use the rng_ member directly, but
-     call
-      getRandomNumberGenerator() instead. */
-  random_numbers::RandomNumberGenerator* rng_;
 };
 
 /** \brief Operator overload for printing variable bounds to a stream */
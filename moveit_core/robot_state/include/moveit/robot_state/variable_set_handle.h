@@ -0,0 +1,134 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef MOVEIT_CORE_ROBOT_STATE_VARIABLE_SET_HANDLE_
+#define MOVEIT_CORE_ROBOT_STATE_VARIABLE_SET_HANDLE_
+
+#include <moveit/robot_model/robot_model.h>
+#include <string>
+#include <vector>
+
+namespace moveit
+{
+namespace core
+{
+class RobotState;
+
+MOVEIT_CLASS_FORWARD(VariableSetHandle);
+
+/** \brief A set of variables of a robot model, identified by name once, for reading and writing their values in
+    robot states without name lookups.
+
+    The names are resolved to variable indices when the handle is constructed. The setters write the values from a
+    contiguous buffer (in the order of the names), then update the joints that mimic the written ones and mark the
+    affected transforms dirty in one pass, with the dirty root computed at construction. The result is the same as
+    setting the variables one by one with RobotState::setVariablePosition(). A handle can be used with any state of
+    the robot model it was constructed for. */
+class VariableSetHandle
+{
+public:
+  /** \brief Resolve \e variable_names. An exception is thrown if a name is not known to the model. */
+  VariableSetHandle(const RobotModelConstPtr& robot_model, const std::vector<std::string>& variable_names);
+
+  const RobotModelConstPtr& getRobotModel() const
+  {
+    return robot_model_;
+  }
+
+  /** \brief The number of variables of the handle; the buffers passed to the setters and getters have this size */
+  std::size_t size() const
+  {
+    return variable_indices_.size();
+  }
+
+  /** \brief The index of each variable in the full variable vector of the model */
+  const std::vector<int>& getVariableIndices() const
+  {
+    return variable_indices_;
+  }
+
+  void setPositions(RobotState& state, const double* positions) const;
+  void setPositions(RobotState& state, const std::vector<double>& positions) const
+  {
+    assert(positions.size() >= variable_indices_.size());
+    setPositions(state, positions.data());
+  }
+  void getPositions(const RobotState& state, double* positions) const;
+  void getPositions(const RobotState& state, std::vector<double>& positions) const
+  {
+    positions.resize(variable_indices_.size());
+    getPositions(state, positions.data());
+  }
+
+  void setVelocities(RobotState& state, const double* velocities) const;
+  void setVelocities(RobotState& state, const std::vector<double>& velocities) const
+  {
+    assert(velocities.size() >= variable_indices_.size());
+    setVelocities(state, velocities.data());
+  }
+  void getVelocities(const RobotState& state, double* velocities) const;
+
+  void setAccelerations(RobotState& state, const double* accelerations) const;
+  void setAccelerations(RobotState& state, const std::vector<double>& accelerations) const
+  {
+    assert(accelerations.size() >= variable_indices_.size());
+    setAccelerations(state, accelerations.data());
+  }
+  void getAccelerations(const RobotState& state, double* accelerations) const;
+
+  void setEfforts(RobotState& state, const double* efforts) const;
+  void setEfforts(RobotState& state, const std::vector<double>& efforts) const
+  {
+    assert(efforts.size() >= variable_indices_.size());
+    setEfforts(state, efforts.data());
+  }
+  void getEfforts(const RobotState& state, double* efforts) const;
+
+private:
+  RobotModelConstPtr robot_model_;
+  std::vector<int> variable_indices_;
+
+  /** \brief The joints that mimic one of the variables, updated after the values are written */
+  std::vector<const JointModel*> mimic_joints_;
+
+  /** \brief The indices of the joints whose transforms are marked dirty by setPositions() */
+  std::vector<int> dirty_joints_;
+
+  /** \brief The common root of the joints in dirty_joints_ */
+  const JointModel* dirty_root_;
+};
+}
+}
+
+#endif
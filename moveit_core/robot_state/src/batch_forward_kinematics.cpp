@@ -0,0 +1,306 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/robot_state/batch_forward_kinematics.h>
+#include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_model/revolute_joint_model.h>
+#include <moveit/robot_model/prismatic_joint_model.h>
+#include <cmath>
+
+namespace moveit
+{
+namespace core
+{
+namespace
+{
+const std::size_t TS = BatchForwardKinematics::TRANSFORM_SIZE;
+
+// out = a * b, for 3x4 affine transforms stored as a column-major rotation followed by the translation
+inline void multiplyAffine(const double* a, const double* b, double* out)
+{
+  for (std::size_t c = 0; c < 4; ++c)
+    for (std::size_t r = 0; r < 3; ++r)
+      out[3 * c + r] = a[r] * b[3 * c] + a[3 + r] * b[3 * c + 1] + a[6 + r] * b[3 * c + 2];
+  for (std::size_t r = 0; r < 3; ++r)
+    out[9 + r] += a[9 + r];
+}
+
+inline void affineToArray(const Eigen::Affine3d& t, double* out)
+{
+  const double* d = t.data();
+  for (std::size_t c = 0; c < 4; ++c)
+    for (std::size_t r = 0; r < 3; ++r)
+      out[3 * c + r] = d[4 * c + r];
+}
+
+inline void arrayToAffine(const double* in, Eigen::Affine3d& t)
+{
+  double* d = t.data();
+  for (std::size_t c = 0; c < 4; ++c)
+  {
+    for (std::size_t r = 0; r < 3; ++r)
+      d[4 * c + r] = in[3 * c + r];
+    d[4 * c + 3] = 0.0;
+  }
+  d[15] = 1.0;
+}
+}
+
+BatchForwardKinematics::BatchForwardKinematics(const RobotModelConstPtr& robot_model) : robot_model_(robot_model)
+{
+  // links are indexed in depth-first order, so the entry of a parent link is always filled in before its children
+  const std::vector<const LinkModel*>& links = robot_model_->getLinkModels();
+  links_.resize(links.size());
+  for (std::size_t i = 0; i < links.size(); ++i)
+  {
+    const LinkModel* link = links[i];
+    LinkEntry& e = links_[link->getLinkIndex()];
+    e.joint = link->getParentJointModel();
+    e.axis[0] = e.axis[1] = e.axis[2] = 0.0;
+    affineToArray(link->getJointOriginTransform(), e.origin);
+
+    const LinkModel* parent = link->getParentLinkModel();
+    if (!parent)
+    {
+      e.anchor = -1;
+      e.type = e.joint->getType() == JointModel::FIXED ? FIXED : GENERIC;
+      continue;
+    }
+
+    // collapse chains of fixed joints; links below the root are still computed from the root, so that every
+    // kernel other than the one for the root can assume it has an anchor
+    e.anchor = parent->getLinkIndex();
+    const LinkEntry& pe = links_[e.anchor];
+    if (pe.type == FIXED && pe.anchor >= 0)
+    {
+      double origin[TS];
+      multiplyAffine(pe.origin, e.origin, origin);
+      std::copy(origin, origin + TS, e.origin);
+      e.anchor = pe.anchor;
+    }
+
+    switch (e.joint->getType())
+    {
+      case JointModel::FIXED:
+        e.type = FIXED;
+        break;
+      case JointModel::REVOLUTE:
+      {
+        e.type = REVOLUTE;
+        const Eigen::Vector3d& axis = static_cast<const RevoluteJointModel*>(e.joint)->getAxis();
+        e.axis[0] = axis.x();
+        e.axis[1] = axis.y();
+        e.axis[2] = axis.z();
+        break;
+      }
+      case JointModel::PRISMATIC:
+      {
+        e.type = PRISMATIC;
+        // the translation along the axis happens after the origin rotation; precompute the rotated axis
+        const Eigen::Vector3d& axis = static_cast<const PrismaticJointModel*>(e.joint)->getAxis();
+        for (std::size_t r = 0; r < 3; ++r)
+          e.axis[r] = e.origin[r] * axis.x() + e.origin[3 + r] * axis.y() + e.origin[6 + r] * axis.z();
+        break;
+      }
+      default:
+        e.type = GENERIC;
+        break;
+    }
+  }
+}
+
+void BatchForwardKinematics::computeLinkTransforms(const double* positions, std::size_t count,
+                                                   double* transforms) const
+{
+  Eigen::Affine3d joint_transform;
+  double values[7];
+  double m[TS], t[TS];
+
+  for (std::size_t l = 0; l < links_.size(); ++l)
+  {
+    const LinkEntry& e = links_[l];
+    const double* o = e.origin;
+    double* out = transforms + l * TS * count;
+    const double* p = e.anchor >= 0 ? transforms + e.anchor * TS * count : nullptr;
+
+    switch (e.type)
+    {
+      case FIXED:
+        if (!p)
+        {
+          for (std::size_t i = 0; i < TS; ++i)
+            std::fill(out + i * count, out + (i + 1) * count, o[i]);
+          break;
+        }
+        for (std::size_t k = 0; k < count; ++k)
+        {
+          for (std::size_t c = 0; c < 4; ++c)
+            for (std::size_t r = 0; r < 3; ++r)
+              out[(3 * c + r) * count + k] = p[r * count + k] * o[3 * c] + p[(3 + r) * count + k] * o[3 * c + 1] +
+                                             p[(6 + r) * count + k] * o[3 * c + 2];
+          for (std::size_t r = 0; r < 3; ++r)
+            out[(9 + r) * count + k] += p[(9 + r) * count + k];
+        }
+        break;
+
+      case REVOLUTE:
+      {
+        const double* q = positions + e.joint->getFirstVariableIndex() * count;
+        const double x = e.axis[0], y = e.axis[1], z = e.axis[2];
+        const double x2 = x * x, y2 = y * y, z2 = z * z, xy = x * y, xz = x * z, yz = y * z;
+        for (std::size_t k = 0; k < count; ++k)
+        {
+          const double c = cos(q[k]);
+          const double s = sin(q[k]);
+          const double tc = 1.0 - c;
+          // the joint rotation, column major, as in RevoluteJointModel::computeTransform()
+          const double j[9] = { tc * x2 + c,      tc * xy + z * s, tc * xz - y * s, tc * xy - z * s, tc * y2 + c,
+                                tc * yz + x * s, tc * xz + y * s, tc * yz - x * s, tc * z2 + c };
+          double rot[9];
+          for (std::size_t cc = 0; cc < 3; ++cc)
+            for (std::size_t r = 0; r < 3; ++r)
+              rot[3 * cc + r] = o[r] * j[3 * cc] + o[3 + r] * j[3 * cc + 1] + o[6 + r] * j[3 * cc + 2];
+          for (std::size_t cc = 0; cc < 3; ++cc)
+            for (std::size_t r = 0; r < 3; ++r)
+              out[(3 * cc + r) * count + k] = p[r * count + k] * rot[3 * cc] +
+                                              p[(3 + r) * count + k] * rot[3 * cc + 1] +
+                                              p[(6 + r) * count + k] * rot[3 * cc + 2];
+          for (std::size_t r = 0; r < 3; ++r)
+            out[(9 + r) * count + k] = p[r * count + k] * o[9] + p[(3 + r) * count + k] * o[10] +
+                                       p[(6 + r) * count + k] * o[11] + p[(9 + r) * count + k];
+        }
+        break;
+      }
+
+      case PRISMATIC:
+      {
+        const double* q = positions + e.joint->getFirstVariableIndex() * count;
+        for (std::size_t k = 0; k < count; ++k)
+        {
+          const double d0 = o[9] + e.axis[0] * q[k];
+          const double d1 = o[10] + e.axis[1] * q[k];
+          const double d2 = o[11] + e.axis[2] * q[k];
+          for (std::size_t cc = 0; cc < 3; ++cc)
+            for (std::size_t r = 0; r < 3; ++r)
+              out[(3 * cc + r) * count + k] = p[r * count + k] * o[3 * cc] + p[(3 + r) * count + k] * o[3 * cc + 1] +
+                                              p[(6 + r) * count + k] * o[3 * cc + 2];
+          for (std::size_t r = 0; r < 3; ++r)
+            out[(9 + r) * count + k] = p[r * count + k] * d0 + p[(3 + r) * count + k] * d1 +
+                                       p[(6 + r) * count + k] * d2 + p[(9 + r) * count + k];
+        }
+        break;
+      }
+
+      case GENERIC:
+      {
+        const std::size_t first = e.joint->getFirstVariableIndex();
+        const std::size_t vc = e.joint->getVariableCount();
+        for (std::size_t k = 0; k < count; ++k)
+        {
+          for (std::size_t v = 0; v < vc; ++v)
+            values[v] = positions[(first + v) * count + k];
+          e.joint->computeTransform(values, joint_transform);
+          affineToArray(joint_transform, t);
+          multiplyAffine(o, t, m);
+          if (p)
+          {
+            double a[TS];
+            for (std::size_t i = 0; i < TS; ++i)
+              a[i] = p[i * count + k];
+            multiplyAffine(a, m, t);
+            for (std::size_t i = 0; i < TS; ++i)
+              out[i * count + k] = t[i];
+          }
+          else
+            for (std::size_t i = 0; i < TS; ++i)
+              out[i * count + k] = m[i];
+        }
+        break;
+      }
+    }
+  }
+}
+
+void BatchForwardKinematics::getLinkTransform(const double* transforms, std::size_t count, std::size_t link_index,
+                                              std::size_t k, Eigen::Affine3d& transform)
+{
+  double a[TS];
+  const double* l = transforms + link_index * TS * count;
+  for (std::size_t i = 0; i < TS; ++i)
+    a[i] = l[i * count + k];
+  arrayToAffine(a, transform);
+}
+
+void BatchForwardKinematics::update(const std::vector<RobotState*>& states) const
+{
+  const std::size_t variable_count = robot_model_->getVariableCount();
+  std::vector<double> positions(variable_count * BATCH_SIZE);
+  std::vector<double> transforms(links_.size() * TS * BATCH_SIZE);
+
+  for (std::size_t start = 0; start < states.size(); start += BATCH_SIZE)
+  {
+    const std::size_t count = std::min(BATCH_SIZE, states.size() - start);
+    for (std::size_t k = 0; k < count; ++k)
+    {
+      const RobotState* state = states[start + k];
+      assert(state->getRobotModel() == robot_model_);
+      const double* values = state->getVariablePositions();
+      for (std::size_t v = 0; v < variable_count; ++v)
+        positions[v * count + k] = values[v];
+    }
+
+    computeLinkTransforms(positions.data(), count, transforms.data());
+
+    for (std::size_t k = 0; k < count; ++k)
+    {
+      RobotState* state = states[start + k];
+      for (std::size_t l = 0; l < links_.size(); ++l)
+        getLinkTransform(transforms.data(), count, l, k, state->global_link_transforms_[l]);
+
+      // same bookkeeping as RobotState::updateLinkTransforms()
+      state->dirty_link_transforms_ = nullptr;
+      state->dirty_collision_body_transforms_ = robot_model_->getRootJoint();
+      state->dirty_link_aabbs_ = robot_model_->getRootJoint();
+      for (std::map<std::string, AttachedBody*>::const_iterator it = state->attached_body_map_.begin();
+           it != state->attached_body_map_.end(); ++it)
+        it->second->computeTransform(state->global_link_transforms_[it->second->getAttachedLink()->getLinkIndex()]);
+    }
+  }
+}
+
+const std::size_t BatchForwardKinematics::TRANSFORM_SIZE;
+const std::size_t BatchForwardKinematics::BATCH_SIZE;
+}
+}
@@ -0,0 +1,243 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/robot_state/batch_jacobian.h>
+#include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_model/revolute_joint_model.h>
+#include <moveit/robot_model/prismatic_joint_model.h>
+#include <algorithm>
+
+namespace moveit
+{
+namespace core
+{
+BatchJacobian::BatchJacobian(const RobotModelConstPtr& robot_model, const JointModelGroup* group,
+                             const LinkModel* link, const Eigen::Vector3d& reference_point_position)
+  : robot_model_(robot_model)
+  , fk_(robot_model)
+  , columns_(group->getVariableCount())
+  , valid_(false)
+  , reference_link_index_(-1)
+  , link_index_(link->getLinkIndex())
+  , reference_point_position_(reference_point_position)
+{
+  if (!group->isChain())
+  {
+    ROS_ERROR_NAMED("robot_state", "The group '%s' is not a chain. Cannot compute Jacobian.", group->getName().c_str());
+    return;
+  }
+  if (!group->isLinkUpdated(link->getName()))
+  {
+    ROS_ERROR_NAMED("robot_state", "Link name '%s' does not exist in the chain '%s' or is not a child for this chain",
+                    link->getName().c_str(), group->getName().c_str());
+    return;
+  }
+
+  const LinkModel* root_link_model = group->getJointModels()[0]->getParentLinkModel();
+  if (root_link_model)
+    reference_link_index_ = root_link_model->getLinkIndex();
+
+  for (const LinkModel* l = link; l; l = l->getParentLinkModel())
+  {
+    const JointModel* pjm = l->getParentJointModel();
+    if (pjm->getVariableCount() == 0 || !group->hasJointModel(pjm->getName()))
+      continue;
+
+    JointEntry e;
+    e.link_index = l->getLinkIndex();
+    e.variable_index = pjm->getFirstVariableIndex();
+    e.column = group->getVariableGroupIndex(pjm->getName());
+    if (pjm->getType() == JointModel::REVOLUTE)
+    {
+      e.revolute = true;
+      e.axis = static_cast<const RevoluteJointModel*>(pjm)->getAxis();
+    }
+    else if (pjm->getType() == JointModel::PRISMATIC)
+    {
+      e.revolute = false;
+      e.axis = static_cast<const PrismaticJointModel*>(pjm)->getAxis();
+    }
+    else
+    {
+      ROS_ERROR_NAMED("robot_state", "Batch Jacobians only support revolute and prismatic joints, not joint '%s'",
+                      pjm->getName().c_str());
+      joints_.clear();
+      return;
+    }
+    joints_.push_back(e);
+  }
+  std::reverse(joints_.begin(), joints_.end());
+  valid_ = true;
+}
+
+template <int Columns>
+bool BatchJacobian::compute(const double* positions, const double* velocities, std::size_t count,
+                            Eigen::Matrix<double, 6, Columns>* jacobians,
+                            Eigen::Matrix<double, 6, Columns>* derivatives) const
+{
+  if (!valid_)
+    return false;
+  if (Columns != Eigen::Dynamic && static_cast<std::size_t>(Columns) != columns_)
+  {
+    ROS_ERROR_NAMED("robot_state", "Jacobians with %d columns were requested, but the group has %zu variables",
+                    Columns, columns_);
+    return false;
+  }
+
+  std::vector<double> transforms(robot_model_->getLinkModelCount() * BatchForwardKinematics::TRANSFORM_SIZE * count);
+  fk_.computeLinkTransforms(positions, count, transforms.data());
+
+  const std::size_t n = joints_.size();
+  std::vector<Eigen::Vector3d> axes(n), origins(n);
+  Eigen::Affine3d reference_transform = Eigen::Affine3d::Identity(), transform;
+  for (std::size_t k = 0; k < count; ++k)
+  {
+    // everything is expressed in the reference frame
+    if (reference_link_index_ >= 0)
+    {
+      BatchForwardKinematics::getLinkTransform(transforms.data(), count, reference_link_index_, k,
+                                               reference_transform);
+      reference_transform = reference_transform.inverse(Eigen::Isometry);
+    }
+    BatchForwardKinematics::getLinkTransform(transforms.data(), count, link_index_, k, transform);
+    const Eigen::Vector3d point = reference_transform * (transform * reference_point_position_);
+
+    Eigen::Matrix<double, 6, Columns>& jacobian = jacobians[k];
+    jacobian.setZero(6, columns_);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      const JointEntry& e = joints_[i];
+      BatchForwardKinematics::getLinkTransform(transforms.data(), count, e.link_index, k, transform);
+      transform = reference_transform * transform;
+      axes[i] = transform.linear() * e.axis;
+      origins[i] = transform.translation();
+      if (e.revolute)
+      {
+        jacobian.template block<3, 1>(0, e.column) += axes[i].cross(point - origins[i]);
+        jacobian.template block<3, 1>(3, e.column) += axes[i];
+      }
+      else
+        jacobian.template block<3, 1>(0, e.column) += axes[i];
+    }
+
+    if (!derivatives)
+      continue;
+
+    // The axis of a joint turns with the angular velocity w of its parent link, and the point moves relative to the
+    // joint origin with w x r plus the velocity contributed by the joint itself and the joints after it, so
+    //   d/dt (a x r) = (w x a) x r + a x (w x r + v_after),   d/dt a = w x a
+    Eigen::Matrix<double, 6, Columns>& derivative = derivatives[k];
+    derivative.setZero(6, columns_);
+    Eigen::Vector3d point_velocity = Eigen::Vector3d::Zero();
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      const double qd = velocities[joints_[i].variable_index * count + k];
+      point_velocity += qd * (joints_[i].revolute ? axes[i].cross(point - origins[i]) : axes[i]);
+    }
+    Eigen::Vector3d angular_velocity = Eigen::Vector3d::Zero();
+    Eigen::Vector3d velocity_before = Eigen::Vector3d::Zero();
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      const JointEntry& e = joints_[i];
+      const double qd = velocities[e.variable_index * count + k];
+      const Eigen::Vector3d axis_rate = angular_velocity.cross(axes[i]);
+      if (e.revolute)
+      {
+        const Eigen::Vector3d r = point - origins[i];
+        const Eigen::Vector3d r_rate = angular_velocity.cross(r) + point_velocity - velocity_before;
+        derivative.template block<3, 1>(0, e.column) += axis_rate.cross(r) + axes[i].cross(r_rate);
+        derivative.template block<3, 1>(3, e.column) += axis_rate;
+        velocity_before += qd * axes[i].cross(r);
+        angular_velocity += qd * axes[i];
+      }
+      else
+      {
+        derivative.template block<3, 1>(0, e.column) += axis_rate;
+        velocity_before += qd * axes[i];
+      }
+    }
+  }
+  return true;
+}
+
+template <int Columns>
+bool BatchJacobian::compute(const std::vector<const RobotState*>& states, JacobianVector<Columns>& jacobians,
+                            JacobianVector<Columns>* derivatives) const
+{
+  jacobians.resize(states.size());
+  if (derivatives)
+    derivatives->resize(states.size());
+
+  const std::size_t variable_count = robot_model_->getVariableCount();
+  const std::size_t batch = BatchForwardKinematics::BATCH_SIZE;
+  std::vector<double> positions(variable_count * batch), velocities(derivatives ? variable_count * batch : 0);
+  for (std::size_t start = 0; start < states.size(); start += batch)
+  {
+    const std::size_t count = std::min(batch, states.size() - start);
+    for (std::size_t k = 0; k < count; ++k)
+    {
+      const RobotState* state = states[start + k];
+      assert(state->getRobotModel() == robot_model_);
+      const double* p = state->getVariablePositions();
+      for (std::size_t v = 0; v < variable_count; ++v)
+        positions[v * count + k] = p[v];
+      if (derivatives)
+      {
+        const double* qd = state->hasVelocities() ? state->getVariableVelocities() : nullptr;
+        for (std::size_t v = 0; v < variable_count; ++v)
+          velocities[v * count + k] = qd ? qd[v] : 0.0;
+      }
+    }
+    if (!compute<Columns>(positions.data(), velocities.data(), count, &jacobians[start],
+                          derivatives ? &(*derivatives)[start] : nullptr))
+      return false;
+  }
+  return true;
+}
+
+template bool BatchJacobian::compute<6>(const double*, const double*, std::size_t, Eigen::Matrix<double, 6, 6>*,
+                                        Eigen::Matrix<double, 6, 6>*) const;
+template bool BatchJacobian::compute<7>(const double*, const double*, std::size_t, Eigen::Matrix<double, 6, 7>*,
+                                        Eigen::Matrix<double, 6, 7>*) const;
+template bool BatchJacobian::compute<Eigen::Dynamic>(const double*, const double*, std::size_t, Eigen::MatrixXd*,
+                                                     Eigen::MatrixXd*) const;
+template bool BatchJacobian::compute<6>(const std::vector<const RobotState*>&, JacobianVector<6>&,
+                                        JacobianVector<6>*) const;
+template bool BatchJacobian::compute<7>(const std::vector<const RobotState*>&, JacobianVector<7>&,
+                                        JacobianVector<7>*) const;
+template bool BatchJacobian::compute<Eigen::Dynamic>(const std::vector<const RobotState*>&,
+                                                     JacobianVector<Eigen::Dynamic>&,
+                                                     JacobianVector<Eigen::Dynamic>*) const;
+}
+}
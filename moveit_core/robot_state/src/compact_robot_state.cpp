@@ -0,0 +1,103 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/robot_state/compact_robot_state.h>
+#include <boost/thread/tss.hpp>
+#include <algorithm>
+
+namespace moveit
+{
+namespace core
+{
+namespace
+{
+struct ScratchState
+{
+  RobotStatePtr state;
+  std::vector<double> positions;
+};
+
+boost::thread_specific_ptr<ScratchState> scratch_state;
+}
+
+CompactRobotState::CompactRobotState(const RobotModelConstPtr& robot_model)
+  : robot_model_(robot_model), position_(robot_model->getVariableCount())
+{
+}
+
+CompactRobotState::CompactRobotState(const RobotState& state) : robot_model_(state.getRobotModel())
+{
+  setFromRobotState(state);
+}
+
+void CompactRobotState::setFromRobotState(const RobotState& state)
+{
+  assert(state.getRobotModel() == robot_model_);
+  const double* values = state.getVariablePositions();
+  position_.assign(values, values + state.getVariableCount());
+}
+
+void CompactRobotState::copyToRobotState(RobotState& state) const
+{
+  assert(state.getRobotModel() == robot_model_);
+  std::vector<double> values(position_.begin(), position_.end());
+  state.setVariablePositions(values);
+}
+
+const RobotState& CompactRobotState::getScratchState() const
+{
+  ScratchState* scratch = scratch_state.get();
+  if (!scratch)
+  {
+    scratch = new ScratchState();
+    scratch_state.reset(scratch);
+  }
+  if (!scratch->state || scratch->state->getRobotModel() != robot_model_)
+  {
+    scratch->state.reset(new RobotState(robot_model_));
+    scratch->positions.clear();
+  }
+
+  // only load the positions if they changed, so transforms computed for the same positions remain valid
+  if (scratch->positions.size() != position_.size() ||
+      !std::equal(position_.begin(), position_.end(), scratch->positions.begin()))
+  {
+    scratch->positions.assign(position_.begin(), position_.end());
+    scratch->state->setVariablePositions(scratch->positions);
+  }
+  return *scratch->state;
+}
+}
+}
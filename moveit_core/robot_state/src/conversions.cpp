@@ -64,6 +64,24 @@ static bool _jointStateToRobotState(const sensor_msgs::JointState& joint_state,
   return true;
 }
 
+static bool _jointStateToRobotState(const sensor_msgs::JointState& joint_state, RobotState& state,
+                                    ConversionContext& context)
+{
+  if (joint_state.name.size() != joint_state.position.size())
+  {
+    ROS_ERROR_NAMED("robot_state", "Different number of names and positions in JointState message: %zu, %zu",
+                    joint_state.name.size(), joint_state.position.size());
+    return false;
+  }
+
+  const VariableSetHandle& variables = context.getVariables(state.getRobotModel(), joint_state.name);
+  variables.setPositions(state, joint_state.position);
+  if (!joint_state.velocity.empty())
+    variables.setVelocities(state, joint_state.velocity);
+
+  return true;
+}
+
 static bool _multiDOFJointsToRobotState(const sensor_msgs::MultiDOFJointState& mjs, RobotState& state,
                                         const Transforms* tf)
 {
@@ -332,7 +350,8 @@ static void _msgToAttachedBody(const Transforms* tf, const moveit_msgs::Attached
 }
 
 static bool _robotStateMsgToRobotStateHelper(const Transforms* tf, const moveit_msgs::RobotState& robot_state,
-                                             RobotState& state, bool copy_attached_bodies)
+                                             RobotState& state, bool copy_attached_bodies,
+                                             ConversionContext* context = nullptr)
 {
   bool valid;
   const moveit_msgs::RobotState& rs = robot_state;
@@ -343,7 +362,8 @@ static bool _robotStateMsgToRobotStateHelper(const Transforms* tf, const moveit_
     return false;
   }
 
-  bool result1 = _jointStateToRobotState(robot_state.joint_state, state);
+  bool result1 = context ? _jointStateToRobotState(robot_state.joint_state, state, *context) :
+                           _jointStateToRobotState(robot_state.joint_state, state);
   bool result2 = _multiDOFJointsToRobotState(robot_state.multi_dof_joint_state, state, tf);
   valid = result1 || result2;
 
@@ -365,6 +385,18 @@ static bool _robotStateMsgToRobotStateHelper(const Transforms* tf, const moveit_
 // * Exposed functions
 // ********************************************
 
+const VariableSetHandle& ConversionContext::getVariables(const RobotModelConstPtr& model,
+                                                         const std::vector<std::string>& names)
+{
+  if (variables_ && model == variables_->getRobotModel() && names == names_)
+    return *variables_;
+
+  // construct first, so the context is unchanged if a name is not known
+  variables_.reset(new VariableSetHandle(model, names));
+  names_ = names;
+  return *variables_;
+}
+
 bool jointStateToRobotState(const sensor_msgs::JointState& joint_state, RobotState& state)
 {
   bool result = _jointStateToRobotState(joint_state, state);
@@ -372,6 +404,14 @@ bool jointStateToRobotState(const sensor_msgs::JointState& joint_state, RobotSta
   return result;
 }
 
+bool jointStateToRobotState(const sensor_msgs::JointState& joint_state, RobotState& state,
+                            ConversionContext& context)
+{
+  bool result = _jointStateToRobotState(joint_state, state, context);
+  state.update();
+  return result;
+}
+
 bool robotStateMsgToRobotState(const moveit_msgs::RobotState& robot_state, RobotState& state, bool copy_attached_bodies)
 {
   bool result = _robotStateMsgToRobotStateHelper(nullptr, robot_state, state, copy_attached_bodies);
@@ -379,6 +419,14 @@ bool robotStateMsgToRobotState(const moveit_msgs::RobotState& robot_state, Robot
   return result;
 }
 
+bool robotStateMsgToRobotState(const moveit_msgs::RobotState& robot_state, RobotState& state,
+                               ConversionContext& context, bool copy_attached_bodies)
+{
+  bool result = _robotStateMsgToRobotStateHelper(nullptr, robot_state, state, copy_attached_bodies, &context);
+  state.update();
+  return result;
+}
+
 bool robotStateMsgToRobotState(const Transforms& tf, const moveit_msgs::RobotState& robot_state, RobotState& state,
                                bool copy_attached_bodies)
 {
@@ -401,6 +449,42 @@ void robotStateToRobotStateMsg(const RobotState& state, moveit_msgs::RobotState&
   }
 }
 
+void robotStateToRobotStateMsg(const RobotState& state, moveit_msgs::RobotState& robot_state,
+                               ConversionContext& context, bool copy_attached_bodies)
+{
+  const std::vector<const JointModel*>& js = state.getRobotModel()->getSingleDOFJointModels();
+  sensor_msgs::JointState& joint_state = robot_state.joint_state;
+
+  // the names of the previous state converted into this message are usually still there
+  bool same_names = joint_state.name.size() == js.size();
+  for (std::size_t i = 0; same_names && i < js.size(); ++i)
+    same_names = joint_state.name[i] == js[i]->getName();
+  if (!same_names)
+  {
+    joint_state.name.resize(js.size());
+    for (std::size_t i = 0; i < js.size(); ++i)
+      joint_state.name[i] = js[i]->getName();
+  }
+  const VariableSetHandle& variables = context.getVariables(state.getRobotModel(), joint_state.name);
+
+  variables.getPositions(state, joint_state.position);
+  joint_state.velocity.resize(state.hasVelocities() ? variables.size() : 0);
+  if (state.hasVelocities())
+    variables.getVelocities(state, joint_state.velocity.data());
+  joint_state.effort.clear();
+  joint_state.header.frame_id = state.getRobotModel()->getModelFrame();
+
+  robot_state.is_diff = false;
+  _robotStateToMultiDOFJointState(state, robot_state.multi_dof_joint_state);
+
+  if (copy_attached_bodies)
+  {
+    std::vector<const AttachedBody*> attached_bodies;
+    state.getAttachedBodies(attached_bodies);
+    attachedBodiesToAttachedCollisionObjectMsgs(attached_bodies, robot_state.attached_collision_objects);
+  }
+}
+
 void attachedBodiesToAttachedCollisionObjectMsgs(
     const std::vector<const AttachedBody*>& attached_bodies,
     std::vector<moveit_msgs::AttachedCollisionObject>& attached_collision_objs)
@@ -455,6 +539,33 @@ bool jointTrajPointToRobotState(const trajectory_msgs::JointTrajectory& trajecto
   return true;
 }
 
+bool jointTrajPointToRobotState(const trajectory_msgs::JointTrajectory& trajectory, std::size_t point_id,
+                                RobotState& state, ConversionContext& context)
+{
+  if (trajectory.points.empty() || point_id > trajectory.points.size() - 1)
+  {
+    ROS_ERROR_NAMED("robot_state", "Invalid point_id");
+    return false;
+  }
+  if (trajectory.joint_names.empty())
+  {
+    ROS_ERROR_NAMED("robot_state", "No joint names specified");
+    return false;
+  }
+
+  const trajectory_msgs::JointTrajectoryPoint& point = trajectory.points[point_id];
+  const VariableSetHandle& variables = context.getVariables(state.getRobotModel(), trajectory.joint_names);
+  variables.setPositions(state, point.positions);
+  if (!point.velocities.empty())
+    variables.setVelocities(state, point.velocities);
+  if (!point.accelerations.empty())
+    variables.setAccelerations(state, point.accelerations);
+  if (!point.effort.empty())
+    variables.setEfforts(state, point.effort);
+
+  return true;
+}
+
 void robotStateToStream(const RobotState& state, std::ostream& out, bool include_header, const std::string& separator)
 {
   // Output name of variables
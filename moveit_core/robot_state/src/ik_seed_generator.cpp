@@ -0,0 +1,235 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/robot_state/ik_seed_generator.h>
+#include <algorithm>
+#include <cmath>
+
+namespace moveit
+{
+namespace core
+{
+IKSeedGenerator::~IKSeedGenerator()
+{
+}
+
+void IKSeedGenerator::addSolution(const JointModelGroup* /*group*/, const EigenSTL::vector_Affine3d& /*poses*/,
+                                  const std::vector<std::string>& /*tips*/,
+                                  const std::vector<double>& /*solution*/) const
+{
+}
+
+HaltonIKSeedGenerator::HaltonIKSeedGenerator(unsigned int offset) : offset_(offset)
+{
+  // one base per dimension; groups with more single variable joints than this get random values for the rest
+  static const unsigned int MAX_DIMENSIONS = 64;
+  for (unsigned int n = 2; primes_.size() < MAX_DIMENSIONS; ++n)
+  {
+    bool prime = true;
+    for (std::size_t i = 0; i < primes_.size() && primes_[i] * primes_[i] <= n; ++i)
+      if (n % primes_[i] == 0)
+      {
+        prime = false;
+        break;
+      }
+    if (prime)
+      primes_.push_back(n);
+  }
+}
+
+double HaltonIKSeedGenerator::getRadicalInverse(unsigned int index, unsigned int base)
+{
+  double result = 0.0;
+  double f = 1.0 / base;
+  while (index > 0)
+  {
+    result += f * (index % base);
+    index /= base;
+    f /= base;
+  }
+  return result;
+}
+
+bool HaltonIKSeedGenerator::getSeed(const RobotState& /*state*/, const JointModelGroup* group,
+                                    const EigenSTL::vector_Affine3d& /*poses*/,
+                                    const std::vector<std::string>& /*tips*/, unsigned int attempt,
+                                    random_numbers::RandomNumberGenerator& rng, std::vector<double>& seed) const
+{
+  group->getVariableRandomPositions(rng, seed);
+  const unsigned int index = offset_ + attempt;
+  std::size_t dimension = 0;
+  for (const JointModel* joint : group->getActiveJointModels())
+  {
+    if (joint->getVariableCount() != 1)
+      continue;
+    if (dimension >= primes_.size())
+      break;
+    const VariableBounds& bounds = joint->getVariableBounds()[0];
+    const unsigned int base = primes_[dimension++];
+    if (!std::isfinite(bounds.min_position_) || !std::isfinite(bounds.max_position_))
+      continue;
+    int i = group->getVariableGroupIndex(joint->getName());
+    if (i >= 0)
+      seed[i] =
+          bounds.min_position_ + getRadicalInverse(index, base) * (bounds.max_position_ - bounds.min_position_);
+  }
+  return true;
+}
+
+FixedIKSeedGenerator::FixedIKSeedGenerator()
+{
+}
+
+void FixedIKSeedGenerator::setSeeds(const std::vector<std::vector<double> >& seeds)
+{
+  boost::mutex::scoped_lock slock(lock_);
+  seeds_ = seeds;
+}
+
+void FixedIKSeedGenerator::addSeed(const std::vector<double>& seed)
+{
+  boost::mutex::scoped_lock slock(lock_);
+  seeds_.push_back(seed);
+}
+
+void FixedIKSeedGenerator::clear()
+{
+  boost::mutex::scoped_lock slock(lock_);
+  seeds_.clear();
+}
+
+bool FixedIKSeedGenerator::getSeed(const RobotState& /*state*/, const JointModelGroup* group,
+                                   const EigenSTL::vector_Affine3d& /*poses*/,
+                                   const std::vector<std::string>& /*tips*/, unsigned int attempt,
+                                   random_numbers::RandomNumberGenerator& /*rng*/, std::vector<double>& seed) const
+{
+  boost::mutex::scoped_lock slock(lock_);
+  if (attempt == 0 || attempt > seeds_.size() || seeds_[attempt - 1].size() != group->getVariableCount())
+    return false;
+  seed = seeds_[attempt - 1];
+  return true;
+}
+
+SolutionCacheIKSeedGenerator::SolutionCacheIKSeedGenerator(std::size_t max_size, double rotation_weight)
+  : max_size_(max_size), rotation_weight_(rotation_weight)
+{
+}
+
+double SolutionCacheIKSeedGenerator::distance(const Entry& entry, const EigenSTL::vector_Affine3d& poses) const
+{
+  double d = 0.0;
+  for (std::size_t i = 0; i < poses.size(); ++i)
+  {
+    d += (entry.poses[i].translation() - poses[i].translation()).norm();
+    if (rotation_weight_ > 0.0)
+      d += rotation_weight_ * Eigen::AngleAxisd(entry.poses[i].linear().transpose() * poses[i].linear()).angle();
+  }
+  return d;
+}
+
+bool SolutionCacheIKSeedGenerator::getSeed(const RobotState& /*state*/, const JointModelGroup* group,
+                                           const EigenSTL::vector_Affine3d& poses,
+                                           const std::vector<std::string>& tips, unsigned int attempt,
+                                           random_numbers::RandomNumberGenerator& /*rng*/,
+                                           std::vector<double>& seed) const
+{
+  if (attempt == 0)
+    return false;
+  boost::mutex::scoped_lock slock(lock_);
+  std::vector<std::pair<double, std::size_t> > candidates;
+  for (std::size_t i = 0; i < entries_.size(); ++i)
+    if (entries_[i].group == group && entries_[i].tips == tips && entries_[i].poses.size() == poses.size())
+      candidates.push_back(std::make_pair(distance(entries_[i], poses), i));
+  const std::size_t k = attempt - 1;
+  if (k >= candidates.size())
+    return false;
+  std::nth_element(candidates.begin(), candidates.begin() + k, candidates.end());
+  seed = entries_[candidates[k].second].solution;
+  return true;
+}
+
+void SolutionCacheIKSeedGenerator::addSolution(const JointModelGroup* group, const EigenSTL::vector_Affine3d& poses,
+                                               const std::vector<std::string>& tips,
+                                               const std::vector<double>& solution) const
+{
+  if (max_size_ == 0)
+    return;
+  boost::mutex::scoped_lock slock(lock_);
+  if (entries_.size() >= max_size_)
+    entries_.pop_front();
+  Entry entry;
+  entry.group = group;
+  entry.tips = tips;
+  entry.poses = poses;
+  entry.solution = solution;
+  entries_.push_back(entry);
+}
+
+std::size_t SolutionCacheIKSeedGenerator::getSize() const
+{
+  boost::mutex::scoped_lock slock(lock_);
+  return entries_.size();
+}
+
+void SolutionCacheIKSeedGenerator::clear()
+{
+  boost::mutex::scoped_lock slock(lock_);
+  entries_.clear();
+}
+
+CompositeIKSeedGenerator::CompositeIKSeedGenerator(const std::vector<IKSeedGeneratorConstPtr>& generators)
+  : generators_(generators)
+{
+}
+
+bool CompositeIKSeedGenerator::getSeed(const RobotState& state, const JointModelGroup* group,
+                                       const EigenSTL::vector_Affine3d& poses, const std::vector<std::string>& tips,
+                                       unsigned int attempt, random_numbers::RandomNumberGenerator& rng,
+                                       std::vector<double>& seed) const
+{
+  if (attempt == 0 || generators_.empty())
+    return false;
+  const std::size_t n = generators_.size();
+  return generators_[(attempt - 1) % n]->getSeed(state, group, poses, tips, (attempt - 1) / n + 1, rng, seed);
+}
+
+void CompositeIKSeedGenerator::addSolution(const JointModelGroup* group, const EigenSTL::vector_Affine3d& poses,
+                                           const std::vector<std::string>& tips,
+                                           const std::vector<double>& solution) const
+{
+  for (const IKSeedGeneratorConstPtr& generator : generators_)
+    generator->addSolution(group, poses, tips, solution);
+}
+}
+}
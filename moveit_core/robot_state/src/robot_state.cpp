@@ -36,13 +36,20 @@
 /* Author: Ioan Sucan, Sachin Chitta, Acorn Pooley, Mario Prats, Dave Coleman */
 
 #include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_state/ik_seed_generator.h>
 #include <moveit/transforms/transforms.h>
 #include <geometric_shapes/shape_operations.h>
 #include <eigen_conversions/eigen_msg.h>
 #include <moveit/backtrace/backtrace.h>
+#include <moveit/background_processing/thread_budget.h>
 #include <moveit/profiler/profiler.h>
+#include <moveit/profiler/probes.h>
 #include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
 #include <moveit/robot_model/aabb.h>
+#include <algorithm>
+#include <atomic>
 
 namespace moveit
 {
@@ -61,7 +68,7 @@ RobotState::RobotState(const RobotModelConstPtr& robot_model)
   , has_effort_(false)
   , dirty_link_transforms_(robot_model_->getRootJoint())
   , dirty_collision_body_transforms_(nullptr)
-  , rng_(nullptr)
+  , dirty_link_aabbs_(robot_model_->getRootJoint())
 {
   allocMemory();
 
@@ -71,19 +78,22 @@ RobotState::RobotState(const RobotModelConstPtr& robot_model)
   memset(dirty_joint_transforms_, 1, sizeof(double) * nr_doubles_for_dirty_joint_transforms);
 }
 
-RobotState::RobotState(const RobotState& other) : rng_(nullptr)
+RobotState::RobotState(const RobotState& other)
 {
   robot_model_ = other.robot_model_;
   allocMemory();
   copyFrom(other);
 }
 
+RobotState::RobotState(RobotState&& other) : memory_(nullptr)
+{
+  moveFrom(other);
+}
+
 RobotState::~RobotState()
 {
   clearAttachedBodies();
   free(memory_);
-  if (rng_)
-    delete rng_;
 }
 
 void RobotState::allocMemory()
@@ -116,14 +126,75 @@ RobotState& RobotState::operator=(const RobotState& other)
   return *this;
 }
 
+RobotState& RobotState::operator=(RobotState&& other)
+{
+  if (this != &other)
+  {
+    clearAttachedBodies();
+    free(memory_);
+    moveFrom(other);
+    if (attached_body_update_callback_)
+      for (std::map<std::string, AttachedBody*>::const_iterator it = attached_body_map_.begin();
+           it != attached_body_map_.end(); ++it)
+        attached_body_update_callback_(it->second, true);
+  }
+  return *this;
+}
+
+void RobotState::moveFrom(RobotState& other)
+{
+  robot_model_ = other.robot_model_;
+  memory_ = other.memory_;
+  position_ = other.position_;
+  velocity_ = other.velocity_;
+  acceleration_ = other.acceleration_;
+  effort_ = other.effort_;
+  has_velocity_ = other.has_velocity_;
+  has_acceleration_ = other.has_acceleration_;
+  has_effort_ = other.has_effort_;
+  dirty_link_transforms_ = other.dirty_link_transforms_;
+  dirty_collision_body_transforms_ = other.dirty_collision_body_transforms_;
+  dirty_link_aabbs_ = other.dirty_link_aabbs_;
+  link_aabbs_.swap(other.link_aabbs_);
+  variable_joint_transforms_ = other.variable_joint_transforms_;
+  global_link_transforms_ = other.global_link_transforms_;
+  global_collision_body_transforms_ = other.global_collision_body_transforms_;
+  dirty_joint_transforms_ = other.dirty_joint_transforms_;
+  attached_body_map_.swap(other.attached_body_map_);
+
+  // other no longer owns any memory
+  other.memory_ = nullptr;
+  other.position_ = other.velocity_ = other.acceleration_ = other.effort_ = nullptr;
+  other.variable_joint_transforms_ = other.global_link_transforms_ = other.global_collision_body_transforms_ = nullptr;
+  other.dirty_joint_transforms_ = nullptr;
+  other.attached_body_map_.clear();
+}
+
+void RobotState::copyPositionsFrom(const RobotState& other)
+{
+  if (!memory_)
+    allocMemory();
+  memcpy(position_, other.position_, robot_model_->getVariableCount() * sizeof(double));
+  has_velocity_ = false;
+  has_acceleration_ = false;
+  has_effort_ = false;
+  memset(dirty_joint_transforms_, 1, robot_model_->getJointModelCount() * sizeof(unsigned char));
+  dirty_link_transforms_ = robot_model_->getRootJoint();
+}
+
 void RobotState::copyFrom(const RobotState& other)
 {
+  // a state that was moved from has no memory
+  if (!memory_)
+    allocMemory();
+
   has_velocity_ = other.has_velocity_;
   has_acceleration_ = other.has_acceleration_;
   has_effort_ = other.has_effort_;
 
   dirty_collision_body_transforms_ = other.dirty_collision_body_transforms_;
   dirty_link_transforms_ = other.dirty_link_transforms_;
+  dirty_link_aabbs_ = robot_model_->getRootJoint();
 
   if (dirty_link_transforms_ == robot_model_->getRootJoint())
   {
@@ -539,6 +610,8 @@ void RobotState::copyJointGroupAccelerations(const JointModelGroup* group, Eigen
 
 void RobotState::update(bool force)
 {
+  MOVEIT_PROBE_SCOPE("RobotState::update");
+
   // make sure we do everything from scratch if needed
   if (force)
   {
@@ -578,12 +651,14 @@ void RobotState::updateLinkTransforms()
 {
   if (dirty_link_transforms_ != nullptr)
   {
+    MOVEIT_PROBE_SCOPE("RobotState::updateLinkTransforms");
     updateLinkTransformsInternal(dirty_link_transforms_);
     if (dirty_collision_body_transforms_)
       dirty_collision_body_transforms_ =
           robot_model_->getCommonRoot(dirty_collision_body_transforms_, dirty_link_transforms_);
     else
       dirty_collision_body_transforms_ = dirty_link_transforms_;
+    markDirtyLinkAABBs(dirty_link_transforms_);
     dirty_link_transforms_ = nullptr;
   }
 }
@@ -658,6 +733,7 @@ void RobotState::updateStateWithLinkAt(const LinkModel* link, const Eigen::Affin
         robot_model_->getCommonRoot(dirty_collision_body_transforms_, link->getParentJointModel());
   else
     dirty_collision_body_transforms_ = link->getParentJointModel();
+  markDirtyLinkAABBs(link->getParentJointModel());
 
   global_link_transforms_[link->getLinkIndex()] = transform;
 
@@ -692,6 +768,7 @@ void RobotState::updateStateWithLinkAt(const LinkModel* link, const Eigen::Affin
     }
     // all collision body transforms are invalid now
     dirty_collision_body_transforms_ = parent_link->getParentJointModel();
+    dirty_link_aabbs_ = parent_link->getParentJointModel();
   }
 
   // update attached bodies tf; these are usually very few, so we update them all
@@ -702,34 +779,65 @@ void RobotState::updateStateWithLinkAt(const LinkModel* link, const Eigen::Affin
 
 bool RobotState::satisfiesBounds(double margin) const
 {
-  const std::vector<const JointModel*>& jm = robot_model_->getActiveJointModels();
-  for (std::size_t i = 0; i < jm.size(); ++i)
-    if (!satisfiesBounds(jm[i], margin))
-      return false;
-  return true;
+  return satisfiesBoundsInternal(robot_model_->getActiveJointModels(), robot_model_->getActiveJointModelsSimpleBounds(),
+                                 margin);
 }
 
 bool RobotState::satisfiesBounds(const JointModelGroup* group, double margin) const
 {
-  const std::vector<const JointModel*>& jm = group->getActiveJointModels();
-  for (std::size_t i = 0; i < jm.size(); ++i)
-    if (!satisfiesBounds(jm[i], margin))
+  return satisfiesBoundsInternal(group->getActiveJointModels(), group->getActiveJointModelsSimpleBounds(), margin);
+}
+
+bool RobotState::satisfiesBoundsInternal(const std::vector<const JointModel*>& joints,
+                                         const std::vector<unsigned char>& simple_bounds, double margin) const
+{
+  for (std::size_t i = 0; i < joints.size(); ++i)
+  {
+    if (simple_bounds[i])
+    {
+      if (!JointModel::satisfiesSinglePositionBounds(position_[joints[i]->getFirstVariableIndex()],
+                                                     joints[i]->getVariableBounds()[0], margin))
+        return false;
+    }
+    else if (!satisfiesPositionBounds(joints[i], margin))
       return false;
+  }
+  if (has_velocity_)
+    for (std::size_t i = 0; i < joints.size(); ++i)
+      if (!satisfiesVelocityBounds(joints[i], margin))
+        return false;
   return true;
 }
 
 void RobotState::enforceBounds()
 {
-  const std::vector<const JointModel*>& jm = robot_model_->getActiveJointModels();
-  for (std::size_t i = 0; i < jm.size(); ++i)
-    enforceBounds(jm[i]);
+  enforceBoundsInternal(robot_model_->getActiveJointModels(), robot_model_->getActiveJointModelsSimpleBounds());
 }
 
 void RobotState::enforceBounds(const JointModelGroup* joint_group)
 {
-  const std::vector<const JointModel*>& jm = joint_group->getActiveJointModels();
-  for (std::size_t i = 0; i < jm.size(); ++i)
-    enforceBounds(jm[i]);
+  enforceBoundsInternal(joint_group->getActiveJointModels(), joint_group->getActiveJointModelsSimpleBounds());
+}
+
+void RobotState::enforceBoundsInternal(const std::vector<const JointModel*>& joints,
+                                       const std::vector<unsigned char>& simple_bounds)
+{
+  for (std::size_t i = 0; i < joints.size(); ++i)
+  {
+    if (simple_bounds[i])
+    {
+      if (JointModel::enforceSinglePositionBounds(position_[joints[i]->getFirstVariableIndex()],
+                                                  joints[i]->getVariableBounds()[0]))
+      {
+        markDirtyJointTransforms(joints[i]);
+        updateMimicJoint(joints[i]);
+      }
+    }
+    else
+      enforcePositionBounds(joints[i]);
+    if (has_velocity_)
+      enforceVelocityBounds(joints[i]);
+  }
 }
 
 std::pair<double, const JointModel*> RobotState::getMinDistanceToPositionBounds() const
@@ -1355,6 +1463,35 @@ bool ikCallbackFnAdapter(RobotState* state, const JointModelGroup* group,
     error_code.val = moveit_msgs::MoveItErrorCodes::NO_IK_SOLUTION;
   return true;
 }
+
+// Fill the solver ordered seed of attempt st > 0 of a setFromIK() query, started at initial_values
+void computeIKSeed(const RobotState& state, const JointModelGroup* jmg,
+                   const kinematics::KinematicsBaseConstPtr& solver, const EigenSTL::vector_Affine3d& poses,
+                   const std::vector<std::string>& tips, const std::vector<double>& initial_values, unsigned int st,
+                   const kinematics::KinematicsQueryOptions& options, random_numbers::RandomNumberGenerator& rng,
+                   std::vector<double>& seed)
+{
+  const std::vector<unsigned int>& bij = jmg->getKinematicsSolverJointBijection();
+  const IKSeedGeneratorConstPtr& seed_generator = jmg->getIKSeedGenerator();
+  std::vector<double> values;
+  if (!seed_generator || !seed_generator->getSeed(state, jmg, poses, tips, st, rng, values) ||
+      values.size() != initial_values.size())
+  {
+    ROS_DEBUG_NAMED("robot_state", "Rerunning IK solver with random joint positions");
+    jmg->getVariableRandomPositions(rng, values);
+  }
+  seed.resize(bij.size());
+  for (std::size_t i = 0; i < bij.size(); ++i)
+    seed[i] = values[bij[i]];
+
+  if (options.lock_redundant_joints)
+  {
+    std::vector<unsigned int> red_joints;
+    solver->getRedundantJoints(red_joints);
+    for (std::size_t i = 0; i < red_joints.size(); ++i)
+      seed[red_joints[i]] = initial_values[bij[red_joints[i]]];
+  }
+}
 }
 
 bool RobotState::setToIKSolverFrame(Eigen::Affine3d& pose, const kinematics::KinematicsBaseConstPtr& solver)
@@ -1408,6 +1545,8 @@ bool RobotState::setFromIK(const JointModelGroup* jmg, const EigenSTL::vector_Af
                            double timeout, const GroupStateValidityCallbackFn& constraint,
                            const kinematics::KinematicsQueryOptions& options)
 {
+  MOVEIT_PROBE_SCOPE("RobotState::setFromIK");
+
   // Error check
   if (poses_in.size() != tips_in.size())
   {
@@ -1609,64 +1748,103 @@ bool RobotState::setFromIK(const JointModelGroup* jmg, const EigenSTL::vector_Af
   if (attempts == 0)
     attempts = jmg->getDefaultIKAttempts();
 
-  // set callback function
-  kinematics::KinematicsBase::IKCallbackFn ik_callback_fn;
-  if (constraint)
-    ik_callback_fn = boost::bind(&ikCallbackFnAdapter, this, jmg, constraint, _1, _2, _3);
-
   // Bijection
   const std::vector<unsigned int>& bij = jmg->getKinematicsSolverJointBijection();
 
-  bool first_seed = true;
+  // the first seed is the current robot state joint values; the validity callback may change this state, so the
+  // values are kept for the seeds that follow
   std::vector<double> initial_values;
-  for (unsigned int st = 0; st < attempts; ++st)
+  copyJointGroupPositions(jmg, initial_values);
+
+  unsigned int threads = jmg->getIKSeedThreads();
+  if (threads == 0)
+    threads = moveit::tools::ThreadBudget::getConcurrency();
+  threads = std::max(1u, std::min(threads, attempts));
+  moveit::tools::ThreadBudget::Reservation reservation("kinematics", threads);
+  threads = reservation.getThreads();
+
+  std::vector<double> ik_sol;
+  bool found = false;
+  if (threads > 1)
+  {
+    // run the attempts on several threads, each with its own copy of the state for the validity callback and the
+    // random seeds; the first solution found wins, and threads stop once their current attempt returns
+    std::atomic<unsigned int> next_attempt(0);
+    std::atomic<bool> solved(false);
+    boost::mutex solution_lock;
+    auto worker = [&]() {
+      RobotState state(*this);
+      kinematics::KinematicsBase::IKCallbackFn callback;
+      if (constraint)
+        callback = boost::bind(&ikCallbackFnAdapter, &state, jmg, constraint, _1, _2, _3);
+      std::vector<double> seed(bij.size());
+      unsigned int st;
+      while (!solved && (st = next_attempt++) < attempts)
+      {
+        if (st == 0)
+          for (std::size_t i = 0; i < bij.size(); ++i)
+            seed[i] = initial_values[bij[i]];
+        else
+          computeIKSeed(*this, jmg, solver, poses_in, tips_in, initial_values, st, options,
+                        state.getRandomNumberGenerator(), seed);
+        std::vector<double> sol;
+        moveit_msgs::MoveItErrorCodes error;
+        if (solver->searchPositionIK(ik_queries, seed, timeout, consistency_limits, sol, callback, error, options,
+                                     &state))
+        {
+          boost::mutex::scoped_lock slock(solution_lock);
+          if (!solved)
+          {
+            ik_sol.swap(sol);
+            solved = true;
+          }
+          return;
+        }
+      }
+    };
+    boost::thread_group workers;
+    for (unsigned int t = 1; t < threads; ++t)
+      workers.create_thread(worker);
+    worker();
+    workers.join_all();
+    found = solved;
+  }
+  else
   {
-    std::vector<double> seed(bij.size());
+    // set callback function
+    kinematics::KinematicsBase::IKCallbackFn ik_callback_fn;
+    if (constraint)
+      ik_callback_fn = boost::bind(&ikCallbackFnAdapter, this, jmg, constraint, _1, _2, _3);
 
-    // the first seed is the current robot state joint values
-    if (first_seed)
-    {
-      first_seed = false;
-      copyJointGroupPositions(jmg, initial_values);
-      for (std::size_t i = 0; i < bij.size(); ++i)
-        seed[i] = initial_values[bij[i]];
-    }
-    else
+    std::vector<double> seed(bij.size());
+    for (std::size_t i = 0; i < bij.size(); ++i)
+      seed[i] = initial_values[bij[i]];
+    for (unsigned int st = 0; st < attempts && !found; ++st)
     {
-      ROS_DEBUG_NAMED("robot_state", "Rerunning IK solver with random joint positions");
+      if (st > 0)
+        computeIKSeed(*this, jmg, solver, poses_in, tips_in, initial_values, st, options, getRandomNumberGenerator(),
+                      seed);
 
-      // sample a random seed
-      random_numbers::RandomNumberGenerator& rng = getRandomNumberGenerator();
-      std::vector<double> random_values;
-      jmg->getVariableRandomPositions(rng, random_values);
-      for (std::size_t i = 0; i < bij.size(); ++i)
-        seed[i] = random_values[bij[i]];
-
-      if (options.lock_redundant_joints)
-      {
-        std::vector<unsigned int> red_joints;
-        solver->getRedundantJoints(red_joints);
-        copyJointGroupPositions(jmg, initial_values);
-        for (std::size_t i = 0; i < red_joints.size(); ++i)
-          seed[red_joints[i]] = initial_values[bij[red_joints[i]]];
-      }
+      // compute the IK solution
+      moveit_msgs::MoveItErrorCodes error;
+      found = solver->searchPositionIK(ik_queries, seed, timeout, consistency_limits, ik_sol, ik_callback_fn, error,
+                                       options, this);
     }
+  }
 
-    // compute the IK solution
-    std::vector<double> ik_sol;
-    moveit_msgs::MoveItErrorCodes error;
-
-    if (solver->searchPositionIK(ik_queries, seed, timeout, consistency_limits, ik_sol, ik_callback_fn, error, options,
-                                 this))
-    {
-      std::vector<double> solution(bij.size());
-      for (std::size_t i = 0; i < bij.size(); ++i)
-        solution[bij[i]] = ik_sol[i];
-      setJointGroupPositions(jmg, solution);
-      return true;
-    }
+  if (!found)
+  {
+    MOVEIT_PROBE_COUNT("RobotState::setFromIK failed", 1);
+    return false;
   }
-  return false;
+  MOVEIT_PROBE_COUNT("RobotState::setFromIK solved", 1);
+  std::vector<double> solution(bij.size());
+  for (std::size_t i = 0; i < bij.size(); ++i)
+    solution[bij[i]] = ik_sol[i];
+  setJointGroupPositions(jmg, solution);
+  if (jmg->getIKSeedGenerator())
+    jmg->getIKSeedGenerator()->addSolution(jmg, poses_in, tips_in, solution);
+  return true;
 }
 
 bool RobotState::setFromIKSubgroups(const JointModelGroup* jmg, const EigenSTL::vector_Affine3d& poses_in,
@@ -1894,7 +2072,7 @@ double RobotState::computeCartesianPath(const JointModelGroup* group, std::vecto
 double RobotState::computeCartesianPath(const JointModelGroup* group, std::vector<RobotStatePtr>& traj,
                                         const LinkModel* link, const Eigen::Affine3d& target,
                                         bool global_reference_frame, const MaxEEFStep& max_step,
-                                        const JumpThreshold& jump_threshold,
+                                        const AdaptiveEEFStep& adaptive_step, const JumpThreshold& jump_threshold,
                                         const GroupStateValidityCallbackFn& validCallback,
                                         const kinematics::KinematicsQueryOptions& options)
 {
@@ -1942,20 +2120,56 @@ double RobotState::computeCartesianPath(const JointModelGroup* group, std::vecto
   traj.push_back(RobotStatePtr(new RobotState(*this)));
 
   double last_valid_percentage = 0.0;
-  for (std::size_t i = 1; i <= steps; ++i)
+  if (adaptive_step.max_joint_step > 0.0)
   {
-    double percentage = (double)i / (double)steps;
+    const double min_scale = std::min(1.0, adaptive_step.min_scale);
+    const double max_scale = std::max(1.0, adaptive_step.max_scale);
+    double scale = 1.0;
+    std::vector<double> previous_positions;
+    while (last_valid_percentage < 1.0)
+    {
+      double percentage = std::min(1.0, last_valid_percentage + scale / (double)steps);
 
-    Eigen::Affine3d pose(start_quaternion.slerp(percentage, target_quaternion));
-    pose.translation() = percentage * rotated_target.translation() + (1 - percentage) * start_pose.translation();
+      Eigen::Affine3d pose(start_quaternion.slerp(percentage, target_quaternion));
+      pose.translation() = percentage * rotated_target.translation() + (1 - percentage) * start_pose.translation();
 
-    if (setFromIK(group, pose, link->getName(), 1, 0.0, validCallback, options))
-      traj.push_back(RobotStatePtr(new RobotState(*this)));
-    else
-      break;
+      bool found = setFromIK(group, pose, link->getName(), 1, 0.0, validCallback, options);
+      if (found && scale > min_scale && distance(*traj.back(), group) > adaptive_step.max_joint_step)
+        found = false;  // too much joint motion for this step; retry with a smaller one
+      else if (!found && scale <= min_scale)
+        break;
 
-    last_valid_percentage = percentage;
+      if (!found)
+      {
+        // IK is seeded from the current state, so restore the last accepted point before retrying
+        traj.back()->copyJointGroupPositions(group, previous_positions);
+        setJointGroupPositions(group, previous_positions);
+        update();
+        scale = std::max(min_scale, scale * 0.5);
+        continue;
+      }
+
+      if (distance(*traj.back(), group) < 0.5 * adaptive_step.max_joint_step)
+        scale = std::min(max_scale, scale * 2.0);
+      traj.push_back(RobotStatePtr(new RobotState(*this)));
+      last_valid_percentage = percentage;
+    }
   }
+  else
+    for (std::size_t i = 1; i <= steps; ++i)
+    {
+      double percentage = (double)i / (double)steps;
+
+      Eigen::Affine3d pose(start_quaternion.slerp(percentage, target_quaternion));
+      pose.translation() = percentage * rotated_target.translation() + (1 - percentage) * start_pose.translation();
+
+      if (setFromIK(group, pose, link->getName(), 1, 0.0, validCallback, options))
+        traj.push_back(RobotStatePtr(new RobotState(*this)));
+      else
+        break;
+
+      last_valid_percentage = percentage;
+    }
 
   last_valid_percentage *= testJointSpaceJump(group, traj, jump_threshold);
 
@@ -1965,7 +2179,7 @@ double RobotState::computeCartesianPath(const JointModelGroup* group, std::vecto
 double RobotState::computeCartesianPath(const JointModelGroup* group, std::vector<RobotStatePtr>& traj,
                                         const LinkModel* link, const EigenSTL::vector_Affine3d& waypoints,
                                         bool global_reference_frame, const MaxEEFStep& max_step,
-                                        const JumpThreshold& jump_threshold,
+                                        const AdaptiveEEFStep& adaptive_step, const JumpThreshold& jump_threshold,
                                         const GroupStateValidityCallbackFn& validCallback,
                                         const kinematics::KinematicsQueryOptions& options)
 {
@@ -1975,8 +2189,9 @@ double RobotState::computeCartesianPath(const JointModelGroup* group, std::vecto
     // Don't test joint space jumps for every waypoint, test them later on the whole trajectory.
     static const JumpThreshold no_joint_space_jump_test;
     std::vector<RobotStatePtr> waypoint_traj;
-    double wp_percentage_solved = computeCartesianPath(group, waypoint_traj, link, waypoints[i], global_reference_frame,
-                                                       max_step, no_joint_space_jump_test, validCallback, options);
+    double wp_percentage_solved =
+        computeCartesianPath(group, waypoint_traj, link, waypoints[i], global_reference_frame, max_step, adaptive_step,
+                             no_joint_space_jump_test, validCallback, options);
     if (fabs(wp_percentage_solved - 1.0) < std::numeric_limits<double>::epsilon())
     {
       percentage_solved = (double)(i + 1) / (double)waypoints.size();
@@ -2106,6 +2321,68 @@ double RobotState::testAbsoluteJointSpaceJump(const JointModelGroup* group, std:
   return 1.0;
 }
 
+void RobotState::computeAABB(std::vector<double>& aabb)
+{
+  updateLinkTransforms();
+
+  if (link_aabbs_.size() != 6 * robot_model_->getLinkModelCount())
+  {
+    link_aabbs_.resize(6 * robot_model_->getLinkModelCount());
+    dirty_link_aabbs_ = robot_model_->getRootJoint();
+  }
+  if (dirty_link_aabbs_)
+  {
+    const std::vector<const LinkModel*>& links = dirty_link_aabbs_->getDescendantLinkModels();
+    for (std::size_t i = 0; i < links.size(); ++i)
+      if (!links[i]->getShapes().empty())
+      {
+        Eigen::Affine3d transform = global_link_transforms_[links[i]->getLinkIndex()];
+        transform.translate(links[i]->getCenteredBoundingBoxOffset());
+        core::AABB box;
+        box.extendWithTransformedBox(transform, links[i]->getShapeExtentsAtOrigin());
+        double* cached = &link_aabbs_[6 * links[i]->getLinkIndex()];
+        Eigen::Map<Eigen::Vector3d, Eigen::Unaligned, Eigen::InnerStride<2> >(cached) = box.min();
+        Eigen::Map<Eigen::Vector3d, Eigen::Unaligned, Eigen::InnerStride<2> >(cached + 1) = box.max();
+      }
+    dirty_link_aabbs_ = nullptr;
+  }
+
+  aabb.assign(6, 0.0);
+  const std::vector<const LinkModel*>& links = robot_model_->getLinkModelsWithCollisionGeometry();
+  bool empty = links.empty();
+  if (!empty)
+    std::copy(&link_aabbs_[6 * links[0]->getLinkIndex()], &link_aabbs_[6 * links[0]->getLinkIndex()] + 6,
+              aabb.begin());
+  for (std::size_t i = 1; i < links.size(); ++i)
+  {
+    const double* cached = &link_aabbs_[6 * links[i]->getLinkIndex()];
+    for (std::size_t j = 0; j < 6; j += 2)
+    {
+      aabb[j] = std::min(aabb[j], cached[j]);
+      aabb[j + 1] = std::max(aabb[j + 1], cached[j + 1]);
+    }
+  }
+
+  // attached bodies are usually few and may change at any time, so their boxes are not cached
+  for (std::map<std::string, AttachedBody*>::const_iterator it = attached_body_map_.begin();
+       it != attached_body_map_.end(); ++it)
+  {
+    const EigenSTL::vector_Affine3d& transforms = it->second->getGlobalCollisionBodyTransforms();
+    const std::vector<shapes::ShapeConstPtr>& shapes = it->second->getShapes();
+    for (std::size_t i = 0; i < transforms.size(); ++i)
+    {
+      core::AABB box;
+      box.extendWithTransformedBox(transforms[i], shapes::computeShapeExtents(shapes[i].get()));
+      for (std::size_t j = 0; j < 3; ++j)
+      {
+        aabb[2 * j] = empty ? box.min()[j] : std::min(aabb[2 * j], box.min()[j]);
+        aabb[2 * j + 1] = empty ? box.max()[j] : std::max(aabb[2 * j + 1], box.max()[j]);
+      }
+      empty = false;
+    }
+  }
+}
+
 void RobotState::computeAABB(std::vector<double>& aabb) const
 {
   BOOST_VERIFY(checkLinkTransforms());
@@ -0,0 +1,135 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/robot_state/variable_set_handle.h>
+#include <moveit/robot_state/robot_state.h>
+
+namespace moveit
+{
+namespace core
+{
+VariableSetHandle::VariableSetHandle(const RobotModelConstPtr& robot_model,
+                                     const std::vector<std::string>& variable_names)
+  : robot_model_(robot_model), dirty_root_(nullptr)
+{
+  variable_indices_.reserve(variable_names.size());
+  std::vector<bool> seen(robot_model_->getJointModelCount(), false);
+  for (const std::string& name : variable_names)
+  {
+    const int index = robot_model_->getVariableIndex(name);
+    variable_indices_.push_back(index);
+    const JointModel* jm = robot_model_->getJointOfVariable(index);
+    if (!jm || seen[jm->getJointIndex()])
+      continue;
+    seen[jm->getJointIndex()] = true;
+    dirty_joints_.push_back(jm->getJointIndex());
+    dirty_root_ = dirty_root_ ? robot_model_->getCommonRoot(dirty_root_, jm) : jm;
+    for (const JointModel* mimic : jm->getMimicRequests())
+      mimic_joints_.push_back(mimic);
+  }
+  for (const JointModel* mimic : mimic_joints_)
+    if (!seen[mimic->getJointIndex()])
+    {
+      seen[mimic->getJointIndex()] = true;
+      dirty_joints_.push_back(mimic->getJointIndex());
+      dirty_root_ = robot_model_->getCommonRoot(dirty_root_, mimic);
+    }
+}
+
+void VariableSetHandle::setPositions(RobotState& state, const double* positions) const
+{
+  assert(state.getRobotModel() == robot_model_);
+  double* p = state.position_;
+  for (std::size_t i = 0; i < variable_indices_.size(); ++i)
+    p[variable_indices_[i]] = positions[i];
+  for (const JointModel* mimic : mimic_joints_)
+    p[mimic->getFirstVariableIndex()] =
+        mimic->getMimicFactor() * p[mimic->getMimic()->getFirstVariableIndex()] + mimic->getMimicOffset();
+
+  if (!dirty_root_)
+    return;
+  for (int joint : dirty_joints_)
+    state.dirty_joint_transforms_[joint] = 1;
+  state.dirty_link_transforms_ = state.dirty_link_transforms_ == nullptr ?
+                                     dirty_root_ :
+                                     robot_model_->getCommonRoot(state.dirty_link_transforms_, dirty_root_);
+}
+
+void VariableSetHandle::getPositions(const RobotState& state, double* positions) const
+{
+  const double* p = state.getVariablePositions();
+  for (std::size_t i = 0; i < variable_indices_.size(); ++i)
+    positions[i] = p[variable_indices_[i]];
+}
+
+void VariableSetHandle::setVelocities(RobotState& state, const double* velocities) const
+{
+  state.markVelocity();
+  for (std::size_t i = 0; i < variable_indices_.size(); ++i)
+    state.velocity_[variable_indices_[i]] = velocities[i];
+}
+
+void VariableSetHandle::getVelocities(const RobotState& state, double* velocities) const
+{
+  for (std::size_t i = 0; i < variable_indices_.size(); ++i)
+    velocities[i] = state.velocity_[variable_indices_[i]];
+}
+
+void VariableSetHandle::setAccelerations(RobotState& state, const double* accelerations) const
+{
+  state.markAcceleration();
+  for (std::size_t i = 0; i < variable_indices_.size(); ++i)
+    state.acceleration_[variable_indices_[i]] = accelerations[i];
+}
+
+void VariableSetHandle::getAccelerations(const RobotState& state, double* accelerations) const
+{
+  for (std::size_t i = 0; i < variable_indices_.size(); ++i)
+    accelerations[i] = state.acceleration_[variable_indices_[i]];
+}
+
+void VariableSetHandle::setEfforts(RobotState& state, const double* efforts) const
+{
+  state.markEffort();
+  for (std::size_t i = 0; i < variable_indices_.size(); ++i)
+    state.effort_[variable_indices_[i]] = efforts[i];
+}
+
+void VariableSetHandle::getEfforts(const RobotState& state, double* efforts) const
+{
+  for (std::size_t i = 0; i < variable_indices_.size(); ++i)
+    efforts[i] = state.effort_[variable_indices_[i]];
+}
+}
+}
@@ -36,6 +36,10 @@
 #include <moveit_resources/config.h>
 #include <moveit/robot_model/robot_model.h>
 #include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_state/ik_seed_generator.h>
+#include <moveit/robot_state/conversions.h>
+#include <moveit/robot_state/variable_set_handle.h>
+#include <geometric_shapes/shapes.h>
 #include <urdf_parser/urdf_parser.h>
 #include <gtest/gtest.h>
 #include <sstream>
@@ -709,6 +713,253 @@ TEST_F(OneRobot, testRelativeJointSpaceJump)
   EXPECT_NEAR(1.0, fraction, 0.01);
 }
 
+TEST_F(OneRobot, IKSeedGenerators)
+{
+  moveit::core::RobotState state(robot_model);
+  state.setToDefaultValues();
+  state.update();
+  const moveit::core::JointModelGroup* group = robot_model->getJointModelGroup("base_from_joints");
+  ASSERT_TRUE(group);
+  random_numbers::RandomNumberGenerator& rng = state.getRandomNumberGenerator();
+  EigenSTL::vector_Affine3d poses(1, Eigen::Affine3d::Identity());
+  std::vector<std::string> tips(1, "link_c");
+
+  EXPECT_DOUBLE_EQ(0.5, moveit::core::HaltonIKSeedGenerator::getRadicalInverse(1, 2));
+  EXPECT_DOUBLE_EQ(0.75, moveit::core::HaltonIKSeedGenerator::getRadicalInverse(3, 2));
+  EXPECT_DOUBLE_EQ(2.0 / 9.0, moveit::core::HaltonIKSeedGenerator::getRadicalInverse(5, 3));
+
+  // the seeds of the prismatic joint spread over its bounds without repeating
+  moveit::core::HaltonIKSeedGenerator halton;
+  int joint_c = group->getVariableGroupIndex("joint_c");
+  ASSERT_GE(joint_c, 0);
+  std::vector<double> values;
+  for (unsigned int attempt = 1; attempt <= 8; ++attempt)
+  {
+    std::vector<double> seed;
+    ASSERT_TRUE(halton.getSeed(state, group, poses, tips, attempt, rng, seed));
+    ASSERT_EQ(group->getVariableCount(), seed.size());
+    EXPECT_GE(seed[joint_c], 0.0);
+    EXPECT_LE(seed[joint_c], 0.09);
+    for (double v : values)
+      EXPECT_GT(std::abs(v - seed[joint_c]), 1e-6);
+    values.push_back(seed[joint_c]);
+  }
+
+  // fixed seeds are used in order and then run out
+  moveit::core::FixedIKSeedGeneratorPtr fixed(new moveit::core::FixedIKSeedGenerator());
+  std::vector<double> a(group->getVariableCount(), 0.01), b(group->getVariableCount(), 0.02);
+  fixed->addSeed(a);
+  fixed->addSeed(b);
+  std::vector<double> seed;
+  ASSERT_TRUE(fixed->getSeed(state, group, poses, tips, 2, rng, seed));
+  EXPECT_EQ(b, seed);
+  EXPECT_FALSE(fixed->getSeed(state, group, poses, tips, 3, rng, seed));
+
+  // cached solutions come back nearest first, and only for the same tips
+  moveit::core::SolutionCacheIKSeedGeneratorPtr cache(new moveit::core::SolutionCacheIKSeedGenerator(2));
+  EigenSTL::vector_Affine3d near_poses(1, Eigen::Affine3d(Eigen::Translation3d(0.1, 0.0, 0.0)));
+  EigenSTL::vector_Affine3d far_poses(1, Eigen::Affine3d(Eigen::Translation3d(1.0, 0.0, 0.0)));
+  cache->addSolution(group, far_poses, tips, b);
+  cache->addSolution(group, near_poses, tips, a);
+  ASSERT_TRUE(cache->getSeed(state, group, poses, tips, 1, rng, seed));
+  EXPECT_EQ(a, seed);
+  ASSERT_TRUE(cache->getSeed(state, group, poses, tips, 2, rng, seed));
+  EXPECT_EQ(b, seed);
+  EXPECT_FALSE(cache->getSeed(state, group, poses, std::vector<std::string>(1, "link_b"), 1, rng, seed));
+  cache->addSolution(group, poses, tips, b);
+  EXPECT_EQ(2u, cache->getSize());
+
+  // a composite takes turns between its generators
+  std::vector<moveit::core::IKSeedGeneratorConstPtr> generators;
+  generators.push_back(fixed);
+  generators.push_back(cache);
+  moveit::core::CompositeIKSeedGenerator composite(generators);
+  ASSERT_TRUE(composite.getSeed(state, group, poses, tips, 1, rng, seed));
+  EXPECT_EQ(a, seed);
+  ASSERT_TRUE(composite.getSeed(state, group, poses, tips, 3, rng, seed));
+  EXPECT_EQ(b, seed);
+  EXPECT_FALSE(composite.getSeed(state, group, poses, tips, 5, rng, seed));
+}
+
+TEST_F(OneRobot, VariableSetHandle)
+{
+  moveit::core::RobotState state(robot_model);
+  state.setToDefaultValues();
+  state.update();
+  moveit::core::RobotState expected(state);
+
+  const std::vector<std::string> names = { "joint_f", "joint_a", "joint_c" };
+  moveit::core::VariableSetHandle variables(robot_model, names);
+  ASSERT_EQ(variables.size(), names.size());
+  for (std::size_t i = 0; i < names.size(); ++i)
+    EXPECT_EQ(variables.getVariableIndices()[i], robot_model->getVariableIndex(names[i]));
+
+  // the result is the same as setting the variables one by one, mimic joints included
+  const std::vector<double> positions = { 0.1, 0.3, 0.05 };
+  variables.setPositions(state, positions);
+  for (std::size_t i = 0; i < names.size(); ++i)
+    expected.setVariablePosition(names[i], positions[i]);
+  EXPECT_TRUE(state.dirtyLinkTransforms());
+  EXPECT_DOUBLE_EQ(1.5 * 0.1 + 0.1, state.getVariablePosition("mim_f"));
+  state.update();
+  expected.update();
+  for (const std::string& name : robot_model->getVariableNames())
+    EXPECT_DOUBLE_EQ(expected.getVariablePosition(name), state.getVariablePosition(name)) << name;
+  for (const moveit::core::LinkModel* link : robot_model->getLinkModels())
+    EXPECT_TRUE(state.getGlobalLinkTransform(link).isApprox(expected.getGlobalLinkTransform(link), 1e-12))
+        << link->getName();
+
+  std::vector<double> values;
+  variables.getPositions(state, values);
+  EXPECT_EQ(positions, values);
+
+  const std::vector<double> velocities = { -0.1, 0.2, 0.3 };
+  variables.setVelocities(state, velocities);
+  EXPECT_TRUE(state.hasVelocities());
+  values.resize(names.size());
+  variables.getVelocities(state, values.data());
+  EXPECT_EQ(velocities, values);
+  EXPECT_EQ(0.2, state.getVariableVelocity("joint_a"));
+
+  const std::vector<std::string> unknown = { "joint_a", "no_such_joint" };
+  EXPECT_THROW(moveit::core::VariableSetHandle handle(robot_model, unknown), moveit::Exception);
+}
+
+TEST_F(OneRobot, EnforceAndSatisfyBounds)
+{
+  const moveit::core::JointModelGroup* group = robot_model->getJointModelGroup("base_from_joints");
+  // the planar base and the continuous joint_a go through their joint models, the prismatic joint_c is clamped inline
+  const std::vector<unsigned char> simple_bounds = { 0, 0, 1 };
+  EXPECT_EQ(simple_bounds, group->getActiveJointModelsSimpleBounds());
+
+  moveit::core::RobotState state(robot_model);
+  state.setToDefaultValues();
+  state.setVariablePosition("joint_a", 4.0);
+  state.setVariablePosition("joint_c", 0.5);
+  state.update();
+  EXPECT_FALSE(state.satisfiesBounds(group));
+  EXPECT_TRUE(state.satisfiesBounds(group, 0.5));
+  state.enforceBounds(group);
+  EXPECT_TRUE(state.dirtyLinkTransforms());
+  EXPECT_TRUE(state.satisfiesBounds(group));
+  EXPECT_DOUBLE_EQ(0.09, state.getVariablePosition("joint_c"));
+  EXPECT_NEAR(4.0 - 2.0 * M_PI, state.getVariablePosition("joint_a"), 1e-12);
+
+  // mimic joints follow the clamped joint
+  state.setVariablePosition("joint_f", 1.0);
+  EXPECT_FALSE(state.satisfiesBounds());
+  state.enforceBounds();
+  EXPECT_TRUE(state.satisfiesBounds());
+  EXPECT_DOUBLE_EQ(0.19, state.getVariablePosition("joint_f"));
+  EXPECT_DOUBLE_EQ(1.5 * 0.19 + 0.1, state.getVariablePosition("mim_f"));
+
+  // the group level functions work on group ordered values
+  std::vector<double> values(group->getVariableCount(), 0.0);
+  const int joint_c = group->getVariableGroupIndex("joint_c");
+  values[joint_c] = -1.0;
+  EXPECT_FALSE(group->satisfiesPositionBounds(values.data()));
+  EXPECT_TRUE(group->enforcePositionBounds(values.data()));
+  EXPECT_DOUBLE_EQ(0.0, values[joint_c]);
+  EXPECT_FALSE(group->enforcePositionBounds(values.data()));
+}
+
+TEST_F(OneRobot, MoveAndPartialCopy)
+{
+  moveit::core::RobotState state(robot_model);
+  state.setToRandomPositions();
+  state.setVariableVelocity("joint_a", 0.5);
+  std::vector<shapes::ShapeConstPtr> shapes(1, shapes::ShapeConstPtr(new shapes::Sphere(0.1)));
+  EigenSTL::vector_Affine3d poses(1, Eigen::Affine3d::Identity());
+  state.attachBody("object", shapes, poses, std::set<std::string>(), "link_a");
+  state.update();
+  const moveit::core::RobotState expected(state);
+
+  // moving takes over the positions, velocities and attached bodies
+  moveit::core::RobotState moved(std::move(state));
+  EXPECT_TRUE(moved.hasVelocities());
+  EXPECT_TRUE(moved.hasAttachedBody("object"));
+  for (const std::string& name : robot_model->getVariableNames())
+    EXPECT_EQ(expected.getVariablePosition(name), moved.getVariablePosition(name)) << name;
+
+  // a moved from state can be assigned to again
+  state = expected;
+  EXPECT_TRUE(state.hasAttachedBody("object"));
+  EXPECT_EQ(expected.getVariablePosition("joint_a"), state.getVariablePosition("joint_a"));
+
+  moveit::core::RobotState other(robot_model);
+  other.setToDefaultValues();
+  other = std::move(moved);
+  EXPECT_TRUE(other.hasAttachedBody("object"));
+  EXPECT_EQ(expected.getVariablePosition("joint_a"), other.getVariablePosition("joint_a"));
+
+  // copying positions only keeps the attached bodies of the target and marks the transforms dirty
+  moveit::core::RobotState positions(robot_model);
+  positions.setToDefaultValues();
+  positions.update();
+  positions.copyPositionsFrom(expected);
+  EXPECT_FALSE(positions.hasVelocities());
+  EXPECT_FALSE(positions.hasAttachedBody("object"));
+  EXPECT_TRUE(positions.dirtyLinkTransforms());
+  positions.update();
+  for (const moveit::core::LinkModel* link : robot_model->getLinkModels())
+    EXPECT_TRUE(positions.getGlobalLinkTransform(link).isApprox(expected.getGlobalLinkTransform(link), 1e-12))
+        << link->getName();
+}
+
+TEST_F(OneRobot, CachedConversions)
+{
+  moveit::core::RobotState state(robot_model);
+  state.setToDefaultValues();
+  state.update();
+  moveit::core::ConversionContext context;
+
+  sensor_msgs::JointState js;
+  js.name = { "joint_c", "joint_f", "joint_a" };
+  js.position = { 0.05, 0.1, 0.3 };
+  for (std::size_t i = 0; i < 2; ++i)
+  {
+    // the second message reuses the cached indices; the result must be the same as without a context
+    js.position[0] += 0.01 * i;
+    moveit::core::RobotState expected(state);
+    ASSERT_TRUE(moveit::core::jointStateToRobotState(js, expected));
+    ASSERT_TRUE(moveit::core::jointStateToRobotState(js, state, context));
+    for (const std::string& name : robot_model->getVariableNames())
+      EXPECT_DOUBLE_EQ(expected.getVariablePosition(name), state.getVariablePosition(name)) << name;
+  }
+  EXPECT_DOUBLE_EQ(0.06, state.getVariablePosition("joint_c"));
+  EXPECT_DOUBLE_EQ(1.5 * 0.1 + 0.1, state.getVariablePosition("mim_f"));
+
+  // a different order of names is looked up again
+  js.name = { "joint_a", "joint_c", "joint_f" };
+  ASSERT_TRUE(moveit::core::jointStateToRobotState(js, state, context));
+  EXPECT_DOUBLE_EQ(0.06, state.getVariablePosition("joint_a"));
+  EXPECT_DOUBLE_EQ(0.1, state.getVariablePosition("joint_c"));
+
+  // messages written into the same message object match the uncached conversion
+  moveit_msgs::RobotState msg, expected_msg;
+  moveit::core::robotStateToRobotStateMsg(state, expected_msg);
+  moveit::core::robotStateToRobotStateMsg(state, msg, context);
+  state.setVariablePosition("joint_c", 0.02);
+  moveit::core::robotStateToRobotStateMsg(state, msg, context);
+  EXPECT_EQ(expected_msg.joint_state.name, msg.joint_state.name);
+  moveit::core::RobotState copy(robot_model);
+  ASSERT_TRUE(moveit::core::robotStateMsgToRobotState(msg, copy, context));
+  EXPECT_DOUBLE_EQ(0.02, copy.getVariablePosition("joint_c"));
+  EXPECT_DOUBLE_EQ(0.06, copy.getVariablePosition("joint_a"));
+
+  trajectory_msgs::JointTrajectory trajectory;
+  trajectory.joint_names = { "joint_f", "joint_c" };
+  trajectory.points.resize(2);
+  trajectory.points[0].positions = { 0.01, 0.02 };
+  trajectory.points[1].positions = { 0.03, 0.04 };
+  for (std::size_t i = 0; i < trajectory.points.size(); ++i)
+  {
+    ASSERT_TRUE(moveit::core::jointTrajPointToRobotState(trajectory, i, state, context));
+    EXPECT_DOUBLE_EQ(trajectory.points[i].positions[0], state.getVariablePosition("joint_f"));
+    EXPECT_DOUBLE_EQ(trajectory.points[i].positions[1], state.getVariablePosition("joint_c"));
+  }
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -291,6 +291,40 @@ TEST_F(TestAABB, TestPR2)
 #endif
 }
 
+TEST_F(TestAABB, TestIncremental)
+{
+  boost::filesystem::path res_path(MOVEIT_TEST_RESOURCES_DIR);
+  robot_state::RobotState pr2_state =
+      this->loadModel(this->readFileToString(res_path / "pr2_description/urdf/robot.xml"),
+                      this->readFileToString(res_path / "pr2_description/srdf/robot.xml"));
+  const robot_model::JointModelGroup* arm = pr2_state.getJointModelGroup("right_arm");
+  ASSERT_TRUE(arm);
+
+  // the cached boxes of the links must follow every kind of update; compare with the uncached computation
+  std::vector<double> incremental, full;
+  for (std::size_t i = 0; i < 5; ++i)
+  {
+    if (i % 2)
+      pr2_state.setToRandomPositions(arm);
+    else
+      pr2_state.setToRandomPositions();
+    pr2_state.computeAABB(incremental);
+    static_cast<const robot_state::RobotState&>(pr2_state).computeAABB(full);
+    ASSERT_EQ(incremental.size(), 6u);
+    for (std::size_t j = 0; j < 6; ++j)
+      EXPECT_NEAR(incremental[j], full[j], 1e-12);
+  }
+
+  // a copy does not share the cache of the original
+  robot_state::RobotState copy(pr2_state);
+  copy.setToRandomPositions(arm);
+  copy.update();
+  copy.computeAABB(incremental);
+  static_cast<const robot_state::RobotState&>(copy).computeAABB(full);
+  for (std::size_t j = 0; j < 6; ++j)
+    EXPECT_NEAR(incremental[j], full[j], 1e-12);
+}
+
 TEST_F(TestAABB, TestSimple)
 {
   // Contains a link with simple geometry and an offset in the collision link
@@ -37,6 +37,9 @@
 #include <moveit/robot_model/robot_model.h>
 #include <moveit/robot_state/robot_state.h>
 #include <moveit/robot_state/conversions.h>
+#include <moveit/robot_state/batch_forward_kinematics.h>
+#include <moveit/robot_state/batch_jacobian.h>
+#include <moveit/robot_state/compact_robot_state.h>
 #include <urdf_parser/urdf_parser.h>
 #include <fstream>
 #include <gtest/gtest.h>
@@ -276,6 +279,131 @@ TEST_F(LoadPlanningModelsPr2, FullTest)
   ASSERT_EQ(attached_bodies_2.size(), 0);
 }
 
+TEST_F(LoadPlanningModelsPr2, BatchForwardKinematics)
+{
+  moveit::core::BatchForwardKinematics fk(robot_model);
+
+  // use a count that is not a multiple of the batch size, so the last batch is partial
+  const std::size_t count = 2 * moveit::core::BatchForwardKinematics::BATCH_SIZE + 3;
+  std::vector<moveit::core::RobotStatePtr> expected, states;
+  std::vector<moveit::core::RobotState*> batch;
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    moveit::core::RobotStatePtr state(new moveit::core::RobotState(robot_model));
+    state->setToRandomPositions();
+    expected.push_back(state);
+    states.push_back(moveit::core::RobotStatePtr(new moveit::core::RobotState(*state)));
+    batch.push_back(states.back().get());
+    expected.back()->update();
+  }
+
+  fk.update(batch);
+
+  const std::vector<const moveit::core::LinkModel*>& links = robot_model->getLinkModels();
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    EXPECT_FALSE(states[i]->dirtyLinkTransforms());
+    for (std::size_t j = 0; j < links.size(); ++j)
+      EXPECT_TRUE(states[i]->getGlobalLinkTransform(links[j]).isApprox(expected[i]->getGlobalLinkTransform(links[j]),
+                                                                        1e-10))
+          << links[j]->getName();
+    // collision body transforms are derived lazily from the batch results
+    for (std::size_t j = 0; j < links.size(); ++j)
+      if (!links[j]->getShapes().empty())
+        EXPECT_TRUE(states[i]->getCollisionBodyTransform(links[j], 0).isApprox(
+            expected[i]->getCollisionBodyTransform(links[j], 0), 1e-10));
+  }
+}
+
+TEST_F(LoadPlanningModelsPr2, BatchJacobian)
+{
+  const moveit::core::JointModelGroup* group = robot_model->getJointModelGroup("right_arm");
+  ASSERT_TRUE(group);
+  ASSERT_EQ(group->getVariableCount(), 7u);
+  const moveit::core::LinkModel* link = group->getLinkModels().back();
+  const Eigen::Vector3d point(0.1, 0.0, 0.05);
+  moveit::core::BatchJacobian batch_jacobian(robot_model, group, link, point);
+  ASSERT_TRUE(batch_jacobian.isValid());
+
+  const std::size_t count = moveit::core::BatchForwardKinematics::BATCH_SIZE + 3;
+  std::vector<moveit::core::RobotStatePtr> states;
+  std::vector<const moveit::core::RobotState*> batch;
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    moveit::core::RobotStatePtr state(new moveit::core::RobotState(robot_model));
+    state->setToRandomPositions();
+    std::vector<double> velocities(state->getVariableCount());
+    for (std::size_t v = 0; v < velocities.size(); ++v)
+      velocities[v] = (v % 3) * 0.2 - 0.2;
+    state->setVariableVelocities(velocities);
+    state->update();
+    states.push_back(state);
+    batch.push_back(state.get());
+  }
+
+  moveit::core::JacobianVector<7> jacobians, derivatives;
+  ASSERT_TRUE(batch_jacobian.compute(batch, jacobians, &derivatives));
+  ASSERT_EQ(jacobians.size(), count);
+  ASSERT_EQ(derivatives.size(), count);
+
+  // the number of columns must match the group
+  moveit::core::JacobianVector<6> wrong_size;
+  EXPECT_FALSE(batch_jacobian.compute(batch, wrong_size));
+
+  const double dt = 1e-6;
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    Eigen::MatrixXd expected;
+    ASSERT_TRUE(states[i]->getJacobian(group, link, point, expected));
+    EXPECT_TRUE(jacobians[i].isApprox(expected, 1e-8));
+
+    // compare the time derivative to central differences along the velocities
+    moveit::core::RobotState before(*states[i]), after(*states[i]);
+    for (std::size_t v = 0; v < states[i]->getVariableCount(); ++v)
+    {
+      before.setVariablePosition(v, states[i]->getVariablePosition(v) - dt * states[i]->getVariableVelocity(v));
+      after.setVariablePosition(v, states[i]->getVariablePosition(v) + dt * states[i]->getVariableVelocity(v));
+    }
+    before.update();
+    after.update();
+    Eigen::MatrixXd jacobian_before, jacobian_after;
+    ASSERT_TRUE(before.getJacobian(group, link, point, jacobian_before));
+    ASSERT_TRUE(after.getJacobian(group, link, point, jacobian_after));
+    EXPECT_LT((derivatives[i] - (jacobian_after - jacobian_before) / (2.0 * dt)).norm(), 1e-5);
+  }
+}
+
+TEST_F(LoadPlanningModelsPr2, CompactRobotState)
+{
+  moveit::core::RobotState state(robot_model);
+  state.setToRandomPositions();
+  state.update();
+
+  moveit::core::CompactRobotState compact(state);
+  ASSERT_EQ(compact.getVariableCount(), state.getVariableCount());
+  for (std::size_t i = 0; i < state.getVariableCount(); ++i)
+    EXPECT_NEAR(compact.getVariablePosition(i), state.getVariablePositions()[i], 1e-6);
+
+  moveit::core::RobotState copy(robot_model);
+  copy.setToDefaultValues();
+  compact.copyToRobotState(copy);
+  for (std::size_t i = 0; i < state.getVariableCount(); ++i)
+    EXPECT_EQ(copy.getVariablePositions()[i], compact.getVariablePosition(i));
+
+  const std::vector<const moveit::core::LinkModel*>& links = robot_model->getLinkModels();
+  for (std::size_t j = 0; j < links.size(); ++j)
+    EXPECT_TRUE(compact.getGlobalLinkTransform(links[j]).isApprox(state.getGlobalLinkTransform(links[j]), 1e-4))
+        << links[j]->getName();
+
+  // the scratch state follows whichever compact state asked last
+  moveit::core::CompactRobotState other(robot_model);
+  for (std::size_t i = 0; i < other.getVariableCount(); ++i)
+    other.setVariablePosition(i, copy.getVariablePositions()[i]);
+  other.setVariablePosition(0, compact.getVariablePosition(0) + 0.5);
+  EXPECT_EQ(other.getScratchState().getVariablePositions()[0], other.getVariablePosition(0));
+  EXPECT_EQ(compact.getScratchState().getVariablePositions()[0], compact.getVariablePosition(0));
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -43,6 +43,7 @@
 #include <moveit_msgs/RobotTrajectory.h>
 #include <moveit_msgs/RobotState.h>
 #include <deque>
+#include <limits>
 
 namespace robot_trajectory
 {
@@ -250,6 +251,16 @@ public:
    */
   bool getStateAtDurationFromStart(const double request_duration, robot_state::RobotStatePtr& output_state) const;
 
+  /** @brief Compute an axis-aligned bounding box that contains the robot at all waypoints from \e start to \e end
+   * (inclusive), in the format of RobotState::computeAABB().
+   *  Links do not move along straight lines between waypoints, so on segments with large joint motions the box of
+   *  the waypoints alone can be too small; \e substeps interpolated states per segment are then included as well.
+   *  The boxes are computed incrementally: only the links moved by the group of the trajectory are computed again
+   *  at every step. All zeros if the range is empty.
+   */
+  void computeSweptAABB(std::vector<double>& aabb, std::size_t start = 0,
+                        std::size_t end = std::numeric_limits<std::size_t>::max(), unsigned int substeps = 0) const;
+
 private:
   robot_model::RobotModelConstPtr robot_model_;
   const robot_model::JointModelGroup* group_;
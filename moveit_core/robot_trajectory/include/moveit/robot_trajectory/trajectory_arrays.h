@@ -0,0 +1,222 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#ifndef MOVEIT_ROBOT_TRAJECTORY_TRAJECTORY_ARRAYS_
+#define MOVEIT_ROBOT_TRAJECTORY_TRAJECTORY_ARRAYS_
+
+#include <moveit/macros/class_forward.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit_msgs/RobotTrajectory.h>
+#include <Eigen/Core>
+#include <vector>
+
+namespace robot_trajectory
+{
+MOVEIT_CLASS_FORWARD(TrajectoryArrays);
+
+/** \brief Maintain the positions, velocities and accelerations of the variables of a group along a trajectory in
+    contiguous arrays, together with the durations between waypoints.
+
+    Unlike RobotTrajectory, waypoints are not stored as separate RobotState instances: the values of waypoint \e i
+    are column \e i of the position, velocity and acceleration matrices. This keeps long, dense trajectories compact
+    and lets time parameterization run over them without touching link transforms. RobotState instances are only
+    constructed on demand, by getWayPoint() or getRobotTrajectory(). */
+class TrajectoryArrays
+{
+public:
+  typedef Eigen::Map<Eigen::MatrixXd> Matrix;
+  typedef Eigen::Map<const Eigen::MatrixXd> ConstMatrix;
+
+  /** \brief Construct an empty trajectory for the variables of \e group, or for all variables of the model if \e
+   * group is NULL */
+  TrajectoryArrays(const robot_model::RobotModelConstPtr& robot_model, const robot_model::JointModelGroup* group);
+
+  /** \brief Copy the positions of the group variables of all waypoints of \e trajectory, as well as the durations.
+      Velocities and accelerations are copied too if some waypoint has them; values missing at other waypoints are
+      set to zero. */
+  explicit TrajectoryArrays(const RobotTrajectory& trajectory);
+
+  const robot_model::RobotModelConstPtr& getRobotModel() const
+  {
+    return robot_model_;
+  }
+
+  const robot_model::JointModelGroup* getGroup() const
+  {
+    return group_;
+  }
+
+  /** \brief The number of variables stored per waypoint (the number of rows of the matrices) */
+  std::size_t getVariableCount() const
+  {
+    return variable_indices_.size();
+  }
+
+  /** \brief The index in the robot model of the variable stored in each row */
+  const std::vector<int>& getVariableIndices() const
+  {
+    return variable_indices_;
+  }
+
+  std::size_t getWayPointCount() const
+  {
+    return duration_from_previous_.size();
+  }
+
+  bool empty() const
+  {
+    return duration_from_previous_.empty();
+  }
+
+  /** \brief Reserve memory for \e waypoint_count waypoints */
+  void reserve(std::size_t waypoint_count);
+
+  /** \brief Remove all waypoints */
+  void clear();
+
+  /** \brief Add a waypoint with the positions (one per row) in \e positions, reached \e dt after the previous one */
+  void addSuffixWayPoint(const double* positions, double dt);
+
+  /** \brief Add a waypoint with the values of the group variables in \e state, reached \e dt after the previous one.
+      Velocities and accelerations are copied too, if \e state has them. */
+  void addSuffixWayPoint(const robot_state::RobotState& state, double dt);
+
+  /** \brief The positions of waypoint \e index, one value per row */
+  const double* getWayPointPositions(std::size_t index) const
+  {
+    return &positions_[index * variable_indices_.size()];
+  }
+
+  Matrix getPositions()
+  {
+    return Matrix(positions_.data(), variable_indices_.size(), getWayPointCount());
+  }
+
+  ConstMatrix getPositions() const
+  {
+    return ConstMatrix(positions_.data(), variable_indices_.size(), getWayPointCount());
+  }
+
+  bool hasVelocities() const
+  {
+    return has_velocities_;
+  }
+
+  /** \brief Access the velocities. If the trajectory has none, they are allocated and set to zero first. */
+  Matrix getVelocities();
+
+  /** \brief The velocities; empty if the trajectory has none */
+  ConstMatrix getVelocities() const
+  {
+    return ConstMatrix(velocities_.data(), variable_indices_.size(), has_velocities_ ? getWayPointCount() : 0);
+  }
+
+  bool hasAccelerations() const
+  {
+    return has_accelerations_;
+  }
+
+  /** \brief Access the accelerations. If the trajectory has none, they are allocated and set to zero first. */
+  Matrix getAccelerations();
+
+  /** \brief The accelerations; empty if the trajectory has none */
+  ConstMatrix getAccelerations() const
+  {
+    return ConstMatrix(accelerations_.data(), variable_indices_.size(), has_accelerations_ ? getWayPointCount() : 0);
+  }
+
+  /** \brief Forget the velocities */
+  void clearVelocities();
+
+  /** \brief Forget the accelerations */
+  void clearAccelerations();
+
+  std::vector<double>& getWayPointDurations()
+  {
+    return duration_from_previous_;
+  }
+
+  const std::vector<double>& getWayPointDurations() const
+  {
+    return duration_from_previous_;
+  }
+
+  /** @brief  Returns the duration after start that a waypoint will be reached.
+   *  @param  The waypoint index.
+   *  @return The duration from start; returns overall duration if index is out of range.
+   */
+  double getWayPointDurationFromStart(std::size_t index) const;
+
+  /** \brief Unwind the continuous joints of the group, so that consecutive waypoints never differ by more than pi */
+  void unwind();
+
+  /** \brief Write the values of waypoint \e index into \e state. Variables that are not stored (outside the group)
+      keep their value from \e state. */
+  void getWayPoint(std::size_t index, robot_state::RobotState& state) const;
+
+  /** \brief Replace the content of \e trajectory by the waypoints of this trajectory. The values of variables that are
+      not stored are taken from \e reference_state. */
+  void getRobotTrajectory(RobotTrajectory& trajectory, const robot_state::RobotState& reference_state) const;
+
+  /** \brief Copy the durations, velocities and accelerations of this trajectory to the waypoints of \e trajectory,
+      which must have the same number of waypoints. Positions are not modified. */
+  void copyTimingTo(RobotTrajectory& trajectory) const;
+
+  /** \brief Construct the trajectory message directly from the arrays, like RobotTrajectory::getRobotTrajectoryMsg() */
+  void getRobotTrajectoryMsg(moveit_msgs::RobotTrajectory& trajectory) const;
+
+private:
+  void initVariables();
+  void copyVariables(const robot_state::RobotState& state, std::size_t index);
+
+  robot_model::RobotModelConstPtr robot_model_;
+  const robot_model::JointModelGroup* group_;
+
+  /** \brief The index of the model variable stored in each row */
+  std::vector<int> variable_indices_;
+
+  /** \brief The row of each model variable, -1 for variables that are not stored */
+  std::vector<int> variable_rows_;
+
+  std::vector<double> positions_;
+  std::vector<double> velocities_;
+  std::vector<double> accelerations_;
+  std::vector<double> duration_from_previous_;
+  bool has_velocities_;
+  bool has_accelerations_;
+};
+}
+
+#endif
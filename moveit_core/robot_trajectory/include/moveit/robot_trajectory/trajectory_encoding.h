@@ -0,0 +1,75 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef MOVEIT_ROBOT_TRAJECTORY_TRAJECTORY_ENCODING_
+#define MOVEIT_ROBOT_TRAJECTORY_TRAJECTORY_ENCODING_
+
+#include <moveit/robot_model/robot_model.h>
+#include <moveit_msgs/RobotState.h>
+#include <moveit_msgs/RobotTrajectory.h>
+#include <cstdint>
+#include <vector>
+
+namespace robot_trajectory
+{
+/** \brief Encode \e trajectory in a compact binary form, for sending it to a process that uses the same robot model.
+
+    Joints are referred to by their variable index in \e robot_model instead of by name, values are stored as 32 bit
+    floats, and positions and time stamps are stored as differences to the previous waypoint. These differences are
+    taken to the values the decoder reconstructs, so rounding errors do not accumulate along the trajectory. The
+    encoding contains a hash of the variable names of the model, so decoding with a different model fails.
+
+    Only the joint trajectory of single-variable joints can be encoded: if the trajectory has multi-DOF waypoints or
+    refers to unknown joints, false is returned and the message has to be sent as it is. */
+bool encodeTrajectory(const moveit_msgs::RobotTrajectory& trajectory, const robot_model::RobotModel& robot_model,
+                      std::vector<uint8_t>& data);
+
+/** \brief Decode a trajectory encoded by encodeTrajectory(). Returns false if \e data is malformed or was encoded for a
+    different robot model. */
+bool decodeTrajectory(const std::vector<uint8_t>& data, const robot_model::RobotModel& robot_model,
+                      moveit_msgs::RobotTrajectory& trajectory);
+
+/** \brief Encode the positions of all variables of \e state, in the order of \e robot_model, without any names. A
+    state that is a diff or has attached bodies cannot be encoded and false is returned. Positions are kept as 64 bit
+    floats, since start states are compared to the current state of the robot before execution. */
+bool encodeRobotState(const moveit_msgs::RobotState& state, const robot_model::RobotModelConstPtr& robot_model,
+                      std::vector<uint8_t>& data);
+
+/** \brief Decode a state encoded by encodeRobotState(). Returns false if \e data is malformed or was encoded for a
+    different robot model. */
+bool decodeRobotState(const std::vector<uint8_t>& data, const robot_model::RobotModelConstPtr& robot_model,
+                      moveit_msgs::RobotState& state);
+}
+
+#endif
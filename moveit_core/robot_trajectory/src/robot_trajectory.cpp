@@ -36,6 +36,7 @@
 
 #include <moveit/robot_trajectory/robot_trajectory.h>
 #include <moveit/robot_state/conversions.h>
+#include <moveit/robot_state/variable_set_handle.h>
 #include <eigen_conversions/eigen_msg.h>
 #include <boost/math/constants/constants.hpp>
 #include <numeric>
@@ -325,18 +326,22 @@ void RobotTrajectory::setRobotTrajectoryMsg(const robot_state::RobotState& refer
   std::size_t state_count = trajectory.points.size();
   ros::Time last_time_stamp = trajectory.header.stamp;
   ros::Time this_time_stamp = last_time_stamp;
+  if (state_count == 0)
+    return;
 
+  // resolve the joint names once for all points
+  const robot_state::VariableSetHandle variables(robot_model_, trajectory.joint_names);
   for (std::size_t i = 0; i < state_count; ++i)
   {
     this_time_stamp = trajectory.header.stamp + trajectory.points[i].time_from_start;
     robot_state::RobotStatePtr st(new robot_state::RobotState(copy));
-    st->setVariablePositions(trajectory.joint_names, trajectory.points[i].positions);
+    variables.setPositions(*st, trajectory.points[i].positions);
     if (!trajectory.points[i].velocities.empty())
-      st->setVariableVelocities(trajectory.joint_names, trajectory.points[i].velocities);
+      variables.setVelocities(*st, trajectory.points[i].velocities);
     if (!trajectory.points[i].accelerations.empty())
-      st->setVariableAccelerations(trajectory.joint_names, trajectory.points[i].accelerations);
+      variables.setAccelerations(*st, trajectory.points[i].accelerations);
     if (!trajectory.points[i].effort.empty())
-      st->setVariableEffort(trajectory.joint_names, trajectory.points[i].effort);
+      variables.setEfforts(*st, trajectory.points[i].effort);
     addSuffixWayPoint(st, (this_time_stamp - last_time_stamp).toSec());
     last_time_stamp = this_time_stamp;
   }
@@ -355,22 +360,26 @@ void RobotTrajectory::setRobotTrajectoryMsg(const robot_state::RobotState& refer
                                   trajectory.multi_dof_joint_trajectory.header.stamp :
                                   trajectory.joint_trajectory.header.stamp;
   ros::Time this_time_stamp = last_time_stamp;
+  if (state_count == 0)
+    return;
 
+  // resolve the joint names once for all points
+  const robot_state::VariableSetHandle variables(
+      robot_model_, trajectory.joint_trajectory.points.empty() ? std::vector<std::string>() :
+                                                                 trajectory.joint_trajectory.joint_names);
   for (std::size_t i = 0; i < state_count; ++i)
   {
     robot_state::RobotStatePtr st(new robot_state::RobotState(copy));
     if (trajectory.joint_trajectory.points.size() > i)
     {
-      st->setVariablePositions(trajectory.joint_trajectory.joint_names,
-                               trajectory.joint_trajectory.points[i].positions);
-      if (!trajectory.joint_trajectory.points[i].velocities.empty())
-        st->setVariableVelocities(trajectory.joint_trajectory.joint_names,
-                                  trajectory.joint_trajectory.points[i].velocities);
-      if (!trajectory.joint_trajectory.points[i].accelerations.empty())
-        st->setVariableAccelerations(trajectory.joint_trajectory.joint_names,
-                                     trajectory.joint_trajectory.points[i].accelerations);
-      if (!trajectory.joint_trajectory.points[i].effort.empty())
-        st->setVariableEffort(trajectory.joint_trajectory.joint_names, trajectory.joint_trajectory.points[i].effort);
+      const trajectory_msgs::JointTrajectoryPoint& point = trajectory.joint_trajectory.points[i];
+      variables.setPositions(*st, point.positions);
+      if (!point.velocities.empty())
+        variables.setVelocities(*st, point.velocities);
+      if (!point.accelerations.empty())
+        variables.setAccelerations(*st, point.accelerations);
+      if (!point.effort.empty())
+        variables.setEfforts(*st, point.effort);
       this_time_stamp =
           trajectory.joint_trajectory.header.stamp + trajectory.joint_trajectory.points[i].time_from_start;
     }
@@ -465,4 +474,48 @@ bool RobotTrajectory::getStateAtDurationFromStart(const double request_duration,
   return true;
 }
 
+void RobotTrajectory::computeSweptAABB(std::vector<double>& aabb, std::size_t start, std::size_t end,
+                                       unsigned int substeps) const
+{
+  aabb.assign(6, 0.0);
+  if (waypoints_.empty())
+    return;
+  end = std::min(end, waypoints_.size() - 1);
+  if (start > end)
+    return;
+
+  // a single state is moved along the trajectory, so that its cached link boxes are reused
+  robot_state::RobotState state(*waypoints_[start]);
+  std::vector<double> box, group_values;
+  state.computeAABB(aabb);
+  for (std::size_t i = start + 1; i <= end; ++i)
+  {
+    for (unsigned int s = 1; s <= substeps + 1; ++s)
+    {
+      if (s <= substeps)
+      {
+        const double t = static_cast<double>(s) / (substeps + 1);
+        if (group_)
+          waypoints_[i - 1]->interpolate(*waypoints_[i], t, state, group_);
+        else
+          waypoints_[i - 1]->interpolate(*waypoints_[i], t, state);
+      }
+      else if (group_)
+      {
+        waypoints_[i]->copyJointGroupPositions(group_, group_values);
+        state.setJointGroupPositions(group_, group_values);
+      }
+      else
+        state.setVariablePositions(waypoints_[i]->getVariablePositions());
+
+      state.computeAABB(box);
+      for (std::size_t j = 0; j < 6; j += 2)
+      {
+        aabb[j] = std::min(aabb[j], box[j]);
+        aabb[j + 1] = std::max(aabb[j + 1], box[j + 1]);
+      }
+    }
+  }
+}
+
 }  // end of namespace robot_trajectory
\ No newline at end of file
@@ -0,0 +1,371 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/robot_trajectory/trajectory_arrays.h>
+#include <eigen_conversions/eigen_msg.h>
+#include <boost/math/constants/constants.hpp>
+#include <ros/console.h>
+
+namespace robot_trajectory
+{
+TrajectoryArrays::TrajectoryArrays(const robot_model::RobotModelConstPtr& robot_model,
+                                   const robot_model::JointModelGroup* group)
+  : robot_model_(robot_model), group_(group), has_velocities_(false), has_accelerations_(false)
+{
+  initVariables();
+}
+
+TrajectoryArrays::TrajectoryArrays(const RobotTrajectory& trajectory)
+  : robot_model_(trajectory.getRobotModel())
+  , group_(trajectory.getGroup())
+  , has_velocities_(false)
+  , has_accelerations_(false)
+{
+  initVariables();
+  const std::deque<double>& durations = trajectory.getWayPointDurations();
+  reserve(trajectory.getWayPointCount());
+  for (std::size_t i = 0; i < trajectory.getWayPointCount(); ++i)
+    addSuffixWayPoint(trajectory.getWayPoint(i), i < durations.size() ? durations[i] : 0.0);
+}
+
+void TrajectoryArrays::initVariables()
+{
+  if (group_)
+    variable_indices_ = group_->getVariableIndexList();
+  else
+  {
+    variable_indices_.resize(robot_model_->getVariableCount());
+    for (std::size_t i = 0; i < variable_indices_.size(); ++i)
+      variable_indices_[i] = i;
+  }
+  variable_rows_.assign(robot_model_->getVariableCount(), -1);
+  for (std::size_t i = 0; i < variable_indices_.size(); ++i)
+    variable_rows_[variable_indices_[i]] = i;
+}
+
+void TrajectoryArrays::reserve(std::size_t waypoint_count)
+{
+  positions_.reserve(waypoint_count * variable_indices_.size());
+  if (has_velocities_)
+    velocities_.reserve(waypoint_count * variable_indices_.size());
+  if (has_accelerations_)
+    accelerations_.reserve(waypoint_count * variable_indices_.size());
+  duration_from_previous_.reserve(waypoint_count);
+}
+
+void TrajectoryArrays::clear()
+{
+  positions_.clear();
+  velocities_.clear();
+  accelerations_.clear();
+  duration_from_previous_.clear();
+  has_velocities_ = false;
+  has_accelerations_ = false;
+}
+
+void TrajectoryArrays::addSuffixWayPoint(const double* positions, double dt)
+{
+  positions_.insert(positions_.end(), positions, positions + variable_indices_.size());
+  if (has_velocities_)
+    velocities_.resize(positions_.size(), 0.0);
+  if (has_accelerations_)
+    accelerations_.resize(positions_.size(), 0.0);
+  duration_from_previous_.push_back(dt);
+}
+
+void TrajectoryArrays::addSuffixWayPoint(const robot_state::RobotState& state, double dt)
+{
+  positions_.resize(positions_.size() + variable_indices_.size());
+  if (has_velocities_)
+    velocities_.resize(positions_.size(), 0.0);
+  if (has_accelerations_)
+    accelerations_.resize(positions_.size(), 0.0);
+  duration_from_previous_.push_back(dt);
+  copyVariables(state, duration_from_previous_.size() - 1);
+}
+
+void TrajectoryArrays::copyVariables(const robot_state::RobotState& state, std::size_t index)
+{
+  const std::size_t n = variable_indices_.size();
+  for (std::size_t r = 0; r < n; ++r)
+    positions_[index * n + r] = state.getVariablePosition(variable_indices_[r]);
+  if (state.hasVelocities())
+  {
+    double* v = getVelocities().data() + index * n;
+    for (std::size_t r = 0; r < n; ++r)
+      v[r] = state.getVariableVelocity(variable_indices_[r]);
+  }
+  if (state.hasAccelerations())
+  {
+    double* a = getAccelerations().data() + index * n;
+    for (std::size_t r = 0; r < n; ++r)
+      a[r] = state.getVariableAcceleration(variable_indices_[r]);
+  }
+}
+
+TrajectoryArrays::Matrix TrajectoryArrays::getVelocities()
+{
+  if (!has_velocities_)
+  {
+    velocities_.assign(positions_.size(), 0.0);
+    has_velocities_ = true;
+  }
+  return Matrix(velocities_.data(), variable_indices_.size(), getWayPointCount());
+}
+
+TrajectoryArrays::Matrix TrajectoryArrays::getAccelerations()
+{
+  if (!has_accelerations_)
+  {
+    accelerations_.assign(positions_.size(), 0.0);
+    has_accelerations_ = true;
+  }
+  return Matrix(accelerations_.data(), variable_indices_.size(), getWayPointCount());
+}
+
+void TrajectoryArrays::clearVelocities()
+{
+  velocities_.clear();
+  has_velocities_ = false;
+}
+
+void TrajectoryArrays::clearAccelerations()
+{
+  accelerations_.clear();
+  has_accelerations_ = false;
+}
+
+double TrajectoryArrays::getWayPointDurationFromStart(std::size_t index) const
+{
+  if (duration_from_previous_.empty())
+    return 0.0;
+  if (index >= duration_from_previous_.size())
+    index = duration_from_previous_.size() - 1;
+
+  double time = 0.0;
+  for (std::size_t i = 0; i <= index; ++i)
+    time += duration_from_previous_[i];
+  return time;
+}
+
+void TrajectoryArrays::unwind()
+{
+  const std::size_t count = getWayPointCount();
+  if (count == 0)
+    return;
+
+  const std::size_t n = variable_indices_.size();
+  const std::vector<const robot_model::JointModel*>& cont_joints =
+      group_ ? group_->getContinuousJointModels() : robot_model_->getContinuousJointModels();
+
+  for (std::size_t i = 0; i < cont_joints.size(); ++i)
+  {
+    // unwrap continuous joints
+    double* values = &positions_[variable_rows_[cont_joints[i]->getFirstVariableIndex()]];
+    double running_offset = 0.0;
+    double last_value = values[0];
+
+    for (std::size_t j = 1; j < count; ++j)
+    {
+      double& current_value = values[j * n];
+      if (last_value > current_value + boost::math::constants::pi<double>())
+        running_offset += 2.0 * boost::math::constants::pi<double>();
+      else if (current_value > last_value + boost::math::constants::pi<double>())
+        running_offset -= 2.0 * boost::math::constants::pi<double>();
+
+      last_value = current_value;
+      current_value += running_offset;
+    }
+  }
+}
+
+void TrajectoryArrays::getWayPoint(std::size_t index, robot_state::RobotState& state) const
+{
+  const std::size_t n = variable_indices_.size();
+  const double* p = &positions_[index * n];
+  for (std::size_t r = 0; r < n; ++r)
+    state.setVariablePosition(variable_indices_[r], p[r]);
+  if (has_velocities_)
+  {
+    const double* v = &velocities_[index * n];
+    for (std::size_t r = 0; r < n; ++r)
+      state.setVariableVelocity(variable_indices_[r], v[r]);
+  }
+  if (has_accelerations_)
+  {
+    const double* a = &accelerations_[index * n];
+    for (std::size_t r = 0; r < n; ++r)
+      state.setVariableAcceleration(variable_indices_[r], a[r]);
+  }
+}
+
+void TrajectoryArrays::getRobotTrajectory(RobotTrajectory& trajectory,
+                                          const robot_state::RobotState& reference_state) const
+{
+  RobotTrajectory result(robot_model_, group_);
+  for (std::size_t i = 0; i < getWayPointCount(); ++i)
+  {
+    robot_state::RobotStatePtr state(new robot_state::RobotState(reference_state));
+    getWayPoint(i, *state);
+    result.addSuffixWayPoint(state, duration_from_previous_[i]);
+  }
+  trajectory.swap(result);
+}
+
+void TrajectoryArrays::copyTimingTo(RobotTrajectory& trajectory) const
+{
+  if (trajectory.getWayPointCount() != getWayPointCount())
+  {
+    ROS_ERROR_NAMED("robot_trajectory", "Cannot copy the timing of a trajectory with %zu waypoints to one with %zu",
+                    getWayPointCount(), trajectory.getWayPointCount());
+    return;
+  }
+
+  const std::size_t n = variable_indices_.size();
+  for (std::size_t i = 0; i < getWayPointCount(); ++i)
+  {
+    trajectory.setWayPointDurationFromPrevious(i, duration_from_previous_[i]);
+    robot_state::RobotState& state = *trajectory.getWayPointPtr(i);
+    if (has_velocities_)
+      for (std::size_t r = 0; r < n; ++r)
+        state.setVariableVelocity(variable_indices_[r], velocities_[i * n + r]);
+    if (has_accelerations_)
+      for (std::size_t r = 0; r < n; ++r)
+        state.setVariableAcceleration(variable_indices_[r], accelerations_[i * n + r]);
+  }
+}
+
+void TrajectoryArrays::getRobotTrajectoryMsg(moveit_msgs::RobotTrajectory& trajectory) const
+{
+  trajectory = moveit_msgs::RobotTrajectory();
+  const std::size_t count = getWayPointCount();
+  if (count == 0)
+    return;
+  const std::vector<const robot_model::JointModel*>& jnt =
+      group_ ? group_->getActiveJointModels() : robot_model_->getActiveJointModels();
+
+  // rows of the single-dof joints, in message order
+  std::vector<int> onedof;
+  std::vector<const robot_model::JointModel*> mdof;
+  for (std::size_t i = 0; i < jnt.size(); ++i)
+    if (jnt[i]->getVariableCount() == 1)
+    {
+      trajectory.joint_trajectory.joint_names.push_back(jnt[i]->getName());
+      onedof.push_back(variable_rows_[jnt[i]->getFirstVariableIndex()]);
+    }
+    else
+    {
+      trajectory.multi_dof_joint_trajectory.joint_names.push_back(jnt[i]->getName());
+      mdof.push_back(jnt[i]);
+    }
+  if (!onedof.empty())
+  {
+    trajectory.joint_trajectory.header.frame_id = robot_model_->getModelFrame();
+    trajectory.joint_trajectory.header.stamp = ros::Time(0);
+    trajectory.joint_trajectory.points.resize(count);
+  }
+  if (!mdof.empty())
+  {
+    trajectory.multi_dof_joint_trajectory.header.frame_id = robot_model_->getModelFrame();
+    trajectory.multi_dof_joint_trajectory.header.stamp = ros::Time(0);
+    trajectory.multi_dof_joint_trajectory.points.resize(count);
+  }
+
+  const std::size_t n = variable_indices_.size();
+  std::vector<double> joint_values;
+  Eigen::Affine3d joint_transform;
+  double total_time = 0.0;
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    total_time += duration_from_previous_[i];
+    const double* p = &positions_[i * n];
+    const double* v = has_velocities_ ? &velocities_[i * n] : nullptr;
+    const double* a = has_accelerations_ ? &accelerations_[i * n] : nullptr;
+
+    if (!onedof.empty())
+    {
+      trajectory_msgs::JointTrajectoryPoint& point = trajectory.joint_trajectory.points[i];
+      point.positions.resize(onedof.size());
+      for (std::size_t j = 0; j < onedof.size(); ++j)
+        point.positions[j] = p[onedof[j]];
+      if (v)
+      {
+        point.velocities.resize(onedof.size());
+        for (std::size_t j = 0; j < onedof.size(); ++j)
+          point.velocities[j] = v[onedof[j]];
+      }
+      if (a)
+      {
+        point.accelerations.resize(onedof.size());
+        for (std::size_t j = 0; j < onedof.size(); ++j)
+          point.accelerations[j] = a[onedof[j]];
+      }
+      point.time_from_start = ros::Duration(total_time);
+    }
+    if (!mdof.empty())
+    {
+      trajectory_msgs::MultiDOFJointTrajectoryPoint& point = trajectory.multi_dof_joint_trajectory.points[i];
+      point.transforms.resize(mdof.size());
+      for (std::size_t j = 0; j < mdof.size(); ++j)
+      {
+        const std::size_t first_row = variable_rows_[mdof[j]->getFirstVariableIndex()];
+        joint_values.assign(p + first_row, p + first_row + mdof[j]->getVariableCount());
+        mdof[j]->computeTransform(joint_values.data(), joint_transform);
+        tf::transformEigenToMsg(joint_transform, point.transforms[j]);
+
+        // TODO: currently only checking for planar multi DOF joints / need to add check for floating
+        if (v && mdof[j]->getType() == robot_model::JointModel::JointType::PLANAR)
+        {
+          const std::vector<std::string>& names = mdof[j]->getVariableNames();
+          geometry_msgs::Twist point_velocity;
+          for (std::size_t k = 0; k < names.size(); ++k)
+          {
+            if (names[k].find("/x") != std::string::npos)
+              point_velocity.linear.x = v[first_row + k];
+            else if (names[k].find("/y") != std::string::npos)
+              point_velocity.linear.y = v[first_row + k];
+            else if (names[k].find("/z") != std::string::npos)
+              point_velocity.linear.z = v[first_row + k];
+            else if (names[k].find("/theta") != std::string::npos)
+              point_velocity.angular.z = v[first_row + k];
+          }
+          point.velocities.push_back(point_velocity);
+        }
+      }
+      point.time_from_start = ros::Duration(total_time);
+    }
+  }
+}
+}
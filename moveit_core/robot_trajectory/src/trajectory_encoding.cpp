@@ -0,0 +1,419 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/robot_trajectory/trajectory_encoding.h>
+#include <moveit/robot_state/conversions.h>
+#include <ros/console.h>
+#include <cstring>
+
+namespace robot_trajectory
+{
+namespace
+{
+const uint32_t TRAJECTORY_MAGIC = 0x4a52544d;  // "MTRJ"
+const uint32_t STATE_MAGIC = 0x5453544d;       // "MTST"
+const uint8_t ENCODING_VERSION = 1;
+
+enum
+{
+  HAS_VELOCITIES = 1,
+  HAS_ACCELERATIONS = 2,
+  HAS_EFFORT = 4
+};
+
+// FNV-1a over the variable names of the model, so both sides can verify they index the same variables
+uint32_t hashVariableNames(const robot_model::RobotModel& robot_model)
+{
+  uint32_t hash = 2166136261u;
+  for (const std::string& name : robot_model.getVariableNames())
+    for (std::size_t i = 0; i <= name.size(); ++i)  // include the terminating zero as separator
+    {
+      hash ^= static_cast<uint8_t>(name.c_str()[i]);
+      hash *= 16777619u;
+    }
+  return hash;
+}
+
+// values are written in little endian byte order, independently of the host
+class Writer
+{
+public:
+  Writer(std::vector<uint8_t>& data) : data_(data)
+  {
+  }
+
+  void putU8(uint8_t value)
+  {
+    data_.push_back(value);
+  }
+
+  void putU16(uint16_t value)
+  {
+    put(value, 2);
+  }
+
+  void putU32(uint32_t value)
+  {
+    put(value, 4);
+  }
+
+  void putF32(float value)
+  {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    put(bits, 4);
+  }
+
+  void putF64(double value)
+  {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    put(bits, 8);
+  }
+
+  void putString(const std::string& value)
+  {
+    putU32(value.size());
+    data_.insert(data_.end(), value.begin(), value.end());
+  }
+
+private:
+  void put(uint64_t value, unsigned int bytes)
+  {
+    for (unsigned int i = 0; i < bytes; ++i)
+      data_.push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+
+  std::vector<uint8_t>& data_;
+};
+
+// reads values written by Writer; once data is missing, ok() is false and all further values are zero
+class Reader
+{
+public:
+  Reader(const std::vector<uint8_t>& data) : data_(data), pos_(0), ok_(true)
+  {
+  }
+
+  bool ok() const
+  {
+    return ok_;
+  }
+
+  std::size_t remaining() const
+  {
+    return data_.size() - pos_;
+  }
+
+  uint8_t getU8()
+  {
+    return static_cast<uint8_t>(get(1));
+  }
+
+  uint16_t getU16()
+  {
+    return static_cast<uint16_t>(get(2));
+  }
+
+  uint32_t getU32()
+  {
+    return static_cast<uint32_t>(get(4));
+  }
+
+  float getF32()
+  {
+    const uint32_t bits = static_cast<uint32_t>(get(4));
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  double getF64()
+  {
+    const uint64_t bits = get(8);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  std::string getString()
+  {
+    const uint32_t size = getU32();
+    if (!available(size))
+      return std::string();
+    std::string value(data_.begin() + pos_, data_.begin() + pos_ + size);
+    pos_ += size;
+    return value;
+  }
+
+private:
+  bool available(std::size_t bytes)
+  {
+    if (ok_ && remaining() < bytes)
+      ok_ = false;
+    return ok_;
+  }
+
+  uint64_t get(unsigned int bytes)
+  {
+    if (!available(bytes))
+      return 0;
+    uint64_t value = 0;
+    for (unsigned int i = 0; i < bytes; ++i)
+      value |= static_cast<uint64_t>(data_[pos_ + i]) << (8 * i);
+    pos_ += bytes;
+    return value;
+  }
+
+  const std::vector<uint8_t>& data_;
+  std::size_t pos_;
+  bool ok_;
+};
+
+bool checkHeader(Reader& reader, uint32_t magic, const robot_model::RobotModel& robot_model)
+{
+  if (reader.getU32() != magic || reader.getU8() != ENCODING_VERSION || !reader.ok())
+  {
+    ROS_ERROR_NAMED("robot_trajectory", "Data is not in a known compact encoding");
+    return false;
+  }
+  if (reader.getU32() != hashVariableNames(robot_model))
+  {
+    ROS_ERROR_NAMED("robot_trajectory", "Data was encoded for a different robot model than '%s'",
+                    robot_model.getName().c_str());
+    return false;
+  }
+  return true;
+}
+}
+
+bool encodeTrajectory(const moveit_msgs::RobotTrajectory& trajectory, const robot_model::RobotModel& robot_model,
+                      std::vector<uint8_t>& data)
+{
+  data.clear();
+  if (!trajectory.multi_dof_joint_trajectory.points.empty())
+    return false;
+
+  const trajectory_msgs::JointTrajectory& joint_trajectory = trajectory.joint_trajectory;
+  const std::size_t joint_count = joint_trajectory.joint_names.size();
+  std::vector<uint16_t> indices(joint_count);
+  for (std::size_t j = 0; j < joint_count; ++j)
+  {
+    if (!robot_model.hasJointModel(joint_trajectory.joint_names[j]))
+      return false;
+    const robot_model::JointModel* joint = robot_model.getJointModel(joint_trajectory.joint_names[j]);
+    if (joint->getVariableCount() != 1 || joint->getFirstVariableIndex() > 0xffff)
+      return false;
+    indices[j] = joint->getFirstVariableIndex();
+  }
+
+  // velocities, accelerations and efforts are only kept if all waypoints have them
+  uint8_t flags = joint_trajectory.points.empty() ? 0 : HAS_VELOCITIES | HAS_ACCELERATIONS | HAS_EFFORT;
+  for (const trajectory_msgs::JointTrajectoryPoint& point : joint_trajectory.points)
+  {
+    if (point.positions.size() != joint_count)
+      return false;
+    if (point.velocities.size() != joint_count)
+      flags &= ~HAS_VELOCITIES;
+    if (point.accelerations.size() != joint_count)
+      flags &= ~HAS_ACCELERATIONS;
+    if (point.effort.size() != joint_count)
+      flags &= ~HAS_EFFORT;
+  }
+
+  Writer writer(data);
+  writer.putU32(TRAJECTORY_MAGIC);
+  writer.putU8(ENCODING_VERSION);
+  writer.putU32(hashVariableNames(robot_model));
+  writer.putString(joint_trajectory.header.frame_id);
+  writer.putU32(joint_trajectory.header.stamp.sec);
+  writer.putU32(joint_trajectory.header.stamp.nsec);
+  writer.putU32(joint_count);
+  for (std::size_t j = 0; j < joint_count; ++j)
+    writer.putU16(indices[j]);
+  writer.putU32(joint_trajectory.points.size());
+  writer.putU8(flags);
+
+  // differences are taken to the values the decoder reconstructs
+  std::vector<double> previous(joint_count, 0.0);
+  double previous_time = 0.0;
+  for (const trajectory_msgs::JointTrajectoryPoint& point : joint_trajectory.points)
+  {
+    const float dt = static_cast<float>(point.time_from_start.toSec() - previous_time);
+    writer.putF32(dt);
+    previous_time += dt;
+    for (std::size_t j = 0; j < joint_count; ++j)
+    {
+      const float delta = static_cast<float>(point.positions[j] - previous[j]);
+      writer.putF32(delta);
+      previous[j] += delta;
+    }
+    if (flags & HAS_VELOCITIES)
+      for (std::size_t j = 0; j < joint_count; ++j)
+        writer.putF32(point.velocities[j]);
+    if (flags & HAS_ACCELERATIONS)
+      for (std::size_t j = 0; j < joint_count; ++j)
+        writer.putF32(point.accelerations[j]);
+    if (flags & HAS_EFFORT)
+      for (std::size_t j = 0; j < joint_count; ++j)
+        writer.putF32(point.effort[j]);
+  }
+  return true;
+}
+
+bool decodeTrajectory(const std::vector<uint8_t>& data, const robot_model::RobotModel& robot_model,
+                      moveit_msgs::RobotTrajectory& trajectory)
+{
+  trajectory = moveit_msgs::RobotTrajectory();
+  Reader reader(data);
+  if (!checkHeader(reader, TRAJECTORY_MAGIC, robot_model))
+    return false;
+
+  trajectory_msgs::JointTrajectory& joint_trajectory = trajectory.joint_trajectory;
+  joint_trajectory.header.frame_id = reader.getString();
+  joint_trajectory.header.stamp.sec = reader.getU32();
+  joint_trajectory.header.stamp.nsec = reader.getU32();
+
+  const std::vector<std::string>& variable_names = robot_model.getVariableNames();
+  const uint32_t joint_count = reader.getU32();
+  if (!reader.ok() || joint_count > variable_names.size())
+  {
+    ROS_ERROR_NAMED("robot_trajectory", "Malformed compact trajectory");
+    return false;
+  }
+  joint_trajectory.joint_names.resize(joint_count);
+  for (uint32_t j = 0; j < joint_count; ++j)
+  {
+    const uint16_t index = reader.getU16();
+    if (index >= variable_names.size())
+    {
+      ROS_ERROR_NAMED("robot_trajectory", "Malformed compact trajectory");
+      return false;
+    }
+    joint_trajectory.joint_names[j] = variable_names[index];
+  }
+
+  const uint32_t point_count = reader.getU32();
+  const uint8_t flags = reader.getU8();
+  const std::size_t values_per_point = 1 + joint_count * (1 + ((flags & HAS_VELOCITIES) ? 1 : 0) +
+                                                          ((flags & HAS_ACCELERATIONS) ? 1 : 0) +
+                                                          ((flags & HAS_EFFORT) ? 1 : 0));
+  if (!reader.ok() || reader.remaining() != point_count * values_per_point * sizeof(float))
+  {
+    ROS_ERROR_NAMED("robot_trajectory", "Malformed compact trajectory");
+    return false;
+  }
+
+  joint_trajectory.points.resize(point_count);
+  std::vector<double> previous(joint_count, 0.0);
+  double previous_time = 0.0;
+  for (trajectory_msgs::JointTrajectoryPoint& point : joint_trajectory.points)
+  {
+    previous_time += reader.getF32();
+    point.time_from_start = ros::Duration(previous_time);
+    point.positions.resize(joint_count);
+    for (uint32_t j = 0; j < joint_count; ++j)
+    {
+      previous[j] += reader.getF32();
+      point.positions[j] = previous[j];
+    }
+    if (flags & HAS_VELOCITIES)
+    {
+      point.velocities.resize(joint_count);
+      for (uint32_t j = 0; j < joint_count; ++j)
+        point.velocities[j] = reader.getF32();
+    }
+    if (flags & HAS_ACCELERATIONS)
+    {
+      point.accelerations.resize(joint_count);
+      for (uint32_t j = 0; j < joint_count; ++j)
+        point.accelerations[j] = reader.getF32();
+    }
+    if (flags & HAS_EFFORT)
+    {
+      point.effort.resize(joint_count);
+      for (uint32_t j = 0; j < joint_count; ++j)
+        point.effort[j] = reader.getF32();
+    }
+  }
+  return true;
+}
+
+bool encodeRobotState(const moveit_msgs::RobotState& state, const robot_model::RobotModelConstPtr& robot_model,
+                      std::vector<uint8_t>& data)
+{
+  data.clear();
+  if (state.is_diff || !state.attached_collision_objects.empty())
+    return false;
+
+  robot_state::RobotState robot_state(robot_model);
+  robot_state.setToDefaultValues();
+  if (!robot_state::robotStateMsgToRobotState(state, robot_state, false))
+    return false;
+
+  Writer writer(data);
+  writer.putU32(STATE_MAGIC);
+  writer.putU8(ENCODING_VERSION);
+  writer.putU32(hashVariableNames(*robot_model));
+  writer.putU32(robot_model->getVariableCount());
+  const double* positions = robot_state.getVariablePositions();
+  for (std::size_t i = 0; i < robot_model->getVariableCount(); ++i)
+    writer.putF64(positions[i]);
+  return true;
+}
+
+bool decodeRobotState(const std::vector<uint8_t>& data, const robot_model::RobotModelConstPtr& robot_model,
+                      moveit_msgs::RobotState& state)
+{
+  state = moveit_msgs::RobotState();
+  Reader reader(data);
+  if (!checkHeader(reader, STATE_MAGIC, *robot_model))
+    return false;
+
+  const uint32_t variable_count = reader.getU32();
+  if (!reader.ok() || variable_count != robot_model->getVariableCount() ||
+      reader.remaining() != variable_count * sizeof(double))
+  {
+    ROS_ERROR_NAMED("robot_trajectory", "Malformed compact robot state");
+    return false;
+  }
+
+  robot_state::RobotState robot_state(robot_model);
+  for (uint32_t i = 0; i < variable_count; ++i)
+    robot_state.setVariablePosition(i, reader.getF64());
+  robot_state.update();
+  robot_state::robotStateToRobotStateMsg(robot_state, state);
+  return true;
+}
+}
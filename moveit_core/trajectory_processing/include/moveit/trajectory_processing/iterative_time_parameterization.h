@@ -41,6 +41,7 @@
 #include <moveit_msgs/JointLimits.h>
 #include <moveit_msgs/RobotState.h>
 #include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/robot_trajectory/trajectory_arrays.h>
 
 namespace trajectory_processing
 {
@@ -55,15 +56,24 @@ public:
   bool computeTimeStamps(robot_trajectory::RobotTrajectory& trajectory, const double max_velocity_scaling_factor = 1.0,
                          const double max_acceleration_scaling_factor = 1.0) const;
 
+  /// \brief Compute the time stamps, velocities and accelerations of a trajectory kept in contiguous arrays.
+  /// A start velocity is taken into account if the trajectory has velocities.
+  bool computeTimeStamps(robot_trajectory::TrajectoryArrays& trajectory, const double max_velocity_scaling_factor = 1.0,
+                         const double max_acceleration_scaling_factor = 1.0) const;
+
+  /// \brief Set the durations between waypoints to \e time_diff (one value per segment) and recompute the
+  /// velocities and accelerations of the waypoints by finite differences, as done by computeTimeStamps()
+  static void setTimeDifferences(robot_trajectory::TrajectoryArrays& trajectory, const std::vector<double>& time_diff);
+
 private:
   unsigned int max_iterations_;    /// @brief maximum number of iterations to find solution
   double max_time_change_per_it_;  /// @brief maximum allowed time change per iteration in seconds
 
-  void applyVelocityConstraints(robot_trajectory::RobotTrajectory& rob_trajectory, std::vector<double>& time_diff,
+  void applyVelocityConstraints(const robot_trajectory::TrajectoryArrays& trajectory, std::vector<double>& time_diff,
                                 const double max_velocity_scaling_factor) const;
 
-  void applyAccelerationConstraints(robot_trajectory::RobotTrajectory& rob_trajectory, std::vector<double>& time_diff,
-                                    const double max_acceleration_scaling_factor) const;
+  void applyAccelerationConstraints(const robot_trajectory::TrajectoryArrays& trajectory,
+                                    std::vector<double>& time_diff, const double max_acceleration_scaling_factor) const;
 
   double findT1(const double d1, const double d2, double t1, const double t2, const double a_max) const;
   double findT2(const double d1, const double d2, const double t1, double t2, const double a_max) const;
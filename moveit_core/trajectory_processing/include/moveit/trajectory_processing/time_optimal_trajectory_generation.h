@@ -0,0 +1,208 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#ifndef MOVEIT_TRAJECTORY_PROCESSING_TIME_OPTIMAL_TRAJECTORY_GENERATION_
+#define MOVEIT_TRAJECTORY_PROCESSING_TIME_OPTIMAL_TRAJECTORY_GENERATION_
+
+#include <Eigen/Core>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <list>
+#include <memory>
+#include <utility>
+
+namespace trajectory_processing
+{
+/// \brief A segment of a Path, parameterized by its arc length
+class PathSegment
+{
+public:
+  PathSegment(double length = 0.0) : position_(0.0), length_(length)
+  {
+  }
+  virtual ~PathSegment()
+  {
+  }
+
+  double getLength() const
+  {
+    return length_;
+  }
+  virtual Eigen::VectorXd getConfig(double s) const = 0;
+  virtual Eigen::VectorXd getTangent(double s) const = 0;
+  virtual Eigen::VectorXd getCurvature(double s) const = 0;
+  virtual std::list<double> getSwitchingPoints() const = 0;
+  virtual PathSegment* clone() const = 0;
+
+  /// Position of the segment's start along the complete path
+  double position_;
+
+protected:
+  double length_;
+};
+
+/// \brief A piecewise linear path with circular blends around its waypoints
+class Path
+{
+public:
+  /** \brief Build the path through \e path. Each interior waypoint is replaced by a circular blend that deviates at
+      most \e max_deviation from it (in joint space). A \e max_deviation of zero disables blending. */
+  Path(const std::list<Eigen::VectorXd>& path, double max_deviation = 0.0);
+  Path(const Path& path);
+
+  double getLength() const
+  {
+    return length_;
+  }
+  Eigen::VectorXd getConfig(double s) const;
+  Eigen::VectorXd getTangent(double s) const;
+  Eigen::VectorXd getCurvature(double s) const;
+
+  /** \brief Get the next point past \e s at which the path is not smooth. \e discontinuity is set if the
+      curvature changes abruptly at that point (between a linear segment and a blend) */
+  double getNextSwitchingPoint(double s, bool& discontinuity) const;
+
+  /// Positions along the path at which the path is not smooth, flagged true at curvature discontinuities
+  const std::list<std::pair<double, bool> >& getSwitchingPoints() const
+  {
+    return switching_points_;
+  }
+
+private:
+  PathSegment* getPathSegment(double& s) const;
+
+  double length_;
+  std::list<std::pair<double, bool> > switching_points_;
+  std::list<std::unique_ptr<PathSegment> > path_segments_;
+};
+
+/// \brief Time-optimal parameterization of a Path subject to joint velocity and acceleration limits
+class Trajectory
+{
+public:
+  /** \brief Generate the time-optimal trajectory along \e path by numerically integrating the phase plane with the
+      given \e time_step */
+  Trajectory(const Path& path, const Eigen::VectorXd& max_velocity, const Eigen::VectorXd& max_acceleration,
+             double time_step = 0.001);
+
+  /** \brief Return true if the trajectory could be generated. Call this before any of the other functions */
+  bool isValid() const
+  {
+    return valid_;
+  }
+
+  /// Return the duration of the trajectory
+  double getDuration() const;
+
+  /** \brief Return the position, velocity and acceleration vectors at \e time. Querying with increasing times is
+      amortized O(1) */
+  Eigen::VectorXd getPosition(double time) const;
+  Eigen::VectorXd getVelocity(double time) const;
+  Eigen::VectorXd getAcceleration(double time) const;
+
+private:
+  struct TrajectoryStep
+  {
+    TrajectoryStep()
+    {
+    }
+    TrajectoryStep(double path_pos, double path_vel) : path_pos_(path_pos), path_vel_(path_vel), time_(0.0)
+    {
+    }
+    double path_pos_;
+    double path_vel_;
+    double time_;
+  };
+
+  bool getNextSwitchingPoint(double path_pos, TrajectoryStep& next_switching_point, double& before_acceleration,
+                             double& after_acceleration);
+  bool getNextAccelerationSwitchingPoint(double path_pos, TrajectoryStep& next_switching_point,
+                                         double& before_acceleration, double& after_acceleration);
+  bool getNextVelocitySwitchingPoint(double path_pos, TrajectoryStep& next_switching_point, double& before_acceleration,
+                                     double& after_acceleration);
+  bool integrateForward(std::list<TrajectoryStep>& trajectory, double acceleration);
+  void integrateBackward(std::list<TrajectoryStep>& start_trajectory, double path_pos, double path_vel,
+                         double acceleration);
+  double getMinMaxPathAcceleration(double path_position, double path_velocity, bool max);
+  double getMinMaxPhaseSlope(double path_position, double path_velocity, bool max);
+  double getAccelerationMaxPathVelocity(double path_pos) const;
+  double getVelocityMaxPathVelocity(double path_pos) const;
+  double getAccelerationMaxPathVelocityDeriv(double path_pos);
+  double getVelocityMaxPathVelocityDeriv(double path_pos);
+
+  std::list<TrajectoryStep>::const_iterator getTrajectorySegment(double time) const;
+  double getPathPosition(double time, double& path_vel, double& path_acc) const;
+
+  Path path_;
+  Eigen::VectorXd max_velocity_;
+  Eigen::VectorXd max_acceleration_;
+  unsigned int joint_num_;
+  bool valid_;
+  std::list<TrajectoryStep> trajectory_;
+  const double time_step_;
+
+  mutable double cached_time_;
+  mutable std::list<TrajectoryStep>::const_iterator cached_trajectory_segment_;
+};
+
+/// \brief This class sets the timestamps of a trajectory to the fastest timing that follows the path of the
+/// trajectory within the joint velocity and acceleration limits of the model, following
+/// "Time-Optimal Trajectory Generation for Path Following with Bounded Acceleration and Velocity" (Kunz and Stilman,
+/// RSS 2012).
+///
+/// Unlike the iterative parameterizations, the timing is computed in a single forward/backward integration of the
+/// phase plane. The waypoints are joined by straight lines in joint space and every interior waypoint is passed
+/// through a circular blend, so the robot does not have to stop at waypoints. Velocity is continuous along the whole
+/// trajectory and acceleration stays within bounds.
+///
+/// The result is resampled at a fixed time interval, so the output waypoints differ from the input waypoints. Paths
+/// deviate from the input waypoints by at most \e path_tolerance (in joint space) inside the blends.
+class TimeOptimalTrajectoryGeneration
+{
+public:
+  TimeOptimalTrajectoryGeneration(const double path_tolerance = 0.1, const double resample_dt = 0.1,
+                                  const double min_angle_change = 0.001);
+  ~TimeOptimalTrajectoryGeneration();
+
+  bool computeTimeStamps(robot_trajectory::RobotTrajectory& trajectory, const double max_velocity_scaling_factor = 1.0,
+                         const double max_acceleration_scaling_factor = 1.0) const;
+
+private:
+  const double path_tolerance_;    /// @brief Maximum deviation of the blends from the waypoints
+  const double resample_dt_;       /// @brief Time interval between the waypoints of the output trajectory
+  const double min_angle_change_;  /// @brief Waypoints closer than this to their predecessor are dropped
+};
+}
+
+#endif
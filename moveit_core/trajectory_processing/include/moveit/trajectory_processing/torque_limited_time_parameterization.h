@@ -0,0 +1,76 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef MOVEIT_TRAJECTORY_PROCESSING_TORQUE_LIMITED_TIME_PARAMETERIZATION_
+#define MOVEIT_TRAJECTORY_PROCESSING_TORQUE_LIMITED_TIME_PARAMETERIZATION_
+
+#include <moveit/dynamics_solver/dynamics_solver.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/trajectory_processing/iterative_time_parameterization.h>
+
+namespace trajectory_processing
+{
+/// \brief This class sets the timestamps of a trajectory to respect velocity and acceleration limits, like
+/// IterativeParabolicTimeParameterization, and then slows down the parts of the trajectory where the joint
+/// torques computed by inverse dynamics exceed the effort limits of the joints.
+///
+/// Scaling the duration of a segment by s scales velocities by 1/s and accelerations by 1/s^2, so the torques
+/// needed to move the arm decrease quadratically, while the torques needed to hold it against gravity (and the
+/// payload) do not change. Each waypoint is therefore scaled by the smallest factor that brings it within the
+/// limits, and since the durations of neighbouring segments interact, this is repeated until no waypoint exceeds
+/// the limits. Waypoints that cannot be held at rest within the limits make the parameterization fail.
+class TorqueLimitedTimeParameterization
+{
+public:
+  /// \param torque_scaling_factor The fraction of the joint effort limits the trajectory may use
+  /// \param max_iterations The maximum number of times the torques are evaluated and the timing is scaled
+  /// \param threads The number of threads used to evaluate inverse dynamics (0 uses all hardware threads)
+  TorqueLimitedTimeParameterization(double torque_scaling_factor = 1.0, unsigned int max_iterations = 10,
+                                    unsigned int threads = 1);
+
+  /// \brief Compute the time stamps of \e trajectory, with the torques of the group of \e solver limited for a
+  /// payload of \e payload kg attached to the last link of that group
+  bool computeTimeStamps(robot_trajectory::RobotTrajectory& trajectory, const dynamics_solver::DynamicsSolver& solver,
+                         double payload = 0.0, const double max_velocity_scaling_factor = 1.0,
+                         const double max_acceleration_scaling_factor = 1.0) const;
+
+private:
+  IterativeParabolicTimeParameterization time_param_;
+  double torque_scaling_factor_;
+  unsigned int max_iterations_;
+  unsigned int threads_;
+};
+}
+
+#endif
@@ -0,0 +1,79 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef MOVEIT_TRAJECTORY_PROCESSING_TRAJECTORY_RESAMPLING_
+#define MOVEIT_TRAJECTORY_PROCESSING_TRAJECTORY_RESAMPLING_
+
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/robot_trajectory/trajectory_arrays.h>
+
+namespace trajectory_processing
+{
+/// \brief This class resamples a time parameterized trajectory at a fixed period, for controllers that expect
+/// evenly spaced waypoints.
+///
+/// Between two waypoints, each variable follows the quintic polynomial that matches the positions, velocities and
+/// accelerations of both waypoints (a cubic one if the trajectory has no accelerations), so the waypoints are
+/// reproduced exactly and the limits enforced there by the time parameterization carry over to the samples. Where
+/// the polynomial overshoots between waypoints, the samples are clamped to the bounds of the variables. The
+/// polynomials of a segment are evaluated for all variables at once.
+///
+/// The first sample is the first waypoint; the last one is the last waypoint, at the first multiple of the period
+/// that is not earlier than the end of the trajectory, so that all samples are exactly one period apart.
+/// Only groups made of single-dof joints can be resampled.
+class TrajectoryResampler
+{
+public:
+  /// \param period The time between two samples, in seconds
+  TrajectoryResampler(double period = 0.01);
+
+  double getPeriod() const
+  {
+    return period_;
+  }
+
+  /// \brief Replace the waypoints of \e trajectory by the samples
+  bool resample(robot_trajectory::RobotTrajectory& trajectory) const;
+
+  /// \brief Write the samples of \e input to \e output, which is the compact form to pass on (as a message from
+  /// TrajectoryArrays::getRobotTrajectoryMsg()) to the controllers. \e input must have velocities, and its
+  /// continuous joints must be unwound (see TrajectoryArrays::unwind()).
+  bool resample(const robot_trajectory::TrajectoryArrays& input, robot_trajectory::TrajectoryArrays& output) const;
+
+private:
+  double period_;
+};
+}
+
+#endif
@@ -98,15 +98,14 @@ void printStats(const trajectory_msgs::JointTrajectory& trajectory, const std::v
 }
 
 // Applies velocity
-void IterativeParabolicTimeParameterization::applyVelocityConstraints(robot_trajectory::RobotTrajectory& rob_trajectory,
-                                                                      std::vector<double>& time_diff,
-                                                                      const double max_velocity_scaling_factor) const
+void IterativeParabolicTimeParameterization::applyVelocityConstraints(
+    const robot_trajectory::TrajectoryArrays& trajectory, std::vector<double>& time_diff,
+    const double max_velocity_scaling_factor) const
 {
-  const robot_model::JointModelGroup* group = rob_trajectory.getGroup();
+  const robot_model::JointModelGroup* group = trajectory.getGroup();
   const std::vector<std::string>& vars = group->getVariableNames();
-  const std::vector<int>& idx = group->getVariableIndexList();
   const robot_model::RobotModel& rmodel = group->getParentModel();
-  const int num_points = rob_trajectory.getWayPointCount();
+  const int num_points = trajectory.getWayPointCount();
 
   double velocity_scaling_factor = 1.0;
 
@@ -121,24 +120,27 @@ void IterativeParabolicTimeParameterization::applyVelocityConstraints(robot_traj
                    "Invalid max_velocity_scaling_factor %f specified, defaulting to %f instead.",
                    max_velocity_scaling_factor, velocity_scaling_factor);
 
-  for (int i = 0; i < num_points - 1; ++i)
+  // look up the limits once instead of for every waypoint
+  std::vector<double> v_max(vars.size(), DEFAULT_VEL_MAX);
+  for (std::size_t j = 0; j < vars.size(); ++j)
   {
-    const robot_state::RobotStatePtr& curr_waypoint = rob_trajectory.getWayPointPtr(i);
-    const robot_state::RobotStatePtr& next_waypoint = rob_trajectory.getWayPointPtr(i + 1);
+    const robot_model::VariableBounds& b = rmodel.getVariableBounds(vars[j]);
+    if (b.velocity_bounded_)
+      v_max[j] =
+          std::min(fabs(b.max_velocity_ * velocity_scaling_factor), fabs(b.min_velocity_ * velocity_scaling_factor));
+  }
 
-    for (std::size_t j = 0; j < vars.size(); ++j)
-    {
-      double v_max = DEFAULT_VEL_MAX;
-      const robot_model::VariableBounds& b = rmodel.getVariableBounds(vars[j]);
-      if (b.velocity_bounded_)
-        v_max =
-            std::min(fabs(b.max_velocity_ * velocity_scaling_factor), fabs(b.min_velocity_ * velocity_scaling_factor));
-      const double dq1 = curr_waypoint->getVariablePosition(idx[j]);
-      const double dq2 = next_waypoint->getVariablePosition(idx[j]);
-      const double t_min = std::abs(dq2 - dq1) / v_max;
-      if (t_min > time_diff[i])
-        time_diff[i] = t_min;
-    }
+  if (vars.empty())
+    return;
+
+  // the time needed by the slowest joint is evaluated for all joints of a segment at once
+  const Eigen::Map<const Eigen::ArrayXd> v_max_array(v_max.data(), v_max.size());
+  const robot_trajectory::TrajectoryArrays::ConstMatrix positions = trajectory.getPositions();
+  for (int i = 0; i < num_points - 1; ++i)
+  {
+    const double t_min = ((positions.col(i + 1) - positions.col(i)).array().abs() / v_max_array).maxCoeff();
+    if (t_min > time_diff[i])
+      time_diff[i] = t_min;
   }
 }
 
@@ -187,47 +189,38 @@ namespace
 {
 // Takes the time differences, and updates the timestamps, velocities and accelerations
 // in the trajectory.
-void updateTrajectory(robot_trajectory::RobotTrajectory& rob_trajectory, const std::vector<double>& time_diff)
+void updateTrajectory(robot_trajectory::TrajectoryArrays& trajectory, const std::vector<double>& time_diff)
 {
   // Error check
   if (time_diff.empty())
     return;
 
-  double time_sum = 0.0;
-
-  robot_state::RobotStatePtr prev_waypoint;
-  robot_state::RobotStatePtr curr_waypoint;
-  robot_state::RobotStatePtr next_waypoint;
-
-  const robot_model::JointModelGroup* group = rob_trajectory.getGroup();
-  const std::vector<std::string>& vars = group->getVariableNames();
-  const std::vector<int>& idx = group->getVariableIndexList();
-
-  int num_points = rob_trajectory.getWayPointCount();
-
-  rob_trajectory.setWayPointDurationFromPrevious(0, time_sum);
+  const int num_points = trajectory.getWayPointCount();
+  const std::size_t num_vars = trajectory.getVariableCount();
+  std::vector<double>& durations = trajectory.getWayPointDurations();
 
   // Times
+  durations[0] = 0.0;
   for (int i = 1; i < num_points; ++i)
-    // Update the time between the waypoints in the robot_trajectory.
-    rob_trajectory.setWayPointDurationFromPrevious(i, time_diff[i - 1]);
+    // Update the time between the waypoints in the trajectory.
+    durations[i] = time_diff[i - 1];
 
   // Return if there is only one point in the trajectory!
   if (num_points <= 1)
     return;
 
+  const bool start_velocity = trajectory.hasVelocities();
+  robot_trajectory::TrajectoryArrays::Matrix velocities = trajectory.getVelocities();
+  robot_trajectory::TrajectoryArrays::Matrix accelerations = trajectory.getAccelerations();
+
   // Accelerations
   for (int i = 0; i < num_points; ++i)
   {
-    curr_waypoint = rob_trajectory.getWayPointPtr(i);
-
-    if (i > 0)
-      prev_waypoint = rob_trajectory.getWayPointPtr(i - 1);
+    const double* curr_waypoint = trajectory.getWayPointPositions(i);
+    const double* prev_waypoint = i > 0 ? trajectory.getWayPointPositions(i - 1) : nullptr;
+    const double* next_waypoint = i < num_points - 1 ? trajectory.getWayPointPositions(i + 1) : nullptr;
 
-    if (i < num_points - 1)
-      next_waypoint = rob_trajectory.getWayPointPtr(i + 1);
-
-    for (std::size_t j = 0; j < vars.size(); ++j)
+    for (std::size_t j = 0; j < num_vars; ++j)
     {
       double q1;
       double q2;
@@ -238,8 +231,8 @@ void updateTrajectory(robot_trajectory::RobotTrajectory& rob_trajectory, const s
       if (i == 0)
       {
         // First point
-        q1 = next_waypoint->getVariablePosition(idx[j]);
-        q2 = curr_waypoint->getVariablePosition(idx[j]);
+        q1 = next_waypoint[j];
+        q2 = curr_waypoint[j];
         q3 = q1;
 
         dt1 = dt2 = time_diff[i];
@@ -247,9 +240,9 @@ void updateTrajectory(robot_trajectory::RobotTrajectory& rob_trajectory, const s
       else if (i < num_points - 1)
       {
         // middle points
-        q1 = prev_waypoint->getVariablePosition(idx[j]);
-        q2 = curr_waypoint->getVariablePosition(idx[j]);
-        q3 = next_waypoint->getVariablePosition(idx[j]);
+        q1 = prev_waypoint[j];
+        q2 = curr_waypoint[j];
+        q3 = next_waypoint[j];
 
         dt1 = time_diff[i - 1];
         dt2 = time_diff[i];
@@ -257,8 +250,8 @@ void updateTrajectory(robot_trajectory::RobotTrajectory& rob_trajectory, const s
       else
       {
         // last point
-        q1 = prev_waypoint->getVariablePosition(idx[j]);
-        q2 = curr_waypoint->getVariablePosition(idx[j]);
+        q1 = prev_waypoint[j];
+        q2 = curr_waypoint[j];
         q3 = q1;
 
         dt1 = dt2 = time_diff[i - 1];
@@ -266,7 +259,6 @@ void updateTrajectory(robot_trajectory::RobotTrajectory& rob_trajectory, const s
 
       double v1, v2, a;
 
-      bool start_velocity = false;
       if (dt1 == 0.0 || dt2 == 0.0)
       {
         v1 = 0.0;
@@ -275,42 +267,76 @@ void updateTrajectory(robot_trajectory::RobotTrajectory& rob_trajectory, const s
       }
       else
       {
-        if (i == 0)
-        {
-          if (curr_waypoint->hasVelocities())
-          {
-            start_velocity = true;
-            v1 = curr_waypoint->getVariableVelocity(idx[j]);
-          }
-        }
-        v1 = start_velocity ? v1 : (q2 - q1) / dt1;
+        const bool use_start_velocity = i == 0 && start_velocity;
+        v1 = use_start_velocity ? velocities(j, 0) : (q2 - q1) / dt1;
         // v2 = (q3-q2)/dt2;
-        v2 = start_velocity ? v1 : (q3 - q2) / dt2;  // Needed to ensure continuous velocity for first point
+        v2 = use_start_velocity ? v1 : (q3 - q2) / dt2;  // Needed to ensure continuous velocity for first point
         a = 2.0 * (v2 - v1) / (dt1 + dt2);
       }
 
-      curr_waypoint->setVariableVelocity(idx[j], (v2 + v1) / 2.0);
-      curr_waypoint->setVariableAcceleration(idx[j], a);
+      velocities(j, i) = (v2 + v1) / 2.0;
+      accelerations(j, i) = a;
     }
   }
 }
 }
 
+namespace
+{
+// Check if the acceleration of the joint with positions \e q exceeds \e limit at any waypoint, computed the same way
+// as in the sweeps of applyAccelerationConstraints(). A sweep over such a joint would not change the time differences.
+bool exceedsAccelerationLimit(const double* q, const std::vector<double>& time_diff, const double limit,
+                              const bool start_velocity, const double v_start)
+{
+  const int num_segments = time_diff.size();
+  const Eigen::Map<const Eigen::ArrayXd> dt(time_diff.data(), num_segments);
+  const Eigen::Map<const Eigen::ArrayXd> q_curr(q, num_segments);
+  const Eigen::Map<const Eigen::ArrayXd> q_next(q + 1, num_segments);
+
+  // middle points, all at once
+  if (num_segments > 1)
+  {
+    const Eigen::ArrayXd v = (q_next - q_curr) / dt;
+    const Eigen::ArrayXd dt_sum = dt.head(num_segments - 1) + dt.tail(num_segments - 1);
+    const Eigen::ArrayXd a = 2.0 * (v.tail(num_segments - 1) - v.head(num_segments - 1)) / dt_sum;
+    const auto zero_dt = dt.head(num_segments - 1) == 0.0 || dt.tail(num_segments - 1) == 0.0;
+    if ((zero_dt.select(0.0, a).abs() > limit).any())
+      return true;
+  }
+
+  // first point
+  double dt1 = time_diff.front();
+  if (dt1 != 0.0)
+  {
+    const double v1 = start_velocity ? v_start : (q[0] - q[1]) / dt1;
+    const double v2 = (q[1] - q[0]) / dt1;
+    if (fabs(2.0 * (v2 - v1) / (dt1 + dt1)) > limit)
+      return true;
+  }
+
+  // last point
+  dt1 = time_diff.back();
+  if (dt1 != 0.0)
+  {
+    const double v1 = (q[num_segments] - q[num_segments - 1]) / dt1;
+    const double v2 = (q[num_segments - 1] - q[num_segments]) / dt1;
+    if (fabs(2.0 * (v2 - v1) / (dt1 + dt1)) > limit)
+      return true;
+  }
+  return false;
+}
+}
+
 // Applies Acceleration constraints
 void IterativeParabolicTimeParameterization::applyAccelerationConstraints(
-    robot_trajectory::RobotTrajectory& rob_trajectory, std::vector<double>& time_diff,
+    const robot_trajectory::TrajectoryArrays& trajectory, std::vector<double>& time_diff,
     const double max_acceleration_scaling_factor) const
 {
-  robot_state::RobotStatePtr prev_waypoint;
-  robot_state::RobotStatePtr curr_waypoint;
-  robot_state::RobotStatePtr next_waypoint;
-
-  const robot_model::JointModelGroup* group = rob_trajectory.getGroup();
+  const robot_model::JointModelGroup* group = trajectory.getGroup();
   const std::vector<std::string>& vars = group->getVariableNames();
-  const std::vector<int>& idx = group->getVariableIndexList();
   const robot_model::RobotModel& rmodel = group->getParentModel();
 
-  const int num_points = rob_trajectory.getWayPointCount();
+  const int num_points = trajectory.getWayPointCount();
   const unsigned int num_joints = group->getVariableCount();
   int num_updates = 0;
   int iteration = 0;
@@ -337,6 +363,23 @@ void IterativeParabolicTimeParameterization::applyAccelerationConstraints(
                    "Invalid max_acceleration_scaling_factor %f specified, defaulting to %f instead.",
                    max_acceleration_scaling_factor, acceleration_scaling_factor);
 
+  // look up the limits once instead of for every waypoint and iteration
+  std::vector<double> a_max(num_joints, DEFAULT_ACCEL_MAX);
+  for (unsigned int j = 0; j < num_joints; ++j)
+  {
+    const robot_model::VariableBounds& b = rmodel.getVariableBounds(vars[j]);
+    if (b.acceleration_bounded_)
+      a_max[j] = std::min(fabs(b.max_acceleration_ * acceleration_scaling_factor),
+                          fabs(b.min_acceleration_ * acceleration_scaling_factor));
+  }
+  const bool start_velocity = trajectory.hasVelocities();
+
+  if (num_points < 2)
+    return;
+
+  // one contiguous column of positions per joint
+  const Eigen::MatrixXd joint_positions = trajectory.getPositions().transpose();
+
   do
   {
     num_updates = 0;
@@ -346,6 +389,14 @@ void IterativeParabolicTimeParameterization::applyAccelerationConstraints(
     // This is so that any time interval increases have a chance to get propogated through the trajectory
     for (unsigned int j = 0; j < num_joints; ++j)
     {
+      const double* q = joint_positions.col(j).data();
+      const double v_start = start_velocity ? trajectory.getVelocities()(j, 0) : 0.0;
+
+      // sweeps over a joint that is within its limits everywhere change nothing, so they are skipped;
+      // once this holds for all joints the iteration has converged
+      if (!exceedsAccelerationLimit(q, time_diff, a_max[j] + ROUNDING_THRESHOLD, start_velocity, v_start))
+        continue;
+
       // Loop forwards, then backwards
       for (int count = 0; count < 2; ++count)
       {
@@ -353,27 +404,12 @@ void IterativeParabolicTimeParameterization::applyAccelerationConstraints(
         {
           int index = backwards ? (num_points - 1) - i : i;
 
-          curr_waypoint = rob_trajectory.getWayPointPtr(index);
-
-          if (index > 0)
-            prev_waypoint = rob_trajectory.getWayPointPtr(index - 1);
-
-          if (index < num_points - 1)
-            next_waypoint = rob_trajectory.getWayPointPtr(index + 1);
-
-          // Get acceleration limits
-          double a_max = DEFAULT_ACCEL_MAX;
-          const robot_model::VariableBounds& b = rmodel.getVariableBounds(vars[j]);
-          if (b.acceleration_bounded_)
-            a_max = std::min(fabs(b.max_acceleration_ * acceleration_scaling_factor),
-                             fabs(b.min_acceleration_ * acceleration_scaling_factor));
-
           if (index == 0)
           {
             // First point
-            q1 = next_waypoint->getVariablePosition(idx[j]);
-            q2 = curr_waypoint->getVariablePosition(idx[j]);
-            q3 = next_waypoint->getVariablePosition(idx[j]);
+            q1 = q[index + 1];
+            q2 = q[index];
+            q3 = q[index + 1];
 
             dt1 = dt2 = time_diff[index];
             assert(!backwards);
@@ -381,9 +417,9 @@ void IterativeParabolicTimeParameterization::applyAccelerationConstraints(
           else if (index < num_points - 1)
           {
             // middle points
-            q1 = prev_waypoint->getVariablePosition(idx[j]);
-            q2 = curr_waypoint->getVariablePosition(idx[j]);
-            q3 = next_waypoint->getVariablePosition(idx[j]);
+            q1 = q[index - 1];
+            q2 = q[index];
+            q3 = q[index + 1];
 
             dt1 = time_diff[index - 1];
             dt2 = time_diff[index];
@@ -391,9 +427,9 @@ void IterativeParabolicTimeParameterization::applyAccelerationConstraints(
           else
           {
             // last point - careful, there are only numpoints-1 time intervals
-            q1 = prev_waypoint->getVariablePosition(idx[j]);
-            q2 = curr_waypoint->getVariablePosition(idx[j]);
-            q3 = prev_waypoint->getVariablePosition(idx[j]);
+            q1 = q[index - 1];
+            q2 = q[index];
+            q3 = q[index - 1];
 
             dt1 = dt2 = time_diff[index - 1];
             assert(backwards);
@@ -407,30 +443,21 @@ void IterativeParabolicTimeParameterization::applyAccelerationConstraints(
           }
           else
           {
-            bool start_velocity = false;
-            if (index == 0)
-            {
-              if (curr_waypoint->hasVelocities())
-              {
-                start_velocity = true;
-                v1 = curr_waypoint->getVariableVelocity(idx[j]);
-              }
-            }
-            v1 = start_velocity ? v1 : (q2 - q1) / dt1;
+            v1 = index == 0 && start_velocity ? v_start : (q2 - q1) / dt1;
             v2 = (q3 - q2) / dt2;
             a = 2.0 * (v2 - v1) / (dt1 + dt2);
           }
 
-          if (fabs(a) > a_max + ROUNDING_THRESHOLD)
+          if (fabs(a) > a_max[j] + ROUNDING_THRESHOLD)
           {
             if (!backwards)
             {
-              dt2 = std::min(dt2 + max_time_change_per_it_, findT2(q2 - q1, q3 - q2, dt1, dt2, a_max));
+              dt2 = std::min(dt2 + max_time_change_per_it_, findT2(q2 - q1, q3 - q2, dt1, dt2, a_max[j]));
               time_diff[index] = dt2;
             }
             else
             {
-              dt1 = std::min(dt1 + max_time_change_per_it_, findT1(q2 - q1, q3 - q2, dt1, dt2, a_max));
+              dt1 = std::min(dt1 + max_time_change_per_it_, findT1(q2 - q1, q3 - q2, dt1, dt2, a_max[j]));
               time_diff[index - 1] = dt1;
             }
             num_updates++;
@@ -457,6 +484,12 @@ void IterativeParabolicTimeParameterization::applyAccelerationConstraints(
   } while (num_updates > 0 && iteration < static_cast<int>(max_iterations_));
 }
 
+void IterativeParabolicTimeParameterization::setTimeDifferences(robot_trajectory::TrajectoryArrays& trajectory,
+                                                                const std::vector<double>& time_diff)
+{
+  updateTrajectory(trajectory, time_diff);
+}
+
 bool IterativeParabolicTimeParameterization::computeTimeStamps(robot_trajectory::RobotTrajectory& trajectory,
                                                                const double max_velocity_scaling_factor,
                                                                const double max_acceleration_scaling_factor) const
@@ -475,6 +508,34 @@ bool IterativeParabolicTimeParameterization::computeTimeStamps(robot_trajectory:
   // this lib does not actually work properly when angles wrap around, so we need to unwind the path first
   trajectory.unwind();
 
+  // the computation runs on contiguous copies of the positions; only the start velocity is used as input
+  robot_trajectory::TrajectoryArrays arrays(trajectory);
+  arrays.clearAccelerations();
+  if (!trajectory.getFirstWayPoint().hasVelocities())
+    arrays.clearVelocities();
+  if (!computeTimeStamps(arrays, max_velocity_scaling_factor, max_acceleration_scaling_factor))
+    return false;
+  arrays.copyTimingTo(trajectory);
+  return true;
+}
+
+bool IterativeParabolicTimeParameterization::computeTimeStamps(robot_trajectory::TrajectoryArrays& trajectory,
+                                                               const double max_velocity_scaling_factor,
+                                                               const double max_acceleration_scaling_factor) const
+{
+  if (trajectory.empty())
+    return true;
+
+  if (!trajectory.getGroup())
+  {
+    ROS_ERROR_NAMED("trajectory_processing.iterative_time_parameterization", "It looks like the planner did not set "
+                                                                             "the group the plan was computed for");
+    return false;
+  }
+
+  // this lib does not actually work properly when angles wrap around, so we need to unwind the path first
+  trajectory.unwind();
+
   const int num_points = trajectory.getWayPointCount();
   std::vector<double> time_diff(num_points - 1, 0.0);  // the time difference between adjacent points
 
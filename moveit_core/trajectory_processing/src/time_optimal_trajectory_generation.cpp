@@ -0,0 +1,912 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/trajectory_processing/time_optimal_trajectory_generation.h>
+#include <ros/console.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace trajectory_processing
+{
+namespace
+{
+const std::string LOGNAME = "trajectory_processing.time_optimal_trajectory_generation";
+const double EPS = 0.000001;
+const double DEFAULT_LIMIT = 1.0;  // default if not specified in model
+
+class LinearPathSegment : public PathSegment
+{
+public:
+  LinearPathSegment(const Eigen::VectorXd& start, const Eigen::VectorXd& end)
+    : PathSegment((end - start).norm()), end_(end), start_(start)
+  {
+  }
+
+  Eigen::VectorXd getConfig(double s) const override
+  {
+    s /= length_;
+    s = std::max(0.0, std::min(1.0, s));
+    return (1.0 - s) * start_ + s * end_;
+  }
+
+  Eigen::VectorXd getTangent(double /* s */) const override
+  {
+    return (end_ - start_) / length_;
+  }
+
+  Eigen::VectorXd getCurvature(double /* s */) const override
+  {
+    return Eigen::VectorXd::Zero(start_.size());
+  }
+
+  std::list<double> getSwitchingPoints() const override
+  {
+    return std::list<double>();
+  }
+
+  LinearPathSegment* clone() const override
+  {
+    return new LinearPathSegment(*this);
+  }
+
+private:
+  Eigen::VectorXd end_;
+  Eigen::VectorXd start_;
+};
+
+class CircularPathSegment : public PathSegment
+{
+public:
+  CircularPathSegment(const Eigen::VectorXd& start, const Eigen::VectorXd& intersection, const Eigen::VectorXd& end,
+                      double max_deviation)
+  {
+    if ((intersection - start).norm() < EPS || (end - intersection).norm() < EPS)
+    {
+      setDegenerate(intersection);
+      return;
+    }
+
+    const Eigen::VectorXd start_direction = (intersection - start).normalized();
+    const Eigen::VectorXd end_direction = (end - intersection).normalized();
+    const double start_dot_end = start_direction.dot(end_direction);
+
+    // the segments are (anti-)parallel, there is nothing to blend
+    if (start_dot_end > 1.0 - EPS || start_dot_end < -1.0 + EPS)
+    {
+      setDegenerate(intersection);
+      return;
+    }
+
+    const double angle = std::acos(start_dot_end);
+    const double start_distance = (start - intersection).norm();
+    const double end_distance = (end - intersection).norm();
+
+    // enforce the maximum deviation from the waypoint
+    double distance = std::min(start_distance, end_distance);
+    distance = std::min(distance, max_deviation * std::sin(0.5 * angle) / (1.0 - std::cos(0.5 * angle)));
+
+    radius_ = distance / std::tan(0.5 * angle);
+    length_ = angle * radius_;
+
+    center_ = intersection + (end_direction - start_direction).normalized() * radius_ / std::cos(0.5 * angle);
+    x_ = (intersection - distance * start_direction - center_).normalized();
+    y_ = start_direction;
+  }
+
+  Eigen::VectorXd getConfig(double s) const override
+  {
+    const double angle = s / radius_;
+    return center_ + radius_ * (x_ * std::cos(angle) + y_ * std::sin(angle));
+  }
+
+  Eigen::VectorXd getTangent(double s) const override
+  {
+    const double angle = s / radius_;
+    return -x_ * std::sin(angle) + y_ * std::cos(angle);
+  }
+
+  Eigen::VectorXd getCurvature(double s) const override
+  {
+    const double angle = s / radius_;
+    return -1.0 / radius_ * (x_ * std::cos(angle) + y_ * std::sin(angle));
+  }
+
+  std::list<double> getSwitchingPoints() const override
+  {
+    // the tangent of each joint changes sign (and thus its velocity limit is active) every half turn
+    std::list<double> switching_points;
+    for (unsigned int i = 0; i < x_.size(); ++i)
+    {
+      double switching_angle = std::atan2(y_[i], x_[i]);
+      if (switching_angle < 0.0)
+        switching_angle += M_PI;
+      while (switching_angle < length_ / radius_)
+      {
+        switching_points.push_back(switching_angle * radius_);
+        switching_angle += M_PI;
+      }
+    }
+    switching_points.sort();
+    return switching_points;
+  }
+
+  CircularPathSegment* clone() const override
+  {
+    return new CircularPathSegment(*this);
+  }
+
+private:
+  void setDegenerate(const Eigen::VectorXd& intersection)
+  {
+    length_ = 0.0;
+    radius_ = 1.0;
+    center_ = intersection;
+    x_ = Eigen::VectorXd::Zero(intersection.size());
+    y_ = Eigen::VectorXd::Zero(intersection.size());
+  }
+
+  double radius_;
+  Eigen::VectorXd center_;
+  Eigen::VectorXd x_;
+  Eigen::VectorXd y_;
+};
+}
+
+Path::Path(const std::list<Eigen::VectorXd>& path, double max_deviation) : length_(0.0)
+{
+  if (path.size() < 2)
+    return;
+
+  std::list<Eigen::VectorXd>::const_iterator config1 = path.begin();
+  std::list<Eigen::VectorXd>::const_iterator config2 = config1;
+  ++config2;
+  Eigen::VectorXd start_config = *config1;
+  while (config2 != path.end())
+  {
+    std::list<Eigen::VectorXd>::const_iterator config3 = config2;
+    ++config3;
+    if (max_deviation > 0.0 && config3 != path.end())
+    {
+      CircularPathSegment* blend_segment = new CircularPathSegment(0.5 * (*config1 + *config2), *config2,
+                                                                   0.5 * (*config2 + *config3), max_deviation);
+      Eigen::VectorXd end_config = blend_segment->getConfig(0.0);
+      if ((end_config - start_config).norm() > EPS)
+        path_segments_.push_back(std::unique_ptr<PathSegment>(new LinearPathSegment(start_config, end_config)));
+      path_segments_.push_back(std::unique_ptr<PathSegment>(blend_segment));
+      start_config = blend_segment->getConfig(blend_segment->getLength());
+    }
+    else
+    {
+      path_segments_.push_back(std::unique_ptr<PathSegment>(new LinearPathSegment(start_config, *config2)));
+      start_config = *config2;
+    }
+    config1 = config2;
+    ++config2;
+  }
+
+  // compute the switching point candidates, the total length and the position of each segment along the path
+  for (std::list<std::unique_ptr<PathSegment> >::iterator it = path_segments_.begin(); it != path_segments_.end();
+       ++it)
+  {
+    (*it)->position_ = length_;
+    std::list<double> local_switching_points = (*it)->getSwitchingPoints();
+    for (std::list<double>::const_iterator point = local_switching_points.begin();
+         point != local_switching_points.end(); ++point)
+      switching_points_.push_back(std::make_pair(length_ + *point, false));
+    length_ += (*it)->getLength();
+    while (!switching_points_.empty() && switching_points_.back().first >= length_)
+      switching_points_.pop_back();
+    switching_points_.push_back(std::make_pair(length_, true));
+  }
+  switching_points_.pop_back();
+}
+
+Path::Path(const Path& path) : length_(path.length_), switching_points_(path.switching_points_)
+{
+  for (std::list<std::unique_ptr<PathSegment> >::const_iterator it = path.path_segments_.begin();
+       it != path.path_segments_.end(); ++it)
+    path_segments_.push_back(std::unique_ptr<PathSegment>((*it)->clone()));
+}
+
+PathSegment* Path::getPathSegment(double& s) const
+{
+  std::list<std::unique_ptr<PathSegment> >::const_iterator it = path_segments_.begin();
+  std::list<std::unique_ptr<PathSegment> >::const_iterator next = it;
+  ++next;
+  while (next != path_segments_.end() && s >= (*next)->position_)
+  {
+    it = next;
+    ++next;
+  }
+  s -= (*it)->position_;
+  return it->get();
+}
+
+Eigen::VectorXd Path::getConfig(double s) const
+{
+  const PathSegment* path_segment = getPathSegment(s);
+  return path_segment->getConfig(s);
+}
+
+Eigen::VectorXd Path::getTangent(double s) const
+{
+  const PathSegment* path_segment = getPathSegment(s);
+  return path_segment->getTangent(s);
+}
+
+Eigen::VectorXd Path::getCurvature(double s) const
+{
+  const PathSegment* path_segment = getPathSegment(s);
+  return path_segment->getCurvature(s);
+}
+
+double Path::getNextSwitchingPoint(double s, bool& discontinuity) const
+{
+  std::list<std::pair<double, bool> >::const_iterator it = switching_points_.begin();
+  while (it != switching_points_.end() && it->first <= s)
+    ++it;
+
+  if (it == switching_points_.end())
+  {
+    discontinuity = true;
+    return length_;
+  }
+  discontinuity = it->second;
+  return it->first;
+}
+
+Trajectory::Trajectory(const Path& path, const Eigen::VectorXd& max_velocity, const Eigen::VectorXd& max_acceleration,
+                       double time_step)
+  : path_(path)
+  , max_velocity_(max_velocity)
+  , max_acceleration_(max_acceleration)
+  , joint_num_(max_velocity.size())
+  , valid_(true)
+  , time_step_(time_step)
+  , cached_time_(std::numeric_limits<double>::max())
+{
+  trajectory_.push_back(TrajectoryStep(0.0, 0.0));
+  double after_acceleration = getMinMaxPathAcceleration(0.0, 0.0, true);
+  while (valid_ && !integrateForward(trajectory_, after_acceleration) && valid_)
+  {
+    double before_acceleration;
+    TrajectoryStep switching_point;
+    if (getNextSwitchingPoint(trajectory_.back().path_pos_, switching_point, before_acceleration, after_acceleration))
+      break;
+    integrateBackward(trajectory_, switching_point.path_pos_, switching_point.path_vel_, before_acceleration);
+  }
+
+  if (valid_)
+  {
+    double before_acceleration = getMinMaxPathAcceleration(path_.getLength(), 0.0, false);
+    integrateBackward(trajectory_, path_.getLength(), 0.0, before_acceleration);
+  }
+
+  if (valid_)
+  {
+    // compute the timing from the phase plane trajectory
+    std::list<TrajectoryStep>::iterator previous = trajectory_.begin();
+    std::list<TrajectoryStep>::iterator it = previous;
+    it->time_ = 0.0;
+    ++it;
+    while (it != trajectory_.end())
+    {
+      it->time_ =
+          previous->time_ + (it->path_pos_ - previous->path_pos_) / ((it->path_vel_ + previous->path_vel_) / 2.0);
+      previous = it;
+      ++it;
+    }
+  }
+}
+
+// Returns true if the end of the path is reached
+bool Trajectory::getNextSwitchingPoint(double path_pos, TrajectoryStep& next_switching_point,
+                                       double& before_acceleration, double& after_acceleration)
+{
+  TrajectoryStep acceleration_switching_point(path_pos, 0.0);
+  double acceleration_before_acceleration, acceleration_after_acceleration;
+  bool acceleration_reached_end;
+  do
+  {
+    acceleration_reached_end =
+        getNextAccelerationSwitchingPoint(acceleration_switching_point.path_pos_, acceleration_switching_point,
+                                          acceleration_before_acceleration, acceleration_after_acceleration);
+  } while (!acceleration_reached_end &&
+           acceleration_switching_point.path_vel_ > getVelocityMaxPathVelocity(acceleration_switching_point.path_pos_));
+
+  TrajectoryStep velocity_switching_point(path_pos, 0.0);
+  double velocity_before_acceleration, velocity_after_acceleration;
+  bool velocity_reached_end;
+  do
+  {
+    velocity_reached_end = getNextVelocitySwitchingPoint(velocity_switching_point.path_pos_, velocity_switching_point,
+                                                         velocity_before_acceleration, velocity_after_acceleration);
+  } while (
+      !velocity_reached_end && velocity_switching_point.path_pos_ <= acceleration_switching_point.path_pos_ &&
+      (velocity_switching_point.path_vel_ > getAccelerationMaxPathVelocity(velocity_switching_point.path_pos_ - EPS) ||
+       velocity_switching_point.path_vel_ > getAccelerationMaxPathVelocity(velocity_switching_point.path_pos_ + EPS)));
+
+  if (acceleration_reached_end && velocity_reached_end)
+    return true;
+
+  if (!acceleration_reached_end &&
+      (velocity_reached_end || acceleration_switching_point.path_pos_ <= velocity_switching_point.path_pos_))
+  {
+    next_switching_point = acceleration_switching_point;
+    before_acceleration = acceleration_before_acceleration;
+    after_acceleration = acceleration_after_acceleration;
+  }
+  else
+  {
+    next_switching_point = velocity_switching_point;
+    before_acceleration = velocity_before_acceleration;
+    after_acceleration = velocity_after_acceleration;
+  }
+  return false;
+}
+
+bool Trajectory::getNextAccelerationSwitchingPoint(double path_pos, TrajectoryStep& next_switching_point,
+                                                   double& before_acceleration, double& after_acceleration)
+{
+  double switching_path_pos = path_pos;
+  double switching_path_vel;
+  while (true)
+  {
+    bool discontinuity;
+    switching_path_pos = path_.getNextSwitchingPoint(switching_path_pos, discontinuity);
+
+    if (switching_path_pos > path_.getLength() - EPS)
+      return true;
+
+    if (discontinuity)
+    {
+      const double before_path_vel = getAccelerationMaxPathVelocity(switching_path_pos - EPS);
+      const double after_path_vel = getAccelerationMaxPathVelocity(switching_path_pos + EPS);
+      switching_path_vel = std::min(before_path_vel, after_path_vel);
+      before_acceleration = getMinMaxPathAcceleration(switching_path_pos - EPS, switching_path_vel, false);
+      after_acceleration = getMinMaxPathAcceleration(switching_path_pos + EPS, switching_path_vel, true);
+
+      if ((before_path_vel > after_path_vel ||
+           getMinMaxPhaseSlope(switching_path_pos - EPS, switching_path_vel, false) >
+               getAccelerationMaxPathVelocityDeriv(switching_path_pos - 2.0 * EPS)) &&
+          (before_path_vel < after_path_vel ||
+           getMinMaxPhaseSlope(switching_path_pos + EPS, switching_path_vel, true) <
+               getAccelerationMaxPathVelocityDeriv(switching_path_pos + 2.0 * EPS)))
+        break;
+    }
+    else
+    {
+      switching_path_vel = getAccelerationMaxPathVelocity(switching_path_pos);
+      before_acceleration = 0.0;
+      after_acceleration = 0.0;
+
+      if (getAccelerationMaxPathVelocityDeriv(switching_path_pos - EPS) < 0.0 &&
+          getAccelerationMaxPathVelocityDeriv(switching_path_pos + EPS) > 0.0)
+        break;
+    }
+  }
+
+  next_switching_point = TrajectoryStep(switching_path_pos, switching_path_vel);
+  return false;
+}
+
+bool Trajectory::getNextVelocitySwitchingPoint(double path_pos, TrajectoryStep& next_switching_point,
+                                               double& before_acceleration, double& after_acceleration)
+{
+  const double step_size = 0.001;
+  const double accuracy = 0.000001;
+
+  bool start = false;
+  path_pos -= step_size;
+  do
+  {
+    path_pos += step_size;
+
+    if (getMinMaxPhaseSlope(path_pos, getVelocityMaxPathVelocity(path_pos), false) >=
+        getVelocityMaxPathVelocityDeriv(path_pos))
+      start = true;
+  } while ((!start || getMinMaxPhaseSlope(path_pos, getVelocityMaxPathVelocity(path_pos), false) >
+                          getVelocityMaxPathVelocityDeriv(path_pos)) &&
+           path_pos < path_.getLength());
+
+  if (path_pos >= path_.getLength())
+    return true;  // end of trajectory reached
+
+  double before_path_pos = path_pos - step_size;
+  double after_path_pos = path_pos;
+  while (after_path_pos - before_path_pos > accuracy)
+  {
+    path_pos = (before_path_pos + after_path_pos) / 2.0;
+    if (getMinMaxPhaseSlope(path_pos, getVelocityMaxPathVelocity(path_pos), false) >
+        getVelocityMaxPathVelocityDeriv(path_pos))
+      before_path_pos = path_pos;
+    else
+      after_path_pos = path_pos;
+  }
+
+  before_acceleration = getMinMaxPathAcceleration(before_path_pos, getVelocityMaxPathVelocity(before_path_pos), false);
+  after_acceleration = getMinMaxPathAcceleration(after_path_pos, getVelocityMaxPathVelocity(after_path_pos), true);
+  next_switching_point = TrajectoryStep(after_path_pos, getVelocityMaxPathVelocity(after_path_pos));
+  return false;
+}
+
+// Returns true if the end of the path is reached
+bool Trajectory::integrateForward(std::list<TrajectoryStep>& trajectory, double acceleration)
+{
+  double path_pos = trajectory.back().path_pos_;
+  double path_vel = trajectory.back().path_vel_;
+
+  const std::list<std::pair<double, bool> >& switching_points = path_.getSwitchingPoints();
+  std::list<std::pair<double, bool> >::const_iterator next_discontinuity = switching_points.begin();
+
+  while (true)
+  {
+    while (next_discontinuity != switching_points.end() &&
+           (next_discontinuity->first <= path_pos || !next_discontinuity->second))
+      ++next_discontinuity;
+
+    const double old_path_pos = path_pos;
+    const double old_path_vel = path_vel;
+
+    path_vel += time_step_ * acceleration;
+    path_pos += time_step_ * 0.5 * (old_path_vel + path_vel);
+
+    if (next_discontinuity != switching_points.end() && path_pos > next_discontinuity->first)
+    {
+      // avoid a step right next to the discontinuity, which would be duplicated by the next integration
+      if (path_pos - next_discontinuity->first < EPS)
+        continue;
+      path_vel = old_path_vel +
+                 (next_discontinuity->first - old_path_pos) * (path_vel - old_path_vel) / (path_pos - old_path_pos);
+      path_pos = next_discontinuity->first;
+    }
+
+    if (path_pos > path_.getLength())
+    {
+      trajectory.push_back(TrajectoryStep(path_pos, path_vel));
+      return true;
+    }
+    else if (path_vel < 0.0)
+    {
+      valid_ = false;
+      ROS_ERROR_NAMED(LOGNAME, "Error while integrating forward: Negative path velocity");
+      return true;
+    }
+
+    if (path_vel > getVelocityMaxPathVelocity(path_pos) &&
+        getMinMaxPhaseSlope(old_path_pos, getVelocityMaxPathVelocity(old_path_pos), false) <=
+            getVelocityMaxPathVelocityDeriv(old_path_pos))
+      path_vel = getVelocityMaxPathVelocity(path_pos);
+
+    trajectory.push_back(TrajectoryStep(path_pos, path_vel));
+    acceleration = getMinMaxPathAcceleration(path_pos, path_vel, true);
+
+    if (path_vel > getAccelerationMaxPathVelocity(path_pos) || path_vel > getVelocityMaxPathVelocity(path_pos))
+    {
+      // find a more accurate intersection with the max-velocity curve using bisection
+      const TrajectoryStep overshoot = trajectory.back();
+      trajectory.pop_back();
+      double before = trajectory.back().path_pos_;
+      double before_path_vel = trajectory.back().path_vel_;
+      double after = overshoot.path_pos_;
+      double after_path_vel = overshoot.path_vel_;
+      while (after - before > EPS)
+      {
+        const double midpoint = 0.5 * (before + after);
+        double midpoint_path_vel = 0.5 * (before_path_vel + after_path_vel);
+
+        if (midpoint_path_vel > getVelocityMaxPathVelocity(midpoint) &&
+            getMinMaxPhaseSlope(before, getVelocityMaxPathVelocity(before), false) <=
+                getVelocityMaxPathVelocityDeriv(before))
+          midpoint_path_vel = getVelocityMaxPathVelocity(midpoint);
+
+        if (midpoint_path_vel > getAccelerationMaxPathVelocity(midpoint) ||
+            midpoint_path_vel > getVelocityMaxPathVelocity(midpoint))
+        {
+          after = midpoint;
+          after_path_vel = midpoint_path_vel;
+        }
+        else
+        {
+          before = midpoint;
+          before_path_vel = midpoint_path_vel;
+        }
+      }
+      trajectory.push_back(TrajectoryStep(before, before_path_vel));
+
+      if (getAccelerationMaxPathVelocity(after) < getVelocityMaxPathVelocity(after))
+      {
+        if (next_discontinuity != switching_points.end() && after > next_discontinuity->first)
+          return false;
+        else if (getMinMaxPhaseSlope(trajectory.back().path_pos_, trajectory.back().path_vel_, true) >
+                 getAccelerationMaxPathVelocityDeriv(trajectory.back().path_pos_))
+          return false;
+      }
+      else
+      {
+        if (getMinMaxPhaseSlope(trajectory.back().path_pos_, trajectory.back().path_vel_, false) >
+            getVelocityMaxPathVelocityDeriv(trajectory.back().path_pos_))
+          return false;
+      }
+    }
+  }
+}
+
+void Trajectory::integrateBackward(std::list<TrajectoryStep>& start_trajectory, double path_pos, double path_vel,
+                                   double acceleration)
+{
+  std::list<TrajectoryStep>::iterator start2 = start_trajectory.end();
+  --start2;
+  std::list<TrajectoryStep>::iterator start1 = start2;
+  --start1;
+  std::list<TrajectoryStep> trajectory;
+  double slope = 0.0;
+
+  while (start1 != start_trajectory.begin() || path_pos >= 0.0)
+  {
+    if (start1->path_pos_ <= path_pos)
+    {
+      trajectory.push_front(TrajectoryStep(path_pos, path_vel));
+      path_vel -= time_step_ * acceleration;
+      path_pos -= time_step_ * 0.5 * (path_vel + trajectory.front().path_vel_);
+      acceleration = getMinMaxPathAcceleration(path_pos, path_vel, false);
+      slope = (trajectory.front().path_vel_ - path_vel) / (trajectory.front().path_pos_ - path_pos);
+
+      if (path_vel < 0.0)
+      {
+        valid_ = false;
+        ROS_ERROR_NAMED(LOGNAME, "Error while integrating backward: Negative path velocity");
+        return;
+      }
+    }
+    else
+    {
+      --start1;
+      --start2;
+    }
+
+    // check for an intersection between the current start trajectory and the backward trajectory segments
+    const double start_slope = (start2->path_vel_ - start1->path_vel_) / (start2->path_pos_ - start1->path_pos_);
+    const double intersection_path_pos =
+        (start1->path_vel_ - path_vel + slope * path_pos - start_slope * start1->path_pos_) / (slope - start_slope);
+    if (std::max(start1->path_pos_, path_pos) - EPS <= intersection_path_pos &&
+        intersection_path_pos <= EPS + std::min(start2->path_pos_, trajectory.front().path_pos_))
+    {
+      const double intersection_path_vel =
+          start1->path_vel_ + start_slope * (intersection_path_pos - start1->path_pos_);
+      start_trajectory.erase(start2, start_trajectory.end());
+      start_trajectory.push_back(TrajectoryStep(intersection_path_pos, intersection_path_vel));
+      start_trajectory.splice(start_trajectory.end(), trajectory);
+      return;
+    }
+  }
+
+  valid_ = false;
+  ROS_ERROR_NAMED(LOGNAME, "Error while integrating backward: Did not hit start trajectory");
+}
+
+double Trajectory::getMinMaxPathAcceleration(double path_pos, double path_vel, bool max)
+{
+  const Eigen::VectorXd config_deriv = path_.getTangent(path_pos);
+  const Eigen::VectorXd config_deriv2 = path_.getCurvature(path_pos);
+  const double factor = max ? 1.0 : -1.0;
+  double max_path_acceleration = std::numeric_limits<double>::max();
+  for (unsigned int i = 0; i < joint_num_; ++i)
+  {
+    if (config_deriv[i] != 0.0)
+    {
+      max_path_acceleration =
+          std::min(max_path_acceleration, max_acceleration_[i] / std::abs(config_deriv[i]) -
+                                              factor * config_deriv2[i] * path_vel * path_vel / config_deriv[i]);
+    }
+  }
+  return factor * max_path_acceleration;
+}
+
+double Trajectory::getMinMaxPhaseSlope(double path_pos, double path_vel, bool max)
+{
+  return getMinMaxPathAcceleration(path_pos, path_vel, max) / path_vel;
+}
+
+double Trajectory::getAccelerationMaxPathVelocity(double path_pos) const
+{
+  double max_path_velocity = std::numeric_limits<double>::infinity();
+  const Eigen::VectorXd config_deriv = path_.getTangent(path_pos);
+  const Eigen::VectorXd config_deriv2 = path_.getCurvature(path_pos);
+  for (unsigned int i = 0; i < joint_num_; ++i)
+  {
+    if (config_deriv[i] != 0.0)
+    {
+      for (unsigned int j = i + 1; j < joint_num_; ++j)
+      {
+        if (config_deriv[j] != 0.0)
+        {
+          const double a_ij = config_deriv2[i] / config_deriv[i] - config_deriv2[j] / config_deriv[j];
+          if (a_ij != 0.0)
+          {
+            const double max_path_acceleration =
+                max_acceleration_[i] / std::abs(config_deriv[i]) + max_acceleration_[j] / std::abs(config_deriv[j]);
+            max_path_velocity = std::min(max_path_velocity, std::sqrt(max_path_acceleration / std::abs(a_ij)));
+          }
+        }
+      }
+    }
+    else if (config_deriv2[i] != 0.0)
+      max_path_velocity = std::min(max_path_velocity, std::sqrt(max_acceleration_[i] / std::abs(config_deriv2[i])));
+  }
+  return max_path_velocity;
+}
+
+double Trajectory::getVelocityMaxPathVelocity(double path_pos) const
+{
+  const Eigen::VectorXd tangent = path_.getTangent(path_pos);
+  double max_path_velocity = std::numeric_limits<double>::max();
+  for (unsigned int i = 0; i < joint_num_; ++i)
+    max_path_velocity = std::min(max_path_velocity, max_velocity_[i] / std::abs(tangent[i]));
+  return max_path_velocity;
+}
+
+double Trajectory::getAccelerationMaxPathVelocityDeriv(double path_pos)
+{
+  return (getAccelerationMaxPathVelocity(path_pos + EPS) - getAccelerationMaxPathVelocity(path_pos - EPS)) /
+         (2.0 * EPS);
+}
+
+double Trajectory::getVelocityMaxPathVelocityDeriv(double path_pos)
+{
+  const Eigen::VectorXd tangent = path_.getTangent(path_pos);
+  double max_path_velocity = std::numeric_limits<double>::max();
+  unsigned int active_constraint = 0;
+  for (unsigned int i = 0; i < joint_num_; ++i)
+  {
+    const double this_max_path_velocity = max_velocity_[i] / std::abs(tangent[i]);
+    if (this_max_path_velocity < max_path_velocity)
+    {
+      max_path_velocity = this_max_path_velocity;
+      active_constraint = i;
+    }
+  }
+  return -(max_velocity_[active_constraint] * path_.getCurvature(path_pos)[active_constraint]) /
+         (tangent[active_constraint] * std::abs(tangent[active_constraint]));
+}
+
+double Trajectory::getDuration() const
+{
+  return trajectory_.back().time_;
+}
+
+std::list<Trajectory::TrajectoryStep>::const_iterator Trajectory::getTrajectorySegment(double time) const
+{
+  if (time >= trajectory_.back().time_)
+  {
+    std::list<TrajectoryStep>::const_iterator last = trajectory_.end();
+    --last;
+    return last;
+  }
+
+  if (time < cached_time_)
+    cached_trajectory_segment_ = trajectory_.begin();
+  while (time >= cached_trajectory_segment_->time_)
+    ++cached_trajectory_segment_;
+  cached_time_ = time;
+  return cached_trajectory_segment_;
+}
+
+double Trajectory::getPathPosition(double time, double& path_vel, double& path_acc) const
+{
+  std::list<TrajectoryStep>::const_iterator it = getTrajectorySegment(time);
+  std::list<TrajectoryStep>::const_iterator previous = it;
+  --previous;
+
+  // the path acceleration is constant between two steps
+  double time_step = it->time_ - previous->time_;
+  path_acc = 2.0 * (it->path_pos_ - previous->path_pos_ - time_step * previous->path_vel_) / (time_step * time_step);
+
+  time_step = time - previous->time_;
+  path_vel = previous->path_vel_ + time_step * path_acc;
+  return previous->path_pos_ + time_step * previous->path_vel_ + 0.5 * time_step * time_step * path_acc;
+}
+
+Eigen::VectorXd Trajectory::getPosition(double time) const
+{
+  double path_vel, path_acc;
+  return path_.getConfig(getPathPosition(time, path_vel, path_acc));
+}
+
+Eigen::VectorXd Trajectory::getVelocity(double time) const
+{
+  double path_vel, path_acc;
+  const double path_pos = getPathPosition(time, path_vel, path_acc);
+  return path_.getTangent(path_pos) * path_vel;
+}
+
+Eigen::VectorXd Trajectory::getAcceleration(double time) const
+{
+  double path_vel, path_acc;
+  const double path_pos = getPathPosition(time, path_vel, path_acc);
+  return path_.getTangent(path_pos) * path_acc + path_.getCurvature(path_pos) * path_vel * path_vel;
+}
+
+TimeOptimalTrajectoryGeneration::TimeOptimalTrajectoryGeneration(const double path_tolerance, const double resample_dt,
+                                                                 const double min_angle_change)
+  : path_tolerance_(path_tolerance), resample_dt_(resample_dt), min_angle_change_(min_angle_change)
+{
+}
+
+TimeOptimalTrajectoryGeneration::~TimeOptimalTrajectoryGeneration()
+{
+}
+
+bool TimeOptimalTrajectoryGeneration::computeTimeStamps(robot_trajectory::RobotTrajectory& trajectory,
+                                                        const double max_velocity_scaling_factor,
+                                                        const double max_acceleration_scaling_factor) const
+{
+  if (trajectory.empty())
+    return true;
+
+  const robot_model::JointModelGroup* group = trajectory.getGroup();
+  if (!group)
+  {
+    ROS_ERROR_NAMED(LOGNAME, "It looks like the planner did not set the group the plan was computed for");
+    return false;
+  }
+
+  double velocity_scaling_factor = 1.0;
+  double acceleration_scaling_factor = 1.0;
+
+  if (max_velocity_scaling_factor > 0.0 && max_velocity_scaling_factor <= 1.0)
+    velocity_scaling_factor = max_velocity_scaling_factor;
+  else if (max_velocity_scaling_factor == 0.0)
+    ROS_DEBUG_NAMED(LOGNAME, "A max_velocity_scaling_factor of 0.0 was specified, defaulting to %f instead.",
+                    velocity_scaling_factor);
+  else
+    ROS_WARN_NAMED(LOGNAME, "Invalid max_velocity_scaling_factor %f specified, defaulting to %f instead.",
+                   max_velocity_scaling_factor, velocity_scaling_factor);
+
+  if (max_acceleration_scaling_factor > 0.0 && max_acceleration_scaling_factor <= 1.0)
+    acceleration_scaling_factor = max_acceleration_scaling_factor;
+  else if (max_acceleration_scaling_factor == 0.0)
+    ROS_DEBUG_NAMED(LOGNAME, "A max_acceleration_scaling_factor of 0.0 was specified, defaulting to %f instead.",
+                    acceleration_scaling_factor);
+  else
+    ROS_WARN_NAMED(LOGNAME, "Invalid max_acceleration_scaling_factor %f specified, defaulting to %f instead.",
+                   max_acceleration_scaling_factor, acceleration_scaling_factor);
+
+  const robot_model::RobotModel& rmodel = group->getParentModel();
+  const std::vector<std::string>& vars = group->getVariableNames();
+  const std::vector<int>& idx = group->getVariableIndexList();
+  const unsigned int num_joints = group->getVariableCount();
+  const unsigned int num_points = trajectory.getWayPointCount();
+
+  // symmetric limits, as the path may be traversed in either direction by each joint
+  Eigen::VectorXd max_velocity(num_joints);
+  Eigen::VectorXd max_acceleration(num_joints);
+  for (unsigned int j = 0; j < num_joints; ++j)
+  {
+    const robot_model::VariableBounds& bounds = rmodel.getVariableBounds(vars[j]);
+
+    max_velocity[j] = DEFAULT_LIMIT;
+    if (bounds.velocity_bounded_)
+    {
+      max_velocity[j] = std::min(std::fabs(bounds.max_velocity_), std::fabs(bounds.min_velocity_));
+      if (bounds.min_velocity_ == 0.0)
+        max_velocity[j] = std::fabs(bounds.max_velocity_);
+    }
+    max_velocity[j] *= velocity_scaling_factor;
+
+    max_acceleration[j] = DEFAULT_LIMIT;
+    if (bounds.acceleration_bounded_)
+    {
+      max_acceleration[j] = std::min(std::fabs(bounds.max_acceleration_), std::fabs(bounds.min_acceleration_));
+      if (bounds.min_acceleration_ == 0.0)
+        max_acceleration[j] = std::fabs(bounds.max_acceleration_);
+    }
+    max_acceleration[j] *= acceleration_scaling_factor;
+
+    if (max_velocity[j] <= 0.0 || max_acceleration[j] <= 0.0)
+    {
+      ROS_ERROR_NAMED(LOGNAME, "Joint '%s' max velocity %f and max acceleration %f must be greater than zero",
+                      vars[j].c_str(), max_velocity[j], max_acceleration[j]);
+      return false;
+    }
+  }
+
+  // No wrapped angles.
+  trajectory.unwind();
+
+  // skip waypoints that (almost) repeat their predecessor, they do not contribute to the path
+  std::list<Eigen::VectorXd> points;
+  for (unsigned int p = 0; p < num_points; ++p)
+  {
+    const robot_state::RobotState& waypoint = trajectory.getWayPoint(p);
+    Eigen::VectorXd new_point(num_joints);
+    bool diverse_point = p == 0;
+    for (unsigned int j = 0; j < num_joints; ++j)
+    {
+      new_point[j] = waypoint.getVariablePosition(idx[j]);
+      if (p > 0 && std::fabs(new_point[j] - points.back()[j]) > min_angle_change_)
+        diverse_point = true;
+    }
+    if (diverse_point)
+      points.push_back(new_point);
+  }
+
+  robot_state::RobotState waypoint(trajectory.getWayPoint(0));
+  trajectory.clear();
+
+  // the robot does not move
+  if (points.size() == 1)
+  {
+    for (unsigned int j = 0; j < num_joints; ++j)
+    {
+      waypoint.setVariableVelocity(idx[j], 0.0);
+      waypoint.setVariableAcceleration(idx[j], 0.0);
+    }
+    trajectory.addSuffixWayPoint(waypoint, 0.0);
+    return true;
+  }
+
+  const Trajectory parameterized(Path(points, path_tolerance_), max_velocity, max_acceleration);
+  if (!parameterized.isValid())
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Unable to parameterize trajectory.");
+    return false;
+  }
+
+  // resample at a fixed interval, always including the end of the trajectory
+  const double duration = parameterized.getDuration();
+  const std::size_t sample_count = std::ceil(duration / resample_dt_);
+  double last_t = 0.0;
+  for (std::size_t sample = 0; sample <= sample_count; ++sample)
+  {
+    const double t = std::min(duration, sample * resample_dt_);
+    const Eigen::VectorXd position = parameterized.getPosition(t);
+    const Eigen::VectorXd velocity = parameterized.getVelocity(t);
+    const Eigen::VectorXd acceleration = parameterized.getAcceleration(t);
+
+    for (unsigned int j = 0; j < num_joints; ++j)
+    {
+      waypoint.setVariablePosition(idx[j], position[j]);
+      waypoint.setVariableVelocity(idx[j], velocity[j]);
+      waypoint.setVariableAcceleration(idx[j], acceleration[j]);
+    }
+    trajectory.addSuffixWayPoint(waypoint, t - last_t);
+    last_t = t;
+  }
+
+  return true;
+}
+}
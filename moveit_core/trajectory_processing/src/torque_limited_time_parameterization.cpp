@@ -0,0 +1,130 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/trajectory_processing/torque_limited_time_parameterization.h>
+#include <moveit/robot_trajectory/trajectory_arrays.h>
+#include <ros/console.h>
+#include <algorithm>
+#include <cmath>
+
+namespace trajectory_processing
+{
+TorqueLimitedTimeParameterization::TorqueLimitedTimeParameterization(double torque_scaling_factor,
+                                                                     unsigned int max_iterations, unsigned int threads)
+  : torque_scaling_factor_(torque_scaling_factor), max_iterations_(max_iterations), threads_(threads)
+{
+}
+
+bool TorqueLimitedTimeParameterization::computeTimeStamps(robot_trajectory::RobotTrajectory& trajectory,
+                                                          const dynamics_solver::DynamicsSolver& solver,
+                                                          double payload, const double max_velocity_scaling_factor,
+                                                          const double max_acceleration_scaling_factor) const
+{
+  if (trajectory.empty())
+    return true;
+
+  if (!solver.getGroup())
+  {
+    ROS_ERROR_NAMED("trajectory_processing.torque_limited_time_parameterization",
+                    "The dynamics solver was not initialized properly");
+    return false;
+  }
+
+  const bool start_velocity = trajectory.getFirstWayPoint().hasVelocities();
+  if (!time_param_.computeTimeStamps(trajectory, max_velocity_scaling_factor, max_acceleration_scaling_factor))
+    return false;
+
+  const std::size_t num_points = trajectory.getWayPointCount();
+  if (num_points <= 1)
+    return true;
+
+  // the torques needed to hold the waypoints at rest do not depend on the timing
+  std::vector<std::vector<double> > static_torques, torques;
+  if (!solver.getTrajectoryStaticTorques(trajectory, payload, static_torques, threads_))
+    return false;
+
+  const std::vector<double>& max_torques = solver.getMaxTorques();
+  const std::size_t num_joints = std::min(max_torques.size(), static_torques[0].size());
+  for (std::size_t i = 0; i < num_points; ++i)
+    for (std::size_t j = 0; j < num_joints; ++j)
+      if (max_torques[j] > 0.0 && std::abs(static_torques[i][j]) >= torque_scaling_factor_ * max_torques[j])
+      {
+        ROS_ERROR_NAMED("trajectory_processing.torque_limited_time_parameterization",
+                        "Waypoint %zu cannot be held at rest with a payload of %lf kg: joint %zu needs a torque of %lf "
+                        "but the limit is %lf",
+                        i, payload, j, static_torques[i][j], torque_scaling_factor_ * max_torques[j]);
+        return false;
+      }
+
+  robot_trajectory::TrajectoryArrays arrays(trajectory);
+  std::vector<double> scale(num_points), time_diff(num_points - 1);
+  for (unsigned int iteration = 0; iteration < max_iterations_; ++iteration)
+  {
+    if (!solver.getTrajectoryTorques(trajectory, payload, torques, threads_))
+      return false;
+
+    // the dynamic part of the torque scales with the inverse square of the time scaling
+    bool within_limits = true;
+    for (std::size_t i = 0; i < num_points; ++i)
+    {
+      scale[i] = 1.0;
+      for (std::size_t j = 0; j < num_joints; ++j)
+      {
+        const double limit = torque_scaling_factor_ * max_torques[j];
+        if (limit <= 0.0 || std::abs(torques[i][j]) <= limit)
+          continue;
+        const double dynamic = std::abs(torques[i][j] - static_torques[i][j]);
+        scale[i] = std::max(scale[i], std::sqrt(dynamic / (limit - std::abs(static_torques[i][j]))));
+        within_limits = false;
+      }
+    }
+    if (within_limits)
+      return true;
+
+    const std::vector<double>& durations = arrays.getWayPointDurations();
+    for (std::size_t i = 0; i + 1 < num_points; ++i)
+      time_diff[i] = durations[i + 1] * std::max(scale[i], scale[i + 1]);
+
+    // keep the start velocity only if it was part of the input
+    if (!start_velocity)
+      arrays.clearVelocities();
+    IterativeParabolicTimeParameterization::setTimeDifferences(arrays, time_diff);
+    arrays.copyTimingTo(trajectory);
+  }
+
+  ROS_WARN_NAMED("trajectory_processing.torque_limited_time_parameterization",
+                 "Joint torques still exceed their limits after %u iterations", max_iterations_);
+  return false;
+}
+}
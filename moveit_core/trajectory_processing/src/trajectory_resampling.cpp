@@ -0,0 +1,201 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/trajectory_processing/trajectory_resampling.h>
+#include <ros/console.h>
+#include <Eigen/Core>
+#include <cmath>
+#include <limits>
+
+namespace trajectory_processing
+{
+TrajectoryResampler::TrajectoryResampler(double period) : period_(period)
+{
+}
+
+bool TrajectoryResampler::resample(robot_trajectory::RobotTrajectory& trajectory) const
+{
+  if (trajectory.empty())
+    return true;
+
+  robot_trajectory::TrajectoryArrays input(trajectory);
+  input.unwind();
+  robot_trajectory::TrajectoryArrays output(trajectory.getRobotModel(), trajectory.getGroup());
+  if (!resample(input, output))
+    return false;
+
+  // the reference state keeps the values of the variables outside the group
+  const robot_state::RobotState reference_state(trajectory.getFirstWayPoint());
+  output.getRobotTrajectory(trajectory, reference_state);
+  return true;
+}
+
+bool TrajectoryResampler::resample(const robot_trajectory::TrajectoryArrays& input,
+                                   robot_trajectory::TrajectoryArrays& output) const
+{
+  output.clear();
+  if (input.empty())
+    return true;
+  if (!(period_ > 0.0))
+  {
+    ROS_ERROR_NAMED("trajectory_processing.trajectory_resampling", "The resampling period must be positive, not %lf",
+                    period_);
+    return false;
+  }
+  if (!input.hasVelocities())
+  {
+    ROS_ERROR_NAMED("trajectory_processing.trajectory_resampling",
+                    "Only trajectories with velocities (time parameterized ones) can be resampled");
+    return false;
+  }
+
+  // bounds of the variables, infinite where a variable is not bounded
+  const robot_model::RobotModel& model = *input.getRobotModel();
+  const std::vector<int>& indices = input.getVariableIndices();
+  const std::size_t n = indices.size();
+  const double inf = std::numeric_limits<double>::infinity();
+  Eigen::ArrayXd min_position = Eigen::ArrayXd::Constant(n, -inf), max_position = Eigen::ArrayXd::Constant(n, inf);
+  Eigen::ArrayXd min_velocity = min_position, max_velocity = max_position;
+  Eigen::ArrayXd min_acceleration = min_position, max_acceleration = max_position;
+  for (std::size_t r = 0; r < n; ++r)
+  {
+    const std::string& name = model.getVariableNames()[indices[r]];
+    if (model.getJointOfVariable(name)->getVariableCount() != 1)
+    {
+      ROS_ERROR_NAMED("trajectory_processing.trajectory_resampling",
+                      "Cannot resample the multi-dof joint of variable '%s'", name.c_str());
+      return false;
+    }
+    const robot_model::VariableBounds& bounds = model.getVariableBounds(name);
+    if (bounds.position_bounded_)
+    {
+      min_position[r] = bounds.min_position_;
+      max_position[r] = bounds.max_position_;
+    }
+    if (bounds.velocity_bounded_)
+    {
+      min_velocity[r] = bounds.min_velocity_;
+      max_velocity[r] = bounds.max_velocity_;
+    }
+    if (bounds.acceleration_bounded_)
+    {
+      min_acceleration[r] = bounds.min_acceleration_;
+      max_acceleration[r] = bounds.max_acceleration_;
+    }
+  }
+
+  const std::size_t count = input.getWayPointCount();
+  const double duration = input.getWayPointDurationFromStart(count - 1);
+  const std::size_t samples = static_cast<std::size_t>(std::ceil(duration / period_ - 1e-9)) + 1;
+  robot_trajectory::TrajectoryArrays::ConstMatrix positions = input.getPositions();
+  robot_trajectory::TrajectoryArrays::ConstMatrix velocities = input.getVelocities();
+  robot_trajectory::TrajectoryArrays::ConstMatrix accelerations = input.getAccelerations();
+  const bool quintic = input.hasAccelerations();
+
+  output.reserve(samples);
+  output.addSuffixWayPoint(input.getWayPointPositions(0), 0.0);
+  for (std::size_t k = 1; k + 1 < samples; ++k)
+    output.addSuffixWayPoint(input.getWayPointPositions(0), period_);
+  if (samples > 1)
+    output.addSuffixWayPoint(input.getWayPointPositions(count - 1), period_);
+  robot_trajectory::TrajectoryArrays::Matrix out_positions = output.getPositions();
+  robot_trajectory::TrajectoryArrays::Matrix out_velocities = output.getVelocities();
+  robot_trajectory::TrajectoryArrays::Matrix out_accelerations = output.getAccelerations();
+  out_velocities.col(0) = velocities.col(0);
+  out_velocities.col(samples - 1) = velocities.col(count - 1);
+  if (quintic)
+  {
+    out_accelerations.col(0) = accelerations.col(0);
+    out_accelerations.col(samples - 1) = accelerations.col(count - 1);
+  }
+
+  // coefficients of the polynomials of the current segment, one row per variable, lowest order first
+  Eigen::ArrayXXd c(n, 6);
+  std::size_t k = 1;
+  double segment_start = 0.0;
+  for (std::size_t i = 1; i < count && k + 1 < samples; ++i)
+  {
+    const double t = input.getWayPointDurations()[i];
+    const double segment_end = segment_start + t;
+    if (t <= 0.0 || k * period_ >= segment_end)
+    {
+      segment_start = segment_end;
+      continue;
+    }
+
+    const Eigen::ArrayXd p0 = positions.col(i - 1).array(), p1 = positions.col(i).array();
+    const Eigen::ArrayXd v0 = velocities.col(i - 1).array(), v1 = velocities.col(i).array();
+    c.col(0) = p0;
+    c.col(1) = v0;
+    if (quintic)
+    {
+      const Eigen::ArrayXd a0 = accelerations.col(i - 1).array(), a1 = accelerations.col(i).array();
+      const double t2 = t * t;
+      c.col(2) = 0.5 * a0;
+      c.col(3) = (20.0 * (p1 - p0) - (8.0 * v1 + 12.0 * v0) * t - (3.0 * a0 - a1) * t2) / (2.0 * t2 * t);
+      c.col(4) = (30.0 * (p0 - p1) + (14.0 * v1 + 16.0 * v0) * t + (3.0 * a0 - 2.0 * a1) * t2) / (2.0 * t2 * t2);
+      c.col(5) = (12.0 * (p1 - p0) - 6.0 * (v1 + v0) * t - (a0 - a1) * t2) / (2.0 * t2 * t2 * t);
+    }
+    else
+    {
+      c.col(2) = (3.0 * (p1 - p0) / t - 2.0 * v0 - v1) / t;
+      c.col(3) = (2.0 * (p0 - p1) / t + v0 + v1) / (t * t);
+      c.col(4).setZero();
+      c.col(5).setZero();
+    }
+
+    for (; k + 1 < samples && k * period_ < segment_end; ++k)
+    {
+      const double s = k * period_ - segment_start;
+      out_positions.col(k) =
+          (c.col(0) + s * (c.col(1) + s * (c.col(2) + s * (c.col(3) + s * (c.col(4) + s * c.col(5))))))
+              .max(min_position)
+              .min(max_position)
+              .matrix();
+      out_velocities.col(k) =
+          (c.col(1) + s * (2.0 * c.col(2) + s * (3.0 * c.col(3) + s * (4.0 * c.col(4) + s * 5.0 * c.col(5)))))
+              .max(min_velocity)
+              .min(max_velocity)
+              .matrix();
+      out_accelerations.col(k) = (2.0 * c.col(2) + s * (6.0 * c.col(3) + s * (12.0 * c.col(4) + s * 20.0 * c.col(5))))
+                                     .max(min_acceleration)
+                                     .min(max_acceleration)
+                                     .matrix();
+    }
+    segment_start = segment_end;
+  }
+
+  return true;
+}
+}
@@ -42,8 +42,12 @@
 #include <moveit/robot_state/robot_state.h>
 #include <moveit/robot_model/robot_model.h>
 #include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/robot_trajectory/trajectory_arrays.h>
 #include <moveit/trajectory_processing/iterative_spline_parameterization.h>
 #include <moveit/trajectory_processing/iterative_time_parameterization.h>
+#include <moveit/trajectory_processing/time_optimal_trajectory_generation.h>
+#include <moveit/trajectory_processing/torque_limited_time_parameterization.h>
+#include <moveit/trajectory_processing/trajectory_resampling.h>
 
 // Function declarations
 moveit::core::RobotModelConstPtr loadModel();
@@ -175,6 +179,43 @@ TEST(TestTimeParameterization, TestIterativeParabolic)
   ASSERT_LT(trajectory.getWayPointDurationFromStart(trajectory.getWayPointCount() - 1), 3.0);
 }
 
+TEST(TestTimeParameterization, TestIterativeParabolicArrays)
+{
+  trajectory_processing::IterativeParabolicTimeParameterization time_parameterization;
+  EXPECT_EQ(initStraightTrajectory(trajectory), 0);
+  robot_trajectory::TrajectoryArrays arrays(trajectory);
+  ASSERT_EQ(arrays.getWayPointCount(), trajectory.getWayPointCount());
+
+  EXPECT_TRUE(time_parameterization.computeTimeStamps(trajectory));
+  EXPECT_TRUE(time_parameterization.computeTimeStamps(arrays));
+
+  // both representations go through the same computation
+  const std::vector<int>& idx = trajectory.getGroup()->getVariableIndexList();
+  ASSERT_TRUE(arrays.hasVelocities());
+  ASSERT_TRUE(arrays.hasAccelerations());
+  for (std::size_t i = 0; i < trajectory.getWayPointCount(); ++i)
+  {
+    EXPECT_NEAR(arrays.getWayPointDurationFromStart(i), trajectory.getWayPointDurationFromStart(i), 1e-12);
+    for (std::size_t j = 0; j < idx.size(); ++j)
+    {
+      EXPECT_NEAR(arrays.getVelocities()(j, i), trajectory.getWayPoint(i).getVariableVelocity(idx[j]), 1e-12);
+      EXPECT_NEAR(arrays.getAccelerations()(j, i), trajectory.getWayPoint(i).getVariableAcceleration(idx[j]), 1e-12);
+    }
+  }
+
+  moveit_msgs::RobotTrajectory from_arrays, from_states;
+  arrays.getRobotTrajectoryMsg(from_arrays);
+  trajectory.getRobotTrajectoryMsg(from_states);
+  EXPECT_EQ(from_arrays.joint_trajectory.joint_names, from_states.joint_trajectory.joint_names);
+  ASSERT_EQ(from_arrays.joint_trajectory.points.size(), from_states.joint_trajectory.points.size());
+  for (std::size_t i = 0; i < from_states.joint_trajectory.points.size(); ++i)
+  {
+    EXPECT_EQ(from_arrays.joint_trajectory.points[i].positions, from_states.joint_trajectory.points[i].positions);
+    EXPECT_NEAR(from_arrays.joint_trajectory.points[i].time_from_start.toSec(),
+                from_states.joint_trajectory.points[i].time_from_start.toSec(), 1e-6);
+  }
+}
+
 TEST(TestTimeParameterization, TestIterativeSpline)
 {
   trajectory_processing::IterativeSplineParameterization time_parameterization(false);
@@ -212,6 +253,118 @@ TEST(TestTimeParameterization, TestRepeatedPoint)
   ASSERT_LT(trajectory.getWayPointDurationFromStart(trajectory.getWayPointCount() - 1), 0.001);
 }
 
+TEST(TestTimeParameterization, TestTimeOptimal)
+{
+  trajectory_processing::TimeOptimalTrajectoryGeneration time_parameterization;
+  EXPECT_EQ(initStraightTrajectory(trajectory), 0);
+
+  ros::WallTime wt = ros::WallTime::now();
+  EXPECT_TRUE(time_parameterization.computeTimeStamps(trajectory));
+  std::cout << "TimeOptimalTrajectoryGeneration took " << (ros::WallTime::now() - wt).toSec() << std::endl;
+  printTrajectory(trajectory);
+  ASSERT_LT(trajectory.getWayPointDurationFromStart(trajectory.getWayPointCount() - 1), 3.0);
+
+  // the limits of the model are respected along the whole trajectory
+  const robot_model::JointModelGroup* group = trajectory.getGroup();
+  const std::vector<int>& idx = group->getVariableIndexList();
+  const robot_model::VariableBounds& bounds = rmodel->getVariableBounds(group->getVariableNames()[0]);
+  for (std::size_t i = 0; i < trajectory.getWayPointCount(); ++i)
+  {
+    const robot_state::RobotState& waypoint = trajectory.getWayPoint(i);
+    if (bounds.velocity_bounded_)
+      EXPECT_LE(std::fabs(waypoint.getVariableVelocity(idx[0])), bounds.max_velocity_ + 1e-3);
+    if (bounds.acceleration_bounded_)
+      EXPECT_LE(std::fabs(waypoint.getVariableAcceleration(idx[0])), bounds.max_acceleration_ + 1e-3);
+  }
+  EXPECT_NEAR(trajectory.getLastWayPoint().getVariablePosition(idx[0]), 2.0, 1e-6);
+}
+
+TEST(TestTimeParameterization, TestTimeOptimalRepeatedPoint)
+{
+  trajectory_processing::TimeOptimalTrajectoryGeneration time_parameterization;
+  EXPECT_EQ(initRepeatedPointTrajectory(trajectory), 0);
+
+  EXPECT_TRUE(time_parameterization.computeTimeStamps(trajectory));
+  printTrajectory(trajectory);
+  ASSERT_LT(trajectory.getWayPointDurationFromStart(trajectory.getWayPointCount() - 1), 0.001);
+}
+
+TEST(TestTimeParameterization, TestTorqueLimited)
+{
+  // without gravity all torques come from the motion, so any torque limit can be met by slowing down
+  geometry_msgs::Vector3 gravity;
+  dynamics_solver::DynamicsSolver solver(rmodel, "right_arm", gravity);
+  ASSERT_TRUE(solver.getGroup() != nullptr);
+
+  trajectory_processing::IterativeParabolicTimeParameterization iterative_parabolic;
+  EXPECT_EQ(initStraightTrajectory(trajectory), 0);
+  EXPECT_TRUE(iterative_parabolic.computeTimeStamps(trajectory));
+  const double unlimited_duration = trajectory.getWayPointDurationFromStart(trajectory.getWayPointCount() - 1);
+
+  std::vector<std::vector<double> > torques;
+  ASSERT_TRUE(solver.getTrajectoryTorques(trajectory, 0.0, torques));
+  double max_ratio = 0.0;
+  const std::vector<double>& max_torques = solver.getMaxTorques();
+  for (std::size_t i = 0; i < torques.size(); ++i)
+    for (std::size_t j = 0; j < torques[i].size(); ++j)
+      if (max_torques[j] > 0.0)
+        max_ratio = std::max(max_ratio, std::fabs(torques[i][j]) / max_torques[j]);
+  ASSERT_GT(max_ratio, 0.0);
+
+  // allow only a quarter of the torque the unconstrained trajectory needs
+  const double torque_scaling_factor = max_ratio / 4.0;
+  trajectory_processing::TorqueLimitedTimeParameterization time_parameterization(torque_scaling_factor, 20, 2);
+  EXPECT_EQ(initStraightTrajectory(trajectory), 0);
+  EXPECT_TRUE(time_parameterization.computeTimeStamps(trajectory, solver));
+  printTrajectory(trajectory);
+  EXPECT_GT(trajectory.getWayPointDurationFromStart(trajectory.getWayPointCount() - 1), unlimited_duration);
+
+  ASSERT_TRUE(solver.getTrajectoryTorques(trajectory, 0.0, torques));
+  for (std::size_t i = 0; i < torques.size(); ++i)
+    for (std::size_t j = 0; j < torques[i].size(); ++j)
+      if (max_torques[j] > 0.0)
+        EXPECT_LE(std::fabs(torques[i][j]), torque_scaling_factor * max_torques[j] + 1e-6);
+}
+
+TEST(TestTimeParameterization, TestResampling)
+{
+  trajectory_processing::IterativeParabolicTimeParameterization time_parameterization;
+  EXPECT_EQ(initStraightTrajectory(trajectory), 0);
+  ASSERT_TRUE(time_parameterization.computeTimeStamps(trajectory));
+  const double duration = trajectory.getWayPointDurationFromStart(trajectory.getWayPointCount() - 1);
+  const robot_state::RobotState first = trajectory.getFirstWayPoint();
+  const robot_state::RobotState last = trajectory.getLastWayPoint();
+
+  const double period = 0.01;
+  trajectory_processing::TrajectoryResampler resampler(period);
+  ASSERT_TRUE(resampler.resample(trajectory));
+  printTrajectory(trajectory);
+
+  ASSERT_EQ(trajectory.getWayPointCount(), static_cast<std::size_t>(std::ceil(duration / period - 1e-9)) + 1);
+  for (std::size_t i = 1; i < trajectory.getWayPointCount(); ++i)
+    EXPECT_NEAR(trajectory.getWayPointDurationFromPrevious(i), period, 1e-12);
+
+  const std::vector<int>& idx = trajectory.getGroup()->getVariableIndexList();
+  for (std::size_t j = 0; j < idx.size(); ++j)
+  {
+    EXPECT_NEAR(trajectory.getFirstWayPoint().getVariablePosition(idx[j]), first.getVariablePosition(idx[j]), 1e-9);
+    EXPECT_NEAR(trajectory.getLastWayPoint().getVariablePosition(idx[j]), last.getVariablePosition(idx[j]), 1e-9);
+
+    const robot_model::VariableBounds& bounds = rmodel->getVariableBounds(rmodel->getVariableNames()[idx[j]]);
+    for (std::size_t i = 0; i < trajectory.getWayPointCount(); ++i)
+    {
+      const robot_state::RobotState& waypoint = trajectory.getWayPoint(i);
+      if (bounds.position_bounded_)
+      {
+        EXPECT_GE(waypoint.getVariablePosition(idx[j]), bounds.min_position_);
+        EXPECT_LE(waypoint.getVariablePosition(idx[j]), bounds.max_position_);
+      }
+      if (bounds.velocity_bounded_)
+        EXPECT_LE(std::fabs(waypoint.getVariableVelocity(idx[j])), bounds.max_velocity_ + 1e-9);
+    }
+  }
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -41,6 +41,8 @@
 #include <geometry_msgs/Pose.h>
 #include <Eigen/Geometry>
 #include <boost/noncopyable.hpp>
+#include <unordered_map>
+#include <vector>
 #include <moveit/macros/class_forward.h>
 
 namespace moveit
@@ -57,10 +59,17 @@ typedef std::map<std::string, Eigen::Affine3d, std::less<std::string>,
 
 /** @brief Provides an implementation of a snapshot of a transform tree that can be easily queried for
     transforming different quantities. Transforms are maintained as a list of transforms to a particular frame.
-    All stored transforms are considered fixed. */
+    All stored transforms are considered fixed.
+
+    Every frame that is ever set is interned: it receives a FrameId that stays valid for the lifetime of this object.
+    Callers that look up the same frame repeatedly can resolve it once with getFrameId() and then read its transform
+    from a flat table with the FrameId overloads of canTransform() and getTransform(). */
 class Transforms : private boost::noncopyable
 {
 public:
+  /** \brief The handle of an interned frame; negative values denote unknown frames */
+  typedef int FrameId;
+
   /**
    * @brief Construct a transform list
    */
@@ -194,9 +203,53 @@ public:
    */
   virtual const Eigen::Affine3d& getTransform(const std::string& from_frame) const;
 
+  /**
+   * \name Lookups by interned frame
+   */
+  /**@{*/
+
+  /**
+   * @brief Get the handle of \e frame (with or without the leading /), or -1 if no transform is known for it
+   */
+  FrameId getFrameId(const std::string& frame) const;
+
+  /**
+   * @brief Check whether a transform is currently stored for the frame with handle \e frame
+   */
+  bool canTransform(FrameId frame) const
+  {
+    return frame >= 0 && static_cast<std::size_t>(frame) < frame_known_.size() && frame_known_[frame];
+  }
+
+  /**
+   * @brief Get the stored transform of the frame with handle \e frame (w.r.t. the target frame), or identity if there
+   * is none. Unlike the string overload, this only considers the fixed transforms stored in this object.
+   */
+  const Eigen::Affine3d& getTransform(FrameId frame) const;
+
+  /**
+   * @brief Transform a pose in the frame with handle \e from_frame to the target_frame
+   */
+  void transformPose(FrameId from_frame, const Eigen::Affine3d& t_in, Eigen::Affine3d& t_out) const
+  {
+    t_out = getTransform(from_frame) * t_in;
+  }
+  /**@}*/
+
 protected:
+  /** \brief Store \e t as the transform of \e from_frame, which must start with / */
+  void storeTransform(const Eigen::Affine3d& t, const std::string& from_frame);
+
   std::string target_frame_;
   FixedTransformsMap transforms_;
+
+private:
+  /** \brief The handle of every frame ever stored, under its name both with and without the leading / */
+  std::unordered_map<std::string, FrameId> frame_ids_;
+
+  /** \brief The transform of each frame, indexed by handle, and whether it is currently set */
+  std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d> > frame_transforms_;
+  std::vector<char> frame_known_;
 };
 }
 }
@@ -38,6 +38,7 @@
 #include <eigen_conversions/eigen_msg.h>
 #include <boost/algorithm/string/trim.hpp>
 #include <ros/console.h>
+#include <algorithm>
 
 namespace moveit
 {
@@ -57,7 +58,7 @@ Transforms::Transforms(const std::string& target_frame) : target_frame_(target_f
                      target_frame_.c_str(), target_frame_.c_str());
       target_frame_ = '/' + target_frame_;
     }
-    transforms_[target_frame_] = Eigen::Affine3d::Identity();
+    storeTransform(Eigen::Affine3d::Identity(), target_frame_);
   }
 }
 
@@ -86,26 +87,60 @@ const FixedTransformsMap& Transforms::getAllTransforms() const
 
 void Transforms::setAllTransforms(const FixedTransformsMap& transforms)
 {
-  transforms_ = transforms;
+  // handles stay valid: frames that are not part of the new set are only marked unknown
+  transforms_.clear();
+  std::fill(frame_known_.begin(), frame_known_.end(), 0);
+  for (FixedTransformsMap::const_iterator it = transforms.begin(); it != transforms.end(); ++it)
+    if (!it->first.empty() && it->first[0] == '/')
+      storeTransform(it->second, it->first);
+    else if (!it->first.empty())
+      storeTransform(it->second, '/' + it->first);
+}
+
+void Transforms::storeTransform(const Eigen::Affine3d& t, const std::string& from_frame)
+{
+  transforms_[from_frame] = t;
+  std::unordered_map<std::string, FrameId>::const_iterator it = frame_ids_.find(from_frame);
+  if (it != frame_ids_.end())
+  {
+    frame_transforms_[it->second] = t;
+    frame_known_[it->second] = 1;
+    return;
+  }
+  FrameId id = frame_transforms_.size();
+  frame_transforms_.push_back(t);
+  frame_known_.push_back(1);
+  frame_ids_[from_frame] = id;
+  if (from_frame.size() > 1)
+    frame_ids_[from_frame.substr(1)] = id;
+}
+
+Transforms::FrameId Transforms::getFrameId(const std::string& frame) const
+{
+  std::unordered_map<std::string, FrameId>::const_iterator it = frame_ids_.find(frame);
+  return it != frame_ids_.end() && frame_known_[it->second] ? it->second : -1;
 }
 
 bool Transforms::isFixedFrame(const std::string& frame) const
 {
-  if (frame.empty())
-    return false;
-  else
-    return (frame[0] == '/' ? transforms_.find(frame) : transforms_.find('/' + frame)) != transforms_.end();
+  return getFrameId(frame) >= 0;
+}
+
+const Eigen::Affine3d& Transforms::getTransform(FrameId frame) const
+{
+  if (canTransform(frame))
+    return frame_transforms_[frame];
+  ROS_ERROR_NAMED("transforms", "Unable to transform from frame with id %d to frame '%s'. Returning identity.", frame,
+                  target_frame_.c_str());
+  static const Eigen::Affine3d identity = Eigen::Affine3d::Identity();
+  return identity;
 }
 
 const Eigen::Affine3d& Transforms::getTransform(const std::string& from_frame) const
 {
-  if (!from_frame.empty())
-  {
-    FixedTransformsMap::const_iterator it =
-        (from_frame[0] == '/' ? transforms_.find(from_frame) : transforms_.find('/' + from_frame));
-    if (it != transforms_.end())
-      return it->second;
-  }
+  FrameId id = getFrameId(from_frame);
+  if (id >= 0)
+    return frame_transforms_[id];
 
   ROS_ERROR_NAMED("transforms", "Unable to transform from frame '%s' to frame '%s'. Returning identity.",
                   from_frame.c_str(), target_frame_.c_str());
@@ -117,11 +152,7 @@ const Eigen::Affine3d& Transforms::getTransform(const std::string& from_frame) c
 
 bool Transforms::canTransform(const std::string& from_frame) const
 {
-  if (from_frame.empty())
-    return false;
-  else
-    return (from_frame[0] == '/' ? transforms_.find(from_frame) : transforms_.find('/' + from_frame)) !=
-           transforms_.end();
+  return getFrameId(from_frame) >= 0;
 }
 
 void Transforms::setTransform(const Eigen::Affine3d& t, const std::string& from_frame)
@@ -134,10 +165,10 @@ void Transforms::setTransform(const Eigen::Affine3d& t, const std::string& from_
     {
       ROS_WARN_NAMED("transforms", "Transform specified for frame '%s'. Assuming '/%s' instead", from_frame.c_str(),
                      from_frame.c_str());
-      transforms_['/' + from_frame] = t;
+      storeTransform(t, '/' + from_frame);
     }
     else
-      transforms_[from_frame] = t;
+      storeTransform(t, from_frame);
   }
 }
 
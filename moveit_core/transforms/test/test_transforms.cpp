@@ -61,6 +61,40 @@ TEST(Transforms, Simple)
   EXPECT_TRUE(tf.isFixedFrame("global"));
 }
 
+TEST(Transforms, FrameIds)
+{
+  moveit::core::Transforms tf("global");
+  EXPECT_EQ(tf.getFrameId("global"), tf.getFrameId("/global"));
+  EXPECT_TRUE(tf.canTransform(tf.getFrameId("global")));
+  EXPECT_LT(tf.getFrameId("unknown"), 0);
+  EXPECT_FALSE(tf.canTransform(tf.getFrameId("unknown")));
+
+  Eigen::Affine3d t1(Eigen::Translation3d(1.0, 2.0, 3.0));
+  tf.setTransform(t1, "/some_frame");
+  moveit::core::Transforms::FrameId id = tf.getFrameId("some_frame");
+  ASSERT_GE(id, 0);
+  EXPECT_EQ(id, tf.getFrameId("/some_frame"));
+  EXPECT_TRUE(tf.getTransform(id).isApprox(t1));
+
+  // the handle stays valid when the transform changes
+  Eigen::Affine3d t2(Eigen::Translation3d(-1.0, 0.0, 0.5));
+  tf.setTransform(t2, "/some_frame");
+  EXPECT_EQ(id, tf.getFrameId("some_frame"));
+  EXPECT_TRUE(tf.getTransform(id).isApprox(t2));
+  EXPECT_TRUE(tf.getTransform("some_frame").isApprox(t2));
+
+  // frames left out of a new set of transforms become unknown, but keep their handle
+  moveit::core::FixedTransformsMap transforms;
+  transforms["/global"] = Eigen::Affine3d::Identity();
+  tf.setAllTransforms(transforms);
+  EXPECT_FALSE(tf.canTransform(id));
+  EXPECT_FALSE(tf.canTransform("some_frame"));
+  transforms["/some_frame"] = t1;
+  tf.setAllTransforms(transforms);
+  EXPECT_TRUE(tf.canTransform(id));
+  EXPECT_TRUE(tf.getTransform(id).isApprox(t1));
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
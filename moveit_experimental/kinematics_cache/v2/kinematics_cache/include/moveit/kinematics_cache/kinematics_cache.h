@@ -43,6 +43,8 @@
 #include <moveit/robot_state/robot_state.h>
 
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 
 namespace kinematics_cache
 {
@@ -69,6 +71,15 @@ public:
    */
   bool generateCacheMap(double timeout);
 
+  /** @brief Generate the cache map with one thread for each of the given solvers, spending timeout (seconds) on the
+   * generation process. Solvers are not shared between threads, so each thread needs its own instance for the group
+   * of this cache.
+   *  @param timeout Time (in seconds) to be spent on generating the cache
+   *  @param solvers One kinematics solver for each generating thread
+   *  @return True if cache map generation was successful
+   */
+  bool generateCacheMap(double timeout, const std::vector<kinematics::KinematicsBaseConstPtr>& solvers);
+
   /** @brief Get a candidate solution for a particular pose. Note that the pose will be projected onto the grid used in
    * the caching process.
    *  @param pose The desired pose
@@ -137,6 +148,16 @@ public:
 
   bool readFromFile(const std::string& filename);
 
+  /** @brief Write the cache in a binary layout that mapFromBinaryFile() can map into memory without parsing */
+  bool writeToBinaryFile(const std::string& filename) const;
+
+  /** @brief Map a cache written by writeToBinaryFile(). The solutions are read from the mapped file until the cache is
+   * modified with addToCache(), which copies them into memory first. Several processes mapping the same file share
+   * its pages.
+   *  @return False if the file cannot be mapped, is not a cache for the group of the solver, or is inconsistent
+   */
+  bool mapFromBinaryFile(const std::string& filename);
+
   std::pair<double, double> getMinMaxSquaredDistance();
 
 private:
@@ -149,8 +170,15 @@ private:
   /** @brief Get the grid index for a given pose */
   bool getGridIndex(const geometry_msgs::Pose& pose, unsigned int& grid_index) const;
 
-  /** @brief Setup the cache */
-  void setup(const KinematicsCache::Options& opt);
+  /** @brief Setup the cache; the storage for the solutions is only allocated if \e allocate is true */
+  void setup(const KinematicsCache::Options& opt, bool allocate = true);
+
+  /** @brief Sample random states of the group and add their FK poses to the cache until \e end_time */
+  void generateCacheSamples(const kinematics::KinematicsBaseConstPtr& solver, const ros::WallTime& end_time,
+                            bool* success);
+
+  /** @brief Copy the solutions of a mapped file into memory so they can be modified */
+  void makeWritable();
 
   void updateDistances(const geometry_msgs::Pose& pose);
 
@@ -167,13 +195,17 @@ private:
   std::vector<double> kinematics_cache_vector_;    /** Storage for the solutions */
   std::vector<unsigned int> num_solutions_vector_; /** Storage for number of solutions for each grid location */
 
+  const double* solutions_;                          /** The solutions, in memory or in the mapped file */
+  const unsigned int* num_solutions_;                /** The number of solutions, in memory or in the mapped file */
+  boost::iostreams::mapped_file_source mapped_file_; /** The file the cache is mapped from, if any */
+
+  boost::mutex cache_lock_; /** Serializes additions to the cache while it is generated */
+
   kinematics::KinematicsBaseConstPtr kinematics_solver_; /** An instance of the kinematics solver */
 
   robot_model::RobotModelConstPtr kinematic_model_; /** An instance of the kinematic model */
-  robot_state::RobotStatePtr kinematic_state_;      /** An instance of the kinematic state */
 
   const robot_model::JointModelGroup* joint_model_group_; /** Joint model group associated with this cache */
-  boost::shared_ptr<robot_state::JointStateGroup> joint_state_group_; /** Joint state corresponding to cache */
 
   //    mutable std::vector<double> solution_local_; /** Local pre-allocated storage */
 
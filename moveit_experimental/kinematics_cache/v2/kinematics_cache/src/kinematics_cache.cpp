@@ -36,12 +36,48 @@
 *********************************************************************/
 
 #include <moveit/kinematics_cache/kinematics_cache.h>
+#include <boost/bind.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/thread.hpp>
+#include <stdint.h>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 
 namespace kinematics_cache
 {
-KinematicsCache::KinematicsCache() : min_squared_distance_(1e6), max_squared_distance_(0.0)
+namespace
+{
+/* The header of a binary cache file. It is followed by the group name, padded to a multiple of 8 bytes, the
+   solutions as doubles and the number of solutions of each grid location as 32 bit integers, all in the byte order of
+   the machine that wrote the file. */
+struct BinaryHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t group_name_size;
+  double origin[3];
+  double workspace_size[3];
+  double resolution[3];
+  uint32_t max_solutions_per_grid_location;
+  uint32_t solution_dimension;
+  uint64_t solution_values;
+  uint64_t grid_locations;
+  double min_squared_distance;
+  double max_squared_distance;
+};
+
+const char BINARY_MAGIC[8] = { 'M', 'V', 'I', 'T', 'K', 'C', 'A', 'C' };
+const uint32_t BINARY_VERSION = 1;
+
+std::size_t paddedSize(std::size_t size)
+{
+  return (size + 7) & ~std::size_t(7);
+}
+}
+
+KinematicsCache::KinematicsCache()
+  : solutions_(NULL), num_solutions_(NULL), min_squared_distance_(1e6), max_squared_distance_(0.0)
 {
 }
 
@@ -53,14 +89,12 @@ bool KinematicsCache::initialize(kinematics::KinematicsBaseConstPtr& kinematics_
   kinematics_solver_ = kinematics_solver;
   kinematic_model_ = kinematic_model;
   joint_model_group_ = kinematic_model_->getJointModelGroup(kinematics_solver_->getGroupName());
-  kinematic_state_.reset(new robot_state::RobotState(kinematic_model));
-  joint_state_group_.reset(new robot_state::JointStateGroup(kinematic_state_.get(), joint_model_group_));
 
   setup(opt);
   return true;
 }
 
-void KinematicsCache::setup(const KinematicsCache::Options& opt)
+void KinematicsCache::setup(const KinematicsCache::Options& opt, bool allocate)
 {
   cache_origin_ = opt.origin;
   cache_resolution_x_ = opt.resolution[0];
@@ -75,8 +109,15 @@ void KinematicsCache::setup(const KinematicsCache::Options& opt)
   size_grid_node_ = max_solutions_per_grid_location_ * solution_dimension_;
   kinematics_cache_size_ = cache_size_x_ * cache_size_y_ * cache_size_z_;
   kinematics_cache_points_with_solution_ = 0;
-  kinematics_cache_vector_.resize(kinematics_cache_size_ * size_grid_node_, 0.0);
-  num_solutions_vector_.resize(kinematics_cache_size_, 0);
+  if (allocate)
+  {
+    if (mapped_file_.is_open())
+      mapped_file_.close();
+    kinematics_cache_vector_.assign(kinematics_cache_size_ * size_grid_node_, 0.0);
+    num_solutions_vector_.assign(kinematics_cache_size_, 0);
+    solutions_ = kinematics_cache_vector_.data();
+    num_solutions_ = num_solutions_vector_.data();
+  }
   ROS_DEBUG_NAMED("kinematics_cache", "Origin: %f %f %f", cache_origin_.x, cache_origin_.y, cache_origin_.z);
   ROS_DEBUG_NAMED("kinematics_cache", "Cache size (num points x,y,z): %d %d %d", cache_size_x_, cache_size_y_,
                   cache_size_z_);
@@ -88,37 +129,92 @@ void KinematicsCache::setup(const KinematicsCache::Options& opt)
 
 bool KinematicsCache::generateCacheMap(double timeout)
 {
-  ros::WallTime start_time = ros::WallTime::now();
-  std::vector<std::string> fk_names;
-  std::vector<double> fk_values;
-  std::vector<geometry_msgs::Pose> poses;
-
-  fk_names.push_back(kinematics_solver_->getTipFrame());
-  fk_values.resize(kinematics_solver_->getJointNames().size(), 0.0);
-  poses.resize(1);
+  return generateCacheMap(timeout, std::vector<kinematics::KinematicsBaseConstPtr>(1, kinematics_solver_));
+}
 
-  while ((ros::WallTime::now() - start_time).toSec() <= timeout &&
-         kinematics_cache_points_with_solution_ <= kinematics_cache_size_)
+bool KinematicsCache::generateCacheMap(double timeout, const std::vector<kinematics::KinematicsBaseConstPtr>& solvers)
+{
+  if (solvers.empty())
   {
-    joint_state_group_->setToRandomValues();
-    joint_state_group_->getVariableValues(fk_values);
-    if (!kinematics_solver_->getPositionFK(fk_names, fk_values, poses))
+    ROS_ERROR_NAMED("kinematics_cache", "No kinematics solvers to generate the cache map with");
+    return false;
+  }
+  for (std::size_t i = 0; i < solvers.size(); ++i)
+    if (!solvers[i] || solvers[i]->getGroupName() != kinematics_solver_->getGroupName())
     {
-      ROS_ERROR_NAMED("kinematics_cache", "Fk failed");
+      ROS_ERROR_NAMED("kinematics_cache", "Solver %d is not a solver for group %s", (int)i,
+                      kinematics_solver_->getGroupName().c_str());
       return false;
     }
-    if (!addToCache(poses[0], fk_values))
-    {
-      ROS_DEBUG_NAMED("kinematics_cache", "Adding to cache failed for: %f %f %f", poses[0].position.x,
-                      poses[0].position.y, poses[0].position.z);
-    }
-    ROS_DEBUG_NAMED("kinematics_cache", "Adding: %d", kinematics_cache_points_with_solution_);
-  }
+
+  makeWritable();
+  ros::WallTime end_time = ros::WallTime::now() + ros::WallDuration(timeout);
+  boost::scoped_array<bool> success(new bool[solvers.size()]);
+  boost::thread_group threads;
+  for (std::size_t i = 1; i < solvers.size(); ++i)
+    threads.create_thread(
+        boost::bind(&KinematicsCache::generateCacheSamples, this, solvers[i], end_time, &success[i]));
+  generateCacheSamples(solvers[0], end_time, &success[0]);
+  threads.join_all();
+
   ROS_DEBUG_NAMED("kinematics_cache", "Cache map generated with %d valid points",
                   kinematics_cache_points_with_solution_);
+  for (std::size_t i = 0; i < solvers.size(); ++i)
+    if (!success[i])
+      return false;
   return true;
 }
 
+void KinematicsCache::generateCacheSamples(const kinematics::KinematicsBaseConstPtr& solver,
+                                           const ros::WallTime& end_time, bool* success)
+{
+  // the states are sampled and the FK computed without holding the lock; the results are added in batches
+  static const std::size_t BATCH_SIZE = 64;
+  robot_state::RobotState state(kinematic_model_);
+  std::vector<std::string> fk_names(1, solver->getTipFrame());
+  std::vector<double> fk_values;
+  std::vector<geometry_msgs::Pose> poses(1);
+  std::vector<geometry_msgs::Pose> batch_poses;
+  std::vector<std::vector<double> > batch_values;
+
+  *success = true;
+  bool done = false;
+  while (!done)
+  {
+    done = ros::WallTime::now() > end_time;
+    if (!done)
+    {
+      state.setToRandomPositions(joint_model_group_);
+      state.copyJointGroupPositions(joint_model_group_, fk_values);
+      if (!solver->getPositionFK(fk_names, fk_values, poses))
+      {
+        ROS_ERROR_NAMED("kinematics_cache", "Fk failed");
+        *success = false;
+        done = true;
+      }
+      else
+      {
+        batch_poses.push_back(poses[0]);
+        batch_values.push_back(fk_values);
+      }
+    }
+
+    if (batch_poses.size() >= BATCH_SIZE || (done && !batch_poses.empty()))
+    {
+      boost::mutex::scoped_lock slock(cache_lock_);
+      for (std::size_t i = 0; i < batch_poses.size(); ++i)
+        if (!addToCache(batch_poses[i], batch_values[i]))
+          ROS_DEBUG_NAMED("kinematics_cache", "Adding to cache failed for: %f %f %f", batch_poses[i].position.x,
+                          batch_poses[i].position.y, batch_poses[i].position.z);
+      ROS_DEBUG_NAMED("kinematics_cache", "Adding: %d", kinematics_cache_points_with_solution_);
+      if (kinematics_cache_points_with_solution_ > kinematics_cache_size_)
+        done = true;
+      batch_poses.clear();
+      batch_values.clear();
+    }
+  }
+}
+
 bool KinematicsCache::addToCache(const geometry_msgs::Pose& pose, const std::vector<double>& joint_values,
                                  bool overwrite)
 {
@@ -128,6 +224,7 @@ bool KinematicsCache::addToCache(const geometry_msgs::Pose& pose, const std::vec
     ROS_DEBUG_NAMED("kinematics_cache", "Failed to get grid index");
     return false;
   }
+  makeWritable();
   unsigned int num_solutions = num_solutions_vector_[grid_index];
   if (!overwrite && num_solutions >= max_solutions_per_grid_location_)
   {
@@ -185,7 +282,7 @@ bool KinematicsCache::getNumSolutions(const geometry_msgs::Pose& pose, unsigned
   if (!getGridIndex(pose, grid_index))
     return false;
 
-  num_solutions = num_solutions_vector_[grid_index];
+  num_solutions = num_solutions_[grid_index];
   return true;
 }
 
@@ -216,7 +313,7 @@ bool KinematicsCache::getSolutions(const geometry_msgs::Pose& pose, std::vector<
   unsigned int grid_index;
   if (!getGridIndex(pose, grid_index))
     return false;
-  if (solution.size() != num_solutions_vector_[grid_index])
+  if (solution.size() != num_solutions_[grid_index])
     return false;
   for (unsigned int i = 0; i < solution.size(); i++)
   {
@@ -232,7 +329,7 @@ std::vector<double> KinematicsCache::getSolution(unsigned int grid_index, unsign
   std::vector<double> solution_local(solution_dimension_);
   unsigned int solution_location = getSolutionLocation(grid_index, solution_index);
   for (unsigned int i = 0; i < solution_dimension_; ++i)
-    solution_local[i] = kinematics_cache_vector_[solution_location + i];
+    solution_local[i] = solutions_[solution_location + i];
   return solution_local;
 }
 
@@ -325,6 +422,8 @@ bool KinematicsCache::readFromFile(const std::string& filename)
 
   kinematics_cache_vector_ = kinematics_cache_vector;
   num_solutions_vector_ = num_solutions_vector;
+  solutions_ = kinematics_cache_vector_.data();
+  num_solutions_ = num_solutions_vector_.data();
   ROS_DEBUG_NAMED("kinematics_cache", "Read %d total points from file: %s", (int)num_solutions_vector_.size(),
                   filename.c_str());
   return true;
@@ -353,14 +452,13 @@ bool KinematicsCache::writeToFile(const std::string& filename)
     file << options_.max_solutions_per_grid_location << std::endl;
     file << min_squared_distance_ << std::endl;
     file << max_squared_distance_ << std::endl;
-    file << kinematics_cache_vector_.size() << std::endl;
-    std::copy(kinematics_cache_vector_.begin(), kinematics_cache_vector_.end(),
-              std::ostream_iterator<double>(file, " "));
+    std::size_t solution_values = kinematics_cache_size_ * size_grid_node_;
+    file << solution_values << std::endl;
+    std::copy(solutions_, solutions_ + solution_values, std::ostream_iterator<double>(file, " "));
     file << std::endl;
 
-    file << num_solutions_vector_.size() << std::endl;
-    std::copy(num_solutions_vector_.begin(), num_solutions_vector_.end(),
-              std::ostream_iterator<unsigned int>(file, " "));
+    file << kinematics_cache_size_ << std::endl;
+    std::copy(num_solutions_, num_solutions_ + kinematics_cache_size_, std::ostream_iterator<unsigned int>(file, " "));
     file << std::endl;
   }
 
@@ -368,6 +466,151 @@ bool KinematicsCache::writeToFile(const std::string& filename)
   return true;
 }
 
+bool KinematicsCache::writeToBinaryFile(const std::string& filename) const
+{
+  std::ofstream file(filename.c_str(), std::ios::binary | std::ios::trunc);
+  if (!file.is_open())
+  {
+    ROS_DEBUG_NAMED("kinematics_cache", "Could not open file: %s", filename.c_str());
+    return false;
+  }
+
+  const std::string& group_name = kinematics_solver_->getGroupName();
+  BinaryHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, BINARY_MAGIC, sizeof(header.magic));
+  header.version = BINARY_VERSION;
+  header.group_name_size = group_name.size();
+  header.origin[0] = options_.origin.x;
+  header.origin[1] = options_.origin.y;
+  header.origin[2] = options_.origin.z;
+  for (int i = 0; i < 3; ++i)
+  {
+    header.workspace_size[i] = options_.workspace_size[i];
+    header.resolution[i] = options_.resolution[i];
+  }
+  header.max_solutions_per_grid_location = max_solutions_per_grid_location_;
+  header.solution_dimension = solution_dimension_;
+  header.solution_values = (uint64_t)kinematics_cache_size_ * size_grid_node_;
+  header.grid_locations = kinematics_cache_size_;
+  header.min_squared_distance = min_squared_distance_;
+  header.max_squared_distance = max_squared_distance_;
+
+  std::string padded_name = group_name;
+  padded_name.resize(paddedSize(group_name.size()), '\0');
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(padded_name.data(), padded_name.size());
+  file.write(reinterpret_cast<const char*>(solutions_), header.solution_values * sizeof(double));
+  file.write(reinterpret_cast<const char*>(num_solutions_), header.grid_locations * sizeof(unsigned int));
+  ROS_DEBUG_NAMED("kinematics_cache", "Wrote %d total points to binary file: %s", (int)kinematics_cache_size_,
+                  filename.c_str());
+  return file.good();
+}
+
+bool KinematicsCache::mapFromBinaryFile(const std::string& filename)
+{
+  boost::iostreams::mapped_file_source mapped_file;
+  try
+  {
+    mapped_file.open(filename);
+  }
+  catch (std::exception& ex)
+  {
+    ROS_DEBUG_NAMED("kinematics_cache", "Could not map file %s: %s", filename.c_str(), ex.what());
+    return false;
+  }
+
+  if (mapped_file.size() < sizeof(BinaryHeader))
+  {
+    ROS_ERROR_NAMED("kinematics_cache", "File %s is too short to be a kinematics cache", filename.c_str());
+    return false;
+  }
+  BinaryHeader header;
+  std::memcpy(&header, mapped_file.data(), sizeof(header));
+  if (std::memcmp(header.magic, BINARY_MAGIC, sizeof(header.magic)) != 0 || header.version != BINARY_VERSION)
+  {
+    ROS_ERROR_NAMED("kinematics_cache", "File %s is not a binary kinematics cache of version %u", filename.c_str(),
+                    BINARY_VERSION);
+    return false;
+  }
+  std::size_t name_size = paddedSize(header.group_name_size);
+  if (mapped_file.size() < sizeof(header) + name_size)
+  {
+    ROS_ERROR_NAMED("kinematics_cache", "File %s is truncated", filename.c_str());
+    return false;
+  }
+  std::string group_name(mapped_file.data() + sizeof(header), header.group_name_size);
+  if (group_name != kinematics_solver_->getGroupName())
+  {
+    ROS_ERROR_NAMED("kinematics_cache", "Input file group name %s does not match solver group name %s",
+                    group_name.c_str(), kinematics_solver_->getGroupName().c_str());
+    return false;
+  }
+  if (header.solution_dimension != joint_model_group_->getVariableCount())
+  {
+    ROS_ERROR_NAMED("kinematics_cache", "Solutions in file %s have dimension %u instead of %u", filename.c_str(),
+                    header.solution_dimension, joint_model_group_->getVariableCount());
+    return false;
+  }
+
+  Options options;
+  options.origin.x = header.origin[0];
+  options.origin.y = header.origin[1];
+  options.origin.z = header.origin[2];
+  for (int i = 0; i < 3; ++i)
+  {
+    options.workspace_size[i] = header.workspace_size[i];
+    options.resolution[i] = header.resolution[i];
+  }
+  options.max_solutions_per_grid_location = header.max_solutions_per_grid_location;
+  Options previous_options = options_;
+  unsigned int previous_points_with_solution = kinematics_cache_points_with_solution_;
+  options_ = options;
+  setup(options_, false);
+
+  // the grid described by the header must be the one the data was written for
+  std::size_t expected_size = sizeof(header) + name_size + header.solution_values * sizeof(double) +
+                              header.grid_locations * sizeof(unsigned int);
+  if (header.grid_locations != kinematics_cache_size_ ||
+      header.solution_values != (uint64_t)kinematics_cache_size_ * size_grid_node_ ||
+      mapped_file.size() != expected_size)
+  {
+    ROS_ERROR_NAMED("kinematics_cache", "File %s does not match the grid it describes", filename.c_str());
+    // the storage was not touched, so the previous grid still describes it
+    options_ = previous_options;
+    setup(options_, false);
+    kinematics_cache_points_with_solution_ = previous_points_with_solution;
+    return false;
+  }
+
+  mapped_file_ = mapped_file;
+  solutions_ = reinterpret_cast<const double*>(mapped_file_.data() + sizeof(header) + name_size);
+  num_solutions_ = reinterpret_cast<const unsigned int*>(solutions_ + header.solution_values);
+  kinematics_cache_vector_.clear();
+  num_solutions_vector_.clear();
+  min_squared_distance_ = header.min_squared_distance;
+  max_squared_distance_ = header.max_squared_distance;
+  kinematics_cache_points_with_solution_ = 0;
+  for (unsigned int i = 0; i < kinematics_cache_size_; ++i)
+    if (num_solutions_[i] > 0)
+      ++kinematics_cache_points_with_solution_;
+
+  ROS_DEBUG_NAMED("kinematics_cache", "Mapped %d total points from binary file: %s", (int)kinematics_cache_size_,
+                  filename.c_str());
+  return true;
+}
+
+void KinematicsCache::makeWritable()
+{
+  if (!mapped_file_.is_open())
+    return;
+  kinematics_cache_vector_.assign(solutions_, solutions_ + kinematics_cache_size_ * size_grid_node_);
+  num_solutions_vector_.assign(num_solutions_, num_solutions_ + kinematics_cache_size_);
+  solutions_ = kinematics_cache_vector_.data();
+  num_solutions_ = num_solutions_vector_.data();
+  mapped_file_.close();
+}
+
 std::pair<double, double> KinematicsCache::getMinMaxSquaredDistance()
 {
   return std::pair<double, double>(min_squared_distance_, max_squared_distance_);
@@ -43,13 +43,19 @@
 #include <tf2/LinearMath/Quaternion.h>
 #include <moveit/cached_ik_kinematics_plugin/detail/NearestNeighborsGNAT.h>
 #include <boost/filesystem.hpp>
+#include <boost/thread/shared_mutex.hpp>
 #include <unordered_map>
 #include <mutex>
 #include <utility>
 
 namespace cached_ik_kinematics_plugin
 {
-/** \brief A cache of inverse kinematic solutions */
+/** \brief A cache of inverse kinematic solutions
+
+    Lookups only take a shared lock, so IK queries from several threads can
+    search the cache concurrently. New solutions are first collected in a
+    pending list and then added to the cache in batches, which keeps the
+    time spent holding the exclusive lock short. */
 class IKCache
 {
 public:
@@ -115,8 +121,21 @@ public:
 protected:
   /** compute the distance between two joint configurations */
   double configDistance2(const std::vector<double>& config1, const std::vector<double>& config2) const;
-  /** save current state of cache to disk */
+  /** save current state of cache to disk, including the nearest neighbor index */
   void saveCache() const;
+  /** map the cache file and read its entries; the nearest neighbor index is only rebuilt for files without one */
+  bool loadCache();
+  /** queue an entry for insertion, and insert the queued entries once a full batch is available */
+  void addEntry(IKEntry&& entry) const;
+  /** move all queued entries into the cache and the nearest neighbor data structure */
+  void flushPendingEntries() const;
+
+  /** number of new entries that are collected before they are inserted into the cache */
+  static const std::size_t INSERTION_BATCH_SIZE;
+  /** identifies cache files that store a nearest neighbor index after the entries */
+  static const unsigned int CACHE_FILE_MAGIC;
+  /** version of the cache file format */
+  static const unsigned int CACHE_FILE_VERSION;
 
   /** number of joints in the system */
   unsigned int num_joints_;
@@ -132,7 +151,7 @@ protected:
 
   /**
     the IK methods are declared const in the base class, but the
-    wrapped methods need to modify the cache, so the next four members
+    wrapped methods need to modify the cache, so the members below
     are mutable
     cache of IK solutions
   */
@@ -141,8 +160,17 @@ protected:
   mutable NearestNeighborsGNAT<IKEntry*> ik_nn_;
   /** size of the cache when it was last saved */
   mutable unsigned int last_saved_cache_size_{ 0 };
-  /** mutex for changing IK cache */
-  mutable std::mutex lock_;
+  /** shared for lookups, exclusive while entries are added to ik_cache_ and ik_nn_ */
+  mutable boost::shared_mutex nn_lock_;
+  /** serializes the threads that insert entries or save the cache */
+  mutable std::mutex flush_lock_;
+
+  /** entries waiting to be inserted into the cache */
+  mutable std::vector<IKEntry> pending_entries_;
+  /** number of entries in the cache, including the pending ones */
+  mutable unsigned int num_entries_{ 0 };
+  /** mutex for pending_entries_ and num_entries_ */
+  mutable std::mutex pending_lock_;
 };
 
 /** a container of IK caches for cases where there is no fixed base frame */
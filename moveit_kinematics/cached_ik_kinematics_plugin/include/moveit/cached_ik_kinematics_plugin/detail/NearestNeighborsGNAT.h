@@ -46,6 +46,11 @@
 #include <queue>
 #include <algorithm>
 #include <utility>
+#include <functional>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ostream>
 
 namespace cached_ik_kinematics_plugin
 {
@@ -253,6 +258,44 @@ public:
       tree_->list(*this, data);
   }
 
+  // \brief Write the structure of the tree to out, so that deserialize()
+  // can restore it without computing any distances. Elements are stored
+  // as the index returned by toIndex. This fails if any elements are
+  // marked for removal.
+  bool serialize(std::ostream& out, const std::function<std::uint64_t(const _T&)>& toIndex) const
+  {
+    if (!removed_.empty())
+      return false;
+    writeValue(out, static_cast<std::uint64_t>(size_));
+    writeValue(out, static_cast<std::uint64_t>(rebuildSize_));
+    writeValue(out, static_cast<std::uint8_t>(tree_ != nullptr));
+    if (tree_)
+      tree_->serialize(out, toIndex);
+    return out.good();
+  }
+
+  // \brief Replace the contents of this GNAT with a tree written by
+  // serialize(). The serialized tree is read from [data, end), and data is
+  // advanced past it on success. fromIndex maps a stored index back to an
+  // element and returns false if the index is invalid.
+  bool deserialize(const char*& data, const char* end, const std::function<bool(std::uint64_t, _T&)>& fromIndex)
+  {
+    const char* cursor = data;
+    std::uint64_t size, rebuild_size;
+    std::uint8_t has_tree;
+    if (!readValue(cursor, end, size) || !readValue(cursor, end, rebuild_size) || !readValue(cursor, end, has_tree))
+      return false;
+    Node* tree = nullptr;
+    if (has_tree && !(tree = Node::deserialize(*this, cursor, end, fromIndex)))
+      return false;
+    clear();
+    tree_ = tree;
+    size_ = size;
+    rebuildSize_ = rebuild_size;
+    data = cursor;
+    return true;
+  }
+
   // \brief Print a GNAT structure (mostly useful for debugging purposes).
   friend std::ostream& operator<<(std::ostream& out, const NearestNeighborsGNAT<_T>& gnat)
   {
@@ -308,6 +351,37 @@ public:
 protected:
   using GNAT = NearestNeighborsGNAT<_T>;
 
+  // Helpers for the binary format used by serialize() and deserialize()
+  template <typename V>
+  static void writeValue(std::ostream& out, const V& value)
+  {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(V));
+  }
+  template <typename V>
+  static bool readValue(const char*& data, const char* end, V& value)
+  {
+    if (end - data < static_cast<std::ptrdiff_t>(sizeof(V)))
+      return false;
+    std::memcpy(&value, data, sizeof(V));
+    data += sizeof(V);
+    return true;
+  }
+  static void writeVector(std::ostream& out, const std::vector<double>& values)
+  {
+    writeValue(out, static_cast<std::uint32_t>(values.size()));
+    out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(double));
+  }
+  static bool readVector(const char*& data, const char* end, std::vector<double>& values)
+  {
+    std::uint32_t count;
+    if (!readValue(data, end, count) || static_cast<std::size_t>(end - data) / sizeof(double) < count)
+      return false;
+    values.resize(count);
+    std::memcpy(values.data(), data, count * sizeof(double));
+    data += count * sizeof(double);
+    return true;
+  }
+
   // Return true iff data has been marked for removal.
   bool isRemoved(const _T& data) const
   {
@@ -641,6 +715,56 @@ protected:
         children_[i]->list(gnat, data);
     }
 
+    // Write this node and its subtree in preorder
+    void serialize(std::ostream& out, const std::function<std::uint64_t(const _T&)>& toIndex) const
+    {
+      writeValue(out, static_cast<std::uint32_t>(degree_));
+      writeValue(out, toIndex(pivot_));
+      writeValue(out, minRadius_);
+      writeValue(out, maxRadius_);
+      writeVector(out, minRange_);
+      writeVector(out, maxRange_);
+      writeValue(out, static_cast<std::uint32_t>(data_.size()));
+      for (unsigned int i = 0; i < data_.size(); ++i)
+        writeValue(out, toIndex(data_[i]));
+      writeValue(out, static_cast<std::uint32_t>(children_.size()));
+      for (unsigned int i = 0; i < children_.size(); ++i)
+        children_[i]->serialize(out, toIndex);
+    }
+
+    // Read a subtree written by serialize(); returns nullptr if the data is invalid
+    static Node* deserialize(const GNAT& gnat, const char*& data, const char* end,
+                             const std::function<bool(std::uint64_t, _T&)>& fromIndex)
+    {
+      std::uint32_t degree, count;
+      std::uint64_t index;
+      _T element;
+      if (!readValue(data, end, degree) || !readValue(data, end, index) || !fromIndex(index, element))
+        return nullptr;
+      std::unique_ptr<Node> node(new Node(degree, gnat.maxNumPtsPerLeaf_, element));
+      if (!readValue(data, end, node->minRadius_) || !readValue(data, end, node->maxRadius_) ||
+          !readVector(data, end, node->minRange_) || !readVector(data, end, node->maxRange_) ||
+          !readValue(data, end, count) || static_cast<std::size_t>(end - data) / sizeof(index) < count)
+        return nullptr;
+      for (std::uint32_t i = 0; i < count; ++i)
+      {
+        if (!readValue(data, end, index) || !fromIndex(index, element))
+          return nullptr;
+        node->data_.push_back(element);
+      }
+      if (!readValue(data, end, count))
+        return nullptr;
+      node->children_.reserve(count);
+      for (std::uint32_t i = 0; i < count; ++i)
+      {
+        Node* child = deserialize(gnat, data, end, fromIndex);
+        if (!child)
+          return nullptr;
+        node->children_.push_back(child);
+      }
+      return node.release();
+    }
+
     friend std::ostream& operator<<(std::ostream& out, const Node& node)
     {
       out << "\ndegree:\t" << node.degree_;
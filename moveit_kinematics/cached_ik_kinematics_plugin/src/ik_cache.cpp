@@ -35,6 +35,8 @@
 /* Author: Mark Moll */
 
 #include <boost/filesystem/fstream.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 #include <chrono>
 #include <cstdlib>
 #include <numeric>
@@ -43,6 +45,23 @@
 
 namespace cached_ik_kinematics_plugin
 {
+namespace
+{
+template <typename T>
+bool readValue(const char*& data, const char* end, T& value)
+{
+  if (end - data < static_cast<std::ptrdiff_t>(sizeof(T)))
+    return false;
+  memcpy(&value, data, sizeof(T));
+  data += sizeof(T);
+  return true;
+}
+}
+
+const std::size_t IKCache::INSERTION_BATCH_SIZE = 16;
+const unsigned int IKCache::CACHE_FILE_MAGIC = 0x43494b4d;  // "MKIC"
+const unsigned int IKCache::CACHE_FILE_VERSION = 2;
+
 IKCache::IKCache()
 {
   // set distance function for nearest-neighbor queries
@@ -56,6 +75,7 @@ IKCache::IKCache()
 
 IKCache::~IKCache()
 {
+  flushPendingEntries();
   if (!ik_cache_.empty())
     saveCache();
 }
@@ -72,7 +92,8 @@ void IKCache::initializeCache(const std::string& robot_description, const std::s
   std::string cached_ik_path = opts.cached_ik_path;
 
   // use mutex lock for rest of initialization
-  std::lock_guard<std::mutex> slock(lock_);
+  std::lock_guard<std::mutex> flock(flush_lock_);
+  boost::unique_lock<boost::shared_mutex> ulock(nn_lock_);
   // determine cache file name
   boost::filesystem::path prefix(!cached_ik_path.empty() ? cached_ik_path : boost::filesystem::current_path());
   // create cache directory if necessary
@@ -85,53 +106,18 @@ void IKCache::initializeCache(const std::string& robot_description, const std::s
   ik_cache_.clear();
   ik_nn_.clear();
   last_saved_cache_size_ = 0;
-  if (boost::filesystem::exists(cache_file_name_))
+  if (boost::filesystem::exists(cache_file_name_) && !loadCache())
   {
-    // read cache
-    boost::filesystem::ifstream cache_file(cache_file_name_, std::ios_base::binary | std::ios_base::in);
-    cache_file.read((char*)&last_saved_cache_size_, sizeof(unsigned int));
-    unsigned int num_dofs;
-    cache_file.read((char*)&num_dofs, sizeof(unsigned int));
-    unsigned int num_tips;
-    cache_file.read((char*)&num_tips, sizeof(unsigned int));
-
-    ROS_INFO_NAMED("cached_ik", "Found %d IK solutions for a %d-dof system with %d end effectors in %s",
-                   last_saved_cache_size_, num_dofs, num_tips, cache_file_name_.string().c_str());
-
-    unsigned int position_size = 3 * sizeof(tf2Scalar);
-    unsigned int orientation_size = 4 * sizeof(tf2Scalar);
-    unsigned int pose_size = position_size + orientation_size;
-    unsigned int config_size = num_dofs * sizeof(double);
-    unsigned int offset_conf = pose_size * num_tips;
-    unsigned int bufsize = offset_conf + config_size;
-    char* buffer = new char[bufsize];
-    IKEntry entry;
-    entry.first.resize(num_tips);
-    entry.second.resize(num_dofs);
-    ik_cache_.reserve(last_saved_cache_size_);
-
-    for (unsigned i = 0; i < last_saved_cache_size_; ++i)
-    {
-      unsigned int j = 0;
-      cache_file.read(buffer, bufsize);
-      for (auto& pose : entry.first)
-      {
-        memcpy(&pose.position[0], buffer + j * pose_size, position_size);
-        memcpy(&pose.orientation[0], buffer + j * pose_size + position_size, orientation_size);
-        ++j;
-      }
-      memcpy(&entry.second[0], buffer + offset_conf, config_size);
-      ik_cache_.push_back(entry);
-    }
-    ROS_INFO_NAMED("cached_ik", "freeing buffer");
-    delete buffer;
-    ROS_INFO_NAMED("cached_ik", "freed buffer");
-    std::vector<IKEntry*> ik_entry_ptrs(last_saved_cache_size_);
-    for (unsigned int i = 0; i < last_saved_cache_size_; ++i)
-      ik_entry_ptrs[i] = &ik_cache_[i];
-    ik_nn_.add(ik_entry_ptrs);
+    ik_cache_.clear();
+    ik_nn_.clear();
+    last_saved_cache_size_ = 0;
   }
 
+  {
+    std::lock_guard<std::mutex> plock(pending_lock_);
+    pending_entries_.clear();
+    num_entries_ = ik_cache_.size();
+  }
   num_joints_ = num_joints;
 
   ROS_INFO_NAMED("cached_ik", "cache file %s initialized!", cache_file_name_.string().c_str());
@@ -150,77 +136,206 @@ double IKCache::configDistance2(const std::vector<double>& config1, const std::v
 
 const IKCache::IKEntry& IKCache::getBestApproximateIKSolution(const Pose& pose) const
 {
+  IKEntry query = std::make_pair(std::vector<Pose>(1, pose), std::vector<double>());
+  // entries are never modified or moved once inserted (ik_cache_ is reserved to
+  // its maximum size), so the returned reference stays valid after unlocking
+  boost::shared_lock<boost::shared_mutex> slock(nn_lock_);
   if (ik_cache_.empty())
   {
     static IKEntry dummy = std::make_pair(std::vector<Pose>(1, pose), std::vector<double>(num_joints_, 0.));
     return dummy;
   }
-  IKEntry query = std::make_pair(std::vector<Pose>(1, pose), std::vector<double>());
   return *ik_nn_.nearest(&query);
 }
 
 const IKCache::IKEntry& IKCache::getBestApproximateIKSolution(const std::vector<Pose>& poses) const
 {
+  IKEntry query = std::make_pair(poses, std::vector<double>());
+  boost::shared_lock<boost::shared_mutex> slock(nn_lock_);
   if (ik_cache_.empty())
   {
     static IKEntry dummy = std::make_pair(poses, std::vector<double>(num_joints_, 0.));
     return dummy;
   }
-  IKEntry query = std::make_pair(poses, std::vector<double>());
   return *ik_nn_.nearest(&query);
 }
 
 void IKCache::updateCache(const IKEntry& nearest, const Pose& pose, const std::vector<double>& config) const
 {
-  if (ik_cache_.size() < ik_cache_.capacity() && (nearest.first[0].distance(pose) > min_pose_distance_ ||
-                                                  configDistance2(nearest.second, config) > min_config_distance2_))
-  {
-    std::lock_guard<std::mutex> slock(lock_);
-    ik_cache_.emplace_back(std::vector<Pose>(1u, pose), config);
-    ik_nn_.add(&ik_cache_.back());
-    if (ik_cache_.size() >= last_saved_cache_size_ + 500u || ik_cache_.size() == max_cache_size_)
-      saveCache();
-  }
+  if (nearest.first[0].distance(pose) > min_pose_distance_ ||
+      configDistance2(nearest.second, config) > min_config_distance2_)
+    addEntry(IKEntry(std::vector<Pose>(1u, pose), config));
 }
 
 void IKCache::updateCache(const IKEntry& nearest, const std::vector<Pose>& poses,
                           const std::vector<double>& config) const
 {
-  if (ik_cache_.size() < ik_cache_.capacity())
+  bool add_to_cache = configDistance2(nearest.second, config) > min_config_distance2_;
+  if (!add_to_cache)
   {
-    bool add_to_cache = configDistance2(nearest.second, config) > min_config_distance2_;
-    if (!add_to_cache)
+    double dist = 0.;
+    for (unsigned int i = 0; i < poses.size(); ++i)
     {
-      double dist = 0.;
-      for (unsigned int i = 0; i < poses.size(); ++i)
+      dist += nearest.first[i].distance(poses[i]);
+      if (dist > min_pose_distance_)
       {
-        dist += nearest.first[i].distance(poses[i]);
-        if (dist > min_pose_distance_)
-        {
-          add_to_cache = true;
-          break;
-        }
+        add_to_cache = true;
+        break;
       }
     }
-    if (add_to_cache)
+  }
+  if (add_to_cache)
+    addEntry(IKEntry(poses, config));
+}
+
+void IKCache::addEntry(IKEntry&& entry) const
+{
+  {
+    std::lock_guard<std::mutex> plock(pending_lock_);
+    if (num_entries_ >= max_cache_size_)
+      return;
+    ++num_entries_;
+    pending_entries_.push_back(std::move(entry));
+    if (pending_entries_.size() < INSERTION_BATCH_SIZE && num_entries_ < max_cache_size_)
+      return;
+  }
+  flushPendingEntries();
+}
+
+void IKCache::flushPendingEntries() const
+{
+  std::lock_guard<std::mutex> flock(flush_lock_);
+  std::vector<IKEntry> entries;
+  {
+    std::lock_guard<std::mutex> plock(pending_lock_);
+    entries.swap(pending_entries_);
+  }
+  if (entries.empty())
+    return;
+
+  std::vector<IKEntry*> entry_ptrs;
+  entry_ptrs.reserve(entries.size());
+  {
+    boost::unique_lock<boost::shared_mutex> ulock(nn_lock_);
+    for (auto& entry : entries)
     {
-      std::lock_guard<std::mutex> slock(lock_);
-      ik_cache_.emplace_back(poses, config);
-      ik_nn_.add(&ik_cache_.back());
-      if (ik_cache_.size() >= last_saved_cache_size_ + 500u || ik_cache_.size() == max_cache_size_)
-        saveCache();
+      ik_cache_.push_back(std::move(entry));
+      entry_ptrs.push_back(&ik_cache_.back());
     }
+    ik_nn_.add(entry_ptrs);
   }
+
+  // only threads holding flush_lock_ modify ik_cache_, so saving does not need to block lookups
+  if (ik_cache_.size() >= last_saved_cache_size_ + 500u || ik_cache_.size() == max_cache_size_)
+    saveCache();
+}
+
+bool IKCache::loadCache()
+{
+  // map the file rather than reading it: pages are loaded on demand and
+  // shared with other processes that use the same cache file
+  std::unique_ptr<boost::interprocess::mapped_region> region;
+  try
+  {
+    boost::interprocess::file_mapping mapping(cache_file_name_.string().c_str(), boost::interprocess::read_only);
+    region.reset(new boost::interprocess::mapped_region(mapping, boost::interprocess::read_only));
+  }
+  catch (boost::interprocess::interprocess_exception& ex)
+  {
+    ROS_ERROR_NAMED("cached_ik", "Unable to map %s: %s", cache_file_name_.string().c_str(), ex.what());
+    return false;
+  }
+  const char* data = static_cast<const char*>(region->get_address());
+  const char* end = data + region->get_size();
+
+  // files written before the nearest neighbor index was stored start with the number of entries
+  unsigned int magic = 0, version = 0;
+  bool indexed = readValue(data, end, magic) && magic == CACHE_FILE_MAGIC;
+  if (indexed && (!readValue(data, end, version) || version != CACHE_FILE_VERSION))
+  {
+    ROS_ERROR_NAMED("cached_ik", "Unsupported version %u of cache file %s", version, cache_file_name_.string().c_str());
+    return false;
+  }
+  if (!indexed)
+    data = static_cast<const char*>(region->get_address());
+
+  unsigned int num_dofs, num_tips;
+  if (!readValue(data, end, last_saved_cache_size_) || !readValue(data, end, num_dofs) ||
+      !readValue(data, end, num_tips))
+  {
+    ROS_ERROR_NAMED("cached_ik", "Cache file %s is truncated", cache_file_name_.string().c_str());
+    return false;
+  }
+
+  ROS_INFO_NAMED("cached_ik", "Found %d IK solutions for a %d-dof system with %d end effectors in %s",
+                 last_saved_cache_size_, num_dofs, num_tips, cache_file_name_.string().c_str());
+
+  unsigned int position_size = 3 * sizeof(tf2Scalar);
+  unsigned int orientation_size = 4 * sizeof(tf2Scalar);
+  unsigned int pose_size = position_size + orientation_size;
+  unsigned int config_size = num_dofs * sizeof(double);
+  unsigned int offset_conf = pose_size * num_tips;
+  unsigned int bufsize = offset_conf + config_size;
+  if (bufsize == 0 || static_cast<std::size_t>(end - data) / bufsize < last_saved_cache_size_)
+  {
+    ROS_ERROR_NAMED("cached_ik", "Cache file %s is truncated", cache_file_name_.string().c_str());
+    return false;
+  }
+
+  IKEntry entry;
+  entry.first.resize(num_tips);
+  entry.second.resize(num_dofs);
+  ik_cache_.reserve(last_saved_cache_size_);
+  for (unsigned i = 0; i < last_saved_cache_size_; ++i, data += bufsize)
+  {
+    unsigned int j = 0;
+    for (auto& pose : entry.first)
+    {
+      memcpy(&pose.position[0], data + j * pose_size, position_size);
+      memcpy(&pose.orientation[0], data + j * pose_size + position_size, orientation_size);
+      ++j;
+    }
+    memcpy(&entry.second[0], data + offset_conf, config_size);
+    ik_cache_.push_back(entry);
+  }
+
+  // restore the stored nearest neighbor index; only rebuild it for old or damaged files
+  bool restored =
+      indexed && ik_nn_.deserialize(data, end, [this](std::uint64_t index, IKEntry*& entry) {
+        if (index >= ik_cache_.size())
+          return false;
+        entry = &ik_cache_[index];
+        return true;
+      }) && ik_nn_.size() == ik_cache_.size();
+  if (!restored)
+  {
+    if (indexed)
+      ROS_WARN_NAMED("cached_ik", "Invalid nearest neighbor index in %s, rebuilding it",
+                     cache_file_name_.string().c_str());
+    std::vector<IKEntry*> ik_entry_ptrs(last_saved_cache_size_);
+    for (unsigned int i = 0; i < last_saved_cache_size_; ++i)
+      ik_entry_ptrs[i] = &ik_cache_[i];
+    ik_nn_.clear();
+    ik_nn_.add(ik_entry_ptrs);
+  }
+  return true;
 }
 
 void IKCache::saveCache() const
 {
   if (cache_file_name_.empty())
+  {
     ROS_ERROR_NAMED("cached_ik", "can't save cache before initialization");
+    return;
+  }
 
   ROS_INFO_NAMED("cached_ik", "writing %ld IK solutions to %s", ik_cache_.size(), cache_file_name_.string().c_str());
 
-  boost::filesystem::ofstream cache_file(cache_file_name_, std::ios_base::binary | std::ios_base::out);
+  // write to a temporary file that then replaces the cache file, so that
+  // processes that currently have the old file mapped are not affected
+  boost::filesystem::path tmp_file_name =
+      cache_file_name_.parent_path() / boost::filesystem::unique_path(cache_file_name_.filename().string() + ".%%%%%%");
+  boost::filesystem::ofstream cache_file(tmp_file_name, std::ios_base::binary | std::ios_base::out);
   unsigned int position_size = 3 * sizeof(tf2Scalar);
   unsigned int orientation_size = 4 * sizeof(tf2Scalar);
   unsigned int pose_size = position_size + orientation_size;
@@ -228,9 +343,11 @@ void IKCache::saveCache() const
   unsigned int config_size = ik_cache_[0].second.size() * sizeof(double);
   unsigned int offset_conf = num_tips * pose_size;
   unsigned int bufsize = offset_conf + config_size;
-  char* buffer = new char[bufsize];
+  std::vector<char> buffer(bufsize);
 
-  // write number of IK entries and size of each configuration first
+  // write the format, the number of IK entries and the size of each entry first
+  cache_file.write((const char*)&CACHE_FILE_MAGIC, sizeof(unsigned int));
+  cache_file.write((const char*)&CACHE_FILE_VERSION, sizeof(unsigned int));
   last_saved_cache_size_ = ik_cache_.size();
   cache_file.write((char*)&last_saved_cache_size_, sizeof(unsigned int));
   unsigned int sz = ik_cache_[0].second.size();
@@ -240,13 +357,30 @@ void IKCache::saveCache() const
   {
     for (unsigned int i = 0; i < num_tips; ++i)
     {
-      memcpy(buffer + i * pose_size, &entry.first[i].position[0], position_size);
-      memcpy(buffer + i * pose_size + position_size, &entry.first[i].orientation[0], orientation_size);
+      memcpy(&buffer[i * pose_size], &entry.first[i].position[0], position_size);
+      memcpy(&buffer[i * pose_size + position_size], &entry.first[i].orientation[0], orientation_size);
     }
-    memcpy(buffer + offset_conf, &entry.second[0], config_size);
-    cache_file.write(buffer, bufsize);
+    memcpy(&buffer[offset_conf], &entry.second[0], config_size);
+    cache_file.write(&buffer[0], bufsize);
+  }
+
+  // followed by the nearest neighbor index, so it does not need to be rebuilt when loading
+  const IKEntry* first = &ik_cache_[0];
+  ik_nn_.serialize(cache_file, [first](IKEntry* const& entry) { return static_cast<std::uint64_t>(entry - first); });
+  cache_file.close();
+
+  boost::system::error_code ec;
+  if (cache_file.fail())
+    ROS_ERROR_NAMED("cached_ik", "Failed to write %s", tmp_file_name.string().c_str());
+  else
+    boost::filesystem::rename(tmp_file_name, cache_file_name_, ec);
+  if (cache_file.fail() || ec)
+  {
+    if (ec)
+      ROS_ERROR_NAMED("cached_ik", "Failed to replace %s: %s", cache_file_name_.string().c_str(),
+                      ec.message().c_str());
+    boost::filesystem::remove(tmp_file_name, ec);
   }
-  delete buffer;
 }
 
 void IKCache::verifyCache(kdl_kinematics_plugin::KDLKinematicsPlugin& fk) const
@@ -255,6 +389,7 @@ void IKCache::verifyCache(kdl_kinematics_plugin::KDLKinematicsPlugin& fk) const
   std::vector<geometry_msgs::Pose> poses(tip_names.size());
   double error, max_error = 0.;
 
+  boost::shared_lock<boost::shared_mutex> slock(nn_lock_);
   for (const auto& entry : ik_cache_)
   {
     fk.getPositionFK(tip_names, entry.second, poses);
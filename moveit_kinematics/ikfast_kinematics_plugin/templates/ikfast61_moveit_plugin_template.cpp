@@ -50,6 +50,8 @@
 #include <moveit/kinematics_base/kinematics_base.h>
 #include <urdf/model.h>
 #include <tf_conversions/tf_kdl.h>
+#include <array>
+#include <limits>
 
 // Need a floating point tolerance when checking joint limits, in case the joint starts at limit
 const double LIMIT_TOLERANCE = .0000001;
@@ -217,6 +219,23 @@ public:
                      std::vector<std::vector<double>>& solutions, kinematics::KinematicsResult& result,
                      const kinematics::KinematicsQueryOptions& options) const;
 
+  /**
+   * @brief Solve the IK for a sequence of end-effector poses, e.g. the waypoints of a Cartesian path or the cells of
+   * a reachability map.
+   *
+   * Every pose gets the limit-obeying solution closest to its seed. With @a chain_seeds the solution of the last
+   * reachable pose seeds the next one, which keeps consecutive waypoints on the same IK branch.
+   * @param ik_poses the desired poses of the tip link
+   * @param ik_seed_state an initial guess solution for the first pose
+   * @param solutions one entry per pose, only meaningful where @a found is true
+   * @param found one entry per pose, true if a valid solution was found for it
+   * @param chain_seeds seed each pose with the previous solution instead of @a ik_seed_state
+   * @return The number of poses for which a valid solution was found
+   */
+  std::size_t getPositionIKBatch(const std::vector<geometry_msgs::Pose>& ik_poses,
+                                 const std::vector<double>& ik_seed_state, std::vector<std::vector<double>>& solutions,
+                                 std::vector<bool>& found, bool chain_seeds = true) const;
+
   /**
    * @brief Given a desired pose of the end-effector, search for the joint angles required to reach it.
    * This particular method is intended for "searching" for a solutions by stepping through the redundancy
@@ -323,6 +342,25 @@ private:
   // void getOrderedSolutions(const std::vector<double> &ik_seed_state, std::vector<std::vector<double> >& solslist);
   void getClosestSolution(const IkSolutionList<IkReal>& solutions, const std::vector<double>& ik_seed_state,
                           std::vector<double>& solution) const;
+
+  /**
+   * @brief Picks the solution that obeys the joint limits and is closest to @a ik_seed_state, unwrapping joints by
+   * 360° towards the seed on the way. Solutions no closer than @a min_dist are rejected, which lets several solution
+   * sets share one running minimum; @a min_dist is updated when a closer solution is found.
+   * @return True if @a solution was set
+   */
+  bool getClosestValidSolution(const IkSolutionList<IkReal>& solutions, const std::vector<double>& ik_seed_state,
+                               std::vector<double>& solution, double& min_dist) const;
+
+  /**
+   * @brief Implementation of getClosestValidSolution() on caller-provided scratch storage. For std::array the joint
+   * loops have a compile-time trip count and no heap allocation takes place per solution.
+   */
+  template <typename JointValues>
+  bool getClosestValidSolution(const IkSolutionList<IkReal>& solutions, const std::vector<double>& ik_seed_state,
+                               JointValues& sol, JointValues& best, JointValues& free_values,
+                               std::vector<double>& solution, double& min_dist) const;
+
   void fillFreeParams(int count, int* array);
   bool getCount(int& count, const int& max_count, const int& min_count) const;
 
@@ -726,6 +764,94 @@ void IKFastKinematicsPlugin::getClosestSolution(const IkSolutionList<IkReal>& so
   }
 }
 
+bool IKFastKinematicsPlugin::getClosestValidSolution(const IkSolutionList<IkReal>& solutions,
+                                                     const std::vector<double>& ik_seed_state,
+                                                     std::vector<double>& solution, double& min_dist) const
+{
+  // Most arms have 6 or 7 joints; dispatch those to fixed-size storage so the joint loops are unrolled
+  switch (num_joints_)
+  {
+    case 6:
+    {
+      std::array<IkReal, 6> sol, best, free_values;
+      return getClosestValidSolution(solutions, ik_seed_state, sol, best, free_values, solution, min_dist);
+    }
+    case 7:
+    {
+      std::array<IkReal, 7> sol, best, free_values;
+      return getClosestValidSolution(solutions, ik_seed_state, sol, best, free_values, solution, min_dist);
+    }
+    default:
+    {
+      std::vector<IkReal> sol(num_joints_), best(num_joints_), free_values(num_joints_);
+      return getClosestValidSolution(solutions, ik_seed_state, sol, best, free_values, solution, min_dist);
+    }
+  }
+}
+
+template <typename JointValues>
+bool IKFastKinematicsPlugin::getClosestValidSolution(const IkSolutionList<IkReal>& solutions,
+                                                     const std::vector<double>& ik_seed_state, JointValues& sol,
+                                                     JointValues& best, JointValues& free_values,
+                                                     std::vector<double>& solution, double& min_dist) const
+{
+  // IKFast never reports more free parameters than joints; like getSolution(), they are evaluated at zero
+  std::fill(free_values.begin(), free_values.end(), 0.0);
+
+  bool found = false;
+  const std::size_t numsol = solutions.GetNumSolutions();
+  for (std::size_t s = 0; s < numsol; ++s)
+  {
+    // IKFast56/61
+    solutions.GetSolution(s).GetSolution(sol.data(), free_values.data());
+
+    double dist_from_seed = 0.0;
+    bool valid = true;
+    for (std::size_t i = 0; i < sol.size(); ++i)
+    {
+      if (joint_has_limits_vector_[i])
+      {
+        // rotate joints by +/-360° where it is possible and useful, see getSolution()
+        double signed_distance = sol[i] - ik_seed_state[i];
+        while (signed_distance > M_PI && sol[i] - 2 * M_PI > (joint_min_vector_[i] - LIMIT_TOLERANCE))
+        {
+          signed_distance -= 2 * M_PI;
+          sol[i] -= 2 * M_PI;
+        }
+        while (signed_distance < -M_PI && sol[i] + 2 * M_PI < (joint_max_vector_[i] + LIMIT_TOLERANCE))
+        {
+          signed_distance += 2 * M_PI;
+          sol[i] += 2 * M_PI;
+        }
+        // Add tolerance to limit check
+        if (sol[i] < (joint_min_vector_[i] - LIMIT_TOLERANCE) || sol[i] > (joint_max_vector_[i] + LIMIT_TOLERANCE))
+        {
+          valid = false;
+          break;
+        }
+      }
+      dist_from_seed += fabs(ik_seed_state[i] - sol[i]);
+      // no need to finish a solution that cannot beat the best one anymore
+      if (dist_from_seed >= min_dist)
+      {
+        valid = false;
+        break;
+      }
+    }
+
+    if (valid)
+    {
+      best = sol;
+      min_dist = dist_from_seed;
+      found = true;
+    }
+  }
+
+  if (found)
+    solution.assign(best.begin(), best.end());
+  return found;
+}
+
 void IKFastKinematicsPlugin::fillFreeParams(int count, int* array)
 {
   free_params_.clear();
@@ -1142,61 +1268,14 @@ bool IKFastKinematicsPlugin::getPositionIK(const geometry_msgs::Pose& ik_pose, c
   int numsol = solve(frame, vfree, solutions);
   ROS_DEBUG_STREAM_NAMED(name_, "Found " << numsol << " solutions from IKFast");
 
-  std::vector<LimitObeyingSol> solutions_obey_limits;
-
-  if (numsol)
+  double min_dist = std::numeric_limits<double>::max();
+  if (numsol && getClosestValidSolution(solutions, ik_seed_state, solution, min_dist))
   {
-    std::vector<double> solution_obey_limits;
-    for (std::size_t s = 0; s < numsol; ++s)
-    {
-      std::vector<double> sol;
-      getSolution(solutions, ik_seed_state, s, sol);
-      ROS_DEBUG_NAMED(name_, "Sol %d: %e   %e   %e   %e   %e   %e", (int)s, sol[0], sol[1], sol[2], sol[3], sol[4],
-                      sol[5]);
-
-      bool obeys_limits = true;
-      for (std::size_t i = 0; i < sol.size(); i++)
-      {
-        // Add tolerance to limit check
-        if (joint_has_limits_vector_[i] && ((sol[i] < (joint_min_vector_[i] - LIMIT_TOLERANCE)) ||
-                                            (sol[i] > (joint_max_vector_[i] + LIMIT_TOLERANCE))))
-        {
-          // One element of solution is not within limits
-          obeys_limits = false;
-          ROS_DEBUG_STREAM_NAMED(name_, "Not in limits! " << (int)i << " value " << sol[i] << " has limit: "
-                                                          << joint_has_limits_vector_[i] << "  being  "
-                                                          << joint_min_vector_[i] << " to " << joint_max_vector_[i]);
-          break;
-        }
-      }
-      if (obeys_limits)
-      {
-        // All elements of this solution obey limits
-        getSolution(solutions, ik_seed_state, s, solution_obey_limits);
-        double dist_from_seed = 0.0;
-        for (std::size_t i = 0; i < ik_seed_state.size(); ++i)
-        {
-          dist_from_seed += fabs(ik_seed_state[i] - solution_obey_limits[i]);
-        }
-
-        solutions_obey_limits.push_back({ solution_obey_limits, dist_from_seed });
-      }
-    }
-  }
-  else
-  {
-    ROS_DEBUG_STREAM_NAMED(name_, "No IK solution");
-  }
-
-  // Sort the solutions under limits and find the one that is closest to ik_seed_state
-  if (!solutions_obey_limits.empty())
-  {
-    std::sort(solutions_obey_limits.begin(), solutions_obey_limits.end());
-    solution = solutions_obey_limits[0].value;
     error_code.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
     return true;
   }
 
+  ROS_DEBUG_STREAM_NAMED(name_, "No IK solution within joint limits");
   error_code.val = moveit_msgs::MoveItErrorCodes::NO_IK_SOLUTION;
   return false;
 }
@@ -1344,6 +1423,56 @@ bool IKFastKinematicsPlugin::getPositionIK(const std::vector<geometry_msgs::Pose
   return false;
 }
 
+std::size_t IKFastKinematicsPlugin::getPositionIKBatch(const std::vector<geometry_msgs::Pose>& ik_poses,
+                                                      const std::vector<double>& ik_seed_state,
+                                                      std::vector<std::vector<double>>& solutions,
+                                                      std::vector<bool>& found, bool chain_seeds) const
+{
+  ROS_DEBUG_STREAM_NAMED(name_, "getPositionIKBatch for " << ik_poses.size() << " poses");
+
+  solutions.resize(ik_poses.size());
+  found.assign(ik_poses.size(), false);
+
+  if (!active_)
+  {
+    ROS_ERROR("kinematics not active");
+    return 0;
+  }
+
+  if (ik_seed_state.size() < num_joints_)
+  {
+    ROS_ERROR_STREAM("ik_seed_state only has " << ik_seed_state.size() << " entries, this ikfast solver requires "
+                                               << num_joints_);
+    return 0;
+  }
+
+  // scratch buffers are shared by all poses
+  std::vector<double> seed(ik_seed_state.begin(), ik_seed_state.begin() + num_joints_);
+  std::vector<double> vfree(free_params_.size());
+  IkSolutionList<IkReal> ik_solutions;
+  KDL::Frame frame;
+  std::size_t num_found = 0;
+
+  for (std::size_t p = 0; p < ik_poses.size(); ++p)
+  {
+    for (std::size_t i = 0; i < free_params_.size(); ++i)
+      vfree[i] = seed[free_params_[i]];
+
+    tf::poseMsgToKDL(ik_poses[p], frame);
+    double min_dist = std::numeric_limits<double>::max();
+    if (solve(frame, vfree, ik_solutions) > 0 && getClosestValidSolution(ik_solutions, seed, solutions[p], min_dist))
+    {
+      found[p] = true;
+      ++num_found;
+      if (chain_seeds)
+        seed = solutions[p];
+    }
+  }
+
+  ROS_DEBUG_STREAM_NAMED(name_, "Found IK solutions for " << num_found << " of " << ik_poses.size() << " poses");
+  return num_found;
+}
+
 bool IKFastKinematicsPlugin::sampleRedundantJoint(kinematics::DiscretizationMethod method,
                                                   std::vector<double>& sampled_joint_vals) const
 {
@@ -136,6 +136,7 @@ private:
   Eigen::VectorXd S_translate;
   Eigen::MatrixXd V_translate;
   Eigen::VectorXd tmp_translate;
+  Eigen::MatrixXd jac_translate;  // translational rows of jac_reduced, kept so the SVD input is not a temporary
 
   // This is the jacobian when the redundant joint is "locked" and plays no part
   Jacobian jac_locked;
@@ -164,6 +165,7 @@ private:
   Eigen::VectorXd S_translate_locked;
   Eigen::MatrixXd V_translate_locked;
   Eigen::VectorXd tmp_translate_locked;
+  Eigen::MatrixXd jac_translate_locked;
 
   // Internal storage for a map from the "locked" state to the full active state
   std::vector<unsigned int> locked_joints_map_index;
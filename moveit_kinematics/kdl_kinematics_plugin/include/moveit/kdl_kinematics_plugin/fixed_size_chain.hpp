@@ -0,0 +1,442 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#ifndef MOVEIT_KDL_KINEMATICS_PLUGIN_FIXED_SIZE_CHAIN_
+#define MOVEIT_KDL_KINEMATICS_PLUGIN_FIXED_SIZE_CHAIN_
+
+#include <kdl/chain.hpp>
+#include <kdl/frames.hpp>
+#include <kdl/jntarray.hpp>
+#include <Eigen/Geometry>
+#include <Eigen/SVD>
+#include <Eigen/Cholesky>
+#include <array>
+#include <cmath>
+#include <memory>
+
+namespace kdl_kinematics_plugin
+{
+/** \brief Position IK solver for a chain whose number of joints is fixed at compile time. All the intermediate
+    quantities are fixed-size Eigen types, so an IK query performs no heap allocations. CartToJnt() follows the
+    conventions of the KDL position solvers: it returns 0 on success and a negative value on failure. */
+class FixedSizeChainIKSolver
+{
+public:
+  enum Method
+  {
+    /** Newton-Raphson iterations with a pseudo-inverse step, clamped to the joint limits after every step */
+    NEWTON_RAPHSON,
+    /** Levenberg-Marquardt on the weighted pose error; solutions outside the joint limits are rejected */
+    LEVENBERG_MARQUARDT
+  };
+
+  virtual ~FixedSizeChainIKSolver()
+  {
+  }
+
+  virtual int CartToJnt(const KDL::JntArray& q_init, const KDL::Frame& p_in, KDL::JntArray& q_out) const = 0;
+};
+
+/** \brief Forward kinematics and Jacobian of a KDL::Chain with DOF joints.
+
+    The chain is flattened at construction into one fixed transform and one screw motion per joint, so evaluating
+    it never touches the KDL segment objects. Fixed segments are folded into the neighbouring transforms. */
+template <int DOF>
+class FixedSizeChain
+{
+public:
+  typedef Eigen::Matrix<double, DOF, 1> JointVector;
+  typedef Eigen::Matrix<double, 6, DOF> Jacobian;
+
+  /** \brief A rigid transform stored as a plain rotation matrix and translation, which have no alignment
+      requirements and can be kept in containers */
+  struct Transform
+  {
+    Eigen::Matrix3d rotation;
+    Eigen::Vector3d translation;
+
+    static Transform identity()
+    {
+      Transform t;
+      t.rotation.setIdentity();
+      t.translation.setZero();
+      return t;
+    }
+    Transform operator*(const Transform& other) const
+    {
+      Transform t;
+      t.rotation = rotation * other.rotation;
+      t.translation = rotation * other.translation + translation;
+      return t;
+    }
+  };
+
+  static Transform fromKDL(const KDL::Frame& frame)
+  {
+    Transform t;
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+      for (unsigned int j = 0; j < 3; ++j)
+        t.rotation(i, j) = frame.M(i, j);
+      t.translation(i) = frame.p(i);
+    }
+    return t;
+  }
+
+  /** \brief Flatten \e chain. Returns false if it does not have DOF joints, or if one of its joints is not a plain
+      revolute or prismatic joint (e.g. a scaled joint) */
+  bool init(const KDL::Chain& chain)
+  {
+    if (chain.getNrOfJoints() != DOF)
+      return false;
+    Transform pending = Transform::identity();
+    unsigned int j = 0;
+    for (unsigned int s = 0; s < chain.getNrOfSegments(); ++s)
+    {
+      const KDL::Segment& segment = chain.getSegment(s);
+      const KDL::Joint& joint = segment.getJoint();
+      if (joint.getType() == KDL::Joint::None)
+      {
+        pending = pending * fromKDL(segment.pose(0.0));
+        continue;
+      }
+
+      JointData& data = joints_[j++];
+      data.before = pending;
+      data.axis = Eigen::Vector3d(joint.JointAxis().x(), joint.JointAxis().y(), joint.JointAxis().z()).normalized();
+      data.origin = Eigen::Vector3d(joint.JointOrigin().x(), joint.JointOrigin().y(), joint.JointOrigin().z());
+      switch (joint.getType())
+      {
+        case KDL::Joint::RotAxis:
+        case KDL::Joint::RotX:
+        case KDL::Joint::RotY:
+        case KDL::Joint::RotZ:
+          data.revolute = true;
+          break;
+        case KDL::Joint::TransAxis:
+        case KDL::Joint::TransX:
+        case KDL::Joint::TransY:
+        case KDL::Joint::TransZ:
+          data.revolute = false;
+          break;
+        default:
+          return false;
+      }
+
+      // segment.pose(q) == screw(q) * segment.pose(0) must hold for the flattened chain to be exact
+      Transform expected = fromKDL(segment.pose(1.0));
+      Transform actual = screw(data, 1.0) * fromKDL(segment.pose(0.0));
+      if (!expected.rotation.isApprox(actual.rotation, 1e-9) ||
+          (expected.translation - actual.translation).norm() > 1e-9)
+        return false;
+      pending = fromKDL(segment.pose(0.0));
+    }
+    tail_ = pending;
+    return true;
+  }
+
+  /** \brief Compute the pose of the tip */
+  void fk(const JointVector& q, Transform& pose) const
+  {
+    pose = Transform::identity();
+    for (unsigned int j = 0; j < DOF; ++j)
+      pose = pose * joints_[j].before * screw(joints_[j], q(j));
+    pose = pose * tail_;
+  }
+
+  /** \brief Compute the pose of the tip and the Jacobian expressed in the base frame, with the tip as reference
+      point (the same convention as KDL::ChainJntToJacSolver). Rows 0-2 are linear, rows 3-5 angular */
+  void fkAndJacobian(const JointVector& q, Transform& pose, Jacobian& jacobian) const
+  {
+    std::array<Eigen::Vector3d, DOF> axes, points;
+    pose = Transform::identity();
+    for (unsigned int j = 0; j < DOF; ++j)
+    {
+      pose = pose * joints_[j].before;
+      axes[j] = pose.rotation * joints_[j].axis;
+      points[j] = pose.rotation * joints_[j].origin + pose.translation;
+      pose = pose * screw(joints_[j], q(j));
+    }
+    pose = pose * tail_;
+    for (unsigned int j = 0; j < DOF; ++j)
+      if (joints_[j].revolute)
+      {
+        jacobian.template block<3, 1>(0, j) = axes[j].cross(pose.translation - points[j]);
+        jacobian.template block<3, 1>(3, j) = axes[j];
+      }
+      else
+      {
+        jacobian.template block<3, 1>(0, j) = axes[j];
+        jacobian.template block<3, 1>(3, j).setZero();
+      }
+  }
+
+  /** \brief The error twist that moves \e from onto \e to, as computed by KDL::diff() */
+  static Eigen::Matrix<double, 6, 1> poseError(const Transform& from, const Transform& to)
+  {
+    Eigen::Matrix<double, 6, 1> error;
+    error.template head<3>() = to.translation - from.translation;
+    Eigen::AngleAxisd rotation(Eigen::Matrix3d(to.rotation * from.rotation.transpose()));
+    error.template tail<3>() = rotation.angle() * rotation.axis();
+    return error;
+  }
+
+private:
+  struct JointData
+  {
+    /** fixed transform from the previous joint (or the base) to the frame the joint is expressed in */
+    Transform before;
+    Eigen::Vector3d axis;
+    Eigen::Vector3d origin;
+    bool revolute;
+  };
+
+  /** \brief The motion of a joint at position q: a rotation about its axis through its origin, or a translation */
+  static Transform screw(const JointData& joint, double q)
+  {
+    Transform t;
+    if (joint.revolute)
+    {
+      t.rotation = Eigen::AngleAxisd(q, joint.axis).toRotationMatrix();
+      t.translation = joint.origin - t.rotation * joint.origin;
+    }
+    else
+    {
+      t.rotation.setIdentity();
+      t.translation = joint.axis * q;
+    }
+    return t;
+  }
+
+  std::array<JointData, DOF> joints_;
+  Transform tail_;
+};
+
+/** \brief FixedSizeChainIKSolver for a chain with DOF joints */
+template <int DOF>
+class FixedSizeChainIKSolverImpl : public FixedSizeChainIKSolver
+{
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  typedef FixedSizeChain<DOF> Chain;
+  typedef typename Chain::JointVector JointVector;
+  typedef typename Chain::Jacobian Jacobian;
+  typedef typename Chain::Transform Transform;
+  typedef Eigen::Matrix<double, 6, 1> Vector6d;
+
+  FixedSizeChainIKSolverImpl(const Chain& chain, const KDL::JntArray& q_min, const KDL::JntArray& q_max,
+                             unsigned int max_iterations, double epsilon, bool position_ik, Method method,
+                             const Vector6d& weights)
+    : chain_(chain)
+    , q_min_(q_min.data)
+    , q_max_(q_max.data)
+    , max_iterations_(max_iterations)
+    , epsilon_(epsilon)
+    , position_ik_(position_ik)
+    , method_(method)
+    , weights_(weights)
+  {
+    if (position_ik_)
+      weights_.template tail<3>().setZero();
+  }
+
+  int CartToJnt(const KDL::JntArray& q_init, const KDL::Frame& p_in, KDL::JntArray& q_out) const override
+  {
+    JointVector q = q_init.data;
+    Transform target = Chain::fromKDL(p_in);
+    int result = method_ == NEWTON_RAPHSON ? solveNewtonRaphson(target, q) : solveLevenbergMarquardt(target, q);
+    q_out.data = q;
+    return result;
+  }
+
+private:
+  bool converged(const Vector6d& error) const
+  {
+    if (position_ik_)
+      return std::fabs(error(0)) < epsilon_ && std::fabs(error(1)) < epsilon_ && std::fabs(error(2)) < epsilon_;
+    return (error.array().abs() < epsilon_).all();
+  }
+
+  /** \brief Mirrors KDL::ChainIkSolverPos_NR_JL_Mimic combined with KDL::ChainIkSolverVel_pinv_mimic */
+  int solveNewtonRaphson(const Transform& target, JointVector& q) const
+  {
+    Transform pose;
+    Jacobian jacobian;
+    for (unsigned int i = 0; i < max_iterations_; ++i)
+    {
+      chain_.fkAndJacobian(q, pose, jacobian);
+      Vector6d error = Chain::poseError(pose, target);
+      if (converged(error))
+        return 0;
+
+      JointVector dq;
+      if (position_ik_)
+        dq = pseudoInverseStep<3>(jacobian.template topRows<3>(), error.template head<3>());
+      else
+        dq = pseudoInverseStep<6>(jacobian, error);
+      q = (q + dq).cwiseMax(q_min_).cwiseMin(q_max_);
+    }
+    return -3;
+  }
+
+  /** \brief Minimum norm step solving J dq = error, ignoring singular values below epsilon like KDL does */
+  template <int ROWS>
+  JointVector pseudoInverseStep(const Eigen::Matrix<double, ROWS, DOF>& jacobian,
+                                const Eigen::Matrix<double, ROWS, 1>& error) const
+  {
+    Eigen::JacobiSVD<Eigen::Matrix<double, ROWS, DOF> > svd(jacobian, Eigen::ComputeFullU | Eigen::ComputeFullV);
+    Eigen::Matrix<double, ROWS, 1> projected = svd.matrixU().transpose() * error;
+    JointVector scaled = JointVector::Zero();
+    const auto& singular_values = svd.singularValues();
+    for (int k = 0; k < singular_values.size(); ++k)
+      if (singular_values(k) >= epsilon_)
+        scaled(k) = projected(k) / singular_values(k);
+    return svd.matrixV() * scaled;
+  }
+
+  /** \brief Levenberg-Marquardt with adaptive damping, followed by the angle wrapping and joint limit check of
+      KDL::ChainIkSolverPos_LMA_JL_Mimic */
+  int solveLevenbergMarquardt(const Transform& target, JointVector& q) const
+  {
+    Transform pose;
+    Jacobian jacobian;
+    chain_.fkAndJacobian(q, pose, jacobian);
+    Vector6d error = weights_.cwiseProduct(Chain::poseError(pose, target));
+    double lambda = 10.0;
+    for (unsigned int i = 0; i < max_iterations_ && error.norm() >= epsilon_; ++i)
+    {
+      Jacobian weighted = weights_.asDiagonal() * jacobian;
+      Eigen::Matrix<double, DOF, DOF> system = weighted.transpose() * weighted;
+      system.diagonal().array() += lambda;
+      JointVector dq = system.ldlt().solve(weighted.transpose() * error);
+      if (dq.norm() < 1e-12)
+        break;
+
+      JointVector q_new = q + dq;
+      Transform pose_new;
+      Jacobian jacobian_new;
+      chain_.fkAndJacobian(q_new, pose_new, jacobian_new);
+      Vector6d error_new = weights_.cwiseProduct(Chain::poseError(pose_new, target));
+      if (error_new.squaredNorm() < error.squaredNorm())
+      {
+        q = q_new;
+        error = error_new;
+        jacobian = jacobian_new;
+        lambda = std::max(lambda / 10.0, 1e-9);
+      }
+      else
+        lambda = std::min(lambda * 10.0, 1e9);
+    }
+    if (error.norm() >= epsilon_)
+      return -3;
+
+    for (int j = 0; j < DOF; ++j)
+    {
+      while (q(j) > 2 * M_PI)
+        q(j) -= 2 * M_PI;
+      while (q(j) < -2 * M_PI)
+        q(j) += 2 * M_PI;
+    }
+    if (((q - q_min_).array() < -0.0001).any() || ((q - q_max_).array() > 0.0001).any())
+      return -4;
+    return 0;
+  }
+
+  Chain chain_;
+  JointVector q_min_;
+  JointVector q_max_;
+  unsigned int max_iterations_;
+  double epsilon_;
+  bool position_ik_;
+  Method method_;
+  Vector6d weights_;
+};
+
+namespace detail
+{
+template <int DOF>
+std::unique_ptr<FixedSizeChainIKSolver>
+createFixedSizeChainIKSolver(const KDL::Chain& chain, const KDL::JntArray& q_min, const KDL::JntArray& q_max,
+                             unsigned int max_iterations, double epsilon, bool position_ik,
+                             FixedSizeChainIKSolver::Method method, const Eigen::Matrix<double, 6, 1>& weights)
+{
+  FixedSizeChain<DOF> fixed_chain;
+  if (!fixed_chain.init(chain))
+    return std::unique_ptr<FixedSizeChainIKSolver>();
+  return std::unique_ptr<FixedSizeChainIKSolver>(new FixedSizeChainIKSolverImpl<DOF>(
+      fixed_chain, q_min, q_max, max_iterations, epsilon, position_ik, method, weights));
+}
+}
+
+/** \brief Create a solver specialized for the number of joints of \e chain. Returns a null pointer for chains with
+    more than 7 joints or with joints that FixedSizeChain does not support; callers then fall back to the generic KDL
+    solvers. \e weights scale the pose error components for LEVENBERG_MARQUARDT and are ignored otherwise. */
+inline std::unique_ptr<FixedSizeChainIKSolver>
+createFixedSizeChainIKSolver(const KDL::Chain& chain, const KDL::JntArray& q_min, const KDL::JntArray& q_max,
+                             unsigned int max_iterations, double epsilon, bool position_ik,
+                             FixedSizeChainIKSolver::Method method,
+                             const Eigen::Matrix<double, 6, 1>& weights = Eigen::Matrix<double, 6, 1>::Ones())
+{
+  switch (chain.getNrOfJoints())
+  {
+    case 1:
+      return detail::createFixedSizeChainIKSolver<1>(chain, q_min, q_max, max_iterations, epsilon, position_ik,
+                                                     method, weights);
+    case 2:
+      return detail::createFixedSizeChainIKSolver<2>(chain, q_min, q_max, max_iterations, epsilon, position_ik,
+                                                     method, weights);
+    case 3:
+      return detail::createFixedSizeChainIKSolver<3>(chain, q_min, q_max, max_iterations, epsilon, position_ik,
+                                                     method, weights);
+    case 4:
+      return detail::createFixedSizeChainIKSolver<4>(chain, q_min, q_max, max_iterations, epsilon, position_ik,
+                                                     method, weights);
+    case 5:
+      return detail::createFixedSizeChainIKSolver<5>(chain, q_min, q_max, max_iterations, epsilon, position_ik,
+                                                     method, weights);
+    case 6:
+      return detail::createFixedSizeChainIKSolver<6>(chain, q_min, q_max, max_iterations, epsilon, position_ik,
+                                                     method, weights);
+    case 7:
+      return detail::createFixedSizeChainIKSolver<7>(chain, q_min, q_max, max_iterations, epsilon, position_ik,
+                                                     method, weights);
+    default:
+      return std::unique_ptr<FixedSizeChainIKSolver>();
+  }
+}
+}
+
+#endif
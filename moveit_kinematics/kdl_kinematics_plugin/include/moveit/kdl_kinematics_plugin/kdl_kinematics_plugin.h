@@ -37,6 +37,11 @@
 #ifndef MOVEIT_ROS_PLANNING_KDL_KINEMATICS_PLUGIN_
 #define MOVEIT_ROS_PLANNING_KDL_KINEMATICS_PLUGIN_
 
+// System
+#include <atomic>
+#include <memory>
+#include <mutex>
+
 // ROS
 #include <ros/ros.h>
 #include <random_numbers/random_numbers.h>
@@ -56,6 +61,7 @@
 #include <moveit/kdl_kinematics_plugin/chainiksolver_pos_nr_jl_mimic.hpp>
 #include <moveit/kdl_kinematics_plugin/chainiksolver_vel_pinv_mimic.hpp>
 #include <moveit/kdl_kinematics_plugin/joint_mimic.hpp>
+#include <moveit/kdl_kinematics_plugin/fixed_size_chain.hpp>
 
 // MoveIt!
 #include <moveit/kinematics_base/kinematics_base.h>
@@ -102,6 +108,17 @@ public:
                    const IKCallbackFn& solution_callback, moveit_msgs::MoveItErrorCodes& error_code,
                    const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions()) const;
 
+  /**
+   * @brief Solve IK for a batch of poses in parallel. Every thread allocates one set of KDL solvers and reuses it for
+   * all the poses it is assigned.
+   */
+  virtual bool searchPositionIKBatch(const EigenSTL::vector_Affine3d& ik_poses,
+                                     const std::vector<std::vector<double> >& ik_seed_states, double timeout,
+                                     std::vector<std::vector<double> >& solutions,
+                                     std::vector<moveit_msgs::MoveItErrorCodes>& error_codes,
+                                     const kinematics::KinematicsQueryOptions& options =
+                                         kinematics::KinematicsQueryOptions()) const;
+
   virtual bool getPositionFK(const std::vector<std::string>& link_names, const std::vector<double>& joint_angles,
                              std::vector<geometry_msgs::Pose>& poses) const;
 
@@ -143,6 +160,69 @@ protected:
   virtual bool setRedundantJoints(const std::vector<unsigned int>& redundant_joint_indices);
 
 private:
+  /** @brief The KDL solvers used by an IK query. The position solver keeps references to the other solvers, so they
+   * are grouped here to be constructed together and reused by batch queries */
+  struct IKSolvers
+  {
+    explicit IKSolvers(const KDLKinematicsPlugin& plugin);
+
+    KDL::ChainFkSolverPos_recursive fk_solver;
+    KDL::ChainIkSolverVel_pinv_mimic ik_solver_vel;
+    KDL::ChainIkSolverPos_NR_JL_Mimic ik_solver_pos;
+  };
+
+  /** @brief Set the mimic and redundant joints of newly constructed solvers */
+  bool configureIKSolvers(IKSolvers& solvers) const;
+
+  /** @brief Everything the random-restart loop of an IK query needs: the solvers, a state to sample restarts with
+   * and the joint arrays and scratch vectors. Workspaces are pooled, so in steady state a query allocates nothing */
+  struct IKWorkspace
+  {
+    explicit IKWorkspace(const KDLKinematicsPlugin& plugin);
+
+    IKSolvers solvers;
+    bool configured; /** Whether configureIKSolvers() succeeded for the solvers */
+    robot_state::RobotState sampling_state;
+    KDL::JntArray jnt_seed_state, jnt_pos_in, jnt_pos_out;
+    std::vector<double> values, near, consistency_limits_mimic;
+  };
+  typedef std::unique_ptr<IKWorkspace> IKWorkspacePtr;
+
+  /** @brief Take a workspace from the pool, or create one if all are in use */
+  IKWorkspacePtr acquireWorkspace() const;
+
+  /** @brief Return a workspace to the pool */
+  void releaseWorkspace(IKWorkspacePtr workspace) const;
+
+  /** @brief State shared by the searches that run in parallel for one query */
+  struct ParallelSearch
+  {
+    ParallelSearch() : solved(false)
+    {
+    }
+
+    std::atomic<bool> solved;
+    std::mutex callback_lock; /** Solution callbacks are not required to be thread-safe */
+  };
+
+  /** @brief Run the search of searchPositionIK() in the given workspace until start_time + timeout. If
+   * random_start is set, the first attempt starts from a random configuration instead of the seed. When the search
+   * is one of several parallel ones, it stops as soon as another one succeeded and only the first to succeed
+   * returns true */
+  bool solvePositionIK(IKWorkspace& workspace, const geometry_msgs::Pose& ik_pose,
+                       const std::vector<double>& ik_seed_state, const ros::WallTime& start_time, double timeout,
+                       std::vector<double>& solution, const IKCallbackFn& solution_callback,
+                       moveit_msgs::MoveItErrorCodes& error_code, const std::vector<double>& consistency_limits,
+                       const kinematics::KinematicsQueryOptions& options, bool random_start = false,
+                       ParallelSearch* parallel_search = NULL) const;
+
+  /** @brief Run num_parallel_restarts_ searches for one query in parallel and keep the first solution found */
+  bool solvePositionIKParallel(const geometry_msgs::Pose& ik_pose, const std::vector<double>& ik_seed_state,
+                               double timeout, std::vector<double>& solution, const IKCallbackFn& solution_callback,
+                               moveit_msgs::MoveItErrorCodes& error_code,
+                               const std::vector<double>& consistency_limits,
+                               const kinematics::KinematicsQueryOptions& options) const;
+
   bool timedOut(const ros::WallTime& start_time, double duration) const;
 
   /** @brief Check whether the solution lies within the consistency limit of the seed state
@@ -160,17 +240,18 @@ private:
 
   int getKDLSegmentIndex(const std::string& name) const;
 
-  void getRandomConfiguration(KDL::JntArray& jnt_array, bool lock_redundancy) const;
+  void getRandomConfiguration(IKWorkspace& workspace, KDL::JntArray& jnt_array, bool lock_redundancy) const;
 
   /** @brief Get a random configuration within joint limits close to the seed state
    *  @param seed_state Seed state
    *  @param redundancy Index of the redundant joint within the chain
    *  @param consistency_limit The returned state will contain a value for the redundant joint in the range
-   * [seed_state(redundancy_limit)-consistency_limit,seed_state(redundancy_limit)+consistency_limit]
+   * [seed_state(redundancy_limit)-consistency_limit,seed_state(redundancy_limit)+consistency_limit], given for the
+   * active joints only in workspace.consistency_limits_mimic
    *  @param jnt_array Returned random configuration
    */
-  void getRandomConfiguration(const KDL::JntArray& seed_state, const std::vector<double>& consistency_limits,
-                              KDL::JntArray& jnt_array, bool lock_redundancy) const;
+  void getRandomConfiguration(IKWorkspace& workspace, const KDL::JntArray& seed_state, KDL::JntArray& jnt_array,
+                              bool lock_redundancy) const;
 
   bool isRedundantJoint(unsigned int index) const;
 
@@ -201,6 +282,16 @@ private:
   double max_solver_iterations_;
   double epsilon_;
   std::vector<JointMimic> mimic_joints_;
+
+  /** IK solver specialized for the number of joints of the chain; NULL if the chain is not supported by it */
+  std::shared_ptr<const FixedSizeChainIKSolver> fixed_size_ik_solver_;
+
+  /** Number of searches run in parallel for a single query */
+  int num_parallel_restarts_;
+
+  /** Workspaces not used by any query right now */
+  mutable std::vector<IKWorkspacePtr> workspaces_;
+  mutable std::mutex workspaces_lock_;
 };
 }
 
@@ -44,6 +44,7 @@ ChainIkSolverVel_pinv_mimic::ChainIkSolverVel_pinv_mimic(const Chain& _chain, in
   , S_translate(VectorXd::Zero(chain.getNrOfJoints() - _num_mimic_joints))
   , V_translate(MatrixXd::Zero(chain.getNrOfJoints() - _num_mimic_joints, chain.getNrOfJoints() - _num_mimic_joints))
   , tmp_translate(VectorXd::Zero(chain.getNrOfJoints() - _num_mimic_joints))
+  , jac_translate(MatrixXd::Zero(3, chain.getNrOfJoints() - _num_mimic_joints))
   , jac_locked(chain.getNrOfJoints() - _num_redundant_joints - _num_mimic_joints)
   , qdot_out_reduced_locked(chain.getNrOfJoints() - _num_mimic_joints - _num_redundant_joints)
   , qdot_out_locked(chain.getNrOfJoints() - _num_redundant_joints)
@@ -62,6 +63,7 @@ ChainIkSolverVel_pinv_mimic::ChainIkSolverVel_pinv_mimic(const Chain& _chain, in
   , V_translate_locked(MatrixXd::Zero(chain.getNrOfJoints() - _num_mimic_joints - _num_redundant_joints,
                                       chain.getNrOfJoints() - _num_mimic_joints - _num_redundant_joints))
   , tmp_translate_locked(VectorXd::Zero(chain.getNrOfJoints() - _num_mimic_joints - _num_redundant_joints))
+  , jac_translate_locked(MatrixXd::Zero(3, chain.getNrOfJoints() - _num_mimic_joints - _num_redundant_joints))
   , num_redundant_joints(_num_redundant_joints)
   , redundant_joints_locked(false)
 {
@@ -157,9 +159,12 @@ int ChainIkSolverVel_pinv_mimic::CartToJntRedundant(const JntArray& q_in, const
   if (!position_ik)
     ret = svd_eigen_HH(jac_locked.data, U_locked, S_locked, V_locked, tmp_locked, maxiter);
   else
-    ret =
-        svd_eigen_HH(jac_locked.data.topLeftCorner(3, chain.getNrOfJoints() - num_mimic_joints - num_redundant_joints),
-                     U_translate_locked, S_translate_locked, V_translate_locked, tmp_translate_locked, maxiter);
+  {
+    // copy into preallocated storage; passing the block would create a temporary matrix on every call
+    jac_translate_locked = jac_locked.data.topRows<3>();
+    ret = svd_eigen_HH(jac_translate_locked, U_translate_locked, S_translate_locked, V_translate_locked,
+                       tmp_translate_locked, maxiter);
+  }
 
   double sum;
   unsigned int i, j;
@@ -260,8 +265,10 @@ int ChainIkSolverVel_pinv_mimic::CartToJnt(const JntArray& q_in, const Twist& v_
   if (!position_ik)
     ret = svd.calculate(jac_reduced, U, S, V, maxiter);
   else
-    ret = svd_eigen_HH(jac_reduced.data.topLeftCorner(3, chain.getNrOfJoints() - num_mimic_joints), U_translate,
-                       S_translate, V_translate, tmp_translate, maxiter);
+  {
+    jac_translate = jac_reduced.data.topRows<3>();
+    ret = svd_eigen_HH(jac_translate, U_translate, S_translate, V_translate, tmp_translate, maxiter);
+  }
 
   double sum;
   unsigned int i, j;
@@ -39,6 +39,7 @@
 
 //#include <tf/transform_datatypes.h>
 #include <tf_conversions/tf_kdl.h>
+#include <eigen_conversions/eigen_msg.h>
 #include <kdl_parser/kdl_parser.hpp>
 
 // URDF, SRDF
@@ -52,21 +53,21 @@ CLASS_LOADER_REGISTER_CLASS(kdl_kinematics_plugin::KDLKinematicsPlugin, kinemati
 
 namespace kdl_kinematics_plugin
 {
-KDLKinematicsPlugin::KDLKinematicsPlugin() : active_(false)
+KDLKinematicsPlugin::KDLKinematicsPlugin() : active_(false), num_parallel_restarts_(1)
 {
 }
 
-void KDLKinematicsPlugin::getRandomConfiguration(KDL::JntArray& jnt_array, bool lock_redundancy) const
+void KDLKinematicsPlugin::getRandomConfiguration(IKWorkspace& workspace, KDL::JntArray& jnt_array,
+                                                 bool lock_redundancy) const
 {
-  std::vector<double> jnt_array_vector(dimension_, 0.0);
-  state_->setToRandomPositions(joint_model_group_);
-  state_->copyJointGroupPositions(joint_model_group_, &jnt_array_vector[0]);
+  workspace.sampling_state.setToRandomPositions(joint_model_group_);
+  workspace.sampling_state.copyJointGroupPositions(joint_model_group_, &workspace.values[0]);
   for (std::size_t i = 0; i < dimension_; ++i)
   {
     if (lock_redundancy)
       if (isRedundantJoint(i))
         continue;
-    jnt_array(i) = jnt_array_vector[i];
+    jnt_array(i) = workspace.values[i];
   }
 }
 
@@ -78,26 +79,16 @@ bool KDLKinematicsPlugin::isRedundantJoint(unsigned int index) const
   return false;
 }
 
-void KDLKinematicsPlugin::getRandomConfiguration(const KDL::JntArray& seed_state,
-                                                 const std::vector<double>& consistency_limits,
+void KDLKinematicsPlugin::getRandomConfiguration(IKWorkspace& workspace, const KDL::JntArray& seed_state,
                                                  KDL::JntArray& jnt_array, bool lock_redundancy) const
 {
-  std::vector<double> values(dimension_, 0.0);
-  std::vector<double> near(dimension_, 0.0);
+  std::vector<double>& values = workspace.values;
+  std::vector<double>& near = workspace.near;
   for (std::size_t i = 0; i < dimension_; ++i)
     near[i] = seed_state(i);
 
-  // Need to resize the consistency limits to remove mimic joints
-  std::vector<double> consistency_limits_mimic;
-  for (std::size_t i = 0; i < dimension_; ++i)
-  {
-    if (!mimic_joints_[i].active)
-      continue;
-    consistency_limits_mimic.push_back(consistency_limits[i]);
-  }
-
-  joint_model_group_->getVariableRandomPositionsNearBy(state_->getRandomNumberGenerator(), values, near,
-                                                       consistency_limits_mimic);
+  joint_model_group_->getVariableRandomPositionsNearBy(workspace.sampling_state.getRandomNumberGenerator(), values,
+                                                       near, workspace.consistency_limits_mimic);
 
   for (std::size_t i = 0; i < dimension_; ++i)
   {
@@ -281,6 +272,26 @@ bool KDLKinematicsPlugin::initialize(const std::string& robot_description, const
   max_solver_iterations_ = max_solver_iterations;
   epsilon_ = epsilon;
 
+  // chains without mimic joints can use a solver specialized for their number of joints
+  bool use_fixed_size_solver;
+  lookupParam("fixed_size_solver", use_fixed_size_solver, true);
+  fixed_size_ik_solver_.reset();
+  if (use_fixed_size_solver && joint_model_group->getMimicJointModels().empty())
+    fixed_size_ik_solver_ = createFixedSizeChainIKSolver(kdl_chain_, joint_min_, joint_max_, max_solver_iterations,
+                                                         epsilon, position_ik, FixedSizeChainIKSolver::NEWTON_RAPHSON);
+  if (fixed_size_ik_solver_)
+    ROS_DEBUG_NAMED("kdl", "Using the IK solver specialized for %u joints", kdl_chain_.getNrOfJoints());
+
+  lookupParam("parallel_restarts", num_parallel_restarts_, 1);
+  if (num_parallel_restarts_ < 1)
+    num_parallel_restarts_ = 1;
+
+  // workspaces created for a previous configuration must not be reused
+  {
+    std::lock_guard<std::mutex> lock(workspaces_lock_);
+    workspaces_.clear();
+  }
+
   active_ = true;
   ROS_DEBUG_NAMED("kdl", "KDL solver initialized");
   return true;
@@ -342,6 +353,10 @@ bool KDLKinematicsPlugin::setRedundantJoints(const std::vector<unsigned int>& re
 
   redundant_joints_map_index_ = redundant_joints_map_index;
   redundant_joint_indices_ = redundant_joints;
+
+  // pooled solvers were configured for the previous set of redundant joints
+  std::lock_guard<std::mutex> lock(workspaces_lock_);
+  workspaces_.clear();
   return true;
 }
 
@@ -435,7 +450,6 @@ bool KDLKinematicsPlugin::searchPositionIK(const geometry_msgs::Pose& ik_pose, c
                                            const std::vector<double>& consistency_limits,
                                            const kinematics::KinematicsQueryOptions& options) const
 {
-  ros::WallTime n1 = ros::WallTime::now();
   if (!active_)
   {
     ROS_ERROR_NAMED("kdl", "kinematics not active");
@@ -459,30 +473,147 @@ bool KDLKinematicsPlugin::searchPositionIK(const geometry_msgs::Pose& ik_pose, c
     return false;
   }
 
-  KDL::JntArray jnt_seed_state(dimension_);
-  KDL::JntArray jnt_pos_in(dimension_);
-  KDL::JntArray jnt_pos_out(dimension_);
+  if (num_parallel_restarts_ > 1)
+    return solvePositionIKParallel(ik_pose, ik_seed_state, timeout, solution, solution_callback, error_code,
+                                   consistency_limits, options);
 
-  KDL::ChainFkSolverPos_recursive fk_solver(kdl_chain_);
-  KDL::ChainIkSolverVel_pinv_mimic ik_solver_vel(kdl_chain_, joint_model_group_->getMimicJointModels().size(),
-                                                 redundant_joint_indices_.size(), position_ik_);
-  KDL::ChainIkSolverPos_NR_JL_Mimic ik_solver_pos(kdl_chain_, joint_min_, joint_max_, fk_solver, ik_solver_vel,
-                                                  max_solver_iterations_, epsilon_, position_ik_);
-  ik_solver_vel.setMimicJoints(mimic_joints_);
-  ik_solver_pos.setMimicJoints(mimic_joints_);
+  IKWorkspacePtr workspace = acquireWorkspace();
+  bool success = false;
+  if (workspace->configured)
+    success = solvePositionIK(*workspace, ik_pose, ik_seed_state, ros::WallTime::now(), timeout, solution,
+                              solution_callback, error_code, consistency_limits, options);
+  else
+    error_code.val = error_code.NO_IK_SOLUTION;
+  releaseWorkspace(std::move(workspace));
+  return success;
+}
 
-  if ((redundant_joint_indices_.size() > 0) && !ik_solver_vel.setRedundantJointsMapIndex(redundant_joints_map_index_))
+bool KDLKinematicsPlugin::solvePositionIKParallel(const geometry_msgs::Pose& ik_pose,
+                                                  const std::vector<double>& ik_seed_state, double timeout,
+                                                  std::vector<double>& solution,
+                                                  const IKCallbackFn& solution_callback,
+                                                  moveit_msgs::MoveItErrorCodes& error_code,
+                                                  const std::vector<double>& consistency_limits,
+                                                  const kinematics::KinematicsQueryOptions& options) const
+{
+  // all searches share one deadline, so running them one after the other (without OpenMP) keeps the timeout
+  const ros::WallTime start_time = ros::WallTime::now();
+  ParallelSearch parallel_search;
+  std::vector<moveit_msgs::MoveItErrorCodes> error_codes(num_parallel_restarts_);
+  int winner = -1;
+
+#pragma omp parallel for num_threads(num_parallel_restarts_) schedule(static, 1)
+  for (int i = 0; i < num_parallel_restarts_; ++i)
+  {
+    error_codes[i].val = error_codes[i].TIMED_OUT;
+    if (parallel_search.solved)
+      continue;
+    IKWorkspacePtr workspace = acquireWorkspace();
+    std::vector<double> thread_solution;
+    // the first search starts from the seed, the others from random configurations
+    if (workspace->configured &&
+        solvePositionIK(*workspace, ik_pose, ik_seed_state, start_time, timeout, thread_solution, solution_callback,
+                        error_codes[i], consistency_limits, options, i > 0, &parallel_search))
+    {
+      // only the first search to succeed gets here
+      solution.swap(thread_solution);
+      winner = i;
+    }
+    else if (!workspace->configured)
+      error_codes[i].val = error_codes[i].NO_IK_SOLUTION;
+    releaseWorkspace(std::move(workspace));
+  }
+
+  error_code = error_codes[winner >= 0 ? winner : 0];
+  return winner >= 0;
+}
+
+KDLKinematicsPlugin::IKWorkspace::IKWorkspace(const KDLKinematicsPlugin& plugin)
+  : solvers(plugin)
+  , configured(plugin.configureIKSolvers(solvers))
+  , sampling_state(*plugin.state_)
+  , jnt_seed_state(plugin.dimension_)
+  , jnt_pos_in(plugin.dimension_)
+  , jnt_pos_out(plugin.dimension_)
+  , values(plugin.dimension_, 0.0)
+  , near(plugin.dimension_, 0.0)
+{
+  consistency_limits_mimic.reserve(plugin.dimension_);
+}
+
+KDLKinematicsPlugin::IKWorkspacePtr KDLKinematicsPlugin::acquireWorkspace() const
+{
+  {
+    std::lock_guard<std::mutex> lock(workspaces_lock_);
+    if (!workspaces_.empty())
+    {
+      IKWorkspacePtr workspace = std::move(workspaces_.back());
+      workspaces_.pop_back();
+      return workspace;
+    }
+  }
+  return IKWorkspacePtr(new IKWorkspace(*this));
+}
+
+void KDLKinematicsPlugin::releaseWorkspace(IKWorkspacePtr workspace) const
+{
+  std::lock_guard<std::mutex> lock(workspaces_lock_);
+  workspaces_.push_back(std::move(workspace));
+}
+
+KDLKinematicsPlugin::IKSolvers::IKSolvers(const KDLKinematicsPlugin& plugin)
+  : fk_solver(plugin.kdl_chain_)
+  , ik_solver_vel(plugin.kdl_chain_, plugin.joint_model_group_->getMimicJointModels().size(),
+                  plugin.redundant_joint_indices_.size(), plugin.position_ik_)
+  , ik_solver_pos(plugin.kdl_chain_, plugin.joint_min_, plugin.joint_max_, fk_solver, ik_solver_vel,
+                  plugin.max_solver_iterations_, plugin.epsilon_, plugin.position_ik_)
+{
+}
+
+bool KDLKinematicsPlugin::configureIKSolvers(IKSolvers& solvers) const
+{
+  solvers.ik_solver_vel.setMimicJoints(mimic_joints_);
+  solvers.ik_solver_pos.setMimicJoints(mimic_joints_);
+
+  if ((redundant_joint_indices_.size() > 0) &&
+      !solvers.ik_solver_vel.setRedundantJointsMapIndex(redundant_joints_map_index_))
   {
     ROS_ERROR_NAMED("kdl", "Could not set redundant joints");
     return false;
   }
+  return true;
+}
+
+bool KDLKinematicsPlugin::solvePositionIK(IKWorkspace& workspace, const geometry_msgs::Pose& ik_pose,
+                                          const std::vector<double>& ik_seed_state, const ros::WallTime& start_time,
+                                          double timeout, std::vector<double>& solution,
+                                          const IKCallbackFn& solution_callback,
+                                          moveit_msgs::MoveItErrorCodes& error_code,
+                                          const std::vector<double>& consistency_limits,
+                                          const kinematics::KinematicsQueryOptions& options, bool random_start,
+                                          ParallelSearch* parallel_search) const
+{
+  IKSolvers& solvers = workspace.solvers;
+  KDL::JntArray& jnt_seed_state = workspace.jnt_seed_state;
+  KDL::JntArray& jnt_pos_in = workspace.jnt_pos_in;
+  KDL::JntArray& jnt_pos_out = workspace.jnt_pos_out;
+
+  // Need to resize the consistency limits to remove mimic joints
+  workspace.consistency_limits_mimic.clear();
+  if (!consistency_limits.empty())
+    for (std::size_t i = 0; i < dimension_; ++i)
+      if (mimic_joints_[i].active)
+        workspace.consistency_limits_mimic.push_back(consistency_limits[i]);
 
   if (options.lock_redundant_joints)
   {
-    ik_solver_vel.lockRedundantJoints();
+    solvers.ik_solver_vel.lockRedundantJoints();
   }
 
   solution.resize(dimension_);
+  // the specialized solver cannot keep redundant joints locked
+  const FixedSizeChainIKSolver* fixed_size_solver =
+      options.lock_redundant_joints && !redundant_joint_indices_.empty() ? NULL : fixed_size_ik_solver_.get();
 
   KDL::Frame pose_desired;
   tf::poseMsgToKDL(ik_pose, pose_desired);
@@ -495,6 +626,13 @@ bool KDLKinematicsPlugin::searchPositionIK(const geometry_msgs::Pose& ik_pose, c
   for (unsigned int i = 0; i < dimension_; i++)
     jnt_seed_state(i) = ik_seed_state[i];
   jnt_pos_in = jnt_seed_state;
+  if (random_start)
+  {
+    if (!consistency_limits.empty())
+      getRandomConfiguration(workspace, jnt_seed_state, jnt_pos_in, options.lock_redundant_joints);
+    else
+      getRandomConfiguration(workspace, jnt_pos_in, options.lock_redundant_joints);
+  }
 
   unsigned int counter(0);
   while (1)
@@ -502,18 +640,26 @@ bool KDLKinematicsPlugin::searchPositionIK(const geometry_msgs::Pose& ik_pose, c
     //    ROS_DEBUG_NAMED("kdl","Iteration: %d, time: %f, Timeout:
     //    %f",counter,(ros::WallTime::now()-n1).toSec(),timeout);
     counter++;
-    if (timedOut(n1, timeout))
+    if (parallel_search && parallel_search->solved)
+    {
+      ROS_DEBUG_NAMED("kdl", "IK solved by a parallel search");
+      error_code.val = error_code.TIMED_OUT;
+      solvers.ik_solver_vel.unlockRedundantJoints();
+      return false;
+    }
+    if (timedOut(start_time, timeout))
     {
       ROS_DEBUG_NAMED("kdl", "IK timed out");
       error_code.val = error_code.TIMED_OUT;
-      ik_solver_vel.unlockRedundantJoints();
+      solvers.ik_solver_vel.unlockRedundantJoints();
       return false;
     }
-    int ik_valid = ik_solver_pos.CartToJnt(jnt_pos_in, pose_desired, jnt_pos_out);
+    int ik_valid = fixed_size_solver ? fixed_size_solver->CartToJnt(jnt_pos_in, pose_desired, jnt_pos_out) :
+                                       solvers.ik_solver_pos.CartToJnt(jnt_pos_in, pose_desired, jnt_pos_out);
     ROS_DEBUG_NAMED("kdl", "IK valid: %d", ik_valid);
     if (!consistency_limits.empty())
     {
-      getRandomConfiguration(jnt_seed_state, consistency_limits, jnt_pos_in, options.lock_redundant_joints);
+      getRandomConfiguration(workspace, jnt_seed_state, jnt_pos_in, options.lock_redundant_joints);
       if ((ik_valid < 0 && !options.return_approximate_solution) ||
           !checkConsistency(jnt_seed_state, consistency_limits, jnt_pos_out))
       {
@@ -523,7 +669,7 @@ bool KDLKinematicsPlugin::searchPositionIK(const geometry_msgs::Pose& ik_pose, c
     }
     else
     {
-      getRandomConfiguration(jnt_pos_in, options.lock_redundant_joints);
+      getRandomConfiguration(workspace, jnt_pos_in, options.lock_redundant_joints);
       ROS_DEBUG_NAMED("kdl", "New random configuration");
       for (unsigned int j = 0; j < dimension_; j++)
         ROS_DEBUG_NAMED("kdl", "%d %f", j, jnt_pos_in(j));
@@ -537,6 +683,15 @@ bool KDLKinematicsPlugin::searchPositionIK(const geometry_msgs::Pose& ik_pose, c
     ROS_DEBUG_NAMED("kdl", "Found IK solution");
     for (unsigned int j = 0; j < dimension_; j++)
       solution[j] = jnt_pos_out(j);
+
+    std::unique_lock<std::mutex> callback_lock;
+    if (parallel_search)
+    {
+      // the callback and the decision which search succeeded first are serialized
+      callback_lock = std::unique_lock<std::mutex>(parallel_search->callback_lock);
+      if (parallel_search->solved)
+        continue;
+    }
     if (!solution_callback.empty())
       solution_callback(ik_pose, solution, error_code);
     else
@@ -544,17 +699,81 @@ bool KDLKinematicsPlugin::searchPositionIK(const geometry_msgs::Pose& ik_pose, c
 
     if (error_code.val == error_code.SUCCESS)
     {
+      if (parallel_search)
+        parallel_search->solved = true;
       ROS_DEBUG_STREAM_NAMED("kdl", "Solved after " << counter << " iterations");
-      ik_solver_vel.unlockRedundantJoints();
+      solvers.ik_solver_vel.unlockRedundantJoints();
       return true;
     }
   }
   ROS_DEBUG_NAMED("kdl", "An IK that satisifes the constraints and is collision free could not be found");
   error_code.val = error_code.NO_IK_SOLUTION;
-  ik_solver_vel.unlockRedundantJoints();
+  solvers.ik_solver_vel.unlockRedundantJoints();
   return false;
 }
 
+bool KDLKinematicsPlugin::searchPositionIKBatch(const EigenSTL::vector_Affine3d& ik_poses,
+                                                const std::vector<std::vector<double> >& ik_seed_states,
+                                                double timeout, std::vector<std::vector<double> >& solutions,
+                                                std::vector<moveit_msgs::MoveItErrorCodes>& error_codes,
+                                                const kinematics::KinematicsQueryOptions& options) const
+{
+  solutions.assign(ik_poses.size(), std::vector<double>());
+  error_codes.resize(ik_poses.size());
+  for (std::size_t i = 0; i < error_codes.size(); ++i)
+    error_codes[i].val = moveit_msgs::MoveItErrorCodes::NO_IK_SOLUTION;
+
+  if (!active_)
+  {
+    ROS_ERROR_NAMED("kdl", "kinematics not active");
+    return false;
+  }
+
+  if (ik_seed_states.size() != 1 && ik_seed_states.size() != ik_poses.size())
+  {
+    ROS_ERROR_NAMED("kdl", "Expected 1 or %u seed states for the IK batch, but %u were given",
+                    (unsigned int)ik_poses.size(), (unsigned int)ik_seed_states.size());
+    return false;
+  }
+
+  for (std::size_t i = 0; i < ik_seed_states.size(); ++i)
+    if (ik_seed_states[i].size() != dimension_)
+    {
+      ROS_ERROR_STREAM_NAMED("kdl", "Seed state must have size " << dimension_ << " instead of size "
+                                                                 << ik_seed_states[i].size());
+      return false;
+    }
+
+  const std::vector<double> no_consistency_limits;
+  const IKCallbackFn no_callback;
+  const int count = ik_poses.size();
+
+// every thread takes one workspace from the pool and keeps it for all the poses it is assigned
+#pragma omp parallel
+  {
+    IKWorkspacePtr workspace = acquireWorkspace();
+    geometry_msgs::Pose ik_pose;
+
+#pragma omp for schedule(dynamic)
+    for (int i = 0; i < count; ++i)
+    {
+      if (!workspace->configured)
+        continue;
+      tf::poseEigenToMsg(ik_poses[i], ik_pose);
+      const std::vector<double>& seed = ik_seed_states.size() == 1 ? ik_seed_states[0] : ik_seed_states[i];
+      if (!solvePositionIK(*workspace, ik_pose, seed, ros::WallTime::now(), timeout, solutions[i], no_callback,
+                           error_codes[i], no_consistency_limits, options))
+        solutions[i].clear();
+    }
+    releaseWorkspace(std::move(workspace));
+  }
+
+  for (std::size_t i = 0; i < error_codes.size(); ++i)
+    if (error_codes[i].val != moveit_msgs::MoveItErrorCodes::SUCCESS)
+      return false;
+  return true;
+}
+
 bool KDLKinematicsPlugin::getPositionFK(const std::vector<std::string>& link_names,
                                         const std::vector<double>& joint_angles,
                                         std::vector<geometry_msgs::Pose>& poses) const
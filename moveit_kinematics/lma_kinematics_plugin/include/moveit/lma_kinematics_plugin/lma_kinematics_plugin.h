@@ -56,6 +56,7 @@
 #include <moveit/lma_kinematics_plugin/chainiksolver_pos_lma_jl_mimic.h>
 #include <moveit/lma_kinematics_plugin/chainiksolver_vel_pinv_mimic.h>
 #include <moveit/lma_kinematics_plugin/joint_mimic.h>
+#include <moveit/kdl_kinematics_plugin/fixed_size_chain.hpp>
 
 // MoveIt!
 #include <moveit/kinematics_base/kinematics_base.h>
@@ -103,6 +104,17 @@ public:
                    const IKCallbackFn& solution_callback, moveit_msgs::MoveItErrorCodes& error_code,
                    const kinematics::KinematicsQueryOptions& options = kinematics::KinematicsQueryOptions()) const;
 
+  /**
+   * @brief Solve IK for a batch of poses in parallel. Every thread allocates one set of KDL solvers and reuses it for
+   * all the poses it is assigned.
+   */
+  virtual bool searchPositionIKBatch(const EigenSTL::vector_Affine3d& ik_poses,
+                                     const std::vector<std::vector<double> >& ik_seed_states, double timeout,
+                                     std::vector<std::vector<double> >& solutions,
+                                     std::vector<moveit_msgs::MoveItErrorCodes>& error_codes,
+                                     const kinematics::KinematicsQueryOptions& options =
+                                         kinematics::KinematicsQueryOptions()) const;
+
   virtual bool getPositionFK(const std::vector<std::string>& link_names, const std::vector<double>& joint_angles,
                              std::vector<geometry_msgs::Pose>& poses) const;
 
@@ -144,6 +156,29 @@ protected:
   virtual bool setRedundantJoints(const std::vector<unsigned int>& redundant_joint_indices);
 
 private:
+  /** @brief The KDL solvers used by an IK query. The position solver keeps references to the other solvers, so they
+   * are grouped here to be constructed together and reused by batch queries */
+  struct IKSolvers
+  {
+    explicit IKSolvers(const LMAKinematicsPlugin& plugin);
+
+    KDL::ChainFkSolverPos_recursive fk_solver;
+    KDL::ChainIkSolverPos_LMA ik_solver;
+    KDL::ChainIkSolverVel_pinv_mimic ik_solver_vel;
+    KDL::ChainIkSolverPos_LMA_JL_Mimic ik_solver_pos;
+  };
+
+  /** @brief Set the mimic and redundant joints of newly constructed solvers */
+  bool configureIKSolvers(IKSolvers& solvers) const;
+
+  /** @brief Run the search of searchPositionIK() using the given solvers. Random restarts are sampled with
+   * sampling_state, which must not be shared with concurrent queries */
+  bool solvePositionIK(IKSolvers& solvers, robot_state::RobotState& sampling_state, const geometry_msgs::Pose& ik_pose,
+                       const std::vector<double>& ik_seed_state, double timeout, std::vector<double>& solution,
+                       const IKCallbackFn& solution_callback, moveit_msgs::MoveItErrorCodes& error_code,
+                       const std::vector<double>& consistency_limits,
+                       const kinematics::KinematicsQueryOptions& options) const;
+
   bool timedOut(const ros::WallTime& start_time, double duration) const;
 
   /** @brief Check whether the solution lies within the consistency limit of the seed state
@@ -161,7 +196,8 @@ private:
 
   int getKDLSegmentIndex(const std::string& name) const;
 
-  void getRandomConfiguration(KDL::JntArray& jnt_array, bool lock_redundancy) const;
+  void getRandomConfiguration(robot_state::RobotState& sampling_state, KDL::JntArray& jnt_array,
+                              bool lock_redundancy) const;
 
   /** @brief Get a random configuration within joint limits close to the seed state
    *  @param seed_state Seed state
@@ -170,8 +206,9 @@ private:
    * [seed_state(redundancy_limit)-consistency_limit,seed_state(redundancy_limit)+consistency_limit]
    *  @param jnt_array Returned random configuration
    */
-  void getRandomConfiguration(const KDL::JntArray& seed_state, const std::vector<double>& consistency_limits,
-                              KDL::JntArray& jnt_array, bool lock_redundancy) const;
+  void getRandomConfiguration(robot_state::RobotState& sampling_state, const KDL::JntArray& seed_state,
+                              const std::vector<double>& consistency_limits, KDL::JntArray& jnt_array,
+                              bool lock_redundancy) const;
 
   bool isRedundantJoint(unsigned int index) const;
 
@@ -202,6 +239,9 @@ private:
   double max_solver_iterations_;
   double epsilon_;
   std::vector<JointMimic> mimic_joints_;
+
+  /** IK solver specialized for the number of joints of the chain; NULL if the chain is not supported by it */
+  std::shared_ptr<const kdl_kinematics_plugin::FixedSizeChainIKSolver> fixed_size_ik_solver_;
 };
 }
 
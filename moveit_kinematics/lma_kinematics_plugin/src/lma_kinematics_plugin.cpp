@@ -38,6 +38,7 @@
 #include <class_loader/class_loader.hpp>
 
 #include <tf_conversions/tf_kdl.h>
+#include <eigen_conversions/eigen_msg.h>
 #include <kdl_parser/kdl_parser.hpp>
 
 // URDF, SRDF
@@ -51,15 +52,31 @@ CLASS_LOADER_REGISTER_CLASS(lma_kinematics_plugin::LMAKinematicsPlugin, kinemati
 
 namespace lma_kinematics_plugin
 {
+namespace
+{
+Eigen::Matrix<double, 6, 1> getLMAWeights()
+{
+  Eigen::Matrix<double, 6, 1> L;
+  L(0) = 1;
+  L(1) = 1;
+  L(2) = 1;
+  L(3) = 0.01;
+  L(4) = 0.01;
+  L(5) = 0.01;
+  return L;
+}
+}
+
 LMAKinematicsPlugin::LMAKinematicsPlugin() : active_(false)
 {
 }
 
-void LMAKinematicsPlugin::getRandomConfiguration(KDL::JntArray& jnt_array, bool lock_redundancy) const
+void LMAKinematicsPlugin::getRandomConfiguration(robot_state::RobotState& sampling_state, KDL::JntArray& jnt_array,
+                                                 bool lock_redundancy) const
 {
   std::vector<double> jnt_array_vector(dimension_, 0.0);
-  state_->setToRandomPositions(joint_model_group_);
-  state_->copyJointGroupPositions(joint_model_group_, &jnt_array_vector[0]);
+  sampling_state.setToRandomPositions(joint_model_group_);
+  sampling_state.copyJointGroupPositions(joint_model_group_, &jnt_array_vector[0]);
   for (std::size_t i = 0; i < dimension_; ++i)
   {
     if (lock_redundancy)
@@ -77,7 +94,8 @@ bool LMAKinematicsPlugin::isRedundantJoint(unsigned int index) const
   return false;
 }
 
-void LMAKinematicsPlugin::getRandomConfiguration(const KDL::JntArray& seed_state,
+void LMAKinematicsPlugin::getRandomConfiguration(robot_state::RobotState& sampling_state,
+                                                 const KDL::JntArray& seed_state,
                                                  const std::vector<double>& consistency_limits,
                                                  KDL::JntArray& jnt_array, bool lock_redundancy) const
 {
@@ -95,7 +113,7 @@ void LMAKinematicsPlugin::getRandomConfiguration(const KDL::JntArray& seed_state
     consistency_limits_mimic.push_back(consistency_limits[i]);
   }
 
-  joint_model_group_->getVariableRandomPositionsNearBy(state_->getRandomNumberGenerator(), values, near,
+  joint_model_group_->getVariableRandomPositionsNearBy(sampling_state.getRandomNumberGenerator(), values, near,
                                                        consistency_limits_mimic);
 
   for (std::size_t i = 0; i < dimension_; ++i)
@@ -281,6 +299,17 @@ bool LMAKinematicsPlugin::initialize(const std::string& robot_description, const
   max_solver_iterations_ = max_solver_iterations;
   epsilon_ = epsilon;
 
+  // chains without mimic joints can use a solver specialized for their number of joints
+  bool use_fixed_size_solver;
+  lookupParam("fixed_size_solver", use_fixed_size_solver, true);
+  fixed_size_ik_solver_.reset();
+  if (use_fixed_size_solver && joint_model_group->getMimicJointModels().empty())
+    fixed_size_ik_solver_ = kdl_kinematics_plugin::createFixedSizeChainIKSolver(
+        kdl_chain_, joint_min_, joint_max_, max_solver_iterations, epsilon, position_ik,
+        kdl_kinematics_plugin::FixedSizeChainIKSolver::LEVENBERG_MARQUARDT, getLMAWeights());
+  if (fixed_size_ik_solver_)
+    ROS_DEBUG_NAMED("lma", "Using the IK solver specialized for %u joints", kdl_chain_.getNrOfJoints());
+
   active_ = true;
   ROS_DEBUG_NAMED("lma", "KDL solver initialized");
   return true;
@@ -435,7 +464,6 @@ bool LMAKinematicsPlugin::searchPositionIK(const geometry_msgs::Pose& ik_pose, c
                                            const std::vector<double>& consistency_limits,
                                            const kinematics::KinematicsQueryOptions& options) const
 {
-  ros::WallTime n1 = ros::WallTime::now();
   if (!active_)
   {
     ROS_ERROR_NAMED("lma", "kinematics not active");
@@ -459,40 +487,61 @@ bool LMAKinematicsPlugin::searchPositionIK(const geometry_msgs::Pose& ik_pose, c
     return false;
   }
 
-  KDL::JntArray jnt_seed_state(dimension_);
-  KDL::JntArray jnt_pos_in(dimension_);
-  KDL::JntArray jnt_pos_out(dimension_);
+  IKSolvers solvers(*this);
+  if (!configureIKSolvers(solvers))
+  {
+    error_code.val = error_code.NO_IK_SOLUTION;
+    return false;
+  }
 
-  // Build Solvers
-  Eigen::Matrix<double, 6, 1> L;
-  L(0) = 1;
-  L(1) = 1;
-  L(2) = 1;
-  L(3) = 0.01;
-  L(4) = 0.01;
-  L(5) = 0.01;
+  return solvePositionIK(solvers, *state_, ik_pose, ik_seed_state, timeout, solution, solution_callback, error_code,
+                         consistency_limits, options);
+}
 
-  KDL::ChainFkSolverPos_recursive fk_solver(kdl_chain_);
-  KDL::ChainIkSolverPos_LMA ik_solver(kdl_chain_, L, epsilon_, max_solver_iterations_);
-  KDL::ChainIkSolverVel_pinv_mimic ik_solver_vel(kdl_chain_, joint_model_group_->getMimicJointModels().size(),
-                                                 redundant_joint_indices_.size(), position_ik_);
-  KDL::ChainIkSolverPos_LMA_JL_Mimic ik_solver_pos(kdl_chain_, joint_min_, joint_max_, fk_solver, ik_solver,
-                                                   max_solver_iterations_, epsilon_, position_ik_);
-  ik_solver_vel.setMimicJoints(mimic_joints_);
-  ik_solver_pos.setMimicJoints(mimic_joints_);
+LMAKinematicsPlugin::IKSolvers::IKSolvers(const LMAKinematicsPlugin& plugin)
+  : fk_solver(plugin.kdl_chain_)
+  , ik_solver(plugin.kdl_chain_, getLMAWeights(), plugin.epsilon_, plugin.max_solver_iterations_)
+  , ik_solver_vel(plugin.kdl_chain_, plugin.joint_model_group_->getMimicJointModels().size(),
+                  plugin.redundant_joint_indices_.size(), plugin.position_ik_)
+  , ik_solver_pos(plugin.kdl_chain_, plugin.joint_min_, plugin.joint_max_, fk_solver, ik_solver,
+                  plugin.max_solver_iterations_, plugin.epsilon_, plugin.position_ik_)
+{
+}
+
+bool LMAKinematicsPlugin::configureIKSolvers(IKSolvers& solvers) const
+{
+  solvers.ik_solver_vel.setMimicJoints(mimic_joints_);
+  solvers.ik_solver_pos.setMimicJoints(mimic_joints_);
 
-  if ((redundant_joint_indices_.size() > 0) && !ik_solver_vel.setRedundantJointsMapIndex(redundant_joints_map_index_))
+  if ((redundant_joint_indices_.size() > 0) &&
+      !solvers.ik_solver_vel.setRedundantJointsMapIndex(redundant_joints_map_index_))
   {
     ROS_ERROR_NAMED("lma", "Could not set redundant joints");
     return false;
   }
+  return true;
+}
+
+bool LMAKinematicsPlugin::solvePositionIK(IKSolvers& solvers, robot_state::RobotState& sampling_state,
+                                          const geometry_msgs::Pose& ik_pose, const std::vector<double>& ik_seed_state,
+                                          double timeout, std::vector<double>& solution,
+                                          const IKCallbackFn& solution_callback,
+                                          moveit_msgs::MoveItErrorCodes& error_code,
+                                          const std::vector<double>& consistency_limits,
+                                          const kinematics::KinematicsQueryOptions& options) const
+{
+  ros::WallTime start_time = ros::WallTime::now();
+  KDL::JntArray jnt_seed_state(dimension_);
+  KDL::JntArray jnt_pos_in(dimension_);
+  KDL::JntArray jnt_pos_out(dimension_);
 
   if (options.lock_redundant_joints)
   {
-    ik_solver_vel.lockRedundantJoints();
+    solvers.ik_solver_vel.lockRedundantJoints();
   }
 
   solution.resize(dimension_);
+  const kdl_kinematics_plugin::FixedSizeChainIKSolver* fixed_size_solver = fixed_size_ik_solver_.get();
 
   KDL::Frame pose_desired;
   tf::poseMsgToKDL(ik_pose, pose_desired);
@@ -512,18 +561,20 @@ bool LMAKinematicsPlugin::searchPositionIK(const geometry_msgs::Pose& ik_pose, c
     //    ROS_DEBUG_NAMED("lma","Iteration: %d, time: %f, Timeout:
     //    %f",counter,(ros::WallTime::now()-n1).toSec(),timeout);
     counter++;
-    if (timedOut(n1, timeout))
+    if (timedOut(start_time, timeout))
     {
       ROS_DEBUG_NAMED("lma", "IK timed out");
       error_code.val = error_code.TIMED_OUT;
-      ik_solver_vel.unlockRedundantJoints();
+      solvers.ik_solver_vel.unlockRedundantJoints();
       return false;
     }
-    int ik_valid = ik_solver_pos.CartToJnt(jnt_pos_in, pose_desired, jnt_pos_out);
+    int ik_valid = fixed_size_solver ? fixed_size_solver->CartToJnt(jnt_pos_in, pose_desired, jnt_pos_out) :
+                                       solvers.ik_solver_pos.CartToJnt(jnt_pos_in, pose_desired, jnt_pos_out);
     ROS_DEBUG_NAMED("lma", "IK valid: %d", ik_valid);
     if (!consistency_limits.empty())
     {
-      getRandomConfiguration(jnt_seed_state, consistency_limits, jnt_pos_in, options.lock_redundant_joints);
+      getRandomConfiguration(sampling_state, jnt_seed_state, consistency_limits, jnt_pos_in,
+                             options.lock_redundant_joints);
       if ((ik_valid < 0 && !options.return_approximate_solution) ||
           !checkConsistency(jnt_seed_state, consistency_limits, jnt_pos_out))
       {
@@ -533,7 +584,7 @@ bool LMAKinematicsPlugin::searchPositionIK(const geometry_msgs::Pose& ik_pose, c
     }
     else
     {
-      getRandomConfiguration(jnt_pos_in, options.lock_redundant_joints);
+      getRandomConfiguration(sampling_state, jnt_pos_in, options.lock_redundant_joints);
       ROS_DEBUG_NAMED("lma", "New random configuration");
       for (unsigned int j = 0; j < dimension_; j++)
         ROS_DEBUG_NAMED("lma", "%d %f", j, jnt_pos_in(j));
@@ -555,16 +606,79 @@ bool LMAKinematicsPlugin::searchPositionIK(const geometry_msgs::Pose& ik_pose, c
     if (error_code.val == error_code.SUCCESS)
     {
       ROS_DEBUG_STREAM_NAMED("lma", "Solved after " << counter << " iterations");
-      ik_solver_vel.unlockRedundantJoints();
+      solvers.ik_solver_vel.unlockRedundantJoints();
       return true;
     }
   }
   ROS_DEBUG_NAMED("lma", "An IK that satisifes the constraints and is collision free could not be found");
   error_code.val = error_code.NO_IK_SOLUTION;
-  ik_solver_vel.unlockRedundantJoints();
+  solvers.ik_solver_vel.unlockRedundantJoints();
   return false;
 }
 
+bool LMAKinematicsPlugin::searchPositionIKBatch(const EigenSTL::vector_Affine3d& ik_poses,
+                                                const std::vector<std::vector<double> >& ik_seed_states,
+                                                double timeout, std::vector<std::vector<double> >& solutions,
+                                                std::vector<moveit_msgs::MoveItErrorCodes>& error_codes,
+                                                const kinematics::KinematicsQueryOptions& options) const
+{
+  solutions.assign(ik_poses.size(), std::vector<double>());
+  error_codes.resize(ik_poses.size());
+  for (std::size_t i = 0; i < error_codes.size(); ++i)
+    error_codes[i].val = moveit_msgs::MoveItErrorCodes::NO_IK_SOLUTION;
+
+  if (!active_)
+  {
+    ROS_ERROR_NAMED("lma", "kinematics not active");
+    return false;
+  }
+
+  if (ik_seed_states.size() != 1 && ik_seed_states.size() != ik_poses.size())
+  {
+    ROS_ERROR_NAMED("lma", "Expected 1 or %u seed states for the IK batch, but %u were given",
+                    (unsigned int)ik_poses.size(), (unsigned int)ik_seed_states.size());
+    return false;
+  }
+
+  for (std::size_t i = 0; i < ik_seed_states.size(); ++i)
+    if (ik_seed_states[i].size() != dimension_)
+    {
+      ROS_ERROR_STREAM_NAMED("lma", "Seed state must have size " << dimension_ << " instead of size "
+                                                                 << ik_seed_states[i].size());
+      return false;
+    }
+
+  const std::vector<double> no_consistency_limits;
+  const IKCallbackFn no_callback;
+  const int count = ik_poses.size();
+
+// every thread builds its solvers once and keeps its own state for sampling random restarts
+#pragma omp parallel
+  {
+    IKSolvers solvers(*this);
+    robot_state::RobotState sampling_state(*state_);
+    bool configured = configureIKSolvers(solvers);
+    geometry_msgs::Pose ik_pose;
+
+#pragma omp for schedule(dynamic)
+    for (int i = 0; i < count; ++i)
+    {
+      if (!configured)
+        continue;
+      tf::poseEigenToMsg(ik_poses[i], ik_pose);
+      const std::vector<double>& seed = ik_seed_states.size() == 1 ? ik_seed_states[0] : ik_seed_states[i];
+      if (!solvePositionIK(solvers, sampling_state, ik_pose, seed, timeout, solutions[i], no_callback, error_codes[i],
+                           no_consistency_limits, options))
+        solutions[i].clear();
+    }
+  }
+
+  for (std::size_t i = 0; i < error_codes.size(); ++i)
+    if (error_codes[i].val != moveit_msgs::MoveItErrorCodes::SUCCESS)
+      return false;
+  return true;
+}
+
 bool LMAKinematicsPlugin::getPositionFK(const std::vector<std::string>& link_names,
                                         const std::vector<double>& joint_angles,
                                         std::vector<geometry_msgs::Pose>& poses) const
@@ -46,7 +46,11 @@
 #include <ros/ros.h>
 
 // System
+#include <cstdint>
+#include <list>
+#include <map>
 #include <memory>
+#include <mutex>
 
 // ROS msgs
 #include <geometry_msgs/PoseStamped.h>
@@ -104,6 +108,22 @@ public:
   virtual bool getPositionFK(const std::vector<std::string>& link_names, const std::vector<double>& joint_angles,
                              std::vector<geometry_msgs::Pose>& poses) const;
 
+  /**
+   * @brief Solve the IK for a sequence of poses of a single-tip group, e.g. the waypoints of a Cartesian path.
+   *
+   * All queries go over the same (persistent) service connection and reuse one prepared request. With
+   * @a chain_seeds the solution of the last reachable pose seeds the next query.
+   * @param ik_poses the desired poses of the tip link
+   * @param ik_seed_state an initial guess solution for the first pose
+   * @param solutions one entry per pose, only meaningful where @a found is true
+   * @param found one entry per pose, true if a valid solution was found for it
+   * @param chain_seeds seed each pose with the previous solution instead of @a ik_seed_state
+   * @return The number of poses for which a valid solution was found
+   */
+  std::size_t getPositionIKBatch(const std::vector<geometry_msgs::Pose>& ik_poses,
+                                 const std::vector<double>& ik_seed_state, std::vector<std::vector<double>>& solutions,
+                                 std::vector<bool>& found, bool chain_seeds = true) const;
+
   virtual bool initialize(const std::string& robot_description, const std::string& group_name,
                           const std::string& base_name, const std::string& tip_frame, double search_discretization)
   {
@@ -153,6 +173,22 @@ private:
 
   bool isRedundantJoint(unsigned int index) const;
 
+  /** @brief (Re)create the service client, optionally with a persistent connection */
+  void connectService() const;
+
+  /** @brief Fill the prepared request with the seed state and poses and call the IK service */
+  bool callService(const std::vector<geometry_msgs::Pose>& ik_poses, const std::vector<double>& ik_seed_state,
+                   std::vector<double>& solution, moveit_msgs::MoveItErrorCodes& error_code) const;
+
+  typedef std::vector<std::int64_t> CacheKey;
+
+  /** @brief Quantize the requested tip poses to the cache resolution */
+  CacheKey getCacheKey(const std::vector<geometry_msgs::Pose>& ik_poses) const;
+
+  bool lookupCache(const CacheKey& key, std::vector<double>& solution) const;
+
+  void insertCache(const CacheKey& key, const std::vector<double>& solution) const;
+
   bool active_; /** Internal variable that indicates whether solvers are configured and ready */
 
   moveit_msgs::KinematicSolverInfo ik_group_info_; /** Stores information for the inverse kinematics solver */
@@ -166,7 +202,22 @@ private:
 
   int num_possible_redundant_joints_;
 
-  std::shared_ptr<ros::ServiceClient> ik_service_client_;
+  std::string ik_service_name_;
+  bool persistent_service_; /** Keep the TCP connection to the IK service open between calls */
+  mutable std::shared_ptr<ros::ServiceClient> ik_service_client_;
+
+  /** The service request is prepared once and only the seed and poses are updated per query. Guarded by
+   * ik_srv_lock_, which also protects robot_state_ */
+  mutable moveit_msgs::GetPositionIK ik_srv_;
+  std::vector<int> seed_state_indices_; /** Group variable index -> index into the request joint_state, if complete */
+  mutable std::mutex ik_srv_lock_;
+
+  /** Least-recently-used cache of pose -> solution pairs, disabled if cache_size_ is 0 */
+  std::size_t cache_size_;
+  double cache_resolution_;
+  mutable std::list<std::pair<CacheKey, std::vector<double>>> cache_;
+  mutable std::map<CacheKey, std::list<std::pair<CacheKey, std::vector<double>>>::iterator> cache_index_;
+  mutable std::mutex cache_lock_;
 };
 }
 
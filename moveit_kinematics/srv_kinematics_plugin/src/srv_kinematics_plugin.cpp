@@ -44,6 +44,10 @@
 #include <moveit/robot_state/conversions.h>
 #include <moveit/rdf_loader/rdf_loader.h>
 
+// System
+#include <algorithm>
+#include <cmath>
+
 // Eigen
 #include <Eigen/Core>
 #include <Eigen/Geometry>
@@ -53,7 +57,8 @@ CLASS_LOADER_REGISTER_CLASS(srv_kinematics_plugin::SrvKinematicsPlugin, kinemati
 
 namespace srv_kinematics_plugin
 {
-SrvKinematicsPlugin::SrvKinematicsPlugin() : active_(false)
+SrvKinematicsPlugin::SrvKinematicsPlugin()
+  : active_(false), persistent_service_(true), cache_size_(0), cache_resolution_(1e-4)
 {
 }
 
@@ -125,17 +130,59 @@ bool SrvKinematicsPlugin::initialize(const std::string& robot_description, const
   // Choose what ROS service to send IK requests to
   ROS_DEBUG_STREAM_NAMED("srv", "Looking for ROS service name on rosparam server with param: "
                                     << "/kinematics_solver_service_name");
-  std::string ik_service_name;
-  lookupParam("kinematics_solver_service_name", ik_service_name, std::string("solve_ik"));
+  lookupParam("kinematics_solver_service_name", ik_service_name_, std::string("solve_ik"));
+  lookupParam("kinematics_solver_persistent_service", persistent_service_, true);
+
+  int cache_size;
+  lookupParam("kinematics_solver_cache_size", cache_size, 0);
+  cache_size_ = cache_size > 0 ? cache_size : 0;
+  lookupParam("kinematics_solver_cache_resolution", cache_resolution_, 1e-4);
+  if (cache_resolution_ <= 0.0)
+  {
+    ROS_WARN_NAMED("srv", "kinematics_solver_cache_resolution must be positive, disabling the IK cache");
+    cache_size_ = 0;
+  }
 
   // Setup the joint state groups that we need
   robot_state_.reset(new robot_state::RobotState(robot_model_));
   robot_state_->setToDefaultValues();
 
+  // Prepare the parts of the service request that are the same for every query
+  moveit_msgs::PositionIKRequest& ik_request = ik_srv_.request.ik_request;
+  ik_request.avoid_collisions = true;
+  ik_request.group_name = getGroupName();
+  moveit::core::robotStateToRobotStateMsg(*robot_state_, ik_request.robot_state);
+  if (tip_frames_.size() > 1)
+  {
+    ik_request.pose_stamped_vector.resize(tip_frames_.size());
+    for (std::size_t i = 0; i < tip_frames_.size(); ++i)
+    {
+      ik_request.pose_stamped_vector[i].header.frame_id = base_frame_;
+      ik_request.ik_link_names.push_back(tip_frames_[i]);
+    }
+  }
+  else
+  {
+    ik_request.pose_stamped.header.frame_id = base_frame_;
+    ik_request.ik_link_name = tip_frames_[0];
+  }
+
+  // Seeds can be written straight into the request if all group variables are part of its joint_state
+  const std::vector<std::string>& variable_names = joint_model_group_->getVariableNames();
+  const std::vector<std::string>& state_names = ik_request.robot_state.joint_state.name;
+  for (std::size_t i = 0; i < variable_names.size(); ++i)
+  {
+    std::vector<std::string>::const_iterator it = std::find(state_names.begin(), state_names.end(), variable_names[i]);
+    if (it == state_names.end())
+    {
+      seed_state_indices_.clear();
+      break;
+    }
+    seed_state_indices_.push_back(it - state_names.begin());
+  }
+
   // Create the ROS service client
-  ros::NodeHandle nonprivate_handle("");
-  ik_service_client_ = std::make_shared<ros::ServiceClient>(
-      nonprivate_handle.serviceClient<moveit_msgs::GetPositionIK>(ik_service_name));
+  connectService();
   if (!ik_service_client_->waitForExistence(ros::Duration(0.1)))  // wait 0.1 seconds, blocking
     ROS_WARN_STREAM_NAMED("srv",
                           "Unable to connect to ROS service client with name: " << ik_service_client_->getService());
@@ -147,6 +194,61 @@ bool SrvKinematicsPlugin::initialize(const std::string& robot_description, const
   return true;
 }
 
+void SrvKinematicsPlugin::connectService() const
+{
+  ros::NodeHandle nonprivate_handle("");
+  ik_service_client_ = std::make_shared<ros::ServiceClient>(
+      nonprivate_handle.serviceClient<moveit_msgs::GetPositionIK>(ik_service_name_, persistent_service_));
+}
+
+SrvKinematicsPlugin::CacheKey SrvKinematicsPlugin::getCacheKey(const std::vector<geometry_msgs::Pose>& ik_poses) const
+{
+  CacheKey key;
+  key.reserve(7 * ik_poses.size());
+  for (const geometry_msgs::Pose& pose : ik_poses)
+  {
+    // q and -q are the same rotation, store the one with non-negative w
+    double sign = pose.orientation.w < 0.0 ? -1.0 : 1.0;
+    const double values[7] = { pose.position.x,           pose.position.y,           pose.position.z,
+                               sign * pose.orientation.x, sign * pose.orientation.y, sign * pose.orientation.z,
+                               sign * pose.orientation.w };
+    for (double v : values)
+      key.push_back(std::llround(v / cache_resolution_));
+  }
+  return key;
+}
+
+bool SrvKinematicsPlugin::lookupCache(const CacheKey& key, std::vector<double>& solution) const
+{
+  std::lock_guard<std::mutex> lock(cache_lock_);
+  auto it = cache_index_.find(key);
+  if (it == cache_index_.end())
+    return false;
+  // move the entry to the front of the LRU list
+  cache_.splice(cache_.begin(), cache_, it->second);
+  solution = it->second->second;
+  return true;
+}
+
+void SrvKinematicsPlugin::insertCache(const CacheKey& key, const std::vector<double>& solution) const
+{
+  std::lock_guard<std::mutex> lock(cache_lock_);
+  auto it = cache_index_.find(key);
+  if (it != cache_index_.end())
+  {
+    it->second->second = solution;
+    cache_.splice(cache_.begin(), cache_, it->second);
+    return;
+  }
+  cache_.emplace_front(key, solution);
+  cache_index_[key] = cache_.begin();
+  if (cache_.size() > cache_size_)
+  {
+    cache_index_.erase(cache_.back().first);
+    cache_.pop_back();
+  }
+}
+
 bool SrvKinematicsPlugin::setRedundantJoints(const std::vector<unsigned int>& redundant_joints)
 {
   if (num_possible_redundant_joints_ < 0)
@@ -289,50 +391,105 @@ bool SrvKinematicsPlugin::searchPositionIK(const std::vector<geometry_msgs::Pose
     return false;
   }
 
-  // Create the service message
-  moveit_msgs::GetPositionIK ik_srv;
-  ik_srv.request.ik_request.avoid_collisions = true;
-  ik_srv.request.ik_request.group_name = getGroupName();
+  // Answer from the cache if possible; the solution callback below still validates it for the current query
+  CacheKey cache_key;
+  bool cached = false;
+  if (cache_size_ > 0)
+  {
+    cache_key = getCacheKey(ik_poses);
+    cached = lookupCache(cache_key, solution);
+    if (cached)
+      ROS_DEBUG_NAMED("srv", "Using cached IK solution");
+  }
 
-  // Copy seed state into virtual robot state and convert into moveit_msg
-  robot_state_->setJointGroupPositions(joint_model_group_, ik_seed_state);
-  moveit::core::robotStateToRobotStateMsg(*robot_state_, ik_srv.request.ik_request.robot_state);
+  if (!cached && !callService(ik_poses, ik_seed_state, solution, error_code))
+    return false;
 
-  // Load the poses into the request in difference places depending if there is more than one or not
-  geometry_msgs::PoseStamped ik_pose_st;
-  ik_pose_st.header.frame_id = base_frame_;
-  if (tip_frames_.size() > 1)
+  // Run the solution callback (i.e. collision checker) if available
+  if (!solution_callback.empty())
   {
-    // Load into vector of poses
-    for (std::size_t i = 0; i < tip_frames_.size(); ++i)
+    ROS_DEBUG_STREAM_NAMED("srv", "Calling solution callback on IK solution");
+
+    // hack: should use all poses, not just the 0th
+    solution_callback(ik_poses[0], solution, error_code);
+
+    if (error_code.val != error_code.SUCCESS)
     {
-      ik_pose_st.pose = ik_poses[i];
-      ik_srv.request.ik_request.pose_stamped_vector.push_back(ik_pose_st);
-      ik_srv.request.ik_request.ik_link_names.push_back(tip_frames_[i]);
+      switch (error_code.val)
+      {
+        case moveit_msgs::MoveItErrorCodes::FAILURE:
+          ROS_ERROR_STREAM_NAMED("srv", "IK solution callback failed with with error code: FAILURE");
+          break;
+        case moveit_msgs::MoveItErrorCodes::NO_IK_SOLUTION:
+          ROS_ERROR_STREAM_NAMED("srv", "IK solution callback failed with with error code: "
+                                        "NO IK SOLUTION");
+          break;
+        default:
+          ROS_ERROR_STREAM_NAMED("srv", "IK solution callback failed with with error code: " << error_code.val);
+      }
+      return false;
     }
   }
+
+  // only solutions that passed the callback are remembered
+  if (cache_size_ > 0 && !cached)
+    insertCache(cache_key, solution);
+
+  error_code.val = error_code.SUCCESS;
+  ROS_DEBUG_STREAM_NAMED("srv", "IK Solver Succeeded!");
+  return true;
+}
+
+bool SrvKinematicsPlugin::callService(const std::vector<geometry_msgs::Pose>& ik_poses,
+                                      const std::vector<double>& ik_seed_state, std::vector<double>& solution,
+                                      moveit_msgs::MoveItErrorCodes& error_code) const
+{
+  std::lock_guard<std::mutex> lock(ik_srv_lock_);
+  moveit_msgs::PositionIKRequest& ik_request = ik_srv_.request.ik_request;
+
+  // Copy seed state into the request, going through the virtual robot state only if the request lacks variables
+  if (!seed_state_indices_.empty())
+  {
+    for (std::size_t i = 0; i < seed_state_indices_.size(); ++i)
+      ik_request.robot_state.joint_state.position[seed_state_indices_[i]] = ik_seed_state[i];
+  }
   else
   {
-    ik_pose_st.pose = ik_poses[0];
+    robot_state_->setJointGroupPositions(joint_model_group_, ik_seed_state);
+    moveit::core::robotStateToRobotStateMsg(*robot_state_, ik_request.robot_state);
+  }
 
-    // Load into single pose value
-    ik_srv.request.ik_request.pose_stamped = ik_pose_st;
-    ik_srv.request.ik_request.ik_link_name = getTipFrames()[0];
+  // Load the poses into the request in difference places depending if there is more than one or not
+  if (tip_frames_.size() > 1)
+  {
+    for (std::size_t i = 0; i < tip_frames_.size(); ++i)
+      ik_request.pose_stamped_vector[i].pose = ik_poses[i];
   }
+  else
+    ik_request.pose_stamped.pose = ik_poses[0];
 
   ROS_DEBUG_STREAM_NAMED("srv", "Calling service: " << ik_service_client_->getService());
-  if (ik_service_client_->call(ik_srv))
+  bool called = ik_service_client_->call(ik_srv_);
+  if (!called && persistent_service_)
+  {
+    // persistent connections do not survive a restart of the server, reconnect once
+    ROS_DEBUG_STREAM_NAMED("srv", "Reconnecting to service: " << ik_service_client_->getService());
+    connectService();
+    called = ik_service_client_->call(ik_srv_);
+  }
+
+  if (called)
   {
     // Check error code
-    error_code.val = ik_srv.response.error_code.val;
+    error_code.val = ik_srv_.response.error_code.val;
     if (error_code.val != error_code.SUCCESS)
     {
       ROS_DEBUG_NAMED("srv", "An IK that satisifes the constraints and is collision free could not be found.");
       switch (error_code.val)
       {
         // Debug mode for failure:
-        ROS_DEBUG_STREAM("Request was: \n" << ik_srv.request.ik_request);
-        ROS_DEBUG_STREAM("Response was: \n" << ik_srv.response.solution);
+        ROS_DEBUG_STREAM("Request was: \n" << ik_srv_.request.ik_request);
+        ROS_DEBUG_STREAM("Response was: \n" << ik_srv_.response.solution);
 
         case moveit_msgs::MoveItErrorCodes::FAILURE:
           ROS_ERROR_STREAM_NAMED("srv", "Service failed with with error code: FAILURE");
@@ -354,7 +511,7 @@ bool SrvKinematicsPlugin::searchPositionIK(const std::vector<geometry_msgs::Pose
   }
 
   // Convert the robot state message to our robot_state representation
-  if (!moveit::core::robotStateMsgToRobotState(ik_srv.response.solution, *robot_state_))
+  if (!moveit::core::robotStateMsgToRobotState(ik_srv_.response.solution, *robot_state_))
   {
     ROS_ERROR_STREAM_NAMED("srv", "An error occured converting recieved robot state message into internal robot "
                                   "state.");
@@ -364,35 +521,45 @@ bool SrvKinematicsPlugin::searchPositionIK(const std::vector<geometry_msgs::Pose
 
   // Get just the joints we are concerned about in our planning group
   robot_state_->copyJointGroupPositions(joint_model_group_, solution);
+  return true;
+}
 
-  // Run the solution callback (i.e. collision checker) if available
-  if (!solution_callback.empty())
+std::size_t SrvKinematicsPlugin::getPositionIKBatch(const std::vector<geometry_msgs::Pose>& ik_poses,
+                                                   const std::vector<double>& ik_seed_state,
+                                                   std::vector<std::vector<double>>& solutions,
+                                                   std::vector<bool>& found, bool chain_seeds) const
+{
+  solutions.resize(ik_poses.size());
+  found.assign(ik_poses.size(), false);
+
+  if (tip_frames_.size() != 1)
   {
-    ROS_DEBUG_STREAM_NAMED("srv", "Calling solution callback on IK solution");
+    ROS_ERROR_NAMED("srv", "getPositionIKBatch() only supports groups with a single tip frame");
+    return 0;
+  }
 
-    // hack: should use all poses, not just the 0th
-    solution_callback(ik_poses[0], solution, error_code);
+  const IKCallbackFn solution_callback = 0;
+  std::vector<double> consistency_limits;
+  std::vector<double> seed = ik_seed_state;
+  std::vector<geometry_msgs::Pose> ik_pose(1);
+  moveit_msgs::MoveItErrorCodes error_code;
+  std::size_t num_found = 0;
 
-    if (error_code.val != error_code.SUCCESS)
+  for (std::size_t i = 0; i < ik_poses.size(); ++i)
+  {
+    ik_pose[0] = ik_poses[i];
+    if (searchPositionIK(ik_pose, seed, default_timeout_, consistency_limits, solutions[i], solution_callback,
+                         error_code))
     {
-      switch (error_code.val)
-      {
-        case moveit_msgs::MoveItErrorCodes::FAILURE:
-          ROS_ERROR_STREAM_NAMED("srv", "IK solution callback failed with with error code: FAILURE");
-          break;
-        case moveit_msgs::MoveItErrorCodes::NO_IK_SOLUTION:
-          ROS_ERROR_STREAM_NAMED("srv", "IK solution callback failed with with error code: "
-                                        "NO IK SOLUTION");
-          break;
-        default:
-          ROS_ERROR_STREAM_NAMED("srv", "IK solution callback failed with with error code: " << error_code.val);
-      }
-      return false;
+      found[i] = true;
+      ++num_found;
+      if (chain_seeds)
+        seed = solutions[i];
     }
   }
 
-  ROS_INFO_STREAM_NAMED("srv", "IK Solver Succeeded!");
-  return true;
+  ROS_DEBUG_STREAM_NAMED("srv", "Found IK solutions for " << num_found << " of " << ik_poses.size() << " poses");
+  return num_found;
 }
 
 bool SrvKinematicsPlugin::getPositionFK(const std::vector<std::string>& link_names,
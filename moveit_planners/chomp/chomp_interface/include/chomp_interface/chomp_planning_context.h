@@ -46,6 +46,7 @@
 #include <tf/transform_listener.h>
 
 #include <moveit/robot_state/conversions.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
 
 namespace chomp_interface
 {
@@ -66,9 +67,14 @@ public:
 
   void initialize();
 
+  /** \brief Warm-start the next call to solve() from \e seed (e.g. a previous solution or the path found by another
+      planner) instead of the configured trajectory initialization. The seed is used once. */
+  void setSeedTrajectory(const robot_trajectory::RobotTrajectoryConstPtr& seed);
+
 private:
   CHOMPInterfacePtr chomp_interface_;
   moveit::core::RobotModelConstPtr robot_model_;
+  robot_trajectory::RobotTrajectoryConstPtr seed_trajectory_;
 
   boost::shared_ptr<tf::TransformListener> tf_;
 };
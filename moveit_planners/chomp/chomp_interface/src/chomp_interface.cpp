@@ -73,5 +73,7 @@ void CHOMPInterface::loadParams()
             std::string("quintic-spline"));
   nh_.param("enable_failure_recovery", params_.enable_failure_recovery_, false);
   nh_.param("max_recovery_attempts", params_.max_recovery_attempts_, 5);
+  nh_.param("num_parallel_restarts", params_.num_parallel_restarts_, 1);
+  nh_.param("restart_noise_scale", params_.restart_noise_scale_, 0.2);
 }
 }
@@ -0,0 +1,110 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/planning_request_adapter/planning_request_adapter.h>
+#include <moveit/kinematic_constraints/utils.h>
+#include <moveit/robot_state/conversions.h>
+#include <moveit/trajectory_processing/iterative_time_parameterization.h>
+#include <chomp_interface/chomp_interface.h>
+#include <class_loader/class_loader.hpp>
+#include <ros/ros.h>
+
+namespace chomp_interface
+{
+/** \brief Runs CHOMP on the path returned by the wrapped planner (e.g. OMPL), using it as the initial trajectory.
+    If CHOMP fails, the original path is kept. */
+class CHOMPOptimizerAdapter : public planning_request_adapter::PlanningRequestAdapter
+{
+public:
+  CHOMPOptimizerAdapter() : planning_request_adapter::PlanningRequestAdapter(), chomp_interface_(new CHOMPInterface())
+  {
+  }
+
+  virtual std::string getDescription() const
+  {
+    return "CHOMP Optimizer";
+  }
+
+  virtual bool adaptAndPlan(const PlannerFn& planner, const planning_scene::PlanningSceneConstPtr& planning_scene,
+                            const planning_interface::MotionPlanRequest& req,
+                            planning_interface::MotionPlanResponse& res,
+                            std::vector<std::size_t>& added_path_index) const
+  {
+    bool solved = planner(planning_scene, req, res);
+    if (!solved || !res.trajectory_ || res.trajectory_->empty())
+      return solved;
+
+    ROS_DEBUG("Running '%s'", getDescription().c_str());
+    const robot_model::JointModelGroup* jmg = planning_scene->getRobotModel()->getJointModelGroup(req.group_name);
+    if (!jmg)
+      return solved;
+
+    // CHOMP only handles joint-space goals, so aim for the end of the path the planner found
+    planning_interface::MotionPlanRequest chomp_req = req;
+    chomp_req.goal_constraints.assign(1, kinematic_constraints::constructGoalConstraints(
+                                             res.trajectory_->getLastWayPoint(), jmg));
+    robot_state::robotStateToRobotStateMsg(res.trajectory_->getFirstWayPoint(), chomp_req.start_state, false);
+
+    moveit_msgs::RobotTrajectory seed;
+    res.trajectory_->getRobotTrajectoryMsg(seed);
+
+    moveit_msgs::MotionPlanDetailedResponse chomp_res;
+    ros::WallTime start = ros::WallTime::now();
+    if (!chomp_interface_->solve(planning_scene, chomp_req, chomp_interface_->getParams(), seed.joint_trajectory,
+                                 chomp_res))
+    {
+      ROS_WARN("CHOMP could not optimize the path found by the planner. Keeping the original path.");
+      return solved;
+    }
+
+    robot_trajectory::RobotTrajectoryPtr optimized(
+        new robot_trajectory::RobotTrajectory(planning_scene->getRobotModel(), req.group_name));
+    optimized->setRobotTrajectoryMsg(res.trajectory_->getFirstWayPoint(), chomp_res.trajectory[0]);
+    trajectory_processing::IterativeParabolicTimeParameterization itp;
+    itp.computeTimeStamps(*optimized, req.max_velocity_scaling_factor, req.max_acceleration_scaling_factor);
+
+    res.trajectory_ = optimized;
+    res.planning_time_ += (ros::WallTime::now() - start).toSec();
+    // the path was resampled, so indices of states added by previous adapters no longer apply
+    added_path_index.clear();
+    return solved;
+  }
+
+private:
+  CHOMPInterfacePtr chomp_interface_;
+};
+}
+
+CLASS_LOADER_REGISTER_CLASS(chomp_interface::CHOMPOptimizerAdapter, planning_request_adapter::PlanningRequestAdapter);
@@ -34,7 +34,19 @@ CHOMPPlanningContext::~CHOMPPlanningContext()
 bool CHOMPPlanningContext::solve(planning_interface::MotionPlanDetailedResponse& res)
 {
   moveit_msgs::MotionPlanDetailedResponse res2;
-  if (chomp_interface_->solve(planning_scene_, request_, chomp_interface_->getParams(), res2))
+  bool solved;
+  if (seed_trajectory_ && !seed_trajectory_->empty())
+  {
+    moveit_msgs::RobotTrajectory seed;
+    seed_trajectory_->getRobotTrajectoryMsg(seed);
+    seed_trajectory_.reset();
+    solved = chomp_interface_->solve(planning_scene_, request_, chomp_interface_->getParams(), seed.joint_trajectory,
+                                     res2);
+  }
+  else
+    solved = chomp_interface_->solve(planning_scene_, request_, chomp_interface_->getParams(), res2);
+
+  if (solved)
   {
     res.trajectory_.resize(1);
     res.trajectory_[0] =
@@ -84,6 +96,12 @@ bool CHOMPPlanningContext::terminate()
 
 void CHOMPPlanningContext::clear()
 {
+  seed_trajectory_.reset();
+}
+
+void CHOMPPlanningContext::setSeedTrajectory(const robot_trajectory::RobotTrajectoryConstPtr& seed)
+{
+  seed_trajectory_ = seed;
 }
 
 } /* namespace chomp_interface */
@@ -39,12 +39,17 @@
 
 #include <eigen3/Eigen/Core>
 #include <chomp_motion_planner/chomp_trajectory.h>
+#include <algorithm>
 #include <vector>
 
 namespace chomp
 {
 /**
  * \brief Represents the smoothness cost for CHOMP, for a single joint
+ *
+ * The quadratic cost matrix is banded, so it is kept as its band and applied in O(n) per trajectory of n points; its
+ * inverse is applied through a banded Cholesky factorization. The matrices only depend on the number of points, the
+ * discretization, the derivative costs and the ridge factor, and are computed once for each combination of those.
  */
 class ChompCost
 {
@@ -58,6 +63,9 @@ public:
 
   const Eigen::MatrixXd& getQuadraticCostInverse() const;
 
+  /** \brief Compute \e result = getQuadraticCostInverse() * \e vector, without the dense product */
+  void multiplyByQuadraticCostInverse(const Eigen::VectorXd& vector, Eigen::VectorXd& result) const;
+
   const Eigen::MatrixXd& getQuadraticCost() const;
 
   double getCost(Eigen::MatrixXd::ColXpr joint_trajectory) const;
@@ -67,18 +75,41 @@ public:
   void scale(double scale);
 
 private:
-  Eigen::MatrixXd quad_cost_full_;
+  /// band of the quadratic cost for all variables: quad_cost_full_band_(j - i + bandwidth_, i) is entry (i, j)
+  Eigen::MatrixXd quad_cost_full_band_;
   Eigen::MatrixXd quad_cost_;
   // Eigen::VectorXd linear_cost_;
   Eigen::MatrixXd quad_cost_inv_;
 
-  Eigen::MatrixXd getDiffMatrix(int size, const double* diff_rule) const;
+  /// band of the Cholesky factor L of quad_cost_: cholesky_band_(i - j, i) is entry (i, j) of L
+  Eigen::MatrixXd cholesky_band_;
+  bool use_cholesky_;
+  int bandwidth_;
+
+  template <typename Input, typename Output>
+  void multiplyByQuadraticCostFull(const Input& input, Output& output) const;
 };
 
+template <typename Input, typename Output>
+void ChompCost::multiplyByQuadraticCostFull(const Input& input, Output& output) const
+{
+  const int size = quad_cost_full_band_.cols();
+  for (int i = 0; i < size; ++i)
+  {
+    const int first = std::max(0, i - bandwidth_);
+    const int last = std::min(size - 1, i + bandwidth_);
+    double sum = 0.0;
+    for (int j = first; j <= last; ++j)
+      sum += quad_cost_full_band_(j - i + bandwidth_, i) * input(j);
+    output(i) = sum;
+  }
+}
+
 template <typename Derived>
 void ChompCost::getDerivative(Eigen::MatrixXd::ColXpr joint_trajectory, Eigen::MatrixBase<Derived>& derivative) const
 {
-  derivative = (quad_cost_full_ * (2.0 * joint_trajectory));
+  multiplyByQuadraticCostFull(joint_trajectory, derivative);
+  derivative *= 2.0;
 }
 
 inline const Eigen::MatrixXd& ChompCost::getQuadraticCostInverse() const
@@ -93,7 +124,9 @@ inline const Eigen::MatrixXd& ChompCost::getQuadraticCost() const
 
 inline double ChompCost::getCost(Eigen::MatrixXd::ColXpr joint_trajectory) const
 {
-  return joint_trajectory.dot(quad_cost_full_ * joint_trajectory);
+  Eigen::VectorXd product(joint_trajectory.size());
+  multiplyByQuadraticCostFull(joint_trajectory, product);
+  return joint_trajectory.dot(product);
 }
 
 }  // namespace chomp
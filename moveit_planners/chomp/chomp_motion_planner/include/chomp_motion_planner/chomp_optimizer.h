@@ -67,6 +67,13 @@ public:
    */
   bool optimize();
 
+  /**
+   * Adds smooth noise, drawn from the inverse of the smoothness cost of each joint, to the free part of the trajectory
+   * so that optimizing it may end in a different local minimum than the unperturbed trajectory
+   * @param scale the standard deviation of the largest perturbation, in radians
+   */
+  void perturbInitialTrajectory(double scale);
+
   inline void destroy()
   {
     // Nothing for now.
@@ -82,6 +89,12 @@ public:
     return is_collision_free_;
   }
 
+  /** @return the cost of the trajectory the last call to optimize() ended with */
+  double getBestCost() const
+  {
+    return best_group_trajectory_cost_;
+  }
+
 private:
   inline double getPotential(double field_distance, double radius, double clearence)
   {
@@ -115,6 +128,7 @@ private:
   //                     Eigen::VectorXd& state_vec);
 
   void setRobotStateFromPoint(ChompTrajectory& group_trajectory, int i);
+  void setRobotStateFromPoint(ChompTrajectory& group_trajectory, int i, moveit::core::RobotState& state) const;
 
   // collision_proximity::CollisionProximitySpace::TrajectorySafety checkCurrentIterValidity();
 
@@ -143,6 +157,10 @@ private:
   collision_detection::GroupStateRepresentationPtr gsr_;
   bool initialized_;
 
+  // scratch used by the threads computing forward kinematics and collision gradients in parallel
+  std::vector<moveit::core::RobotStatePtr> thread_states_;
+  std::vector<collision_detection::GroupStateRepresentationPtr> thread_gsrs_;
+
   std::vector<std::vector<std::string> > collision_point_joint_names_;
   std::vector<std::vector<Eigen::Vector3d> > collision_point_pos_eigen_;
   std::vector<std::vector<Eigen::Vector3d> > collision_point_vel_eigen_;
@@ -176,10 +194,6 @@ private:
   Eigen::MatrixXd final_increments_;
 
   // temporary variables for all functions:
-  Eigen::VectorXd smoothness_derivative_;
-  Eigen::MatrixXd jacobian_;
-  Eigen::MatrixXd jacobian_pseudo_inverse_;
-  Eigen::MatrixXd jacobian_jacobian_tranpose_;
   Eigen::VectorXd random_state_;
   Eigen::VectorXd joint_state_velocities_;
 
@@ -219,8 +233,8 @@ private:
   void getRandomMomentum();
   void updateMomentum();
   void updatePositionFromMomentum();
-  void calculatePseudoInverse();
-  void computeJointProperties(int trajectoryPoint);
+  void calculatePseudoInverse(const Eigen::MatrixXd& jacobian, Eigen::MatrixXd& jacobian_pseudo_inverse) const;
+  void computeJointProperties(int trajectoryPoint, const moveit::core::RobotState& state);
   bool isCurrentTrajectoryMeshToMeshCollisionFree() const;
 };
 }
@@ -101,6 +101,9 @@ public:
                                   /// an initial path is not found with the specified chomp parameters
   int max_recovery_attempts_;     /// this the maximum recovery attempts to find a collision free path after an initial
                                   /// failure to find a solution
+  int num_parallel_restarts_;     /// number of trajectories optimized concurrently, all but the first perturbed with
+                                  /// smooth noise; the collision free one of lowest cost is used
+  double restart_noise_scale_;    /// standard deviation (in rad) of the largest perturbation of a restarted trajectory
 };
 
 }  // namespace chomp
@@ -40,6 +40,7 @@
 #include <chomp_motion_planner/chomp_parameters.h>
 #include <moveit_msgs/MotionPlanDetailedResponse.h>
 #include <moveit_msgs/MotionPlanRequest.h>
+#include <trajectory_msgs/JointTrajectory.h>
 #include <moveit/planning_scene/planning_scene.h>
 
 namespace chomp
@@ -52,6 +53,18 @@ public:
 
   bool solve(const planning_scene::PlanningSceneConstPtr& planning_scene, const moveit_msgs::MotionPlanRequest& req,
              const ChompParameters& params, moveit_msgs::MotionPlanDetailedResponse& res) const;
+
+  /** \brief Optimize starting from \e seed (e.g. a previous solution or the output of another planner) instead of
+      the configured trajectory initialization method. The seed is resampled to CHOMP's discretization and bent to the
+      requested start and goal; if it cannot be used, the configured initialization is used instead. */
+  bool solve(const planning_scene::PlanningSceneConstPtr& planning_scene, const moveit_msgs::MotionPlanRequest& req,
+             const ChompParameters& params, const trajectory_msgs::JointTrajectory& seed,
+             moveit_msgs::MotionPlanDetailedResponse& res) const;
+
+private:
+  bool solve(const planning_scene::PlanningSceneConstPtr& planning_scene, const moveit_msgs::MotionPlanRequest& req,
+             const ChompParameters& params, const trajectory_msgs::JointTrajectory* seed,
+             moveit_msgs::MotionPlanDetailedResponse& res) const;
 };
 }
 
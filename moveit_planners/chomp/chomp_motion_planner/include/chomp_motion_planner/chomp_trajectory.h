@@ -129,6 +129,16 @@ public:
    */
   void fillInCubicInterpolation();
 
+  /**
+   * \brief Fills the trajectory from start index to end index by resampling a seed trajectory
+   *
+   * The seed waypoints are spread uniformly along their joint-space arc length, and the difference between the seed
+   * end points and the fixed points before start_index_ and after end_index_ is blended in linearly so both stay
+   * untouched. \e joint_names gives the joint of each trajectory column. Returns false, without modifying the
+   * trajectory, if the seed has fewer than two waypoints or misses one of the joints.
+   */
+  bool fillInFromTrajectory(const trajectory_msgs::JointTrajectory& seed, const std::vector<std::string>& joint_names);
+
   /**
    * \brief Sets the start and end index for the modifiable part of the trajectory
    *
@@ -37,40 +37,50 @@
 #include <chomp_motion_planner/chomp_cost.h>
 #include <chomp_motion_planner/chomp_utils.h>
 #include <eigen3/Eigen/LU>
+#include <ros/console.h>
+#include <boost/thread/mutex.hpp>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <tuple>
 
 using namespace Eigen;
 using namespace std;
 
 namespace chomp
 {
-ChompCost::ChompCost(const ChompTrajectory& trajectory, int joint_number, const std::vector<double>& derivative_costs,
-                     double ridge_factor)
+namespace
 {
-  int num_vars_all = trajectory.getNumPoints();
-  int num_vars_free = num_vars_all - 2 * (DIFF_RULE_LENGTH - 1);
-  MatrixXd diff_matrix = MatrixXd::Zero(num_vars_all, num_vars_all);
-  quad_cost_full_ = MatrixXd::Zero(num_vars_all, num_vars_all);
+/// bandwidth of the quadratic costs: the products of differentiation matrices of half width DIFF_RULE_LENGTH / 2
+const int COST_BANDWIDTH = 2 * (DIFF_RULE_LENGTH / 2);
 
-  // construct the quad cost for all variables, as a sum of squared differentiation matrices
-  double multiplier = 1.0;
-  for (unsigned int i = 0; i < derivative_costs.size(); i++)
-  {
-    multiplier *= trajectory.getDiscretization();
-    diff_matrix = getDiffMatrix(num_vars_all, &DIFF_RULES[i][0]);
-    quad_cost_full_ += (derivative_costs[i] * multiplier) * (diff_matrix.transpose() * diff_matrix);
-  }
-  quad_cost_full_ += MatrixXd::Identity(num_vars_all, num_vars_all) * ridge_factor;
+struct CostMatrices
+{
+  MatrixXd quad_cost_full_band_;
+  MatrixXd quad_cost_;
+  MatrixXd quad_cost_inv_;
+  MatrixXd cholesky_band_;
+  bool use_cholesky_;
+};
+typedef std::shared_ptr<const CostMatrices> CostMatricesConstPtr;
 
-  // extract the quad cost just for the free variables:
-  quad_cost_ = quad_cost_full_.block(DIFF_RULE_LENGTH - 1, DIFF_RULE_LENGTH - 1, num_vars_free, num_vars_free);
+/// number of points, discretization, derivative costs and ridge factor
+typedef std::tuple<int, double, std::vector<double>, double> CostKey;
 
-  // invert the matrix:
-  quad_cost_inv_ = quad_cost_.inverse();
+struct CostCache
+{
+  static const std::size_t MAX_SIZE = 32;
+  boost::mutex lock_;
+  std::map<CostKey, CostMatricesConstPtr> matrices_;
+};
 
-  // cout << quad_cost_inv_ << endl;
+CostCache& getCostCache()
+{
+  static CostCache cache;
+  return cache;
 }
 
-Eigen::MatrixXd ChompCost::getDiffMatrix(int size, const double* diff_rule) const
+MatrixXd getDiffMatrix(int size, const double* diff_rule)
 {
   MatrixXd matrix = MatrixXd::Zero(size, size);
   for (int i = 0; i < size; i++)
@@ -88,6 +98,127 @@ Eigen::MatrixXd ChompCost::getDiffMatrix(int size, const double* diff_rule) cons
   return matrix;
 }
 
+/* Compute the band of the Cholesky factor L of the symmetric banded \e matrix, with band(i - j, i) = L(i, j).
+   Returns false if the matrix is not positive definite. */
+bool computeBandedCholesky(const MatrixXd& matrix, int bandwidth, MatrixXd& band)
+{
+  const int size = matrix.rows();
+  band = MatrixXd::Zero(bandwidth + 1, size);
+  for (int i = 0; i < size; ++i)
+    for (int j = std::max(0, i - bandwidth); j <= i; ++j)
+    {
+      double sum = matrix(i, j);
+      for (int k = std::max(0, i - bandwidth); k < j; ++k)
+        sum -= band(i - k, i) * band(j - k, j);
+      if (i == j)
+      {
+        if (sum <= 0.0)
+          return false;
+        band(0, i) = std::sqrt(sum);
+      }
+      else
+        band(i - j, i) = sum / band(0, j);
+    }
+  return true;
+}
+
+CostMatricesConstPtr computeCostMatrices(int num_vars_all, double discretization,
+                                         const std::vector<double>& derivative_costs, double ridge_factor)
+{
+  int num_vars_free = num_vars_all - 2 * (DIFF_RULE_LENGTH - 1);
+  MatrixXd diff_matrix = MatrixXd::Zero(num_vars_all, num_vars_all);
+  MatrixXd quad_cost_full = MatrixXd::Zero(num_vars_all, num_vars_all);
+
+  // construct the quad cost for all variables, as a sum of squared differentiation matrices
+  double multiplier = 1.0;
+  for (unsigned int i = 0; i < derivative_costs.size(); i++)
+  {
+    multiplier *= discretization;
+    diff_matrix = getDiffMatrix(num_vars_all, &DIFF_RULES[i][0]);
+    quad_cost_full += (derivative_costs[i] * multiplier) * (diff_matrix.transpose() * diff_matrix);
+  }
+  quad_cost_full += MatrixXd::Identity(num_vars_all, num_vars_all) * ridge_factor;
+
+  std::shared_ptr<CostMatrices> matrices(new CostMatrices());
+  matrices->quad_cost_full_band_ = MatrixXd::Zero(2 * COST_BANDWIDTH + 1, num_vars_all);
+  for (int i = 0; i < num_vars_all; ++i)
+    for (int j = std::max(0, i - COST_BANDWIDTH); j <= std::min(num_vars_all - 1, i + COST_BANDWIDTH); ++j)
+      matrices->quad_cost_full_band_(j - i + COST_BANDWIDTH, i) = quad_cost_full(i, j);
+
+  // extract the quad cost just for the free variables:
+  matrices->quad_cost_ =
+      quad_cost_full.block(DIFF_RULE_LENGTH - 1, DIFF_RULE_LENGTH - 1, num_vars_free, num_vars_free);
+
+  // invert the matrix; the inverse is still needed densely for sampling and for handling joint limits
+  matrices->quad_cost_inv_ = matrices->quad_cost_.inverse();
+  matrices->use_cholesky_ = computeBandedCholesky(matrices->quad_cost_, COST_BANDWIDTH, matrices->cholesky_band_);
+  if (!matrices->use_cholesky_)
+    ROS_WARN_NAMED("chomp_cost", "Smoothness cost is not positive definite; using its dense inverse");
+  return matrices;
+}
+}
+
+ChompCost::ChompCost(const ChompTrajectory& trajectory, int joint_number, const std::vector<double>& derivative_costs,
+                     double ridge_factor)
+  : bandwidth_(COST_BANDWIDTH)
+{
+  CostCache& cache = getCostCache();
+  CostKey key(trajectory.getNumPoints(), trajectory.getDiscretization(), derivative_costs, ridge_factor);
+  CostMatricesConstPtr matrices;
+  {
+    boost::mutex::scoped_lock slock(cache.lock_);
+    std::map<CostKey, CostMatricesConstPtr>::const_iterator it = cache.matrices_.find(key);
+    if (it != cache.matrices_.end())
+      matrices = it->second;
+  }
+
+  if (!matrices)
+  {
+    matrices = computeCostMatrices(trajectory.getNumPoints(), trajectory.getDiscretization(), derivative_costs,
+                                   ridge_factor);
+    boost::mutex::scoped_lock slock(cache.lock_);
+    if (cache.matrices_.size() >= CostCache::MAX_SIZE)
+      cache.matrices_.clear();
+    cache.matrices_[key] = matrices;
+  }
+
+  // the matrices are copied, as scale() changes them for this joint only
+  quad_cost_full_band_ = matrices->quad_cost_full_band_;
+  quad_cost_ = matrices->quad_cost_;
+  quad_cost_inv_ = matrices->quad_cost_inv_;
+  cholesky_band_ = matrices->cholesky_band_;
+  use_cholesky_ = matrices->use_cholesky_;
+
+  // cout << quad_cost_inv_ << endl;
+}
+
+void ChompCost::multiplyByQuadraticCostInverse(const Eigen::VectorXd& vector, Eigen::VectorXd& result) const
+{
+  if (!use_cholesky_)
+  {
+    result.noalias() = quad_cost_inv_ * vector;
+    return;
+  }
+
+  // solve L y = vector and then L^T result = y, both in place in result
+  const int size = cholesky_band_.cols();
+  result.resize(size);
+  for (int i = 0; i < size; ++i)
+  {
+    double sum = vector(i);
+    for (int k = std::max(0, i - bandwidth_); k < i; ++k)
+      sum -= cholesky_band_(i - k, i) * result(k);
+    result(i) = sum / cholesky_band_(0, i);
+  }
+  for (int i = size - 1; i >= 0; --i)
+  {
+    double sum = result(i);
+    for (int k = i + 1; k <= std::min(size - 1, i + bandwidth_); ++k)
+      sum -= cholesky_band_(k - i, k) * result(k);
+    result(i) = sum / cholesky_band_(0, i);
+  }
+}
+
 double ChompCost::getMaxQuadCostInvValue() const
 {
   return quad_cost_inv_.maxCoeff();
@@ -98,7 +229,8 @@ void ChompCost::scale(double scale)
   double inv_scale = 1.0 / scale;
   quad_cost_inv_ *= inv_scale;
   quad_cost_ *= scale;
-  quad_cost_full_ *= scale;
+  quad_cost_full_band_ *= scale;
+  cholesky_band_ *= std::sqrt(scale);
 }
 
 ChompCost::~ChompCost()
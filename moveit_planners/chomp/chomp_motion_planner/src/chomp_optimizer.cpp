@@ -44,6 +44,10 @@
 #include <eigen3/Eigen/LU>
 #include <eigen3/Eigen/Core>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 namespace chomp
 {
 double getRandomDouble()
@@ -112,6 +116,27 @@ void ChompOptimizer::initialize()
   hy_world_->getCollisionGradients(req, res, *hy_robot_->getCollisionRobotDistanceField().get(), state_,
                                    &planning_scene_->getAllowedCollisionMatrix(), gsr_);
   ROS_INFO_STREAM("First coll check took " << (ros::WallTime::now() - wt));
+
+  // forward kinematics and collision gradients are computed for several trajectory points in parallel; every
+  // thread needs its own robot state and collision checking structures, which cannot be shared
+#ifdef _OPENMP
+  const int num_threads = omp_get_max_threads();
+#else
+  const int num_threads = 1;
+#endif
+  thread_states_.resize(num_threads);
+  thread_gsrs_.resize(num_threads);
+  thread_gsrs_[0] = gsr_;
+  for (int t = 0; t < num_threads; ++t)
+  {
+    thread_states_[t].reset(new moveit::core::RobotState(state_));
+    if (!thread_gsrs_[t])
+    {
+      collision_detection::CollisionResult thread_res;
+      hy_world_->getCollisionGradients(req, thread_res, *hy_robot_->getCollisionRobotDistanceField().get(), state_,
+                                       &planning_scene_->getAllowedCollisionMatrix(), thread_gsrs_[t]);
+    }
+  }
   num_collision_points_ = 0;
   for (size_t i = 0; i < gsr_->gradients_.size(); i++)
   {
@@ -152,10 +177,6 @@ void ChompOptimizer::initialize()
   smoothness_increments_ = Eigen::MatrixXd::Zero(num_vars_free_, num_joints_);
   collision_increments_ = Eigen::MatrixXd::Zero(num_vars_free_, num_joints_);
   final_increments_ = Eigen::MatrixXd::Zero(num_vars_free_, num_joints_);
-  smoothness_derivative_ = Eigen::VectorXd::Zero(num_vars_all_);
-  jacobian_ = Eigen::MatrixXd::Zero(3, num_joints_);
-  jacobian_pseudo_inverse_ = Eigen::MatrixXd::Zero(num_joints_, 3);
-  jacobian_jacobian_tranpose_ = Eigen::MatrixXd::Zero(3, 3);
   random_state_ = Eigen::VectorXd::Zero(num_joints_);
   joint_state_velocities_ = Eigen::VectorXd::Zero(num_joints_);
 
@@ -601,24 +622,20 @@ bool ChompOptimizer::isCurrentTrajectoryMeshToMeshCollisionFree() const
 
 void ChompOptimizer::calculateSmoothnessIncrements()
 {
-  for (int i = 0; i < num_joints_; i++)
+#pragma omp parallel
   {
-    joint_costs_[i].getDerivative(group_trajectory_.getJointTrajectory(i), smoothness_derivative_);
-    smoothness_increments_.col(i) = -smoothness_derivative_.segment(group_trajectory_.getStartIndex(), num_vars_free_);
+    Eigen::VectorXd smoothness_derivative(num_vars_all_);
+#pragma omp for schedule(static)
+    for (int i = 0; i < num_joints_; i++)
+    {
+      joint_costs_[i].getDerivative(group_trajectory_.getJointTrajectory(i), smoothness_derivative);
+      smoothness_increments_.col(i) = -smoothness_derivative.segment(group_trajectory_.getStartIndex(), num_vars_free_);
+    }
   }
 }
 
 void ChompOptimizer::calculateCollisionIncrements()
 {
-  double potential;
-  double vel_mag_sq;
-  double vel_mag;
-  Eigen::Vector3d potential_gradient;
-  Eigen::Vector3d normalized_velocity;
-  Eigen::Matrix3d orthogonal_projector;
-  Eigen::Vector3d curvature_vector;
-  Eigen::Vector3d cartesian_gradient;
-
   collision_increments_.setZero(num_vars_free_, num_joints_);
 
   int startPoint = 0;
@@ -640,66 +657,89 @@ void ChompOptimizer::calculateCollisionIncrements()
     startPoint = free_vars_start_;
   }
 
-  for (int i = startPoint; i <= endPoint; i++)
+  // every trajectory point only writes its own row of the increments
+#pragma omp parallel
   {
-    for (int j = 0; j < num_collision_points_; j++)
+    double potential;
+    double vel_mag_sq;
+    double vel_mag;
+    Eigen::Vector3d potential_gradient;
+    Eigen::Vector3d normalized_velocity;
+    Eigen::Matrix3d orthogonal_projector;
+    Eigen::Vector3d curvature_vector;
+    Eigen::Vector3d cartesian_gradient;
+    Eigen::MatrixXd jacobian = Eigen::MatrixXd::Zero(3, num_joints_);
+    Eigen::MatrixXd jacobian_pseudo_inverse = Eigen::MatrixXd::Zero(num_joints_, 3);
+
+#pragma omp for schedule(dynamic)
+    for (int i = startPoint; i <= endPoint; i++)
     {
-      potential = collision_point_potential_[i][j];
+      for (int j = 0; j < num_collision_points_; j++)
+      {
+        potential = collision_point_potential_[i][j];
 
-      if (potential < 0.0001)
-        continue;
+        if (potential < 0.0001)
+          continue;
 
-      potential_gradient = -collision_point_potential_gradient_[i][j];
+        potential_gradient = -collision_point_potential_gradient_[i][j];
 
-      vel_mag = collision_point_vel_mag_[i][j];
-      vel_mag_sq = vel_mag * vel_mag;
+        vel_mag = collision_point_vel_mag_[i][j];
+        vel_mag_sq = vel_mag * vel_mag;
 
-      // all math from the CHOMP paper:
+        // all math from the CHOMP paper:
 
-      normalized_velocity = collision_point_vel_eigen_[i][j] / vel_mag;
-      orthogonal_projector = Eigen::Matrix3d::Identity() - (normalized_velocity * normalized_velocity.transpose());
-      curvature_vector = (orthogonal_projector * collision_point_acc_eigen_[i][j]) / vel_mag_sq;
-      cartesian_gradient = vel_mag * (orthogonal_projector * potential_gradient - potential * curvature_vector);
+        normalized_velocity = collision_point_vel_eigen_[i][j] / vel_mag;
+        orthogonal_projector = Eigen::Matrix3d::Identity() - (normalized_velocity * normalized_velocity.transpose());
+        curvature_vector = (orthogonal_projector * collision_point_acc_eigen_[i][j]) / vel_mag_sq;
+        cartesian_gradient = vel_mag * (orthogonal_projector * potential_gradient - potential * curvature_vector);
 
-      // pass it through the jacobian transpose to get the increments
-      getJacobian(i, collision_point_pos_eigen_[i][j], collision_point_joint_names_[i][j], jacobian_);
+        // pass it through the jacobian transpose to get the increments
+        getJacobian(i, collision_point_pos_eigen_[i][j], collision_point_joint_names_[i][j], jacobian);
 
-      if (parameters_->use_pseudo_inverse_)
-      {
-        calculatePseudoInverse();
-        collision_increments_.row(i - free_vars_start_).transpose() -= jacobian_pseudo_inverse_ * cartesian_gradient;
-      }
-      else
-      {
-        collision_increments_.row(i - free_vars_start_).transpose() -= jacobian_.transpose() * cartesian_gradient;
-      }
-
-      /*
-        if(point_is_in_collision_[i][j])
+        if (parameters_->use_pseudo_inverse_)
         {
-        break;
+          calculatePseudoInverse(jacobian, jacobian_pseudo_inverse);
+          collision_increments_.row(i - free_vars_start_).transpose() -= jacobian_pseudo_inverse * cartesian_gradient;
         }
-      */
+        else
+        {
+          collision_increments_.row(i - free_vars_start_).transpose() -= jacobian.transpose() * cartesian_gradient;
+        }
+
+        /*
+          if(point_is_in_collision_[i][j])
+          {
+          break;
+          }
+        */
+      }
     }
   }
   // cout << collision_increments_ << endl;
 }
 
-void ChompOptimizer::calculatePseudoInverse()
+void ChompOptimizer::calculatePseudoInverse(const Eigen::MatrixXd& jacobian,
+                                            Eigen::MatrixXd& jacobian_pseudo_inverse) const
 {
-  jacobian_jacobian_tranpose_ =
-      jacobian_ * jacobian_.transpose() + Eigen::MatrixXd::Identity(3, 3) * parameters_->pseudo_inverse_ridge_factor_;
-  jacobian_pseudo_inverse_ = jacobian_.transpose() * jacobian_jacobian_tranpose_.inverse();
+  Eigen::Matrix3d jacobian_jacobian_tranpose =
+      jacobian * jacobian.transpose() + Eigen::Matrix3d::Identity() * parameters_->pseudo_inverse_ridge_factor_;
+  jacobian_pseudo_inverse.noalias() = jacobian.transpose() * jacobian_jacobian_tranpose.inverse();
 }
 
 void ChompOptimizer::calculateTotalIncrements()
 {
-  for (int i = 0; i < num_joints_; i++)
+#pragma omp parallel
   {
-    final_increments_.col(i) =
-        parameters_->learning_rate_ * (joint_costs_[i].getQuadraticCostInverse() *
-                                       (parameters_->smoothness_cost_weight_ * smoothness_increments_.col(i) +
-                                        parameters_->obstacle_cost_weight_ * collision_increments_.col(i)));
+    Eigen::VectorXd gradient(num_vars_free_);
+    Eigen::VectorXd increment(num_vars_free_);
+#pragma omp for schedule(static)
+    for (int i = 0; i < num_joints_; i++)
+    {
+      gradient = parameters_->smoothness_cost_weight_ * smoothness_increments_.col(i) +
+                 parameters_->obstacle_cost_weight_ * collision_increments_.col(i);
+      joint_costs_[i].multiplyByQuadraticCostInverse(gradient, increment);
+      final_increments_.col(i) = parameters_->learning_rate_ * increment;
+    }
   }
 }
 
@@ -777,12 +817,12 @@ double ChompOptimizer::getCollisionCost()
   return parameters_->obstacle_cost_weight_ * collision_cost;
 }
 
-void ChompOptimizer::computeJointProperties(int trajectory_point)
+void ChompOptimizer::computeJointProperties(int trajectory_point, const moveit::core::RobotState& state)
 {
   // tf::Transform inverseWorldTransform = collision_space_->getInverseWorldTransform(*state_);
   for (int j = 0; j < num_joints_; j++)
   {
-    const moveit::core::JointModel* joint_model = state_.getJointModel(joint_names_[j]);
+    const moveit::core::JointModel* joint_model = state.getJointModel(joint_names_[j]);
     const moveit::core::RevoluteJointModel* revolute_joint =
         dynamic_cast<const moveit::core::RevoluteJointModel*>(joint_model);
     const moveit::core::PrismaticJointModel* prismatic_joint =
@@ -791,8 +831,8 @@ void ChompOptimizer::computeJointProperties(int trajectory_point)
     std::string parent_link_name = joint_model->getParentLinkModel()->getName();
     std::string child_link_name = joint_model->getChildLinkModel()->getName();
     Eigen::Affine3d joint_transform =
-        state_.getGlobalLinkTransform(parent_link_name) *
-        (kmodel_->getLinkModel(child_link_name)->getJointOriginTransform() * (state_.getJointTransform(joint_model)));
+        state.getGlobalLinkTransform(parent_link_name) *
+        (kmodel_->getLinkModel(child_link_name)->getJointOriginTransform() * (state.getJointTransform(joint_model)));
 
     // joint_transform = inverseWorldTransform * jointTransform;
     Eigen::Vector3d axis;
@@ -937,31 +977,36 @@ void ChompOptimizer::performForwardKinematics()
     end = num_vars_all_ - 1;
   }
 
-  is_collision_free_ = true;
-
-  ros::WallDuration total_dur(0.0);
+  bool collision_free = true;
 
   // for each point in the trajectory
+#pragma omp parallel for schedule(dynamic) reduction(&& : collision_free)
   for (int i = start; i <= end; ++i)
   {
+#ifdef _OPENMP
+    const int thread = omp_get_thread_num();
+#else
+    const int thread = 0;
+#endif
+    moveit::core::RobotState& state = *thread_states_[thread];
+    collision_detection::GroupStateRepresentationPtr& gsr = thread_gsrs_[thread];
+
     // Set Robot state from trajectory point...
     collision_detection::CollisionRequest req;
     collision_detection::CollisionResult res;
     req.group_name = planning_group_;
-    setRobotStateFromPoint(group_trajectory_, i);
-    ros::WallTime grad = ros::WallTime::now();
+    setRobotStateFromPoint(group_trajectory_, i, state);
 
-    hy_world_->getCollisionGradients(req, res, *hy_robot_->getCollisionRobotDistanceField().get(), state_, NULL, gsr_);
-    total_dur += (ros::WallTime::now() - grad);
-    computeJointProperties(i);
+    hy_world_->getCollisionGradients(req, res, *hy_robot_->getCollisionRobotDistanceField().get(), state, NULL, gsr);
+    computeJointProperties(i, state);
     state_is_in_collision_[i] = false;
 
     // Keep vars in scope
     {
       size_t j = 0;
-      for (size_t g = 0; g < gsr_->gradients_.size(); g++)
+      for (size_t g = 0; g < gsr->gradients_.size(); g++)
       {
-        collision_detection::GradientInfo& info = gsr_->gradients_[g];
+        collision_detection::GradientInfo& info = gsr->gradients_[g];
 
         for (size_t k = 0; k < info.sphere_locations.size(); k++)
         {
@@ -990,17 +1035,17 @@ void ChompOptimizer::performForwardKinematics()
             //   collision_point_potential_[i][j]);
             // }
 
-            is_collision_free_ = false;
+            collision_free = false;
           }
           j++;
         }
       }
     }
   }
-
-  // ROS_INFO_STREAM("Total dur " << total_dur << " total checks " << end-start+1);
+  is_collision_free_ = collision_free;
 
   // now, get the vel and acc for each collision point (using finite differencing)
+#pragma omp parallel for schedule(static)
   for (int i = free_vars_start_; i <= free_vars_end_; i++)
   {
     for (int j = 0; j < num_collision_points_; j++)
@@ -1022,6 +1067,12 @@ void ChompOptimizer::performForwardKinematics()
 }
 
 void ChompOptimizer::setRobotStateFromPoint(ChompTrajectory& group_trajectory, int i)
+{
+  setRobotStateFromPoint(group_trajectory, i, state_);
+}
+
+void ChompOptimizer::setRobotStateFromPoint(ChompTrajectory& group_trajectory, int i,
+                                            moveit::core::RobotState& state) const
 {
   const Eigen::MatrixXd::RowXpr& point = group_trajectory.getTrajectoryPoint(i);
 
@@ -1031,8 +1082,22 @@ void ChompOptimizer::setRobotStateFromPoint(ChompTrajectory& group_trajectory, i
     joint_states.push_back(point(0, j));
   }
 
-  state_.setJointGroupPositions(planning_group_, joint_states);
-  state_.update();
+  state.setJointGroupPositions(planning_group_, joint_states);
+  state.update();
+}
+
+void ChompOptimizer::perturbInitialTrajectory(double scale)
+{
+  // the quadratic cost inverses are scaled to a largest entry of one, so the samples have a standard deviation of at
+  // most one as well
+  Eigen::VectorXd noise(num_vars_free_);
+  for (int i = 0; i < num_joints_; i++)
+  {
+    multivariate_gaussian_[i].sample(noise);
+    group_trajectory_.getFreeJointTrajectoryBlock(i) += scale * noise;
+  }
+  handleJointLimits();
+  updateFullTrajectory();
 }
 
 void ChompOptimizer::perturbTrajectory()
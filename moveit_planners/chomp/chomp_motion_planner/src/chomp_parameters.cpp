@@ -68,6 +68,8 @@ ChompParameters::ChompParameters()
   trajectory_initialization_method_ = std::string("quintic-spline");
   enable_failure_recovery_ = false;
   max_recovery_attempts_ = 5;
+  num_parallel_restarts_ = 1;
+  restart_noise_scale_ = 0.2;
 }
 
 ChompParameters::~ChompParameters()
@@ -41,8 +41,57 @@
 #include <moveit/robot_state/conversions.h>
 #include <moveit_msgs/MotionPlanRequest.h>
 
+#include <memory>
+
 namespace chomp
 {
+namespace
+{
+/* Optimize params.num_parallel_restarts_ copies of \e trajectory concurrently, all but the first perturbed with smooth
+   noise, and copy the collision free result of lowest cost back into \e trajectory (the result of lowest cost if none
+   is collision free). Returns false if the optimizers could not be initialized. */
+bool optimizeWithRestarts(ChompTrajectory& trajectory, const planning_scene::PlanningSceneConstPtr& planning_scene,
+                          const std::string& group_name, const ChompParameters& params,
+                          const moveit::core::RobotState& start_state, bool& optimization_result, bool& collision_free)
+{
+  const int restarts = params.num_parallel_restarts_;
+  std::vector<ChompTrajectory> trajectories(restarts, trajectory);
+  std::vector<std::unique_ptr<ChompOptimizer> > optimizers(restarts);
+
+  // the optimizers are created one after the other, as their noise generators are seeded with rand()
+  for (int k = 0; k < restarts; ++k)
+  {
+    optimizers[k].reset(new ChompOptimizer(&trajectories[k], planning_scene, group_name, &params, start_state));
+    if (!optimizers[k]->isInitialized())
+      return false;
+    if (k > 0)
+      optimizers[k]->perturbInitialTrajectory(params.restart_noise_scale_);
+  }
+
+  // nested OpenMP regions are serialized, so each optimizer runs single threaded inside this loop
+  std::vector<int> results(restarts, 0);
+#pragma omp parallel for schedule(dynamic)
+  for (int k = 0; k < restarts; ++k)
+    results[k] = optimizers[k]->optimize();
+
+  int best = 0;
+  for (int k = 1; k < restarts; ++k)
+  {
+    bool free = optimizers[k]->isCollisionFree();
+    bool best_free = optimizers[best]->isCollisionFree();
+    if ((free && !best_free) || (free == best_free && optimizers[k]->getBestCost() < optimizers[best]->getBestCost()))
+      best = k;
+  }
+  ROS_DEBUG_NAMED("chomp_planner", "Using the result of restart %d of %d, with cost %f", best + 1, restarts,
+                  optimizers[best]->getBestCost());
+
+  trajectory = trajectories[best];
+  optimization_result = results[best];
+  collision_free = optimizers[best]->isCollisionFree();
+  return true;
+}
+}
+
 ChompPlanner::ChompPlanner()
 {
 }
@@ -50,6 +99,22 @@ ChompPlanner::ChompPlanner()
 bool ChompPlanner::solve(const planning_scene::PlanningSceneConstPtr& planning_scene,
                          const moveit_msgs::MotionPlanRequest& req, const chomp::ChompParameters& params,
                          moveit_msgs::MotionPlanDetailedResponse& res) const
+{
+  return solve(planning_scene, req, params, static_cast<const trajectory_msgs::JointTrajectory*>(NULL), res);
+}
+
+bool ChompPlanner::solve(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                         const moveit_msgs::MotionPlanRequest& req, const chomp::ChompParameters& params,
+                         const trajectory_msgs::JointTrajectory& seed,
+                         moveit_msgs::MotionPlanDetailedResponse& res) const
+{
+  return solve(planning_scene, req, params, &seed, res);
+}
+
+bool ChompPlanner::solve(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                         const moveit_msgs::MotionPlanRequest& req, const chomp::ChompParameters& params,
+                         const trajectory_msgs::JointTrajectory* seed,
+                         moveit_msgs::MotionPlanDetailedResponse& res) const
 {
   if (!planning_scene)
   {
@@ -139,8 +204,21 @@ bool ChompPlanner::solve(const planning_scene::PlanningSceneConstPtr& planning_s
     return false;
   }
 
-  // fill in an initial trajectory based on user choice from the chomp_config.yaml file
-  if (params.trajectory_initialization_method_.compare("quintic-spline") == 0)
+  // fill in an initial trajectory from the seed, if one was given, or based on user choice from the
+  // chomp_config.yaml file
+  bool seeded = false;
+  if (seed)
+  {
+    seeded = trajectory.fillInFromTrajectory(*seed, active_joint_names);
+    if (!seeded)
+      ROS_WARN_STREAM_NAMED("chomp_planner", "Seed trajectory does not cover group '"
+                                                 << req.group_name << "'. Using "
+                                                 << params.trajectory_initialization_method_ << " initialization");
+  }
+  if (seeded)
+    ROS_DEBUG_NAMED("chomp_planner", "Initialized trajectory from a seed with %u waypoints",
+                    static_cast<unsigned int>(seed->points.size()));
+  else if (params.trajectory_initialization_method_.compare("quintic-spline") == 0)
     trajectory.fillInMinJerk();
   else if (params.trajectory_initialization_method_.compare("linear") == 0)
     trajectory.fillInLinearInterpolation();
@@ -167,7 +245,7 @@ bool ChompPlanner::solve(const planning_scene::PlanningSceneConstPtr& planning_s
   org_planning_time_limit = params.planning_time_limit_;
   org_max_iterations = params.max_iterations_;
 
-  ChompOptimizer* optimizer;
+  bool is_collision_free = false;
 
   // create a non_const_params variable which stores the non constant version of the const params variable
   ChompParameters params_nonconst = params_nonconst.getNonConstParams(params);
@@ -185,19 +263,31 @@ bool ChompPlanner::solve(const planning_scene::PlanningSceneConstPtr& planning_s
 
     // initialize a ChompOptimizer object to load up the optimizer with default parameters or with updated parameters in
     // case of a recovery behaviour
-    optimizer = new ChompOptimizer(&trajectory, planning_scene, req.group_name, &params_nonconst, start_state);
-    if (!optimizer->isInitialized())
+    bool optimization_result = false;
+    if (params_nonconst.num_parallel_restarts_ <= 1)
+    {
+      ChompOptimizer optimizer(&trajectory, planning_scene, req.group_name, &params_nonconst, start_state);
+      if (!optimizer.isInitialized())
+      {
+        ROS_ERROR_STREAM_NAMED("chomp_planner", "Could not initialize optimizer");
+        res.error_code.val = moveit_msgs::MoveItErrorCodes::PLANNING_FAILED;
+        return false;
+      }
+
+      ROS_DEBUG_NAMED("chomp_planner", "Optimization took %f sec to create",
+                      (ros::WallTime::now() - create_time).toSec());
+
+      optimization_result = optimizer.optimize();
+      is_collision_free = optimizer.isCollisionFree();
+    }
+    else if (!optimizeWithRestarts(trajectory, planning_scene, req.group_name, params_nonconst, start_state,
+                                   optimization_result, is_collision_free))
     {
       ROS_ERROR_STREAM_NAMED("chomp_planner", "Could not initialize optimizer");
       res.error_code.val = moveit_msgs::MoveItErrorCodes::PLANNING_FAILED;
       return false;
     }
 
-    ROS_DEBUG_NAMED("chomp_planner", "Optimization took %f sec to create",
-                    (ros::WallTime::now() - create_time).toSec());
-
-    bool optimization_result = optimizer->optimize();
-
     // replan with updated parameters if no solution is found
     if (params_nonconst.enable_failure_recovery_)
     {
@@ -212,8 +302,6 @@ bool ChompPlanner::solve(const planning_scene::PlanningSceneConstPtr& planning_s
       {
         replan_count++;
         replan_flag = true;
-        // delete ChompOptimizer object 'optimizer' to prevent a possible memory leak
-        delete optimizer;
       }
       else
       {
@@ -262,7 +350,7 @@ bool ChompPlanner::solve(const planning_scene::PlanningSceneConstPtr& planning_s
   res.processing_time.push_back((ros::WallTime::now() - start_time).toSec());
 
   // report planning failure if path has collisions
-  if (not optimizer->isCollisionFree())
+  if (not is_collision_free)
   {
     res.error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_MOTION_PLAN;
     return false;
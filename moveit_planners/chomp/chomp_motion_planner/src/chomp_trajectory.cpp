@@ -36,7 +36,9 @@
 
 #include <ros/ros.h>
 #include <chomp_motion_planner/chomp_trajectory.h>
+#include <algorithm>
 #include <iostream>
+#include <limits>
 
 namespace chomp
 {
@@ -207,6 +209,81 @@ void ChompTrajectory::fillInCubicInterpolation()
   }
 }
 
+bool ChompTrajectory::fillInFromTrajectory(const trajectory_msgs::JointTrajectory& seed,
+                                           const std::vector<std::string>& joint_names)
+{
+  if (seed.points.size() < 2 || joint_names.size() != static_cast<std::size_t>(num_joints_))
+    return false;
+
+  // map the columns of this trajectory to the seed's joint order
+  std::vector<std::size_t> seed_index(num_joints_);
+  for (int j = 0; j < num_joints_; j++)
+  {
+    std::vector<std::string>::const_iterator it =
+        std::find(seed.joint_names.begin(), seed.joint_names.end(), joint_names[j]);
+    if (it == seed.joint_names.end())
+      return false;
+    seed_index[j] = it - seed.joint_names.begin();
+  }
+  for (std::size_t k = 0; k < seed.points.size(); k++)
+    for (int j = 0; j < num_joints_; j++)
+      if (seed_index[j] >= seed.points[k].positions.size())
+        return false;
+
+  // cumulative joint-space arc length of the seed
+  std::vector<double> length(seed.points.size(), 0.0);
+  for (std::size_t k = 1; k < seed.points.size(); k++)
+  {
+    double d = 0.0;
+    for (int j = 0; j < num_joints_; j++)
+    {
+      double diff = seed.points[k].positions[seed_index[j]] - seed.points[k - 1].positions[seed_index[j]];
+      d += diff * diff;
+    }
+    length[k] = length[k - 1] + sqrt(d);
+  }
+
+  int start_index = start_index_ - 1;
+  int end_index = end_index_ + 1;
+  const double total = length.back();
+  std::vector<double> start_offset(num_joints_), end_offset(num_joints_);
+  for (int j = 0; j < num_joints_; j++)
+  {
+    start_offset[j] = (*this)(start_index, j) - seed.points.front().positions[seed_index[j]];
+    end_offset[j] = (*this)(end_index, j) - seed.points.back().positions[seed_index[j]];
+  }
+
+  std::size_t k = 0;
+  for (int i = start_index + 1; i < end_index; i++)
+  {
+    double s = static_cast<double>(i - start_index) / (end_index - start_index);
+    double alpha;
+    if (total > std::numeric_limits<double>::epsilon())
+    {
+      double target = s * total;
+      while (k + 2 < seed.points.size() && length[k + 1] < target)
+        k++;
+      double segment = length[k + 1] - length[k];
+      alpha = segment > std::numeric_limits<double>::epsilon() ? (target - length[k]) / segment : 0.0;
+    }
+    else
+    {
+      // a seed without any motion is interpolated by waypoint index
+      double position = s * (seed.points.size() - 1);
+      k = std::min(static_cast<std::size_t>(position), seed.points.size() - 2);
+      alpha = position - k;
+    }
+    alpha = std::max(0.0, std::min(1.0, alpha));
+    for (int j = 0; j < num_joints_; j++)
+    {
+      double from = seed.points[k].positions[seed_index[j]];
+      double to = seed.points[k + 1].positions[seed_index[j]];
+      (*this)(i, j) = from + alpha * (to - from) + (1.0 - s) * start_offset[j] + s * end_offset[j];
+    }
+  }
+  return true;
+}
+
 void ChompTrajectory::fillInMinJerk()
 {
   double start_index = start_index_ - 1;
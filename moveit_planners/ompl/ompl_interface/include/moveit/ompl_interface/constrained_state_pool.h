@@ -0,0 +1,153 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef MOVEIT_OMPL_INTERFACE_CONSTRAINED_STATE_POOL_
+#define MOVEIT_OMPL_INTERFACE_CONSTRAINED_STATE_POOL_
+
+#include <moveit/macros/class_forward.h>
+#include <moveit/constraint_samplers/constraint_sampler.h>
+#include <moveit/kinematic_constraints/kinematic_constraint.h>
+#include <moveit_msgs/Constraints.h>
+#include <ompl/util/RandomNumbers.h>
+#include <boost/thread.hpp>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace ompl_interface
+{
+MOVEIT_CLASS_FORWARD(ConstrainedStatePool);
+
+/** \brief An in-memory pool of group configurations that satisfy path constraints, kept per planning group and
+    constraint hash.
+
+    The first time a set of path constraints is planned with, a background thread starts filling the pool for it
+    from a constraint sampler. Planning then draws configurations from the pool instead of calling IK for every
+    sample, and keeps adding the ones it still computes itself, so the pool is refreshed as it is used. Only the
+    constraints are checked, not collisions, so pooled states remain useful when the scene changes; the planner
+    validates them like any other sample. Unlike the ConstraintsLibrary, nothing has to be computed offline. */
+class ConstrainedStatePool
+{
+public:
+  MOVEIT_CLASS_FORWARD(Entry);
+
+  /** \brief The configurations stored for one group and set of constraints. All functions are thread safe. */
+  class Entry
+  {
+  public:
+    Entry(const robot_model::JointModelGroup* group, std::size_t max_size);
+    ~Entry();
+
+    const robot_model::JointModelGroup* getJointModelGroup() const
+    {
+      return group_;
+    }
+
+    std::size_t size() const;
+
+    std::size_t getMaximumSize() const
+    {
+      return max_size_;
+    }
+
+    /** \brief Copy a random stored configuration (in the order of the group's variables) to \e values. Returns
+        false if the entry is empty. */
+    bool sample(ompl::RNG& rng, std::vector<double>& values) const;
+
+    /** \brief Store a configuration known to satisfy the constraints; once the entry is full, a random stored
+        configuration is replaced */
+    void add(const std::vector<double>& values);
+
+    /** \brief True while the background thread is still filling this entry */
+    bool isFilling() const
+    {
+      return filling_;
+    }
+
+  private:
+    friend class ConstrainedStatePool;
+
+    void fill(constraint_samplers::ConstraintSamplerPtr sampler,
+              kinematic_constraints::KinematicConstraintSetPtr constraints, robot_state::RobotState reference_state);
+
+    const robot_model::JointModelGroup* group_;
+    std::size_t max_size_;
+    std::vector<std::vector<double> > states_;
+    std::size_t next_replaced_;
+    mutable boost::mutex lock_;
+
+    boost::thread fill_thread_;
+    std::atomic<bool> filling_;
+    std::atomic<bool> stop_;
+  };
+
+  ConstrainedStatePool(std::size_t max_states_per_entry = 1000);
+
+  /** \brief Stops the threads still filling entries */
+  ~ConstrainedStatePool();
+
+  /** \brief The key states sampled for \e constraints on \e group are stored under. Header stamps and the
+      constraint name do not change the key. */
+  static std::string getKey(const std::string& group, const moveit_msgs::Constraints& constraints);
+
+  /** \brief Get the entry for \e key, or an empty pointer if it has not been requested yet */
+  EntryPtr getEntry(const std::string& key) const;
+
+  /** \brief Get the entry for \e key, creating it if needed. A new entry is filled in the background by drawing
+      from \e sampler, which the pool takes over and must not be used elsewhere, starting from \e reference_state.
+      Only samples that satisfy \e constraints are stored. */
+  EntryPtr requestEntry(const std::string& key, const constraint_samplers::ConstraintSamplerPtr& sampler,
+                        const kinematic_constraints::KinematicConstraintSetPtr& constraints,
+                        const robot_state::RobotState& reference_state);
+
+  std::size_t getMaximumStatesPerEntry() const
+  {
+    return max_states_per_entry_;
+  }
+
+  /** \brief Number of entries */
+  std::size_t size() const;
+
+  /** \brief Stop filling and drop all entries */
+  void clear();
+
+private:
+  std::size_t max_states_per_entry_;
+  std::map<std::string, EntryPtr> entries_;
+  mutable boost::mutex lock_;
+};
+}
+
+#endif
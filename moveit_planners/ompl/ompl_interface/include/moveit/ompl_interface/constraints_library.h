@@ -43,6 +43,9 @@
 #include <ompl/base/StateStorage.h>
 #include <boost/function.hpp>
 #include <boost/serialization/map.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/cstdint.hpp>
 
 namespace ompl_interface
 {
@@ -50,6 +53,81 @@ typedef std::pair<std::vector<std::size_t>, std::map<std::size_t, std::pair<std:
     ConstrainedStateMetadata;
 typedef ompl::base::StateStorageWithMetadata<ConstrainedStateMetadata> ConstraintApproximationStateStorage;
 
+MOVEIT_CLASS_FORWARD(ConstraintApproximationDatabase)
+
+/** \brief Read-only, memory-mapped view of a constraint approximation stored in the binary database format.
+
+    States stay in their serialized form inside the mapped file and are only copied out when a sampler asks for
+    them, so opening a database costs a single mmap() and the pages are shared by every process mapping the same
+    file. The milestone graph is stored as flat, index-addressed arrays next to the states. */
+class ConstraintApproximationDatabase
+{
+public:
+  /** \brief Version of the binary layout; files written with a different version are rejected */
+  static const boost::uint32_t VERSION;
+
+  /** \brief Write \e storage to \e filename in the binary database format */
+  static bool store(const ConstraintApproximationStateStorage& storage, const std::string& filename);
+
+  /** \brief Map \e filename read-only. Returns an empty pointer if the file is missing, truncated, has a
+      different version or was written for a state space whose signature differs from that of \e space */
+  static ConstraintApproximationDatabasePtr open(const std::string& filename, const ompl::base::StateSpacePtr& space);
+
+  const ompl::base::StateSpacePtr& getStateSpace() const
+  {
+    return space_;
+  }
+
+  /** \brief Number of stored states (milestones and explicit motion states) */
+  std::size_t size() const
+  {
+    return state_count_;
+  }
+
+  /** \brief Total number of milestone connections */
+  std::size_t getConnectionCount() const
+  {
+    return neighbor_count_;
+  }
+
+  /** \brief Deserialize the stored state \e index into \e state (including its tag) */
+  void copyState(ompl::base::State* state, std::size_t index) const;
+
+  std::size_t getNeighborCount(std::size_t index) const
+  {
+    return neighbor_offsets_[index + 1] - neighbor_offsets_[index];
+  }
+
+  std::size_t getNeighbor(std::size_t index, std::size_t k) const
+  {
+    return neighbors_[neighbor_offsets_[index] + k];
+  }
+
+  /** \brief Look up the range of explicit motion states stored for the edge \e from -> \e to */
+  bool getMotion(std::size_t from, std::size_t to, std::size_t& first, std::size_t& last) const;
+
+  /** \brief Copy the mapped data into a regular state storage (used when re-saving in the OMPL format) */
+  ompl::base::StateStoragePtr toStateStorage() const;
+
+private:
+  ConstraintApproximationDatabase(const std::string& filename, const ompl::base::StateSpacePtr& space);
+
+  bool parse();
+
+  ompl::base::StateSpacePtr space_;
+  boost::interprocess::file_mapping file_;
+  boost::interprocess::mapped_region region_;
+
+  std::size_t state_count_;
+  std::size_t state_size_;
+  std::size_t neighbor_count_;
+  const boost::uint64_t* neighbor_offsets_;
+  const boost::uint64_t* neighbors_;
+  const boost::uint64_t* motion_offsets_;
+  const boost::uint64_t* motions_;
+  const char* states_;
+};
+
 MOVEIT_CLASS_FORWARD(ConstraintApproximation)
 
 class ConstraintApproximation
@@ -59,6 +137,11 @@ public:
                           bool explicit_motions, const moveit_msgs::Constraints& msg, const std::string& filename,
                           const ompl::base::StateStoragePtr& storage, std::size_t milestones = 0);
 
+  /** \brief Construct an approximation backed by a memory-mapped database instead of an in-memory storage */
+  ConstraintApproximation(const std::string& group, const std::string& state_space_parameterization,
+                          bool explicit_motions, const moveit_msgs::Constraints& msg, const std::string& filename,
+                          const ConstraintApproximationDatabasePtr& database, std::size_t milestones = 0);
+
   virtual ~ConstraintApproximation()
   {
   }
@@ -102,11 +185,18 @@ public:
     return constraint_msg_;
   }
 
-  const ompl::base::StateStoragePtr& getStateStorage() const
+  /** \brief Get the in-memory state storage. For approximations backed by a mapped database this copies the
+      mapped states the first time it is called. */
+  const ompl::base::StateStoragePtr& getStateStorage() const;
+
+  const ConstraintApproximationDatabasePtr& getDatabase() const
   {
-    return state_storage_ptr_;
+    return database_;
   }
 
+  /** \brief Number of stored states, regardless of how they are backed */
+  std::size_t getStateCount() const;
+
   const std::string& getFilename() const
   {
     return ompldb_filename_;
@@ -122,8 +212,9 @@ protected:
   std::vector<int> space_signature_;
 
   std::string ompldb_filename_;
-  ompl::base::StateStoragePtr state_storage_ptr_;
+  mutable ompl::base::StateStoragePtr state_storage_ptr_;
   ConstraintApproximationStateStorage* state_storage_;
+  ConstraintApproximationDatabasePtr database_;
   std::size_t milestones_;
 };
 
@@ -136,6 +227,8 @@ struct ConstraintApproximationConstructionOptions
     , explicit_motions(false)
     , explicit_points_resolution(0.0)
     , max_explicit_points(0)
+    , threads(0)
+    , extend_existing(false)
   {
   }
 
@@ -146,6 +239,13 @@ struct ConstraintApproximationConstructionOptions
   bool explicit_motions;
   double explicit_points_resolution;
   unsigned int max_explicit_points;
+
+  /// number of threads sampling states and validating edges (0 means one per hardware thread)
+  unsigned int threads;
+
+  /// if an approximation with the same name, group and options exists, keep its milestones and connections and add
+  /// states until there are \e samples milestones, connecting only the new ones
+  bool extend_existing;
 };
 
 struct ConstraintApproximationConstructionResults
@@ -193,7 +293,7 @@ private:
   ompl::base::StateStoragePtr constructConstraintApproximation(
       const ModelBasedPlanningContextPtr& pcontext, const moveit_msgs::Constraints& constr_sampling,
       const moveit_msgs::Constraints& constr_hard, const ConstraintApproximationConstructionOptions& options,
-      ConstraintApproximationConstructionResults& result);
+      const ConstraintApproximationPtr& previous, ConstraintApproximationConstructionResults& result);
 
   const PlanningContextManager& context_manager_;
   std::map<std::string, ConstraintApproximationPtr> constraint_approximations_;
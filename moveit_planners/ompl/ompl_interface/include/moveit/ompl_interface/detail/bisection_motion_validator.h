@@ -0,0 +1,91 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#ifndef MOVEIT_OMPL_INTERFACE_DETAIL_BISECTION_MOTION_VALIDATOR_
+#define MOVEIT_OMPL_INTERFACE_DETAIL_BISECTION_MOTION_VALIDATOR_
+
+#include <ompl/base/DiscreteMotionValidator.h>
+#include <boost/thread/tss.hpp>
+
+namespace ompl_interface
+{
+class ModelBasedPlanningContext;
+
+/** @class BisectionMotionValidator
+    @brief A motion validator that checks the states along a motion in bisection order.
+
+    The end state is checked first, then the midpoint of the motion, then the midpoints of both halves, and so on,
+    so collisions in the middle of long motions are found after a few checks. Unlike the discrete validator of OMPL,
+    the variant of checkMotion() that reports the last valid state uses this order as well: once an invalid state is
+    found, only the states before it remain to be checked. Each thread reuses one state for the interpolation, and
+    the state validity checker converts it into its own per-thread robot state, so the self collision broadphase of
+    that thread is updated incrementally from one state to the next. */
+class BisectionMotionValidator : public ompl::base::DiscreteMotionValidator
+{
+public:
+  BisectionMotionValidator(const ModelBasedPlanningContext* planning_context);
+
+  virtual bool checkMotion(const ompl::base::State* s1, const ompl::base::State* s2) const;
+
+  virtual bool checkMotion(const ompl::base::State* s1, const ompl::base::State* s2,
+                           std::pair<ompl::base::State*, double>& lastValid) const;
+
+protected:
+  /** \brief The interpolation state of one thread */
+  struct Scratch
+  {
+    Scratch(const ompl::base::StateSpacePtr& space) : space(space), state(space->allocState())
+    {
+    }
+
+    ~Scratch()
+    {
+      space->freeState(state);
+    }
+
+    ompl::base::StateSpacePtr space;
+    ompl::base::State* state;
+  };
+
+  /** \brief Find the first invalid state among the states j / \e nd, 0 < j < \e limit, of the motion from \e s1 to
+      \e s2. If \e first is false, stop at any invalid state instead. Return \e limit if all states are valid. */
+  unsigned int findInvalidState(const ompl::base::State* s1, const ompl::base::State* s2, unsigned int nd,
+                                unsigned int limit, bool first) const;
+
+  mutable boost::thread_specific_ptr<Scratch> scratch_;
+};
+}
+
+#endif
@@ -0,0 +1,113 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#ifndef MOVEIT_OMPL_INTERFACE_DETAIL_CLEARANCE_FIELD_
+#define MOVEIT_OMPL_INTERFACE_DETAIL_CLEARANCE_FIELD_
+
+#include <moveit/collision_detection/world.h>
+#include <moveit/distance_field/propagation_distance_field.h>
+#include <moveit/macros/class_forward.h>
+#include <moveit/robot_state/robot_state.h>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace ompl_interface
+{
+MOVEIT_CLASS_FORWARD(ClearanceField);
+
+/** @class ClearanceField
+    @brief Approximate clearance of the robot from the world, answered from a distance field.
+
+    The world objects are rasterized into a PropagationDistanceField, which update() keeps in sync with the world by
+    only adding and removing the objects that changed. The links of a group and the bodies attached to them are
+    approximated by spheres along their bounding cylinders, so the clearance of a state costs one distance field
+    lookup per sphere, instead of an exact distance query. Self distances are not considered. */
+class ClearanceField
+{
+public:
+  /** \brief Create an empty field with cells of size \e resolution that propagates distances up to \e max_distance */
+  ClearanceField(double resolution, double max_distance);
+
+  double getResolution() const
+  {
+    return resolution_;
+  }
+
+  double getMaxDistance() const
+  {
+    return max_distance_;
+  }
+
+  /** \brief Bring the distance field up to date with the objects in \e world, inside the box spanned by \e min and \e
+      max. Only objects that changed since the last update are added or removed, unless the box changes. */
+  void update(const collision_detection::World& world, const Eigen::Vector3d& min, const Eigen::Vector3d& max);
+
+  /** \brief Use spheres for the links updated by \e group and the bodies attached to them in \e state */
+  void setRobot(const robot_state::RobotState& state, const robot_model::JointModelGroup* group);
+
+  /** \brief The approximate distance between the robot spheres and the world in \e state, whose link transforms must
+      be up to date. This is 0 if a sphere penetrates an object and infinity if the world is empty. */
+  double getClearance(const robot_state::RobotState& state) const;
+
+private:
+  struct Sphere
+  {
+    const robot_model::LinkModel* link;
+    Eigen::Vector3d center;
+    double radius;
+  };
+
+  /** \brief The shapes of an object as they were added to the field */
+  struct FieldObject
+  {
+    std::vector<shapes::ShapeConstPtr> shapes;
+    EigenSTL::vector_Affine3d poses;
+  };
+
+  void addObject(const std::string& id, const collision_detection::World::Object& object);
+  void removeObject(std::map<std::string, FieldObject>::iterator it);
+
+  double resolution_;
+  double max_distance_;
+  Eigen::Vector3d min_;
+  Eigen::Vector3d max_;
+  std::unique_ptr<distance_field::PropagationDistanceField> field_;
+  std::map<std::string, FieldObject> objects_;
+  std::vector<Sphere> spheres_;
+};
+}
+
+#endif
@@ -38,11 +38,15 @@
 #define MOVEIT_OMPL_INTERFACE_DETAIL_CONSTRAINED_GOAL_SAMPLER_
 
 #include <ompl/base/goals/GoalLazySamples.h>
+#include <ompl/base/ScopedState.h>
+#include <boost/thread/tss.hpp>
 #include <moveit/kinematic_constraints/kinematic_constraint.h>
 #include <moveit/constraint_samplers/constraint_sampler.h>
 
 #include <moveit/robot_state/robot_state.h>
 #include <moveit/robot_model/joint_model_group.h>
+#include <moveit/ompl_interface/detail/threadsafe_state_storage.h>
+#include <moveit/ompl_interface/goal_sample_cache.h>
 
 namespace ompl_interface
 {
@@ -53,14 +57,17 @@ class ModelBasedPlanningContext;
 class ConstrainedGoalSampler : public ompl::base::GoalLazySamples
 {
 public:
+  /** \brief If the planning context has a goal sample cache, the goals cached under \e cache_key are tried before
+      the constraint sampler is called, and the goals sampled are added there */
   ConstrainedGoalSampler(
       const ModelBasedPlanningContext* pc, const kinematic_constraints::KinematicConstraintSetPtr& ks,
-      const constraint_samplers::ConstraintSamplerPtr& cs = constraint_samplers::ConstraintSamplerPtr());
+      const constraint_samplers::ConstraintSamplerPtr& cs = constraint_samplers::ConstraintSamplerPtr(),
+      const std::string& cache_key = std::string());
 
 private:
   bool sampleUsingConstraintSampler(const ompl::base::GoalLazySamples* gls, ompl::base::State* new_goal);
-  bool stateValidityCallback(ompl::base::State* new_goal, robot_state::RobotState const* state,
-                             const robot_model::JointModelGroup*, const double*, bool verbose = false) const;
+  bool stateValidityCallback(robot_state::RobotState const* state, const robot_model::JointModelGroup*,
+                             const double*, bool verbose = false) const;
   bool checkStateValidity(ompl::base::State* new_goal, const robot_state::RobotState& state,
                           bool verbose = false) const;
 
@@ -69,6 +76,14 @@ private:
   constraint_samplers::ConstraintSamplerPtr constraint_sampler_;
   ompl::base::StateSamplerPtr default_sampler_;
   robot_state::RobotState work_state_;
+  TSStateStorage solution_states_;
+  // scratch OMPL states for the validity callback, which the constraint sampler may call from several threads
+  mutable boost::thread_specific_ptr<ompl::base::ScopedState<> > scratch_goals_;
+  std::vector<robot_state::RobotStatePtr> sampled_goals_;  // drawn by the constraint sampler but not yet used
+  GoalSampleCachePtr goal_sample_cache_;
+  std::string cache_key_;
+  std::vector<std::vector<double> > cached_goals_;  // goals of earlier attempts not yet tried
+  std::vector<double> goal_values_;
   unsigned int invalid_sampled_constraints_;
   bool warned_invalid_samples_;
   unsigned int verbose_display_;
@@ -39,6 +39,7 @@
 
 #include <ompl/base/StateSampler.h>
 #include <moveit/constraint_samplers/constraint_sampler.h>
+#include <moveit/ompl_interface/constrained_state_pool.h>
 
 namespace ompl_interface
 {
@@ -52,8 +53,11 @@ public:
   /** @brief Default constructor
    *  @param pg The planning group
    *  @param cs A pointer to a kinematic constraint sampler
+   *  @param pool_entry If set, samples are mostly drawn from this pool entry, and the samples computed by \e cs are
+   *         added to it
    */
-  ConstrainedSampler(const ModelBasedPlanningContext* pc, const constraint_samplers::ConstraintSamplerPtr& cs);
+  ConstrainedSampler(const ModelBasedPlanningContext* pc, const constraint_samplers::ConstraintSamplerPtr& cs,
+                     const ConstrainedStatePool::EntryPtr& pool_entry = ConstrainedStatePool::EntryPtr());
 
   /** @brief Sample a state (uniformly)*/
   virtual void sampleUniform(ompl::base::State* state);
@@ -68,10 +72,13 @@ public:
 
 private:
   bool sampleC(ompl::base::State* state);
+  bool samplePool(ompl::base::State* state);
 
   const ModelBasedPlanningContext* planning_context_;
   ompl::base::StateSamplerPtr default_;
   constraint_samplers::ConstraintSamplerPtr constraint_sampler_;
+  ConstrainedStatePool::EntryPtr pool_entry_;
+  std::vector<double> pool_values_;
   robot_state::RobotState work_state_;
   unsigned int constrained_success_;
   unsigned int constrained_failure_;
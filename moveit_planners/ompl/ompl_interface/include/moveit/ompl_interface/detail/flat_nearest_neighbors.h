@@ -0,0 +1,272 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef MOVEIT_OMPL_INTERFACE_DETAIL_FLAT_NEAREST_NEIGHBORS_
+#define MOVEIT_OMPL_INTERFACE_DETAIL_FLAT_NEAREST_NEIGHBORS_
+
+#include <moveit/ompl_interface/parameterization/model_based_state_space.h>
+#include <ompl/datastructures/NearestNeighbors.h>
+#include <ompl/util/Exception.h>
+#include <boost/math/constants/constants.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace ompl_interface
+{
+/** @class FlatDistanceLayout
+    @brief Describes the distance of a ModelBasedStateSpace as a weighted sum over its state values.
+
+    This holds for joint space parameterizations of groups that consist of revolute and prismatic joints only. The
+    values of continuous joints wrap around at 2 pi. */
+struct FlatDistanceLayout
+{
+  /** \brief The distance factor of each state value */
+  std::vector<double> factors;
+
+  /** \brief Whether each state value belongs to a continuous joint */
+  std::vector<char> continuous;
+
+  /** \brief Compute the layout of \e space. Returns false if its distance is not a weighted sum over its values. */
+  bool compute(const ompl::base::StateSpace* space);
+
+  bool empty() const
+  {
+    return factors.empty();
+  }
+
+  /** \brief The layout picked up by FlatNearestNeighbors instances constructed in the calling thread, if any */
+  static const FlatDistanceLayout* current();
+
+  /** \brief Make \e layout current for the calling thread while this object exists */
+  class Scope
+  {
+  public:
+    Scope(const FlatDistanceLayout* layout);
+    ~Scope();
+
+  private:
+    const FlatDistanceLayout* previous_;
+  };
+};
+
+/** @class FlatNearestNeighbors
+    @brief Exact nearest neighbors for the motions of OMPL's tree planners, kept in flat arrays.
+
+    The state values of the stored motions are copied into one contiguous array per state value, so a query computes
+    the distances to all motions with a few tight loops the compiler can vectorize, without calling through the
+    planner's distance function for every motion. Elements must expose the planner state as \e element->state, which
+    is the case for the Motion types of RRT, RRTConnect, LazyRRT, TRRT, BiTRRT and RRTstar.
+
+    The layout is taken from FlatDistanceLayout::current() at construction. Without a layout the distance function set
+    by the planner is used, which makes this a plain linear scan. Queries reuse internal buffers and must not be made
+    concurrently. */
+template <typename _T>
+class FlatNearestNeighbors : public ompl::NearestNeighbors<_T>
+{
+public:
+  FlatNearestNeighbors()
+  {
+    const FlatDistanceLayout* layout = FlatDistanceLayout::current();
+    if (layout)
+      layout_ = *layout;
+    columns_.resize(layout_.factors.size());
+  }
+
+  void clear() override
+  {
+    data_.clear();
+    for (std::size_t v = 0; v < columns_.size(); ++v)
+      columns_[v].clear();
+  }
+
+  bool reportsSortedResults() const override
+  {
+    return true;
+  }
+
+  void add(const _T& data) override
+  {
+    data_.push_back(data);
+    if (!columns_.empty())
+    {
+      const double* values = getValues(data);
+      for (std::size_t v = 0; v < columns_.size(); ++v)
+        columns_[v].push_back(values[v]);
+    }
+  }
+
+  void add(const std::vector<_T>& data) override
+  {
+    data_.reserve(data_.size() + data.size());
+    for (std::size_t v = 0; v < columns_.size(); ++v)
+      columns_[v].reserve(data_.size() + data.size());
+    for (std::size_t i = 0; i < data.size(); ++i)
+      add(data[i]);
+  }
+
+  bool remove(const _T& data) override
+  {
+    for (std::size_t i = data_.size(); i > 0; --i)
+      if (data_[i - 1] == data)
+      {
+        // keep the arrays dense by moving the last element into the freed slot
+        data_[i - 1] = data_.back();
+        data_.pop_back();
+        for (std::size_t v = 0; v < columns_.size(); ++v)
+        {
+          columns_[v][i - 1] = columns_[v].back();
+          columns_[v].pop_back();
+        }
+        return true;
+      }
+    return false;
+  }
+
+  _T nearest(const _T& data) const override
+  {
+    if (data_.empty())
+      throw ompl::Exception("No elements found in nearest neighbors data structure");
+    computeDistances(data);
+    return data_[std::min_element(distances_.begin(), distances_.end()) - distances_.begin()];
+  }
+
+  void nearestK(const _T& data, std::size_t k, std::vector<_T>& nbh) const override
+  {
+    nbh.clear();
+    if (k == 0 || data_.empty())
+      return;
+    computeDistances(data);
+    order_.resize(data_.size());
+    for (std::size_t i = 0; i < order_.size(); ++i)
+      order_[i] = i;
+    k = std::min(k, order_.size());
+    std::partial_sort(order_.begin(), order_.begin() + k, order_.end(), CompareDistances(distances_));
+    nbh.reserve(k);
+    for (std::size_t i = 0; i < k; ++i)
+      nbh.push_back(data_[order_[i]]);
+  }
+
+  void nearestR(const _T& data, double radius, std::vector<_T>& nbh) const override
+  {
+    nbh.clear();
+    if (data_.empty())
+      return;
+    computeDistances(data);
+    order_.clear();
+    for (std::size_t i = 0; i < distances_.size(); ++i)
+      if (distances_[i] <= radius)
+        order_.push_back(i);
+    std::sort(order_.begin(), order_.end(), CompareDistances(distances_));
+    nbh.reserve(order_.size());
+    for (std::size_t i = 0; i < order_.size(); ++i)
+      nbh.push_back(data_[order_[i]]);
+  }
+
+  std::size_t size() const override
+  {
+    return data_.size();
+  }
+
+  void list(std::vector<_T>& data) const override
+  {
+    data = data_;
+  }
+
+private:
+  struct CompareDistances
+  {
+    CompareDistances(const std::vector<double>& distances) : distances_(distances)
+    {
+    }
+
+    bool operator()(std::size_t a, std::size_t b) const
+    {
+      return distances_[a] < distances_[b];
+    }
+
+    const std::vector<double>& distances_;
+  };
+
+  static const double* getValues(const _T& data)
+  {
+    return static_cast<const ModelBasedStateSpace::StateType*>(data->state)->values;
+  }
+
+  /** \brief Fill distances_ with the distance from \e data to every stored element */
+  void computeDistances(const _T& data) const
+  {
+    const std::size_t n = data_.size();
+    if (columns_.empty())
+    {
+      distances_.resize(n);
+      for (std::size_t i = 0; i < n; ++i)
+        distances_[i] = this->distFun_(data, data_[i]);
+      return;
+    }
+
+    const double two_pi = boost::math::constants::two_pi<double>();
+    const double* query = getValues(data);
+    distances_.assign(n, 0.0);
+    double* d = distances_.data();
+    for (std::size_t v = 0; v < columns_.size(); ++v)
+    {
+      const double* column = columns_[v].data();
+      const double q = query[v];
+      const double factor = layout_.factors[v];
+      if (layout_.continuous[v])
+        for (std::size_t i = 0; i < n; ++i)
+        {
+          double dv = std::fabs(column[i] - q);
+          if (dv >= two_pi)
+            dv = std::fmod(dv, two_pi);
+          d[i] += factor * std::min(dv, two_pi - dv);
+        }
+      else
+        for (std::size_t i = 0; i < n; ++i)
+          d[i] += factor * std::fabs(column[i] - q);
+    }
+  }
+
+  FlatDistanceLayout layout_;
+  std::vector<_T> data_;
+  std::vector<std::vector<double> > columns_;
+
+  mutable std::vector<double> distances_;
+  mutable std::vector<std::size_t> order_;
+};
+}
+
+#endif
@@ -0,0 +1,80 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef MOVEIT_OMPL_INTERFACE_DETAIL_MANIPULABILITY_OBJECTIVE_
+#define MOVEIT_OMPL_INTERFACE_DETAIL_MANIPULABILITY_OBJECTIVE_
+
+#include <moveit/kinematics_metrics/kinematics_metrics.h>
+#include <ompl/base/objectives/StateCostIntegralObjective.h>
+#include <boost/thread/tss.hpp>
+#include <vector>
+
+namespace ompl_interface
+{
+class ModelBasedPlanningContext;
+
+/** @class ManipulabilityObjective
+    @brief Prefer paths along which the manipulability index of the planning group is high.
+
+    The cost of a state is 1 / (epsilon + manipulability index), integrated along the path. The cost of a motion is
+    evaluated on states interpolated along it, and all of them are passed to KinematicsMetrics at once, so the
+    Jacobian and robot state storage of each thread is reused from one motion to the next. */
+class ManipulabilityObjective : public ompl::base::StateCostIntegralObjective
+{
+public:
+  ManipulabilityObjective(const ModelBasedPlanningContext* planning_context, bool translation = false);
+
+  virtual ompl::base::Cost stateCost(const ompl::base::State* state) const;
+
+  virtual ompl::base::Cost motionCost(const ompl::base::State* s1, const ompl::base::State* s2) const;
+
+private:
+  struct Scratch
+  {
+    std::vector<robot_state::RobotState> states;
+    std::vector<const robot_state::RobotState*> state_pointers;
+    std::vector<double> indices;
+  };
+
+  Scratch& getScratch(std::size_t state_count) const;
+  ompl::base::Cost costFromIndex(double manipulability_index) const;
+
+  const ModelBasedPlanningContext* planning_context_;
+  kinematics_metrics::KinematicsMetrics metrics_;
+  bool translation_;
+  mutable boost::thread_specific_ptr<Scratch> scratch_;
+};
+}
+
+#endif
@@ -76,6 +76,31 @@ private:
   const ModelBasedPlanningContext* planning_context_;
   std::vector<unsigned int> variables_;
 };
+
+/** @class ProjectionEvaluatorPCA
+    @brief Projects states onto the principal components of the joint values of valid states, sampled when the
+    projection is first set up for a group. The components are cached for the group, so later planning contexts of
+    the same group reuse them. */
+class ProjectionEvaluatorPCA : public ompl::base::ProjectionEvaluator
+{
+public:
+  ProjectionEvaluatorPCA(const ModelBasedPlanningContext* pc, unsigned int dimension);
+
+  virtual unsigned int getDimension() const;
+  virtual void defaultCellSizes();
+  virtual void setup();
+  virtual void project(const ompl::base::State* state, ompl::base::EuclideanProjection& projection) const;
+
+private:
+  /** \brief Sample valid states and compute their principal components, unless cached for the group */
+  void computeComponents();
+
+  const ModelBasedPlanningContext* planning_context_;
+  unsigned int dimension_;
+  Eigen::VectorXd mean_;
+  // one principal component per row, scaled so unit steps in the projection are one standard deviation apart
+  Eigen::MatrixXd components_;
+};
 }
 
 #endif
@@ -0,0 +1,135 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#ifndef MOVEIT_OMPL_INTERFACE_DETAIL_STATE_VALIDITY_CACHE_
+#define MOVEIT_OMPL_INTERFACE_DETAIL_STATE_VALIDITY_CACHE_
+
+#include <boost/thread.hpp>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace ompl_interface
+{
+/** @class StateValidityCache
+    @brief A bounded, per-thread cache of state validity results.
+
+    States are identified by their variable values quantized to a given resolution, so states that differ by less
+    than the resolution share their results. Every thread owns a fixed size table in which each state maps to a single
+    slot, so new results simply replace older ones and no locks are taken after a thread's first access. clear()
+    invalidates the results of all threads at once. */
+class StateValidityCache
+{
+public:
+  /** \brief The results known for a state */
+  struct Result
+  {
+    Result()
+      : validity_known(false)
+      , valid(false)
+      , distance_known(false)
+      , distance(0.0)
+      , clearance_known(false)
+      , clearance(0.0)
+    {
+    }
+
+    bool validity_known;
+    bool valid;
+    bool distance_known;
+    double distance;
+    bool clearance_known;
+    double clearance;
+  };
+
+  /** \brief Cache results for states with \e dimension variables. At most \e size results (rounded up to a power of
+      two) are kept per thread. */
+  StateValidityCache(std::size_t dimension, std::size_t size, double resolution);
+  ~StateValidityCache();
+
+  /** \brief Retrieve the results known for the state with variable values \e values. Returns false if there are
+      none. */
+  bool lookup(const double* values, Result& result) const;
+
+  /** \brief Add the known parts of \e result to the results of the state with variable values \e values */
+  void store(const double* values, const Result& result) const;
+
+  /** \brief Forget all results, in all threads */
+  void clear();
+
+  std::size_t getSize() const
+  {
+    return size_;
+  }
+
+  double getResolution() const
+  {
+    return resolution_;
+  }
+
+private:
+  struct Entry
+  {
+    std::uint64_t generation;
+    Result result;
+  };
+
+  struct Table
+  {
+    std::vector<std::int64_t> keys;
+    std::vector<Entry> entries;
+
+    // the key of the state being looked up
+    std::vector<std::int64_t> scratch;
+  };
+
+  Table& getTable() const;
+
+  std::uint64_t quantize(const double* values, std::int64_t* key) const;
+
+  std::size_t dimension_;
+  std::size_t size_;
+  double resolution_;
+
+  // results stored before the last clear() have an older generation; 0 marks never used slots
+  std::atomic<std::uint64_t> generation_;
+
+  mutable std::map<boost::thread::id, Table*> tables_;
+  mutable boost::shared_mutex lock_;
+};
+}
+
+#endif
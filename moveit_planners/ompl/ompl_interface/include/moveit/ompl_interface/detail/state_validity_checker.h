@@ -38,8 +38,11 @@
 #define MOVEIT_OMPL_INTERFACE_DETAIL_STATE_VALIDITY_CHECKER_
 
 #include <moveit/ompl_interface/detail/threadsafe_state_storage.h>
+#include <moveit/ompl_interface/detail/state_validity_cache.h>
+#include <moveit/ompl_interface/detail/clearance_field.h>
 #include <moveit/collision_detection/collision_common.h>
 #include <ompl/base/StateValidityChecker.h>
+#include <memory>
 
 namespace ompl_interface
 {
@@ -70,7 +73,45 @@ public:
 
   void setVerbose(bool flag);
 
+  /** \brief Screen states with bounding spheres before checking them for collisions with the world. If the padded
+      bounding spheres of the robot links and attached bodies are clear of the bounding spheres of all world objects,
+      the robot cannot touch the world and only self collisions are checked exactly. Otherwise, or if the world
+      contains unbounded objects, the exact check runs as usual. Only the checks without distance are screened. */
+  void setLazyCollisionChecking(bool flag);
+
+  /** \brief Remember the validity, distance and clearance of up to \e size states per thread, identifying states by
+      their variable values quantized to \e resolution. A \e size of 0 disables the cache. Unlike the validity flags
+      kept in the states themselves, these results are shared by all states with the same quantized values. Results
+      are never returned for verbose checks. The cache only lives as long as this checker, which is created again
+      whenever its planning context is configured for a (possibly changed) planning scene. */
+  void setValidityCache(std::size_t size, double resolution);
+
+  /** \brief Forget all cached results, e.g. after the planning scene used by the context changed */
+  void clearValidityCache();
+
+  /** \brief Answer clearance() from \e field instead of an exact distance query. The field must be up to date with
+      the world of the planning scene and use the spheres of this group. Only the distance to the world is reported
+      then, self distances are ignored. Passing a null pointer restores the exact queries. */
+  void setClearanceField(const ClearanceFieldConstPtr& field);
+
 protected:
+  /** \brief A bounding sphere, defined in the frame of \e link (or the world frame if there is no link) */
+  struct BoundingSphere
+  {
+    const robot_model::LinkModel* link;
+    Eigen::Vector3d center;
+    double radius;
+  };
+
+  /** \brief Compute the bounding spheres of the robot and the world objects used by the lazy collision checks */
+  void computeBoundingSpheres();
+
+  /** \brief Check whether all robot bounding spheres are clear of all world bounding spheres in \e state */
+  bool isClearOfWorld(const robot_state::RobotState& state) const;
+
+  /** \brief Check \e state for collisions, screening it first if lazy collision checking is enabled */
+  bool isCollisionFree(robot_state::RobotState& state, bool verbose) const;
+
   bool isValidWithoutCache(const ompl::base::State* state, bool verbose) const;
   bool isValidWithoutCache(const ompl::base::State* state, double& dist, bool verbose) const;
 
@@ -87,6 +128,14 @@ protected:
 
   collision_detection::CollisionRequest collision_request_with_cost_;
   bool verbose_;
+
+  bool lazy_collision_checking_;
+  std::vector<BoundingSphere> robot_spheres_;
+  std::vector<BoundingSphere> world_spheres_;
+
+  std::unique_ptr<StateValidityCache> validity_cache_;
+
+  ClearanceFieldConstPtr clearance_field_;
 };
 }
 
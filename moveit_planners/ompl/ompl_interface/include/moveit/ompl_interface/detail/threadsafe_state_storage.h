@@ -54,7 +54,7 @@ public:
 private:
   robot_state::RobotState start_state_;
   mutable std::map<boost::thread::id, robot_state::RobotState*> thread_states_;
-  mutable boost::mutex lock_;
+  mutable boost::shared_mutex lock_;
 };
 }
 #endif
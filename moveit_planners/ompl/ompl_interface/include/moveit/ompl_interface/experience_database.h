@@ -0,0 +1,128 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#ifndef MOVEIT_OMPL_INTERFACE_EXPERIENCE_DATABASE_
+#define MOVEIT_OMPL_INTERFACE_EXPERIENCE_DATABASE_
+
+#include <moveit/macros/class_forward.h>
+#include <ompl/geometric/PathGeometric.h>
+#include <ompl/base/ProblemDefinition.h>
+#include <ompl/datastructures/NearestNeighbors.h>
+#include <boost/thread/mutex.hpp>
+#include <boost/function.hpp>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+
+namespace ompl_interface
+{
+MOVEIT_CLASS_FORWARD(ExperienceDatabase);
+
+/** \brief A store of previously computed solution paths that planning contexts consult before planning.
+
+    Paths are grouped by a key describing the problem family (the planning group and the state space in use) and
+    indexed by their start state in a nearest-neighbor structure. A recalled path is only used if its final state
+    satisfies the goal of the new problem and if it can be made collision free in the current scene by
+    re-validating its motions with checkMotion() and shortcutting over the segments that are no longer valid. */
+class ExperienceDatabase
+{
+public:
+  ExperienceDatabase(std::size_t max_experiences_per_key = 1000);
+  ~ExperienceDatabase();
+
+  /** \brief Remember \e path as a solution for problems of kind \e key. Paths whose start and end are
+      within \e getDuplicateDistance() of an existing experience replace it. */
+  void addExperience(const std::string& key, const ompl::geometric::PathGeometric& path);
+
+  /** \brief Decide whether a state reaches the goal of the problem being solved */
+  typedef boost::function<bool(const ompl::base::State*)> GoalTestFn;
+
+  /** \brief Look for a stored path that solves the problem in \e pdef. Up to \e candidates nearest experiences
+      (by start state) whose final state passes \e goal_test are tried. If \e goal_test is empty, the goal of
+      \e pdef is used instead. On success, \e path holds a valid solution starting at the first start state
+      of \e pdef. */
+  bool recallExperience(const std::string& key, const ompl::base::ProblemDefinitionPtr& pdef,
+                        const GoalTestFn& goal_test, ompl::geometric::PathGeometric& path,
+                        unsigned int candidates = 10) const;
+
+  /** \brief Number of stored experiences across all keys */
+  std::size_t size() const;
+
+  void clear();
+
+  /** \brief Load experiences from \e filename, adding them to the ones already in memory */
+  bool load(const std::string& filename);
+
+  /** \brief Save all experiences to \e filename */
+  bool save(const std::string& filename) const;
+
+  std::size_t getMaximumExperiencesPerKey() const
+  {
+    return max_experiences_per_key_;
+  }
+
+  void setMaximumExperiencesPerKey(std::size_t max_experiences_per_key)
+  {
+    max_experiences_per_key_ = max_experiences_per_key;
+  }
+
+  double getDuplicateDistance() const
+  {
+    return duplicate_distance_;
+  }
+
+  void setDuplicateDistance(double distance)
+  {
+    duplicate_distance_ = distance;
+  }
+
+private:
+  MOVEIT_STRUCT_FORWARD(Experience);
+  MOVEIT_STRUCT_FORWARD(ExperienceSet);
+
+  ExperienceSet& getExperienceSet(const std::string& key);
+  void addExperience(ExperienceSet& set, const ExperiencePtr& experience);
+
+  bool repairPath(const ompl::base::SpaceInformationPtr& si, std::vector<ompl::base::State*>& states) const;
+
+  std::map<std::string, ExperienceSetPtr> experiences_;
+  std::size_t max_experiences_per_key_;
+  double duplicate_distance_;
+  mutable boost::mutex lock_;
+};
+}
+
+#endif
@@ -0,0 +1,105 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef MOVEIT_OMPL_INTERFACE_GOAL_SAMPLE_CACHE_
+#define MOVEIT_OMPL_INTERFACE_GOAL_SAMPLE_CACHE_
+
+#include <moveit/macros/class_forward.h>
+#include <boost/thread/mutex.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+
+namespace ompl_interface
+{
+MOVEIT_CLASS_FORWARD(GoalSampleCache);
+
+/** \brief An in-memory cache of valid goal configurations, kept per planning group and goal constraint hash.
+
+    Goal samplers first try the configurations found for the same goal constraints by earlier planning attempts and
+    requests, and only call IK once those are used up. A cached configuration is checked against the constraints and
+    the current scene before it is used, so the scene does not need to be part of the key; configurations that fail
+    that check are dropped. A bounded number of configurations is kept for a bounded number of keys; the keys used
+    least recently are evicted first. All functions are thread safe. */
+class GoalSampleCache
+{
+public:
+  GoalSampleCache(std::size_t max_entries = 100, std::size_t max_samples_per_entry = 10);
+
+  /** \brief Get the configurations (in the order of the group's variables) stored under \e key, the most recently
+      added last */
+  void getSamples(const std::string& key, std::vector<std::vector<double> >& samples);
+
+  /** \brief Store a valid goal configuration under \e key; once the entry is full, the oldest configuration is
+      replaced */
+  void addSample(const std::string& key, const std::vector<double>& values);
+
+  /** \brief Drop a configuration stored under \e key that turned out not to be valid anymore */
+  void removeSample(const std::string& key, const std::vector<double>& values);
+
+  std::size_t getMaximumEntries() const
+  {
+    return max_entries_;
+  }
+
+  std::size_t getMaximumSamplesPerEntry() const
+  {
+    return max_samples_per_entry_;
+  }
+
+  /** \brief Number of entries */
+  std::size_t size() const;
+
+  void clear();
+
+private:
+  struct Entry
+  {
+    // oldest first
+    std::vector<std::vector<double> > samples;
+    std::uint64_t last_used;
+  };
+
+  Entry& useEntry(const std::string& key);
+
+  std::size_t max_entries_;
+  std::size_t max_samples_per_entry_;
+  std::map<std::string, Entry> entries_;
+  std::uint64_t clock_;
+  mutable boost::mutex lock_;
+};
+}
+
+#endif
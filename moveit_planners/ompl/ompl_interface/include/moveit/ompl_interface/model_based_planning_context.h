@@ -39,6 +39,10 @@
 
 #include <moveit/ompl_interface/parameterization/model_based_state_space.h>
 #include <moveit/ompl_interface/detail/constrained_valid_state_sampler.h>
+#include <moveit/ompl_interface/detail/clearance_field.h>
+#include <moveit/ompl_interface/experience_database.h>
+#include <moveit/ompl_interface/constrained_state_pool.h>
+#include <moveit/ompl_interface/goal_sample_cache.h>
 #include <moveit/constraint_samplers/constraint_sampler_manager.h>
 #include <moveit/planning_interface/planning_interface.h>
 
@@ -70,6 +74,9 @@ struct ModelBasedPlanningContextSpecification
   ConfiguredPlannerSelector planner_selector_;
   ConstraintsLibraryConstPtr constraints_library_;
   constraint_samplers::ConstraintSamplerManagerPtr constraint_sampler_manager_;
+  ExperienceDatabasePtr experience_database_;
+  ConstrainedStatePoolPtr constrained_state_pool_;
+  GoalSampleCachePtr goal_sample_cache_;
 
   ModelBasedStateSpacePtr state_space_;
   std::vector<ModelBasedStateSpacePtr> subspaces_;
@@ -249,6 +256,38 @@ public:
     spec_.constraints_library_ = constraints_library;
   }
 
+  /** \brief Reuse and record solution paths in \e experience_database. Pass an empty pointer to always plan from
+      scratch. */
+  void setExperienceDatabase(const ExperienceDatabasePtr& experience_database)
+  {
+    spec_.experience_database_ = experience_database;
+  }
+
+  /** \brief Draw path constrained samples from \e constrained_state_pool when no precomputed constraint
+      approximation exists. Pass an empty pointer to call the constraint sampler for every sample. */
+  void setConstrainedStatePool(const ConstrainedStatePoolPtr& constrained_state_pool)
+  {
+    spec_.constrained_state_pool_ = constrained_state_pool;
+  }
+
+  /** \brief Try the goal configurations found by earlier planning attempts in \e goal_sample_cache before sampling
+      new ones, and record the new ones there. Pass an empty pointer to always sample goals from scratch. */
+  void setGoalSampleCache(const GoalSampleCachePtr& goal_sample_cache)
+  {
+    spec_.goal_sample_cache_ = goal_sample_cache;
+  }
+
+  const GoalSampleCachePtr& getGoalSampleCache() const
+  {
+    return spec_.goal_sample_cache_;
+  }
+
+  /** \brief True if the last solution was recalled from the experience database rather than planned */
+  bool solvedFromExperience() const
+  {
+    return solved_from_experience_;
+  }
+
   bool useStateValidityCache() const
   {
     return use_state_validity_cache_;
@@ -269,6 +308,48 @@ public:
     simplify_solutions_ = flag;
   }
 
+  unsigned int getSimplificationThreads() const
+  {
+    return simplification_threads_;
+  }
+
+  /* @brief Simplify solutions with \e threads independent path simplifiers at once (1 by default) */
+  void setSimplificationThreads(unsigned int threads)
+  {
+    simplification_threads_ = threads;
+  }
+
+  unsigned int getGoalSamplingThreads() const
+  {
+    return goal_sampling_threads_;
+  }
+
+  /* @brief Let the constraint sampler of the goal race IK attempts and sample independent groups on up to \e threads
+     threads (0 for one per core; 1, the default, samples serially). Only use this with thread safe IK solvers. */
+  void setGoalSamplingThreads(unsigned int threads)
+  {
+    goal_sampling_threads_ = threads;
+  }
+
+  /* @brief Let solve() with several attempts stop before the time runs out: once \e agreement exact solutions are
+     no longer than the shortest one plus the fraction \e tolerance of it, or, with at least two solutions, once the
+     shortest path length improves by less than the fraction \e min_improvement_rate of it per second. 0 disables
+     either criterion; both are disabled by default. */
+  void setAdaptiveAttempts(unsigned int agreement, double tolerance, double min_improvement_rate)
+  {
+    adaptive_attempts_agreement_ = agreement;
+    adaptive_attempts_tolerance_ = tolerance;
+    adaptive_attempts_min_improvement_rate_ = min_improvement_rate;
+  }
+
+  /* @brief Receive every improved solution the planner reports while solve() is still running. Only planners that
+     keep optimizing after their first solution (e.g. RRT*, BIT*) report intermediate solutions. An empty callback
+     (the default) disables the reports. solve(MotionPlanResponse&) takes the callback from the response. */
+  void setIntermediateSolutionCallback(const planning_interface::IntermediateSolutionCallback& callback)
+  {
+    intermediate_solution_callback_ = callback;
+  }
+
   /* @brief Solve the planning problem. Return true if the problem is solved
      @param timeout The time to spend on solving
      @param count The number of runs to combine the paths of, in an attempt to generate better quality paths
@@ -295,7 +376,10 @@ public:
     return last_simplify_time_;
   }
 
-  /* @brief Apply smoothing and try to simplify the plan
+  /* @brief Apply smoothing and try to simplify the plan. Paths that are already close to the straight line between
+     their ends are left as they are. With more than one simplification thread, independent simplifiers shortcut
+     copies of the path concurrently, in rounds that start from the shortest result of the previous round, until the
+     timeout expires or a round brings no improvement.
      @param timeout The amount of time allowed to be spent on simplifying the plan*/
   void simplifySolution(double timeout);
 
@@ -309,6 +393,10 @@ public:
 
   virtual void configure();
 
+  /* @brief Apply the configuration and construct the planner ahead of the first request, so that configure() and
+     solve() can reuse it */
+  void preallocatePlanner();
+
 protected:
   void preSolve();
   void postSolve();
@@ -321,7 +409,29 @@ protected:
   virtual void useConfig();
   virtual ob::GoalPtr constructGoal();
 
+  /** \brief Try to solve the problem with a path from the experience database */
+  bool recallExperience();
+
+  /** \brief Store the current solution in the experience database, unless it was recalled from there */
+  void rememberSolution();
+
+  /** \brief The key solutions of this context are stored under in the experience database */
+  std::string getExperienceKey() const;
+
+  bool isGoalState(const ob::State* state) const;
+
+  /** \brief In multi-query mode, keep the roadmap of a PRM-type \e planner for the next query if it was computed for
+      the same scene, and return true if it was kept */
+  bool reuseRoadmap(ob::Planner* planner);
+
+  /** \brief Convert a path reported by the planner while solving and pass it to the intermediate solution callback */
+  void reportIntermediateSolution(const std::vector<const ob::State*>& states, const ob::Cost& cost) const;
+
   void registerTerminationCondition(const ob::PlannerTerminationCondition& ptc);
+
+  /** \brief The condition that ends several attempts at once: \e timeout seconds have passed, or the attempts
+      converged as configured with setAdaptiveAttempts() */
+  ob::PlannerTerminationCondition attemptsTerminationCondition(double timeout) const;
   void unregisterTerminationCondition();
 
   ModelBasedPlanningContextSpecification spec_;
@@ -342,10 +452,22 @@ protected:
   kinematic_constraints::KinematicConstraintSetPtr path_constraints_;
   moveit_msgs::Constraints path_constraints_msg_;
   std::vector<kinematic_constraints::KinematicConstraintSetPtr> goal_constraints_;
+  /// the keys goal samples for each of goal_constraints_ are cached under
+  std::vector<std::string> goal_constraint_keys_;
 
   const ob::PlannerTerminationCondition* ptc_;
   boost::mutex ptc_lock_;
 
+  /// receives the solutions reported while the planner is running; empty if they are not wanted
+  planning_interface::IntermediateSolutionCallback intermediate_solution_callback_;
+
+  /// the cost of the best intermediate solution reported so far, so that parallel planners only report improvements
+  mutable ob::Cost best_intermediate_cost_;
+  mutable boost::mutex intermediate_solution_lock_;
+
+  /// the type of planner the planner allocator was last set for
+  std::string planner_type_;
+
   /// the time spent computing the last plan
   double last_plan_time_;
 
@@ -376,7 +498,52 @@ protected:
 
   bool use_state_validity_cache_;
 
+  /// distance field of the world used for clearance queries; kept across requests so it is only updated incrementally
+  ClearanceFieldPtr clearance_field_;
+
   bool simplify_solutions_;
+
+  /// number of path simplifiers run concurrently by simplifySolution()
+  unsigned int simplification_threads_;
+
+  /// number of threads the goal constraint sampler may use for each sample
+  unsigned int goal_sampling_threads_;
+
+  /// criteria for ending the attempts of solve() early, see setAdaptiveAttempts()
+  unsigned int adaptive_attempts_agreement_;
+  double adaptive_attempts_tolerance_;
+  double adaptive_attempts_min_improvement_rate_;
+
+  /// whether the last solution came from the experience database
+  bool solved_from_experience_;
+
+  /// whether roadmap planners (PRM, LazyPRM and their variants) keep their roadmap across requests
+  bool multi_query_planning_enabled_;
+
+  /// what the validity of the states and motions in a kept roadmap depends on, beyond the group being planned for
+  struct RoadmapScene
+  {
+    RoadmapScene(const planning_scene::PlanningScene& scene, const robot_state::RobotState& state,
+                 const robot_model::JointModelGroup* group);
+
+    bool matches(const RoadmapScene& other) const;
+
+    /// the world objects are copied on write, so an unchanged pointer means an unchanged object
+    std::vector<std::pair<std::string, collision_detection::World::ObjectConstPtr> > objects_;
+    moveit_msgs::AllowedCollisionMatrix acm_;
+    std::map<std::string, double> link_padding_;
+    std::map<std::string, double> link_scale_;
+
+    /// the positions of the variables outside the group, and the bodies attached to the robot
+    std::vector<double> other_positions_;
+    std::vector<std::string> attached_names_;
+    std::vector<std::string> attached_links_;
+    std::vector<std::vector<shapes::ShapeConstPtr> > attached_shapes_;
+    std::vector<EigenSTL::vector_Affine3d> attached_transforms_;
+  };
+
+  /// the scene the roadmap of the planner was last used with; empty if it is not reused
+  std::shared_ptr<const RoadmapScene> roadmap_scene_;
 };
 }
 
@@ -90,6 +90,12 @@ public:
   ModelBasedPlanningContextPtr getPlanningContext(const std::string& config,
                                                   const std::string& factory_type = "") const;
 
+  /** @brief Get a context that races the portfolio planners configured for the group of \e req, if any
+      @see PlanningContextManager::getPortfolioPlanningContext() */
+  PortfolioPlanningContextPtr getPortfolioPlanningContext(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                                          const planning_interface::MotionPlanRequest& req,
+                                                          moveit_msgs::MoveItErrorCodes& error_code) const;
+
   ModelBasedPlanningContextPtr getLastPlanningContext() const
   {
     return context_manager_.getLastPlanningContext();
@@ -139,6 +145,40 @@ public:
 
   void saveConstraintApproximations(const std::string& path);
 
+  /** \brief Reuse previous solutions from \e experience_database before planning; pass an empty pointer to disable */
+  void setExperienceDatabase(const ExperienceDatabasePtr& experience_database)
+  {
+    experience_database_ = experience_database;
+  }
+
+  const ExperienceDatabasePtr& getExperienceDatabase() const
+  {
+    return experience_database_;
+  }
+
+  /** \brief Draw path constrained samples from \e constrained_state_pool; pass an empty pointer to disable */
+  void setConstrainedStatePool(const ConstrainedStatePoolPtr& constrained_state_pool)
+  {
+    constrained_state_pool_ = constrained_state_pool;
+  }
+
+  const ConstrainedStatePoolPtr& getConstrainedStatePool() const
+  {
+    return constrained_state_pool_;
+  }
+
+  /** \brief Reuse the goal configurations of earlier planning attempts kept in \e goal_sample_cache; pass an empty
+      pointer to disable */
+  void setGoalSampleCache(const GoalSampleCachePtr& goal_sample_cache)
+  {
+    goal_sample_cache_ = goal_sample_cache;
+  }
+
+  const GoalSampleCachePtr& getGoalSampleCache() const
+  {
+    return goal_sample_cache_;
+  }
+
   bool simplifySolutions() const
   {
     return simplify_solutions_;
@@ -157,6 +197,27 @@ public:
    * approximations to */
   bool loadConstraintApproximations();
 
+  /** @brief Look up param server 'experience_database_path' and use its value as the file to save the experience
+   * database to */
+  bool saveExperienceDatabase();
+
+  /** @brief Look up param server 'experience_database_path' and, if set, enable the experience database and load the
+   * experiences stored in that file */
+  bool loadExperienceDatabase();
+
+  /** @brief Look up param server 'constrained_state_pool_size' for the number of constrained states kept per group
+   * and set of path constraints (1000 by default, 0 disables the pool) */
+  void loadConstrainedStatePool();
+
+  /** @brief Look up param server 'goal_sample_cache_size' for the number of goal constraints valid goal
+   * configurations are cached for (100 by default, 0 disables the cache) and 'goal_sample_cache_samples' for the
+   * number of configurations kept for each of them (10 by default) */
+  void loadGoalSampleCache();
+
+  /** @brief Look up param server 'max_cached_planning_contexts' for the number of planning contexts kept for reuse
+   * and construct the contexts of the configurations listed in 'prewarm_planning_contexts' ahead of their first use */
+  void loadPlanningContextCache();
+
   /** @brief Print the status of this node*/
   void printStatus();
 
@@ -192,6 +253,12 @@ protected:
   ConstraintsLibraryPtr constraints_library_;
   bool use_constraints_approximations_;
 
+  ExperienceDatabasePtr experience_database_;
+
+  ConstrainedStatePoolPtr constrained_state_pool_;
+
+  GoalSampleCachePtr goal_sample_cache_;
+
   bool simplify_solutions_;
 
 private:
@@ -43,6 +43,7 @@
 #include <moveit/kinematic_constraints/kinematic_constraint.h>
 #include <moveit/constraint_samplers/constraint_sampler.h>
 #include "../detail/same_shared_ptr.hpp"
+#include <boost/thread/mutex.hpp>
 
 namespace ompl_interface
 {
@@ -267,6 +268,17 @@ protected:
 
   double tag_snap_to_segment_;
   double tag_snap_to_segment_complement_;
+
+private:
+  /** \brief The number of states allocated at once when the state pool is empty */
+  static const std::size_t STATE_POOL_BLOCK_SIZE = 64;
+
+  /** \brief States released by freeState(), ready to be handed out again by allocState(). Each state and its
+      values share one slot of a block in state_pool_blocks_; the blocks are only released when the space is
+      destroyed. */
+  mutable std::vector<StateType*> state_pool_;
+  mutable std::vector<char*> state_pool_blocks_;
+  mutable boost::mutex state_pool_lock_;
 };
 
 typedef same_shared_ptr<ModelBasedStateSpace, ompl::base::StateSpacePtr>::type ModelBasedStateSpacePtr;
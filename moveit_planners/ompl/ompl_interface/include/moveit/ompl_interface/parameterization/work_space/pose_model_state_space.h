@@ -39,6 +39,7 @@
 
 #include <moveit/ompl_interface/parameterization/model_based_state_space.h>
 #include <ompl/base/spaces/SE3StateSpace.h>
+#include <boost/thread/tss.hpp>
 
 namespace ompl_interface
 {
@@ -132,8 +133,22 @@ private:
     std::vector<std::string> fk_link_;
   };
 
+  /* The IK solution of the last state interpolated along an edge, used to seed the IK of the next state
+     interpolated along the same edge. Motion validation interpolates the states of an edge in order of increasing t,
+     so consecutive solutions are close and IK converges in few iterations. */
+  struct EdgeSeed
+  {
+    bool matches(const StateType* from, const StateType* to, double t) const;
+
+    std::vector<double> from_values;
+    std::vector<double> to_values;
+    double t;
+    std::vector<double> values;
+  };
+
   std::vector<PoseComponent> poses_;
   double jump_factor_;
+  mutable boost::thread_specific_ptr<EdgeSeed> edge_seed_;
 };
 }
 
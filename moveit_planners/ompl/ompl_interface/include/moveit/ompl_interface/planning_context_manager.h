@@ -38,6 +38,7 @@
 #define MOVEIT_OMPL_INTERFACE_PLANNING_CONTEXT_MANAGER_
 
 #include <moveit/ompl_interface/model_based_planning_context.h>
+#include <moveit/ompl_interface/portfolio_planning_context.h>
 #include <moveit/ompl_interface/parameterization/model_based_state_space_factory.h>
 #include <moveit/constraint_samplers/constraint_sampler_manager.h>
 #include <moveit/macros/class_forward.h>
@@ -136,6 +137,16 @@ public:
     minimum_waypoint_count_ = mwc;
   }
 
+  /** \brief Get the maximum number of planning contexts kept for reuse (0 means no limit) */
+  unsigned int getMaximumCachedContexts() const
+  {
+    return max_cached_contexts_;
+  }
+
+  /** \brief Keep at most \e max_cached_contexts planning contexts for reuse (0 means no limit). When there are more,
+      the least recently used contexts that are not in use are dropped. */
+  void setMaximumCachedContexts(unsigned int max_cached_contexts);
+
   const robot_model::RobotModelConstPtr& getRobotModel() const
   {
     return kmodel_;
@@ -146,10 +157,22 @@ public:
   ModelBasedPlanningContextPtr getPlanningContext(const std::string& config,
                                                   const std::string& factory_type = "") const;
 
+  /** \brief Construct the contexts of the configurations \e configs ahead of the first requests for them, including
+      their state spaces and planners, and keep them for reuse. Returns the number of contexts that were prepared. */
+  std::size_t prewarmPlanningContexts(const std::vector<std::string>& configs);
+
   ModelBasedPlanningContextPtr getPlanningContext(const planning_scene::PlanningSceneConstPtr& planning_scene,
                                                   const planning_interface::MotionPlanRequest& req,
                                                   moveit_msgs::MoveItErrorCodes& error_code) const;
 
+  /** \brief Get a context that races the planners listed in the "portfolio_planners" parameter of the group the
+      request is for. An empty pointer is returned if the group has no portfolio or if a particular planner is
+      requested. If "portfolio_keep_shortest" is set for the group, the shortest solution is kept instead of the
+      first one. */
+  PortfolioPlanningContextPtr getPortfolioPlanningContext(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                                          const planning_interface::MotionPlanRequest& req,
+                                                          moveit_msgs::MoveItErrorCodes& error_code) const;
+
   void registerPlannerAllocator(const std::string& planner_id, const ConfiguredPlannerAllocator& pa)
   {
     known_planners_[planner_id] = pa;
@@ -185,6 +208,12 @@ protected:
                                                   const StateSpaceFactoryTypeSelector& factory_selector,
                                                   const moveit_msgs::MotionPlanRequest& req) const;
 
+  /** \brief Get a context for configuration \e config that is set up for the request \e req */
+  ModelBasedPlanningContextPtr getPlanningContext(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                                  const moveit_msgs::MotionPlanRequest& req,
+                                                  const planning_interface::PlannerConfigurationSettings& config,
+                                                  moveit_msgs::MoveItErrorCodes& error_code) const;
+
   const ModelBasedStateSpaceFactoryPtr& getStateSpaceFactory1(const std::string& group_name,
                                                               const std::string& factory_type) const;
   const ModelBasedStateSpaceFactoryPtr& getStateSpaceFactory2(const std::string& group_name,
@@ -226,6 +255,9 @@ protected:
   /// needed)
   unsigned int minimum_waypoint_count_;
 
+  /// the maximum number of planning contexts kept for reuse (0 means no limit)
+  unsigned int max_cached_contexts_;
+
 private:
   MOVEIT_CLASS_FORWARD(LastPlanningContext);
   LastPlanningContextPtr last_planning_context_;
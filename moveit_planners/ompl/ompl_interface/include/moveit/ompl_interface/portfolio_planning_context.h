@@ -0,0 +1,88 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#ifndef MOVEIT_OMPL_INTERFACE_PORTFOLIO_PLANNING_CONTEXT_
+#define MOVEIT_OMPL_INTERFACE_PORTFOLIO_PLANNING_CONTEXT_
+
+#include <moveit/ompl_interface/model_based_planning_context.h>
+
+namespace ompl_interface
+{
+MOVEIT_CLASS_FORWARD(PortfolioPlanningContext);
+
+/** @class PortfolioPlanningContext
+    @brief A planning context that races several configured planning contexts for the same request.
+
+    Every context plans in its own thread. By default the first context that finds an exact solution wins and the
+    others are terminated. When \e keep_shortest is set, all contexts are allowed to finish (within the allowed
+    planning time) and the shortest solution is kept. Only the selected solution is simplified and interpolated. */
+class PortfolioPlanningContext : public planning_interface::PlanningContext
+{
+public:
+  PortfolioPlanningContext(const std::string& name, const std::string& group,
+                           const std::vector<ModelBasedPlanningContextPtr>& contexts, bool keep_shortest = false);
+
+  virtual ~PortfolioPlanningContext()
+  {
+  }
+
+  virtual bool solve(planning_interface::MotionPlanResponse& res);
+  virtual bool solve(planning_interface::MotionPlanDetailedResponse& res);
+
+  virtual void clear();
+  virtual bool terminate();
+
+  /** @brief Get the contexts that are raced against each other */
+  const std::vector<ModelBasedPlanningContextPtr>& getPlanningContexts() const
+  {
+    return contexts_;
+  }
+
+  bool keepShortestSolution() const
+  {
+    return keep_shortest_;
+  }
+
+protected:
+  /** @brief Run all contexts and return the one whose solution is to be used, or an empty pointer if none of them
+      found a solution. \e plan_time is set to the time spent planning */
+  ModelBasedPlanningContextPtr solve(double& plan_time);
+
+  std::vector<ModelBasedPlanningContextPtr> contexts_;
+  bool keep_shortest_;
+};
+}
+
+#endif
@@ -0,0 +1,217 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/ompl_interface/constrained_state_pool.h>
+#include <ros/serialization.h>
+#include <ros/console.h>
+#include <boost/functional/hash.hpp>
+#include <boost/scoped_array.hpp>
+#include <sstream>
+
+namespace ompl_interface
+{
+namespace
+{
+// give up filling an entry after this many samples in a row that fail; the constraints are then likely infeasible
+static const unsigned int MAX_CONSECUTIVE_FILL_FAILURES = 100;
+
+void clearHeader(std_msgs::Header& header)
+{
+  header.seq = 0;
+  header.stamp = ros::Time();
+}
+}
+
+ConstrainedStatePool::Entry::Entry(const robot_model::JointModelGroup* group, std::size_t max_size)
+  : group_(group), max_size_(max_size), next_replaced_(0), filling_(false), stop_(false)
+{
+}
+
+ConstrainedStatePool::Entry::~Entry()
+{
+  stop_ = true;
+  if (fill_thread_.joinable())
+    fill_thread_.join();
+}
+
+std::size_t ConstrainedStatePool::Entry::size() const
+{
+  boost::mutex::scoped_lock slock(lock_);
+  return states_.size();
+}
+
+bool ConstrainedStatePool::Entry::sample(ompl::RNG& rng, std::vector<double>& values) const
+{
+  boost::mutex::scoped_lock slock(lock_);
+  if (states_.empty())
+    return false;
+  values = states_[rng.uniformInt(0, states_.size() - 1)];
+  return true;
+}
+
+void ConstrainedStatePool::Entry::add(const std::vector<double>& values)
+{
+  if (max_size_ == 0)
+    return;
+  boost::mutex::scoped_lock slock(lock_);
+  if (states_.size() < max_size_)
+    states_.push_back(values);
+  else
+  {
+    // replace in a round robin, so a full entry keeps turning over to the most recent samples
+    states_[next_replaced_] = values;
+    next_replaced_ = (next_replaced_ + 1) % max_size_;
+  }
+}
+
+void ConstrainedStatePool::Entry::fill(constraint_samplers::ConstraintSamplerPtr sampler,
+                                       kinematic_constraints::KinematicConstraintSetPtr constraints,
+                                       robot_state::RobotState reference_state)
+{
+  reference_state.update();
+  robot_state::RobotState state(reference_state);
+  std::vector<double> values;
+  unsigned int failures = 0;
+  while (!stop_ && size() < max_size_)
+  {
+    if (sampler->sample(state, reference_state))
+    {
+      state.update();
+      if (constraints->decide(state).satisfied)
+      {
+        state.copyJointGroupPositions(group_, values);
+        add(values);
+        failures = 0;
+        continue;
+      }
+    }
+    if (++failures >= MAX_CONSECUTIVE_FILL_FAILURES)
+    {
+      ROS_WARN_NAMED("constrained_state_pool", "Stopped filling the constrained state pool for group '%s' after %u "
+                                               "failed samples in a row (%u states stored)",
+                     group_->getName().c_str(), failures, (unsigned int)size());
+      break;
+    }
+  }
+  ROS_DEBUG_NAMED("constrained_state_pool", "Constrained state pool for group '%s' holds %u states",
+                  group_->getName().c_str(), (unsigned int)size());
+  filling_ = false;
+}
+
+ConstrainedStatePool::ConstrainedStatePool(std::size_t max_states_per_entry)
+  : max_states_per_entry_(max_states_per_entry)
+{
+}
+
+ConstrainedStatePool::~ConstrainedStatePool()
+{
+  clear();
+}
+
+std::string ConstrainedStatePool::getKey(const std::string& group, const moveit_msgs::Constraints& constraints)
+{
+  // requests for the same constraints differ in their stamps, so those are left out of the hash
+  moveit_msgs::Constraints msg = constraints;
+  msg.name.clear();
+  for (std::size_t i = 0; i < msg.position_constraints.size(); ++i)
+    clearHeader(msg.position_constraints[i].header);
+  for (std::size_t i = 0; i < msg.orientation_constraints.size(); ++i)
+    clearHeader(msg.orientation_constraints[i].header);
+  for (std::size_t i = 0; i < msg.visibility_constraints.size(); ++i)
+  {
+    clearHeader(msg.visibility_constraints[i].target_pose.header);
+    clearHeader(msg.visibility_constraints[i].sensor_pose.header);
+  }
+
+  const uint32_t length = ros::serialization::serializationLength(msg);
+  boost::scoped_array<uint8_t> buffer(new uint8_t[length]);
+  ros::serialization::OStream stream(buffer.get(), length);
+  ros::serialization::serialize(stream, msg);
+
+  std::stringstream ss;
+  ss << group << ":" << std::hex << boost::hash_range(buffer.get(), buffer.get() + length);
+  return ss.str();
+}
+
+ConstrainedStatePool::EntryPtr ConstrainedStatePool::getEntry(const std::string& key) const
+{
+  boost::mutex::scoped_lock slock(lock_);
+  std::map<std::string, EntryPtr>::const_iterator it = entries_.find(key);
+  return it == entries_.end() ? EntryPtr() : it->second;
+}
+
+ConstrainedStatePool::EntryPtr
+ConstrainedStatePool::requestEntry(const std::string& key, const constraint_samplers::ConstraintSamplerPtr& sampler,
+                                   const kinematic_constraints::KinematicConstraintSetPtr& constraints,
+                                   const robot_state::RobotState& reference_state)
+{
+  boost::mutex::scoped_lock slock(lock_);
+  EntryPtr& entry = entries_[key];
+  if (entry)
+    return entry;
+
+  entry.reset(new Entry(sampler->getJointModelGroup(), max_states_per_entry_));
+  if (max_states_per_entry_ > 0)
+  {
+    ROS_DEBUG_NAMED("constrained_state_pool", "Filling constrained state pool for group '%s' (key '%s') in the "
+                                              "background",
+                    sampler->getJointModelGroup()->getName().c_str(), key.c_str());
+    entry->filling_ = true;
+    entry->fill_thread_ = boost::thread(&Entry::fill, entry.get(), sampler, constraints, reference_state);
+  }
+  return entry;
+}
+
+std::size_t ConstrainedStatePool::size() const
+{
+  boost::mutex::scoped_lock slock(lock_);
+  return entries_.size();
+}
+
+void ConstrainedStatePool::clear()
+{
+  std::map<std::string, EntryPtr> entries;
+  {
+    boost::mutex::scoped_lock slock(lock_);
+    entries.swap(entries_);
+  }
+  // entries still used by samplers are stopped here too, so no fill thread outlives the pool
+  for (std::map<std::string, EntryPtr>::iterator it = entries.begin(); it != entries.end(); ++it)
+  {
+    it->second->stop_ = true;
+    if (it->second->fill_thread_.joinable())
+      it->second->fill_thread_.join();
+  }
+}
+}
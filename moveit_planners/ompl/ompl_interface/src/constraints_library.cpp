@@ -39,8 +39,13 @@
 #include <moveit/profiler/profiler.h>
 #include <ompl/tools/config/SelfConfig.h>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/bind.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
 #include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
 
 namespace ompl_interface
 {
@@ -76,6 +81,247 @@ void hexToMsg(const std::string& hex, T& msg)
   ros::serialization::IStream stream_arg(buffer_arg.get(), serial_size_arg);
   ros::serialization::deserialize(stream_arg, msg);
 }
+
+const std::string DATABASE_EXTENSION = ".mmap";
+const char DATABASE_MAGIC[8] = { 'M', 'V', 'I', 'T', 'C', 'A', 'D', 'B' };
+
+/* Layout of the binary database; all sections start on 8 byte boundaries and use native byte order:
+     header | signature (int32) | neighbor offsets (state_count + 1) | neighbors | motion offsets (state_count + 1) |
+     motions (to, first, last triplets, sorted by 'to' for every state) | serialized states */
+struct DatabaseHeader
+{
+  char magic[8];
+  boost::uint32_t version;
+  boost::uint32_t state_size;
+  boost::uint64_t state_count;
+  boost::uint64_t signature_count;
+  boost::uint64_t neighbor_count;
+  boost::uint64_t motion_count;
+};
+
+std::size_t alignedSize(std::size_t size)
+{
+  return (size + 7) & ~static_cast<std::size_t>(7);
+}
+
+// run fn(0) ... fn(threads - 1) concurrently; fn(0) runs in the calling thread
+void runInThreads(unsigned int threads, const boost::function<void(unsigned int)>& fn)
+{
+  boost::thread_group group;
+  for (unsigned int t = 1; t < threads; ++t)
+    group.create_thread(boost::bind(fn, t));
+  fn(0);
+  group.join_all();
+}
+}
+
+const boost::uint32_t ConstraintApproximationDatabase::VERSION = 1;
+
+bool ConstraintApproximationDatabase::store(const ConstraintApproximationStateStorage& storage,
+                                            const std::string& filename)
+{
+  const ob::StateSpacePtr& space = storage.getStateSpace();
+  std::vector<int> signature;
+  space->computeSignature(signature);
+
+  DatabaseHeader header;
+  memcpy(header.magic, DATABASE_MAGIC, sizeof(DATABASE_MAGIC));
+  header.version = VERSION;
+  header.state_size = space->getSerializationLength();
+  header.state_count = storage.size();
+  header.signature_count = signature.size();
+
+  std::vector<boost::uint64_t> neighbor_offsets(1, 0), neighbors, motion_offsets(1, 0), motions;
+  for (std::size_t i = 0; i < storage.size(); ++i)
+  {
+    const ConstrainedStateMetadata& md = storage.getMetadata(i);
+    neighbors.insert(neighbors.end(), md.first.begin(), md.first.end());
+    neighbor_offsets.push_back(neighbors.size());
+    for (std::map<std::size_t, std::pair<std::size_t, std::size_t> >::const_iterator it = md.second.begin();
+         it != md.second.end(); ++it)
+    {
+      motions.push_back(it->first);
+      motions.push_back(it->second.first);
+      motions.push_back(it->second.second);
+    }
+    motion_offsets.push_back(motions.size() / 3);
+  }
+  header.neighbor_count = neighbors.size();
+  header.motion_count = motions.size() / 3;
+
+  std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+  if (!out.good())
+  {
+    ROS_ERROR_NAMED("constraints_library", "Unable to open '%s' for writing", filename.c_str());
+    return false;
+  }
+
+  static const char padding[8] = { 0 };
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  const std::size_t signature_bytes = signature.size() * sizeof(boost::int32_t);
+  if (!signature.empty())
+    out.write(reinterpret_cast<const char*>(&signature[0]), signature_bytes);
+  out.write(padding, alignedSize(signature_bytes) - signature_bytes);
+  out.write(reinterpret_cast<const char*>(&neighbor_offsets[0]), neighbor_offsets.size() * sizeof(boost::uint64_t));
+  if (!neighbors.empty())
+    out.write(reinterpret_cast<const char*>(&neighbors[0]), neighbors.size() * sizeof(boost::uint64_t));
+  out.write(reinterpret_cast<const char*>(&motion_offsets[0]), motion_offsets.size() * sizeof(boost::uint64_t));
+  if (!motions.empty())
+    out.write(reinterpret_cast<const char*>(&motions[0]), motions.size() * sizeof(boost::uint64_t));
+
+  std::vector<char> buffer(header.state_size);
+  for (std::size_t i = 0; i < storage.size(); ++i)
+  {
+    space->serialize(buffer.empty() ? NULL : &buffer[0], storage.getState(i));
+    out.write(buffer.empty() ? NULL : &buffer[0], buffer.size());
+  }
+
+  if (!out.good())
+  {
+    ROS_ERROR_NAMED("constraints_library", "Failed writing constraint approximation database '%s'", filename.c_str());
+    return false;
+  }
+  return true;
+}
+
+ConstraintApproximationDatabasePtr ConstraintApproximationDatabase::open(const std::string& filename,
+                                                                         const ob::StateSpacePtr& space)
+{
+  ConstraintApproximationDatabasePtr db;
+  if (!boost::filesystem::exists(filename))
+    return db;
+  try
+  {
+    db.reset(new ConstraintApproximationDatabase(filename, space));
+  }
+  catch (boost::interprocess::interprocess_exception& ex)
+  {
+    ROS_WARN_NAMED("constraints_library", "Unable to map '%s': %s", filename.c_str(), ex.what());
+    return ConstraintApproximationDatabasePtr();
+  }
+  if (!db->parse())
+    db.reset();
+  return db;
+}
+
+ConstraintApproximationDatabase::ConstraintApproximationDatabase(const std::string& filename,
+                                                                 const ob::StateSpacePtr& space)
+  : space_(space)
+  , file_(filename.c_str(), boost::interprocess::read_only)
+  , region_(file_, boost::interprocess::read_only)
+  , state_count_(0)
+  , state_size_(0)
+  , neighbor_count_(0)
+  , neighbor_offsets_(NULL)
+  , neighbors_(NULL)
+  , motion_offsets_(NULL)
+  , motions_(NULL)
+  , states_(NULL)
+{
+}
+
+bool ConstraintApproximationDatabase::parse()
+{
+  const char* data = static_cast<const char*>(region_.get_address());
+  const std::size_t length = region_.get_size();
+  if (length < sizeof(DatabaseHeader))
+  {
+    ROS_WARN_NAMED("constraints_library", "Constraint approximation database is truncated");
+    return false;
+  }
+
+  const DatabaseHeader* header = reinterpret_cast<const DatabaseHeader*>(data);
+  if (memcmp(header->magic, DATABASE_MAGIC, sizeof(DATABASE_MAGIC)) != 0 || header->version != VERSION)
+  {
+    ROS_WARN_NAMED("constraints_library", "Constraint approximation database has an unknown format or version");
+    return false;
+  }
+  if (header->state_size != space_->getSerializationLength())
+  {
+    ROS_WARN_NAMED("constraints_library", "Constraint approximation database was written for a different state space");
+    return false;
+  }
+
+  const std::size_t signature_bytes = alignedSize(header->signature_count * sizeof(boost::int32_t));
+  const std::size_t expected = sizeof(DatabaseHeader) + signature_bytes +
+                               sizeof(boost::uint64_t) * (2 * (header->state_count + 1) + header->neighbor_count +
+                                                          3 * header->motion_count) +
+                               header->state_count * header->state_size;
+  if (length < expected)
+  {
+    ROS_WARN_NAMED("constraints_library", "Constraint approximation database is truncated");
+    return false;
+  }
+
+  std::vector<int> signature;
+  space_->computeSignature(signature);
+  const boost::int32_t* stored_signature = reinterpret_cast<const boost::int32_t*>(data + sizeof(DatabaseHeader));
+  if (signature.size() != header->signature_count ||
+      !std::equal(signature.begin(), signature.end(), stored_signature))
+  {
+    ROS_WARN_NAMED("constraints_library", "Constraint approximation database was written for a different state space");
+    return false;
+  }
+
+  state_count_ = header->state_count;
+  state_size_ = header->state_size;
+  neighbor_count_ = header->neighbor_count;
+  neighbor_offsets_ = reinterpret_cast<const boost::uint64_t*>(data + sizeof(DatabaseHeader) + signature_bytes);
+  neighbors_ = neighbor_offsets_ + state_count_ + 1;
+  motion_offsets_ = neighbors_ + neighbor_count_;
+  motions_ = motion_offsets_ + state_count_ + 1;
+  states_ = reinterpret_cast<const char*>(motions_ + 3 * header->motion_count);
+
+  if (neighbor_offsets_[state_count_] != neighbor_count_ || motion_offsets_[state_count_] != header->motion_count)
+  {
+    ROS_WARN_NAMED("constraints_library", "Constraint approximation database is corrupted");
+    return false;
+  }
+  return true;
+}
+
+void ConstraintApproximationDatabase::copyState(ob::State* state, std::size_t index) const
+{
+  space_->deserialize(state, states_ + index * state_size_);
+}
+
+bool ConstraintApproximationDatabase::getMotion(std::size_t from, std::size_t to, std::size_t& first,
+                                                std::size_t& last) const
+{
+  // motions of a state are sorted by their target, so bisect over the (to, first, last) triplets
+  std::size_t lo = motion_offsets_[from];
+  std::size_t hi = motion_offsets_[from + 1];
+  while (lo < hi)
+  {
+    std::size_t mid = lo + (hi - lo) / 2;
+    if (motions_[3 * mid] < to)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo == motion_offsets_[from + 1] || motions_[3 * lo] != to)
+    return false;
+  first = motions_[3 * lo + 1];
+  last = motions_[3 * lo + 2];
+  return true;
+}
+
+ob::StateStoragePtr ConstraintApproximationDatabase::toStateStorage() const
+{
+  ConstraintApproximationStateStorage* cass = new ConstraintApproximationStateStorage(space_);
+  ob::StateStoragePtr result(cass);
+  ob::State* state = space_->allocState();
+  for (std::size_t i = 0; i < state_count_; ++i)
+  {
+    ConstrainedStateMetadata md;
+    md.first.assign(neighbors_ + neighbor_offsets_[i], neighbors_ + neighbor_offsets_[i + 1]);
+    for (std::size_t j = motion_offsets_[i]; j < motion_offsets_[i + 1]; ++j)
+      md.second[motions_[3 * j]] = std::make_pair(motions_[3 * j + 1], motions_[3 * j + 2]);
+    copyState(state, i);
+    cass->addState(state, md);
+  }
+  space_->freeState(state);
+  return result;
 }
 
 class ConstraintApproximationStateSampler : public ob::StateSampler
@@ -83,15 +329,33 @@ class ConstraintApproximationStateSampler : public ob::StateSampler
 public:
   ConstraintApproximationStateSampler(const ob::StateSpace* space,
                                       const ConstraintApproximationStateStorage* state_storage, std::size_t milestones)
-    : ob::StateSampler(space), state_storage_(state_storage)
+    : ob::StateSampler(space), state_storage_(state_storage), database_(NULL), scratch_(NULL)
   {
     max_index_ = milestones - 1;
     inv_dim_ = space->getDimension() > 0 ? 1.0 / (double)space->getDimension() : 1.0;
   }
 
+  ConstraintApproximationStateSampler(const ob::StateSpace* space, const ConstraintApproximationDatabase* database,
+                                      std::size_t milestones)
+    : ob::StateSampler(space), state_storage_(NULL), database_(database), scratch_(space->allocState())
+  {
+    max_index_ = milestones - 1;
+    inv_dim_ = space->getDimension() > 0 ? 1.0 / (double)space->getDimension() : 1.0;
+  }
+
+  virtual ~ConstraintApproximationStateSampler()
+  {
+    if (scratch_)
+      space_->freeState(scratch_);
+  }
+
   virtual void sampleUniform(ob::State* state)
   {
-    space_->copyState(state, state_storage_->getState(rng_.uniformInt(0, max_index_)));
+    std::size_t index = rng_.uniformInt(0, max_index_);
+    if (database_)
+      database_->copyState(state, index);
+    else
+      space_->copyState(state, state_storage_->getState(index));
   }
 
   virtual void sampleUniformNear(ob::State* state, const ob::State* near, const double distance)
@@ -101,14 +365,16 @@ public:
 
     if (tag >= 0)
     {
-      const ConstrainedStateMetadata& md = state_storage_->getMetadata(tag);
-      if (!md.first.empty())
+      const std::size_t neighbor_count = database_ ? database_->getNeighborCount(tag) :
+                                                     state_storage_->getMetadata(tag).first.size();
+      if (neighbor_count > 0)
       {
-        std::size_t matt = md.first.size() / 3;
+        std::size_t matt = neighbor_count / 3;
         std::size_t att = 0;
         do
         {
-          index = md.first[rng_.uniformInt(0, md.first.size() - 1)];
+          std::size_t k = rng_.uniformInt(0, neighbor_count - 1);
+          index = database_ ? database_->getNeighbor(tag, k) : state_storage_->getMetadata(tag).first[k];
         } while (dirty_.find(index) != dirty_.end() && ++att < matt);
         if (att >= matt)
           index = -1;
@@ -119,15 +385,24 @@ public:
     if (index < 0)
       index = rng_.uniformInt(0, max_index_);
 
-    double dist = space_->distance(near, state_storage_->getState(index));
+    const ob::State* stored;
+    if (database_)
+    {
+      database_->copyState(scratch_, index);
+      stored = scratch_;
+    }
+    else
+      stored = state_storage_->getState(index);
+
+    double dist = space_->distance(near, stored);
 
     if (dist > distance)
     {
       double d = pow(rng_.uniform01(), inv_dim_) * distance;
-      space_->interpolate(near, state_storage_->getState(index), d / dist, state);
+      space_->interpolate(near, stored, d / dist, state);
     }
     else
-      space_->copyState(state, state_storage_->getState(index));
+      space_->copyState(state, stored);
   }
 
   virtual void sampleGaussian(ob::State* state, const ob::State* mean, const double stdDev)
@@ -138,6 +413,9 @@ public:
 protected:
   /** \brief The states to sample from */
   const ConstraintApproximationStateStorage* state_storage_;
+  /** \brief The mapped states to sample from, used instead of \e state_storage_ when set */
+  const ConstraintApproximationDatabase* database_;
+  ob::State* scratch_;
   std::set<std::size_t> dirty_;
   unsigned int max_index_;
   double inv_dim_;
@@ -178,10 +456,46 @@ bool interpolateUsingStoredStates(const ConstraintApproximationStateStorage* sta
   return true;
 }
 
+bool interpolateUsingMappedStates(const ConstraintApproximationDatabase* database, const ob::State* from,
+                                  const ob::State* to, const double t, ob::State* state)
+{
+  int tag_from = from->as<ModelBasedStateSpace::StateType>()->tag;
+  int tag_to = to->as<ModelBasedStateSpace::StateType>()->tag;
+
+  if (tag_from < 0 || tag_to < 0)
+    return false;
+
+  if (tag_from == tag_to)
+    database->getStateSpace()->copyState(state, to);
+  else
+  {
+    std::size_t first, last;
+    if (!database->getMotion(tag_from, tag_to, first, last))
+      return false;
+    std::size_t index = (std::size_t)((last - first + 2) * t + 0.5);
+
+    if (index == 0)
+      database->getStateSpace()->copyState(state, from);
+    else
+    {
+      --index;
+      if (index >= last - first)
+        database->getStateSpace()->copyState(state, to);
+      else
+        database->copyState(state, first + index);
+    }
+  }
+  return true;
+}
+
 ompl_interface::InterpolationFunction ompl_interface::ConstraintApproximation::getInterpolationFunction() const
 {
-  if (explicit_motions_ && milestones_ > 0 && milestones_ < state_storage_->size())
+  if (explicit_motions_ && milestones_ > 0 && milestones_ < getStateCount())
+  {
+    if (database_)
+      return boost::bind(&interpolateUsingMappedStates, database_.get(), _1, _2, _3, _4);
     return boost::bind(&interpolateUsingStoredStates, state_storage_, _1, _2, _3, _4);
+  }
   return InterpolationFunction();
 }
 
@@ -196,6 +510,18 @@ ompl::base::StateSamplerPtr allocConstraintApproximationStateSampler(
   else
     return ompl::base::StateSamplerPtr(new ConstraintApproximationStateSampler(space, state_storage, milestones));
 }
+
+ompl::base::StateSamplerPtr allocMappedConstraintApproximationStateSampler(
+    const ob::StateSpace* space, const std::vector<int>& expected_signature,
+    const ConstraintApproximationDatabase* database, std::size_t milestones)
+{
+  std::vector<int> sig;
+  space->computeSignature(sig);
+  if (sig != expected_signature)
+    return ompl::base::StateSamplerPtr();
+  else
+    return ompl::base::StateSamplerPtr(new ConstraintApproximationStateSampler(space, database, milestones));
+}
 }
 
 ompl_interface::ConstraintApproximation::ConstraintApproximation(
@@ -216,11 +542,44 @@ ompl_interface::ConstraintApproximation::ConstraintApproximation(
     milestones_ = state_storage_->size();
 }
 
+ompl_interface::ConstraintApproximation::ConstraintApproximation(
+    const std::string& group, const std::string& state_space_parameterization, bool explicit_motions,
+    const moveit_msgs::Constraints& msg, const std::string& filename,
+    const ConstraintApproximationDatabasePtr& database, std::size_t milestones)
+  : group_(group)
+  , state_space_parameterization_(state_space_parameterization)
+  , explicit_motions_(explicit_motions)
+  , constraint_msg_(msg)
+  , ompldb_filename_(filename)
+  , state_storage_(NULL)
+  , database_(database)
+  , milestones_(milestones)
+{
+  database_->getStateSpace()->computeSignature(space_signature_);
+  if (milestones_ == 0)
+    milestones_ = database_->size();
+}
+
+const ompl::base::StateStoragePtr& ompl_interface::ConstraintApproximation::getStateStorage() const
+{
+  if (!state_storage_ptr_ && database_)
+    state_storage_ptr_ = database_->toStateStorage();
+  return state_storage_ptr_;
+}
+
+std::size_t ompl_interface::ConstraintApproximation::getStateCount() const
+{
+  return database_ ? database_->size() : state_storage_->size();
+}
+
 ompl::base::StateSamplerAllocator
 ompl_interface::ConstraintApproximation::getStateSamplerAllocator(const moveit_msgs::Constraints& msg) const
 {
-  if (state_storage_->size() == 0)
+  if (getStateCount() == 0)
     return ompl::base::StateSamplerAllocator();
+  if (database_)
+    return boost::bind(&allocMappedConstraintApproximationStateSampler, _1, space_signature_, database_.get(),
+                       milestones_);
   return boost::bind(&allocConstraintApproximationStateSampler, _1, space_signature_, state_storage_, milestones_);
 }
 /*
@@ -305,23 +664,36 @@ void ompl_interface::ConstraintsLibrary::loadConstraintApproximations(const std:
     {
       moveit_msgs::Constraints msg;
       hexToMsg(serialization, msg);
-      ConstraintApproximationStateStorage* cass =
-          new ConstraintApproximationStateStorage(pc->getOMPLSimpleSetup()->getStateSpace());
-      cass->load((path + "/" + filename).c_str());
-      ConstraintApproximationPtr cap(new ConstraintApproximation(group, state_space_parameterization, explicit_motions,
-                                                                 msg, filename, ompl::base::StateStoragePtr(cass),
-                                                                 milestones));
+      // prefer the memory-mapped database; fall back to parsing the OMPL serialization
+      ConstraintApproximationPtr cap;
+      std::size_t sum = 0;
+      ConstraintApproximationDatabasePtr db = ConstraintApproximationDatabase::open(
+          path + "/" + filename + DATABASE_EXTENSION, pc->getOMPLSimpleSetup()->getStateSpace());
+      if (db)
+      {
+        cap.reset(new ConstraintApproximation(group, state_space_parameterization, explicit_motions, msg, filename, db,
+                                              milestones));
+        sum = db->getConnectionCount();
+      }
+      else
+      {
+        ConstraintApproximationStateStorage* cass =
+            new ConstraintApproximationStateStorage(pc->getOMPLSimpleSetup()->getStateSpace());
+        cass->load((path + "/" + filename).c_str());
+        cap.reset(new ConstraintApproximation(group, state_space_parameterization, explicit_motions, msg, filename,
+                                              ompl::base::StateStoragePtr(cass), milestones));
+        for (std::size_t i = 0; i < cass->size(); ++i)
+          sum += cass->getMetadata(i).first.size();
+      }
       if (constraint_approximations_.find(cap->getName()) != constraint_approximations_.end())
         ROS_WARN_NAMED("constraints_library", "Overwriting constraint approximation named '%s'",
                        cap->getName().c_str());
       constraint_approximations_[cap->getName()] = cap;
-      std::size_t sum = 0;
-      for (std::size_t i = 0; i < cass->size(); ++i)
-        sum += cass->getMetadata(i).first.size();
       ROS_INFO_NAMED("constraints_library", "Loaded %lu states (%lu milestones) and %lu connections (%0.1lf per state) "
-                                            "for constraint named '%s'%s",
-                     cass->size(), cap->getMilestoneCount(), sum, (double)sum / (double)cap->getMilestoneCount(),
-                     msg.name.c_str(), explicit_motions ? ". Explicit motions included." : "");
+                                            "for constraint named '%s'%s%s",
+                     cap->getStateCount(), cap->getMilestoneCount(), sum,
+                     (double)sum / (double)cap->getMilestoneCount(), msg.name.c_str(),
+                     explicit_motions ? ". Explicit motions included." : "", db ? " (memory-mapped)" : "");
     }
   }
   ROS_INFO_NAMED("constraints_library", "Done loading constrained space approximations.");
@@ -353,7 +725,13 @@ void ompl_interface::ConstraintsLibrary::saveConstraintApproximations(const std:
       fout << serialization << std::endl;
       fout << it->second->getFilename() << std::endl;
       if (it->second->getStateStorage())
-        it->second->getStateStorage()->store((path + "/" + it->second->getFilename()).c_str());
+      {
+        const std::string filename = path + "/" + it->second->getFilename();
+        it->second->getStateStorage()->store(filename.c_str());
+        ConstraintApproximationDatabase::store(
+            *static_cast<const ConstraintApproximationStateStorage*>(it->second->getStateStorage().get()),
+            filename + DATABASE_EXTENSION);
+      }
     }
   else
     ROS_ERROR_NAMED("constraints_library", "Unable to save constraint approximation to '%s'", path.c_str());
@@ -412,18 +790,44 @@ ompl_interface::ConstraintsLibrary::addConstraintApproximation(
     pc->setPlanningScene(scene);
     pc->setCompleteInitialState(scene->getCurrentState());
 
+    ConstraintApproximationPtr previous;
+    if (options.extend_existing)
+    {
+      std::map<std::string, ConstraintApproximationPtr>::const_iterator it =
+          constraint_approximations_.find(constr_hard.name);
+      if (it == constraint_approximations_.end())
+        ROS_INFO_NAMED("constraints_library", "No constraint approximation named '%s' to extend; constructing a new "
+                                              "one",
+                       constr_hard.name.c_str());
+      else if (it->second->getGroup() != group ||
+               it->second->getStateSpaceParameterization() != options.state_space_parameterization ||
+               it->second->hasExplicitMotions() != options.explicit_motions)
+        ROS_WARN_NAMED("constraints_library", "Constraint approximation named '%s' was constructed with different "
+                                              "options and cannot be extended; constructing a new one",
+                       constr_hard.name.c_str());
+      else
+      {
+        previous = it->second;
+        ROS_INFO_NAMED("constraints_library", "Extending constraint approximation '%s' with %lu milestones",
+                       constr_hard.name.c_str(), previous->getMilestoneCount());
+      }
+    }
+
     ros::WallTime start = ros::WallTime::now();
-    ompl::base::StateStoragePtr ss = constructConstraintApproximation(pc, constr_sampling, constr_hard, options, res);
+    ompl::base::StateStoragePtr ss =
+        constructConstraintApproximation(pc, constr_sampling, constr_hard, options, previous, res);
     ROS_INFO_NAMED("constraints_library", "Spent %lf seconds constructing the database",
                    (ros::WallTime::now() - start).toSec());
     if (ss)
     {
       ConstraintApproximationPtr ca(new ConstraintApproximation(
           group, options.state_space_parameterization, options.explicit_motions, constr_hard,
-          group + "_" + boost::posix_time::to_iso_extended_string(boost::posix_time::microsec_clock::universal_time()) +
-              ".ompldb",
+          previous ? previous->getFilename() :
+                     group + "_" + boost::posix_time::to_iso_extended_string(
+                                       boost::posix_time::microsec_clock::universal_time()) +
+                         ".ompldb",
           ss, res.milestones));
-      if (constraint_approximations_.find(ca->getName()) != constraint_approximations_.end())
+      if (!previous && constraint_approximations_.find(ca->getName()) != constraint_approximations_.end())
         ROS_WARN_NAMED("constraints_library", "Overwriting constraint approximation named '%s'", ca->getName().c_str());
       constraint_approximations_[ca->getName()] = ca;
       res.approx = ca;
@@ -438,172 +842,276 @@ ompl_interface::ConstraintsLibrary::addConstraintApproximation(
 ompl::base::StateStoragePtr ompl_interface::ConstraintsLibrary::constructConstraintApproximation(
     const ModelBasedPlanningContextPtr& pcontext, const moveit_msgs::Constraints& constr_sampling,
     const moveit_msgs::Constraints& constr_hard, const ConstraintApproximationConstructionOptions& options,
-    ConstraintApproximationConstructionResults& result)
+    const ConstraintApproximationPtr& previous, ConstraintApproximationConstructionResults& result)
 {
   // state storage structure
   ConstraintApproximationStateStorage* cass = new ConstraintApproximationStateStorage(pcontext->getOMPLStateSpace());
   ob::StateStoragePtr sstor(cass);
 
-  // construct a sampler for the sampling constraints
-  kinematic_constraints::KinematicConstraintSet kset(pcontext->getRobotModel());
+  unsigned int threads = options.threads > 0 ? options.threads : std::max(1u, boost::thread::hardware_concurrency());
+
+  // each thread checks the hard constraints on its own robot state, with its own copy of the constraints
+  std::vector<kinematic_constraints::KinematicConstraintSetPtr> ksets(threads);
   robot_state::Transforms no_transforms(pcontext->getRobotModel()->getModelFrame());
-  kset.add(constr_hard, no_transforms);
+  for (unsigned int t = 0; t < threads; ++t)
+  {
+    ksets[t].reset(new kinematic_constraints::KinematicConstraintSet(pcontext->getRobotModel()));
+    ksets[t]->add(constr_hard, no_transforms);
+  }
 
   const robot_state::RobotState& default_state = pcontext->getCompleteInitialRobotState();
 
-  unsigned int attempts = 0;
-
   double bounds_val = std::numeric_limits<double>::max() / 2.0 - 1.0;
   pcontext->getOMPLStateSpace()->setPlanningVolume(-bounds_val, bounds_val, -bounds_val, bounds_val, -bounds_val,
                                                    bounds_val);
   pcontext->getOMPLStateSpace()->setup();
 
-  // construct the constrained states
+  // start from the milestones of the approximation that is extended, keeping their indices and connections
+  std::size_t previous_milestones = 0;
+  const ConstraintApproximationStateStorage* previous_storage =
+      previous ? static_cast<const ConstraintApproximationStateStorage*>(previous->getStateStorage().get()) : NULL;
+  if (previous_storage)
+  {
+    previous_milestones = std::min(previous->getMilestoneCount(), previous_storage->size());
+    for (std::size_t i = 0; i < previous_milestones; ++i)
+    {
+      sstor->addState(previous_storage->getState(i));
+      cass->getMetadata(i).first = previous_storage->getMetadata(i).first;
+    }
+  }
 
-  robot_state::RobotState kstate(default_state);
+  // construct the constrained states; every thread has its own sampler
   const constraint_samplers::ConstraintSamplerManagerPtr& csmng = pcontext->getConstraintSamplerManager();
-  ConstrainedSampler* csmp = NULL;
-  if (csmng)
+  std::vector<ConstrainedSampler*> csmps(threads, NULL);
+  std::vector<ob::StateSamplerPtr> samplers(threads);
+  for (unsigned int t = 0; t < threads; ++t)
   {
-    constraint_samplers::ConstraintSamplerPtr cs =
-        csmng->selectSampler(pcontext->getPlanningScene(), pcontext->getJointModelGroup()->getName(), constr_sampling);
-    if (cs)
-      csmp = new ConstrainedSampler(pcontext.get(), cs);
+    if (csmng)
+    {
+      constraint_samplers::ConstraintSamplerPtr cs = csmng->selectSampler(
+          pcontext->getPlanningScene(), pcontext->getJointModelGroup()->getName(), constr_sampling);
+      if (cs)
+        csmps[t] = new ConstrainedSampler(pcontext.get(), cs);
+    }
+    samplers[t] = csmps[t] ? ob::StateSamplerPtr(csmps[t]) : pcontext->getOMPLStateSpace()->allocDefaultStateSampler();
   }
 
-  ob::StateSamplerPtr ss(csmp ? ob::StateSamplerPtr(csmp) : pcontext->getOMPLStateSpace()->allocDefaultStateSampler());
-
-  ompl::base::ScopedState<> temp(pcontext->getOMPLStateSpace());
+  boost::mutex storage_lock;
+  std::atomic<std::size_t> attempts(0);
+  std::atomic<bool> give_up(false);
   int done = -1;
   bool slow_warn = false;
   ompl::time::point start = ompl::time::now();
-  while (sstor->size() < options.samples)
-  {
-    ++attempts;
-    int done_now = 100 * sstor->size() / options.samples;
-    if (done != done_now)
+  auto sample = [&](unsigned int t) {
+    robot_state::RobotState kstate(default_state);
+    ompl::base::ScopedState<> temp(pcontext->getOMPLStateSpace());
+    while (!give_up)
     {
-      done = done_now;
-      ROS_INFO_NAMED("constraints_library", "%d%% complete (kept %0.1lf%% sampled states)", done,
-                     100.0 * (double)sstor->size() / (double)attempts);
-    }
+      std::size_t attempt = ++attempts;
+      {
+        boost::mutex::scoped_lock slock(storage_lock);
+        if (sstor->size() >= options.samples)
+          break;
 
-    if (!slow_warn && attempts > 10 && attempts > sstor->size() * 100)
-    {
-      slow_warn = true;
-      ROS_WARN_NAMED("constraints_library", "Computation of valid state database is very slow...");
-    }
+        int done_now = 100 * sstor->size() / options.samples;
+        if (done != done_now)
+        {
+          done = done_now;
+          ROS_INFO_NAMED("constraints_library", "%d%% complete (kept %0.1lf%% sampled states)", done,
+                         100.0 * (double)sstor->size() / (double)attempt);
+        }
 
-    if (attempts > options.samples && sstor->size() == 0)
-    {
-      ROS_ERROR_NAMED("constraints_library", "Unable to generate any samples");
-      break;
-    }
+        if (!slow_warn && attempt > 10 && attempt > sstor->size() * 100)
+        {
+          slow_warn = true;
+          ROS_WARN_NAMED("constraints_library", "Computation of valid state database is very slow...");
+        }
 
-    ss->sampleUniform(temp.get());
-    pcontext->getOMPLStateSpace()->copyToRobotState(kstate, temp.get());
-    if (kset.decide(kstate).satisfied)
-    {
-      if (sstor->size() < options.samples)
+        if (attempt > options.samples && sstor->size() == 0)
+        {
+          ROS_ERROR_NAMED("constraints_library", "Unable to generate any samples");
+          give_up = true;
+          break;
+        }
+      }
+
+      samplers[t]->sampleUniform(temp.get());
+      pcontext->getOMPLStateSpace()->copyToRobotState(kstate, temp.get());
+      if (ksets[t]->isSatisfied(kstate))
       {
-        temp->as<ModelBasedStateSpace::StateType>()->tag = sstor->size();
-        sstor->addState(temp.get());
+        boost::mutex::scoped_lock slock(storage_lock);
+        if (sstor->size() < options.samples)
+        {
+          temp->as<ModelBasedStateSpace::StateType>()->tag = sstor->size();
+          sstor->addState(temp.get());
+        }
       }
     }
-  }
+  };
+  runInThreads(threads, sample);
 
   result.state_sampling_time = ompl::time::seconds(ompl::time::now() - start);
-  ROS_INFO_NAMED("constraints_library", "Generated %u states in %lf seconds", (unsigned int)sstor->size(),
-                 result.state_sampling_time);
-  if (csmp)
+  ROS_INFO_NAMED("constraints_library", "Generated %u states in %lf seconds using %u threads",
+                 (unsigned int)(sstor->size() - previous_milestones), result.state_sampling_time, threads);
+  if (csmps[0])
   {
-    result.sampling_success_rate = csmp->getConstrainedSamplingRate();
+    result.sampling_success_rate = 0.0;
+    for (unsigned int t = 0; t < threads; ++t)
+      result.sampling_success_rate += csmps[t]->getConstrainedSamplingRate() / threads;
     ROS_INFO_NAMED("constraints_library", "Constrained sampling rate: %lf", result.sampling_success_rate);
   }
 
   result.milestones = sstor->size();
+  const std::size_t milestones = sstor->size();
+
+  // the explicit motions of the extended approximation are kept; they are stored after all milestones
+  if (previous_storage && options.explicit_motions)
+    for (std::size_t i = 0; i < previous_milestones; ++i)
+    {
+      const ConstrainedStateMetadata& md = previous_storage->getMetadata(i);
+      for (std::map<std::size_t, std::pair<std::size_t, std::size_t> >::const_iterator it = md.second.begin();
+           it != md.second.end(); ++it)
+      {
+        // both directions of an edge refer to the same states
+        if (it->first < i || it->first >= previous_milestones)
+          continue;
+        std::pair<std::size_t, std::size_t> range(sstor->size(), 0);
+        for (std::size_t k = it->second.first; k < it->second.second; ++k)
+          sstor->addState(previous_storage->getState(k));
+        range.second = sstor->size();
+        cass->getMetadata(i).second[it->first] = range;
+        cass->getMetadata(it->first).second[i] = range;
+      }
+    }
+
   if (options.edges_per_sample > 0)
   {
     ROS_INFO_NAMED("constraints_library", "Computing graph connections (max %u edges per sample) ...",
                    options.edges_per_sample);
 
-    // construct connexions
+    // construct connexions; the threads only read the stored states and decide about the edges of a milestone under
+    // the storage lock. The states of explicit motions are added once all threads are done.
     const ob::StateSpacePtr& space = pcontext->getOMPLSimpleSetup()->getStateSpace();
-    unsigned int milestones = sstor->size();
-    std::vector<ob::State*> int_states(options.max_explicit_points, NULL);
-    pcontext->getOMPLSimpleSetup()->getSpaceInformation()->allocStates(int_states);
-
-    ompl::time::point start = ompl::time::now();
-    int good = 0;
-    int done = -1;
+    const ob::SpaceInformationPtr& si = pcontext->getOMPLSimpleSetup()->getSpaceInformation();
+    std::vector<std::size_t> edge_count(milestones, 0);
+    for (std::size_t i = 0; i < previous_milestones; ++i)
+      edge_count[i] = cass->getMetadata(i).first.size();
 
-    for (std::size_t j = 0; j < milestones; ++j)
+    struct Motion
     {
-      int done_now = 100 * j / milestones;
-      if (done != done_now)
-      {
-        done = done_now;
-        ROS_INFO_NAMED("constraints_library", "%d%% complete", done);
-      }
-      if (cass->getMetadata(j).first.size() >= options.edges_per_sample)
-        continue;
+      std::size_t from, to;
+      std::vector<ob::State*> states;
+    };
+    std::vector<Motion> motions;
 
-      const ob::State* sj = sstor->getState(j);
+    std::atomic<std::size_t> next(0);
+    int good = 0;
+    int done = -1;
+    ompl::time::point start = ompl::time::now();
+    auto connect = [&](unsigned int t) {
+      robot_state::RobotState kstate(default_state);
+      std::vector<ob::State*> int_states(options.max_explicit_points, NULL);
+      si->allocStates(int_states);
 
-      for (std::size_t i = j + 1; i < milestones; ++i)
+      for (std::size_t j = next++; j < milestones; j = next++)
       {
-        if (cass->getMetadata(i).first.size() >= options.edges_per_sample)
-          continue;
-        double d = space->distance(sstor->getState(i), sj);
-        if (d >= options.max_edge_length)
-          continue;
-        unsigned int isteps =
-            std::min<unsigned int>(options.max_explicit_points, d / options.explicit_points_resolution);
-        double step = 1.0 / (double)isteps;
-        double remain = 1.0;
-        bool ok = true;
-        space->interpolate(sstor->getState(i), sj, step, int_states[0]);
-        for (unsigned int k = 1; k < isteps; ++k)
         {
-          double this_step = step / (1.0 - (k - 1) * step);
-          space->interpolate(int_states[k - 1], sj, this_step, int_states[k]);
-          pcontext->getOMPLStateSpace()->copyToRobotState(kstate, int_states[k]);
-          if (!kset.decide(kstate).satisfied)
+          boost::mutex::scoped_lock slock(storage_lock);
+          int done_now = 100 * j / milestones;
+          if (done < done_now)
           {
-            ok = false;
-            break;
+            done = done_now;
+            ROS_INFO_NAMED("constraints_library", "%d%% complete", done);
           }
+          if (edge_count[j] >= options.edges_per_sample)
+            continue;
         }
 
-        if (ok)
-        {
-          cass->getMetadata(i).first.push_back(j);
-          cass->getMetadata(j).first.push_back(i);
+        const ob::State* sj = sstor->getState(j);
 
-          if (options.explicit_motions)
+        // the pairs of milestones that were both part of the extended approximation were considered before
+        for (std::size_t i = std::max(j + 1, j < previous_milestones ? previous_milestones : 0); i < milestones; ++i)
+        {
           {
-            cass->getMetadata(i).second[j].first = sstor->size();
-            for (unsigned int k = 0; k < isteps; ++k)
+            boost::mutex::scoped_lock slock(storage_lock);
+            if (edge_count[i] >= options.edges_per_sample)
+              continue;
+          }
+          double d = space->distance(sstor->getState(i), sj);
+          if (d >= options.max_edge_length)
+            continue;
+          unsigned int isteps =
+              std::min<unsigned int>(options.max_explicit_points, d / options.explicit_points_resolution);
+          double step = 1.0 / (double)isteps;
+          bool ok = true;
+          space->interpolate(sstor->getState(i), sj, step, int_states[0]);
+          for (unsigned int k = 1; k < isteps; ++k)
+          {
+            double this_step = step / (1.0 - (k - 1) * step);
+            space->interpolate(int_states[k - 1], sj, this_step, int_states[k]);
+            pcontext->getOMPLStateSpace()->copyToRobotState(kstate, int_states[k]);
+            if (!ksets[t]->isSatisfied(kstate))
             {
-              int_states[k]->as<ModelBasedStateSpace::StateType>()->tag = -1;
-              sstor->addState(int_states[k]);
+              ok = false;
+              break;
             }
-            cass->getMetadata(i).second[j].second = sstor->size();
-            cass->getMetadata(j).second[i] = cass->getMetadata(i).second[j];
           }
 
-          good++;
-          if (cass->getMetadata(j).first.size() >= options.edges_per_sample)
-            break;
+          if (ok)
+          {
+            boost::mutex::scoped_lock slock(storage_lock);
+            // another thread may have used up the edges of either milestone in the meantime
+            if (edge_count[i] >= options.edges_per_sample)
+              continue;
+            if (edge_count[j] >= options.edges_per_sample)
+              break;
+
+            cass->getMetadata(i).first.push_back(j);
+            cass->getMetadata(j).first.push_back(i);
+            ++edge_count[i];
+            ++edge_count[j];
+
+            if (options.explicit_motions)
+            {
+              Motion motion;
+              motion.from = i;
+              motion.to = j;
+              motion.states.resize(isteps);
+              for (unsigned int k = 0; k < isteps; ++k)
+              {
+                motion.states[k] = space->cloneState(int_states[k]);
+                motion.states[k]->as<ModelBasedStateSpace::StateType>()->tag = -1;
+              }
+              motions.push_back(motion);
+            }
+
+            good++;
+            if (edge_count[j] >= options.edges_per_sample)
+              break;
+          }
         }
       }
+      si->freeStates(int_states);
+    };
+    runInThreads(threads, connect);
+
+    for (std::size_t m = 0; m < motions.size(); ++m)
+    {
+      std::pair<std::size_t, std::size_t> range(sstor->size(), 0);
+      for (std::size_t k = 0; k < motions[m].states.size(); ++k)
+      {
+        sstor->addState(motions[m].states[k]);
+        space->freeState(motions[m].states[k]);
+      }
+      range.second = sstor->size();
+      cass->getMetadata(motions[m].from).second[motions[m].to] = range;
+      cass->getMetadata(motions[m].to).second[motions[m].from] = range;
     }
 
     result.state_connection_time = ompl::time::seconds(ompl::time::now() - start);
     ROS_INFO_NAMED("constraints_library", "Computed possible connexions in %lf seconds. Added %d connexions",
                    result.state_connection_time, good);
-    pcontext->getOMPLSimpleSetup()->getSpaceInformation()->freeStates(int_states);
-
-    return sstor;
   }
+
+  return sstor;
 }
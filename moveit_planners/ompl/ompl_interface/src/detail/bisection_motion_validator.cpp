@@ -0,0 +1,116 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/ompl_interface/detail/bisection_motion_validator.h>
+#include <moveit/ompl_interface/model_based_planning_context.h>
+#include <algorithm>
+
+ompl_interface::BisectionMotionValidator::BisectionMotionValidator(const ModelBasedPlanningContext* pc)
+  : ompl::base::DiscreteMotionValidator(pc->getOMPLSimpleSetup()->getSpaceInformation())
+{
+}
+
+unsigned int ompl_interface::BisectionMotionValidator::findInvalidState(const ompl::base::State* s1,
+                                                                        const ompl::base::State* s2, unsigned int nd,
+                                                                        unsigned int limit, bool first) const
+{
+  if (!scratch_.get())
+    scratch_.reset(new Scratch(si_->getStateSpace()));
+  ompl::base::State* test = scratch_->state;
+
+  // the smallest power of two not below nd; the states at odd multiples of stride / 2 form one level of the
+  // bisection, and the levels together visit every state 0 < j < nd exactly once
+  unsigned int stride = 1;
+  while (stride < nd)
+    stride *= 2;
+  for (; stride > 1; stride /= 2)
+    for (unsigned int j = stride / 2; j < limit; j += stride)
+    {
+      stateSpace_->interpolate(s1, s2, (double)j / (double)nd, test);
+      if (!si_->isValid(test))
+      {
+        if (!first)
+          return j;
+        // states at or after j no longer matter; the following levels only look at the states before it
+        limit = j;
+        break;
+      }
+    }
+  return limit;
+}
+
+bool ompl_interface::BisectionMotionValidator::checkMotion(const ompl::base::State* s1,
+                                                           const ompl::base::State* s2) const
+{
+  // s1 is assumed to be valid
+  bool result = si_->isValid(s2);
+  if (result)
+  {
+    unsigned int nd = stateSpace_->validSegmentCount(s1, s2);
+    result = nd <= 1 || findInvalidState(s1, s2, nd, nd, false) == nd;
+  }
+
+  if (result)
+    valid_++;
+  else
+    invalid_++;
+  return result;
+}
+
+bool ompl_interface::BisectionMotionValidator::checkMotion(const ompl::base::State* s1, const ompl::base::State* s2,
+                                                           std::pair<ompl::base::State*, double>& lastValid) const
+{
+  unsigned int nd = stateSpace_->validSegmentCount(s1, s2);
+  // the first invalid state, where nd stands for s2
+  unsigned int invalid = si_->isValid(s2) ? nd + 1 : nd;
+  if (nd > 1)
+  {
+    unsigned int found = findInvalidState(s1, s2, nd, std::min(invalid, nd), true);
+    if (found < nd)
+      invalid = found;
+  }
+
+  bool result = invalid > nd;
+  if (result)
+    valid_++;
+  else
+  {
+    lastValid.second = (double)(invalid - 1) / (double)nd;
+    if (lastValid.first)
+      stateSpace_->interpolate(s1, s2, lastValid.second, lastValid.first);
+    invalid_++;
+  }
+  return result;
+}
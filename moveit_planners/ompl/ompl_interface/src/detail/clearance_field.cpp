@@ -0,0 +1,188 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/ompl_interface/detail/clearance_field.h>
+#include <geometric_shapes/bodies.h>
+#include <ros/console.h>
+#include <cmath>
+#include <limits>
+
+namespace ompl_interface
+{
+namespace
+{
+// cover a shape with spheres centered on the axis of its bounding cylinder
+template <typename Sphere>
+void decomposeShape(const robot_model::LinkModel* link, const shapes::Shape* shape, const Eigen::Affine3d& pose,
+                    std::vector<Sphere>& spheres)
+{
+  bodies::Body* body = bodies::createBodyFromShape(shape);
+  if (!body)
+    return;
+  body->setPose(pose);
+  bodies::BoundingCylinder cylinder;
+  body->computeBoundingCylinder(cylinder);
+  delete body;
+
+  const double radius = std::max(cylinder.radius, 1e-3);
+  const unsigned int count = std::min(32u, std::max(1u, (unsigned int)std::ceil(cylinder.length / radius)));
+  const double spacing = cylinder.length / count;
+  const Eigen::Vector3d axis = cylinder.pose.linear().col(2);
+  for (unsigned int i = 0; i < count; ++i)
+  {
+    Sphere s;
+    s.link = link;
+    s.center = cylinder.pose.translation() + axis * (-0.5 * cylinder.length + spacing * (i + 0.5));
+    s.radius = std::sqrt(radius * radius + 0.25 * spacing * spacing);
+    spheres.push_back(s);
+  }
+}
+
+bool sameShapes(const std::vector<shapes::ShapeConstPtr>& shapes, const EigenSTL::vector_Affine3d& poses,
+                const collision_detection::World::Object& object)
+{
+  if (shapes.size() != object.shapes_.size())
+    return false;
+  for (std::size_t i = 0; i < shapes.size(); ++i)
+    if (shapes[i] != object.shapes_[i] || !poses[i].matrix().isApprox(object.shape_poses_[i].matrix(), 1e-12))
+      return false;
+  return true;
+}
+}
+
+ClearanceField::ClearanceField(double resolution, double max_distance)
+  : resolution_(resolution), max_distance_(max_distance), min_(Eigen::Vector3d::Zero()), max_(Eigen::Vector3d::Zero())
+{
+}
+
+void ClearanceField::addObject(const std::string& id, const collision_detection::World::Object& object)
+{
+  FieldObject& added = objects_[id];
+  for (std::size_t i = 0; i < object.shapes_.size(); ++i)
+  {
+    // planes have no interior to rasterize
+    if (object.shapes_[i]->type != shapes::PLANE)
+      field_->addShapeToField(object.shapes_[i].get(), object.shape_poses_[i]);
+    added.shapes.push_back(object.shapes_[i]);
+    added.poses.push_back(object.shape_poses_[i]);
+  }
+}
+
+void ClearanceField::removeObject(std::map<std::string, FieldObject>::iterator it)
+{
+  for (std::size_t i = 0; i < it->second.shapes.size(); ++i)
+    if (it->second.shapes[i]->type != shapes::PLANE)
+      field_->removeShapeFromField(it->second.shapes[i].get(), it->second.poses[i]);
+  objects_.erase(it);
+}
+
+void ClearanceField::update(const collision_detection::World& world, const Eigen::Vector3d& min,
+                            const Eigen::Vector3d& max)
+{
+  if (!field_ || !min.isApprox(min_) || !max.isApprox(max_))
+  {
+    min_ = min;
+    max_ = max;
+    Eigen::Vector3d size = max - min;
+    field_.reset(new distance_field::PropagationDistanceField(size.x(), size.y(), size.z(), resolution_, min.x(),
+                                                              min.y(), min.z(), max_distance_));
+    objects_.clear();
+  }
+
+  // remove the objects that disappeared or changed
+  bool removed = false;
+  for (std::map<std::string, FieldObject>::iterator it = objects_.begin(); it != objects_.end();)
+  {
+    std::map<std::string, FieldObject>::iterator current = it++;
+    collision_detection::World::ObjectConstPtr object = world.getObject(current->first);
+    if (!object || !sameShapes(current->second.shapes, current->second.poses, *object))
+    {
+      removeObject(current);
+      removed = true;
+    }
+  }
+
+  // removal clears cells the remaining objects may share; adding occupied cells again is cheap
+  if (removed)
+    for (std::map<std::string, FieldObject>::const_iterator it = objects_.begin(); it != objects_.end(); ++it)
+      for (std::size_t i = 0; i < it->second.shapes.size(); ++i)
+        if (it->second.shapes[i]->type != shapes::PLANE)
+          field_->addShapeToField(it->second.shapes[i].get(), it->second.poses[i]);
+
+  // and add the ones that are not in the field yet
+  for (collision_detection::World::const_iterator it = world.begin(); it != world.end(); ++it)
+    if (objects_.find(it->first) == objects_.end())
+      addObject(it->first, *it->second);
+}
+
+void ClearanceField::setRobot(const robot_state::RobotState& state, const robot_model::JointModelGroup* group)
+{
+  spheres_.clear();
+  const std::vector<const robot_model::LinkModel*>& links = group->getUpdatedLinkModelsWithGeometry();
+  for (std::size_t i = 0; i < links.size(); ++i)
+  {
+    const std::vector<shapes::ShapeConstPtr>& shapes = links[i]->getShapes();
+    const EigenSTL::vector_Affine3d& poses = links[i]->getCollisionOriginTransforms();
+    for (std::size_t j = 0; j < shapes.size(); ++j)
+      decomposeShape(links[i], shapes[j].get(), poses[j], spheres_);
+
+    std::vector<const robot_state::AttachedBody*> attached;
+    state.getAttachedBodies(attached, links[i]);
+    for (std::size_t j = 0; j < attached.size(); ++j)
+      for (std::size_t k = 0; k < attached[j]->getShapes().size(); ++k)
+        decomposeShape(links[i], attached[j]->getShapes()[k].get(), attached[j]->getFixedTransforms()[k], spheres_);
+  }
+}
+
+double ClearanceField::getClearance(const robot_state::RobotState& state) const
+{
+  if (!field_ || objects_.empty())
+    return std::numeric_limits<double>::infinity();
+
+  double clearance = max_distance_;
+  for (std::size_t i = 0; i < spheres_.size(); ++i)
+  {
+    const Eigen::Vector3d center = state.getGlobalLinkTransform(spheres_[i].link) * spheres_[i].center;
+    double d = field_->getDistance(center.x(), center.y(), center.z()) - spheres_[i].radius;
+    if (d < clearance)
+    {
+      clearance = d;
+      if (clearance <= 0.0)
+        return 0.0;
+    }
+  }
+  return clearance;
+}
+}
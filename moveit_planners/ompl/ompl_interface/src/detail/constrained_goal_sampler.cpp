@@ -41,19 +41,28 @@
 
 ompl_interface::ConstrainedGoalSampler::ConstrainedGoalSampler(
     const ModelBasedPlanningContext* pc, const kinematic_constraints::KinematicConstraintSetPtr& ks,
-    const constraint_samplers::ConstraintSamplerPtr& cs)
+    const constraint_samplers::ConstraintSamplerPtr& cs, const std::string& cache_key)
   : ob::GoalLazySamples(pc->getOMPLSimpleSetup()->getSpaceInformation(),
                         boost::bind(&ConstrainedGoalSampler::sampleUsingConstraintSampler, this, _1, _2), false)
   , planning_context_(pc)
   , kinematic_constraint_set_(ks)
   , constraint_sampler_(cs)
   , work_state_(pc->getCompleteInitialRobotState())
+  , solution_states_(pc->getCompleteInitialRobotState())
   , invalid_sampled_constraints_(0)
   , warned_invalid_samples_(false)
   , verbose_display_(0)
 {
   if (!constraint_sampler_)
     default_sampler_ = si_->allocStateSampler();
+  else if (pc->getGoalSampleCache() && !cache_key.empty())
+  {
+    goal_sample_cache_ = pc->getGoalSampleCache();
+    cache_key_ = cache_key;
+    goal_sample_cache_->getSamples(cache_key_, cached_goals_);
+    ROS_DEBUG_NAMED("constrained_goal_sampler", "Trying %u cached goal states first",
+                    (unsigned int)cached_goals_.size());
+  }
   ROS_DEBUG_NAMED("constrained_goal_sampler", "Constructed a ConstrainedGoalSampler instance at address %p", this);
   startSampling();
 }
@@ -66,16 +75,18 @@ bool ompl_interface::ConstrainedGoalSampler::checkStateValidity(ob::State* new_g
   return static_cast<const StateValidityChecker*>(si_->getStateValidityChecker().get())->isValid(new_goal, verbose);
 }
 
-bool ompl_interface::ConstrainedGoalSampler::stateValidityCallback(ob::State* new_goal,
-                                                                   robot_state::RobotState const* state,
+bool ompl_interface::ConstrainedGoalSampler::stateValidityCallback(robot_state::RobotState const* state,
                                                                    const robot_model::JointModelGroup* jmg,
                                                                    const double* jpos, bool verbose) const
 {
-  // we copy the state to not change the seed state
-  robot_state::RobotState solution_state(*state);
-  solution_state.setJointGroupPositions(jmg, jpos);
-  solution_state.update();
-  return checkStateValidity(new_goal, solution_state, verbose);
+  // we copy the state to not change the seed state; the copy reuses per-thread storage rather than allocating
+  robot_state::RobotState* solution_state = solution_states_.getStateStorage();
+  *solution_state = *state;
+  solution_state->setJointGroupPositions(jmg, jpos);
+  solution_state->update();
+  if (!scratch_goals_.get())
+    scratch_goals_.reset(new ob::ScopedState<>(si_->getStateSpace()));
+  return checkStateValidity(scratch_goals_->get(), *solution_state, verbose);
 }
 
 bool ompl_interface::ConstrainedGoalSampler::sampleUsingConstraintSampler(const ob::GoalLazySamples* gls,
@@ -109,24 +120,51 @@ bool ompl_interface::ConstrainedGoalSampler::sampleUsingConstraintSampler(const
         verbose_display_++;
       }
 
-    if (constraint_sampler_)
+    if (constraint_sampler_ && !cached_goals_.empty())
+    {
+      // goals found by earlier attempts only need to be checked against the current scene again
+      goal_values_.swap(cached_goals_.back());
+      cached_goals_.pop_back();
+      work_state_.setJointGroupPositions(planning_context_->getJointModelGroup(), goal_values_);
+      work_state_.update();
+      if (kinematic_constraint_set_->isSatisfied(work_state_, verbose) &&
+          checkStateValidity(new_goal, work_state_, verbose))
+        return true;
+      goal_sample_cache_->removeSample(cache_key_, goal_values_);
+    }
+    else if (constraint_sampler_)
     {
       // makes the constraint sampler also perform a validity callback
       robot_state::GroupStateValidityCallbackFn gsvcf =
-          boost::bind(&ompl_interface::ConstrainedGoalSampler::stateValidityCallback, this, new_goal,
+          boost::bind(&ompl_interface::ConstrainedGoalSampler::stateValidityCallback, this,
                       _1,  // pointer to state
                       _2,  // const* joint model group
                       _3,  // double* of joint positions
                       verbose);
       constraint_sampler_->setGroupStateValidityCallback(gsvcf);
+      constraint_sampler_->setSamplingThreads(planning_context_->getGoalSamplingThreads());
 
-      if (constraint_sampler_->project(work_state_, planning_context_->getMaximumStateSamplingAttempts()))
+      // draw the goals still wanted in one go and hand them out one at a time
+      if (sampled_goals_.empty())
+        constraint_sampler_->sampleBatch(planning_context_->getMaximumGoalSamples() - gls->getStateCount(),
+                                         work_state_, sampled_goals_,
+                                         planning_context_->getMaximumStateSamplingAttempts());
+
+      if (!sampled_goals_.empty())
       {
-        work_state_.update();
-        if (kinematic_constraint_set_->decide(work_state_, verbose).satisfied)
+        robot_state::RobotStatePtr goal_state = sampled_goals_.back();
+        sampled_goals_.pop_back();
+        if (kinematic_constraint_set_->isSatisfied(*goal_state, verbose))
         {
-          if (checkStateValidity(new_goal, work_state_, verbose))
+          if (checkStateValidity(new_goal, *goal_state, verbose))
+          {
+            if (goal_sample_cache_)
+            {
+              goal_state->copyJointGroupPositions(planning_context_->getJointModelGroup(), goal_values_);
+              goal_sample_cache_->addSample(cache_key_, goal_values_);
+            }
             return true;
+          }
         }
         else
         {
@@ -147,7 +185,7 @@ bool ompl_interface::ConstrainedGoalSampler::sampleUsingConstraintSampler(const
       if (static_cast<const StateValidityChecker*>(si_->getStateValidityChecker().get())->isValid(new_goal, verbose))
       {
         planning_context_->getOMPLStateSpace()->copyToRobotState(work_state_, new_goal);
-        if (kinematic_constraint_set_->decide(work_state_, verbose).satisfied)
+        if (kinematic_constraint_set_->isSatisfied(work_state_, verbose))
           return true;
       }
     }
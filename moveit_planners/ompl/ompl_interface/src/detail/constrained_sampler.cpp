@@ -37,13 +37,16 @@
 #include <moveit/ompl_interface/detail/constrained_sampler.h>
 #include <moveit/ompl_interface/model_based_planning_context.h>
 #include <moveit/profiler/profiler.h>
+#include <algorithm>
 
 ompl_interface::ConstrainedSampler::ConstrainedSampler(const ModelBasedPlanningContext* pc,
-                                                       const constraint_samplers::ConstraintSamplerPtr& cs)
+                                                       const constraint_samplers::ConstraintSamplerPtr& cs,
+                                                       const ConstrainedStatePool::EntryPtr& pool_entry)
   : ob::StateSampler(pc->getOMPLStateSpace().get())
   , planning_context_(pc)
   , default_(space_->allocDefaultStateSampler())
   , constraint_sampler_(cs)
+  , pool_entry_(pool_entry)
   , work_state_(pc->getCompleteInitialRobotState())
   , constrained_success_(0)
   , constrained_failure_(0)
@@ -59,10 +62,29 @@ double ompl_interface::ConstrainedSampler::getConstrainedSamplingRate() const
     return (double)constrained_success_ / (double)(constrained_success_ + constrained_failure_);
 }
 
+bool ompl_interface::ConstrainedSampler::samplePool(ob::State* state)
+{
+  // draw from the pool more often as it fills up, but keep computing some samples so the pool keeps being refreshed
+  if (!pool_entry_ || pool_entry_->size() == 0 ||
+      rng_.uniform01() >= 0.9 * pool_entry_->size() / std::max<std::size_t>(1, pool_entry_->getMaximumSize()))
+    return false;
+  if (!pool_entry_->sample(rng_, pool_values_))
+    return false;
+  work_state_.setJointGroupPositions(pool_entry_->getJointModelGroup(), pool_values_);
+  planning_context_->getOMPLStateSpace()->copyToOMPLState(state, work_state_);
+  return space_->satisfiesBounds(state);
+}
+
 bool ompl_interface::ConstrainedSampler::sampleC(ob::State* state)
 {
   //  moveit::Profiler::ScopedBlock sblock("sampleWithConstraints");
 
+  if (samplePool(state))
+  {
+    ++constrained_success_;
+    return true;
+  }
+
   if (constraint_sampler_->sample(work_state_, planning_context_->getCompleteInitialRobotState(),
                                   planning_context_->getMaximumStateSamplingAttempts()))
   {
@@ -70,6 +92,16 @@ bool ompl_interface::ConstrainedSampler::sampleC(ob::State* state)
     if (space_->satisfiesBounds(state))
     {
       ++constrained_success_;
+      // constraint samplers do not always guarantee the constraints hold, so only checked samples are pooled
+      if (pool_entry_)
+      {
+        work_state_.update();
+        if (planning_context_->getPathConstraints()->decide(work_state_).satisfied)
+        {
+          work_state_.copyJointGroupPositions(pool_entry_->getJointModelGroup(), pool_values_);
+          pool_entry_->add(pool_values_);
+        }
+      }
       return true;
     }
   }
@@ -61,7 +61,7 @@ bool ompl_interface::ValidConstrainedSampler::project(ompl::base::State* state)
     planning_context_->getOMPLStateSpace()->copyToRobotState(work_state_, state);
     if (constraint_sampler_->project(work_state_, planning_context_->getMaximumStateSamplingAttempts()))
     {
-      if (kinematic_constraint_set_->decide(work_state_).satisfied)
+      if (kinematic_constraint_set_->isSatisfied(work_state_))
       {
         planning_context_->getOMPLStateSpace()->copyToOMPLState(state, work_state_);
         return true;
@@ -79,7 +79,7 @@ bool ompl_interface::ValidConstrainedSampler::sample(ob::State* state)
     if (constraint_sampler_->sample(work_state_, planning_context_->getCompleteInitialRobotState(),
                                     planning_context_->getMaximumStateSamplingAttempts()))
     {
-      if (kinematic_constraint_set_->decide(work_state_).satisfied)
+      if (kinematic_constraint_set_->isSatisfied(work_state_))
       {
         planning_context_->getOMPLStateSpace()->copyToOMPLState(state, work_state_);
         return true;
@@ -90,7 +90,7 @@ bool ompl_interface::ValidConstrainedSampler::sample(ob::State* state)
   {
     default_sampler_->sampleUniform(state);
     planning_context_->getOMPLStateSpace()->copyToRobotState(work_state_, state);
-    if (kinematic_constraint_set_->decide(work_state_).satisfied)
+    if (kinematic_constraint_set_->isSatisfied(work_state_))
       return true;
   }
 
@@ -108,7 +108,7 @@ bool ompl_interface::ValidConstrainedSampler::sampleNear(ompl::base::State* stat
     double dist = pow(rng_.uniform01(), inv_dim_) * distance;
     si_->getStateSpace()->interpolate(near, state, dist / total_d, state);
     planning_context_->getOMPLStateSpace()->copyToRobotState(work_state_, state);
-    if (!kinematic_constraint_set_->decide(work_state_).satisfied)
+    if (!kinematic_constraint_set_->isSatisfied(work_state_))
       return false;
   }
   return true;
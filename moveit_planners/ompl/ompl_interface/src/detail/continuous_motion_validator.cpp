@@ -0,0 +1,101 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/ompl_interface/detail/continuous_motion_validator.h>
+#include <moveit/ompl_interface/model_based_planning_context.h>
+
+namespace
+{
+// Each continuous check covers the motion that discrete validation would cover with this many segments. The links
+// are assumed to move along straight lines between the ends of each segment, so segments must not get too long.
+const unsigned int DISCRETE_SEGMENTS_PER_CHECK = 10;
+}
+
+ompl_interface::ContinuousMotionValidator::ContinuousMotionValidator(const ModelBasedPlanningContext* pc)
+  : ompl::base::DiscreteMotionValidator(pc->getOMPLSimpleSetup()->getSpaceInformation())
+  , planning_context_(pc)
+  , tss_start_(pc->getCompleteInitialRobotState())
+  , tss_end_(pc->getCompleteInitialRobotState())
+{
+  collision_request_.group_name = planning_context_->getGroupName();
+}
+
+bool ompl_interface::ContinuousMotionValidator::checkMotion(const ompl::base::State* s1,
+                                                            const ompl::base::State* s2) const
+{
+  // path constraints can only be checked at discrete states
+  if (planning_context_->getPathConstraints())
+    return ompl::base::DiscreteMotionValidator::checkMotion(s1, s2);
+
+  // s1 is assumed to be valid
+  if (!si_->isValid(s2))
+  {
+    invalid_++;
+    return false;
+  }
+
+  const ompl::base::StateSpacePtr& space = si_->getStateSpace();
+  unsigned int nd = (space->validSegmentCount(s1, s2) + DISCRETE_SEGMENTS_PER_CHECK - 1) / DISCRETE_SEGMENTS_PER_CHECK;
+
+  robot_state::RobotState* start = tss_start_.getStateStorage();
+  robot_state::RobotState* end = tss_end_.getStateStorage();
+  const ModelBasedStateSpacePtr& model_space = planning_context_->getOMPLStateSpace();
+  model_space->copyToRobotState(*start, s1);
+
+  ompl::base::State* test = si_->allocState();
+  bool result = true;
+  for (unsigned int j = 1; result && j <= nd; ++j)
+  {
+    if (j < nd)
+    {
+      space->interpolate(s1, s2, (double)j / (double)nd, test);
+      model_space->copyToRobotState(*end, test);
+    }
+    else
+      model_space->copyToRobotState(*end, s2);
+
+    collision_detection::CollisionResult res;
+    planning_context_->getPlanningScene()->checkCollisionContinuous(collision_request_, res, *start, *end);
+    result = !res.collision;
+    std::swap(start, end);
+  }
+  si_->freeState(test);
+
+  if (result)
+    valid_++;
+  else
+    invalid_++;
+  return result;
+}
@@ -0,0 +1,91 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/ompl_interface/detail/flat_nearest_neighbors.h>
+#include <moveit/ompl_interface/parameterization/joint_space/joint_model_state_space.h>
+#include <moveit/robot_model/revolute_joint_model.h>
+
+namespace
+{
+thread_local const ompl_interface::FlatDistanceLayout* current_layout = nullptr;
+}
+
+bool ompl_interface::FlatDistanceLayout::compute(const ompl::base::StateSpace* space)
+{
+  factors.clear();
+  continuous.clear();
+
+  // other parameterizations may compute distances in a different space
+  const JointModelStateSpace* joint_space = dynamic_cast<const JointModelStateSpace*>(space);
+  if (!joint_space)
+    return false;
+  const robot_model::JointModelGroup* jmg = joint_space->getJointModelGroup();
+  if (!jmg->getMimicJointModels().empty())
+    return false;
+
+  const std::vector<const robot_model::JointModel*>& joints = jmg->getActiveJointModels();
+  factors.resize(jmg->getVariableCount(), 0.0);
+  continuous.resize(factors.size(), 0);
+  for (std::size_t i = 0; i < joints.size(); ++i)
+  {
+    const robot_model::JointModel* joint = joints[i];
+    int index = jmg->getVariableGroupIndex(joint->getName());
+    if (index < 0 || (joint->getType() != robot_model::JointModel::REVOLUTE &&
+                      joint->getType() != robot_model::JointModel::PRISMATIC))
+    {
+      factors.clear();
+      continuous.clear();
+      return false;
+    }
+    factors[index] = joint->getDistanceFactor();
+    if (joint->getType() == robot_model::JointModel::REVOLUTE)
+      continuous[index] = static_cast<const robot_model::RevoluteJointModel*>(joint)->isContinuous();
+  }
+  return !factors.empty();
+}
+
+const ompl_interface::FlatDistanceLayout* ompl_interface::FlatDistanceLayout::current()
+{
+  return current_layout;
+}
+
+ompl_interface::FlatDistanceLayout::Scope::Scope(const FlatDistanceLayout* layout) : previous_(current_layout)
+{
+  current_layout = layout;
+}
+
+ompl_interface::FlatDistanceLayout::Scope::~Scope()
+{
+  current_layout = previous_;
+}
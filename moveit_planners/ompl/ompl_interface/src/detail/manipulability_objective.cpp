@@ -0,0 +1,121 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/ompl_interface/detail/manipulability_objective.h>
+#include <moveit/ompl_interface/model_based_planning_context.h>
+#include <ros/console.h>
+#include <algorithm>
+
+namespace ompl_interface
+{
+namespace
+{
+// keeps the cost finite at singular configurations
+const double MANIPULABILITY_EPSILON = 1e-3;
+}
+
+ManipulabilityObjective::ManipulabilityObjective(const ModelBasedPlanningContext* planning_context, bool translation)
+  : ompl::base::StateCostIntegralObjective(planning_context->getOMPLSimpleSetup()->getSpaceInformation(), true)
+  , planning_context_(planning_context)
+  , metrics_(planning_context->getRobotModel())
+  , translation_(translation)
+{
+  description_ = "Manipulability";
+  if (!planning_context->getJointModelGroup()->isChain())
+    ROS_WARN_NAMED("manipulability_objective", "Manipulability is only defined for chains; group '%s' is not one",
+                   planning_context->getJointModelGroup()->getName().c_str());
+}
+
+ManipulabilityObjective::Scratch& ManipulabilityObjective::getScratch(std::size_t state_count) const
+{
+  Scratch* scratch = scratch_.get();
+  if (!scratch)
+  {
+    scratch = new Scratch();
+    scratch_.reset(scratch);
+  }
+  while (scratch->states.size() < state_count)
+    scratch->states.push_back(planning_context_->getCompleteInitialRobotState());
+  return *scratch;
+}
+
+ompl::base::Cost ManipulabilityObjective::costFromIndex(double manipulability_index) const
+{
+  return ompl::base::Cost(1.0 / (MANIPULABILITY_EPSILON + manipulability_index));
+}
+
+ompl::base::Cost ManipulabilityObjective::stateCost(const ompl::base::State* state) const
+{
+  Scratch& scratch = getScratch(1);
+  planning_context_->getOMPLStateSpace()->copyToRobotState(scratch.states[0], state);
+  scratch.state_pointers.assign(1, &scratch.states[0]);
+  if (!metrics_.getManipulabilityIndices(scratch.state_pointers, planning_context_->getJointModelGroup(),
+                                         scratch.indices, translation_))
+    return identityCost();
+  return costFromIndex(scratch.indices[0]);
+}
+
+ompl::base::Cost ManipulabilityObjective::motionCost(const ompl::base::State* s1, const ompl::base::State* s2) const
+{
+  const unsigned int segments = std::max(1u, si_->getStateSpace()->validSegmentCount(s1, s2));
+  Scratch& scratch = getScratch(segments + 1);
+
+  // interpolate all states of the motion first, then evaluate them in one batch
+  const robot_model::JointModelGroup* group = planning_context_->getJointModelGroup();
+  robot_state::RobotState& first = scratch.states[0];
+  robot_state::RobotState& last = scratch.states[segments];
+  planning_context_->getOMPLStateSpace()->copyToRobotState(first, s1);
+  planning_context_->getOMPLStateSpace()->copyToRobotState(last, s2);
+  scratch.state_pointers.resize(segments + 1);
+  scratch.state_pointers[0] = &first;
+  scratch.state_pointers[segments] = &last;
+  for (unsigned int i = 1; i < segments; ++i)
+  {
+    first.interpolate(last, (double)i / (double)segments, scratch.states[i], group);
+    scratch.states[i].update();
+    scratch.state_pointers[i] = &scratch.states[i];
+  }
+
+  if (!metrics_.getManipulabilityIndices(scratch.state_pointers, group, scratch.indices, translation_))
+    return identityCost();
+
+  // integrate the state costs with the trapezoidal rule, like StateCostIntegralObjective
+  const double segment_length = si_->distance(s1, s2) / segments;
+  double total = 0.0;
+  for (unsigned int i = 0; i < segments; ++i)
+    total +=
+        trapezoid(costFromIndex(scratch.indices[i]), costFromIndex(scratch.indices[i + 1]), segment_length).value();
+  return ompl::base::Cost(total);
+}
+}
@@ -37,6 +37,8 @@
 #include <moveit/ompl_interface/detail/projection_evaluators.h>
 #include <moveit/ompl_interface/model_based_planning_context.h>
 #include <moveit/ompl_interface/parameterization/model_based_state_space.h>
+#include <boost/thread/mutex.hpp>
+#include <Eigen/Eigenvalues>
 
 ompl_interface::ProjectionEvaluatorLinkPose::ProjectionEvaluatorLinkPose(const ModelBasedPlanningContext* pc,
                                                                          const std::string& link)
@@ -95,3 +97,118 @@ void ompl_interface::ProjectionEvaluatorJointValue::project(const ompl::base::St
   for (std::size_t i = 0; i < variables_.size(); ++i)
     projection(i) = state->as<ModelBasedStateSpace::StateType>()->values[variables_[i]];
 }
+
+namespace
+{
+// number of valid states the principal components are computed from, and the attempts made to sample them
+const unsigned int PCA_SAMPLES = 1000;
+const unsigned int PCA_SAMPLE_ATTEMPTS = 10 * PCA_SAMPLES;
+
+struct PCAComponents
+{
+  Eigen::VectorXd mean;
+  Eigen::MatrixXd components;
+};
+
+boost::mutex pca_cache_lock;
+std::map<std::string, PCAComponents> pca_cache;
+}
+
+ompl_interface::ProjectionEvaluatorPCA::ProjectionEvaluatorPCA(const ModelBasedPlanningContext* pc,
+                                                               unsigned int dimension)
+  : ompl::base::ProjectionEvaluator(pc->getOMPLStateSpace())
+  , planning_context_(pc)
+  , dimension_(std::min(dimension, pc->getJointModelGroup()->getVariableCount()))
+{
+}
+
+unsigned int ompl_interface::ProjectionEvaluatorPCA::getDimension() const
+{
+  return dimension_;
+}
+
+void ompl_interface::ProjectionEvaluatorPCA::defaultCellSizes()
+{
+  // the components are scaled to the standard deviation of the samples along them
+  cellSizes_.clear();
+  cellSizes_.resize(dimension_, 0.2);
+}
+
+void ompl_interface::ProjectionEvaluatorPCA::setup()
+{
+  if (components_.rows() == 0)
+    computeComponents();
+  ompl::base::ProjectionEvaluator::setup();
+}
+
+void ompl_interface::ProjectionEvaluatorPCA::computeComponents()
+{
+  // the name of the state space includes the group and the parameterization
+  const std::string key = planning_context_->getRobotModel()->getName() + "/" +
+                          planning_context_->getOMPLStateSpace()->getName() + "/" + std::to_string(dimension_);
+  boost::mutex::scoped_lock slock(pca_cache_lock);
+  std::map<std::string, PCAComponents>::const_iterator it = pca_cache.find(key);
+  if (it != pca_cache.end())
+  {
+    mean_ = it->second.mean;
+    components_ = it->second.components;
+    return;
+  }
+
+  const ompl::base::SpaceInformationPtr& si = planning_context_->getOMPLSimpleSetup()->getSpaceInformation();
+  const unsigned int variable_count = planning_context_->getJointModelGroup()->getVariableCount();
+  ompl::base::StateSamplerPtr sampler = si->allocStateSampler();
+  ompl::base::State* state = si->allocState();
+  Eigen::MatrixXd samples(variable_count, PCA_SAMPLES);
+  unsigned int count = 0;
+  for (unsigned int i = 0; i < PCA_SAMPLE_ATTEMPTS && count < PCA_SAMPLES; ++i)
+  {
+    sampler->sampleUniform(state);
+    if (si->isValid(state))
+      samples.col(count++) = Eigen::Map<const Eigen::VectorXd>(state->as<ModelBasedStateSpace::StateType>()->values,
+                                                               variable_count);
+  }
+  si->freeState(state);
+
+  PCAComponents pca;
+  pca.mean = Eigen::VectorXd::Zero(variable_count);
+  pca.components = Eigen::MatrixXd::Zero(dimension_, variable_count);
+  if (count <= variable_count)
+  {
+    // too few valid samples to tell anything; project onto the first variables, as joints(...) would
+    ROS_WARN_NAMED("projection_evaluators", "Only %u of %u sampled states of group '%s' are valid. Projecting onto the "
+                                            "first %u variables instead of their principal components.",
+                   count, PCA_SAMPLE_ATTEMPTS, planning_context_->getGroupName().c_str(), dimension_);
+    for (unsigned int i = 0; i < dimension_; ++i)
+      pca.components(i, i) = 1.0;
+  }
+  else
+  {
+    Eigen::MatrixXd valid = samples.leftCols(count);
+    pca.mean = valid.rowwise().mean();
+    valid.colwise() -= pca.mean;
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eigen(valid * valid.transpose() / (count - 1));
+
+    // eigenvalues come in increasing order
+    for (unsigned int i = 0; i < dimension_; ++i)
+    {
+      const unsigned int c = variable_count - 1 - i;
+      const double stddev = std::sqrt(std::max(eigen.eigenvalues()(c), 0.0));
+      pca.components.row(i) = eigen.eigenvectors().col(c).transpose() / std::max(stddev, 1e-6);
+    }
+    ROS_DEBUG_NAMED("projection_evaluators", "Computed %u principal components of group '%s' from %u valid states",
+                    dimension_, planning_context_->getGroupName().c_str(), count);
+  }
+  pca_cache[key] = pca;
+  mean_ = pca.mean;
+  components_ = pca.components;
+}
+
+void ompl_interface::ProjectionEvaluatorPCA::project(const ompl::base::State* state,
+                                                     ompl::base::EuclideanProjection& projection) const
+{
+  Eigen::Map<const Eigen::VectorXd> values(state->as<ModelBasedStateSpace::StateType>()->values, mean_.size());
+  Eigen::VectorXd p = components_ * (values - mean_);
+  for (unsigned int i = 0; i < dimension_; ++i)
+    projection(i) = p(i);
+}
@@ -0,0 +1,135 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/ompl_interface/detail/state_validity_cache.h>
+#include <cmath>
+#include <cstring>
+
+ompl_interface::StateValidityCache::StateValidityCache(std::size_t dimension, std::size_t size, double resolution)
+  : dimension_(dimension), size_(1), resolution_(resolution > 0.0 ? resolution : 1e-6), generation_(1)
+{
+  while (size_ < size)
+    size_ <<= 1;
+}
+
+ompl_interface::StateValidityCache::~StateValidityCache()
+{
+  for (std::map<boost::thread::id, Table*>::iterator it = tables_.begin(); it != tables_.end(); ++it)
+    delete it->second;
+}
+
+ompl_interface::StateValidityCache::Table& ompl_interface::StateValidityCache::getTable() const
+{
+  const boost::thread::id id = boost::this_thread::get_id();
+  {
+    boost::shared_lock<boost::shared_mutex> slock(lock_);
+    std::map<boost::thread::id, Table*>::const_iterator it = tables_.find(id);
+    if (it != tables_.end())
+      return *it->second;
+  }
+
+  Table* table = new Table();
+  table->keys.resize(size_ * dimension_, 0);
+  table->entries.resize(size_);
+  table->scratch.resize(dimension_);
+  for (std::size_t i = 0; i < size_; ++i)
+    table->entries[i].generation = 0;
+  boost::unique_lock<boost::shared_mutex> ulock(lock_);
+  tables_[id] = table;
+  return *table;
+}
+
+std::uint64_t ompl_interface::StateValidityCache::quantize(const double* values, std::int64_t* key) const
+{
+  // FNV-1a over the quantized values
+  std::uint64_t hash = 14695981039346656037ull;
+  for (std::size_t i = 0; i < dimension_; ++i)
+  {
+    key[i] = static_cast<std::int64_t>(std::floor(values[i] / resolution_ + 0.5));
+    hash = (hash ^ static_cast<std::uint64_t>(key[i])) * 1099511628211ull;
+  }
+  return hash;
+}
+
+bool ompl_interface::StateValidityCache::lookup(const double* values, Result& result) const
+{
+  Table& table = getTable();
+  std::int64_t* key = table.scratch.data();
+  std::size_t slot = quantize(values, key) & (size_ - 1);
+  const Entry& entry = table.entries[slot];
+  if (entry.generation != generation_.load(std::memory_order_relaxed) ||
+      memcmp(&table.keys[slot * dimension_], key, dimension_ * sizeof(std::int64_t)) != 0)
+    return false;
+  result = entry.result;
+  return true;
+}
+
+void ompl_interface::StateValidityCache::store(const double* values, const Result& result) const
+{
+  Table& table = getTable();
+  std::int64_t* key = table.scratch.data();
+  std::size_t slot = quantize(values, key) & (size_ - 1);
+  Entry& entry = table.entries[slot];
+  std::int64_t* stored_key = &table.keys[slot * dimension_];
+  const std::uint64_t generation = generation_.load(std::memory_order_relaxed);
+
+  // a different state in the slot is replaced, results for the same state are merged
+  if (entry.generation != generation || memcmp(stored_key, key, dimension_ * sizeof(std::int64_t)) != 0)
+  {
+    entry.generation = generation;
+    entry.result = Result();
+    memcpy(stored_key, key, dimension_ * sizeof(std::int64_t));
+  }
+  if (result.validity_known)
+  {
+    entry.result.validity_known = true;
+    entry.result.valid = result.valid;
+  }
+  if (result.distance_known)
+  {
+    entry.result.distance_known = true;
+    entry.result.distance = result.distance;
+  }
+  if (result.clearance_known)
+  {
+    entry.result.clearance_known = true;
+    entry.result.clearance = result.clearance;
+  }
+}
+
+void ompl_interface::StateValidityCache::clear()
+{
+  generation_.fetch_add(1, std::memory_order_relaxed);
+}
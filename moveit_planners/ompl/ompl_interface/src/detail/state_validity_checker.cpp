@@ -37,6 +37,8 @@
 #include <moveit/ompl_interface/detail/state_validity_checker.h>
 #include <moveit/ompl_interface/model_based_planning_context.h>
 #include <moveit/profiler/profiler.h>
+#include <moveit/profiler/probes.h>
+#include <geometric_shapes/shape_operations.h>
 #include <ros/ros.h>
 
 ompl_interface::StateValidityChecker::StateValidityChecker(const ModelBasedPlanningContext* pc)
@@ -45,6 +47,7 @@ ompl_interface::StateValidityChecker::StateValidityChecker(const ModelBasedPlann
   , group_name_(pc->getGroupName())
   , tss_(pc->getCompleteInitialRobotState())
   , verbose_(false)
+  , lazy_collision_checking_(false)
 {
   specs_.clearanceComputationType = ompl::base::StateValidityCheckerSpecs::APPROXIMATE;
   specs_.hasValidDirectionComputation = false;
@@ -68,18 +71,180 @@ void ompl_interface::StateValidityChecker::setVerbose(bool flag)
   verbose_ = flag;
 }
 
+void ompl_interface::StateValidityChecker::setValidityCache(std::size_t size, double resolution)
+{
+  if (size == 0)
+    validity_cache_.reset();
+  else
+    validity_cache_.reset(new StateValidityCache(
+        planning_context_->getOMPLStateSpace()->getJointModelGroup()->getVariableCount(), size, resolution));
+}
+
+void ompl_interface::StateValidityChecker::clearValidityCache()
+{
+  if (validity_cache_)
+    validity_cache_->clear();
+}
+
+void ompl_interface::StateValidityChecker::setClearanceField(const ClearanceFieldConstPtr& field)
+{
+  clearance_field_ = field;
+  clearValidityCache();
+}
+
+void ompl_interface::StateValidityChecker::setLazyCollisionChecking(bool flag)
+{
+  lazy_collision_checking_ = flag;
+  robot_spheres_.clear();
+  world_spheres_.clear();
+  if (flag)
+    computeBoundingSpheres();
+}
+
+void ompl_interface::StateValidityChecker::computeBoundingSpheres()
+{
+  const planning_scene::PlanningSceneConstPtr& scene = planning_context_->getPlanningScene();
+  const collision_detection::CollisionRobotConstPtr& crobot = scene->getCollisionRobot();
+  const robot_state::RobotState& initial_state = planning_context_->getCompleteInitialRobotState();
+
+  // the spheres of the links enclose their centered bounding boxes, enlarged by the padding used for world collisions
+  const std::vector<const robot_model::LinkModel*>& links =
+      scene->getRobotModel()->getLinkModelsWithCollisionGeometry();
+  for (std::size_t i = 0; i < links.size(); ++i)
+  {
+    BoundingSphere s;
+    s.link = links[i];
+    s.center = links[i]->getCenteredBoundingBoxOffset();
+    s.radius = 0.5 * links[i]->getShapeExtentsAtOrigin().norm() * crobot->getLinkScale(links[i]->getName()) +
+               crobot->getLinkPadding(links[i]->getName());
+    robot_spheres_.push_back(s);
+  }
+
+  // attached bodies do not change while planning, so their spheres are fixed in the frame of the link they are on
+  std::vector<const robot_state::AttachedBody*> attached;
+  initial_state.getAttachedBodies(attached);
+  for (std::size_t i = 0; i < attached.size(); ++i)
+  {
+    const std::vector<shapes::ShapeConstPtr>& shapes = attached[i]->getShapes();
+    const EigenSTL::vector_Affine3d& poses = attached[i]->getFixedTransforms();
+    double padding = crobot->getLinkPadding(attached[i]->getAttachedLinkName());
+    for (std::size_t j = 0; j < shapes.size(); ++j)
+    {
+      BoundingSphere s;
+      s.link = attached[i]->getAttachedLink();
+      shapes::computeShapeBoundingSphere(shapes[j].get(), s.center, s.radius);
+      s.center = poses[j] * s.center;
+      s.radius += padding;
+      robot_spheres_.push_back(s);
+    }
+  }
+
+  const collision_detection::WorldConstPtr& world = scene->getWorld();
+  for (collision_detection::World::const_iterator it = world->begin(); it != world->end(); ++it)
+    for (std::size_t j = 0; j < it->second->shapes_.size(); ++j)
+    {
+      const shapes::ShapeConstPtr& shape = it->second->shapes_[j];
+      // unbounded objects cannot be screened, so every state is checked exactly
+      if (shape->type == shapes::OCTREE || shape->type == shapes::PLANE)
+      {
+        ROS_DEBUG_NAMED("state_validity_checker", "World object '%s' is unbounded; lazy collision checking disabled",
+                        it->first.c_str());
+        lazy_collision_checking_ = false;
+        robot_spheres_.clear();
+        world_spheres_.clear();
+        return;
+      }
+      BoundingSphere s;
+      s.link = nullptr;
+      shapes::computeShapeBoundingSphere(shape.get(), s.center, s.radius);
+      s.center = it->second->shape_poses_[j] * s.center;
+      world_spheres_.push_back(s);
+    }
+}
+
+bool ompl_interface::StateValidityChecker::isClearOfWorld(const robot_state::RobotState& state) const
+{
+  for (std::size_t i = 0; i < robot_spheres_.size(); ++i)
+  {
+    const BoundingSphere& r = robot_spheres_[i];
+    Eigen::Vector3d center = state.getGlobalLinkTransform(r.link) * r.center;
+    for (std::size_t j = 0; j < world_spheres_.size(); ++j)
+    {
+      double d = r.radius + world_spheres_[j].radius;
+      if ((center - world_spheres_[j].center).squaredNorm() <= d * d)
+        return false;
+    }
+  }
+  return true;
+}
+
+bool ompl_interface::StateValidityChecker::isCollisionFree(robot_state::RobotState& state, bool verbose) const
+{
+  collision_detection::CollisionResult res;
+  const collision_detection::CollisionRequest& req = verbose ? collision_request_simple_verbose_ :
+                                                               collision_request_simple_;
+  if (lazy_collision_checking_ && !verbose)
+  {
+    state.updateLinkTransforms();
+    if (isClearOfWorld(state))
+    {
+      MOVEIT_PROBE_COUNT("StateValidityChecker::world check skipped", 1);
+      planning_context_->getPlanningScene()->checkSelfCollision(req, res, state);
+      return res.collision == false;
+    }
+  }
+  planning_context_->getPlanningScene()->checkCollision(req, res, state);
+  return res.collision == false;
+}
+
 bool ompl_interface::StateValidityChecker::isValid(const ompl::base::State* state, bool verbose) const
 {
-  //  moveit::Profiler::ScopedBlock sblock("isValid");
-  return planning_context_->useStateValidityCache() ? isValidWithCache(state, verbose) :
-                                                      isValidWithoutCache(state, verbose);
+  MOVEIT_PROBE_SCOPE("StateValidityChecker::isValid");
+  const bool cached = validity_cache_ && !verbose;
+  const double* values = state->as<ModelBasedStateSpace::StateType>()->values;
+  StateValidityCache::Result result;
+  if (cached && validity_cache_->lookup(values, result) && result.validity_known)
+  {
+    MOVEIT_PROBE_COUNT("StateValidityChecker::cache hit", 1);
+    return result.valid;
+  }
+
+  bool valid = planning_context_->useStateValidityCache() ? isValidWithCache(state, verbose) :
+                                                            isValidWithoutCache(state, verbose);
+  if (cached)
+  {
+    result.validity_known = true;
+    result.valid = valid;
+    validity_cache_->store(values, result);
+  }
+  return valid;
 }
 
 bool ompl_interface::StateValidityChecker::isValid(const ompl::base::State* state, double& dist, bool verbose) const
 {
-  //  moveit::Profiler::ScopedBlock sblock("isValid");
-  return planning_context_->useStateValidityCache() ? isValidWithCache(state, dist, verbose) :
-                                                      isValidWithoutCache(state, dist, verbose);
+  MOVEIT_PROBE_SCOPE("StateValidityChecker::isValid (distance)");
+  const bool cached = validity_cache_ && !verbose;
+  const double* values = state->as<ModelBasedStateSpace::StateType>()->values;
+  StateValidityCache::Result result;
+  if (cached && validity_cache_->lookup(values, result) && result.validity_known && result.distance_known)
+  {
+    MOVEIT_PROBE_COUNT("StateValidityChecker::cache hit", 1);
+    dist = result.distance;
+    return result.valid;
+  }
+
+  bool valid = planning_context_->useStateValidityCache() ? isValidWithCache(state, dist, verbose) :
+                                                            isValidWithoutCache(state, dist, verbose);
+  if (cached)
+  {
+    result = StateValidityCache::Result();
+    result.validity_known = true;
+    result.valid = valid;
+    result.distance_known = true;
+    result.distance = dist;
+    validity_cache_->store(values, result);
+  }
+  return valid;
 }
 
 double ompl_interface::StateValidityChecker::cost(const ompl::base::State* state) const
@@ -102,12 +267,34 @@ double ompl_interface::StateValidityChecker::cost(const ompl::base::State* state
 
 double ompl_interface::StateValidityChecker::clearance(const ompl::base::State* state) const
 {
+  const double* values = state->as<ModelBasedStateSpace::StateType>()->values;
+  StateValidityCache::Result result;
+  if (validity_cache_ && validity_cache_->lookup(values, result) && result.clearance_known)
+    return result.clearance;
+
   robot_state::RobotState* kstate = tss_.getStateStorage();
   planning_context_->getOMPLStateSpace()->copyToRobotState(*kstate, state);
 
-  collision_detection::CollisionResult res;
-  planning_context_->getPlanningScene()->checkCollision(collision_request_with_distance_, res, *kstate);
-  return res.collision ? 0.0 : (res.distance < 0.0 ? std::numeric_limits<double>::infinity() : res.distance);
+  double clearance;
+  if (clearance_field_)
+  {
+    kstate->updateLinkTransforms();
+    clearance = clearance_field_->getClearance(*kstate);
+  }
+  else
+  {
+    collision_detection::CollisionResult res;
+    planning_context_->getPlanningScene()->checkCollision(collision_request_with_distance_, res, *kstate);
+    clearance = res.collision ? 0.0 : (res.distance < 0.0 ? std::numeric_limits<double>::infinity() : res.distance);
+  }
+  if (validity_cache_)
+  {
+    result = StateValidityCache::Result();
+    result.clearance_known = true;
+    result.clearance = clearance;
+    validity_cache_->store(values, result);
+  }
+  return clearance;
 }
 
 bool ompl_interface::StateValidityChecker::isValidWithoutCache(const ompl::base::State* state, bool verbose) const
@@ -126,7 +313,7 @@ bool ompl_interface::StateValidityChecker::isValidWithoutCache(const ompl::base:
 
   // check path constraints
   const kinematic_constraints::KinematicConstraintSetPtr& kset = planning_context_->getPathConstraints();
-  if (kset && !kset->decide(*kstate, verbose).satisfied)
+  if (kset && !kset->isSatisfied(*kstate, verbose))
     return false;
 
   // check feasibility
@@ -134,10 +321,7 @@ bool ompl_interface::StateValidityChecker::isValidWithoutCache(const ompl::base:
     return false;
 
   // check collision avoidance
-  collision_detection::CollisionResult res;
-  planning_context_->getPlanningScene()->checkCollision(
-      verbose ? collision_request_simple_verbose_ : collision_request_simple_, res, *kstate);
-  return res.collision == false;
+  return isCollisionFree(*kstate, verbose);
 }
 
 bool ompl_interface::StateValidityChecker::isValidWithoutCache(const ompl::base::State* state, double& dist,
@@ -198,7 +382,7 @@ bool ompl_interface::StateValidityChecker::isValidWithCache(const ompl::base::St
 
   // check path constraints
   const kinematic_constraints::KinematicConstraintSetPtr& kset = planning_context_->getPathConstraints();
-  if (kset && !kset->decide(*kstate, verbose).satisfied)
+  if (kset && !kset->isSatisfied(*kstate, verbose))
   {
     const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->markInvalid();
     return false;
@@ -212,10 +396,7 @@ bool ompl_interface::StateValidityChecker::isValidWithCache(const ompl::base::St
   }
 
   // check collision avoidance
-  collision_detection::CollisionResult res;
-  planning_context_->getPlanningScene()->checkCollision(
-      verbose ? collision_request_simple_verbose_ : collision_request_simple_, res, *kstate);
-  if (res.collision == false)
+  if (isCollisionFree(*kstate, verbose))
   {
     const_cast<ob::State*>(state)->as<ModelBasedStateSpace::StateType>()->markValid();
     return true;
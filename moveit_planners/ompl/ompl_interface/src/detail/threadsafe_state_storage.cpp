@@ -54,16 +54,18 @@ ompl_interface::TSStateStorage::~TSStateStorage()
 
 robot_state::RobotState* ompl_interface::TSStateStorage::getStateStorage() const
 {
-  robot_state::RobotState* st = NULL;
-  boost::mutex::scoped_lock slock(lock_);  /// \todo use Thread Local Storage?
-  std::map<boost::thread::id, robot_state::RobotState*>::const_iterator it =
-      thread_states_.find(boost::this_thread::get_id());
-  if (it == thread_states_.end())
+  const boost::thread::id id = boost::this_thread::get_id();
+
+  // every thread creates its state once and then only looks it up, so lookups only need to share the lock
   {
-    st = new robot_state::RobotState(start_state_);
-    thread_states_[boost::this_thread::get_id()] = st;
+    boost::shared_lock<boost::shared_mutex> slock(lock_);
+    std::map<boost::thread::id, robot_state::RobotState*>::const_iterator it = thread_states_.find(id);
+    if (it != thread_states_.end())
+      return it->second;
   }
-  else
-    st = it->second;
+
+  robot_state::RobotState* st = new robot_state::RobotState(start_state_);
+  boost::unique_lock<boost::shared_mutex> ulock(lock_);
+  thread_states_[id] = st;
   return st;
 }
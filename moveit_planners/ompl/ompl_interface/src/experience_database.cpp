@@ -0,0 +1,299 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/ompl_interface/experience_database.h>
+#include <ompl/datastructures/NearestNeighborsGNAT.h>
+#include <ros/console.h>
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <cmath>
+#include <memory>
+
+namespace ompl_interface
+{
+struct ExperienceDatabase::Experience
+{
+  /** \brief The waypoints of the stored path, as returned by StateSpace::copyToReals() */
+  std::vector<std::vector<double> > states;
+};
+
+struct ExperienceDatabase::ExperienceSet
+{
+  ExperienceSet() : nn(new ompl::NearestNeighborsGNAT<ExperiencePtr>())
+  {
+    nn->setDistanceFunction(&startDistance);
+  }
+
+  static double distance(const std::vector<double>& a, const std::vector<double>& b)
+  {
+    if (a.size() != b.size())
+      return std::numeric_limits<double>::infinity();
+    double d = 0.0;
+    for (std::size_t i = 0; i < a.size(); ++i)
+      d += (a[i] - b[i]) * (a[i] - b[i]);
+    return sqrt(d);
+  }
+
+  static double startDistance(const ExperiencePtr& a, const ExperiencePtr& b)
+  {
+    return distance(a->states.front(), b->states.front());
+  }
+
+  std::shared_ptr<ompl::NearestNeighbors<ExperiencePtr> > nn;
+  /** \brief Experiences in the order they were added, so the oldest can be dropped when the set is full */
+  std::deque<ExperiencePtr> order;
+};
+}
+
+ompl_interface::ExperienceDatabase::ExperienceDatabase(std::size_t max_experiences_per_key)
+  : max_experiences_per_key_(max_experiences_per_key), duplicate_distance_(1e-3)
+{
+}
+
+ompl_interface::ExperienceDatabase::~ExperienceDatabase()
+{
+}
+
+ompl_interface::ExperienceDatabase::ExperienceSet&
+ompl_interface::ExperienceDatabase::getExperienceSet(const std::string& key)
+{
+  ExperienceSetPtr& set = experiences_[key];
+  if (!set)
+    set.reset(new ExperienceSet());
+  return *set;
+}
+
+void ompl_interface::ExperienceDatabase::addExperience(ExperienceSet& set, const ExperiencePtr& experience)
+{
+  if (set.nn->size() > 0)
+  {
+    // replace an experience that solves (nearly) the same problem instead of storing both
+    ExperiencePtr nearest = set.nn->nearest(experience);
+    if (ExperienceSet::startDistance(nearest, experience) < duplicate_distance_ &&
+        ExperienceSet::distance(nearest->states.back(), experience->states.back()) < duplicate_distance_)
+    {
+      set.nn->remove(nearest);
+      set.order.erase(std::find(set.order.begin(), set.order.end(), nearest));
+    }
+  }
+  while (max_experiences_per_key_ > 0 && set.order.size() >= max_experiences_per_key_)
+  {
+    set.nn->remove(set.order.front());
+    set.order.pop_front();
+  }
+  set.nn->add(experience);
+  set.order.push_back(experience);
+}
+
+void ompl_interface::ExperienceDatabase::addExperience(const std::string& key,
+                                                       const ompl::geometric::PathGeometric& path)
+{
+  if (path.getStateCount() < 2)
+    return;
+  ExperiencePtr experience(new Experience());
+  experience->states.resize(path.getStateCount());
+  const ompl::base::StateSpacePtr& space = path.getSpaceInformation()->getStateSpace();
+  for (std::size_t i = 0; i < path.getStateCount(); ++i)
+    space->copyToReals(experience->states[i], path.getState(i));
+
+  boost::mutex::scoped_lock slock(lock_);
+  addExperience(getExperienceSet(key), experience);
+}
+
+bool ompl_interface::ExperienceDatabase::repairPath(const ompl::base::SpaceInformationPtr& si,
+                                                    std::vector<ompl::base::State*>& states) const
+{
+  // states[0] is the start of the new problem, which the caller has already validated
+  std::vector<ompl::base::State*> kept(1, states[0]);
+  std::size_t i = 0;
+  while (i + 1 < states.size())
+  {
+    std::size_t next = i + 1;
+    if (!si->checkMotion(states[i], states[next]))
+    {
+      // the scene changed along this segment; try to shortcut to the furthest waypoint that can still be reached
+      next = 0;
+      for (std::size_t j = states.size() - 1; j > i + 1; --j)
+        if (si->checkMotion(states[i], states[j]))
+        {
+          next = j;
+          break;
+        }
+      if (next == 0)
+        return false;
+    }
+    kept.push_back(states[next]);
+    i = next;
+  }
+  // the skipped waypoints are freed by the caller, which owns all states in the original vector
+  states.swap(kept);
+  return true;
+}
+
+bool ompl_interface::ExperienceDatabase::recallExperience(const std::string& key,
+                                                          const ompl::base::ProblemDefinitionPtr& pdef,
+                                                          const GoalTestFn& goal_test,
+                                                          ompl::geometric::PathGeometric& path,
+                                                          unsigned int candidates) const
+{
+  const ompl::base::SpaceInformationPtr& si = pdef->getSpaceInformation();
+  const ompl::base::GoalPtr& goal = pdef->getGoal();
+  if (!goal || pdef->getStartStateCount() == 0 || candidates == 0)
+    return false;
+  const ompl::base::State* start = pdef->getStartState(0);
+
+  ExperiencePtr query(new Experience());
+  query->states.resize(1);
+  si->getStateSpace()->copyToReals(query->states[0], start);
+
+  std::vector<ExperiencePtr> nearest;
+  {
+    boost::mutex::scoped_lock slock(lock_);
+    std::map<std::string, ExperienceSetPtr>::const_iterator it = experiences_.find(key);
+    if (it == experiences_.end() || it->second->nn->size() == 0)
+      return false;
+    it->second->nn->nearestK(query, candidates, nearest);
+  }
+
+  for (std::size_t k = 0; k < nearest.size(); ++k)
+  {
+    const Experience& experience = *nearest[k];
+    if (experience.states.front().size() != query->states[0].size())
+      continue;
+
+    std::vector<ompl::base::State*> states(1, si->cloneState(start));
+    for (std::size_t i = 0; i < experience.states.size(); ++i)
+    {
+      states.push_back(si->allocState());
+      si->getStateSpace()->copyFromReals(states.back(), experience.states[i]);
+    }
+    std::vector<ompl::base::State*> all_states = states;
+
+    bool reaches_goal = goal_test ? goal_test(states.back()) : goal->isSatisfied(states.back());
+    bool solved = reaches_goal && repairPath(si, states);
+    if (solved)
+    {
+      path = ompl::geometric::PathGeometric(si);
+      for (std::size_t i = 0; i < states.size(); ++i)
+        path.append(states[i]);
+      ROS_DEBUG_NAMED("experience_database", "Recalled a stored path with %u waypoints (%u after repair)",
+                      (unsigned int)all_states.size(), (unsigned int)states.size());
+    }
+    for (std::size_t i = 0; i < all_states.size(); ++i)
+      si->freeState(all_states[i]);
+    if (solved)
+      return true;
+  }
+  return false;
+}
+
+std::size_t ompl_interface::ExperienceDatabase::size() const
+{
+  boost::mutex::scoped_lock slock(lock_);
+  std::size_t count = 0;
+  for (std::map<std::string, ExperienceSetPtr>::const_iterator it = experiences_.begin(); it != experiences_.end();
+       ++it)
+    count += it->second->order.size();
+  return count;
+}
+
+void ompl_interface::ExperienceDatabase::clear()
+{
+  boost::mutex::scoped_lock slock(lock_);
+  experiences_.clear();
+}
+
+bool ompl_interface::ExperienceDatabase::load(const std::string& filename)
+{
+  std::ifstream fin(filename.c_str());
+  if (!fin.good())
+  {
+    ROS_WARN_NAMED("experience_database", "Unable to open experience database '%s'", filename.c_str());
+    return false;
+  }
+
+  boost::mutex::scoped_lock slock(lock_);
+  std::size_t count = 0;
+  std::string key;
+  while (std::getline(fin, key))
+  {
+    if (key.empty())
+      continue;
+    std::size_t state_count = 0, dimension = 0;
+    fin >> state_count >> dimension;
+    if (!fin.good() || state_count < 2)
+      break;
+    ExperiencePtr experience(new Experience());
+    experience->states.resize(state_count, std::vector<double>(dimension));
+    for (std::size_t i = 0; i < state_count; ++i)
+      for (std::size_t j = 0; j < dimension; ++j)
+        fin >> experience->states[i][j];
+    if (fin.fail())
+      break;
+    addExperience(getExperienceSet(key), experience);
+    ++count;
+  }
+  ROS_INFO_NAMED("experience_database", "Loaded %u experiences from '%s'", (unsigned int)count, filename.c_str());
+  return true;
+}
+
+bool ompl_interface::ExperienceDatabase::save(const std::string& filename) const
+{
+  std::ofstream fout(filename.c_str());
+  if (!fout.good())
+  {
+    ROS_ERROR_NAMED("experience_database", "Unable to save experience database to '%s'", filename.c_str());
+    return false;
+  }
+  fout.precision(std::numeric_limits<double>::digits10 + 2);
+
+  boost::mutex::scoped_lock slock(lock_);
+  for (std::map<std::string, ExperienceSetPtr>::const_iterator it = experiences_.begin(); it != experiences_.end();
+       ++it)
+    for (std::size_t e = 0; e < it->second->order.size(); ++e)
+    {
+      const Experience& experience = *it->second->order[e];
+      fout << it->first << std::endl;
+      fout << experience.states.size() << " " << experience.states.front().size() << std::endl;
+      for (std::size_t i = 0; i < experience.states.size(); ++i)
+      {
+        for (std::size_t j = 0; j < experience.states[i].size(); ++j)
+          fout << experience.states[i][j] << " ";
+        fout << std::endl;
+      }
+    }
+  return fout.good();
+}
@@ -0,0 +1,108 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/ompl_interface/goal_sample_cache.h>
+#include <algorithm>
+
+namespace ompl_interface
+{
+GoalSampleCache::GoalSampleCache(std::size_t max_entries, std::size_t max_samples_per_entry)
+  : max_entries_(max_entries), max_samples_per_entry_(max_samples_per_entry), clock_(0)
+{
+}
+
+GoalSampleCache::Entry& GoalSampleCache::useEntry(const std::string& key)
+{
+  Entry& entry = entries_[key];
+  entry.last_used = ++clock_;
+  return entry;
+}
+
+void GoalSampleCache::getSamples(const std::string& key, std::vector<std::vector<double> >& samples)
+{
+  samples.clear();
+  boost::mutex::scoped_lock slock(lock_);
+  std::map<std::string, Entry>::iterator it = entries_.find(key);
+  if (it == entries_.end())
+    return;
+  it->second.last_used = ++clock_;
+  samples = it->second.samples;
+}
+
+void GoalSampleCache::addSample(const std::string& key, const std::vector<double>& values)
+{
+  if (max_entries_ == 0 || max_samples_per_entry_ == 0)
+    return;
+  boost::mutex::scoped_lock slock(lock_);
+  Entry& entry = useEntry(key);
+  if (std::find(entry.samples.begin(), entry.samples.end(), values) != entry.samples.end())
+    return;
+  if (entry.samples.size() >= max_samples_per_entry_)
+    entry.samples.erase(entry.samples.begin());
+  entry.samples.push_back(values);
+
+  if (entries_.size() > max_entries_)
+  {
+    std::map<std::string, Entry>::iterator oldest = entries_.begin();
+    for (std::map<std::string, Entry>::iterator it = entries_.begin(); it != entries_.end(); ++it)
+      if (it->second.last_used < oldest->second.last_used)
+        oldest = it;
+    entries_.erase(oldest);
+  }
+}
+
+void GoalSampleCache::removeSample(const std::string& key, const std::vector<double>& values)
+{
+  boost::mutex::scoped_lock slock(lock_);
+  std::map<std::string, Entry>::iterator it = entries_.find(key);
+  if (it == entries_.end())
+    return;
+  std::vector<std::vector<double> >& samples = it->second.samples;
+  samples.erase(std::remove(samples.begin(), samples.end(), values), samples.end());
+  if (samples.empty())
+    entries_.erase(it);
+}
+
+std::size_t GoalSampleCache::size() const
+{
+  boost::mutex::scoped_lock slock(lock_);
+  return entries_.size();
+}
+
+void GoalSampleCache::clear()
+{
+  boost::mutex::scoped_lock slock(lock_);
+  entries_.clear();
+}
+}
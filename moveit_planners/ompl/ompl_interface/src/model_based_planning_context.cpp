@@ -35,23 +35,34 @@
 /* Author: Ioan Sucan */
 
 #include <boost/algorithm/string/trim.hpp>
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 #include <moveit/ompl_interface/model_based_planning_context.h>
 #include <moveit/ompl_interface/detail/state_validity_checker.h>
+#include <moveit/ompl_interface/detail/continuous_motion_validator.h>
+#include <moveit/ompl_interface/detail/bisection_motion_validator.h>
 #include <moveit/ompl_interface/detail/constrained_sampler.h>
 #include <moveit/ompl_interface/detail/constrained_goal_sampler.h>
 #include <moveit/ompl_interface/detail/goal_union.h>
 #include <moveit/ompl_interface/detail/projection_evaluators.h>
+#include <moveit/ompl_interface/detail/manipulability_objective.h>
 #include <moveit/ompl_interface/constraints_library.h>
 #include <moveit/kinematic_constraints/utils.h>
 #include <moveit/profiler/profiler.h>
+#include <moveit/profiler/probes.h>
 #include <eigen_conversions/eigen_msg.h>
 
 #include <ompl/base/samplers/UniformValidStateSampler.h>
+#include <ompl/geometric/PathSimplifier.h>
 #include <ompl/base/goals/GoalLazySamples.h>
 #include <ompl/tools/config/SelfConfig.h>
 #include <ompl/base/spaces/SE3StateSpace.h>
 #include <ompl/datastructures/PDF.h>
+#include <ompl/geometric/planners/prm/PRM.h>
+#include <ompl/geometric/planners/prm/LazyPRM.h>
 
 #include "ompl/base/objectives/PathLengthOptimizationObjective.h"
 #include "ompl/base/objectives/MechanicalWorkOptimizationObjective.h"
@@ -78,6 +89,13 @@ ompl_interface::ModelBasedPlanningContext::ModelBasedPlanningContext(const std::
   , minimum_waypoint_count_(0)
   , use_state_validity_cache_(true)
   , simplify_solutions_(true)
+  , simplification_threads_(1)
+  , goal_sampling_threads_(1)
+  , adaptive_attempts_agreement_(0)
+  , adaptive_attempts_tolerance_(0.05)
+  , adaptive_attempts_min_improvement_rate_(0.0)
+  , solved_from_experience_(false)
+  , multi_query_planning_enabled_(false)
 {
   complete_initial_robot_state_.update();
   ompl_simple_setup_->getStateSpace()->computeSignature(space_signature_);
@@ -146,6 +164,26 @@ ompl_interface::ModelBasedPlanningContext::getProjectionEvaluator(const std::str
     else
       return ob::ProjectionEvaluatorPtr(new ProjectionEvaluatorJointValue(this, j));
   }
+  else if (peval == "pca" || (peval.find("pca(") == 0 && peval[peval.length() - 1] == ')'))
+  {
+    // projection onto the principal components of valid states, two dimensional by default
+    int dimension = 2;
+    if (peval != "pca")
+    {
+      try
+      {
+        dimension = boost::lexical_cast<int>(boost::trim_copy(peval.substr(4, peval.length() - 5)));
+      }
+      catch (boost::bad_lexical_cast&)
+      {
+        dimension = 0;
+      }
+    }
+    if (dimension > 0)
+      return ob::ProjectionEvaluatorPtr(new ProjectionEvaluatorPCA(this, dimension));
+    ROS_ERROR_NAMED("model_based_planning_context", "%s: Invalid dimension in projection evaluator '%s'",
+                    name_.c_str(), peval.c_str());
+  }
   else
     ROS_ERROR_NAMED("model_based_planning_context",
                     "Unable to allocate projection evaluator based on description: '%s'", peval.c_str());
@@ -195,9 +233,26 @@ ompl_interface::ModelBasedPlanningContext::allocPathConstrainedSampler(const omp
 
     if (cs)
     {
+      // share the constrained states found so far with other samplers and requests for the same constraints; the
+      // pool is filled in the background with a sampler of its own
+      ConstrainedStatePool::EntryPtr pool_entry;
+      if (spec_.constrained_state_pool_)
+      {
+        const std::string key = ConstrainedStatePool::getKey(getGroupName(), path_constraints_msg_);
+        pool_entry = spec_.constrained_state_pool_->getEntry(key);
+        if (!pool_entry)
+        {
+          constraint_samplers::ConstraintSamplerPtr pool_cs = spec_.constraint_sampler_manager_->selectSampler(
+              getPlanningScene(), getGroupName(), path_constraints_->getAllConstraints());
+          if (pool_cs)
+            pool_entry = spec_.constrained_state_pool_->requestEntry(key, pool_cs, path_constraints_,
+                                                                     getCompleteInitialRobotState());
+        }
+      }
+
       ROS_INFO_NAMED("model_based_planning_context", "%s: Allocating specialized state sampler for state space",
                      name_.c_str());
-      return ob::StateSamplerPtr(new ConstrainedSampler(this, cs));
+      return ob::StateSamplerPtr(new ConstrainedSampler(this, cs, pool_entry));
     }
   }
   ROS_DEBUG_NAMED("model_based_planning_context", "%s: Allocating default state sampler for state space",
@@ -259,6 +314,186 @@ void ompl_interface::ModelBasedPlanningContext::useConfig()
     cfg["longest_valid_segment_fraction"] = boost::lexical_cast<std::string>(longest_valid_segment_fraction_final);
   }
 
+  // simplify solutions with several threads, if requested
+  it = cfg.find("simplification_threads");
+  if (it != cfg.end())
+  {
+    simplification_threads_ = std::max(1u, boost::lexical_cast<unsigned int>(boost::trim_copy(it->second)));
+    cfg.erase(it);
+  }
+
+  // sample goals with several threads, if requested
+  it = cfg.find("goal_sampling_threads");
+  if (it != cfg.end())
+  {
+    goal_sampling_threads_ = boost::lexical_cast<unsigned int>(boost::trim_copy(it->second));
+    cfg.erase(it);
+  }
+
+  // keep the roadmap of PRM-type planners across requests in the same scene, if requested
+  it = cfg.find("multi_query_planning_enabled");
+  if (it != cfg.end())
+  {
+    std::string value = boost::trim_copy(it->second);
+    multi_query_planning_enabled_ = value == "true" || value == "1";
+    cfg.erase(it);
+  }
+  else
+    multi_query_planning_enabled_ = false;
+  if (!multi_query_planning_enabled_)
+    roadmap_scene_.reset();
+
+  // plan against another of the scene's collision detectors, if requested; the scene itself keeps its active one
+  it = cfg.find("collision_detector");
+  if (it != cfg.end())
+  {
+    std::string detector = boost::trim_copy(it->second);
+    if (planning_scene_ && !detector.empty() && detector != planning_scene_->getActiveCollisionDetectorName())
+    {
+      std::vector<std::string> available;
+      planning_scene_->getCollisionDetectorNames(available);
+      if (std::find(available.begin(), available.end(), detector) != available.end())
+      {
+        planning_scene::PlanningScenePtr scene = planning_scene_->diff();
+        scene->setActiveCollisionDetector(detector);
+        planning_scene_ = scene;
+        ROS_DEBUG_NAMED("model_based_planning_context", "%s: Planning with collision detector '%s'", name_.c_str(),
+                        detector.c_str());
+      }
+      else
+        ROS_WARN_NAMED("model_based_planning_context",
+                       "%s: Collision detector '%s' is not available; planning with '%s' instead", name_.c_str(),
+                       detector.c_str(), planning_scene_->getActiveCollisionDetectorName().c_str());
+    }
+    cfg.erase(it);
+  }
+
+  // end parallel attempts once their solutions converge, if requested
+  it = cfg.find("adaptive_attempts_agreement");
+  if (it != cfg.end())
+  {
+    adaptive_attempts_agreement_ = boost::lexical_cast<unsigned int>(boost::trim_copy(it->second));
+    cfg.erase(it);
+  }
+  it = cfg.find("adaptive_attempts_tolerance");
+  if (it != cfg.end())
+  {
+    adaptive_attempts_tolerance_ = boost::lexical_cast<double>(boost::trim_copy(it->second));
+    cfg.erase(it);
+  }
+  it = cfg.find("adaptive_attempts_min_improvement_rate");
+  if (it != cfg.end())
+  {
+    adaptive_attempts_min_improvement_rate_ = boost::lexical_cast<double>(boost::trim_copy(it->second));
+    cfg.erase(it);
+  }
+
+  // check the states along motions in bisection order, if requested; continuous collision checking takes precedence
+  it = cfg.find("bisection_motion_checking");
+  if (it != cfg.end())
+  {
+    std::string value = boost::trim_copy(it->second);
+    if (value == "true" || value == "1")
+    {
+      ompl_simple_setup_->getSpaceInformation()->setMotionValidator(
+          ob::MotionValidatorPtr(new BisectionMotionValidator(this)));
+      ROS_DEBUG_NAMED("model_based_planning_context", "%s: Checking motions in bisection order", name_.c_str());
+    }
+    cfg.erase(it);
+  }
+
+  // use continuous collision checking for motions, if requested
+  it = cfg.find("continuous_collision_checking");
+  if (it != cfg.end())
+  {
+    std::string value = boost::trim_copy(it->second);
+    if (value == "true" || value == "1")
+    {
+      ompl_simple_setup_->getSpaceInformation()->setMotionValidator(
+          ob::MotionValidatorPtr(new ContinuousMotionValidator(this)));
+      ROS_DEBUG_NAMED("model_based_planning_context", "%s: Using continuous collision checking for motions",
+                      name_.c_str());
+    }
+    cfg.erase(it);
+  }
+
+  // screen states with bounding spheres before the exact world collision check, if requested
+  it = cfg.find("lazy_collision_checking");
+  if (it != cfg.end())
+  {
+    std::string value = boost::trim_copy(it->second);
+    if ((value == "true" || value == "1") && ompl_simple_setup_->getStateValidityChecker())
+    {
+      static_cast<StateValidityChecker*>(ompl_simple_setup_->getStateValidityChecker().get())
+          ->setLazyCollisionChecking(true);
+      ROS_DEBUG_NAMED("model_based_planning_context", "%s: Using lazy collision checking for states", name_.c_str());
+    }
+    cfg.erase(it);
+  }
+
+  // remember validity results of recently checked states, if requested
+  it = cfg.find("validity_cache_size");
+  if (it != cfg.end())
+  {
+    std::size_t size = boost::lexical_cast<std::size_t>(boost::trim_copy(it->second));
+    double resolution = 1e-6;
+    std::map<std::string, std::string>::iterator rit = cfg.find("validity_cache_resolution");
+    if (rit != cfg.end())
+      resolution = boost::lexical_cast<double>(boost::trim_copy(rit->second));
+    if (ompl_simple_setup_->getStateValidityChecker())
+      static_cast<StateValidityChecker*>(ompl_simple_setup_->getStateValidityChecker().get())
+          ->setValidityCache(size, resolution);
+    cfg.erase(it);
+  }
+  cfg.erase("validity_cache_resolution");
+
+  // answer clearance queries from a distance field of the world, if requested
+  it = cfg.find("clearance_distance_field");
+  if (it != cfg.end())
+  {
+    std::string value = boost::trim_copy(it->second);
+    if ((value == "true" || value == "1") && ompl_simple_setup_->getStateValidityChecker())
+    {
+      double resolution = 0.02;
+      double max_distance = 0.4;
+      std::map<std::string, std::string>::iterator rit = cfg.find("clearance_distance_field_resolution");
+      if (rit != cfg.end())
+        resolution = boost::lexical_cast<double>(boost::trim_copy(rit->second));
+      rit = cfg.find("clearance_distance_field_max_distance");
+      if (rit != cfg.end())
+        max_distance = boost::lexical_cast<double>(boost::trim_copy(rit->second));
+      if (!clearance_field_ || clearance_field_->getResolution() != resolution ||
+          clearance_field_->getMaxDistance() != max_distance)
+        clearance_field_.reset(new ClearanceField(resolution, max_distance));
+
+      // the field covers the workspace of the request, or a box around the robot base if there is none
+      const moveit_msgs::WorkspaceParameters& wparams = request_.workspace_parameters;
+      Eigen::Vector3d min(wparams.min_corner.x, wparams.min_corner.y, wparams.min_corner.z);
+      Eigen::Vector3d max(wparams.max_corner.x, wparams.max_corner.y, wparams.max_corner.z);
+      if ((max - min).minCoeff() <= 0.0)
+      {
+        min = Eigen::Vector3d::Constant(-1.5);
+        max = Eigen::Vector3d::Constant(1.5);
+      }
+      clearance_field_->update(*planning_scene_->getWorld(), min, max);
+      clearance_field_->setRobot(getCompleteInitialRobotState(), getJointModelGroup());
+      static_cast<StateValidityChecker*>(ompl_simple_setup_->getStateValidityChecker().get())
+          ->setClearanceField(clearance_field_);
+      ROS_DEBUG_NAMED("model_based_planning_context", "%s: Using a distance field for clearance queries",
+                      name_.c_str());
+    }
+    cfg.erase(it);
+  }
+  cfg.erase("clearance_distance_field_resolution");
+  cfg.erase("clearance_distance_field_max_distance");
+
+  // portfolio settings of the group are handled by the PlanningContextManager
+  cfg.erase("portfolio_planners");
+  cfg.erase("portfolio_keep_shortest");
+
+  // the nearest neighbors structure is chosen when the planner is allocated
+  cfg.erase("nearest_neighbors");
+
   // set the projection evaluator
   it = cfg.find("projection_evaluator");
   if (it != cfg.end())
@@ -305,6 +540,18 @@ void ompl_interface::ModelBasedPlanningContext::useConfig()
   {
     objective.reset(new ompl::base::MaximizeMinClearanceObjective(ompl_simple_setup_->getSpaceInformation()));
   }
+  else if (optimizer == "ManipulabilityObjective")
+  {
+    bool translation = false;
+    it = cfg.find("manipulability_translation");
+    if (it != cfg.end())
+    {
+      std::string value = boost::trim_copy(it->second);
+      translation = value == "true" || value == "1";
+      cfg.erase(it);
+    }
+    objective.reset(new ManipulabilityObjective(this, translation));
+  }
   else
   {
     objective.reset(new ompl::base::PathLengthOptimizationObjective(ompl_simple_setup_->getSpaceInformation()));
@@ -324,12 +571,17 @@ void ompl_interface::ModelBasedPlanningContext::useConfig()
   {
     std::string type = it->second;
     cfg.erase(it);
-    ompl_simple_setup_->setPlannerAllocator(
-        boost::bind(spec_.planner_selector_(type), _1, name_ != getGroupName() ? name_ : "", spec_));
-    ROS_INFO_NAMED("model_based_planning_context",
-                   "Planner configuration '%s' will use planner '%s'. "
-                   "Additional configuration parameters will be set when the planner is constructed.",
-                   name_.c_str(), type.c_str());
+    // keep the planner constructed for a previous request; preSolve() clears its data structures
+    if (type != planner_type_ || !ompl_simple_setup_->getPlanner())
+    {
+      ompl_simple_setup_->setPlannerAllocator(
+          boost::bind(spec_.planner_selector_(type), _1, name_ != getGroupName() ? name_ : "", spec_));
+      planner_type_ = type;
+      ROS_INFO_NAMED("model_based_planning_context",
+                     "Planner configuration '%s' will use planner '%s'. "
+                     "Additional configuration parameters will be set when the planner is constructed.",
+                     name_.c_str(), type.c_str());
+    }
   }
 
   // call the setParams() after setup(), so we know what the params are
@@ -339,6 +591,14 @@ void ompl_interface::ModelBasedPlanningContext::useConfig()
   ompl_simple_setup_->getSpaceInformation()->setup();
 }
 
+void ompl_interface::ModelBasedPlanningContext::preallocatePlanner()
+{
+  useConfig();
+  if (!ompl_simple_setup_->getPlanner() && ompl_simple_setup_->getPlannerAllocator())
+    ompl_simple_setup_->setPlanner(
+        ompl_simple_setup_->getPlannerAllocator()(ompl_simple_setup_->getSpaceInformation()));
+}
+
 void ompl_interface::ModelBasedPlanningContext::setPlanningVolume(const moveit_msgs::WorkspaceParameters& wparams)
 {
   if (wparams.min_corner.x == wparams.max_corner.x && wparams.min_corner.x == 0.0 &&
@@ -356,14 +616,87 @@ void ompl_interface::ModelBasedPlanningContext::setPlanningVolume(const moveit_m
                                         wparams.max_corner.y, wparams.min_corner.z, wparams.max_corner.z);
 }
 
+namespace
+{
+// paths at most this much longer than the straight line between their ends are not simplified
+const double SHORT_PATH_TOLERANCE = 1e-3;
+
+// parallel simplification stops once a round shortens the path by less than this fraction
+const double SIMPLIFICATION_IMPROVEMENT_TOLERANCE = 1e-3;
+}
+
 void ompl_interface::ModelBasedPlanningContext::simplifySolution(double timeout)
 {
-  ompl_simple_setup_->simplifySolution(timeout);
-  last_simplify_time_ = ompl_simple_setup_->getLastSimplificationTime();
+  MOVEIT_PROBE_SPAN("ModelBasedPlanningContext::simplifySolution");
+  if (!ompl_simple_setup_->haveSolutionPath())
+  {
+    ompl_simple_setup_->simplifySolution(timeout);
+    last_simplify_time_ = ompl_simple_setup_->getLastSimplificationTime();
+    return;
+  }
+
+  ompl::time::point start = ompl::time::now();
+  og::PathGeometric& path = ompl_simple_setup_->getSolutionPath();
+  const ob::SpaceInformationPtr& si = ompl_simple_setup_->getSpaceInformation();
+  if (path.getStateCount() <= 2 ||
+      path.length() <= (1.0 + SHORT_PATH_TOLERANCE) * si->distance(path.getState(0),
+                                                                     path.getState(path.getStateCount() - 1)))
+  {
+    ROS_DEBUG_NAMED("model_based_planning_context", "%s: Solution is already short, not simplifying it",
+                    name_.c_str());
+    last_simplify_time_ = ompl::time::seconds(ompl::time::now() - start);
+    return;
+  }
+
+  if (simplification_threads_ <= 1)
+  {
+    ompl_simple_setup_->simplifySolution(timeout);
+    last_simplify_time_ = ompl_simple_setup_->getLastSimplificationTime();
+    return;
+  }
+
+  // the simplifiers draw their shortcuts from their own random number generators, so each one explores different
+  // shortcuts of the same path; validity checks are thread safe, as for parallel planning
+  ob::PlannerTerminationCondition ptc = ob::timedPlannerTerminationCondition(timeout);
+  std::vector<og::PathSimplifierPtr> simplifiers;
+  for (unsigned int i = 0; i < simplification_threads_; ++i)
+    simplifiers.push_back(og::PathSimplifierPtr(new og::PathSimplifier(si)));
+
+  // the checks of the helper threads count towards the request being traced, if any
+  moveit::tools::probes::RequestTrace* trace = moveit::tools::probes::getCurrentRequestTrace();
+  unsigned int rounds = 0;
+  while (!ptc)
+  {
+    std::vector<og::PathGeometric> candidates(simplification_threads_, path);
+    boost::thread_group threads;
+    for (unsigned int i = 1; i < simplification_threads_; ++i)
+      threads.create_thread([&simplifiers, &candidates, &ptc, i, trace]() {
+        moveit::tools::probes::ScopedRequestTrace trace_scope(trace);
+        simplifiers[i]->simplify(candidates[i], ptc);
+      });
+    simplifiers[0]->simplify(candidates[0], ptc);
+    threads.join_all();
+    ++rounds;
+
+    std::size_t best = 0;
+    for (std::size_t i = 1; i < candidates.size(); ++i)
+      if (candidates[i].length() < candidates[best].length())
+        best = i;
+    const double previous_length = path.length();
+    if (candidates[best].length() < previous_length)
+      path = candidates[best];
+    if (previous_length - path.length() <= SIMPLIFICATION_IMPROVEMENT_TOLERANCE * previous_length)
+      break;
+  }
+
+  last_simplify_time_ = ompl::time::seconds(ompl::time::now() - start);
+  ROS_DEBUG_NAMED("model_based_planning_context", "%s: Simplified the solution with %u threads in %u round(s), %lf s",
+                  name_.c_str(), simplification_threads_, rounds, last_simplify_time_);
 }
 
 void ompl_interface::ModelBasedPlanningContext::interpolateSolution()
 {
+  MOVEIT_PROBE_SPAN("ModelBasedPlanningContext::interpolateSolution");
   if (ompl_simple_setup_->haveSolutionPath())
   {
     og::PathGeometric& pg = ompl_simple_setup_->getSolutionPath();
@@ -429,7 +762,7 @@ ompl::base::GoalPtr ompl_interface::ModelBasedPlanningContext::constructGoal()
                                                             goal_constraints_[i]->getAllConstraints());
     if (cs)
     {
-      ob::GoalPtr g = ob::GoalPtr(new ConstrainedGoalSampler(this, goal_constraints_[i], cs));
+      ob::GoalPtr g = ob::GoalPtr(new ConstrainedGoalSampler(this, goal_constraints_[i], cs, goal_constraint_keys_[i]));
       goals.push_back(g);
     }
   }
@@ -451,12 +784,17 @@ void ompl_interface::ModelBasedPlanningContext::setCompleteInitialState(
 
 void ompl_interface::ModelBasedPlanningContext::clear()
 {
-  ompl_simple_setup_->clear();
+  // a roadmap kept for multi-query planning is only discarded in preSolve(), once the new scene is known
+  if (multi_query_planning_enabled_)
+    ompl_simple_setup_->getProblemDefinition()->clearSolutionPaths();
+  else
+    ompl_simple_setup_->clear();
   ompl_simple_setup_->clearStartStates();
   ompl_simple_setup_->setGoal(ob::GoalPtr());
   ompl_simple_setup_->setStateValidityChecker(ob::StateValidityCheckerPtr());
   path_constraints_.reset();
   goal_constraints_.clear();
+  goal_constraint_keys_.clear();
   getOMPLStateSpace()->setInterpolationFunction(InterpolationFunction());
 }
 
@@ -477,6 +815,7 @@ bool ompl_interface::ModelBasedPlanningContext::setGoalConstraints(
 {
   // ******************* check if the input is correct
   goal_constraints_.clear();
+  goal_constraint_keys_.clear();
   for (std::size_t i = 0; i < goal_constraints.size(); ++i)
   {
     moveit_msgs::Constraints constr = kinematic_constraints::mergeConstraints(goal_constraints[i], path_constraints);
@@ -484,7 +823,10 @@ bool ompl_interface::ModelBasedPlanningContext::setGoalConstraints(
         new kinematic_constraints::KinematicConstraintSet(getRobotModel()));
     kset->add(constr, getPlanningScene()->getTransforms());
     if (!kset->empty())
+    {
       goal_constraints_.push_back(kset);
+      goal_constraint_keys_.push_back(ConstrainedStatePool::getKey(getGroupName(), constr));
+    }
   }
 
   if (goal_constraints_.empty())
@@ -547,12 +889,116 @@ void ompl_interface::ModelBasedPlanningContext::preSolve()
   // clear previously computed solutions
   ompl_simple_setup_->getProblemDefinition()->clearSolutionPaths();
   const ob::PlannerPtr planner = ompl_simple_setup_->getPlanner();
-  if (planner)
+  if (planner && !reuseRoadmap(planner.get()))
     planner->clear();
+  best_intermediate_cost_ = ob::Cost(std::numeric_limits<double>::quiet_NaN());
+  if (intermediate_solution_callback_)
+    ompl_simple_setup_->getProblemDefinition()->setIntermediateSolutionCallback(
+        [this](const ob::Planner*, const std::vector<const ob::State*>& states, const ob::Cost cost) {
+          reportIntermediateSolution(states, cost);
+        });
+  else
+    ompl_simple_setup_->getProblemDefinition()->setIntermediateSolutionCallback(ob::ReportIntermediateSolutionFn());
   startSampling();
   ompl_simple_setup_->getSpaceInformation()->getMotionValidator()->resetMotionCounter();
 }
 
+namespace
+{
+bool sameAllowedCollisions(const moveit_msgs::AllowedCollisionMatrix& a, const moveit_msgs::AllowedCollisionMatrix& b)
+{
+  if (a.entry_names != b.entry_names || a.default_entry_names != b.default_entry_names ||
+      a.default_entry_values != b.default_entry_values || a.entry_values.size() != b.entry_values.size())
+    return false;
+  for (std::size_t i = 0; i < a.entry_values.size(); ++i)
+    if (a.entry_values[i].enabled != b.entry_values[i].enabled)
+      return false;
+  return true;
+}
+}
+
+ompl_interface::ModelBasedPlanningContext::RoadmapScene::RoadmapScene(const planning_scene::PlanningScene& scene,
+                                                                      const robot_state::RobotState& state,
+                                                                      const robot_model::JointModelGroup* group)
+{
+  const collision_detection::WorldConstPtr& world = scene.getWorld();
+  for (collision_detection::World::const_iterator it = world->begin(); it != world->end(); ++it)
+    objects_.push_back(std::make_pair(it->first, collision_detection::World::ObjectConstPtr(it->second)));
+  scene.getAllowedCollisionMatrix().getMessage(acm_);
+  link_padding_ = scene.getCollisionRobot()->getLinkPadding();
+  link_scale_ = scene.getCollisionRobot()->getLinkScale();
+
+  // the variables of the group are set by the planner, so only the others are compared
+  other_positions_.assign(state.getVariablePositions(), state.getVariablePositions() + state.getVariableCount());
+  const std::vector<int>& group_variables = group->getVariableIndexList();
+  for (std::size_t i = 0; i < group_variables.size(); ++i)
+    other_positions_[group_variables[i]] = 0.0;
+
+  std::vector<const robot_state::AttachedBody*> attached;
+  state.getAttachedBodies(attached);
+  for (std::size_t i = 0; i < attached.size(); ++i)
+  {
+    attached_names_.push_back(attached[i]->getName());
+    attached_links_.push_back(attached[i]->getAttachedLinkName());
+    attached_shapes_.push_back(attached[i]->getShapes());
+    attached_transforms_.push_back(attached[i]->getFixedTransforms());
+  }
+}
+
+bool ompl_interface::ModelBasedPlanningContext::RoadmapScene::matches(const RoadmapScene& other) const
+{
+  if (objects_ != other.objects_ || link_padding_ != other.link_padding_ || link_scale_ != other.link_scale_ ||
+      other_positions_ != other.other_positions_ || attached_names_ != other.attached_names_ ||
+      attached_links_ != other.attached_links_ || attached_shapes_ != other.attached_shapes_ ||
+      !sameAllowedCollisions(acm_, other.acm_))
+    return false;
+  for (std::size_t i = 0; i < attached_transforms_.size(); ++i)
+    for (std::size_t j = 0; j < attached_transforms_[i].size(); ++j)
+      if (!attached_transforms_[i][j].isApprox(other.attached_transforms_[i][j], 1e-9))
+        return false;
+  return true;
+}
+
+bool ompl_interface::ModelBasedPlanningContext::reuseRoadmap(ob::Planner* planner)
+{
+  if (!multi_query_planning_enabled_)
+    return false;
+  og::PRM* prm = dynamic_cast<og::PRM*>(planner);
+  og::LazyPRM* lazy_prm = prm ? NULL : dynamic_cast<og::LazyPRM*>(planner);
+  // path constraints decide which states are valid too, so roadmaps computed under them are not kept
+  if ((!prm && !lazy_prm) || !kinematic_constraints::isEmpty(path_constraints_msg_))
+  {
+    roadmap_scene_.reset();
+    return false;
+  }
+
+  std::shared_ptr<const RoadmapScene> scene(
+      new RoadmapScene(*getPlanningScene(), complete_initial_robot_state_, getJointModelGroup()));
+  bool same = roadmap_scene_ && roadmap_scene_->matches(*scene);
+  roadmap_scene_ = scene;
+  if (!same)
+  {
+    ROS_DEBUG_NAMED("model_based_planning_context", "%s: The scene changed, the roadmap is computed anew",
+                    name_.c_str());
+    return false;
+  }
+
+  // only the start and goal states are dropped; the milestones and edges answer the new query as well
+  if (prm)
+  {
+    prm->clearQuery();
+    ROS_DEBUG_NAMED("model_based_planning_context", "%s: Reusing a roadmap of %lu milestones", name_.c_str(),
+                    prm->milestoneCount());
+  }
+  else
+  {
+    lazy_prm->clearQuery();
+    ROS_DEBUG_NAMED("model_based_planning_context", "%s: Reusing a roadmap of %lu milestones", name_.c_str(),
+                    lazy_prm->milestoneCount());
+  }
+  return true;
+}
+
 void ompl_interface::ModelBasedPlanningContext::postSolve()
 {
   stopSampling();
@@ -564,8 +1010,75 @@ void ompl_interface::ModelBasedPlanningContext::postSolve()
     ROS_WARN_NAMED("model_based_planning_context", "Computed solution is approximate");
 }
 
+void ompl_interface::ModelBasedPlanningContext::reportIntermediateSolution(const std::vector<const ob::State*>& states,
+                                                                           const ob::Cost& cost) const
+{
+  if (states.empty())
+    return;
+
+  // with parallel planners the reports are not ordered by cost; only pass on those that improve on the best one
+  const ob::ProblemDefinitionPtr& pdef = ompl_simple_setup_->getProblemDefinition();
+  boost::mutex::scoped_lock slock(intermediate_solution_lock_);
+  const ob::OptimizationObjectivePtr& objective = pdef->getOptimizationObjective();
+  if (objective && !std::isnan(best_intermediate_cost_.value()) &&
+      !objective->isCostBetterThan(cost, best_intermediate_cost_))
+    return;
+  best_intermediate_cost_ = cost;
+
+  // planners report their paths in either direction; orient the path so that it begins at the start state
+  bool reverse = false;
+  if (pdef->getStartStateCount() > 0)
+  {
+    const ob::State* start = pdef->getStartState(0);
+    reverse = spec_.state_space_->distance(states.back(), start) < spec_.state_space_->distance(states.front(), start);
+  }
+
+  robot_trajectory::RobotTrajectoryPtr traj(new robot_trajectory::RobotTrajectory(getRobotModel(), getGroupName()));
+  robot_state::RobotState ks = complete_initial_robot_state_;
+  for (std::size_t i = 0; i < states.size(); ++i)
+  {
+    spec_.state_space_->copyToRobotState(ks, states[reverse ? states.size() - 1 - i : i]);
+    traj->addSuffixWayPoint(ks, 0.0);
+  }
+  intermediate_solution_callback_(traj, cost.value());
+}
+
+std::string ompl_interface::ModelBasedPlanningContext::getExperienceKey() const
+{
+  return getGroupName() + "/" + spec_.state_space_->getName();
+}
+
+bool ompl_interface::ModelBasedPlanningContext::isGoalState(const ob::State* state) const
+{
+  robot_state::RobotState robot_state(complete_initial_robot_state_);
+  spec_.state_space_->copyToRobotState(robot_state, state);
+  for (std::size_t i = 0; i < goal_constraints_.size(); ++i)
+    if (goal_constraints_[i]->decide(robot_state).satisfied)
+      return true;
+  return false;
+}
+
+bool ompl_interface::ModelBasedPlanningContext::recallExperience()
+{
+  og::PathGeometric path(ompl_simple_setup_->getSpaceInformation());
+  if (!spec_.experience_database_->recallExperience(
+          getExperienceKey(), ompl_simple_setup_->getProblemDefinition(),
+          boost::bind(&ModelBasedPlanningContext::isGoalState, this, _1), path))
+    return false;
+  ompl_simple_setup_->getProblemDefinition()->addSolutionPath(ob::PathPtr(new og::PathGeometric(path)), false, 0.0,
+                                                              "ExperienceDatabase");
+  return true;
+}
+
+void ompl_interface::ModelBasedPlanningContext::rememberSolution()
+{
+  if (spec_.experience_database_ && !solved_from_experience_ && ompl_simple_setup_->haveExactSolutionPath())
+    spec_.experience_database_->addExperience(getExperienceKey(), ompl_simple_setup_->getSolutionPath());
+}
+
 bool ompl_interface::ModelBasedPlanningContext::solve(planning_interface::MotionPlanResponse& res)
 {
+  setIntermediateSolutionCallback(res.intermediate_solution_callback_);
   if (solve(request_.allowed_planning_time, request_.num_planning_attempts))
   {
     double ptime = getLastPlanTime();
@@ -574,6 +1087,7 @@ bool ompl_interface::ModelBasedPlanningContext::solve(planning_interface::Motion
       simplifySolution(request_.allowed_planning_time - ptime);
       ptime += getLastSimplifyTime();
     }
+    rememberSolution();
     interpolateSolution();
 
     // fill the response
@@ -618,6 +1132,8 @@ bool ompl_interface::ModelBasedPlanningContext::solve(planning_interface::Motion
       getSolutionPath(*res.trajectory_.back());
     }
 
+    rememberSolution();
+
     ompl::time::point start_interpolate = ompl::time::now();
     interpolateSolution();
     res.processing_time_.push_back(ompl::time::seconds(ompl::time::now() - start_interpolate));
@@ -642,8 +1158,21 @@ bool ompl_interface::ModelBasedPlanningContext::solve(planning_interface::Motion
 bool ompl_interface::ModelBasedPlanningContext::solve(double timeout, unsigned int count)
 {
   moveit::tools::Profiler::ScopedBlock sblock("PlanningContext:Solve");
+  MOVEIT_PROBE_SPAN("ModelBasedPlanningContext::solve");
   ompl::time::point start = ompl::time::now();
-  preSolve();
+  {
+    MOVEIT_PROBE_SPAN("ModelBasedPlanningContext::preSolve");
+    preSolve();
+  }
+
+  solved_from_experience_ = spec_.experience_database_ && recallExperience();
+  if (solved_from_experience_)
+  {
+    ROS_DEBUG_NAMED("model_based_planning_context", "%s: Reusing a previously computed solution", name_.c_str());
+    last_plan_time_ = ompl::time::seconds(ompl::time::now() - start);
+    postSolve();
+    return true;
+  }
 
   bool result = false;
   if (count <= 1)
@@ -672,7 +1201,7 @@ bool ompl_interface::ModelBasedPlanningContext::solve(double timeout, unsigned i
           ompl_parallel_plan_.addPlanner(ompl::tools::SelfConfig::getDefaultPlanner(ompl_simple_setup_->getGoal()));
 
       ob::PlannerTerminationCondition ptc =
-          ob::timedPlannerTerminationCondition(timeout - ompl::time::seconds(ompl::time::now() - start));
+          attemptsTerminationCondition(timeout - ompl::time::seconds(ompl::time::now() - start));
       registerTerminationCondition(ptc);
       result = ompl_parallel_plan_.solve(ptc, 1, count, true) == ompl::base::PlannerStatus::EXACT_SOLUTION;
       last_plan_time_ = ompl::time::seconds(ompl::time::now() - start);
@@ -681,7 +1210,7 @@ bool ompl_interface::ModelBasedPlanningContext::solve(double timeout, unsigned i
     else
     {
       ob::PlannerTerminationCondition ptc =
-          ob::timedPlannerTerminationCondition(timeout - ompl::time::seconds(ompl::time::now() - start));
+          attemptsTerminationCondition(timeout - ompl::time::seconds(ompl::time::now() - start));
       registerTerminationCondition(ptc);
       int n = count / max_planning_threads_;
       result = true;
@@ -720,6 +1249,100 @@ bool ompl_interface::ModelBasedPlanningContext::solve(double timeout, unsigned i
   return result;
 }
 
+namespace
+{
+// how long the shortest solution is watched for improvement before the improvement rate is judged
+const double ATTEMPTS_IMPROVEMENT_WINDOW = 0.1;
+
+// how often the solutions of the attempts are checked for convergence
+const double ATTEMPTS_CHECK_PERIOD = 0.01;
+
+class AttemptsConvergence
+{
+public:
+  AttemptsConvergence(const ob::ProblemDefinitionPtr& pdef, unsigned int agreement, double tolerance,
+                      double min_improvement_rate)
+    : pdef_(pdef)
+    , agreement_(agreement)
+    , tolerance_(tolerance)
+    , min_improvement_rate_(min_improvement_rate)
+    , last_best_(-1.0)
+  {
+  }
+
+  // evaluated periodically on a single thread
+  bool operator()()
+  {
+    const std::vector<ob::PlannerSolution> solutions = pdef_->getSolutions();
+    std::vector<double> lengths;
+    for (std::size_t i = 0; i < solutions.size(); ++i)
+      if (!solutions[i].approximate_)
+        lengths.push_back(solutions[i].path_->length());
+    if (lengths.size() < 2)
+      return false;
+    const double best = *std::min_element(lengths.begin(), lengths.end());
+
+    if (agreement_ > 0)
+    {
+      unsigned int agreeing = 0;
+      for (std::size_t i = 0; i < lengths.size(); ++i)
+        if (lengths[i] <= best * (1.0 + tolerance_))
+          ++agreeing;
+      if (agreeing >= agreement_)
+      {
+        ROS_DEBUG_NAMED("model_based_planning_context", "%u solutions agree on a path length of %lf", agreeing, best);
+        return true;
+      }
+    }
+
+    if (min_improvement_rate_ > 0.0)
+    {
+      const ompl::time::point now = ompl::time::now();
+      if (last_best_ < 0.0)
+      {
+        last_best_ = best;
+        last_check_ = now;
+        return false;
+      }
+      const double elapsed = ompl::time::seconds(now - last_check_);
+      if (elapsed >= ATTEMPTS_IMPROVEMENT_WINDOW)
+      {
+        if ((last_best_ - best) / (last_best_ * elapsed) < min_improvement_rate_)
+        {
+          ROS_DEBUG_NAMED("model_based_planning_context", "Path length stopped improving at %lf", best);
+          return true;
+        }
+        last_best_ = best;
+        last_check_ = now;
+      }
+    }
+    return false;
+  }
+
+private:
+  ob::ProblemDefinitionPtr pdef_;
+  unsigned int agreement_;
+  double tolerance_;
+  double min_improvement_rate_;
+  double last_best_;
+  ompl::time::point last_check_;
+};
+}
+
+ompl::base::PlannerTerminationCondition
+ompl_interface::ModelBasedPlanningContext::attemptsTerminationCondition(double timeout) const
+{
+  ob::PlannerTerminationCondition timed = ob::timedPlannerTerminationCondition(timeout);
+  if (adaptive_attempts_agreement_ == 0 && adaptive_attempts_min_improvement_rate_ <= 0.0)
+    return timed;
+  return ob::plannerOrTerminationCondition(
+      timed, ob::PlannerTerminationCondition(AttemptsConvergence(ompl_simple_setup_->getProblemDefinition(),
+                                                                 adaptive_attempts_agreement_,
+                                                                 adaptive_attempts_tolerance_,
+                                                                 adaptive_attempts_min_improvement_rate_),
+                                             ATTEMPTS_CHECK_PERIOD));
+}
+
 void ompl_interface::ModelBasedPlanningContext::registerTerminationCondition(const ob::PlannerTerminationCondition& ptc)
 {
   boost::mutex::scoped_lock slock(ptc_lock_);
@@ -39,6 +39,8 @@
 #include <moveit/kinematic_constraints/utils.h>
 #include <moveit/ompl_interface/detail/constrained_valid_state_sampler.h>
 #include <moveit/profiler/profiler.h>
+#include <boost/filesystem.hpp>
+#include <algorithm>
 #include <fstream>
 
 ompl_interface::OMPLInterface::OMPLInterface(const robot_model::RobotModelConstPtr& kmodel, const ros::NodeHandle& nh)
@@ -53,7 +55,11 @@ ompl_interface::OMPLInterface::OMPLInterface(const robot_model::RobotModelConstP
   ROS_INFO("Initializing OMPL interface using ROS parameters");
   loadPlannerConfigurations();
   loadConstraintApproximations();
+  loadExperienceDatabase();
+  loadConstrainedStatePool();
+  loadGoalSampleCache();
   loadConstraintSamplers();
+  loadPlanningContextCache();
 }
 
 ompl_interface::OMPLInterface::OMPLInterface(const robot_model::RobotModelConstPtr& kmodel,
@@ -70,11 +76,17 @@ ompl_interface::OMPLInterface::OMPLInterface(const robot_model::RobotModelConstP
   ROS_INFO("Initializing OMPL interface using specified configuration");
   setPlannerConfigurations(pconfig);
   loadConstraintApproximations();
+  loadExperienceDatabase();
+  loadConstrainedStatePool();
+  loadGoalSampleCache();
   loadConstraintSamplers();
+  loadPlanningContextCache();
 }
 
 ompl_interface::OMPLInterface::~OMPLInterface()
 {
+  if (experience_database_)
+    saveExperienceDatabase();
 }
 
 void ompl_interface::OMPLInterface::setPlannerConfigurations(const planning_interface::PlannerConfigurationMap& pconfig)
@@ -113,6 +125,17 @@ ompl_interface::ModelBasedPlanningContextPtr ompl_interface::OMPLInterface::getP
   return ctx;
 }
 
+ompl_interface::PortfolioPlanningContextPtr ompl_interface::OMPLInterface::getPortfolioPlanningContext(
+    const planning_scene::PlanningSceneConstPtr& planning_scene, const planning_interface::MotionPlanRequest& req,
+    moveit_msgs::MoveItErrorCodes& error_code) const
+{
+  PortfolioPlanningContextPtr ctx = context_manager_.getPortfolioPlanningContext(planning_scene, req, error_code);
+  if (ctx)
+    for (std::size_t i = 0; i < ctx->getPlanningContexts().size(); ++i)
+      configureContext(ctx->getPlanningContexts()[i]);
+  return ctx;
+}
+
 ompl_interface::ModelBasedPlanningContextPtr
 ompl_interface::OMPLInterface::getPlanningContext(const std::string& config, const std::string& factory_type) const
 {
@@ -128,6 +151,9 @@ void ompl_interface::OMPLInterface::configureContext(const ModelBasedPlanningCon
     context->setConstraintsApproximations(constraints_library_);
   else
     context->setConstraintsApproximations(ConstraintsLibraryPtr());
+  context->setExperienceDatabase(experience_database_);
+  context->setConstrainedStatePool(constrained_state_pool_);
+  context->setGoalSampleCache(goal_sample_cache_);
   context->simplifySolutions(simplify_solutions_);
 }
 
@@ -167,6 +193,64 @@ bool ompl_interface::OMPLInterface::loadConstraintApproximations()
   return false;
 }
 
+bool ompl_interface::OMPLInterface::saveExperienceDatabase()
+{
+  std::string path;
+  if (experience_database_ && nh_.getParam("experience_database_path", path))
+    return experience_database_->save(path);
+  return false;
+}
+
+bool ompl_interface::OMPLInterface::loadExperienceDatabase()
+{
+  std::string path;
+  if (!nh_.getParam("experience_database_path", path))
+    return false;
+  int max_experiences;
+  nh_.param("experience_database_max_per_group", max_experiences, 1000);
+  experience_database_.reset(new ExperienceDatabase(std::max(0, max_experiences)));
+  if (boost::filesystem::exists(path))
+    experience_database_->load(path);
+  ROS_INFO("Reusing previous solutions from experience database '%s'", path.c_str());
+  return true;
+}
+
+void ompl_interface::OMPLInterface::loadConstrainedStatePool()
+{
+  int pool_size;
+  nh_.param("constrained_state_pool_size", pool_size, 1000);
+  if (pool_size > 0)
+    constrained_state_pool_.reset(new ConstrainedStatePool(pool_size));
+  else
+    constrained_state_pool_.reset();
+}
+
+void ompl_interface::OMPLInterface::loadGoalSampleCache()
+{
+  int cache_size, samples;
+  nh_.param("goal_sample_cache_size", cache_size, 100);
+  nh_.param("goal_sample_cache_samples", samples, 10);
+  if (cache_size > 0 && samples > 0)
+    goal_sample_cache_.reset(new GoalSampleCache(cache_size, samples));
+  else
+    goal_sample_cache_.reset();
+}
+
+void ompl_interface::OMPLInterface::loadPlanningContextCache()
+{
+  int max_contexts;
+  nh_.param("max_cached_planning_contexts", max_contexts, 32);
+  context_manager_.setMaximumCachedContexts(std::max(0, max_contexts));
+
+  std::vector<std::string> configs;
+  if (!nh_.getParam("prewarm_planning_contexts", configs) || configs.empty())
+    return;
+  ompl::time::point start = ompl::time::now();
+  std::size_t count = context_manager_.prewarmPlanningContexts(configs);
+  ROS_INFO("Prepared %u of %u planning contexts in %lf seconds", (unsigned int)count, (unsigned int)configs.size(),
+           ompl::time::seconds(ompl::time::now() - start));
+}
+
 void ompl_interface::OMPLInterface::loadConstraintSamplers()
 {
   constraint_sampler_manager_loader_.reset(
@@ -225,7 +309,9 @@ void ompl_interface::OMPLInterface::loadPlannerConfigurations()
   {
     // the set of planning parameters that can be specific for the group (inherited by configurations of that group)
     static const std::string KNOWN_GROUP_PARAMS[] = { "projection_evaluator", "longest_valid_segment_fraction",
-                                                      "enforce_joint_model_state_space" };
+                                                      "enforce_joint_model_state_space",
+                                                      "continuous_collision_checking", "portfolio_planners",
+                                                      "portfolio_keep_shortest" };
 
     // get parameters specific for the robot planning group
     std::map<std::string, std::string> specific_group_params;
@@ -146,6 +146,10 @@ public:
   getPlanningContext(const planning_scene::PlanningSceneConstPtr& planning_scene,
                      const planning_interface::MotionPlanRequest& req, moveit_msgs::MoveItErrorCodes& error_code) const
   {
+    planning_interface::PlanningContextPtr portfolio =
+        ompl_interface_->getPortfolioPlanningContext(planning_scene, req, error_code);
+    if (portfolio)
+      return portfolio;
     return ompl_interface_->getPlanningContext(planning_scene, req, error_code);
   }
 
@@ -75,8 +75,12 @@ ompl_interface::ModelBasedStateSpace::ModelBasedStateSpace(const ModelBasedState
                                boost::bind(&ModelBasedStateSpace::getTagSnapToSegment, this));
 }
 
+const std::size_t ompl_interface::ModelBasedStateSpace::STATE_POOL_BLOCK_SIZE;
+
 ompl_interface::ModelBasedStateSpace::~ModelBasedStateSpace()
 {
+  for (std::size_t i = 0; i < state_pool_blocks_.size(); ++i)
+    delete[] state_pool_blocks_[i];
 }
 
 double ompl_interface::ModelBasedStateSpace::getTagSnapToSegment() const
@@ -100,15 +104,36 @@ void ompl_interface::ModelBasedStateSpace::setTagSnapToSegment(double snap)
 
 ompl::base::State* ompl_interface::ModelBasedStateSpace::allocState() const
 {
-  StateType* state = new StateType();
-  state->values = new double[variable_count_];
+  boost::mutex::scoped_lock slock(state_pool_lock_);
+  if (state_pool_.empty())
+  {
+    // allocate a block of states at once; the values of each state follow it in memory. sizeof(StateType) is a
+    // multiple of the alignment of double, since StateType holds a double
+    const std::size_t slot_size = sizeof(StateType) + state_values_size_;
+    char* block = new char[slot_size * STATE_POOL_BLOCK_SIZE];
+    state_pool_blocks_.push_back(block);
+    state_pool_.reserve(STATE_POOL_BLOCK_SIZE * state_pool_blocks_.size());
+    for (std::size_t i = 0; i < STATE_POOL_BLOCK_SIZE; ++i)
+    {
+      char* slot = block + (STATE_POOL_BLOCK_SIZE - i - 1) * slot_size;
+      StateType* state = new (slot) StateType();
+      state->values = reinterpret_cast<double*>(slot + sizeof(StateType));
+      state_pool_.push_back(state);
+    }
+  }
+
+  StateType* state = state_pool_.back();
+  state_pool_.pop_back();
+  state->tag = -1;
+  state->flags = 0;
+  state->distance = 0.0;
   return state;
 }
 
 void ompl_interface::ModelBasedStateSpace::freeState(ompl::base::State* state) const
 {
-  delete[] state->as<StateType>()->values;
-  delete state->as<StateType>();
+  boost::mutex::scoped_lock slock(state_pool_lock_);
+  state_pool_.push_back(state->as<StateType>());
 }
 
 void ompl_interface::ModelBasedStateSpace::copyState(ompl::base::State* destination,
@@ -260,13 +285,15 @@ ompl::base::StateSamplerPtr ompl_interface::ModelBasedStateSpace::allocDefaultSt
 
     virtual void sampleUniform(ompl::base::State* state)
     {
-      joint_model_group_->getVariableRandomPositions(moveit_rng_, state->as<StateType>()->values, *joint_bounds_);
+      joint_model_group_->getVariableRandomPositions(moveit::core::getThreadRandomNumberGenerator(),
+                                                     state->as<StateType>()->values, *joint_bounds_);
       state->as<StateType>()->clearKnownInformation();
     }
 
     virtual void sampleUniformNear(ompl::base::State* state, const ompl::base::State* near, const double distance)
     {
-      joint_model_group_->getVariableRandomPositionsNearBy(moveit_rng_, state->as<StateType>()->values, *joint_bounds_,
+      joint_model_group_->getVariableRandomPositionsNearBy(moveit::core::getThreadRandomNumberGenerator(),
+                                                           state->as<StateType>()->values, *joint_bounds_,
                                                            near->as<StateType>()->values, distance);
       state->as<StateType>()->clearKnownInformation();
     }
@@ -277,7 +304,6 @@ ompl::base::StateSamplerPtr ompl_interface::ModelBasedStateSpace::allocDefaultSt
     }
 
   protected:
-    random_numbers::RandomNumberGenerator moveit_rng_;
     const robot_model::JointModelGroup* joint_model_group_;
     const robot_model::JointBoundsVector* joint_bounds_;
   };
@@ -98,7 +98,9 @@ void ompl_interface::PoseModelStateSpace::freeState(ompl::base::State* state) co
   for (std::size_t i = 0; i < poses_.size(); ++i)
     poses_[i].state_space_->freeState(state->as<StateType>()->poses[i]);
   delete[] state->as<StateType>()->poses;
-  ModelBasedStateSpace::freeState(state);
+  // allocated by allocState() above, not taken from the state pool of ModelBasedStateSpace
+  delete[] state->as<StateType>()->values;
+  delete state->as<StateType>();
 }
 
 void ompl_interface::PoseModelStateSpace::copyState(ompl::base::State* destination,
@@ -139,6 +141,34 @@ void ompl_interface::PoseModelStateSpace::interpolate(const ompl::base::State* f
   // the call above may reset all flags for state; but we know the pose we want flag should be set
   state->as<StateType>()->setPoseComputed(true);
 
+  // at the ends of the edge the joint values are known, no IK needed
+  if (t <= 0.0 || t >= 1.0)
+  {
+    const StateType* end = (t <= 0.0 ? from : to)->as<StateType>();
+    if (end->jointsComputed())
+    {
+      memcpy(state->as<StateType>()->values, end->values, state_values_size_);
+      state->as<StateType>()->setJointsComputed(true);
+      return;
+    }
+  }
+
+  // seed IK with the solution for the previous state on this edge, where there is one
+  EdgeSeed* seed = edge_seed_.get();
+  if (!seed)
+  {
+    seed = new EdgeSeed();
+    seed->t = 0.0;
+    edge_seed_.reset(seed);
+  }
+  if (seed->matches(from->as<StateType>(), to->as<StateType>(), t))
+    for (std::size_t i = 0; i < poses_.size(); ++i)
+      for (std::size_t j = 0; j < poses_[i].bijection_.size(); ++j)
+      {
+        unsigned int k = poses_[i].bijection_[j];
+        state->as<StateType>()->values[k] = seed->values[k];
+      }
+
   /*
   std::cout << "*********** interpolate\n";
   printState(from, std::cout);
@@ -158,7 +188,26 @@ void ompl_interface::PoseModelStateSpace::interpolate(const ompl::base::State* f
     // if the joint value jumped too much
     if (d_from + d_to > std::max(0.2, dj))  // \todo make 0.2 a param
       state->as<StateType>()->markInvalid();
+    else
+    {
+      const double* from_values = from->as<StateType>()->values;
+      const double* to_values = to->as<StateType>()->values;
+      const double* values = state->as<StateType>()->values;
+      seed->from_values.assign(from_values, from_values + variable_count_);
+      seed->to_values.assign(to_values, to_values + variable_count_);
+      seed->values.assign(values, values + variable_count_);
+      seed->t = t;
+      return;
+    }
   }
+  seed->from_values.clear();
+}
+
+bool ompl_interface::PoseModelStateSpace::EdgeSeed::matches(const StateType* from, const StateType* to,
+                                                            double t) const
+{
+  return t > this->t && !from_values.empty() && std::equal(from_values.begin(), from_values.end(), from->values) &&
+         std::equal(to_values.begin(), to_values.end(), to->values);
 }
 
 void ompl_interface::PoseModelStateSpace::setPlanningVolume(double minX, double maxX, double minY, double maxY,
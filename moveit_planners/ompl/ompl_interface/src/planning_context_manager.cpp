@@ -38,6 +38,7 @@
 #include <moveit/robot_state/conversions.h>
 #include <moveit/profiler/profiler.h>
 #include <algorithm>
+#include <cstdint>
 #include <set>
 
 #include <ompl/geometric/planners/rrt/RRT.h>
@@ -70,6 +71,8 @@
 #include <moveit/ompl_interface/parameterization/joint_space/joint_model_state_space_factory.h>
 #include <moveit/ompl_interface/parameterization/joint_space/joint_model_state_space.h>
 #include <moveit/ompl_interface/parameterization/work_space/pose_model_state_space_factory.h>
+#include <moveit/ompl_interface/detail/flat_nearest_neighbors.h>
+#include <boost/algorithm/string/trim.hpp>
 
 namespace ompl_interface
 {
@@ -102,7 +105,47 @@ private:
 
 struct PlanningContextManager::CachedContexts
 {
-  std::map<std::pair<std::string, std::string>, std::vector<ModelBasedPlanningContextPtr> > contexts_;
+  struct Entry
+  {
+    ModelBasedPlanningContextPtr context_;
+    std::uint64_t last_used_;
+  };
+
+  typedef std::map<std::pair<std::string, std::string>, std::vector<Entry> > ContextMap;
+
+  /* Drop the least recently used contexts that are not in use until at most max_size remain (0 means no limit).
+     The caller must hold lock_. */
+  void evict(std::size_t max_size)
+  {
+    while (max_size > 0 && size_ > max_size)
+    {
+      ContextMap::iterator oldest = contexts_.end();
+      std::size_t oldest_index = 0;
+      for (ContextMap::iterator cc = contexts_.begin(); cc != contexts_.end(); ++cc)
+        for (std::size_t i = 0; i < cc->second.size(); ++i)
+          if (cc->second[i].context_.unique() &&
+              (oldest == contexts_.end() || cc->second[i].last_used_ < oldest->second[oldest_index].last_used_))
+          {
+            oldest = cc;
+            oldest_index = i;
+          }
+
+      // all remaining contexts are in use
+      if (oldest == contexts_.end())
+        break;
+
+      ROS_DEBUG_NAMED("planning_context_manager", "Dropping cached planning context '%s'",
+                      oldest->first.first.c_str());
+      oldest->second.erase(oldest->second.begin() + oldest_index);
+      if (oldest->second.empty())
+        contexts_.erase(oldest);
+      --size_;
+    }
+  }
+
+  ContextMap contexts_;
+  std::size_t size_ = 0;
+  std::uint64_t clock_ = 0;
   boost::mutex lock_;
 };
 
@@ -118,6 +161,7 @@ ompl_interface::PlanningContextManager::PlanningContextManager(
   , max_planning_threads_(4)
   , max_solution_segment_length_(0.0)
   , minimum_waypoint_count_(2)
+  , max_cached_contexts_(0)
 {
   last_planning_context_.reset(new LastPlanningContext());
   cached_contexts_.reset(new CachedContexts());
@@ -144,6 +188,40 @@ static ompl::base::PlannerPtr allocatePlanner(const ob::SpaceInformationPtr& si,
   planner->setup();
   return planner;
 }
+
+/* Planners that grow trees of motions can keep them in a FlatNearestNeighbors structure, which is selected by setting
+   nearest_neighbors to "flat" in the planner configuration */
+template <typename T>
+static ompl::base::PlannerPtr allocateTreePlanner(const ob::SpaceInformationPtr& si, const std::string& new_name,
+                                                  const ModelBasedPlanningContextSpecification& spec)
+{
+  T* tree_planner = new T(si);
+  ompl::base::PlannerPtr planner(tree_planner);
+  if (!new_name.empty())
+    planner->setName(new_name);
+  planner->params().setParams(spec.config_, true);
+
+  std::map<std::string, std::string>::const_iterator it = spec.config_.find("nearest_neighbors");
+  if (it != spec.config_.end() && boost::trim_copy(it->second) == "flat")
+  {
+    FlatDistanceLayout layout;
+    if (layout.compute(si->getStateSpace().get()))
+    {
+      FlatDistanceLayout::Scope scope(&layout);
+      tree_planner->template setNearestNeighbors<FlatNearestNeighbors>();
+    }
+    else
+      ROS_WARN_NAMED("planning_context_manager", "The distance of state space '%s' is not a weighted sum over its "
+                                                 "variables; keeping the default nearest neighbors structure",
+                     si->getStateSpace()->getName().c_str());
+  }
+  else if (it != spec.config_.end())
+    ROS_WARN_NAMED("planning_context_manager", "Unknown nearest neighbors structure '%s' for planner '%s'",
+                   it->second.c_str(), planner->getName().c_str());
+
+  planner->setup();
+  return planner;
+}
 }
 
 ompl_interface::ConfiguredPlannerAllocator
@@ -161,23 +239,23 @@ ompl_interface::PlanningContextManager::plannerSelector(const std::string& plann
 
 void ompl_interface::PlanningContextManager::registerDefaultPlanners()
 {
-  registerPlannerAllocator("geometric::RRT", boost::bind(&allocatePlanner<og::RRT>, _1, _2, _3));
-  registerPlannerAllocator("geometric::RRTConnect", boost::bind(&allocatePlanner<og::RRTConnect>, _1, _2, _3));
-  registerPlannerAllocator("geometric::LazyRRT", boost::bind(&allocatePlanner<og::LazyRRT>, _1, _2, _3));
-  registerPlannerAllocator("geometric::TRRT", boost::bind(&allocatePlanner<og::TRRT>, _1, _2, _3));
+  registerPlannerAllocator("geometric::RRT", boost::bind(&allocateTreePlanner<og::RRT>, _1, _2, _3));
+  registerPlannerAllocator("geometric::RRTConnect", boost::bind(&allocateTreePlanner<og::RRTConnect>, _1, _2, _3));
+  registerPlannerAllocator("geometric::LazyRRT", boost::bind(&allocateTreePlanner<og::LazyRRT>, _1, _2, _3));
+  registerPlannerAllocator("geometric::TRRT", boost::bind(&allocateTreePlanner<og::TRRT>, _1, _2, _3));
   registerPlannerAllocator("geometric::EST", boost::bind(&allocatePlanner<og::EST>, _1, _2, _3));
   registerPlannerAllocator("geometric::SBL", boost::bind(&allocatePlanner<og::SBL>, _1, _2, _3));
   registerPlannerAllocator("geometric::KPIECE", boost::bind(&allocatePlanner<og::KPIECE1>, _1, _2, _3));
   registerPlannerAllocator("geometric::BKPIECE", boost::bind(&allocatePlanner<og::BKPIECE1>, _1, _2, _3));
   registerPlannerAllocator("geometric::LBKPIECE", boost::bind(&allocatePlanner<og::LBKPIECE1>, _1, _2, _3));
-  registerPlannerAllocator("geometric::RRTstar", boost::bind(&allocatePlanner<og::RRTstar>, _1, _2, _3));
+  registerPlannerAllocator("geometric::RRTstar", boost::bind(&allocateTreePlanner<og::RRTstar>, _1, _2, _3));
   registerPlannerAllocator("geometric::PRM", boost::bind(&allocatePlanner<og::PRM>, _1, _2, _3));
   registerPlannerAllocator("geometric::PRMstar", boost::bind(&allocatePlanner<og::PRMstar>, _1, _2, _3));
   registerPlannerAllocator("geometric::FMT", boost::bind(&allocatePlanner<og::FMT>, _1, _2, _3));
   registerPlannerAllocator("geometric::BFMT", boost::bind(&allocatePlanner<og::BFMT>, _1, _2, _3));
   registerPlannerAllocator("geometric::PDST", boost::bind(&allocatePlanner<og::PDST>, _1, _2, _3));
   registerPlannerAllocator("geometric::STRIDE", boost::bind(&allocatePlanner<og::STRIDE>, _1, _2, _3));
-  registerPlannerAllocator("geometric::BiTRRT", boost::bind(&allocatePlanner<og::BiTRRT>, _1, _2, _3));
+  registerPlannerAllocator("geometric::BiTRRT", boost::bind(&allocateTreePlanner<og::BiTRRT>, _1, _2, _3));
   registerPlannerAllocator("geometric::LBTRRT", boost::bind(&allocatePlanner<og::LBTRRT>, _1, _2, _3));
   registerPlannerAllocator("geometric::BiEST", boost::bind(&allocatePlanner<og::BiEST>, _1, _2, _3));
   registerPlannerAllocator("geometric::ProjEST", boost::bind(&allocatePlanner<og::ProjEST>, _1, _2, _3));
@@ -222,6 +300,55 @@ ompl_interface::ModelBasedPlanningContextPtr ompl_interface::PlanningContextMana
   }
 }
 
+void ompl_interface::PlanningContextManager::setMaximumCachedContexts(unsigned int max_cached_contexts)
+{
+  max_cached_contexts_ = max_cached_contexts;
+  boost::mutex::scoped_lock slock(cached_contexts_->lock_);
+  cached_contexts_->evict(max_cached_contexts_);
+}
+
+std::size_t ompl_interface::PlanningContextManager::prewarmPlanningContexts(const std::vector<std::string>& configs)
+{
+  std::size_t count = 0;
+  moveit_msgs::MotionPlanRequest req;  // dummy request with default values
+  for (std::size_t i = 0; i < configs.size(); ++i)
+  {
+    planning_interface::PlannerConfigurationMap::const_iterator pc = planner_configs_.find(configs[i]);
+    if (pc == planner_configs_.end())
+    {
+      ROS_ERROR_NAMED("planning_context_manager", "Planning configuration '%s' was not found", configs[i].c_str());
+      continue;
+    }
+
+    // pick the state space the same way unconstrained requests for this configuration do
+    StateSpaceFactoryTypeSelector factory_selector;
+    std::map<std::string, std::string>::const_iterator it = pc->second.config.find("enforce_joint_model_state_space");
+    if (it != pc->second.config.end() && boost::lexical_cast<bool>(it->second))
+      factory_selector = boost::bind(&PlanningContextManager::getStateSpaceFactory1, this, _1,
+                                     JointModelStateSpace::PARAMETERIZATION_TYPE);
+    else
+      factory_selector = boost::bind(&PlanningContextManager::getStateSpaceFactory2, this, _1, req);
+    if (!factory_selector(pc->second.group))
+      continue;
+
+    ModelBasedPlanningContextPtr context = getPlanningContext(pc->second, factory_selector, req);
+    try
+    {
+      context->preallocatePlanner();
+      ++count;
+    }
+    catch (ompl::Exception& ex)
+    {
+      ROS_ERROR_NAMED("planning_context_manager", "OMPL encountered an error while preparing '%s': %s",
+                      configs[i].c_str(), ex.what());
+    }
+  }
+
+  // the prepared contexts are only reused by requests if nothing else refers to them
+  last_planning_context_->clear();
+  return count;
+}
+
 ompl_interface::ModelBasedPlanningContextPtr ompl_interface::PlanningContextManager::getPlanningContext(
     const planning_interface::PlannerConfigurationSettings& config,
     const StateSpaceFactoryTypeSelector& factory_selector, const moveit_msgs::MotionPlanRequest& req) const
@@ -233,15 +360,16 @@ ompl_interface::ModelBasedPlanningContextPtr ompl_interface::PlanningContextMana
 
   {
     boost::mutex::scoped_lock slock(cached_contexts_->lock_);
-    std::map<std::pair<std::string, std::string>, std::vector<ModelBasedPlanningContextPtr> >::const_iterator cc =
+    CachedContexts::ContextMap::iterator cc =
         cached_contexts_->contexts_.find(std::make_pair(config.name, factory->getType()));
     if (cc != cached_contexts_->contexts_.end())
     {
       for (std::size_t i = 0; i < cc->second.size(); ++i)
-        if (cc->second[i].unique())
+        if (cc->second[i].context_.unique())
         {
           ROS_DEBUG_NAMED("planning_context_manager", "Reusing cached planning context");
-          context = cc->second[i];
+          context = cc->second[i].context_;
+          cc->second[i].last_used_ = ++cached_contexts_->clock_;
           break;
         }
     }
@@ -284,7 +412,10 @@ ompl_interface::ModelBasedPlanningContextPtr ompl_interface::PlanningContextMana
     context->useStateValidityCache(state_validity_cache);
     {
       boost::mutex::scoped_lock slock(cached_contexts_->lock_);
-      cached_contexts_->contexts_[std::make_pair(config.name, factory->getType())].push_back(context);
+      CachedContexts::Entry entry = { context, ++cached_contexts_->clock_ };
+      cached_contexts_->contexts_[std::make_pair(config.name, factory->getType())].push_back(entry);
+      ++cached_contexts_->size_;
+      cached_contexts_->evict(max_cached_contexts_);
     }
   }
 
@@ -392,6 +523,13 @@ ompl_interface::ModelBasedPlanningContextPtr ompl_interface::PlanningContextMana
     }
   }
 
+  return getPlanningContext(planning_scene, req, pc->second, error_code);
+}
+
+ompl_interface::ModelBasedPlanningContextPtr ompl_interface::PlanningContextManager::getPlanningContext(
+    const planning_scene::PlanningSceneConstPtr& planning_scene, const moveit_msgs::MotionPlanRequest& req,
+    const planning_interface::PlannerConfigurationSettings& config, moveit_msgs::MoveItErrorCodes& error_code) const
+{
   // Check if sampling in JointModelStateSpace is enforced for this group by user.
   // This is done by setting 'enforce_joint_model_state_space' to 'true' for the desired group in ompl_planning.yaml.
   //
@@ -400,15 +538,15 @@ ompl_interface::ModelBasedPlanningContextPtr ompl_interface::PlanningContextMana
   // leading to invalid trajectories. This workaround lets the user prevent this problem by forcing rejection sampling
   // in JointModelStateSpace.
   StateSpaceFactoryTypeSelector factory_selector;
-  std::map<std::string, std::string>::const_iterator it = pc->second.config.find("enforce_joint_model_state_space");
+  std::map<std::string, std::string>::const_iterator it = config.config.find("enforce_joint_model_state_space");
 
-  if (it != pc->second.config.end() && boost::lexical_cast<bool>(it->second))
+  if (it != config.config.end() && boost::lexical_cast<bool>(it->second))
     factory_selector = boost::bind(&PlanningContextManager::getStateSpaceFactory1, this, _1,
                                    JointModelStateSpace::PARAMETERIZATION_TYPE);
   else
     factory_selector = boost::bind(&PlanningContextManager::getStateSpaceFactory2, this, _1, req);
 
-  ModelBasedPlanningContextPtr context = getPlanningContext(pc->second, factory_selector, req);
+  ModelBasedPlanningContextPtr context = getPlanningContext(config, factory_selector, req);
 
   if (context)
   {
@@ -444,6 +582,64 @@ ompl_interface::ModelBasedPlanningContextPtr ompl_interface::PlanningContextMana
   return context;
 }
 
+ompl_interface::PortfolioPlanningContextPtr ompl_interface::PlanningContextManager::getPortfolioPlanningContext(
+    const planning_scene::PlanningSceneConstPtr& planning_scene, const moveit_msgs::MotionPlanRequest& req,
+    moveit_msgs::MoveItErrorCodes& error_code) const
+{
+  // a portfolio is only used if no particular planner was asked for
+  if (req.group_name.empty() || !planning_scene || (!req.planner_id.empty() && req.planner_id != req.group_name))
+    return PortfolioPlanningContextPtr();
+
+  planning_interface::PlannerConfigurationMap::const_iterator pc = planner_configs_.find(req.group_name);
+  if (pc == planner_configs_.end())
+    return PortfolioPlanningContextPtr();
+  std::map<std::string, std::string>::const_iterator planners = pc->second.config.find("portfolio_planners");
+  if (planners == pc->second.config.end())
+    return PortfolioPlanningContextPtr();
+
+  bool keep_shortest = false;
+  std::map<std::string, std::string>::const_iterator ks = pc->second.config.find("portfolio_keep_shortest");
+  if (ks != pc->second.config.end())
+    keep_shortest = ks->second == "true" || ks->second == "1";
+
+  std::vector<ModelBasedPlanningContextPtr> contexts;
+  boost::char_separator<char> sep(" ");
+  boost::tokenizer<boost::char_separator<char> > tok(planners->second, sep);
+  for (boost::tokenizer<boost::char_separator<char> >::iterator beg = tok.begin(); beg != tok.end(); ++beg)
+  {
+    planning_interface::PlannerConfigurationMap::const_iterator member = planner_configs_.find(
+        beg->find(req.group_name) == std::string::npos ? req.group_name + "[" + *beg + "]" : *beg);
+    if (member == planner_configs_.end())
+    {
+      ROS_WARN_NAMED("planning_context_manager",
+                     "Cannot find planning configuration '%s' of the portfolio for group '%s'", beg->c_str(),
+                     req.group_name.c_str());
+      continue;
+    }
+
+    ModelBasedPlanningContextPtr context = getPlanningContext(planning_scene, req, member->second, error_code);
+    if (!context)
+      return PortfolioPlanningContextPtr();
+    contexts.push_back(context);
+  }
+
+  if (contexts.empty())
+  {
+    ROS_ERROR_NAMED("planning_context_manager", "None of the portfolio planners of group '%s' could be configured",
+                    req.group_name.c_str());
+    return PortfolioPlanningContextPtr();
+  }
+
+  ROS_DEBUG_NAMED("planning_context_manager", "Racing %u planning contexts for group '%s'",
+                  (unsigned int)contexts.size(), req.group_name.c_str());
+  PortfolioPlanningContextPtr portfolio(
+      new PortfolioPlanningContext(pc->second.name, req.group_name, contexts, keep_shortest));
+  portfolio->setPlanningScene(planning_scene);
+  portfolio->setMotionPlanRequest(req);
+  error_code.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
+  return portfolio;
+}
+
 ompl_interface::ModelBasedPlanningContextPtr ompl_interface::PlanningContextManager::getLastPlanningContext() const
 {
   return last_planning_context_->getContext();
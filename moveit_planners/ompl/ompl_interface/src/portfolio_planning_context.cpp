@@ -0,0 +1,207 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/ompl_interface/portfolio_planning_context.h>
+#include <moveit/profiler/profiler.h>
+#include <boost/thread.hpp>
+#include <limits>
+
+ompl_interface::PortfolioPlanningContext::PortfolioPlanningContext(
+    const std::string& name, const std::string& group, const std::vector<ModelBasedPlanningContextPtr>& contexts,
+    bool keep_shortest)
+  : planning_interface::PlanningContext(name, group), contexts_(contexts), keep_shortest_(keep_shortest)
+{
+}
+
+void ompl_interface::PortfolioPlanningContext::clear()
+{
+  for (std::size_t i = 0; i < contexts_.size(); ++i)
+    contexts_[i]->clear();
+}
+
+bool ompl_interface::PortfolioPlanningContext::terminate()
+{
+  bool result = true;
+  for (std::size_t i = 0; i < contexts_.size(); ++i)
+    result = contexts_[i]->terminate() && result;
+  return result;
+}
+
+ompl_interface::ModelBasedPlanningContextPtr ompl_interface::PortfolioPlanningContext::solve(double& plan_time)
+{
+  moveit::tools::Profiler::ScopedBlock sblock("PortfolioPlanningContext:Solve");
+  ompl::time::point start = ompl::time::now();
+
+  boost::mutex lock;
+  boost::condition_variable finished_condition;
+  std::vector<bool> solved(contexts_.size(), false);
+  std::vector<bool> finished(contexts_.size(), false);
+  std::size_t finished_count = 0;
+  int first_solved = -1;
+
+  boost::thread_group threads;
+  for (std::size_t i = 0; i < contexts_.size(); ++i)
+    threads.create_thread([&, i]() {
+      bool result = contexts_[i]->solve(request_.allowed_planning_time, request_.num_planning_attempts);
+      boost::mutex::scoped_lock slock(lock);
+      solved[i] = result;
+      finished[i] = true;
+      ++finished_count;
+      if (result && first_solved < 0)
+        first_solved = static_cast<int>(i);
+      finished_condition.notify_all();
+    });
+
+  {
+    boost::mutex::scoped_lock slock(lock);
+    if (!keep_shortest_)
+    {
+      while (first_solved < 0 && finished_count < contexts_.size())
+        finished_condition.wait(slock);
+
+      // a context may not have registered its termination condition yet when it is first asked to terminate,
+      // so keep asking until all of them are done
+      while (finished_count < contexts_.size())
+      {
+        for (std::size_t i = 0; i < contexts_.size(); ++i)
+          if (!finished[i])
+            contexts_[i]->terminate();
+        finished_condition.timed_wait(slock, boost::posix_time::milliseconds(10));
+      }
+    }
+  }
+  threads.join_all();
+  plan_time = ompl::time::seconds(ompl::time::now() - start);
+
+  if (!keep_shortest_)
+  {
+    if (first_solved < 0)
+      return ModelBasedPlanningContextPtr();
+    ROS_DEBUG_NAMED("portfolio_planning_context", "%s: '%s' found the first solution", name_.c_str(),
+                    contexts_[first_solved]->getName().c_str());
+    return contexts_[first_solved];
+  }
+
+  ModelBasedPlanningContextPtr best;
+  double best_length = std::numeric_limits<double>::infinity();
+  for (std::size_t i = 0; i < contexts_.size(); ++i)
+    if (solved[i])
+    {
+      double length = contexts_[i]->getOMPLSimpleSetup()->getSolutionPath().length();
+      ROS_DEBUG_NAMED("portfolio_planning_context", "%s: '%s' found a solution of length %lf", name_.c_str(),
+                      contexts_[i]->getName().c_str(), length);
+      if (length < best_length)
+      {
+        best_length = length;
+        best = contexts_[i];
+      }
+    }
+  return best;
+}
+
+bool ompl_interface::PortfolioPlanningContext::solve(planning_interface::MotionPlanResponse& res)
+{
+  double ptime;
+  ModelBasedPlanningContextPtr context = solve(ptime);
+  if (context)
+  {
+    if (context->simplifySolutions())
+    {
+      context->simplifySolution(request_.allowed_planning_time - ptime);
+      ptime += context->getLastSimplifyTime();
+    }
+    context->interpolateSolution();
+
+    ROS_DEBUG_NAMED("portfolio_planning_context", "%s: Returning successful solution with %lu states",
+                    getName().c_str(), context->getOMPLSimpleSetup()->getSolutionPath().getStateCount());
+
+    res.trajectory_.reset(new robot_trajectory::RobotTrajectory(context->getRobotModel(), getGroupName()));
+    context->getSolutionPath(*res.trajectory_);
+    res.planning_time_ = ptime;
+    return true;
+  }
+  else
+  {
+    ROS_INFO_NAMED("portfolio_planning_context", "Unable to solve the planning problem");
+    res.error_code_.val = moveit_msgs::MoveItErrorCodes::PLANNING_FAILED;
+    return false;
+  }
+}
+
+bool ompl_interface::PortfolioPlanningContext::solve(planning_interface::MotionPlanDetailedResponse& res)
+{
+  double ptime;
+  ModelBasedPlanningContextPtr context = solve(ptime);
+  if (context)
+  {
+    res.trajectory_.reserve(3);
+
+    // add info about planned solution
+    res.processing_time_.push_back(ptime);
+    res.description_.push_back("plan");
+    res.trajectory_.resize(res.trajectory_.size() + 1);
+    res.trajectory_.back().reset(new robot_trajectory::RobotTrajectory(context->getRobotModel(), getGroupName()));
+    context->getSolutionPath(*res.trajectory_.back());
+
+    // simplify solution if time remains
+    if (context->simplifySolutions())
+    {
+      context->simplifySolution(request_.allowed_planning_time - ptime);
+      res.processing_time_.push_back(context->getLastSimplifyTime());
+      res.description_.push_back("simplify");
+      res.trajectory_.resize(res.trajectory_.size() + 1);
+      res.trajectory_.back().reset(new robot_trajectory::RobotTrajectory(context->getRobotModel(), getGroupName()));
+      context->getSolutionPath(*res.trajectory_.back());
+    }
+
+    ompl::time::point start_interpolate = ompl::time::now();
+    context->interpolateSolution();
+    res.processing_time_.push_back(ompl::time::seconds(ompl::time::now() - start_interpolate));
+    res.description_.push_back("interpolate");
+    res.trajectory_.resize(res.trajectory_.size() + 1);
+    res.trajectory_.back().reset(new robot_trajectory::RobotTrajectory(context->getRobotModel(), getGroupName()));
+    context->getSolutionPath(*res.trajectory_.back());
+
+    ROS_DEBUG_NAMED("portfolio_planning_context", "%s: Returning successful solution with %lu states",
+                    getName().c_str(), context->getOMPLSimpleSetup()->getSolutionPath().getStateCount());
+    return true;
+  }
+  else
+  {
+    ROS_INFO_NAMED("portfolio_planning_context", "Unable to solve the planning problem");
+    res.error_code_.val = moveit_msgs::MoveItErrorCodes::PLANNING_FAILED;
+    return false;
+  }
+}
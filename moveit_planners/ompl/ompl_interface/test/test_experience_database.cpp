@@ -0,0 +1,174 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/ompl_interface/experience_database.h>
+#include <ompl/base/spaces/RealVectorStateSpace.h>
+#include <ompl/base/ScopedState.h>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cmath>
+
+namespace ob = ompl::base;
+namespace og = ompl::geometric;
+
+namespace
+{
+bool block_detour = false;
+
+// a wall at x = 0.5 below y = 0.8, and optionally a small obstacle on top of the detour around it
+bool isStateValid(const ob::State* state)
+{
+  const double* v = state->as<ob::RealVectorStateSpace::StateType>()->values;
+  if (fabs(v[0] - 0.5) < 0.05 && v[1] < 0.8)
+    return false;
+  return !(block_detour && fabs(v[0] - 0.5) < 0.03 && fabs(v[1] - 0.99) < 0.03);
+}
+}
+
+class ExperienceDatabaseTest : public testing::Test
+{
+protected:
+  virtual void SetUp()
+  {
+    block_detour = false;
+    ob::RealVectorStateSpace* space = new ob::RealVectorStateSpace(2);
+    space->setBounds(0.0, 1.0);
+    space_.reset(space);
+    si_.reset(new ob::SpaceInformation(space_));
+    si_->setStateValidityChecker(&isStateValid);
+    si_->setStateValidityCheckingResolution(0.005);
+    si_->setup();
+  }
+
+  og::PathGeometric makePath(const double points[][2], std::size_t count)
+  {
+    og::PathGeometric path(si_);
+    ob::ScopedState<ob::RealVectorStateSpace> state(space_);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      state->values[0] = points[i][0];
+      state->values[1] = points[i][1];
+      path.append(state.get());
+    }
+    return path;
+  }
+
+  ob::ProblemDefinitionPtr makeProblem(double sx, double sy, double gx, double gy)
+  {
+    ob::ProblemDefinitionPtr pdef(new ob::ProblemDefinition(si_));
+    ob::ScopedState<ob::RealVectorStateSpace> start(space_), goal(space_);
+    start->values[0] = sx;
+    start->values[1] = sy;
+    goal->values[0] = gx;
+    goal->values[1] = gy;
+    pdef->setStartAndGoalStates(start, goal, 0.01);
+    return pdef;
+  }
+
+  bool recall(const ompl_interface::ExperienceDatabase& db, const std::string& key,
+              const ob::ProblemDefinitionPtr& pdef, og::PathGeometric& path)
+  {
+    return db.recallExperience(key, pdef, ompl_interface::ExperienceDatabase::GoalTestFn(), path);
+  }
+
+  ob::StateSpacePtr space_;
+  ob::SpaceInformationPtr si_;
+};
+
+static const double DETOUR[5][2] = { { 0.1, 0.1 }, { 0.3, 0.9 }, { 0.5, 0.99 }, { 0.7, 0.9 }, { 0.9, 0.1 } };
+
+TEST_F(ExperienceDatabaseTest, Recall)
+{
+  ompl_interface::ExperienceDatabase db;
+  db.addExperience("group", makePath(DETOUR, 5));
+  EXPECT_EQ(1u, db.size());
+
+  // a nearby start reuses the stored path, prefixed by the new start
+  og::PathGeometric path(si_);
+  ASSERT_TRUE(recall(db, "group", makeProblem(0.12, 0.1, 0.9, 0.1), path));
+  EXPECT_TRUE(path.check());
+  EXPECT_EQ(6u, path.getStateCount());
+  EXPECT_NEAR(0.12, path.getState(0)->as<ob::RealVectorStateSpace::StateType>()->values[0], 1e-9);
+
+  // experiences are not shared between keys, and must end in the goal
+  EXPECT_FALSE(recall(db, "other", makeProblem(0.1, 0.1, 0.9, 0.1), path));
+  EXPECT_FALSE(recall(db, "group", makeProblem(0.1, 0.1, 0.9, 0.5), path));
+
+  // storing (nearly) the same path again replaces the old one
+  db.addExperience("group", makePath(DETOUR, 5));
+  EXPECT_EQ(1u, db.size());
+}
+
+TEST_F(ExperienceDatabaseTest, Repair)
+{
+  ompl_interface::ExperienceDatabase db;
+  db.addExperience("group", makePath(DETOUR, 5));
+
+  // the top of the detour is now blocked; the path is repaired by shortcutting below the obstacle
+  block_detour = true;
+  og::PathGeometric path(si_);
+  ASSERT_TRUE(recall(db, "group", makeProblem(0.1, 0.1, 0.9, 0.1), path));
+  EXPECT_TRUE(path.check());
+  EXPECT_EQ(5u, path.getStateCount());
+}
+
+TEST_F(ExperienceDatabaseTest, SaveLoad)
+{
+  ompl_interface::ExperienceDatabase db(2);
+  db.addExperience("group", makePath(DETOUR, 5));
+  const double other[2][2] = { { 0.1, 0.9 }, { 0.2, 0.9 } };
+  db.addExperience("group", makePath(other, 2));
+  const double third[2][2] = { { 0.9, 0.9 }, { 0.8, 0.9 } };
+  db.addExperience("group", makePath(third, 2));
+  // the oldest experience was dropped to honor the limit of two per key
+  EXPECT_EQ(2u, db.size());
+
+  const std::string filename = "ompl_interface_test_experience_database.txt";
+  ASSERT_TRUE(db.save(filename));
+  ompl_interface::ExperienceDatabase loaded;
+  ASSERT_TRUE(loaded.load(filename));
+  std::remove(filename.c_str());
+  EXPECT_EQ(2u, loaded.size());
+
+  og::PathGeometric path(si_);
+  EXPECT_TRUE(recall(loaded, "group", makeProblem(0.1, 0.9, 0.2, 0.9), path));
+  EXPECT_FALSE(recall(loaded, "group", makeProblem(0.1, 0.1, 0.9, 0.1), path));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
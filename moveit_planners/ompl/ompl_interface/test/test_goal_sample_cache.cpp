@@ -0,0 +1,110 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/ompl_interface/goal_sample_cache.h>
+#include <gtest/gtest.h>
+
+using ompl_interface::GoalSampleCache;
+
+TEST(GoalSampleCache, AddAndRemove)
+{
+  GoalSampleCache cache(10, 2);
+  std::vector<std::vector<double> > samples;
+  cache.getSamples("a", samples);
+  EXPECT_TRUE(samples.empty());
+
+  const std::vector<double> first(3, 0.1), second(3, 0.2), third(3, 0.3);
+  cache.addSample("a", first);
+  cache.addSample("a", first);
+  cache.addSample("a", second);
+  cache.getSamples("a", samples);
+  ASSERT_EQ(samples.size(), 2u);
+  EXPECT_EQ(samples[0], first);
+  EXPECT_EQ(samples[1], second);
+
+  // a full entry replaces its oldest sample
+  cache.addSample("a", third);
+  cache.getSamples("a", samples);
+  ASSERT_EQ(samples.size(), 2u);
+  EXPECT_EQ(samples[0], second);
+  EXPECT_EQ(samples[1], third);
+
+  cache.getSamples("b", samples);
+  EXPECT_TRUE(samples.empty());
+
+  cache.removeSample("a", second);
+  cache.getSamples("a", samples);
+  ASSERT_EQ(samples.size(), 1u);
+  EXPECT_EQ(samples[0], third);
+
+  // entries without samples are dropped
+  cache.removeSample("a", third);
+  EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST(GoalSampleCache, EvictLeastRecentlyUsed)
+{
+  GoalSampleCache cache(2, 5);
+  const std::vector<double> values(2, 1.0);
+  cache.addSample("a", values);
+  cache.addSample("b", values);
+
+  std::vector<std::vector<double> > samples;
+  cache.getSamples("a", samples);
+  cache.addSample("c", values);
+  EXPECT_EQ(cache.size(), 2u);
+
+  cache.getSamples("a", samples);
+  EXPECT_EQ(samples.size(), 1u);
+  cache.getSamples("b", samples);
+  EXPECT_TRUE(samples.empty());
+  cache.getSamples("c", samples);
+  EXPECT_EQ(samples.size(), 1u);
+
+  cache.clear();
+  EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST(GoalSampleCache, Disabled)
+{
+  GoalSampleCache cache(0, 5);
+  cache.addSample("a", std::vector<double>(1, 0.0));
+  EXPECT_EQ(cache.size(), 0u);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
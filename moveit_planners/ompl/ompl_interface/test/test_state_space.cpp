@@ -36,6 +36,10 @@
 
 #include <moveit/ompl_interface/parameterization/joint_space/joint_model_state_space.h>
 #include <moveit/ompl_interface/parameterization/work_space/pose_model_state_space.h>
+#include <moveit/ompl_interface/constraints_library.h>
+#include <moveit/ompl_interface/detail/flat_nearest_neighbors.h>
+#include <moveit/ompl_interface/constrained_state_pool.h>
+#include <moveit/constraint_samplers/default_constraint_samplers.h>
 #include <moveit_resources/config.h>
 
 #include <urdf_parser/urdf_parser.h>
@@ -44,6 +48,7 @@
 #include <moveit/robot_state/conversions.h>
 #include <gtest/gtest.h>
 #include <fstream>
+#include <limits>
 #include <boost/filesystem/path.hpp>
 
 class LoadPlanningModelsPr2 : public testing::Test
@@ -126,6 +131,54 @@ TEST_F(LoadPlanningModelsPr2, StateSpaces)
   ompl::base::StateSpace::Diagram(fout);
 }
 
+TEST_F(LoadPlanningModelsPr2, ConstraintApproximationDatabase)
+{
+  ompl_interface::ModelBasedStateSpaceSpecification spec(robot_model_, "right_arm");
+  ompl::base::StateSpacePtr ss(new ompl_interface::JointModelStateSpace(spec));
+  ss->setup();
+
+  ompl_interface::ConstraintApproximationStateStorage storage(ss);
+  ompl::base::StateSamplerPtr sampler = ss->allocDefaultStateSampler();
+  ompl::base::ScopedState<> state(ss);
+  for (int i = 0; i < 10; ++i)
+  {
+    sampler->sampleUniform(state.get());
+    state->as<ompl_interface::ModelBasedStateSpace::StateType>()->tag = i;
+    ompl_interface::ConstrainedStateMetadata md;
+    md.first.push_back((i + 1) % 10);
+    md.second[(i + 1) % 10] = std::make_pair(i, i + 1);
+    storage.addState(state.get(), md);
+  }
+
+  const std::string filename = "ompl_interface_test_constraint_database.mmap";
+  ASSERT_TRUE(ompl_interface::ConstraintApproximationDatabase::store(storage, filename));
+  ompl_interface::ConstraintApproximationDatabasePtr db =
+      ompl_interface::ConstraintApproximationDatabase::open(filename, ss);
+  ASSERT_TRUE(db);
+  EXPECT_EQ(storage.size(), db->size());
+  EXPECT_EQ(10u, db->getConnectionCount());
+
+  for (std::size_t i = 0; i < storage.size(); ++i)
+  {
+    db->copyState(state.get(), i);
+    EXPECT_TRUE(ss->equalStates(state.get(), storage.getState(i)));
+    EXPECT_EQ((int)i, state->as<ompl_interface::ModelBasedStateSpace::StateType>()->tag);
+    ASSERT_EQ(1u, db->getNeighborCount(i));
+    EXPECT_EQ((i + 1) % 10, db->getNeighbor(i, 0));
+    std::size_t first, last;
+    EXPECT_TRUE(db->getMotion(i, (i + 1) % 10, first, last));
+    EXPECT_EQ(i, first);
+    EXPECT_EQ(i + 1, last);
+    EXPECT_FALSE(db->getMotion(i, (i + 2) % 10, first, last));
+  }
+
+  // a database must not be accepted for a different state space
+  ompl_interface::ModelBasedStateSpaceSpecification whole_spec(robot_model_, "whole_body");
+  ompl::base::StateSpacePtr whole(new ompl_interface::JointModelStateSpace(whole_spec));
+  whole->setup();
+  EXPECT_FALSE(ompl_interface::ConstraintApproximationDatabase::open(filename, whole));
+}
+
 TEST_F(LoadPlanningModelsPr2, StateSpaceCopy)
 {
   ompl_interface::ModelBasedStateSpaceSpecification spec(robot_model_, "right_arm");
@@ -170,6 +223,131 @@ TEST_F(LoadPlanningModelsPr2, StateSpaceCopy)
   ss.freeState(state);
 }
 
+namespace
+{
+struct Motion
+{
+  ompl::base::State* state;
+};
+}
+
+TEST_F(LoadPlanningModelsPr2, FlatNearestNeighbors)
+{
+  ompl_interface::ModelBasedStateSpaceSpecification spec(robot_model_, "left_arm");
+  ompl_interface::JointModelStateSpace ss(spec);
+  ss.setup();
+
+  ompl_interface::FlatDistanceLayout layout;
+  ASSERT_TRUE(layout.compute(&ss));
+  EXPECT_EQ(layout.factors.size(), ss.getJointModelGroup()->getVariableCount());
+
+  ompl_interface::FlatDistanceLayout::Scope scope(&layout);
+  ompl_interface::FlatNearestNeighbors<Motion*> nn;
+  nn.setDistanceFunction([&ss](Motion* const& a, Motion* const& b) { return ss.distance(a->state, b->state); });
+
+  ompl::base::StateSamplerPtr sampler = ss.allocDefaultStateSampler();
+  std::vector<Motion> motions(200);
+  for (std::size_t i = 0; i < motions.size(); ++i)
+  {
+    motions[i].state = ss.allocState();
+    sampler->sampleUniform(motions[i].state);
+    nn.add(&motions[i]);
+  }
+  EXPECT_TRUE(nn.remove(&motions[10]));
+  EXPECT_FALSE(nn.remove(&motions[10]));
+  EXPECT_EQ(nn.size(), motions.size() - 1);
+
+  Motion query;
+  query.state = ss.allocState();
+  for (int q = 0; q < 10; ++q)
+  {
+    sampler->sampleUniform(query.state);
+    Motion* best = nullptr;
+    double best_distance = std::numeric_limits<double>::infinity();
+    for (std::size_t i = 0; i < motions.size(); ++i)
+      if (i != 10 && ss.distance(query.state, motions[i].state) < best_distance)
+      {
+        best = &motions[i];
+        best_distance = ss.distance(query.state, motions[i].state);
+      }
+    EXPECT_EQ(nn.nearest(&query), best);
+
+    std::vector<Motion*> nbh;
+    nn.nearestK(&query, 5, nbh);
+    ASSERT_EQ(nbh.size(), 5u);
+    EXPECT_EQ(nbh[0], best);
+    for (std::size_t i = 1; i < nbh.size(); ++i)
+      EXPECT_LE(ss.distance(query.state, nbh[i - 1]->state), ss.distance(query.state, nbh[i]->state));
+
+    nn.nearestR(&query, ss.distance(query.state, nbh[4]->state) + 1e-9, nbh);
+    EXPECT_GE(nbh.size(), 5u);
+  }
+
+  ss.freeState(query.state);
+  for (std::size_t i = 0; i < motions.size(); ++i)
+    ss.freeState(motions[i].state);
+}
+
+TEST_F(LoadPlanningModelsPr2, ConstrainedStatePool)
+{
+  moveit_msgs::Constraints constraints;
+  constraints.name = "elbow";
+  constraints.joint_constraints.resize(1);
+  constraints.joint_constraints[0].joint_name = "r_elbow_flex_joint";
+  constraints.joint_constraints[0].position = -1.0;
+  constraints.joint_constraints[0].tolerance_above = 0.1;
+  constraints.joint_constraints[0].tolerance_below = 0.1;
+  constraints.joint_constraints[0].weight = 1.0;
+
+  // the key ignores the name, but not the group or the constraints themselves
+  const std::string key = ompl_interface::ConstrainedStatePool::getKey("right_arm", constraints);
+  moveit_msgs::Constraints renamed = constraints;
+  renamed.name = "other";
+  EXPECT_EQ(key, ompl_interface::ConstrainedStatePool::getKey("right_arm", renamed));
+  EXPECT_NE(key, ompl_interface::ConstrainedStatePool::getKey("left_arm", constraints));
+  moveit_msgs::Constraints moved = constraints;
+  moved.joint_constraints[0].position = -1.2;
+  EXPECT_NE(key, ompl_interface::ConstrainedStatePool::getKey("right_arm", moved));
+
+  planning_scene::PlanningScenePtr scene(new planning_scene::PlanningScene(robot_model_));
+  constraint_samplers::JointConstraintSamplerPtr sampler(
+      new constraint_samplers::JointConstraintSampler(scene, "right_arm"));
+  ASSERT_TRUE(sampler->configure(constraints));
+  kinematic_constraints::KinematicConstraintSetPtr constraint_set(
+      new kinematic_constraints::KinematicConstraintSet(robot_model_));
+  constraint_set->add(constraints, scene->getTransforms());
+
+  robot_state::RobotState reference(robot_model_);
+  reference.setToDefaultValues();
+  ompl_interface::ConstrainedStatePool pool(50);
+  EXPECT_FALSE(pool.getEntry(key));
+  ompl_interface::ConstrainedStatePool::EntryPtr entry = pool.requestEntry(key, sampler, constraint_set, reference);
+  ASSERT_TRUE(static_cast<bool>(entry));
+  EXPECT_EQ(entry, pool.getEntry(key));
+
+  // the entry fills up in the background
+  for (int i = 0; i < 1000 && entry->isFilling(); ++i)
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(10));
+  EXPECT_FALSE(entry->isFilling());
+  EXPECT_EQ(50u, entry->size());
+
+  ompl::RNG rng;
+  std::vector<double> values;
+  robot_state::RobotState state(reference);
+  const robot_model::JointModelGroup* group = robot_model_->getJointModelGroup("right_arm");
+  for (int i = 0; i < 20; ++i)
+  {
+    ASSERT_TRUE(entry->sample(rng, values));
+    state.setJointGroupPositions(group, values);
+    state.update();
+    EXPECT_TRUE(constraint_set->decide(state).satisfied);
+  }
+
+  // a full entry replaces old states rather than growing
+  entry->add(values);
+  EXPECT_EQ(50u, entry->size());
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);
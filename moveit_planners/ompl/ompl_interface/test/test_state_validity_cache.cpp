@@ -0,0 +1,126 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/ompl_interface/detail/state_validity_cache.h>
+#include <gtest/gtest.h>
+#include <boost/thread.hpp>
+
+using ompl_interface::StateValidityCache;
+
+TEST(StateValidityCache, StoreAndLookup)
+{
+  StateValidityCache cache(3, 100, 1e-3);
+  EXPECT_EQ(cache.getSize(), 128u);
+
+  const double a[3] = { 0.1, 0.2, 0.3 };
+  StateValidityCache::Result result;
+  EXPECT_FALSE(cache.lookup(a, result));
+
+  result.validity_known = true;
+  result.valid = true;
+  cache.store(a, result);
+
+  StateValidityCache::Result found;
+  ASSERT_TRUE(cache.lookup(a, found));
+  EXPECT_TRUE(found.validity_known);
+  EXPECT_TRUE(found.valid);
+  EXPECT_FALSE(found.distance_known);
+
+  // results of the same state are merged
+  StateValidityCache::Result distance;
+  distance.distance_known = true;
+  distance.distance = 0.5;
+  cache.store(a, distance);
+  ASSERT_TRUE(cache.lookup(a, found));
+  EXPECT_TRUE(found.validity_known);
+  EXPECT_TRUE(found.distance_known);
+  EXPECT_DOUBLE_EQ(found.distance, 0.5);
+
+  // states closer than the resolution share their results, others do not
+  const double near_a[3] = { 0.1 + 1e-4, 0.2, 0.3 };
+  const double far_a[3] = { 0.1 + 1e-2, 0.2, 0.3 };
+  EXPECT_TRUE(cache.lookup(near_a, found));
+  EXPECT_FALSE(cache.lookup(far_a, found));
+}
+
+TEST(StateValidityCache, Clear)
+{
+  StateValidityCache cache(2, 16, 1e-6);
+  const double a[2] = { -1.0, 1.0 };
+  StateValidityCache::Result result;
+  result.validity_known = true;
+  cache.store(a, result);
+  EXPECT_TRUE(cache.lookup(a, result));
+  cache.clear();
+  EXPECT_FALSE(cache.lookup(a, result));
+}
+
+TEST(StateValidityCache, Bounded)
+{
+  // a single slot only remembers the last state
+  StateValidityCache cache(1, 1, 1e-6);
+  const double a[1] = { 1.0 };
+  const double b[1] = { 2.0 };
+  StateValidityCache::Result result;
+  result.validity_known = true;
+  cache.store(a, result);
+  cache.store(b, result);
+  EXPECT_FALSE(cache.lookup(a, result));
+  EXPECT_TRUE(cache.lookup(b, result));
+}
+
+TEST(StateValidityCache, PerThread)
+{
+  StateValidityCache cache(1, 16, 1e-6);
+  const double a[1] = { 1.0 };
+  StateValidityCache::Result result;
+  result.validity_known = true;
+  cache.store(a, result);
+
+  bool found_in_other_thread = true;
+  boost::thread other([&]() {
+    StateValidityCache::Result r;
+    found_in_other_thread = cache.lookup(a, r);
+  });
+  other.join();
+  EXPECT_FALSE(found_in_other_thread);
+  EXPECT_TRUE(cache.lookup(a, result));
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -57,6 +57,7 @@
 #include <moveit_msgs/GetMotionPlan.h>
 
 #include <Eigen/Core>
+#include <boost/thread.hpp>
 
 static const double DEFAULT_INTERPOLATION_DISTANCE = .05;
 static const double DEFAULT_JOINT_MOTION_PRIMITIVE_DISTANCE = .2;
@@ -84,6 +85,10 @@ struct PlanningParameters
     , attempt_full_shortcut_(true)
     , interpolation_distance_(DEFAULT_INTERPOLATION_DISTANCE)
     , joint_motion_primitive_distance_(DEFAULT_JOINT_MOTION_PRIMITIVE_DISTANCE)
+    , expansion_threads_(std::max(1u, boost::thread::hardware_concurrency()))
+    , initial_epsilon_(100.0)
+    , search_until_first_solution_(true)
+    , allowed_planning_time_(10.0)
   {
   }
 
@@ -92,8 +97,46 @@ struct PlanningParameters
   bool attempt_full_shortcut_;
   double interpolation_distance_;
   double joint_motion_primitive_distance_;
+  /// Number of threads checking the validity of the successors of an expanded state
+  unsigned int expansion_threads_;
+  /// Suboptimality bound of the first solution of ARA*
+  double initial_epsilon_;
+  /// Return the first solution instead of decreasing epsilon for the rest of the allowed time
+  bool search_until_first_solution_;
+  /// Time (in seconds) ARA* may search for
+  double allowed_planning_time_;
 };
 
+/** \brief Keeps the BFS searches of recent planning requests. A request whose grid has the same walls and whose goal
+    falls in the same cell reuses the (possibly still running) search instead of starting a new one. */
+class BFSHeuristicCache
+{
+public:
+  BFSHeuristicCache(std::size_t capacity = 4) : capacity_(capacity)
+  {
+  }
+
+  /** \brief Get the search for a grid of size \e dim_x x \e dim_y x \e dim_z whose wall cells are \e walls (as
+      [x, y, z] triples), towards \e goal_xyz. The search is started if it is not cached. */
+  boost::shared_ptr<BFS_3D> getSearch(int dim_x, int dim_y, int dim_z, const std::vector<int>& walls,
+                                      const int (&goal_xyz)[3]);
+
+private:
+  struct Entry
+  {
+    int dims_[3];
+    int goal_[3];
+    std::vector<int> walls_;
+    boost::shared_ptr<BFS_3D> bfs_;
+  };
+
+  boost::mutex lock_;
+  std::size_t capacity_;
+  std::list<Entry> entries_;  // most recently used first
+};
+
+typedef boost::shared_ptr<BFSHeuristicCache> BFSHeuristicCachePtr;
+
 /** Environment to be used when planning for a Robotic Arm using the SBPL. */
 class EnvironmentChain3D : public DiscreteSpaceInformation
 {
@@ -234,6 +277,12 @@ public:
     return goal_pose_;
   }
 
+  /** \brief Share BFS searches with other environments through \e cache. Must be called before setupForMotionPlan() */
+  void setBFSHeuristicCache(const BFSHeuristicCachePtr& cache)
+  {
+    bfs_cache_ = cache;
+  }
+
   void attemptShortcut(const trajectory_msgs::JointTrajectory& traj_in, trajectory_msgs::JointTrajectory& traj_out);
 
 protected:
@@ -243,8 +292,36 @@ protected:
 
   planning_scene::PlanningSceneConstPtr planning_scene_;
 
+  /** \brief A successor generated while expanding a state, and the outcome of its validity check */
+  struct SuccessorCandidate
+  {
+    unsigned int action_;
+    std::vector<double> angles_;
+    bool valid_;
+    int xyz_[3];
+  };
+
+  /** \brief The state a thread uses to check successors, so that threads do not share robot states */
+  struct ExpansionWorkspace
+  {
+    ExpansionWorkspace(const planning_models::RobotState& state, const std::string& group,
+                       const std::string& tip_link);
+
+    planning_models::RobotState state_;
+    planning_models::RobotState::JointStateGroup* joint_state_group_;
+    const planning_models::RobotState::LinkState* tip_link_state_;
+    boost::shared_ptr<collision_detection::GroupStateRepresentation> gsr_;
+  };
+
+  /** \brief Check path constraints and collisions for \e candidates [begin, end) using \e workspace, and compute
+      the grid cell of the tip of the valid ones */
+  void checkSuccessors(std::vector<SuccessorCandidate>& candidates, std::size_t begin, std::size_t end,
+                       ExpansionWorkspace& workspace) const;
+
   double angle_discretization_;
-  BFS_3D* bfs_;
+  boost::shared_ptr<BFS_3D> bfs_;
+  BFSHeuristicCachePtr bfs_cache_;
+  std::vector<boost::shared_ptr<ExpansionWorkspace> > expansion_workspaces_;
 
   std::vector<boost::shared_ptr<JointMotionWrapper> > joint_motion_wrappers_;
   std::vector<boost::shared_ptr<JointMotionPrimitive> > possible_actions_;
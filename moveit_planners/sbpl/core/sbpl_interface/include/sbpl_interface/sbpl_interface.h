@@ -45,7 +45,10 @@ namespace sbpl_interface
 class SBPLInterface
 {
 public:
-  SBPLInterface(const planning_models::RobotModelConstPtr& kmodel)
+  /** \brief Construct the interface; several interfaces may share the BFS heuristics they computed through \e cache */
+  SBPLInterface(const planning_models::RobotModelConstPtr& kmodel,
+                const BFSHeuristicCachePtr& cache = BFSHeuristicCachePtr())
+    : bfs_cache_(cache ? cache : BFSHeuristicCachePtr(new BFSHeuristicCache()))
   {
   }
   virtual ~SBPLInterface()
@@ -64,6 +67,9 @@ public:
 protected:
   PlanningStatistics last_planning_statistics_;
 
+  /// BFS heuristics of previous requests; repeated tasks in an unchanged world reuse them
+  BFSHeuristicCachePtr bfs_cache_;
+
   // DummyEnvironment* dummy_env_;
   // SBPLPlanner *planner_;
 };
@@ -40,17 +40,48 @@
 #include <moveit_msgs/GetMotionPlan.h>
 #include <sbpl_interface/sbpl_interface.h>
 #include <boost/thread.hpp>
+#include <boost/function.hpp>
 
 namespace sbpl_interface
 {
+/** \brief Runs a portfolio of search configurations concurrently and returns the solution of one of them. All the
+    configurations share their BFS heuristics. */
 class SBPLMetaInterface
 {
 public:
+  /** \brief Called with the index of the configuration that found the first solution, and that solution. It is
+      called from the thread of that configuration, before solve() returns. */
+  typedef boost::function<void(std::size_t, const moveit_msgs::GetMotionPlan::Response&)> SolutionCallback;
+
   SBPLMetaInterface(const planning_models::RobotModelConstPtr& kmodel);
   virtual ~SBPLMetaInterface()
   {
   }
 
+  /** \brief Set the configurations solve() runs concurrently. By default these are ARA* with and without the BFS
+      heuristic. */
+  void setConfigurations(const std::vector<PlanningParameters>& configurations);
+
+  const std::vector<PlanningParameters>& getConfigurations() const
+  {
+    return configurations_;
+  }
+
+  /** \brief Set the callback notified of the first solution of each solve() call */
+  void setFirstSolutionCallback(const SolutionCallback& callback)
+  {
+    first_solution_callback_ = callback;
+  }
+
+  /** \brief By default solve() returns the first solution found and interrupts the other configurations. If \e wait
+      is true, it waits for all of them, until the allowed planning time is over, and returns the shortest solution. */
+  void setWaitForAllConfigurations(bool wait)
+  {
+    wait_for_all_configurations_ = wait;
+  }
+
+  /** \brief Solve the request with all configurations; none of them searches past the allowed planning time of the
+      request (or 10 seconds, if none is set) */
   bool solve(const planning_scene::PlanningSceneConstPtr& planning_scene,
              const moveit_msgs::GetMotionPlan::Request& req, moveit_msgs::GetMotionPlan::Response& res);
 
@@ -60,19 +91,11 @@ public:
   }
 
 protected:
-  void runSolver(bool use_first, const planning_scene::PlanningSceneConstPtr& planning_scene,
-                 const moveit_msgs::GetMotionPlan::Request& req, moveit_msgs::GetMotionPlan::Response& res,
-                 const PlanningParameters& params);
-
-  boost::mutex planner_done_mutex_;
-  boost::condition_variable planner_done_condition_;
-  bool first_ok_;
-  bool first_done_;
-  bool second_ok_;
-  bool second_done_;
-
-  boost::shared_ptr<sbpl_interface::SBPLInterface> sbpl_interface_first_;
-  boost::shared_ptr<sbpl_interface::SBPLInterface> sbpl_interface_second_;
+  planning_models::RobotModelConstPtr kmodel_;
+  std::vector<PlanningParameters> configurations_;
+  BFSHeuristicCachePtr bfs_cache_;
+  SolutionCallback first_solution_callback_;
+  bool wait_for_all_configurations_;
 
   PlanningStatistics last_planning_statistics_;
 };
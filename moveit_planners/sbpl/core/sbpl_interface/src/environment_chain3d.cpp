@@ -37,6 +37,7 @@
 #include <sbpl_interface/environment_chain3d.h>
 #include <collision_detection/collision_common.h>
 #include <planning_models/conversions.h>
+#include <boost/bind.hpp>
 #include <boost/timer.hpp>
 #include <planning_models/angle_utils.h>
 
@@ -49,7 +50,6 @@ namespace sbpl_interface
 {
 EnvironmentChain3D::EnvironmentChain3D(const planning_scene::PlanningSceneConstPtr& planning_scene)
   : planning_scene_(planning_scene)
-  , bfs_(NULL)
   , state_(planning_scene->getCurrentState())
   , planning_data_(StateID2IndexMapping)
   , goal_constraint_set_(planning_scene->getRobotModel(), planning_scene->getTransforms())
@@ -63,10 +63,52 @@ EnvironmentChain3D::EnvironmentChain3D(const planning_scene::PlanningSceneConstP
 
 EnvironmentChain3D::~EnvironmentChain3D()
 {
-  if (bfs_ != NULL)
+}
+
+EnvironmentChain3D::ExpansionWorkspace::ExpansionWorkspace(const planning_models::RobotState& state,
+                                                           const std::string& group, const std::string& tip_link)
+  : state_(state)
+{
+  joint_state_group_ = state_.getJointStateGroup(group);
+  tip_link_state_ = state_.getLinkState(tip_link);
+}
+
+boost::shared_ptr<BFS_3D> BFSHeuristicCache::getSearch(int dim_x, int dim_y, int dim_z, const std::vector<int>& walls,
+                                                       const int (&goal_xyz)[3])
+{
+  boost::mutex::scoped_lock slock(lock_);
+  for (std::list<Entry>::iterator it = entries_.begin(); it != entries_.end(); ++it)
   {
-    delete bfs_;
+    if (it->dims_[0] == dim_x && it->dims_[1] == dim_y && it->dims_[2] == dim_z && it->goal_[0] == goal_xyz[0] &&
+        it->goal_[1] == goal_xyz[1] && it->goal_[2] == goal_xyz[2] && it->walls_ == walls)
+    {
+      entries_.splice(entries_.begin(), entries_, it);
+      ROS_DEBUG_STREAM("Reusing cached BFS heuristic");
+      return entries_.front().bfs_;
+    }
+  }
+
+  Entry entry;
+  entry.dims_[0] = dim_x;
+  entry.dims_[1] = dim_y;
+  entry.dims_[2] = dim_z;
+  entry.goal_[0] = goal_xyz[0];
+  entry.goal_[1] = goal_xyz[1];
+  entry.goal_[2] = goal_xyz[2];
+  entry.walls_ = walls;
+  entry.bfs_.reset(new BFS_3D(dim_x, dim_y, dim_z));
+  for (std::size_t i = 0; i + 2 < walls.size(); i += 3)
+  {
+    entry.bfs_->setWall(walls[i], walls[i + 1], walls[i + 2]);
   }
+  entry.bfs_->run(goal_xyz[0], goal_xyz[1], goal_xyz[2]);
+
+  entries_.push_front(entry);
+  if (entries_.size() > capacity_)
+  {
+    entries_.pop_back();
+  }
+  return entries_.front().bfs_;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -177,7 +219,6 @@ void EnvironmentChain3D::GetSuccs(int source_state_ID, std::vector<int>* succ_id
   // convertCoordToJointAngles(hash_entry->coord, source_joint_angles);
 
   std::vector<int> succ_coord;
-  std::vector<double> succ_joint_angles;
 
   // for(unsigned int i = 0; i < source_joint_angles.size(); i++) {
   //   std::cerr << "Source " << i << " " << source_joint_angles[i] << std::endl;
@@ -185,98 +226,55 @@ void EnvironmentChain3D::GetSuccs(int source_state_ID, std::vector<int>* succ_id
 
   planning_statistics_.total_expansions_++;
 
+  // generate all successors first, so that their validity can be checked in parallel
+  std::vector<SuccessorCandidate> candidates;
+  candidates.reserve(possible_actions_.size());
   for (unsigned int i = 0; i < possible_actions_.size(); i++)
   {
-    if (!possible_actions_[i]->generateSuccessorState(source_joint_angles, succ_joint_angles))
+    SuccessorCandidate candidate;
+    if (!possible_actions_[i]->generateSuccessorState(source_joint_angles, candidate.angles_))
     {
       continue;
     }
+    candidate.action_ = i;
+    candidates.push_back(candidate);
+  }
 
-    // for(unsigned int j = 0; j < planning_data_.goal_hash_entry_->angles.size(); j++) {
-    //   if(joint_is_continuous_[j]) {
-    //     if(source_joint_angles[j] < M_PI && succ_joint_angles[j] > M_PI) {
-    //       succ_joint_angles[j] -= 2*M_PI;
-    //     } else if(source_joint_angles[j] > -M_PI && succ_joint_angles[j] < -M_PI) {
-    //       succ_joint_angles[j] += 2*M_PI;
-    //     }
-    //   }
-    // }
-    // double dist = 0.0;
-    // for(unsigned int j = 0; j < planning_data_.goal_hash_entry_->angles.size(); j++) {
-    //   dist += fabs(planning_data_.goal_hash_entry_->angles[j]-succ_joint_angles[j]);
-    //   //std::cerr << "Succ " << i << " " << j << " " << succ_joint_angles[j] << std::endl;
-    // }
-    // if(dist < closest_to_goal_) {
-    //   //std::cerr << "Got dist " << dist << std::endl;
-    //   closest_to_goal_ = dist;
-    // }
-
-    // int max_dist = getJointDistanceIntegerMax(succ_joint_angles,
-    //                                           planning_data_.goal_hash_entry_->angles);
-    // if(max_dist*1.0 < closest_to_goal_) {
-    //   std::cerr << "Max integer distance is " << max_dist << std::endl;
-    //   closest_to_goal_ = max_dist*1.0;
-    //   // for(unsigned int j = 0; j < joint_motion_wrappers_.size(); j++) {
-    //   //   if(joint_motion_wrappers_[j]->canGetCloser(succ_joint_angles[j],
-    //   //                                              planning_data_.goal_hash_entry_->angles[j],
-    //   //                                              LONG_RANGE_JOINT_DIFF)) {
-    //   //     std::cerr << "Joint " << j << " succ " << succ_joint_angles[j] << " "
-    //   //               << planning_data_.goal_hash_entry_->angles[j] << " can get closer\n";
-    //   //     break;
-    //   //   }
-    //   // }
-    // }
-    convertJointAnglesToCoord(succ_joint_angles, succ_coord);
-
-    joint_state_group_->setStateValues(succ_joint_angles);
-
-    kinematic_constraints::ConstraintEvaluationResult con_res = path_constraint_set_.decide(state_);
-    if (!con_res.satisfied)
+  ros::WallTime before_coll = ros::WallTime::now();
+  std::size_t num_threads = std::min<std::size_t>(expansion_workspaces_.size(), candidates.size());
+  if (num_threads <= 1)
+  {
+    checkSuccessors(candidates, 0, candidates.size(), *expansion_workspaces_[0]);
+  }
+  else
+  {
+    // the calling thread checks the first chunk itself
+    boost::thread_group threads;
+    std::size_t chunk = (candidates.size() + num_threads - 1) / num_threads;
+    for (std::size_t t = 1; t < num_threads; ++t)
     {
-      ROS_INFO_STREAM("State violates path constraints");
+      std::size_t begin = std::min(candidates.size(), t * chunk);
+      std::size_t end = std::min(candidates.size(), begin + chunk);
+      threads.create_thread(boost::bind(&EnvironmentChain3D::checkSuccessors, this, boost::ref(candidates), begin,
+                                        end, boost::ref(*expansion_workspaces_[t])));
     }
+    checkSuccessors(candidates, 0, std::min(candidates.size(), chunk), *expansion_workspaces_[0]);
+    threads.join_all();
+  }
+  planning_statistics_.coll_checks_ += candidates.size();
+  planning_statistics_.total_coll_check_time_ += ros::WallTime::now() - before_coll;
 
-    // if(!joint_state_group_->satisfiesBounds()) {
-    //   std::cerr << "ERROR - successor doesn't satisfy bounds" << std::endl;
-    //   //std::cerr << "Successor doesn't satisfy bounds" << std::endl;
-    //   continue;
-    // }
-    ros::WallTime before_coll = ros::WallTime::now();
-    collision_detection::CollisionRequest req;
-    collision_detection::CollisionResult res;
-    req.group_name = planning_group_;
-    if (!planning_parameters_.use_standard_collision_checking_)
-    {
-      hy_world_->checkCollisionDistanceField(req, res, *hy_robot_->getCollisionRobotDistanceField().get(), state_,
-                                             gsr_);
-    }
-    else
-    {
-      planning_scene_->checkCollision(req, res, state_);
-    }
-    planning_statistics_.coll_checks_++;
-    // std::cerr << "Elapsed " << t.elapsed() << std::endl;
-    ros::WallDuration dur(ros::WallTime::now() - before_coll);
-    // std::cerr << dur.toSec() << std::endl;
-    // ROS_DEBUG_STREAM("Time " << ros::WallTime::now()-before_coll);
-    planning_statistics_.total_coll_check_time_ += dur;
-    if (res.collision)
+  for (std::size_t c = 0; c < candidates.size(); c++)
+  {
+    if (!candidates[c].valid_)
     {
-      // std::cerr << "Successor in collision" << std::endl;
       continue;
     }
+    const unsigned int i = candidates[c].action_;
+    const std::vector<double>& succ_joint_angles = candidates[c].angles_;
+    const int(&xyz)[3] = candidates[c].xyz_;
+    convertJointAnglesToCoord(succ_joint_angles, succ_coord);
 
-    Eigen::Affine3d pose = tip_link_state_->getGlobalLinkTransform();
-
-    int xyz[3];
-    if (!planning_parameters_.use_standard_collision_checking_)
-    {
-      if (!getGridXYZInt(pose, xyz))
-      {
-        std::cerr << "Can't get successor x y z" << std::endl;
-        continue;
-      }
-    }
     int dist;
     if (planning_parameters_.use_bfs_)
     {
@@ -395,6 +393,52 @@ void EnvironmentChain3D::GetSuccs(int source_state_ID, std::vector<int>* succ_id
   planning_statistics_.total_expansion_time_ += ros::WallTime::now() - expansion_start_time;
 }
 
+void EnvironmentChain3D::checkSuccessors(std::vector<SuccessorCandidate>& candidates, std::size_t begin,
+                                         std::size_t end, ExpansionWorkspace& workspace) const
+{
+  collision_detection::CollisionRequest req;
+  req.group_name = planning_group_;
+  for (std::size_t c = begin; c < end; c++)
+  {
+    SuccessorCandidate& candidate = candidates[c];
+    candidate.valid_ = false;
+    candidate.xyz_[0] = candidate.xyz_[1] = candidate.xyz_[2] = 0;
+
+    workspace.joint_state_group_->setStateValues(candidate.angles_);
+
+    kinematic_constraints::ConstraintEvaluationResult con_res = path_constraint_set_.decide(workspace.state_);
+    if (!con_res.satisfied)
+    {
+      ROS_INFO_STREAM("State violates path constraints");
+    }
+
+    collision_detection::CollisionResult res;
+    if (!planning_parameters_.use_standard_collision_checking_)
+    {
+      hy_world_->checkCollisionDistanceField(req, res, *hy_robot_->getCollisionRobotDistanceField().get(),
+                                             workspace.state_, workspace.gsr_);
+    }
+    else
+    {
+      planning_scene_->checkCollision(req, res, workspace.state_);
+    }
+    if (res.collision)
+    {
+      continue;
+    }
+
+    if (!planning_parameters_.use_standard_collision_checking_)
+    {
+      if (!getGridXYZInt(workspace.tip_link_state_->getGlobalLinkTransform(), candidate.xyz_))
+      {
+        std::cerr << "Can't get successor x y z" << std::endl;
+        continue;
+      }
+    }
+    candidate.valid_ = true;
+  }
+}
+
 void EnvironmentChain3D::GetPreds(int TargetStateID, vector<int>* PredIDV, vector<int>* cost_v)
 {
   std::cerr << ("ERROR in EnvChain... function: GetPreds is undefined\n");
@@ -467,6 +511,12 @@ bool EnvironmentChain3D::setupForMotionPlan(const planning_scene::PlanningSceneC
   interpolation_joint_state_group_2_ = interpolation_state_2_.getJointStateGroup(planning_group_);
   interpolation_joint_state_group_temp_ = interpolation_state_temp_.getJointStateGroup(planning_group_);
   tip_link_state_ = state_.getLinkState(joint_state_group_->getJointModelGroup()->getLinkModelNames().back());
+  expansion_workspaces_.clear();
+  for (unsigned int i = 0; i < std::max(1u, planning_parameters_.expansion_threads_); i++)
+  {
+    expansion_workspaces_.push_back(boost::shared_ptr<ExpansionWorkspace>(
+        new ExpansionWorkspace(state_, planning_group_, tip_link_state_->getName())));
+  }
 
   collision_detection::CollisionRequest req;
   collision_detection::CollisionResult res;
@@ -501,11 +551,10 @@ bool EnvironmentChain3D::setupForMotionPlan(const planning_scene::PlanningSceneC
   {
     planning_parameters_.use_bfs_ = false;
   }
+  // wall cells of the BFS grid, as [x, y, z] triples
+  std::vector<int> bfs_walls;
   if (!planning_parameters_.use_standard_collision_checking_ && planning_parameters_.use_bfs_)
   {
-    bfs_ = new BFS_3D(gsr_->dfce_->distance_field_->getXNumCells(), gsr_->dfce_->distance_field_->getYNumCells(),
-                      gsr_->dfce_->distance_field_->getZNumCells());
-
     boost::shared_ptr<const distance_field::DistanceField> world_distance_field =
         hy_world_->getCollisionWorldDistanceField()->getDistanceField();
     if (world_distance_field->getXNumCells() != gsr_->dfce_->distance_field_->getXNumCells() ||
@@ -532,7 +581,9 @@ bool EnvironmentChain3D::setupForMotionPlan(const planning_scene::PlanningSceneC
           if (gsr_->dfce_->distance_field_->getDistanceFromCell(i + 1, j + 1, k + 1) == 0.0 ||
               world_distance_field->getDistanceFromCell(i + 1, j + 1, k + 1) == 0.0)
           {
-            bfs_->setWall(i + 1, j + 1, k + 1);
+            bfs_walls.push_back(i + 1);
+            bfs_walls.push_back(j + 1);
+            bfs_walls.push_back(k + 1);
             wall_count++;
           }
         }
@@ -627,7 +678,22 @@ bool EnvironmentChain3D::setupForMotionPlan(const planning_scene::PlanningSceneC
   // std::cerr << "Running bfs with goal " << goal_xyz[0] << " " <<  goal_xyz[1] << " " << goal_xyz[2] << std::endl;
   if (planning_parameters_.use_bfs_)
   {
-    bfs_->run(goal_xyz[0], goal_xyz[1], goal_xyz[2]);
+    int dim_x = gsr_->dfce_->distance_field_->getXNumCells();
+    int dim_y = gsr_->dfce_->distance_field_->getYNumCells();
+    int dim_z = gsr_->dfce_->distance_field_->getZNumCells();
+    if (bfs_cache_)
+    {
+      bfs_ = bfs_cache_->getSearch(dim_x, dim_y, dim_z, bfs_walls, goal_xyz);
+    }
+    else
+    {
+      bfs_.reset(new BFS_3D(dim_x, dim_y, dim_z));
+      for (std::size_t i = 0; i + 2 < bfs_walls.size(); i += 3)
+      {
+        bfs_->setWall(bfs_walls[i], bfs_walls[i + 1], bfs_walls[i + 2]);
+      }
+      bfs_->run(goal_xyz[0], goal_xyz[1], goal_xyz[2]);
+    }
     // std::cerr << "Got start " << start_xyz[0] << " " <<  start_xyz[1] << " " << start_xyz[2] << " cost "
     //           << getBFSCostToGoal(start_xyz[0], start_xyz[1], start_xyz[2]) << std::endl;
   }
@@ -50,6 +50,7 @@ bool SBPLInterface::solve(const planning_scene::PlanningSceneConstPtr& planning_
 
   ros::WallTime wt = ros::WallTime::now();
   boost::shared_ptr<EnvironmentChain3D> env_chain(new EnvironmentChain3D(planning_scene));
+  env_chain->setBFSHeuristicCache(bfs_cache_);
   if (!env_chain->setupForMotionPlan(planning_scene, req, res, params))
   {
     // std::cerr << "Env chain setup failing" << std::endl;
@@ -61,8 +62,8 @@ bool SBPLInterface::solve(const planning_scene::PlanningSceneConstPtr& planning_
 
   // DummyEnvironment* dummy_env = new DummyEnvironment();
   boost::shared_ptr<ARAPlanner> planner(new ARAPlanner(env_chain.get(), true));
-  planner->set_initialsolution_eps(100.0);
-  planner->set_search_mode(true);
+  planner->set_initialsolution_eps(params.initial_epsilon_);
+  planner->set_search_mode(params.search_until_first_solution_);
   planner->force_planning_from_scratch();
   planner->set_start(env_chain->getPlanningData().start_hash_entry_->stateID);
   planner->set_goal(env_chain->getPlanningData().goal_hash_entry_->stateID);
@@ -71,7 +72,7 @@ bool SBPLInterface::solve(const planning_scene::PlanningSceneConstPtr& planning_
   int solution_cost;
   wt = ros::WallTime::now();
   // CALLGRIND_START_INSTRUMENTATION;
-  bool b_ret = planner->replan(10.0, &solution_state_ids, &solution_cost);
+  bool b_ret = planner->replan(params.allowed_planning_time_, &solution_state_ids, &solution_cost);
   // CALLGRIND_STOP_INSTRUMENTATION;
   double el = (ros::WallTime::now() - wt).toSec();
   std::cerr << "B ret is " << b_ret << " planning time " << el << std::endl;
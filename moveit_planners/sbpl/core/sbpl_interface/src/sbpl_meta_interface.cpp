@@ -35,139 +35,168 @@
 #include <sbpl_interface/sbpl_meta_interface.h>
 #include <sbpl_interface/sbpl_interface.h>
 #include <planning_models/conversions.h>
+#include <cmath>
 
 namespace sbpl_interface
 {
-SBPLMetaInterface::SBPLMetaInterface(const planning_models::RobotModelConstPtr& kmodel)
+namespace
+{
+/* The state of one solve() call, shared with the threads of its configurations. Configurations that are interrupted
+   or still searching when solve() returns keep it alive until they end. */
+struct PortfolioRun
 {
-  sbpl_interface_first_.reset(new sbpl_interface::SBPLInterface(kmodel));
-  sbpl_interface_second_.reset(new sbpl_interface::SBPLInterface(kmodel));
+  PortfolioRun(std::size_t size)
+    : responses_(size), statistics_(size), done_(size, 0), ok_(size, 0), finished_(0), first_solution_(-1)
+  {
+  }
+
+  boost::mutex lock_;
+  boost::condition_variable done_condition_;
+  std::vector<moveit_msgs::GetMotionPlan::Response> responses_;
+  std::vector<PlanningStatistics> statistics_;
+  std::vector<char> done_;
+  std::vector<char> ok_;
+  std::size_t finished_;
+  int first_solution_;
+};
+
+void runConfiguration(const boost::shared_ptr<PortfolioRun>& run, std::size_t index,
+                      const boost::shared_ptr<SBPLInterface>& sbpl_interface,
+                      const planning_scene::PlanningSceneConstPtr& planning_scene,
+                      const moveit_msgs::GetMotionPlan::Request& req, const PlanningParameters& params,
+                      const SBPLMetaInterface::SolutionCallback& callback)
+{
+  moveit_msgs::GetMotionPlan::Response res;
+  bool ok = false;
+  try
+  {
+    ok = sbpl_interface->solve(planning_scene, req, res, params);
+  }
+  catch (...)
+  {
+    ROS_DEBUG_NAMED("sbpl_meta_interface", "Configuration %u was interrupted", (unsigned int)index);
+  }
+
+  bool first = false;
+  {
+    boost::mutex::scoped_lock slock(run->lock_);
+    run->responses_[index] = res;
+    run->statistics_[index] = sbpl_interface->getLastPlanningStatistics();
+    run->ok_[index] = ok;
+    run->done_[index] = 1;
+    ++run->finished_;
+    if (ok && run->first_solution_ < 0)
+    {
+      run->first_solution_ = index;
+      first = true;
+    }
+  }
+  run->done_condition_.notify_all();
+  if (first && callback)
+    callback(index, res);
 }
 
-bool SBPLMetaInterface::solve(const planning_scene::PlanningSceneConstPtr& planning_scene,
-                              const moveit_msgs::GetMotionPlan::Request& req, moveit_msgs::GetMotionPlan::Response& res)
+double getPathLength(const trajectory_msgs::JointTrajectory& trajectory)
 {
-  first_ok_ = false;
-  first_done_ = false;
-  second_ok_ = false;
-  second_done_ = false;
+  double length = 0.0;
+  for (std::size_t i = 1; i < trajectory.points.size(); ++i)
+    for (std::size_t j = 0; j < trajectory.points[i].positions.size(); ++j)
+      length += fabs(trajectory.points[i].positions[j] - trajectory.points[i - 1].positions[j]);
+  return length;
+}
+}
 
+SBPLMetaInterface::SBPLMetaInterface(const planning_models::RobotModelConstPtr& kmodel)
+  : kmodel_(kmodel), bfs_cache_(new BFSHeuristicCache()), wait_for_all_configurations_(false)
+{
   PlanningParameters param_bfs;
   param_bfs.use_bfs_ = true;
   PlanningParameters param_no_bfs;
   param_no_bfs.use_bfs_ = false;
-  moveit_msgs::GetMotionPlan::Response res1, res2;
-  boost::thread thread1(boost::bind(&SBPLMetaInterface::runSolver, this, true, boost::cref(planning_scene),
-                                    boost::cref(req), boost::ref(res1), param_bfs));
-  boost::thread thread2(boost::bind(&SBPLMetaInterface::runSolver, this, false, boost::cref(planning_scene),
-                                    boost::cref(req), boost::ref(res2), param_no_bfs));
-  boost::mutex::scoped_lock lock(planner_done_mutex_);
-  planner_done_condition_.wait(lock);
+  configurations_.push_back(param_bfs);
+  configurations_.push_back(param_no_bfs);
+}
 
-  if (first_done_)
+void SBPLMetaInterface::setConfigurations(const std::vector<PlanningParameters>& configurations)
+{
+  if (configurations.empty())
+    ROS_WARN_NAMED("sbpl_meta_interface", "No search configurations given; keeping the previous ones");
+  else
+    configurations_ = configurations;
+}
+
+bool SBPLMetaInterface::solve(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                              const moveit_msgs::GetMotionPlan::Request& req, moveit_msgs::GetMotionPlan::Response& res)
+{
+  double allowed_time = req.motion_plan_request.allowed_planning_time.toSec();
+  if (allowed_time <= 0.0)
+    allowed_time = 10.0;
+  boost::system_time deadline = boost::get_system_time() + boost::posix_time::microseconds(allowed_time * 1e6);
+
+  // the interfaces are created for every call, as interrupted configurations may still be using their previous ones
+  boost::shared_ptr<PortfolioRun> run(new PortfolioRun(configurations_.size()));
+  std::vector<boost::shared_ptr<boost::thread> > threads(configurations_.size());
+  for (std::size_t i = 0; i < configurations_.size(); ++i)
   {
-    std::cerr << "FIRST DONE" << std::endl;
-    if (first_ok_)
-    {
-      std::cerr << "First ok, interrupting second" << std::endl;
-      if (!second_done_)
-      {
-        thread2.interrupt();
-        thread2.join();
-      }
-    }
-    else
-    {
-      if (!second_done_)
-      {
-        planner_done_condition_.wait(lock);
-      }
-    }
+    PlanningParameters params = configurations_[i];
+    params.allowed_planning_time_ = std::min(params.allowed_planning_time_, allowed_time);
+    boost::shared_ptr<SBPLInterface> sbpl_interface(new SBPLInterface(kmodel_, bfs_cache_));
+    threads[i].reset(new boost::thread(boost::bind(&runConfiguration, run, i, sbpl_interface, planning_scene, req,
+                                                   params, first_solution_callback_)));
   }
-  if (second_done_)
+
+  int chosen = -1;
   {
-    std::cerr << "Second done" << std::endl;
-    if (second_ok_)
-    {
-      std::cerr << "Second ok, interrupting first" << std::endl;
-      if (!first_done_)
+    boost::mutex::scoped_lock slock(run->lock_);
+    while (run->finished_ < configurations_.size() &&
+           (run->first_solution_ < 0 || wait_for_all_configurations_))
+      if (!run->done_condition_.timed_wait(slock, deadline))
       {
-        thread1.interrupt();
-        thread1.join();
+        ROS_DEBUG_NAMED("sbpl_meta_interface", "Allowed planning time of %f seconds is over", allowed_time);
+        break;
       }
-    }
-    else
+
+    if (wait_for_all_configurations_)
     {
-      if (!first_done_)
-      {
-        planner_done_condition_.wait(lock);
-      }
+      for (std::size_t i = 0; i < configurations_.size(); ++i)
+        if (run->ok_[i] && (chosen < 0 || getPathLength(run->responses_[i].trajectory.joint_trajectory) <
+                                              getPathLength(run->responses_[chosen].trajectory.joint_trajectory)))
+          chosen = i;
     }
-  }
-
-  if (!first_ok_ && !second_ok_)
-  {
-    std::cerr << "Both planners failed" << std::endl;
-    res = res1;
-    return false;
-  }
-  if (!first_ok_ && second_ok_)
-  {
-    std::cerr << "Sbpl interface no bfs reports time "
-              << sbpl_interface_second_->getLastPlanningStatistics().total_planning_time_ << std::endl;
-    last_planning_statistics_ = sbpl_interface_second_->getLastPlanningStatistics();
-    res = res2;
-    return true;
-  }
-  else if (first_ok_ && !second_ok_)
-  {
-    std::cerr << "Sbpl interface bfs reports time "
-              << sbpl_interface_first_->getLastPlanningStatistics().total_planning_time_ << std::endl;
-    last_planning_statistics_ = sbpl_interface_first_->getLastPlanningStatistics();
-    res = res1;
-    return true;
-  }
-  std::cerr << "Sbpl interface bfs reports time "
-            << sbpl_interface_first_->getLastPlanningStatistics().total_planning_time_ << std::endl;
-  std::cerr << "Sbpl interface no bfs reports time "
-            << sbpl_interface_second_->getLastPlanningStatistics().total_planning_time_ << std::endl;
-  if (sbpl_interface_first_->getLastPlanningStatistics().total_planning_time_ <
-      sbpl_interface_second_->getLastPlanningStatistics().total_planning_time_)
-  {
-    last_planning_statistics_ = sbpl_interface_first_->getLastPlanningStatistics();
-    res = res1;
-  }
-  else
-  {
-    last_planning_statistics_ = sbpl_interface_second_->getLastPlanningStatistics();
-    res = res2;
-  }
-  return true;
-}
+    else
+      chosen = run->first_solution_;
 
-void SBPLMetaInterface::runSolver(bool use_first, const planning_scene::PlanningSceneConstPtr& planning_scene,
-                                  const moveit_msgs::GetMotionPlan::Request& req,
-                                  moveit_msgs::GetMotionPlan::Response& res, const PlanningParameters& params)
-{
-  try
-  {
-    if (use_first)
+    if (chosen >= 0)
     {
-      std::cerr << "Running first planner" << std::endl;
-      first_ok_ = sbpl_interface_first_->solve(planning_scene, req, res, params);
-      first_done_ = true;
+      ROS_DEBUG_NAMED("sbpl_meta_interface", "Using the solution of configuration %d, found in %f seconds", chosen,
+                      run->statistics_[chosen].total_planning_time_.toSec());
+      res = run->responses_[chosen];
+      last_planning_statistics_ = run->statistics_[chosen];
     }
     else
     {
-      std::cerr << "Running second planner" << std::endl;
-      second_ok_ = sbpl_interface_second_->solve(planning_scene, req, res, params);
-      second_done_ = true;
+      // report the failure of the first configuration that ended, if any did
+      res = moveit_msgs::GetMotionPlan::Response();
+      res.error_code.val = moveit_msgs::MoveItErrorCodes::TIMED_OUT;
+      for (std::size_t i = 0; i < configurations_.size(); ++i)
+        if (run->done_[i])
+        {
+          res = run->responses_[i];
+          break;
+        }
+      last_planning_statistics_ = PlanningStatistics();
     }
-    planner_done_condition_.notify_all();
   }
-  catch (...)
+
+  // configurations still searching are interrupted and not waited for; they do not search past the deadline
+  for (std::size_t i = 0; i < threads.size(); ++i)
   {
-    std::cerr << "Interruption requested\n";
+    threads[i]->interrupt();
+    threads[i]->detach();
   }
+
+  if (chosen < 0)
+    ROS_INFO_NAMED("sbpl_meta_interface", "All %u configurations failed", (unsigned int)configurations_.size());
+  return chosen >= 0;
 }
 }
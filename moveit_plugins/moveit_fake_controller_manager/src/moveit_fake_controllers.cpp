@@ -106,8 +106,33 @@ bool LastPointController::waitForExecution(const ros::Duration&)
 
 ThreadedController::ThreadedController(const std::string& name, const std::vector<std::string>& joints,
                                        const ros::Publisher& pub)
-  : BaseFakeController(name, joints, pub)
+  : BaseFakeController(name, joints, pub), time_scale_(1.0)
+{
+  double s;
+  if (ros::param::get("~fake_execution_time_scale", s))
+  {
+    if (s < 0.0)
+      ROS_WARN("Ignoring negative fake_execution_time_scale %f", s);
+    else
+      time_scale_ = s;
+  }
+}
+
+ros::Duration ThreadedController::executionTime(const ros::Time& start) const
 {
+  return ros::Duration((ros::Time::now() - start).toSec() * time_scale_);
+}
+
+void ThreadedController::sleepUntil(const ros::Time& start, const ros::Duration& time_from_start) const
+{
+  if (asFastAsPossible())
+    return;
+  ros::Duration wait_time((time_from_start - executionTime(start)).toSec() / time_scale_);
+  if (wait_time.toSec() > std::numeric_limits<float>::epsilon())
+  {
+    ROS_DEBUG("Fake execution: waiting %0.1fs for next via point", wait_time.toSec());
+    wait_time.sleep();
+  }
 }
 
 ThreadedController::~ThreadedController()
@@ -178,12 +203,7 @@ void ViaPointController::execTrajectory(const moveit_msgs::RobotTrajectory& t)
     js.velocity = via->velocities;
     js.effort = via->effort;
 
-    ros::Duration waitTime = via->time_from_start - (ros::Time::now() - startTime);
-    if (waitTime.toSec() > std::numeric_limits<float>::epsilon())
-    {
-      ROS_DEBUG("Fake execution: waiting %0.1fs for next via point, %ld remaining", waitTime.toSec(), end - via);
-      waitTime.sleep();
-    }
+    sleepUntil(startTime, via->time_from_start);
     js.header.stamp = ros::Time::now();
     pub_.publish(js);
   }
@@ -196,7 +216,7 @@ InterpolatingController::InterpolatingController(const std::string& name, const
 {
   double r;
   if (ros::param::get("~fake_interpolating_controller_rate", r))
-    rate_ = ros::WallRate(r);
+    rate_ = r;
 }
 
 InterpolatingController::~InterpolatingController()
@@ -232,14 +252,33 @@ void InterpolatingController::execTrajectory(const moveit_msgs::RobotTrajectory&
   js.name = t.joint_trajectory.joint_names;
 
   const std::vector<trajectory_msgs::JointTrajectoryPoint>& points = t.joint_trajectory.points;
+
+  // without waiting there is nothing to interpolate in between: publish the via points one after the other
+  if (asFastAsPossible())
+  {
+    for (std::size_t i = 0; i < points.size() && !cancelled(); ++i)
+    {
+      js.position = points[i].positions;
+      js.header.stamp = ros::Time::now();
+      pub_.publish(js);
+    }
+    ROS_DEBUG("Fake execution of trajectory: done");
+    return;
+  }
+
   std::vector<trajectory_msgs::JointTrajectoryPoint>::const_iterator prev = points.begin(),  // previous via point
       next = points.begin() + 1,  // currently targetted via point
       end = points.end();
 
+  // in simulation, publish at the rate of /clock rather than the wall clock
+  ros::Rate sim_rate(rate_);
+  ros::WallRate wall_rate(rate_);
+  const bool sim_time = ros::Time::isSimTime();
+
   ros::Time startTime = ros::Time::now();
   while (!cancelled())
   {
-    ros::Duration elapsed = ros::Time::now() - startTime;
+    ros::Duration elapsed = executionTime(startTime);
     // hop to next targetted via point
     while (next != end && elapsed > next->time_from_start)
     {
@@ -257,12 +296,15 @@ void InterpolatingController::execTrajectory(const moveit_msgs::RobotTrajectory&
     interpolate(js, *prev, *next, elapsed);
     js.header.stamp = ros::Time::now();
     pub_.publish(js);
-    rate_.sleep();
+    if (sim_time)
+      sim_rate.sleep();
+    else
+      wall_rate.sleep();
   }
   if (cancelled())
     return;
 
-  ros::Duration elapsed = ros::Time::now() - startTime;
+  ros::Duration elapsed = executionTime(startTime);
   ROS_DEBUG("elapsed: %.3f via points %td,%td / %td  alpha: 1.0", elapsed.toSec(), prev - points.begin(),
             next - points.begin(), end - points.begin());
 
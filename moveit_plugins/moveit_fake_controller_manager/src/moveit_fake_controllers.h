@@ -90,6 +90,22 @@ protected:
     return cancel_;
   }
 
+  /// true if trajectories are played back without waiting (~fake_execution_time_scale is 0)
+  bool asFastAsPossible() const
+  {
+    return time_scale_ <= 0.0;
+  }
+
+  /// trajectory time reached since start, i.e. the ROS time (which follows /clock in simulation) that passed
+  /// since start multiplied by the time scale
+  ros::Duration executionTime(const ros::Time& start) const;
+
+  /// sleep in ROS time until trajectory time reaches time_from_start; returns immediately in as-fast-as-possible mode
+  void sleepUntil(const ros::Time& start, const ros::Duration& time_from_start) const;
+
+  /// trajectory seconds executed per second of ROS time; 0 plays trajectories back without waiting
+  double time_scale_;
+
 private:
   virtual void execTrajectory(const moveit_msgs::RobotTrajectory& t) = 0;
   virtual void cancelTrajectory();
@@ -120,7 +136,7 @@ protected:
   virtual void execTrajectory(const moveit_msgs::RobotTrajectory& t);
 
 private:
-  ros::WallRate rate_;
+  double rate_;  // publishing rate in Hz
 };
 }
 
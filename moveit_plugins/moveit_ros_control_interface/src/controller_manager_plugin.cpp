@@ -97,6 +97,10 @@ class MoveItControllerManager : public moveit_controller_manager::MoveItControll
   ros::Time controllers_stamp_;
   boost::mutex controllers_mutex_;
 
+  // persistent connections, so switching does not pay for a service lookup and a new connection every time
+  ros::ServiceClient list_controllers_service_;
+  ros::ServiceClient switch_controller_service_;
+
   /**
    * \brief Check if given controller is active
    * @param s state of controller
@@ -119,7 +123,7 @@ class MoveItControllerManager : public moveit_controller_manager::MoveItControll
       return;
 
     controller_manager_msgs::ListControllers srv;
-    if (!ros::service::call(getAbsName("controller_manager/list_controllers"), srv))
+    if (!callService(list_controllers_service_, "controller_manager/list_controllers", srv))
     {
       ROS_WARN_STREAM("Failed to read controllers from " << ns_ << "controller_manager/list_controllers");
     }
@@ -141,6 +145,48 @@ class MoveItControllerManager : public moveit_controller_manager::MoveItControll
     }
   }
 
+  /**
+   * \brief Call a service of the controller manager over a persistent connection, reconnecting once if the
+   * connection was lost (e.g. because the controller manager restarted)
+   * @param client the client to reuse, (re)created as needed
+   * @param name service name relative to ns_
+   * @param srv service request and response
+   * @return true if the call succeeded
+   */
+  template <typename Service>
+  bool callService(ros::ServiceClient& client, const std::string& name, Service& srv)
+  {
+    if (client.isValid() && client.call(srv))
+      return true;
+    client = ros::NodeHandle().serviceClient<Service>(getAbsName(name), true);
+    return client.call(srv);
+  }
+
+  /**
+   * \brief Mark the controllers of a successful switch as stopped and running in the cached states, so the
+   * controllers need not be listed again. controllers_mutex_ must be locked externally
+   * @param request the switch that was carried out
+   */
+  void applySwitch(const controller_manager_msgs::SwitchController::Request& request)
+  {
+    for (std::size_t i = 0; i < request.stop_controllers.size(); ++i)
+    {
+      ControllersMap::iterator c = managed_controllers_.find(getAbsName(request.stop_controllers[i]));
+      if (c != managed_controllers_.end())
+        c->second.state = "stopped";
+      active_controllers_.erase(request.stop_controllers[i]);
+    }
+    for (std::size_t i = 0; i < request.start_controllers.size(); ++i)
+    {
+      ControllersMap::iterator c = managed_controllers_.find(getAbsName(request.start_controllers[i]));
+      if (c == managed_controllers_.end())
+        continue;
+      c->second.state = "running";
+      active_controllers_[request.start_controllers[i]] = c->second;
+    }
+    controllers_stamp_ = ros::Time::now();
+  }
+
   /**
    * \brief Allocates a MoveItControllerHandle instance for the given controller
    * Might create allocator object first.
@@ -310,8 +356,43 @@ public:
   virtual bool switchControllers(const std::vector<std::string>& activate, const std::vector<std::string>& deactivate)
   {
     boost::mutex::scoped_lock lock(controllers_mutex_);
+    // switch based on the cached controller states; only if those turn out to be outdated are the controllers listed
+    // again and the switch retried
+    discover();
+    controller_manager_msgs::SwitchController srv;
+    if (!fillSwitchRequest(activate, deactivate, srv.request))
+      return true;  // nothing to switch
+
+    if (callService(switch_controller_service_, "controller_manager/switch_controller", srv) && srv.response.ok)
+    {
+      applySwitch(srv.request);
+      return true;
+    }
+
     discover(true);
+    srv = controller_manager_msgs::SwitchController();
+    if (!fillSwitchRequest(activate, deactivate, srv.request))
+      return true;
+    if (!callService(switch_controller_service_, "controller_manager/switch_controller", srv))
+    {
+      ROS_ERROR_STREAM("Could not switch controllers at " << ns_);
+      return false;
+    }
+    if (srv.response.ok)
+      applySwitch(srv.request);
+    else
+      discover(true);
+    return srv.response.ok;
+  }
 
+  /**
+   * \brief Fill the request that switches the managed controllers in \e activate and \e deactivate, based on the
+   * cached controller states. controllers_mutex_ must be locked externally
+   * @return false if there is nothing to switch
+   */
+  bool fillSwitchRequest(const std::vector<std::string>& activate, const std::vector<std::string>& deactivate,
+                         controller_manager_msgs::SwitchController::Request& request)
+  {
     typedef boost::bimap<std::string, std::string> resources_bimap;
 
     resources_bimap claimed_resources;
@@ -337,14 +418,12 @@ public:
 #endif
     }
 
-    controller_manager_msgs::SwitchController srv;
-
     for (std::vector<std::string>::const_iterator it = deactivate.begin(); it != deactivate.end(); ++it)
     {
       ControllersMap::iterator c = managed_controllers_.find(*it);
       if (c != managed_controllers_.end())
       {  // controller belongs to this manager
-        srv.request.stop_controllers.push_back(c->second.name);
+        request.stop_controllers.push_back(c->second.name);
         claimed_resources.right.erase(c->second.name);  // remove resources
       }
     }
@@ -354,15 +433,15 @@ public:
       ControllersMap::iterator c = managed_controllers_.find(*it);
       if (c != managed_controllers_.end())
       {  // controller belongs to this manager
-        srv.request.start_controllers.push_back(c->second.name);
+        request.start_controllers.push_back(c->second.name);
 #if defined(MOVEIT_ROS_CONTROL_INTERFACE_OLD_ROS_CONTROL)
         for (std::vector<std::string>::iterator r = c->second.resources.begin(); r != c->second.resources.end(); ++r)
         {  // for all claimed resource
           resources_bimap::right_const_iterator res = claimed_resources.right.find(*r);
           if (res != claimed_resources.right.end())
-          {                                                       // resource is claimed
-            srv.request.stop_controllers.push_back(res->second);  // add claiming controller to stop list
-            claimed_resources.left.erase(res->second);            // remove claimed resources
+          {                                                   // resource is claimed
+            request.stop_controllers.push_back(res->second);  // add claiming controller to stop list
+            claimed_resources.left.erase(res->second);        // remove claimed resources
           }
         }
 #else
@@ -374,27 +453,17 @@ public:
           {  // for all claimed resource
             resources_bimap::right_const_iterator res = claimed_resources.right.find(*r);
             if (res != claimed_resources.right.end())
-            {                                                       // resource is claimed
-              srv.request.stop_controllers.push_back(res->second);  // add claiming controller to stop list
-              claimed_resources.left.erase(res->second);            // remove claimed resources
+            {                                                   // resource is claimed
+              request.stop_controllers.push_back(res->second);  // add claiming controller to stop list
+              claimed_resources.left.erase(res->second);        // remove claimed resources
             }
           }
         }
 #endif
       }
     }
-    srv.request.strictness = srv.request.STRICT;
-
-    if (!srv.request.start_controllers.empty() || srv.request.stop_controllers.empty())
-    {  // something to switch?
-      if (!ros::service::call(getAbsName("controller_manager/switch_controller"), srv))
-      {
-        ROS_ERROR_STREAM("Could switch controllers at " << ns_);
-      }
-      discover(true);
-      return srv.response.ok;
-    }
-    return true;
+    request.strictness = request.STRICT;
+    return !request.start_controllers.empty() || !request.stop_controllers.empty();
   }
 };
 /**
@@ -458,6 +527,20 @@ class MoveItMultiControllerManager : public moveit_controller_manager::MoveItCon
     return name.substr(0, pos + 1);
   }
 
+  /**
+   * \brief Collect the controllers that live in the given namespace
+   * @param ns namespace including leading and trailing slashes
+   * @param names controller names
+   * @param filtered names that start with ns
+   */
+  static void filterNamespace(const std::string& ns, const std::vector<std::string>& names,
+                              std::vector<std::string>& filtered)
+  {
+    for (std::size_t i = 0; i < names.size(); ++i)
+      if (names[i].compare(0, ns.size(), ns) == 0)
+        filtered.push_back(names[i]);
+  }
+
 public:
   /**
    * \brief Find appropriate interface and delegate handle creation
@@ -543,7 +626,7 @@ public:
   }
 
   /**
-   * \brief delegates switch  to all known interfaces. Stops of first failing switch.
+   * \brief delegates switch  to all interfaces that manage any of the given controllers. Stops of first failing switch.
    * @param activate
    * @param deactivate
    * @return
@@ -554,7 +637,12 @@ public:
 
     for (ControllerManagersMap::iterator it = controller_managers_.begin(); it != controller_managers_.end(); ++it)
     {
-      if (!it->second->switchControllers(activate, deactivate))
+      std::vector<std::string> ns_activate, ns_deactivate;
+      filterNamespace(it->first, activate, ns_activate);
+      filterNamespace(it->first, deactivate, ns_deactivate);
+      if (ns_activate.empty() && ns_deactivate.empty())
+        continue;  // spare the interfaces not involved a round trip to their controller manager
+      if (!it->second->switchControllers(ns_activate, ns_deactivate))
         return false;
     }
     return true;
@@ -52,10 +52,20 @@ class FollowJointTrajectoryControllerHandle
 {
 public:
   FollowJointTrajectoryControllerHandle(const std::string& name, const std::string& action_ns)
-    : ActionBasedControllerHandle<control_msgs::FollowJointTrajectoryAction>(name, action_ns)
+    : ActionBasedControllerHandle<control_msgs::FollowJointTrajectoryAction>(name, action_ns), chunk_size_(0)
   {
   }
 
+  /*
+   * Send trajectories longer than chunk_size points as a sequence of goals of at most chunk_size points, each
+   *   replacing the previous one from its first point on, so execution can start before the whole trajectory
+   *   has been transmitted. 0 (the default) sends every trajectory as a single goal.
+   */
+  void setChunkSize(std::size_t chunk_size)
+  {
+    chunk_size_ = chunk_size;
+  }
+
   virtual bool sendTrajectory(const moveit_msgs::RobotTrajectory& trajectory)
   {
     ROS_DEBUG_STREAM_NAMED("FollowJointTrajectoryController", "new trajectory to " << name_);
@@ -74,18 +84,46 @@ public:
       ROS_DEBUG_STREAM_NAMED("FollowJointTrajectoryController",
                              "sending continuation for the currently executed trajectory to " << name_);
 
-    control_msgs::FollowJointTrajectoryGoal goal;
-    goal.trajectory = trajectory.joint_trajectory;
-    controller_action_client_->sendGoal(
-        goal, boost::bind(&FollowJointTrajectoryControllerHandle::controllerDoneCallback, this, _1, _2),
-        boost::bind(&FollowJointTrajectoryControllerHandle::controllerActiveCallback, this),
-        boost::bind(&FollowJointTrajectoryControllerHandle::controllerFeedbackCallback, this, _1));
+    // the goal is a member, so the point buffers of previous trajectories are reused
+    const trajectory_msgs::JointTrajectory& jt = trajectory.joint_trajectory;
+    goal_.trajectory.header = jt.header;
+    goal_.trajectory.joint_names = jt.joint_names;
+    if (chunk_size_ < 2 || jt.points.size() <= chunk_size_)
+    {
+      goal_.trajectory.points = jt.points;
+      sendGoal();
+    }
+    else
+    {
+      // all chunks need to refer to the same start time; the controller would take each one to start on receipt
+      if (goal_.trajectory.header.stamp.isZero())
+        goal_.trajectory.header.stamp = ros::Time::now();
+      // consecutive chunks share a point, so each replacement starts on the trajectory already being executed
+      for (std::size_t start = 0; start + 1 < jt.points.size(); start += chunk_size_ - 1)
+      {
+        std::size_t end = std::min(start + chunk_size_, jt.points.size());
+        goal_.trajectory.points.assign(jt.points.begin() + start, jt.points.begin() + end);
+        sendGoal();
+      }
+      ROS_DEBUG_STREAM_NAMED("FollowJointTrajectoryController", "sent trajectory of " << jt.points.size()
+                                                                                      << " points in chunks of "
+                                                                                      << chunk_size_ << " to "
+                                                                                      << name_);
+    }
     done_ = false;
     last_exec_ = moveit_controller_manager::ExecutionStatus::RUNNING;
     return true;
   }
 
 protected:
+  void sendGoal()
+  {
+    controller_action_client_->sendGoal(
+        goal_, boost::bind(&FollowJointTrajectoryControllerHandle::controllerDoneCallback, this, _1, _2),
+        boost::bind(&FollowJointTrajectoryControllerHandle::controllerActiveCallback, this),
+        boost::bind(&FollowJointTrajectoryControllerHandle::controllerFeedbackCallback, this, _1));
+  }
+
   void controllerDoneCallback(const actionlib::SimpleClientGoalState& state,
                               const control_msgs::FollowJointTrajectoryResultConstPtr& result)
   {
@@ -127,6 +165,9 @@ protected:
   void controllerFeedbackCallback(const control_msgs::FollowJointTrajectoryFeedbackConstPtr& feedback)
   {
   }
+
+  control_msgs::FollowJointTrajectoryGoal goal_;
+  std::size_t chunk_size_;
 };
 
 }  // end namespace moveit_simple_controller_manager
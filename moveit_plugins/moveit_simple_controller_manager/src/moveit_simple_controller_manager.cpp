@@ -143,6 +143,9 @@ public:
           new_handle.reset(new FollowJointTrajectoryControllerHandle(name, action_ns));
           if (static_cast<FollowJointTrajectoryControllerHandle*>(new_handle.get())->isConnected())
           {
+            if (controller_list[i].hasMember("chunk_size"))
+              static_cast<FollowJointTrajectoryControllerHandle*>(new_handle.get())
+                  ->setChunkSize(static_cast<int>(controller_list[i]["chunk_size"]));
             ROS_INFO_STREAM_NAMED("manager", "Added FollowJointTrajectory controller for " << name);
             controllers_[name] = new_handle;
           }
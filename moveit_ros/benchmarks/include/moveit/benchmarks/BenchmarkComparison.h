@@ -0,0 +1,108 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef MOVEIT_ROS_BENCHMARKS_BENCHMARK_COMPARISON_
+#define MOVEIT_ROS_BENCHMARKS_BENCHMARK_COMPARISON_
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace moveit_ros_benchmarks
+{
+/// The values of each property over the runs of one planner on one experiment. Runs that did not report a property
+/// (e.g. the path length of a failed run) contribute no value to it.
+typedef std::map<std::string, std::vector<double>> PropertyValues;
+
+/// The results of a benchmark, indexed by (experiment name, planner name)
+typedef std::map<std::pair<std::string, std::string>, PropertyValues> BenchmarkResults;
+
+/// Read the log files written by BenchmarkExecutor::writeOutput() into \e results. Each path is a log file or a
+/// directory whose .log files are all read. Runs of the same experiment and planner found in several logs (e.g. from
+/// benchmark shards) are merged. Returns false if a path or log could not be read.
+bool loadBenchmarkLogs(const std::vector<std::string>& paths, BenchmarkResults& results);
+
+/// The change of one metric of one planner on one experiment between a baseline and a candidate benchmark
+struct MetricComparison
+{
+  std::string experiment;
+  std::string planner;
+  std::string metric;
+
+  /// Number of values in the baseline and candidate samples
+  std::size_t baseline_count;
+  std::size_t candidate_count;
+
+  /// The median of the values (the success rate for "solved")
+  double baseline_value;
+  double candidate_value;
+
+  /// Two-sided p-value of the hypothesis that both samples have the same distribution
+  double p_value;
+
+  /// Whether this change fails the comparison
+  bool regression;
+};
+
+/// Statistical comparison of two benchmark result sets, for gating changes on planning performance.
+/// Planning times and path quality metrics are compared with the Mann-Whitney U test, success rates with a two
+/// proportion z-test. Only planning time regressions fail the comparison: the candidate regresses if its median time
+/// is more than the time threshold slower than the baseline, and the difference is significant.
+class BenchmarkComparison
+{
+public:
+  BenchmarkComparison(double time_threshold = 0.1, double significance = 0.05);
+
+  /// Compare each experiment and planner present in both \e baseline and \e candidate.
+  /// Returns false if any metric regressed.
+  bool compare(const BenchmarkResults& baseline, const BenchmarkResults& candidate,
+               std::vector<MetricComparison>& comparisons) const;
+
+  /// Two-sided p-value of the Mann-Whitney U test of samples \e a and \e b (normal approximation, corrected for ties)
+  static double mannWhitneyPValue(const std::vector<double>& a, const std::vector<double>& b);
+
+  /// Two-sided p-value of the z-test for the equality of the success rates \e successes_a / \e n_a and
+  /// \e successes_b / \e n_b
+  static double proportionPValue(std::size_t successes_a, std::size_t n_a, std::size_t successes_b, std::size_t n_b);
+
+  static double median(std::vector<double> values);
+
+private:
+  double time_threshold_;
+  double significance_;
+};
+}
+
+#endif
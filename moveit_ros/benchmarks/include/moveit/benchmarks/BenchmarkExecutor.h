@@ -38,6 +38,7 @@
 #define MOVEIT_ROS_BENCHMARKS_BENCHMARK_EXECUTOR_
 
 #include <moveit/benchmarks/BenchmarkOptions.h>
+#include <moveit/benchmarks/SceneGenerator.h>
 
 #include <moveit/planning_scene_monitor/planning_scene_monitor.h>
 
@@ -47,6 +48,7 @@
 #include <moveit/warehouse/constraints_storage.h>
 #include <moveit/warehouse/trajectory_constraints_storage.h>
 #include <moveit/planning_interface/planning_interface.h>
+#include <moveit/planning_pipeline/planning_pipeline.h>
 #include <warehouse_ros/database_loader.h>
 #include <pluginlib/class_loader.hpp>
 
@@ -54,12 +56,16 @@
 #include <vector>
 #include <string>
 #include <boost/function.hpp>
+#include <boost/progress.hpp>
+#include <cstdint>
 #include <memory>
 
 namespace moveit_ros_benchmarks
 {
 /// A class that executes motion plan requests and aggregates data across multiple runs
-/// Note: This class operates outside of MoveGroup and does NOT use PlanningRequestAdapters
+/// Note: This class operates outside of MoveGroup and by default does NOT use PlanningRequestAdapters. When the
+/// planning_pipeline option is set, runs go through PlanningPipeline::generatePlan() with the configured adapters,
+/// which matches what MoveGroup users see.
 class BenchmarkExecutor
 {
 public:
@@ -87,6 +93,8 @@ public:
       PlannerCompletionEventFunction;
 
   /// Definition of a pre-run benchmark event function.  Invoked immediately before each planner calls solve().
+  /// When runs are distributed over several workers, pre-run and post-run events (and collectMetrics()) are invoked
+  /// concurrently from the worker threads.
   typedef boost::function<void(moveit_msgs::MotionPlanRequest& request)> PreRunEventFunction;
 
   /// Definition of a post-run benchmark event function.  Invoked immediately after each planner calls solve().
@@ -95,6 +103,9 @@ public:
                                PlannerRunData& run_data)>
       PostRunEventFunction;
 
+  /// Definition of a function that returns the number of heap allocations the process made so far.
+  typedef boost::function<std::uint64_t()> AllocationCounterFunction;
+
   BenchmarkExecutor(const std::string& robot_description_param = "robot_description");
   virtual ~BenchmarkExecutor();
 
@@ -109,6 +120,10 @@ public:
   void addQueryStartEvent(QueryStartEventFunction func);
   void addQueryCompletionEvent(QueryCompletionEventFunction func);
 
+  /// Report the number of heap allocations of every run as counted by \e func. Like the peak memory, this is only
+  /// measured when runs are not distributed over several workers.
+  void setAllocationCounter(AllocationCounterFunction func);
+
   virtual void clear();
 
   virtual bool runBenchmarks(const BenchmarkOptions& opts);
@@ -176,10 +191,39 @@ protected:
                                  const std::vector<PathConstraints>& path_constraints,
                                  std::vector<BenchmarkRequest>& combos);
 
+  /// Select the planners of \e planners that run query number \e query in the shard configured in the options.
+  /// Pairs of queries and planners are numbered in order and dealt to the shards in turn, so every shard gets a
+  /// similar amount of work however few queries or planners there are. With generated scenes, each combination of
+  /// generated scene and query counts as a query.
+  void getShardPlanners(std::size_t query, const std::map<std::string, std::vector<std::string>>& planners,
+                        std::map<std::string, std::vector<std::string>>& shard_planners) const;
+
+  /// Add a generated scene to the planning scene, without the objects that collide with the robot in \e start_state
+  void addGeneratedScene(const moveit_msgs::PlanningSceneWorld& world, const moveit_msgs::RobotState& start_state);
+
   /// Execute the given motion plan request on the set of planners for the set number of runs
   void runBenchmark(moveit_msgs::MotionPlanRequest request,
                     const std::map<std::string, std::vector<std::string>>& planners, int runs);
 
+  /// Create the planning pipelines used when the planning_pipeline option is set
+  bool initializePlanningPipelines();
+
+  /// Execute a single run and store its metrics in \e run_data. The run uses \e pipeline to plan in \e scene if it is
+  /// set, and \e context otherwise. If the run is \e exclusive, no other run executes at the same time, so process
+  /// wide resources (memory, allocations, helper threads of the planner) can be attributed to it; otherwise only
+  /// probes hit by the calling thread are reported.
+  void runPlanner(const planning_interface::PlanningContextPtr& context,
+                  const planning_pipeline::PlanningPipelinePtr& pipeline,
+                  const planning_scene::PlanningSceneConstPtr& scene, moveit_msgs::MotionPlanRequest& request,
+                  PlannerRunData& run_data, bool exclusive);
+
+  /// Distribute the runs of one planner over \e workers threads, each pinned to its own core and planning in its own
+  /// copy of the planning scene. Results are stored by run index, so the output does not depend on scheduling.
+  void runPlannerParallel(const planning_interface::PlannerManagerPtr& planner_interface,
+                          const planning_pipeline::PlanningPipelinePtr& pipeline,
+                          const moveit_msgs::MotionPlanRequest& request, PlannerBenchmarkData& planner_data,
+                          unsigned int workers, boost::progress_display& progress);
+
   planning_scene_monitor::PlanningSceneMonitor* psm_;
   moveit_warehouse::PlanningSceneStorage* pss_;
   moveit_warehouse::PlanningSceneWorldStorage* psws_;
@@ -195,8 +239,16 @@ protected:
   std::shared_ptr<pluginlib::ClassLoader<planning_interface::PlannerManager>> planner_plugin_loader_;
   std::map<std::string, planning_interface::PlannerManagerPtr> planner_interfaces_;
 
+  /// The planning pipeline of each planner plugin, only used when the planning_pipeline option is set
+  std::map<std::string, planning_pipeline::PlanningPipelinePtr> planning_pipelines_;
+
   std::vector<PlannerBenchmarkData> benchmark_data_;
 
+  /// The planners that were run for the current query, in the order of benchmark_data_
+  std::map<std::string, std::vector<std::string>> benchmark_planners_;
+
+  AllocationCounterFunction allocation_counter_;
+
   std::vector<PreRunEventFunction> pre_event_fns_;
   std::vector<PostRunEventFunction> post_event_fns_;
   std::vector<PlannerStartEventFunction> planner_start_fns_;
@@ -42,6 +42,7 @@
 #include <vector>
 #include <ros/ros.h>
 #include <moveit_msgs/WorkspaceParameters.h>
+#include <moveit/benchmarks/SceneGenerator.h>
 
 namespace moveit_ros_benchmarks
 {
@@ -59,6 +60,12 @@ public:
   const std::string& getSceneName() const;
 
   int getNumRuns() const;
+  int getNumWorkers() const;
+  int getShardIndex() const;
+  int getNumShards() const;
+  bool getInstrumentation() const;
+  bool getUsePlanningPipeline() const;
+  const std::vector<std::string>& getRequestAdapters() const;
   double getTimeout() const;
   const std::string& getBenchmarkName() const;
   const std::string& getGroupName() const;
@@ -75,6 +82,9 @@ public:
   const std::string& getWorkspaceFrameID() const;
   const moveit_msgs::WorkspaceParameters& getWorkspaceParameters() const;
 
+  /// The generated scenes to add to the warehouse scene in turn; if empty, only the warehouse scene is benchmarked
+  const std::vector<SceneGenerator::Parameters>& getGeneratedScenes() const;
+
 protected:
   void readBenchmarkOptions(const std::string& ros_namespace);
 
@@ -84,6 +94,7 @@ protected:
 
   void readWorkspaceParameters(ros::NodeHandle& nh);
   void readGoalOffset(ros::NodeHandle& nh);
+  void readGeneratedScenes(ros::NodeHandle& nh);
 
   /// warehouse parameters
   std::string hostname_;
@@ -92,6 +103,12 @@ protected:
 
   /// benchmark parameters
   int runs_;
+  int workers_;
+  int shard_;
+  int shards_;
+  bool instrumentation_;
+  bool use_planning_pipeline_;
+  std::vector<std::string> request_adapters_;
   double timeout_;
   std::string benchmark_name_;
   std::string group_name_;
@@ -107,6 +124,9 @@ protected:
   std::map<std::string, std::vector<std::string>> planners_;
 
   moveit_msgs::WorkspaceParameters workspace_;
+
+  /// all combinations of the swept scene generation parameters
+  std::vector<SceneGenerator::Parameters> generated_scenes_;
 };
 }
 
@@ -0,0 +1,97 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef MOVEIT_ROS_BENCHMARKS_SCENE_GENERATOR_
+#define MOVEIT_ROS_BENCHMARKS_SCENE_GENERATOR_
+
+#include <moveit_msgs/PlanningSceneWorld.h>
+#include <geometry_msgs/Point.h>
+#include <shape_msgs/Mesh.h>
+#include <random_numbers/random_numbers.h>
+#include <string>
+
+namespace moveit_ros_benchmarks
+{
+/// Procedural generation of cluttered scenes, to measure how planning and collision checking scale with the number
+/// and complexity of obstacles
+class SceneGenerator
+{
+public:
+  /// The contents of a generated scene
+  struct Parameters
+  {
+    Parameters();
+
+    /// The name of the scene, built from the numbers of objects, e.g. "p10_m2x200_v5000"
+    std::string getName() const;
+
+    /// Number of boxes, spheres and cylinders
+    unsigned int primitives;
+
+    /// Number of meshes, and the number of triangles of each mesh
+    unsigned int meshes;
+    unsigned int mesh_triangles;
+
+    /// Number of occupied octomap voxels, and the size of a voxel
+    unsigned int voxels;
+    double voxel_resolution;
+
+    /// Range of the size of generated objects
+    double min_size;
+    double max_size;
+
+    /// Objects and voxels are placed uniformly at random in this box of frame \e frame_id
+    std::string frame_id;
+    geometry_msgs::Point min_corner;
+    geometry_msgs::Point max_corner;
+
+    unsigned int seed;
+  };
+
+  /// Generate the scene described by \e params. The primitives, meshes and voxels are drawn from separate random
+  /// streams of the seed, so scenes that differ only in the number of one kind of object contain the same first
+  /// objects, and form a nested sequence along each parameter. Generated collision objects are named with the prefix
+  /// OBJECT_PREFIX. The octomap is left empty if no voxels are requested.
+  static void generate(const Parameters& params, moveit_msgs::PlanningSceneWorld& world);
+
+  /// Create a closed, star-shaped mesh of about \e triangles triangles, whose vertices are a quarter to a half of
+  /// \e size away from its center
+  static void createMesh(random_numbers::RandomNumberGenerator& rng, unsigned int triangles, double size,
+                         shape_msgs::Mesh& mesh);
+
+  static const std::string OBJECT_PREFIX;
+};
+}
+
+#endif
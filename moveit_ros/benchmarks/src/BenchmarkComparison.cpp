@@ -0,0 +1,321 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/benchmarks/BenchmarkComparison.h>
+#include <ros/console.h>
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+using namespace moveit_ros_benchmarks;
+
+namespace
+{
+// Read a line of the form "<count> <text>", e.g. "3 planners"
+bool readCount(std::istream& in, const std::string& text, std::size_t& count)
+{
+  std::string line;
+  if (!std::getline(in, line))
+    return false;
+  std::istringstream line_stream(line);
+  std::string rest;
+  if (!(line_stream >> count) || !std::getline(line_stream, rest))
+    return false;
+  boost::trim(rest);
+  return rest == text;
+}
+
+bool skipLines(std::istream& in, std::size_t count)
+{
+  std::string line;
+  for (std::size_t i = 0; i < count; ++i)
+    if (!std::getline(in, line))
+      return false;
+  return true;
+}
+
+bool loadBenchmarkLog(const std::string& filename, BenchmarkResults& results)
+{
+  std::ifstream in(filename.c_str());
+  if (!in)
+  {
+    ROS_ERROR("Failed to open benchmark log '%s'", filename.c_str());
+    return false;
+  }
+
+  // The header lists the experiment name, and the experiment setup between "<<<|" and "|>>>"
+  std::string experiment;
+  std::string line;
+  while (std::getline(in, line) && line != "|>>>")
+    if (experiment.empty() && boost::starts_with(line, "Experiment "))
+      experiment = line.substr(11);
+
+  std::size_t count;
+  while (std::getline(in, line))
+  {
+    std::istringstream line_stream(line);
+    std::string rest;
+    if (!(line_stream >> count) || !std::getline(line_stream, rest))
+      continue;
+    boost::trim(rest);
+    if (rest == "enum types")
+      skipLines(in, count);
+    else if (rest == "planners")
+      break;
+  }
+  if (!in || experiment.empty())
+  {
+    ROS_ERROR("'%s' is not a benchmark log", filename.c_str());
+    return false;
+  }
+
+  const std::size_t num_planners = count;
+  for (std::size_t p = 0; p < num_planners; ++p)
+  {
+    std::string planner;
+    std::size_t num_properties, num_runs;
+    if (!std::getline(in, planner) || !readCount(in, "common properties", count) || !skipLines(in, count) ||
+        !readCount(in, "properties for each run", num_properties))
+    {
+      ROS_ERROR("Malformed planner %lu in benchmark log '%s'", p, filename.c_str());
+      return false;
+    }
+
+    // properties are listed as "<name> <type>"; the values are indexed by name
+    std::vector<std::string> properties(num_properties);
+    for (std::size_t i = 0; i < num_properties && std::getline(in, line); ++i)
+      properties[i] = line.substr(0, line.rfind(' '));
+
+    if (!readCount(in, "runs", num_runs))
+    {
+      ROS_ERROR("Malformed runs of planner '%s' in benchmark log '%s'", planner.c_str(), filename.c_str());
+      return false;
+    }
+
+    PropertyValues& values = results[std::make_pair(experiment, planner)];
+    for (std::size_t r = 0; r < num_runs && std::getline(in, line); ++r)
+    {
+      std::vector<std::string> fields;
+      boost::split(fields, line, boost::is_any_of(";"));
+      for (std::size_t i = 0; i < num_properties && i < fields.size(); ++i)
+      {
+        boost::trim(fields[i]);
+        if (fields[i].empty())
+          continue;
+        char* end;
+        double value = std::strtod(fields[i].c_str(), &end);
+        if (*end == '\0')
+          values[properties[i]].push_back(value);
+      }
+    }
+
+    // each planner ends with a line holding a single "."
+    if (!std::getline(in, line) || line != ".")
+    {
+      ROS_ERROR("Malformed runs of planner '%s' in benchmark log '%s'", planner.c_str(), filename.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+bool isPathQualityMetric(const std::string& property)
+{
+  return boost::starts_with(property, "path_") &&
+         (boost::ends_with(property, "_length") || boost::ends_with(property, "_clearance") ||
+          boost::ends_with(property, "_smoothness"));
+}
+
+double normalPValue(double z)
+{
+  return std::erfc(std::fabs(z) / std::sqrt(2.0));
+}
+}
+
+bool moveit_ros_benchmarks::loadBenchmarkLogs(const std::vector<std::string>& paths, BenchmarkResults& results)
+{
+  bool ok = true;
+  for (std::size_t i = 0; i < paths.size(); ++i)
+  {
+    boost::system::error_code ec;
+    if (boost::filesystem::is_directory(paths[i], ec))
+    {
+      std::vector<std::string> logs;
+      for (boost::filesystem::directory_iterator it(paths[i], ec), end; !ec && it != end; it.increment(ec))
+        if (it->path().extension() == ".log")
+          logs.push_back(it->path().string());
+      std::sort(logs.begin(), logs.end());
+      for (std::size_t j = 0; j < logs.size(); ++j)
+        ok &= loadBenchmarkLog(logs[j], results);
+    }
+    else
+      ok &= loadBenchmarkLog(paths[i], results);
+  }
+  return ok;
+}
+
+BenchmarkComparison::BenchmarkComparison(double time_threshold, double significance)
+  : time_threshold_(time_threshold), significance_(significance)
+{
+}
+
+double BenchmarkComparison::median(std::vector<double> values)
+{
+  if (values.empty())
+    return 0.0;
+  std::size_t mid = values.size() / 2;
+  std::nth_element(values.begin(), values.begin() + mid, values.end());
+  double m = values[mid];
+  if (values.size() % 2 == 0)
+    m = (m + *std::max_element(values.begin(), values.begin() + mid)) / 2.0;
+  return m;
+}
+
+double BenchmarkComparison::mannWhitneyPValue(const std::vector<double>& a, const std::vector<double>& b)
+{
+  const double n_a = a.size();
+  const double n_b = b.size();
+  const double n = n_a + n_b;
+  if (a.empty() || b.empty())
+    return 1.0;
+
+  // rank the pooled sample, giving tied values their average rank
+  std::vector<std::pair<double, bool>> pooled;
+  pooled.reserve(a.size() + b.size());
+  for (std::size_t i = 0; i < a.size(); ++i)
+    pooled.push_back(std::make_pair(a[i], true));
+  for (std::size_t i = 0; i < b.size(); ++i)
+    pooled.push_back(std::make_pair(b[i], false));
+  std::sort(pooled.begin(), pooled.end());
+
+  double rank_sum_a = 0.0;
+  double ties = 0.0;
+  for (std::size_t i = 0; i < pooled.size();)
+  {
+    std::size_t j = i;
+    while (j < pooled.size() && pooled[j].first == pooled[i].first)
+      ++j;
+    const double t = j - i;
+    const double rank = (i + 1 + j) / 2.0;
+    for (std::size_t k = i; k < j; ++k)
+      if (pooled[k].second)
+        rank_sum_a += rank;
+    ties += t * t * t - t;
+    i = j;
+  }
+
+  const double u = rank_sum_a - n_a * (n_a + 1.0) / 2.0;
+  const double mean = n_a * n_b / 2.0;
+  const double variance = n_a * n_b / 12.0 * ((n + 1.0) - ties / (n * (n - 1.0)));
+  if (variance <= 0.0)
+    return 1.0;
+
+  // continuity correction towards the mean
+  const double deviation = std::max(0.0, std::fabs(u - mean) - 0.5);
+  return normalPValue(deviation / std::sqrt(variance));
+}
+
+double BenchmarkComparison::proportionPValue(std::size_t successes_a, std::size_t n_a, std::size_t successes_b,
+                                             std::size_t n_b)
+{
+  if (n_a == 0 || n_b == 0)
+    return 1.0;
+  const double p_a = static_cast<double>(successes_a) / n_a;
+  const double p_b = static_cast<double>(successes_b) / n_b;
+  const double p = static_cast<double>(successes_a + successes_b) / (n_a + n_b);
+  const double se = std::sqrt(p * (1.0 - p) * (1.0 / n_a + 1.0 / n_b));
+  if (se <= 0.0)
+    return 1.0;
+  return normalPValue((p_a - p_b) / se);
+}
+
+bool BenchmarkComparison::compare(const BenchmarkResults& baseline, const BenchmarkResults& candidate,
+                                  std::vector<MetricComparison>& comparisons) const
+{
+  comparisons.clear();
+  bool passed = true;
+  for (BenchmarkResults::const_iterator it = baseline.begin(); it != baseline.end(); ++it)
+  {
+    BenchmarkResults::const_iterator cit = candidate.find(it->first);
+    if (cit == candidate.end())
+    {
+      ROS_WARN("Planner '%s' on experiment '%s' is missing from the candidate results", it->first.second.c_str(),
+               it->first.first.c_str());
+      continue;
+    }
+
+    for (PropertyValues::const_iterator pit = it->second.begin(); pit != it->second.end(); ++pit)
+    {
+      const bool time = pit->first == "time";
+      const bool solved = pit->first == "solved";
+      if (!time && !solved && !isPathQualityMetric(pit->first))
+        continue;
+      PropertyValues::const_iterator cpit = cit->second.find(pit->first);
+      if (cpit == cit->second.end())
+        continue;
+
+      const std::vector<double>& a = pit->second;
+      const std::vector<double>& b = cpit->second;
+      MetricComparison c;
+      c.experiment = it->first.first;
+      c.planner = it->first.second;
+      c.metric = pit->first;
+      c.baseline_count = a.size();
+      c.candidate_count = b.size();
+      if (solved)
+      {
+        const std::size_t successes_a = std::count(a.begin(), a.end(), 1.0);
+        const std::size_t successes_b = std::count(b.begin(), b.end(), 1.0);
+        c.baseline_value = a.empty() ? 0.0 : static_cast<double>(successes_a) / a.size();
+        c.candidate_value = b.empty() ? 0.0 : static_cast<double>(successes_b) / b.size();
+        c.p_value = proportionPValue(successes_a, a.size(), successes_b, b.size());
+      }
+      else
+      {
+        c.baseline_value = median(a);
+        c.candidate_value = median(b);
+        c.p_value = mannWhitneyPValue(a, b);
+      }
+      c.regression =
+          time && c.p_value < significance_ && c.candidate_value > c.baseline_value * (1.0 + time_threshold_);
+      passed &= !c.regression;
+      comparisons.push_back(c);
+    }
+  }
+  return passed;
+}
@@ -36,14 +36,19 @@
 
 #include <moveit/benchmarks/BenchmarkExecutor.h>
 #include <moveit/version.h>
+#include <moveit/profiler/probes.h>
+#include <moveit/robot_state/conversions.h>
 #include <eigen_conversions/eigen_msg.h>
 
-#include <boost/regex.hpp>
-#include <boost/progress.hpp>
+#include <boost/thread.hpp>
 #include <boost/math/constants/constants.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <cctype>
+#include <fstream>
 #include <unistd.h>
+#include <pthread.h>
+#include <atomic>
 
 using namespace moveit_ros_benchmarks;
 
@@ -61,6 +66,133 @@ static std::string getHostname()
   }
 }
 
+// Pin the calling thread to a single core so that run timings are not skewed by the scheduler migrating threads
+static void pinThreadToCore(unsigned int core)
+{
+#ifdef __linux__
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(core, &cpu_set);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0)
+    ROS_WARN("Unable to pin benchmark worker to core %u", core);
+#endif
+}
+
+// Reset the peak resident set size of the process. Returns false if this is not supported.
+static bool resetPeakMemory()
+{
+#ifdef __linux__
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  clear_refs << "5";
+  clear_refs.close();
+  return !clear_refs.fail();
+#else
+  return false;
+#endif
+}
+
+// The peak resident set size of the process since the last reset, in MB
+static double getPeakMemory()
+{
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line))
+    if (line.compare(0, 6, "VmHWM:") == 0)
+      return atof(line.c_str() + 6) / 1024.0;
+  return 0.0;
+}
+
+typedef std::map<std::string, moveit::tools::probes::ProbeStats> ProbeSnapshot;
+
+static ProbeSnapshot getProbeSnapshot(bool all_threads)
+{
+  std::vector<moveit::tools::probes::ProbeStats> stats =
+      all_threads ? moveit::tools::probes::getStats() : moveit::tools::probes::getThreadStats();
+  ProbeSnapshot snapshot;
+  for (std::size_t i = 0; i < stats.size(); ++i)
+    snapshot[stats[i].name] = stats[i];
+  return snapshot;
+}
+
+// Accumulate the measurements the probe \e name took between the two snapshots into \e delta
+static void addProbeDelta(const ProbeSnapshot& before, const ProbeSnapshot& after, const std::string& name,
+                          moveit::tools::probes::ProbeStats& delta)
+{
+  ProbeSnapshot::const_iterator a = after.find(name);
+  if (a == after.end())
+    return;
+  ProbeSnapshot::const_iterator b = before.find(name);
+  delta.histogram.resize(a->second.histogram.size(), 0);
+  delta.count += a->second.count;
+  delta.timed += a->second.timed;
+  delta.total += a->second.total;
+  for (std::size_t i = 0; i < a->second.histogram.size(); ++i)
+    delta.histogram[i] += a->second.histogram[i];
+  // the extremes of the interval are unknown, the overall longest duration bounds the percentiles
+  delta.longest = std::max(delta.longest, a->second.longest);
+  if (b == before.end())
+    return;
+  delta.count -= b->second.count;
+  delta.timed -= b->second.timed;
+  delta.total -= b->second.total;
+  for (std::size_t i = 0; i < b->second.histogram.size() && i < delta.histogram.size(); ++i)
+    delta.histogram[i] -= b->second.histogram[i];
+}
+
+// Store the number of hits, the total time and the latency distribution of a group of probes under \e metric
+static void addProbeMetrics(BenchmarkExecutor::PlannerRunData& metrics, const std::string& metric,
+                            const ProbeSnapshot& before, const ProbeSnapshot& after,
+                            const std::vector<std::string>& probes)
+{
+  moveit::tools::probes::ProbeStats delta;
+  delta.count = delta.timed = 0;
+  delta.total = delta.shortest = delta.longest = 0.0;
+  for (std::size_t i = 0; i < probes.size(); ++i)
+    addProbeDelta(before, after, probes[i], delta);
+
+  metrics[metric + "_count INTEGER"] = boost::lexical_cast<std::string>(delta.count);
+  metrics[metric + "_time REAL"] = boost::lexical_cast<std::string>(delta.total);
+  if (delta.timed > 0)
+  {
+    metrics[metric + "_latency_p50 REAL"] =
+        boost::lexical_cast<std::string>(moveit::tools::probes::percentile(delta, 0.5));
+    metrics[metric + "_latency_p99 REAL"] =
+        boost::lexical_cast<std::string>(moveit::tools::probes::percentile(delta, 0.99));
+  }
+}
+
+// Plan with the full planning pipeline, including the planning request adapters and the check of the solution path
+static bool solveWithPipeline(const planning_pipeline::PlanningPipeline& pipeline,
+                              const planning_scene::PlanningSceneConstPtr& scene,
+                              const moveit_msgs::MotionPlanRequest& request,
+                              planning_interface::MotionPlanDetailedResponse& res)
+{
+  planning_interface::MotionPlanResponse mp_res;
+  bool solved = pipeline.generatePlan(scene, request, mp_res);
+  res.error_code_ = mp_res.error_code_;
+  if (mp_res.trajectory_)
+  {
+    res.trajectory_.push_back(mp_res.trajectory_);
+    res.description_.push_back("pipeline");
+    res.processing_time_.push_back(mp_res.planning_time_);
+  }
+  return solved;
+}
+
+// Turn the description of a planning request adapter into a metric name
+static std::string getAdapterMetricName(const std::string& description)
+{
+  std::string name = "adapter_";
+  for (std::size_t i = 0; i < description.size(); ++i)
+    if (isalnum(description[i]))
+      name += tolower(description[i]);
+    else if (name[name.size() - 1] != '_')
+      name += '_';
+  while (name[name.size() - 1] == '_')
+    name.erase(name.size() - 1);
+  return name;
+}
+
 BenchmarkExecutor::BenchmarkExecutor(const std::string& robot_description_param)
 {
   pss_ = NULL;
@@ -171,6 +303,7 @@ void BenchmarkExecutor::clear()
   }
 
   benchmark_data_.clear();
+  benchmark_planners_.clear();
   pre_event_fns_.clear();
   post_event_fns_.clear();
   planner_start_fns_.clear();
@@ -204,6 +337,11 @@ void BenchmarkExecutor::addQueryStartEvent(QueryStartEventFunction func)
   query_start_fns_.push_back(func);
 }
 
+void BenchmarkExecutor::setAllocationCounter(AllocationCounterFunction func)
+{
+  allocation_counter_ = func;
+}
+
 void BenchmarkExecutor::addQueryCompletionEvent(QueryCompletionEventFunction func)
 {
   query_end_fns_.push_back(func);
@@ -225,8 +363,36 @@ bool BenchmarkExecutor::runBenchmarks(const BenchmarkOptions& opts)
     if (!queriesAndPlannersCompatible(queries, opts.getPlannerConfigurations()))
       return false;
 
-    for (std::size_t i = 0; i < queries.size(); ++i)
+    if (!initializePlanningPipelines())
+      return false;
+
+    // The instrumentation counters are the source of the collision checking, FK and IK metrics
+    const bool probes_enabled = moveit::tools::probes::isEnabled();
+    if (options_.getInstrumentation())
+      moveit::tools::probes::setEnabled(true);
+
+    // Every query is benchmarked in every generated scene, or only in the warehouse scene if none are configured
+    std::vector<SceneGenerator::Parameters> generated_scenes = options_.getGeneratedScenes();
+    const std::size_t num_jobs = std::max<std::size_t>(1, generated_scenes.size()) * queries.size();
+    moveit_msgs::PlanningSceneWorld generated_world;
+    std::size_t generated_scene = generated_scenes.size();
+
+    for (std::size_t i = 0; i < num_jobs; ++i)
     {
+      getShardPlanners(i, options_.getPlannerConfigurations(), benchmark_planners_);
+      if (benchmark_planners_.empty())
+        continue;
+
+      BenchmarkRequest query = queries[i % queries.size()];
+      if (!generated_scenes.empty() && generated_scene != i / queries.size())
+      {
+        generated_scene = i / queries.size();
+        SceneGenerator::Parameters& params = generated_scenes[generated_scene];
+        if (params.frame_id.empty())
+          params.frame_id = planning_scene_->getPlanningFrame();
+        SceneGenerator::generate(params, generated_world);
+      }
+
       // Configure planning scene
       if (scene_msg.robot_model_name != planning_scene_->getRobotModel()->getName())
       {
@@ -240,26 +406,67 @@ bool BenchmarkExecutor::runBenchmarks(const BenchmarkOptions& opts)
       else
         planning_scene_->usePlanningSceneMsg(scene_msg);
 
+      if (!generated_scenes.empty())
+      {
+        addGeneratedScene(generated_world, query.request.start_state);
+        query.name += "_" + generated_scenes[generated_scene].getName();
+      }
+
       // Calling query start events
       for (std::size_t j = 0; j < query_start_fns_.size(); ++j)
-        query_start_fns_[j](queries[i].request, planning_scene_);
+        query_start_fns_[j](query.request, planning_scene_);
 
-      ROS_INFO("Benchmarking query '%s' (%lu of %lu)", queries[i].name.c_str(), i + 1, queries.size());
+      ROS_INFO("Benchmarking query '%s' (%lu of %lu)", query.name.c_str(), i + 1, num_jobs);
       ros::WallTime start_time = ros::WallTime::now();
-      runBenchmark(queries[i].request, options_.getPlannerConfigurations(), options_.getNumRuns());
+      runBenchmark(query.request, benchmark_planners_, options_.getNumRuns());
       double duration = (ros::WallTime::now() - start_time).toSec();
 
       for (std::size_t j = 0; j < query_end_fns_.size(); ++j)
-        query_end_fns_[j](queries[i].request, planning_scene_);
+        query_end_fns_[j](query.request, planning_scene_);
 
-      writeOutput(queries[i], boost::posix_time::to_iso_extended_string(start_time.toBoost()), duration);
+      writeOutput(query, boost::posix_time::to_iso_extended_string(start_time.toBoost()), duration);
     }
 
+    moveit::tools::probes::setEnabled(probes_enabled);
     return true;
   }
   return false;
 }
 
+void BenchmarkExecutor::addGeneratedScene(const moveit_msgs::PlanningSceneWorld& world,
+                                          const moveit_msgs::RobotState& start_state)
+{
+  for (std::size_t i = 0; i < world.collision_objects.size(); ++i)
+    planning_scene_->processCollisionObjectMsg(world.collision_objects[i]);
+  // an empty octomap message would remove the octomap of the warehouse scene
+  if (!world.octomap.octomap.data.empty())
+    planning_scene_->processOctomapMsg(world.octomap);
+
+  // Objects placed on the robot's start state would make the query infeasible for every planner
+  robot_state::RobotState state = planning_scene_->getCurrentState();
+  moveit::core::robotStateMsgToRobotState(planning_scene_->getTransforms(), start_state, state);
+  collision_detection::CollisionRequest req;
+  req.contacts = true;
+  req.max_contacts_per_pair = 1;
+  req.max_contacts = (world.collision_objects.size() + 1) *
+                     planning_scene_->getRobotModel()->getLinkModelsWithCollisionGeometry().size();
+  collision_detection::CollisionResult res;
+  planning_scene_->checkCollision(req, res, state);
+
+  std::size_t removed = 0;
+  for (collision_detection::CollisionResult::ContactMap::const_iterator it = res.contacts.begin();
+       it != res.contacts.end(); ++it)
+  {
+    const std::string* names[] = { &it->first.first, &it->first.second };
+    for (std::size_t j = 0; j < 2; ++j)
+      if (names[j]->compare(0, SceneGenerator::OBJECT_PREFIX.size(), SceneGenerator::OBJECT_PREFIX) == 0 &&
+          planning_scene_->getWorldNonConst()->removeObject(*names[j]))
+        ++removed;
+  }
+  if (removed)
+    ROS_INFO("Removed %lu generated objects in collision with the start state", removed);
+}
+
 bool BenchmarkExecutor::queriesAndPlannersCompatible(const std::vector<BenchmarkRequest>& requests,
                                                      const std::map<std::string, std::vector<std::string>>& planners)
 {
@@ -437,6 +644,38 @@ bool BenchmarkExecutor::initializeBenchmarks(const BenchmarkOptions& opts, movei
   return true;
 }
 
+bool BenchmarkExecutor::initializePlanningPipelines()
+{
+  planning_pipelines_.clear();
+  if (!options_.getUsePlanningPipeline())
+    return true;
+
+  const std::map<std::string, std::vector<std::string>>& planners = options_.getPlannerConfigurations();
+  for (std::map<std::string, std::vector<std::string>>::const_iterator it = planners.begin(); it != planners.end();
+       ++it)
+  {
+    planning_pipeline::PlanningPipelinePtr pipeline;
+    try
+    {
+      pipeline.reset(new planning_pipeline::PlanningPipeline(planning_scene_->getRobotModel(), ros::NodeHandle(),
+                                                             it->first, options_.getRequestAdapters()));
+    }
+    catch (std::exception& ex)
+    {
+      ROS_ERROR("Exception while creating the planning pipeline for '%s': %s", it->first.c_str(), ex.what());
+      return false;
+    }
+    if (!pipeline->getPlannerManager())
+    {
+      ROS_ERROR("Unable to create the planning pipeline for '%s'", it->first.c_str());
+      return false;
+    }
+    pipeline->displayComputedMotionPlans(false);
+    planning_pipelines_[it->first] = pipeline;
+  }
+  return true;
+}
+
 void BenchmarkExecutor::shiftConstraintsByOffset(moveit_msgs::Constraints& constraints,
                                                  const std::vector<double> offset)
 {
@@ -606,10 +845,19 @@ bool BenchmarkExecutor::loadQueries(const std::string& regex, const std::string&
   if (regex.empty())
     return true;
 
-  std::vector<std::string> query_names;
+  // stream the matching queries so that only one stored message is deserialized at a time
+  std::size_t loaded = 0;
   try
   {
-    pss_->getPlanningQueriesNames(regex, query_names, scene_name);
+    loaded = pss_->forEachPlanningQuery(
+        regex, scene_name,
+        [&queries](const std::string& name, const moveit_warehouse::MotionPlanRequestWithMetadata& planning_query) {
+          BenchmarkRequest query;
+          query.name = name;
+          query.request = static_cast<const moveit_msgs::MotionPlanRequest&>(*planning_query);
+          queries.push_back(query);
+          return true;
+        });
   }
   catch (std::exception& ex)
   {
@@ -617,30 +865,11 @@ bool BenchmarkExecutor::loadQueries(const std::string& regex, const std::string&
     return false;
   }
 
-  if (query_names.empty())
+  if (loaded == 0)
   {
     ROS_ERROR("Scene '%s' has no associated queries", scene_name.c_str());
     return false;
   }
-
-  for (std::size_t i = 0; i < query_names.size(); ++i)
-  {
-    moveit_warehouse::MotionPlanRequestWithMetadata planning_query;
-    try
-    {
-      pss_->getPlanningQuery(planning_query, scene_name, query_names[i]);
-    }
-    catch (std::exception& ex)
-    {
-      ROS_ERROR("Error loading motion planning query '%s': %s", query_names[i].c_str(), ex.what());
-      continue;
-    }
-
-    BenchmarkRequest query;
-    query.name = query_names[i];
-    query.request = static_cast<moveit_msgs::MotionPlanRequest>(*planning_query);
-    queries.push_back(query);
-  }
   ROS_INFO("Loaded queries successfully");
   return true;
 }
@@ -649,31 +878,26 @@ bool BenchmarkExecutor::loadStates(const std::string& regex, std::vector<StartSt
 {
   if (regex.size())
   {
-    boost::regex start_regex(regex);
     std::vector<std::string> state_names;
-    rs_->getKnownRobotStates(state_names);
+    rs_->getKnownRobotStates(regex, state_names);
     for (std::size_t i = 0; i < state_names.size(); ++i)
     {
-      boost::cmatch match;
-      if (boost::regex_match(state_names[i].c_str(), match, start_regex))
+      moveit_warehouse::RobotStateWithMetadata robot_state;
+      try
       {
-        moveit_warehouse::RobotStateWithMetadata robot_state;
-        try
-        {
-          if (rs_->getRobotState(robot_state, state_names[i]))
-          {
-            StartState start_state;
-            start_state.state = moveit_msgs::RobotState(*robot_state);
-            start_state.name = state_names[i];
-            start_states.push_back(start_state);
-          }
-        }
-        catch (std::exception& ex)
+        if (rs_->getRobotState(robot_state, state_names[i]))
         {
-          ROS_ERROR("Runtime error when loading state '%s': %s", state_names[i].c_str(), ex.what());
-          continue;
+          StartState start_state;
+          start_state.state = moveit_msgs::RobotState(*robot_state);
+          start_state.name = state_names[i];
+          start_states.push_back(start_state);
         }
       }
+      catch (std::exception& ex)
+      {
+        ROS_ERROR("Runtime error when loading state '%s': %s", state_names[i].c_str(), ex.what());
+        continue;
+      }
     }
 
     if (start_states.empty())
@@ -754,6 +978,31 @@ bool BenchmarkExecutor::loadTrajectoryConstraints(const std::string& regex,
   return true;
 }
 
+void BenchmarkExecutor::getShardPlanners(std::size_t query,
+                                         const std::map<std::string, std::vector<std::string>>& planners,
+                                         std::map<std::string, std::vector<std::string>>& shard_planners) const
+{
+  shard_planners.clear();
+  const std::size_t shards = options_.getNumShards();
+  if (shards <= 1)
+  {
+    shard_planners = planners;
+    return;
+  }
+
+  std::size_t num_planners = 0;
+  for (std::map<std::string, std::vector<std::string>>::const_iterator it = planners.begin(); it != planners.end();
+       ++it)
+    num_planners += it->second.size();
+
+  std::size_t job = query * num_planners;
+  for (std::map<std::string, std::vector<std::string>>::const_iterator it = planners.begin(); it != planners.end();
+       ++it)
+    for (std::size_t i = 0; i < it->second.size(); ++i, ++job)
+      if (job % shards == static_cast<std::size_t>(options_.getShardIndex()))
+        shard_planners[it->first].push_back(it->second[i]);
+}
+
 void BenchmarkExecutor::runBenchmark(moveit_msgs::MotionPlanRequest request,
                                      const std::map<std::string, std::vector<std::string>>& planners, int runs)
 {
@@ -782,31 +1031,28 @@ void BenchmarkExecutor::runBenchmark(moveit_msgs::MotionPlanRequest request,
       for (std::size_t j = 0; j < planner_start_fns_.size(); ++j)
         planner_start_fns_[j](request, planner_data);
 
-      planning_interface::PlanningContextPtr context =
-          planner_interfaces_[it->first]->getPlanningContext(planning_scene_, request);
-      for (int j = 0; j < runs; ++j)
+      // Never use more workers than there are cores, otherwise runs would compete for CPU time
+      unsigned int workers = std::max(1, std::min(options_.getNumWorkers(), runs));
+      workers = std::min(workers, std::max(1u, boost::thread::hardware_concurrency()));
+      // In pipeline mode, runs go through the planning request adapters instead of a bare planning context
+      planning_pipeline::PlanningPipelinePtr pipeline;
+      std::map<std::string, planning_pipeline::PlanningPipelinePtr>::const_iterator pipeline_it =
+          planning_pipelines_.find(it->first);
+      if (pipeline_it != planning_pipelines_.end())
+        pipeline = pipeline_it->second;
+
+      if (workers > 1)
+        runPlannerParallel(planner_interfaces_[it->first], pipeline, request, planner_data, workers, progress);
+      else
       {
-        // Pre-run events
-        for (std::size_t k = 0; k < pre_event_fns_.size(); ++k)
-          pre_event_fns_[k](request);
-
-        // Solve problem
-        planning_interface::MotionPlanDetailedResponse mp_res;
-        ros::WallTime start = ros::WallTime::now();
-        bool solved = context->solve(mp_res);
-        double total_time = (ros::WallTime::now() - start).toSec();
-
-        // Collect data
-        start = ros::WallTime::now();
-
-        // Post-run events
-        for (std::size_t k = 0; k < post_event_fns_.size(); ++k)
-          post_event_fns_[k](request, mp_res, planner_data[j]);
-        collectMetrics(planner_data[j], mp_res, solved, total_time);
-        double metrics_time = (ros::WallTime::now() - start).toSec();
-        ROS_DEBUG("Spent %lf seconds collecting metrics", metrics_time);
-
-        ++progress;
+        planning_interface::PlanningContextPtr context;
+        if (!pipeline)
+          context = planner_interfaces_[it->first]->getPlanningContext(planning_scene_, request);
+        for (int j = 0; j < runs; ++j)
+        {
+          runPlanner(context, pipeline, planning_scene_, request, planner_data[j], true);
+          ++progress;
+        }
       }
 
       // Planner completion events
@@ -818,6 +1064,113 @@ void BenchmarkExecutor::runBenchmark(moveit_msgs::MotionPlanRequest request,
   }
 }
 
+void BenchmarkExecutor::runPlanner(const planning_interface::PlanningContextPtr& context,
+                                   const planning_pipeline::PlanningPipelinePtr& pipeline,
+                                   const planning_scene::PlanningSceneConstPtr& scene,
+                                   moveit_msgs::MotionPlanRequest& request, PlannerRunData& run_data, bool exclusive)
+{
+  // Pre-run events
+  for (std::size_t k = 0; k < pre_event_fns_.size(); ++k)
+    pre_event_fns_[k](request);
+
+  const bool instrumented = moveit::tools::probes::isEnabled();
+  const bool count_allocations = exclusive && allocation_counter_;
+  const bool measure_memory = exclusive && resetPeakMemory();
+  ProbeSnapshot probes_before;
+  if (instrumented)
+    probes_before = getProbeSnapshot(exclusive);
+  std::uint64_t allocations = count_allocations ? allocation_counter_() : 0;
+
+  // Solve problem
+  planning_interface::MotionPlanDetailedResponse mp_res;
+  ros::WallTime start = ros::WallTime::now();
+  bool solved = pipeline ? solveWithPipeline(*pipeline, scene, request, mp_res) : context->solve(mp_res);
+  double total_time = (ros::WallTime::now() - start).toSec();
+
+  // Resources used by the planner, not including the metrics collected below
+  if (count_allocations)
+    run_data["allocations INTEGER"] = boost::lexical_cast<std::string>(allocation_counter_() - allocations);
+  if (measure_memory)
+    run_data["peak_memory REAL"] = boost::lexical_cast<std::string>(getPeakMemory());
+  if (instrumented)
+  {
+    ProbeSnapshot probes_after = getProbeSnapshot(exclusive);
+    addProbeMetrics(run_data, "world_collision_check", probes_before, probes_after,
+                    { "CollisionWorldFCL::checkRobotCollision",
+                      "CollisionWorldFCL::checkRobotCollision (continuous)" });
+    addProbeMetrics(run_data, "self_collision_check", probes_before, probes_after,
+                    { "CollisionRobotFCL::checkSelfCollision" });
+    addProbeMetrics(run_data, "state_validity_check", probes_before, probes_after,
+                    { "StateValidityChecker::isValid", "StateValidityChecker::isValid (distance)" });
+    addProbeMetrics(run_data, "fk", probes_before, probes_after, { "RobotState::updateLinkTransforms" });
+    addProbeMetrics(run_data, "ik", probes_before, probes_after, { "RobotState::setFromIK" });
+    if (pipeline)
+    {
+      addProbeMetrics(run_data, "solution_path_check", probes_before, probes_after,
+                      { "PlanningPipeline::checkSolutionPath" });
+      // the time of each adapter excludes the adapters after it and the planner
+      static const std::string ADAPTER_PROBE_PREFIX = "PlanningRequestAdapter::";
+      for (ProbeSnapshot::const_iterator it = probes_after.begin(); it != probes_after.end(); ++it)
+        if (it->first.compare(0, ADAPTER_PROBE_PREFIX.size(), ADAPTER_PROBE_PREFIX) == 0)
+          addProbeMetrics(run_data, getAdapterMetricName(it->first.substr(ADAPTER_PROBE_PREFIX.size())),
+                          probes_before, probes_after, { it->first });
+    }
+  }
+
+  // Collect data
+  start = ros::WallTime::now();
+
+  // Post-run events
+  for (std::size_t k = 0; k < post_event_fns_.size(); ++k)
+    post_event_fns_[k](request, mp_res, run_data);
+  collectMetrics(run_data, mp_res, solved, total_time);
+  double metrics_time = (ros::WallTime::now() - start).toSec();
+  ROS_DEBUG("Spent %lf seconds collecting metrics", metrics_time);
+}
+
+void BenchmarkExecutor::runPlannerParallel(const planning_interface::PlannerManagerPtr& planner_interface,
+                                           const planning_pipeline::PlanningPipelinePtr& pipeline,
+                                           const moveit_msgs::MotionPlanRequest& request,
+                                           PlannerBenchmarkData& planner_data, unsigned int workers,
+                                           boost::progress_display& progress)
+{
+  // Every worker gets its own scene and planning context, which are created up front so that all runs start
+  // from an identical setup and no planner instance is shared between threads
+  std::vector<planning_scene::PlanningScenePtr> scenes(workers);
+  std::vector<moveit_msgs::MotionPlanRequest> requests(workers, request);
+  std::vector<planning_interface::PlanningContextPtr> contexts(workers);
+  for (unsigned int w = 0; w < workers; ++w)
+  {
+    scenes[w] = planning_scene::PlanningScene::clone(planning_scene_);
+    if (pipeline)
+      continue;
+    contexts[w] = planner_interface->getPlanningContext(scenes[w], requests[w]);
+    if (!contexts[w])
+    {
+      ROS_ERROR("Unable to create planning context for worker %u", w);
+      return;
+    }
+  }
+
+  const std::size_t runs = planner_data.size();
+  std::atomic<std::size_t> next(0);
+  boost::mutex progress_lock;
+  auto worker = [&](unsigned int w) {
+    pinThreadToCore(w);
+    for (std::size_t j = next++; j < runs; j = next++)
+    {
+      runPlanner(contexts[w], pipeline, scenes[w], requests[w], planner_data[j], false);
+      boost::mutex::scoped_lock slock(progress_lock);
+      ++progress;
+    }
+  };
+
+  boost::thread_group threads;
+  for (unsigned int w = 0; w < workers; ++w)
+    threads.create_thread(boost::bind<void>(worker, w));
+  threads.join_all();
+}
+
 void BenchmarkExecutor::collectMetrics(PlannerRunData& metrics,
                                        const planning_interface::MotionPlanDetailedResponse& mp_res, bool solved,
                                        double total_time)
@@ -911,7 +1264,7 @@ void BenchmarkExecutor::collectMetrics(PlannerRunData& metrics,
 void BenchmarkExecutor::writeOutput(const BenchmarkRequest& brequest, const std::string& start_time,
                                     double benchmark_duration)
 {
-  const std::map<std::string, std::vector<std::string>>& planners = options_.getPlannerConfigurations();
+  const std::map<std::string, std::vector<std::string>>& planners = benchmark_planners_;
 
   size_t num_planners = 0;
   for (std::map<std::string, std::vector<std::string>>::const_iterator it = planners.begin(); it != planners.end();
@@ -930,7 +1283,11 @@ void BenchmarkExecutor::writeOutput(const BenchmarkRequest& brequest, const std:
   boost::filesystem::create_directories(filename);
 
   filename += (options_.getBenchmarkName().empty() ? "" : options_.getBenchmarkName() + "_") + brequest.name + "_" +
-              getHostname() + "_" + start_time + ".log";
+              getHostname() + "_" + start_time;
+  // shards may share a host and an output directory
+  if (options_.getNumShards() > 1)
+    filename += "_shard" + std::to_string(options_.getShardIndex());
+  filename += ".log";
   std::ofstream out(filename.c_str());
   if (!out)
   {
@@ -35,6 +35,32 @@
 /* Author: Ryan Luna */
 
 #include <moveit/benchmarks/BenchmarkOptions.h>
+#include <sstream>
+
+namespace
+{
+// Read a parameter that is either a single non-negative integer or a list of them
+std::vector<unsigned int> readSweep(ros::NodeHandle& nh, const std::string& name, unsigned int default_value)
+{
+  std::vector<unsigned int> values;
+  XmlRpc::XmlRpcValue param;
+  if (!nh.getParam(name, param))
+    values.push_back(default_value);
+  else if (param.getType() == XmlRpc::XmlRpcValue::TypeInt && static_cast<int>(param) >= 0)
+    values.push_back(static_cast<int>(param));
+  else if (param.getType() == XmlRpc::XmlRpcValue::TypeArray)
+  {
+    for (int i = 0; i < param.size(); ++i)
+      if (param[i].getType() == XmlRpc::XmlRpcValue::TypeInt && static_cast<int>(param[i]) >= 0)
+        values.push_back(static_cast<int>(param[i]));
+      else
+        ROS_WARN("Ignoring invalid value %d of '%s'; expected a non-negative integer", i, name.c_str());
+  }
+  else
+    ROS_WARN("Expected a non-negative integer or a list of them for '%s'", name.c_str());
+  return values;
+}
+}
 
 using namespace moveit_ros_benchmarks;
 
@@ -66,6 +92,7 @@ void BenchmarkOptions::readBenchmarkOptions(const std::string& ros_namespace)
     readWarehouseOptions(nh);
     readBenchmarkParameters(nh);
     readPlannerConfigs(nh);
+    readGeneratedScenes(nh);
   }
   else
   {
@@ -93,6 +120,36 @@ int BenchmarkOptions::getNumRuns() const
   return runs_;
 }
 
+int BenchmarkOptions::getNumWorkers() const
+{
+  return workers_;
+}
+
+int BenchmarkOptions::getShardIndex() const
+{
+  return shard_;
+}
+
+int BenchmarkOptions::getNumShards() const
+{
+  return shards_;
+}
+
+bool BenchmarkOptions::getInstrumentation() const
+{
+  return instrumentation_;
+}
+
+bool BenchmarkOptions::getUsePlanningPipeline() const
+{
+  return use_planning_pipeline_;
+}
+
+const std::vector<std::string>& BenchmarkOptions::getRequestAdapters() const
+{
+  return request_adapters_;
+}
+
 double BenchmarkOptions::getTimeout() const
 {
   return timeout_;
@@ -167,6 +224,11 @@ const moveit_msgs::WorkspaceParameters& BenchmarkOptions::getWorkspaceParameters
   return workspace_;
 }
 
+const std::vector<SceneGenerator::Parameters>& BenchmarkOptions::getGeneratedScenes() const
+{
+  return generated_scenes_;
+}
+
 void BenchmarkOptions::readWarehouseOptions(ros::NodeHandle& nh)
 {
   nh.param(std::string("benchmark_config/warehouse/host"), hostname_, std::string("127.0.0.1"));
@@ -184,7 +246,29 @@ void BenchmarkOptions::readBenchmarkParameters(ros::NodeHandle& nh)
 {
   nh.param(std::string("benchmark_config/parameters/name"), benchmark_name_, std::string(""));
   nh.param(std::string("benchmark_config/parameters/runs"), runs_, 10);
+  nh.param(std::string("benchmark_config/parameters/workers"), workers_, 1);
   nh.param(std::string("benchmark_config/parameters/timeout"), timeout_, 10.0);
+
+  // the (query, planner) pairs of a benchmark can be spread over several machines sharing the warehouse: each machine
+  // is started with the same configuration and its own shard index, and runs every shards-th pair
+  nh.param(std::string("benchmark_config/parameters/shards"), shards_, 1);
+  nh.param(std::string("benchmark_config/parameters/shard"), shard_, 0);
+  if (shards_ < 1 || shard_ < 0 || shard_ >= shards_)
+  {
+    ROS_ERROR("Invalid benchmark shard %d of %d; running all queries and planners", shard_, shards_);
+    shards_ = 1;
+    shard_ = 0;
+  }
+  nh.param(std::string("benchmark_config/parameters/instrumentation"), instrumentation_, true);
+  nh.param(std::string("benchmark_config/parameters/planning_pipeline"), use_planning_pipeline_, false);
+
+  // planning request adapters are given as a space separated list, in the same way as for move_group
+  std::string adapters;
+  nh.param(std::string("benchmark_config/parameters/request_adapters"), adapters, std::string(""));
+  request_adapters_.clear();
+  std::istringstream adapter_stream(adapters);
+  for (std::string adapter; adapter_stream >> adapter;)
+    request_adapters_.push_back(adapter);
   nh.param(std::string("benchmark_config/parameters/output_directory"), output_directory_, std::string(""));
   nh.param(std::string("benchmark_config/parameters/queries"), query_regex_, std::string(".*"));
   nh.param(std::string("benchmark_config/parameters/start_states"), start_state_regex_, std::string(""));
@@ -209,7 +293,13 @@ void BenchmarkOptions::readBenchmarkParameters(ros::NodeHandle& nh)
 
   ROS_INFO("Benchmark name: '%s'", benchmark_name_.c_str());
   ROS_INFO("Benchmark #runs: %d", runs_);
+  ROS_INFO("Benchmark #workers: %d", workers_);
+  if (shards_ > 1)
+    ROS_INFO("Benchmark shard: %d of %d", shard_, shards_);
   ROS_INFO("Benchmark timeout: %f secs", timeout_);
+  ROS_INFO("Benchmark instrumentation: %s", instrumentation_ ? "enabled" : "disabled");
+  if (use_planning_pipeline_)
+    ROS_INFO("Benchmark planning pipeline with request adapters: '%s'", adapters.c_str());
   ROS_INFO("Benchmark group: %s", group_name_.c_str());
   ROS_INFO("Benchmark query regex: '%s'", query_regex_.c_str());
   ROS_INFO("Benchmark start state regex: '%s':", start_state_regex_.c_str());
@@ -284,3 +374,47 @@ void BenchmarkOptions::readPlannerConfigs(ros::NodeHandle& nh)
     }
   }
 }
+
+void BenchmarkOptions::readGeneratedScenes(ros::NodeHandle& nh)
+{
+  generated_scenes_.clear();
+  if (!nh.hasParam("benchmark_config/generated_scenes"))
+    return;
+
+  // the common parameters of all generated scenes
+  SceneGenerator::Parameters base;
+  int seed;
+  nh.param(std::string("benchmark_config/generated_scenes/seed"), seed, 0);
+  base.seed = seed;
+  nh.param(std::string("benchmark_config/generated_scenes/voxel_resolution"), base.voxel_resolution, 0.02);
+  nh.param(std::string("benchmark_config/generated_scenes/min_size"), base.min_size, 0.05);
+  nh.param(std::string("benchmark_config/generated_scenes/max_size"), base.max_size, 0.2);
+  nh.param(std::string("benchmark_config/generated_scenes/frame_id"), base.frame_id, std::string(""));
+  nh.param(std::string("benchmark_config/generated_scenes/min_corner/x"), base.min_corner.x, -1.0);
+  nh.param(std::string("benchmark_config/generated_scenes/min_corner/y"), base.min_corner.y, -1.0);
+  nh.param(std::string("benchmark_config/generated_scenes/min_corner/z"), base.min_corner.z, 0.0);
+  nh.param(std::string("benchmark_config/generated_scenes/max_corner/x"), base.max_corner.x, 1.0);
+  nh.param(std::string("benchmark_config/generated_scenes/max_corner/y"), base.max_corner.y, 1.0);
+  nh.param(std::string("benchmark_config/generated_scenes/max_corner/z"), base.max_corner.z, 1.5);
+
+  // the swept parameters; a scene is generated for every combination of their values
+  std::vector<unsigned int> primitives = readSweep(nh, "benchmark_config/generated_scenes/primitives", 0);
+  std::vector<unsigned int> meshes = readSweep(nh, "benchmark_config/generated_scenes/meshes", 0);
+  std::vector<unsigned int> triangles = readSweep(nh, "benchmark_config/generated_scenes/mesh_triangles", 200);
+  std::vector<unsigned int> voxels = readSweep(nh, "benchmark_config/generated_scenes/voxels", 0);
+
+  for (std::size_t p = 0; p < primitives.size(); ++p)
+    for (std::size_t m = 0; m < meshes.size(); ++m)
+      for (std::size_t t = 0; t < triangles.size(); ++t)
+        for (std::size_t v = 0; v < voxels.size(); ++v)
+        {
+          SceneGenerator::Parameters params = base;
+          params.primitives = primitives[p];
+          params.meshes = meshes[m];
+          params.mesh_triangles = triangles[t];
+          params.voxels = voxels[v];
+          generated_scenes_.push_back(params);
+        }
+
+  ROS_INFO("Benchmarking %lu generated scenes", generated_scenes_.size());
+}
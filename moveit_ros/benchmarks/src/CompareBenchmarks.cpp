@@ -0,0 +1,101 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/benchmarks/BenchmarkComparison.h>
+#include <boost/program_options/cmdline.hpp>
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <cstdio>
+#include <iostream>
+
+// Compare a candidate benchmark against a baseline and exit with a nonzero status if planning time regressed
+int main(int argc, char** argv)
+{
+  namespace po = boost::program_options;
+  po::options_description desc("Usage: moveit_compare_benchmarks --baseline LOGS... --candidate LOGS... [options]\n"
+                               "LOGS are benchmark log files or directories of them");
+  desc.add_options()("help", "Show help message")(
+      "baseline", po::value<std::vector<std::string>>()->multitoken()->required(), "Logs of the baseline benchmark")(
+      "candidate", po::value<std::vector<std::string>>()->multitoken()->required(), "Logs of the candidate benchmark")(
+      "time-threshold", po::value<double>()->default_value(0.1),
+      "Relative increase of the median planning time that counts as a regression")(
+      "significance", po::value<double>()->default_value(0.05), "Significance level of the statistical tests");
+
+  po::variables_map vm;
+  try
+  {
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    if (vm.count("help"))
+    {
+      std::cout << desc << std::endl;
+      return 0;
+    }
+    po::notify(vm);
+  }
+  catch (po::error& e)
+  {
+    std::cerr << e.what() << std::endl << desc << std::endl;
+    return 2;
+  }
+
+  moveit_ros_benchmarks::BenchmarkResults baseline, candidate;
+  if (!moveit_ros_benchmarks::loadBenchmarkLogs(vm["baseline"].as<std::vector<std::string>>(), baseline) ||
+      !moveit_ros_benchmarks::loadBenchmarkLogs(vm["candidate"].as<std::vector<std::string>>(), candidate))
+    return 2;
+
+  moveit_ros_benchmarks::BenchmarkComparison comparison(vm["time-threshold"].as<double>(),
+                                                        vm["significance"].as<double>());
+  std::vector<moveit_ros_benchmarks::MetricComparison> comparisons;
+  bool passed = comparison.compare(baseline, candidate, comparisons);
+
+  std::printf("%-24s %-28s %-24s %12s %12s %8s %10s\n", "experiment", "planner", "metric", "baseline", "candidate",
+              "change", "p-value");
+  for (std::size_t i = 0; i < comparisons.size(); ++i)
+  {
+    const moveit_ros_benchmarks::MetricComparison& c = comparisons[i];
+    double change = c.baseline_value != 0.0 ? 100.0 * (c.candidate_value - c.baseline_value) / c.baseline_value : 0.0;
+    std::printf("%-24s %-28s %-24s %12.6g %12.6g %7.1f%% %10.4g%s\n", c.experiment.c_str(), c.planner.c_str(),
+                c.metric.c_str(), c.baseline_value, c.candidate_value, change, c.p_value,
+                c.regression ? "  REGRESSION" : "");
+  }
+
+  if (!passed)
+  {
+    std::cout << "Planning time regressed by more than " << 100.0 * vm["time-threshold"].as<double>() << "%"
+              << std::endl;
+    return 1;
+  }
+  return 0;
+}
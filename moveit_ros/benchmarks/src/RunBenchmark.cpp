@@ -35,11 +35,38 @@
 /* Author: Ryan Luna */
 
 #include <ros/ros.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
 #include <string>
 
 #include <moveit/benchmarks/BenchmarkOptions.h>
 #include <moveit/benchmarks/BenchmarkExecutor.h>
 
+// Heap allocations are counted only while runs execute one at a time, so workers do not contend on the counter
+static std::atomic<bool> count_allocations(false);
+static std::atomic<std::uint64_t> allocations(0);
+
+void* operator new(std::size_t size)
+{
+  if (count_allocations.load(std::memory_order_relaxed))
+    allocations.fetch_add(1, std::memory_order_relaxed);
+  void* ptr = std::malloc(size ? size : 1);
+  if (!ptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+static std::uint64_t getAllocationCount()
+{
+  return allocations.load(std::memory_order_relaxed);
+}
+
 int main(int argc, char** argv)
 {
   ros::init(argc, argv, "moveit_run_benchmark");
@@ -54,6 +81,11 @@ int main(int argc, char** argv)
   std::vector<std::string> plugins;
   opts.getPlannerPluginList(plugins);
   server.initialize(plugins);
+  if (opts.getNumWorkers() <= 1)
+  {
+    count_allocations = true;
+    server.setAllocationCounter(&getAllocationCount);
+  }
 
   // Running benchmarks
   if (!server.runBenchmarks(opts))
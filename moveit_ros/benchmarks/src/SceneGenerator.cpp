@@ -0,0 +1,218 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/benchmarks/SceneGenerator.h>
+#include <octomap/octomap.h>
+#include <octomap_msgs/conversions.h>
+#include <boost/math/constants/constants.hpp>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+using namespace moveit_ros_benchmarks;
+
+const std::string SceneGenerator::OBJECT_PREFIX = "generated_";
+
+SceneGenerator::Parameters::Parameters()
+  : primitives(0)
+  , meshes(0)
+  , mesh_triangles(200)
+  , voxels(0)
+  , voxel_resolution(0.02)
+  , min_size(0.05)
+  , max_size(0.2)
+  , seed(0)
+{
+}
+
+std::string SceneGenerator::Parameters::getName() const
+{
+  std::stringstream ss;
+  ss << "p" << primitives << "_m" << meshes << "x" << mesh_triangles << "_v" << voxels;
+  return ss.str();
+}
+
+namespace
+{
+void randomPose(random_numbers::RandomNumberGenerator& rng, const SceneGenerator::Parameters& params,
+                geometry_msgs::Pose& pose)
+{
+  pose.position.x = rng.uniformReal(params.min_corner.x, params.max_corner.x);
+  pose.position.y = rng.uniformReal(params.min_corner.y, params.max_corner.y);
+  pose.position.z = rng.uniformReal(params.min_corner.z, params.max_corner.z);
+  double q[4];
+  rng.quaternion(q);
+  pose.orientation.x = q[0];
+  pose.orientation.y = q[1];
+  pose.orientation.z = q[2];
+  pose.orientation.w = q[3];
+}
+
+moveit_msgs::CollisionObject& addObject(const SceneGenerator::Parameters& params, const std::string& kind,
+                                        unsigned int index, moveit_msgs::PlanningSceneWorld& world)
+{
+  world.collision_objects.resize(world.collision_objects.size() + 1);
+  moveit_msgs::CollisionObject& object = world.collision_objects.back();
+  std::stringstream ss;
+  ss << SceneGenerator::OBJECT_PREFIX << kind << "_" << index;
+  object.id = ss.str();
+  object.header.frame_id = params.frame_id;
+  object.operation = moveit_msgs::CollisionObject::ADD;
+  return object;
+}
+}
+
+void SceneGenerator::generate(const Parameters& params, moveit_msgs::PlanningSceneWorld& world)
+{
+  world.collision_objects.clear();
+  world.octomap = octomap_msgs::OctomapWithPose();
+
+  // separate streams, so that e.g. more meshes do not change the primitives
+  random_numbers::RandomNumberGenerator primitive_rng(params.seed);
+  random_numbers::RandomNumberGenerator mesh_rng(params.seed + 1);
+  random_numbers::RandomNumberGenerator voxel_rng(params.seed + 2);
+
+  for (unsigned int i = 0; i < params.primitives; ++i)
+  {
+    moveit_msgs::CollisionObject& object = addObject(params, "primitive", i, world);
+    shape_msgs::SolidPrimitive primitive;
+    switch (primitive_rng.uniformInteger(0, 2))
+    {
+      case 0:
+        primitive.type = shape_msgs::SolidPrimitive::BOX;
+        primitive.dimensions.resize(3);
+        for (std::size_t j = 0; j < 3; ++j)
+          primitive.dimensions[j] = primitive_rng.uniformReal(params.min_size, params.max_size);
+        break;
+      case 1:
+        primitive.type = shape_msgs::SolidPrimitive::SPHERE;
+        primitive.dimensions.resize(1);
+        primitive.dimensions[shape_msgs::SolidPrimitive::SPHERE_RADIUS] =
+            primitive_rng.uniformReal(params.min_size, params.max_size) / 2.0;
+        break;
+      default:
+        primitive.type = shape_msgs::SolidPrimitive::CYLINDER;
+        primitive.dimensions.resize(2);
+        primitive.dimensions[shape_msgs::SolidPrimitive::CYLINDER_HEIGHT] =
+            primitive_rng.uniformReal(params.min_size, params.max_size);
+        primitive.dimensions[shape_msgs::SolidPrimitive::CYLINDER_RADIUS] =
+            primitive_rng.uniformReal(params.min_size, params.max_size) / 2.0;
+        break;
+    }
+    object.primitives.push_back(primitive);
+    object.primitive_poses.resize(1);
+    randomPose(primitive_rng, params, object.primitive_poses[0]);
+  }
+
+  for (unsigned int i = 0; i < params.meshes; ++i)
+  {
+    moveit_msgs::CollisionObject& object = addObject(params, "mesh", i, world);
+    object.meshes.resize(1);
+    createMesh(mesh_rng, params.mesh_triangles, mesh_rng.uniformReal(params.min_size, params.max_size),
+               object.meshes[0]);
+    object.mesh_poses.resize(1);
+    randomPose(mesh_rng, params, object.mesh_poses[0]);
+  }
+
+  if (params.voxels == 0 || params.voxel_resolution <= 0.0)
+    return;
+
+  // draw distinct voxels; a box too small for the requested number of voxels is filled as far as the attempts go
+  octomap::OcTree tree(params.voxel_resolution);
+  octomap::KeySet keys;
+  for (std::size_t attempt = 0; keys.size() < params.voxels && attempt < 10 * std::size_t(params.voxels); ++attempt)
+  {
+    octomap::OcTreeKey key;
+    if (tree.coordToKeyChecked(voxel_rng.uniformReal(params.min_corner.x, params.max_corner.x),
+                               voxel_rng.uniformReal(params.min_corner.y, params.max_corner.y),
+                               voxel_rng.uniformReal(params.min_corner.z, params.max_corner.z), key))
+      keys.insert(key);
+  }
+  for (octomap::KeySet::const_iterator it = keys.begin(); it != keys.end(); ++it)
+    tree.updateNode(*it, true);
+
+  world.octomap.header.frame_id = params.frame_id;
+  world.octomap.origin.orientation.w = 1.0;
+  octomap_msgs::binaryMapToMsg(tree, world.octomap.octomap);
+  world.octomap.octomap.header.frame_id = params.frame_id;
+}
+
+void SceneGenerator::createMesh(random_numbers::RandomNumberGenerator& rng, unsigned int triangles, double size,
+                                shape_msgs::Mesh& mesh)
+{
+  // a sphere of rings x 2 rings segments has 4 rings (rings - 1) triangles; every vertex gets a random radius
+  const unsigned int rings = std::max(2u, static_cast<unsigned int>(std::lround((1.0 + std::sqrt(triangles)) / 2.0)));
+  const unsigned int segments = 2 * rings;
+  const double pi = boost::math::constants::pi<double>();
+
+  mesh.vertices.clear();
+  mesh.triangles.clear();
+  mesh.vertices.resize(2 + (rings - 1) * segments);
+  mesh.vertices[0].z = rng.uniformReal(size / 4.0, size / 2.0);
+  mesh.vertices[1].z = -rng.uniformReal(size / 4.0, size / 2.0);
+  for (unsigned int k = 1; k < rings; ++k)
+    for (unsigned int j = 0; j < segments; ++j)
+    {
+      const double theta = pi * k / rings;
+      const double phi = 2.0 * pi * j / segments;
+      const double r = rng.uniformReal(size / 4.0, size / 2.0);
+      geometry_msgs::Point& p = mesh.vertices[2 + (k - 1) * segments + j];
+      p.x = r * std::sin(theta) * std::cos(phi);
+      p.y = r * std::sin(theta) * std::sin(phi);
+      p.z = r * std::cos(theta);
+    }
+
+  shape_msgs::MeshTriangle t;
+  for (unsigned int j = 0; j < segments; ++j)
+  {
+    const unsigned int next = (j + 1) % segments;
+    const unsigned int top = 2;
+    const unsigned int bottom = 2 + (rings - 2) * segments;
+
+    t.vertex_indices = { 0, top + j, top + next };
+    mesh.triangles.push_back(t);
+    t.vertex_indices = { 1, bottom + next, bottom + j };
+    mesh.triangles.push_back(t);
+
+    for (unsigned int k = 1; k + 1 < rings; ++k)
+    {
+      const unsigned int a = 2 + (k - 1) * segments;
+      const unsigned int b = a + segments;
+      t.vertex_indices = { a + j, b + j, b + next };
+      mesh.triangles.push_back(t);
+      t.vertex_indices = { a + j, b + next, a + next };
+      mesh.triangles.push_back(t);
+    }
+  }
+}
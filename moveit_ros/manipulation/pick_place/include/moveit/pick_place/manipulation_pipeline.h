@@ -97,12 +97,17 @@ public:
 protected:
   void processingThread(unsigned int index);
 
+  /** \brief Return the index of the last stage with plans waiting, or -1 if all queues are empty. Call this with
+   *  queue_access_lock_ held */
+  int deepestWaitingStage() const;
+
   std::string name_;
   unsigned int nthreads_;
   bool verbose_;
   std::vector<ManipulationStagePtr> stages_;
 
-  std::deque<ManipulationPlanPtr> queue_;
+  /** \brief One queue per stage, holding the plans waiting to be evaluated by that stage */
+  std::vector<std::deque<ManipulationPlanPtr> > queues_;
   std::vector<ManipulationPlanPtr> success_;
   std::vector<ManipulationPlanPtr> failed_;
 
@@ -42,9 +42,11 @@
 #include <moveit/pick_place/pick_place_params.h>
 #include <moveit/constraint_sampler_manager_loader/constraint_sampler_manager_loader.h>
 #include <moveit/planning_pipeline/planning_pipeline.h>
+#include <moveit/reachability_map/reachability_map.h>
 #include <moveit_msgs/PickupAction.h>
 #include <moveit_msgs/PlaceAction.h>
 #include <boost/noncopyable.hpp>
+#include <map>
 #include <memory>
 
 namespace pick_place
@@ -149,6 +151,10 @@ public:
 
   void visualizeGrasps(const std::vector<ManipulationPlanPtr>& plans) const;
 
+  /** \brief Get the reachability map of \e group, loaded on first use from the file named by the
+   *  ~reachability_maps/<group> parameter. Returns an empty pointer if no map is configured for the group. */
+  reachability_map::ReachabilityMapConstPtr getReachabilityMap(const std::string& group) const;
+
 private:
   ros::NodeHandle nh_;
   planning_pipeline::PlanningPipelinePtr planning_pipeline_;
@@ -157,6 +163,9 @@ private:
   ros::Publisher display_path_publisher_;
   ros::Publisher grasps_publisher_;
 
+  mutable boost::mutex reachability_maps_lock_;
+  mutable std::map<std::string, reachability_map::ReachabilityMapConstPtr> reachability_maps_;
+
   constraint_sampler_manager_loader::ConstraintSamplerManagerLoaderPtr constraint_sampler_manager_loader_;
 };
 }
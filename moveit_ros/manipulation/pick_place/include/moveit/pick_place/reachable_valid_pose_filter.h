@@ -40,6 +40,7 @@
 #include <moveit/pick_place/manipulation_stage.h>
 #include <moveit/constraint_samplers/constraint_sampler_manager.h>
 #include <moveit/planning_scene/planning_scene.h>
+#include <moveit/reachability_map/reachability_map.h>
 
 namespace pick_place
 {
@@ -52,12 +53,26 @@ public:
 
   virtual bool evaluate(const ManipulationPlanPtr& plan) const;
 
+  /** \brief Reorder \e plans so the candidates most likely to pass this filter come first, keeping their relative
+   *  order otherwise. This is a cheap pre-pass meant to run before the plans enter the pipeline: the end-effector is
+   *  checked for collisions at each goal pose, and IK is solved for all the poses in one batch, without collision
+   *  checking or multiple attempts. Candidates with a free end-effector and an IK solution go first, followed by the
+   *  ones with a free end-effector only, followed by the rest. All plans must share the same shared_data_. */
+  void rankPlans(std::vector<ManipulationPlanPtr>& plans) const;
+
+  /** \brief Use \e map in rankPlans(): candidates outside of it are ranked last without solving IK for them */
+  void setReachabilityMap(const reachability_map::ReachabilityMapConstPtr& map)
+  {
+    reachability_map_ = map;
+  }
+
 private:
   bool isEndEffectorFree(const ManipulationPlanPtr& plan, robot_state::RobotState& token_state) const;
 
   planning_scene::PlanningSceneConstPtr planning_scene_;
   collision_detection::AllowedCollisionMatrixConstPtr collision_matrix_;
   constraint_samplers::ConstraintSamplerManagerPtr constraints_sampler_manager_;
+  reachability_map::ReachabilityMapConstPtr reachability_map_;
 };
 }
 
@@ -54,6 +54,7 @@ ManipulationPipeline& ManipulationPipeline::addStage(const ManipulationStagePtr&
 {
   next->setVerbose(verbose_);
   stages_.push_back(next);
+  queues_.resize(stages_.size());
   return *this;
 }
 
@@ -83,6 +84,7 @@ void ManipulationPipeline::reset()
 {
   clear();
   stages_.clear();
+  queues_.clear();
 }
 
 void ManipulationPipeline::setVerbose(bool flag)
@@ -97,7 +99,8 @@ void ManipulationPipeline::clear()
   stop();
   {
     boost::mutex::scoped_lock slock(queue_access_lock_);
-    queue_.clear();
+    for (std::size_t i = 0; i < queues_.size(); ++i)
+      queues_[i].clear();
   }
   {
     boost::mutex::scoped_lock slock(result_lock_);
@@ -137,70 +140,85 @@ void ManipulationPipeline::stop()
     }
 }
 
+int ManipulationPipeline::deepestWaitingStage() const
+{
+  for (int i = static_cast<int>(queues_.size()) - 1; i >= 0; --i)
+    if (!queues_[i].empty())
+      return i;
+  return -1;
+}
+
 void ManipulationPipeline::processingThread(unsigned int index)
 {
   ROS_DEBUG_STREAM_NAMED("manipulation", "Start thread " << index << " for '" << name_ << "'");
 
+  // Each iteration evaluates a single stage for a single plan. Plans that passed a stage are queued for the next one,
+  // so cheap filtering stages keep running ahead while other threads plan. Plans further down the pipeline are
+  // closer to a solution, so they are always taken first.
+  boost::unique_lock<boost::mutex> ulock(queue_access_lock_);
   while (!stop_processing_)
   {
-    bool inc_queue = false;
-    boost::unique_lock<boost::mutex> ulock(queue_access_lock_);
-    // if the queue is empty, we trigger the corresponding event
-    if (queue_.empty() && !stop_processing_ && empty_queue_callback_)
+    int stage = deepestWaitingStage();
+    if (stage < 0)
     {
-      empty_queue_threads_++;
-      inc_queue = true;
-      if (empty_queue_threads_ == processing_threads_.size())
-        empty_queue_callback_();
+      // if all the queues are empty, we trigger the corresponding event
+      if (empty_queue_callback_)
+      {
+        empty_queue_threads_++;
+        if (empty_queue_threads_ == processing_threads_.size())
+          empty_queue_callback_();
+      }
+      while ((stage = deepestWaitingStage()) < 0 && !stop_processing_)
+        queue_access_cond_.wait(ulock);
+      if (empty_queue_callback_)
+        empty_queue_threads_--;
+      continue;
     }
-    while (queue_.empty() && !stop_processing_)
-      queue_access_cond_.wait(ulock);
-    while (!stop_processing_ && !queue_.empty())
+
+    ManipulationPlanPtr g = queues_[stage].front();
+    queues_[stage].pop_front();
+    ulock.unlock();
+
+    bool res = false;
+    try
     {
-      ManipulationPlanPtr g = queue_.front();
-      queue_.pop_front();
-      if (inc_queue)
+      if (stage == 0)
+        g->error_code_.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+      res = stages_[stage]->evaluate(g);
+      g->processing_stage_ = stage + 1;
+      if (res == false)
       {
-        empty_queue_threads_--;
-        inc_queue = false;
+        boost::mutex::scoped_lock slock(result_lock_);
+        failed_.push_back(g);
+        ROS_INFO_STREAM_NAMED("manipulation", "Manipulation plan " << g->id_ << " failed at stage '"
+                                                                   << stages_[stage]->getName() << "' on thread "
+                                                                   << index);
       }
-
-      queue_access_lock_.unlock();
-      try
+      else if (stage + 1 == static_cast<int>(stages_.size()) &&
+               g->error_code_.val == moveit_msgs::MoveItErrorCodes::SUCCESS)
       {
-        g->error_code_.val = moveit_msgs::MoveItErrorCodes::FAILURE;
-        for (std::size_t i = 0; !stop_processing_ && i < stages_.size(); ++i)
+        g->processing_stage_++;
         {
-          bool res = stages_[i]->evaluate(g);
-          g->processing_stage_ = i + 1;
-          if (res == false)
-          {
-            boost::mutex::scoped_lock slock(result_lock_);
-            failed_.push_back(g);
-            ROS_INFO_STREAM_NAMED("manipulation", "Manipulation plan " << g->id_ << " failed at stage '"
-                                                                       << stages_[i]->getName() << "' on thread "
-                                                                       << index);
-            break;
-          }
+          boost::mutex::scoped_lock slock(result_lock_);
+          success_.push_back(g);
         }
-        if (g->error_code_.val == moveit_msgs::MoveItErrorCodes::SUCCESS)
-        {
-          g->processing_stage_++;
-          {
-            boost::mutex::scoped_lock slock(result_lock_);
-            success_.push_back(g);
-          }
-          signalStop();
-          ROS_INFO_STREAM_NAMED("manipulation", "Found successful manipulation plan!");
-          if (solution_callback_)
-            solution_callback_();
-        }
-      }
-      catch (std::exception& ex)
-      {
-        ROS_ERROR_NAMED("manipulation", "[%s:%u] %s", name_.c_str(), index, ex.what());
+        signalStop();
+        ROS_INFO_STREAM_NAMED("manipulation", "Found successful manipulation plan!");
+        if (solution_callback_)
+          solution_callback_();
       }
-      queue_access_lock_.lock();
+    }
+    catch (std::exception& ex)
+    {
+      res = false;
+      ROS_ERROR_NAMED("manipulation", "[%s:%u] %s", name_.c_str(), index, ex.what());
+    }
+
+    ulock.lock();
+    if (res && stage + 1 < static_cast<int>(stages_.size()))
+    {
+      queues_[stage + 1].push_back(g);
+      queue_access_cond_.notify_one();
     }
   }
 }
@@ -208,9 +226,14 @@ void ManipulationPipeline::processingThread(unsigned int index)
 void ManipulationPipeline::push(const ManipulationPlanPtr& plan)
 {
   boost::mutex::scoped_lock slock(queue_access_lock_);
-  queue_.push_back(plan);
+  if (queues_.empty())
+  {
+    ROS_ERROR_NAMED("manipulation", "Pipeline '%s' has no stages to process plans", name_.c_str());
+    return;
+  }
+  queues_[0].push_back(plan);
   ROS_INFO_STREAM_NAMED("manipulation", "Added plan for pipeline '" << name_ << "'. Queue is now of size "
-                                                                    << queue_.size());
+                                                                    << queues_[0].size());
   queue_access_cond_.notify_all();
 }
 
@@ -222,9 +245,11 @@ void ManipulationPipeline::reprocessLastFailure()
   ManipulationPlanPtr plan = failed_.back();
   failed_.pop_back();
   plan->clear();
-  queue_.push_back(plan);
+  if (queues_.empty())
+    return;
+  queues_[0].push_back(plan);
   ROS_INFO_STREAM_NAMED("manipulation", "Re-added last failed plan for pipeline '"
-                                            << name_ << "'. Queue is now of size " << queue_.size());
+                                            << name_ << "'. Queue is now of size " << queues_[0].size());
   queue_access_cond_.notify_all();
 }
 }
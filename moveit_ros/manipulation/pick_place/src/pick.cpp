@@ -158,8 +158,10 @@ bool PickPlan::plan(const planning_scene::PlanningSceneConstPtr& planning_scene,
 
   // configure the manipulation pipeline
   pipeline_.reset();
-  ManipulationStagePtr stage1(
+  std::shared_ptr<ReachableAndValidPoseFilter> pose_filter(
       new ReachableAndValidPoseFilter(planning_scene, approach_grasp_acm, pick_place_->getConstraintsSamplerManager()));
+  pose_filter->setReachabilityMap(pick_place_->getReachabilityMap(planning_group));
+  ManipulationStagePtr stage1(pose_filter);
   ManipulationStagePtr stage2(new ApproachAndTranslateStage(planning_scene, approach_grasp_acm));
   ManipulationStagePtr stage3(new PlanStage(planning_scene, pick_place_->getPlanningPipeline()));
   pipeline_.addStage(stage1).addStage(stage2).addStage(stage3);
@@ -175,6 +177,7 @@ bool PickPlan::plan(const planning_scene::PlanningSceneConstPtr& planning_scene,
   std::sort(grasp_order.begin(), grasp_order.end(), oq);
 
   // feed the available grasps to the stages we set up
+  std::vector<ManipulationPlanPtr> plans;
   for (std::size_t i = 0; i < goal.possible_grasps.size(); ++i)
   {
     ManipulationPlanPtr p(new ManipulationPlan(const_plan_data));
@@ -188,9 +191,14 @@ bool PickPlan::plan(const planning_scene::PlanningSceneConstPtr& planning_scene,
       p->goal_pose_.header.frame_id = goal.target_name;
     p->approach_posture_ = g.pre_grasp_posture;
     p->retreat_posture_ = g.grasp_posture;
-    pipeline_.push(p);
+    plans.push_back(p);
   }
 
+  // try the grasps that are likely to be reachable first
+  pose_filter->rankPlans(plans);
+  for (std::size_t i = 0; i < plans.size(); ++i)
+    pipeline_.push(plans[i]);
+
   // wait till we're done
   waitForPipeline(endtime);
   pipeline_.stop();
@@ -99,6 +99,32 @@ PickPlace::PickPlace(const planning_pipeline::PlanningPipelinePtr& planning_pipe
   constraint_sampler_manager_loader_.reset(new constraint_sampler_manager_loader::ConstraintSamplerManagerLoader());
 }
 
+reachability_map::ReachabilityMapConstPtr PickPlace::getReachabilityMap(const std::string& group) const
+{
+  boost::mutex::scoped_lock slock(reachability_maps_lock_);
+  std::map<std::string, reachability_map::ReachabilityMapConstPtr>::const_iterator it = reachability_maps_.find(group);
+  if (it != reachability_maps_.end())
+    return it->second;
+
+  // remember failures too, so the parameter is only looked up once per group
+  reachability_map::ReachabilityMapConstPtr& map = reachability_maps_[group];
+  std::string filename;
+  if (nh_.getParam("reachability_maps/" + group, filename))
+  {
+    reachability_map::ReachabilityMapPtr loaded = reachability_map::ReachabilityMap::load(filename);
+    if (loaded && loaded->getGroupName() != group)
+      ROS_ERROR_NAMED("manipulation", "Reachability map '%s' was built for group '%s', not '%s'", filename.c_str(),
+                      loaded->getGroupName().c_str(), group.c_str());
+    else if (loaded)
+    {
+      ROS_INFO_NAMED("manipulation", "Loaded reachability map for group '%s' from '%s'", group.c_str(),
+                     filename.c_str());
+      map = loaded;
+    }
+  }
+  return map;
+}
+
 void PickPlace::displayProcessedGrasps(bool flag)
 {
   if (display_grasps_ && !flag)
@@ -292,8 +292,10 @@ bool PlacePlan::plan(const planning_scene::PlanningSceneConstPtr& planning_scene
   // configure the manipulation pipeline
   pipeline_.reset();
 
-  ManipulationStagePtr stage1(
+  std::shared_ptr<ReachableAndValidPoseFilter> pose_filter(
       new ReachableAndValidPoseFilter(planning_scene, approach_place_acm, pick_place_->getConstraintsSamplerManager()));
+  pose_filter->setReachabilityMap(pick_place_->getReachabilityMap(plan_data->planning_group_->getName()));
+  ManipulationStagePtr stage1(pose_filter);
   ManipulationStagePtr stage2(new ApproachAndTranslateStage(planning_scene, approach_place_acm));
   ManipulationStagePtr stage3(new PlanStage(planning_scene, pick_place_->getPlanningPipeline()));
   pipeline_.addStage(stage1).addStage(stage2).addStage(stage3);
@@ -303,6 +305,7 @@ bool PlacePlan::plan(const planning_scene::PlanningSceneConstPtr& planning_scene
   pipeline_.start();
 
   // add possible place locations
+  std::vector<ManipulationPlanPtr> plans;
   for (std::size_t i = 0; i < goal.place_locations.size(); ++i)
   {
     ManipulationPlanPtr p(new ManipulationPlan(const_plan_data));
@@ -326,8 +329,13 @@ bool PlacePlan::plan(const planning_scene::PlanningSceneConstPtr& planning_scene
     p->id_ = i;
     if (p->retreat_posture_.joint_names.empty())
       p->retreat_posture_ = attached_body->getDetachPosture();
-    pipeline_.push(p);
+    plans.push_back(p);
   }
+
+  // try the locations that are likely to be reachable first
+  pose_filter->rankPlans(plans);
+  for (std::size_t i = 0; i < plans.size(); ++i)
+    pipeline_.push(plans[i]);
   ROS_INFO_NAMED("manipulation", "Added %d place locations", (int)goal.place_locations.size());
 
   // wait till we're done
@@ -39,6 +39,7 @@
 #include <eigen_conversions/eigen_msg.h>
 #include <boost/bind.hpp>
 #include <ros/console.h>
+#include <algorithm>
 
 pick_place::ReachableAndValidPoseFilter::ReachableAndValidPoseFilter(
     const planning_scene::PlanningSceneConstPtr& scene,
@@ -104,6 +105,79 @@ bool pick_place::ReachableAndValidPoseFilter::isEndEffectorFree(const Manipulati
   return res.collision == false;
 }
 
+void pick_place::ReachableAndValidPoseFilter::rankPlans(std::vector<ManipulationPlanPtr>& plans) const
+{
+  if (plans.size() < 2)
+    return;
+
+  const ManipulationPlanSharedDataConstPtr& shared_data = plans.front()->shared_data_;
+  robot_state::RobotState token_state(planning_scene_->getCurrentState());
+
+  // 0: free end-effector and reachable; 1: free end-effector only; 2: end-effector in collision
+  std::vector<int> rank(plans.size(), 2);
+  std::vector<std::size_t> free_plans;
+  EigenSTL::vector_Affine3d ik_link_poses;
+  const reachability_map::ReachabilityMap* map =
+      reachability_map_ && reachability_map_->getTipLink() == shared_data->ik_link_->getName() ?
+          reachability_map_.get() :
+          NULL;
+  for (std::size_t i = 0; i < plans.size(); ++i)
+  {
+    // start from the scene state each time, since attached bodies that define goal frames move with the end-effector
+    if (i > 0)
+      token_state = planning_scene_->getCurrentState();
+    if (isEndEffectorFree(plans[i], token_state) &&
+        (!map || map->isReachable(token_state, plans[i]->transformed_goal_pose_)))
+    {
+      // isEndEffectorFree() leaves the transformed goal pose of the ik link in the plan
+      rank[i] = 1;
+      free_plans.push_back(i);
+      ik_link_poses.push_back(plans[i]->transformed_goal_pose_);
+    }
+  }
+
+  // the batch query needs a solver for exactly the ik link, in the frame of the solver
+  const robot_model::JointModelGroup* group = shared_data->planning_group_;
+  const kinematics::KinematicsBaseConstPtr& solver = group->getSolverInstance();
+  if (!free_plans.empty() && solver && solver->getTipFrames().size() == 1)
+  {
+    std::string tip = solver->getTipFrames().front();
+    std::string base = solver->getBaseFrame();
+    if (!tip.empty() && tip[0] == '/')
+      tip = tip.substr(1);
+    if (!base.empty() && base[0] == '/')
+      base = base.substr(1);
+    if (tip == shared_data->ik_link_->getName() && token_state.knowsFrameTransform(base))
+    {
+      token_state = planning_scene_->getCurrentState();
+      const Eigen::Affine3d base_inv = token_state.getFrameTransform(base).inverse();
+      for (std::size_t i = 0; i < ik_link_poses.size(); ++i)
+        ik_link_poses[i] = base_inv * ik_link_poses[i];
+
+      std::vector<std::vector<double> > seed(1);
+      token_state.copyJointGroupPositions(group, seed[0]);
+      std::vector<std::vector<double> > solutions;
+      std::vector<moveit_msgs::MoveItErrorCodes> error_codes;
+      solver->searchPositionIKBatch(ik_link_poses, seed, group->getDefaultIKTimeout(), solutions, error_codes);
+      for (std::size_t i = 0; i < free_plans.size() && i < error_codes.size(); ++i)
+        if (error_codes[i].val == moveit_msgs::MoveItErrorCodes::SUCCESS)
+          rank[free_plans[i]] = 0;
+    }
+  }
+
+  std::vector<std::size_t> order(plans.size());
+  for (std::size_t i = 0; i < order.size(); ++i)
+    order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&rank](std::size_t a, std::size_t b) { return rank[a] < rank[b]; });
+  std::vector<ManipulationPlanPtr> ranked(plans.size());
+  for (std::size_t i = 0; i < order.size(); ++i)
+    ranked[i] = plans[order[i]];
+  plans.swap(ranked);
+
+  ROS_DEBUG_NAMED("manipulation", "Ranked %u candidates: %u with a free and reachable end-effector pose",
+                  (unsigned int)plans.size(), (unsigned int)std::count(rank.begin(), rank.end(), 0));
+}
+
 bool pick_place::ReachableAndValidPoseFilter::evaluate(const ManipulationPlanPtr& plan) const
 {
   // initialize with scene state
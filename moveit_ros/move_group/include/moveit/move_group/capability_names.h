@@ -70,18 +70,38 @@ static const std::string GET_PLANNER_PARAMS_SERVICE_NAME =
 static const std::string SET_PLANNER_PARAMS_SERVICE_NAME =
     "set_planner_params";                                 // service name to set planner parameters
 static const std::string MOVE_ACTION = "move_group";      // name of 'move' action
+static const std::string REQUEST_TRACES_TOPIC =
+    "request_traces";  // topic on which the latency breakdown of traced requests is published (within ~)
 static const std::string IK_SERVICE_NAME = "compute_ik";  // name of ik service
 static const std::string FK_SERVICE_NAME = "compute_fk";  // name of fk service
+static const std::string IK_BATCH_SERVICE_NAME =
+    "compute_ik_batch";  // name of the service that solves many ik requests at once
+static const std::string FK_BATCH_SERVICE_NAME =
+    "compute_fk_batch";  // name of the service that computes fk for many states at once
 static const std::string STATE_VALIDITY_SERVICE_NAME =
     "check_state_validity";  // name of the service that validates states
+static const std::string STATE_VALIDITY_BATCH_SERVICE_NAME =
+    "check_state_validity_batch";  // name of the service that validates many states at once
 static const std::string CARTESIAN_PATH_SERVICE_NAME =
     "compute_cartesian_path";  // name of the service that computes cartesian paths
+static const std::string PLANNER_COMPACT_SERVICE_NAME =
+    "plan_kinematic_path_compact";  // name of the planning service returning compactly encoded results
+static const std::string CARTESIAN_PATH_COMPACT_SERVICE_NAME =
+    "compute_cartesian_path_compact";  // name of the cartesian path service returning compactly encoded results
+static const std::string CARTESIAN_PATH_BATCH_SERVICE_NAME =
+    "compute_cartesian_path_batch";  // name of the service that computes many cartesian paths at once
+static const std::string EXECUTE_COMPACT_SERVICE_NAME =
+    "execute_kinematic_path_compact";  // name of the service executing compactly encoded trajectories
 static const std::string GET_PLANNING_SCENE_SERVICE_NAME =
     "get_planning_scene";  // name of the service that can be used to query the planning scene
+static const std::string JOG_COMMAND_TOPIC =
+    "jog_command";  // name of the topic the jog capability listens to for twist commands
 static const std::string APPLY_PLANNING_SCENE_SERVICE_NAME =
     "apply_planning_scene";  // name of the service that applies a given planning scene
 static const std::string CLEAR_OCTOMAP_SERVICE_NAME =
     "clear_octomap";  // name of the service that can be used to clear the octomap
+static const std::string INTERMEDIATE_SOLUTIONS_TOPIC =
+    "intermediate_solutions";  // name of the topic on which solutions are published while planning is running
 }
 
 #endif
@@ -93,10 +93,51 @@ protected:
   moveit_msgs::PlanningScene clearSceneRobotState(const moveit_msgs::PlanningScene& scene) const;
   bool performTransform(geometry_msgs::PoseStamped& pose_msg, const std::string& target_frame) const;
 
+  /** @brief Run \e fn through the planning scheduler of the context on behalf of \e client.
+   *  The request trace current in the calling thread, if any, is current while \e fn runs as well.
+   *  Returns false and sets \e error_code if the request was dropped instead of run to completion. */
+  bool runPlanningRequest(const std::string& client, bool supersede, const boost::function<void()>& fn,
+                          moveit_msgs::MoveItErrorCodes& error_code) const;
+
+  /** @brief Advertise INTERMEDIATE_SOLUTIONS_TOPIC, on which the solutions planners report while still running are
+   *  published as time parameterized trajectories (anytime planning) */
+  void advertiseIntermediateSolutions();
+
+  /** @brief Return the callback that publishes the intermediate solutions of a planning request \e req, or an empty
+   *  callback if the topic is not advertised or nobody listens to it */
+  planning_interface::IntermediateSolutionCallback
+  getIntermediateSolutionCallback(const planning_interface::MotionPlanRequest& req) const;
+
+  /** @brief Encode \e start_state and \e trajectory for the compact variants of the services, see
+   *  robot_trajectory::encodeTrajectory(). Messages that could be encoded are cleared; the others are left as they are
+   *  and their encoded version is empty. */
+  void encodeCompactResult(moveit_msgs::RobotState& start_state, moveit_msgs::RobotTrajectory& trajectory,
+                           std::vector<uint8_t>& compact_start_state, std::vector<uint8_t>& compact_trajectory) const;
+
+  /** @brief Traces a request of this capability for the lifetime of the object, see
+   *  MoveGroupContext::startRequestTrace(). The trace is current in the constructing thread and is published with
+   *  the value \e error_code has when the object is destroyed. */
+  class RequestTraceScope
+  {
+  public:
+    RequestTraceScope(const MoveGroupCapability& capability, const moveit_msgs::MoveItErrorCodes& error_code);
+    ~RequestTraceScope();
+
+  private:
+    RequestTraceScope(const RequestTraceScope&);
+    RequestTraceScope& operator=(const RequestTraceScope&);
+
+    MoveGroupContextPtr context_;
+    const moveit_msgs::MoveItErrorCodes& error_code_;
+    moveit::tools::probes::RequestTracePtr trace_;
+    moveit::tools::probes::ScopedRequestTrace trace_scope_;
+  };
+
   ros::NodeHandle root_node_handle_;
   ros::NodeHandle node_handle_;
   std::string capability_name_;
   MoveGroupContextPtr context_;
+  ros::Publisher intermediate_solution_publisher_;
 };
 }
 
@@ -38,6 +38,10 @@
 #define MOVEIT_MOVE_GROUP_CONTEXT_
 
 #include <moveit/macros/class_forward.h>
+#include <moveit/profiler/probes.h>
+#include <ros/publisher.h>
+#include <ros/time.h>
+#include <atomic>
 
 namespace planning_scene_monitor
 {
@@ -63,6 +67,7 @@ MOVEIT_CLASS_FORWARD(TrajectoryExecutionManager);
 namespace move_group
 {
 MOVEIT_CLASS_FORWARD(MoveGroupContext);
+MOVEIT_CLASS_FORWARD(PlanningScheduler);
 
 struct MoveGroupContext
 {
@@ -72,13 +77,29 @@ struct MoveGroupContext
 
   bool status() const;
 
+  /** \brief Start the trace of a request handled by \e capability. Returns an empty pointer unless request tracing is
+      enabled (request_tracing parameter). The trace should be current while the request is handled, see
+      moveit::tools::probes::ScopedRequestTrace, and is passed to publishRequestTrace() once the request is done. */
+  moveit::tools::probes::RequestTracePtr startRequestTrace(const std::string& capability);
+
+  /** \brief Publish the spans and the probe totals of \e trace on REQUEST_TRACES_TOPIC and, if request_trace_directory
+      is set, write the trace to that directory as \<request id\>.json in the Chrome trace event format */
+  void publishRequestTrace(const moveit::tools::probes::RequestTracePtr& trace, int error_code) const;
+
   planning_scene_monitor::PlanningSceneMonitorPtr planning_scene_monitor_;
   trajectory_execution_manager::TrajectoryExecutionManagerPtr trajectory_execution_manager_;
   planning_pipeline::PlanningPipelinePtr planning_pipeline_;
   plan_execution::PlanExecutionPtr plan_execution_;
   plan_execution::PlanWithSensingPtr plan_with_sensing_;
+  PlanningSchedulerPtr planning_scheduler_;
+  ros::WallDuration planning_queue_timeout_;  // requests not started within this time are dropped (zero: never)
   bool allow_trajectory_execution_;
   bool debug_;
+
+  bool trace_requests_;
+  std::string request_trace_directory_;
+  ros::Publisher request_trace_publisher_;
+  std::atomic<unsigned long> traced_request_count_;
 };
 }
 
@@ -0,0 +1,149 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#ifndef MOVEIT_MOVE_GROUP_PLANNING_SCHEDULER_
+#define MOVEIT_MOVE_GROUP_PLANNING_SCHEDULER_
+
+#include <moveit/macros/class_forward.h>
+#include <ros/time.h>
+#include <boost/function.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace move_group
+{
+MOVEIT_CLASS_FORWARD(PlanningScheduler);
+
+/** @brief Runs planning requests from several clients on a pool of worker threads.
+ *
+ *  Requests are started in order of priority (lower values first), then deadline, then arrival. A client never
+ *  occupies more than a configured number of workers, so one client issuing slow requests does not delay the
+ *  requests of another. The queue is bounded: when it is full, a new request is only admitted if it is more urgent
+ *  than the least urgent queued request, which is then rejected. Requests that are still queued when their
+ *  deadline passes are dropped, and a client can supersede (or cancel) its own queued requests. */
+class PlanningScheduler
+{
+public:
+  enum Status
+  {
+    /** The request ran to completion */
+    COMPLETED,
+    /** The request was not admitted because the queue was full */
+    REJECTED,
+    /** The deadline passed before the request could be started */
+    DEADLINE_MISSED,
+    /** A newer request from the same client replaced this one */
+    SUPERSEDED,
+    /** The request was cancelled by its client, or the scheduler was stopped */
+    CANCELLED
+  };
+
+  struct Request
+  {
+    Request() : priority(0), supersede(false)
+    {
+    }
+
+    /** Identifies the client; fairness, superseding and cancellation work per client */
+    std::string client;
+
+    /** Lower values are started first */
+    int priority;
+
+    /** The request is dropped if it cannot be started before this time; zero means no deadline */
+    ros::WallTime deadline;
+
+    /** Cancel the queued requests of the same client when this one is added */
+    bool supersede;
+  };
+
+  /** @param thread_count The number of worker threads
+   *  @param max_queue_size The maximum number of requests waiting for a worker
+   *  @param max_running_per_client The maximum number of requests of a single client running at the same time */
+  PlanningScheduler(unsigned int thread_count = 2, std::size_t max_queue_size = 16,
+                    unsigned int max_running_per_client = 1);
+  ~PlanningScheduler();
+
+  /** @brief Run \e fn on a worker thread according to \e request and wait until it is done (or dropped).
+   *  Called from the thread serving a client request, which blocks for the duration. */
+  Status run(const Request& request, const boost::function<void()>& fn);
+
+  /** @brief Cancel all queued requests of \e client. Requests that are already running are not interrupted;
+   *  the planner has to be stopped through the planning pipeline for that. */
+  void cancel(const std::string& client);
+
+  /** @brief Set the priority used for requests of \e client, overriding the one passed to run() */
+  void setClientPriority(const std::string& client, int priority);
+
+  /** @brief Get the number of requests waiting for a worker */
+  std::size_t getQueueSize() const;
+
+  /** @brief Get a string representation of a status */
+  static const char* statusToString(Status status);
+
+private:
+  struct Entry;
+  typedef std::shared_ptr<Entry> EntryPtr;
+
+  void worker();
+
+  /** @brief Pick the next request to start, dropping the ones that missed their deadline. Lock must be held. */
+  EntryPtr popNextEntry();
+
+  /** @brief Mark \e entry as done with \e status. Lock must be held. */
+  void finish(const EntryPtr& entry, Status status);
+
+  std::size_t max_queue_size_;
+  unsigned int max_running_per_client_;
+
+  mutable boost::mutex lock_;
+  boost::condition_variable work_condition_;
+  boost::condition_variable done_condition_;
+  std::vector<EntryPtr> queue_;
+  std::vector<EntryPtr> running_;
+  std::map<std::string, unsigned int> running_per_client_;
+  std::map<std::string, int> client_priorities_;
+  unsigned long next_sequence_;
+  bool stop_;
+  boost::thread_group workers_;
+};
+}
+
+#endif
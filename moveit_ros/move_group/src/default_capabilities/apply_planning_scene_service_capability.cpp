@@ -56,7 +56,12 @@ bool move_group::ApplyPlanningSceneService::applyScene(moveit_msgs::ApplyPlannin
     return true;
   }
   context_->planning_scene_monitor_->updateFrameTransforms();
-  res.success = context_->planning_scene_monitor_->newPlanningSceneMessage(req.scene);
+  // diffs are applied as a transaction, so a diff that fails to apply does not leave the scene half updated
+  if (req.scene.is_diff)
+    res.success = context_->planning_scene_monitor_->newPlanningSceneMessages(
+        std::vector<moveit_msgs::PlanningScene>(1, req.scene));
+  else
+    res.success = context_->planning_scene_monitor_->newPlanningSceneMessage(req.scene);
   return true;
 }
 
@@ -43,9 +43,14 @@
 #include <moveit/planning_pipeline/planning_pipeline.h>
 #include <moveit_msgs/DisplayTrajectory.h>
 #include <moveit/trajectory_processing/iterative_time_parameterization.h>
+#include <boost/thread.hpp>
+#include <atomic>
 
 move_group::MoveGroupCartesianPathService::MoveGroupCartesianPathService()
-  : MoveGroupCapability("CartesianPathService"), display_computed_paths_(true)
+  : MoveGroupCapability("CartesianPathService")
+  , display_computed_paths_(true)
+  , adaptive_max_joint_step_(0.0)
+  , thread_count_(1)
 {
 }
 
@@ -55,21 +60,103 @@ void move_group::MoveGroupCartesianPathService::initialize()
       planning_pipeline::PlanningPipeline::DISPLAY_PATH_TOPIC, 10, true);
   cartesian_path_service_ = root_node_handle_.advertiseService(CARTESIAN_PATH_SERVICE_NAME,
                                                                &MoveGroupCartesianPathService::computeService, this);
+  compact_cartesian_path_service_ = root_node_handle_.advertiseService(
+      CARTESIAN_PATH_COMPACT_SERVICE_NAME, &MoveGroupCartesianPathService::computeCompactService, this);
+  batch_cartesian_path_service_ = root_node_handle_.advertiseService(
+      CARTESIAN_PATH_BATCH_SERVICE_NAME, &MoveGroupCartesianPathService::computeBatchService, this);
+  node_handle_.param("cartesian_path/adaptive_max_joint_step", adaptive_max_joint_step_, 0.0);
+
+  int thread_count;
+  if (node_handle_.getParam("cartesian_path/batch_threads", thread_count) && thread_count > 0)
+    thread_count_ = thread_count;
+  else
+    thread_count_ = std::max(1u, boost::thread::hardware_concurrency());
 }
 
 namespace
 {
-bool isStateValid(const planning_scene::PlanningScene* planning_scene,
-                  const kinematic_constraints::KinematicConstraintSet* constraint_set, robot_state::RobotState* state,
+/** Call fn(i) for all i < count, using up to thread_count threads (including the calling one) */
+template <typename Fn>
+void parallelFor(std::size_t count, std::size_t thread_count, const Fn& fn)
+{
+  // indices are handed out one at a time, so threads that hit short chains keep picking up work
+  std::atomic<std::size_t> next(0);
+  auto worker = [&]() {
+    for (std::size_t i = next++; i < count; i = next++)
+      fn(i);
+  };
+
+  thread_count = std::min(thread_count, count);
+  if (thread_count <= 1)
+  {
+    worker();
+    return;
+  }
+
+  boost::thread_group threads;
+  for (std::size_t t = 1; t < thread_count; ++t)
+    threads.create_thread(worker);
+  worker();
+  threads.join_all();
+}
+
+bool isStateValid(const kinematic_constraints::KinematicConstraintSet* constraint_set, robot_state::RobotState* state,
                   const robot_state::JointModelGroup* group, const double* ik_solution)
 {
   state->setJointGroupPositions(group, ik_solution);
   state->update();
-  return (!planning_scene || !planning_scene->isStateColliding(*state, group->getName())) &&
-         (!constraint_set || constraint_set->decide(*state).satisfied);
+  return constraint_set->decide(*state).satisfied;
+}
+
+// Collision check all points of the path but the start state in one batch; returns the number of leading points that
+// are collision-free
+std::size_t countCollisionFreePoints(const planning_scene::PlanningScene& planning_scene, const std::string& group,
+                                     const std::vector<robot_state::RobotStatePtr>& traj)
+{
+  if (traj.size() <= 1)
+    return traj.size();
+  std::vector<const robot_state::RobotState*> states(traj.size() - 1);
+  for (std::size_t i = 1; i < traj.size(); ++i)
+    states[i - 1] = traj[i].get();
+
+  collision_detection::CollisionRequest req;
+  req.group_name = group;
+  std::vector<collision_detection::CollisionResult> res;
+  planning_scene.getCollisionWorld()->checkCollisionBatch(req, res, *planning_scene.getCollisionRobot(), states,
+                                                          &planning_scene.getAllowedCollisionMatrix());
+  for (std::size_t i = 0; i < res.size(); ++i)
+    if (res[i].collision)
+      return i + 1;
+  return traj.size();
 }
 }
 
+bool move_group::MoveGroupCartesianPathService::computeCompactService(
+    moveit_ros_move_group::GetCompactCartesianPath::Request& req,
+    moveit_ros_move_group::GetCompactCartesianPath::Response& res)
+{
+  moveit_msgs::GetCartesianPath::Request path_req;
+  path_req.header = req.header;
+  path_req.start_state = req.start_state;
+  path_req.group_name = req.group_name;
+  path_req.link_name = req.link_name;
+  path_req.waypoints = req.waypoints;
+  path_req.max_step = req.max_step;
+  path_req.jump_threshold = req.jump_threshold;
+  path_req.avoid_collisions = req.avoid_collisions;
+  path_req.path_constraints = req.path_constraints;
+
+  moveit_msgs::GetCartesianPath::Response path_res;
+  computeService(path_req, path_res);
+
+  res.start_state = std::move(path_res.start_state);
+  res.solution = std::move(path_res.solution);
+  res.fraction = path_res.fraction;
+  res.error_code = path_res.error_code;
+  encodeCompactResult(res.start_state, res.solution, res.compact_start_state, res.compact_solution);
+  return true;
+}
+
 bool move_group::MoveGroupCartesianPathService::computeService(moveit_msgs::GetCartesianPath::Request& req,
                                                                moveit_msgs::GetCartesianPath::Response& res)
 {
@@ -79,107 +166,230 @@ bool move_group::MoveGroupCartesianPathService::computeService(moveit_msgs::GetC
   robot_state::RobotState start_state =
       planning_scene_monitor::LockedPlanningSceneRO(context_->planning_scene_monitor_)->getCurrentState();
   robot_state::robotStateMsgToRobotState(req.start_state, start_state);
-  if (const robot_model::JointModelGroup* jmg = start_state.getJointModelGroup(req.group_name))
+  const robot_model::JointModelGroup* jmg = start_state.getJointModelGroup(req.group_name);
+  if (!jmg)
+  {
+    res.error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_GROUP_NAME;
+    return true;
+  }
+
+  const std::string link_name = getLinkName(jmg, req.link_name);
+  EigenSTL::vector_Affine3d waypoints;
+  if (!transformWaypoints(req.header, req.waypoints, link_name, waypoints))
+  {
+    res.error_code.val = moveit_msgs::MoveItErrorCodes::FRAME_TRANSFORM_FAILURE;
+    return true;
+  }
+
+  if (req.max_step < std::numeric_limits<double>::epsilon())
   {
-    std::string link_name = req.link_name;
-    if (link_name.empty() && !jmg->getLinkModelNames().empty())
-      link_name = jmg->getLinkModelNames().back();
-
-    bool ok = true;
-    EigenSTL::vector_Affine3d waypoints(req.waypoints.size());
-    const std::string& default_frame = context_->planning_scene_monitor_->getRobotModel()->getModelFrame();
-    bool no_transform = req.header.frame_id.empty() ||
-                        robot_state::Transforms::sameFrame(req.header.frame_id, default_frame) ||
-                        robot_state::Transforms::sameFrame(req.header.frame_id, link_name);
-
-    for (std::size_t i = 0; i < req.waypoints.size(); ++i)
+    ROS_ERROR("Maximum step to take between consecutive configrations along Cartesian path was not specified (this "
+              "value needs to be > 0)");
+    res.error_code.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+    return true;
+  }
+
+  if (waypoints.size() > 0)
+  {
+    std::unique_ptr<planning_scene_monitor::LockedPlanningSceneRO> ls;
+    std::unique_ptr<kinematic_constraints::KinematicConstraintSet> kset;
+    const planning_scene::PlanningScene* scene = NULL;
+    if (req.avoid_collisions || !kinematic_constraints::isEmpty(req.path_constraints))
     {
-      if (no_transform)
-        tf::poseMsgToEigen(req.waypoints[i], waypoints[i]);
-      else
-      {
-        geometry_msgs::PoseStamped p;
-        p.header = req.header;
-        p.pose = req.waypoints[i];
-        if (performTransform(p, default_frame))
-          tf::poseMsgToEigen(p.pose, waypoints[i]);
-        else
-        {
-          ROS_ERROR("Error encountered transforming waypoints to frame '%s'", default_frame.c_str());
-          ok = false;
-          break;
-        }
-      }
+      ls.reset(new planning_scene_monitor::LockedPlanningSceneRO(context_->planning_scene_monitor_));
+      scene = static_cast<const planning_scene::PlanningSceneConstPtr&>(*ls).get();
+      kset.reset(new kinematic_constraints::KinematicConstraintSet(scene->getRobotModel()));
+      kset->add(req.path_constraints, scene->getTransforms());
+    }
+    bool global_frame = !robot_state::Transforms::sameFrame(link_name, req.header.frame_id);
+    ROS_INFO("Attempting to follow %u waypoints for link '%s' using a step of %lf m and jump threshold %lf (in "
+             "%s reference frame)",
+             (unsigned int)waypoints.size(), link_name.c_str(), req.max_step, req.jump_threshold,
+             global_frame ? "global" : "link");
+    robot_trajectory::RobotTrajectory rt(context_->planning_scene_monitor_->getRobotModel(), req.group_name);
+    res.fraction = computePath(req.avoid_collisions ? scene : NULL, kset.get(), start_state, jmg, link_name,
+                               waypoints, global_frame, req.max_step, req.jump_threshold, rt);
+    robot_state::robotStateToRobotStateMsg(start_state, res.start_state);
+
+    rt.getRobotTrajectoryMsg(res.solution);
+    ROS_INFO("Computed Cartesian path with %u points (followed %lf%% of requested trajectory)",
+             (unsigned int)rt.getWayPointCount(), res.fraction * 100.0);
+    if (display_computed_paths_ && rt.getWayPointCount() > 0)
+    {
+      moveit_msgs::DisplayTrajectory disp;
+      disp.model_id = context_->planning_scene_monitor_->getRobotModel()->getName();
+      disp.trajectory.resize(1, res.solution);
+      robot_state::robotStateToRobotStateMsg(rt.getFirstWayPoint(), disp.trajectory_start);
+      display_path_.publish(disp);
     }
+  }
+  res.error_code.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
+  return true;
+}
+
+bool move_group::MoveGroupCartesianPathService::computeBatchService(
+    moveit_ros_move_group::GetCartesianPathBatch::Request& req,
+    moveit_ros_move_group::GetCartesianPathBatch::Response& res)
+{
+  const std::size_t count = req.segments.size();
+  ROS_INFO("Received request to compute %u Cartesian path segments", (unsigned int)count);
+  context_->planning_scene_monitor_->updateFrameTransforms();
+  res.results.resize(count);
+
+  // all segments are computed against the same scene, which stays locked until they are done
+  planning_scene_monitor::LockedPlanningSceneRO ls(context_->planning_scene_monitor_);
+  const planning_scene::PlanningScene* scene = static_cast<const planning_scene::PlanningSceneConstPtr&>(ls).get();
+  const robot_state::RobotState& current_state = scene->getCurrentState();
+  const robot_model::JointModelGroup* jmg = current_state.getJointModelGroup(req.group_name);
+  int32_t error = moveit_msgs::MoveItErrorCodes::SUCCESS;
+  if (!jmg)
+    error = moveit_msgs::MoveItErrorCodes::INVALID_GROUP_NAME;
+  else if (req.max_step < std::numeric_limits<double>::epsilon())
+  {
+    ROS_ERROR("Maximum step to take between consecutive configrations along Cartesian path was not specified (this "
+              "value needs to be > 0)");
+    error = moveit_msgs::MoveItErrorCodes::FAILURE;
+  }
+  if (error != moveit_msgs::MoveItErrorCodes::SUCCESS)
+  {
+    for (std::size_t i = 0; i < count; ++i)
+      res.results[i].error_code.val = error;
+    return true;
+  }
+
+  const std::string link_name = getLinkName(jmg, req.link_name);
+  const bool global_frame = !robot_state::Transforms::sameFrame(link_name, req.header.frame_id);
+  kinematic_constraints::KinematicConstraintSet kset(scene->getRobotModel());
+  kset.add(req.path_constraints, scene->getTransforms());
+
+  // the transforms are looked up before the paths are computed in parallel
+  std::vector<EigenSTL::vector_Affine3d> waypoints(count);
+  std::vector<bool> transformed(count);
+  for (std::size_t i = 0; i < count; ++i)
+    transformed[i] = transformWaypoints(req.header, req.segments[i].waypoints, link_name, waypoints[i]);
 
-    if (ok)
+  // each chain of segments is computed by one thread, in order
+  std::vector<std::size_t> chain_starts;
+  for (std::size_t i = 0; i < count; ++i)
+    if (i == 0 || !req.segments[i].chain_start_state)
+      chain_starts.push_back(i);
+
+  parallelFor(chain_starts.size(), thread_count_, [&](std::size_t c) {
+    const std::size_t chain_end = c + 1 < chain_starts.size() ? chain_starts[c + 1] : count;
+    robot_state::RobotState state(current_state);
+    robot_state::robotStateMsgToRobotState(req.segments[chain_starts[c]].start_state, state);
+    bool previous_ok = true;
+    for (std::size_t i = chain_starts[c]; i < chain_end; ++i)
     {
-      if (req.max_step < std::numeric_limits<double>::epsilon())
+      moveit_ros_move_group::CartesianPathSegmentResult& result = res.results[i];
+      if (!previous_ok)
       {
-        ROS_ERROR("Maximum step to take between consecutive configrations along Cartesian path was not specified (this "
-                  "value needs to be > 0)");
-        res.error_code.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+        result.error_code.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+        continue;
       }
-      else
+      if (!transformed[i])
       {
-        if (waypoints.size() > 0)
-        {
-          robot_state::GroupStateValidityCallbackFn constraint_fn;
-          std::unique_ptr<planning_scene_monitor::LockedPlanningSceneRO> ls;
-          std::unique_ptr<kinematic_constraints::KinematicConstraintSet> kset;
-          if (req.avoid_collisions || !kinematic_constraints::isEmpty(req.path_constraints))
-          {
-            ls.reset(new planning_scene_monitor::LockedPlanningSceneRO(context_->planning_scene_monitor_));
-            kset.reset(new kinematic_constraints::KinematicConstraintSet((*ls)->getRobotModel()));
-            kset->add(req.path_constraints, (*ls)->getTransforms());
-            constraint_fn = boost::bind(
-                &isStateValid,
-                req.avoid_collisions ? static_cast<const planning_scene::PlanningSceneConstPtr&>(*ls).get() : NULL,
-                kset->empty() ? NULL : kset.get(), _1, _2, _3);
-          }
-          bool global_frame = !robot_state::Transforms::sameFrame(link_name, req.header.frame_id);
-          ROS_INFO("Attempting to follow %u waypoints for link '%s' using a step of %lf m and jump threshold %lf (in "
-                   "%s reference frame)",
-                   (unsigned int)waypoints.size(), link_name.c_str(), req.max_step, req.jump_threshold,
-                   global_frame ? "global" : "link");
-          std::vector<robot_state::RobotStatePtr> traj;
-          res.fraction =
-              start_state.computeCartesianPath(jmg, traj, start_state.getLinkModel(link_name), waypoints, global_frame,
-                                               req.max_step, req.jump_threshold, constraint_fn);
-          robot_state::robotStateToRobotStateMsg(start_state, res.start_state);
-
-          robot_trajectory::RobotTrajectory rt(context_->planning_scene_monitor_->getRobotModel(), req.group_name);
-          for (std::size_t i = 0; i < traj.size(); ++i)
-            rt.addSuffixWayPoint(traj[i], 0.0);
-
-          // time trajectory
-          // \todo optionally compute timing to move the eef with constant speed
-          trajectory_processing::IterativeParabolicTimeParameterization time_param;
-          time_param.computeTimeStamps(rt, 1.0);
-
-          rt.getRobotTrajectoryMsg(res.solution);
-          ROS_INFO("Computed Cartesian path with %u points (followed %lf%% of requested trajectory)",
-                   (unsigned int)traj.size(), res.fraction * 100.0);
-          if (display_computed_paths_ && rt.getWayPointCount() > 0)
-          {
-            moveit_msgs::DisplayTrajectory disp;
-            disp.model_id = context_->planning_scene_monitor_->getRobotModel()->getName();
-            disp.trajectory.resize(1, res.solution);
-            robot_state::robotStateToRobotStateMsg(rt.getFirstWayPoint(), disp.trajectory_start);
-            display_path_.publish(disp);
-          }
-        }
-        res.error_code.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
+        result.error_code.val = moveit_msgs::MoveItErrorCodes::FRAME_TRANSFORM_FAILURE;
+        previous_ok = false;
+        continue;
       }
+
+      robot_state::robotStateToRobotStateMsg(state, result.start_state);
+      if (!waypoints[i].empty())
+      {
+        robot_trajectory::RobotTrajectory rt(scene->getRobotModel(), req.group_name);
+        result.fraction = computePath(req.avoid_collisions ? scene : NULL, &kset, state, jmg, link_name, waypoints[i],
+                                      global_frame, req.max_step, req.jump_threshold, rt);
+        // the next segment starts where this path ends, which is not the end of the IK if the path was truncated
+        if (rt.getWayPointCount() > 0)
+          state = rt.getLastWayPoint();
+        rt.getRobotTrajectoryMsg(result.solution);
+      }
+      result.error_code.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
+      encodeCompactResult(result.start_state, result.solution, result.compact_start_state, result.compact_solution);
     }
+  });
+
+  ROS_INFO("Computed %u Cartesian path segments in %u chains", (unsigned int)count,
+           (unsigned int)chain_starts.size());
+  return true;
+}
+
+std::string move_group::MoveGroupCartesianPathService::getLinkName(const robot_model::JointModelGroup* jmg,
+                                                                    const std::string& link_name) const
+{
+  if (link_name.empty() && !jmg->getLinkModelNames().empty())
+    return jmg->getLinkModelNames().back();
+  return link_name;
+}
+
+bool move_group::MoveGroupCartesianPathService::transformWaypoints(const std_msgs::Header& header,
+                                                                   const std::vector<geometry_msgs::Pose>& poses,
+                                                                   const std::string& link_name,
+                                                                   EigenSTL::vector_Affine3d& waypoints) const
+{
+  waypoints.resize(poses.size());
+  const std::string& default_frame = context_->planning_scene_monitor_->getRobotModel()->getModelFrame();
+  bool no_transform = header.frame_id.empty() || robot_state::Transforms::sameFrame(header.frame_id, default_frame) ||
+                      robot_state::Transforms::sameFrame(header.frame_id, link_name);
+
+  for (std::size_t i = 0; i < poses.size(); ++i)
+  {
+    if (no_transform)
+      tf::poseMsgToEigen(poses[i], waypoints[i]);
     else
-      res.error_code.val = moveit_msgs::MoveItErrorCodes::FRAME_TRANSFORM_FAILURE;
+    {
+      geometry_msgs::PoseStamped p;
+      p.header = header;
+      p.pose = poses[i];
+      if (performTransform(p, default_frame))
+        tf::poseMsgToEigen(p.pose, waypoints[i]);
+      else
+      {
+        ROS_ERROR("Error encountered transforming waypoints to frame '%s'", default_frame.c_str());
+        return false;
+      }
+    }
   }
-  else
-    res.error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_GROUP_NAME;
-
   return true;
 }
 
+double move_group::MoveGroupCartesianPathService::computePath(
+    const planning_scene::PlanningScene* scene, const kinematic_constraints::KinematicConstraintSet* kset,
+    robot_state::RobotState& start_state, const robot_model::JointModelGroup* jmg, const std::string& link_name,
+    const EigenSTL::vector_Affine3d& waypoints, bool global_frame, double max_step, double jump_threshold,
+    robot_trajectory::RobotTrajectory& rt) const
+{
+  robot_state::GroupStateValidityCallbackFn constraint_fn;
+  // collisions are checked for the whole path at once after IK
+  if (kset && !kset->empty())
+    constraint_fn = boost::bind(&isStateValid, kset, _1, _2, _3);
+  std::vector<robot_state::RobotStatePtr> traj;
+  double fraction = start_state.computeCartesianPath(
+      jmg, traj, start_state.getLinkModel(link_name), waypoints, global_frame, robot_state::MaxEEFStep(max_step),
+      robot_state::AdaptiveEEFStep(adaptive_max_joint_step_), robot_state::JumpThreshold(jump_threshold),
+      constraint_fn);
+  if (scene)
+  {
+    std::size_t valid = countCollisionFreePoints(*scene, jmg->getName(), traj);
+    if (valid < traj.size())
+    {
+      ROS_DEBUG("Truncating Cartesian path at point %zu, which is in collision", valid);
+      fraction *= (double)valid / (double)traj.size();
+      traj.resize(valid);
+    }
+  }
+
+  rt.clear();
+  for (std::size_t i = 0; i < traj.size(); ++i)
+    rt.addSuffixWayPoint(traj[i], 0.0);
+
+  // time trajectory
+  // \todo optionally compute timing to move the eef with constant speed
+  trajectory_processing::IterativeParabolicTimeParameterization time_param;
+  time_param.computeTimeStamps(rt, 1.0);
+  return fraction;
+}
+
 #include <class_loader/class_loader.hpp>
 CLASS_LOADER_REGISTER_CLASS(move_group::MoveGroupCartesianPathService, move_group::MoveGroupCapability)
@@ -39,9 +39,15 @@
 
 #include <moveit/move_group/move_group_capability.h>
 #include <moveit_msgs/GetCartesianPath.h>
+#include <moveit_ros_move_group/GetCompactCartesianPath.h>
+#include <moveit_ros_move_group/GetCartesianPathBatch.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/kinematic_constraints/kinematic_constraint.h>
+#include <eigen_stl_containers/eigen_stl_vector_container.h>
 
 namespace move_group
 {
+/** \brief Computes Cartesian paths one at a time, or many at once in parallel in the batch service */
 class MoveGroupCartesianPathService : public MoveGroupCapability
 {
 public:
@@ -51,10 +57,32 @@ public:
 
 private:
   bool computeService(moveit_msgs::GetCartesianPath::Request& req, moveit_msgs::GetCartesianPath::Response& res);
+  bool computeCompactService(moveit_ros_move_group::GetCompactCartesianPath::Request& req,
+                             moveit_ros_move_group::GetCompactCartesianPath::Response& res);
+  bool computeBatchService(moveit_ros_move_group::GetCartesianPathBatch::Request& req,
+                           moveit_ros_move_group::GetCartesianPathBatch::Response& res);
+
+  /** \brief The link to follow the waypoints with: \e link_name, or the last link of \e jmg if that is empty */
+  std::string getLinkName(const robot_model::JointModelGroup* jmg, const std::string& link_name) const;
+  /** \brief Transform \e poses given in the frame of \e header to the model frame */
+  bool transformWaypoints(const std_msgs::Header& header, const std::vector<geometry_msgs::Pose>& poses,
+                          const std::string& link_name, EigenSTL::vector_Affine3d& waypoints) const;
+  /** \brief Compute the time parameterized path \e rt along \e waypoints, starting at \e start_state, which is
+      left at the last IK solution. States that do not satisfy \e kset are not accepted; if \e scene is not NULL,
+      the path is truncated before its first state in collision. Returns the fraction of the path followed. */
+  double computePath(const planning_scene::PlanningScene* scene,
+                     const kinematic_constraints::KinematicConstraintSet* kset, robot_state::RobotState& start_state,
+                     const robot_model::JointModelGroup* jmg, const std::string& link_name,
+                     const EigenSTL::vector_Affine3d& waypoints, bool global_frame, double max_step,
+                     double jump_threshold, robot_trajectory::RobotTrajectory& rt) const;
 
   ros::ServiceServer cartesian_path_service_;
+  ros::ServiceServer compact_cartesian_path_service_;
+  ros::ServiceServer batch_cartesian_path_service_;
   ros::Publisher display_path_;
   bool display_computed_paths_;
+  double adaptive_max_joint_step_;  // enables adaptive steps along the path if non-zero
+  unsigned int thread_count_;       // threads computing the chains of a batch
 };
 }
 
@@ -0,0 +1,144 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include "diagnostics_capability.h"
+#include <moveit/move_group/planning_scheduler.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include <cstdio>
+
+namespace
+{
+const std::string IK_SOLVED_PROBE = "RobotState::setFromIK solved";
+const std::string IK_FAILED_PROBE = "RobotState::setFromIK failed";
+
+void addValue(diagnostic_msgs::DiagnosticStatus& status, const std::string& key, double value)
+{
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%g", value);
+  diagnostic_msgs::KeyValue kv;
+  kv.key = key;
+  kv.value = buffer;
+  status.values.push_back(kv);
+}
+
+// the measurements in current that were not yet in previous; longest stays the overall one, which only caps the
+// percentiles
+moveit::tools::probes::ProbeStats difference(const moveit::tools::probes::ProbeStats& current,
+                                             const moveit::tools::probes::ProbeStats* previous)
+{
+  moveit::tools::probes::ProbeStats delta = current;
+  if (!previous)
+    return delta;
+  delta.count -= previous->count;
+  delta.timed -= previous->timed;
+  delta.total -= previous->total;
+  for (std::size_t i = 0; i < delta.histogram.size() && i < previous->histogram.size(); ++i)
+    delta.histogram[i] -= previous->histogram[i];
+  return delta;
+}
+}
+
+move_group::MoveGroupDiagnosticsCapability::MoveGroupDiagnosticsCapability()
+  : MoveGroupCapability("DiagnosticsCapability")
+{
+}
+
+void move_group::MoveGroupDiagnosticsCapability::initialize()
+{
+  double period;
+  node_handle_.param("diagnostics/period", period, 1.0);
+  if (period <= 0.0)
+  {
+    ROS_ERROR("The period for publishing move_group diagnostics must be positive, not %lf", period);
+    return;
+  }
+
+  moveit::tools::probes::setEnabled(true);
+  diagnostics_publisher_ = root_node_handle_.advertise<diagnostic_msgs::DiagnosticArray>("diagnostics", 10);
+  last_time_ = ros::WallTime::now();
+  timer_ = root_node_handle_.createWallTimer(ros::WallDuration(period),
+                                             &MoveGroupDiagnosticsCapability::publishDiagnostics, this);
+}
+
+void move_group::MoveGroupDiagnosticsCapability::publishDiagnostics(const ros::WallTimerEvent& event)
+{
+  const ros::WallTime now = ros::WallTime::now();
+  const double elapsed = (now - last_time_).toSec();
+  last_time_ = now;
+  if (elapsed <= 0.0)
+    return;
+
+  diagnostic_msgs::DiagnosticArray msg;
+  msg.header.stamp = ros::Time::now();
+  msg.status.resize(1);
+  diagnostic_msgs::DiagnosticStatus& status = msg.status[0];
+  status.name = "move_group: hot paths";
+  status.hardware_id = "move_group";
+  status.level = diagnostic_msgs::DiagnosticStatus::OK;
+  char buffer[64];
+  std::snprintf(buffer, sizeof(buffer), "Rates and durations over the last %.3f s", elapsed);
+  status.message = buffer;
+
+  addValue(status, "planning queue depth", context_->planning_scheduler_->getQueueSize());
+
+  // rates are per second; durations are in seconds
+  std::uint64_t ik_solved = 0, ik_failed = 0;
+  std::vector<moveit::tools::probes::ProbeStats> stats = moveit::tools::probes::getStats();
+  for (std::size_t i = 0; i < stats.size(); ++i)
+  {
+    std::map<std::string, moveit::tools::probes::ProbeStats>::const_iterator it = last_stats_.find(stats[i].name);
+    moveit::tools::probes::ProbeStats delta = difference(stats[i], it == last_stats_.end() ? nullptr : &it->second);
+    last_stats_[stats[i].name] = stats[i];
+
+    if (stats[i].name == IK_SOLVED_PROBE)
+      ik_solved = delta.count;
+    else if (stats[i].name == IK_FAILED_PROBE)
+      ik_failed = delta.count;
+
+    addValue(status, stats[i].name + ": rate", delta.count / elapsed);
+    if (delta.timed > 0)
+    {
+      addValue(status, stats[i].name + ": mean", delta.total / delta.timed);
+      addValue(status, stats[i].name + ": p99", moveit::tools::probes::percentile(delta, 0.99));
+    }
+  }
+  if (ik_solved + ik_failed > 0)
+    addValue(status, "IK success rate", static_cast<double>(ik_solved) / (ik_solved + ik_failed));
+
+  diagnostics_publisher_.publish(msg);
+}
+
+#include <class_loader/class_loader.hpp>
+CLASS_LOADER_REGISTER_CLASS(move_group::MoveGroupDiagnosticsCapability, move_group::MoveGroupCapability)
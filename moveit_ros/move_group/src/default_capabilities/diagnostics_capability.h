@@ -0,0 +1,68 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#ifndef MOVEIT_MOVE_GROUP_DIAGNOSTICS_CAPABILITY_
+#define MOVEIT_MOVE_GROUP_DIAGNOSTICS_CAPABILITY_
+
+#include <moveit/move_group/move_group_capability.h>
+#include <moveit/profiler/probes.h>
+#include <map>
+
+namespace move_group
+{
+/** \brief Publishes throughput metrics of the hot code paths as diagnostic_msgs, for dashboards and regression alerts.
+
+    Probes are kept enabled while this capability is loaded; their counters are per thread and lock free, so this
+    costs a few relaxed stores per instrumented call. Every period, the rate, mean and 99th percentile duration of each
+    probe hit since the previous period are published, together with the IK success rate and the depth of the
+    planning queue. */
+class MoveGroupDiagnosticsCapability : public MoveGroupCapability
+{
+public:
+  MoveGroupDiagnosticsCapability();
+
+  virtual void initialize();
+
+private:
+  void publishDiagnostics(const ros::WallTimerEvent& event);
+
+  ros::Publisher diagnostics_publisher_;
+  ros::WallTimer timer_;
+  ros::WallTime last_time_;
+  std::map<std::string, moveit::tools::probes::ProbeStats> last_stats_;
+};
+}
+
+#endif  // MOVEIT_MOVE_GROUP_DIAGNOSTICS_CAPABILITY_
@@ -40,13 +40,34 @@
 #include <moveit/trajectory_processing/trajectory_tools.h>
 #include <moveit/kinematic_constraints/utils.h>
 #include <moveit/move_group/capability_names.h>
+#include <moveit/robot_trajectory/trajectory_encoding.h>
 
 namespace move_group
 {
+namespace
+{
+int32_t statusToErrorCode(const moveit_controller_manager::ExecutionStatus& status)
+{
+  if (status == moveit_controller_manager::ExecutionStatus::SUCCEEDED)
+    return moveit_msgs::MoveItErrorCodes::SUCCESS;
+  if (status == moveit_controller_manager::ExecutionStatus::PREEMPTED)
+    return moveit_msgs::MoveItErrorCodes::PREEMPTED;
+  if (status == moveit_controller_manager::ExecutionStatus::TIMED_OUT)
+    return moveit_msgs::MoveItErrorCodes::TIMED_OUT;
+  return moveit_msgs::MoveItErrorCodes::CONTROL_FAILED;
+}
+}
+
 MoveGroupExecuteTrajectoryAction::MoveGroupExecuteTrajectoryAction() : MoveGroupCapability("ExecuteTrajectoryAction")
 {
 }
 
+MoveGroupExecuteTrajectoryAction::~MoveGroupExecuteTrajectoryAction()
+{
+  if (spinner_)
+    spinner_->stop();
+}
+
 void MoveGroupExecuteTrajectoryAction::initialize()
 {
   // start the move action server
@@ -56,6 +77,13 @@ void MoveGroupExecuteTrajectoryAction::initialize()
   execute_action_server_->registerPreemptCallback(
       boost::bind(&MoveGroupExecuteTrajectoryAction::preemptExecuteTrajectoryCallback, this));
   execute_action_server_->start();
+
+  ros::NodeHandle nh(root_node_handle_);
+  nh.setCallbackQueue(&callback_queue_);
+  execute_compact_service_ =
+      nh.advertiseService(EXECUTE_COMPACT_SERVICE_NAME, &MoveGroupExecuteTrajectoryAction::executeCompactService, this);
+  spinner_.reset(new ros::AsyncSpinner(1, &callback_queue_));
+  spinner_->start();
 }
 
 void MoveGroupExecuteTrajectoryAction::executePathCallback(const moveit_msgs::ExecuteTrajectoryGoalConstPtr& goal)
@@ -99,22 +127,7 @@ void MoveGroupExecuteTrajectoryAction::executePath(const moveit_msgs::ExecuteTra
     setExecuteTrajectoryState(MONITOR);
     context_->trajectory_execution_manager_->execute();
     moveit_controller_manager::ExecutionStatus status = context_->trajectory_execution_manager_->waitForExecution();
-    if (status == moveit_controller_manager::ExecutionStatus::SUCCEEDED)
-    {
-      action_res.error_code.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
-    }
-    else if (status == moveit_controller_manager::ExecutionStatus::PREEMPTED)
-    {
-      action_res.error_code.val = moveit_msgs::MoveItErrorCodes::PREEMPTED;
-    }
-    else if (status == moveit_controller_manager::ExecutionStatus::TIMED_OUT)
-    {
-      action_res.error_code.val = moveit_msgs::MoveItErrorCodes::TIMED_OUT;
-    }
-    else
-    {
-      action_res.error_code.val = moveit_msgs::MoveItErrorCodes::CONTROL_FAILED;
-    }
+    action_res.error_code.val = statusToErrorCode(status);
     ROS_INFO_STREAM_NAMED(capability_name_, "Execution completed: " << status.asString());
   }
   else
@@ -123,6 +136,46 @@ void MoveGroupExecuteTrajectoryAction::executePath(const moveit_msgs::ExecuteTra
   }
 }
 
+bool MoveGroupExecuteTrajectoryAction::executeCompactService(
+    moveit_ros_move_group::ExecuteCompactTrajectory::Request& req,
+    moveit_ros_move_group::ExecuteCompactTrajectory::Response& res)
+{
+  if (!context_->trajectory_execution_manager_)
+  {
+    ROS_ERROR_NAMED(capability_name_, "Cannot execute trajectory since ~allow_trajectory_execution was set to false");
+    res.error_code.val = moveit_msgs::MoveItErrorCodes::CONTROL_FAILED;
+    return true;
+  }
+
+  moveit_msgs::RobotTrajectory trajectory;
+  if (!robot_trajectory::decodeTrajectory(req.trajectory, *context_->planning_scene_monitor_->getRobotModel(),
+                                          trajectory))
+  {
+    ROS_ERROR_NAMED(capability_name_, "Unable to decode the compact trajectory");
+    res.error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_MOTION_PLAN;
+    return true;
+  }
+
+  ROS_INFO_NAMED(capability_name_, "Compact execution request received");
+  context_->trajectory_execution_manager_->clear();
+  if (!context_->trajectory_execution_manager_->push(trajectory))
+  {
+    res.error_code.val = moveit_msgs::MoveItErrorCodes::CONTROL_FAILED;
+    return true;
+  }
+
+  context_->trajectory_execution_manager_->execute();
+  if (req.wait_for_execution)
+  {
+    moveit_controller_manager::ExecutionStatus status = context_->trajectory_execution_manager_->waitForExecution();
+    res.error_code.val = statusToErrorCode(status);
+    ROS_INFO_STREAM_NAMED(capability_name_, "Execution completed: " << status.asString());
+  }
+  else
+    res.error_code.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
+  return true;
+}
+
 void MoveGroupExecuteTrajectoryAction::preemptExecuteTrajectoryCallback()
 {
   context_->trajectory_execution_manager_->stopExecution(true);
@@ -46,6 +46,8 @@
 #include <moveit/move_group/move_group_capability.h>
 #include <actionlib/server/simple_action_server.h>
 #include <moveit_msgs/ExecuteTrajectoryAction.h>
+#include <moveit_ros_move_group/ExecuteCompactTrajectory.h>
+#include <ros/callback_queue.h>
 #include <memory>
 
 namespace move_group
@@ -54,6 +56,7 @@ class MoveGroupExecuteTrajectoryAction : public MoveGroupCapability
 {
 public:
   MoveGroupExecuteTrajectoryAction();
+  ~MoveGroupExecuteTrajectoryAction();
 
   virtual void initialize();
 
@@ -61,10 +64,17 @@ private:
   void executePathCallback(const moveit_msgs::ExecuteTrajectoryGoalConstPtr& goal);
   void executePath(const moveit_msgs::ExecuteTrajectoryGoalConstPtr& goal,
                    moveit_msgs::ExecuteTrajectoryResult& action_res);
+  bool executeCompactService(moveit_ros_move_group::ExecuteCompactTrajectory::Request& req,
+                             moveit_ros_move_group::ExecuteCompactTrajectory::Response& res);
   void preemptExecuteTrajectoryCallback();
   void setExecuteTrajectoryState(MoveGroupState state);
 
   std::unique_ptr<actionlib::SimpleActionServer<moveit_msgs::ExecuteTrajectoryAction> > execute_action_server_;
+
+  // the compact execution service blocks while waiting for the execution, so it gets its own queue
+  ros::ServiceServer execute_compact_service_;
+  ros::CallbackQueue callback_queue_;
+  std::unique_ptr<ros::AsyncSpinner> spinner_;
 };
 
 }  // namespace move_group
@@ -42,19 +42,101 @@ move_group::MoveGroupGetPlanningSceneService::MoveGroupGetPlanningSceneService()
 {
 }
 
+move_group::MoveGroupGetPlanningSceneService::~MoveGroupGetPlanningSceneService()
+{
+  if (world_)
+    world_->removeObserver(world_observer_);
+}
+
 void move_group::MoveGroupGetPlanningSceneService::initialize()
 {
+  {
+    planning_scene_monitor::LockedPlanningSceneRW ps(context_->planning_scene_monitor_);
+    world_ = ps->getWorldNonConst();
+    world_observer_ = world_->addObserver(
+        boost::bind(&MoveGroupGetPlanningSceneService::worldObjectUpdateCallback, this, _1, _2));
+  }
   get_scene_service_ = root_node_handle_.advertiseService(
       GET_PLANNING_SCENE_SERVICE_NAME, &MoveGroupGetPlanningSceneService::getPlanningSceneService, this);
 }
 
+void move_group::MoveGroupGetPlanningSceneService::worldObjectUpdateCallback(
+    const collision_detection::World::ObjectConstPtr& object, collision_detection::World::Action action)
+{
+  if (!(action & collision_detection::World::DESTROY))
+    return;
+  boost::mutex::scoped_lock lock(cache_mutex_);
+  if (object->id_ == planning_scene::PlanningScene::OCTOMAP_NS)
+    octomap_cache_ = CachedMsg<octomap_msgs::OctomapWithPose>();
+  else
+    collision_object_cache_.erase(object->id_);
+}
+
+void move_group::MoveGroupGetPlanningSceneService::getCachedCollisionObjectMsgs(
+    const planning_scene::PlanningSceneConstPtr& scene, std::vector<moveit_msgs::CollisionObject>& collision_objects)
+{
+  const std::vector<std::string> ids = scene->getWorld()->getObjectIds();
+  collision_objects.clear();
+  collision_objects.reserve(ids.size());
+
+  boost::mutex::scoped_lock lock(cache_mutex_);
+  for (const std::string& id : ids)
+  {
+    if (id == planning_scene::PlanningScene::OCTOMAP_NS)
+      continue;
+    collision_detection::World::ObjectConstPtr object = scene->getWorld()->getObject(id);
+    CachedMsg<moveit_msgs::CollisionObject>& cached = collision_object_cache_[id];
+    if (cached.object != object)
+    {
+      cached.object = object;
+      cached.msg = moveit_msgs::CollisionObject();
+      scene->getCollisionObjectMsg(cached.msg, id);
+    }
+    collision_objects.push_back(cached.msg);
+
+    // object types are not part of the world, so they are never cached
+    moveit_msgs::CollisionObject& msg = collision_objects.back();
+    if ((!msg.primitives.empty() || !msg.meshes.empty() || !msg.planes.empty()) && scene->hasObjectType(id))
+      msg.type = scene->getObjectType(id);
+  }
+}
+
+void move_group::MoveGroupGetPlanningSceneService::getCachedOctomapMsg(
+    const planning_scene::PlanningSceneConstPtr& scene, octomap_msgs::OctomapWithPose& octomap)
+{
+  collision_detection::World::ObjectConstPtr object =
+      scene->getWorld()->getObject(planning_scene::PlanningScene::OCTOMAP_NS);
+  if (!object)
+  {
+    scene->getOctomapMsg(octomap);
+    return;
+  }
+
+  boost::mutex::scoped_lock lock(cache_mutex_);
+  if (octomap_cache_.object != object)
+  {
+    octomap_cache_.object = object;
+    scene->getOctomapMsg(octomap_cache_.msg);
+  }
+  octomap = octomap_cache_.msg;
+}
+
 bool move_group::MoveGroupGetPlanningSceneService::getPlanningSceneService(moveit_msgs::GetPlanningScene::Request& req,
                                                                            moveit_msgs::GetPlanningScene::Response& res)
 {
   if (req.components.components & moveit_msgs::PlanningSceneComponents::TRANSFORMS)
     context_->planning_scene_monitor_->updateFrameTransforms();
   planning_scene_monitor::LockedPlanningSceneRO ps(context_->planning_scene_monitor_);
-  ps->getPlanningSceneMsg(res.scene, req.components);
+
+  // the world geometry and the octomap are the expensive parts to convert; they come from the cache
+  moveit_msgs::PlanningSceneComponents components = req.components;
+  components.components &=
+      ~(moveit_msgs::PlanningSceneComponents::WORLD_OBJECT_GEOMETRY | moveit_msgs::PlanningSceneComponents::OCTOMAP);
+  ps->getPlanningSceneMsg(res.scene, components);
+  if (req.components.components & moveit_msgs::PlanningSceneComponents::WORLD_OBJECT_GEOMETRY)
+    getCachedCollisionObjectMsgs(ps, res.scene.world.collision_objects);
+  if (req.components.components & moveit_msgs::PlanningSceneComponents::OCTOMAP)
+    getCachedOctomapMsg(ps, res.scene.world.octomap);
   return true;
 }
 
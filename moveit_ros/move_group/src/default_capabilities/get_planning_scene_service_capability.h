@@ -39,6 +39,8 @@
 
 #include <moveit/move_group/move_group_capability.h>
 #include <moveit_msgs/GetPlanningScene.h>
+#include <moveit/collision_detection/world.h>
+#include <boost/thread/mutex.hpp>
 
 namespace move_group
 {
@@ -46,6 +48,7 @@ class MoveGroupGetPlanningSceneService : public MoveGroupCapability
 {
 public:
   MoveGroupGetPlanningSceneService();
+  virtual ~MoveGroupGetPlanningSceneService();
 
   virtual void initialize();
 
@@ -53,7 +56,32 @@ private:
   bool getPlanningSceneService(moveit_msgs::GetPlanningScene::Request& req,
                                moveit_msgs::GetPlanningScene::Response& res);
 
+  // fill the world part of msg from the cache, converting only the objects that changed since they were cached
+  void getCachedCollisionObjectMsgs(const planning_scene::PlanningSceneConstPtr& scene,
+                                    std::vector<moveit_msgs::CollisionObject>& collision_objects);
+  void getCachedOctomapMsg(const planning_scene::PlanningSceneConstPtr& scene, octomap_msgs::OctomapWithPose& octomap);
+
+  // drop the cached messages of objects removed from the monitored world
+  void worldObjectUpdateCallback(const collision_detection::World::ObjectConstPtr& object,
+                                 collision_detection::World::Action action);
+
   ros::ServiceServer get_scene_service_;
+
+  /// A message converted from a world object. Objects are copy-on-write, so the message is valid as long as the
+  /// world still holds the same object.
+  template <typename Msg>
+  struct CachedMsg
+  {
+    collision_detection::World::ObjectConstPtr object;
+    Msg msg;
+  };
+
+  std::map<std::string, CachedMsg<moveit_msgs::CollisionObject> > collision_object_cache_;
+  CachedMsg<octomap_msgs::OctomapWithPose> octomap_cache_;
+  boost::mutex cache_mutex_;
+
+  collision_detection::WorldPtr world_;
+  collision_detection::World::ObserverHandle world_observer_;
 };
 }
 
@@ -0,0 +1,233 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include "jog_capability.h"
+#include <moveit/move_group/capability_names.h>
+#include <moveit/trajectory_execution_manager/trajectory_execution_manager.h>
+#include <Eigen/SVD>
+#include <algorithm>
+#include <limits>
+#include <set>
+
+move_group::MoveGroupJogCapability::MoveGroupJogCapability()
+  : MoveGroupCapability("JogCapability"), group_(NULL), pseudo_inverse_valid_(false), collision_scale_(1.0)
+{
+}
+
+void move_group::MoveGroupJogCapability::initialize()
+{
+  std::string group_name, command_topic;
+  node_handle_.param("jog/group", group_name, std::string());
+  node_handle_.param("jog/command_topic", command_topic, std::string());
+  node_handle_.param("jog/command_period", command_period_, 0.002);
+  node_handle_.param("jog/command_timeout", command_timeout_, 0.1);
+  node_handle_.param("jog/pseudo_inverse_update_threshold", pseudo_inverse_update_threshold_, 0.01);
+  node_handle_.param("jog/singularity_threshold", singularity_threshold_, 0.01);
+  node_handle_.param("jog/collision_distance_threshold", collision_distance_threshold_, 0.05);
+  node_handle_.param("jog/collision_check_period", collision_check_period_, 0.01);
+
+  const robot_model::RobotModelConstPtr& robot_model = context_->planning_scene_monitor_->getRobotModel();
+  if (group_name.empty() || !(group_ = robot_model->getJointModelGroup(group_name)))
+  {
+    ROS_ERROR("Jogging is disabled: parameter '~jog/group' does not name a joint model group");
+    return;
+  }
+
+  // unless a topic is given, command the controller that moves all joints of the group
+  std::vector<std::string> command_joints = group_->getVariableNames();
+  moveit_controller_manager::MoveItControllerManagerPtr controller_manager;
+  if (context_->trajectory_execution_manager_)
+    controller_manager = context_->trajectory_execution_manager_->getControllerManager();
+  if (command_topic.empty() && controller_manager)
+  {
+    std::vector<std::string> controllers;
+    controller_manager->getControllersList(controllers);
+    for (std::size_t i = 0; i < controllers.size() && command_topic.empty(); ++i)
+    {
+      std::vector<std::string> joints;
+      controller_manager->getControllerJoints(controllers[i], joints);
+      std::set<std::string> joint_set(joints.begin(), joints.end());
+      bool covers_group = true;
+      for (const std::string& name : group_->getVariableNames())
+        covers_group &= joint_set.count(name) > 0;
+      if (covers_group)
+      {
+        command_topic = controllers[i] + "/command";
+        command_joints = joints;
+      }
+    }
+  }
+  if (command_topic.empty())
+  {
+    ROS_ERROR("Jogging is disabled: no controller found for group '%s'. Set parameter '~jog/command_topic'.",
+              group_name.c_str());
+    group_ = NULL;
+    return;
+  }
+
+  const std::vector<std::string>& group_variables = group_->getVariableNames();
+  command_.joint_names = command_joints;
+  command_.points.resize(1);
+  command_.points[0].positions.resize(command_joints.size());
+  command_.points[0].velocities.resize(command_joints.size());
+  command_group_index_.resize(command_joints.size());
+  for (std::size_t i = 0; i < command_joints.size(); ++i)
+  {
+    std::vector<std::string>::const_iterator it =
+        std::find(group_variables.begin(), group_variables.end(), command_joints[i]);
+    command_group_index_[i] = it == group_variables.end() ? -1 : it - group_variables.begin();
+  }
+
+  command_publisher_ = root_node_handle_.advertise<trajectory_msgs::JointTrajectory>(command_topic, 1);
+  jog_subscriber_ = root_node_handle_.subscribe(JOG_COMMAND_TOPIC, 1, &MoveGroupJogCapability::jogCallback, this,
+                                                ros::TransportHints().tcpNoDelay());
+  ROS_INFO("Jogging group '%s' through '%s'", group_name.c_str(), command_publisher_.getTopic().c_str());
+}
+
+void move_group::MoveGroupJogCapability::jogCallback(const geometry_msgs::TwistStampedConstPtr& msg)
+{
+  if (!group_ || !context_->planning_scene_monitor_->getStateMonitor())
+    return;
+
+  // integrate from the last command while commands keep coming, resume from the measured state after a pause
+  ros::Time now = ros::Time::now();
+  double dt = (now - last_command_time_).toSec();
+  if (!state_ || dt > command_timeout_)
+  {
+    state_ = context_->planning_scene_monitor_->getStateMonitor()->getCurrentState();
+    state_->update();
+    pseudo_inverse_valid_ = false;
+    last_collision_check_ = ros::Time();
+    dt = command_period_;
+  }
+  else if (dt <= 0.0)
+    dt = command_period_;
+  last_command_time_ = now;
+
+  // the Jacobian is expressed in the model frame
+  Eigen::Matrix<double, 6, 1> twist;
+  twist << msg->twist.linear.x, msg->twist.linear.y, msg->twist.linear.z, msg->twist.angular.x,
+      msg->twist.angular.y, msg->twist.angular.z;
+  const std::string& frame = msg->header.frame_id;
+  if (!frame.empty() && frame != state_->getRobotModel()->getModelFrame())
+  {
+    if (!state_->knowsFrameTransform(frame))
+    {
+      ROS_WARN_THROTTLE(1, "Ignoring jog command in unknown frame '%s'", frame.c_str());
+      return;
+    }
+    const Eigen::Matrix3d rotation = state_->getFrameTransform(frame).rotation();
+    twist.head<3>() = rotation * twist.head<3>();
+    twist.tail<3>() = rotation * twist.tail<3>();
+  }
+
+  if (!updatePseudoInverse())
+  {
+    ROS_WARN_THROTTLE(1, "Not jogging: group '%s' is close to a singularity", group_->getName().c_str());
+    return;
+  }
+
+  Eigen::VectorXd previous_positions;
+  state_->copyJointGroupPositions(group_, previous_positions);
+  Eigen::VectorXd velocity = collision_scale_ * (jacobian_pseudo_inverse_ * twist);
+  state_->setJointGroupPositions(group_, previous_positions + velocity * dt);
+  state_->enforceBounds(group_);
+  state_->update();
+
+  // the distance query is the most expensive step, so it only runs at the collision check period
+  if (last_collision_check_.isZero() || (now - last_collision_check_).toSec() >= collision_check_period_)
+  {
+    last_collision_check_ = now;
+    collision_scale_ = computeCollisionScale();
+    if (collision_scale_ <= 0.0)
+    {
+      state_->setJointGroupPositions(group_, previous_positions);
+      state_->update();
+      ROS_WARN_THROTTLE(1, "Not jogging: group '%s' would collide", group_->getName().c_str());
+      return;
+    }
+  }
+
+  Eigen::VectorXd positions;
+  state_->copyJointGroupPositions(group_, positions);
+  publishCommand((positions - previous_positions) / dt, dt);
+}
+
+bool move_group::MoveGroupJogCapability::updatePseudoInverse()
+{
+  Eigen::VectorXd positions;
+  state_->copyJointGroupPositions(group_, positions);
+  if (pseudo_inverse_positions_.size() == positions.size() && jacobian_pseudo_inverse_.size() > 0 &&
+      (positions - pseudo_inverse_positions_).cwiseAbs().maxCoeff() < pseudo_inverse_update_threshold_)
+    return pseudo_inverse_valid_;
+
+  Eigen::MatrixXd jacobian = state_->getJacobian(group_);
+  Eigen::JacobiSVD<Eigen::MatrixXd> svd(jacobian, Eigen::ComputeThinU | Eigen::ComputeThinV);
+  const Eigen::VectorXd& singular_values = svd.singularValues();
+  Eigen::VectorXd inverse_values(singular_values.size());
+  for (int i = 0; i < singular_values.size(); ++i)
+    inverse_values(i) = singular_values(i) > std::numeric_limits<double>::epsilon() ? 1.0 / singular_values(i) : 0.0;
+  jacobian_pseudo_inverse_ = svd.matrixV() * inverse_values.asDiagonal() * svd.matrixU().transpose();
+  pseudo_inverse_positions_ = positions;
+  pseudo_inverse_valid_ =
+      singular_values.size() > 0 && singular_values(singular_values.size() - 1) > singularity_threshold_;
+  return pseudo_inverse_valid_;
+}
+
+double move_group::MoveGroupJogCapability::computeCollisionScale()
+{
+  planning_scene_monitor::LockedPlanningSceneRO scene(context_->planning_scene_monitor_);
+  if (scene->isStateColliding(*state_, group_->getName()))
+    return 0.0;
+  if (collision_distance_threshold_ <= 0.0)
+    return 1.0;
+  double distance = scene->distanceToCollision(*state_);
+  return std::max(0.0, std::min(1.0, distance / collision_distance_threshold_));
+}
+
+void move_group::MoveGroupJogCapability::publishCommand(const Eigen::VectorXd& velocity, double dt)
+{
+  trajectory_msgs::JointTrajectoryPoint& point = command_.points[0];
+  for (std::size_t i = 0; i < command_.joint_names.size(); ++i)
+  {
+    point.positions[i] = state_->getVariablePosition(command_.joint_names[i]);
+    point.velocities[i] = command_group_index_[i] < 0 ? 0.0 : velocity(command_group_index_[i]);
+  }
+  point.time_from_start = ros::Duration(dt);
+  command_publisher_.publish(command_);
+}
+
+#include <class_loader/class_loader.hpp>
+CLASS_LOADER_REGISTER_CLASS(move_group::MoveGroupJogCapability, move_group::MoveGroupCapability)
@@ -0,0 +1,97 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#ifndef MOVEIT_MOVE_GROUP_JOG_CAPABILITY_
+#define MOVEIT_MOVE_GROUP_JOG_CAPABILITY_
+
+#include <moveit/move_group/move_group_capability.h>
+#include <geometry_msgs/TwistStamped.h>
+#include <trajectory_msgs/JointTrajectory.h>
+#include <Eigen/Core>
+
+namespace move_group
+{
+/** \brief Low-latency Cartesian jogging: converts twist commands for the tip of a group into joint commands that are
+    published directly to the group's controller, bypassing planning and trajectory execution.
+
+    Each command is mapped to joint velocities with a cached pseudo-inverse of the group Jacobian, which is only
+    recomputed once the joints moved noticeably. Motion is scaled down when the robot gets closer to the world than a
+    distance threshold and stops in collision or near singularities. */
+class MoveGroupJogCapability : public MoveGroupCapability
+{
+public:
+  MoveGroupJogCapability();
+
+  virtual void initialize();
+
+private:
+  void jogCallback(const geometry_msgs::TwistStampedConstPtr& msg);
+
+  /** \brief Recompute the pseudo-inverse if the joints moved since it was last computed; false near singularities */
+  bool updatePseudoInverse();
+
+  /** \brief Scale factor in [0, 1] for motion at the state the robot is commanded to, based on its distance to the
+      world */
+  double computeCollisionScale();
+
+  void publishCommand(const Eigen::VectorXd& velocity, double dt);
+
+  ros::Subscriber jog_subscriber_;
+  ros::Publisher command_publisher_;
+
+  const robot_model::JointModelGroup* group_;
+  robot_state::RobotStatePtr state_;  // the state the robot was last commanded to
+  ros::Time last_command_time_;
+
+  Eigen::MatrixXd jacobian_pseudo_inverse_;
+  Eigen::VectorXd pseudo_inverse_positions_;  // group positions the cached pseudo-inverse was computed at
+  bool pseudo_inverse_valid_;
+
+  ros::Time last_collision_check_;
+  double collision_scale_;
+
+  trajectory_msgs::JointTrajectory command_;
+  std::vector<int> command_group_index_;  // index of each command joint in the group, -1 if not part of it
+
+  double command_period_;
+  double command_timeout_;
+  double pseudo_inverse_update_threshold_;
+  double singularity_threshold_;
+  double collision_distance_threshold_;
+  double collision_check_period_;
+};
+}
+
+#endif  // MOVEIT_MOVE_GROUP_JOG_CAPABILITY_
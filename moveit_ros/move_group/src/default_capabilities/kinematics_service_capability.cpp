@@ -39,21 +39,73 @@
 #include <moveit/kinematic_constraints/utils.h>
 #include <eigen_conversions/eigen_msg.h>
 #include <moveit/move_group/capability_names.h>
+#include <boost/thread.hpp>
+#include <atomic>
 
-move_group::MoveGroupKinematicsService::MoveGroupKinematicsService() : MoveGroupCapability("KinematicsService")
+move_group::MoveGroupKinematicsService::MoveGroupKinematicsService()
+  : MoveGroupCapability("KinematicsService"), thread_count_(1)
 {
 }
 
+move_group::MoveGroupKinematicsService::~MoveGroupKinematicsService()
+{
+  if (spinner_)
+    spinner_->stop();
+}
+
 void move_group::MoveGroupKinematicsService::initialize()
 {
-  fk_service_ =
-      root_node_handle_.advertiseService(FK_SERVICE_NAME, &MoveGroupKinematicsService::computeFKService, this);
-  ik_service_ =
-      root_node_handle_.advertiseService(IK_SERVICE_NAME, &MoveGroupKinematicsService::computeIKService, this);
+  int thread_count;
+  if (node_handle_.getParam("kinematics_service_threads", thread_count) && thread_count > 0)
+    thread_count_ = thread_count;
+  else
+    thread_count_ = std::max(1u, boost::thread::hardware_concurrency());
+
+  // serve the kinematics services from their own queue, so requests do not wait for each other
+  ros::NodeHandle nh(root_node_handle_);
+  nh.setCallbackQueue(&callback_queue_);
+  fk_service_ = nh.advertiseService(FK_SERVICE_NAME, &MoveGroupKinematicsService::computeFKService, this);
+  ik_service_ = nh.advertiseService(IK_SERVICE_NAME, &MoveGroupKinematicsService::computeIKService, this);
+  fk_batch_service_ =
+      nh.advertiseService(FK_BATCH_SERVICE_NAME, &MoveGroupKinematicsService::computeFKBatchService, this);
+  ik_batch_service_ =
+      nh.advertiseService(IK_BATCH_SERVICE_NAME, &MoveGroupKinematicsService::computeIKBatchService, this);
+  spinner_.reset(new ros::AsyncSpinner(thread_count_, &callback_queue_));
+  spinner_->start();
 }
 
 namespace
 {
+/** Call fn(i) for all i < count, using up to thread_count threads (including the calling one) */
+template <typename Fn>
+void parallelFor(std::size_t count, std::size_t thread_count, const Fn& fn)
+{
+  // indices are handed out one at a time, so threads that hit cheap requests keep picking up work
+  std::atomic<std::size_t> next(0);
+  auto worker = [&]() {
+    for (std::size_t i = next++; i < count; i = next++)
+      fn(i);
+  };
+
+  thread_count = std::min(thread_count, count);
+  if (thread_count <= 1)
+  {
+    worker();
+    return;
+  }
+
+  boost::thread_group threads;
+  for (std::size_t t = 1; t < thread_count; ++t)
+    threads.create_thread(worker);
+  worker();
+  threads.join_all();
+}
+
+bool needsScene(const moveit_msgs::PositionIKRequest& req)
+{
+  return req.avoid_collisions || !kinematic_constraints::isEmpty(req.constraints);
+}
+
 bool isIKSolutionValid(const planning_scene::PlanningScene* planning_scene,
                        const kinematic_constraints::KinematicConstraintSet* constraint_set,
                        robot_state::RobotState* state, const robot_model::JointModelGroup* jmg,
@@ -140,6 +192,24 @@ void move_group::MoveGroupKinematicsService::computeIK(
     error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_GROUP_NAME;
 }
 
+void move_group::MoveGroupKinematicsService::computeIK(moveit_msgs::PositionIKRequest& req,
+                                                       moveit_msgs::RobotState& solution,
+                                                       moveit_msgs::MoveItErrorCodes& error_code,
+                                                       const robot_state::RobotState& start,
+                                                       const planning_scene::PlanningScene* scene) const
+{
+  robot_state::RobotState rs(start);
+  if (needsScene(req))
+  {
+    kinematic_constraints::KinematicConstraintSet kset(scene->getRobotModel());
+    kset.add(req.constraints, scene->getTransforms());
+    computeIK(req, solution, error_code, rs, boost::bind(&isIKSolutionValid, req.avoid_collisions ? scene : NULL,
+                                                         kset.empty() ? NULL : &kset, _1, _2, _3));
+  }
+  else
+    computeIK(req, solution, error_code, rs);
+}
+
 bool move_group::MoveGroupKinematicsService::computeIKService(moveit_msgs::GetPositionIK::Request& req,
                                                               moveit_msgs::GetPositionIK::Response& res)
 {
@@ -169,45 +239,120 @@ bool move_group::MoveGroupKinematicsService::computeIKService(moveit_msgs::GetPo
   return true;
 }
 
-bool move_group::MoveGroupKinematicsService::computeFKService(moveit_msgs::GetPositionFK::Request& req,
-                                                              moveit_msgs::GetPositionFK::Response& res)
+bool move_group::MoveGroupKinematicsService::computeIKBatchService(
+    moveit_ros_move_group::GetPositionIKBatch::Request& req, moveit_ros_move_group::GetPositionIKBatch::Response& res)
 {
-  if (req.fk_link_names.empty())
+  context_->planning_scene_monitor_->updateFrameTransforms();
+
+  const std::size_t count = req.ik_requests.size();
+  res.solutions.resize(count);
+  res.error_codes.resize(count);
+
+  bool need_scene = false;
+  for (const moveit_msgs::PositionIKRequest& ik_request : req.ik_requests)
+    need_scene |= needsScene(ik_request);
+
+  // the scene stays locked for the whole batch only if some request is checked against it
+  std::unique_ptr<planning_scene_monitor::LockedPlanningSceneRO> ls(
+      new planning_scene_monitor::LockedPlanningSceneRO(context_->planning_scene_monitor_));
+  const robot_state::RobotState start = (*ls)->getCurrentState();
+  const planning_scene::PlanningScene* scene = static_cast<const planning_scene::PlanningSceneConstPtr&>(*ls).get();
+  if (!need_scene)
   {
-    ROS_ERROR("No links specified for FK request");
-    res.error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_LINK_NAME;
-    return true;
+    ls.reset();
+    scene = NULL;
   }
 
-  context_->planning_scene_monitor_->updateFrameTransforms();
+  parallelFor(count, thread_count_, [&](std::size_t i) {
+    computeIK(req.ik_requests[i], res.solutions[i], res.error_codes[i], start, scene);
+  });
+  return true;
+}
 
-  const std::string& default_frame = context_->planning_scene_monitor_->getRobotModel()->getModelFrame();
-  bool do_transform = !req.header.frame_id.empty() &&
-                      !robot_state::Transforms::sameFrame(req.header.frame_id, default_frame) &&
+void move_group::MoveGroupKinematicsService::computeFK(const std::string& frame_id,
+                                                       const std::vector<std::string>& links,
+                                                       robot_state::RobotState& rs,
+                                                       std::vector<geometry_msgs::PoseStamped>& poses,
+                                                       std::vector<std::string>& found_links,
+                                                       moveit_msgs::MoveItErrorCodes& error_code) const
+{
+  const std::string& default_frame = rs.getRobotModel()->getModelFrame();
+  bool do_transform = !frame_id.empty() && !robot_state::Transforms::sameFrame(frame_id, default_frame) &&
                       context_->planning_scene_monitor_->getTFClient();
   bool tf_problem = false;
 
-  robot_state::RobotState rs =
-      planning_scene_monitor::LockedPlanningSceneRO(context_->planning_scene_monitor_)->getCurrentState();
-  robot_state::robotStateMsgToRobotState(req.robot_state, rs);
-  for (std::size_t i = 0; i < req.fk_link_names.size(); ++i)
-    if (rs.getRobotModel()->hasLinkModel(req.fk_link_names[i]))
+  std::size_t found = 0;
+  for (std::size_t i = 0; i < links.size(); ++i)
+    if (rs.getRobotModel()->hasLinkModel(links[i]))
     {
-      res.pose_stamped.resize(res.pose_stamped.size() + 1);
-      tf::poseEigenToMsg(rs.getGlobalLinkTransform(req.fk_link_names[i]), res.pose_stamped.back().pose);
-      res.pose_stamped.back().header.frame_id = default_frame;
-      res.pose_stamped.back().header.stamp = ros::Time::now();
+      poses.resize(poses.size() + 1);
+      tf::poseEigenToMsg(rs.getGlobalLinkTransform(links[i]), poses.back().pose);
+      poses.back().header.frame_id = default_frame;
+      poses.back().header.stamp = ros::Time::now();
       if (do_transform)
-        if (!performTransform(res.pose_stamped.back(), req.header.frame_id))
+        if (!performTransform(poses.back(), frame_id))
           tf_problem = true;
-      res.fk_link_names.push_back(req.fk_link_names[i]);
+      found_links.push_back(links[i]);
+      ++found;
     }
   if (tf_problem)
-    res.error_code.val = moveit_msgs::MoveItErrorCodes::FRAME_TRANSFORM_FAILURE;
-  else if (res.fk_link_names.size() == req.fk_link_names.size())
-    res.error_code.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
+    error_code.val = moveit_msgs::MoveItErrorCodes::FRAME_TRANSFORM_FAILURE;
+  else if (found == links.size())
+    error_code.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
   else
+    error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_LINK_NAME;
+}
+
+bool move_group::MoveGroupKinematicsService::computeFKService(moveit_msgs::GetPositionFK::Request& req,
+                                                              moveit_msgs::GetPositionFK::Response& res)
+{
+  if (req.fk_link_names.empty())
+  {
+    ROS_ERROR("No links specified for FK request");
     res.error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_LINK_NAME;
+    return true;
+  }
+
+  context_->planning_scene_monitor_->updateFrameTransforms();
+
+  robot_state::RobotState rs =
+      planning_scene_monitor::LockedPlanningSceneRO(context_->planning_scene_monitor_)->getCurrentState();
+  robot_state::robotStateMsgToRobotState(req.robot_state, rs);
+  computeFK(req.header.frame_id, req.fk_link_names, rs, res.pose_stamped, res.fk_link_names, res.error_code);
+  return true;
+}
+
+bool move_group::MoveGroupKinematicsService::computeFKBatchService(
+    moveit_ros_move_group::GetPositionFKBatch::Request& req, moveit_ros_move_group::GetPositionFKBatch::Response& res)
+{
+  const std::size_t count = req.robot_states.size();
+  res.error_codes.resize(count);
+  if (req.fk_link_names.empty())
+  {
+    ROS_ERROR("No links specified for FK request");
+    for (moveit_msgs::MoveItErrorCodes& error_code : res.error_codes)
+      error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_LINK_NAME;
+    return true;
+  }
+
+  context_->planning_scene_monitor_->updateFrameTransforms();
+
+  const robot_state::RobotState start =
+      planning_scene_monitor::LockedPlanningSceneRO(context_->planning_scene_monitor_)->getCurrentState();
+  const std::size_t link_count = req.fk_link_names.size();
+  res.pose_stamped.resize(count * link_count);
+
+  parallelFor(count, thread_count_, [&](std::size_t i) {
+    robot_state::RobotState rs(start);
+    robot_state::robotStateMsgToRobotState(req.robot_states[i], rs);
+    std::vector<geometry_msgs::PoseStamped> poses;
+    std::vector<std::string> found_links;
+    computeFK(req.header.frame_id, req.fk_link_names, rs, poses, found_links, res.error_codes[i]);
+    // unknown links leave their poses empty, so the layout stays fixed
+    for (std::size_t k = 0, j = 0; k < link_count && j < poses.size(); ++k)
+      if (req.fk_link_names[k] == found_links[j])
+        res.pose_stamped[i * link_count + k] = poses[j++];
+  });
   return true;
 }
 
@@ -40,27 +40,57 @@
 #include <moveit/move_group/move_group_capability.h>
 #include <moveit_msgs/GetPositionIK.h>
 #include <moveit_msgs/GetPositionFK.h>
+#include <moveit_ros_move_group/GetPositionIKBatch.h>
+#include <moveit_ros_move_group/GetPositionFKBatch.h>
+#include <ros/callback_queue.h>
+#include <memory>
 
 namespace move_group
 {
+/** @brief Forward and inverse kinematics services.
+ *
+ *  The services are served from their own callback queue by several threads, so independent requests run
+ *  concurrently. The batch services additionally spread the requests they carry over these threads. */
 class MoveGroupKinematicsService : public MoveGroupCapability
 {
 public:
   MoveGroupKinematicsService();
+  ~MoveGroupKinematicsService();
 
   virtual void initialize();
 
 private:
   bool computeIKService(moveit_msgs::GetPositionIK::Request& req, moveit_msgs::GetPositionIK::Response& res);
   bool computeFKService(moveit_msgs::GetPositionFK::Request& req, moveit_msgs::GetPositionFK::Response& res);
+  bool computeIKBatchService(moveit_ros_move_group::GetPositionIKBatch::Request& req,
+                             moveit_ros_move_group::GetPositionIKBatch::Response& res);
+  bool computeFKBatchService(moveit_ros_move_group::GetPositionFKBatch::Request& req,
+                             moveit_ros_move_group::GetPositionFKBatch::Response& res);
 
   void computeIK(
       moveit_msgs::PositionIKRequest& req, moveit_msgs::RobotState& solution, moveit_msgs::MoveItErrorCodes& error_code,
       robot_state::RobotState& rs,
       const robot_state::GroupStateValidityCallbackFn& constraint = robot_state::GroupStateValidityCallbackFn()) const;
 
+  /** @brief Solve \e req starting from \e start; collisions and constraints are checked against \e scene, which
+   *  may only be NULL if \e req needs neither */
+  void computeIK(moveit_msgs::PositionIKRequest& req, moveit_msgs::RobotState& solution,
+                 moveit_msgs::MoveItErrorCodes& error_code, const robot_state::RobotState& start,
+                 const planning_scene::PlanningScene* scene) const;
+
+  /** @brief Compute the poses of \e links for the state \e rs, in \e frame_id (the model frame if empty) */
+  void computeFK(const std::string& frame_id, const std::vector<std::string>& links, robot_state::RobotState& rs,
+                 std::vector<geometry_msgs::PoseStamped>& poses, std::vector<std::string>& found_links,
+                 moveit_msgs::MoveItErrorCodes& error_code) const;
+
   ros::ServiceServer fk_service_;
   ros::ServiceServer ik_service_;
+  ros::ServiceServer fk_batch_service_;
+  ros::ServiceServer ik_batch_service_;
+
+  unsigned int thread_count_;
+  ros::CallbackQueue callback_queue_;
+  std::unique_ptr<ros::AsyncSpinner> spinner_;
 };
 }
 
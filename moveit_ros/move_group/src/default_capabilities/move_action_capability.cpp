@@ -41,7 +41,15 @@
 #include <moveit/plan_execution/plan_with_sensing.h>
 #include <moveit/trajectory_processing/trajectory_tools.h>
 #include <moveit/kinematic_constraints/utils.h>
+#include <moveit/robot_state/conversions.h>
 #include <moveit/move_group/capability_names.h>
+#include <moveit/move_group/planning_scheduler.h>
+
+namespace
+{
+// the action server handles one goal at a time, so all its requests come from one scheduler client
+const std::string SCHEDULER_CLIENT = "move_group/" + move_group::MOVE_ACTION;
+}
 
 move_group::MoveGroupMoveAction::MoveGroupMoveAction()
   : MoveGroupCapability("MoveAction"), move_state_(IDLE), preempt_requested_{ false }
@@ -55,16 +63,21 @@ void move_group::MoveGroupMoveAction::initialize()
       root_node_handle_, MOVE_ACTION, boost::bind(&MoveGroupMoveAction::executeMoveCallback, this, _1), false));
   move_action_server_->registerPreemptCallback(boost::bind(&MoveGroupMoveAction::preemptMoveCallback, this));
   move_action_server_->start();
+  advertiseIntermediateSolutions();
 }
 
 void move_group::MoveGroupMoveAction::executeMoveCallback(const moveit_msgs::MoveGroupGoalConstPtr& goal)
 {
+  moveit_msgs::MoveGroupResult action_res;
+  RequestTraceScope trace(*this, action_res.error_code);
+
   setMoveState(PLANNING);
   // before we start planning, ensure that we have the latest robot state received...
-  context_->planning_scene_monitor_->waitForCurrentRobotState(ros::Time::now());
-  context_->planning_scene_monitor_->updateFrameTransforms();
-
-  moveit_msgs::MoveGroupResult action_res;
+  {
+    MOVEIT_PROBE_SPAN("MoveGroupMoveAction::waitForCurrentRobotState");
+    context_->planning_scene_monitor_->waitForCurrentRobotState(ros::Time::now());
+    context_->planning_scene_monitor_->updateFrameTransforms();
+  }
   if (goal->planning_options.plan_only || !context_->allow_trajectory_execution_)
   {
     if (!goal->planning_options.plan_only)
@@ -133,6 +146,10 @@ void move_group::MoveGroupMoveAction::executeMoveCallback_PlanAndExecute(const m
 
   opt.plan_callback_ =
       boost::bind(&MoveGroupMoveAction::planUsingPlanningPipeline, this, boost::cref(motion_plan_request), _1);
+  opt.plan_segment_callback_ = boost::bind(&MoveGroupMoveAction::planSegmentUsingPlanningPipeline, this,
+                                           boost::cref(motion_plan_request), _1, _2, _3, _4);
+  opt.repair_velocity_scaling_factor_ = motion_plan_request.max_velocity_scaling_factor;
+  opt.repair_acceleration_scaling_factor_ = motion_plan_request.max_acceleration_scaling_factor;
   if (goal->planning_options.look_around && context_->plan_with_sensing_)
   {
     opt.plan_callback_ = boost::bind(&plan_execution::PlanWithSensing::computePlan, context_->plan_with_sensing_.get(),
@@ -162,15 +179,8 @@ void move_group::MoveGroupMoveAction::executeMoveCallback_PlanOnly(const moveit_
 {
   ROS_INFO("Planning request received for MoveGroup action. Forwarding to planning pipeline.");
 
-  planning_scene_monitor::LockedPlanningSceneRO lscene(context_->planning_scene_monitor_);  // lock the scene so that it
-                                                                                            // does not modify the world
-                                                                                            // representation while
-                                                                                            // diff() is called
-  const planning_scene::PlanningSceneConstPtr& the_scene =
-      (planning_scene::PlanningScene::isEmpty(goal->planning_options.planning_scene_diff)) ?
-          static_cast<const planning_scene::PlanningSceneConstPtr&>(lscene) :
-          lscene->diff(goal->planning_options.planning_scene_diff);
   planning_interface::MotionPlanResponse res;
+  res.intermediate_solution_callback_ = getIntermediateSolutionCallback(goal->request);
 
   if (preempt_requested_)
   {
@@ -179,15 +189,25 @@ void move_group::MoveGroupMoveAction::executeMoveCallback_PlanOnly(const moveit_
     return;
   }
 
-  try
-  {
-    context_->planning_pipeline_->generatePlan(the_scene, goal->request, res);
-  }
-  catch (std::exception& ex)
-  {
-    ROS_ERROR("Planning pipeline threw an exception: %s", ex.what());
-    res.error_code_.val = moveit_msgs::MoveItErrorCodes::FAILURE;
-  }
+  runPlanningRequest(SCHEDULER_CLIENT, true,
+                     [&]() {
+                       // lock the scene so that it does not modify the world representation while diff() is called
+                       planning_scene_monitor::LockedPlanningSceneRO lscene(context_->planning_scene_monitor_);
+                       const planning_scene::PlanningSceneConstPtr& the_scene =
+                           (planning_scene::PlanningScene::isEmpty(goal->planning_options.planning_scene_diff)) ?
+                               static_cast<const planning_scene::PlanningSceneConstPtr&>(lscene) :
+                               lscene->diff(goal->planning_options.planning_scene_diff);
+                       try
+                       {
+                         context_->planning_pipeline_->generatePlan(the_scene, goal->request, res);
+                       }
+                       catch (std::exception& ex)
+                       {
+                         ROS_ERROR("Planning pipeline threw an exception: %s", ex.what());
+                         res.error_code_.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+                       }
+                     },
+                     res.error_code_);
 
   convertToMsg(res.trajectory_, action_res.trajectory_start, action_res.planned_trajectory);
   action_res.error_code = res.error_code_;
@@ -199,18 +219,24 @@ bool move_group::MoveGroupMoveAction::planUsingPlanningPipeline(const planning_i
 {
   setMoveState(PLANNING);
 
-  planning_scene_monitor::LockedPlanningSceneRO lscene(plan.planning_scene_monitor_);
   bool solved = false;
   planning_interface::MotionPlanResponse res;
-  try
-  {
-    solved = context_->planning_pipeline_->generatePlan(plan.planning_scene_, req, res);
-  }
-  catch (std::exception& ex)
-  {
-    ROS_ERROR("Planning pipeline threw an exception: %s", ex.what());
-    res.error_code_.val = moveit_msgs::MoveItErrorCodes::FAILURE;
-  }
+  res.intermediate_solution_callback_ = getIntermediateSolutionCallback(req);
+  if (!runPlanningRequest(SCHEDULER_CLIENT, true,
+                          [&]() {
+                            planning_scene_monitor::LockedPlanningSceneRO lscene(plan.planning_scene_monitor_);
+                            try
+                            {
+                              solved = context_->planning_pipeline_->generatePlan(plan.planning_scene_, req, res);
+                            }
+                            catch (std::exception& ex)
+                            {
+                              ROS_ERROR("Planning pipeline threw an exception: %s", ex.what());
+                              res.error_code_.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+                            }
+                          },
+                          res.error_code_))
+    solved = false;
   if (res.trajectory_)
   {
     plan.plan_components_.resize(1);
@@ -221,6 +247,45 @@ bool move_group::MoveGroupMoveAction::planUsingPlanningPipeline(const planning_i
   return solved;
 }
 
+bool move_group::MoveGroupMoveAction::planSegmentUsingPlanningPipeline(
+    const planning_interface::MotionPlanRequest& req, const plan_execution::ExecutableMotionPlan& plan,
+    const robot_state::RobotState& start, const robot_state::RobotState& goal,
+    robot_trajectory::RobotTrajectory& segment)
+{
+  if (!segment.getGroup())
+    return false;
+
+  // same planner and path constraints as the original request, but between two states of the group
+  planning_interface::MotionPlanRequest segment_req = req;
+  robot_state::robotStateToRobotStateMsg(start, segment_req.start_state, false);
+  segment_req.goal_constraints.assign(1,
+                                      kinematic_constraints::constructGoalConstraints(goal, segment.getGroup(), 1e-4));
+
+  setMoveState(PLANNING);
+  bool solved = false;
+  planning_interface::MotionPlanResponse res;
+  if (!runPlanningRequest(SCHEDULER_CLIENT, true,
+                          [&]() {
+                            planning_scene_monitor::LockedPlanningSceneRO lscene(plan.planning_scene_monitor_);
+                            try
+                            {
+                              solved =
+                                  context_->planning_pipeline_->generatePlan(plan.planning_scene_, segment_req, res);
+                            }
+                            catch (std::exception& ex)
+                            {
+                              ROS_ERROR("Planning pipeline threw an exception: %s", ex.what());
+                              res.error_code_.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+                            }
+                          },
+                          res.error_code_))
+    solved = false;
+  if (!solved || !res.trajectory_)
+    return false;
+  segment.swap(*res.trajectory_);
+  return true;
+}
+
 void move_group::MoveGroupMoveAction::startMoveExecutionCallback()
 {
   setMoveState(MONITOR);
@@ -234,7 +299,9 @@ void move_group::MoveGroupMoveAction::startMoveLookCallback()
 void move_group::MoveGroupMoveAction::preemptMoveCallback()
 {
   preempt_requested_ = true;
-  context_->plan_execution_->stop();
+  context_->planning_scheduler_->cancel(SCHEDULER_CLIENT);
+  if (context_->plan_execution_)
+    context_->plan_execution_->stop();
 }
 
 void move_group::MoveGroupMoveAction::setMoveState(MoveGroupState state)
@@ -63,6 +63,10 @@ private:
   void setMoveState(MoveGroupState state);
   bool planUsingPlanningPipeline(const planning_interface::MotionPlanRequest& req,
                                  plan_execution::ExecutableMotionPlan& plan);
+  bool planSegmentUsingPlanningPipeline(const planning_interface::MotionPlanRequest& req,
+                                        const plan_execution::ExecutableMotionPlan& plan,
+                                        const robot_state::RobotState& start, const robot_state::RobotState& goal,
+                                        robot_trajectory::RobotTrajectory& segment);
 
   std::unique_ptr<actionlib::SimpleActionServer<moveit_msgs::MoveGroupAction> > move_action_server_;
   moveit_msgs::MoveGroupFeedback move_feedback_;
@@ -38,18 +38,66 @@
 #include <moveit/planning_pipeline/planning_pipeline.h>
 #include <moveit/move_group/capability_names.h>
 
-move_group::MoveGroupPlanService::MoveGroupPlanService() : MoveGroupCapability("MotionPlanService")
+move_group::MoveGroupPlanService::MoveGroupPlanService() : MoveGroupCapability("MotionPlanService"), supersede_(false)
 {
 }
 
+move_group::MoveGroupPlanService::~MoveGroupPlanService()
+{
+  if (spinner_)
+    spinner_->stop();
+}
+
 void move_group::MoveGroupPlanService::initialize()
 {
-  plan_service_ =
-      root_node_handle_.advertiseService(PLANNER_SERVICE_NAME, &MoveGroupPlanService::computePlanService, this);
+  int threads;
+  node_handle_.param("planning_scheduler/service_threads", threads, 4);
+  // a new request of a client replaces its requests that are still queued
+  node_handle_.param("planning_scheduler/supersede", supersede_, false);
+
+  ros::NodeHandle nh(root_node_handle_);
+  nh.setCallbackQueue(&callback_queue_);
+  plan_service_ = nh.advertiseService(PLANNER_SERVICE_NAME, &MoveGroupPlanService::computePlanService, this);
+  compact_plan_service_ =
+      nh.advertiseService(PLANNER_COMPACT_SERVICE_NAME, &MoveGroupPlanService::computeCompactPlanService, this);
+  spinner_.reset(new ros::AsyncSpinner(std::max(1, threads), &callback_queue_));
+  spinner_->start();
+  advertiseIntermediateSolutions();
+}
+
+bool move_group::MoveGroupPlanService::computePlanService(
+    ros::ServiceEvent<moveit_msgs::GetMotionPlan::Request, moveit_msgs::GetMotionPlan::Response>& event)
+{
+  const moveit_msgs::GetMotionPlan::Request& req = event.getRequest();
+  moveit_msgs::GetMotionPlan::Response& res = event.getResponse();
+  RequestTraceScope trace(*this, res.motion_plan_response.error_code);
+  runPlanningRequest(event.getCallerName(), supersede_,
+                     boost::bind(&MoveGroupPlanService::computePlan, this, boost::cref(req), boost::ref(res)),
+                     res.motion_plan_response.error_code);
+  return true;
 }
 
-bool move_group::MoveGroupPlanService::computePlanService(moveit_msgs::GetMotionPlan::Request& req,
-                                                          moveit_msgs::GetMotionPlan::Response& res)
+bool move_group::MoveGroupPlanService::computeCompactPlanService(
+    ros::ServiceEvent<moveit_ros_move_group::GetCompactMotionPlan::Request,
+                      moveit_ros_move_group::GetCompactMotionPlan::Response>& event)
+{
+  moveit_msgs::GetMotionPlan::Request req;
+  req.motion_plan_request = event.getRequest().motion_plan_request;
+  moveit_msgs::GetMotionPlan::Response res;
+  RequestTraceScope trace(*this, res.motion_plan_response.error_code);
+  runPlanningRequest(event.getCallerName(), supersede_,
+                     boost::bind(&MoveGroupPlanService::computePlan, this, boost::cref(req), boost::ref(res)),
+                     res.motion_plan_response.error_code);
+
+  moveit_ros_move_group::GetCompactMotionPlan::Response& compact_res = event.getResponse();
+  compact_res.motion_plan_response = std::move(res.motion_plan_response);
+  encodeCompactResult(compact_res.motion_plan_response.trajectory_start, compact_res.motion_plan_response.trajectory,
+                      compact_res.compact_trajectory_start, compact_res.compact_trajectory);
+  return true;
+}
+
+void move_group::MoveGroupPlanService::computePlan(const moveit_msgs::GetMotionPlan::Request& req,
+                                                   moveit_msgs::GetMotionPlan::Response& res)
 {
   ROS_INFO("Received new planning service request...");
   // before we start planning, ensure that we have the latest robot state received...
@@ -62,6 +110,7 @@ bool move_group::MoveGroupPlanService::computePlanService(moveit_msgs::GetMotion
   try
   {
     planning_interface::MotionPlanResponse mp_res;
+    mp_res.intermediate_solution_callback_ = getIntermediateSolutionCallback(req.motion_plan_request);
     context_->planning_pipeline_->generatePlan(ps, req.motion_plan_request, mp_res);
     mp_res.getMessage(res.motion_plan_response);
   }
@@ -70,8 +119,6 @@ bool move_group::MoveGroupPlanService::computePlanService(moveit_msgs::GetMotion
     ROS_ERROR("Planning pipeline threw an exception: %s", ex.what());
     res.motion_plan_response.error_code.val = moveit_msgs::MoveItErrorCodes::FAILURE;
   }
-
-  return true;
 }
 
 #include <class_loader/class_loader.hpp>
@@ -39,6 +39,9 @@
 
 #include <moveit/move_group/move_group_capability.h>
 #include <moveit_msgs/GetMotionPlan.h>
+#include <moveit_ros_move_group/GetCompactMotionPlan.h>
+#include <ros/callback_queue.h>
+#include <memory>
 
 namespace move_group
 {
@@ -46,13 +49,24 @@ class MoveGroupPlanService : public MoveGroupCapability
 {
 public:
   MoveGroupPlanService();
+  ~MoveGroupPlanService();
 
   virtual void initialize();
 
 private:
-  bool computePlanService(moveit_msgs::GetMotionPlan::Request& req, moveit_msgs::GetMotionPlan::Response& res);
+  bool computePlanService(ros::ServiceEvent<moveit_msgs::GetMotionPlan::Request,
+                                            moveit_msgs::GetMotionPlan::Response>& event);
+  bool computeCompactPlanService(ros::ServiceEvent<moveit_ros_move_group::GetCompactMotionPlan::Request,
+                                                   moveit_ros_move_group::GetCompactMotionPlan::Response>& event);
+  void computePlan(const moveit_msgs::GetMotionPlan::Request& req, moveit_msgs::GetMotionPlan::Response& res);
 
   ros::ServiceServer plan_service_;
+  ros::ServiceServer compact_plan_service_;
+
+  // requests are accepted by several threads and handed to the planning scheduler, which decides what runs when
+  ros::CallbackQueue callback_queue_;
+  std::unique_ptr<ros::AsyncSpinner> spinner_;
+  bool supersede_;
 };
 }
 
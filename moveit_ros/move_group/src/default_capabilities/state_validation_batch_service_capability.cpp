@@ -0,0 +1,165 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include "state_validation_batch_service_capability.h"
+#include <moveit/robot_state/conversions.h>
+#include <moveit/kinematic_constraints/utils.h>
+#include <moveit/collision_detection/collision_tools.h>
+#include <moveit/move_group/capability_names.h>
+#include <boost/thread.hpp>
+#include <atomic>
+
+namespace
+{
+inline void setBit(std::vector<uint8_t>& bitmap, std::size_t index)
+{
+  bitmap[index / 8] |= 1 << (index % 8);
+}
+}
+
+move_group::MoveGroupStateValidationBatchService::MoveGroupStateValidationBatchService()
+  : MoveGroupCapability("StateValidationBatchService"), thread_count_(0)
+{
+}
+
+void move_group::MoveGroupStateValidationBatchService::initialize()
+{
+  int thread_count;
+  if (node_handle_.getParam("state_validity_batch_threads", thread_count) && thread_count > 0)
+    thread_count_ = thread_count;
+  else
+    thread_count_ = std::max(1u, boost::thread::hardware_concurrency());
+
+  validity_service_ = root_node_handle_.advertiseService(STATE_VALIDITY_BATCH_SERVICE_NAME,
+                                                         &MoveGroupStateValidationBatchService::computeService, this);
+}
+
+bool move_group::MoveGroupStateValidationBatchService::computeService(
+    moveit_ros_move_group::GetStateValidityBatch::Request& req,
+    moveit_ros_move_group::GetStateValidityBatch::Response& res)
+{
+  const std::size_t count = req.robot_states.size();
+  const std::size_t bytes = (count + 7) / 8;
+  res.valid.assign(bytes, 0);
+  res.in_collision.assign(bytes, 0);
+  res.constraints_violated.assign(bytes, 0);
+  if (count == 0)
+    return true;
+
+  // the lock is taken once; all states are checked against the same scene
+  planning_scene_monitor::LockedPlanningSceneRO ls(context_->planning_scene_monitor_);
+  const planning_scene::PlanningSceneConstPtr& scene = ls;
+  const robot_state::RobotState& current_state = scene->getCurrentState();
+
+  // configure collision request
+  collision_detection::CollisionRequest creq;
+  creq.group_name = req.group_name;
+  if (req.return_contacts)
+  {
+    creq.contacts = true;
+    creq.max_contacts = scene->getWorld()->size();
+    creq.max_contacts *= creq.max_contacts;
+  }
+
+  kinematic_constraints::KinematicConstraintSet kset(scene->getRobotModel());
+  if (!kinematic_constraints::isEmpty(req.constraints))
+    kset.add(req.constraints, scene->getTransforms());
+
+  std::vector<collision_detection::CollisionResult> cres(req.return_contacts ? count : 0);
+  std::vector<uint8_t> in_collision(count, 0);
+  std::vector<uint8_t> constraints_violated(count, 0);
+
+  // states are handed out one at a time, so threads that hit cheap states keep picking up work
+  std::atomic<std::size_t> next(0);
+  auto worker = [&]() {
+    robot_state::RobotState rs(current_state);
+    collision_detection::CollisionResult local_result;
+    for (std::size_t i = next++; i < count; i = next++)
+    {
+      rs = current_state;
+      robot_state::robotStateMsgToRobotState(req.robot_states[i], rs);
+      rs.update();
+
+      collision_detection::CollisionResult& result = req.return_contacts ? cres[i] : local_result;
+      result.clear();
+      scene->checkCollision(creq, result, rs);
+      in_collision[i] = result.collision;
+
+      if (!kset.empty() && !kset.decide(rs).satisfied)
+        constraints_violated[i] = 1;
+    }
+  };
+
+  std::size_t thread_count = std::min<std::size_t>(thread_count_, count);
+  if (thread_count <= 1)
+    worker();
+  else
+  {
+    boost::thread_group threads;
+    for (std::size_t t = 1; t < thread_count; ++t)
+      threads.create_thread(worker);
+    worker();
+    threads.join_all();
+  }
+
+  ros::Time time_now = ros::Time::now();
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    if (in_collision[i])
+      setBit(res.in_collision, i);
+    if (constraints_violated[i])
+      setBit(res.constraints_violated, i);
+    if (!in_collision[i] && !constraints_violated[i])
+      setBit(res.valid, i);
+
+    // copy contacts if any
+    if (req.return_contacts && cres[i].collision)
+      for (collision_detection::CollisionResult::ContactMap::const_iterator it = cres[i].contacts.begin();
+           it != cres[i].contacts.end(); ++it)
+        for (std::size_t k = 0; k < it->second.size(); ++k)
+        {
+          res.contacts.resize(res.contacts.size() + 1);
+          collision_detection::contactToMsg(it->second[k], res.contacts.back());
+          res.contacts.back().header.frame_id = scene->getPlanningFrame();
+          res.contacts.back().header.stamp = time_now;
+          res.contact_state_index.push_back(i);
+        }
+  }
+
+  return true;
+}
+
+#include <class_loader/class_loader.hpp>
+CLASS_LOADER_REGISTER_CLASS(move_group::MoveGroupStateValidationBatchService, move_group::MoveGroupCapability)
@@ -42,6 +42,10 @@
 #include <boost/tokenizer.hpp>
 #include <moveit/macros/console_colors.h>
 #include <moveit/move_group/node_name.h>
+#include <moveit/profiler/probes.h>
+#include <moveit/background_processing/thread_budget.h>
+#include <algorithm>
+#include <map>
 #include <memory>
 #include <set>
 
@@ -192,6 +196,34 @@ int main(int argc, char** argv)
     else
       ROS_INFO("MoveGroup debug mode is OFF");
 
+    // let readers (planning requests, state validation) work on scene snapshots instead of locking the scene
+    bool scene_snapshots;
+    ros::NodeHandle("~").param("use_scene_snapshots", scene_snapshots, false);
+    planning_scene_monitor->enableSceneSnapshots(scene_snapshots);
+
+    // publish only the changed octomap leaves, with a full octomap every octomap_keyframe_period publications
+    int octomap_keyframe_period;
+    ros::NodeHandle("~").param("octomap_keyframe_period", octomap_keyframe_period, 0);
+    planning_scene_monitor->publishOctomapDeltas(std::max(octomap_keyframe_period, 0));
+
+    // collect timing statistics of the instrumented code paths; a trace is written on shutdown if a file is given
+    bool enable_probes;
+    std::string probe_trace_file;
+    ros::NodeHandle("~").param("enable_probes", enable_probes, false);
+    ros::NodeHandle("~").param("probe_trace_file", probe_trace_file, std::string());
+    moveit::tools::probes::setEnabled(enable_probes);
+    moveit::tools::probes::setTracing(enable_probes && !probe_trace_file.empty());
+
+    // share the cores between the parallel sections of all subsystems instead of each using one thread per core
+    int thread_budget;
+    ros::NodeHandle("~").param("thread_budget", thread_budget, 0);
+    moveit::tools::ThreadBudget::setConcurrency(std::max(thread_budget, 0));
+    std::map<std::string, int> thread_budget_limits;
+    ros::NodeHandle("~").param("thread_budget_limits", thread_budget_limits, std::map<std::string, int>());
+    for (std::map<std::string, int>::const_iterator it = thread_budget_limits.begin();
+         it != thread_budget_limits.end(); ++it)
+      moveit::tools::ThreadBudget::setSubsystemLimit(it->first, std::max(it->second, 0));
+
     printf(MOVEIT_CONSOLE_COLOR_CYAN "Starting context monitors...\n" MOVEIT_CONSOLE_COLOR_RESET);
     planning_scene_monitor->startSceneMonitor();
     planning_scene_monitor->startWorldGeometryMonitor();
@@ -205,6 +237,15 @@ int main(int argc, char** argv)
     mge.status();
 
     ros::waitForShutdown();
+
+    if (enable_probes)
+    {
+      moveit::tools::probes::setEnabled(false);
+      moveit::tools::probes::setTracing(false);
+      moveit::tools::probes::consoleStats();
+      if (!probe_trace_file.empty() && moveit::tools::probes::writeChromeTrace(probe_trace_file))
+        ROS_INFO("Wrote probe trace to '%s'", probe_trace_file.c_str());
+    }
   }
   else
     ROS_ERROR("Planning scene not configured");
@@ -36,6 +36,41 @@
 
 #include <moveit/move_group/move_group_capability.h>
 #include <moveit/robot_state/conversions.h>
+#include <moveit/move_group/planning_scheduler.h>
+#include <moveit/move_group/capability_names.h>
+#include <moveit/robot_trajectory/trajectory_encoding.h>
+#include <moveit/trajectory_processing/iterative_time_parameterization.h>
+#include <moveit_msgs/DisplayTrajectory.h>
+#include <boost/bind.hpp>
+#include <chrono>
+
+namespace
+{
+void publishIntermediateSolution(const ros::Publisher& publisher, double max_velocity_scaling_factor,
+                                 double max_acceleration_scaling_factor,
+                                 const robot_trajectory::RobotTrajectoryPtr& trajectory, double cost)
+{
+  if (trajectory->empty())
+    return;
+
+  // executives pick up these solutions directly, so they are timed the same way the final solution is
+  trajectory_processing::IterativeParabolicTimeParameterization time_param;
+  if (!time_param.computeTimeStamps(*trajectory, max_velocity_scaling_factor, max_acceleration_scaling_factor))
+  {
+    ROS_WARN("Time parametrization for an intermediate solution failed; not publishing it.");
+    return;
+  }
+
+  moveit_msgs::DisplayTrajectory disp;
+  disp.model_id = trajectory->getRobotModel()->getName();
+  robot_state::robotStateToRobotStateMsg(trajectory->getFirstWayPoint(), disp.trajectory_start);
+  disp.trajectory.resize(1);
+  trajectory->getRobotTrajectoryMsg(disp.trajectory[0]);
+  publisher.publish(disp);
+  ROS_DEBUG("Published an intermediate solution with %u states and cost %g",
+            (unsigned int)trajectory->getWayPointCount(), cost);
+}
+}
 
 void move_group::MoveGroupCapability::setContext(const MoveGroupContextPtr& context)
 {
@@ -204,3 +239,95 @@ bool move_group::MoveGroupCapability::performTransform(geometry_msgs::PoseStampe
   }
   return true;
 }
+
+namespace
+{
+inline std::uint64_t steadyNow()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// run fn with the trace of the client thread current, after recording how long the request waited for a worker
+void runTraced(const boost::function<void()>& fn, const moveit::tools::probes::RequestTracePtr& trace,
+               std::uint64_t queued_ns)
+{
+  static const moveit::tools::probes::ProbeId WAIT_PROBE =
+      moveit::tools::probes::registerProbe("PlanningScheduler::wait");
+  trace->addSpan(WAIT_PROBE, queued_ns, steadyNow() - queued_ns);
+  moveit::tools::probes::ScopedRequestTrace trace_scope(trace.get());
+  fn();
+}
+}
+
+move_group::MoveGroupCapability::RequestTraceScope::RequestTraceScope(const MoveGroupCapability& capability,
+                                                                      const moveit_msgs::MoveItErrorCodes& error_code)
+  : context_(capability.context_)
+  , error_code_(error_code)
+  , trace_(context_->startRequestTrace(capability.getName()))
+  , trace_scope_(trace_.get())
+{
+}
+
+move_group::MoveGroupCapability::RequestTraceScope::~RequestTraceScope()
+{
+  context_->publishRequestTrace(trace_, error_code_.val);
+}
+
+bool move_group::MoveGroupCapability::runPlanningRequest(const std::string& client, bool supersede,
+                                                         const boost::function<void()>& fn,
+                                                         moveit_msgs::MoveItErrorCodes& error_code) const
+{
+  PlanningScheduler::Request request;
+  request.client = client;
+  request.supersede = supersede;
+  if (!context_->planning_queue_timeout_.isZero())
+    request.deadline = ros::WallTime::now() + context_->planning_queue_timeout_;
+
+  // the request runs on a worker thread, which continues the trace of the calling thread
+  PlanningScheduler::Status status;
+  if (moveit::tools::probes::RequestTrace* trace = moveit::tools::probes::getCurrentRequestTrace())
+    status = context_->planning_scheduler_->run(
+        request, boost::bind(&runTraced, boost::cref(fn), trace->shared_from_this(), steadyNow()));
+  else
+    status = context_->planning_scheduler_->run(request, fn);
+  if (status == PlanningScheduler::COMPLETED)
+    return true;
+
+  ROS_WARN("Planning request from '%s' did not run: %s", client.c_str(), PlanningScheduler::statusToString(status));
+  if (status == PlanningScheduler::REJECTED)
+    error_code.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+  else if (status == PlanningScheduler::DEADLINE_MISSED)
+    error_code.val = moveit_msgs::MoveItErrorCodes::TIMED_OUT;
+  else
+    error_code.val = moveit_msgs::MoveItErrorCodes::PREEMPTED;
+  return false;
+}
+
+void move_group::MoveGroupCapability::advertiseIntermediateSolutions()
+{
+  intermediate_solution_publisher_ =
+      node_handle_.advertise<moveit_msgs::DisplayTrajectory>(INTERMEDIATE_SOLUTIONS_TOPIC, 10);
+}
+
+planning_interface::IntermediateSolutionCallback
+move_group::MoveGroupCapability::getIntermediateSolutionCallback(const planning_interface::MotionPlanRequest& req) const
+{
+  // converting and publishing the solutions is only worth it if someone listens
+  if (!intermediate_solution_publisher_ || intermediate_solution_publisher_.getNumSubscribers() == 0)
+    return planning_interface::IntermediateSolutionCallback();
+  return boost::bind(&publishIntermediateSolution, intermediate_solution_publisher_, req.max_velocity_scaling_factor,
+                     req.max_acceleration_scaling_factor, _1, _2);
+}
+
+void move_group::MoveGroupCapability::encodeCompactResult(moveit_msgs::RobotState& start_state,
+                                                          moveit_msgs::RobotTrajectory& trajectory,
+                                                          std::vector<uint8_t>& compact_start_state,
+                                                          std::vector<uint8_t>& compact_trajectory) const
+{
+  const robot_model::RobotModelConstPtr& robot_model = context_->planning_scene_monitor_->getRobotModel();
+  if (robot_trajectory::encodeRobotState(start_state, robot_model, compact_start_state))
+    start_state = moveit_msgs::RobotState();
+  if (robot_trajectory::encodeTrajectory(trajectory, *robot_model, compact_trajectory))
+    trajectory = moveit_msgs::RobotTrajectory();
+}
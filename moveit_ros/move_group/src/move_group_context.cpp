@@ -39,6 +39,14 @@
 #include <moveit/planning_pipeline/planning_pipeline.h>
 #include <moveit/plan_execution/plan_execution.h>
 #include <moveit/plan_execution/plan_with_sensing.h>
+#include <moveit/move_group/planning_scheduler.h>
+#include <moveit/move_group/capability_names.h>
+#include <moveit_msgs/MoveItErrorCodes.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include <ros/node_handle.h>
+#include <algorithm>
+#include <cstdio>
+#include <map>
 
 move_group::MoveGroupContext::MoveGroupContext(
     const planning_scene_monitor::PlanningSceneMonitorPtr& planning_scene_monitor, bool allow_trajectory_execution,
@@ -46,6 +54,8 @@ move_group::MoveGroupContext::MoveGroupContext(
   : planning_scene_monitor_(planning_scene_monitor)
   , allow_trajectory_execution_(allow_trajectory_execution)
   , debug_(debug)
+  , trace_requests_(false)
+  , traced_request_count_(0)
 {
   planning_pipeline_.reset(new planning_pipeline::PlanningPipeline(planning_scene_monitor_->getRobotModel()));
 
@@ -65,10 +75,38 @@ move_group::MoveGroupContext::MoveGroupContext(
 
   if (debug_)
     planning_pipeline_->publishReceivedRequests(true);
+
+  // planning requests of all capabilities are run by one scheduler
+  ros::NodeHandle nh("~/planning_scheduler");
+  int threads, queue_size, max_running_per_client;
+  double queue_timeout;
+  nh.param("threads", threads, 2);
+  nh.param("queue_size", queue_size, 16);
+  nh.param("max_running_per_client", max_running_per_client, 1);
+  nh.param("queue_timeout", queue_timeout, 0.0);
+  planning_scheduler_.reset(new PlanningScheduler(std::max(1, threads), std::max(1, queue_size),
+                                                  std::max(1, max_running_per_client)));
+  planning_queue_timeout_ = ros::WallDuration(std::max(0.0, queue_timeout));
+
+  std::map<std::string, int> client_priorities;
+  if (nh.getParam("client_priorities", client_priorities))
+    for (const std::pair<const std::string, int>& client : client_priorities)
+      planning_scheduler_->setClientPriority(client.first, client.second);
+
+  // trace the stages of every request; the probe totals of a trace are only collected while probes are enabled
+  ros::NodeHandle node_handle("~");
+  node_handle.param("request_tracing", trace_requests_, false);
+  node_handle.param("request_trace_directory", request_trace_directory_, std::string());
+  if (trace_requests_)
+  {
+    request_trace_publisher_ = node_handle.advertise<diagnostic_msgs::DiagnosticArray>(REQUEST_TRACES_TOPIC, 100);
+    moveit::tools::probes::setEnabled(true);
+  }
 }
 
 move_group::MoveGroupContext::~MoveGroupContext()
 {
+  planning_scheduler_.reset();
   plan_with_sensing_.reset();
   plan_execution_.reset();
   trajectory_execution_manager_.reset();
@@ -76,6 +114,64 @@ move_group::MoveGroupContext::~MoveGroupContext()
   planning_scene_monitor_.reset();
 }
 
+moveit::tools::probes::RequestTracePtr
+move_group::MoveGroupContext::startRequestTrace(const std::string& capability)
+{
+  if (!trace_requests_)
+    return moveit::tools::probes::RequestTracePtr();
+  std::string id = capability + "-" + std::to_string(++traced_request_count_);
+  ROS_DEBUG("Tracing request %s", id.c_str());
+  return std::make_shared<moveit::tools::probes::RequestTrace>(id);
+}
+
+void move_group::MoveGroupContext::publishRequestTrace(const moveit::tools::probes::RequestTracePtr& trace,
+                                                       int error_code) const
+{
+  if (!trace)
+    return;
+
+  const double elapsed = trace->getElapsed();
+  diagnostic_msgs::DiagnosticArray msg;
+  msg.header.stamp = ros::Time::now();
+  msg.status.resize(1);
+  diagnostic_msgs::DiagnosticStatus& status = msg.status[0];
+  status.name = "move_group: request trace";
+  status.hardware_id = trace->getId();
+  status.level = error_code == moveit_msgs::MoveItErrorCodes::SUCCESS ? diagnostic_msgs::DiagnosticStatus::OK :
+                                                                        diagnostic_msgs::DiagnosticStatus::WARN;
+  char buffer[128];
+  std::snprintf(buffer, sizeof(buffer), "%.6f s, error code %d", elapsed, error_code);
+  status.message = buffer;
+
+  // the spans give the timeline of the stages; the totals account for what was measured within them
+  const std::vector<moveit::tools::probes::RequestTrace::Span> spans = trace->getSpans();
+  for (std::size_t i = 0; i < spans.size(); ++i)
+  {
+    diagnostic_msgs::KeyValue kv;
+    kv.key = spans[i].name;
+    std::snprintf(buffer, sizeof(buffer), "%.6f s at %.6f s", spans[i].duration, spans[i].start);
+    kv.value = buffer;
+    status.values.push_back(kv);
+  }
+  const std::vector<moveit::tools::probes::ProbeStats> stats = trace->getStats();
+  for (std::size_t i = 0; i < stats.size(); ++i)
+  {
+    diagnostic_msgs::KeyValue kv;
+    kv.key = "total: " + stats[i].name;
+    if (stats[i].timed > 0)
+      std::snprintf(buffer, sizeof(buffer), "%.6f s in %llu calls", stats[i].total,
+                    static_cast<unsigned long long>(stats[i].timed));
+    else
+      std::snprintf(buffer, sizeof(buffer), "%llu hits", static_cast<unsigned long long>(stats[i].count));
+    kv.value = buffer;
+    status.values.push_back(kv);
+  }
+  request_trace_publisher_.publish(msg);
+
+  if (!request_trace_directory_.empty())
+    trace->writeChromeTrace(request_trace_directory_ + "/" + trace->getId() + ".json");
+}
+
 bool move_group::MoveGroupContext::status() const
 {
   const planning_interface::PlannerManagerPtr& planner_interface = planning_pipeline_->getPlannerManager();
@@ -0,0 +1,290 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/move_group/planning_scheduler.h>
+#include <ros/console.h>
+#include <algorithm>
+
+namespace move_group
+{
+static const std::string LOGNAME = "planning_scheduler";
+
+struct PlanningScheduler::Entry
+{
+  Request request;
+  boost::function<void()> fn;
+  unsigned long sequence;
+  bool running;
+  bool superseded;
+  bool done;
+  Status status;
+};
+
+namespace
+{
+bool hasDeadline(const ros::WallTime& deadline)
+{
+  return !deadline.isZero();
+}
+
+/** true if request a should be started before request b */
+template <typename EntryPtr>
+bool moreUrgent(const EntryPtr& a, const EntryPtr& b)
+{
+  if (a->request.priority != b->request.priority)
+    return a->request.priority < b->request.priority;
+  if (hasDeadline(a->request.deadline) != hasDeadline(b->request.deadline))
+    return hasDeadline(a->request.deadline);
+  if (a->request.deadline != b->request.deadline)
+    return a->request.deadline < b->request.deadline;
+  return a->sequence < b->sequence;
+}
+}
+
+PlanningScheduler::PlanningScheduler(unsigned int thread_count, std::size_t max_queue_size,
+                                     unsigned int max_running_per_client)
+  : max_queue_size_(std::max<std::size_t>(1, max_queue_size))
+  , max_running_per_client_(std::max(1u, max_running_per_client))
+  , next_sequence_(0)
+  , stop_(false)
+{
+  for (unsigned int i = 0; i < std::max(1u, thread_count); ++i)
+    workers_.create_thread(boost::bind(&PlanningScheduler::worker, this));
+}
+
+PlanningScheduler::~PlanningScheduler()
+{
+  {
+    boost::mutex::scoped_lock slock(lock_);
+    stop_ = true;
+    for (const EntryPtr& entry : queue_)
+      finish(entry, CANCELLED);
+    queue_.clear();
+  }
+  work_condition_.notify_all();
+  workers_.join_all();
+}
+
+PlanningScheduler::Status PlanningScheduler::run(const Request& request, const boost::function<void()>& fn)
+{
+  EntryPtr entry(new Entry());
+  entry->request = request;
+  entry->fn = fn;
+  entry->running = false;
+  entry->superseded = false;
+  entry->done = false;
+  entry->status = COMPLETED;
+
+  boost::mutex::scoped_lock slock(lock_);
+  if (stop_)
+    return CANCELLED;
+  entry->sequence = next_sequence_++;
+  std::map<std::string, int>::const_iterator priority = client_priorities_.find(request.client);
+  if (priority != client_priorities_.end())
+    entry->request.priority = priority->second;
+
+  if (request.supersede)
+  {
+    for (std::size_t i = 0; i < queue_.size();)
+      if (queue_[i]->request.client == request.client)
+      {
+        finish(queue_[i], SUPERSEDED);
+        queue_.erase(queue_.begin() + i);
+      }
+      else
+        ++i;
+    for (const EntryPtr& running : running_)
+      if (running->request.client == request.client)
+        running->superseded = true;
+  }
+
+  // backpressure: a full queue only admits a request that is more urgent than the least urgent one queued
+  if (queue_.size() >= max_queue_size_)
+  {
+    std::vector<EntryPtr>::iterator least_urgent = std::max_element(queue_.begin(), queue_.end(), moreUrgent<EntryPtr>);
+    if (!moreUrgent(entry, *least_urgent))
+    {
+      ROS_WARN_NAMED(LOGNAME, "Planning queue is full; rejecting request from '%s'", request.client.c_str());
+      return REJECTED;
+    }
+    ROS_WARN_NAMED(LOGNAME, "Planning queue is full; rejecting queued request from '%s'",
+                   (*least_urgent)->request.client.c_str());
+    finish(*least_urgent, REJECTED);
+    queue_.erase(least_urgent);
+  }
+
+  queue_.push_back(entry);
+  // workers that cannot take a request because of the per-client limit go back to waiting, so wake them all
+  work_condition_.notify_all();
+
+  while (!entry->done)
+  {
+    if (entry->running || !hasDeadline(entry->request.deadline))
+    {
+      done_condition_.wait(slock);
+      continue;
+    }
+
+    const ros::WallDuration remaining = entry->request.deadline - ros::WallTime::now();
+    if (remaining <= ros::WallDuration())
+    {
+      queue_.erase(std::find(queue_.begin(), queue_.end(), entry));
+      finish(entry, DEADLINE_MISSED);
+      break;
+    }
+    done_condition_.timed_wait(slock, boost::posix_time::microseconds(remaining.toNSec() / 1000 + 1));
+  }
+  return entry->status;
+}
+
+void PlanningScheduler::cancel(const std::string& client)
+{
+  boost::mutex::scoped_lock slock(lock_);
+  for (std::size_t i = 0; i < queue_.size();)
+    if (queue_[i]->request.client == client)
+    {
+      finish(queue_[i], CANCELLED);
+      queue_.erase(queue_.begin() + i);
+    }
+    else
+      ++i;
+}
+
+void PlanningScheduler::setClientPriority(const std::string& client, int priority)
+{
+  boost::mutex::scoped_lock slock(lock_);
+  client_priorities_[client] = priority;
+}
+
+std::size_t PlanningScheduler::getQueueSize() const
+{
+  boost::mutex::scoped_lock slock(lock_);
+  return queue_.size();
+}
+
+const char* PlanningScheduler::statusToString(Status status)
+{
+  switch (status)
+  {
+    case COMPLETED:
+      return "completed";
+    case REJECTED:
+      return "rejected (queue full)";
+    case DEADLINE_MISSED:
+      return "deadline missed";
+    case SUPERSEDED:
+      return "superseded";
+    case CANCELLED:
+      return "cancelled";
+  }
+  return "unknown";
+}
+
+void PlanningScheduler::worker()
+{
+  while (true)
+  {
+    EntryPtr entry;
+    {
+      boost::mutex::scoped_lock slock(lock_);
+      while (!stop_ && !(entry = popNextEntry()))
+        work_condition_.wait(slock);
+      if (!entry)
+        return;
+      entry->running = true;
+      running_.push_back(entry);
+      ++running_per_client_[entry->request.client];
+    }
+
+    try
+    {
+      entry->fn();
+    }
+    catch (std::exception& ex)
+    {
+      ROS_ERROR_NAMED(LOGNAME, "Planning request from '%s' threw an exception: %s", entry->request.client.c_str(),
+                      ex.what());
+    }
+
+    {
+      boost::mutex::scoped_lock slock(lock_);
+      running_.erase(std::find(running_.begin(), running_.end(), entry));
+      if (--running_per_client_[entry->request.client] == 0)
+        running_per_client_.erase(entry->request.client);
+      finish(entry, entry->superseded ? SUPERSEDED : COMPLETED);
+    }
+    // a slot of this client became available
+    work_condition_.notify_all();
+  }
+}
+
+PlanningScheduler::EntryPtr PlanningScheduler::popNextEntry()
+{
+  // drop the requests that can no longer be started in time
+  const ros::WallTime now = ros::WallTime::now();
+  for (std::size_t i = 0; i < queue_.size();)
+    if (hasDeadline(queue_[i]->request.deadline) && queue_[i]->request.deadline <= now)
+    {
+      finish(queue_[i], DEADLINE_MISSED);
+      queue_.erase(queue_.begin() + i);
+    }
+    else
+      ++i;
+
+  std::vector<EntryPtr>::iterator best = queue_.end();
+  for (std::vector<EntryPtr>::iterator it = queue_.begin(); it != queue_.end(); ++it)
+  {
+    std::map<std::string, unsigned int>::const_iterator running = running_per_client_.find((*it)->request.client);
+    if (running != running_per_client_.end() && running->second >= max_running_per_client_)
+      continue;
+    if (best == queue_.end() || moreUrgent(*it, *best))
+      best = it;
+  }
+  if (best == queue_.end())
+    return EntryPtr();
+  EntryPtr entry = *best;
+  queue_.erase(best);
+  return entry;
+}
+
+void PlanningScheduler::finish(const EntryPtr& entry, Status status)
+{
+  entry->done = true;
+  entry->status = status;
+  if (status != COMPLETED)
+    ROS_DEBUG_NAMED(LOGNAME, "Planning request from '%s' %s", entry->request.client.c_str(), statusToString(status));
+  done_condition_.notify_all();
+}
+}
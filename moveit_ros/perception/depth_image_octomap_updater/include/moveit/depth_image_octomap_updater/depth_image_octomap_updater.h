@@ -66,6 +66,14 @@ private:
   bool getShapeTransform(mesh_filter::MeshHandle h, Eigen::Affine3d& transform) const;
   void stopHelper();
 
+  /** \brief Project the pixels [x_begin, x_end) of one row of a depth image (scaled to meters by \e scale) into the
+      map frame, collecting the keys of unfiltered pixels in \e occupied_cells and those of model or far clipped pixels
+      in \e model_cells. Called concurrently for different rows. */
+  template <typename T>
+  void projectDepthRow(const T* input_row, float scale, const unsigned int* labels_row, float y_factor, int x_begin,
+                       int x_end, const tf::Transform& map_H_sensor, octomap::KeySet& occupied_cells,
+                       octomap::KeySet& model_cells) const;
+
   ros::NodeHandle nh_;
   boost::shared_ptr<tf::Transformer> tf_;
   image_transport::ImageTransport input_depth_transport_;
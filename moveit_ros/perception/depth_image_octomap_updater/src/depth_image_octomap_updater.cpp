@@ -36,6 +36,7 @@
 
 #include <moveit/depth_image_octomap_updater/depth_image_octomap_updater.h>
 #include <moveit/occupancy_map_monitor/occupancy_map_monitor.h>
+#include <moveit/profiler/probes.h>
 #include <geometric_shapes/shape_operations.h>
 #include <sensor_msgs/image_encodings.h>
 #include <XmlRpcException.h>
@@ -205,12 +206,49 @@ bool host_is_big_endian(void)
 
 static const bool HOST_IS_BIG_ENDIAN = host_is_big_endian();
 
+template <typename T>
+void DepthImageOctomapUpdater::projectDepthRow(const T* input_row, float scale, const unsigned int* labels_row,
+                                               float y_factor, int x_begin, int x_end,
+                                               const tf::Transform& map_H_sensor, octomap::KeySet& occupied_cells,
+                                               octomap::KeySet& model_cells) const
+{
+  // neighbouring pixels usually fall into the same voxel; skip the set insertion for repeated keys
+  octomap::OcTreeKey last_key;
+  octomap::KeySet* last_set = NULL;
+  for (int x = x_begin; x < x_end; ++x)
+  {
+    octomap::KeySet* cells;
+    // not filtered
+    if (labels_row[x] == mesh_filter::MeshFilterBase::Background)
+      cells = &occupied_cells;
+    // on far plane or a model point -> remove
+    else if (labels_row[x] >= mesh_filter::MeshFilterBase::FarClip)
+      cells = &model_cells;
+    else
+      continue;
+
+    float zz = (float)input_row[x] * scale;
+    float yy = y_factor * zz;
+    float xx = x_cache_[x] * zz;
+    /* transform to map frame */
+    tf::Vector3 point_tf = map_H_sensor * tf::Vector3(xx, yy, zz);
+    octomap::OcTreeKey key = tree_->coordToKey(point_tf.getX(), point_tf.getY(), point_tf.getZ());
+    if (cells == last_set && key == last_key)
+      continue;
+    cells->insert(key);
+    last_key = key;
+    last_set = cells;
+  }
+}
+
 void DepthImageOctomapUpdater::depthImageCallback(const sensor_msgs::ImageConstPtr& depth_msg,
                                                   const sensor_msgs::CameraInfoConstPtr& info_msg)
 {
   ROS_DEBUG("Received a new depth image message (frame = '%s', encoding='%s')", depth_msg->header.frame_id.c_str(),
             depth_msg->encoding.c_str());
   ros::WallTime start = ros::WallTime::now();
+  MOVEIT_PROBE_SCOPE("DepthImageOctomapUpdater::depthImageCallback");
+  recordMessageAge(depth_msg->header.stamp);
 
   if (max_update_rate_ > 0)
   {
@@ -449,96 +487,62 @@ void DepthImageOctomapUpdater::depthImageCallback(const sensor_msgs::ImageConstP
   // figure out occupied cells and model cells
   tree_->lockRead();
 
-  try
+  // rows are independent, so they are projected in parallel into per-thread key sets that are merged at the end
+  bool failed = false;
+  const int h_bound = h - skip_vertical_pixels_;
+  const int w_bound = w - skip_horizontal_pixels_;
+#pragma omp parallel
   {
-    const int h_bound = h - skip_vertical_pixels_;
-    const int w_bound = w - skip_horizontal_pixels_;
-
-    if (is_u_short)
+    octomap::KeySet thread_occupied_cells, thread_model_cells;
+    bool thread_failed = false;
+    try
     {
-      const uint16_t* input_row = reinterpret_cast<const uint16_t*>(&depth_msg->data[0]);
-
-      for (int y = skip_vertical_pixels_; y < h_bound; ++y, labels_row += w, input_row += w)
-        for (int x = skip_horizontal_pixels_; x < w_bound; ++x)
-        {
-          // not filtered
-          if (labels_row[x] == mesh_filter::MeshFilterBase::Background)
-          {
-            float zz = (float)input_row[x] * 1e-3;  // scale from mm to m
-            float yy = y_cache_[y] * zz;
-            float xx = x_cache_[x] * zz;
-            /* transform to map frame */
-            tf::Vector3 point_tf = map_H_sensor * tf::Vector3(xx, yy, zz);
-            occupied_cells.insert(tree_->coordToKey(point_tf.getX(), point_tf.getY(), point_tf.getZ()));
-          }
-          // on far plane or a model point -> remove
-          else if (labels_row[x] >= mesh_filter::MeshFilterBase::FarClip)
-          {
-            float zz = input_row[x] * 1e-3;
-            float yy = y_cache_[y] * zz;
-            float xx = x_cache_[x] * zz;
-            /* transform to map frame */
-            tf::Vector3 point_tf = map_H_sensor * tf::Vector3(xx, yy, zz);
-            // add to the list of model cells
-            model_cells.insert(tree_->coordToKey(point_tf.getX(), point_tf.getY(), point_tf.getZ()));
-          }
-        }
+#pragma omp for schedule(static)
+      for (int y = skip_vertical_pixels_; y < h_bound; ++y)
+        if (is_u_short)
+          projectDepthRow(reinterpret_cast<const uint16_t*>(&depth_msg->data[0]) + y * w, 1e-3f, labels_row + y * w,
+                          y_cache_[y], skip_horizontal_pixels_, w_bound, map_H_sensor, thread_occupied_cells,
+                          thread_model_cells);
+        else
+          projectDepthRow(reinterpret_cast<const float*>(&depth_msg->data[0]) + y * w, 1.0f, labels_row + y * w,
+                          y_cache_[y], skip_horizontal_pixels_, w_bound, map_H_sensor, thread_occupied_cells,
+                          thread_model_cells);
     }
-    else
+    catch (...)
     {
-      const float* input_row = reinterpret_cast<const float*>(&depth_msg->data[0]);
+      thread_failed = true;
+    }
 
-      for (int y = skip_vertical_pixels_; y < h_bound; ++y, labels_row += w, input_row += w)
-        for (int x = skip_horizontal_pixels_; x < w_bound; ++x)
-        {
-          if (labels_row[x] == mesh_filter::MeshFilterBase::Background)
-          {
-            float zz = input_row[x];
-            float yy = y_cache_[y] * zz;
-            float xx = x_cache_[x] * zz;
-            /* transform to map frame */
-            tf::Vector3 point_tf = map_H_sensor * tf::Vector3(xx, yy, zz);
-            occupied_cells.insert(tree_->coordToKey(point_tf.getX(), point_tf.getY(), point_tf.getZ()));
-          }
-          else if (labels_row[x] >= mesh_filter::MeshFilterBase::FarClip)
-          {
-            float zz = input_row[x];
-            float yy = y_cache_[y] * zz;
-            float xx = x_cache_[x] * zz;
-            /* transform to map frame */
-            tf::Vector3 point_tf = map_H_sensor * tf::Vector3(xx, yy, zz);
-            // add to the list of model cells
-            model_cells.insert(tree_->coordToKey(point_tf.getX(), point_tf.getY(), point_tf.getZ()));
-          }
-        }
+#pragma omp critical
+    {
+      failed = failed || thread_failed;
+      occupied_cells.insert(thread_occupied_cells.begin(), thread_occupied_cells.end());
+      model_cells.insert(thread_model_cells.begin(), thread_model_cells.end());
     }
   }
-  catch (...)
+  tree_->unlockRead();
+
+  if (failed)
   {
-    tree_->unlockRead();
     ROS_ERROR("Internal error while parsing depth data");
+    delete occupied_cells_ptr;
+    delete model_cells_ptr;
     return;
   }
-  tree_->unlockRead();
 
   /* cells that overlap with the model are not occupied */
   for (octomap::KeySet::iterator it = model_cells.begin(), end = model_cells.end(); it != end; ++it)
     occupied_cells.erase(*it);
 
-  // mark occupied cells
-  tree_->lockWrite();
-  try
+  // mark occupied cells; the tree applies them together with the updates of the other sensors
   {
-    /* now mark all occupied cells */
+    const float lg_hit = tree_->getProbHitLog();
+    occupancy_map_monitor::OccMapDelta delta;
     for (octomap::KeySet::iterator it = occupied_cells.begin(), end = occupied_cells.end(); it != end; ++it)
-      tree_->updateNode(*it, true);
-  }
-  catch (...)
-  {
-    ROS_ERROR("Internal error while updating octree");
+      delta.updateNode(*it, lg_hit);
+    MOVEIT_PROBE_SCOPE("DepthImageOctomapUpdater::applyDelta");
+    tree_->applyDelta(delta);
   }
-  tree_->unlockWrite();
-  tree_->triggerUpdateCallback();
 
   // at this point we still have not freed the space
   free_space_updater_->pushLazyUpdate(occupied_cells_ptr, model_cells_ptr, sensor_origin);
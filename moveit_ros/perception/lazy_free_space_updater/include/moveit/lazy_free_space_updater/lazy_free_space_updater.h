@@ -38,49 +38,91 @@
 #define MOVEIT_OCCUPANCY_MAP_MONITOR_LAZY_FREE_SPACE_UPDATER_
 
 #include <moveit/occupancy_map_monitor/occupancy_map.h>
+#include <boost/lockfree/queue.hpp>
+#include <boost/lockfree/spsc_queue.hpp>
 #include <boost/thread.hpp>
-#include <deque>
+#include <atomic>
+#include <cstdint>
+#include <vector>
 
 namespace occupancy_map_monitor
 {
+/** \brief Clears the free space along the rays of sensor updates in a background thread.
+
+    Updates are queued by pushLazyUpdate() without locking. Up to \e max_batch_size consecutive updates taken from
+    the same sensor origin are merged into one batch, whose free cells are found by a second thread. Cell sets are
+    kept as sorted vectors of packed keys, so that merging and subtracting them is a linear pass. */
 class LazyFreeSpaceUpdater
 {
 public:
-  LazyFreeSpaceUpdater(const OccMapTreePtr& tree, unsigned int max_batch_size = 10);
+  /** \brief At most \e queue_size updates wait to be merged; further ones are dropped until the queue drains */
+  LazyFreeSpaceUpdater(const OccMapTreePtr& tree, unsigned int max_batch_size = 10, unsigned int queue_size = 64);
   ~LazyFreeSpaceUpdater();
 
+  /** \brief Queue the cells of one sensor update, taking ownership of both sets. This can be called from several
+      threads at once and does not block. */
   void pushLazyUpdate(octomap::KeySet* occupied_cells, octomap::KeySet* model_cells,
                       const octomap::point3d& sensor_origin);
 
 private:
-#ifdef __APPLE__
-  typedef std::unordered_map<octomap::OcTreeKey, unsigned int, octomap::OcTreeKey::KeyHash> OcTreeKeyCountMap;
-#else
-  typedef std::tr1::unordered_map<octomap::OcTreeKey, unsigned int, octomap::OcTreeKey::KeyHash> OcTreeKeyCountMap;
-#endif
+  /** \brief An OcTreeKey packed into one integer, so that keys sort and compare as integers */
+  typedef std::uint64_t PackedKey;
+
+  /** \brief Keys with the number of times they were seen, sorted by key without duplicates */
+  typedef std::vector<std::pair<PackedKey, unsigned int> > KeyCountVector;
+
+  struct SensorUpdate
+  {
+    octomap::KeySet* occupied_cells;
+    octomap::KeySet* model_cells;
+    octomap::point3d sensor_origin;
+  };
+
+  struct CellBatch
+  {
+    KeyCountVector occupied_cells;
+    std::vector<PackedKey> model_cells;
+    octomap::point3d sensor_origin;
+    unsigned int size;
+  };
+
+  static PackedKey packKey(const octomap::OcTreeKey& key)
+  {
+    return (static_cast<PackedKey>(key[0]) << 32) | (static_cast<PackedKey>(key[1]) << 16) | key[2];
+  }
+
+  static octomap::OcTreeKey unpackKey(PackedKey key)
+  {
+    return octomap::OcTreeKey(static_cast<octomap::key_type>(key >> 32), static_cast<octomap::key_type>(key >> 16),
+                              static_cast<octomap::key_type>(key));
+  }
+
+  /** \brief Sort \e cells and sum the counts of equal keys */
+  static void reduceKeyCounts(KeyCountVector& cells);
+
+  /** \brief Add the counts of \e cells to \e result */
+  static void mergeKeyCounts(KeyCountVector& result, const KeyCountVector& cells);
 
-  void pushBatchToProcess(OcTreeKeyCountMap* occupied_cells, octomap::KeySet* model_cells,
-                          const octomap::point3d& sensor_origin);
+  void addToBatch(CellBatch& batch, SensorUpdate* update) const;
+  bool pushBatchToProcess(CellBatch* batch);
 
   void lazyUpdateThread();
   void processThread();
 
   OccMapTreePtr tree_;
-  bool running_;
+  std::atomic<bool> running_;
   std::size_t max_batch_size_;
   double max_sensor_delta_;
 
-  std::deque<octomap::KeySet*> occupied_cells_sets_;
-  std::deque<octomap::KeySet*> model_cells_sets_;
-  std::deque<octomap::point3d> sensor_origins_;
+  /** \brief Updates pushed by any thread, popped by lazyUpdateThread() */
+  boost::lockfree::queue<SensorUpdate*, boost::lockfree::fixed_sized<true> > update_queue_;
   boost::condition_variable update_condition_;
-  boost::mutex update_cell_sets_lock_;
+  boost::mutex update_wait_lock_;
 
-  OcTreeKeyCountMap* process_occupied_cells_set_;
-  octomap::KeySet* process_model_cells_set_;
-  octomap::point3d process_sensor_origin_;
+  /** \brief Merged batches passed from lazyUpdateThread() to processThread() */
+  boost::lockfree::spsc_queue<CellBatch*> process_queue_;
   boost::condition_variable process_condition_;
-  boost::mutex cell_process_lock_;
+  boost::mutex process_wait_lock_;
 
   boost::thread update_thread_;
   boost::thread process_thread_;
@@ -36,17 +36,31 @@
 
 #include <moveit/lazy_free_space_updater/lazy_free_space_updater.h>
 #include <ros/console.h>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace occupancy_map_monitor
 {
-LazyFreeSpaceUpdater::LazyFreeSpaceUpdater(const OccMapTreePtr& tree, unsigned int max_batch_size)
+namespace
+{
+// how long the threads sleep when their queue is empty before looking again, in case a notification was missed
+const boost::chrono::milliseconds IDLE_WAIT(10);
+}
+
+LazyFreeSpaceUpdater::LazyFreeSpaceUpdater(const OccMapTreePtr& tree, unsigned int max_batch_size,
+                                           unsigned int queue_size)
   : tree_(tree)
   , running_(true)
   , max_batch_size_(max_batch_size)
   , max_sensor_delta_(1e-3)
   ,  // 1mm
-  process_occupied_cells_set_(NULL)
-  , process_model_cells_set_(NULL)
+  update_queue_(std::max(1u, queue_size))
+  , process_queue_(4)
   , update_thread_(boost::bind(&LazyFreeSpaceUpdater::lazyUpdateThread, this))
   , process_thread_(boost::bind(&LazyFreeSpaceUpdater::processThread, this))
 {
@@ -55,16 +69,21 @@ LazyFreeSpaceUpdater::LazyFreeSpaceUpdater(const OccMapTreePtr& tree, unsigned i
 LazyFreeSpaceUpdater::~LazyFreeSpaceUpdater()
 {
   running_ = false;
-  {
-    boost::unique_lock<boost::mutex> _(update_cell_sets_lock_);
-    update_condition_.notify_one();
-  }
-  {
-    boost::unique_lock<boost::mutex> _(cell_process_lock_);
-    process_condition_.notify_one();
-  }
+  update_condition_.notify_one();
+  process_condition_.notify_one();
   update_thread_.join();
   process_thread_.join();
+
+  SensorUpdate* update;
+  while (update_queue_.pop(update))
+  {
+    delete update->occupied_cells;
+    delete update->model_cells;
+    delete update;
+  }
+  CellBatch* batch;
+  while (process_queue_.pop(batch))
+    delete batch;
 }
 
 void LazyFreeSpaceUpdater::pushLazyUpdate(octomap::KeySet* occupied_cells, octomap::KeySet* model_cells,
@@ -72,33 +91,99 @@ void LazyFreeSpaceUpdater::pushLazyUpdate(octomap::KeySet* occupied_cells, octom
 {
   ROS_DEBUG("Pushing %lu occupied cells and %lu model cells for lazy updating...",
             (long unsigned int)occupied_cells->size(), (long unsigned int)model_cells->size());
-  boost::mutex::scoped_lock _(update_cell_sets_lock_);
-  occupied_cells_sets_.push_back(occupied_cells);
-  model_cells_sets_.push_back(model_cells);
-  sensor_origins_.push_back(sensor_origin);
-  update_condition_.notify_one();
+  SensorUpdate* update = new SensorUpdate();
+  update->occupied_cells = occupied_cells;
+  update->model_cells = model_cells;
+  update->sensor_origin = sensor_origin;
+  if (update_queue_.bounded_push(update))
+    update_condition_.notify_one();
+  else
+  {
+    ROS_WARN("Too many lazy updates are pending. Ignoring set of cells to be freed.");
+    delete occupied_cells;
+    delete model_cells;
+    delete update;
+  }
+}
+
+void LazyFreeSpaceUpdater::reduceKeyCounts(KeyCountVector& cells)
+{
+  if (cells.empty())
+    return;
+  std::sort(cells.begin(), cells.end());
+  std::size_t n = 0;
+  for (std::size_t i = 1; i < cells.size(); ++i)
+    if (cells[i].first == cells[n].first)
+      cells[n].second += cells[i].second;
+    else
+      cells[++n] = cells[i];
+  cells.resize(n + 1);
 }
 
-void LazyFreeSpaceUpdater::pushBatchToProcess(OcTreeKeyCountMap* occupied_cells, octomap::KeySet* model_cells,
-                                              const octomap::point3d& sensor_origin)
+void LazyFreeSpaceUpdater::mergeKeyCounts(KeyCountVector& result, const KeyCountVector& cells)
 {
-  // this is basically a queue of size 1. if this function is called repeatedly without any work being done by
-  // processThread(),
-  // data can be lost; this is intentional, to avoid spending too much time clearing the octomap
-  if (cell_process_lock_.try_lock())
+  if (result.empty())
   {
-    process_occupied_cells_set_ = occupied_cells;
-    process_model_cells_set_ = model_cells;
-    process_sensor_origin_ = sensor_origin;
-    process_condition_.notify_one();
-    cell_process_lock_.unlock();
+    result = cells;
+    return;
   }
+  KeyCountVector merged;
+  merged.reserve(result.size() + cells.size());
+  KeyCountVector::const_iterator a = result.begin(), b = cells.begin();
+  while (a != result.end() && b != cells.end())
+    if (a->first < b->first)
+      merged.push_back(*a++);
+    else if (b->first < a->first)
+      merged.push_back(*b++);
+    else
+    {
+      merged.push_back(std::make_pair(a->first, a->second + b->second));
+      ++a;
+      ++b;
+    }
+  merged.insert(merged.end(), a, result.cend());
+  merged.insert(merged.end(), b, cells.end());
+  result.swap(merged);
+}
+
+void LazyFreeSpaceUpdater::addToBatch(CellBatch& batch, SensorUpdate* update) const
+{
+  KeyCountVector occupied;
+  occupied.reserve(update->occupied_cells->size());
+  for (octomap::KeySet::iterator it = update->occupied_cells->begin(), end = update->occupied_cells->end(); it != end;
+       ++it)
+    occupied.push_back(std::make_pair(packKey(*it), 1u));
+  std::sort(occupied.begin(), occupied.end());
+  mergeKeyCounts(batch.occupied_cells, occupied);
+
+  std::vector<PackedKey> model;
+  model.reserve(update->model_cells->size());
+  for (octomap::KeySet::iterator it = update->model_cells->begin(), end = update->model_cells->end(); it != end; ++it)
+    model.push_back(packKey(*it));
+  std::sort(model.begin(), model.end());
+  if (batch.model_cells.empty())
+    batch.model_cells.swap(model);
   else
   {
-    ROS_WARN("Previous batch update did not complete. Ignoring set of cells to be freed.");
-    delete occupied_cells;
-    delete model_cells;
+    std::vector<PackedKey> merged;
+    merged.reserve(batch.model_cells.size() + model.size());
+    std::set_union(batch.model_cells.begin(), batch.model_cells.end(), model.begin(), model.end(),
+                   std::back_inserter(merged));
+    batch.model_cells.swap(merged);
   }
+
+  delete update->occupied_cells;
+  delete update->model_cells;
+  delete update;
+  batch.size++;
+}
+
+bool LazyFreeSpaceUpdater::pushBatchToProcess(CellBatch* batch)
+{
+  if (!process_queue_.push(batch))
+    return false;
+  process_condition_.notify_one();
+  return true;
 }
 
 void LazyFreeSpaceUpdater::processThread()
@@ -106,161 +191,144 @@ void LazyFreeSpaceUpdater::processThread()
   const float lg_0 = tree_->getClampingThresMinLog() - tree_->getClampingThresMaxLog();
   const float lg_miss = tree_->getProbMissLog();
 
-  octomap::KeyRay key_ray1, key_ray2;
-  OcTreeKeyCountMap free_cells1, free_cells2;
+#ifdef _OPENMP
+  std::vector<KeyCountVector> thread_free_cells(omp_get_max_threads());
+#else
+  std::vector<KeyCountVector> thread_free_cells(1);
+#endif
 
   while (running_)
   {
-    free_cells1.clear();
-    free_cells2.clear();
-
-    boost::unique_lock<boost::mutex> ulock(cell_process_lock_);
-    while (!process_occupied_cells_set_ && running_)
-      process_condition_.wait(ulock);
-
-    if (!running_)
-      break;
+    CellBatch* next;
+    if (!process_queue_.pop(next))
+    {
+      boost::unique_lock<boost::mutex> ulock(process_wait_lock_);
+      process_condition_.wait_for(ulock, IDLE_WAIT);
+      continue;
+    }
+    std::unique_ptr<CellBatch> batch(next);
+    const KeyCountVector& occupied_cells = batch->occupied_cells;
+    const std::vector<PackedKey>& model_cells = batch->model_cells;
+    const octomap::point3d& sensor_origin = batch->sensor_origin;
 
     ROS_DEBUG("Begin processing batched update: marking free cells due to %lu occupied cells and %lu model cells",
-              (long unsigned int)process_occupied_cells_set_->size(),
-              (long unsigned int)process_model_cells_set_->size());
+              (long unsigned int)occupied_cells.size(), (long unsigned int)model_cells.size());
 
     ros::WallTime start = ros::WallTime::now();
     tree_->lockRead();
 
-#pragma omp sections
+    /* compute the free cells along each ray that ends at an occupied cell or model cell; every thread collects and
+       reduces its own cells, which are then merged */
+    const int ray_count = occupied_cells.size() + model_cells.size();
+#pragma omp parallel
     {
-#pragma omp section
-      {
-        /* compute the free cells along each ray that ends at an occupied cell */
-        for (OcTreeKeyCountMap::iterator it = process_occupied_cells_set_->begin(),
-                                         end = process_occupied_cells_set_->end();
-             it != end; ++it)
-          if (tree_->computeRayKeys(process_sensor_origin_, tree_->keyToCoord(it->first), key_ray1))
-            for (octomap::KeyRay::iterator jt = key_ray1.begin(), end = key_ray1.end(); jt != end; ++jt)
-              free_cells1[*jt] += it->second;
-      }
-
-#pragma omp section
+#ifdef _OPENMP
+      KeyCountVector& free_cells = thread_free_cells[omp_get_thread_num()];
+#else
+      KeyCountVector& free_cells = thread_free_cells[0];
+#endif
+      free_cells.clear();
+      octomap::KeyRay key_ray;
+      // rays overlap near the sensor, so duplicates are folded whenever the vector doubles in size
+      std::size_t reduce_at = 1 << 16;
+#pragma omp for schedule(dynamic, 256)
+      for (int i = 0; i < ray_count; ++i)
       {
-        /* compute the free cells along each ray that ends at a model cell */
-        for (octomap::KeySet::iterator it = process_model_cells_set_->begin(), end = process_model_cells_set_->end();
-             it != end; ++it)
-          if (tree_->computeRayKeys(process_sensor_origin_, tree_->keyToCoord(*it), key_ray2))
-            for (octomap::KeyRay::iterator jt = key_ray2.begin(), end = key_ray2.end(); jt != end; ++jt)
-              free_cells2[*jt]++;
+        const bool occupied = i < static_cast<int>(occupied_cells.size());
+        const PackedKey end_key = occupied ? occupied_cells[i].first : model_cells[i - occupied_cells.size()];
+        const unsigned int count = occupied ? occupied_cells[i].second : 1;
+        if (tree_->computeRayKeys(sensor_origin, tree_->keyToCoord(unpackKey(end_key)), key_ray))
+          for (octomap::KeyRay::iterator jt = key_ray.begin(), end = key_ray.end(); jt != end; ++jt)
+            free_cells.push_back(std::make_pair(packKey(*jt), count));
+        if (free_cells.size() > reduce_at)
+        {
+          reduceKeyCounts(free_cells);
+          reduce_at = std::max(reduce_at, 2 * free_cells.size());
+        }
       }
+      reduceKeyCounts(free_cells);
     }
 
     tree_->unlockRead();
 
-    for (OcTreeKeyCountMap::iterator it = process_occupied_cells_set_->begin(),
-                                     end = process_occupied_cells_set_->end();
-         it != end; ++it)
-    {
-      free_cells1.erase(it->first);
-      free_cells2.erase(it->first);
-    }
+    KeyCountVector free_cells;
+    for (std::size_t t = 0; t < thread_free_cells.size(); ++t)
+      mergeKeyCounts(free_cells, thread_free_cells[t]);
 
-    for (octomap::KeySet::iterator it = process_model_cells_set_->begin(), end = process_model_cells_set_->end();
-         it != end; ++it)
+    /* mark free cells only if not seen occupied in this batch, and not part of the model */
+    std::size_t n = 0;
+    KeyCountVector::const_iterator occ = occupied_cells.begin();
+    std::vector<PackedKey>::const_iterator mod = model_cells.begin();
+    for (std::size_t i = 0; i < free_cells.size(); ++i)
     {
-      free_cells1.erase(*it);
-      free_cells2.erase(*it);
+      const PackedKey key = free_cells[i].first;
+      while (occ != occupied_cells.end() && occ->first < key)
+        ++occ;
+      while (mod != model_cells.end() && *mod < key)
+        ++mod;
+      if ((occ == occupied_cells.end() || occ->first != key) && (mod == model_cells.end() || *mod != key))
+        free_cells[n++] = free_cells[i];
     }
-    ROS_DEBUG("Marking %lu cells as free...", (long unsigned int)(free_cells1.size() + free_cells2.size()));
+    free_cells.resize(n);
+    ROS_DEBUG("Marking %lu cells as free...", (long unsigned int)free_cells.size());
 
-    tree_->lockWrite();
+    occupancy_map_monitor::OccMapDelta delta;
+    // set the logodds to the minimum for the cells that are part of the model
+    for (std::size_t i = 0; i < model_cells.size(); ++i)
+      delta.updateNode(unpackKey(model_cells[i]), lg_0);
 
-    try
-    {
-      // set the logodds to the minimum for the cells that are part of the model
-      for (octomap::KeySet::iterator it = process_model_cells_set_->begin(), end = process_model_cells_set_->end();
-           it != end; ++it)
-        tree_->updateNode(*it, lg_0);
-
-      /* mark free cells only if not seen occupied in this cloud */
-      for (OcTreeKeyCountMap::iterator it = free_cells1.begin(), end = free_cells1.end(); it != end; ++it)
-        tree_->updateNode(it->first, it->second * lg_miss);
-      for (OcTreeKeyCountMap::iterator it = free_cells2.begin(), end = free_cells2.end(); it != end; ++it)
-        tree_->updateNode(it->first, it->second * lg_miss);
-    }
-    catch (...)
-    {
-      ROS_ERROR("Internal error while updating octree");
-    }
-    tree_->unlockWrite();
-    tree_->triggerUpdateCallback();
+    for (std::size_t i = 0; i < free_cells.size(); ++i)
+      delta.updateNode(unpackKey(free_cells[i].first), free_cells[i].second * lg_miss);
 
-    ROS_DEBUG("Marked free cells in %lf ms", (ros::WallTime::now() - start).toSec() * 1000.0);
+    tree_->applyDelta(delta);
 
-    delete process_occupied_cells_set_;
-    process_occupied_cells_set_ = NULL;
-    delete process_model_cells_set_;
-    process_model_cells_set_ = NULL;
+    ROS_DEBUG("Marked free cells in %lf ms", (ros::WallTime::now() - start).toSec() * 1000.0);
   }
 }
 
 void LazyFreeSpaceUpdater::lazyUpdateThread()
 {
-  OcTreeKeyCountMap* occupied_cells_set = NULL;
-  octomap::KeySet* model_cells_set = NULL;
-  octomap::point3d sensor_origin;
-  unsigned int batch_size = 0;
+  std::unique_ptr<CellBatch> batch;
 
   while (running_)
   {
-    boost::unique_lock<boost::mutex> ulock(update_cell_sets_lock_);
-    while (occupied_cells_sets_.empty() && running_)
-      update_condition_.wait(ulock);
-
-    if (!running_)
-      break;
-
-    if (batch_size == 0)
+    SensorUpdate* update;
+    if (!update_queue_.pop(update))
     {
-      occupied_cells_set = new OcTreeKeyCountMap();
-      octomap::KeySet* s = occupied_cells_sets_.front();
-      occupied_cells_sets_.pop_front();
-      for (octomap::KeySet::iterator it = s->begin(), end = s->end(); it != end; ++it)
-        (*occupied_cells_set)[*it]++;
-      delete s;
-      model_cells_set = model_cells_sets_.front();
-      model_cells_sets_.pop_front();
-      sensor_origin = sensor_origins_.front();
-      sensor_origins_.pop_front();
-      batch_size++;
+      // retry a full batch the process thread had no room for
+      if (batch && batch->size >= max_batch_size_ && pushBatchToProcess(batch.get()))
+        batch.release();
+      boost::unique_lock<boost::mutex> ulock(update_wait_lock_);
+      update_condition_.wait_for(ulock, IDLE_WAIT);
+      continue;
     }
 
-    while (!occupied_cells_sets_.empty())
+    if (batch && (update->sensor_origin - batch->sensor_origin).norm() > max_sensor_delta_)
     {
-      if ((sensor_origins_.front() - sensor_origin).norm() > max_sensor_delta_)
+      ROS_DEBUG("Pushing %u sets of occupied/model cells to free cells update thread (origin changed)", batch->size);
+      if (pushBatchToProcess(batch.get()))
+        batch.release();
+      else
       {
-        ROS_DEBUG("Pushing %u sets of occupied/model cells to free cells update thread (origin changed)", batch_size);
-        pushBatchToProcess(occupied_cells_set, model_cells_set, sensor_origin);
-        batch_size = 0;
-        break;
+        ROS_WARN("Previous batch update did not complete. Ignoring set of cells to be freed.");
+        batch.reset();
       }
-      sensor_origins_.pop_front();
-
-      octomap::KeySet* add_occ = occupied_cells_sets_.front();
-      for (octomap::KeySet::iterator it = add_occ->begin(), end = add_occ->end(); it != end; ++it)
-        (*occupied_cells_set)[*it]++;
-      occupied_cells_sets_.pop_front();
-      delete add_occ;
-      octomap::KeySet* mod_occ = model_cells_sets_.front();
-      model_cells_set->insert(mod_occ->begin(), mod_occ->end());
-      model_cells_sets_.pop_front();
-      delete mod_occ;
-      batch_size++;
     }
 
-    if (batch_size >= max_batch_size_)
+    if (!batch)
+    {
+      batch.reset(new CellBatch());
+      batch->sensor_origin = update->sensor_origin;
+      batch->size = 0;
+    }
+    addToBatch(*batch, update);
+
+    // if the process thread is busy, keep merging into this batch; it is cleared all at once later
+    if (batch->size >= max_batch_size_)
     {
-      ROS_DEBUG("Pushing %u sets of occupied/model cells to free cells update thread", batch_size);
-      pushBatchToProcess(occupied_cells_set, model_cells_set, sensor_origin);
-      occupied_cells_set = NULL;
-      batch_size = 0;
+      ROS_DEBUG("Pushing %u sets of occupied/model cells to free cells update thread", batch->size);
+      if (pushBatchToProcess(batch.get()))
+        batch.release();
     }
   }
 }
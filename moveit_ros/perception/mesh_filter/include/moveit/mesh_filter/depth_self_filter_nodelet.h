@@ -44,7 +44,6 @@
 #include <moveit/mesh_filter/transform_provider.h>
 #include <moveit/mesh_filter/mesh_filter.h>
 #include <moveit/mesh_filter/stereo_camera_model.h>
-#include <cv_bridge/cv_bridge.h>
 #include <memory>
 
 namespace mesh_filter
@@ -90,6 +89,17 @@ private:
    */
   void depthCb(const sensor_msgs::ImageConstPtr& depth_msg, const sensor_msgs::CameraInfoConstPtr& info_msg);
 
+  /**
+   * \brief Prepare an output image for writing. The image published last time is reused if no subscriber holds on to
+   * it anymore, so in steady state the output buffers are not reallocated and nothing is copied before publishing.
+   * \param[in,out] image the output image; replaced by a new one if it is still in use
+   * \param[in] depth_msg the input image providing header and size
+   * \param[in] encoding the encoding of the output image
+   * \param[in] bytes_per_pixel the size of a pixel in the output image
+   */
+  void prepareImage(sensor_msgs::ImagePtr& image, const sensor_msgs::Image& depth_msg, const std::string& encoding,
+                    unsigned int bytes_per_pixel) const;
+
 private:
   // member variables to handle ros messages
   std::shared_ptr<image_transport::ImageTransport> input_depth_transport_;
@@ -108,10 +118,15 @@ private:
   int queue_size_;
   TransformProvider transform_provider_;
 
-  cv_bridge::CvImagePtr filtered_depth_ptr_;
-  cv_bridge::CvImagePtr filtered_label_ptr_;
-  cv_bridge::CvImagePtr model_depth_ptr_;
-  cv_bridge::CvImagePtr model_label_ptr_;
+  /** \brief output images, filled in place by the mesh filter and published without copies */
+  sensor_msgs::ImagePtr filtered_depth_ptr_;
+  sensor_msgs::ImagePtr filtered_label_ptr_;
+  sensor_msgs::ImagePtr model_depth_ptr_;
+  sensor_msgs::ImagePtr model_label_ptr_;
+
+  /** \brief only advertise the filtered depth image, not the labels and the rendered model */
+  bool filtered_depth_only_;
+
   /** \brief distance of near clipping plane*/
   double near_clipping_plane_distance_;
 
@@ -104,6 +104,18 @@ public:
    */
   void getDepthBuffer(float* buffer) const;
 
+  /**
+   * \brief starts copying the color buffer into a pixel buffer object without waiting for the transfer. The next call
+   * of getColorBuffer() then only waits for the remaining transfer, unless begin() is called in between.
+   */
+  void readColorBufferAsync() const;
+
+  /**
+   * \brief starts copying the depth buffer into a pixel buffer object without waiting for the transfer. The next call
+   * of getDepthBuffer() then only waits for the remaining transfer, unless begin() is called in between.
+   */
+  void readDepthBufferAsync() const;
+
   /**
    * \brief loads, compiles, links and adds GLSL shaders from files to the current OpenGL context.
    * \author Suat Gedikli (gedikli@willowgarage.com)
@@ -237,6 +249,14 @@ private:
    */
   void initFrameBuffers();
 
+  /**
+   * \brief copies the buffer read by readColorBufferAsync() or readDepthBufferAsync() from the pixel buffer object
+   * \param[in] pbo handle of the pixel buffer object
+   * \param[out] buffer pointer to memory where the values need to be stored
+   * \param[in] size number of bytes to copy
+   */
+  void copyPixelBuffer(GLuint pbo, void* buffer, std::size_t size) const;
+
   /**
    * \brief deletes the frame buffer objects
    * \author Suat Gedikli (gedikli@willowgarage.com)
@@ -273,6 +293,18 @@ private:
   /** \brief handle to depth buffer*/
   GLuint depth_id_;
 
+  /** \brief handle to pixel buffer object the color buffer is read into asynchronously*/
+  GLuint color_pbo_;
+
+  /** \brief handle to pixel buffer object the depth buffer is read into asynchronously*/
+  GLuint depth_pbo_;
+
+  /** \brief whether color_pbo_ holds the color buffer of the last rendering*/
+  mutable bool color_pbo_pending_;
+
+  /** \brief whether depth_pbo_ holds the depth buffer of the last rendering*/
+  mutable bool depth_pbo_pending_;
+
   /** \brief handle to program that is currently used*/
   GLuint program_;
 
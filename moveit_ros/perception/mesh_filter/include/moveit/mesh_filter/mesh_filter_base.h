@@ -45,6 +45,7 @@
 #include <boost/thread/mutex.hpp>
 #include <Eigen/Eigen>
 #include <queue>
+#include <atomic>
 
 // forward declarations
 namespace shapes
@@ -181,6 +182,15 @@ public:
   void setPaddingOffset(float offset);
 
 protected:
+  /** \brief the buffers that can be read back after filtering */
+  enum ReadbackBuffer
+  {
+    MODEL_LABELS = 1,
+    MODEL_DEPTH = 2,
+    FILTERED_LABELS = 4,
+    FILTERED_DEPTH = 8
+  };
+
   /**
    * \brief initializes OpenGL related things as well as renderers
    */
@@ -292,6 +302,10 @@ protected:
 
   /** \brief threshold for shadowed pixels vs. filtered pixels*/
   float shadow_threshold_;
+
+  /** \brief ReadbackBuffer flags of the buffers requested since the last filtering. These buffers are read back
+   * asynchronously right after the next filtering, since they are likely to be requested again */
+  mutable std::atomic<unsigned int> requested_buffers_;
 };
 }  // namespace mesh_filter
 
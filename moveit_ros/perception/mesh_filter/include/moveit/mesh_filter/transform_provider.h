@@ -116,7 +116,8 @@ public:
 private:
   /**
    * \brief this method is called periodically by the dedicated thread and updates all the transformations of the
-   * registered frames.
+   * registered frames. The camera pose is looked up in TF once and combined with the link poses of a single robot
+   * state, so all meshes are rendered from one consistent snapshot.
    * \author Suat Gedikli (gedikli@willowgarage.com)
    */
   void updateTransforms();
@@ -135,7 +136,6 @@ private:
     }
     std::string frame_id_;
     Eigen::Affine3d transformation_;
-    boost::mutex mutex_;
   };
 
   /**
@@ -147,6 +147,9 @@ private:
   /** \brief mapping between the mesh handle and its context*/
   std::map<mesh_filter::MeshHandle, TransformContextPtr> handle2context_;
 
+  /** \brief guards the transformations of all contexts, which are replaced together*/
+  mutable boost::mutex transforms_mutex_;
+
   /** \brief TransformListener used to listen and update transformations*/
   boost::shared_ptr<tf::TransformListener> tf_;
 
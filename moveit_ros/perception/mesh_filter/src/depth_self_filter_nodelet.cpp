@@ -43,12 +43,26 @@
 #include <moveit/robot_model_loader/robot_model_loader.h>
 #include <moveit/robot_model/robot_model.h>
 #include <eigen3/Eigen/Eigen>
-#include <cv_bridge/cv_bridge.h>
 
 namespace enc = sensor_msgs::image_encodings;
 using namespace std;
 using namespace boost;
 
+namespace
+{
+bool host_is_big_endian(void)
+{
+  union
+  {
+    uint32_t i;
+    char c[sizeof(uint32_t)];
+  } bint = { 0x01020304 };
+  return bint.c[0] == 1;
+}
+}
+
+static const bool HOST_IS_BIG_ENDIAN = host_is_big_endian();
+
 mesh_filter::DepthSelfFiltering::~DepthSelfFiltering()
 {
 }
@@ -73,6 +87,7 @@ void mesh_filter::DepthSelfFiltering::onInit()
   private_nh.param("padding_offset", padding_offset_, 0.005);
   double tf_update_rate = 30;
   private_nh.param("tf_update_rate", tf_update_rate, 30.0);
+  private_nh.param("filtered_depth_only", filtered_depth_only_, false);
   transform_provider_.setUpdateInterval(long(1000000.0 / tf_update_rate));
 
   image_transport::SubscriberStatusCallback itssc = bind(&DepthSelfFiltering::connectCb, this);
@@ -81,17 +96,16 @@ void mesh_filter::DepthSelfFiltering::onInit()
   lock_guard<mutex> lock(connect_mutex_);
   pub_filtered_depth_image_ =
       filtered_depth_transport_->advertiseCamera("/filtered/depth", queue_size_, itssc, itssc, rssc, rssc);
-  pub_filtered_label_image_ =
-      filtered_label_transport_->advertiseCamera("/filtered/labels", queue_size_, itssc, itssc, rssc, rssc);
-  pub_model_depth_image_ =
-      model_depth_transport_->advertiseCamera("/model/depth", queue_size_, itssc, itssc, rssc, rssc);
-  pub_model_label_image_ =
-      model_depth_transport_->advertiseCamera("/model/label", queue_size_, itssc, itssc, rssc, rssc);
-
-  filtered_depth_ptr_.reset(new cv_bridge::CvImage);
-  filtered_label_ptr_.reset(new cv_bridge::CvImage);
-  model_depth_ptr_.reset(new cv_bridge::CvImage);
-  model_label_ptr_.reset(new cv_bridge::CvImage);
+  // publishers that are not advertised report no subscribers, so the corresponding images are never computed
+  if (!filtered_depth_only_)
+  {
+    pub_filtered_label_image_ =
+        filtered_label_transport_->advertiseCamera("/filtered/labels", queue_size_, itssc, itssc, rssc, rssc);
+    pub_model_depth_image_ =
+        model_depth_transport_->advertiseCamera("/model/depth", queue_size_, itssc, itssc, rssc, rssc);
+    pub_model_label_image_ =
+        model_depth_transport_->advertiseCamera("/model/label", queue_size_, itssc, itssc, rssc, rssc);
+  }
 
   mesh_filter_.reset(
       new MeshFilter<StereoCameraModel>(bind(&TransformProvider::getTransform, &transform_provider_, _1, _2),
@@ -105,71 +119,93 @@ void mesh_filter::DepthSelfFiltering::onInit()
   transform_provider_.start();
 }
 
+void mesh_filter::DepthSelfFiltering::prepareImage(sensor_msgs::ImagePtr& image, const sensor_msgs::Image& depth_msg,
+                                                   const std::string& encoding, unsigned int bytes_per_pixel) const
+{
+  // subscribers in the same process share the published message, so it must not be written while they hold it
+  if (!image || !image.unique())
+    image.reset(new sensor_msgs::Image);
+  image->header = depth_msg.header;
+  image->width = depth_msg.width;
+  image->height = depth_msg.height;
+  image->encoding = encoding;
+  image->is_bigendian = HOST_IS_BIG_ENDIAN;
+  image->step = depth_msg.width * bytes_per_pixel;
+  image->data.resize(image->step * image->height);
+}
+
 void mesh_filter::DepthSelfFiltering::filter(const sensor_msgs::ImageConstPtr& depth_msg,
                                              const sensor_msgs::CameraInfoConstPtr& info_msg)
 {
+  GLushort type;
+  unsigned int bytes_per_pixel;
+  if (depth_msg->encoding == enc::TYPE_16UC1)
+  {
+    type = GL_UNSIGNED_SHORT;
+    bytes_per_pixel = sizeof(unsigned short);
+  }
+  else if (depth_msg->encoding == enc::TYPE_32FC1)
+  {
+    type = GL_FLOAT;
+    bytes_per_pixel = sizeof(float);
+  }
+  else
+  {
+    NODELET_ERROR_THROTTLE(1, "Unexpected encoding type: '%s'. Ignoring input.", depth_msg->encoding.c_str());
+    return;
+  }
+  if (depth_msg->is_bigendian != HOST_IS_BIG_ENDIAN)
+    NODELET_ERROR_THROTTLE(1, "endian problem: received image data does not match host");
+
+  // the sensor data is uploaded as one tightly packed block
+  if (depth_msg->step != depth_msg->width * bytes_per_pixel)
+  {
+    NODELET_ERROR_THROTTLE(1, "Depth images with padded rows are not supported. Ignoring input.");
+    return;
+  }
+
   transform_provider_.setFrame(depth_msg->header.frame_id);
   // do filtering here
   mesh_filter::StereoCameraModel::Parameters& params = mesh_filter_->parameters();
   params.setCameraParameters(info_msg->K[0], info_msg->K[4], info_msg->K[2], info_msg->K[5]);
   params.setImageSize(depth_msg->width, depth_msg->height);
 
-  const float* src = (const float*)&depth_msg->data[0];
-  //*
-  static unsigned dataSize = 0;
-  static unsigned short* data = 0;
-  if (dataSize < depth_msg->width * depth_msg->height)
-    data = new unsigned short[depth_msg->width * depth_msg->height];
-  for (unsigned idx = 0; idx < depth_msg->width * depth_msg->height; ++idx)
-    data[idx] = (unsigned short)(src[idx] * 1000.0);
-
-  mesh_filter_->filter(data, GL_UNSIGNED_SHORT);
-  // delete[] data;
-  /*/
-  mesh_filter_->filter ((void*) &depth_msg->data[0], GL_FLOAT);
-  //*/
-  if (pub_filtered_depth_image_.getNumSubscribers() > 0)
-  {
-    filtered_depth_ptr_->encoding = sensor_msgs::image_encodings::TYPE_32FC1;
-    filtered_depth_ptr_->header = depth_msg->header;
+  bool filtered_depth = pub_filtered_depth_image_.getNumSubscribers() > 0;
+  bool model_depth = pub_model_depth_image_.getNumSubscribers() > 0;
+  bool filtered_labels = pub_filtered_label_image_.getNumSubscribers() > 0;
+  bool model_labels = pub_model_label_image_.getNumSubscribers() > 0;
+
+  // The filter reads the message data directly. Reading back any of the buffers below waits for it; if none is
+  // requested, wait here so the filter is done with the data before the message may be released.
+  mesh_filter_->filter(&depth_msg->data[0], type, !(filtered_depth || model_depth || filtered_labels || model_labels));
 
-    if (filtered_depth_ptr_->image.cols != depth_msg->width || filtered_depth_ptr_->image.rows != depth_msg->height)
-      filtered_depth_ptr_->image = cv::Mat(depth_msg->height, depth_msg->width, CV_32FC1);
-    mesh_filter_->getFilteredDepth((float*)filtered_depth_ptr_->image.data);
-    pub_filtered_depth_image_.publish(filtered_depth_ptr_->toImageMsg(), info_msg);
+  if (filtered_depth)
+  {
+    prepareImage(filtered_depth_ptr_, *depth_msg, enc::TYPE_32FC1, sizeof(float));
+    mesh_filter_->getFilteredDepth(reinterpret_cast<float*>(&filtered_depth_ptr_->data[0]));
+    pub_filtered_depth_image_.publish(filtered_depth_ptr_, info_msg);
   }
 
   // this is from rendering of the model
-  if (pub_model_depth_image_.getNumSubscribers() > 0)
+  if (model_depth)
   {
-    model_depth_ptr_->encoding = sensor_msgs::image_encodings::TYPE_32FC1;
-    model_depth_ptr_->header = depth_msg->header;
-
-    if (model_depth_ptr_->image.cols != depth_msg->width || model_depth_ptr_->image.rows != depth_msg->height)
-      model_depth_ptr_->image = cv::Mat(depth_msg->height, depth_msg->width, CV_32FC1);
-    mesh_filter_->getModelDepth((float*)model_depth_ptr_->image.data);
-    pub_model_depth_image_.publish(model_depth_ptr_->toImageMsg(), info_msg);
+    prepareImage(model_depth_ptr_, *depth_msg, enc::TYPE_32FC1, sizeof(float));
+    mesh_filter_->getModelDepth(reinterpret_cast<float*>(&model_depth_ptr_->data[0]));
+    pub_model_depth_image_.publish(model_depth_ptr_, info_msg);
   }
 
-  if (pub_filtered_label_image_.getNumSubscribers() > 0)
+  if (filtered_labels)
   {
-    filtered_label_ptr_->encoding = sensor_msgs::image_encodings::RGBA8;
-    filtered_label_ptr_->header = depth_msg->header;
-
-    if (filtered_label_ptr_->image.cols != depth_msg->width || filtered_label_ptr_->image.rows != depth_msg->height)
-      filtered_label_ptr_->image = cv::Mat(depth_msg->height, depth_msg->width, CV_8UC4);
-    mesh_filter_->getFilteredLabels((unsigned int*)filtered_label_ptr_->image.data);
-    pub_filtered_label_image_.publish(filtered_label_ptr_->toImageMsg(), info_msg);
+    prepareImage(filtered_label_ptr_, *depth_msg, enc::RGBA8, sizeof(LabelType));
+    mesh_filter_->getFilteredLabels(reinterpret_cast<LabelType*>(&filtered_label_ptr_->data[0]));
+    pub_filtered_label_image_.publish(filtered_label_ptr_, info_msg);
   }
 
-  if (pub_model_label_image_.getNumSubscribers() > 0)
+  if (model_labels)
   {
-    model_label_ptr_->encoding = sensor_msgs::image_encodings::RGBA8;
-    model_label_ptr_->header = depth_msg->header;
-    if (model_label_ptr_->image.cols != depth_msg->width || model_label_ptr_->image.rows != depth_msg->height)
-      model_label_ptr_->image = cv::Mat(depth_msg->height, depth_msg->width, CV_8UC4);
-    mesh_filter_->getModelLabels((unsigned int*)model_label_ptr_->image.data);
-    pub_model_label_image_.publish(model_label_ptr_->toImageMsg(), info_msg);
+    prepareImage(model_label_ptr_, *depth_msg, enc::RGBA8, sizeof(LabelType));
+    mesh_filter_->getModelLabels(reinterpret_cast<LabelType*>(&model_label_ptr_->data[0]));
+    pub_model_label_image_.publish(model_label_ptr_, info_msg);
   }
 }
 
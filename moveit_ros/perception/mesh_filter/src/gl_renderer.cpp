@@ -45,6 +45,7 @@
 #include <moveit/mesh_filter/gl_renderer.h>
 #include <sstream>
 #include <fstream>
+#include <cstring>
 #include <stdexcept>
 #include <vector>
 #include <iostream>
@@ -60,6 +61,10 @@ mesh_filter::GLRenderer::GLRenderer(unsigned width, unsigned height, float near,
   , rbo_id_(0)
   , rgb_id_(0)
   , depth_id_(0)
+  , color_pbo_(0)
+  , depth_pbo_(0)
+  , color_pbo_pending_(false)
+  , depth_pbo_pending_(false)
   , program_(0)
   , near_(near)
   , far_(far)
@@ -166,6 +171,16 @@ void mesh_filter::GLRenderer::initFrameBuffers()
     throw runtime_error("Couldn't create frame buffer");
 
   glBindFramebuffer(GL_FRAMEBUFFER, 0);  // Unbind our frame buffer
+
+  // both RGBA8 and float depth take 4 bytes per pixel
+  glGenBuffers(1, &color_pbo_);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, color_pbo_);
+  glBufferData(GL_PIXEL_PACK_BUFFER, width_ * height_ * 4, NULL, GL_STREAM_READ);
+  glGenBuffers(1, &depth_pbo_);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, depth_pbo_);
+  glBufferData(GL_PIXEL_PACK_BUFFER, width_ * height_ * sizeof(float), NULL, GL_STREAM_READ);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  color_pbo_pending_ = depth_pbo_pending_ = false;
 }
 
 void mesh_filter::GLRenderer::deleteFrameBuffers()
@@ -178,8 +193,13 @@ void mesh_filter::GLRenderer::deleteFrameBuffers()
     glDeleteTextures(1, &depth_id_);
   if (rgb_id_)
     glDeleteTextures(1, &rgb_id_);
+  if (color_pbo_)
+    glDeleteBuffers(1, &color_pbo_);
+  if (depth_pbo_)
+    glDeleteBuffers(1, &depth_pbo_);
 
-  rbo_id_ = fbo_id_ = depth_id_ = rgb_id_ = 0;
+  rbo_id_ = fbo_id_ = depth_id_ = rgb_id_ = color_pbo_ = depth_pbo_ = 0;
+  color_pbo_pending_ = depth_pbo_pending_ = false;
 }
 
 void mesh_filter::GLRenderer::begin() const
@@ -187,6 +207,7 @@ void mesh_filter::GLRenderer::begin() const
   glPushAttrib(GL_VIEWPORT_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_POLYGON_BIT);
   glBindFramebuffer(GL_FRAMEBUFFER, fbo_id_);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  color_pbo_pending_ = depth_pbo_pending_ = false;
   glViewport(0, 0, width_, height_);
   glUseProgram(program_);
   setCameraParameters();
@@ -208,6 +229,12 @@ void mesh_filter::GLRenderer::end() const
 
 void mesh_filter::GLRenderer::getColorBuffer(unsigned char* buffer) const
 {
+  if (color_pbo_pending_)
+  {
+    copyPixelBuffer(color_pbo_, buffer, width_ * height_ * 4);
+    color_pbo_pending_ = false;
+    return;
+  }
   glBindFramebuffer(GL_FRAMEBUFFER, fbo_id_);
   glBindTexture(GL_TEXTURE_2D, rgb_id_);
   glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, buffer);
@@ -216,12 +243,59 @@ void mesh_filter::GLRenderer::getColorBuffer(unsigned char* buffer) const
 
 void mesh_filter::GLRenderer::getDepthBuffer(float* buffer) const
 {
+  if (depth_pbo_pending_)
+  {
+    copyPixelBuffer(depth_pbo_, buffer, width_ * height_ * sizeof(float));
+    depth_pbo_pending_ = false;
+    return;
+  }
   glBindFramebuffer(GL_FRAMEBUFFER, fbo_id_);
   glBindTexture(GL_TEXTURE_2D, depth_id_);
   glGetTexImage(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, GL_FLOAT, buffer);
   glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
+void mesh_filter::GLRenderer::readColorBufferAsync() const
+{
+  // with a pixel pack buffer bound, glReadPixels only queues the transfer and returns
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo_id_);
+  glReadBuffer(GL_COLOR_ATTACHMENT0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, color_pbo_);
+  glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  color_pbo_pending_ = true;
+}
+
+void mesh_filter::GLRenderer::readDepthBufferAsync() const
+{
+  // the depth scale and bias used for uploading sensor data must not be applied to the read back depth
+  glPushAttrib(GL_PIXEL_MODE_BIT);
+  glPixelTransferf(GL_DEPTH_SCALE, 1.0);
+  glPixelTransferf(GL_DEPTH_BIAS, 0.0);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo_id_);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, depth_pbo_);
+  glReadPixels(0, 0, width_, height_, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  glPopAttrib();
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  depth_pbo_pending_ = true;
+}
+
+void mesh_filter::GLRenderer::copyPixelBuffer(GLuint pbo, void* buffer, std::size_t size) const
+{
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+  const void* data = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+  if (data)
+  {
+    memcpy(buffer, data, size);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  else
+    ROS_ERROR("Unable to map the pixel buffer object");
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
 GLuint mesh_filter::GLRenderer::setShadersFromFile(const string& vertex_filename, const string& fragment_filename)
 {
   if (program_)
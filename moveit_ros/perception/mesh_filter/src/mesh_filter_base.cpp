@@ -66,6 +66,7 @@ mesh_filter::MeshFilterBase::MeshFilterBase(const TransformCallback& transform_c
   , padding_scale_(1.0)
   , padding_offset_(0.01)
   , shadow_threshold_(0.5)
+  , requested_buffers_(0)
 {
   filter_thread_ = boost::thread(boost::bind(&MeshFilterBase::run, this, render_vertex_shader, render_fragment_shader,
                                              filter_vertex_shader, filter_fragment_shader));
@@ -218,6 +219,7 @@ void mesh_filter::MeshFilterBase::setShadowThreshold(float threshold)
 
 void mesh_filter::MeshFilterBase::getModelLabels(LabelType* labels) const
 {
+  requested_buffers_ |= MODEL_LABELS;
   JobPtr job(
       new FilterJob<void>(boost::bind(&GLRenderer::getColorBuffer, mesh_renderer_.get(), (unsigned char*)labels)));
   addJob(job);
@@ -226,6 +228,7 @@ void mesh_filter::MeshFilterBase::getModelLabels(LabelType* labels) const
 
 void mesh_filter::MeshFilterBase::getModelDepth(float* depth) const
 {
+  requested_buffers_ |= MODEL_DEPTH;
   JobPtr job1(new FilterJob<void>(boost::bind(&GLRenderer::getDepthBuffer, mesh_renderer_.get(), depth)));
   JobPtr job2(new FilterJob<void>(
       boost::bind(&SensorModel::Parameters::transformModelDepthToMetricDepth, sensor_parameters_.get(), depth)));
@@ -241,6 +244,7 @@ void mesh_filter::MeshFilterBase::getModelDepth(float* depth) const
 
 void mesh_filter::MeshFilterBase::getFilteredDepth(float* depth) const
 {
+  requested_buffers_ |= FILTERED_DEPTH;
   JobPtr job1(new FilterJob<void>(boost::bind(&GLRenderer::getDepthBuffer, depth_filter_.get(), depth)));
   JobPtr job2(new FilterJob<void>(
       boost::bind(&SensorModel::Parameters::transformFilteredDepthToMetricDepth, sensor_parameters_.get(), depth)));
@@ -256,6 +260,7 @@ void mesh_filter::MeshFilterBase::getFilteredDepth(float* depth) const
 
 void mesh_filter::MeshFilterBase::getFilteredLabels(LabelType* labels) const
 {
+  requested_buffers_ |= FILTERED_LABELS;
   JobPtr job(
       new FilterJob<void>(boost::bind(&GLRenderer::getColorBuffer, depth_filter_.get(), (unsigned char*)labels)));
   addJob(job);
@@ -383,6 +388,17 @@ void mesh_filter::MeshFilterBase::doFilter(const void* sensor_data, const int en
   glBindTexture(GL_TEXTURE_2D, color_texture);
   glCallList(canvas_);
   depth_filter_->end();
+
+  // queue the transfers of the buffers that are likely to be requested, so reading them does not stall the pipeline
+  unsigned int requested = requested_buffers_.exchange(0);
+  if (requested & MODEL_LABELS)
+    mesh_renderer_->readColorBufferAsync();
+  if (requested & MODEL_DEPTH)
+    mesh_renderer_->readDepthBufferAsync();
+  if (requested & FILTERED_LABELS)
+    depth_filter_->readColorBufferAsync();
+  if (requested & FILTERED_DEPTH)
+    depth_filter_->readDepthBufferAsync();
 }
 
 void mesh_filter::MeshFilterBase::setPaddingOffset(float offset)
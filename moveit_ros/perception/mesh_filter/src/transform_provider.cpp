@@ -81,14 +81,11 @@ void TransformProvider::setFrame(const string& frame)
   if (frame_id_ != frame)
   {
     frame_id_ = frame;
+    // invalidate transformations
+    boost::mutex::scoped_lock lock(transforms_mutex_);
     for (map<MeshHandle, shared_ptr<TransformContext> >::iterator contextIt = handle2context_.begin();
          contextIt != handle2context_.end(); ++contextIt)
-    {
-      // invalidate transformations
-      contextIt->second->mutex_.lock();
       contextIt->second->transformation_.matrix().setZero();
-      contextIt->second->mutex_.unlock();
-    }
   }
 }
 
@@ -101,9 +98,10 @@ bool TransformProvider::getTransform(MeshHandle handle, Affine3d& transform) con
     ROS_ERROR("Unable to find mesh with handle %d", handle);
     return false;
   }
-  contextIt->second->mutex_.lock();
-  transform = contextIt->second->transformation_;
-  contextIt->second->mutex_.unlock();
+  {
+    boost::mutex::scoped_lock lock(transforms_mutex_);
+    transform = contextIt->second->transformation_;
+  }
   return !(transform.matrix().isZero(0));
 }
 
@@ -126,38 +124,32 @@ void TransformProvider::setUpdateInterval(unsigned long usecs)
 
 void TransformProvider::updateTransforms()
 {
-  static Affine3d transformation;
-  static robot_state::RobotStatePtr robot_state;
-  robot_state = psm_->getStateMonitor()->getCurrentState();
-
-  static string error;
-  static Stamped<Pose> input_pose, out_pose;
-  tf_->getLatestCommonTime(frame_id_, psm_->getPlanningScene()->getPlanningFrame(), input_pose.stamp_, &error);
-  input_pose.frame_id_ = psm_->getPlanningScene()->getPlanningFrame();
+  robot_state::RobotStatePtr robot_state = psm_->getStateMonitor()->getCurrentState();
+  robot_state->updateCollisionBodyTransforms();
+  const string& planning_frame = psm_->getPlanningScene()->getPlanningFrame();
+
+  // one TF lookup for the camera; the links are placed relative to it with the poses of the robot state
+  Affine3d camera_from_planning;
+  bool valid = true;
+  try
+  {
+    StampedTransform stamped;
+    tf_->lookupTransform(frame_id_, planning_frame, Time(0), stamped);
+    transformTFToEigen(stamped, camera_from_planning);
+  }
+  catch (const tf::TransformException& ex)
+  {
+    valid = false;
+  }
 
+  boost::mutex::scoped_lock lock(transforms_mutex_);
   for (map<MeshHandle, shared_ptr<TransformContext> >::const_iterator contextIt = handle2context_.begin();
        contextIt != handle2context_.end(); ++contextIt)
   {
-    transformation = robot_state->getLinkState(contextIt->second->frame_id_)->getGlobalCollisionBodyTransform();
-    poseEigenToTF(transformation, input_pose);
-    try
-    {
-      tf_->transformPose(frame_id_, input_pose, out_pose);
-    }
-    catch (const tf::TransformException& ex)
-    {
-      handle2context_[contextIt->first]->mutex_.lock();
-      handle2context_[contextIt->first]->transformation_.matrix().setZero();
-      handle2context_[contextIt->first]->mutex_.unlock();
-      continue;
-    }
-    catch (std::exception& ex)
-    {
-      ROS_ERROR("Caught %s while updating transforms", ex.what());
-    }
-    poseTFToEigen(out_pose, transformation);
-    handle2context_[contextIt->first]->mutex_.lock();
-    handle2context_[contextIt->first]->transformation_ = transformation;
-    handle2context_[contextIt->first]->mutex_.unlock();
+    if (valid)
+      contextIt->second->transformation_ =
+          camera_from_planning * robot_state->getCollisionBodyTransform(contextIt->second->frame_id_, 0);
+    else
+      contextIt->second->transformation_.matrix().setZero();
   }
 }
@@ -39,21 +39,82 @@
 
 #include <octomap/octomap.h>
 #include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/mutex.hpp>
 #include <boost/function.hpp>
 #include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace occupancy_map_monitor
 {
 typedef octomap::OcTreeNode OccMapNode;
 
+/** @brief Log-odds updates for the cells of an OccMapTree, collected by an updater without holding the write lock of
+ *  the tree. Updates of the same cell add up. See OccMapTree::applyDelta(). */
+class OccMapDelta
+{
+public:
+  typedef std::unordered_map<octomap::OcTreeKey, float, octomap::OcTreeKey::KeyHash> CellUpdates;
+
+  /** @brief Add \e log_odds_update to the cell at \e key */
+  void updateNode(const octomap::OcTreeKey& key, float log_odds_update)
+  {
+    cells_[key] += log_odds_update;
+  }
+
+  /** @brief Add \e log_odds_update to the coarse block that starts at \e key (see OccMapTree::coarsenKey()) */
+  void updateCoarseNode(const octomap::OcTreeKey& key, float log_odds_update)
+  {
+    coarse_cells_[key] += log_odds_update;
+  }
+
+  /** @brief Add the updates of \e other to this delta */
+  void merge(const OccMapDelta& other);
+
+  void swap(OccMapDelta& other)
+  {
+    cells_.swap(other.cells_);
+    coarse_cells_.swap(other.coarse_cells_);
+  }
+
+  void clear()
+  {
+    cells_.clear();
+    coarse_cells_.clear();
+  }
+
+  bool empty() const
+  {
+    return cells_.empty() && coarse_cells_.empty();
+  }
+
+  const CellUpdates& getCells() const
+  {
+    return cells_;
+  }
+
+  const CellUpdates& getCoarseCells() const
+  {
+    return coarse_cells_;
+  }
+
+private:
+  CellUpdates cells_;
+  CellUpdates coarse_cells_;
+};
+
 class OccMapTree : public octomap::OcTree
 {
 public:
-  OccMapTree(double resolution) : octomap::OcTree(resolution)
+  /** @brief An axis-aligned box given by its minimum and maximum corner, in the frame of the map */
+  typedef std::pair<octomap::point3d, octomap::point3d> RegionOfInterest;
+
+  OccMapTree(double resolution) : octomap::OcTree(resolution), coarse_levels_(0), merging_deltas_(false)
   {
   }
 
-  OccMapTree(const std::string& filename) : octomap::OcTree(filename)
+  OccMapTree(const std::string& filename) : octomap::OcTree(filename), coarse_levels_(0), merging_deltas_(false)
   {
   }
 
@@ -108,9 +169,92 @@ public:
     update_callback_ = update_callback;
   }
 
+  /** @brief Outside the regions of interest, updaters maintain the map in blocks of 2^\e levels leaves per side, each
+   *  stored as a single node. A value of 0 (the default) keeps the full resolution everywhere. Hold the write lock
+   *  while calling this. */
+  void setCoarseLevels(unsigned int levels);
+
+  unsigned int getCoarseLevels() const
+  {
+    return coarse_levels_;
+  }
+
+  double getCoarseResolution() const
+  {
+    return getResolution() * (1 << coarse_levels_);
+  }
+
+  /** @brief Set the regions that keep the full resolution of the map when coarse levels are in use. Hold the write
+   *  lock while calling this. */
+  void setRegionsOfInterest(const std::vector<RegionOfInterest>& regions)
+  {
+    regions_of_interest_ = regions;
+  }
+
+  const std::vector<RegionOfInterest>& getRegionsOfInterest() const
+  {
+    return regions_of_interest_;
+  }
+
+  /** @brief True if updates to the cell at \e key should be applied to its coarse block rather than the cell alone */
+  bool isCoarse(const octomap::OcTreeKey& key) const;
+
+  /** @brief The key of the first leaf in the coarse block that contains \e key */
+  octomap::OcTreeKey coarsenKey(const octomap::OcTreeKey& key) const
+  {
+    const octomap::key_type mask = ~static_cast<octomap::key_type>((1 << coarse_levels_) - 1);
+    return octomap::OcTreeKey(key[0] & mask, key[1] & mask, key[2] & mask);
+  }
+
+  /** @brief The center of the coarse block that starts at \e key */
+  octomap::point3d coarseKeyToCoord(const octomap::OcTreeKey& key) const
+  {
+    return keyToCoord(key, tree_depth - coarse_levels_);
+  }
+
+  /** @brief Integrate a hit or miss for the whole coarse block that starts at \e key. The block ends up as a single
+   *  leaf: finer data stored inside it is merged first, keeping its most occupied value. */
+  OccMapNode* updateCoarseNode(const octomap::OcTreeKey& key, bool occupied);
+
+  /** @brief Same as above, adding \e log_odds_update to the block */
+  OccMapNode* updateCoarseNode(const octomap::OcTreeKey& key, float log_odds_update);
+
+  /** @brief Apply the updates of \e delta to the tree and trigger the update callback; \e delta is left empty. If
+   *  another thread is applying deltas at the time, \e delta is handed over to it and this returns right away: that
+   *  thread merges all the deltas submitted meanwhile and applies them in one batch, so several sensors take the write
+   *  lock once instead of once each. Do not hold a lock of the tree while calling this. */
+  void applyDelta(OccMapDelta& delta);
+
+  /** @brief Collect the keys of the nodes at \e depth. A pass over the whole map can then be split into one pass per
+   *  subtree, so the write lock is never held for long. Hold the read lock while calling this. */
+  void getSubtreeKeys(unsigned int depth, std::vector<octomap::OcTreeKey>& keys) const;
+
+  /** @brief Age the leaves of the subtree at \e key and \e depth: occupied leaves lose \e occupied_decay and free
+   *  leaves \e free_decay of their log-odds. Leaves that reach the unknown state are removed and subtrees that became
+   *  uniform are pruned. Pass 0 for both to only prune. Hold the write lock while calling this.
+   *  @return the number of leaves that were removed */
+  std::size_t decaySubtree(const octomap::OcTreeKey& key, unsigned int depth, float occupied_decay, float free_decay);
+
+  /** @brief Same as decaySubtree() for the part of the tree above \e depth; the subtrees at \e depth are left as they
+   *  are. Hold the write lock while calling this. */
+  std::size_t decayAboveDepth(unsigned int depth, float occupied_decay, float free_decay);
+
 private:
+  bool decayRecurs(OccMapNode* node, unsigned int depth, unsigned int max_depth, float occupied_decay,
+                   float free_decay, std::size_t& removed);
+
+  OccMapNode* updateCoarseNodeRecurs(OccMapNode* node, bool node_just_created, const octomap::OcTreeKey& key,
+                                     unsigned int depth, float log_odds_update);
+
+  unsigned int coarse_levels_;
+  std::vector<RegionOfInterest> regions_of_interest_;
+
   boost::shared_mutex tree_mutex_;
   boost::function<void()> update_callback_;
+
+  boost::mutex pending_deltas_mutex_;
+  std::vector<OccMapDelta> pending_deltas_;
+  bool merging_deltas_;
 };
 
 typedef std::shared_ptr<OccMapTree> OccMapTreePtr;
@@ -49,6 +49,8 @@
 #include <moveit/occupancy_map_monitor/occupancy_map_updater.h>
 
 #include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
 
 #include <memory>
 
@@ -65,7 +67,9 @@ public:
 
   ~OccupancyMapMonitor();
 
-  /** @brief start the monitor (will begin updating the octomap */
+  /** @brief start the monitor (will begin updating the octomap). If any of octomap_prune_interval,
+   *  octomap_occupied_decay_time, octomap_free_decay_time or octomap_max_memory is set, a background thread also
+   *  maintains the octree while the monitor is active, see maintainTree(). */
   void startMonitor();
 
   void stopMonitor();
@@ -96,6 +100,11 @@ public:
     return map_resolution_;
   }
 
+  /** @brief Set the boxes (in the map frame) that keep the full map resolution, e.g. around the end-effector or the
+   *  volume swept by a planning request. Only has an effect when a coarse resolution is configured
+   *  (octomap_coarse_resolution); outside these boxes the map is then maintained at that coarser resolution. */
+  void setRegionsOfInterest(const std::vector<OccMapTree::RegionOfInterest>& regions);
+
   const boost::shared_ptr<tf::Transformer>& getTFClient() const
   {
     return tf_;
@@ -127,6 +136,22 @@ public:
 private:
   void initialize();
 
+  /** @brief Read octomap_coarse_resolution and octomap_regions_of_interest from the parameter server */
+  void loadCoarseParameters();
+
+  /** @brief Read octomap_prune_interval, octomap_occupied_decay_time, octomap_free_decay_time and octomap_max_memory
+   *  (in MB) from the parameter server */
+  void loadMaintenanceParameters();
+
+  /** @brief Every maintenance interval, age the octree by the configured decay and, while it uses more memory than
+   *  allowed, evict the least certain voxels */
+  void maintenanceThread();
+
+  /** @brief Decay and prune the whole octree. The write lock is taken once per subtree so updaters and readers are
+   *  never blocked for a full pass.
+   *  @return the number of leaves that were removed */
+  std::size_t maintainTree(float occupied_decay, float free_decay);
+
   /** @brief Save the current octree to a binary file */
   bool saveMapCallback(moveit_msgs::SaveMap::Request& request, moveit_msgs::SaveMap::Response& response);
 
@@ -158,6 +183,15 @@ private:
   ros::ServiceServer load_map_srv_;
 
   bool active_;
+
+  double prune_interval_;
+  double occupied_decay_time_;
+  double free_decay_time_;
+  std::size_t max_memory_;
+  std::unique_ptr<boost::thread> maintenance_thread_;
+  boost::mutex maintenance_lock_;
+  boost::condition_variable maintenance_condition_;
+  bool maintenance_stop_;
 };
 }
 
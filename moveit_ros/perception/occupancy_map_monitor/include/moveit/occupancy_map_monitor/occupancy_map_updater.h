@@ -39,6 +39,7 @@
 
 #include <moveit/macros/class_forward.h>
 #include <moveit/occupancy_map_monitor/occupancy_map.h>
+#include <moveit/profiler/probes.h>
 #include <geometric_shapes/shapes.h>
 #include <boost/shared_ptr.hpp>
 #include <Eigen/Core>
@@ -106,6 +107,11 @@ protected:
   TransformCacheProvider transform_provider_callback_;
   ShapeTransformCache transform_cache_;
   bool debug_info_;
+  moveit::tools::probes::ProbeId message_age_probe_;
+
+  /** \brief Record how old the sensor data stamped \e stamp is when it is processed, while probes are enabled. A
+   *  growing age means the updater falls behind its input. */
+  void recordMessageAge(const ros::Time& stamp) const;
 
   bool updateTransformCache(const std::string& target_frame, const ros::Time& target_time);
 
@@ -0,0 +1,277 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/occupancy_map_monitor/occupancy_map.h>
+#include <ros/console.h>
+
+namespace occupancy_map_monitor
+{
+void OccMapTree::setCoarseLevels(unsigned int levels)
+{
+  if (levels >= tree_depth)
+    levels = tree_depth - 1;
+  coarse_levels_ = levels;
+}
+
+bool OccMapTree::isCoarse(const octomap::OcTreeKey& key) const
+{
+  if (coarse_levels_ == 0)
+    return false;
+
+  // a block is only coarse if no part of it is inside a region of interest; this way fine data kept for a region is
+  // never merged away by an update of a neighbouring cell
+  const octomap::point3d center = coarseKeyToCoord(coarsenKey(key));
+  const float half_size = getCoarseResolution() * 0.5;
+  for (std::size_t i = 0; i < regions_of_interest_.size(); ++i)
+  {
+    const octomap::point3d& min = regions_of_interest_[i].first;
+    const octomap::point3d& max = regions_of_interest_[i].second;
+    if (center.x() + half_size > min.x() && center.x() - half_size < max.x() && center.y() + half_size > min.y() &&
+        center.y() - half_size < max.y() && center.z() + half_size > min.z() && center.z() - half_size < max.z())
+      return false;
+  }
+  return true;
+}
+
+void OccMapDelta::merge(const OccMapDelta& other)
+{
+  for (CellUpdates::const_iterator it = other.cells_.begin(); it != other.cells_.end(); ++it)
+    cells_[it->first] += it->second;
+  for (CellUpdates::const_iterator it = other.coarse_cells_.begin(); it != other.coarse_cells_.end(); ++it)
+    coarse_cells_[it->first] += it->second;
+}
+
+void OccMapTree::applyDelta(OccMapDelta& delta)
+{
+  {
+    boost::mutex::scoped_lock slock(pending_deltas_mutex_);
+    pending_deltas_.push_back(OccMapDelta());
+    pending_deltas_.back().swap(delta);
+    // the thread that is merging applies this delta in its next batch
+    if (merging_deltas_)
+      return;
+    merging_deltas_ = true;
+  }
+
+  while (true)
+  {
+    std::vector<OccMapDelta> deltas;
+    {
+      boost::mutex::scoped_lock slock(pending_deltas_mutex_);
+      if (pending_deltas_.empty())
+      {
+        merging_deltas_ = false;
+        break;
+      }
+      deltas.swap(pending_deltas_);
+    }
+
+    // merge before taking the write lock, so a cell seen by several sensors is only updated once
+    for (std::size_t i = 1; i < deltas.size(); ++i)
+      deltas[0].merge(deltas[i]);
+
+    {
+      WriteLock lock = writing();
+      try
+      {
+        const OccMapDelta::CellUpdates& cells = deltas[0].getCells();
+        for (OccMapDelta::CellUpdates::const_iterator it = cells.begin(); it != cells.end(); ++it)
+          updateNode(it->first, it->second);
+        const OccMapDelta::CellUpdates& coarse_cells = deltas[0].getCoarseCells();
+        for (OccMapDelta::CellUpdates::const_iterator it = coarse_cells.begin(); it != coarse_cells.end(); ++it)
+          updateCoarseNode(it->first, it->second);
+      }
+      catch (...)
+      {
+        ROS_ERROR("Internal error while updating octree");
+      }
+    }
+    triggerUpdateCallback();
+  }
+}
+
+OccMapNode* OccMapTree::updateCoarseNode(const octomap::OcTreeKey& key, bool occupied)
+{
+  return updateCoarseNode(key, occupied ? getProbHitLog() : getProbMissLog());
+}
+
+OccMapNode* OccMapTree::updateCoarseNode(const octomap::OcTreeKey& key, float log_odds_update)
+{
+  bool created_root = false;
+  if (!root)
+  {
+    root = new OccMapNode();
+    tree_size++;
+    created_root = true;
+  }
+  return updateCoarseNodeRecurs(root, created_root, coarsenKey(key), 0, log_odds_update);
+}
+
+OccMapNode* OccMapTree::updateCoarseNodeRecurs(OccMapNode* node, bool node_just_created, const octomap::OcTreeKey& key,
+                                               unsigned int depth, float log_odds_update)
+{
+  // same descent as octomap's updateNodeRecurs(), but ending coarse_levels_ above the leaves
+  if (depth < tree_depth - coarse_levels_)
+  {
+    unsigned int pos = octomap::computeChildIdx(key, tree_depth - 1 - depth);
+    bool created_node = false;
+    if (!nodeChildExists(node, pos))
+    {
+      // a pruned node has no children but already holds the value of the whole volume
+      if (!nodeHasChildren(node) && !node_just_created)
+        expandNode(node);
+      else
+      {
+        createNodeChild(node, pos);
+        created_node = true;
+      }
+    }
+
+    OccMapNode* result = updateCoarseNodeRecurs(getNodeChild(node, pos), created_node, key, depth + 1, log_odds_update);
+    if (pruneNode(node))
+      result = node;
+    else
+      node->updateOccupancyChildren();
+    return result;
+  }
+
+  if (nodeHasChildren(node))
+  {
+    node->setLogOdds(node->getMaxChildLogOdds());
+    for (unsigned int i = 0; i < 8; ++i)
+      if (nodeChildExists(node, i))
+        deleteNodeChild(node, i);
+  }
+  updateNodeLogOdds(node, log_odds_update);
+  return node;
+}
+
+void OccMapTree::getSubtreeKeys(unsigned int depth, std::vector<octomap::OcTreeKey>& keys) const
+{
+  keys.clear();
+  if (!root)
+    return;
+  for (tree_iterator it = begin_tree(depth), end = end_tree(); it != end; ++it)
+    if (it.getDepth() == depth)
+      keys.push_back(it.getKey());
+}
+
+std::size_t OccMapTree::decaySubtree(const octomap::OcTreeKey& key, unsigned int depth, float occupied_decay,
+                                     float free_decay)
+{
+  if (!root)
+    return 0;
+  if (depth == 0)
+    return decayAboveDepth(tree_depth, occupied_decay, free_decay);
+
+  // remember the path down to the subtree, so its ancestors can be kept consistent with it afterwards
+  std::vector<OccMapNode*> path(depth + 1);
+  std::vector<unsigned int> child_idx(depth);
+  path[0] = root;
+  for (unsigned int d = 0; d < depth; ++d)
+  {
+    child_idx[d] = octomap::computeChildIdx(key, tree_depth - 1 - d);
+    if (!nodeChildExists(path[d], child_idx[d]))
+      return 0;
+    path[d + 1] = getNodeChild(path[d], child_idx[d]);
+  }
+
+  std::size_t removed = 0;
+  if (!decayRecurs(path[depth], depth, tree_depth, occupied_decay, free_decay, removed))
+  {
+    for (int d = depth - 1; d >= 0; --d)
+      path[d]->updateOccupancyChildren();
+    return removed;
+  }
+
+  // the subtree became unknown; ancestors that are left without children would otherwise read as leaves
+  for (int d = depth - 1; d >= 0; --d)
+  {
+    deleteNodeChild(path[d], child_idx[d]);
+    if (nodeHasChildren(path[d]))
+    {
+      for (; d >= 0; --d)
+        path[d]->updateOccupancyChildren();
+      return removed;
+    }
+  }
+  clear();
+  return removed;
+}
+
+std::size_t OccMapTree::decayAboveDepth(unsigned int depth, float occupied_decay, float free_decay)
+{
+  std::size_t removed = 0;
+  if (root && decayRecurs(root, 0, depth, occupied_decay, free_decay, removed))
+    clear();
+  return removed;
+}
+
+bool OccMapTree::decayRecurs(OccMapNode* node, unsigned int depth, unsigned int max_depth, float occupied_decay,
+                             float free_decay, std::size_t& removed)
+{
+  if (nodeHasChildren(node))
+  {
+    // subtrees at max_depth are processed separately and are kept as they are
+    if (depth == max_depth)
+      return false;
+    for (unsigned int i = 0; i < 8; ++i)
+      if (nodeChildExists(node, i) &&
+          decayRecurs(getNodeChild(node, i), depth + 1, max_depth, occupied_decay, free_decay, removed))
+        deleteNodeChild(node, i);
+    if (!nodeHasChildren(node))
+      return true;
+    if (!pruneNode(node))
+      node->updateOccupancyChildren();
+    return false;
+  }
+
+  // a leaf; it stays occupied or free until it is removed, so decay never turns an obstacle into free space
+  if (depth == max_depth && max_depth != tree_depth)
+    return false;
+  float log_odds = node->getLogOdds();
+  if (log_odds > 0.0f)
+    log_odds -= occupied_decay;
+  else
+    log_odds += free_decay;
+  if ((node->getLogOdds() > 0.0f) != (log_odds > 0.0f) || log_odds == 0.0f)
+  {
+    ++removed;
+    return true;
+  }
+  node->setLogOdds(log_odds);
+  return false;
+}
+}
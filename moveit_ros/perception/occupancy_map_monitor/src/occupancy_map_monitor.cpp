@@ -40,6 +40,8 @@
 #include <moveit/occupancy_map_monitor/occupancy_map.h>
 #include <moveit/occupancy_map_monitor/occupancy_map_monitor.h>
 #include <XmlRpcException.h>
+#include <algorithm>
+#include <cmath>
 
 namespace occupancy_map_monitor
 {
@@ -84,6 +86,8 @@ void OccupancyMapMonitor::initialize()
 
   tree_.reset(new OccMapTree(map_resolution_));
   tree_const_ = tree_;
+  loadCoarseParameters();
+  loadMaintenanceParameters();
 
   XmlRpc::XmlRpcValue sensor_list;
   if (nh_.getParam("sensors", sensor_list))
@@ -169,6 +173,87 @@ void OccupancyMapMonitor::initialize()
   load_map_srv_ = nh_.advertiseService("load_map", &OccupancyMapMonitor::loadMapCallback, this);
 }
 
+static bool readPoint(XmlRpc::XmlRpcValue& value, octomap::point3d& point)
+{
+  if (value.getType() != XmlRpc::XmlRpcValue::TypeArray || value.size() != 3)
+    return false;
+  for (int i = 0; i < 3; ++i)
+  {
+    if (value[i].getType() == XmlRpc::XmlRpcValue::TypeDouble)
+      point(i) = static_cast<double>(value[i]);
+    else if (value[i].getType() == XmlRpc::XmlRpcValue::TypeInt)
+      point(i) = static_cast<int>(value[i]);
+    else
+      return false;
+  }
+  return true;
+}
+
+void OccupancyMapMonitor::loadCoarseParameters()
+{
+  double coarse_resolution = 0.0;
+  if (!nh_.getParam("octomap_coarse_resolution", coarse_resolution) || coarse_resolution <= map_resolution_)
+    return;
+
+  // the coarse blocks are octree nodes, so their size is a power of two multiple of the resolution
+  unsigned int levels = std::max(1, static_cast<int>(std::round(std::log2(coarse_resolution / map_resolution_))));
+  tree_->setCoarseLevels(levels);
+  ROS_DEBUG("Using resolution = %lf m for the octomap outside the regions of interest", tree_->getCoarseResolution());
+
+  std::vector<OccMapTree::RegionOfInterest> regions;
+  XmlRpc::XmlRpcValue region_list;
+  if (nh_.getParam("octomap_regions_of_interest", region_list))
+  {
+    if (region_list.getType() == XmlRpc::XmlRpcValue::TypeArray)
+      for (int32_t i = 0; i < region_list.size(); ++i)
+      {
+        OccMapTree::RegionOfInterest region;
+        if (region_list[i].getType() != XmlRpc::XmlRpcValue::TypeStruct || !region_list[i].hasMember("min") ||
+            !region_list[i].hasMember("max") || !readPoint(region_list[i]["min"], region.first) ||
+            !readPoint(region_list[i]["max"], region.second))
+        {
+          ROS_ERROR("Octomap region of interest %d must specify 'min' and 'max' as [x, y, z]; ignoring.", i);
+          continue;
+        }
+        regions.push_back(region);
+      }
+    else
+      ROS_ERROR("List of octomap regions of interest must be an array!");
+  }
+  tree_->setRegionsOfInterest(regions);
+}
+
+void OccupancyMapMonitor::loadMaintenanceParameters()
+{
+  prune_interval_ = 0.0;
+  occupied_decay_time_ = 0.0;
+  free_decay_time_ = 0.0;
+  max_memory_ = 0;
+  maintenance_stop_ = true;
+
+  nh_.param("octomap_prune_interval", prune_interval_, 0.0);
+  nh_.param("octomap_occupied_decay_time", occupied_decay_time_, 0.0);
+  nh_.param("octomap_free_decay_time", free_decay_time_, 0.0);
+  double max_memory_mb = 0.0;
+  if (nh_.getParam("octomap_max_memory", max_memory_mb) && max_memory_mb > 0.0)
+    max_memory_ = static_cast<std::size_t>(max_memory_mb * 1024.0 * 1024.0);
+
+  // decay and the memory bound are applied by the same pass as pruning, so they need an interval too
+  if (prune_interval_ <= 0.0 && (occupied_decay_time_ > 0.0 || free_decay_time_ > 0.0 || max_memory_ > 0))
+    prune_interval_ = 1.0;
+  if (prune_interval_ > 0.0)
+    ROS_DEBUG("Maintaining the octomap every %lf s (occupied decay time %lf s, free decay time %lf s, "
+              "memory limit %zu bytes)",
+              prune_interval_, occupied_decay_time_, free_decay_time_, max_memory_);
+}
+
+void OccupancyMapMonitor::setRegionsOfInterest(const std::vector<OccMapTree::RegionOfInterest>& regions)
+{
+  tree_->lockWrite();
+  tree_->setRegionsOfInterest(regions);
+  tree_->unlockWrite();
+}
+
 void OccupancyMapMonitor::addUpdater(const OccupancyMapUpdaterPtr& updater)
 {
   if (updater)
@@ -323,17 +408,102 @@ bool OccupancyMapMonitor::loadMapCallback(moveit_msgs::LoadMap::Request& request
   return true;
 }
 
+std::size_t OccupancyMapMonitor::maintainTree(float occupied_decay, float free_decay)
+{
+  // subtrees of 2^6 leaves per side are small enough to process without holding up the updaters
+  static const unsigned int SUBTREE_LEVELS = 6;
+
+  std::vector<octomap::OcTreeKey> keys;
+  unsigned int depth;
+  {
+    OccMapTree::ReadLock lock = tree_->reading();
+    depth = tree_->getTreeDepth() > SUBTREE_LEVELS ? tree_->getTreeDepth() - SUBTREE_LEVELS : 0;
+    tree_->getSubtreeKeys(depth, keys);
+  }
+
+  // subtrees created after the keys were collected are simply left for the next pass
+  std::size_t removed = 0;
+  for (std::size_t i = 0; i < keys.size(); ++i)
+  {
+    OccMapTree::WriteLock lock = tree_->writing();
+    removed += tree_->decaySubtree(keys[i], depth, occupied_decay, free_decay);
+  }
+  OccMapTree::WriteLock lock = tree_->writing();
+  removed += tree_->decayAboveDepth(depth, occupied_decay, free_decay);
+  return removed;
+}
+
+void OccupancyMapMonitor::maintenanceThread()
+{
+  const float max_log_odds = tree_->getClampingThresMaxLog();
+  const float min_log_odds = tree_->getClampingThresMinLog();
+  // a voxel observed at the clamping threshold becomes unknown after the decay time without new observations
+  const float occupied_decay = occupied_decay_time_ > 0.0 ? max_log_odds * prune_interval_ / occupied_decay_time_ : 0.0;
+  const float free_decay = free_decay_time_ > 0.0 ? -min_log_odds * prune_interval_ / free_decay_time_ : 0.0;
+
+  boost::unique_lock<boost::mutex> lock(maintenance_lock_);
+  while (!maintenance_stop_)
+  {
+    maintenance_condition_.timed_wait(lock, boost::posix_time::microseconds(static_cast<long>(prune_interval_ * 1e6)));
+    if (maintenance_stop_)
+      break;
+    lock.unlock();
+
+    std::size_t removed = maintainTree(occupied_decay, free_decay);
+    if (max_memory_ > 0)
+    {
+      // evict the least certain voxels first; with decay enabled these are the ones observed least recently
+      float eviction = std::max(max_log_odds, -min_log_odds) / 16.0f;
+      std::size_t memory = 0;
+      for (int i = 0; i < 8; ++i, eviction *= 2.0f)
+      {
+        {
+          OccMapTree::ReadLock read_lock = tree_->reading();
+          memory = tree_->memoryUsage();
+        }
+        if (memory <= max_memory_)
+          break;
+        removed += maintainTree(eviction, eviction);
+      }
+      if (memory > max_memory_)
+        ROS_WARN_THROTTLE(10, "Octomap still uses %zu bytes after eviction (limit is %zu bytes)", memory, max_memory_);
+    }
+    if (removed > 0)
+      ROS_DEBUG("Removed %zu voxels from the octomap", removed);
+    if (removed > 0 || occupied_decay > 0.0f || free_decay > 0.0f)
+      tree_->triggerUpdateCallback();
+
+    lock.lock();
+  }
+}
+
 void OccupancyMapMonitor::startMonitor()
 {
   active_ = true;
   /* initialize all of the occupancy map updaters */
   for (std::size_t i = 0; i < map_updaters_.size(); ++i)
     map_updaters_[i]->start();
+
+  if (prune_interval_ > 0.0 && !maintenance_thread_)
+  {
+    maintenance_stop_ = false;
+    maintenance_thread_.reset(new boost::thread(boost::bind(&OccupancyMapMonitor::maintenanceThread, this)));
+  }
 }
 
 void OccupancyMapMonitor::stopMonitor()
 {
   active_ = false;
+  if (maintenance_thread_)
+  {
+    {
+      boost::mutex::scoped_lock _(maintenance_lock_);
+      maintenance_stop_ = true;
+    }
+    maintenance_condition_.notify_all();
+    maintenance_thread_->join();
+    maintenance_thread_.reset();
+  }
   for (std::size_t i = 0; i < map_updaters_.size(); ++i)
     map_updaters_[i]->stop();
 }
@@ -36,11 +36,13 @@
 
 #include <moveit/occupancy_map_monitor/occupancy_map_monitor.h>
 #include <moveit/occupancy_map_monitor/occupancy_map_updater.h>
+#include <chrono>
 
 namespace occupancy_map_monitor
 {
 OccupancyMapUpdater::OccupancyMapUpdater(const std::string& type) : type_(type)
 {
+  message_age_probe_ = moveit::tools::probes::registerProbe("OccupancyMapUpdater::message age (" + type + ")");
 }
 
 OccupancyMapUpdater::~OccupancyMapUpdater()
@@ -70,6 +72,20 @@ void OccupancyMapUpdater::readXmlParam(XmlRpc::XmlRpcValue& params, const std::s
     *value = (int)params[param_name];
 }
 
+void OccupancyMapUpdater::recordMessageAge(const ros::Time& stamp) const
+{
+  if (!moveit::tools::probes::isEnabled() || stamp.isZero())
+    return;
+  const ros::Duration age = ros::Time::now() - stamp;
+  if (age <= ros::Duration(0.0))
+    return;
+  // as a trace event, the age spans from the time the data was stamped until now
+  const std::uint64_t now =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  const std::uint64_t age_ns = age.toNSec();
+  moveit::tools::probes::record(message_age_probe_, now > age_ns ? now - age_ns : 0, age_ns);
+}
+
 bool OccupancyMapUpdater::updateTransformCache(const std::string& target_frame, const ros::Time& target_time)
 {
   transform_cache_.clear();
@@ -79,6 +79,10 @@ public:
   /** \brief Compute the containment mask (INSIDE or OUTSIDE) for a given pointcloud. If a mask element is INSIDE, the
      point
       is inside the robot. The point is outside if the mask element is OUTSIDE.
+
+      The poses of all bodies are taken once per call. A first pass over the cloud clips points by distance and
+      rejects everything outside the axis-aligned box around the bodies' bounding spheres; only the remaining points
+      are tested against the bounding sphere of each body and then the body itself.
   */
   void maskContainment(const sensor_msgs::PointCloud2& data_in, const Eigen::Vector3d& sensor_pos,
                        const double min_sensor_dist, const double max_sensor_dist, std::vector<int>& mask);
@@ -126,7 +130,12 @@ private:
   mutable boost::mutex shapes_lock_;
   std::set<SeeShape, SortBodies> bodies_;
   std::map<ShapeHandle, std::set<SeeShape, SortBodies>::iterator> used_handles_;
+  /** \brief Per-call snapshot: the bodies whose pose is known for the current cloud and their bounding spheres */
+  std::vector<const bodies::Body*> posed_bodies_;
   std::vector<bodies::BoundingSphere> bspheres_;
+
+  /** \brief Indices of the points that passed the bulk rejection, kept to avoid reallocating for every cloud */
+  std::vector<unsigned int> candidates_;
 };
 }
 
@@ -38,6 +38,8 @@
 #include <geometric_shapes/body_operations.h>
 #include <ros/console.h>
 #include <sensor_msgs/point_cloud2_iterator.h>
+#include <cmath>
+#include <limits>
 
 point_containment_filter::ShapeMask::ShapeMask(const TransformCallback& transform_callback)
   : transform_callback_(transform_callback), next_handle_(1), min_handle_(1)
@@ -116,52 +118,85 @@ void point_containment_filter::ShapeMask::maskContainment(const sensor_msgs::Poi
                                                           std::vector<int>& mask)
 {
   boost::mutex::scoped_lock _(shapes_lock_);
-  const unsigned int np = data_in.data.size() / data_in.point_step;
+  const unsigned int np = data_in.point_step > 0 ? data_in.data.size() / data_in.point_step : 0;
   mask.resize(np);
+  if (np == 0)
+    return;
 
-  if (bodies_.empty())
-    std::fill(mask.begin(), mask.end(), (int)OUTSIDE);
-  else
+  // take the poses of all bodies once; bodies without a transform for this cloud are not tested
+  Eigen::Affine3d tmp;
+  posed_bodies_.clear();
+  bspheres_.clear();
+  for (std::set<SeeShape>::const_iterator it = bodies_.begin(); it != bodies_.end(); ++it)
   {
-    Eigen::Affine3d tmp;
-    bspheres_.resize(bodies_.size());
-    std::size_t j = 0;
-    for (std::set<SeeShape>::const_iterator it = bodies_.begin(); it != bodies_.end(); ++it)
+    if (transform_callback_(it->handle, tmp))
     {
-      if (transform_callback_(it->handle, tmp))
-      {
-        it->body->setPose(tmp);
-        it->body->computeBoundingSphere(bspheres_[j++]);
-      }
+      it->body->setPose(tmp);
+      bspheres_.resize(bspheres_.size() + 1);
+      it->body->computeBoundingSphere(bspheres_.back());
+      posed_bodies_.push_back(it->body);
     }
+  }
 
-    // compute a sphere that bounds the entire robot
-    bodies::BoundingSphere bound;
+  // compute a sphere and a box that bound the entire robot
+  bodies::BoundingSphere bound;
+  Eigen::Vector3d box_min = Eigen::Vector3d::Constant(std::numeric_limits<double>::infinity());
+  Eigen::Vector3d box_max = -box_min;
+  if (!posed_bodies_.empty())
+  {
     bodies::mergeBoundingSpheres(bspheres_, bound);
-    const double radiusSquared = bound.radius * bound.radius;
-
-    // we now decide which points we keep
-    sensor_msgs::PointCloud2ConstIterator<float> iter_x(data_in, "x");
-    sensor_msgs::PointCloud2ConstIterator<float> iter_y(data_in, "y");
-    sensor_msgs::PointCloud2ConstIterator<float> iter_z(data_in, "z");
-
-    // Cloud iterators are not incremented in the for loop, because of the pragma
-    // Comment out below parallelization as it can result in very high CPU consumption
-    //#pragma omp parallel for schedule(dynamic)
-    for (int i = 0; i < (int)np; ++i)
+    for (std::size_t j = 0; j < bspheres_.size(); ++j)
     {
-      Eigen::Vector3d pt = Eigen::Vector3d(*(iter_x + i), *(iter_y + i), *(iter_z + i));
-      double d = pt.norm();
-      int out = OUTSIDE;
-      if (d < min_sensor_dist || d > max_sensor_dist)
-        out = CLIP;
-      else if ((bound.center - pt).squaredNorm() < radiusSquared)
-        for (std::set<SeeShape>::const_iterator it = bodies_.begin(); it != bodies_.end() && out == OUTSIDE; ++it)
-          if (it->body->containsPoint(pt))
-            out = INSIDE;
-      mask[i] = out;
+      box_min = box_min.cwiseMin(bspheres_[j].center - Eigen::Vector3d::Constant(bspheres_[j].radius));
+      box_max = box_max.cwiseMax(bspheres_[j].center + Eigen::Vector3d::Constant(bspheres_[j].radius));
     }
   }
+  const double radius_squared = bound.radius * bound.radius;
+
+  // read the coordinates through plain offsets instead of advancing three iterators per point
+  sensor_msgs::PointCloud2ConstIterator<float> iter_x(data_in, "x");
+  sensor_msgs::PointCloud2ConstIterator<float> iter_y(data_in, "y");
+  sensor_msgs::PointCloud2ConstIterator<float> iter_z(data_in, "z");
+  const uint8_t* data = &data_in.data[0];
+  const std::size_t offset_x = reinterpret_cast<const uint8_t*>(&*iter_x) - data;
+  const std::size_t offset_y = reinterpret_cast<const uint8_t*>(&*iter_y) - data;
+  const std::size_t offset_z = reinterpret_cast<const uint8_t*>(&*iter_z) - data;
+  const std::size_t step = data_in.point_step;
+
+  // bulk pass: distance clipping and rejection of everything outside the box, without touching the bodies
+  candidates_.clear();
+  for (unsigned int i = 0; i < np; ++i)
+  {
+    const uint8_t* point = data + i * step;
+    const double x = *reinterpret_cast<const float*>(point + offset_x);
+    const double y = *reinterpret_cast<const float*>(point + offset_y);
+    const double z = *reinterpret_cast<const float*>(point + offset_z);
+    const double d = std::sqrt(x * x + y * y + z * z);
+    const bool clip = d < min_sensor_dist || d > max_sensor_dist;
+    mask[i] = clip ? CLIP : OUTSIDE;
+    if (!clip && x >= box_min.x() && x <= box_max.x() && y >= box_min.y() && y <= box_max.y() && z >= box_min.z() &&
+        z <= box_max.z())
+      candidates_.push_back(i);
+  }
+
+  // exact tests, first against the bounding spheres; larger bodies come first
+  for (std::size_t k = 0; k < candidates_.size(); ++k)
+  {
+    const unsigned int i = candidates_[k];
+    const uint8_t* point = data + i * step;
+    const Eigen::Vector3d pt(*reinterpret_cast<const float*>(point + offset_x),
+                             *reinterpret_cast<const float*>(point + offset_y),
+                             *reinterpret_cast<const float*>(point + offset_z));
+    if ((bound.center - pt).squaredNorm() >= radius_squared)
+      continue;
+    for (std::size_t j = 0; j < posed_bodies_.size(); ++j)
+      if ((bspheres_[j].center - pt).squaredNorm() <= bspheres_[j].radius * bspheres_[j].radius &&
+          posed_bodies_[j]->containsPoint(pt))
+      {
+        mask[i] = INSIDE;
+        break;
+      }
+  }
 }
 
 int point_containment_filter::ShapeMask::getMaskContainment(const Eigen::Vector3d& pt) const
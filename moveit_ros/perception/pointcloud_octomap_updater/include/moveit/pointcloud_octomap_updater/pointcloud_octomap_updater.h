@@ -91,9 +91,9 @@ private:
   message_filters::Subscriber<sensor_msgs::PointCloud2>* point_cloud_subscriber_;
   tf::MessageFilter<sensor_msgs::PointCloud2>* point_cloud_filter_;
 
-  /* used to store all cells in the map which a given ray passes through during raycasting.
-     we cache this here because it dynamically pre-allocates a lot of memory in its contsructor */
-  octomap::KeyRay key_ray_;
+  /* used to store all cells in the map which a given ray passes through during raycasting, one per thread.
+     we cache these here because they dynamically pre-allocate a lot of memory in their constructor */
+  std::vector<octomap::KeyRay> key_rays_;
 
   std::unique_ptr<point_containment_filter::ShapeMask> shape_mask_;
   std::vector<int> mask_;
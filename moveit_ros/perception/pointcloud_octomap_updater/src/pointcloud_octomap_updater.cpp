@@ -37,12 +37,17 @@
 #include <cmath>
 #include <moveit/pointcloud_octomap_updater/pointcloud_octomap_updater.h>
 #include <moveit/occupancy_map_monitor/occupancy_map_monitor.h>
+#include <moveit/profiler/probes.h>
 #include <message_filters/subscriber.h>
 #include <sensor_msgs/point_cloud2_iterator.h>
 #include <XmlRpcException.h>
 
 #include <memory>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 namespace occupancy_map_monitor
 {
 PointCloudOctomapUpdater::PointCloudOctomapUpdater()
@@ -170,6 +175,8 @@ void PointCloudOctomapUpdater::cloudMsgCallback(const sensor_msgs::PointCloud2::
 {
   ROS_DEBUG("Received a new point cloud message");
   ros::WallTime start = ros::WallTime::now();
+  MOVEIT_PROBE_SCOPE("PointCloudOctomapUpdater::cloudMsgCallback");
+  recordMessageAge(cloud_msg->header.stamp);
 
   if (max_update_rate_ > 0)
   {
@@ -221,6 +228,8 @@ void PointCloudOctomapUpdater::cloudMsgCallback(const sensor_msgs::PointCloud2::
   updateMask(*cloud_msg, sensor_origin_eigen, mask_);
 
   octomap::KeySet free_cells, occupied_cells, model_cells, clip_cells;
+  /* blocks outside the regions of interest, when the map keeps those at a coarser resolution */
+  octomap::KeySet coarse_free_cells, coarse_occupied_cells;
   std::unique_ptr<sensor_msgs::PointCloud2> filtered_cloud;
 
   // We only use these iterators if we are creating a filtered_cloud for
@@ -277,7 +286,11 @@ void PointCloudOctomapUpdater::cloudMsgCallback(const sensor_msgs::PointCloud2::
             clip_cells.insert(tree_->coordToKey(point_tf.getX(), point_tf.getY(), point_tf.getZ()));
           else
           {
-            occupied_cells.insert(tree_->coordToKey(point_tf.getX(), point_tf.getY(), point_tf.getZ()));
+            const octomap::OcTreeKey key = tree_->coordToKey(point_tf.getX(), point_tf.getY(), point_tf.getZ());
+            if (tree_->isCoarse(key))
+              coarse_occupied_cells.insert(tree_->coarsenKey(key));
+            else
+              occupied_cells.insert(key);
             // build list of valid points if we want to publish them
             if (filtered_cloud)
             {
@@ -294,20 +307,55 @@ void PointCloudOctomapUpdater::cloudMsgCallback(const sensor_msgs::PointCloud2::
       }
     }
 
-    /* compute the free cells along each ray that ends at an occupied cell */
+    /* compute the free cells along each ray that ends at an occupied, model or clipped cell; the rays are
+       independent, so they are cast in parallel into per-thread key sets that are merged at the end. Points that
+       fall into the same coarse block share a single ray to the center of that block */
+    std::vector<octomap::point3d> ray_ends;
+    ray_ends.reserve(occupied_cells.size() + coarse_occupied_cells.size() + model_cells.size() + clip_cells.size());
     for (octomap::KeySet::iterator it = occupied_cells.begin(), end = occupied_cells.end(); it != end; ++it)
-      if (tree_->computeRayKeys(sensor_origin, tree_->keyToCoord(*it), key_ray_))
-        free_cells.insert(key_ray_.begin(), key_ray_.end());
-
-    /* compute the free cells along each ray that ends at a model cell */
+      ray_ends.push_back(tree_->keyToCoord(*it));
+    for (octomap::KeySet::iterator it = coarse_occupied_cells.begin(), end = coarse_occupied_cells.end(); it != end;
+         ++it)
+      ray_ends.push_back(tree_->coarseKeyToCoord(*it));
     for (octomap::KeySet::iterator it = model_cells.begin(), end = model_cells.end(); it != end; ++it)
-      if (tree_->computeRayKeys(sensor_origin, tree_->keyToCoord(*it), key_ray_))
-        free_cells.insert(key_ray_.begin(), key_ray_.end());
-
-    /* compute the free cells along each ray that ends at a clipped cell */
+      ray_ends.push_back(tree_->keyToCoord(*it));
     for (octomap::KeySet::iterator it = clip_cells.begin(), end = clip_cells.end(); it != end; ++it)
-      if (tree_->computeRayKeys(sensor_origin, tree_->keyToCoord(*it), key_ray_))
-        free_cells.insert(key_ray_.begin(), key_ray_.end());
+      ray_ends.push_back(tree_->keyToCoord(*it));
+    const int ray_count = ray_ends.size();
+#ifdef _OPENMP
+    key_rays_.resize(omp_get_max_threads());
+#else
+    key_rays_.resize(1);
+#endif
+
+#pragma omp parallel
+    {
+#ifdef _OPENMP
+      octomap::KeyRay& key_ray = key_rays_[omp_get_thread_num()];
+#else
+      octomap::KeyRay& key_ray = key_rays_[0];
+#endif
+      octomap::KeySet thread_free_cells;
+#pragma omp for schedule(dynamic, 256)
+      for (int i = 0; i < ray_count; ++i)
+        if (tree_->computeRayKeys(sensor_origin, ray_ends[i], key_ray))
+          thread_free_cells.insert(key_ray.begin(), key_ray.end());
+
+#pragma omp critical
+      free_cells.insert(thread_free_cells.begin(), thread_free_cells.end());
+    }
+
+    /* free cells outside the regions of interest are cleared as whole blocks */
+    if (tree_->getCoarseLevels() > 0)
+    {
+      octomap::KeySet fine_free_cells;
+      for (octomap::KeySet::iterator it = free_cells.begin(), end = free_cells.end(); it != end; ++it)
+        if (tree_->isCoarse(*it))
+          coarse_free_cells.insert(tree_->coarsenKey(*it));
+        else
+          fine_free_cells.insert(*it);
+      free_cells.swap(fine_free_cells);
+    }
   }
   catch (...)
   {
@@ -324,31 +372,38 @@ void PointCloudOctomapUpdater::cloudMsgCallback(const sensor_msgs::PointCloud2::
   /* occupied cells are not free */
   for (octomap::KeySet::iterator it = occupied_cells.begin(), end = occupied_cells.end(); it != end; ++it)
     free_cells.erase(*it);
+  for (octomap::KeySet::iterator it = coarse_occupied_cells.begin(), end = coarse_occupied_cells.end(); it != end;
+       ++it)
+    coarse_free_cells.erase(*it);
+
+  /* collect the updates without the write lock; the tree applies them together with those of the other sensors */
+  const float lg_hit = tree_->getProbHitLog();
+  const float lg_miss = tree_->getProbMissLog();
+  occupancy_map_monitor::OccMapDelta delta;
+
+  /* mark free cells only if not seen occupied in this cloud */
+  for (octomap::KeySet::iterator it = free_cells.begin(), end = free_cells.end(); it != end; ++it)
+    delta.updateNode(*it, lg_miss);
+  for (octomap::KeySet::iterator it = coarse_free_cells.begin(), end = coarse_free_cells.end(); it != end; ++it)
+    delta.updateCoarseNode(*it, lg_miss);
+
+  /* now mark all occupied cells */
+  for (octomap::KeySet::iterator it = occupied_cells.begin(), end = occupied_cells.end(); it != end; ++it)
+    delta.updateNode(*it, lg_hit);
+  for (octomap::KeySet::iterator it = coarse_occupied_cells.begin(), end = coarse_occupied_cells.end(); it != end;
+       ++it)
+    delta.updateCoarseNode(*it, lg_hit);
 
-  tree_->lockWrite();
-
-  try
-  {
-    /* mark free cells only if not seen occupied in this cloud */
-    for (octomap::KeySet::iterator it = free_cells.begin(), end = free_cells.end(); it != end; ++it)
-      tree_->updateNode(*it, false);
-
-    /* now mark all occupied cells */
-    for (octomap::KeySet::iterator it = occupied_cells.begin(), end = occupied_cells.end(); it != end; ++it)
-      tree_->updateNode(*it, true);
+  // set the logodds to the minimum for the cells that are part of the model
+  const float lg = tree_->getClampingThresMinLog() - tree_->getClampingThresMaxLog();
+  for (octomap::KeySet::iterator it = model_cells.begin(), end = model_cells.end(); it != end; ++it)
+    delta.updateNode(*it, lg);
 
-    // set the logodds to the minimum for the cells that are part of the model
-    const float lg = tree_->getClampingThresMinLog() - tree_->getClampingThresMaxLog();
-    for (octomap::KeySet::iterator it = model_cells.begin(), end = model_cells.end(); it != end; ++it)
-      tree_->updateNode(*it, lg);
-  }
-  catch (...)
   {
-    ROS_ERROR("Internal error while updating octree");
+    MOVEIT_PROBE_SCOPE("PointCloudOctomapUpdater::applyDelta");
+    tree_->applyDelta(delta);
   }
-  tree_->unlockWrite();
   ROS_DEBUG("Processed point cloud in %lf ms", (ros::WallTime::now() - start).toSec() * 1000.0);
-  tree_->triggerUpdateCallback();
 
   if (filtered_cloud)
   {
@@ -43,17 +43,70 @@
 #include <geometric_shapes/shape_operations.h>
 #include <moveit_msgs/PlanningScene.h>
 
-// OpenCV
-#include <opencv2/imgproc/imgproc.hpp>
-
 // Eigen
 #include <eigen_conversions/eigen_msg.h>
 #include <Eigen/Geometry>
 
+#include <algorithm>
+
 namespace moveit
 {
 namespace semantic_world
 {
+namespace
+{
+// tables are compared by value to find the ones that changed since they were last added to the collision world
+bool sameTable(const object_recognition_msgs::Table& a, const object_recognition_msgs::Table& b)
+{
+  if (a.header.frame_id != b.header.frame_id || a.convex_hull.size() != b.convex_hull.size())
+    return false;
+  const geometry_msgs::Pose &pa = a.pose, &pb = b.pose;
+  if (pa.position.x != pb.position.x || pa.position.y != pb.position.y || pa.position.z != pb.position.z ||
+      pa.orientation.x != pb.orientation.x || pa.orientation.y != pb.orientation.y ||
+      pa.orientation.z != pb.orientation.z || pa.orientation.w != pb.orientation.w)
+    return false;
+  for (std::size_t i = 0; i < a.convex_hull.size(); ++i)
+    if (a.convex_hull[i].x != b.convex_hull[i].x || a.convex_hull[i].y != b.convex_hull[i].y ||
+        a.convex_hull[i].z != b.convex_hull[i].z)
+      return false;
+  return true;
+}
+
+// distance from (x, y) to the closest edge of the table contour, in the table frame
+double distanceToContour(const std::vector<geometry_msgs::Point>& contour, double x, double y)
+{
+  double min_sq = std::numeric_limits<double>::max();
+  for (std::size_t i = 0, j = contour.size() - 1; i < contour.size(); j = i++)
+  {
+    double ex = contour[i].x - contour[j].x, ey = contour[i].y - contour[j].y;
+    double px = x - contour[j].x, py = y - contour[j].y;
+    double len_sq = ex * ex + ey * ey;
+    double t = len_sq > 0.0 ? std::max(0.0, std::min(1.0, (px * ex + py * ey) / len_sq)) : 0.0;
+    double dx = px - t * ex, dy = py - t * ey;
+    min_sq = std::min(min_sq, dx * dx + dy * dy);
+  }
+  return sqrt(min_sq);
+}
+
+// the x coordinates at which the line at height y crosses the table contour; between consecutive pairs of
+// crossings, the line is inside the contour
+void contourCrossings(const std::vector<geometry_msgs::Point>& contour, double y, std::vector<double>& crossings)
+{
+  crossings.clear();
+  for (std::size_t i = 0, j = contour.size() - 1; i < contour.size(); j = i++)
+    if ((contour[i].y > y) != (contour[j].y > y))
+      crossings.push_back(contour[j].x +
+                          (y - contour[j].y) * (contour[i].x - contour[j].x) / (contour[i].y - contour[j].y));
+  std::sort(crossings.begin(), crossings.end());
+}
+
+// whether x is inside the contour, given the crossings of the line it is on
+bool insideCrossings(const std::vector<double>& crossings, double x)
+{
+  return (std::upper_bound(crossings.begin(), crossings.end(), x) - crossings.begin()) % 2 == 1;
+}
+}
+
 SemanticWorld::SemanticWorld(const planning_scene::PlanningSceneConstPtr& planning_scene)
   : planning_scene_(planning_scene)
 {
@@ -96,39 +149,51 @@ bool SemanticWorld::addTablesToCollisionWorld()
   moveit_msgs::PlanningScene planning_scene;
   planning_scene.is_diff = true;
 
-  // Remove the existing tables
-  std::map<std::string, object_recognition_msgs::Table>::iterator it;
-  for (it = current_tables_in_collision_world_.begin(); it != current_tables_in_collision_world_.end(); ++it)
+  // Remove the tables that are gone; the ones that are unchanged are left alone and the ones that changed are
+  // replaced, so continuous table updates only send (and mesh) what differs
+  std::map<std::string, object_recognition_msgs::Table> tables;
+  for (std::size_t i = 0; i < table_array_.tables.size(); ++i)
   {
-    moveit_msgs::CollisionObject co;
-    co.id = it->first;
-    co.operation = moveit_msgs::CollisionObject::REMOVE;
-    planning_scene.world.collision_objects.push_back(co);
-    //    collision_object_publisher_.publish(co);
+    std::stringstream ss;
+    ss << "table_" << i;
+    tables[ss.str()] = table_array_.tables[i];
   }
+  std::map<std::string, object_recognition_msgs::Table>::iterator it;
+  for (it = current_tables_in_collision_world_.begin(); it != current_tables_in_collision_world_.end(); ++it)
+    if (tables.find(it->first) == tables.end())
+    {
+      moveit_msgs::CollisionObject co;
+      co.id = it->first;
+      co.operation = moveit_msgs::CollisionObject::REMOVE;
+      planning_scene.world.collision_objects.push_back(co);
+    }
 
-  planning_scene_diff_publisher_.publish(planning_scene);
-  planning_scene.world.collision_objects.clear();
-  current_tables_in_collision_world_.clear();
-  // Add the new tables
-  for (std::size_t i = 0; i < table_array_.tables.size(); ++i)
+  std::map<std::string, object_recognition_msgs::Table> previous_tables;
+  previous_tables.swap(current_tables_in_collision_world_);
+  for (it = tables.begin(); it != tables.end(); ++it)
   {
+    const object_recognition_msgs::Table& table = it->second;
+    current_tables_in_collision_world_[it->first] = table;
+    std::map<std::string, object_recognition_msgs::Table>::const_iterator previous = previous_tables.find(it->first);
+    if (previous != previous_tables.end() && sameTable(previous->second, table))
+      continue;
+
     moveit_msgs::CollisionObject co;
-    std::stringstream ss;
-    ss << "table_" << i;
-    co.id = ss.str();
-    current_tables_in_collision_world_[co.id] = table_array_.tables[i];
+    co.id = it->first;
     co.operation = moveit_msgs::CollisionObject::ADD;
 
-    const std::vector<geometry_msgs::Point>& convex_hull = table_array_.tables[i].convex_hull;
+    const std::vector<geometry_msgs::Point>& convex_hull = table.convex_hull;
+    if (convex_hull.size() < 3)
+      continue;
 
+    // triangulate the (convex) contour as a fan around its first vertex
     EigenSTL::vector_Vector3d vertices(convex_hull.size());
     std::vector<unsigned int> triangles((vertices.size() - 2) * 3);
     for (unsigned int j = 0; j < convex_hull.size(); ++j)
       vertices[j] = Eigen::Vector3d(convex_hull[j].x, convex_hull[j].y, convex_hull[j].z);
-    for (unsigned int j = 1; j < triangles.size() - 1; ++j)
+    for (unsigned int j = 1; j < vertices.size() - 1; ++j)
     {
-      unsigned int i3 = j * 3;
+      unsigned int i3 = (j - 1) * 3;
       triangles[i3++] = 0;
       triangles[i3++] = j;
       triangles[i3] = j + 1;
@@ -157,14 +222,14 @@ bool SemanticWorld::addTablesToCollisionWorld()
     const shape_msgs::Mesh& table_shape_msg_mesh = boost::get<shape_msgs::Mesh>(table_shape_msg);
 
     co.meshes.push_back(table_shape_msg_mesh);
-    co.mesh_poses.push_back(table_array_.tables[i].pose);
-    co.header = table_array_.tables[i].header;
+    co.mesh_poses.push_back(table.pose);
+    co.header = table.header;
     planning_scene.world.collision_objects.push_back(co);
-    //    collision_object_publisher_.publish(co);
     delete table_shape;
     delete table_mesh_solid;
   }
-  planning_scene_diff_publisher_.publish(planning_scene);
+  if (!planning_scene.world.collision_objects.empty())
+    planning_scene_diff_publisher_.publish(planning_scene);
   return true;
 }
 
@@ -310,38 +375,15 @@ std::vector<geometry_msgs::PoseStamped> SemanticWorld::generatePlacePoses(const
 {
   std::vector<geometry_msgs::PoseStamped> place_poses;
   // Assumption that the table's normal is along the Z axis
-  if (table.convex_hull.empty())
+  if (table.convex_hull.size() < 3)
     return place_poses;
-  const int scale_factor = 100;
-  std::vector<cv::Point2f> table_contour;
-  float x_min = table.convex_hull[0].x, x_max = x_min, y_min = table.convex_hull[0].y, y_max = y_min;
+  double x_min = table.convex_hull[0].x, x_max = x_min, y_min = table.convex_hull[0].y, y_max = y_min;
   for (std::size_t j = 1; j < table.convex_hull.size(); ++j)
   {
-    if (table.convex_hull[j].x < x_min)
-      x_min = table.convex_hull[j].x;
-    else if (table.convex_hull[j].x > x_max)
-      x_max = table.convex_hull[j].x;
-    if (table.convex_hull[j].y < y_min)
-      y_min = table.convex_hull[j].y;
-    else if (table.convex_hull[j].y > y_max)
-      y_max = table.convex_hull[j].y;
-  }
-  for (std::size_t j = 0; j < table.convex_hull.size(); ++j)
-    table_contour.push_back(
-        cv::Point((table.convex_hull[j].x - x_min) * scale_factor, (table.convex_hull[j].y - y_min) * scale_factor));
-
-  double x_range = fabs(x_max - x_min);
-  double y_range = fabs(y_max - y_min);
-  int max_range = (int)x_range + 1;
-  if (max_range < (int)y_range + 1)
-    max_range = (int)y_range + 1;
-
-  int image_scale = std::max<int>(max_range, 4);
-  cv::Mat src = cv::Mat::zeros(image_scale * scale_factor, image_scale * scale_factor, CV_8UC1);
-
-  for (std::size_t j = 0; j < table.convex_hull.size(); ++j)
-  {
-    cv::line(src, table_contour[j], table_contour[(j + 1) % table.convex_hull.size()], cv::Scalar(255), 3, 8);
+    x_min = std::min(x_min, table.convex_hull[j].x);
+    x_max = std::max(x_max, table.convex_hull[j].x);
+    y_min = std::min(y_min, table.convex_hull[j].y);
+    y_max = std::max(y_max, table.convex_hull[j].y);
   }
 
   unsigned int num_x = fabs(x_max - x_min) / resolution + 1;
@@ -349,35 +391,33 @@ std::vector<geometry_msgs::PoseStamped> SemanticWorld::generatePlacePoses(const
 
   ROS_DEBUG("Num points for possible place operations: %d %d", num_x, num_y);
 
-  std::vector<std::vector<cv::Point> > contours;
-  std::vector<cv::Vec4i> hierarchy;
-  cv::findContours(src, contours, hierarchy, cv::RETR_TREE, cv::CHAIN_APPROX_SIMPLE);
+  Eigen::Affine3d pose;
+  tf::poseMsgToEigen(table.pose, pose);
 
-  for (std::size_t j = 0; j < num_x; ++j)
+  // candidates are visited row by row; the crossings of a row with the contour tell which of its candidates are on
+  // the table, so only those need their distance to the edge computed
+  std::vector<double> crossings;
+  for (std::size_t k = 0; k < num_y; ++k)
   {
-    int point_x = j * resolution * scale_factor;
-    for (std::size_t k = 0; k < num_y; ++k)
+    double y = y_min + k * resolution;
+    contourCrossings(table.convex_hull, y, crossings);
+    if (crossings.empty())
+      continue;
+    for (std::size_t j = 0; j < num_x; ++j)
     {
+      double x = x_min + j * resolution;
+      if (!insideCrossings(crossings, x) || distanceToContour(table.convex_hull, x, y) < min_distance_from_edge)
+        continue;
       for (std::size_t mm = 0; mm < num_heights; ++mm)
       {
-        int point_y = k * resolution * scale_factor;
-        cv::Point2f point2f(point_x, point_y);
-        double result = cv::pointPolygonTest(contours[0], point2f, true);
-        if ((int)result >= (int)(min_distance_from_edge * scale_factor))
-        {
-          Eigen::Vector3d point((double)(point_x) / scale_factor + x_min, (double)(point_y) / scale_factor + y_min,
-                                height_above_table + mm * delta_height);
-          Eigen::Affine3d pose;
-          tf::poseMsgToEigen(table.pose, pose);
-          point = pose * point;
-          geometry_msgs::PoseStamped place_pose;
-          place_pose.pose.orientation.w = 1.0;
-          place_pose.pose.position.x = point.x();
-          place_pose.pose.position.y = point.y();
-          place_pose.pose.position.z = point.z();
-          place_pose.header = table.header;
-          place_poses.push_back(place_pose);
-        }
+        Eigen::Vector3d point = pose * Eigen::Vector3d(x, y, height_above_table + mm * delta_height);
+        geometry_msgs::PoseStamped place_pose;
+        place_pose.pose.orientation.w = 1.0;
+        place_pose.pose.position.x = point.x();
+        place_pose.pose.position.y = point.y();
+        place_pose.pose.position.z = point.z();
+        place_pose.header = table.header;
+        place_poses.push_back(place_pose);
       }
     }
   }
@@ -388,43 +428,8 @@ bool SemanticWorld::isInsideTableContour(const geometry_msgs::Pose& pose, const
                                          double min_distance_from_edge, double min_vertical_offset) const
 {
   // Assumption that the table's normal is along the Z axis
-  if (table.convex_hull.empty())
+  if (table.convex_hull.size() < 3)
     return false;
-  float x_min = table.convex_hull[0].x, x_max = x_min, y_min = table.convex_hull[0].y, y_max = y_min;
-  for (std::size_t j = 1; j < table.convex_hull.size(); ++j)
-  {
-    if (table.convex_hull[j].x < x_min)
-      x_min = table.convex_hull[j].x;
-    else if (table.convex_hull[j].x > x_max)
-      x_max = table.convex_hull[j].x;
-    if (table.convex_hull[j].y < y_min)
-      y_min = table.convex_hull[j].y;
-    else if (table.convex_hull[j].y > y_max)
-      y_max = table.convex_hull[j].y;
-  }
-  const int scale_factor = 100;
-  std::vector<cv::Point2f> table_contour;
-  for (std::size_t j = 0; j < table.convex_hull.size(); ++j)
-    table_contour.push_back(
-        cv::Point((table.convex_hull[j].x - x_min) * scale_factor, (table.convex_hull[j].y - y_min) * scale_factor));
-
-  double x_range = fabs(x_max - x_min);
-  double y_range = fabs(y_max - y_min);
-  int max_range = (int)x_range + 1;
-  if (max_range < (int)y_range + 1)
-    max_range = (int)y_range + 1;
-
-  int image_scale = std::max<int>(max_range, 4);
-  cv::Mat src = cv::Mat::zeros(image_scale * scale_factor, image_scale * scale_factor, CV_8UC1);
-
-  for (std::size_t j = 0; j < table.convex_hull.size(); ++j)
-  {
-    cv::line(src, table_contour[j], table_contour[(j + 1) % table.convex_hull.size()], cv::Scalar(255), 3, 8);
-  }
-
-  std::vector<std::vector<cv::Point> > contours;
-  std::vector<cv::Vec4i> hierarchy;
-  cv::findContours(src, contours, hierarchy, cv::RETR_TREE, cv::CHAIN_APPROX_SIMPLE);
 
   Eigen::Vector3d point(pose.position.x, pose.position.y, pose.position.z);
   Eigen::Affine3d pose_table;
@@ -439,16 +444,14 @@ bool SemanticWorld::isInsideTableContour(const geometry_msgs::Pose& pose, const
     return false;
   }
 
-  int point_x = (point.x() - x_min) * scale_factor;
-  int point_y = (point.y() - y_min) * scale_factor;
-  cv::Point2f point2f(point_x, point_y);
-  double result = cv::pointPolygonTest(contours[0], point2f, true);
+  std::vector<double> crossings;
+  contourCrossings(table.convex_hull, point.y(), crossings);
+  if (!insideCrossings(crossings, point.x()))
+    return false;
+  double result = distanceToContour(table.convex_hull, point.x(), point.y());
   ROS_DEBUG("table distance: %f", result);
 
-  if ((int)result >= (int)(min_distance_from_edge * scale_factor))
-    return true;
-
-  return false;
+  return result >= min_distance_from_edge;
 }
 
 std::string SemanticWorld::findObjectTable(const geometry_msgs::Pose& pose, double min_distance_from_edge,
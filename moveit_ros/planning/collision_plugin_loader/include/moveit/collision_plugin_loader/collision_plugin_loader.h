@@ -50,7 +50,10 @@ public:
   CollisionPluginLoader();
   ~CollisionPluginLoader();
 
-  /** @brief This can be called on a new planning scene to setup the collision detector. */
+  /** @brief This can be called on a new planning scene to setup the collision detector.
+   *
+   * The active detector is read from the \e collision_detector parameter. Plugins listed in
+   * \e additional_collision_detectors are added as well, so they can be selected by name later on. */
   void setupScene(ros::NodeHandle& nh, const planning_scene::PlanningScenePtr& scene);
 
   /**
@@ -137,7 +137,27 @@ void CollisionPluginLoader::setupScene(ros::NodeHandle& nh, const planning_scene
   }
 
   activate(collision_detector_name, scene, true);
-  ROS_INFO_STREAM("Using collision detector:" << scene->getActiveCollisionDetectorName().c_str());
+  const std::string active_name = scene->getActiveCollisionDetectorName();
+  ROS_INFO_STREAM("Using collision detector:" << active_name.c_str());
+
+  // Further detectors are kept up to date next to the active one, all observing the same world, so individual
+  // planners can select them (e.g. a cheaper approximate checker while exploring)
+  std::vector<std::string> additional_names;
+  if (nh.searchParam("additional_collision_detectors", param_name))
+    nh.getParam(param_name, additional_names);
+  else if (nh.hasParam("/move_group/additional_collision_detectors"))
+    nh.getParam("/move_group/additional_collision_detectors", additional_names);
+  for (std::size_t i = 0; i < additional_names.size(); ++i)
+  {
+    if (additional_names[i].empty() || additional_names[i] == collision_detector_name)
+      continue;
+    if (activate(additional_names[i], scene, false))
+      ROS_INFO_STREAM("Maintaining additional collision detector: " << additional_names[i]);
+    else
+      ROS_ERROR_STREAM("Unable to add collision detector '" << additional_names[i] << "'");
+  }
+  // adding a detector also makes it the active one
+  scene->setActiveCollisionDetector(active_name);
 }
 
 }  // namespace collision_detection
@@ -139,14 +139,16 @@ public:
           possible_kinematics_solvers_.find(jmg->getName());
       if (it != possible_kinematics_solvers_.end())
       {
-        // just to be sure, do not call the same pluginlib instance allocation function in parallel
-        boost::mutex::scoped_lock slock(lock_);
-
         for (std::size_t i = 0; !result && i < it->second.size(); ++i)
         {
           try
           {
-            result = kinematics_loader_->createUniqueInstance(it->second[i]);
+            {
+              // just to be sure, do not call the same pluginlib instance allocation function in parallel;
+              // initialize() below is potentially slow and runs without the lock, so groups can load in parallel
+              boost::mutex::scoped_lock slock(lock_);
+              result = kinematics_loader_->createUniqueInstance(it->second[i]);
+            }
             if (result)
             {
               const std::vector<const robot_model::LinkModel*>& links = jmg->getLinkModels();
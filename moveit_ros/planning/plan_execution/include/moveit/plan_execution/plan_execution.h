@@ -55,7 +55,12 @@ class PlanExecution
 public:
   struct Options
   {
-    Options() : replan_(false), replan_attempts_(0), replan_delay_(0.0)
+    Options()
+      : replan_(false)
+      , replan_attempts_(0)
+      , replan_delay_(0.0)
+      , repair_velocity_scaling_factor_(1.0)
+      , repair_acceleration_scaling_factor_(1.0)
     {
     }
 
@@ -84,6 +89,14 @@ public:
     boost::function<bool(ExecutableMotionPlan& plan_to_update, const std::pair<int, int>& trajectory_index)>
         repair_plan_callback_;
 
+    /// Callback for computing a path between two states, used to repair plans locally (see
+    /// PlanExecution::setLocalRepair()). This is optional; without it, invalidated plans are always re-planned.
+    ExecutableMotionPlanSegmentComputationFn plan_segment_callback_;
+
+    /// The scaling factors applied when a locally repaired trajectory is time parameterized again
+    double repair_velocity_scaling_factor_;
+    double repair_acceleration_scaling_factor_;
+
     boost::function<void()> before_plan_callback_;
     boost::function<void()> before_execution_callback_;
     boost::function<void()> done_callback_;
@@ -127,6 +140,35 @@ public:
     return default_max_replan_attempts_;
   }
 
+  /** \brief While a trajectory is executed, continuously check the part of it that will be executed within the next
+      \e look_ahead_time seconds for collisions with the current scene, and stop the execution (which triggers
+      replanning, if allowed) as soon as that part becomes invalid. Waypoints are checked once when they enter the
+      window and again whenever the scene changes. A value of 0 (the default) disables the look-ahead check; the
+      remaining path is then only re-validated as a whole after scene updates. */
+  void setLookAheadTime(double look_ahead_time)
+  {
+    look_ahead_time_ = look_ahead_time > 0.0 ? look_ahead_time : 0.0;
+  }
+
+  double getLookAheadTime() const
+  {
+    return look_ahead_time_;
+  }
+
+  /** \brief When the path of a single-component plan becomes invalid during execution and the options specify a
+      plan_segment_callback_, re-plan only from the last valid waypoint before the invalid part to the first valid
+      waypoint after it, and splice the result into the rest of the old path. The full re-planning callbacks are
+      used when no such repair is found. Disabled by default. */
+  void setLocalRepair(bool flag)
+  {
+    local_repair_ = flag;
+  }
+
+  bool getLocalRepair() const
+  {
+    return local_repair_;
+  }
+
   void planAndExecute(ExecutableMotionPlan& plan, const Options& opt);
   void planAndExecute(ExecutableMotionPlan& plan, const moveit_msgs::PlanningScene& scene_diff, const Options& opt);
 
@@ -144,6 +186,18 @@ private:
   void planAndExecuteHelper(ExecutableMotionPlan& plan, const Options& opt);
   bool isRemainingPathValid(const ExecutableMotionPlan& plan);
   bool isRemainingPathValid(const ExecutableMotionPlan& plan, const std::pair<int, int>& path_segment);
+  bool isLookAheadPathValid(const ExecutableMotionPlan& plan, bool scene_changed);
+
+  /** \brief Check the waypoints [\e begin, \e end) of the trajectory of plan component \e component */
+  bool isPathSegmentValid(const ExecutableMotionPlan& plan, std::size_t component, std::size_t begin,
+                          std::size_t end);
+
+  /** \brief Check waypoint \e index of the trajectory of plan component \e component; the scene must be locked */
+  bool isWayPointValid(const ExecutableMotionPlan& plan, std::size_t component, std::size_t index,
+                       bool verbose) const;
+
+  /** \brief Splice a re-planned segment around the invalid waypoint found during the last execution into the plan */
+  bool repairPlanLocally(ExecutableMotionPlan& plan, const Options& opt);
 
   void planningSceneUpdatedCallback(const planning_scene_monitor::PlanningSceneMonitor::SceneUpdateType update_type);
   void doneWithTrajectoryExecution(const moveit_controller_manager::ExecutionStatus& status);
@@ -159,9 +213,18 @@ private:
   bool preempt_requested_;
   bool new_scene_update_;
 
+  double look_ahead_time_;
+  bool look_ahead_scene_update_;
+  int look_ahead_component_;            // plan component the look-ahead window was last checked in
+  std::size_t look_ahead_checked_end_;  // waypoints before this index were checked against the current scene
+
   bool execution_complete_;
   bool path_became_invalid_;
 
+  bool local_repair_;
+  std::pair<int, int> invalid_waypoint_;  // (component, waypoint) found invalid during the last execution
+  std::pair<int, int> stopped_index_;     // expected trajectory index when the last execution was stopped
+
   class DynamicReconfigureImpl;
   DynamicReconfigureImpl* reconfigure_impl_;
 };
@@ -82,5 +82,11 @@ struct ExecutableMotionPlan
 
 /// The signature of a function that can compute a motion plan
 typedef boost::function<bool(ExecutableMotionPlan& plan)> ExecutableMotionPlanComputationFn;
+
+/// The signature of a function that can compute a path for the group of \e segment (which is already allocated)
+/// from \e start to \e goal, in the planning scene of \e plan
+typedef boost::function<bool(const ExecutableMotionPlan& plan, const robot_state::RobotState& start,
+                             const robot_state::RobotState& goal, robot_trajectory::RobotTrajectory& segment)>
+    ExecutableMotionPlanSegmentComputationFn;
 }
 #endif
@@ -38,6 +38,7 @@
 #include <moveit/robot_state/conversions.h>
 #include <moveit/trajectory_processing/trajectory_tools.h>
 #include <moveit/collision_detection/collision_tools.h>
+#include <moveit/trajectory_processing/iterative_time_parameterization.h>
 #include <boost/algorithm/string/join.hpp>
 
 #include <dynamic_reconfigure/server.h>
@@ -62,6 +63,8 @@ private:
   {
     owner_->setMaxReplanAttempts(config.max_replan_attempts);
     owner_->setTrajectoryStateRecordingFrequency(config.record_trajectory_state_frequency);
+    owner_->setLookAheadTime(config.look_ahead_time);
+    owner_->setLocalRepair(config.local_repair);
   }
 
   PlanExecution* owner_;
@@ -85,6 +88,15 @@ plan_execution::PlanExecution::PlanExecution(
   preempt_requested_ = false;
   new_scene_update_ = false;
 
+  look_ahead_time_ = 0.0;
+  look_ahead_scene_update_ = false;
+  look_ahead_component_ = -1;
+  look_ahead_checked_end_ = 0;
+
+  local_repair_ = false;
+  invalid_waypoint_ = std::make_pair(-1, -1);
+  stopped_index_ = std::make_pair(-1, -1);
+
   // we want to be notified when new information is available
   planning_scene_monitor_->addUpdateCallback(boost::bind(&PlanExecution::planningSceneUpdatedCallback, this, _1));
 
@@ -182,11 +194,14 @@ void plan_execution::PlanExecution::planAndExecuteHelper(ExecutableMotionPlan& p
                                 // plan, which should consider most recent updates already
 
     // if we never had a solved plan, or there is no specified way of fixing plans, just call the planner; otherwise,
-    // try to repair the plan we previously had;
-    bool solved =
-        (!previously_solved || !opt.repair_plan_callback_) ?
-            opt.plan_callback_(plan) :
-            opt.repair_plan_callback_(plan, trajectory_execution_manager_->getCurrentExpectedTrajectoryIndex());
+    // try to repair the plan we previously had, first locally around the invalid part if that is enabled
+    bool solved;
+    if (previously_solved && local_repair_ && opt.plan_segment_callback_ && repairPlanLocally(plan, opt))
+      solved = true;
+    else
+      solved = (!previously_solved || !opt.repair_plan_callback_) ?
+                   opt.plan_callback_(plan) :
+                   opt.repair_plan_callback_(plan, trajectory_execution_manager_->getCurrentExpectedTrajectoryIndex());
 
     if (preempt_requested_)
       break;
@@ -275,42 +290,146 @@ bool plan_execution::PlanExecution::isRemainingPathValid(const ExecutableMotionP
       plan.plan_components_[path_segment.first].trajectory_monitoring_)  // If path_segment.second <= 0, the function
                                                                          // will fallback to check the entire trajectory
   {
-    planning_scene_monitor::LockedPlanningSceneRO lscene(plan.planning_scene_monitor_);  // lock the scene so that it
-                                                                                         // does not modify the world
-                                                                                         // representation while
-                                                                                         // isStateValid() is called
     const robot_trajectory::RobotTrajectory& t = *plan.plan_components_[path_segment.first].trajectory_;
-    const collision_detection::AllowedCollisionMatrix* acm =
-        plan.plan_components_[path_segment.first].allowed_collision_matrix_.get();
-    std::size_t wpc = t.getWayPointCount();
-    collision_detection::CollisionRequest req;
-    req.group_name = t.getGroupName();
-    for (std::size_t i = std::max(path_segment.second - 1, 0); i < wpc; ++i)
-    {
-      collision_detection::CollisionResult res;
-      if (acm)
-        plan.planning_scene_->checkCollisionUnpadded(req, res, t.getWayPoint(i), *acm);
-      else
-        plan.planning_scene_->checkCollisionUnpadded(req, res, t.getWayPoint(i));
+    return isPathSegmentValid(plan, path_segment.first, std::max(path_segment.second - 1, 0), t.getWayPointCount());
+  }
+  return true;
+}
 
-      if (res.collision || !plan.planning_scene_->isStateFeasible(t.getWayPoint(i), false))
-      {
-        // Dave's debacle
-        ROS_INFO_NAMED("plan_execution", "Trajectory component '%s' is invalid",
-                       plan.plan_components_[path_segment.first].description_.c_str());
-
-        // call the same functions again, in verbose mode, to show what issues have been detected
-        plan.planning_scene_->isStateFeasible(t.getWayPoint(i), true);
-        req.verbose = true;
-        res.clear();
-        if (acm)
-          plan.planning_scene_->checkCollisionUnpadded(req, res, t.getWayPoint(i), *acm);
-        else
-          plan.planning_scene_->checkCollisionUnpadded(req, res, t.getWayPoint(i));
-        return false;
-      }
+bool plan_execution::PlanExecution::isLookAheadPathValid(const ExecutableMotionPlan& plan, bool scene_changed)
+{
+  const std::pair<int, int> index = trajectory_execution_manager_->getCurrentExpectedTrajectoryIndex();
+  if (index.first < 0 || index.first >= static_cast<int>(plan.plan_components_.size()) ||
+      !plan.plan_components_[index.first].trajectory_monitoring_ || !plan.plan_components_[index.first].trajectory_)
+    return true;
+  const robot_trajectory::RobotTrajectory& t = *plan.plan_components_[index.first].trajectory_;
+
+  // the window starts at the segment being executed and ends with the first waypoint beyond the look-ahead time
+  const std::size_t wpc = t.getWayPointCount();
+  const std::size_t begin = std::max(index.second - 1, 0);
+  std::size_t end = std::min(begin + 1, wpc);
+  for (double duration = 0.0; end < wpc && duration < look_ahead_time_; ++end)
+    duration += t.getWayPointDurationFromPrevious(end);
+
+  // waypoints that were already checked against the current scene are not checked again
+  if (scene_changed || index.first != look_ahead_component_)
+  {
+    look_ahead_component_ = index.first;
+    look_ahead_checked_end_ = begin;
+  }
+  const std::size_t from = std::max(begin, look_ahead_checked_end_);
+  if (from >= end)
+    return true;
+  if (!isPathSegmentValid(plan, index.first, from, end))
+    return false;
+  look_ahead_checked_end_ = end;
+  return true;
+}
+
+bool plan_execution::PlanExecution::isPathSegmentValid(const ExecutableMotionPlan& plan, std::size_t component,
+                                                       std::size_t begin, std::size_t end)
+{
+  planning_scene_monitor::LockedPlanningSceneRO lscene(plan.planning_scene_monitor_);  // lock the scene so that it
+                                                                                       // does not modify the world
+                                                                                       // representation while
+                                                                                       // isStateValid() is called
+  for (std::size_t i = begin; i < end; ++i)
+    if (!isWayPointValid(plan, component, i, false))
+    {
+      // Dave's debacle
+      ROS_INFO_NAMED("plan_execution", "Trajectory component '%s' is invalid",
+                     plan.plan_components_[component].description_.c_str());
+      invalid_waypoint_ = std::make_pair(static_cast<int>(component), static_cast<int>(i));
+
+      // call the same functions again, in verbose mode, to show what issues have been detected
+      isWayPointValid(plan, component, i, true);
+      return false;
     }
+  return true;
+}
+
+bool plan_execution::PlanExecution::isWayPointValid(const ExecutableMotionPlan& plan, std::size_t component,
+                                                    std::size_t index, bool verbose) const
+{
+  const robot_trajectory::RobotTrajectory& t = *plan.plan_components_[component].trajectory_;
+  const collision_detection::AllowedCollisionMatrix* acm =
+      plan.plan_components_[component].allowed_collision_matrix_.get();
+  collision_detection::CollisionRequest req;
+  req.group_name = t.getGroupName();
+  req.verbose = verbose;
+  collision_detection::CollisionResult res;
+  if (acm)
+    plan.planning_scene_->checkCollisionUnpadded(req, res, t.getWayPoint(index), *acm);
+  else
+    plan.planning_scene_->checkCollisionUnpadded(req, res, t.getWayPoint(index));
+  // in verbose mode both checks run, so all detected issues are reported
+  if (res.collision && !verbose)
+    return false;
+  return plan.planning_scene_->isStateFeasible(t.getWayPoint(index), verbose) && !res.collision;
+}
+
+bool plan_execution::PlanExecution::repairPlanLocally(ExecutableMotionPlan& plan, const Options& opt)
+{
+  // components after the first may depend on the side effects of earlier ones, so only single paths are repaired
+  if (plan.plan_components_.size() != 1 || invalid_waypoint_.first != 0 || !plan.plan_components_[0].trajectory_ ||
+      !planning_scene_monitor_->getStateMonitor())
+    return false;
+  const robot_trajectory::RobotTrajectory& old_path = *plan.plan_components_[0].trajectory_;
+  const std::size_t wpc = old_path.getWayPointCount();
+  const std::size_t stopped = stopped_index_.first == 0 ? std::max(stopped_index_.second, 0) : 0;
+  std::size_t invalid = std::max<std::size_t>(invalid_waypoint_.second, stopped + 1);
+  std::size_t rejoin = invalid + 1;
+  {
+    planning_scene_monitor::LockedPlanningSceneRO lscene(plan.planning_scene_monitor_);
+    // the waypoints up to the invalid one are reused, unless the scene has changed in the meantime
+    for (std::size_t i = stopped + 1; i < invalid && i < wpc; ++i)
+      if (!isWayPointValid(plan, 0, i, false))
+        invalid = i;
+    // the new segment rejoins the old path at the first valid waypoint after the invalid one
+    while (rejoin < wpc && !isWayPointValid(plan, 0, rejoin, false))
+      ++rejoin;
+  }
+  if (rejoin >= wpc)
+  {
+    ROS_INFO_NAMED("plan_execution", "No valid waypoint after the invalid part of the path; re-planning completely");
+    return false;
+  }
+
+  robot_state::RobotStatePtr current_state = planning_scene_monitor_->getStateMonitor()->getCurrentState();
+  const robot_state::RobotState& segment_start = invalid > stopped + 1 ? old_path.getWayPoint(invalid - 1) :
+                                                                         *current_state;
+  ROS_INFO_NAMED("plan_execution", "Re-planning the path locally, from waypoint %u to waypoint %u of %u",
+                 static_cast<unsigned int>(invalid > stopped + 1 ? invalid - 1 : stopped),
+                 static_cast<unsigned int>(rejoin), static_cast<unsigned int>(wpc));
+  robot_trajectory::RobotTrajectory segment(old_path.getRobotModel(), old_path.getGroup());
+  if (!opt.plan_segment_callback_(plan, segment_start, old_path.getWayPoint(rejoin), segment) || segment.empty())
+  {
+    ROS_INFO_NAMED("plan_execution", "Local re-planning failed");
+    return false;
+  }
+
+  // current state, reused prefix, new segment (without its first waypoint, which is the end of the prefix), and the
+  // rest of the old path (without the rejoin waypoint, which ends the new segment)
+  robot_trajectory::RobotTrajectoryPtr path(
+      new robot_trajectory::RobotTrajectory(old_path.getRobotModel(), old_path.getGroup()));
+  path->addSuffixWayPoint(*current_state, 0.0);
+  for (std::size_t i = stopped + 1; i < invalid; ++i)
+    path->addSuffixWayPoint(old_path.getWayPoint(i), 0.0);
+  for (std::size_t i = 1; i < segment.getWayPointCount(); ++i)
+    path->addSuffixWayPoint(segment.getWayPoint(i), 0.0);
+  for (std::size_t i = rejoin + 1; i < wpc; ++i)
+    path->addSuffixWayPoint(old_path.getWayPoint(i), 0.0);
+
+  trajectory_processing::IterativeParabolicTimeParameterization time_param;
+  if (!time_param.computeTimeStamps(*path, opt.repair_velocity_scaling_factor_,
+                                    opt.repair_acceleration_scaling_factor_))
+  {
+    ROS_WARN_NAMED("plan_execution", "Unable to time parameterize the locally repaired path");
+    return false;
   }
+
+  plan.plan_components_[0].trajectory_ = path;
+  plan.error_code_.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
   return true;
 }
 
@@ -405,9 +524,23 @@ moveit_msgs::MoveItErrorCodes plan_execution::PlanExecution::executeAndMonitor(E
   // wait for path to be done, while checking that the path does not become invalid
   ros::Rate r(100);
   path_became_invalid_ = false;
+  invalid_waypoint_ = std::make_pair(-1, -1);
+  stopped_index_ = std::make_pair(-1, -1);
+  look_ahead_component_ = -1;
   while (node_handle_.ok() && !execution_complete_ && !preempt_requested_ && !path_became_invalid_)
   {
     r.sleep();
+    // the part of the path about to be executed is checked first, so new obstacles are detected with bounded latency
+    if (look_ahead_time_ > 0.0)
+    {
+      bool scene_changed = look_ahead_scene_update_;
+      look_ahead_scene_update_ = false;
+      if (!isLookAheadPathValid(plan, scene_changed))
+      {
+        path_became_invalid_ = true;
+        break;
+      }
+    }
     // check the path if there was an environment update in the meantime
     if (new_scene_update_)
     {
@@ -430,6 +563,7 @@ moveit_msgs::MoveItErrorCodes plan_execution::PlanExecution::executeAndMonitor(E
   {
     ROS_INFO_NAMED("plan_execution", "Stopping execution because the path to execute became invalid"
                                      "(probably the environment changed)");
+    stopped_index_ = trajectory_execution_manager_->getCurrentExpectedTrajectoryIndex();
     trajectory_execution_manager_->stopExecution();
   }
   else if (!execution_complete_)
@@ -472,7 +606,10 @@ void plan_execution::PlanExecution::planningSceneUpdatedCallback(
 {
   if (update_type & (planning_scene_monitor::PlanningSceneMonitor::UPDATE_GEOMETRY |
                      planning_scene_monitor::PlanningSceneMonitor::UPDATE_TRANSFORMS))
+  {
     new_scene_update_ = true;
+    look_ahead_scene_update_ = true;
+  }
 }
 
 void plan_execution::PlanExecution::doneWithTrajectoryExecution(
@@ -0,0 +1,103 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/robot_model_loader/robot_model_loader.h>
+#include <moveit/reachability_map/reachability_map.h>
+#include <boost/lexical_cast.hpp>
+#include <ros/ros.h>
+
+static const std::string ROBOT_DESCRIPTION = "robot_description";
+
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "build_reachability_map");
+
+  ros::AsyncSpinner spinner(1);
+  spinner.start();
+
+  if (argc <= 2)
+    ROS_ERROR("Usage: %s <group> <output file> [resolution = 0.05] [samples = 1000000] [roll steps = 4]", argv[0]);
+  else
+  {
+    double resolution = 0.05;
+    std::size_t samples = 1000000;
+    unsigned int roll_steps = 4;
+    try
+    {
+      if (argc > 3)
+        resolution = boost::lexical_cast<double>(argv[3]);
+      if (argc > 4)
+        samples = boost::lexical_cast<std::size_t>(argv[4]);
+      if (argc > 5)
+        roll_steps = boost::lexical_cast<unsigned int>(argv[5]);
+    }
+    catch (boost::bad_lexical_cast& ex)
+    {
+      ROS_ERROR("Invalid argument: %s", ex.what());
+      ros::shutdown();
+      return 1;
+    }
+
+    robot_model_loader::RobotModelLoader rml(ROBOT_DESCRIPTION);
+    const robot_model::JointModelGroup* jmg = rml.getModel()->getJointModelGroup(argv[1]);
+    reachability_map::ReachabilityMapPtr map;
+    if (jmg)
+      map = reachability_map::ReachabilityMap::create(jmg, resolution);
+    if (map)
+    {
+      robot_state::RobotState state(rml.getModel());
+      state.setToDefaultValues();
+      ROS_INFO("Mapping poses of '%s' relative to '%s' on a %u x %u x %u grid", map->getTipLink().c_str(),
+               map->getBaseLink().c_str(), map->getCellCount(0), map->getCellCount(1), map->getCellCount(2));
+
+      ros::WallTime start = ros::WallTime::now();
+      map->sample(state, samples);
+      ROS_INFO("Sampled %u configurations in %lf s", (unsigned int)samples, (ros::WallTime::now() - start).toSec());
+      if (roll_steps > 0 && jmg->getSolverInstance())
+      {
+        start = ros::WallTime::now();
+        map->solve(state, roll_steps);
+        ROS_INFO("Completed the map with IK in %lf s", (ros::WallTime::now() - start).toSec());
+      }
+      if (map->save(argv[2]))
+        ROS_INFO("Saved reachability map to '%s'", argv[2]);
+    }
+    else
+      ROS_ERROR("Unable to create a reachability map for group '%s'", argv[1]);
+  }
+
+  ros::shutdown();
+  return 0;
+}
@@ -0,0 +1,389 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/robot_model_loader/robot_model_loader.h>
+#include <moveit/kinematics_plugin_loader/kinematics_plugin_loader.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/trajectory_processing/iterative_time_parameterization.h>
+#include <geometric_shapes/shapes.h>
+#include <octomap/octomap.h>
+#include <random_numbers/random_numbers.h>
+#include <ros/package.h>
+#include <ros/ros.h>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <numeric>
+
+/* Microbenchmarks of the hot paths used by planning: forward kinematics, collision checking (self, against an
+   octomap, distance queries), inverse kinematics and time parameterization. All random input is drawn from
+   generators with a fixed seed, so two runs on the same robot measure the same work; results are written as JSON
+   to allow tracking regressions between builds. */
+
+static const std::string LOGNAME = "microbenchmarks";
+
+namespace
+{
+struct BenchmarkResult
+{
+  std::string name;
+  std::vector<double> samples;  // duration of each iteration in microseconds
+  std::map<std::string, double> extra;
+  std::string skipped;  // reason for skipping the benchmark, if it was not run
+};
+
+struct StandardRobot
+{
+  const char* name;
+  const char* urdf;
+  const char* srdf;
+  const char* group;
+};
+
+// robots from moveit_resources
+const StandardRobot STANDARD_ROBOTS[] = {
+  { "pr2", "pr2_description/urdf/robot.xml", "pr2_description/srdf/robot.xml", "right_arm" },
+  { "fanuc", "fanuc_description/urdf/fanuc.urdf", "fanuc_moveit_config/config/fanuc.srdf", "manipulator" },
+  { "panda", "panda_description/urdf/panda.urdf", "panda_moveit_config/config/panda.srdf", "panda_arm" },
+};
+
+bool readFile(const std::string& path, std::string& content)
+{
+  std::ifstream file(path.c_str());
+  if (!file.good())
+    return false;
+  content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  return true;
+}
+
+/** Time fn(i) for iteration i = 0 .. iterations - 1 */
+template <typename Fn>
+void measure(BenchmarkResult& result, unsigned int iterations, const Fn& fn)
+{
+  result.samples.reserve(iterations);
+  for (unsigned int i = 0; i < iterations; ++i)
+  {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    fn(i);
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    result.samples.push_back(elapsed.count());
+  }
+}
+
+std::vector<robot_state::RobotState> sampleStates(const robot_model::RobotModelConstPtr& model, unsigned int count,
+                                                  random_numbers::RandomNumberGenerator& rng)
+{
+  std::vector<robot_state::RobotState> states(count, robot_state::RobotState(model));
+  std::vector<double> values(model->getVariableCount());
+  for (robot_state::RobotState& state : states)
+  {
+    // RobotState::setToRandomPositions() uses an unseeded generator, so sample through the model
+    model->getVariableRandomPositions(rng, values);
+    state.setVariablePositions(values);
+    state.update();
+  }
+  return states;
+}
+
+void fillOctomap(planning_scene::PlanningScene& scene, unsigned int points, random_numbers::RandomNumberGenerator& rng)
+{
+  std::shared_ptr<octomap::OcTree> tree(new octomap::OcTree(0.02));
+  for (unsigned int i = 0; i < points; ++i)
+    tree->updateNode(octomap::point3d(rng.uniformReal(-1.5, 1.5), rng.uniformReal(-1.5, 1.5), rng.uniformReal(0, 2)),
+                     true);
+  tree->updateInnerOccupancy();
+  scene.getWorldNonConst()->addToObject(planning_scene::PlanningScene::OCTOMAP_NS,
+                                        shapes::ShapeConstPtr(new shapes::OcTree(tree)), Eigen::Affine3d::Identity());
+}
+
+void writeJSONString(std::ostream& out, const std::string& s)
+{
+  out << '"';
+  for (char c : s)
+    if (c == '"' || c == '\\')
+      out << '\\' << c;
+    else if (c == '\n')
+      out << "\\n";
+    else
+      out << c;
+  out << '"';
+}
+
+void writeJSON(std::ostream& out, const std::string& robot, unsigned int seed,
+               const std::vector<BenchmarkResult>& results)
+{
+  out << "{\n  \"robot\": ";
+  writeJSONString(out, robot);
+  out << ",\n  \"seed\": " << seed << ",\n  \"benchmarks\": [";
+  for (std::size_t i = 0; i < results.size(); ++i)
+  {
+    const BenchmarkResult& r = results[i];
+    out << (i ? ",\n" : "\n") << "    { \"name\": ";
+    writeJSONString(out, r.name);
+    if (!r.skipped.empty())
+    {
+      out << ", \"skipped\": ";
+      writeJSONString(out, r.skipped);
+    }
+    else
+    {
+      std::vector<double> sorted = r.samples;
+      std::sort(sorted.begin(), sorted.end());
+      const double mean = std::accumulate(sorted.begin(), sorted.end(), 0.0) / std::max<std::size_t>(1, sorted.size());
+      out << ", \"iterations\": " << sorted.size() << ", \"mean_us\": " << mean;
+      if (!sorted.empty())
+        out << ", \"min_us\": " << sorted.front() << ", \"median_us\": " << sorted[sorted.size() / 2]
+            << ", \"p95_us\": " << sorted[std::min(sorted.size() - 1, sorted.size() * 95 / 100)]
+            << ", \"max_us\": " << sorted.back();
+    }
+    for (const std::pair<const std::string, double>& e : r.extra)
+    {
+      out << ", ";
+      writeJSONString(out, e.first);
+      out << ": " << e.second;
+    }
+    out << " }";
+  }
+  out << "\n  ]\n}\n";
+}
+}
+
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "run_microbenchmarks");
+
+  std::string robot = "pr2";
+  std::string robot_description;
+  std::string group;
+  std::string ik_plugin = "kdl_kinematics_plugin/KDLKinematicsPlugin";
+  std::string output;
+  unsigned int seed = 42;
+  unsigned int iterations = 1000;
+  unsigned int octomap_points = 20000;
+
+  boost::program_options::options_description desc;
+  desc.add_options()("help", "this screen")(
+      "robot", boost::program_options::value<std::string>(&robot)->default_value(robot),
+      "Standard robot from moveit_resources: pr2, fanuc or panda")(
+      "robot_description", boost::program_options::value<std::string>(&robot_description),
+      "Use the robot (and its kinematics configuration) from this ROS parameter instead of a standard robot")(
+      "group", boost::program_options::value<std::string>(&group),
+      "Group for the IK and time parameterization benchmarks (the standard robot's arm by default)")(
+      "ik_plugin", boost::program_options::value<std::string>(&ik_plugin)->default_value(ik_plugin),
+      "IK solver used for standard robots")(
+      "seed", boost::program_options::value<unsigned int>(&seed)->default_value(seed), "Seed of all random input")(
+      "iterations", boost::program_options::value<unsigned int>(&iterations)->default_value(iterations),
+      "Iterations of each benchmark")(
+      "octomap_points", boost::program_options::value<unsigned int>(&octomap_points)->default_value(octomap_points),
+      "Number of occupied points in the octomap")(
+      "output", boost::program_options::value<std::string>(&output), "Write the JSON results to this file");
+  boost::program_options::variables_map vm;
+  boost::program_options::store(boost::program_options::parse_command_line(argc, argv, desc), vm);
+  boost::program_options::notify(vm);
+  if (vm.count("help"))
+  {
+    std::cout << desc << std::endl;
+    return 0;
+  }
+
+  ros::AsyncSpinner spinner(1);
+  spinner.start();
+
+  robot_model_loader::RobotModelLoaderPtr rml;
+  if (robot_description.empty())
+  {
+    const StandardRobot* standard = NULL;
+    for (const StandardRobot& r : STANDARD_ROBOTS)
+      if (robot == r.name)
+        standard = &r;
+    if (!standard)
+    {
+      ROS_ERROR_NAMED(LOGNAME, "Unknown robot '%s'", robot.c_str());
+      return 1;
+    }
+    const std::string resources = ros::package::getPath("moveit_resources");
+    std::string urdf, srdf;
+    if (!readFile(resources + "/" + standard->urdf, urdf) || !readFile(resources + "/" + standard->srdf, srdf))
+    {
+      ROS_ERROR_NAMED(LOGNAME, "Robot '%s' is not available in moveit_resources ('%s')", robot.c_str(),
+                      resources.c_str());
+      return 1;
+    }
+    if (group.empty())
+      group = standard->group;
+
+    // kinematics plugins read the robot from the parameter server
+    robot_description = "microbenchmark_robot_description";
+    ros::param::set(robot_description, urdf);
+    ros::param::set(robot_description + "_semantic", srdf);
+    robot_model_loader::RobotModelLoader::Options opt(robot_description);
+    opt.load_kinematics_solvers_ = false;
+    rml.reset(new robot_model_loader::RobotModelLoader(opt));
+    if (rml->getModel())
+      rml->loadKinematicsSolvers(kinematics_plugin_loader::KinematicsPluginLoaderPtr(
+          new kinematics_plugin_loader::KinematicsPluginLoader(ik_plugin, 0.005, 1, robot_description)));
+  }
+  else
+  {
+    rml.reset(new robot_model_loader::RobotModelLoader(robot_description));
+    robot = robot_description;
+  }
+
+  robot_model::RobotModelConstPtr model = rml->getModel();
+  if (!model)
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Unable to load the robot model");
+    return 1;
+  }
+  if (group.empty() && !model->getJointModelGroupNames().empty())
+    group = model->getJointModelGroupNames().front();
+  const robot_model::JointModelGroup* jmg = model->getJointModelGroup(group);
+
+  random_numbers::RandomNumberGenerator rng(seed);
+  std::vector<robot_state::RobotState> states = sampleStates(model, iterations, rng);
+  std::vector<BenchmarkResult> results;
+
+  {
+    results.push_back(BenchmarkResult());
+    results.back().name = "RobotState::update";
+    robot_state::RobotState state(model);
+    measure(results.back(), iterations, [&](unsigned int i) {
+      state.setVariablePositions(states[i].getVariablePositions());
+      state.update();
+    });
+  }
+
+  planning_scene::PlanningScene scene(model);
+  {
+    results.push_back(BenchmarkResult());
+    results.back().name = "PlanningScene::checkSelfCollision";
+    collision_detection::CollisionRequest req;
+    unsigned int colliding = 0;
+    measure(results.back(), iterations, [&](unsigned int i) {
+      collision_detection::CollisionResult res;
+      scene.checkSelfCollision(req, res, states[i]);
+      colliding += res.collision;
+    });
+    results.back().extra["colliding_fraction"] = double(colliding) / std::max(1u, iterations);
+  }
+
+  fillOctomap(scene, octomap_points, rng);
+  {
+    results.push_back(BenchmarkResult());
+    results.back().name = "PlanningScene::checkCollision (octomap)";
+    collision_detection::CollisionRequest req;
+    unsigned int colliding = 0;
+    measure(results.back(), iterations, [&](unsigned int i) {
+      collision_detection::CollisionResult res;
+      scene.checkCollision(req, res, states[i]);
+      colliding += res.collision;
+    });
+    results.back().extra["colliding_fraction"] = double(colliding) / std::max(1u, iterations);
+    results.back().extra["octomap_points"] = octomap_points;
+  }
+
+  {
+    results.push_back(BenchmarkResult());
+    results.back().name = "PlanningScene::distanceToCollision (octomap)";
+    measure(results.back(), iterations, [&](unsigned int i) { scene.distanceToCollision(states[i]); });
+  }
+
+  results.push_back(BenchmarkResult());
+  results.back().name = "RobotState::setFromIK";
+  if (!jmg)
+    results.back().skipped = "unknown group '" + group + "'";
+  else if (!jmg->getSolverInstance())
+    results.back().skipped = "no IK solver for group '" + group + "'";
+  else
+  {
+    // targets are poses reached by random states, so each has a solution
+    const std::string& tip = jmg->getSolverInstance()->getTipFrame();
+    EigenSTL::vector_Affine3d targets;
+    for (const robot_state::RobotState& state : states)
+      targets.push_back(state.getGlobalLinkTransform(tip));
+    robot_state::RobotState state(model);
+    state.setToDefaultValues();
+    const robot_state::RobotState seed_state = state;
+    unsigned int solved = 0;
+    measure(results.back(), iterations, [&](unsigned int i) {
+      state = seed_state;
+      solved += state.setFromIK(jmg, targets[i], tip, 1, 0.0);
+    });
+    results.back().extra["success_rate"] = double(solved) / std::max(1u, iterations);
+  }
+
+  results.push_back(BenchmarkResult());
+  results.back().name = "IterativeParabolicTimeParameterization::computeTimeStamps";
+  if (!jmg)
+    results.back().skipped = "unknown group '" + group + "'";
+  else
+  {
+    static const unsigned int WAYPOINTS = 50;
+    std::vector<robot_trajectory::RobotTrajectory> trajectories;
+    for (unsigned int i = 0; i < iterations; ++i)
+    {
+      trajectories.push_back(robot_trajectory::RobotTrajectory(model, group));
+      robot_state::RobotState state(states[i]);
+      std::vector<double> values, near;
+      for (unsigned int k = 0; k < WAYPOINTS; ++k)
+      {
+        state.copyJointGroupPositions(jmg, near);
+        values.resize(near.size());
+        jmg->getVariableRandomPositionsNearBy(rng, values, near, 0.1);
+        state.setJointGroupPositions(jmg, values);
+        trajectories.back().addSuffixWayPoint(state, 0.0);
+      }
+    }
+    trajectory_processing::IterativeParabolicTimeParameterization iptp;
+    measure(results.back(), iterations, [&](unsigned int i) { iptp.computeTimeStamps(trajectories[i]); });
+    results.back().extra["waypoints"] = WAYPOINTS;
+  }
+
+  if (output.empty())
+    writeJSON(std::cout, robot, seed, results);
+  else
+  {
+    std::ofstream out(output.c_str());
+    writeJSON(out, robot, seed, results);
+    ROS_INFO_NAMED(LOGNAME, "Results written to '%s'", output.c_str());
+  }
+
+  ros::shutdown();
+  return 0;
+}
@@ -0,0 +1,105 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/planning_request_adapter/planning_request_adapter.h>
+#include <moveit/trajectory_processing/time_optimal_trajectory_generation.h>
+#include <class_loader/class_loader.hpp>
+#include <ros/ros.h>
+#include <memory>
+
+namespace default_planner_request_adapters
+{
+class AddTimeOptimalParameterization : public planning_request_adapter::PlanningRequestAdapter
+{
+public:
+  static const std::string PATH_TOLERANCE_PARAM_NAME;
+  static const std::string RESAMPLE_DT_PARAM_NAME;
+
+  AddTimeOptimalParameterization() : planning_request_adapter::PlanningRequestAdapter(), nh_("~")
+  {
+    double path_tolerance, resample_dt;
+    if (!nh_.getParam(PATH_TOLERANCE_PARAM_NAME, path_tolerance))
+    {
+      path_tolerance = 0.1;
+      ROS_INFO_STREAM("Param '" << PATH_TOLERANCE_PARAM_NAME
+                                << "' was not set. Using default value: " << path_tolerance);
+    }
+    else
+      ROS_INFO_STREAM("Param '" << PATH_TOLERANCE_PARAM_NAME << "' was set to " << path_tolerance);
+
+    if (!nh_.getParam(RESAMPLE_DT_PARAM_NAME, resample_dt))
+    {
+      resample_dt = 0.1;
+      ROS_INFO_STREAM("Param '" << RESAMPLE_DT_PARAM_NAME << "' was not set. Using default value: " << resample_dt);
+    }
+    else
+      ROS_INFO_STREAM("Param '" << RESAMPLE_DT_PARAM_NAME << "' was set to " << resample_dt);
+
+    time_param_.reset(new trajectory_processing::TimeOptimalTrajectoryGeneration(path_tolerance, resample_dt));
+  }
+
+  virtual std::string getDescription() const
+  {
+    return "Add Time Optimal Parameterization";
+  }
+
+  virtual bool adaptAndPlan(const PlannerFn& planner, const planning_scene::PlanningSceneConstPtr& planning_scene,
+                            const planning_interface::MotionPlanRequest& req,
+                            planning_interface::MotionPlanResponse& res,
+                            std::vector<std::size_t>& added_path_index) const
+  {
+    bool result = planner(planning_scene, req, res);
+    if (result && res.trajectory_)
+    {
+      ROS_DEBUG("Running '%s'", getDescription().c_str());
+      if (!time_param_->computeTimeStamps(*res.trajectory_, req.max_velocity_scaling_factor,
+                                          req.max_acceleration_scaling_factor))
+        ROS_WARN("Time parametrization for the solution path failed.");
+    }
+
+    return result;
+  }
+
+private:
+  ros::NodeHandle nh_;
+  std::unique_ptr<trajectory_processing::TimeOptimalTrajectoryGeneration> time_param_;
+};
+
+const std::string AddTimeOptimalParameterization::PATH_TOLERANCE_PARAM_NAME = "path_tolerance";
+const std::string AddTimeOptimalParameterization::RESAMPLE_DT_PARAM_NAME = "resample_dt";
+}
+
+CLASS_LOADER_REGISTER_CLASS(default_planner_request_adapters::AddTimeOptimalParameterization,
+                            planning_request_adapter::PlanningRequestAdapter);
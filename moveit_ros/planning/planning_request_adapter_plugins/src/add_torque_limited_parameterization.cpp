@@ -0,0 +1,134 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/planning_request_adapter/planning_request_adapter.h>
+#include <moveit/trajectory_processing/torque_limited_time_parameterization.h>
+#include <class_loader/class_loader.hpp>
+#include <boost/thread/mutex.hpp>
+#include <ros/ros.h>
+#include <algorithm>
+#include <map>
+#include <memory>
+
+namespace default_planner_request_adapters
+{
+class AddTorqueLimitedParameterization : public planning_request_adapter::PlanningRequestAdapter
+{
+public:
+  static const std::string TORQUE_SCALING_FACTOR_PARAM_NAME;
+  static const std::string PAYLOAD_PARAM_NAME;
+  static const std::string THREADS_PARAM_NAME;
+
+  AddTorqueLimitedParameterization() : planning_request_adapter::PlanningRequestAdapter(), nh_("~")
+  {
+    double torque_scaling_factor;
+    int threads;
+    nh_.param(TORQUE_SCALING_FACTOR_PARAM_NAME, torque_scaling_factor, 1.0);
+    nh_.param(PAYLOAD_PARAM_NAME, payload_, 0.0);
+    nh_.param(THREADS_PARAM_NAME, threads, 1);
+    ROS_INFO_STREAM("Limiting torques to " << torque_scaling_factor << " of the joint effort limits for a payload of "
+                                           << payload_ << " kg");
+
+    time_param_.reset(new trajectory_processing::TorqueLimitedTimeParameterization(
+        torque_scaling_factor, 10, static_cast<unsigned int>(std::max(threads, 0))));
+
+    gravity_.x = 0.0;
+    gravity_.y = 0.0;
+    gravity_.z = -9.81;
+  }
+
+  virtual std::string getDescription() const
+  {
+    return "Add Torque Limited Time Parameterization";
+  }
+
+  virtual bool adaptAndPlan(const PlannerFn& planner, const planning_scene::PlanningSceneConstPtr& planning_scene,
+                            const planning_interface::MotionPlanRequest& req,
+                            planning_interface::MotionPlanResponse& res,
+                            std::vector<std::size_t>& added_path_index) const
+  {
+    bool result = planner(planning_scene, req, res);
+    if (result && res.trajectory_)
+    {
+      ROS_DEBUG("Running '%s'", getDescription().c_str());
+      const dynamics_solver::DynamicsSolverPtr& solver =
+          getDynamicsSolver(planning_scene->getRobotModel(), res.trajectory_->getGroupName());
+      if (!solver)
+      {
+        time_param_fallback_.computeTimeStamps(*res.trajectory_, req.max_velocity_scaling_factor,
+                                               req.max_acceleration_scaling_factor);
+        ROS_WARN("No dynamics solver is available for group '%s'. Torque limits were not applied.",
+                 res.trajectory_->getGroupName().c_str());
+      }
+      else if (!time_param_->computeTimeStamps(*res.trajectory_, *solver, payload_, req.max_velocity_scaling_factor,
+                                               req.max_acceleration_scaling_factor))
+        ROS_WARN("Time parametrization for the solution path failed.");
+    }
+
+    return result;
+  }
+
+private:
+  /** \brief Get the dynamics solver of a group, constructing it on first use. NULL if the group is not a chain. */
+  const dynamics_solver::DynamicsSolverPtr& getDynamicsSolver(const robot_model::RobotModelConstPtr& robot_model,
+                                                              const std::string& group) const
+  {
+    boost::mutex::scoped_lock slock(solvers_lock_);
+    dynamics_solver::DynamicsSolverPtr& solver = solvers_[group];
+    if (!solver || solver->getRobotModel() != robot_model)
+    {
+      solver.reset(new dynamics_solver::DynamicsSolver(robot_model, group, gravity_));
+      if (!solver->getGroup())
+        solver.reset();
+    }
+    return solver;
+  }
+
+  ros::NodeHandle nh_;
+  std::unique_ptr<trajectory_processing::TorqueLimitedTimeParameterization> time_param_;
+  trajectory_processing::IterativeParabolicTimeParameterization time_param_fallback_;
+  double payload_;
+  geometry_msgs::Vector3 gravity_;
+
+  mutable std::map<std::string, dynamics_solver::DynamicsSolverPtr> solvers_;
+  mutable boost::mutex solvers_lock_;
+};
+
+const std::string AddTorqueLimitedParameterization::TORQUE_SCALING_FACTOR_PARAM_NAME = "torque_scaling_factor";
+const std::string AddTorqueLimitedParameterization::PAYLOAD_PARAM_NAME = "payload";
+const std::string AddTorqueLimitedParameterization::THREADS_PARAM_NAME = "dynamics_threads";
+}
+
+CLASS_LOADER_REGISTER_CLASS(default_planner_request_adapters::AddTorqueLimitedParameterization,
+                            planning_request_adapter::PlanningRequestAdapter);
@@ -73,6 +73,41 @@ public:
     return "Fix Start State Bounds";
   }
 
+  virtual bool isNeeded(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                        const planning_interface::MotionPlanRequest& req) const
+  {
+    // only a start state that is the current state can be checked without constructing it first
+    const moveit_msgs::RobotState& start = req.start_state;
+    if (!start.is_diff || !start.joint_state.name.empty() || !start.multi_dof_joint_state.joint_names.empty())
+      return true;
+
+    const robot_state::RobotState& state = planning_scene->getCurrentState();
+    const std::vector<const robot_model::JointModel*>& jmodels =
+        planning_scene->getRobotModel()->hasJointModelGroup(req.group_name) ?
+            planning_scene->getRobotModel()->getJointModelGroup(req.group_name)->getJointModels() :
+            planning_scene->getRobotModel()->getJointModels();
+    for (std::size_t i = 0; i < jmodels.size(); ++i)
+    {
+      const robot_model::JointModel* jm = jmodels[i];
+      if (!state.satisfiesBounds(jm))
+        return true;
+      const double* p = state.getJointPositions(jm);
+      if (jm->getType() == robot_model::JointModel::PLANAR)
+      {
+        double copy[3] = { p[0], p[1], p[2] };
+        if (static_cast<const robot_model::PlanarJointModel*>(jm)->normalizeRotation(copy))
+          return true;
+      }
+      else if (jm->getType() == robot_model::JointModel::FLOATING)
+      {
+        double copy[7] = { p[0], p[1], p[2], p[3], p[4], p[5], p[6] };
+        if (static_cast<const robot_model::FloatingJointModel*>(jm)->normalizeRotation(copy))
+          return true;
+      }
+    }
+    return false;
+  }
+
   virtual bool adaptAndPlan(const PlannerFn& planner, const planning_scene::PlanningSceneConstPtr& planning_scene,
                             const planning_interface::MotionPlanRequest& req,
                             planning_interface::MotionPlanResponse& res,
@@ -48,6 +48,7 @@ public:
   static const std::string DT_PARAM_NAME;
   static const std::string JIGGLE_PARAM_NAME;
   static const std::string ATTEMPTS_PARAM_NAME;
+  static const std::string STEPS_PARAM_NAME;
 
   FixStartStateCollision() : planning_request_adapter::PlanningRequestAdapter(), nh_("~")
   {
@@ -81,6 +82,14 @@ public:
       }
       ROS_INFO_STREAM("Param '" << ATTEMPTS_PARAM_NAME << "' was set to " << sampling_attempts_);
     }
+
+    if (!nh_.getParam(STEPS_PARAM_NAME, push_steps_))
+    {
+      push_steps_ = 10;
+      ROS_INFO_STREAM("Param '" << STEPS_PARAM_NAME << "' was not set. Using default value: " << push_steps_);
+    }
+    else
+      ROS_INFO_STREAM("Param '" << STEPS_PARAM_NAME << "' was set to " << push_steps_);
   }
 
   virtual std::string getDescription() const
@@ -124,7 +133,17 @@ public:
               planning_scene->getRobotModel()->getJointModelGroup(req.group_name)->getJointModels() :
               planning_scene->getRobotModel()->getJointModels();
 
+      // first try to push the state out along the contact normals, then fall back to random jiggling
       bool found = false;
+      if (push_steps_ > 0 && planning_scene->getRobotModel()->hasJointModelGroup(req.group_name))
+      {
+        const robot_model::JointModelGroup* jmg = planning_scene->getRobotModel()->getJointModelGroup(req.group_name);
+        found = pushOutOfCollision(planning_scene, creq, jmg, start_state);
+        if (found)
+          ROS_INFO("Pushed the start state out of collision by a distance of %lf", prefix_state->distance(start_state));
+        else
+          start_state = *prefix_state;
+      }
       for (int c = 0; !found && c < sampling_attempts_; ++c)
       {
         for (std::size_t i = 0; !found && i < jmodels.size(); ++i)
@@ -183,15 +202,105 @@ public:
   }
 
 private:
+  /** \brief Move \e state out of collision with a few damped least squares steps. Each step moves the group's joints
+      so the contact points of the robot separate along the contact normals by the penetration depth. Succeeds if
+      \e state is collision free within push_steps_ steps. */
+  bool pushOutOfCollision(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                          const collision_detection::CollisionRequest& creq,
+                          const robot_model::JointModelGroup* jmg, robot_state::RobotState& state) const
+  {
+    // the Jacobian is only available for chains
+    if (!jmg->isChain())
+      return false;
+
+    // separate by a little more than the reported depth, which is only an estimate for non-convex shapes
+    static const double MARGIN = 0.005;
+    static const double DAMPING = 1e-4;
+
+    collision_detection::CollisionRequest contact_req = creq;
+    contact_req.contacts = true;
+    contact_req.max_contacts = 50;
+    contact_req.max_contacts_per_pair = 1;
+
+    const robot_model::LinkModel* root_link = jmg->getJointModels()[0]->getParentLinkModel();
+    std::vector<double> positions;
+    Eigen::MatrixXd jacobian;
+    for (int step = 0; step < push_steps_; ++step)
+    {
+      state.update();
+      collision_detection::CollisionResult cres;
+      planning_scene->checkCollision(contact_req, cres, state);
+      if (!cres.collision)
+        return true;
+
+      // world directions are expressed in the frame the Jacobian is computed in
+      Eigen::Matrix3d to_root =
+          root_link ? state.getGlobalLinkTransform(root_link).rotation().transpose() : Eigen::Matrix3d::Identity();
+      Eigen::VectorXd delta = Eigen::VectorXd::Zero(jmg->getVariableCount());
+      bool moved = false;
+      for (collision_detection::CollisionResult::ContactMap::const_iterator it = cres.contacts.begin();
+           it != cres.contacts.end(); ++it)
+        for (std::size_t k = 0; k < it->second.size(); ++k)
+        {
+          const collision_detection::Contact& contact = it->second[k];
+          // the normal points from the first body to the second one; each robot body moves away from the other one
+          for (int b = 0; b < 2; ++b)
+          {
+            const robot_model::LinkModel* link =
+                b == 0 ? contactLink(state, contact.body_type_1, contact.body_name_1) :
+                         contactLink(state, contact.body_type_2, contact.body_name_2);
+            if (!link || !jmg->isLinkUpdated(link->getName()))
+              continue;
+            Eigen::Vector3d point = state.getGlobalLinkTransform(link).inverse() * contact.pos;
+            if (!state.getJacobian(jmg, link, point, jacobian))
+              continue;
+            Eigen::Vector3d direction = (b == 0 ? -contact.normal : contact.normal) * (contact.depth + MARGIN);
+            Eigen::MatrixXd jv = jacobian.topRows(3);
+            Eigen::Matrix3d jjt = jv * jv.transpose() + DAMPING * Eigen::Matrix3d::Identity();
+            delta += jv.transpose() * jjt.ldlt().solve(to_root * direction);
+            moved = true;
+          }
+        }
+      if (!moved)
+        return false;
+
+      state.copyJointGroupPositions(jmg, positions);
+      for (std::size_t i = 0; i < positions.size(); ++i)
+        positions[i] += delta[i];
+      state.setJointGroupPositions(jmg, positions);
+      state.enforceBounds(jmg);
+    }
+    state.update();
+    collision_detection::CollisionResult cres;
+    planning_scene->checkCollision(creq, cres, state);
+    return !cres.collision;
+  }
+
+  /// The robot link moved with the body of a contact, or NULL for world objects
+  static const robot_model::LinkModel* contactLink(const robot_state::RobotState& state,
+                                                   collision_detection::BodyType type, const std::string& name)
+  {
+    if (type == collision_detection::BodyTypes::ROBOT_LINK)
+      return state.getRobotModel()->getLinkModel(name);
+    if (type == collision_detection::BodyTypes::ROBOT_ATTACHED)
+    {
+      const robot_state::AttachedBody* body = state.getAttachedBody(name);
+      return body ? body->getAttachedLink() : NULL;
+    }
+    return NULL;
+  }
+
   ros::NodeHandle nh_;
   double max_dt_offset_;
   double jiggle_fraction_;
   int sampling_attempts_;
+  int push_steps_;
 };
 
 const std::string FixStartStateCollision::DT_PARAM_NAME = "start_state_max_dt";
 const std::string FixStartStateCollision::JIGGLE_PARAM_NAME = "jiggle_fraction";
 const std::string FixStartStateCollision::ATTEMPTS_PARAM_NAME = "max_sampling_attempts";
+const std::string FixStartStateCollision::STEPS_PARAM_NAME = "max_push_steps";
 }
 
 CLASS_LOADER_REGISTER_CLASS(default_planner_request_adapters::FixStartStateCollision,
@@ -37,6 +37,7 @@
 
 #include <moveit/planning_request_adapter/planning_request_adapter.h>
 #include <moveit/robot_state/conversions.h>
+#include <moveit/kinematic_constraints/utils.h>
 #include <class_loader/class_loader.hpp>
 #include <moveit/trajectory_processing/trajectory_tools.h>
 #include <ros/ros.h>
@@ -55,6 +56,13 @@ public:
     return "Fix Start State Path Constraints";
   }
 
+  virtual bool isNeeded(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                        const planning_interface::MotionPlanRequest& req) const
+  {
+    // without path constraints, a valid start state always satisfies them
+    return !kinematic_constraints::isEmpty(req.path_constraints);
+  }
+
   virtual bool adaptAndPlan(const PlannerFn& planner, const planning_scene::PlanningSceneConstPtr& planning_scene,
                             const planning_interface::MotionPlanRequest& req,
                             planning_interface::MotionPlanResponse& res,
@@ -62,16 +62,19 @@ public:
     return "Fix Workspace Bounds";
   }
 
+  virtual bool isNeeded(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                        const planning_interface::MotionPlanRequest& req) const
+  {
+    return isUnspecified(req.workspace_parameters);
+  }
+
   virtual bool adaptAndPlan(const PlannerFn& planner, const planning_scene::PlanningSceneConstPtr& planning_scene,
                             const planning_interface::MotionPlanRequest& req,
                             planning_interface::MotionPlanResponse& res,
                             std::vector<std::size_t>& added_path_index) const
   {
     ROS_DEBUG("Running '%s'", getDescription().c_str());
-    const moveit_msgs::WorkspaceParameters& wparams = req.workspace_parameters;
-    if (wparams.min_corner.x == wparams.max_corner.x && wparams.min_corner.x == 0.0 &&
-        wparams.min_corner.y == wparams.max_corner.y && wparams.min_corner.y == 0.0 &&
-        wparams.min_corner.z == wparams.max_corner.z && wparams.min_corner.z == 0.0)
+    if (isUnspecified(req.workspace_parameters))
     {
       ROS_DEBUG("It looks like the planning volume was not specified. Using default values.");
       planning_interface::MotionPlanRequest req2 = req;
@@ -85,6 +88,13 @@ public:
   }
 
 private:
+  static bool isUnspecified(const moveit_msgs::WorkspaceParameters& wparams)
+  {
+    return wparams.min_corner.x == wparams.max_corner.x && wparams.min_corner.x == 0.0 &&
+           wparams.min_corner.y == wparams.max_corner.y && wparams.min_corner.y == 0.0 &&
+           wparams.min_corner.z == wparams.max_corner.z && wparams.min_corner.z == 0.0;
+  }
+
   ros::NodeHandle nh_;
   double workspace_extent_;
 };
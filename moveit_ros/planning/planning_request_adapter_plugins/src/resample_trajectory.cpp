@@ -0,0 +1,87 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/planning_request_adapter/planning_request_adapter.h>
+#include <moveit/trajectory_processing/trajectory_resampling.h>
+#include <class_loader/class_loader.hpp>
+#include <ros/ros.h>
+
+namespace default_planner_request_adapters
+{
+/** \brief Resample the time parameterized solution at a fixed period. This adapter must come before (i.e., run
+    after) one of the time parameterization adapters. */
+class ResampleTrajectory : public planning_request_adapter::PlanningRequestAdapter
+{
+public:
+  static const std::string PERIOD_PARAM_NAME;
+
+  ResampleTrajectory() : planning_request_adapter::PlanningRequestAdapter(), nh_("~")
+  {
+    double period;
+    nh_.param(PERIOD_PARAM_NAME, period, 0.01);
+    ROS_INFO_STREAM("Resampling trajectories every " << period << " s");
+    resampler_ = trajectory_processing::TrajectoryResampler(period);
+  }
+
+  virtual std::string getDescription() const
+  {
+    return "Resample Trajectory";
+  }
+
+  virtual bool adaptAndPlan(const PlannerFn& planner, const planning_scene::PlanningSceneConstPtr& planning_scene,
+                            const planning_interface::MotionPlanRequest& req,
+                            planning_interface::MotionPlanResponse& res,
+                            std::vector<std::size_t>& added_path_index) const
+  {
+    bool result = planner(planning_scene, req, res);
+    if (result && res.trajectory_)
+    {
+      ROS_DEBUG("Running '%s'", getDescription().c_str());
+      if (!resampler_.resample(*res.trajectory_))
+        ROS_WARN("Resampling the solution path failed. The solution is kept as it is.");
+    }
+
+    return result;
+  }
+
+private:
+  ros::NodeHandle nh_;
+  trajectory_processing::TrajectoryResampler resampler_;
+};
+
+const std::string ResampleTrajectory::PERIOD_PARAM_NAME = "resample_period";
+}
+
+CLASS_LOADER_REGISTER_CLASS(default_planner_request_adapters::ResampleTrajectory,
+                            planning_request_adapter::PlanningRequestAdapter);
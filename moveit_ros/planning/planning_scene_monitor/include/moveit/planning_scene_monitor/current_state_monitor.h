@@ -46,6 +46,8 @@
 #include <boost/thread/mutex.hpp>
 #include <moveit/macros/deprecation.h>
 #include <boost/thread/condition_variable.hpp>
+#include <atomic>
+#include <memory>
 
 namespace planning_scene_monitor
 {
@@ -126,9 +128,26 @@ public:
    *  @return Returns the current state */
   robot_state::RobotStatePtr getCurrentState() const;
 
+  /** @brief Get a shared, read-only copy of the current state without waiting for new joint states.
+   *
+   *  The copy (with up to date link transforms) is only made again once the state was updated since the previous
+   *  call, so polling this is cheap. If \e version is given, it is set to the version of the returned state
+   *  (see getStateVersion()). */
+  robot_state::RobotStateConstPtr getCurrentStateSnapshot(uint64_t* version = nullptr) const;
+
+  /** @brief Get a counter that increases with every update of the current state (joint state messages and TF updates
+   *  of multi-dof joints). It is zero as long as no update was received. Does not block. */
+  uint64_t getStateVersion() const
+  {
+    return state_version_.load();
+  }
+
   /** @brief Set the state \e upd to the current state maintained by this class. */
   void setToCurrentState(robot_state::RobotState& upd) const;
 
+  /** @brief Set the state \e upd to the current state maintained by this class and \e stamp to its time stamp */
+  void setToCurrentState(robot_state::RobotState& upd, ros::Time& stamp) const;
+
   /** @brief Get the time stamp for the current state */
   ros::Time getCurrentStateTime() const;
 
@@ -195,21 +214,67 @@ public:
     copy_dynamics_ = enabled;
   }
 
+  /** @brief Limit the rate at which joint state updates are dispatched to the update callbacks.
+   *
+   *  Incoming joint states are always stored immediately (without taking the state lock), so getCurrentState()
+   *  and waitForCurrentState() see every message. With a non-zero \e period, the update callbacks are called at
+   *  most once per \e period: the first message after a quiet period is dispatched right away, later ones are
+   *  coalesced and the most recent of them is dispatched when the period expires. A zero period (the default)
+   *  dispatches every message. Takes effect the next time the monitor is started. */
+  void setJointStateCoalescingPeriod(const ros::WallDuration& period)
+  {
+    coalescing_period_ = period;
+  }
+
+  /** @brief Get the period set by setJointStateCoalescingPeriod() */
+  const ros::WallDuration& getJointStateCoalescingPeriod() const
+  {
+    return coalescing_period_;
+  }
+
 private:
+  class JointStateBuffer;
+
   void jointStateCallback(const sensor_msgs::JointStateConstPtr& joint_state);
   void tfCallback();
 
+  /** @brief Apply the joint states stored in the buffer since the last call to robot_state_.
+   *  Must be called with state_update_lock_ held. Returns true if any position changed. */
+  bool applyBufferedJointStates() const;
+
+  /** @brief Bring robot_state_ up to date and call the update callbacks if anything changed */
+  void dispatchJointState(const sensor_msgs::JointStateConstPtr& joint_state);
+
+  void coalescingTimerCallback(const ros::WallTimerEvent& event);
+
   ros::NodeHandle nh_;
   boost::shared_ptr<tf::Transformer> tf_;
   robot_model::RobotModelConstPtr robot_model_;
-  robot_state::RobotState robot_state_;
-  std::map<const moveit::core::JointModel*, ros::Time> joint_time_;
+  // the state is brought up to date lazily (by readers as well) from the joint state buffer
+  mutable robot_state::RobotState robot_state_;
+  mutable std::map<const moveit::core::JointModel*, ros::Time> joint_time_;
   bool state_monitor_started_;
   bool copy_dynamics_;  // Copy velocity and effort from joint_state
   ros::Time monitor_start_time_;
   double error_;
   ros::Subscriber joint_state_subscriber_;
-  ros::Time current_state_time_;
+  mutable ros::Time current_state_time_;
+
+  std::unique_ptr<JointStateBuffer> joint_state_buffer_;
+  mutable uint64_t applied_sequence_;      // buffer sequence already applied to robot_state_
+  mutable bool state_changed_;             // robot_state_ changed since the update callbacks were last called
+  std::vector<std::string> joint_names_;   // names of the last received message ...
+  std::vector<int> joint_variables_;       // ... and the variable index each of them maps to (-1 if ignored)
+  mutable std::atomic<unsigned int> waiters_;  // number of threads in waitForCurrentState()
+
+  std::atomic<uint64_t> state_version_;
+  mutable robot_state::RobotStatePtr snapshot_;  // returned by getCurrentStateSnapshot(), never modified once shared
+  mutable uint64_t snapshot_version_;
+
+  ros::WallDuration coalescing_period_;
+  ros::WallTimer coalescing_timer_;
+  ros::WallTime last_dispatch_time_;
+  sensor_msgs::JointStateConstPtr pending_joint_state_;  // accessed atomically
 
   mutable boost::mutex state_update_lock_;
   mutable boost::condition_variable state_update_condition_;
@@ -38,6 +38,7 @@
 #define MOVEIT_PLANNING_SCENE_MONITOR_PLANNING_SCENE_MONITOR_
 
 #include <ros/ros.h>
+#include <ros/callback_queue.h>
 #include <tf/tf.h>
 #include <tf/message_filter.h>
 #include <message_filters/subscriber.h>
@@ -50,6 +51,8 @@
 #include <boost/noncopyable.hpp>
 #include <boost/thread/shared_mutex.hpp>
 #include <boost/thread/recursive_mutex.hpp>
+#include <atomic>
+#include <deque>
 #include <memory>
 
 namespace planning_scene_monitor
@@ -245,6 +248,22 @@ public:
       publishing planning scenes. */
   void monitorDiffs(bool flag);
 
+  /** \brief When the flag passed in is true, every update of the maintained scene publishes an immutable copy of it
+      (a snapshot). Snapshots can be retrieved with getSceneSnapshot() without locking the maintained scene, and
+      LockedPlanningSceneRO instances refer to the latest snapshot instead of waiting for writers to finish. Octree
+      data is shared with the occupancy map monitor, so snapshot readers still hold the octree read lock. */
+  void enableSceneSnapshots(bool flag);
+
+  /** \brief Return true if snapshots of the maintained scene are published on updates */
+  bool sceneSnapshotsEnabled() const
+  {
+    return snapshots_enabled_;
+  }
+
+  /** \brief Get the most recent snapshot of the maintained scene. This never blocks on scene updates. An empty
+      pointer is returned if snapshots are not enabled. */
+  planning_scene::PlanningSceneConstPtr getSceneSnapshot() const;
+
   /** \brief Start publishing the maintained planning scene. The first message set out is a complete planning scene.
       Diffs are sent afterwards on updates specified by the \e event bitmask. For UPDATE_SCENE, the full scene is always
      sent. */
@@ -263,6 +282,17 @@ public:
     return publish_planning_scene_frequency_;
   }
 
+  /** \brief Publish octomap changes as deltas (only the changed leaves) instead of the full octomap. A full octomap is
+      still sent every \e keyframe_period published octomaps so that late subscribers can catch up. A period of 0
+      (the default) disables deltas. */
+  void publishOctomapDeltas(unsigned int keyframe_period);
+
+  /** \brief Get the octomap keyframe period; 0 if octomap deltas are not published */
+  unsigned int getOctomapKeyframePeriod() const
+  {
+    return octomap_keyframe_period_;
+  }
+
   /** @brief Get the stored instance of the stored current state monitor
    *  @return An instance of the stored current state monitor*/
   const CurrentStateMonitorPtr& getStateMonitor() const
@@ -312,6 +342,85 @@ public:
       return 0.0;
   }
 
+  /** @brief Collect the collision object messages received within \e period seconds and apply them together, with a
+      single scene update event. Within a window, an update that replaces or removes an object drops the messages
+      received earlier for the same object, and consecutive moves of an object are merged. A period of 0 (the
+      default, also settable with the ~collision_object_coalescing_period parameter) applies every message as it
+      arrives. */
+  void setCollisionObjectCoalescingPeriod(double period);
+
+  double getCollisionObjectCoalescingPeriod() const
+  {
+    return collision_object_coalescing_period_.toSec();
+  }
+
+  /** @brief Collision objects whose meshes have at least this many triangles in total are decoded, and their
+      collision geometry is built, on a background thread before the object is added to the scene in one step, so the
+      scene stays available while a large model is ingested. Collision object messages received while such an object is
+      being prepared are applied after it, in order. Set with the ~background_mesh_triangle_threshold parameter
+      (default 10000); 0 applies all objects in the receiving thread. */
+  unsigned int getBackgroundMeshTriangleThreshold() const
+  {
+    return background_mesh_triangle_threshold_;
+  }
+
+  /** @brief Keep a history of the robot state (including attached bodies) for the last \e duration seconds, so
+      getStateAtTime() and getSceneAtTime() can look up the scene at the capture time of delayed sensor data. Every
+      scene update adds an entry, stamped with the time of the monitored state for state updates and the receipt time
+      otherwise. When scene snapshots are enabled, entries also refer to the snapshot of the scene at that time. At
+      most \e max_entries entries are kept. A duration of 0 (the default, also settable with the
+      ~scene_history_duration parameter) disables the history. */
+  void setSceneHistory(double duration, std::size_t max_entries = 1000);
+
+  double getSceneHistoryDuration() const
+  {
+    return scene_history_duration_.toSec();
+  }
+
+  /** @brief Set \e state to the robot state at time \e t, interpolating the variable positions between the neighbouring
+      history entries. Attached bodies are those of the entry preceding \e t. Times newer than the latest entry get the
+      latest state, as nothing changed since. Returns false if the history is disabled or does not reach back to
+      \e t. */
+  bool getStateAtTime(const ros::Time& t, robot_state::RobotState& state) const;
+
+  /** @brief Get a diff of the scene at time \e t, with the robot state from getStateAtTime(). The diff is based on the
+      snapshot of the preceding history entry if there is one, and on the maintained scene (which should then be
+      locked for reading while the diff is used) otherwise. Returns an empty pointer if \e t is not in the history. */
+  planning_scene::PlanningScenePtr getSceneAtTime(const ros::Time& t) const;
+
+  /** @brief Statistics about the updates the monitor received from one source of scene data */
+  struct UpdateSourceStatistics
+  {
+    UpdateSourceStatistics()
+      : received(0)
+      , applied(0)
+      , total_latency(0.0)
+      , max_latency(0.0)
+      , total_processing_time(0.0)
+      , max_processing_time(0.0)
+    {
+    }
+
+    /// The number of updates received, and how many of them were applied (fewer when updates are coalesced)
+    std::size_t received;
+    std::size_t applied;
+
+    /// Wall time (in seconds) from receiving an update until it was applied and announced to the update callbacks
+    double total_latency;
+    double max_latency;
+
+    /// Wall time (in seconds) spent applying updates and running the update callbacks
+    double total_processing_time;
+    double max_processing_time;
+  };
+
+  /** @brief Get the update statistics of each source that sent updates, indexed by source name: "planning_scene",
+      "planning_scene_world", "collision_object", "attached_collision_object", "octomap" and "robot_state" */
+  std::map<std::string, UpdateSourceStatistics> getUpdateStatistics() const;
+
+  /** @brief Clear the update statistics of all sources */
+  void resetUpdateStatistics();
+
   /** @brief Start the scene monitor
    *  @param scene_topic The name of the planning scene topic
    */
@@ -382,11 +491,22 @@ public:
    */
   void unlockSceneWrite();
 
+  /** \brief Lock the data that is shared between the maintained scene and its snapshots (the octree) for reading */
+  void lockSnapshotRead();
+
+  /** \brief Unlock the data that is shared between the maintained scene and its snapshots (the octree) */
+  void unlockSnapshotRead();
+
   void clearOctomap();
 
   // Called to update the planning scene with a new message.
   bool newPlanningSceneMessage(const moveit_msgs::PlanningScene& scene);
 
+  /** @brief Apply a batch of planning scene diffs as one transaction: the diffs are applied in order under a single
+      lock of the scene, and a single update event (and hence a single published diff) is triggered for all of them.
+      If any diff fails to apply, or a message is not a diff, the scene is left unchanged and false is returned. */
+  bool newPlanningSceneMessages(const std::vector<moveit_msgs::PlanningScene>& scenes);
+
 protected:
   /** @brief Initialize the planning scene monitor
    *  @param scene The scene instance to fill with data (an instance is allocated if the one passed in is not allocated)
@@ -399,6 +519,9 @@ protected:
   /** @brief Configure the default padding*/
   void configureDefaultPadding();
 
+  /** @brief Publish a new snapshot of the maintained scene, if snapshots are enabled */
+  void updateSceneSnapshot();
+
   /** @brief Callback for a new collision object msg*/
   void collisionObjectCallback(const moveit_msgs::CollisionObjectConstPtr& obj);
 
@@ -448,8 +571,19 @@ protected:
   ros::Time last_update_time_;                     /// Last time the state was updated
   ros::Time last_robot_motion_time_;               /// Last time the robot has moved
 
+  std::atomic<bool> snapshots_enabled_;
+  planning_scene::PlanningSceneConstPtr scene_snapshot_;  /// latest snapshot, only accessed with std::atomic_load/store
+  boost::mutex scene_snapshot_mutex_;                     /// serializes the creation of snapshots
+
   ros::NodeHandle nh_;
   ros::NodeHandle root_nh_;
+
+  /// If the ~priority_update_lane parameter is set, joint states, attached objects and the state update timer are
+  /// served by priority_callback_queue_ and its own spinner, so slow updates of other sources do not delay them.
+  /// The queue is declared before all subscribers and timers, so it outlives them.
+  ros::CallbackQueue priority_callback_queue_;
+  ros::NodeHandle priority_nh_;
+  std::unique_ptr<ros::AsyncSpinner> priority_spinner_;
   boost::shared_ptr<tf::Transformer> tf_;
   std::string robot_description_;
 
@@ -472,6 +606,8 @@ protected:
   double publish_planning_scene_frequency_;
   SceneUpdateType publish_update_types_;
   SceneUpdateType new_scene_update_;
+  unsigned int octomap_keyframe_period_;
+  unsigned int octomap_deltas_since_keyframe_;
   boost::condition_variable_any new_scene_update_condition_;
 
   // subscribe to various sources of data
@@ -514,15 +650,80 @@ private:
   // publish planning scene update diffs (runs in its own thread)
   void scenePublishingThread();
 
+  // replace the octomap in an outgoing message by a delta when deltas are enabled (octree read lock must be held)
+  void processOctomapDelta(moveit_msgs::PlanningScene& msg, bool is_full);
+
   // called by current_state_monitor_ when robot state (as monitored on joint state topic) changes
   void onStateUpdate(const sensor_msgs::JointStateConstPtr& joint_state);
 
   // called by state_update_timer_ when a state update it pending
   void stateUpdateTimerCallback(const ros::WallTimerEvent& event);
 
+  // the update type caused by the diff scene, for a scene named old_scene_name before the diff was applied
+  static SceneUpdateType getDiffUpdateType(const moveit_msgs::PlanningScene& scene, const std::string& old_scene_name);
+
   // Callback for a new planning scene msg
   void newPlanningSceneCallback(const moveit_msgs::PlanningSceneConstPtr& scene);
 
+  struct PendingCollisionObject
+  {
+    moveit_msgs::CollisionObjectConstPtr msg;
+    ros::WallTime received;
+  };
+
+  // add obj to pending_collision_objects_, dropping the pending messages it supersedes (lock must be held)
+  void queueCollisionObject(const moveit_msgs::CollisionObjectConstPtr& obj, const ros::WallTime& received);
+
+  // apply all pending collision objects to the scene, or hand them to the ingestion thread
+  void flushPendingCollisionObjects();
+  void collisionObjectFlushTimerCallback(const ros::WallTimerEvent& event);
+
+  // decode the collision objects without holding the scene lock, then apply them all under a single lock
+  void applyCollisionObjects(const std::vector<PendingCollisionObject>& objects);
+  void collisionObjectIngestionThread();
+
+  // add the current state to the scene history and drop the entries that fell out of it
+  void recordSceneHistory(SceneUpdateType update_type);
+
+  // update statistics of source; applied updates also record the time since received and since start
+  void recordUpdateReceived(const std::string& source);
+  void recordUpdateApplied(const std::string& source, const ros::WallTime& received, const ros::WallTime& start);
+
+  /// Collision object messages waiting to be applied, in the order they were received
+  std::vector<PendingCollisionObject> pending_collision_objects_;
+  bool collision_object_flush_pending_;
+  ros::WallDuration collision_object_coalescing_period_;
+  ros::WallTimer collision_object_flush_timer_;
+  boost::mutex pending_collision_objects_mutex_;
+
+  /// Batches of collision objects waiting for the ingestion thread, in the order they were flushed
+  std::deque<std::vector<PendingCollisionObject> > ingestion_queue_;
+  bool ingestion_busy_;  // the ingestion thread is applying a batch
+  bool ingestion_stop_;
+  unsigned int background_mesh_triangle_threshold_;
+  std::unique_ptr<boost::thread> ingestion_thread_;
+  boost::condition_variable ingestion_condition_;
+  boost::mutex ingestion_mutex_;
+
+  std::map<std::string, UpdateSourceStatistics> update_statistics_;
+  mutable boost::mutex update_statistics_mutex_;
+
+  struct SceneHistoryEntry
+  {
+    ros::Time stamp;
+    robot_state::RobotStatePtr state;
+    planning_scene::PlanningSceneConstPtr scene;  // snapshot at stamp, if snapshots are enabled
+  };
+
+  /// Scene history, oldest entry first (protected by scene_history_mutex_)
+  std::deque<SceneHistoryEntry> scene_history_;
+  ros::Duration scene_history_duration_;
+  std::size_t scene_history_max_entries_;
+  mutable boost::mutex scene_history_mutex_;
+
+  /// Receipt time of the oldest state update not yet applied to the scene (protected by state_pending_mutex_)
+  ros::WallTime state_update_received_;
+
   // Lock for state_update_pending_ and dt_state_update_
   boost::mutex state_pending_mutex_;
 
@@ -594,17 +795,17 @@ public:
 
   operator bool() const
   {
-    return planning_scene_monitor_ && planning_scene_monitor_->getPlanningScene();
+    return planning_scene_monitor_ && (snapshot_ || planning_scene_monitor_->getPlanningScene());
   }
 
   operator const planning_scene::PlanningSceneConstPtr&() const
   {
-    return static_cast<const PlanningSceneMonitor*>(planning_scene_monitor_.get())->getPlanningScene();
+    return getScene();
   }
 
   const planning_scene::PlanningSceneConstPtr& operator->() const
   {
-    return static_cast<const PlanningSceneMonitor*>(planning_scene_monitor_.get())->getPlanningScene();
+    return getScene();
   }
 
 protected:
@@ -616,8 +817,19 @@ protected:
 
   void initialize(bool read_only)
   {
-    if (planning_scene_monitor_)
-      lock_.reset(new SingleUnlock(planning_scene_monitor_.get(), read_only));
+    if (!planning_scene_monitor_)
+      return;
+    // readers use the latest snapshot, if there is one, so they do not wait for scene updates
+    if (read_only && planning_scene_monitor_->sceneSnapshotsEnabled())
+      snapshot_ = planning_scene_monitor_->getSceneSnapshot();
+    lock_.reset(new SingleUnlock(planning_scene_monitor_.get(), read_only, static_cast<bool>(snapshot_)));
+  }
+
+  const planning_scene::PlanningSceneConstPtr& getScene() const
+  {
+    if (snapshot_)
+      return snapshot_;
+    return static_cast<const PlanningSceneMonitor*>(planning_scene_monitor_.get())->getPlanningScene();
   }
 
   MOVEIT_CLASS_FORWARD(SingleUnlock);
@@ -626,26 +838,32 @@ protected:
   // even if the LockedPlanningScene instance is copied around
   struct SingleUnlock
   {
-    SingleUnlock(PlanningSceneMonitor* planning_scene_monitor, bool read_only)
-      : planning_scene_monitor_(planning_scene_monitor), read_only_(read_only)
+    SingleUnlock(PlanningSceneMonitor* planning_scene_monitor, bool read_only, bool snapshot)
+      : planning_scene_monitor_(planning_scene_monitor), read_only_(read_only), snapshot_(snapshot)
     {
-      if (read_only)
+      if (snapshot)
+        planning_scene_monitor_->lockSnapshotRead();
+      else if (read_only)
         planning_scene_monitor_->lockSceneRead();
       else
         planning_scene_monitor_->lockSceneWrite();
     }
     ~SingleUnlock()
     {
-      if (read_only_)
+      if (snapshot_)
+        planning_scene_monitor_->unlockSnapshotRead();
+      else if (read_only_)
         planning_scene_monitor_->unlockSceneRead();
       else
         planning_scene_monitor_->unlockSceneWrite();
     }
     PlanningSceneMonitor* planning_scene_monitor_;
     bool read_only_;
+    bool snapshot_;
   };
 
   PlanningSceneMonitorPtr planning_scene_monitor_;
+  planning_scene::PlanningSceneConstPtr snapshot_;
   SingleUnlockPtr lock_;
 };
 
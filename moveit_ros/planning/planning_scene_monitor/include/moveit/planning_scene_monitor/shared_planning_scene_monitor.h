@@ -0,0 +1,65 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#ifndef MOVEIT_PLANNING_SCENE_MONITOR_SHARED_PLANNING_SCENE_MONITOR_
+#define MOVEIT_PLANNING_SCENE_MONITOR_SHARED_PLANNING_SCENE_MONITOR_
+
+#include <moveit/planning_scene_monitor/planning_scene_monitor.h>
+
+namespace planning_scene_monitor
+{
+/** @brief Get the planning scene monitor shared by all users within this process.
+ *
+ *  Nodelets loaded into the same manager run in one process; instead of each of them maintaining its own
+ *  PlanningSceneMonitor fed by serialized scene diffs, they can all use the same instance, and therefore the same
+ *  PlanningScene, octomap and robot model. Monitors are identified by \e robot_description and \e name; the first
+ *  call creates the monitor, later calls return the same instance for as long as any caller keeps a pointer to it.
+ *
+ *  The monitor is returned unconfigured when it is created; the creator is expected to start the monitors it
+ *  needs (startSceneMonitor(), startStateMonitor(), startWorldGeometryMonitor(), ...), everybody else should only
+ *  access the scene through LockedPlanningSceneRO / LockedPlanningSceneRW and register update callbacks.
+ *
+ *  @param robot_description The name of the ROS parameter that contains the URDF (in string format)
+ *  @param tf A pointer to a tf::Transformer; only used when the monitor is created
+ *  @param name A name identifying the shared monitor
+ *  @param created If not NULL, set to true if this call created the monitor
+ *  @return The shared monitor, or an empty pointer if it could not be created (no robot model) */
+PlanningSceneMonitorPtr
+getSharedPlanningSceneMonitor(const std::string& robot_description = "robot_description",
+                              const boost::shared_ptr<tf::Transformer>& tf = boost::shared_ptr<tf::Transformer>(),
+                              const std::string& name = "shared_planning_scene_monitor", bool* created = NULL);
+}
+
+#endif
@@ -41,6 +41,7 @@
 #include <moveit/planning_scene_monitor/current_state_monitor.h>
 #include <moveit/robot_trajectory/robot_trajectory.h>
 #include <boost/thread.hpp>
+#include <boost/thread/mutex.hpp>
 #include <memory>
 
 namespace planning_scene_monitor
@@ -51,7 +52,12 @@ typedef boost::function<void(const robot_state::RobotStateConstPtr& state, const
 MOVEIT_CLASS_FORWARD(TrajectoryMonitor);
 
 /** @class TrajectoryMonitor
-    @brief Monitors the joint_states topic and tf to record the trajectory of the robot. */
+    @brief Monitors the joint_states topic and tf to record the trajectory of the robot.
+
+    By default every sample is appended to a RobotTrajectory. With setRingBufferCapacity(), the monitor instead keeps
+    the positions of the most recent samples in a preallocated ring buffer, which allows recording at controller rate
+    for arbitrarily long executions without allocating memory. The samples are converted to a RobotTrajectory only
+    when copyRecordedTrajectory() is called. */
 class TrajectoryMonitor
 {
 public:
@@ -88,13 +94,37 @@ public:
     trajectory_.swap(other);
   }
 
+  /** @brief Set the function called for every recorded state. In ring buffer mode this requires a copy of the state
+      per sample, which the ring buffer otherwise avoids. */
   void setOnStateAddCallback(const TrajectoryStateAddedCallback& callback)
   {
     state_add_callback_ = callback;
   }
 
+  /** @brief Record into a ring buffer of \e capacity samples instead of the trajectory returned by getTrajectory().
+      Once the buffer is full, the oldest samples are overwritten. A capacity of 0 (the default) restores the regular
+      recording. Clears the recorded samples. In ring buffer mode, a sample is only recorded if the state monitor
+      received an update since the previous one, so the sampling frequency can be set to the controller rate. */
+  void setRingBufferCapacity(std::size_t capacity);
+
+  std::size_t getRingBufferCapacity() const
+  {
+    return ring_capacity_;
+  }
+
+  /** @brief Get the number of samples currently held by the ring buffer */
+  std::size_t getRecordedSampleCount() const;
+
+  /** @brief Get the variable positions and time stamp of the recorded sample \e index (0 is the oldest one).
+      \e positions is resized to the variable count of the robot model. Returns false if there is no such sample. */
+  bool getRecordedSample(std::size_t index, std::vector<double>& positions, ros::Time& stamp) const;
+
+  /** @brief Convert the samples of the ring buffer (oldest first) to \e trajectory, replacing its waypoints */
+  void copyRecordedTrajectory(robot_trajectory::RobotTrajectory& trajectory) const;
+
 private:
   void recordStates();
+  void recordSample(robot_state::RobotState& state, uint64_t& last_version);
 
   CurrentStateMonitorConstPtr current_state_monitor_;
   double sampling_frequency_;
@@ -105,6 +135,14 @@ private:
 
   std::unique_ptr<boost::thread> record_states_thread_;
   TrajectoryStateAddedCallback state_add_callback_;
+
+  // ring buffer of variable positions, ring_capacity_ samples of the model's variable count each
+  std::size_t ring_capacity_;
+  std::vector<double> ring_positions_;
+  std::vector<ros::Time> ring_stamps_;
+  std::size_t ring_begin_;  // index of the oldest sample
+  std::size_t ring_size_;
+  mutable boost::mutex ring_lock_;
 };
 }
 
@@ -39,6 +39,135 @@
 #include <tf_conversions/tf_eigen.h>
 
 #include <limits>
+#include <thread>
+
+/** @brief Latest received value of every single-DOF variable.
+ *
+ *  Written by the joint state subscriber and read by whoever needs the current state. There is a single writer, so
+ *  the buffer is a sequence lock: the sequence number is odd while a write is in progress and readers retry if it
+ *  changed while they were copying. Neither side ever blocks the other. */
+class planning_scene_monitor::CurrentStateMonitor::JointStateBuffer
+{
+public:
+  enum
+  {
+    HAS_VELOCITY = 1,
+    HAS_EFFORT = 2
+  };
+
+  struct Value
+  {
+    int variable;
+    double position;
+    double velocity;
+    double effort;
+    unsigned int fields;
+    uint64_t stamp;
+  };
+
+  explicit JointStateBuffer(std::size_t variable_count) : entries_(variable_count), sequence_(0), stamp_(0)
+  {
+    for (Entry& e : entries_)
+      e.written = 0;
+  }
+
+  /** @brief Store the values of \e msg; \e variables maps each message entry to a variable index (-1 to skip) */
+  void write(const sensor_msgs::JointState& msg, const std::vector<int>& variables, bool copy_dynamics)
+  {
+    const uint64_t stamp = msg.header.stamp.toNSec();
+    const uint64_t seq = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    // velocities and efforts are only taken into account if present for all joints, efforts only with velocities
+    unsigned int fields = 0;
+    if (copy_dynamics && msg.velocity.size() == msg.name.size())
+      fields = msg.effort.size() == msg.name.size() ? HAS_VELOCITY | HAS_EFFORT : HAS_VELOCITY;
+    for (std::size_t i = 0; i < variables.size(); ++i)
+    {
+      if (variables[i] < 0)
+        continue;
+      Entry& e = entries_[variables[i]];
+      e.position.store(msg.position[i], std::memory_order_relaxed);
+      if (fields & HAS_VELOCITY)
+        e.velocity.store(msg.velocity[i], std::memory_order_relaxed);
+      if (fields & HAS_EFFORT)
+        e.effort.store(msg.effort[i], std::memory_order_relaxed);
+      e.fields.store(fields, std::memory_order_relaxed);
+      e.stamp.store(stamp, std::memory_order_relaxed);
+      e.written.store(seq + 2, std::memory_order_relaxed);
+    }
+    stamp_.store(stamp, std::memory_order_relaxed);
+    sequence_.store(seq + 2, std::memory_order_release);
+  }
+
+  /** @brief Copy the values written after sequence number \e since into \e values.
+   *  Returns false if nothing was written since then; otherwise \e sequence is set to the state that was read. */
+  bool read(uint64_t since, std::vector<Value>& values, uint64_t& sequence) const
+  {
+    while (true)
+    {
+      const uint64_t seq = sequence_.load(std::memory_order_acquire);
+      if (seq == since)
+        return false;
+      if (seq & 1)
+      {
+        std::this_thread::yield();
+        continue;
+      }
+      values.clear();
+      for (std::size_t i = 0; i < entries_.size(); ++i)
+      {
+        const Entry& e = entries_[i];
+        if (e.written.load(std::memory_order_relaxed) <= since)
+          continue;
+        Value v;
+        v.variable = i;
+        v.position = e.position.load(std::memory_order_relaxed);
+        v.velocity = e.velocity.load(std::memory_order_relaxed);
+        v.effort = e.effort.load(std::memory_order_relaxed);
+        v.fields = e.fields.load(std::memory_order_relaxed);
+        v.stamp = e.stamp.load(std::memory_order_relaxed);
+        values.push_back(v);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (sequence_.load(std::memory_order_relaxed) == seq)
+      {
+        sequence = seq;
+        return true;
+      }
+    }
+  }
+
+  /** @brief Time stamp of the most recently written message */
+  ros::Time getStamp() const
+  {
+    ros::Time t;
+    t.fromNSec(stamp_.load());
+    return t;
+  }
+
+  /** @brief Publish the stamp of the last write with full ordering, to pair with a load of the waiter count */
+  void publishStamp()
+  {
+    stamp_.store(stamp_.load(std::memory_order_relaxed));
+  }
+
+private:
+  struct Entry
+  {
+    std::atomic<double> position;
+    std::atomic<double> velocity;
+    std::atomic<double> effort;
+    std::atomic<unsigned int> fields;
+    std::atomic<uint64_t> stamp;
+    std::atomic<uint64_t> written;  // sequence number of the write that last set this entry
+  };
+
+  std::vector<Entry> entries_;
+  std::atomic<uint64_t> sequence_;
+  std::atomic<uint64_t> stamp_;
+};
 
 planning_scene_monitor::CurrentStateMonitor::CurrentStateMonitor(const robot_model::RobotModelConstPtr& robot_model,
                                                                  const boost::shared_ptr<tf::Transformer>& tf)
@@ -56,6 +185,12 @@ planning_scene_monitor::CurrentStateMonitor::CurrentStateMonitor(const robot_mod
   , state_monitor_started_(false)
   , copy_dynamics_(false)
   , error_(std::numeric_limits<double>::epsilon())
+  , joint_state_buffer_(new JointStateBuffer(robot_model->getVariableCount()))
+  , applied_sequence_(0)
+  , state_changed_(false)
+  , waiters_(0)
+  , state_version_(0)
+  , snapshot_version_(0)
 {
   robot_state_.setToDefaultValues();
 }
@@ -68,13 +203,33 @@ planning_scene_monitor::CurrentStateMonitor::~CurrentStateMonitor()
 robot_state::RobotStatePtr planning_scene_monitor::CurrentStateMonitor::getCurrentState() const
 {
   boost::mutex::scoped_lock slock(state_update_lock_);
+  applyBufferedJointStates();
   robot_state::RobotState* result = new robot_state::RobotState(robot_state_);
   return robot_state::RobotStatePtr(result);
 }
 
+robot_state::RobotStateConstPtr
+planning_scene_monitor::CurrentStateMonitor::getCurrentStateSnapshot(uint64_t* version) const
+{
+  boost::mutex::scoped_lock slock(state_update_lock_);
+  // the version is incremented after the joint states are stored, so applying them below covers at least this version
+  const uint64_t current_version = state_version_.load();
+  if (!snapshot_ || snapshot_version_ != current_version)
+  {
+    applyBufferedJointStates();
+    snapshot_.reset(new robot_state::RobotState(robot_state_));
+    snapshot_->update();
+    snapshot_version_ = current_version;
+  }
+  if (version)
+    *version = snapshot_version_;
+  return snapshot_;
+}
+
 ros::Time planning_scene_monitor::CurrentStateMonitor::getCurrentStateTime() const
 {
   boost::mutex::scoped_lock slock(state_update_lock_);
+  applyBufferedJointStates();
   return current_state_time_;
 }
 
@@ -82,6 +237,7 @@ std::pair<robot_state::RobotStatePtr, ros::Time>
 planning_scene_monitor::CurrentStateMonitor::getCurrentStateAndTime() const
 {
   boost::mutex::scoped_lock slock(state_update_lock_);
+  applyBufferedJointStates();
   robot_state::RobotState* result = new robot_state::RobotState(robot_state_);
   return std::make_pair(robot_state::RobotStatePtr(result), current_state_time_);
 }
@@ -90,6 +246,7 @@ std::map<std::string, double> planning_scene_monitor::CurrentStateMonitor::getCu
 {
   std::map<std::string, double> m;
   boost::mutex::scoped_lock slock(state_update_lock_);
+  applyBufferedJointStates();
   const double* pos = robot_state_.getVariablePositions();
   const std::vector<std::string>& names = robot_state_.getVariableNames();
   for (std::size_t i = 0; i < names.size(); ++i)
@@ -98,8 +255,17 @@ std::map<std::string, double> planning_scene_monitor::CurrentStateMonitor::getCu
 }
 
 void planning_scene_monitor::CurrentStateMonitor::setToCurrentState(robot_state::RobotState& upd) const
+{
+  ros::Time stamp;
+  setToCurrentState(upd, stamp);
+}
+
+void planning_scene_monitor::CurrentStateMonitor::setToCurrentState(robot_state::RobotState& upd,
+                                                                    ros::Time& stamp) const
 {
   boost::mutex::scoped_lock slock(state_update_lock_);
+  applyBufferedJointStates();
+  stamp = current_state_time_;
   const double* pos = robot_state_.getVariablePositions();
   upd.setVariablePositions(pos);
   if (copy_dynamics_)
@@ -142,6 +308,9 @@ void planning_scene_monitor::CurrentStateMonitor::startStateMonitor(const std::s
       ROS_ERROR("The joint states topic cannot be an empty string");
     else
       joint_state_subscriber_ = nh_.subscribe(joint_states_topic, 25, &CurrentStateMonitor::jointStateCallback, this);
+    if (!coalescing_period_.isZero())
+      coalescing_timer_ =
+          nh_.createWallTimer(coalescing_period_, &CurrentStateMonitor::coalescingTimerCallback, this, false, true);
     if (tf_ && robot_model_->getMultiDOFJointModels().size() > 0)
     {
       tf_connection_.reset(
@@ -163,6 +332,8 @@ void planning_scene_monitor::CurrentStateMonitor::stopStateMonitor()
   if (state_monitor_started_)
   {
     joint_state_subscriber_.shutdown();
+    coalescing_timer_.stop();
+    boost::atomic_store(&pending_joint_state_, sensor_msgs::JointStateConstPtr());
     if (tf_ && tf_connection_)
     {
       tf_->removeTransformsChangedListener(*tf_connection_);
@@ -186,6 +357,7 @@ bool planning_scene_monitor::CurrentStateMonitor::haveCompleteState() const
   bool result = true;
   const std::vector<const moveit::core::JointModel*>& joints = robot_model_->getActiveJointModels();
   boost::mutex::scoped_lock slock(state_update_lock_);
+  applyBufferedJointStates();
   for (const moveit::core::JointModel* joint : joints)
     if (joint_time_.find(joint) == joint_time_.end())
     {
@@ -203,6 +375,7 @@ bool planning_scene_monitor::CurrentStateMonitor::haveCompleteState(std::vector<
   bool result = true;
   const std::vector<const moveit::core::JointModel*>& joints = robot_model_->getActiveJointModels();
   boost::mutex::scoped_lock slock(state_update_lock_);
+  applyBufferedJointStates();
   for (const moveit::core::JointModel* joint : joints)
     if (joint_time_.find(joint) == joint_time_.end())
       if (!joint->isPassive() && !joint->getMimic())
@@ -220,6 +393,7 @@ bool planning_scene_monitor::CurrentStateMonitor::haveCompleteState(const ros::D
   ros::Time now = ros::Time::now();
   ros::Time old = now - age;
   boost::mutex::scoped_lock slock(state_update_lock_);
+  applyBufferedJointStates();
   for (const moveit::core::JointModel* joint : joints)
   {
     if (joint->isPassive() || joint->getMimic())
@@ -248,6 +422,7 @@ bool planning_scene_monitor::CurrentStateMonitor::haveCompleteState(const ros::D
   ros::Time now = ros::Time::now();
   ros::Time old = now - age;
   boost::mutex::scoped_lock slock(state_update_lock_);
+  applyBufferedJointStates();
   for (const moveit::core::JointModel* joint : joints)
   {
     if (joint->isPassive() || joint->getMimic())
@@ -277,18 +452,22 @@ bool planning_scene_monitor::CurrentStateMonitor::waitForCurrentState(const ros:
   ros::WallDuration timeout(wait_time);
 
   boost::mutex::scoped_lock lock(state_update_lock_);
-  while (current_state_time_ < t)
+  // the joint state callback only takes the lock to notify us while someone is waiting
+  ++waiters_;
+  while (std::max(current_state_time_, joint_state_buffer_->getStamp()) < t)
   {
     state_update_condition_.wait_for(lock, boost::chrono::nanoseconds((timeout - elapsed).toNSec()));
     elapsed = ros::WallTime::now() - start;
     if (elapsed > timeout)
     {
+      --waiters_;
       ROS_INFO_STREAM("Didn't received robot state (joint angles) with recent timestamp within "
                       << wait_time << " seconds.\n"
                       << "Check clock synchronization if your are running ROS across multiple machines!");
       return false;
     }
   }
+  --waiters_;
   return true;
 }
 
@@ -349,61 +528,67 @@ void planning_scene_monitor::CurrentStateMonitor::jointStateCallback(const senso
                           "positions)");
     return;
   }
-  bool update = false;
 
+  // publishers send the same joint names in every message, so the name lookup is only redone when they change
+  if (joint_state->name != joint_names_)
   {
-    boost::mutex::scoped_lock _(state_update_lock_);
-    // read the received values, and update their time stamps
-    std::size_t n = joint_state->name.size();
-    current_state_time_ = joint_state->header.stamp;
-    for (std::size_t i = 0; i < n; ++i)
+    joint_names_ = joint_state->name;
+    joint_variables_.resize(joint_names_.size());
+    for (std::size_t i = 0; i < joint_names_.size(); ++i)
     {
-      const moveit::core::JointModel* jm = robot_model_->getJointModel(joint_state->name[i]);
-      if (!jm)
-        continue;
+      const moveit::core::JointModel* jm = robot_model_->getJointModel(joint_names_[i]);
       // ignore fixed joints, multi-dof joints (they should not even be in the message)
-      if (jm->getVariableCount() != 1)
-        continue;
+      joint_variables_[i] = jm && jm->getVariableCount() == 1 ? jm->getFirstVariableIndex() : -1;
+    }
+  }
+  joint_state_buffer_->write(*joint_state, joint_variables_, copy_dynamics_);
+  ++state_version_;
 
-      joint_time_[jm] = joint_state->header.stamp;
+  if (coalescing_period_.isZero())
+  {
+    dispatchJointState(joint_state);
+    return;
+  }
 
-      if (robot_state_.getJointPositions(jm)[0] != joint_state->position[i])
-      {
-        update = true;
-        robot_state_.setJointPositions(jm, &(joint_state->position[i]));
-
-        // optionally copy velocities and effort
-        if (copy_dynamics_)
-        {
-          // check if velocities exist
-          if (joint_state->name.size() == joint_state->velocity.size())
-          {
-            robot_state_.setJointVelocities(jm, &(joint_state->velocity[i]));
-
-            // check if effort exist. assume they are not useful if no velocities were passed in
-            if (joint_state->name.size() == joint_state->effort.size())
-            {
-              robot_state_.setJointEfforts(jm, &(joint_state->effort[i]));
-            }
-          }
-        }
-
-        // continuous joints wrap, so we don't modify them (even if they are outside bounds!)
-        if (jm->getType() == moveit::core::JointModel::REVOLUTE)
-          if (static_cast<const moveit::core::RevoluteJointModel*>(jm)->isContinuous())
-            continue;
-
-        const robot_model::VariableBounds& b =
-            jm->getVariableBounds()[0];  // only one variable in the joint, so we get its bounds
-
-        // if the read variable is 'almost' within bounds (up to error_ difference), then consider it to be within
-        // bounds
-        if (joint_state->position[i] < b.min_position_ && joint_state->position[i] >= b.min_position_ - error_)
-          robot_state_.setJointPositions(jm, &b.min_position_);
-        else if (joint_state->position[i] > b.max_position_ && joint_state->position[i] <= b.max_position_ + error_)
-          robot_state_.setJointPositions(jm, &b.max_position_);
-      }
+  // wake up waitForCurrentState() even if this message is not dispatched now;
+  // the waiter holds the lock from checking the stamp until it waits, so no notification is lost
+  joint_state_buffer_->publishStamp();
+  if (waiters_.load() > 0)
+  {
+    {
+      boost::mutex::scoped_lock _(state_update_lock_);
     }
+    state_update_condition_.notify_all();
+  }
+
+  // leading edge: dispatch right away after a quiet period, otherwise leave it to the timer
+  ros::WallTime now = ros::WallTime::now();
+  if (now - last_dispatch_time_ >= coalescing_period_)
+  {
+    last_dispatch_time_ = now;
+    boost::atomic_store(&pending_joint_state_, sensor_msgs::JointStateConstPtr());
+    dispatchJointState(joint_state);
+  }
+  else
+    boost::atomic_store(&pending_joint_state_, joint_state);
+}
+
+void planning_scene_monitor::CurrentStateMonitor::coalescingTimerCallback(const ros::WallTimerEvent& /*event*/)
+{
+  sensor_msgs::JointStateConstPtr joint_state =
+      boost::atomic_exchange(&pending_joint_state_, sensor_msgs::JointStateConstPtr());
+  if (joint_state)
+    dispatchJointState(joint_state);
+}
+
+void planning_scene_monitor::CurrentStateMonitor::dispatchJointState(const sensor_msgs::JointStateConstPtr& joint_state)
+{
+  bool update;
+  {
+    boost::mutex::scoped_lock _(state_update_lock_);
+    applyBufferedJointStates();
+    update = state_changed_;
+    state_changed_ = false;
   }
 
   // callbacks, if needed
@@ -415,6 +600,53 @@ void planning_scene_monitor::CurrentStateMonitor::jointStateCallback(const senso
   state_update_condition_.notify_all();
 }
 
+bool planning_scene_monitor::CurrentStateMonitor::applyBufferedJointStates() const
+{
+  std::vector<JointStateBuffer::Value> values;
+  uint64_t sequence;
+  if (!joint_state_buffer_->read(applied_sequence_, values, sequence))
+    return false;
+  applied_sequence_ = sequence;
+  current_state_time_ = joint_state_buffer_->getStamp();
+
+  bool update = false;
+  for (const JointStateBuffer::Value& v : values)
+  {
+    const moveit::core::JointModel* jm = robot_model_->getJointOfVariable(v.variable);
+    joint_time_[jm].fromNSec(v.stamp);
+
+    if (robot_state_.getJointPositions(jm)[0] != v.position)
+    {
+      update = true;
+      robot_state_.setJointPositions(jm, &v.position);
+
+      // optionally copy velocities and effort
+      if (v.fields & JointStateBuffer::HAS_VELOCITY)
+        robot_state_.setJointVelocities(jm, &v.velocity);
+      if (v.fields & JointStateBuffer::HAS_EFFORT)
+        robot_state_.setJointEfforts(jm, &v.effort);
+
+      // continuous joints wrap, so we don't modify them (even if they are outside bounds!)
+      if (jm->getType() == moveit::core::JointModel::REVOLUTE)
+        if (static_cast<const moveit::core::RevoluteJointModel*>(jm)->isContinuous())
+          continue;
+
+      const robot_model::VariableBounds& b =
+          jm->getVariableBounds()[0];  // only one variable in the joint, so we get its bounds
+
+      // if the read variable is 'almost' within bounds (up to error_ difference), then consider it to be within
+      // bounds
+      if (v.position < b.min_position_ && v.position >= b.min_position_ - error_)
+        robot_state_.setJointPositions(jm, &b.min_position_);
+      else if (v.position > b.max_position_ && v.position <= b.max_position_ + error_)
+        robot_state_.setJointPositions(jm, &b.max_position_);
+    }
+  }
+  if (update)
+    state_changed_ = true;
+  return update;
+}
+
 void planning_scene_monitor::CurrentStateMonitor::tfCallback()
 {
   // read multi-dof joint states from TF, if needed
@@ -473,6 +705,8 @@ void planning_scene_monitor::CurrentStateMonitor::tfCallback()
       robot_state_.setJointPositions(joint, new_values);
       update = true;
     }
+    if (update)
+      ++state_version_;
   }
 
   // callbacks, if needed
@@ -43,7 +43,9 @@
 #include <moveit_ros_planning/PlanningSceneMonitorDynamicReconfigureConfig.h>
 #include <tf_conversions/tf_eigen.h>
 #include <moveit/profiler/profiler.h>
+#include <moveit/profiler/probes.h>
 
+#include <algorithm>
 #include <memory>
 
 namespace planning_scene_monitor
@@ -151,6 +153,20 @@ planning_scene_monitor::PlanningSceneMonitor::PlanningSceneMonitor(
 
 planning_scene_monitor::PlanningSceneMonitor::~PlanningSceneMonitor()
 {
+  // no more priority callbacks while the monitors are taken down
+  if (priority_spinner_)
+    priority_spinner_->stop();
+  collision_object_flush_timer_.stop();
+  if (ingestion_thread_)
+  {
+    {
+      boost::mutex::scoped_lock lock(ingestion_mutex_);
+      ingestion_stop_ = true;
+      ingestion_condition_.notify_all();
+    }
+    ingestion_thread_->join();
+    ingestion_thread_.reset();
+  }
   if (scene_)
   {
     scene_->setCollisionObjectUpdateCallback(collision_detection::World::ObserverCallbackFn());
@@ -177,6 +193,7 @@ void planning_scene_monitor::PlanningSceneMonitor::initialize(const planning_sce
 
   if (monitor_name_.empty())
     monitor_name_ = "planning_scene_monitor";
+  snapshots_enabled_ = false;
   robot_description_ = rm_loader_->getRobotDescription();
   if (rm_loader_->getModel())
   {
@@ -230,6 +247,8 @@ void planning_scene_monitor::PlanningSceneMonitor::initialize(const planning_sce
 
   publish_planning_scene_frequency_ = 2.0;
   new_scene_update_ = UPDATE_NONE;
+  octomap_keyframe_period_ = 0;
+  octomap_deltas_since_keyframe_ = 0;
 
   last_update_time_ = last_robot_motion_time_ = ros::Time::now();
   last_robot_state_update_wall_time_ = ros::WallTime::now();
@@ -242,10 +261,41 @@ void planning_scene_monitor::PlanningSceneMonitor::initialize(const planning_sce
 
   shape_transform_cache_lookup_wait_time_ = ros::Duration(temp_wait_time);
 
+  // without a priority lane, priority_nh_ uses the global callback queue like all other sources
+  priority_nh_ = root_nh_;
+  bool priority_update_lane = false;
+  nh_.param("priority_update_lane", priority_update_lane, priority_update_lane);
+  if (priority_update_lane)
+  {
+    priority_nh_.setCallbackQueue(&priority_callback_queue_);
+    priority_spinner_.reset(new ros::AsyncSpinner(1, &priority_callback_queue_));
+    priority_spinner_->start();
+    ROS_INFO_NAMED(LOGNAME, "Serving joint state and attached object updates on a separate callback queue");
+  }
+
+  collision_object_flush_pending_ = false;
+  double coalescing_period = 0.0;
+  nh_.param("collision_object_coalescing_period", coalescing_period, coalescing_period);
+  collision_object_coalescing_period_ = ros::WallDuration(std::max(coalescing_period, 0.0));
+
+  double history_duration = 0.0;
+  nh_.param("scene_history_duration", history_duration, history_duration);
+  setSceneHistory(history_duration);
+
+  ingestion_busy_ = false;
+  ingestion_stop_ = false;
+  int triangle_threshold = 10000;
+  nh_.param("background_mesh_triangle_threshold", triangle_threshold, triangle_threshold);
+  background_mesh_triangle_threshold_ = std::max(triangle_threshold, 0);
+  if (background_mesh_triangle_threshold_ > 0)
+    ingestion_thread_.reset(
+        new boost::thread(boost::bind(&PlanningSceneMonitor::collisionObjectIngestionThread, this)));
+
   state_update_pending_ = false;
-  state_update_timer_ = nh_.createWallTimer(dt_state_update_, &PlanningSceneMonitor::stateUpdateTimerCallback, this,
-                                            false,   // not a oneshot timer
-                                            false);  // do not start the timer yet
+  state_update_timer_ = priority_nh_.createWallTimer(dt_state_update_, &PlanningSceneMonitor::stateUpdateTimerCallback,
+                                                     this,
+                                                     false,   // not a oneshot timer
+                                                     false);  // do not start the timer yet
 
   reconfigure_impl_ = new DynamicReconfigureImpl(this);
 }
@@ -324,6 +374,31 @@ void planning_scene_monitor::PlanningSceneMonitor::startPublishingPlanningScene(
   }
 }
 
+void planning_scene_monitor::PlanningSceneMonitor::publishOctomapDeltas(unsigned int keyframe_period)
+{
+  boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
+  octomap_keyframe_period_ = keyframe_period;
+  octomap_deltas_since_keyframe_ = 0;
+}
+
+void planning_scene_monitor::PlanningSceneMonitor::processOctomapDelta(moveit_msgs::PlanningScene& msg, bool is_full)
+{
+  if (!octomap_monitor_ || octomap_keyframe_period_ == 0 || msg.world.octomap.octomap.data.empty())
+    return;
+
+  // called with the octree read lock held; updaters only touch the changed key set under the write lock
+  const occupancy_map_monitor::OccMapTreePtr& tree = octomap_monitor_->getOcTreePtr();
+  if (!is_full && tree->isChangeDetectionEnabled() && ++octomap_deltas_since_keyframe_ < octomap_keyframe_period_)
+    planning_scene::PlanningScene::getOctomapDeltaMsg(*tree, msg.world.octomap.octomap);
+  else
+  {
+    // the full octomap in this message is the keyframe later deltas are relative to
+    tree->enableChangeDetection(true);
+    octomap_deltas_since_keyframe_ = 0;
+  }
+  tree->resetChangeDetection();
+}
+
 void planning_scene_monitor::PlanningSceneMonitor::scenePublishingThread()
 {
   ROS_DEBUG_NAMED(LOGNAME, "Started scene publishing thread ...");
@@ -336,6 +411,7 @@ void planning_scene_monitor::PlanningSceneMonitor::scenePublishingThread()
       if (octomap_monitor_)
         lock = octomap_monitor_->getOcTreePtr()->reading();
       scene_->getPlanningSceneMsg(msg);
+      processOctomapDelta(msg, true);
     }
     planning_scene_publisher_.publish(msg);
     ROS_DEBUG_NAMED(LOGNAME, "Published the full planning scene: '%s'", msg.name.c_str());
@@ -363,6 +439,7 @@ void planning_scene_monitor::PlanningSceneMonitor::scenePublishingThread()
             if (octomap_monitor_)
               lock = octomap_monitor_->getOcTreePtr()->reading();
             scene_->getPlanningSceneDiffMsg(msg);
+            processOctomapDelta(msg, false);
           }
           boost::recursive_mutex::scoped_lock prevent_shape_cache_updates(shape_handles_lock_);  // we don't want the
                                                                                                  // transform cache to
@@ -388,6 +465,7 @@ void planning_scene_monitor::PlanningSceneMonitor::scenePublishingThread()
             if (octomap_monitor_)
               lock = octomap_monitor_->getOcTreePtr()->reading();
             scene_->getPlanningSceneMsg(msg);
+            processOctomapDelta(msg, true);
           }
           // also publish timestamp of this robot_state
           msg.robot_state.joint_state.header.stamp = last_robot_motion_time_;
@@ -448,8 +526,45 @@ bool planning_scene_monitor::PlanningSceneMonitor::updatesScene(
   return sceneIsParentOf(scene_const_, scene.get());
 }
 
+void planning_scene_monitor::PlanningSceneMonitor::enableSceneSnapshots(bool flag)
+{
+  snapshots_enabled_ = flag;
+  if (flag)
+    updateSceneSnapshot();
+  else
+  {
+    boost::mutex::scoped_lock slock(scene_snapshot_mutex_);
+    std::atomic_store(&scene_snapshot_, planning_scene::PlanningSceneConstPtr());
+  }
+}
+
+planning_scene::PlanningSceneConstPtr planning_scene_monitor::PlanningSceneMonitor::getSceneSnapshot() const
+{
+  return std::atomic_load(&scene_snapshot_);
+}
+
+void planning_scene_monitor::PlanningSceneMonitor::updateSceneSnapshot()
+{
+  if (!snapshots_enabled_)
+    return;
+
+  // snapshots are created one at a time, so the published snapshot can never be older than a previous one
+  boost::mutex::scoped_lock slock(scene_snapshot_mutex_);
+  planning_scene::PlanningSceneConstPtr snapshot;
+  {
+    boost::shared_lock<boost::shared_mutex> lock(scene_update_mutex_);
+    if (scene_)
+      snapshot = planning_scene::PlanningScene::clone(scene_);
+  }
+  std::atomic_store(&scene_snapshot_, snapshot);
+}
+
 void planning_scene_monitor::PlanningSceneMonitor::triggerSceneUpdateEvent(SceneUpdateType update_type)
 {
+  // make the update visible to snapshot readers before notifying anyone about it
+  updateSceneSnapshot();
+  recordSceneHistory(update_type);
+
   // do not modify update functions while we are calling them
   boost::recursive_mutex::scoped_lock lock(update_lock_);
 
@@ -459,6 +574,90 @@ void planning_scene_monitor::PlanningSceneMonitor::triggerSceneUpdateEvent(Scene
   new_scene_update_condition_.notify_all();
 }
 
+void planning_scene_monitor::PlanningSceneMonitor::setSceneHistory(double duration, std::size_t max_entries)
+{
+  boost::mutex::scoped_lock lock(scene_history_mutex_);
+  scene_history_duration_ = ros::Duration(std::max(duration, 0.0));
+  scene_history_max_entries_ = std::max<std::size_t>(max_entries, 1);
+  scene_history_.clear();
+}
+
+void planning_scene_monitor::PlanningSceneMonitor::recordSceneHistory(SceneUpdateType update_type)
+{
+  {
+    boost::mutex::scoped_lock lock(scene_history_mutex_);
+    if (scene_history_duration_.isZero())
+      return;
+  }
+
+  SceneHistoryEntry entry;
+  {
+    boost::shared_lock<boost::shared_mutex> lock(scene_update_mutex_);
+    if (!scene_)
+      return;
+    entry.stamp = (update_type & UPDATE_STATE) ? last_robot_motion_time_ : last_update_time_;
+    entry.state.reset(new robot_state::RobotState(scene_->getCurrentState()));
+  }
+  entry.scene = getSceneSnapshot();
+
+  boost::mutex::scoped_lock lock(scene_history_mutex_);
+  // stamps of different sources are not necessarily monotonic; keep the history sorted
+  std::deque<SceneHistoryEntry>::iterator pos = scene_history_.end();
+  while (pos != scene_history_.begin() && (pos - 1)->stamp > entry.stamp)
+    --pos;
+  scene_history_.insert(pos, entry);
+
+  const ros::Time oldest = scene_history_.back().stamp - scene_history_duration_;
+  // keep the newest entry older than the window, so the whole window can be interpolated
+  while (scene_history_.size() > scene_history_max_entries_ ||
+         (scene_history_.size() > 1 && scene_history_[1].stamp <= oldest))
+    scene_history_.pop_front();
+}
+
+bool planning_scene_monitor::PlanningSceneMonitor::getStateAtTime(const ros::Time& t,
+                                                                 robot_state::RobotState& state) const
+{
+  boost::mutex::scoped_lock lock(scene_history_mutex_);
+  if (scene_history_.empty() || t < scene_history_.front().stamp)
+    return false;
+
+  // first entry newer than t
+  std::deque<SceneHistoryEntry>::const_iterator next = scene_history_.begin();
+  while (next != scene_history_.end() && next->stamp <= t)
+    ++next;
+  const SceneHistoryEntry& prev = *(next - 1);
+  state = *prev.state;
+  if (next != scene_history_.end())
+  {
+    const double span = (next->stamp - prev.stamp).toSec();
+    if (span > 0.0)
+      prev.state->interpolate(*next->state, (t - prev.stamp).toSec() / span, state);
+  }
+  state.update();
+  return true;
+}
+
+planning_scene::PlanningScenePtr
+planning_scene_monitor::PlanningSceneMonitor::getSceneAtTime(const ros::Time& t) const
+{
+  robot_state::RobotState state(robot_model_);
+  if (!getStateAtTime(t, state))
+    return planning_scene::PlanningScenePtr();
+
+  planning_scene::PlanningSceneConstPtr parent;
+  {
+    boost::mutex::scoped_lock lock(scene_history_mutex_);
+    for (std::size_t i = 0; i < scene_history_.size() && scene_history_[i].stamp <= t; ++i)
+      parent = scene_history_[i].scene;
+  }
+  if (!parent)
+    parent = scene_;
+
+  planning_scene::PlanningScenePtr scene = parent->diff();
+  scene->setCurrentState(state);
+  return scene;
+}
+
 bool planning_scene_monitor::PlanningSceneMonitor::requestPlanningSceneState(const std::string& service_name)
 {
   // use global namespace for service
@@ -494,7 +693,10 @@ bool planning_scene_monitor::PlanningSceneMonitor::requestPlanningSceneState(con
 void planning_scene_monitor::PlanningSceneMonitor::newPlanningSceneCallback(
     const moveit_msgs::PlanningSceneConstPtr& scene)
 {
+  ros::WallTime received = ros::WallTime::now();
+  recordUpdateReceived("planning_scene");
   newPlanningSceneMessage(*scene);
+  recordUpdateApplied("planning_scene", received, received);
 }
 
 void planning_scene_monitor::PlanningSceneMonitor::clearOctomap()
@@ -559,29 +761,94 @@ bool planning_scene_monitor::PlanningSceneMonitor::newPlanningSceneMessage(const
 
   // if we have a diff, try to more accuratelly determine the update type
   if (scene.is_diff)
+    upd = getDiffUpdateType(scene, old_scene_name);
+  triggerSceneUpdateEvent(upd);
+  return result;
+}
+
+planning_scene_monitor::PlanningSceneMonitor::SceneUpdateType
+planning_scene_monitor::PlanningSceneMonitor::getDiffUpdateType(const moveit_msgs::PlanningScene& scene,
+                                                                const std::string& old_scene_name)
+{
+  bool no_other_scene_upd = (scene.name.empty() || scene.name == old_scene_name) &&
+                            scene.allowed_collision_matrix.entry_names.empty() && scene.link_padding.empty() &&
+                            scene.link_scale.empty();
+  if (!no_other_scene_upd)
+    return UPDATE_SCENE;
+
+  SceneUpdateType upd = UPDATE_NONE;
+  if (!planning_scene::PlanningScene::isEmpty(scene.world))
+    upd = (SceneUpdateType)((int)upd | (int)UPDATE_GEOMETRY);
+
+  if (!scene.fixed_frame_transforms.empty())
+    upd = (SceneUpdateType)((int)upd | (int)UPDATE_TRANSFORMS);
+
+  if (!planning_scene::PlanningScene::isEmpty(scene.robot_state))
   {
-    bool no_other_scene_upd = (scene.name.empty() || scene.name == old_scene_name) &&
-                              scene.allowed_collision_matrix.entry_names.empty() && scene.link_padding.empty() &&
-                              scene.link_scale.empty();
-    if (no_other_scene_upd)
+    upd = (SceneUpdateType)((int)upd | (int)UPDATE_STATE);
+    if (!scene.robot_state.attached_collision_objects.empty() || scene.robot_state.is_diff == false)
+      upd = (SceneUpdateType)((int)upd | (int)UPDATE_GEOMETRY);
+  }
+  return upd;
+}
+
+bool planning_scene_monitor::PlanningSceneMonitor::newPlanningSceneMessages(
+    const std::vector<moveit_msgs::PlanningScene>& scenes)
+{
+  if (!scene_)
+    return false;
+
+  for (const moveit_msgs::PlanningScene& scene : scenes)
+    if (!scene.is_diff)
     {
-      upd = UPDATE_NONE;
-      if (!planning_scene::PlanningScene::isEmpty(scene.world))
-        upd = (SceneUpdateType)((int)upd | (int)UPDATE_GEOMETRY);
+      ROS_ERROR_NAMED(LOGNAME, "Only planning scene diffs can be applied as a batch");
+      return false;
+    }
 
-      if (!scene.fixed_frame_transforms.empty())
-        upd = (SceneUpdateType)((int)upd | (int)UPDATE_TRANSFORMS);
+  SceneUpdateType upd = UPDATE_NONE;
+  {
+    boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
+    // we don't want the transform cache to update while we are potentially changing attached bodies
+    boost::recursive_mutex::scoped_lock prevent_shape_cache_updates(shape_handles_lock_);
 
-      if (!planning_scene::PlanningScene::isEmpty(scene.robot_state))
+    // apply the batch to a diff of the scene first, so a failing message leaves the scene untouched
+    planning_scene::PlanningScenePtr staged = scene_->diff();
+    const std::string scene_name = scene_->getName();
+    std::string new_name;
+    ros::Time robot_stamp;
+    for (std::size_t i = 0; i < scenes.size(); ++i)
+    {
+      if (!staged->usePlanningSceneMsg(scenes[i]))
       {
-        upd = (SceneUpdateType)((int)upd | (int)UPDATE_STATE);
-        if (!scene.robot_state.attached_collision_objects.empty() || scene.robot_state.is_diff == false)
-          upd = (SceneUpdateType)((int)upd | (int)UPDATE_GEOMETRY);
+        ROS_ERROR_NAMED(LOGNAME, "Planning scene diff %zu of the batch failed to apply. Discarding the batch.", i);
+        return false;
       }
+      upd = (SceneUpdateType)((int)upd | (int)getDiffUpdateType(scenes[i], new_name.empty() ? scene_name : new_name));
+      if (!scenes[i].name.empty())
+        new_name = scenes[i].name;
+      if (!scenes[i].robot_state.joint_state.header.stamp.isZero())
+        robot_stamp = scenes[i].robot_state.joint_state.header.stamp;
+    }
+    staged->pushDiffs(scene_);
+    if (!new_name.empty())
+      scene_->setName(new_name);
+    // pushDiffs() only carries the colors of objects whose geometry changed
+    for (const moveit_msgs::PlanningScene& scene : scenes)
+      for (const moveit_msgs::ObjectColor& color : scene.object_colors)
+        scene_->setObjectColor(color.id, color.color);
+
+    last_update_time_ = ros::Time::now();
+    if (upd & UPDATE_STATE)
+      last_robot_motion_time_ = robot_stamp;
+    if (octomap_monitor_)
+    {
+      excludeAttachedBodiesFromOctree();
+      excludeWorldObjectsFromOctree();
     }
   }
+
   triggerSceneUpdateEvent(upd);
-  return result;
+  return true;
 }
 
 void planning_scene_monitor::PlanningSceneMonitor::newPlanningSceneWorldCallback(
@@ -589,6 +856,8 @@ void planning_scene_monitor::PlanningSceneMonitor::newPlanningSceneWorldCallback
 {
   if (scene_)
   {
+    ros::WallTime received = ros::WallTime::now();
+    recordUpdateReceived("planning_scene_world");
     updateFrameTransforms();
     {
       boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
@@ -606,6 +875,7 @@ void planning_scene_monitor::PlanningSceneMonitor::newPlanningSceneWorldCallback
       }
     }
     triggerSceneUpdateEvent(UPDATE_SCENE);
+    recordUpdateApplied("planning_scene_world", received, received);
   }
 }
 
@@ -620,16 +890,154 @@ void planning_scene_monitor::PlanningSceneMonitor::collisionObjectFailTFCallback
 void planning_scene_monitor::PlanningSceneMonitor::collisionObjectCallback(
     const moveit_msgs::CollisionObjectConstPtr& obj)
 {
-  if (scene_)
+  if (!scene_)
+    return;
+  recordUpdateReceived("collision_object");
+
+  bool flush_now;
   {
-    updateFrameTransforms();
+    boost::mutex::scoped_lock lock(pending_collision_objects_mutex_);
+    queueCollisionObject(obj, ros::WallTime::now());
+    flush_now = collision_object_coalescing_period_.isZero();
+    if (!flush_now && !collision_object_flush_pending_)
     {
-      boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
-      last_update_time_ = ros::Time::now();
-      scene_->processCollisionObjectMsg(*obj);
+      // the first message of a window starts it
+      collision_object_flush_pending_ = true;
+      collision_object_flush_timer_ =
+          nh_.createWallTimer(collision_object_coalescing_period_,
+                              &PlanningSceneMonitor::collisionObjectFlushTimerCallback, this, true);  // oneshot
     }
-    triggerSceneUpdateEvent(UPDATE_GEOMETRY);
   }
+  if (flush_now)
+    flushPendingCollisionObjects();
+}
+
+void planning_scene_monitor::PlanningSceneMonitor::queueCollisionObject(const moveit_msgs::CollisionObjectConstPtr& obj,
+                                                                        const ros::WallTime& received)
+{
+  std::vector<PendingCollisionObject>& pending = pending_collision_objects_;
+  if (obj->operation == moveit_msgs::CollisionObject::REMOVE && obj->id.empty())
+    // removing all objects supersedes everything received before
+    pending.clear();
+  else if (obj->operation == moveit_msgs::CollisionObject::ADD ||
+           obj->operation == moveit_msgs::CollisionObject::REMOVE)
+  {
+    // adding an object replaces it completely, so earlier messages for it do not matter either
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < pending.size(); ++i)
+      if (pending[i].msg->id != obj->id)
+        pending[kept++] = pending[i];
+    pending.resize(kept);
+  }
+  else if (obj->operation == moveit_msgs::CollisionObject::MOVE)
+  {
+    // moves set absolute poses, so only the last of consecutive moves of an object needs to be applied
+    for (std::size_t i = pending.size(); i > 0; --i)
+      if (pending[i - 1].msg->id == obj->id || pending[i - 1].msg->id.empty())
+      {
+        if (pending[i - 1].msg->id == obj->id && pending[i - 1].msg->operation == moveit_msgs::CollisionObject::MOVE)
+          pending.erase(pending.begin() + (i - 1));
+        break;
+      }
+  }
+
+  PendingCollisionObject p;
+  p.msg = obj;
+  p.received = received;
+  pending.push_back(p);
+}
+
+void planning_scene_monitor::PlanningSceneMonitor::collisionObjectFlushTimerCallback(const ros::WallTimerEvent& event)
+{
+  flushPendingCollisionObjects();
+}
+
+void planning_scene_monitor::PlanningSceneMonitor::flushPendingCollisionObjects()
+{
+  std::vector<PendingCollisionObject> pending;
+  {
+    boost::mutex::scoped_lock lock(pending_collision_objects_mutex_);
+    pending.swap(pending_collision_objects_);
+    collision_object_flush_pending_ = false;
+  }
+  if (pending.empty() || !scene_)
+    return;
+
+  if (ingestion_thread_)
+  {
+    std::size_t triangles = 0;
+    for (std::size_t i = 0; i < pending.size(); ++i)
+      if (pending[i].msg->operation == moveit_msgs::CollisionObject::ADD ||
+          pending[i].msg->operation == moveit_msgs::CollisionObject::APPEND)
+        for (std::size_t j = 0; j < pending[i].msg->meshes.size(); ++j)
+          triangles += pending[i].msg->meshes[j].triangles.size();
+
+    boost::mutex::scoped_lock lock(ingestion_mutex_);
+    // once a batch is handed to the ingestion thread, later batches follow it so objects are updated in order
+    if (ingestion_busy_ || !ingestion_queue_.empty() || triangles >= background_mesh_triangle_threshold_)
+    {
+      ingestion_queue_.push_back(std::vector<PendingCollisionObject>());
+      ingestion_queue_.back().swap(pending);
+      ingestion_condition_.notify_all();
+      return;
+    }
+  }
+  applyCollisionObjects(pending);
+}
+
+void planning_scene_monitor::PlanningSceneMonitor::applyCollisionObjects(
+    const std::vector<PendingCollisionObject>& objects)
+{
+  ros::WallTime start = ros::WallTime::now();
+  // decoding meshes and building their collision geometry is the expensive part, so it happens before the scene is
+  // locked; the collision detectors keep the prepared geometry and only copy it when the object is added
+  std::vector<planning_scene::PlanningScene::PreparedCollisionObject> prepared(objects.size());
+  std::vector<bool> valid(objects.size());
+  for (std::size_t i = 0; i < objects.size(); ++i)
+    valid[i] = scene_->prepareCollisionObjectMsg(*objects[i].msg, prepared[i]);
+
+  updateFrameTransforms();
+  {
+    boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
+    last_update_time_ = ros::Time::now();
+    for (std::size_t i = 0; i < objects.size(); ++i)
+      if (valid[i])
+        scene_->processCollisionObjectMsg(*objects[i].msg, prepared[i]);
+  }
+  triggerSceneUpdateEvent(UPDATE_GEOMETRY);
+  for (std::size_t i = 0; i < objects.size(); ++i)
+    recordUpdateApplied("collision_object", objects[i].received, start);
+}
+
+void planning_scene_monitor::PlanningSceneMonitor::collisionObjectIngestionThread()
+{
+  boost::mutex::scoped_lock lock(ingestion_mutex_);
+  while (true)
+  {
+    while (!ingestion_stop_ && ingestion_queue_.empty())
+      ingestion_condition_.wait(lock);
+    if (ingestion_stop_)
+      return;
+
+    std::vector<PendingCollisionObject> objects;
+    objects.swap(ingestion_queue_.front());
+    ingestion_queue_.pop_front();
+    ingestion_busy_ = true;
+    lock.unlock();
+    applyCollisionObjects(objects);
+    lock.lock();
+    ingestion_busy_ = false;
+  }
+}
+
+void planning_scene_monitor::PlanningSceneMonitor::setCollisionObjectCoalescingPeriod(double period)
+{
+  {
+    boost::mutex::scoped_lock lock(pending_collision_objects_mutex_);
+    collision_object_coalescing_period_ = ros::WallDuration(std::max(period, 0.0));
+  }
+  // messages waiting for the old window are applied right away
+  flushPendingCollisionObjects();
 }
 
 void planning_scene_monitor::PlanningSceneMonitor::attachObjectCallback(
@@ -637,6 +1045,8 @@ void planning_scene_monitor::PlanningSceneMonitor::attachObjectCallback(
 {
   if (scene_)
   {
+    ros::WallTime received = ros::WallTime::now();
+    recordUpdateReceived("attached_collision_object");
     updateFrameTransforms();
     {
       boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
@@ -644,9 +1054,46 @@ void planning_scene_monitor::PlanningSceneMonitor::attachObjectCallback(
       scene_->processAttachedCollisionObjectMsg(*obj);
     }
     triggerSceneUpdateEvent(UPDATE_GEOMETRY);
+    recordUpdateApplied("attached_collision_object", received, received);
   }
 }
 
+void planning_scene_monitor::PlanningSceneMonitor::recordUpdateReceived(const std::string& source)
+{
+  boost::mutex::scoped_lock lock(update_statistics_mutex_);
+  ++update_statistics_[source].received;
+}
+
+void planning_scene_monitor::PlanningSceneMonitor::recordUpdateApplied(const std::string& source,
+                                                                       const ros::WallTime& received,
+                                                                       const ros::WallTime& start)
+{
+  ros::WallTime now = ros::WallTime::now();
+  double latency = (now - received).toSec();
+  double processing_time = (now - start).toSec();
+
+  boost::mutex::scoped_lock lock(update_statistics_mutex_);
+  UpdateSourceStatistics& stats = update_statistics_[source];
+  ++stats.applied;
+  stats.total_latency += latency;
+  stats.max_latency = std::max(stats.max_latency, latency);
+  stats.total_processing_time += processing_time;
+  stats.max_processing_time = std::max(stats.max_processing_time, processing_time);
+}
+
+std::map<std::string, planning_scene_monitor::PlanningSceneMonitor::UpdateSourceStatistics>
+planning_scene_monitor::PlanningSceneMonitor::getUpdateStatistics() const
+{
+  boost::mutex::scoped_lock lock(update_statistics_mutex_);
+  return update_statistics_;
+}
+
+void planning_scene_monitor::PlanningSceneMonitor::resetUpdateStatistics()
+{
+  boost::mutex::scoped_lock lock(update_statistics_mutex_);
+  update_statistics_.clear();
+}
+
 void planning_scene_monitor::PlanningSceneMonitor::excludeRobotLinksFromOctree()
 {
   if (!octomap_monitor_)
@@ -921,6 +1368,7 @@ bool planning_scene_monitor::PlanningSceneMonitor::waitForCurrentRobotState(cons
 
 void planning_scene_monitor::PlanningSceneMonitor::lockSceneRead()
 {
+  MOVEIT_PROBE_SPAN("PlanningSceneMonitor::lockSceneRead");
   scene_update_mutex_.lock_shared();
   if (octomap_monitor_)
     octomap_monitor_->getOcTreePtr()->lockRead();
@@ -935,6 +1383,7 @@ void planning_scene_monitor::PlanningSceneMonitor::unlockSceneRead()
 
 void planning_scene_monitor::PlanningSceneMonitor::lockSceneWrite()
 {
+  MOVEIT_PROBE_SCOPE("PlanningSceneMonitor::lockSceneWrite");
   scene_update_mutex_.lock();
   if (octomap_monitor_)
     octomap_monitor_->getOcTreePtr()->lockWrite();
@@ -945,6 +1394,19 @@ void planning_scene_monitor::PlanningSceneMonitor::unlockSceneWrite()
   if (octomap_monitor_)
     octomap_monitor_->getOcTreePtr()->unlockWrite();
   scene_update_mutex_.unlock();
+  updateSceneSnapshot();
+}
+
+void planning_scene_monitor::PlanningSceneMonitor::lockSnapshotRead()
+{
+  if (octomap_monitor_)
+    octomap_monitor_->getOcTreePtr()->lockRead();
+}
+
+void planning_scene_monitor::PlanningSceneMonitor::unlockSnapshotRead()
+{
+  if (octomap_monitor_)
+    octomap_monitor_->getOcTreePtr()->unlockRead();
 }
 
 void planning_scene_monitor::PlanningSceneMonitor::startSceneMonitor(const std::string& scene_topic)
@@ -1105,7 +1567,13 @@ void planning_scene_monitor::PlanningSceneMonitor::startStateMonitor(const std::
   if (scene_)
   {
     if (!current_state_monitor_)
-      current_state_monitor_.reset(new CurrentStateMonitor(getRobotModel(), tf_, root_nh_));
+    {
+      current_state_monitor_.reset(new CurrentStateMonitor(getRobotModel(), tf_, priority_nh_));
+      // high rate joint state publishers can have their updates coalesced before they reach the scene
+      double coalescing_period;
+      if (nh_.getParam("joint_state_coalescing_period", coalescing_period) && coalescing_period > 0.0)
+        current_state_monitor_->setJointStateCoalescingPeriod(ros::WallDuration(coalescing_period));
+    }
     current_state_monitor_->addUpdateCallback(boost::bind(&PlanningSceneMonitor::onStateUpdate, this, _1));
     current_state_monitor_->startStateMonitor(joint_states_topic);
 
@@ -1119,7 +1587,7 @@ void planning_scene_monitor::PlanningSceneMonitor::startStateMonitor(const std::
     {
       // using regular message filter as there's no header
       attached_collision_object_subscriber_ =
-          root_nh_.subscribe(attached_objects_topic, 1024, &PlanningSceneMonitor::attachObjectCallback, this);
+          priority_nh_.subscribe(attached_objects_topic, 1024, &PlanningSceneMonitor::attachObjectCallback, this);
       ROS_INFO_NAMED(LOGNAME, "Listening to '%s' for attached collision objects",
                      root_nh_.resolveName(attached_objects_topic).c_str());
     }
@@ -1148,10 +1616,13 @@ void planning_scene_monitor::PlanningSceneMonitor::onStateUpdate(
 {
   const ros::WallTime& n = ros::WallTime::now();
   ros::WallDuration dt = n - last_robot_state_update_wall_time_;
+  recordUpdateReceived("robot_state");
 
   bool update = false;
   {
     boost::mutex::scoped_lock lock(state_pending_mutex_);
+    if (state_update_received_.isZero())
+      state_update_received_ = n;
 
     if (dt < dt_state_update_)
     {
@@ -1205,6 +1676,8 @@ void planning_scene_monitor::PlanningSceneMonitor::octomapUpdateCallback()
   if (!octomap_monitor_)
     return;
 
+  ros::WallTime received = ros::WallTime::now();
+  recordUpdateReceived("octomap");
   updateFrameTransforms();
   {
     boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
@@ -1222,6 +1695,7 @@ void planning_scene_monitor::PlanningSceneMonitor::octomapUpdateCallback()
     }
   }
   triggerSceneUpdateEvent(UPDATE_GEOMETRY);
+  recordUpdateApplied("octomap", received, received);
 }
 
 void planning_scene_monitor::PlanningSceneMonitor::setStateUpdateFrequency(double hz)
@@ -1262,6 +1736,13 @@ void planning_scene_monitor::PlanningSceneMonitor::updateSceneWithCurrentState()
                               missing_str.c_str());
     }
 
+    ros::WallTime start = ros::WallTime::now();
+    ros::WallTime received;
+    {
+      boost::mutex::scoped_lock lock(state_pending_mutex_);
+      received = state_update_received_.isZero() ? start : state_update_received_;
+      state_update_received_ = ros::WallTime();
+    }
     {
       boost::unique_lock<boost::shared_mutex> ulock(scene_update_mutex_);
       last_update_time_ = last_robot_motion_time_ = current_state_monitor_->getCurrentStateTime();
@@ -1270,6 +1751,7 @@ void planning_scene_monitor::PlanningSceneMonitor::updateSceneWithCurrentState()
       scene_->getCurrentStateNonConst().update();  // compute all transforms
     }
     triggerSceneUpdateEvent(UPDATE_STATE);
+    recordUpdateApplied("robot_state", received, start);
   }
   else
     ROS_ERROR_THROTTLE_NAMED(1, LOGNAME, "State monitor is not active. Unable to set the planning scene state");
@@ -0,0 +1,91 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+#include <moveit/planning_scene_monitor/shared_planning_scene_monitor.h>
+
+#include <boost/thread/mutex.hpp>
+#include <map>
+
+namespace planning_scene_monitor
+{
+static const std::string LOGNAME = "shared_planning_scene_monitor";
+
+namespace
+{
+struct SharedMonitors
+{
+  boost::mutex lock_;
+  std::map<std::pair<std::string, std::string>, std::weak_ptr<PlanningSceneMonitor> > monitors_;
+};
+
+SharedMonitors& getSharedMonitors()
+{
+  // leaked on purpose: nodelets may release their monitors during static destruction
+  static SharedMonitors* monitors = new SharedMonitors();
+  return *monitors;
+}
+}
+
+PlanningSceneMonitorPtr getSharedPlanningSceneMonitor(const std::string& robot_description,
+                                                      const boost::shared_ptr<tf::Transformer>& tf,
+                                                      const std::string& name, bool* created)
+{
+  if (created)
+    *created = false;
+
+  SharedMonitors& shared = getSharedMonitors();
+  // keep the lock while constructing, so concurrent callers wait for the monitor instead of creating a second one
+  boost::mutex::scoped_lock slock(shared.lock_);
+  std::weak_ptr<PlanningSceneMonitor>& entry = shared.monitors_[std::make_pair(robot_description, name)];
+  PlanningSceneMonitorPtr monitor = entry.lock();
+  if (monitor)
+    return monitor;
+
+  monitor.reset(new PlanningSceneMonitor(robot_description, tf, name));
+  if (!monitor->getPlanningScene())
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Unable to create shared planning scene monitor '%s' for '%s'", name.c_str(),
+                    robot_description.c_str());
+    shared.monitors_.erase(std::make_pair(robot_description, name));
+    return PlanningSceneMonitorPtr();
+  }
+  ROS_DEBUG_NAMED(LOGNAME, "Created shared planning scene monitor '%s' for '%s'", name.c_str(),
+                  robot_description.c_str());
+  entry = monitor;
+  if (created)
+    *created = true;
+  return monitor;
+}
+}
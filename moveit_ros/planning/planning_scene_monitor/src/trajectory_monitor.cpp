@@ -37,6 +37,7 @@
 #include <moveit/planning_scene_monitor/trajectory_monitor.h>
 #include <moveit/trajectory_processing/trajectory_tools.h>
 #include <ros/rate.h>
+#include <algorithm>
 #include <limits>
 #include <memory>
 
@@ -45,6 +46,9 @@ planning_scene_monitor::TrajectoryMonitor::TrajectoryMonitor(const CurrentStateM
   : current_state_monitor_(state_monitor)
   , sampling_frequency_(5.0)
   , trajectory_(current_state_monitor_->getRobotModel(), "")
+  , ring_capacity_(0)
+  , ring_begin_(0)
+  , ring_size_(0)
 {
   setSamplingFrequency(sampling_frequency);
 }
@@ -93,10 +97,72 @@ void planning_scene_monitor::TrajectoryMonitor::clearTrajectory()
   if (restart)
     stopTrajectoryMonitor();
   trajectory_.clear();
+  {
+    boost::mutex::scoped_lock slock(ring_lock_);
+    ring_begin_ = 0;
+    ring_size_ = 0;
+  }
+  if (restart)
+    startTrajectoryMonitor();
+}
+
+void planning_scene_monitor::TrajectoryMonitor::setRingBufferCapacity(std::size_t capacity)
+{
+  bool restart = isActive();
+  if (restart)
+    stopTrajectoryMonitor();
+  {
+    boost::mutex::scoped_lock slock(ring_lock_);
+    ring_capacity_ = capacity;
+    ring_positions_.assign(capacity * current_state_monitor_->getRobotModel()->getVariableCount(), 0.0);
+    ring_stamps_.assign(capacity, ros::Time());
+    ring_begin_ = 0;
+    ring_size_ = 0;
+  }
   if (restart)
     startTrajectoryMonitor();
 }
 
+std::size_t planning_scene_monitor::TrajectoryMonitor::getRecordedSampleCount() const
+{
+  boost::mutex::scoped_lock slock(ring_lock_);
+  return ring_size_;
+}
+
+bool planning_scene_monitor::TrajectoryMonitor::getRecordedSample(std::size_t index, std::vector<double>& positions,
+                                                                  ros::Time& stamp) const
+{
+  const std::size_t variable_count = current_state_monitor_->getRobotModel()->getVariableCount();
+  boost::mutex::scoped_lock slock(ring_lock_);
+  if (index >= ring_size_)
+    return false;
+  const std::size_t slot = (ring_begin_ + index) % ring_capacity_;
+  positions.assign(ring_positions_.begin() + slot * variable_count,
+                   ring_positions_.begin() + (slot + 1) * variable_count);
+  stamp = ring_stamps_[slot];
+  return true;
+}
+
+void planning_scene_monitor::TrajectoryMonitor::copyRecordedTrajectory(
+    robot_trajectory::RobotTrajectory& trajectory) const
+{
+  const robot_model::RobotModelConstPtr& robot_model = current_state_monitor_->getRobotModel();
+  const std::size_t variable_count = robot_model->getVariableCount();
+  trajectory.clear();
+
+  boost::mutex::scoped_lock slock(ring_lock_);
+  for (std::size_t i = 0; i < ring_size_; ++i)
+  {
+    const std::size_t slot = (ring_begin_ + i) % ring_capacity_;
+    robot_state::RobotStatePtr state(new robot_state::RobotState(robot_model));
+    state->setVariablePositions(&ring_positions_[slot * variable_count]);
+    state->update();
+    const std::size_t previous_slot = i == 0 ? slot : (slot + ring_capacity_ - 1) % ring_capacity_;
+    const ros::Time& previous_stamp = ring_stamps_[previous_slot];
+    trajectory.addSuffixWayPoint(state, (ring_stamps_[slot] - previous_stamp).toSec());
+  }
+}
+
 void planning_scene_monitor::TrajectoryMonitor::recordStates()
 {
   if (!current_state_monitor_)
@@ -104,6 +170,20 @@ void planning_scene_monitor::TrajectoryMonitor::recordStates()
 
   ros::Rate rate(sampling_frequency_);
 
+  if (ring_capacity_ > 0)
+  {
+    // a single state is reused for all samples, so recording does not allocate
+    robot_state::RobotState state(current_state_monitor_->getRobotModel());
+    state.setToDefaultValues();
+    uint64_t last_version = 0;
+    while (record_states_thread_)
+    {
+      rate.sleep();
+      recordSample(state, last_version);
+    }
+    return;
+  }
+
   while (record_states_thread_)
   {
     rate.sleep();
@@ -123,3 +203,35 @@ void planning_scene_monitor::TrajectoryMonitor::recordStates()
       state_add_callback_(state.first, state.second);
   }
 }
+
+void planning_scene_monitor::TrajectoryMonitor::recordSample(robot_state::RobotState& state, uint64_t& last_version)
+{
+  const uint64_t version = current_state_monitor_->getStateVersion();
+  if (version == last_version)
+    return;
+  last_version = version;
+
+  ros::Time stamp;
+  current_state_monitor_->setToCurrentState(state, stamp);
+  const std::size_t variable_count = state.getVariableCount();
+  {
+    boost::mutex::scoped_lock slock(ring_lock_);
+    std::size_t slot;
+    if (ring_size_ < ring_capacity_)
+      slot = (ring_begin_ + ring_size_++) % ring_capacity_;
+    else
+    {
+      slot = ring_begin_;
+      ring_begin_ = (ring_begin_ + 1) % ring_capacity_;
+    }
+    std::copy(state.getVariablePositions(), state.getVariablePositions() + variable_count,
+              ring_positions_.begin() + slot * variable_count);
+    ring_stamps_[slot] = stamp;
+  }
+
+  if (state_add_callback_)
+  {
+    state.update();
+    state_add_callback_(robot_state::RobotStatePtr(new robot_state::RobotState(state)), stamp);
+  }
+}
@@ -141,6 +141,10 @@ public:
 private:
   void configure(const Options& opt);
 
+  /** @brief Replace the collision meshes of the links selected by the <robot_description>_planning/collision_geometry
+   *  parameters with their convex hulls, reading and writing the hulls from a cache on disk */
+  void configureCollisionHulls();
+
   robot_model::RobotModelPtr model_;
   rdf_loader::RDFLoaderPtr rdf_loader_;
   kinematics_plugin_loader::KinematicsPluginLoaderPtr kinematics_loader_;
@@ -36,7 +36,23 @@
 
 #include <moveit/robot_model_loader/robot_model_loader.h>
 #include <moveit/profiler/profiler.h>
+#include <geometric_shapes/bodies.h>
+#include <geometric_shapes/shapes.h>
+#include <geometric_shapes/shape_operations.h>
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread/thread.hpp>
+#include <ros/package.h>
 #include <ros/ros.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
 #include <typeinfo>
 
 robot_model_loader::RobotModelLoader::RobotModelLoader(const std::string& robot_description,
@@ -80,6 +96,176 @@ bool canSpecifyPosition(const robot_model::JointModel* jmodel, const unsigned in
     ok = true;
   return ok;
 }
+
+const std::uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+
+/* Add \e size bytes at \e data to the FNV-1a hash \e hash */
+void hashBytes(std::uint64_t& hash, const void* data, std::size_t size)
+{
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (std::size_t i = 0; i < size; ++i)
+    hash = (hash ^ bytes[i]) * 1099511628211ULL;
+}
+
+/* FNV-1a hash of the vertices and triangles of a mesh, used as the name of its cached convex hull */
+std::uint64_t hashMesh(const shapes::Mesh& mesh)
+{
+  std::uint64_t hash = FNV_OFFSET_BASIS;
+  hashBytes(hash, &mesh.vertex_count, sizeof(mesh.vertex_count));
+  hashBytes(hash, &mesh.triangle_count, sizeof(mesh.triangle_count));
+  hashBytes(hash, mesh.vertices, sizeof(double) * 3 * mesh.vertex_count);
+  hashBytes(hash, mesh.triangles, sizeof(unsigned int) * 3 * mesh.triangle_count);
+  return hash;
+}
+
+std::string cacheFileName(std::uint64_t hash, const std::string& extension)
+{
+  std::stringstream name;
+  name << std::hex << std::setw(16) << std::setfill('0') << hash << extension;
+  return name.str();
+}
+
+shapes::Mesh* computeConvexHull(const shapes::Mesh& mesh)
+{
+  bodies::ConvexMesh hull(&mesh);
+  const EigenSTL::vector_Vector3d& vertices = hull.getVertices();
+  const std::vector<unsigned int>& triangles = hull.getTriangles();
+  if (vertices.empty() || triangles.size() < 3)
+    return nullptr;
+
+  shapes::Mesh* result = new shapes::Mesh(vertices.size(), triangles.size() / 3);
+  for (std::size_t i = 0; i < vertices.size(); ++i)
+    for (int k = 0; k < 3; ++k)
+      result->vertices[3 * i + k] = vertices[i][k];
+  std::copy(triangles.begin(), triangles.begin() + 3 * result->triangle_count, result->triangles);
+  result->computeTriangleNormals();
+  return result;
+}
+
+/* Cached meshes and hulls are stored as the vertex and triangle counts followed by the raw vertex and index arrays */
+shapes::Mesh* readCachedMesh(const boost::filesystem::path& path)
+{
+  std::ifstream in(path.string().c_str(), std::ios::binary);
+  unsigned int vertex_count = 0, triangle_count = 0;
+  if (!in.read(reinterpret_cast<char*>(&vertex_count), sizeof(vertex_count)) ||
+      !in.read(reinterpret_cast<char*>(&triangle_count), sizeof(triangle_count)) || vertex_count == 0 ||
+      triangle_count == 0)
+    return nullptr;
+  std::unique_ptr<shapes::Mesh> mesh(new shapes::Mesh(vertex_count, triangle_count));
+  if (!in.read(reinterpret_cast<char*>(mesh->vertices), sizeof(double) * 3 * vertex_count) ||
+      !in.read(reinterpret_cast<char*>(mesh->triangles), sizeof(unsigned int) * 3 * triangle_count))
+    return nullptr;
+  for (unsigned int i = 0; i < 3 * triangle_count; ++i)
+    if (mesh->triangles[i] >= vertex_count)
+      return nullptr;
+  mesh->computeTriangleNormals();
+  mesh->computeVertexNormals();
+  return mesh.release();
+}
+
+void writeCachedMesh(const boost::filesystem::path& path, const shapes::Mesh& mesh)
+{
+  boost::system::error_code ec;
+  boost::filesystem::create_directories(path.parent_path(), ec);
+  // write to a temporary file first, so concurrently starting nodes never read a partial mesh
+  boost::filesystem::path tmp = path;
+  tmp += ".tmp" + std::to_string(::getpid());
+  {
+    std::ofstream out(tmp.string().c_str(), std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&mesh.vertex_count), sizeof(mesh.vertex_count));
+    out.write(reinterpret_cast<const char*>(&mesh.triangle_count), sizeof(mesh.triangle_count));
+    out.write(reinterpret_cast<const char*>(mesh.vertices), sizeof(double) * 3 * mesh.vertex_count);
+    out.write(reinterpret_cast<const char*>(mesh.triangles), sizeof(unsigned int) * 3 * mesh.triangle_count);
+    if (!out)
+    {
+      ROS_WARN("Unable to write cache file '%s'", tmp.string().c_str());
+      return;
+    }
+  }
+  boost::filesystem::rename(tmp, path, ec);
+  if (ec)
+  {
+    ROS_WARN("Unable to write cache file '%s': %s", path.string().c_str(), ec.message().c_str());
+    boost::filesystem::remove(tmp, ec);
+  }
+}
+
+/* The local file a package:// or file:// mesh resource refers to; empty for other resources */
+boost::filesystem::path resolveMeshResource(const std::string& resource)
+{
+  static const std::string PACKAGE_PREFIX = "package://";
+  static const std::string FILE_PREFIX = "file://";
+  if (resource.compare(0, FILE_PREFIX.size(), FILE_PREFIX) == 0)
+    return boost::filesystem::path(resource.substr(FILE_PREFIX.size()));
+  if (resource.compare(0, PACKAGE_PREFIX.size(), PACKAGE_PREFIX) == 0)
+  {
+    std::size_t separator = resource.find('/', PACKAGE_PREFIX.size());
+    if (separator == std::string::npos)
+      return boost::filesystem::path();
+    std::string package_path =
+        ros::package::getPath(resource.substr(PACKAGE_PREFIX.size(), separator - PACKAGE_PREFIX.size()));
+    if (package_path.empty())
+      return boost::filesystem::path();
+    return boost::filesystem::path(package_path) / resource.substr(separator + 1);
+  }
+  return boost::filesystem::path();
+}
+
+/* Load a mesh resource from the mesh cache in \e cache_dir, parsing the resource and filling the cache if needed.
+   Cached meshes are named by the resource, the size and modification time of its file and the scale, so editing
+   or replacing a mesh file makes its cache entry stale. */
+shapes::Mesh* loadMeshWithCache(const boost::filesystem::path& cache_dir, const std::string& resource,
+                                const Eigen::Vector3d& scale)
+{
+  const boost::filesystem::path file = resolveMeshResource(resource);
+  boost::system::error_code ec;
+  const std::uintmax_t size = file.empty() ? 0 : boost::filesystem::file_size(file, ec);
+  const std::time_t mtime = file.empty() || ec ? 0 : boost::filesystem::last_write_time(file, ec);
+  if (file.empty() || ec)
+    return shapes::createMeshFromResource(resource, scale);
+
+  std::uint64_t hash = FNV_OFFSET_BASIS;
+  hashBytes(hash, resource.data(), resource.size());
+  hashBytes(hash, &size, sizeof(size));
+  hashBytes(hash, &mtime, sizeof(mtime));
+  hashBytes(hash, scale.data(), sizeof(double) * 3);
+  const boost::filesystem::path path = cache_dir / cacheFileName(hash, ".mesh");
+
+  shapes::Mesh* mesh = readCachedMesh(path);
+  if (mesh)
+  {
+    ROS_DEBUG("Loaded mesh '%s' from the mesh cache", resource.c_str());
+    return mesh;
+  }
+  mesh = shapes::createMeshFromResource(resource, scale);
+  if (mesh)
+    writeCachedMesh(path, *mesh);
+  return mesh;
+}
+
+boost::filesystem::path defaultMeshCacheDirectory()
+{
+  const char* ros_home = std::getenv("ROS_HOME");
+  if (ros_home)
+    return boost::filesystem::path(ros_home) / "moveit_mesh_cache";
+  const char* home = std::getenv("HOME");
+  return boost::filesystem::path(home ? home : ".") / ".ros" / "moveit_mesh_cache";
+}
+
+boost::filesystem::path defaultConvexHullCacheDirectory()
+{
+  const char* ros_home = std::getenv("ROS_HOME");
+  if (ros_home)
+    return boost::filesystem::path(ros_home) / "moveit_collision_hulls";
+  const char* home = std::getenv("HOME");
+  return boost::filesystem::path(home ? home : ".") / ".ros" / "moveit_collision_hulls";
+}
+
+void allocateSolver(const robot_model::SolverAllocatorFn& allocator, const robot_model::JointModelGroup* jmg,
+                    kinematics::KinematicsBasePtr& solver)
+{
+  solver = allocator(jmg);
+}
 }
 
 void robot_model_loader::RobotModelLoader::configure(const Options& opt)
@@ -98,7 +284,23 @@ void robot_model_loader::RobotModelLoader::configure(const Options& opt)
   {
     const srdf::ModelSharedPtr& srdf =
         rdf_loader_->getSRDF() ? rdf_loader_->getSRDF() : srdf::ModelSharedPtr(new srdf::Model());
-    model_.reset(new robot_model::RobotModel(rdf_loader_->getURDF(), srdf));
+
+    // parsed meshes can be kept in a cache on disk, so that later starts skip parsing the mesh files
+    bool mesh_cache = false;
+    std::string mesh_cache_dir;
+    if (!rdf_loader_->getRobotDescription().empty())
+    {
+      ros::NodeHandle nh("~");
+      const std::string prefix = rdf_loader_->getRobotDescription() + "_planning/";
+      nh.param(prefix + "mesh_cache", mesh_cache, false);
+      nh.param(prefix + "mesh_cache_directory", mesh_cache_dir, defaultMeshCacheDirectory().string());
+    }
+    if (mesh_cache && !mesh_cache_dir.empty())
+      model_.reset(new robot_model::RobotModel(
+          rdf_loader_->getURDF(), srdf,
+          boost::bind(&loadMeshWithCache, boost::filesystem::path(mesh_cache_dir), _1, _2)));
+    else
+      model_.reset(new robot_model::RobotModel(rdf_loader_->getURDF(), srdf));
   }
 
   if (model_ && !rdf_loader_->getRobotDescription().empty())
@@ -158,6 +360,9 @@ void robot_model_loader::RobotModelLoader::configure(const Options& opt)
     }
   }
 
+  if (model_ && !rdf_loader_->getRobotDescription().empty())
+    configureCollisionHulls();
+
   if (model_ && opt.load_kinematics_solvers_)
     loadKinematicsSolvers();
 
@@ -165,6 +370,54 @@ void robot_model_loader::RobotModelLoader::configure(const Options& opt)
                                                                             << " seconds");
 }
 
+void robot_model_loader::RobotModelLoader::configureCollisionHulls()
+{
+  moveit::tools::Profiler::ScopedBlock prof_block("RobotModelLoader::configureCollisionHulls");
+
+  ros::NodeHandle nh("~");
+  const std::string prefix = rdf_loader_->getRobotDescription() + "_planning/collision_geometry/";
+  std::string cache_dir;
+  nh.param(prefix + "hull_cache_directory", cache_dir, defaultConvexHullCacheDirectory().string());
+
+  for (const robot_model::LinkModel* link : model_->getLinkModelsWithCollisionGeometry())
+  {
+    bool convex_hull = false;
+    if (!nh.getParam(prefix + link->getName() + "/convex_hull", convex_hull) || !convex_hull)
+      continue;
+
+    std::vector<shapes::ShapeConstPtr> shapes = link->getShapes();
+    bool changed = false;
+    for (shapes::ShapeConstPtr& shape : shapes)
+    {
+      if (shape->type != shapes::MESH)
+        continue;
+      const shapes::Mesh& mesh = static_cast<const shapes::Mesh&>(*shape);
+
+      const boost::filesystem::path path = boost::filesystem::path(cache_dir) / cacheFileName(hashMesh(mesh), ".hull");
+
+      shapes::Mesh* hull = cache_dir.empty() ? nullptr : readCachedMesh(path);
+      if (!hull)
+      {
+        hull = computeConvexHull(mesh);
+        if (!hull)
+        {
+          ROS_WARN("Unable to compute the convex hull of a collision mesh of link '%s'; keeping the mesh",
+                   link->getName().c_str());
+          continue;
+        }
+        if (!cache_dir.empty())
+          writeCachedMesh(path, *hull);
+      }
+      ROS_DEBUG("Using a convex hull with %u triangles instead of a mesh with %u triangles for link '%s'",
+                hull->triangle_count, mesh.triangle_count, link->getName().c_str());
+      shape.reset(hull);
+      changed = true;
+    }
+    if (changed)
+      model_->getLinkModel(link->getName())->setGeometry(shapes, link->getCollisionOriginTransforms());
+  }
+}
+
 void robot_model_loader::RobotModelLoader::loadKinematicsSolvers(
     const kinematics_plugin_loader::KinematicsPluginLoaderPtr& kloader)
 {
@@ -187,16 +440,40 @@ void robot_model_loader::RobotModelLoader::loadKinematicsSolvers(
     if (groups.empty() && !model_->getJointModelGroups().empty())
       ROS_WARN("No kinematics plugins defined. Fill and load kinematics.yaml!");
 
+    ros::NodeHandle nh("~");
+    bool parallel = true;
+    nh.param(rdf_loader_->getRobotDescription() + "_planning/parallel_kinematics_initialization", parallel, true);
+
+    // Instantiate one solver per group up front. Initializing a solver can take seconds, so this is done
+    // concurrently for all groups; the instances are cached by the plugin loader and reused when the allocators
+    // are set on the robot model below.
+    std::vector<kinematics::KinematicsBasePtr> solvers(groups.size());
+    {
+      boost::thread_group threads;
+      for (std::size_t i = 0; i < groups.size(); ++i)
+      {
+        // Check if a group in kinematics.yaml exists in the srdf
+        if (!model_->hasJointModelGroup(groups[i]))
+          continue;
+        const robot_model::JointModelGroup* jmg = model_->getJointModelGroup(groups[i]);
+        if (parallel)
+          threads.create_thread(boost::bind(&allocateSolver, boost::cref(kinematics_allocator), jmg,
+                                            boost::ref(solvers[i])));
+        else
+          allocateSolver(kinematics_allocator, jmg, solvers[i]);
+      }
+      threads.join_all();
+    }
+
     std::map<std::string, robot_model::SolverAllocatorFn> imap;
     for (std::size_t i = 0; i < groups.size(); ++i)
     {
-      // Check if a group in kinematics.yaml exists in the srdf
       if (!model_->hasJointModelGroup(groups[i]))
         continue;
 
       const robot_model::JointModelGroup* jmg = model_->getJointModelGroup(groups[i]);
 
-      kinematics::KinematicsBasePtr solver = kinematics_allocator(jmg);
+      const kinematics::KinematicsBasePtr& solver = solvers[i];
       if (solver)
       {
         std::string error_msg;
@@ -215,6 +492,8 @@ void robot_model_loader::RobotModelLoader::loadKinematicsSolvers(
         ROS_ERROR("Kinematics solver could not be instantiated for joint group %s.", groups[i].c_str());
       }
     }
+    // release the instances so the cached solvers are picked up by the robot model
+    solvers.clear();
     model_->setKinematicsAllocators(imap);
 
     // set the default IK timeouts
@@ -40,15 +40,18 @@
 #include <moveit/macros/class_forward.h>
 #include <moveit/robot_model/robot_model.h>
 #include <moveit/planning_scene_monitor/current_state_monitor.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
 #include <moveit_msgs/RobotTrajectory.h>
 #include <sensor_msgs/JointState.h>
 #include <std_msgs/String.h>
 #include <ros/ros.h>
 #include <moveit/controller_manager/controller_manager.h>
+#include <moveit/profiler/probes.h>
 #include <boost/thread.hpp>
 #include <pluginlib/class_loader.hpp>
 
 #include <memory>
+#include <tuple>
 
 namespace trajectory_execution_manager
 {
@@ -200,6 +203,30 @@ public:
   /// is given to the already loaded ones. If no controller is specified, a default is used. This call is non-blocking.
   bool pushAndExecute(const sensor_msgs::JointState& state, const std::vector<std::string>& controllers);
 
+  /// Append a trajectory to the motion currently streamed to the controllers, without stopping at the junction. The
+  /// part of the streamed motion that lies more than the stream lookahead ahead of now is blended with \e trajectory
+  /// and the result is re-timed with IterativeSplineParameterization. \e trajectory has to start where the previously
+  /// streamed one ends; if nothing is being streamed, it is executed from rest. This call is non-blocking, so the next
+  /// motion can be planned while the current one executes.
+  bool streamTrajectory(const robot_trajectory::RobotTrajectory& trajectory,
+                        const std::vector<std::string>& controllers = std::vector<std::string>(),
+                        double max_velocity_scaling_factor = 1.0, double max_acceleration_scaling_factor = 1.0);
+
+  /// Execute \e trajectory right away, at the same time as other trajectories passed to executeConcurrently() and as
+  /// execute(), as long as their controllers share no joints with the ones \e trajectory needs. This lets independent
+  /// groups (e.g. two arms, or an arm and a gripper) move in parallel. Each concurrent execution is validated and its
+  /// duration monitored on its own, and \e callback is called with its status, from the execution thread, when it
+  /// completes. Returns false if the trajectory cannot be executed or its controllers are busy.
+  bool executeConcurrently(const moveit_msgs::RobotTrajectory& trajectory,
+                           const ExecutionCompleteCallback& callback = ExecutionCompleteCallback(),
+                           const std::vector<std::string>& controllers = std::vector<std::string>());
+
+  /// Stop the concurrent executions that use any of \e controllers, or all of them if \e controllers is empty
+  void stopConcurrentExecution(const std::vector<std::string>& controllers = std::vector<std::string>());
+
+  /// Wait until the concurrent executions that use any of \e controllers (all if empty) are complete
+  void waitForConcurrentExecution(const std::vector<std::string>& controllers = std::vector<std::string>());
+
   /// Wait until the execution is complete. This only works for executions started by execute().  If you call this after
   /// pushAndExecute(), it will immediately stop execution.
   moveit_controller_manager::ExecutionStatus waitForExecution();
@@ -215,7 +242,8 @@ public:
   /// Return the controller status for the last attempted execution
   moveit_controller_manager::ExecutionStatus getLastExecutionStatus() const;
 
-  /// Stop whatever executions are active, if any
+  /// Stop the executions started by execute() and pushAndExecute(), if any. Concurrent executions are stopped by
+  /// stopConcurrentExecution(), or together with everything else by the "stop" event.
   void stopExecution(bool auto_clear = true);
 
   /// Clear the trajectories to execute
@@ -240,6 +268,16 @@ public:
   /// Set joint-value tolerance for validating trajectory's start point against current robot state
   void setAllowedStartTolerance(double tolerance);
 
+  /// Enable or disable pipelined execution: while a trajectory is finishing, the next one is validated against its end
+  /// point and queued on controllers that allow trajectory queueing, instead of waiting for the robot to stop
+  void enablePipelinedExecution(bool flag);
+
+  /// Time (in seconds) before the expected end of a trajectory at which the next one is queued in pipelined execution
+  void setPipelineLookahead(double lookahead);
+
+  /// Time (in seconds) ahead of now after which trajectories passed to streamTrajectory() replace the streamed motion
+  void setStreamLookahead(double lookahead);
+
 private:
   struct ControllerInformation
   {
@@ -257,6 +295,15 @@ private:
     }
   };
 
+  /// A trajectory passed to executeConcurrently()
+  struct ConcurrentExecution
+  {
+    TrajectoryExecutionContext context_;
+    std::vector<moveit_controller_manager::MoveItControllerHandlePtr> handles_;
+    bool stopped_;
+  };
+  typedef std::shared_ptr<ConcurrentExecution> ConcurrentExecutionPtr;
+
   void initialize();
 
   void reloadControllerInformation();
@@ -286,12 +333,28 @@ private:
                          const std::vector<std::string>& available_controllers,
                          std::vector<std::string>& selected_controllers);
 
+  /// Run the execution; \e trace is the request trace that was current when execute() was called, if any
   void executeThread(const ExecutionCompleteCallback& callback, const PathSegmentCompleteCallback& part_callback,
-                     bool auto_clear);
-  bool executePart(std::size_t part_index);
+                     bool auto_clear, const moveit::tools::probes::RequestTracePtr& trace);
+  /// Execute trajectory \e part_index. If \e pipeline_time is set, the part is queued to start at that time. If \e
+  /// pipeline_next is true, this returns when the next part should be queued and sets \e pipeline_time to the expected
+  /// end of this part; otherwise it waits for completion and clears \e pipeline_time.
+  bool executePart(std::size_t part_index, bool pipeline_next, ros::Time& pipeline_time);
+  /// Check whether the part after \e part_index can be queued while \e part_index is still executing
+  bool canPipeline(std::size_t part_index) const;
+  /// Validate first point of \e next matches the last point of \e previous
+  bool validateContinuity(const TrajectoryExecutionContext& previous, const TrajectoryExecutionContext& next) const;
   bool waitForRobotToStop(const TrajectoryExecutionContext& context, double wait_time = 1.0);
   void continuousExecutionThread();
 
+  /// Run a concurrent execution; \e trace is the request trace that was current when it was started, if any
+  void concurrentExecutionThread(const ConcurrentExecutionPtr& execution, const ExecutionCompleteCallback& callback,
+                                 const moveit::tools::probes::RequestTracePtr& trace);
+  /// The time \e context may take from \e now before its execution is considered to have timed out
+  ros::Duration getAllowedExecutionDuration(const TrajectoryExecutionContext& context, const ros::Time& now) const;
+  /// Check whether any of \e controllers is in \e used, or shares joints with a controller in \e used
+  bool controllersOverlap(const std::vector<std::string>& controllers, const std::set<std::string>& used) const;
+
   void stopExecutionInternal();
 
   void receiveEvent(const std_msgs::StringConstPtr& event);
@@ -310,6 +373,14 @@ private:
   std::map<std::string, ControllerInformation> known_controllers_;
   bool manage_controllers_;
 
+  // the known controllers that actuate each joint
+  std::map<std::string, std::set<std::string> > joint_controllers_;
+
+  // controller combinations found to cover a set of joints, keyed by the joints, the available controllers and the
+  // number of controllers combined; cleared whenever the known controllers are reloaded
+  typedef std::tuple<std::set<std::string>, std::vector<std::string>, std::size_t> ControllerCombinationKey;
+  std::map<ControllerCombinationKey, std::vector<std::vector<std::string> > > controller_combinations_;
+
   // thread used to execute trajectories using the execute() command
   std::unique_ptr<boost::thread> execution_thread_;
 
@@ -336,6 +407,13 @@ private:
   std::vector<TrajectoryExecutionContext*> trajectories_;
   std::deque<TrajectoryExecutionContext*> continuous_execution_queue_;
 
+  // trajectories passed to executeConcurrently(), keyed by the controllers executing them, and the number of threads
+  // that still run them (their threads are detached)
+  std::map<std::set<std::string>, ConcurrentExecutionPtr> concurrent_executions_;
+  std::size_t concurrent_execution_threads_;
+  boost::mutex concurrent_execution_mutex_;
+  boost::condition_variable concurrent_execution_condition_;
+
   std::unique_ptr<pluginlib::ClassLoader<moveit_controller_manager::MoveItControllerManager> >
       controller_manager_loader_;
   moveit_controller_manager::MoveItControllerManagerPtr controller_manager_;
@@ -353,9 +431,20 @@ private:
   // override the 'global' values
   std::map<std::string, double> controller_allowed_execution_duration_scaling_;
   std::map<std::string, double> controller_allowed_goal_duration_margin_;
+  // controllers that append a trajectory stamped in the future instead of replacing the active one
+  std::set<std::string> controller_allow_trajectory_queueing_;
 
   double allowed_start_tolerance_;  // joint tolerance for validate(): radians for revolute joints
   double execution_velocity_scaling_;
+
+  bool pipelined_execution_;
+  double pipeline_lookahead_;
+
+  // motion sent by streamTrajectory(); its time 0 corresponds to stream_start_time_
+  boost::mutex stream_mutex_;
+  robot_trajectory::RobotTrajectoryPtr stream_trajectory_;
+  ros::Time stream_start_time_;
+  double stream_lookahead_;
 };
 }
 
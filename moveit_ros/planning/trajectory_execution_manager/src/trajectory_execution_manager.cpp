@@ -36,6 +36,7 @@
 
 #include <moveit/trajectory_execution_manager/trajectory_execution_manager.h>
 #include <moveit/robot_state/robot_state.h>
+#include <moveit/trajectory_processing/iterative_spline_parameterization.h>
 #include <moveit_ros_planning/TrajectoryExecutionDynamicReconfigureConfig.h>
 #include <dynamic_reconfigure/server.h>
 #include <eigen_conversions/eigen_msg.h>
@@ -71,6 +72,9 @@ private:
     owner_->setAllowedGoalDurationMargin(config.allowed_goal_duration_margin);
     owner_->setExecutionVelocityScaling(config.execution_velocity_scaling);
     owner_->setAllowedStartTolerance(config.allowed_start_tolerance);
+    owner_->enablePipelinedExecution(config.pipelined_execution);
+    owner_->setPipelineLookahead(config.pipeline_lookahead);
+    owner_->setStreamLookahead(config.stream_lookahead);
   }
 
   TrajectoryExecutionManager* owner_;
@@ -99,6 +103,12 @@ TrajectoryExecutionManager::~TrajectoryExecutionManager()
 {
   run_continuous_execution_thread_ = false;
   stopExecution(true);
+  stopConcurrentExecution();
+  {
+    boost::unique_lock<boost::mutex> ulock(concurrent_execution_mutex_);
+    while (concurrent_execution_threads_ > 0)
+      concurrent_execution_condition_.wait(ulock);
+  }
   delete reconfigure_impl_;
 }
 
@@ -112,11 +122,15 @@ void TrajectoryExecutionManager::initialize()
   execution_complete_ = true;
   stop_continuous_execution_ = false;
   current_context_ = -1;
+  concurrent_execution_threads_ = 0;
   last_execution_status_ = moveit_controller_manager::ExecutionStatus::SUCCEEDED;
   run_continuous_execution_thread_ = true;
   execution_duration_monitoring_ = true;
   execution_velocity_scaling_ = 1.0;
   allowed_start_tolerance_ = 0.01;
+  pipelined_execution_ = false;
+  pipeline_lookahead_ = 0.1;
+  stream_lookahead_ = 0.1;
 
   // TODO: Reading from old param location should be removed in L-turtle. Handled by DynamicReconfigure.
   if (node_handle_.getParam("allowed_execution_duration_scaling", allowed_execution_duration_scaling_))
@@ -214,6 +228,21 @@ void TrajectoryExecutionManager::setAllowedStartTolerance(double tolerance)
   allowed_start_tolerance_ = tolerance;
 }
 
+void TrajectoryExecutionManager::enablePipelinedExecution(bool flag)
+{
+  pipelined_execution_ = flag;
+}
+
+void TrajectoryExecutionManager::setPipelineLookahead(double lookahead)
+{
+  pipeline_lookahead_ = lookahead;
+}
+
+void TrajectoryExecutionManager::setStreamLookahead(double lookahead)
+{
+  stream_lookahead_ = lookahead;
+}
+
 bool TrajectoryExecutionManager::isManagingControllers() const
 {
   return manage_controllers_;
@@ -227,7 +256,10 @@ const moveit_controller_manager::MoveItControllerManagerPtr& TrajectoryExecution
 void TrajectoryExecutionManager::processEvent(const std::string& event)
 {
   if (event == "stop")
+  {
     stopExecution(true);
+    stopConcurrentExecution();
+  }
   else
     ROS_WARN_STREAM_NAMED(name_, "Unknown event type: '" << event << "'");
 }
@@ -376,6 +408,354 @@ bool TrajectoryExecutionManager::pushAndExecute(const moveit_msgs::RobotTrajecto
   }
 }
 
+bool TrajectoryExecutionManager::streamTrajectory(const robot_trajectory::RobotTrajectory& trajectory,
+                                                  const std::vector<std::string>& controllers,
+                                                  double max_velocity_scaling_factor,
+                                                  double max_acceleration_scaling_factor)
+{
+  if (trajectory.empty())
+    return true;
+
+  boost::mutex::scoped_lock slock(stream_mutex_);
+  robot_trajectory::RobotTrajectoryPtr stream(
+      new robot_trajectory::RobotTrajectory(robot_model_, trajectory.getGroup()));
+  const std::vector<double> zero(robot_model_->getVariableCount(), 0.0);
+  ros::Time start_time;
+
+  // keep the part of the streamed motion the controllers are about to execute, and replace everything after it
+  if (stream_trajectory_ && !stream_trajectory_->empty())
+  {
+    const std::size_t count = stream_trajectory_->getWayPointCount();
+    const double elapsed = (ros::Time::now() - stream_start_time_).toSec() + stream_lookahead_;
+    if (elapsed < stream_trajectory_->getWayPointDurationFromStart(count - 1))
+    {
+      if (stream_trajectory_->getGroup() != trajectory.getGroup())
+      {
+        ROS_ERROR_NAMED(name_, "Cannot stream a trajectory for group '%s' while one for group '%s' is executing",
+                        trajectory.getGroupName().c_str(), stream_trajectory_->getGroupName().c_str());
+        return false;
+      }
+      double gap = trajectory.getGroup() ?
+                       trajectory.getFirstWayPoint().distance(stream_trajectory_->getLastWayPoint(),
+                                                              trajectory.getGroup()) :
+                       trajectory.getFirstWayPoint().distance(stream_trajectory_->getLastWayPoint());
+      if (allowed_start_tolerance_ > 0 && gap > allowed_start_tolerance_)
+      {
+        ROS_ERROR_NAMED(name_, "Cannot stream trajectory: its start deviates from the end of the streamed motion by %g "
+                               "(allowed: %g)",
+                        gap, allowed_start_tolerance_);
+        return false;
+      }
+
+      std::size_t k = 0;
+      while (k + 1 < count && stream_trajectory_->getWayPointDurationFromStart(k) < elapsed)
+        ++k;
+      start_time = stream_start_time_ + ros::Duration(stream_trajectory_->getWayPointDurationFromStart(k));
+      // the first kept waypoint carries the velocity the robot will have when the blended motion takes over; the
+      // junction point is dropped so the motion no longer comes to rest there
+      for (std::size_t i = k; i + 1 < count; ++i)
+        stream->addSuffixWayPoint(stream_trajectory_->getWayPoint(i), 0.0);
+    }
+  }
+
+  for (std::size_t i = 0; i < trajectory.getWayPointCount(); ++i)
+    stream->addSuffixWayPoint(trajectory.getWayPoint(i), 0.0);
+  if (start_time.isZero())
+  {
+    stream->getFirstWayPointPtr()->setVariableVelocities(zero);
+    stream->getFirstWayPointPtr()->setVariableAccelerations(zero);
+  }
+  stream->getLastWayPointPtr()->setVariableVelocities(zero);
+  stream->getLastWayPointPtr()->setVariableAccelerations(zero);
+
+  trajectory_processing::IterativeSplineParameterization time_parameterization;
+  if (!time_parameterization.computeTimeStamps(*stream, max_velocity_scaling_factor, max_acceleration_scaling_factor))
+  {
+    ROS_ERROR_NAMED(name_, "Failed to time-parameterize streamed trajectory");
+    return false;
+  }
+
+  moveit_msgs::RobotTrajectory msg;
+  stream->getRobotTrajectoryMsg(msg);
+  // a stamp in the future makes the controllers switch to the blended motion exactly at the kept waypoint
+  msg.joint_trajectory.header.stamp = start_time;
+  msg.multi_dof_joint_trajectory.header.stamp = start_time;
+  if (!pushAndExecute(msg, controllers))
+    return false;
+
+  stream_trajectory_ = stream;
+  stream_start_time_ = start_time.isZero() ? ros::Time::now() : start_time;
+  return true;
+}
+
+bool TrajectoryExecutionManager::controllersOverlap(const std::vector<std::string>& controllers,
+                                                    const std::set<std::string>& used) const
+{
+  for (std::size_t i = 0; i < controllers.size(); ++i)
+  {
+    if (used.count(controllers[i]))
+      return true;
+    std::map<std::string, ControllerInformation>::const_iterator it = known_controllers_.find(controllers[i]);
+    if (it != known_controllers_.end())
+      for (std::set<std::string>::const_iterator oit = it->second.overlapping_controllers_.begin();
+           oit != it->second.overlapping_controllers_.end(); ++oit)
+        if (used.count(*oit))
+          return true;
+  }
+  return false;
+}
+
+bool TrajectoryExecutionManager::executeConcurrently(const moveit_msgs::RobotTrajectory& trajectory,
+                                                     const ExecutionCompleteCallback& callback,
+                                                     const std::vector<std::string>& controllers)
+{
+  ConcurrentExecutionPtr execution(new ConcurrentExecution());
+  execution->stopped_ = false;
+  if (!configure(execution->context_, trajectory, controllers) || !validate(execution->context_))
+    return false;
+  const std::set<std::string> key(execution->context_.controllers_.begin(), execution->context_.controllers_.end());
+
+  // the controllers must not be used by execute(), which runs its trajectories one after the other
+  if (!execution_complete_)
+    for (std::size_t i = 0; i < trajectories_.size(); ++i)
+      if (controllersOverlap(trajectories_[i]->controllers_, key))
+      {
+        ROS_ERROR_NAMED(name_, "Cannot execute trajectory concurrently: its controllers are used by the current "
+                               "execution");
+        return false;
+      }
+
+  moveit::tools::probes::RequestTracePtr trace;
+  if (moveit::tools::probes::RequestTrace* current = moveit::tools::probes::getCurrentRequestTrace())
+    trace = current->shared_from_this();
+
+  boost::mutex::scoped_lock slock(concurrent_execution_mutex_);
+  for (std::map<std::set<std::string>, ConcurrentExecutionPtr>::const_iterator it = concurrent_executions_.begin();
+       it != concurrent_executions_.end(); ++it)
+    if (controllersOverlap(execution->context_.controllers_, it->first))
+    {
+      ROS_ERROR_NAMED(name_, "Cannot execute trajectory concurrently: its controllers are used by another concurrent "
+                             "execution");
+      return false;
+    }
+  concurrent_executions_[key] = execution;
+  ++concurrent_execution_threads_;
+  boost::thread(&TrajectoryExecutionManager::concurrentExecutionThread, this, execution, callback, trace).detach();
+  return true;
+}
+
+void TrajectoryExecutionManager::stopConcurrentExecution(const std::vector<std::string>& controllers)
+{
+  boost::mutex::scoped_lock slock(concurrent_execution_mutex_);
+  for (std::map<std::set<std::string>, ConcurrentExecutionPtr>::const_iterator it = concurrent_executions_.begin();
+       it != concurrent_executions_.end(); ++it)
+  {
+    bool match = controllers.empty();
+    for (std::size_t i = 0; i < controllers.size() && !match; ++i)
+      match = it->first.count(controllers[i]) > 0;
+    if (!match)
+      continue;
+
+    it->second->stopped_ = true;
+    for (std::size_t i = 0; i < it->second->handles_.size(); ++i)
+      try
+      {
+        it->second->handles_[i]->cancelExecution();
+      }
+      catch (std::exception& ex)
+      {
+        ROS_ERROR_NAMED(name_, "Caught %s when canceling execution.", ex.what());
+      }
+  }
+}
+
+void TrajectoryExecutionManager::waitForConcurrentExecution(const std::vector<std::string>& controllers)
+{
+  boost::unique_lock<boost::mutex> ulock(concurrent_execution_mutex_);
+  while (true)
+  {
+    bool running = false;
+    for (std::map<std::set<std::string>, ConcurrentExecutionPtr>::const_iterator it = concurrent_executions_.begin();
+         it != concurrent_executions_.end() && !running; ++it)
+    {
+      running = controllers.empty();
+      for (std::size_t i = 0; i < controllers.size() && !running; ++i)
+        running = it->first.count(controllers[i]) > 0;
+    }
+    if (!running)
+      break;
+    concurrent_execution_condition_.wait(ulock);
+  }
+}
+
+ros::Duration TrajectoryExecutionManager::getAllowedExecutionDuration(const TrajectoryExecutionContext& context,
+                                                                      const ros::Time& now) const
+{
+  ros::Duration allowed(0.0);
+  for (std::size_t i = 0; i < context.trajectory_parts_.size(); ++i)
+  {
+    const moveit_msgs::RobotTrajectory& part = context.trajectory_parts_[i];
+    ros::Duration d(0.0);
+    if (part.joint_trajectory.header.stamp > now)
+      d = part.joint_trajectory.header.stamp - now;
+    if (part.multi_dof_joint_trajectory.header.stamp > now)
+      d = std::max(d, part.multi_dof_joint_trajectory.header.stamp - now);
+    d += std::max(part.joint_trajectory.points.empty() ? ros::Duration(0.0) :
+                                                         part.joint_trajectory.points.back().time_from_start,
+                  part.multi_dof_joint_trajectory.points.empty() ?
+                      ros::Duration(0.0) :
+                      part.multi_dof_joint_trajectory.points.back().time_from_start);
+
+    // prefer controller-specific values over global ones if defined
+    std::map<std::string, double>::const_iterator scaling_it =
+        controller_allowed_execution_duration_scaling_.find(context.controllers_[i]);
+    const double scaling = scaling_it != controller_allowed_execution_duration_scaling_.end() ?
+                               scaling_it->second :
+                               allowed_execution_duration_scaling_;
+    std::map<std::string, double>::const_iterator margin_it =
+        controller_allowed_goal_duration_margin_.find(context.controllers_[i]);
+    const double margin =
+        margin_it != controller_allowed_goal_duration_margin_.end() ? margin_it->second : allowed_goal_duration_margin_;
+
+    allowed = std::max(d * scaling + ros::Duration(margin), allowed);
+  }
+  return allowed;
+}
+
+void TrajectoryExecutionManager::concurrentExecutionThread(const ConcurrentExecutionPtr& execution,
+                                                           const ExecutionCompleteCallback& callback,
+                                                           const moveit::tools::probes::RequestTracePtr& trace)
+{
+  moveit::tools::probes::ScopedRequestTrace trace_scope(trace.get());
+  MOVEIT_PROBE_SPAN("TrajectoryExecutionManager::executeConcurrently");
+  const TrajectoryExecutionContext& context = execution->context_;
+  moveit_controller_manager::ExecutionStatus status = moveit_controller_manager::ExecutionStatus::SUCCEEDED;
+
+  std::vector<moveit_controller_manager::MoveItControllerHandlePtr> handles;
+  if (!ensureActiveControllers(context.controllers_))
+    status = moveit_controller_manager::ExecutionStatus::ABORTED;
+  else
+  {
+    // handles are published under the lock, so stopConcurrentExecution() cancels whatever was sent
+    boost::mutex::scoped_lock slock(concurrent_execution_mutex_);
+    if (execution->stopped_)
+      status = moveit_controller_manager::ExecutionStatus::PREEMPTED;
+    const bool start = status == moveit_controller_manager::ExecutionStatus::SUCCEEDED;
+    for (std::size_t i = 0; start && i < context.controllers_.size(); ++i)
+    {
+      moveit_controller_manager::MoveItControllerHandlePtr h;
+      try
+      {
+        h = controller_manager_->getControllerHandle(context.controllers_[i]);
+      }
+      catch (std::exception& ex)
+      {
+        ROS_ERROR_NAMED(name_, "Caught %s when retrieving controller handle", ex.what());
+      }
+      if (!h)
+      {
+        ROS_ERROR_NAMED(name_, "No controller handle for controller '%s'. Aborting.", context.controllers_[i].c_str());
+        status = moveit_controller_manager::ExecutionStatus::ABORTED;
+        break;
+      }
+      handles.push_back(h);
+    }
+
+    bool sent = status == moveit_controller_manager::ExecutionStatus::SUCCEEDED;
+    for (std::size_t i = 0; sent && i < context.trajectory_parts_.size(); ++i)
+    {
+      sent = false;
+      try
+      {
+        sent = handles[i]->sendTrajectory(context.trajectory_parts_[i]);
+      }
+      catch (std::exception& ex)
+      {
+        ROS_ERROR_NAMED(name_, "Caught %s when sending trajectory to controller", ex.what());
+      }
+      if (!sent)
+      {
+        for (std::size_t j = 0; j < i; ++j)
+          try
+          {
+            handles[j]->cancelExecution();
+          }
+          catch (std::exception& ex)
+          {
+            ROS_ERROR_NAMED(name_, "Caught %s when canceling execution", ex.what());
+          }
+        ROS_ERROR_NAMED(name_, "Failed to send trajectory part %zu of %zu to controller %s", i + 1,
+                        context.trajectory_parts_.size(), handles[i]->getName().c_str());
+        status = moveit_controller_manager::ExecutionStatus::ABORTED;
+      }
+    }
+    if (sent)
+      execution->handles_ = handles;
+  }
+
+  if (status == moveit_controller_manager::ExecutionStatus::SUCCEEDED)
+  {
+    const ros::Time start_time = ros::Time::now();
+    const ros::Duration allowed_duration = getAllowedExecutionDuration(context, start_time);
+    for (std::size_t i = 0; i < handles.size(); ++i)
+    {
+      if (execution_duration_monitoring_)
+      {
+        // a zero timeout would wait forever
+        ros::Duration remaining = allowed_duration - (ros::Time::now() - start_time);
+        if (remaining <= ros::Duration(0.0) || !handles[i]->waitForExecution(remaining))
+        {
+          ROS_ERROR_NAMED(name_, "Controller is taking too long to execute trajectory (the expected upper bound for "
+                                 "the trajectory execution was %lf seconds). Stopping trajectory.",
+                          allowed_duration.toSec());
+          for (std::size_t j = 0; j < handles.size(); ++j)
+            try
+            {
+              handles[j]->cancelExecution();
+            }
+            catch (std::exception& ex)
+            {
+              ROS_ERROR_NAMED(name_, "Caught %s when canceling execution", ex.what());
+            }
+          status = moveit_controller_manager::ExecutionStatus::TIMED_OUT;
+          break;
+        }
+      }
+      else
+        handles[i]->waitForExecution();
+
+      boost::mutex::scoped_lock slock(concurrent_execution_mutex_);
+      if (execution->stopped_)
+      {
+        status = moveit_controller_manager::ExecutionStatus::PREEMPTED;
+        break;
+      }
+      if (handles[i]->getLastExecutionStatus() != moveit_controller_manager::ExecutionStatus::SUCCEEDED)
+      {
+        ROS_WARN_STREAM_NAMED(name_, "Controller handle " << handles[i]->getName() << " reports status "
+                                                          << handles[i]->getLastExecutionStatus().asString());
+        status = handles[i]->getLastExecutionStatus();
+        break;
+      }
+    }
+  }
+
+  ROS_INFO_NAMED(name_, "Completed concurrent trajectory execution with status %s", status.asString().c_str());
+  {
+    boost::mutex::scoped_lock slock(concurrent_execution_mutex_);
+    concurrent_executions_.erase(std::set<std::string>(context.controllers_.begin(), context.controllers_.end()));
+    concurrent_execution_condition_.notify_all();
+  }
+
+  if (callback)
+    callback(status);
+
+  // the manager may be destroyed as soon as no concurrent execution thread is left
+  boost::mutex::scoped_lock slock(concurrent_execution_mutex_);
+  --concurrent_execution_threads_;
+  concurrent_execution_condition_.notify_all();
+}
+
 void TrajectoryExecutionManager::continuousExecutionThread()
 {
   std::set<moveit_controller_manager::MoveItControllerHandlePtr> used_handles;
@@ -518,6 +898,8 @@ void TrajectoryExecutionManager::continuousExecutionThread()
 void TrajectoryExecutionManager::reloadControllerInformation()
 {
   known_controllers_.clear();
+  joint_controllers_.clear();
+  controller_combinations_.clear();
   if (controller_manager_)
   {
     std::vector<std::string> names;
@@ -530,6 +912,8 @@ void TrajectoryExecutionManager::reloadControllerInformation()
       ci.name_ = names[i];
       ci.joints_.insert(joints.begin(), joints.end());
       known_controllers_[ci.name_] = ci;
+      for (std::size_t j = 0; j < joints.size(); ++j)
+        joint_controllers_[joints[j]].insert(names[i]);
     }
 
     for (std::map<std::string, ControllerInformation>::iterator it = known_controllers_.begin();
@@ -682,8 +1066,19 @@ bool TrajectoryExecutionManager::findControllers(const std::set<std::string>& ac
   std::vector<std::string> work_area;
   OrderPotentialControllerCombination order;
   std::vector<std::vector<std::string> >& selected_options = order.selected_options;
-  generateControllerCombination(0, controller_count, available_controllers, work_area, selected_options,
-                                actuated_joints);
+
+  // which combinations cover the joints only depends on the joints of the controllers, not on their state
+  ControllerCombinationKey key(actuated_joints, available_controllers, controller_count);
+  std::map<ControllerCombinationKey, std::vector<std::vector<std::string> > >::const_iterator cached =
+      controller_combinations_.find(key);
+  if (cached != controller_combinations_.end())
+    selected_options = cached->second;
+  else
+  {
+    generateControllerCombination(0, controller_count, available_controllers, work_area, selected_options,
+                                  actuated_joints);
+    controller_combinations_[key] = selected_options;
+  }
 
   if (verbose_)
   {
@@ -778,15 +1173,33 @@ bool TrajectoryExecutionManager::selectControllers(const std::set<std::string>&
                                                    const std::vector<std::string>& available_controllers,
                                                    std::vector<std::string>& selected_controllers)
 {
-  for (std::size_t i = 1; i <= available_controllers.size(); ++i)
-    if (findControllers(actuated_joints, i, available_controllers, selected_controllers))
+  // a controller that actuates none of the joints adds nothing to a combination, so only the others are combined
+  std::vector<std::string> relevant_controllers;
+  if (!actuated_joints.empty())
+  {
+    std::set<std::string> actuating;
+    for (std::set<std::string>::const_iterator it = actuated_joints.begin(); it != actuated_joints.end(); ++it)
+    {
+      std::map<std::string, std::set<std::string> >::const_iterator jt = joint_controllers_.find(*it);
+      if (jt == joint_controllers_.end())
+        return false;  // no known controller actuates this joint
+      actuating.insert(jt->second.begin(), jt->second.end());
+    }
+    for (std::size_t i = 0; i < available_controllers.size(); ++i)
+      if (actuating.find(available_controllers[i]) != actuating.end())
+        relevant_controllers.push_back(available_controllers[i]);
+  }
+  const std::vector<std::string>& candidates = actuated_joints.empty() ? available_controllers : relevant_controllers;
+
+  for (std::size_t i = 1; i <= candidates.size(); ++i)
+    if (findControllers(actuated_joints, i, candidates, selected_controllers))
     {
       // if we are not managing controllers, prefer to use active controllers even if there are more of them
       if (!manage_controllers_ && !areControllersActive(selected_controllers))
       {
         std::vector<std::string> other_option;
-        for (std::size_t j = i + 1; j <= available_controllers.size(); ++j)
-          if (findControllers(actuated_joints, j, available_controllers, other_option))
+        for (std::size_t j = i + 1; j <= candidates.size(); ++j)
+          if (findControllers(actuated_joints, j, candidates, other_option))
           {
             if (areControllersActive(other_option))
             {
@@ -938,6 +1351,7 @@ bool TrajectoryExecutionManager::distributeTrajectory(const moveit_msgs::RobotTr
 
 bool TrajectoryExecutionManager::validate(const TrajectoryExecutionContext& context) const
 {
+  MOVEIT_PROBE_SPAN("TrajectoryExecutionManager::validate");
   if (allowed_start_tolerance_ == 0)  // skip validation on this magic number
     return true;
 
@@ -1158,6 +1572,10 @@ void TrajectoryExecutionManager::stopExecution(bool auto_clear)
 {
   stop_continuous_execution_ = true;
   continuous_execution_condition_.notify_all();
+  {
+    boost::mutex::scoped_lock slock(stream_mutex_);
+    stream_trajectory_.reset();
+  }
 
   if (!execution_complete_)
   {
@@ -1204,8 +1622,20 @@ void TrajectoryExecutionManager::execute(const ExecutionCompleteCallback& callba
 {
   stopExecution(false);
 
+  // the controllers of concurrent executions cannot be used until these complete
+  bool busy = false;
+  {
+    boost::mutex::scoped_lock slock(concurrent_execution_mutex_);
+    for (std::map<std::set<std::string>, ConcurrentExecutionPtr>::const_iterator it = concurrent_executions_.begin();
+         it != concurrent_executions_.end() && !busy; ++it)
+      for (std::size_t i = 0; i < trajectories_.size() && !busy; ++i)
+        busy = controllersOverlap(trajectories_[i]->controllers_, it->first);
+  }
+  if (busy)
+    ROS_ERROR_NAMED(name_, "Cannot execute trajectories on controllers used by a concurrent execution");
+
   // check whether first trajectory starts at current robot state
-  if (trajectories_.size() && !validate(*trajectories_.front()))
+  if (busy || (trajectories_.size() && !validate(*trajectories_.front())))
   {
     last_execution_status_ = moveit_controller_manager::ExecutionStatus::ABORTED;
     if (auto_clear)
@@ -1215,10 +1645,13 @@ void TrajectoryExecutionManager::execute(const ExecutionCompleteCallback& callba
     return;
   }
 
-  // start the execution thread
+  // start the execution thread; it continues the request trace of the caller, if there is one
+  moveit::tools::probes::RequestTracePtr trace;
+  if (moveit::tools::probes::RequestTrace* current = moveit::tools::probes::getCurrentRequestTrace())
+    trace = current->shared_from_this();
   execution_complete_ = false;
-  execution_thread_.reset(
-      new boost::thread(&TrajectoryExecutionManager::executeThread, this, callback, part_callback, auto_clear));
+  execution_thread_.reset(new boost::thread(&TrajectoryExecutionManager::executeThread, this, callback, part_callback,
+                                            auto_clear, trace));
 }
 
 moveit_controller_manager::ExecutionStatus TrajectoryExecutionManager::waitForExecution()
@@ -1261,8 +1694,12 @@ void TrajectoryExecutionManager::clear()
 }
 
 void TrajectoryExecutionManager::executeThread(const ExecutionCompleteCallback& callback,
-                                               const PathSegmentCompleteCallback& part_callback, bool auto_clear)
+                                               const PathSegmentCompleteCallback& part_callback, bool auto_clear,
+                                               const moveit::tools::probes::RequestTracePtr& trace)
 {
+  moveit::tools::probes::ScopedRequestTrace trace_scope(trace.get());
+  MOVEIT_PROBE_SPAN("TrajectoryExecutionManager::execute");
+
   // if we already got a stop request before we even started anything, we abort
   if (execution_complete_)
   {
@@ -1278,10 +1715,12 @@ void TrajectoryExecutionManager::executeThread(const ExecutionCompleteCallback&
 
   // execute each trajectory, one after the other (executePart() is blocking) or until one fails.
   // on failure, the status is set by executePart(). Otherwise, it will remain as set above (success)
+  // in pipelined mode, executePart() returns early when the next trajectory can be queued behind the current one
   std::size_t i = 0;
+  ros::Time pipeline_time;
   for (; i < trajectories_.size(); ++i)
   {
-    bool epart = executePart(i);
+    bool epart = executePart(i, canPipeline(i), pipeline_time);
     if (epart && part_callback)
       part_callback(i);
     if (!epart || execution_complete_)
@@ -1292,7 +1731,10 @@ void TrajectoryExecutionManager::executeThread(const ExecutionCompleteCallback&
   }
 
   // only report that execution finished when the robot stopped moving
-  waitForRobotToStop(*trajectories_[i - 1]);
+  {
+    MOVEIT_PROBE_SPAN("TrajectoryExecutionManager::waitForRobotToStop");
+    waitForRobotToStop(*trajectories_[i - 1]);
+  }
 
   ROS_INFO_NAMED(name_, "Completed trajectory execution with status %s ...", last_execution_status_.asString().c_str());
 
@@ -1311,10 +1753,73 @@ void TrajectoryExecutionManager::executeThread(const ExecutionCompleteCallback&
     callback(last_execution_status_);
 }
 
-bool TrajectoryExecutionManager::executePart(std::size_t part_index)
+bool TrajectoryExecutionManager::canPipeline(std::size_t part_index) const
 {
+  if (!pipelined_execution_ || part_index + 1 >= trajectories_.size())
+    return false;
+  const TrajectoryExecutionContext& current = *trajectories_[part_index];
+  const TrajectoryExecutionContext& next = *trajectories_[part_index + 1];
+  if (current.controllers_.empty() || current.controllers_ != next.controllers_)
+    return false;
+  for (const std::string& controller : current.controllers_)
+    if (controller_allow_trajectory_queueing_.find(controller) == controller_allow_trajectory_queueing_.end())
+      return false;
+  return validateContinuity(current, next);
+}
+
+bool TrajectoryExecutionManager::validateContinuity(const TrajectoryExecutionContext& previous,
+                                                    const TrajectoryExecutionContext& next) const
+{
+  if (previous.trajectory_parts_.size() != next.trajectory_parts_.size())
+    return false;
+  if (allowed_start_tolerance_ == 0)  // skip validation on this magic number
+    return true;
+
+  for (std::size_t i = 0; i < next.trajectory_parts_.size(); ++i)
+  {
+    const trajectory_msgs::JointTrajectory& prev_traj = previous.trajectory_parts_[i].joint_trajectory;
+    const trajectory_msgs::JointTrajectory& next_traj = next.trajectory_parts_[i].joint_trajectory;
+    // multi-dof parts are not queued, as their continuity cannot be checked cheaply
+    if (!previous.trajectory_parts_[i].multi_dof_joint_trajectory.points.empty() ||
+        !next.trajectory_parts_[i].multi_dof_joint_trajectory.points.empty())
+      return false;
+    if (prev_traj.points.empty() || next_traj.points.empty())
+      continue;
+    if (prev_traj.joint_names != next_traj.joint_names)
+      return false;
+
+    const std::vector<double>& end = prev_traj.points.back().positions;
+    const std::vector<double>& start = next_traj.points.front().positions;
+    if (end.size() != start.size())
+      return false;
+    for (std::size_t j = 0; j < start.size(); ++j)
+      if (fabs(end[j] - start[j]) > allowed_start_tolerance_)
+      {
+        ROS_WARN_NAMED(name_, "Not queueing trajectory: start of joint '%s' deviates from the end of the previous "
+                              "trajectory more than %g (%g vs. %g)",
+                       next_traj.joint_names[j].c_str(), allowed_start_tolerance_, start[j], end[j]);
+        return false;
+      }
+  }
+  return true;
+}
+
+bool TrajectoryExecutionManager::executePart(std::size_t part_index, bool pipeline_next, ros::Time& pipeline_time)
+{
+  MOVEIT_PROBE_SPAN("TrajectoryExecutionManager::executePart");
   TrajectoryExecutionContext& context = *trajectories_[part_index];
 
+  // queue this part behind the one that is still executing, if it did not finish already
+  bool queued = !pipeline_time.isZero() && pipeline_time > ros::Time::now();
+  for (std::size_t i = 0; i < context.trajectory_parts_.size(); ++i)
+  {
+    if (queued)
+      context.trajectory_parts_[i].joint_trajectory.header.stamp = pipeline_time;
+    else if (!pipeline_time.isZero())
+      context.trajectory_parts_[i].joint_trajectory.header.stamp = ros::Time(0);
+  }
+  pipeline_time = ros::Time();
+
   // first make sure desired controllers are active
   if (ensureActiveControllers(context.controllers_))
   {
@@ -1324,6 +1829,7 @@ bool TrajectoryExecutionManager::executePart(std::size_t part_index)
 
     std::vector<moveit_controller_manager::MoveItControllerHandlePtr> handles;
     {
+      MOVEIT_PROBE_SPAN("TrajectoryExecutionManager::sendTrajectory");
       boost::mutex::scoped_lock slock(execution_state_mutex_);
       if (!execution_complete_)
       {
@@ -1393,6 +1899,7 @@ bool TrajectoryExecutionManager::executePart(std::size_t part_index)
     // compute the expected duration of the trajectory and find the part of the trajectory that takes longest to execute
     ros::Time current_time = ros::Time::now();
     ros::Duration expected_trajectory_duration(0.0);
+    ros::Duration nominal_trajectory_duration(0.0);
     int longest_part = -1;
     for (std::size_t i = 0; i < context.trajectory_parts_.size(); ++i)
     {
@@ -1410,6 +1917,7 @@ bool TrajectoryExecutionManager::executePart(std::size_t part_index)
                       context.trajectory_parts_[i].multi_dof_joint_trajectory.points.empty() ?
                           ros::Duration(0.0) :
                           context.trajectory_parts_[i].multi_dof_joint_trajectory.points.back().time_from_start);
+        nominal_trajectory_duration = std::max(nominal_trajectory_duration, d);
 
         if (longest_part < 0 ||
             std::max(context.trajectory_parts_[i].joint_trajectory.points.size(),
@@ -1468,43 +1976,71 @@ bool TrajectoryExecutionManager::executePart(std::size_t part_index)
     }
 
     bool result = true;
-    for (std::size_t i = 0; i < handles.size(); ++i)
+    if (pipeline_next)
     {
-      if (execution_duration_monitoring_)
+      // return shortly before the expected end so the next part can be queued; the controllers keep executing this
+      // part and their handles are monitored again once the next part has been sent
+      ros::Time end_time = current_time + nominal_trajectory_duration;
+      ros::Time handoff_time =
+          end_time - ros::Duration(std::min(pipeline_lookahead_, nominal_trajectory_duration.toSec()));
+      for (std::size_t i = 0; i < handles.size() && result; ++i)
       {
-        if (!handles[i]->waitForExecution(expected_trajectory_duration))
-          if (!execution_complete_ && ros::Time::now() - current_time > expected_trajectory_duration)
-          {
-            ROS_ERROR_NAMED(name_, "Controller is taking too long to execute trajectory (the expected upper "
-                                   "bound for the trajectory execution was %lf seconds). Stopping trajectory.",
-                            expected_trajectory_duration.toSec());
-            {
-              boost::mutex::scoped_lock slock(execution_state_mutex_);
-              stopExecutionInternal();  // this is really tricky. we can't call stopExecution() here, so we call the
-                                        // internal function only
-            }
-            last_execution_status_ = moveit_controller_manager::ExecutionStatus::TIMED_OUT;
-            result = false;
-            break;
-          }
+        ros::Duration remaining = handoff_time - ros::Time::now();
+        if (remaining > ros::Duration(0.0) && !handles[i]->waitForExecution(remaining))
+          continue;  // still running, as expected
+        moveit_controller_manager::ExecutionStatus status = handles[i]->getLastExecutionStatus();
+        if (status != moveit_controller_manager::ExecutionStatus::RUNNING &&
+            status != moveit_controller_manager::ExecutionStatus::SUCCEEDED)
+        {
+          ROS_WARN_STREAM_NAMED(name_, "Controller handle " << handles[i]->getName() << " reports status "
+                                                            << status.asString());
+          last_execution_status_ = status;
+          result = false;
+        }
       }
-      else
-        handles[i]->waitForExecution();
-
-      // if something made the trajectory stop, we stop this thread too
       if (execution_complete_)
-      {
         result = false;
-        break;
-      }
-      else if (handles[i]->getLastExecutionStatus() != moveit_controller_manager::ExecutionStatus::SUCCEEDED)
+      if (result)
+        pipeline_time = end_time;
+    }
+    else
+      for (std::size_t i = 0; i < handles.size(); ++i)
       {
-        ROS_WARN_STREAM_NAMED(name_, "Controller handle " << handles[i]->getName() << " reports status "
-                                                          << handles[i]->getLastExecutionStatus().asString());
-        last_execution_status_ = handles[i]->getLastExecutionStatus();
-        result = false;
+        if (execution_duration_monitoring_)
+        {
+          if (!handles[i]->waitForExecution(expected_trajectory_duration))
+            if (!execution_complete_ && ros::Time::now() - current_time > expected_trajectory_duration)
+            {
+              ROS_ERROR_NAMED(name_, "Controller is taking too long to execute trajectory (the expected upper "
+                                     "bound for the trajectory execution was %lf seconds). Stopping trajectory.",
+                              expected_trajectory_duration.toSec());
+              {
+                boost::mutex::scoped_lock slock(execution_state_mutex_);
+                stopExecutionInternal();  // this is really tricky. we can't call stopExecution() here, so we call the
+                                          // internal function only
+              }
+              last_execution_status_ = moveit_controller_manager::ExecutionStatus::TIMED_OUT;
+              result = false;
+              break;
+            }
+        }
+        else
+          handles[i]->waitForExecution();
+
+        // if something made the trajectory stop, we stop this thread too
+        if (execution_complete_)
+        {
+          result = false;
+          break;
+        }
+        else if (handles[i]->getLastExecutionStatus() != moveit_controller_manager::ExecutionStatus::SUCCEEDED)
+        {
+          ROS_WARN_STREAM_NAMED(name_, "Controller handle " << handles[i]->getName() << " reports status "
+                                                            << handles[i]->getLastExecutionStatus().asString());
+          last_execution_status_ = handles[i]->getLastExecutionStatus();
+          result = false;
+        }
       }
-    }
 
     // clear the active handles
     execution_state_mutex_.lock();
@@ -1646,6 +2182,7 @@ bool TrajectoryExecutionManager::ensureActiveController(const std::string& contr
 
 bool TrajectoryExecutionManager::ensureActiveControllers(const std::vector<std::string>& controllers)
 {
+  MOVEIT_PROBE_SPAN("TrajectoryExecutionManager::ensureActiveControllers");
   updateControllersState(DEFAULT_CONTROLLER_INFORMATION_VALIDITY_AGE);
 
   if (manage_controllers_)
@@ -1760,6 +2297,10 @@ void TrajectoryExecutionManager::loadControllerParams()
         if (controller.hasMember("allowed_goal_duration_margin"))
           controller_allowed_goal_duration_margin_[std::string(controller["name"])] =
               controller["allowed_goal_duration_margin"];
+        if (controller.hasMember("allow_trajectory_queueing") &&
+            controller["allow_trajectory_queueing"].getType() == XmlRpc::XmlRpcValue::TypeBoolean &&
+            static_cast<bool>(controller["allow_trajectory_queueing"]))
+          controller_allow_trajectory_queueing_.insert(std::string(controller["name"]));
       }
     }
   }
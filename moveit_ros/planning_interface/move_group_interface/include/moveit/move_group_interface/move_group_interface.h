@@ -50,7 +50,10 @@
 #include <moveit_msgs/MotionPlanRequest.h>
 #include <geometry_msgs/PoseStamped.h>
 #include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
 #include <tf/tf.h>
+#include <chrono>
+#include <future>
 
 namespace moveit
 {
@@ -135,6 +138,85 @@ public:
     double planning_time_;
   };
 
+  /// The result of planAsync()
+  struct PlanResult
+  {
+    MoveItErrorCode error_code_;
+    Plan plan_;
+  };
+
+  /// The result of computeCartesianPathAsync(); the fraction is -1.0 in case of error
+  struct CartesianPathResult
+  {
+    MoveItErrorCode error_code_;
+    double fraction_;
+    moveit_msgs::RobotTrajectory trajectory_;
+  };
+
+  /// The result of computeIKAsync()
+  struct IKResult
+  {
+    MoveItErrorCode error_code_;
+    moveit_msgs::RobotState solution_;
+  };
+
+  /** \brief A request to move_group that is processed in the background, as returned by the *Async() functions.
+      Any number of requests can be in flight at the same time; copies of a Future refer to the same request. */
+  template <typename T>
+  class Future
+  {
+  public:
+    Future()
+    {
+    }
+
+    Future(const std::shared_future<T>& future, const boost::function<void()>& cancel)
+      : future_(future), cancel_(cancel)
+    {
+    }
+
+    /** \brief Whether this refers to a request */
+    bool valid() const
+    {
+      return future_.valid();
+    }
+
+    /** \brief Wait at most \e timeout seconds (forever if negative) for the result. Return true if it is available. */
+    bool wait(double timeout = -1.0) const
+    {
+      if (timeout < 0.0)
+      {
+        future_.wait();
+        return true;
+      }
+      return future_.wait_for(std::chrono::duration<double>(timeout)) == std::future_status::ready;
+    }
+
+    /** \brief Whether the result is available */
+    bool ready() const
+    {
+      return wait(0.0);
+    }
+
+    /** \brief The result of the request; blocks until it is available */
+    const T& get() const
+    {
+      return future_.get();
+    }
+
+    /** \brief Cancel the request. Cancelled executions are stopped and complete once the robot is stopped; other
+        requests complete right away with error code PREEMPTED, although move_group still finishes computing them. */
+    void cancel() const
+    {
+      if (cancel_)
+        cancel_();
+    }
+
+  private:
+    std::shared_future<T> future_;
+    boost::function<void()> cancel_;
+  };
+
   /**
       \brief Construct a MoveGroupInterface instance call using a specified set of options \e opt.
 
@@ -730,6 +812,27 @@ public:
                               const moveit_msgs::Constraints& path_constraints, bool avoid_collisions = true,
                               moveit_msgs::MoveItErrorCodes* error_code = NULL);
 
+  /** \brief Compute a motion plan to the current target, like plan(), without blocking. The request is made of the
+      current settings of this class, so these can be changed right after the call to prepare the next request. This
+      requires an asynchronous spinner to be started. */
+  Future<PlanResult> planAsync();
+
+  /** \brief Compute a Cartesian path, like computeCartesianPath(), without blocking */
+  Future<CartesianPathResult> computeCartesianPathAsync(
+      const std::vector<geometry_msgs::Pose>& waypoints, double eef_step, double jump_threshold,
+      const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints(), bool avoid_collisions = true);
+
+  /** \brief Compute a solution of the group's inverse kinematics that places \e end_effector_link (the end-effector
+      link if empty) at \e pose, starting from the start state, without blocking. If \e avoid_collisions is true, the
+      solution has to be collision free. \e timeout is the time allowed for IK (the default of move_group if 0). */
+  Future<IKResult> computeIKAsync(const geometry_msgs::PoseStamped& pose, const std::string& end_effector_link = "",
+                                  bool avoid_collisions = true, double timeout = 0.0);
+
+  /** \brief Execute \e plan without blocking, like asyncExecute(), and return its outcome once the execution
+      completes. move_group executes one trajectory at a time, so a new execution preempts the previous one. This
+      requires the ExecuteTrajectory action of move_group and an asynchronous spinner to be started. */
+  Future<MoveItErrorCode> executeAsync(const Plan& plan);
+
   /** \brief Stop any trajectory execution, if one is active */
   void stop();
 
@@ -740,6 +843,14 @@ public:
   /** \brief Specify whether the robot is allowed to replan if it detects changes in the environment */
   void allowReplanning(bool flag);
 
+  /** \brief Specify whether plans and Cartesian paths are requested and executed through the compact services of
+      move_group when they are available (default is false). These transfer trajectories in an encoded form that is
+      considerably smaller than the regular messages, which helps on slow links between this node and move_group. */
+  void setCompactTransport(bool flag);
+
+  /** \brief Check whether the compact services of move_group are used when they are available */
+  bool getCompactTransport() const;
+
   /** \brief Build the MotionPlanRequest that would be sent to the move_group action with plan() or move() and store it
       in \e request */
   void constructMotionPlanRequest(moveit_msgs::MotionPlanRequest& request);
@@ -831,6 +942,21 @@ public:
   /** \brief Get the current state of the robot within the duration specified by wait. */
   robot_state::RobotStatePtr getCurrentState(double wait = 1);
 
+  /** \brief Get the most recently received state of the robot without waiting for a new one.
+
+      The state is shared by all MoveGroupInterface instances of this process and only copied again once it changed,
+      which makes this suitable for polling. If \e version is given, it is set to the version of the returned state
+      (see getCurrentStateVersion()). Returns an empty pointer if no state was received yet. */
+  robot_state::RobotStateConstPtr getCurrentStateSnapshot(uint64_t* version = NULL);
+
+  /** \brief Get a counter that increases whenever the current state of the robot is updated; zero as long as no state
+      was received. Comparing it with a previous value tells whether the state changed in between. */
+  uint64_t getCurrentStateVersion() const;
+
+  /** \brief Get the most recently received joint values for the joints planned for by this instance, without waiting
+      for a new state (see getCurrentStateSnapshot()). Returns an empty vector if no state was received yet. */
+  std::vector<double> getCachedJointValues();
+
   /** \brief Get the pose for the end-effector \e end_effector_link.
       If \e end_effector_link is empty (the default value) then the end-effector reported by getEndEffectorLink() is
      assumed */
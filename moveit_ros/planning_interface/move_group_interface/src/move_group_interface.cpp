@@ -50,6 +50,7 @@
 #include <moveit/trajectory_execution_manager/trajectory_execution_manager.h>
 #include <moveit/common_planning_interface_objects/common_objects.h>
 #include <moveit/robot_state/conversions.h>
+#include <moveit/robot_trajectory/trajectory_encoding.h>
 #include <moveit_msgs/MoveGroupAction.h>
 #include <moveit_msgs/PickupAction.h>
 #include <moveit_msgs/ExecuteTrajectoryAction.h>
@@ -57,10 +58,16 @@
 #include <moveit_msgs/ExecuteKnownTrajectory.h>
 #include <moveit_msgs/QueryPlannerInterfaces.h>
 #include <moveit_msgs/GetCartesianPath.h>
+#include <moveit_msgs/GetMotionPlan.h>
+#include <moveit_msgs/GetPositionIK.h>
 #include <moveit_msgs/GraspPlanning.h>
 #include <moveit_msgs/GetPlannerParams.h>
 #include <moveit_msgs/SetPlannerParams.h>
+#include <moveit_ros_move_group/GetCompactMotionPlan.h>
+#include <moveit_ros_move_group/GetCompactCartesianPath.h>
+#include <moveit_ros_move_group/ExecuteCompactTrajectory.h>
 
+#include <actionlib/client/action_client.h>
 #include <actionlib/client/simple_action_client.h>
 #include <eigen_conversions/eigen_msg.h>
 #include <std_msgs/String.h>
@@ -88,6 +95,60 @@ enum ActiveTargetType
   POSITION,
   ORIENTATION
 };
+
+// The shared state of a request that completes in the background; the first completion (the result or a
+// cancellation) wins
+template <typename T>
+struct AsyncRequest
+{
+  AsyncRequest() : future_(promise_.get_future().share()), done_(false)
+  {
+  }
+
+  void complete(const T& value)
+  {
+    boost::mutex::scoped_lock slock(lock_);
+    if (done_)
+      return;
+    done_ = true;
+    promise_.set_value(value);
+  }
+
+  std::promise<T> promise_;
+  std::shared_future<T> future_;
+  boost::mutex lock_;
+  bool done_;
+};
+
+// A trajectory sent with executeAsync(); the goal handle is kept until the goal is done, so actionlib keeps tracking it
+struct AsyncExecution : public AsyncRequest<MoveItErrorCode>
+{
+  AsyncExecution() : has_goal_handle_(false)
+  {
+  }
+
+  bool has_goal_handle_;
+  actionlib::ClientGoalHandle<moveit_msgs::ExecuteTrajectoryAction> goal_handle_;
+};
+
+// Call \e client with \e request in a detached thread, and complete \e async with \e convert(response) once the call
+// returns, or with a failure if it does not succeed
+template <typename Service, typename T>
+MoveGroupInterface::Future<T> callServiceAsync(const ros::ServiceClient& client,
+                                               const typename Service::Request& request,
+                                               const boost::function<T(const typename Service::Response&)>& convert,
+                                               const T& failure, const T& cancelled)
+{
+  std::shared_ptr<AsyncRequest<T> > async = std::make_shared<AsyncRequest<T> >();
+  boost::thread([async, client, request, convert, failure]() mutable {
+    typename Service::Response response;
+    if (client.call(request, response))
+      async->complete(convert(response));
+    else
+      async->complete(failure);
+  }).detach();
+  return MoveGroupInterface::Future<T>(async->future_, [async, cancelled]() { async->complete(cancelled); });
+}
 }
 
 class MoveGroupInterface::MoveGroupInterfaceImpl
@@ -129,6 +190,7 @@ public:
     max_velocity_scaling_factor_ = 1.0;
     max_acceleration_scaling_factor_ = 1.0;
     initializing_constraints_ = false;
+    compact_transport_ = false;
 
     if (joint_model_group_->isChain())
       end_effector_link_ = joint_model_group_->getLinkModelNames().back();
@@ -174,8 +236,20 @@ public:
     cartesian_path_service_ =
         node_handle_.serviceClient<moveit_msgs::GetCartesianPath>(move_group::CARTESIAN_PATH_SERVICE_NAME);
 
+    // used by the asynchronous requests, which can be in flight concurrently
+    plan_service_ = node_handle_.serviceClient<moveit_msgs::GetMotionPlan>(move_group::PLANNER_SERVICE_NAME);
+    ik_service_ = node_handle_.serviceClient<moveit_msgs::GetPositionIK>(move_group::IK_SERVICE_NAME);
+
     plan_grasps_service_ = node_handle_.serviceClient<moveit_msgs::GraspPlanning>(GRASP_PLANNING_SERVICE_NAME);
 
+    // the compact services are optional; they are only used if enabled and offered by move_group
+    compact_plan_service_ = node_handle_.serviceClient<moveit_ros_move_group::GetCompactMotionPlan>(
+        move_group::PLANNER_COMPACT_SERVICE_NAME);
+    compact_cartesian_path_service_ = node_handle_.serviceClient<moveit_ros_move_group::GetCompactCartesianPath>(
+        move_group::CARTESIAN_PATH_COMPACT_SERVICE_NAME);
+    compact_execute_service_ = node_handle_.serviceClient<moveit_ros_move_group::ExecuteCompactTrajectory>(
+        move_group::EXECUTE_COMPACT_SERVICE_NAME);
+
     ROS_INFO_STREAM_NAMED("move_group_interface", "Ready to take commands for planning group " << opt.group_name_
                                                                                                << ".");
   }
@@ -644,6 +718,29 @@ public:
     return true;
   }
 
+  robot_state::RobotStateConstPtr getCurrentStateSnapshot(uint64_t* version)
+  {
+    if (version)
+      *version = 0;
+    if (!current_state_monitor_)
+    {
+      ROS_ERROR_NAMED("move_group_interface", "Unable to get current robot state");
+      return robot_state::RobotStateConstPtr();
+    }
+
+    // the monitor is shared by all instances in this process and keeps running once started, so this never waits
+    if (!current_state_monitor_->isActive())
+      current_state_monitor_->startStateMonitor();
+    if (current_state_monitor_->getStateVersion() == 0)
+      return robot_state::RobotStateConstPtr();
+    return current_state_monitor_->getCurrentStateSnapshot(version);
+  }
+
+  uint64_t getCurrentStateVersion() const
+  {
+    return current_state_monitor_ ? current_state_monitor_->getStateVersion() : 0;
+  }
+
   /** \brief Place an object at one of the specified possible locations */
   MoveItErrorCode place(const std::string& object, const std::vector<geometry_msgs::PoseStamped>& poses)
   {
@@ -798,8 +895,38 @@ public:
     return pick(object.id, response.grasps);
   }
 
+  MoveItErrorCode planCompact(Plan& plan)
+  {
+    moveit_ros_move_group::GetCompactMotionPlan::Request req;
+    moveit_ros_move_group::GetCompactMotionPlan::Response res;
+    constructMotionPlanRequest(req.motion_plan_request);
+    if (!compact_plan_service_.call(req, res))
+      return MoveItErrorCode(moveit_msgs::MoveItErrorCodes::FAILURE);
+
+    moveit_msgs::MotionPlanResponse& response = res.motion_plan_response;
+    if (response.error_code.val == moveit_msgs::MoveItErrorCodes::SUCCESS)
+    {
+      if ((!res.compact_trajectory.empty() &&
+           !robot_trajectory::decodeTrajectory(res.compact_trajectory, *getRobotModel(), response.trajectory)) ||
+          (!res.compact_trajectory_start.empty() &&
+           !robot_trajectory::decodeRobotState(res.compact_trajectory_start, getRobotModel(),
+                                               response.trajectory_start)))
+      {
+        ROS_ERROR_NAMED("move_group_interface", "Unable to decode the plan received from move_group");
+        return MoveItErrorCode(moveit_msgs::MoveItErrorCodes::FAILURE);
+      }
+      plan.trajectory_ = std::move(response.trajectory);
+      plan.start_state_ = std::move(response.trajectory_start);
+      plan.planning_time_ = response.planning_time;
+    }
+    return MoveItErrorCode(response.error_code);
+  }
+
   MoveItErrorCode plan(Plan& plan)
   {
+    if (compact_transport_ && compact_plan_service_.exists())
+      return planCompact(plan);
+
     if (!move_action_client_)
     {
       return MoveItErrorCode(moveit_msgs::MoveItErrorCodes::FAILURE);
@@ -882,6 +1009,20 @@ public:
 
   MoveItErrorCode execute(const Plan& plan, bool wait)
   {
+    if (compact_transport_ && compact_execute_service_.exists())
+    {
+      moveit_ros_move_group::ExecuteCompactTrajectory::Request req;
+      moveit_ros_move_group::ExecuteCompactTrajectory::Response res;
+      req.wait_for_execution = wait;
+      // trajectories that cannot be encoded (e.g. multi-dof ones) are sent as they are
+      if (robot_trajectory::encodeTrajectory(plan.trajectory_, *getRobotModel(), req.trajectory))
+      {
+        if (compact_execute_service_.call(req, res))
+          return MoveItErrorCode(res.error_code);
+        return MoveItErrorCode(moveit_msgs::MoveItErrorCodes::FAILURE);
+      }
+    }
+
     if (!execute_action_client_)
     {
       // TODO: Remove this backwards compatibility code in L-turtle
@@ -930,12 +1071,34 @@ public:
     }
   }
 
-  double computeCartesianPath(const std::vector<geometry_msgs::Pose>& waypoints, double step, double jump_threshold,
-                              moveit_msgs::RobotTrajectory& msg, const moveit_msgs::Constraints& path_constraints,
-                              bool avoid_collisions, moveit_msgs::MoveItErrorCodes& error_code)
+  void constructCartesianPathRequest(moveit_msgs::GetCartesianPath::Request& req,
+                                     const std::vector<geometry_msgs::Pose>& waypoints, double step,
+                                     double jump_threshold, const moveit_msgs::Constraints& path_constraints,
+                                     bool avoid_collisions)
   {
-    moveit_msgs::GetCartesianPath::Request req;
-    moveit_msgs::GetCartesianPath::Response res;
+    if (considered_start_state_)
+      robot_state::robotStateToRobotStateMsg(*considered_start_state_, req.start_state);
+    else
+      req.start_state.is_diff = true;
+
+    req.group_name = opt_.group_name_;
+    req.header.frame_id = getPoseReferenceFrame();
+    req.header.stamp = ros::Time::now();
+    req.waypoints = waypoints;
+    req.max_step = step;
+    req.jump_threshold = jump_threshold;
+    req.path_constraints = path_constraints;
+    req.avoid_collisions = avoid_collisions;
+    req.link_name = getEndEffectorLink();
+  }
+
+  double computeCompactCartesianPath(const std::vector<geometry_msgs::Pose>& waypoints, double step,
+                                     double jump_threshold, moveit_msgs::RobotTrajectory& msg,
+                                     const moveit_msgs::Constraints& path_constraints, bool avoid_collisions,
+                                     moveit_msgs::MoveItErrorCodes& error_code)
+  {
+    moveit_ros_move_group::GetCompactCartesianPath::Request req;
+    moveit_ros_move_group::GetCompactCartesianPath::Response res;
 
     if (considered_start_state_)
       robot_state::robotStateToRobotStateMsg(*considered_start_state_, req.start_state);
@@ -952,6 +1115,37 @@ public:
     req.avoid_collisions = avoid_collisions;
     req.link_name = getEndEffectorLink();
 
+    if (!compact_cartesian_path_service_.call(req, res))
+    {
+      error_code.val = error_code.FAILURE;
+      return -1.0;
+    }
+    error_code = res.error_code;
+    if (res.error_code.val != moveit_msgs::MoveItErrorCodes::SUCCESS)
+      return -1.0;
+    if (res.compact_solution.empty())
+      msg = std::move(res.solution);
+    else if (!robot_trajectory::decodeTrajectory(res.compact_solution, *getRobotModel(), msg))
+    {
+      ROS_ERROR_NAMED("move_group_interface", "Unable to decode the Cartesian path received from move_group");
+      error_code.val = error_code.FAILURE;
+      return -1.0;
+    }
+    return res.fraction;
+  }
+
+  double computeCartesianPath(const std::vector<geometry_msgs::Pose>& waypoints, double step, double jump_threshold,
+                              moveit_msgs::RobotTrajectory& msg, const moveit_msgs::Constraints& path_constraints,
+                              bool avoid_collisions, moveit_msgs::MoveItErrorCodes& error_code)
+  {
+    if (compact_transport_ && compact_cartesian_path_service_.exists())
+      return computeCompactCartesianPath(waypoints, step, jump_threshold, msg, path_constraints, avoid_collisions,
+                                         error_code);
+
+    moveit_msgs::GetCartesianPath::Request req;
+    moveit_msgs::GetCartesianPath::Response res;
+    constructCartesianPathRequest(req, waypoints, step, jump_threshold, path_constraints, avoid_collisions);
+
     if (cartesian_path_service_.call(req, res))
     {
       error_code = res.error_code;
@@ -970,6 +1164,131 @@ public:
     }
   }
 
+  MoveGroupInterface::Future<MoveGroupInterface::PlanResult> planAsync()
+  {
+    moveit_msgs::GetMotionPlan::Request req;
+    constructMotionPlanRequest(req.motion_plan_request);
+    PlanResult failure, cancelled;
+    failure.error_code_.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+    cancelled.error_code_.val = moveit_msgs::MoveItErrorCodes::PREEMPTED;
+    return callServiceAsync<moveit_msgs::GetMotionPlan, PlanResult>(
+        plan_service_, req,
+        [](const moveit_msgs::GetMotionPlan::Response& res) {
+          PlanResult result;
+          result.error_code_ = res.motion_plan_response.error_code;
+          result.plan_.trajectory_ = res.motion_plan_response.trajectory;
+          result.plan_.start_state_ = res.motion_plan_response.trajectory_start;
+          result.plan_.planning_time_ = res.motion_plan_response.planning_time;
+          return result;
+        },
+        failure, cancelled);
+  }
+
+  MoveGroupInterface::Future<MoveGroupInterface::CartesianPathResult>
+  computeCartesianPathAsync(const std::vector<geometry_msgs::Pose>& waypoints, double step, double jump_threshold,
+                            const moveit_msgs::Constraints& path_constraints, bool avoid_collisions)
+  {
+    moveit_msgs::GetCartesianPath::Request req;
+    constructCartesianPathRequest(req, waypoints, step, jump_threshold, path_constraints, avoid_collisions);
+    CartesianPathResult failure, cancelled;
+    failure.error_code_.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+    failure.fraction_ = -1.0;
+    cancelled.error_code_.val = moveit_msgs::MoveItErrorCodes::PREEMPTED;
+    cancelled.fraction_ = -1.0;
+    return callServiceAsync<moveit_msgs::GetCartesianPath, CartesianPathResult>(
+        cartesian_path_service_, req,
+        [](const moveit_msgs::GetCartesianPath::Response& res) {
+          CartesianPathResult result;
+          result.error_code_ = res.error_code;
+          result.fraction_ = res.error_code.val == moveit_msgs::MoveItErrorCodes::SUCCESS ? res.fraction : -1.0;
+          result.trajectory_ = res.solution;
+          return result;
+        },
+        failure, cancelled);
+  }
+
+  MoveGroupInterface::Future<MoveGroupInterface::IKResult> computeIKAsync(const geometry_msgs::PoseStamped& pose,
+                                                                          const std::string& end_effector_link,
+                                                                          bool avoid_collisions, double timeout)
+  {
+    moveit_msgs::GetPositionIK::Request req;
+    req.ik_request.group_name = opt_.group_name_;
+    if (considered_start_state_)
+      robot_state::robotStateToRobotStateMsg(*considered_start_state_, req.ik_request.robot_state);
+    else
+      req.ik_request.robot_state.is_diff = true;
+    req.ik_request.avoid_collisions = avoid_collisions;
+    req.ik_request.ik_link_name = end_effector_link.empty() ? getEndEffectorLink() : end_effector_link;
+    req.ik_request.pose_stamped = pose;
+    req.ik_request.timeout = ros::Duration(timeout);
+    IKResult failure, cancelled;
+    failure.error_code_.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+    cancelled.error_code_.val = moveit_msgs::MoveItErrorCodes::PREEMPTED;
+    return callServiceAsync<moveit_msgs::GetPositionIK, IKResult>(
+        ik_service_, req,
+        [](const moveit_msgs::GetPositionIK::Response& res) {
+          IKResult result;
+          result.error_code_ = res.error_code;
+          result.solution_ = res.solution;
+          return result;
+        },
+        failure, cancelled);
+  }
+
+  MoveGroupInterface::Future<MoveItErrorCode> executeAsync(const Plan& plan)
+  {
+    std::shared_ptr<AsyncExecution> async = std::make_shared<AsyncExecution>();
+    MoveGroupInterface::Future<MoveItErrorCode> future(async->future_, [async]() {
+      actionlib::ClientGoalHandle<moveit_msgs::ExecuteTrajectoryAction> goal_handle;
+      {
+        boost::mutex::scoped_lock slock(async->lock_);
+        if (!async->has_goal_handle_)
+          return;
+        goal_handle = async->goal_handle_;
+      }
+      // cancel() invokes the transition callback, which takes the lock itself
+      goal_handle.cancel();
+    });
+
+    if (!execute_goal_client_)
+      execute_goal_client_.reset(new actionlib::ActionClient<moveit_msgs::ExecuteTrajectoryAction>(
+          node_handle_, move_group::EXECUTE_ACTION_NAME));
+    if (!execute_goal_client_->isServerConnected())
+    {
+      ROS_ERROR_NAMED("move_group_interface", "Cannot execute asynchronously without the %s action of move_group",
+                      move_group::EXECUTE_ACTION_NAME.c_str());
+      async->complete(MoveItErrorCode(moveit_msgs::MoveItErrorCodes::FAILURE));
+      return future;
+    }
+
+    moveit_msgs::ExecuteTrajectoryGoal goal;
+    goal.trajectory = plan.trajectory_;
+    typedef actionlib::ClientGoalHandle<moveit_msgs::ExecuteTrajectoryAction> GoalHandle;
+    GoalHandle goal_handle = execute_goal_client_->sendGoal(goal, [async](GoalHandle gh) {
+      if (gh.getCommState() != actionlib::CommState::DONE)
+        return;
+      moveit_msgs::ExecuteTrajectoryResultConstPtr result = gh.getResult();
+      MoveItErrorCode error_code(moveit_msgs::MoveItErrorCodes::FAILURE);
+      if (result)
+        error_code = result->error_code;
+      else if (gh.getTerminalState() == actionlib::TerminalState::PREEMPTED ||
+               gh.getTerminalState() == actionlib::TerminalState::RECALLED)
+        error_code.val = moveit_msgs::MoveItErrorCodes::PREEMPTED;
+      async->complete(error_code);
+      boost::mutex::scoped_lock slock(async->lock_);
+      async->has_goal_handle_ = false;
+      async->goal_handle_.reset();
+    });
+
+    boost::mutex::scoped_lock slock(async->lock_);
+    if (!async->done_)
+    {
+      async->goal_handle_ = goal_handle;
+      async->has_goal_handle_ = true;
+    }
+    return future;
+  }
+
   void stop()
   {
     if (trajectory_event_publisher_)
@@ -1083,6 +1402,16 @@ public:
     ROS_INFO_NAMED("move_group_interface", "Replanning: %s", can_replan_ ? "yes" : "no");
   }
 
+  void setCompactTransport(bool flag)
+  {
+    compact_transport_ = flag;
+  }
+
+  bool getCompactTransport() const
+  {
+    return compact_transport_;
+  }
+
   void setReplanningDelay(double delay)
   {
     if (delay >= 0.0)
@@ -1311,6 +1640,8 @@ private:
   std::unique_ptr<actionlib::SimpleActionClient<moveit_msgs::ExecuteTrajectoryAction> > execute_action_client_;
   std::unique_ptr<actionlib::SimpleActionClient<moveit_msgs::PickupAction> > pick_action_client_;
   std::unique_ptr<actionlib::SimpleActionClient<moveit_msgs::PlaceAction> > place_action_client_;
+  // tracks each goal sent by executeAsync(), unlike execute_action_client_ that only tracks the last one
+  std::unique_ptr<actionlib::ActionClient<moveit_msgs::ExecuteTrajectoryAction> > execute_goal_client_;
 
   // general planning params
   robot_state::RobotStatePtr considered_start_state_;
@@ -1326,6 +1657,7 @@ private:
   bool can_look_;
   bool can_replan_;
   double replan_delay_;
+  bool compact_transport_;
 
   // joint state goal
   robot_state::RobotStatePtr joint_state_target_;
@@ -1352,6 +1684,11 @@ private:
   ros::ServiceClient set_params_service_;
   ros::ServiceClient cartesian_path_service_;
   ros::ServiceClient plan_grasps_service_;
+  ros::ServiceClient compact_plan_service_;
+  ros::ServiceClient compact_cartesian_path_service_;
+  ros::ServiceClient compact_execute_service_;
+  ros::ServiceClient plan_service_;
+  ros::ServiceClient ik_service_;
   std::unique_ptr<moveit_warehouse::ConstraintsStorage> constraints_storage_;
   std::unique_ptr<boost::thread> constraints_init_thread_;
   bool initializing_constraints_;
@@ -1575,6 +1912,35 @@ moveit::planning_interface::MoveGroupInterface::place(const std::string& object,
   return impl_->place(object, std::vector<geometry_msgs::PoseStamped>(1, pose));
 }
 
+moveit::planning_interface::MoveGroupInterface::Future<moveit::planning_interface::MoveGroupInterface::PlanResult>
+moveit::planning_interface::MoveGroupInterface::planAsync()
+{
+  return impl_->planAsync();
+}
+
+moveit::planning_interface::MoveGroupInterface::Future<
+    moveit::planning_interface::MoveGroupInterface::CartesianPathResult>
+moveit::planning_interface::MoveGroupInterface::computeCartesianPathAsync(
+    const std::vector<geometry_msgs::Pose>& waypoints, double eef_step, double jump_threshold,
+    const moveit_msgs::Constraints& path_constraints, bool avoid_collisions)
+{
+  return impl_->computeCartesianPathAsync(waypoints, eef_step, jump_threshold, path_constraints, avoid_collisions);
+}
+
+moveit::planning_interface::MoveGroupInterface::Future<moveit::planning_interface::MoveGroupInterface::IKResult>
+moveit::planning_interface::MoveGroupInterface::computeIKAsync(const geometry_msgs::PoseStamped& pose,
+                                                               const std::string& end_effector_link,
+                                                               bool avoid_collisions, double timeout)
+{
+  return impl_->computeIKAsync(pose, end_effector_link, avoid_collisions, timeout);
+}
+
+moveit::planning_interface::MoveGroupInterface::Future<moveit::planning_interface::MoveItErrorCode>
+moveit::planning_interface::MoveGroupInterface::executeAsync(const Plan& plan)
+{
+  return impl_->executeAsync(plan);
+}
+
 double moveit::planning_interface::MoveGroupInterface::computeCartesianPath(
     const std::vector<geometry_msgs::Pose>& waypoints, double eef_step, double jump_threshold,
     moveit_msgs::RobotTrajectory& trajectory, bool avoid_collisions, moveit_msgs::MoveItErrorCodes* error_code)
@@ -2057,6 +2423,15 @@ std::vector<double> moveit::planning_interface::MoveGroupInterface::getCurrentJo
   return values;
 }
 
+std::vector<double> moveit::planning_interface::MoveGroupInterface::getCachedJointValues()
+{
+  std::vector<double> values;
+  robot_state::RobotStateConstPtr current_state = impl_->getCurrentStateSnapshot(NULL);
+  if (current_state)
+    current_state->copyJointGroupPositions(getName(), values);
+  return values;
+}
+
 std::vector<double> moveit::planning_interface::MoveGroupInterface::getRandomJointValues()
 {
   std::vector<double> r;
@@ -2165,6 +2540,17 @@ robot_state::RobotStatePtr moveit::planning_interface::MoveGroupInterface::getCu
   return current_state;
 }
 
+robot_state::RobotStateConstPtr
+moveit::planning_interface::MoveGroupInterface::getCurrentStateSnapshot(uint64_t* version)
+{
+  return impl_->getCurrentStateSnapshot(version);
+}
+
+uint64_t moveit::planning_interface::MoveGroupInterface::getCurrentStateVersion() const
+{
+  return impl_->getCurrentStateVersion();
+}
+
 void moveit::planning_interface::MoveGroupInterface::rememberJointValues(const std::string& name,
                                                                          const std::vector<double>& values)
 {
@@ -2186,6 +2572,16 @@ void moveit::planning_interface::MoveGroupInterface::allowReplanning(bool flag)
   impl_->allowReplanning(flag);
 }
 
+void moveit::planning_interface::MoveGroupInterface::setCompactTransport(bool flag)
+{
+  impl_->setCompactTransport(flag);
+}
+
+bool moveit::planning_interface::MoveGroupInterface::getCompactTransport() const
+{
+  return impl_->getCompactTransport();
+}
+
 std::vector<std::string> moveit::planning_interface::MoveGroupInterface::getKnownConstraints() const
 {
   return impl_->getKnownConstraints();
@@ -56,6 +56,96 @@ namespace moveit
 {
 namespace planning_interface
 {
+// Releases the GIL while waiting on a future, so other Python threads keep running
+class ScopedGILRelease
+{
+public:
+  ScopedGILRelease() : state_(PyEval_SaveThread())
+  {
+  }
+
+  ~ScopedGILRelease()
+  {
+    PyEval_RestoreThread(state_);
+  }
+
+private:
+  PyThreadState* state_;
+};
+
+// The Python view of MoveGroupInterface::Future; \e Convert turns the result into Python types
+template <typename T, bp::object (*Convert)(const T&)>
+class FutureWrapper
+{
+public:
+  FutureWrapper(const MoveGroupInterface::Future<T>& future) : future_(future)
+  {
+  }
+
+  bool ready() const
+  {
+    return future_.ready();
+  }
+
+  bool wait(double timeout) const
+  {
+    ScopedGILRelease release;
+    return future_.wait(timeout);
+  }
+
+  void cancel() const
+  {
+    future_.cancel();
+  }
+
+  bp::object result() const
+  {
+    {
+      ScopedGILRelease release;
+      future_.wait();
+    }
+    return Convert(future_.get());
+  }
+
+private:
+  MoveGroupInterface::Future<T> future_;
+};
+
+static bp::object convertPlanResult(const MoveGroupInterface::PlanResult& result)
+{
+  return bp::object(py_bindings_tools::serializeMsg(result.plan_.trajectory_));
+}
+
+static bp::object convertCartesianPathResult(const MoveGroupInterface::CartesianPathResult& result)
+{
+  return bp::make_tuple(py_bindings_tools::serializeMsg(result.trajectory_), result.fraction_);
+}
+
+static bp::object convertIKResult(const MoveGroupInterface::IKResult& result)
+{
+  return bp::make_tuple(result.error_code_.val, py_bindings_tools::serializeMsg(result.solution_));
+}
+
+static bp::object convertExecuteResult(const MoveItErrorCode& result)
+{
+  return bp::object(result == MoveItErrorCode::SUCCESS);
+}
+
+typedef FutureWrapper<MoveGroupInterface::PlanResult, convertPlanResult> PlanFuture;
+typedef FutureWrapper<MoveGroupInterface::CartesianPathResult, convertCartesianPathResult> CartesianPathFuture;
+typedef FutureWrapper<MoveGroupInterface::IKResult, convertIKResult> IKFuture;
+typedef FutureWrapper<MoveItErrorCode, convertExecuteResult> ExecuteFuture;
+
+template <typename Future>
+static void wrapFuture(const char* name)
+{
+  bp::class_<Future>(name, bp::no_init)
+      .def("ready", &Future::ready)
+      .def("wait", &Future::wait)
+      .def("cancel", &Future::cancel)
+      .def("result", &Future::result);
+}
+
 class MoveGroupInterfaceWrapper : protected py_bindings_tools::ROScppInitializer, public MoveGroupInterface
 {
 public:
@@ -168,6 +258,16 @@ public:
     return py_bindings_tools::listFromDouble(getCurrentJointValues());
   }
 
+  bp::object getCurrentJointValuesBuffer()
+  {
+    return py_bindings_tools::bufferFromDouble(getCurrentJointValues());
+  }
+
+  bp::list getCachedJointValuesList()
+  {
+    return py_bindings_tools::listFromDouble(getCachedJointValues());
+  }
+
   bp::list getRandomJointValuesList()
   {
     return py_bindings_tools::listFromDouble(getRandomJointValues());
@@ -418,6 +518,35 @@ public:
     return asyncExecute(plan) == MoveItErrorCode::SUCCESS;
   }
 
+  PlanFuture planAsyncPython()
+  {
+    return PlanFuture(planAsync());
+  }
+
+  ExecuteFuture executeAsyncPython(const std::string& plan_str)
+  {
+    MoveGroupInterface::Plan plan;
+    py_bindings_tools::deserializeMsg(plan_str, plan.trajectory_);
+    return ExecuteFuture(executeAsync(plan));
+  }
+
+  CartesianPathFuture computeCartesianPathAsyncPython(const bp::list& waypoints, double eef_step,
+                                                      double jump_threshold, bool avoid_collisions)
+  {
+    std::vector<geometry_msgs::Pose> poses;
+    convertListToArrayOfPoses(waypoints, poses);
+    return CartesianPathFuture(
+        computeCartesianPathAsync(poses, eef_step, jump_threshold, moveit_msgs::Constraints(), avoid_collisions));
+  }
+
+  IKFuture computeIKAsyncPython(const std::string& pose_str, const std::string& end_effector_link,
+                                bool avoid_collisions, double timeout)
+  {
+    geometry_msgs::PoseStamped pose;
+    py_bindings_tools::deserializeMsg(pose_str, pose);
+    return IKFuture(computeIKAsync(pose, end_effector_link, avoid_collisions, timeout));
+  }
+
   std::string getPlanPython()
   {
     MoveGroupInterface::Plan plan;
@@ -513,6 +642,70 @@ public:
       return "";
     }
   }
+
+  // (joint names, positions, velocities, times from start) of a serialized RobotTrajectory; each array is a buffer of
+  // doubles, row-major with one row per point. Velocities are empty unless all points have them.
+  bp::tuple getTrajectoryArraysPython(const std::string& traj_str)
+  {
+    moveit_msgs::RobotTrajectory traj_msg;
+    py_bindings_tools::deserializeMsg(traj_str, traj_msg);
+    const trajectory_msgs::JointTrajectory& jt = traj_msg.joint_trajectory;
+    const std::size_t joints = jt.joint_names.size();
+
+    std::vector<double> positions, velocities, times;
+    positions.reserve(jt.points.size() * joints);
+    velocities.reserve(jt.points.size() * joints);
+    times.reserve(jt.points.size());
+    bool have_velocities = true;
+    for (const trajectory_msgs::JointTrajectoryPoint& p : jt.points)
+    {
+      if (p.positions.size() != joints)
+      {
+        ROS_ERROR("Trajectory point has %zu positions for %zu joints", p.positions.size(), joints);
+        return bp::make_tuple(bp::list(), py_bindings_tools::bufferFromDouble(nullptr, 0),
+                              py_bindings_tools::bufferFromDouble(nullptr, 0),
+                              py_bindings_tools::bufferFromDouble(nullptr, 0));
+      }
+      positions.insert(positions.end(), p.positions.begin(), p.positions.end());
+      have_velocities = have_velocities && p.velocities.size() == joints;
+      if (have_velocities)
+        velocities.insert(velocities.end(), p.velocities.begin(), p.velocities.end());
+      times.push_back(p.time_from_start.toSec());
+    }
+    if (!have_velocities)
+      velocities.clear();
+
+    return bp::make_tuple(py_bindings_tools::listFromString(jt.joint_names),
+                          py_bindings_tools::bufferFromDouble(positions),
+                          py_bindings_tools::bufferFromDouble(velocities), py_bindings_tools::bufferFromDouble(times));
+  }
+
+  // the 6 x n Jacobian (row-major) of the end-effector link for the group's joint values, at reference_point in the
+  // link frame; an empty buffer if it cannot be computed
+  bp::object getJacobianMatrixPython(const bp::list& joint_values, const bp::list& reference_point)
+  {
+    const moveit::core::JointModelGroup* jmg = getRobotModel()->getJointModelGroup(getName());
+    std::vector<double> values = py_bindings_tools::doubleFromList(joint_values);
+    std::vector<double> point = py_bindings_tools::doubleFromList(reference_point);
+    const std::string& link = getEndEffectorLink().empty() ? jmg->getLinkModelNames().back() : getEndEffectorLink();
+    if (values.size() != jmg->getVariableCount() || (!point.empty() && point.size() != 3))
+    {
+      ROS_ERROR("Expected %u joint values and a reference point of 3 values", jmg->getVariableCount());
+      return py_bindings_tools::bufferFromDouble(nullptr, 0);
+    }
+
+    moveit::core::RobotState state(getRobotModel());
+    state.setToDefaultValues();
+    state.setJointGroupPositions(jmg, values);
+    state.update();
+    Eigen::MatrixXd jacobian;
+    Eigen::Vector3d reference = point.empty() ? Eigen::Vector3d::Zero() : Eigen::Vector3d(point[0], point[1], point[2]);
+    if (!state.getJacobian(jmg, getRobotModel()->getLinkModel(link), reference, jacobian))
+      return py_bindings_tools::bufferFromDouble(nullptr, 0);
+
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> row_major = jacobian;
+    return py_bindings_tools::bufferFromDouble(row_major.data(), row_major.size());
+  }
 };
 
 class MoveGroupWrapper : public MoveGroupInterfaceWrapper
@@ -528,6 +721,11 @@ public:
 
 static void wrap_move_group_interface()
 {
+  wrapFuture<PlanFuture>("PlanFuture");
+  wrapFuture<CartesianPathFuture>("CartesianPathFuture");
+  wrapFuture<IKFuture>("IKFuture");
+  wrapFuture<ExecuteFuture>("ExecuteFuture");
+
   bp::class_<MoveGroupInterfaceWrapper, boost::noncopyable> MoveGroupInterfaceClass(
       "MoveGroupInterface", bp::init<std::string, std::string, bp::optional<std::string>>());
 
@@ -608,6 +806,10 @@ static void wrap_move_group_interface()
 
   MoveGroupInterfaceClass.def("start_state_monitor", &MoveGroupInterfaceWrapper::startStateMonitor);
   MoveGroupInterfaceClass.def("get_current_joint_values", &MoveGroupInterfaceWrapper::getCurrentJointValuesList);
+  MoveGroupInterfaceClass.def("get_current_joint_values_buffer",
+                              &MoveGroupInterfaceWrapper::getCurrentJointValuesBuffer);
+  MoveGroupInterfaceClass.def("get_cached_joint_values", &MoveGroupInterfaceWrapper::getCachedJointValuesList);
+  MoveGroupInterfaceClass.def("get_current_state_version", &MoveGroupInterfaceWrapper::getCurrentStateVersion);
   MoveGroupInterfaceClass.def("get_random_joint_values", &MoveGroupInterfaceWrapper::getRandomJointValuesList);
   MoveGroupInterfaceClass.def("get_remembered_joint_values",
                               &MoveGroupInterfaceWrapper::getRememberedJointValuesPython);
@@ -647,6 +849,11 @@ static void wrap_move_group_interface()
   MoveGroupInterfaceClass.def("set_planner_id", &MoveGroupInterfaceWrapper::setPlannerId);
   MoveGroupInterfaceClass.def("set_num_planning_attempts", &MoveGroupInterfaceWrapper::setNumPlanningAttempts);
   MoveGroupInterfaceClass.def("compute_plan", &MoveGroupInterfaceWrapper::getPlanPython);
+  MoveGroupInterfaceClass.def("plan_async", &MoveGroupInterfaceWrapper::planAsyncPython);
+  MoveGroupInterfaceClass.def("execute_async", &MoveGroupInterfaceWrapper::executeAsyncPython);
+  MoveGroupInterfaceClass.def("compute_cartesian_path_async",
+                              &MoveGroupInterfaceWrapper::computeCartesianPathAsyncPython);
+  MoveGroupInterfaceClass.def("compute_ik_async", &MoveGroupInterfaceWrapper::computeIKAsyncPython);
   MoveGroupInterfaceClass.def("compute_cartesian_path", &MoveGroupInterfaceWrapper::computeCartesianPathPython);
   MoveGroupInterfaceClass.def("compute_cartesian_path",
                               &MoveGroupInterfaceWrapper::computeCartesianPathConstrainedPython);
@@ -654,6 +861,8 @@ static void wrap_move_group_interface()
   MoveGroupInterfaceClass.def("attach_object", &MoveGroupInterfaceWrapper::attachObjectPython);
   MoveGroupInterfaceClass.def("detach_object", &MoveGroupInterfaceWrapper::detachObject);
   MoveGroupInterfaceClass.def("retime_trajectory", &MoveGroupInterfaceWrapper::retimeTrajectory);
+  MoveGroupInterfaceClass.def("get_trajectory_arrays", &MoveGroupInterfaceWrapper::getTrajectoryArraysPython);
+  MoveGroupInterfaceClass.def("get_jacobian_matrix", &MoveGroupInterfaceWrapper::getJacobianMatrixPython);
   MoveGroupInterfaceClass.def("get_named_targets", &MoveGroupInterfaceWrapper::getNamedTargetsPython);
   MoveGroupInterfaceClass.def("get_named_target_values", &MoveGroupInterfaceWrapper::getNamedTargetValuesPython);
   MoveGroupInterfaceClass.def("get_current_state_bounded", &MoveGroupInterfaceWrapper::getCurrentStateBoundedPython);
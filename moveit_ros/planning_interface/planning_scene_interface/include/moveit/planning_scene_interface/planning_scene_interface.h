@@ -61,6 +61,21 @@ public:
    */
   /**@{*/
 
+  /** \brief Keep a local copy of the world of move_group's planning scene, fed by the scene updates move_group
+      publishes on its monitored planning scene topic.
+
+      While the mirror is active, getKnownObjectNames(), getKnownObjectNamesInROI(), getObjectPoses() and getObjects()
+      are answered locally instead of calling the GetPlanningScene service, which makes them cheap enough for
+      polling. Attached objects are still requested from move_group. Returns false if the initial scene could not be
+      retrieved. */
+  bool startSceneMirror();
+
+  /** \brief Stop mirroring the world; queries go to the GetPlanningScene service again */
+  void stopSceneMirror();
+
+  /** \brief Check whether queries about the world are answered from the local mirror */
+  bool isSceneMirrorActive() const;
+
   /** \brief Get the names of all known objects in the world. If \e with_type is set to true, only return objects that
    * have a known type. */
   std::vector<std::string> getKnownObjectNames(bool with_type = false);
@@ -39,16 +39,20 @@
 #include <moveit_msgs/GetPlanningScene.h>
 #include <moveit_msgs/ApplyPlanningScene.h>
 #include <ros/ros.h>
+#include <boost/thread/mutex.hpp>
 #include <algorithm>
+#include <limits>
 
 namespace moveit
 {
 namespace planning_interface
 {
+static const std::string MONITORED_PLANNING_SCENE_TOPIC = "move_group/monitored_planning_scene";
+
 class PlanningSceneInterface::PlanningSceneInterfaceImpl
 {
 public:
-  explicit PlanningSceneInterfaceImpl(const std::string& ns = "")
+  explicit PlanningSceneInterfaceImpl(const std::string& ns = "") : mirror_synchronized_(false)
   {
     node_handle_ = ros::NodeHandle(ns);
     planning_scene_service_ =
@@ -58,8 +62,71 @@ public:
     planning_scene_diff_publisher_ = node_handle_.advertise<moveit_msgs::PlanningScene>("planning_scene", 1);
   }
 
+  ~PlanningSceneInterfaceImpl()
+  {
+    stopSceneMirror();
+  }
+
+  bool startSceneMirror()
+  {
+    if (mirror_subscriber_)
+      return true;
+
+    // updates that arrive before the initial scene are kept and applied on top of it
+    mirror_subscriber_ = node_handle_.subscribe(MONITORED_PLANNING_SCENE_TOPIC, 100,
+                                                &PlanningSceneInterfaceImpl::sceneUpdateCallback, this);
+    moveit_msgs::GetPlanningScene::Request request;
+    moveit_msgs::GetPlanningScene::Response response;
+    request.components.components = request.components.WORLD_OBJECT_GEOMETRY;
+    if (!planning_scene_service_.call(request, response))
+    {
+      ROS_WARN_NAMED("planning_scene_interface", "Could not call planning scene service to initialize the scene "
+                                                 "mirror");
+      mirror_subscriber_.shutdown();
+      return false;
+    }
+
+    boost::mutex::scoped_lock slock(mirror_lock_);
+    response.scene.is_diff = false;
+    applyWorldUpdate(response.scene);
+    for (const moveit_msgs::PlanningScene& update : pending_updates_)
+      applyWorldUpdate(update);
+    pending_updates_.clear();
+    mirror_synchronized_ = true;
+    ROS_DEBUG_NAMED("planning_scene_interface", "Mirroring the world of the planning scene from '%s'",
+                    node_handle_.resolveName(MONITORED_PLANNING_SCENE_TOPIC).c_str());
+    return true;
+  }
+
+  void stopSceneMirror()
+  {
+    mirror_subscriber_.shutdown();
+    boost::mutex::scoped_lock slock(mirror_lock_);
+    mirror_synchronized_ = false;
+    mirror_objects_.clear();
+    pending_updates_.clear();
+  }
+
+  bool isSceneMirrorActive() const
+  {
+    boost::mutex::scoped_lock slock(mirror_lock_);
+    return mirror_synchronized_;
+  }
+
   std::vector<std::string> getKnownObjectNames(bool with_type)
   {
+    {
+      boost::mutex::scoped_lock slock(mirror_lock_);
+      if (mirror_synchronized_)
+      {
+        std::vector<std::string> result;
+        for (const std::pair<const std::string, MirroredObject>& it : mirror_objects_)
+          if (!with_type || !it.second.object.type.key.empty())
+            result.push_back(it.first);
+        return result;
+      }
+    }
+
     moveit_msgs::GetPlanningScene::Request request;
     moveit_msgs::GetPlanningScene::Response response;
     std::vector<std::string> result;
@@ -83,6 +150,29 @@ public:
   std::vector<std::string> getKnownObjectNamesInROI(double minx, double miny, double minz, double maxx, double maxy,
                                                     double maxz, bool with_type, std::vector<std::string>& types)
   {
+    {
+      boost::mutex::scoped_lock slock(mirror_lock_);
+      if (mirror_synchronized_)
+      {
+        // an object is in the region if all its shape positions are, i.e. if the box around them is
+        std::vector<std::string> result;
+        for (const std::pair<const std::string, MirroredObject>& it : mirror_objects_)
+        {
+          const MirroredObject& o = it.second;
+          if ((with_type && o.object.type.key.empty()) || !o.has_poses)
+            continue;
+          if (o.min[0] >= minx && o.min[1] >= miny && o.min[2] >= minz && o.max[0] <= maxx && o.max[1] <= maxy &&
+              o.max[2] <= maxz)
+          {
+            result.push_back(it.first);
+            if (with_type)
+              types.push_back(o.object.type.key);
+          }
+        }
+        return result;
+      }
+    }
+
     moveit_msgs::GetPlanningScene::Request request;
     moveit_msgs::GetPlanningScene::Response response;
     std::vector<std::string> result;
@@ -135,6 +225,23 @@ public:
 
   std::map<std::string, geometry_msgs::Pose> getObjectPoses(const std::vector<std::string>& object_ids)
   {
+    {
+      boost::mutex::scoped_lock slock(mirror_lock_);
+      if (mirror_synchronized_)
+      {
+        std::map<std::string, geometry_msgs::Pose> result;
+        for (const std::string& id : object_ids)
+        {
+          std::map<std::string, MirroredObject>::const_iterator it = mirror_objects_.find(id);
+          if (it == mirror_objects_.end() || !it->second.has_poses)
+            continue;
+          const moveit_msgs::CollisionObject& object = it->second.object;
+          result[id] = object.mesh_poses.empty() ? object.primitive_poses[0] : object.mesh_poses[0];
+        }
+        return result;
+      }
+    }
+
     moveit_msgs::GetPlanningScene::Request request;
     moveit_msgs::GetPlanningScene::Response response;
     std::map<std::string, geometry_msgs::Pose> result;
@@ -166,6 +273,27 @@ public:
 
   std::map<std::string, moveit_msgs::CollisionObject> getObjects(const std::vector<std::string>& object_ids)
   {
+    {
+      boost::mutex::scoped_lock slock(mirror_lock_);
+      if (mirror_synchronized_)
+      {
+        std::map<std::string, moveit_msgs::CollisionObject> result;
+        if (object_ids.empty())
+        {
+          for (const std::pair<const std::string, MirroredObject>& it : mirror_objects_)
+            result[it.first] = it.second.object;
+        }
+        else
+          for (const std::string& id : object_ids)
+          {
+            std::map<std::string, MirroredObject>::const_iterator it = mirror_objects_.find(id);
+            if (it != mirror_objects_.end())
+              result[id] = it->second.object;
+          }
+        return result;
+      }
+    }
+
     moveit_msgs::GetPlanningScene::Request request;
     moveit_msgs::GetPlanningScene::Response response;
     std::map<std::string, moveit_msgs::CollisionObject> result;
@@ -262,11 +390,105 @@ public:
   }
 
 private:
+  /** \brief A collision object of the mirrored world, with the box around the positions of its shapes */
+  struct MirroredObject
+  {
+    moveit_msgs::CollisionObject object;
+    bool has_poses;
+    double min[3];
+    double max[3];
+  };
+
+  void sceneUpdateCallback(const moveit_msgs::PlanningSceneConstPtr& scene)
+  {
+    boost::mutex::scoped_lock slock(mirror_lock_);
+    if (mirror_synchronized_)
+      applyWorldUpdate(*scene);
+    else
+      pending_updates_.push_back(*scene);
+  }
+
+  /** \brief Apply the world part of \e scene to the mirror; must be called with mirror_lock_ held */
+  void applyWorldUpdate(const moveit_msgs::PlanningScene& scene)
+  {
+    if (!scene.is_diff)
+      mirror_objects_.clear();
+    for (const moveit_msgs::CollisionObject& object : scene.world.collision_objects)
+    {
+      if (object.operation == moveit_msgs::CollisionObject::REMOVE)
+      {
+        if (object.id.empty())
+          mirror_objects_.clear();
+        else
+          mirror_objects_.erase(object.id);
+        continue;
+      }
+
+      std::map<std::string, MirroredObject>::iterator it = mirror_objects_.find(object.id);
+      if (object.operation == moveit_msgs::CollisionObject::MOVE)
+      {
+        if (it == mirror_objects_.end())
+          continue;
+        moveit_msgs::CollisionObject& existing = it->second.object;
+        if (existing.primitive_poses.size() == object.primitive_poses.size())
+          existing.primitive_poses = object.primitive_poses;
+        if (existing.mesh_poses.size() == object.mesh_poses.size())
+          existing.mesh_poses = object.mesh_poses;
+        if (existing.plane_poses.size() == object.plane_poses.size())
+          existing.plane_poses = object.plane_poses;
+      }
+      else if (object.operation == moveit_msgs::CollisionObject::APPEND && it != mirror_objects_.end())
+      {
+        moveit_msgs::CollisionObject& existing = it->second.object;
+        existing.primitives.insert(existing.primitives.end(), object.primitives.begin(), object.primitives.end());
+        existing.primitive_poses.insert(existing.primitive_poses.end(), object.primitive_poses.begin(),
+                                        object.primitive_poses.end());
+        existing.meshes.insert(existing.meshes.end(), object.meshes.begin(), object.meshes.end());
+        existing.mesh_poses.insert(existing.mesh_poses.end(), object.mesh_poses.begin(), object.mesh_poses.end());
+        existing.planes.insert(existing.planes.end(), object.planes.begin(), object.planes.end());
+        existing.plane_poses.insert(existing.plane_poses.end(), object.plane_poses.begin(), object.plane_poses.end());
+      }
+      else
+      {
+        it = mirror_objects_.insert(std::make_pair(object.id, MirroredObject())).first;
+        it->second.object = object;
+        it->second.object.operation = moveit_msgs::CollisionObject::ADD;
+      }
+      updateBounds(it->second);
+    }
+  }
+
+  static void updateBounds(MirroredObject& o)
+  {
+    o.has_poses = !o.object.mesh_poses.empty() || !o.object.primitive_poses.empty();
+    for (int k = 0; k < 3; ++k)
+    {
+      o.min[k] = std::numeric_limits<double>::infinity();
+      o.max[k] = -std::numeric_limits<double>::infinity();
+    }
+    for (const std::vector<geometry_msgs::Pose>* poses : { &o.object.mesh_poses, &o.object.primitive_poses })
+      for (const geometry_msgs::Pose& pose : *poses)
+      {
+        const double p[3] = { pose.position.x, pose.position.y, pose.position.z };
+        for (int k = 0; k < 3; ++k)
+        {
+          o.min[k] = std::min(o.min[k], p[k]);
+          o.max[k] = std::max(o.max[k], p[k]);
+        }
+      }
+  }
+
   ros::NodeHandle node_handle_;
   ros::ServiceClient planning_scene_service_;
   ros::ServiceClient apply_planning_scene_service_;
   ros::Publisher planning_scene_diff_publisher_;
   robot_model::RobotModelConstPtr robot_model_;
+
+  ros::Subscriber mirror_subscriber_;
+  mutable boost::mutex mirror_lock_;
+  bool mirror_synchronized_;
+  std::map<std::string, MirroredObject> mirror_objects_;
+  std::vector<moveit_msgs::PlanningScene> pending_updates_;
 };
 
 PlanningSceneInterface::PlanningSceneInterface(const std::string& ns)
@@ -279,6 +501,21 @@ PlanningSceneInterface::~PlanningSceneInterface()
   delete impl_;
 }
 
+bool PlanningSceneInterface::startSceneMirror()
+{
+  return impl_->startSceneMirror();
+}
+
+void PlanningSceneInterface::stopSceneMirror()
+{
+  impl_->stopSceneMirror();
+}
+
+bool PlanningSceneInterface::isSceneMirrorActive() const
+{
+  return impl_->isSceneMirrorActive();
+}
+
 std::vector<std::string> PlanningSceneInterface::getKnownObjectNames(bool with_type)
 {
   return impl_->getKnownObjectNames(with_type);
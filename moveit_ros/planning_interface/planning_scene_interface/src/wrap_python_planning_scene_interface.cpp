@@ -117,6 +117,9 @@ static void wrap_planning_scene_interface()
   bp::class_<PlanningSceneInterfaceWrapper> PlanningSceneClass("PlanningSceneInterface",
                                                                bp::init<bp::optional<std::string>>());
 
+  PlanningSceneClass.def("start_scene_mirror", &PlanningSceneInterfaceWrapper::startSceneMirror);
+  PlanningSceneClass.def("stop_scene_mirror", &PlanningSceneInterfaceWrapper::stopSceneMirror);
+  PlanningSceneClass.def("is_scene_mirror_active", &PlanningSceneInterfaceWrapper::isSceneMirrorActive);
   PlanningSceneClass.def("get_known_object_names", &PlanningSceneInterfaceWrapper::getKnownObjectNamesPython);
   PlanningSceneClass.def("get_known_object_names_in_roi",
                          &PlanningSceneInterfaceWrapper::getKnownObjectNamesInROIPython);
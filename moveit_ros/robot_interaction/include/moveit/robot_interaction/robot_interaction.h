@@ -202,7 +202,11 @@ private:
   bool run_processing_thread_;
 
   boost::condition_variable new_feedback_condition_;
+  // the latest feedback not yet processed, per marker; feedback that arrives while IK for the same marker is still
+  // being solved replaces older feedback waiting here, so the processing thread never solves for stale poses
   std::map<std::string, visualization_msgs::InteractiveMarkerFeedbackConstPtr> feedback_map_;
+  // number of feedback messages replaced before they were processed
+  std::size_t dropped_feedback_count_;
 
   robot_model::RobotModelConstPtr robot_model_;
 
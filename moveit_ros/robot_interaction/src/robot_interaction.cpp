@@ -68,6 +68,7 @@ RobotInteraction::RobotInteraction(const robot_model::RobotModelConstPtr& robot_
   int_marker_server_ = new interactive_markers::InteractiveMarkerServer(topic_);
 
   // spin a thread that will process feedback events
+  dropped_feedback_count_ = 0;
   run_processing_thread_ = true;
   processing_thread_.reset(new boost::thread(boost::bind(&RobotInteraction::processingThread, this)));
 }
@@ -738,7 +739,14 @@ void RobotInteraction::processInteractiveMarkerFeedback(
     return;
   }
 
-  feedback_map_[feedback->marker_name] = feedback;
+  visualization_msgs::InteractiveMarkerFeedbackConstPtr& pending = feedback_map_[feedback->marker_name];
+  if (pending)
+  {
+    ++dropped_feedback_count_;
+    ROS_DEBUG_THROTTLE_NAMED(1, "robot_interaction", "Dropped %zu superseded feedback messages so far",
+                             dropped_feedback_count_);
+  }
+  pending = feedback;
   new_feedback_condition_.notify_all();
 }
 
@@ -58,6 +58,7 @@
 #include <moveit_msgs/DisplayTrajectory.h>
 #endif
 
+#include <atomic>
 #include <memory>
 
 namespace Ogre
@@ -256,6 +257,21 @@ protected:
   std::map<std::string, LinkDisplayStatus> status_links_start_;
   std::map<std::string, LinkDisplayStatus> status_links_goal_;
 
+  /// Set when a query state changed, or only needs to be drawn again. update() handles these at a capped rate, so a
+  /// burst of changes (dragging a marker, a stream of scene updates) costs one redraw per frame at most
+  std::atomic<bool> query_start_state_changed_;
+  std::atomic<bool> query_goal_state_changed_;
+  std::atomic<bool> query_start_state_draw_pending_;
+  std::atomic<bool> query_goal_state_draw_pending_;
+  ros::WallTime last_query_state_update_;
+
+  /// The link statuses and group the query robots were last colored for, so updateLinkColors() only recolors
+  /// when they change; reset link_colors_valid_ to force recoloring (e.g. when a color property changes)
+  bool link_colors_valid_;
+  std::string link_colors_group_;
+  std::map<std::string, LinkDisplayStatus> link_colors_start_;
+  std::map<std::string, LinkDisplayStatus> link_colors_goal_;
+
   /// Hold the names of the groups for which the query states have been updated (and should not be altered when new info
   /// is received from the planning scene)
   std::set<std::string> modified_groups_;
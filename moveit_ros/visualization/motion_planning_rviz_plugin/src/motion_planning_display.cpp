@@ -69,12 +69,17 @@
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include <algorithm>
+
 #include <QShortcut>
 
 #include "ui_motion_planning_rviz_plugin_frame.h"
 
 namespace moveit_rviz_plugin
 {
+// the query states are redrawn at most this often, however often they change
+static const double QUERY_STATE_UPDATE_PERIOD = 1.0 / 30.0;
+
 // ******************************************************************************************
 // Base class contructor
 // ******************************************************************************************
@@ -87,6 +92,11 @@ MotionPlanningDisplay::MotionPlanningDisplay()
   , menu_handler_start_(new interactive_markers::MenuHandler)
   , menu_handler_goal_(new interactive_markers::MenuHandler)
   , int_marker_display_(NULL)
+  , query_start_state_changed_(false)
+  , query_goal_state_changed_(false)
+  , query_start_state_draw_pending_(false)
+  , query_goal_state_draw_pending_(false)
+  , link_colors_valid_(false)
 {
   // Category Groups
   plan_category_ = new rviz::Property("Planning Request", QVariant(), "", this);
@@ -845,6 +855,7 @@ void MotionPlanningDisplay::changedQueryStartColor()
   color.b = qcolor.blueF();
   color.a = 1.0f;
   query_robot_start_->setDefaultAttachedObjectColor(color);
+  link_colors_valid_ = false;
   changedQueryStartState();
 }
 
@@ -875,6 +886,7 @@ void MotionPlanningDisplay::changedQueryGoalColor()
   color.b = qcolor.blueF();
   color.a = 1.0f;
   query_robot_goal_->setDefaultAttachedObjectColor(color);
+  link_colors_valid_ = false;
   changedQueryGoalState();
 }
 
@@ -886,12 +898,14 @@ void MotionPlanningDisplay::changedQueryGoalAlpha()
 
 void MotionPlanningDisplay::changedQueryCollidingLinkColor()
 {
+  link_colors_valid_ = false;
   changedQueryStartState();
   changedQueryGoalState();
 }
 
 void MotionPlanningDisplay::changedQueryJointViolationColor()
 {
+  link_colors_valid_ = false;
   changedQueryStartState();
   changedQueryGoalState();
 }
@@ -904,7 +918,7 @@ void MotionPlanningDisplay::scheduleDrawQueryStartState(robot_interaction::Robot
   addBackgroundJob(boost::bind(&MotionPlanningDisplay::publishInteractiveMarkers, this, !error_state_changed),
                    "publishInteractiveMarkers");
   recomputeQueryStartStateMetrics();
-  addMainLoopJob(boost::bind(&MotionPlanningDisplay::drawQueryStartState, this));
+  query_start_state_draw_pending_ = true;
   context_->queueRender();
 }
 
@@ -916,21 +930,21 @@ void MotionPlanningDisplay::scheduleDrawQueryGoalState(robot_interaction::RobotI
   addBackgroundJob(boost::bind(&MotionPlanningDisplay::publishInteractiveMarkers, this, !error_state_changed),
                    "publishInteractiveMarkers");
   recomputeQueryGoalStateMetrics();
-  addMainLoopJob(boost::bind(&MotionPlanningDisplay::drawQueryGoalState, this));
+  query_goal_state_draw_pending_ = true;
   context_->queueRender();
 }
 
 void MotionPlanningDisplay::updateQueryStartState()
 {
   recomputeQueryStartStateMetrics();
-  addMainLoopJob(boost::bind(&MotionPlanningDisplay::changedQueryStartState, this));
+  query_start_state_changed_ = true;
   context_->queueRender();
 }
 
 void MotionPlanningDisplay::updateQueryGoalState()
 {
   recomputeQueryGoalStateMetrics();
-  addMainLoopJob(boost::bind(&MotionPlanningDisplay::changedQueryGoalState, this));
+  query_goal_state_changed_ = true;
   context_->queueRender();
 }
 
@@ -979,9 +993,17 @@ bool MotionPlanningDisplay::isIKSolutionCollisionFree(robot_state::RobotState* s
 
 void MotionPlanningDisplay::updateLinkColors()
 {
+  std::string group = planning_group_property_->getStdString();
+  if (link_colors_valid_ && link_colors_group_ == group && link_colors_start_ == status_links_start_ &&
+      link_colors_goal_ == status_links_goal_)
+    return;
+  link_colors_valid_ = true;
+  link_colors_group_ = group;
+  link_colors_start_ = status_links_start_;
+  link_colors_goal_ = status_links_goal_;
+
   unsetAllColors(&query_robot_start_->getRobot());
   unsetAllColors(&query_robot_goal_->getRobot());
-  std::string group = planning_group_property_->getStdString();
   if (!group.empty())
   {
     setGroupColor(&query_robot_start_->getRobot(), group, query_start_color_property_->getColor());
@@ -1132,6 +1154,7 @@ void MotionPlanningDisplay::onRobotModelLoaded()
   int_marker_display_->subProp("Update Topic")
       ->setValue(QString::fromStdString(robot_interaction_->getServerTopic() + "/update"));
   query_robot_start_->load(*getRobotModel()->getURDF());
+  link_colors_valid_ = false;
   query_robot_goal_->load(*getRobotModel()->getURDF());
 
   robot_state::RobotStatePtr ks(new robot_state::RobotState(getPlanningSceneRO()->getCurrentState()));
@@ -1198,6 +1221,16 @@ void MotionPlanningDisplay::updateStateExceptModified(robot_state::RobotState& d
   dest = src_copy;
 }
 
+static bool samePositions(const robot_state::RobotState& a, const robot_state::RobotState& b)
+{
+  std::vector<const robot_state::AttachedBody*> a_bodies, b_bodies;
+  a.getAttachedBodies(a_bodies);
+  b.getAttachedBodies(b_bodies);
+  return a_bodies.size() == b_bodies.size() &&
+         std::equal(a.getVariablePositions(), a.getVariablePositions() + a.getVariableCount(),
+                    b.getVariablePositions());
+}
+
 void MotionPlanningDisplay::onSceneMonitorReceivedUpdate(
     planning_scene_monitor::PlanningSceneMonitor::SceneUpdateType update_type)
 {
@@ -1205,18 +1238,24 @@ void MotionPlanningDisplay::onSceneMonitorReceivedUpdate(
   robot_state::RobotState current_state = getPlanningSceneRO()->getCurrentState();
   std::string group = planning_group_property_->getStdString();
 
+  // only states that actually change are set again; otherwise the scene may still have changed what they collide with
+  bool scene_changed = update_type & ~planning_scene_monitor::PlanningSceneMonitor::UPDATE_STATE;
   if (query_start_state_property_->getBool() && !group.empty())
   {
-    robot_state::RobotState start = *getQueryStartState();
+    robot_state::RobotStateConstPtr previous = getQueryStartState();
+    robot_state::RobotState start = *previous;
     updateStateExceptModified(start, current_state);
-    setQueryStartState(start);
+    if (scene_changed || !samePositions(start, *previous))
+      setQueryStartState(start);
   }
 
   if (query_goal_state_property_->getBool() && !group.empty())
   {
-    robot_state::RobotState goal = *getQueryGoalState();
+    robot_state::RobotStateConstPtr previous = getQueryGoalState();
+    robot_state::RobotState goal = *previous;
     updateStateExceptModified(goal, current_state);
-    setQueryGoalState(goal);
+    if (scene_changed || !samePositions(goal, *previous))
+      setQueryGoalState(goal);
   }
 
   if (frame_)
@@ -1278,6 +1317,28 @@ void MotionPlanningDisplay::update(float wall_dt, float ros_dt)
     frame_->updateSceneMarkers(wall_dt, ros_dt);
 
   PlanningSceneDisplay::update(wall_dt, ros_dt);
+
+  if (!query_start_state_changed_ && !query_goal_state_changed_ && !query_start_state_draw_pending_ &&
+      !query_goal_state_draw_pending_)
+    return;
+  ros::WallTime now = ros::WallTime::now();
+  if (now - last_query_state_update_ < ros::WallDuration(QUERY_STATE_UPDATE_PERIOD))
+    return;
+  last_query_state_update_ = now;
+
+  // a change redraws the state as well
+  bool start_changed = query_start_state_changed_.exchange(false);
+  bool start_draw = query_start_state_draw_pending_.exchange(false);
+  if (start_changed)
+    changedQueryStartState();
+  else if (start_draw)
+    drawQueryStartState();
+  bool goal_changed = query_goal_state_changed_.exchange(false);
+  bool goal_draw = query_goal_state_draw_pending_.exchange(false);
+  if (goal_changed)
+    changedQueryGoalState();
+  else if (goal_draw)
+    drawQueryGoalState();
 }
 
 void MotionPlanningDisplay::updateInternal(float wall_dt, float ros_dt)
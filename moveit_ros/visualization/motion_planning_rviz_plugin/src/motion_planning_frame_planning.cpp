@@ -72,7 +72,9 @@ void MotionPlanningFrame::planAndExecuteButtonClicked()
 void MotionPlanningFrame::stopButtonClicked()
 {
   ui_->stop_button->setEnabled(false);  // avoid clicking again
-  planning_display_->addBackgroundJob(boost::bind(&MotionPlanningFrame::computeStopButtonClicked, this), "stop");
+  // do not wait for other queued jobs before stopping
+  planning_display_->addBackgroundJob(boost::bind(&MotionPlanningFrame::computeStopButtonClicked, this), "stop",
+                                      moveit::tools::BackgroundProcessing::HIGH);
 }
 
 void MotionPlanningFrame::allowReplanningToggled(bool checked)
@@ -85,8 +85,10 @@ public:
   void queueRenderSceneGeometry();
 
   /** Queue this function call for execution within the background thread
-      All jobs are queued and processed in order by a single background thread. */
-  void addBackgroundJob(const boost::function<void()>& job, const std::string& name);
+      All jobs are queued and processed by a single background thread, in order within each priority class. */
+  void addBackgroundJob(const boost::function<void()>& job, const std::string& name,
+                        moveit::tools::BackgroundProcessing::JobPriority priority =
+                            moveit::tools::BackgroundProcessing::NORMAL);
 
   /** Directly spawn a (detached) background thread for execution of this function call
       Should be used, when order of processing is not relevant / job can run in parallel.
@@ -212,9 +212,10 @@ void PlanningSceneDisplay::reset()
   }
 }
 
-void PlanningSceneDisplay::addBackgroundJob(const boost::function<void()>& job, const std::string& name)
+void PlanningSceneDisplay::addBackgroundJob(const boost::function<void()>& job, const std::string& name,
+                                            moveit::tools::BackgroundProcessing::JobPriority priority)
 {
-  background_process_.addJob(job, name);
+  background_process_.addJob(job, name, priority);
 }
 
 void PlanningSceneDisplay::spawnBackgroundJob(const boost::function<void()>& job)
@@ -37,8 +37,10 @@
 #ifndef MOVEIT_VISUALIZATION_SCENE_DISPLAY_RVIZ_OCTOMAP_RENDER_
 #define MOVEIT_VISUALIZATION_SCENE_DISPLAY_RVIZ_OCTOMAP_RENDER_
 
+#include <map>
 #include <memory>
 #include <vector>
+#include <stdint.h>
 #include <rviz/ogre_helpers/point_cloud.h>
 
 #include <moveit/rviz_plugin_render_tools/octomap_render.h>
@@ -82,7 +84,22 @@ public:
   void setPosition(const Ogre::Vector3& position);
   void setOrientation(const Ogre::Quaternion& orientation);
 
+  /** \brief Render \e octree instead of the current one. Voxels are grouped in point clouds by depth and by spatial
+      block; only the clouds whose voxels changed are rebuilt. */
+  void update(const std::shared_ptr<const octomap::OcTree>& octree, OctreeVoxelRenderMode octree_voxel_rendering,
+              OctreeVoxelColorMode octree_color_mode);
+
 private:
+  /** \brief The voxels of one depth level within one spatial block, and the cloud that renders them */
+  struct VoxelBlock
+  {
+    rviz::PointCloud* cloud_;
+    std::vector<rviz::PointCloud::Point> points_;
+  };
+
+  /** \brief Voxel blocks, indexed by (depth, block) */
+  typedef std::map<std::pair<unsigned int, uint64_t>, VoxelBlock> VoxelBlockMap;
+
   void setColor(double z_pos, double min_z, double max_z, double color_factor, rviz::PointCloud::Point* point);
   void setProbColor(double prob, rviz::PointCloud::Point* point);
 
@@ -90,13 +107,14 @@ private:
                       OctreeVoxelRenderMode octree_voxel_rendering, OctreeVoxelColorMode octree_color_mode);
 
   // Ogre-rviz point clouds
-  std::vector<rviz::PointCloud*> cloud_;
+  VoxelBlockMap blocks_;
   std::shared_ptr<const octomap::OcTree> octree_;
 
   Ogre::SceneNode* scene_node_;
   Ogre::SceneManager* scene_manager_;
 
   double colorFactor_;
+  std::size_t max_octree_depth_;
   std::size_t octree_depth_;
 };
 }
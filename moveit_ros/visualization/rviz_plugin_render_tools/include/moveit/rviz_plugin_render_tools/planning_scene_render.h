@@ -42,6 +42,7 @@
 #include <moveit/rviz_plugin_render_tools/render_shapes.h>
 #include <rviz/helpers/color.h>
 #include <OgreMaterial.h>
+#include <map>
 
 namespace Ogre
 {
@@ -82,9 +83,21 @@ public:
   void clear();
 
 private:
+  /** \brief What was last rendered for a world object. World objects are copied on write while we hold a
+      reference to them, so an unchanged pointer means an unchanged object. */
+  struct RenderedObject
+  {
+    collision_detection::World::ObjectConstPtr object_;
+    rviz::Color color_;
+    float alpha_;
+    OctreeVoxelRenderMode voxel_render_mode_;
+    OctreeVoxelColorMode voxel_color_mode_;
+    RenderShapesPtr render_shapes_;
+  };
+
   Ogre::SceneNode* planning_scene_geometry_node_;
   rviz::DisplayContext* context_;
-  RenderShapesPtr render_shapes_;
+  std::map<std::string, RenderedObject> rendered_objects_;
   RobotStateVisualizationPtr scene_robot_;
 };
 }
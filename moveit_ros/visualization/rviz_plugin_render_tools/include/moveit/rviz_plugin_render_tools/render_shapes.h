@@ -70,6 +70,10 @@ public:
   void renderShape(Ogre::SceneNode* node, const shapes::Shape* s, const Eigen::Affine3d& p,
                    OctreeVoxelRenderMode octree_voxel_rendering, OctreeVoxelColorMode octree_color_mode,
                    const rviz::Color& color, float alpha);
+  /** \brief If the only rendered shape is an octree, render \e s in its place, updating its existing point clouds.
+      Returns false (and renders nothing) otherwise. */
+  bool updateOcTree(const shapes::OcTree* s, const Eigen::Affine3d& p, OctreeVoxelRenderMode octree_voxel_rendering,
+                    OctreeVoxelColorMode octree_color_mode);
   void clear();
 
 private:
@@ -123,6 +123,9 @@ protected:
   void incomingDisplayTrajectory(const moveit_msgs::DisplayTrajectory::ConstPtr& msg);
   float getStateDisplayTime();
   void clearTrajectoryTrail();
+  /** \brief Show the trail robots of the waypoints up to and including \e waypoint, hide the others. Only robots whose
+      visibility changes are touched. */
+  void setTrailVisibleUpTo(int waypoint);
 
   // Handles actually drawing the robot along motion plans
   RobotStateVisualizationPtr display_path_robot_;
@@ -133,7 +136,10 @@ protected:
 
   robot_trajectory::RobotTrajectoryPtr displaying_trajectory_message_;
   robot_trajectory::RobotTrajectoryPtr trajectory_message_to_display_;
+  // trail robots are kept between trajectories and only the first trajectory_trail_waypoints_.size() are in use
   std::vector<rviz::Robot*> trajectory_trail_;
+  std::vector<int> trajectory_trail_waypoints_;  // the waypoint shown by each trail robot in use, ascending
+  std::size_t trail_visible_count_;              // the number of trail robots currently shown
   ros::Subscriber trajectory_topic_sub_;
   bool animating_path_;
   bool drop_displaying_trajectory_;
@@ -165,6 +171,7 @@ protected:
   rviz::ColorProperty* robot_color_property_;
   rviz::BoolProperty* enable_robot_color_property_;
   rviz::IntProperty* trail_step_size_property_;
+  rviz::FloatProperty* trail_min_distance_property_;
 };
 
 }  // namespace moveit_rviz_plugin
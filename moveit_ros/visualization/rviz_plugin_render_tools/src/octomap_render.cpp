@@ -44,56 +44,73 @@
 
 #include <rviz/ogre_helpers/point_cloud.h>
 
+#include <sstream>
+
 namespace moveit_rviz_plugin
 {
 typedef std::vector<rviz::PointCloud::Point> VPoint;
-typedef std::vector<VPoint> VVPoint;
+
+// voxel blocks span 2^BLOCK_SHIFT leaf cells along each axis
+static const unsigned int BLOCK_SHIFT = 5;
+
+static bool samePoints(const VPoint& a, const VPoint& b)
+{
+  if (a.size() != b.size())
+    return false;
+  for (std::size_t i = 0; i < a.size(); ++i)
+    if (a[i].position != b[i].position || a[i].color != b[i].color)
+      return false;
+  return true;
+}
 
 OcTreeRender::OcTreeRender(const std::shared_ptr<const octomap::OcTree>& octree,
                            OctreeVoxelRenderMode octree_voxel_rendering, OctreeVoxelColorMode octree_color_mode,
                            std::size_t max_octree_depth, Ogre::SceneManager* scene_manager,
                            Ogre::SceneNode* parent_node = NULL)
-  : octree_(octree), colorFactor_(0.8)
+  : scene_manager_(scene_manager), colorFactor_(0.8), max_octree_depth_(max_octree_depth), octree_depth_(0)
 {
   if (!parent_node)
   {
     parent_node = scene_manager_->getRootSceneNode();
   }
 
-  if (!max_octree_depth)
-  {
-    octree_depth_ = octree->getTreeDepth();
-  }
-  else
-  {
-    octree_depth_ = std::min(max_octree_depth, (std::size_t)octree->getTreeDepth());
-  }
-
   scene_node_ = parent_node->createChildSceneNode();
 
-  cloud_.resize(octree_depth_);
-
-  for (std::size_t i = 0; i < octree_depth_; ++i)
-  {
-    std::stringstream sname;
-    sname << "PointCloud Nr." << i;
-    cloud_[i] = new rviz::PointCloud();
-    cloud_[i]->setName(sname.str());
-    cloud_[i]->setRenderMode(rviz::PointCloud::RM_BOXES);
-    scene_node_->attachObject(cloud_[i]);
-  }
-
-  octreeDecoding(octree, octree_voxel_rendering, octree_color_mode);
+  update(octree, octree_voxel_rendering, octree_color_mode);
 }
 
 OcTreeRender::~OcTreeRender()
 {
   scene_node_->detachAllObjects();
 
-  for (std::size_t i = 0; i < octree_depth_; ++i)
+  for (VoxelBlockMap::iterator it = blocks_.begin(); it != blocks_.end(); ++it)
+  {
+    delete it->second.cloud_;
+  }
+}
+
+void OcTreeRender::update(const std::shared_ptr<const octomap::OcTree>& octree,
+                          OctreeVoxelRenderMode octree_voxel_rendering, OctreeVoxelColorMode octree_color_mode)
+{
+  std::size_t octree_depth = octree->getTreeDepth();
+  if (max_octree_depth_)
   {
-    delete cloud_[i];
+    octree_depth = std::min(max_octree_depth_, octree_depth);
+  }
+  // blocks and node sizes of the existing clouds are only valid for the same depth and resolution
+  if (!octree_ || octree_depth != octree_depth_ || octree_->getResolution() != octree->getResolution())
+  {
+    scene_node_->detachAllObjects();
+    for (VoxelBlockMap::iterator it = blocks_.begin(); it != blocks_.end(); ++it)
+    {
+      delete it->second.cloud_;
+    }
+    blocks_.clear();
+    octree_depth_ = octree_depth;
   }
+  octree_ = octree;
+
+  octreeDecoding(octree, octree_voxel_rendering, octree_color_mode);
 }
 
 void OcTreeRender::setPosition(const Ogre::Vector3& position)
@@ -157,8 +174,7 @@ void OcTreeRender::setColor(double z_pos, double min_z, double max_z, double col
 void OcTreeRender::octreeDecoding(const std::shared_ptr<const octomap::OcTree>& octree,
                                   OctreeVoxelRenderMode octree_voxel_rendering, OctreeVoxelColorMode octree_color_mode)
 {
-  VVPoint pointBuf_;
-  pointBuf_.resize(octree_depth_);
+  std::map<std::pair<unsigned int, uint64_t>, VPoint> pointBuf_;
 
   // get dimensions of octree
   double minX, minY, minZ, maxX, maxY, maxZ;
@@ -230,24 +246,55 @@ void OcTreeRender::octreeDecoding(const std::shared_ptr<const octomap::OcTree>&
             break;
         }
 
-        // push to point vectors
-        unsigned int depth = it.getDepth();
-        pointBuf_[depth - 1].push_back(newPoint);
+        // push to the point vector of the voxel's depth and block
+        const octomap::OcTreeKey& vkey = it.getKey();
+        uint64_t block = (static_cast<uint64_t>(vkey[0] >> BLOCK_SHIFT) << 32) |
+                         (static_cast<uint64_t>(vkey[1] >> BLOCK_SHIFT) << 16) |
+                         static_cast<uint64_t>(vkey[2] >> BLOCK_SHIFT);
+        pointBuf_[std::make_pair(it.getDepth(), block)].push_back(newPoint);
 
         ++pointCount;
       }
     }
   }
 
-  for (size_t i = 0; i < octree_depth_; ++i)
+  // drop the clouds of blocks that have no voxels anymore
+  for (VoxelBlockMap::iterator it = blocks_.begin(); it != blocks_.end();)
   {
-    double size = octree->getNodeSize(i + 1);
+    if (pointBuf_.find(it->first) == pointBuf_.end())
+    {
+      scene_node_->detachObject(it->second.cloud_);
+      delete it->second.cloud_;
+      blocks_.erase(it++);
+    }
+    else
+      ++it;
+  }
 
-    cloud_[i]->clear();
-    cloud_[i]->setDimensions(size, size, size);
+  // rebuild the clouds whose voxels changed; the others keep their buffers
+  for (std::map<std::pair<unsigned int, uint64_t>, VPoint>::iterator it = pointBuf_.begin(); it != pointBuf_.end();
+       ++it)
+  {
+    VoxelBlockMap::iterator bit = blocks_.find(it->first);
+    if (bit == blocks_.end())
+    {
+      std::stringstream sname;
+      sname << "PointCloud Nr." << it->first.first << "." << it->first.second;
+      VoxelBlock block;
+      block.cloud_ = new rviz::PointCloud();
+      block.cloud_->setName(sname.str());
+      block.cloud_->setRenderMode(rviz::PointCloud::RM_BOXES);
+      double size = octree->getNodeSize(it->first.first);
+      block.cloud_->setDimensions(size, size, size);
+      scene_node_->attachObject(block.cloud_);
+      bit = blocks_.insert(std::make_pair(it->first, block)).first;
+    }
+    else if (samePoints(bit->second.points_, it->second))
+      continue;
 
-    cloud_[i]->addPoints(&pointBuf_[i].front(), pointBuf_[i].size());
-    pointBuf_[i].clear();
+    bit->second.cloud_->clear();
+    bit->second.cloud_->addPoints(&it->second.front(), it->second.size());
+    bit->second.points_.swap(it->second);
   }
 }
 }
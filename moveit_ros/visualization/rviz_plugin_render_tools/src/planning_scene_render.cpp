@@ -48,17 +48,17 @@ PlanningSceneRender::PlanningSceneRender(Ogre::SceneNode* node, rviz::DisplayCon
                                          const RobotStateVisualizationPtr& robot)
   : planning_scene_geometry_node_(node->createChildSceneNode()), context_(context), scene_robot_(robot)
 {
-  render_shapes_.reset(new RenderShapes(context));
 }
 
 PlanningSceneRender::~PlanningSceneRender()
 {
+  clear();
   context_->getSceneManager()->destroySceneNode(planning_scene_geometry_node_->getName());
 }
 
 void PlanningSceneRender::clear()
 {
-  render_shapes_->clear();
+  rendered_objects_.clear();
 }
 
 void PlanningSceneRender::renderPlanningScene(const planning_scene::PlanningSceneConstPtr& scene,
@@ -70,8 +70,6 @@ void PlanningSceneRender::renderPlanningScene(const planning_scene::PlanningScen
   if (!scene)
     return;
 
-  clear();
-
   if (scene_robot_)
   {
     robot_state::RobotState* rs = new robot_state::RobotState(scene->getCurrentState());
@@ -87,10 +85,20 @@ void PlanningSceneRender::renderPlanningScene(const planning_scene::PlanningScen
     scene_robot_->update(robot_state::RobotStateConstPtr(rs), color, color_map);
   }
 
-  const std::vector<std::string>& ids = scene->getWorld()->getObjectIds();
+  // only objects that were added, removed or changed since the last call are rendered again
+  const collision_detection::WorldConstPtr& world = scene->getWorld();
+  for (std::map<std::string, RenderedObject>::iterator it = rendered_objects_.begin(); it != rendered_objects_.end();)
+  {
+    if (!world->hasObject(it->first))
+      rendered_objects_.erase(it++);
+    else
+      ++it;
+  }
+
+  const std::vector<std::string>& ids = world->getObjectIds();
   for (std::size_t i = 0; i < ids.size(); ++i)
   {
-    collision_detection::CollisionWorld::ObjectConstPtr o = scene->getWorld()->getObject(ids[i]);
+    collision_detection::CollisionWorld::ObjectConstPtr o = world->getObject(ids[i]);
     rviz::Color color = default_env_color;
     float alpha = default_scene_alpha;
     if (scene->hasObjectColor(ids[i]))
@@ -101,9 +109,34 @@ void PlanningSceneRender::renderPlanningScene(const planning_scene::PlanningScen
       color.b_ = c.b;
       alpha = c.a;
     }
+
+    RenderedObject& rendered = rendered_objects_[ids[i]];
+    bool same_appearance = rendered.render_shapes_ && rendered.color_.r_ == color.r_ &&
+                           rendered.color_.g_ == color.g_ && rendered.color_.b_ == color.b_ &&
+                           rendered.alpha_ == alpha && rendered.voxel_render_mode_ == octree_voxel_rendering &&
+                           rendered.voxel_color_mode_ == octree_color_mode;
+    if (same_appearance && rendered.object_ == o)
+      continue;
+
+    rendered.object_ = o;
+    rendered.color_ = color;
+    rendered.alpha_ = alpha;
+    rendered.voxel_render_mode_ = octree_voxel_rendering;
+    rendered.voxel_color_mode_ = octree_color_mode;
+
+    // an updated octomap reuses the point clouds of the previous one
+    if (same_appearance && o->shapes_.size() == 1 && o->shapes_[0]->type == shapes::OCTREE &&
+        rendered.render_shapes_->updateOcTree(static_cast<const shapes::OcTree*>(o->shapes_[0].get()),
+                                              o->shape_poses_[0], octree_voxel_rendering, octree_color_mode))
+      continue;
+
+    if (rendered.render_shapes_)
+      rendered.render_shapes_->clear();
+    else
+      rendered.render_shapes_.reset(new RenderShapes(context_));
     for (std::size_t j = 0; j < o->shapes_.size(); ++j)
-      render_shapes_->renderShape(planning_scene_geometry_node_, o->shapes_[j].get(), o->shape_poses_[j],
-                                  octree_voxel_rendering, octree_color_mode, color, alpha);
+      rendered.render_shapes_->renderShape(planning_scene_geometry_node_, o->shapes_[j].get(), o->shape_poses_[j],
+                                           octree_voxel_rendering, octree_color_mode, color, alpha);
   }
 }
 }
@@ -71,6 +71,19 @@ void RenderShapes::clear()
   octree_voxel_grids_.clear();
 }
 
+bool RenderShapes::updateOcTree(const shapes::OcTree* s, const Eigen::Affine3d& p,
+                                OctreeVoxelRenderMode octree_voxel_rendering, OctreeVoxelColorMode octree_color_mode)
+{
+  if (!scene_shapes_.empty() || octree_voxel_grids_.size() != 1)
+    return false;
+  Eigen::Vector3d translation = p.translation();
+  Eigen::Quaterniond q(p.rotation());
+  octree_voxel_grids_[0]->update(s->octree, octree_voxel_rendering, octree_color_mode);
+  octree_voxel_grids_[0]->setPosition(Ogre::Vector3(translation.x(), translation.y(), translation.z()));
+  octree_voxel_grids_[0]->setOrientation(Ogre::Quaternion(q.w(), q.x(), q.y(), q.z()));
+  return true;
+}
+
 void RenderShapes::renderShape(Ogre::SceneNode* node, const shapes::Shape* s, const Eigen::Affine3d& p,
                                OctreeVoxelRenderMode octree_voxel_rendering, OctreeVoxelColorMode octree_color_mode,
                                const rviz::Color& color, float alpha)
@@ -36,6 +36,7 @@
 
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/replace.hpp>
+#include <algorithm>
 
 #include <moveit/rviz_plugin_render_tools/trajectory_visualization.h>
 
@@ -64,6 +65,7 @@ TrajectoryVisualization::TrajectoryVisualization(rviz::Property* widget, rviz::D
   , animating_path_(false)
   , drop_displaying_trajectory_(false)
   , current_state_(-1)
+  , trail_visible_count_(0)
   , trajectory_slider_panel_(NULL)
   , trajectory_slider_dock_panel_(NULL)
 {
@@ -109,6 +111,12 @@ TrajectoryVisualization::TrajectoryVisualization(rviz::Property* widget, rviz::D
                                                     widget, SLOT(changedTrailStepSize()), this);
   trail_step_size_property_->setMin(1);
 
+  trail_min_distance_property_ =
+      new rviz::FloatProperty("Trail Joint Distance", 0.0f, "Skips trail samples closer than this (joint-space) "
+                                                            "distance to the previous sample. 0 keeps all samples.",
+                              widget, SLOT(changedTrailStepSize()), this);
+  trail_min_distance_property_->setMin(0.0);
+
   interrupt_display_property_ = new rviz::BoolProperty(
       "Interrupt Display", false,
       "Immediately show newly planned trajectory, interrupting the currently displayed one.", widget);
@@ -179,6 +187,9 @@ void TrajectoryVisualization::onRobotModelLoaded(robot_model::RobotModelConstPtr
   robot_state_.reset(new robot_state::RobotState(robot_model_));
   robot_state_->setToDefaultValues();
 
+  // trail robots loaded for a previous model cannot be reused
+  clearTrajectoryTrail();
+
   // Load rviz robot
   display_path_robot_->load(*robot_model_->getURDF());
   enabledRobotColor();  // force-refresh to account for saved display configuration
@@ -201,6 +212,20 @@ void TrajectoryVisualization::clearTrajectoryTrail()
   for (std::size_t i = 0; i < trajectory_trail_.size(); ++i)
     delete trajectory_trail_[i];
   trajectory_trail_.clear();
+  trajectory_trail_waypoints_.clear();
+  trail_visible_count_ = 0;
+}
+
+void TrajectoryVisualization::setTrailVisibleUpTo(int waypoint)
+{
+  std::size_t count =
+      std::upper_bound(trajectory_trail_waypoints_.begin(), trajectory_trail_waypoints_.end(), waypoint) -
+      trajectory_trail_waypoints_.begin();
+  for (std::size_t i = count; i < trail_visible_count_; ++i)
+    trajectory_trail_[i]->setVisible(false);
+  for (std::size_t i = trail_visible_count_; i < count; ++i)
+    trajectory_trail_[i]->setVisible(true);
+  trail_visible_count_ = count;
 }
 
 void TrajectoryVisualization::changedLoopDisplay()
@@ -212,33 +237,65 @@ void TrajectoryVisualization::changedLoopDisplay()
 
 void TrajectoryVisualization::changedShowTrail()
 {
-  clearTrajectoryTrail();
-
   if (!trail_display_property_->getBool())
+  {
+    clearTrajectoryTrail();
     return;
+  }
   robot_trajectory::RobotTrajectoryPtr t = trajectory_message_to_display_;
   if (!t)
     t = displaying_trajectory_message_;
   if (!t)
+  {
+    clearTrajectoryTrail();
     return;
+  }
 
-  int stepsize = trail_step_size_property_->getInt();
+  // select the waypoints to show: every stepsize-th one, skipping those that barely move the robot
+  const int waypoint_count = t->getWayPointCount();
+  const int stepsize = trail_step_size_property_->getInt();
+  const double min_distance = trail_min_distance_property_->getFloat();
+  trajectory_trail_waypoints_.clear();
+  const robot_state::RobotState* last_sample = NULL;
+  for (int i = 0; i < waypoint_count; i += stepsize)
+  {
+    if (last_sample && min_distance > 0.0 && last_sample->distance(t->getWayPoint(i)) < min_distance)
+      continue;
+    trajectory_trail_waypoints_.push_back(i);
+    last_sample = &t->getWayPoint(i);
+  }
   // always include last trajectory point
-  trajectory_trail_.resize((int)std::ceil((t->getWayPointCount() + stepsize - 1) / (float)stepsize));
-  for (std::size_t i = 0; i < trajectory_trail_.size(); i++)
+  if (waypoint_count > 0 &&
+      (trajectory_trail_waypoints_.empty() || trajectory_trail_waypoints_.back() != waypoint_count - 1))
+    trajectory_trail_waypoints_.push_back(waypoint_count - 1);
+
+  // reuse the trail robots of previous trajectories; only load the missing ones
+  for (std::size_t i = trajectory_trail_.size(); i < trajectory_trail_waypoints_.size(); i++)
   {
-    int waypoint_i = std::min(i * stepsize, t->getWayPointCount() - 1);  // limit to last trajectory point
     rviz::Robot* r = new rviz::Robot(scene_node_, context_, "Trail Robot " + boost::lexical_cast<std::string>(i), NULL);
     r->load(*robot_model_->getURDF());
     r->setVisualVisible(display_path_visual_enabled_property_->getBool());
     r->setCollisionVisible(display_path_collision_enabled_property_->getBool());
     r->setAlpha(robot_path_alpha_property_->getFloat());
-    r->update(PlanningLinkUpdater(t->getWayPointPtr(waypoint_i)));
+    r->setVisible(false);
+    trajectory_trail_.push_back(r);
+  }
+  for (std::size_t i = 0; i < trajectory_trail_.size(); i++)
+  {
+    rviz::Robot* r = trajectory_trail_[i];
+    if (i >= trajectory_trail_waypoints_.size())
+    {
+      r->setVisible(false);
+      continue;
+    }
+    r->update(PlanningLinkUpdater(t->getWayPointPtr(trajectory_trail_waypoints_[i])));
     if (enable_robot_color_property_->getBool())
       setRobotColor(r, robot_color_property_->getColor());
-    r->setVisible(display_->isEnabled() && (!animating_path_ || waypoint_i <= current_state_));
-    trajectory_trail_[i] = r;
+    r->setVisible(false);
   }
+  trail_visible_count_ = 0;
+  if (display_->isEnabled())
+    setTrailVisibleUpTo(animating_path_ ? current_state_ : waypoint_count - 1);
 }
 
 void TrajectoryVisualization::changedTrailStepSize()
@@ -301,8 +358,9 @@ void TrajectoryVisualization::onEnable()
   {
     trajectory_trail_[i]->setVisualVisible(display_path_visual_enabled_property_->getBool());
     trajectory_trail_[i]->setCollisionVisible(display_path_collision_enabled_property_->getBool());
-    trajectory_trail_[i]->setVisible(true);
+    trajectory_trail_[i]->setVisible(i < trajectory_trail_waypoints_.size());
   }
+  trail_visible_count_ = trajectory_trail_waypoints_.size();
 
   changedTrajectoryTopic();  // load topic at startup if default used
 }
@@ -312,6 +370,7 @@ void TrajectoryVisualization::onDisable()
   display_path_robot_->setVisible(false);
   for (std::size_t i = 0; i < trajectory_trail_.size(); ++i)
     trajectory_trail_[i]->setVisible(false);
+  trail_visible_count_ = 0;
   displaying_trajectory_message_.reset();
   animating_path_ = false;
   if (trajectory_slider_panel_)
@@ -437,9 +496,7 @@ void TrajectoryVisualization::update(float wall_dt, float ros_dt)
       if (trajectory_slider_panel_)
         trajectory_slider_panel_->setSliderPosition(current_state_);
       display_path_robot_->update(displaying_trajectory_message_->getWayPointPtr(current_state_));
-      for (std::size_t i = 0; i < trajectory_trail_.size(); ++i)
-        trajectory_trail_[i]->setVisible(
-            std::min(waypoint_count - 1, static_cast<int>(i) * trail_step_size_property_->getInt()) <= current_state_);
+      setTrailVisibleUpTo(current_state_);
     }
     else
     {
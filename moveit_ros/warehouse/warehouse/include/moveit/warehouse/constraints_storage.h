@@ -61,6 +61,11 @@ public:
 
   void addConstraints(const moveit_msgs::Constraints& msg, const std::string& robot = "",
                       const std::string& group = "");
+
+  /** \brief Add several constraints at once, replacing existing constraints with the same name. The known names are
+      fetched once for the whole batch. */
+  void addConstraints(const std::vector<moveit_msgs::Constraints>& msgs, const std::string& robot = "",
+                      const std::string& group = "");
   bool hasConstraints(const std::string& name, const std::string& robot = "", const std::string& group = "") const;
   void getKnownConstraints(std::vector<std::string>& names, const std::string& robot = "",
                            const std::string& group = "") const;
@@ -60,6 +60,10 @@ protected:
   /// Keep only the \e names that match \e regex
   void filterNames(const std::string& regex, std::vector<std::string>& names) const;
 
+  /// Return true if \e regex contains no regular expression operators, so it can only match a name equal to itself.
+  /// Such patterns are looked up directly in the database instead of fetching and filtering every name.
+  static bool isLiteralName(const std::string& regex);
+
   warehouse_ros::DatabaseConnection::Ptr conn_;
 };
 
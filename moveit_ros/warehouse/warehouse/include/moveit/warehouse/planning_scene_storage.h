@@ -42,16 +42,27 @@
 #include <moveit_msgs/PlanningScene.h>
 #include <moveit_msgs/MotionPlanRequest.h>
 #include <moveit_msgs/RobotTrajectory.h>
+#include <octomap_msgs/Octomap.h>
+#include <shape_msgs/Mesh.h>
+#include <boost/function.hpp>
 
 namespace moveit_warehouse
 {
 typedef warehouse_ros::MessageWithMetadata<moveit_msgs::PlanningScene>::ConstPtr PlanningSceneWithMetadata;
 typedef warehouse_ros::MessageWithMetadata<moveit_msgs::MotionPlanRequest>::ConstPtr MotionPlanRequestWithMetadata;
 typedef warehouse_ros::MessageWithMetadata<moveit_msgs::RobotTrajectory>::ConstPtr RobotTrajectoryWithMetadata;
+typedef warehouse_ros::MessageWithMetadata<shape_msgs::Mesh>::ConstPtr MeshWithMetadata;
+typedef warehouse_ros::MessageWithMetadata<octomap_msgs::Octomap>::ConstPtr OctomapWithMetadata;
 
 typedef warehouse_ros::MessageCollection<moveit_msgs::PlanningScene>::Ptr PlanningSceneCollection;
 typedef warehouse_ros::MessageCollection<moveit_msgs::MotionPlanRequest>::Ptr MotionPlanRequestCollection;
 typedef warehouse_ros::MessageCollection<moveit_msgs::RobotTrajectory>::Ptr RobotTrajectoryCollection;
+typedef warehouse_ros::MessageCollection<shape_msgs::Mesh>::Ptr MeshCollection;
+typedef warehouse_ros::MessageCollection<octomap_msgs::Octomap>::Ptr OctomapCollection;
+
+/** \brief Callback invoked for each query streamed by PlanningSceneStorage::forEachPlanningQuery(). Receives the name
+    of the query and the query itself; returning false stops the iteration. */
+typedef boost::function<bool(const std::string&, const MotionPlanRequestWithMetadata&)> PlanningQueryCallback;
 
 MOVEIT_CLASS_FORWARD(PlanningSceneStorage);
 
@@ -63,6 +74,17 @@ public:
   static const std::string PLANNING_SCENE_ID_NAME;
   static const std::string MOTION_PLAN_REQUEST_ID_NAME;
 
+  /** \brief Metadata field holding the content hash of a stored mesh or octomap */
+  static const std::string CONTENT_HASH_NAME;
+  /** \brief Metadata fields of a stored planning scene that reference the meshes and the octomap it contains */
+  static const std::string MESH_REFERENCES_NAME;
+  static const std::string OCTOMAP_REFERENCE_NAME;
+  /** \brief Metadata field of a stored planning result telling what kind of result it is, if that was specified */
+  static const std::string RESULT_TYPE_NAME;
+
+  /** \brief Planning scenes are stored without their meshes and octomap data. Each distinct mesh and octomap is
+      stored once, keyed by a hash of its content, and scenes keep references to them. Octomap data is compressed.
+      getPlanningScene() puts the referenced content back, so this is transparent to users of this class. */
   PlanningSceneStorage(warehouse_ros::DatabaseConnection::Ptr conn);
 
   void addPlanningScene(const moveit_msgs::PlanningScene& scene);
@@ -70,6 +92,22 @@ public:
                         const std::string& query_name = "");
   void addPlanningResult(const moveit_msgs::MotionPlanRequest& planning_query,
                          const moveit_msgs::RobotTrajectory& result, const std::string& scene_name);
+  /** \brief Same as addPlanningResult() above, except that \e result_type (e.g. "planned" or "executed") is stored in
+      the RESULT_TYPE_NAME metadata field of the result */
+  void addPlanningResult(const moveit_msgs::MotionPlanRequest& planning_query,
+                         const moveit_msgs::RobotTrajectory& result, const std::string& scene_name,
+                         const std::string& result_type);
+
+  /** \brief Add several planning scenes at once. Existing scenes with the same names are replaced. The names already
+      in the database are fetched once for the whole batch, instead of once per scene. */
+  void addPlanningScenes(const std::vector<moveit_msgs::PlanningScene>& scenes);
+
+  /** \brief Add several queries to the scene \e scene_name at once. \e query_names is either empty or holds one name
+      per query; empty names are replaced by generated ones and existing queries with the same name are replaced.
+      Unlike addPlanningQuery(), this does not look for identical requests already stored under another name. */
+  void addPlanningQueries(const std::vector<moveit_msgs::MotionPlanRequest>& planning_queries,
+                          const std::string& scene_name,
+                          const std::vector<std::string>& query_names = std::vector<std::string>());
 
   bool hasPlanningScene(const std::string& name) const;
   void getPlanningSceneNames(std::vector<std::string>& names) const;
@@ -90,6 +128,13 @@ public:
   void getPlanningQueries(std::vector<MotionPlanRequestWithMetadata>& planning_queries,
                           std::vector<std::string>& query_names, const std::string& scene_name) const;
 
+  /** \brief Call \e callback for each query of \e scene_name whose name matches \e regex (all queries if \e regex is
+      empty), in name order. Only the metadata of the matching queries is listed up front; each query message is then
+      fetched and deserialized just before it is passed to \e callback, so only one of them is held at a time.
+      Returns the number of queries passed to \e callback. */
+  std::size_t forEachPlanningQuery(const std::string& regex, const std::string& scene_name,
+                                   const PlanningQueryCallback& callback) const;
+
   void getPlanningResults(std::vector<RobotTrajectoryWithMetadata>& planning_results, const std::string& scene_name,
                           const moveit_msgs::MotionPlanRequest& planning_query) const;
   void getPlanningResults(std::vector<RobotTrajectoryWithMetadata>& planning_results, const std::string& scene_name,
@@ -110,6 +155,19 @@ public:
 private:
   void createCollections();
 
+  /** \brief Insert \e scene, with its meshes and octomap replaced by references to deduplicated copies */
+  void insertPlanningScene(const moveit_msgs::PlanningScene& scene);
+  /** \brief Move the meshes and the octomap data of \e scene to their own collections, recording references to them
+      in \e metadata */
+  void storeSceneContent(moveit_msgs::PlanningScene& scene, warehouse_ros::Metadata& metadata);
+  /** \brief Put back the content referenced by \e scene_m into \e scene */
+  void restoreSceneContent(moveit_msgs::PlanningScene& scene, const PlanningSceneWithMetadata& scene_m) const;
+  /** \brief Store \e mesh unless an identical one is stored already. Return its key; empty on failure */
+  std::string storeMesh(const shape_msgs::Mesh& mesh);
+  /** \brief Store the compressed \e octomap unless an identical one is stored already. Return its key; empty on
+      failure */
+  std::string storeOctomap(const octomap_msgs::Octomap& octomap);
+
   std::string getMotionPlanRequestName(const moveit_msgs::MotionPlanRequest& planning_query,
                                        const std::string& scene_name) const;
   std::string addNewPlanningRequest(const moveit_msgs::MotionPlanRequest& planning_query, const std::string& scene_name,
@@ -118,6 +176,8 @@ private:
   PlanningSceneCollection planning_scene_collection_;
   MotionPlanRequestCollection motion_plan_request_collection_;
   RobotTrajectoryCollection robot_trajectory_collection_;
+  MeshCollection mesh_collection_;
+  OctomapCollection octomap_collection_;
 };
 }
 
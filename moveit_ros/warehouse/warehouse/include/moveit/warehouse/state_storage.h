@@ -59,6 +59,11 @@ public:
   RobotStateStorage(warehouse_ros::DatabaseConnection::Ptr conn);
 
   void addRobotState(const moveit_msgs::RobotState& msg, const std::string& name, const std::string& robot = "");
+
+  /** \brief Add one robot state per entry of \e names, replacing existing states with the same name. The known names
+      are fetched once for the whole batch. */
+  void addRobotStates(const std::vector<moveit_msgs::RobotState>& msgs, const std::vector<std::string>& names,
+                      const std::string& robot = "");
   bool hasRobotState(const std::string& name, const std::string& robot = "") const;
   void getKnownRobotStates(std::vector<std::string>& names, const std::string& robot = "") const;
   void getKnownRobotStates(const std::string& regex, std::vector<std::string>& names,
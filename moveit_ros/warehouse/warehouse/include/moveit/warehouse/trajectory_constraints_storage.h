@@ -62,6 +62,12 @@ public:
 
   void addTrajectoryConstraints(const moveit_msgs::TrajectoryConstraints& msg, const std::string& name,
                                 const std::string& robot = "", const std::string& group = "");
+
+  /** \brief Add one set of trajectory constraints per entry of \e names, replacing existing constraints with the same
+      name. The known names are fetched once for the whole batch. */
+  void addTrajectoryConstraints(const std::vector<moveit_msgs::TrajectoryConstraints>& msgs,
+                                const std::vector<std::string>& names, const std::string& robot = "",
+                                const std::string& group = "");
   bool hasTrajectoryConstraints(const std::string& name, const std::string& robot = "",
                                 const std::string& group = "") const;
   void getKnownTrajectoryConstraints(std::vector<std::string>& names, const std::string& robot = "",
@@ -35,6 +35,7 @@
 /* Author: Ioan Sucan */
 
 #include <moveit/warehouse/constraints_storage.h>
+#include <set>
 
 const std::string moveit_warehouse::ConstraintsStorage::DATABASE_NAME = "moveit_constraints";
 
@@ -80,6 +81,26 @@ void moveit_warehouse::ConstraintsStorage::addConstraints(const moveit_msgs::Con
   ROS_DEBUG("%s constraints '%s'", replace ? "Replaced" : "Added", msg.name.c_str());
 }
 
+void moveit_warehouse::ConstraintsStorage::addConstraints(const std::vector<moveit_msgs::Constraints>& msgs,
+                                                          const std::string& robot, const std::string& group)
+{
+  std::vector<std::string> known;
+  getKnownConstraints(known, robot, group);
+  std::set<std::string> existing(known.begin(), known.end());
+  for (std::size_t i = 0; i < msgs.size(); ++i)
+  {
+    bool replace = !existing.insert(msgs[i].name).second;
+    if (replace)
+      removeConstraints(msgs[i].name, robot, group);
+    Metadata::Ptr metadata = constraints_collection_->createMetadata();
+    metadata->append(CONSTRAINTS_ID_NAME, msgs[i].name);
+    metadata->append(ROBOT_NAME, robot);
+    metadata->append(CONSTRAINTS_GROUP_NAME, group);
+    constraints_collection_->insert(msgs[i], metadata);
+    ROS_DEBUG("%s constraints '%s'", replace ? "Replaced" : "Added", msgs[i].name.c_str());
+  }
+}
+
 bool moveit_warehouse::ConstraintsStorage::hasConstraints(const std::string& name, const std::string& robot,
                                                           const std::string& group) const
 {
@@ -97,6 +118,13 @@ void moveit_warehouse::ConstraintsStorage::getKnownConstraints(const std::string
                                                                std::vector<std::string>& names,
                                                                const std::string& robot, const std::string& group) const
 {
+  if (isLiteralName(regex))
+  {
+    names.clear();
+    if (hasConstraints(regex, robot, group))
+      names.push_back(regex);
+    return;
+  }
   getKnownConstraints(names, robot, group);
   filterNames(regex, names);
 }
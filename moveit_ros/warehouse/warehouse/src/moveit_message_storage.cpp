@@ -61,6 +61,11 @@ void moveit_warehouse::MoveItMessageStorage::filterNames(const std::string& rege
   }
 }
 
+bool moveit_warehouse::MoveItMessageStorage::isLiteralName(const std::string& regex)
+{
+  return !regex.empty() && regex.find_first_of(".[]{}()\\*+?|^$") == std::string::npos;
+}
+
 static std::unique_ptr<warehouse_ros::DatabaseLoader> dbloader;
 
 typename warehouse_ros::DatabaseConnection::Ptr moveit_warehouse::loadDatabase()
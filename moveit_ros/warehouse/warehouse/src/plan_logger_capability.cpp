@@ -0,0 +1,341 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "plan_logger_capability.h"
+#include <moveit/move_group/capability_names.h>
+#include <moveit/robot_state/conversions.h>
+#include <moveit/warehouse/warehouse_connector.h>
+#include <boost/functional/hash.hpp>
+#include <cstdio>
+
+namespace
+{
+const std::string PLANNED_RESULT_TYPE = "planned";
+const std::string EXECUTED_RESULT_TYPE = "executed";
+const std::string FAILED_EXECUTION_RESULT_TYPE = "execution_failed";
+
+// Scenes are named after their content, so identical scenes are stored once
+std::string getSceneName(const moveit_msgs::PlanningScene& scene)
+{
+  std::vector<uint8_t> buffer(ros::serialization::serializationLength(scene));
+  ros::serialization::OStream stream(buffer.data(), buffer.size());
+  ros::serialization::serialize(stream, scene);
+  char name[64];
+  std::snprintf(name, sizeof(name), "logged_scene_%016llx_%llu",
+                static_cast<unsigned long long>(boost::hash_range(buffer.begin(), buffer.end())),
+                static_cast<unsigned long long>(buffer.size()));
+  return name;
+}
+}
+
+moveit_warehouse::PlanLoggerCapability::PlanLoggerCapability()
+  : MoveGroupCapability("PlanLogger"), dropped_(0), enabled_(false), stop_(false)
+{
+}
+
+moveit_warehouse::PlanLoggerCapability::~PlanLoggerCapability()
+{
+  move_goal_subscriber_.shutdown();
+  move_result_subscriber_.shutdown();
+  execute_goal_subscriber_.shutdown();
+  execute_result_subscriber_.shutdown();
+  {
+    boost::mutex::scoped_lock slock(queue_lock_);
+    stop_ = true;
+  }
+  queue_condition_.notify_all();
+  if (write_thread_.joinable())
+    write_thread_.join();
+}
+
+void moveit_warehouse::PlanLoggerCapability::initialize()
+{
+  if (!context_->planning_scene_monitor_)
+  {
+    ROS_ERROR("The plan logger needs a planning scene monitor. Not logging plans.");
+    return;
+  }
+
+  int queue_size, batch_size;
+  double flush_period;
+  node_handle_.param("plan_logger/queue_size", queue_size, 100);
+  node_handle_.param("plan_logger/batch_size", batch_size, 10);
+  node_handle_.param("plan_logger/flush_period", flush_period, 1.0);
+  if (queue_size <= 0 || batch_size <= 0 || flush_period <= 0.0)
+  {
+    ROS_ERROR("The queue size, batch size and flush period of the plan logger must be positive. Not logging plans.");
+    return;
+  }
+  max_queue_size_ = queue_size;
+  batch_size_ = batch_size;
+  flush_period_ = ros::WallDuration(flush_period);
+
+  enabled_ = true;
+  write_thread_ = boost::thread(boost::bind(&PlanLoggerCapability::writeThread, this));
+
+  move_goal_subscriber_ = root_node_handle_.subscribe(move_group::MOVE_ACTION + "/goal", 10,
+                                                      &PlanLoggerCapability::moveGoalCallback, this);
+  move_result_subscriber_ = root_node_handle_.subscribe(move_group::MOVE_ACTION + "/result", 10,
+                                                        &PlanLoggerCapability::moveResultCallback, this);
+  execute_goal_subscriber_ = root_node_handle_.subscribe(move_group::EXECUTE_ACTION_NAME + "/goal", 10,
+                                                         &PlanLoggerCapability::executeGoalCallback, this);
+  execute_result_subscriber_ = root_node_handle_.subscribe(move_group::EXECUTE_ACTION_NAME + "/result", 10,
+                                                           &PlanLoggerCapability::executeResultCallback, this);
+}
+
+void moveit_warehouse::PlanLoggerCapability::moveGoalCallback(const moveit_msgs::MoveGroupActionGoalConstPtr& goal)
+{
+  if (!acceptGoal())
+    return;
+  LogEntry entry;
+  entry.request = goal->goal.request;
+  if (goal->goal.planning_options.plan_only)
+    snapshotScene(goal->goal.planning_options.planning_scene_diff, entry);
+  else
+  {
+    // the move action ignores the robot state of the diff when executing
+    moveit_msgs::PlanningScene scene_diff = goal->goal.planning_options.planning_scene_diff;
+    scene_diff.robot_state = moveit_msgs::RobotState();
+    scene_diff.robot_state.is_diff = true;
+    snapshotScene(scene_diff, entry);
+  }
+  addPendingGoal(goal->goal_id.id, entry);
+}
+
+void moveit_warehouse::PlanLoggerCapability::moveResultCallback(
+    const moveit_msgs::MoveGroupActionResultConstPtr& result)
+{
+  LogEntry entry;
+  if (!takePendingGoal(result->status.goal_id.id, entry))
+    return;
+  entry.planned_trajectory = result->result.planned_trajectory;
+  entry.executed_trajectory = result->result.executed_trajectory;
+  entry.executed_type = result->result.error_code.val == moveit_msgs::MoveItErrorCodes::SUCCESS ?
+                            EXECUTED_RESULT_TYPE :
+                            FAILED_EXECUTION_RESULT_TYPE;
+  queueEntry(entry);
+}
+
+void moveit_warehouse::PlanLoggerCapability::executeGoalCallback(
+    const moveit_msgs::ExecuteTrajectoryActionGoalConstPtr& goal)
+{
+  if (!acceptGoal())
+    return;
+  // directly executed trajectories have no request; they are all stored with an empty one
+  LogEntry entry;
+  entry.request.start_state.is_diff = true;
+  snapshotScene(moveit_msgs::PlanningScene(), entry);
+  entry.executed_trajectory = goal->goal.trajectory;
+  addPendingGoal(goal->goal_id.id, entry);
+}
+
+void moveit_warehouse::PlanLoggerCapability::executeResultCallback(
+    const moveit_msgs::ExecuteTrajectoryActionResultConstPtr& result)
+{
+  LogEntry entry;
+  if (!takePendingGoal(result->status.goal_id.id, entry))
+    return;
+  entry.executed_type = result->result.error_code.val == moveit_msgs::MoveItErrorCodes::SUCCESS ?
+                            EXECUTED_RESULT_TYPE :
+                            FAILED_EXECUTION_RESULT_TYPE;
+  queueEntry(entry);
+}
+
+bool moveit_warehouse::PlanLoggerCapability::acceptGoal()
+{
+  boost::mutex::scoped_lock slock(queue_lock_);
+  if (!enabled_)
+    return false;
+  if (queue_.size() < max_queue_size_)
+    return true;
+  countDropped();
+  return false;
+}
+
+void moveit_warehouse::PlanLoggerCapability::countDropped()
+{
+  ++dropped_;
+  ROS_WARN_THROTTLE(5.0, "The plan logger cannot keep up with writing to the warehouse. %lu entries were dropped.",
+                    static_cast<unsigned long>(dropped_));
+}
+
+void moveit_warehouse::PlanLoggerCapability::snapshotScene(const moveit_msgs::PlanningScene& scene_diff,
+                                                           LogEntry& entry) const
+{
+  // the state of the robot is kept with the request, so the scene stays the same while only the robot moves
+  planning_scene_monitor::LockedPlanningSceneRO ls(context_->planning_scene_monitor_);
+  planning_scene::PlanningSceneConstPtr scene = ls;
+  if (!planning_scene::PlanningScene::isEmpty(scene_diff))
+    scene = ls->diff(scene_diff);
+  moveit::core::robotStateToRobotStateMsg(*scene->getCurrentStateUpdated(entry.request.start_state),
+                                          entry.request.start_state);
+  scene->getPlanningSceneMsg(entry.scene);
+  entry.scene.robot_state = moveit_msgs::RobotState();
+  entry.scene.robot_state.is_diff = true;
+}
+
+void moveit_warehouse::PlanLoggerCapability::addPendingGoal(const std::string& goal_id, LogEntry& entry)
+{
+  entry.stamp = ros::WallTime::now();
+  boost::mutex::scoped_lock slock(queue_lock_);
+  // results that never arrive must not make this grow forever
+  if (pending_goals_.size() >= max_queue_size_)
+  {
+    std::map<std::string, LogEntry>::iterator oldest = pending_goals_.begin();
+    for (std::map<std::string, LogEntry>::iterator it = pending_goals_.begin(); it != pending_goals_.end(); ++it)
+      if (it->second.stamp < oldest->second.stamp)
+        oldest = it;
+    pending_goals_.erase(oldest);
+  }
+  std::swap(pending_goals_[goal_id], entry);
+}
+
+bool moveit_warehouse::PlanLoggerCapability::takePendingGoal(const std::string& goal_id, LogEntry& entry)
+{
+  boost::mutex::scoped_lock slock(queue_lock_);
+  std::map<std::string, LogEntry>::iterator it = pending_goals_.find(goal_id);
+  if (it == pending_goals_.end())
+    return false;
+  std::swap(it->second, entry);
+  pending_goals_.erase(it);
+  return true;
+}
+
+void moveit_warehouse::PlanLoggerCapability::queueEntry(LogEntry& entry)
+{
+  {
+    boost::mutex::scoped_lock slock(queue_lock_);
+    if (queue_.size() >= max_queue_size_)
+    {
+      countDropped();
+      return;
+    }
+    queue_.push_back(LogEntry());
+    std::swap(queue_.back(), entry);
+    if (queue_.size() < batch_size_)
+      return;
+  }
+  queue_condition_.notify_one();
+}
+
+void moveit_warehouse::PlanLoggerCapability::writeThread()
+{
+  // connecting may take a while, so it is not done when move_group starts
+  std::string host;
+  int port;
+  root_node_handle_.param<std::string>("warehouse_host", host, "localhost");
+  root_node_handle_.param<int>("warehouse_port", port, 33829);
+  try
+  {
+    warehouse_ros::DatabaseConnection::Ptr conn = loadDatabase();
+    conn->setParams(host, port, 5.0);
+    if (!conn->connect())
+      throw std::runtime_error("Failed to connect to the warehouse on " + host + ":" + std::to_string(port));
+    storage_.reset(new PlanningSceneStorage(conn));
+    ROS_INFO("Logging plans to the warehouse on %s:%d", host.c_str(), port);
+  }
+  catch (std::exception& ex)
+  {
+    ROS_ERROR("%s. Not logging plans.", ex.what());
+    boost::mutex::scoped_lock slock(queue_lock_);
+    enabled_ = false;
+    pending_goals_.clear();
+    queue_.clear();
+    return;
+  }
+
+  std::vector<LogEntry> entries;
+  while (true)
+  {
+    {
+      boost::mutex::scoped_lock slock(queue_lock_);
+      // write whenever a batch is complete, and at least once per flush period
+      const boost::system_time timeout = boost::get_system_time() + flush_period_.toBoost();
+      while (!stop_ && queue_.size() < batch_size_)
+        if (!queue_condition_.timed_wait(slock, timeout))
+          break;
+      if (stop_)
+        break;
+      while (!queue_.empty() && entries.size() < batch_size_)
+      {
+        entries.push_back(LogEntry());
+        std::swap(entries.back(), queue_.front());
+        queue_.pop_front();
+      }
+    }
+    if (!entries.empty())
+      writeEntries(entries);
+    entries.clear();
+  }
+}
+
+void moveit_warehouse::PlanLoggerCapability::writeEntries(std::vector<LogEntry>& entries)
+{
+  try
+  {
+    std::vector<moveit_msgs::PlanningScene> scenes;
+    for (std::size_t i = 0; i < entries.size(); ++i)
+    {
+      entries[i].scene.name = getSceneName(entries[i].scene);
+      if (stored_scenes_.insert(entries[i].scene.name).second && !storage_->hasPlanningScene(entries[i].scene.name))
+        scenes.push_back(entries[i].scene);
+    }
+    if (!scenes.empty())
+      storage_->addPlanningScenes(scenes);
+
+    for (std::size_t i = 0; i < entries.size(); ++i)
+    {
+      const LogEntry& entry = entries[i];
+      if (!entry.planned_trajectory.joint_trajectory.points.empty() ||
+          !entry.planned_trajectory.multi_dof_joint_trajectory.points.empty())
+        storage_->addPlanningResult(entry.request, entry.planned_trajectory, entry.scene.name, PLANNED_RESULT_TYPE);
+      if (!entry.executed_trajectory.joint_trajectory.points.empty() ||
+          !entry.executed_trajectory.multi_dof_joint_trajectory.points.empty())
+        storage_->addPlanningResult(entry.request, entry.executed_trajectory, entry.scene.name, entry.executed_type);
+      else if (entry.planned_trajectory.joint_trajectory.points.empty() &&
+               entry.planned_trajectory.multi_dof_joint_trajectory.points.empty())
+        // failed requests are worth keeping as well
+        storage_->addPlanningQuery(entry.request, entry.scene.name);
+    }
+  }
+  catch (std::exception& ex)
+  {
+    // the scenes of this batch may not have been stored
+    stored_scenes_.clear();
+    ROS_ERROR("Failed to log %u plans to the warehouse: %s", static_cast<unsigned int>(entries.size()), ex.what());
+  }
+}
+
+#include <class_loader/class_loader.hpp>
+CLASS_LOADER_REGISTER_CLASS(moveit_warehouse::PlanLoggerCapability, move_group::MoveGroupCapability)
@@ -0,0 +1,122 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef MOVEIT_MOVEIT_WAREHOUSE_PLAN_LOGGER_CAPABILITY_
+#define MOVEIT_MOVEIT_WAREHOUSE_PLAN_LOGGER_CAPABILITY_
+
+#include <moveit/move_group/move_group_capability.h>
+#include <moveit/warehouse/planning_scene_storage.h>
+#include <moveit_msgs/MoveGroupActionGoal.h>
+#include <moveit_msgs/MoveGroupActionResult.h>
+#include <moveit_msgs/ExecuteTrajectoryActionGoal.h>
+#include <moveit_msgs/ExecuteTrajectoryActionResult.h>
+#include <boost/thread.hpp>
+#include <deque>
+#include <map>
+#include <set>
+
+namespace moveit_warehouse
+{
+/** \brief Log the requests, plans and executed trajectories of the move_group and execute_trajectory actions to the
+    warehouse, together with the scenes they were planned in.
+
+    The goal and result topics of the actions are listened to, so the actions themselves are never delayed. Entries
+    are queued and written in batches by a background thread; each distinct scene is stored once. If more entries
+    wait to be written than the queue holds, new ones are dropped. */
+class PlanLoggerCapability : public move_group::MoveGroupCapability
+{
+public:
+  PlanLoggerCapability();
+  virtual ~PlanLoggerCapability();
+
+  virtual void initialize();
+
+private:
+  struct LogEntry
+  {
+    moveit_msgs::PlanningScene scene;
+    moveit_msgs::MotionPlanRequest request;
+    moveit_msgs::RobotTrajectory planned_trajectory;
+    moveit_msgs::RobotTrajectory executed_trajectory;
+    std::string executed_type;
+    ros::WallTime stamp;
+  };
+
+  void moveGoalCallback(const moveit_msgs::MoveGroupActionGoalConstPtr& goal);
+  void moveResultCallback(const moveit_msgs::MoveGroupActionResultConstPtr& result);
+  void executeGoalCallback(const moveit_msgs::ExecuteTrajectoryActionGoalConstPtr& goal);
+  void executeResultCallback(const moveit_msgs::ExecuteTrajectoryActionResultConstPtr& result);
+
+  /** \brief Return true if an entry for a new goal can be queued; counts the entry as dropped otherwise */
+  bool acceptGoal();
+  /** \brief Count an entry as dropped and warn about it; the queue lock must be held */
+  void countDropped();
+  /** \brief Fill in the scene of \e entry with the current scene updated by \e scene_diff, and its start state with
+      the current state updated by the start state of the request */
+  void snapshotScene(const moveit_msgs::PlanningScene& scene_diff, LogEntry& entry) const;
+  /** \brief Keep \e entry until the result of \e goal_id arrives. If too many goals are pending, the oldest one is
+      forgotten */
+  void addPendingGoal(const std::string& goal_id, LogEntry& entry);
+  /** \brief Move the pending entry of \e goal_id to \e entry; returns false if there is no such entry */
+  bool takePendingGoal(const std::string& goal_id, LogEntry& entry);
+  /** \brief Queue \e entry for writing, or drop it if the queue is full */
+  void queueEntry(LogEntry& entry);
+
+  void writeThread();
+  void writeEntries(std::vector<LogEntry>& entries);
+
+  std::size_t max_queue_size_;
+  std::size_t batch_size_;
+  ros::WallDuration flush_period_;
+
+  PlanningSceneStoragePtr storage_;
+  std::set<std::string> stored_scenes_;
+
+  boost::mutex queue_lock_;
+  boost::condition_variable queue_condition_;
+  std::map<std::string, LogEntry> pending_goals_;
+  std::deque<LogEntry> queue_;
+  std::size_t dropped_;
+  bool enabled_;
+  bool stop_;
+  boost::thread write_thread_;
+
+  ros::Subscriber move_goal_subscriber_;
+  ros::Subscriber move_result_subscriber_;
+  ros::Subscriber execute_goal_subscriber_;
+  ros::Subscriber execute_result_subscriber_;
+};
+}
+
+#endif
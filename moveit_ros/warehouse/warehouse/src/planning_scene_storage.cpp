@@ -35,16 +35,97 @@
 /* Author: Ioan Sucan */
 
 #include <moveit/warehouse/planning_scene_storage.h>
-#include <boost/regex.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/iostreams/copy.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <cstdio>
+#include <map>
+#include <set>
+#include <sstream>
 
 const std::string moveit_warehouse::PlanningSceneStorage::DATABASE_NAME = "moveit_planning_scenes";
 
 const std::string moveit_warehouse::PlanningSceneStorage::PLANNING_SCENE_ID_NAME = "planning_scene_id";
 const std::string moveit_warehouse::PlanningSceneStorage::MOTION_PLAN_REQUEST_ID_NAME = "motion_request_id";
+const std::string moveit_warehouse::PlanningSceneStorage::CONTENT_HASH_NAME = "content_hash";
+const std::string moveit_warehouse::PlanningSceneStorage::MESH_REFERENCES_NAME = "mesh_refs";
+const std::string moveit_warehouse::PlanningSceneStorage::OCTOMAP_REFERENCE_NAME = "octomap_ref";
+const std::string moveit_warehouse::PlanningSceneStorage::RESULT_TYPE_NAME = "result_type";
 
 using warehouse_ros::Metadata;
 using warehouse_ros::Query;
 
+namespace
+{
+const std::string COMPRESSION_NAME = "compression";
+
+template <typename M>
+std::vector<uint8_t> serializeMessage(const M& msg)
+{
+  std::vector<uint8_t> buffer(ros::serialization::serializationLength(msg));
+  ros::serialization::OStream stream(buffer.data(), buffer.size());
+  ros::serialization::serialize(stream, msg);
+  return buffer;
+}
+
+// The key of a stored message: 64 bit FNV-1a hash of its serialization, followed by the serialization length.
+// Content found under a key is compared byte for byte before it is reused, so a hash collision only costs the
+// deduplication of the colliding message.
+std::string contentKey(const std::vector<uint8_t>& data)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for (uint8_t byte : data)
+  {
+    hash ^= byte;
+    hash *= 1099511628211ULL;
+  }
+  char buffer[24];
+  snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+  return std::string(buffer) + "-" + boost::lexical_cast<std::string>(data.size());
+}
+
+std::vector<int8_t> compressData(const std::vector<int8_t>& data)
+{
+  std::vector<char> out;
+  {
+    boost::iostreams::filtering_ostream os;
+    os.push(boost::iostreams::zlib_compressor());
+    os.push(boost::iostreams::back_inserter(out));
+    os.write(reinterpret_cast<const char*>(data.data()), data.size());
+  }
+  return std::vector<int8_t>(out.begin(), out.end());
+}
+
+std::vector<int8_t> decompressData(const std::vector<int8_t>& data)
+{
+  std::vector<char> out;
+  boost::iostreams::filtering_istream is;
+  is.push(boost::iostreams::zlib_decompressor());
+  is.push(boost::iostreams::array_source(reinterpret_cast<const char*>(data.data()), data.size()));
+  boost::iostreams::copy(is, boost::iostreams::back_inserter(out));
+  return std::vector<int8_t>(out.begin(), out.end());
+}
+
+// Return true if a message stored under \e key serializes to \e data; \e found tells whether anything is stored
+// under \e key at all
+template <typename M>
+bool findStoredMessage(const typename warehouse_ros::MessageCollection<M>::Ptr& collection, const std::string& key,
+                       const std::vector<uint8_t>& data, bool& found)
+{
+  Query::Ptr q = collection->createQuery();
+  q->append(moveit_warehouse::PlanningSceneStorage::CONTENT_HASH_NAME, key);
+  std::vector<typename warehouse_ros::MessageWithMetadata<M>::ConstPtr> stored = collection->queryList(q, false);
+  found = !stored.empty();
+  for (std::size_t i = 0; i < stored.size(); ++i)
+    if (serializeMessage(static_cast<const M&>(*stored[i])) == data)
+      return true;
+  return false;
+}
+}
+
 moveit_warehouse::PlanningSceneStorage::PlanningSceneStorage(warehouse_ros::DatabaseConnection::Ptr conn)
   : MoveItMessageStorage(conn)
 {
@@ -58,6 +139,8 @@ void moveit_warehouse::PlanningSceneStorage::createCollections()
       conn_->openCollectionPtr<moveit_msgs::MotionPlanRequest>(DATABASE_NAME, "motion_plan_request");
   robot_trajectory_collection_ =
       conn_->openCollectionPtr<moveit_msgs::RobotTrajectory>(DATABASE_NAME, "robot_trajectory");
+  mesh_collection_ = conn_->openCollectionPtr<shape_msgs::Mesh>(DATABASE_NAME, "mesh");
+  octomap_collection_ = conn_->openCollectionPtr<octomap_msgs::Octomap>(DATABASE_NAME, "octomap");
 }
 
 void moveit_warehouse::PlanningSceneStorage::reset()
@@ -65,6 +148,8 @@ void moveit_warehouse::PlanningSceneStorage::reset()
   planning_scene_collection_.reset();
   motion_plan_request_collection_.reset();
   robot_trajectory_collection_.reset();
+  mesh_collection_.reset();
+  octomap_collection_.reset();
   conn_->dropDatabase(DATABASE_NAME);
   createCollections();
 }
@@ -77,10 +162,184 @@ void moveit_warehouse::PlanningSceneStorage::addPlanningScene(const moveit_msgs:
     removePlanningScene(scene.name);
     replace = true;
   }
+  insertPlanningScene(scene);
+  ROS_DEBUG("%s scene '%s'", replace ? "Replaced" : "Added", scene.name.c_str());
+}
+
+void moveit_warehouse::PlanningSceneStorage::addPlanningScenes(const std::vector<moveit_msgs::PlanningScene>& scenes)
+{
+  std::vector<std::string> names;
+  getPlanningSceneNames(names);
+  std::set<std::string> existing(names.begin(), names.end());
+  for (std::size_t i = 0; i < scenes.size(); ++i)
+  {
+    bool replace = !existing.insert(scenes[i].name).second;
+    if (replace)
+      removePlanningScene(scenes[i].name);
+    insertPlanningScene(scenes[i]);
+    ROS_DEBUG("%s scene '%s'", replace ? "Replaced" : "Added", scenes[i].name.c_str());
+  }
+}
+
+void moveit_warehouse::PlanningSceneStorage::insertPlanningScene(const moveit_msgs::PlanningScene& scene)
+{
   Metadata::Ptr metadata = planning_scene_collection_->createMetadata();
   metadata->append(PLANNING_SCENE_ID_NAME, scene.name);
-  planning_scene_collection_->insert(scene, metadata);
-  ROS_DEBUG("%s scene '%s'", replace ? "Replaced" : "Added", scene.name.c_str());
+  moveit_msgs::PlanningScene stripped = scene;
+  storeSceneContent(stripped, *metadata);
+  planning_scene_collection_->insert(stripped, metadata);
+}
+
+std::string moveit_warehouse::PlanningSceneStorage::storeMesh(const shape_msgs::Mesh& mesh)
+{
+  std::vector<uint8_t> data = serializeMessage(mesh);
+  std::string key = contentKey(data);
+  bool found;
+  if (findStoredMessage<shape_msgs::Mesh>(mesh_collection_, key, data, found))
+    return key;
+  if (found)
+  {
+    ROS_DEBUG("Content key '%s' is used by a different mesh; storing the mesh inline", key.c_str());
+    return "";
+  }
+  Metadata::Ptr metadata = mesh_collection_->createMetadata();
+  metadata->append(CONTENT_HASH_NAME, key);
+  mesh_collection_->insert(mesh, metadata);
+  return key;
+}
+
+std::string moveit_warehouse::PlanningSceneStorage::storeOctomap(const octomap_msgs::Octomap& octomap)
+{
+  octomap_msgs::Octomap compressed = octomap;
+  try
+  {
+    compressed.data = compressData(octomap.data);
+  }
+  catch (std::exception& ex)
+  {
+    ROS_ERROR("Unable to compress octomap: %s", ex.what());
+    return "";
+  }
+  // compression is deterministic, so the compressed message identifies the octomap as well
+  std::vector<uint8_t> data = serializeMessage(compressed);
+  std::string key = contentKey(data);
+  bool found;
+  if (findStoredMessage<octomap_msgs::Octomap>(octomap_collection_, key, data, found))
+    return key;
+  if (found)
+  {
+    ROS_DEBUG("Content key '%s' is used by a different octomap; storing the octomap inline", key.c_str());
+    return "";
+  }
+  Metadata::Ptr metadata = octomap_collection_->createMetadata();
+  metadata->append(CONTENT_HASH_NAME, key);
+  metadata->append(COMPRESSION_NAME, std::string("zlib"));
+  octomap_collection_->insert(compressed, metadata);
+  return key;
+}
+
+void moveit_warehouse::PlanningSceneStorage::storeSceneContent(moveit_msgs::PlanningScene& scene, Metadata& metadata)
+{
+  // references are written as "<o|a>:<object index>:<mesh index>:<key>", separated by spaces;
+  // 'o' refers to world collision objects, 'a' to attached ones
+  std::stringstream refs;
+  const auto store_meshes = [this, &refs](char kind, std::size_t object, moveit_msgs::CollisionObject& obj) {
+    for (std::size_t j = 0; j < obj.meshes.size(); ++j)
+    {
+      if (obj.meshes[j].triangles.empty() && obj.meshes[j].vertices.empty())
+        continue;
+      std::string key = storeMesh(obj.meshes[j]);
+      if (key.empty())
+        continue;
+      refs << kind << ':' << object << ':' << j << ':' << key << ' ';
+      obj.meshes[j] = shape_msgs::Mesh();
+    }
+  };
+  for (std::size_t i = 0; i < scene.world.collision_objects.size(); ++i)
+    store_meshes('o', i, scene.world.collision_objects[i]);
+  for (std::size_t i = 0; i < scene.robot_state.attached_collision_objects.size(); ++i)
+    store_meshes('a', i, scene.robot_state.attached_collision_objects[i].object);
+  if (!refs.str().empty())
+    metadata.append(MESH_REFERENCES_NAME, refs.str());
+
+  if (!scene.world.octomap.octomap.data.empty())
+  {
+    std::string key = storeOctomap(scene.world.octomap.octomap);
+    if (!key.empty())
+    {
+      metadata.append(OCTOMAP_REFERENCE_NAME, key);
+      scene.world.octomap.octomap.data.clear();
+    }
+  }
+}
+
+void moveit_warehouse::PlanningSceneStorage::restoreSceneContent(moveit_msgs::PlanningScene& scene,
+                                                                 const PlanningSceneWithMetadata& scene_m) const
+{
+  if (scene_m->lookupField(MESH_REFERENCES_NAME))
+  {
+    // the same mesh is often referenced several times within a scene
+    std::map<std::string, MeshWithMetadata> meshes;
+    std::stringstream refs(scene_m->lookupString(MESH_REFERENCES_NAME));
+    std::string ref;
+    while (refs >> ref)
+    {
+      char kind, sep1, sep2, sep3;
+      std::size_t object, index;
+      std::string key;
+      std::stringstream ss(ref);
+      if (!(ss >> kind >> sep1 >> object >> sep2 >> index >> sep3) || !(ss >> key))
+      {
+        ROS_ERROR("Malformed mesh reference '%s' in scene '%s'", ref.c_str(), scene.name.c_str());
+        continue;
+      }
+      moveit_msgs::CollisionObject* obj = nullptr;
+      if (kind == 'o' && object < scene.world.collision_objects.size())
+        obj = &scene.world.collision_objects[object];
+      else if (kind == 'a' && object < scene.robot_state.attached_collision_objects.size())
+        obj = &scene.robot_state.attached_collision_objects[object].object;
+      if (!obj || index >= obj->meshes.size())
+      {
+        ROS_ERROR("Mesh reference '%s' in scene '%s' does not match the scene", ref.c_str(), scene.name.c_str());
+        continue;
+      }
+
+      std::map<std::string, MeshWithMetadata>::iterator it = meshes.find(key);
+      if (it == meshes.end())
+      {
+        Query::Ptr q = mesh_collection_->createQuery();
+        q->append(CONTENT_HASH_NAME, key);
+        std::vector<MeshWithMetadata> stored = mesh_collection_->queryList(q, false);
+        it = meshes.insert(std::make_pair(key, stored.empty() ? MeshWithMetadata() : stored.front())).first;
+      }
+      if (it->second)
+        obj->meshes[index] = *it->second;
+      else
+        ROS_ERROR("Mesh '%s' used by scene '%s' was not found in the database", key.c_str(), scene.name.c_str());
+    }
+  }
+
+  if (scene_m->lookupField(OCTOMAP_REFERENCE_NAME))
+  {
+    const std::string key = scene_m->lookupString(OCTOMAP_REFERENCE_NAME);
+    Query::Ptr q = octomap_collection_->createQuery();
+    q->append(CONTENT_HASH_NAME, key);
+    std::vector<OctomapWithMetadata> stored = octomap_collection_->queryList(q, false);
+    if (stored.empty())
+      ROS_ERROR("Octomap '%s' used by scene '%s' was not found in the database", key.c_str(), scene.name.c_str());
+    else
+    {
+      try
+      {
+        scene.world.octomap.octomap.data = decompressData(stored.front()->data);
+      }
+      catch (std::exception& ex)
+      {
+        ROS_ERROR("Unable to decompress octomap '%s' used by scene '%s': %s", key.c_str(), scene.name.c_str(),
+                  ex.what());
+      }
+    }
+  }
 }
 
 bool moveit_warehouse::PlanningSceneStorage::hasPlanningScene(const std::string& name) const
@@ -168,9 +427,55 @@ std::string moveit_warehouse::PlanningSceneStorage::addNewPlanningRequest(
   return id;
 }
 
+void moveit_warehouse::PlanningSceneStorage::addPlanningQueries(
+    const std::vector<moveit_msgs::MotionPlanRequest>& planning_queries, const std::string& scene_name,
+    const std::vector<std::string>& query_names)
+{
+  if (!query_names.empty() && query_names.size() != planning_queries.size())
+  {
+    ROS_ERROR("Got %lu names for %lu planning queries of scene '%s'. No queries were added.", query_names.size(),
+              planning_queries.size(), scene_name.c_str());
+    return;
+  }
+
+  std::vector<std::string> names;
+  getPlanningQueriesNames(names, scene_name);
+  std::set<std::string> used(names.begin(), names.end());
+  std::size_t index = names.size();
+  for (std::size_t i = 0; i < planning_queries.size(); ++i)
+  {
+    std::string id = query_names.empty() ? std::string() : query_names[i];
+    if (id.empty())
+    {
+      do
+      {
+        id = "Motion Plan Request " + boost::lexical_cast<std::string>(index);
+        index++;
+      } while (used.find(id) != used.end());
+    }
+    else if (used.find(id) != used.end())
+      removePlanningQuery(scene_name, id);
+    used.insert(id);
+
+    Metadata::Ptr metadata = motion_plan_request_collection_->createMetadata();
+    metadata->append(PLANNING_SCENE_ID_NAME, scene_name);
+    metadata->append(MOTION_PLAN_REQUEST_ID_NAME, id);
+    motion_plan_request_collection_->insert(planning_queries[i], metadata);
+  }
+  ROS_DEBUG("Saved %lu planning queries for scene '%s'", planning_queries.size(), scene_name.c_str());
+}
+
 void moveit_warehouse::PlanningSceneStorage::addPlanningResult(const moveit_msgs::MotionPlanRequest& planning_query,
                                                                const moveit_msgs::RobotTrajectory& result,
                                                                const std::string& scene_name)
+{
+  addPlanningResult(planning_query, result, scene_name, "");
+}
+
+void moveit_warehouse::PlanningSceneStorage::addPlanningResult(const moveit_msgs::MotionPlanRequest& planning_query,
+                                                               const moveit_msgs::RobotTrajectory& result,
+                                                               const std::string& scene_name,
+                                                               const std::string& result_type)
 {
   std::string id = getMotionPlanRequestName(planning_query, scene_name);
   if (id.empty())
@@ -178,6 +483,8 @@ void moveit_warehouse::PlanningSceneStorage::addPlanningResult(const moveit_msgs
   Metadata::Ptr metadata = robot_trajectory_collection_->createMetadata();
   metadata->append(PLANNING_SCENE_ID_NAME, scene_name);
   metadata->append(MOTION_PLAN_REQUEST_ID_NAME, id);
+  if (!result_type.empty())
+    metadata->append(RESULT_TYPE_NAME, result_type);
   robot_trajectory_collection_->insert(result, metadata);
 }
 
@@ -195,6 +502,13 @@ void moveit_warehouse::PlanningSceneStorage::getPlanningSceneNames(std::vector<s
 void moveit_warehouse::PlanningSceneStorage::getPlanningSceneNames(const std::string& regex,
                                                                    std::vector<std::string>& names) const
 {
+  if (isLiteralName(regex))
+  {
+    names.clear();
+    if (hasPlanningScene(regex))
+      names.push_back(regex);
+    return;
+  }
   getPlanningSceneNames(names);
   filterNames(regex, names);
 }
@@ -224,9 +538,11 @@ bool moveit_warehouse::PlanningSceneStorage::getPlanningScene(PlanningSceneWithM
     return false;
   }
   scene_m = planning_scenes.back();
+  moveit_msgs::PlanningScene* scene =
+      const_cast<moveit_msgs::PlanningScene*>(static_cast<const moveit_msgs::PlanningScene*>(scene_m.get()));
   // in case the scene was renamed, the name in the message may be out of date
-  const_cast<moveit_msgs::PlanningScene*>(static_cast<const moveit_msgs::PlanningScene*>(scene_m.get()))->name =
-      scene_name;
+  scene->name = scene_name;
+  restoreSceneContent(*scene, scene_m);
   return true;
 }
 
@@ -263,7 +579,8 @@ void moveit_warehouse::PlanningSceneStorage::getPlanningQueriesNames(std::vector
 {
   Query::Ptr q = motion_plan_request_collection_->createQuery();
   q->append(PLANNING_SCENE_ID_NAME, scene_name);
-  std::vector<MotionPlanRequestWithMetadata> planning_queries = motion_plan_request_collection_->queryList(q, true);
+  std::vector<MotionPlanRequestWithMetadata> planning_queries =
+      motion_plan_request_collection_->queryList(q, true, MOTION_PLAN_REQUEST_ID_NAME, true);
   query_names.clear();
   for (std::size_t i = 0; i < planning_queries.size(); ++i)
     if (planning_queries[i]->lookupField(MOTION_PLAN_REQUEST_ID_NAME))
@@ -274,22 +591,15 @@ void moveit_warehouse::PlanningSceneStorage::getPlanningQueriesNames(const std::
                                                                      std::vector<std::string>& query_names,
                                                                      const std::string& scene_name) const
 {
-  getPlanningQueriesNames(query_names, scene_name);
-
-  if (!regex.empty())
+  if (isLiteralName(regex))
   {
-    std::vector<std::string> fnames;
-    boost::regex r(regex);
-    for (std::size_t i = 0; i < query_names.size(); ++i)
-    {
-      boost::cmatch match;
-      if (boost::regex_match(query_names[i].c_str(), match, r))
-      {
-        fnames.push_back(query_names[i]);
-      }
-    }
-    query_names.swap(fnames);
+    query_names.clear();
+    if (hasPlanningQuery(scene_name, regex))
+      query_names.push_back(regex);
+    return;
   }
+  getPlanningQueriesNames(query_names, scene_name);
+  filterNames(regex, query_names);
 }
 
 void moveit_warehouse::PlanningSceneStorage::getPlanningQueries(
@@ -307,6 +617,30 @@ void moveit_warehouse::PlanningSceneStorage::getPlanningQueries(
       query_names[i].clear();
 }
 
+std::size_t moveit_warehouse::PlanningSceneStorage::forEachPlanningQuery(const std::string& regex,
+                                                                        const std::string& scene_name,
+                                                                        const PlanningQueryCallback& callback) const
+{
+  std::vector<std::string> query_names;
+  getPlanningQueriesNames(regex, query_names, scene_name);
+
+  std::size_t count = 0;
+  for (std::size_t i = 0; i < query_names.size(); ++i)
+  {
+    Query::Ptr q = motion_plan_request_collection_->createQuery();
+    q->append(PLANNING_SCENE_ID_NAME, scene_name);
+    q->append(MOTION_PLAN_REQUEST_ID_NAME, query_names[i]);
+    std::vector<MotionPlanRequestWithMetadata> planning_queries = motion_plan_request_collection_->queryList(q, false);
+    // the query may have been removed since its name was listed
+    if (planning_queries.empty())
+      continue;
+    ++count;
+    if (!callback(query_names[i], planning_queries.front()))
+      break;
+  }
+  return count;
+}
+
 void moveit_warehouse::PlanningSceneStorage::getPlanningResults(
     std::vector<RobotTrajectoryWithMetadata>& planning_results, const std::string& scene_name,
     const moveit_msgs::MotionPlanRequest& planning_query) const
@@ -35,6 +35,7 @@
 /* Author: Ioan Sucan */
 
 #include <moveit/warehouse/state_storage.h>
+#include <set>
 
 const std::string moveit_warehouse::RobotStateStorage::DATABASE_NAME = "moveit_robot_states";
 
@@ -78,6 +79,31 @@ void moveit_warehouse::RobotStateStorage::addRobotState(const moveit_msgs::Robot
   ROS_DEBUG("%s robot state '%s'", replace ? "Replaced" : "Added", name.c_str());
 }
 
+void moveit_warehouse::RobotStateStorage::addRobotStates(const std::vector<moveit_msgs::RobotState>& msgs,
+                                                         const std::vector<std::string>& names,
+                                                         const std::string& robot)
+{
+  if (msgs.size() != names.size())
+  {
+    ROS_ERROR("Got %lu names for %lu robot states. No states were added.", names.size(), msgs.size());
+    return;
+  }
+  std::vector<std::string> known;
+  getKnownRobotStates(known, robot);
+  std::set<std::string> existing(known.begin(), known.end());
+  for (std::size_t i = 0; i < msgs.size(); ++i)
+  {
+    bool replace = !existing.insert(names[i]).second;
+    if (replace)
+      removeRobotState(names[i], robot);
+    Metadata::Ptr metadata = state_collection_->createMetadata();
+    metadata->append(STATE_NAME, names[i]);
+    metadata->append(ROBOT_NAME, robot);
+    state_collection_->insert(msgs[i], metadata);
+    ROS_DEBUG("%s robot state '%s'", replace ? "Replaced" : "Added", names[i].c_str());
+  }
+}
+
 bool moveit_warehouse::RobotStateStorage::hasRobotState(const std::string& name, const std::string& robot) const
 {
   Query::Ptr q = state_collection_->createQuery();
@@ -91,6 +117,13 @@ bool moveit_warehouse::RobotStateStorage::hasRobotState(const std::string& name,
 void moveit_warehouse::RobotStateStorage::getKnownRobotStates(const std::string& regex, std::vector<std::string>& names,
                                                               const std::string& robot) const
 {
+  if (isLiteralName(regex))
+  {
+    names.clear();
+    if (hasRobotState(regex, robot))
+      names.push_back(regex);
+    return;
+  }
   getKnownRobotStates(names, robot);
   filterNames(regex, names);
 }
@@ -35,6 +35,7 @@
 /* Author: Mario Prats, Ioan Sucan */
 
 #include <moveit/warehouse/trajectory_constraints_storage.h>
+#include <set>
 
 const std::string moveit_warehouse::TrajectoryConstraintsStorage::DATABASE_NAME = "moveit_trajectory_constraints";
 
@@ -83,6 +84,32 @@ void moveit_warehouse::TrajectoryConstraintsStorage::addTrajectoryConstraints(
   ROS_DEBUG("%s constraints '%s'", replace ? "Replaced" : "Added", name.c_str());
 }
 
+void moveit_warehouse::TrajectoryConstraintsStorage::addTrajectoryConstraints(
+    const std::vector<moveit_msgs::TrajectoryConstraints>& msgs, const std::vector<std::string>& names,
+    const std::string& robot, const std::string& group)
+{
+  if (msgs.size() != names.size())
+  {
+    ROS_ERROR("Got %lu names for %lu trajectory constraints. No constraints were added.", names.size(), msgs.size());
+    return;
+  }
+  std::vector<std::string> known;
+  getKnownTrajectoryConstraints(known, robot, group);
+  std::set<std::string> existing(known.begin(), known.end());
+  for (std::size_t i = 0; i < msgs.size(); ++i)
+  {
+    bool replace = !existing.insert(names[i]).second;
+    if (replace)
+      removeTrajectoryConstraints(names[i], robot, group);
+    Metadata::Ptr metadata = constraints_collection_->createMetadata();
+    metadata->append(CONSTRAINTS_ID_NAME, names[i]);
+    metadata->append(ROBOT_NAME, robot);
+    metadata->append(CONSTRAINTS_GROUP_NAME, group);
+    constraints_collection_->insert(msgs[i], metadata);
+    ROS_DEBUG("%s constraints '%s'", replace ? "Replaced" : "Added", names[i].c_str());
+  }
+}
+
 bool moveit_warehouse::TrajectoryConstraintsStorage::hasTrajectoryConstraints(const std::string& name,
                                                                               const std::string& robot,
                                                                               const std::string& group) const
@@ -102,6 +129,13 @@ void moveit_warehouse::TrajectoryConstraintsStorage::getKnownTrajectoryConstrain
                                                                                    const std::string& robot,
                                                                                    const std::string& group) const
 {
+  if (isLiteralName(regex))
+  {
+    names.clear();
+    if (hasTrajectoryConstraints(regex, robot, group))
+      names.push_back(regex);
+    return;
+  }
   getKnownTrajectoryConstraints(names, robot, group);
   filterNames(regex, names);
 }
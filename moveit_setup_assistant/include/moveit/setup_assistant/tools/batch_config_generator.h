@@ -0,0 +1,100 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef MOVEIT_MOVEIT_SETUP_ASSISTANT_TOOLS_BATCH_CONFIG_GENERATOR_
+#define MOVEIT_MOVEIT_SETUP_ASSISTANT_TOOLS_BATCH_CONFIG_GENERATOR_
+
+#include <moveit/setup_assistant/tools/moveit_config_data.h>
+#include <moveit/setup_assistant/tools/collision_matrix_cache.h>
+
+namespace moveit_setup_assistant
+{
+/**
+ * \brief Settings for regenerating config packages without the GUI
+ */
+struct BatchGeneratorOptions
+{
+  BatchGeneratorOptions()
+    : threads(0)
+    , trials(10000)
+    , min_collision_fraction(0.95)
+    , stable_trials(0)
+    , keep_old(false)
+    , skip_mask(0)
+    , verbose(false)
+  {
+  }
+
+  unsigned int threads;           // number of packages processed in parallel; 0 for the hardware concurrency
+  unsigned int trials;            // trials for searching never colliding pairs; 0 to not search them
+  double min_collision_fraction;  // fraction of sampled states in collision for a pair to be "always" colliding
+  unsigned int stable_trials;     // see computeDefaultCollisions()
+  bool keep_old;                  // keep the disabled collisions already present in the SRDF
+  size_t skip_mask;               // disabled reasons to not write into the SRDF, see setCollisionLinkPairs()
+  bool verbose;
+};
+
+/**
+ * \brief Load an existing config package like the start screen of the setup assistant does
+ * \param config_data Data to fill, should be freshly constructed
+ * \param pkg_path Path to the config package, containing the .setup_assistant file
+ * \return false if the URDF or SRDF could not be loaded. Missing optional config files only produce warnings
+ */
+bool loadConfigPackage(MoveItConfigData& config_data, const std::string& pkg_path);
+
+/**
+ * \brief Write the SRDF, all config/ YAML files and the .setup_assistant file of a loaded config package.
+ * Launch files are not touched.
+ * \return true if all files were written
+ */
+bool writeConfigFiles(MoveItConfigData& config_data);
+
+/**
+ * \brief Load a config package, recompute its collision matrix and write all its config files in one pass
+ * \param cache Results of link pairs shared with other packages
+ * \return true on success
+ */
+bool generateConfigPackage(const std::string& pkg_path, const BatchGeneratorOptions& options,
+                           CollisionMatrixCache& cache);
+
+/**
+ * \brief Run generateConfigPackage() for many packages in parallel, sharing one collision matrix cache
+ * \param succeeded Filled with the result for each of \e pkg_paths
+ * \return number of packages generated successfully
+ */
+std::size_t generateConfigPackages(const std::vector<std::string>& pkg_paths, const BatchGeneratorOptions& options,
+                                   CollisionMatrixCache& cache, std::vector<bool>& succeeded);
+}
+
+#endif
@@ -0,0 +1,99 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef MOVEIT_MOVEIT_SETUP_ASSISTANT_TOOLS_COLLISION_MATRIX_CACHE_
+#define MOVEIT_MOVEIT_SETUP_ASSISTANT_TOOLS_COLLISION_MATRIX_CACHE_
+
+#include <moveit/setup_assistant/tools/compute_default_collisions.h>
+#include <boost/thread/mutex.hpp>
+
+namespace moveit_setup_assistant
+{
+/**
+ * \brief Signature of a link pair for each pair of link names, see computeLinkPairSignatures()
+ */
+typedef std::map<std::pair<std::string, std::string>, std::string> LinkPairSignatureMap;
+
+/**
+ * \brief Thread-safe store of computed link pair results, keyed by link pair signature.
+ *
+ * Robot variants that share a sub-assembly produce the same signature for all link pairs within it, so one cache
+ * can be shared by the collision matrix computations of many robots to only sample the pairs that actually differ.
+ */
+class CollisionMatrixCache
+{
+public:
+  /** \brief Look up the result stored for \e signature. Returns false if there is none */
+  bool getLinkPairData(const std::string& signature, LinkPairData& data) const;
+
+  /** \brief Store the result for \e signature, replacing any previous one */
+  void setLinkPairData(const std::string& signature, const LinkPairData& data);
+
+  /** \brief Number of stored link pair results */
+  std::size_t size() const;
+
+  void clear();
+
+private:
+  mutable boost::mutex lock_;
+  std::map<std::string, LinkPairData> pairs_;
+};
+
+/**
+ * \brief Compute a name-independent signature for each link pair in \e link_pairs.
+ *
+ * The signature covers everything the result for a pair depends on: the collision geometry of both links and the
+ * joints on the kinematic path between them (type, origin, axis, bounds, default values and mimic settings) as well
+ * as which links on that path have geometry. Two pairs with the same signature always collide in the same states.
+ * \param model The robot model the link pairs refer to
+ * \param link_pairs The link pairs to compute signatures for, as generated by computeLinkPairs()
+ * \param signatures Filled with the signature of each link pair
+ */
+void computeLinkPairSignatures(const robot_model::RobotModel& model, const LinkPairMap& link_pairs,
+                               LinkPairSignatureMap& signatures);
+
+/**
+ * \brief Same as computeDefaultCollisions(), but reuses results for link pairs already stored in \e cache.
+ *
+ * Cached link pairs are excluded from sampling, only the remaining pairs are computed and then added to the cache.
+ * Results computed with different parameters are kept apart, so one cache may be used with any parameters.
+ */
+LinkPairMap computeDefaultCollisions(const planning_scene::PlanningSceneConstPtr& parent_scene,
+                                     CollisionMatrixCache& cache, unsigned int* progress,
+                                     const bool include_never_colliding, const unsigned int trials,
+                                     const double min_collision_faction, const bool verbose,
+                                     const unsigned int stable_trials = 0);
+}
+
+#endif
@@ -0,0 +1,92 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <ros/ros.h>
+#include <moveit/setup_assistant/tools/batch_config_generator.h>
+
+#include <boost/program_options.hpp>
+
+namespace po = boost::program_options;
+
+int main(int argc, char* argv[])
+{
+  moveit_setup_assistant::BatchGeneratorOptions options;
+  bool include_default = false, include_always = false;
+
+  po::options_description desc("Allowed options");
+  desc.add_options()("help", "show help")("config-pkgs", po::value<std::vector<std::string> >()->composing(),
+                                          "paths to moveit config packages")(
+      "threads", po::value(&options.threads), "number of packages generated in parallel, 0 for one per core")(
+      "default", po::bool_switch(&include_default), "disable default colliding pairs")(
+      "always", po::bool_switch(&include_always), "disable always colliding pairs")(
+      "keep", po::bool_switch(&options.keep_old), "keep disabled link from SRDF")(
+      "verbose", po::bool_switch(&options.verbose), "verbose output")(
+      "trials", po::value(&options.trials), "number of trials for searching never colliding pairs")(
+      "min-collision-fraction", po::value(&options.min_collision_fraction),
+      "fraction of small sample size to determine links that are alwas colliding")(
+      "stable-trials", po::value(&options.stable_trials),
+      "stop searching never colliding pairs after this many trials without finding a new pair");
+
+  po::positional_options_description pos_desc;
+  pos_desc.add("config-pkgs", -1);
+
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(desc).positional(pos_desc).run(), vm);
+  po::notify(vm);
+
+  if (vm.count("help") || !vm.count("config-pkgs"))
+  {
+    std::cout << "Usage: " << argv[0] << " [options] config_pkg..." << std::endl << desc << std::endl;
+    return 1;
+  }
+
+  if (!include_default)
+    options.skip_mask |= (1 << moveit_setup_assistant::DEFAULT);
+  if (!include_always)
+    options.skip_mask |= (1 << moveit_setup_assistant::ALWAYS);
+
+  const std::vector<std::string>& pkg_paths = vm["config-pkgs"].as<std::vector<std::string> >();
+
+  moveit_setup_assistant::CollisionMatrixCache cache;
+  std::vector<bool> succeeded;
+  std::size_t num_succeeded = moveit_setup_assistant::generateConfigPackages(pkg_paths, options, cache, succeeded);
+
+  for (std::size_t i = 0; i < pkg_paths.size(); ++i)
+    if (!succeeded[i])
+      ROS_ERROR_STREAM("Could not generate config package '" << pkg_paths[i] << "'");
+  ROS_INFO("Generated %u of %u config packages, %u link pairs cached", (unsigned int)num_succeeded,
+           (unsigned int)pkg_paths.size(), (unsigned int)cache.size());
+
+  return num_succeeded == pkg_paths.size() ? 0 : 1;
+}
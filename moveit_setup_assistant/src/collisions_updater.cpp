@@ -104,12 +104,13 @@ bool setup(moveit_setup_assistant::MoveItConfigData& config_data, bool keep_old,
 }
 
 moveit_setup_assistant::LinkPairMap compute(moveit_setup_assistant::MoveItConfigData& config_data, uint32_t trials,
-                                            double min_collision_fraction, bool verbose)
+                                            double min_collision_fraction, bool verbose, uint32_t stable_trials)
 {
   // TODO: spin thread and print progess if verbose
   unsigned int collision_progress;
   return moveit_setup_assistant::computeDefaultCollisions(config_data.getPlanningScene(), &collision_progress,
-                                                          trials > 0, trials, min_collision_fraction, verbose);
+                                                          trials > 0, trials, min_collision_fraction, verbose,
+                                                          stable_trials);
 }
 
 int main(int argc, char* argv[])
@@ -125,6 +126,7 @@ int main(int argc, char* argv[])
   double min_collision_fraction = 1.0;
 
   uint32_t never_trials = 0;
+  uint32_t stable_trials = 0;
 
   po::options_description desc("Allowed options");
   desc.add_options()("help", "show help")("config-pkg", po::value(&config_pkg_path), "path to moveit config package")(
@@ -142,7 +144,9 @@ int main(int argc, char* argv[])
 
                   ("trials", po::value(&never_trials), "number of trials for searching never colliding pairs")(
                       "min-collision-fraction", po::value(&min_collision_fraction),
-                      "fraction of small sample size to determine links that are alwas colliding");
+                      "fraction of small sample size to determine links that are alwas colliding")(
+                      "stable-trials", po::value(&stable_trials),
+                      "stop searching never colliding pairs after this many trials without finding a new pair");
 
   po::positional_options_description pos_desc;
   pos_desc.add("xacro-args", -1);
@@ -194,7 +198,8 @@ int main(int argc, char* argv[])
     return 1;
   }
 
-  moveit_setup_assistant::LinkPairMap link_pairs = compute(config_data, never_trials, min_collision_fraction, verbose);
+  moveit_setup_assistant::LinkPairMap link_pairs =
+      compute(config_data, never_trials, min_collision_fraction, verbose, stable_trials);
 
   size_t skip_mask = 0;
   if (!include_default)
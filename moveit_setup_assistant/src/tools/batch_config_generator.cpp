@@ -0,0 +1,203 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/setup_assistant/tools/batch_config_generator.h>
+#include <moveit/rdf_loader/rdf_loader.h>
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <ros/console.h>
+#include <algorithm>
+#include <atomic>
+
+namespace moveit_setup_assistant
+{
+namespace fs = boost::filesystem;
+
+// ******************************************************************************************
+// Load an existing config package, in the same order as the start screen of the setup assistant
+// ******************************************************************************************
+bool loadConfigPackage(MoveItConfigData& config_data, const std::string& pkg_path)
+{
+  if (!config_data.setPackagePath(pkg_path))
+  {
+    ROS_ERROR_STREAM("Could not set package path '" << pkg_path << "'");
+    return false;
+  }
+
+  std::string setup_assistant_path;
+  if (!config_data.getSetupAssistantYAMLPath(setup_assistant_path) ||
+      !config_data.inputSetupAssistantYAML(setup_assistant_path))
+  {
+    ROS_ERROR_STREAM("Could not parse .setup_assistant file of '" << pkg_path << "'");
+    return false;
+  }
+
+  // Load the URDF
+  if (!config_data.createFullURDFPath())
+  {
+    ROS_ERROR_STREAM("Could not find URDF '" << config_data.urdf_path_ << "' of '" << pkg_path << "'");
+    return false;
+  }
+  const std::vector<std::string> xacro_args = { config_data.xacro_args_ };
+  if (!rdf_loader::RDFLoader::loadXmlFileToString(config_data.urdf_string_, config_data.urdf_path_, xacro_args) ||
+      !config_data.urdf_model_->initString(config_data.urdf_string_))
+  {
+    ROS_ERROR_STREAM("Could not load URDF from '" << config_data.urdf_path_ << "'");
+    return false;
+  }
+  config_data.urdf_from_xacro_ = rdf_loader::RDFLoader::isXacroFile(config_data.urdf_path_);
+
+  // Load the SRDF
+  if (!config_data.createFullSRDFPath(config_data.config_pkg_path_))
+  {
+    ROS_ERROR_STREAM("Could not find SRDF '" << config_data.srdf_path_ << "' of '" << pkg_path << "'");
+    return false;
+  }
+  std::string srdf_string;
+  if (!rdf_loader::RDFLoader::loadXmlFileToString(srdf_string, config_data.srdf_path_, std::vector<std::string>()) ||
+      !config_data.srdf_->initString(*config_data.urdf_model_, srdf_string))
+  {
+    ROS_ERROR_STREAM("Could not load SRDF from '" << config_data.srdf_path_ << "'");
+    return false;
+  }
+
+  config_data.loadAllowedCollisionMatrix();
+
+  // Optional config files
+  const std::string config_path = config_data.appendPaths(config_data.config_pkg_path_, "config");
+  if (!config_data.inputKinematicsYAML(config_data.appendPaths(config_path, "kinematics.yaml")))
+    ROS_WARN_STREAM("Failed to parse kinematics.yaml of '" << pkg_path << "', kinematic solver settings are lost");
+
+  const std::string default_sensors_path =
+      config_data.appendPaths(config_data.setup_assistant_path_, "resources/default_config/sensors_3d.yaml");
+  const std::string sensors_path = config_data.appendPaths(config_path, "sensors_3d.yaml");
+  config_data.input3DSensorsYAML(default_sensors_path, fs::is_regular_file(sensors_path) ? sensors_path : "");
+
+  config_data.inputROSControllersYAML(config_data.appendPaths(config_path, "ros_controllers.yaml"));
+  config_data.inputOMPLYAML(config_data.appendPaths(config_path, "ompl_planning.yaml"));
+
+  return true;
+}
+
+// ******************************************************************************************
+// Write all config files that do not come from templates
+// ******************************************************************************************
+bool writeConfigFiles(MoveItConfigData& config_data)
+{
+  const std::string config_path = config_data.appendPaths(config_data.config_pkg_path_, "config");
+  try
+  {
+    fs::create_directories(config_path);
+  }
+  catch (const fs::filesystem_error& e)
+  {
+    ROS_ERROR_STREAM("Could not create '" << config_path << "': " << e.what());
+    return false;
+  }
+
+  bool success = true;
+  success &= config_data.srdf_->writeSRDF(
+      config_data.appendPaths(config_data.config_pkg_path_, config_data.srdf_pkg_relative_path_));
+  success &= config_data.outputOMPLPlanningYAML(config_data.appendPaths(config_path, "ompl_planning.yaml"));
+  success &= config_data.outputCHOMPPlanningYAML(config_data.appendPaths(config_path, "chomp_planning.yaml"));
+  success &= config_data.outputKinematicsYAML(config_data.appendPaths(config_path, "kinematics.yaml"));
+  success &= config_data.outputJointLimitsYAML(config_data.appendPaths(config_path, "joint_limits.yaml"));
+  success &= config_data.outputFakeControllersYAML(config_data.appendPaths(config_path, "fake_controllers.yaml"));
+  success &= config_data.outputROSControllersYAML(config_data.appendPaths(config_path, "ros_controllers.yaml"));
+  success &= config_data.output3DSensorPluginYAML(config_data.appendPaths(config_path, "sensors_3d.yaml"));
+  success &= config_data.outputSetupAssistantFile(
+      config_data.appendPaths(config_data.config_pkg_path_, ".setup_assistant"));
+
+  if (!success)
+    ROS_ERROR_STREAM("Failed to write some config files of '" << config_data.config_pkg_path_ << "'");
+  return success;
+}
+
+// ******************************************************************************************
+// Regenerate the collision matrix and config files of one package
+// ******************************************************************************************
+bool generateConfigPackage(const std::string& pkg_path, const BatchGeneratorOptions& options,
+                           CollisionMatrixCache& cache)
+{
+  MoveItConfigData config_data;
+  if (!loadConfigPackage(config_data, pkg_path))
+    return false;
+
+  if (!options.keep_old)
+    config_data.srdf_->disabled_collisions_.clear();
+
+  unsigned int collision_progress;
+  LinkPairMap link_pairs = computeDefaultCollisions(
+      config_data.getPlanningScene(), cache, &collision_progress, options.trials > 0, options.trials,
+      options.min_collision_fraction, options.verbose, options.stable_trials);
+  config_data.setCollisionLinkPairs(link_pairs, options.skip_mask);
+
+  return writeConfigFiles(config_data);
+}
+
+// ******************************************************************************************
+// Regenerate many packages in parallel
+// ******************************************************************************************
+static void generateConfigPackagesThread(const std::vector<std::string>& pkg_paths,
+                                         const BatchGeneratorOptions& options, CollisionMatrixCache& cache,
+                                         std::atomic<std::size_t>& next, std::vector<char>& succeeded)
+{
+  for (std::size_t i = next++; i < pkg_paths.size(); i = next++)
+  {
+    ROS_INFO_STREAM("Generating config package '" << pkg_paths[i] << "'");
+    succeeded[i] = generateConfigPackage(pkg_paths[i], options, cache);
+  }
+}
+
+std::size_t generateConfigPackages(const std::vector<std::string>& pkg_paths, const BatchGeneratorOptions& options,
+                                   CollisionMatrixCache& cache, std::vector<bool>& succeeded)
+{
+  unsigned int num_threads = options.threads ? options.threads : boost::thread::hardware_concurrency();
+  num_threads = std::max(1u, std::min(num_threads, (unsigned int)pkg_paths.size()));
+
+  // std::vector<bool> packs its elements, so it cannot be written from several threads
+  std::vector<char> results(pkg_paths.size(), false);
+  std::atomic<std::size_t> next(0);
+
+  boost::thread_group bgroup;
+  for (unsigned int i = 0; i < num_threads; ++i)
+    bgroup.create_thread(boost::bind(&generateConfigPackagesThread, boost::cref(pkg_paths), boost::cref(options),
+                                     boost::ref(cache), boost::ref(next), boost::ref(results)));
+  bgroup.join_all();
+
+  succeeded.assign(results.begin(), results.end());
+  return std::count(succeeded.begin(), succeeded.end(), true);
+}
+}
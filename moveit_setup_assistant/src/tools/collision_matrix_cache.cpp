@@ -0,0 +1,271 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/setup_assistant/tools/collision_matrix_cache.h>
+#include <moveit/robot_model/revolute_joint_model.h>
+#include <moveit/robot_model/prismatic_joint_model.h>
+#include <geometric_shapes/shape_operations.h>
+#include <ros/console.h>
+#include <functional>
+#include <sstream>
+
+namespace moveit_setup_assistant
+{
+// Precision used when writing link and joint properties into signatures
+static const int SIGNATURE_PRECISION = 10;
+
+// Map of links to the hashed description of their collision geometry
+typedef std::map<const robot_model::LinkModel*, std::string> LinkGeometryMap;
+
+bool CollisionMatrixCache::getLinkPairData(const std::string& signature, LinkPairData& data) const
+{
+  boost::mutex::scoped_lock slock(lock_);
+  std::map<std::string, LinkPairData>::const_iterator it = pairs_.find(signature);
+  if (it == pairs_.end())
+    return false;
+  data = it->second;
+  return true;
+}
+
+void CollisionMatrixCache::setLinkPairData(const std::string& signature, const LinkPairData& data)
+{
+  boost::mutex::scoped_lock slock(lock_);
+  pairs_[signature] = data;
+}
+
+std::size_t CollisionMatrixCache::size() const
+{
+  boost::mutex::scoped_lock slock(lock_);
+  return pairs_.size();
+}
+
+void CollisionMatrixCache::clear()
+{
+  boost::mutex::scoped_lock slock(lock_);
+  pairs_.clear();
+}
+
+// ******************************************************************************************
+// Describe the collision geometry of a link, independent of its name. Meshes make this long, so it is hashed
+// ******************************************************************************************
+static std::string describeGeometry(const robot_model::LinkModel* link)
+{
+  std::stringstream ss;
+  ss.precision(SIGNATURE_PRECISION);
+  const std::vector<shapes::ShapeConstPtr>& shapes = link->getShapes();
+  const EigenSTL::vector_Affine3d& origins = link->getCollisionOriginTransforms();
+  for (std::size_t i = 0; i < shapes.size(); ++i)
+  {
+    shapes::saveAsText(shapes[i].get(), ss);
+    ss << origins[i].matrix() << std::endl;
+  }
+
+  std::stringstream hash;
+  hash << std::hex << std::hash<std::string>()(ss.str()) << ':' << shapes.size();
+  return hash.str();
+}
+
+// ******************************************************************************************
+// Describe everything about a joint that affects the relative pose of its parent and child link when sampled
+// ******************************************************************************************
+static void describeBounds(const robot_model::JointModel* joint, std::ostream& out)
+{
+  const robot_model::JointModel::Bounds& bounds = joint->getVariableBounds();
+  for (std::size_t i = 0; i < bounds.size(); ++i)
+    out << bounds[i].position_bounded_ << ' ' << bounds[i].min_position_ << ' ' << bounds[i].max_position_ << ' ';
+}
+
+static void describeJoint(const robot_model::JointModel* joint, std::ostream& out)
+{
+  out << joint->getTypeName() << ' ' << joint->getChildLinkModel()->getJointOriginTransform().matrix() << ' ';
+
+  if (const robot_model::RevoluteJointModel* revolute = dynamic_cast<const robot_model::RevoluteJointModel*>(joint))
+    out << revolute->getAxis().transpose() << ' ' << revolute->isContinuous() << ' ';
+  else if (const robot_model::PrismaticJointModel* prismatic =
+               dynamic_cast<const robot_model::PrismaticJointModel*>(joint))
+    out << prismatic->getAxis().transpose() << ' ';
+
+  describeBounds(joint, out);
+
+  std::vector<double> defaults(joint->getVariableCount());
+  if (!defaults.empty())
+    joint->getVariableDefaultPositions(&defaults[0]);
+  for (std::size_t i = 0; i < defaults.size(); ++i)
+    out << defaults[i] << ' ';
+
+  if (joint->getMimic())
+  {
+    out << "mimic " << joint->getMimicFactor() << ' ' << joint->getMimicOffset() << ' ';
+    describeBounds(joint->getMimic(), out);
+  }
+  out << ';';
+}
+
+// ******************************************************************************************
+// Describe the path from link up to (excluding) its ancestor, including the geometry of the link itself
+// ******************************************************************************************
+static std::string describeSide(const robot_model::LinkModel* link, const robot_model::LinkModel* ancestor,
+                                const LinkGeometryMap& geometry)
+{
+  std::stringstream ss;
+  ss.precision(SIGNATURE_PRECISION);
+  ss << geometry.at(link) << '/';
+  for (const robot_model::LinkModel* l = link; l != ancestor; l = l->getParentLinkModel())
+  {
+    describeJoint(l->getParentJointModel(), ss);
+    // intermediate links without geometry make links adjacent across them
+    if (l->getParentLinkModel() != ancestor)
+      ss << (l->getParentLinkModel()->getShapes().empty() ? '-' : '+');
+  }
+  return ss.str();
+}
+
+// ******************************************************************************************
+// Compute a name-independent signature for each link pair
+// ******************************************************************************************
+void computeLinkPairSignatures(const robot_model::RobotModel& model, const LinkPairMap& link_pairs,
+                               LinkPairSignatureMap& signatures)
+{
+  signatures.clear();
+
+  LinkGeometryMap geometry;
+  const std::vector<const robot_model::LinkModel*>& links = model.getLinkModelsWithCollisionGeometry();
+  for (std::size_t i = 0; i < links.size(); ++i)
+    geometry[links[i]] = describeGeometry(links[i]);
+
+  for (LinkPairMap::const_iterator pair_it = link_pairs.begin(); pair_it != link_pairs.end(); ++pair_it)
+  {
+    const robot_model::LinkModel* link_a = model.getLinkModel(pair_it->first.first);
+    const robot_model::LinkModel* link_b = model.getLinkModel(pair_it->first.second);
+    if (!link_a || !link_b)
+      continue;
+
+    // find the closest common ancestor of both links
+    std::set<const robot_model::LinkModel*> ancestors_a;
+    for (const robot_model::LinkModel* l = link_a; l; l = l->getParentLinkModel())
+      ancestors_a.insert(l);
+    const robot_model::LinkModel* ancestor = link_b;
+    while (!ancestors_a.count(ancestor))
+      ancestor = ancestor->getParentLinkModel();
+
+    std::string middle = "|";
+    if (ancestor != link_a && ancestor != link_b)
+      middle = ancestor->getShapes().empty() ? "|-|" : "|+|";
+
+    // the order of link names is arbitrary, so use the same order for both directions of the path
+    std::string side_a = describeSide(link_a, ancestor, geometry);
+    std::string side_b = describeSide(link_b, ancestor, geometry);
+    signatures[pair_it->first] = side_a < side_b ? side_a + middle + side_b : side_b + middle + side_a;
+  }
+}
+
+// ******************************************************************************************
+// Generate the collision matrix, only computing link pairs that are not cached yet
+// ******************************************************************************************
+LinkPairMap computeDefaultCollisions(const planning_scene::PlanningSceneConstPtr& parent_scene,
+                                     CollisionMatrixCache& cache, unsigned int* progress,
+                                     const bool include_never_colliding, const unsigned int trials,
+                                     const double min_collision_fraction, const bool verbose,
+                                     const unsigned int stable_trials)
+{
+  LinkPairMap link_pairs;
+  computeLinkPairs(*parent_scene, link_pairs);
+
+  LinkPairSignatureMap signatures;
+  computeLinkPairSignatures(*parent_scene->getRobotModel(), link_pairs, signatures);
+
+  // keep results of different parameters apart
+  std::stringstream settings;
+  settings.precision(SIGNATURE_PRECISION);
+  settings << include_never_colliding << ' ' << trials << ' ' << min_collision_fraction << ' ' << stable_trials << '#';
+  for (LinkPairSignatureMap::iterator it = signatures.begin(); it != signatures.end(); ++it)
+    it->second.insert(0, settings.str());
+
+  LinkPairMap cached_pairs;
+  for (LinkPairSignatureMap::const_iterator it = signatures.begin(); it != signatures.end(); ++it)
+  {
+    LinkPairData data;
+    if (cache.getLinkPairData(it->second, data))
+      cached_pairs[it->first] = data;
+  }
+
+  if (verbose)
+    ROS_INFO("Reusing %u of %u link pairs from the collision matrix cache", (unsigned int)cached_pairs.size(),
+             (unsigned int)link_pairs.size());
+
+  if (cached_pairs.size() == link_pairs.size())
+  {
+    *progress = 100;
+    return cached_pairs;
+  }
+
+  // exclude cached pairs from all collision checks
+  planning_scene::PlanningScenePtr scene = parent_scene->diff();
+  for (LinkPairMap::const_iterator it = cached_pairs.begin(); it != cached_pairs.end(); ++it)
+    scene->getAllowedCollisionMatrixNonConst().setEntry(it->first.first, it->first.second, true);
+
+  link_pairs = computeDefaultCollisions(scene, progress, include_never_colliding, trials, min_collision_fraction,
+                                        verbose, stable_trials);
+
+  // Pairs with the same signature may still differ by chance of sampling. Keep collision checking enabled for all
+  // of them if it is enabled for one, so the result does not depend on which of them gets cached.
+  std::map<std::string, LinkPairData> computed;
+  for (LinkPairMap::const_iterator pair_it = link_pairs.begin(); pair_it != link_pairs.end(); ++pair_it)
+  {
+    LinkPairSignatureMap::const_iterator signature_it = signatures.find(pair_it->first);
+    if (signature_it == signatures.end() || cached_pairs.count(pair_it->first))
+      continue;
+    std::map<std::string, LinkPairData>::iterator computed_it = computed.find(signature_it->second);
+    if (computed_it == computed.end())
+      computed[signature_it->second] = pair_it->second;
+    else if (computed_it->second.disable_check && !pair_it->second.disable_check)
+      computed_it->second = pair_it->second;
+  }
+
+  for (LinkPairMap::iterator pair_it = link_pairs.begin(); pair_it != link_pairs.end(); ++pair_it)
+  {
+    LinkPairMap::const_iterator cached_it = cached_pairs.find(pair_it->first);
+    LinkPairSignatureMap::const_iterator signature_it = signatures.find(pair_it->first);
+    if (cached_it != cached_pairs.end())
+      pair_it->second = cached_it->second;
+    else if (signature_it != signatures.end())
+      pair_it->second = computed[signature_it->second];
+  }
+
+  for (std::map<std::string, LinkPairData>::const_iterator it = computed.begin(); it != computed.end(); ++it)
+    cache.setLinkPairData(it->first, it->second);
+
+  return link_pairs;
+}
+}
@@ -41,6 +41,8 @@
 #include <boost/unordered_map.hpp>
 #include <boost/assign.hpp>
 #include <ros/console.h>
+#include <algorithm>
+#include <atomic>
 
 namespace moveit_setup_assistant
 {
@@ -58,18 +60,29 @@ const boost::unordered_map<std::string, DisabledReason> reasonsFromString = boos
 // Unique set of pairs of links in string-based form
 typedef std::set<std::pair<std::string, std::string> > StringPairSet;
 
+// Sampling state shared by all threads, used to decide when to stop early
+struct SharedSamplingState
+{
+  SharedSamplingState(unsigned int stable_trials) : stable_trials_(stable_trials), trials_done_(0), last_discovery_(0)
+  {
+  }
+  const unsigned int stable_trials_;          // stop once this many trials found nothing new; 0 to never stop early
+  std::atomic<unsigned int> trials_done_;     // trials completed by all threads
+  std::atomic<unsigned int> last_discovery_;  // value of trials_done_ when some thread last saw a new pair
+};
+
 // Struct for passing parameters to threads, for cleaner code
 struct ThreadComputation
 {
   ThreadComputation(planning_scene::PlanningScene& scene, const collision_detection::CollisionRequest& req,
-                    int thread_id, int num_trials, StringPairSet* links_seen_colliding, boost::mutex* lock,
+                    int thread_id, int num_trials, StringPairSet* links_seen_colliding, SharedSamplingState* shared,
                     unsigned int* progress)
     : scene_(scene)
     , req_(req)
     , thread_id_(thread_id)
     , num_trials_(num_trials)
     , links_seen_colliding_(links_seen_colliding)
-    , lock_(lock)
+    , shared_(shared)
     , progress_(progress)
   {
   }
@@ -77,8 +90,8 @@ struct ThreadComputation
   const collision_detection::CollisionRequest& req_;
   int thread_id_;
   unsigned int num_trials_;
-  StringPairSet* links_seen_colliding_;
-  boost::mutex* lock_;
+  StringPairSet* links_seen_colliding_;  // owned by this thread only; merged when all threads are done
+  SharedSamplingState* shared_;
   unsigned int* progress_;  // only to be updated by thread 0
 };
 
@@ -154,11 +167,13 @@ static unsigned int disableAlwaysInCollision(planning_scene::PlanningScene& scen
  * \param link_pairs List of all unique link pairs and each pair's properties
  * \param req A reference to a collision request that is already initialized
  * \param links_seen_colliding Set of links that have at some point been seen in collision
+ * \param stable_trials Stop once this many consecutive trials found no new colliding pair; 0 to run all trials
  * \return number of never in collision links found and disabled
  */
 static unsigned int disableNeverInCollision(const unsigned int num_trials, planning_scene::PlanningScene& scene,
                                             LinkPairMap& link_pairs, const collision_detection::CollisionRequest& req,
-                                            StringPairSet& links_seen_colliding, unsigned int* progress);
+                                            StringPairSet& links_seen_colliding, unsigned int* progress,
+                                            const unsigned int stable_trials);
 
 /**
  * \brief Thread for getting the pairs of links that are never in collision
@@ -171,7 +186,8 @@ static void disableNeverInCollisionThread(ThreadComputation tc);
 // ******************************************************************************************
 LinkPairMap computeDefaultCollisions(const planning_scene::PlanningSceneConstPtr& parent_scene, unsigned int* progress,
                                      const bool include_never_colliding, const unsigned int num_trials,
-                                     const double min_collision_fraction, const bool verbose)
+                                     const double min_collision_fraction, const bool verbose,
+                                     const unsigned int stable_trials)
 {
   // Create new instance of planning scene using pointer
   planning_scene::PlanningScenePtr scene = parent_scene->diff();
@@ -236,7 +252,8 @@ LinkPairMap computeDefaultCollisions(const planning_scene::PlanningSceneConstPtr
   unsigned int num_never = 0;
   if (include_never_colliding)  // option of function
   {
-    num_never = disableNeverInCollision(num_trials, *scene, link_pairs, req, links_seen_colliding, progress);
+    num_never =
+        disableNeverInCollision(num_trials, *scene, link_pairs, req, links_seen_colliding, progress, stable_trials);
   }
 
   // ROS_INFO("Link pairs seen colliding ever: %d", int(links_seen_colliding.size()));
@@ -550,20 +567,25 @@ unsigned int disableAlwaysInCollision(planning_scene::PlanningScene& scene, Link
 // ******************************************************************************************
 unsigned int disableNeverInCollision(const unsigned int num_trials, planning_scene::PlanningScene& scene,
                                      LinkPairMap& link_pairs, const collision_detection::CollisionRequest& req,
-                                     StringPairSet& links_seen_colliding, unsigned int* progress)
+                                     StringPairSet& links_seen_colliding, unsigned int* progress,
+                                     const unsigned int stable_trials)
 {
   unsigned int num_disabled = 0;
 
   boost::thread_group bgroup;  // create a group of threads
-  boost::mutex lock;           // used for sharing the same data structures
+  SharedSamplingState shared(stable_trials);
 
   int num_threads = boost::thread::hardware_concurrency();  // how many cores does this computer have?
+  if (num_threads < 1)
+    num_threads = 1;
   // ROS_INFO_STREAM("Performing " << num_trials << " trials for 'always in collision' checking on " <<
   //   num_threads << " threads...");
 
+  // each thread starts from the pairs already known and collects new ones without locking
+  std::vector<StringPairSet> thread_links_seen_colliding(num_threads, links_seen_colliding);
   for (int i = 0; i < num_threads; ++i)
   {
-    ThreadComputation tc(scene, req, i, num_trials / num_threads, &links_seen_colliding, &lock, progress);
+    ThreadComputation tc(scene, req, i, num_trials / num_threads, &thread_links_seen_colliding[i], &shared, progress);
     bgroup.create_thread(boost::bind(&disableNeverInCollisionThread, tc));
   }
 
@@ -579,6 +601,16 @@ unsigned int disableNeverInCollision(const unsigned int num_trials, planning_sce
     throw;
   }
 
+  // merge what the threads have seen
+  for (std::size_t i = 0; i < thread_links_seen_colliding.size(); ++i)
+    for (StringPairSet::const_iterator it = thread_links_seen_colliding[i].begin();
+         it != thread_links_seen_colliding[i].end(); ++it)
+      if (links_seen_colliding.insert(*it).second)
+        scene.getAllowedCollisionMatrixNonConst().setEntry(it->first, it->second, true);
+
+  if (stable_trials > 0)
+    ROS_INFO("Sampled %u states for never colliding link pairs (limit %u)", shared.trials_done_.load(), num_trials);
+
   // Loop through every possible link pair and check if it has ever been seen in collision
   for (LinkPairMap::iterator pair_it = link_pairs.begin(); pair_it != link_pairs.end(); ++pair_it)
   {
@@ -610,11 +642,18 @@ void disableNeverInCollisionThread(ThreadComputation tc)
   // ROS_INFO_STREAM("Thread " << tc.thread_id_ << " running " << tc.num_trials_ << " trials");
 
   // User feedback vars
-  const unsigned int progress_interval = tc.num_trials_ / 20;  // show progress update every 5%
+  const unsigned int progress_interval = std::max(tc.num_trials_ / 20, 1u);  // show progress update every 5%
 
   // Create a new kinematic state for this thread to work on
   robot_state::RobotState kstate(tc.scene_.getRobotModel());
 
+  // Pairs seen colliding are disabled in a thread-local copy of the collision matrix, so they are not reported again
+  // and the scene (shared by all threads) is not modified while sampling
+  collision_detection::AllowedCollisionMatrix acm = tc.scene_.getAllowedCollisionMatrix();
+  for (StringPairSet::const_iterator it = tc.links_seen_colliding_->begin(); it != tc.links_seen_colliding_->end();
+       ++it)
+    acm.setEntry(it->first, it->second, true);
+
   // Do a large number of tests
   for (unsigned int i = 0; i < tc.num_trials_; ++i)
   {
@@ -628,23 +667,30 @@ void disableNeverInCollisionThread(ThreadComputation tc)
 
     collision_detection::CollisionResult res;
     kstate.setToRandomPositions();
-    tc.scene_.checkSelfCollision(tc.req_, res, kstate);
+    tc.scene_.checkSelfCollision(tc.req_, res, kstate, acm);
 
-    // Check all contacts
+    bool found_new = false;
     for (collision_detection::CollisionResult::ContactMap::const_iterator it = res.contacts.begin();
          it != res.contacts.end(); ++it)
-    {
-      // Check if this collision pair is unique before doing a thread lock
-      if (tc.links_seen_colliding_->find(it->first) == tc.links_seen_colliding_->end())
+      if (tc.links_seen_colliding_->insert(it->first).second)
       {
-        // Collision Matrix and links_seen_colliding is modified only if needed, based on above if statement
-
-        boost::mutex::scoped_lock slock(*tc.lock_);
-        tc.links_seen_colliding_->insert(it->first);
-
-        tc.scene_.getAllowedCollisionMatrixNonConst().setEntry(it->first.first, it->first.second,
-                                                               true);  // disable link checking in the collision matrix
+        acm.setEntry(it->first.first, it->first.second, true);  // disable link checking in the collision matrix
+        found_new = true;
       }
+
+    unsigned int trials_done = ++tc.shared_->trials_done_;
+    if (found_new)
+    {
+      // pairs new to this thread may already be known to others; that only makes the stopping rule conservative
+      unsigned int last = tc.shared_->last_discovery_.load();
+      while (last < trials_done && !tc.shared_->last_discovery_.compare_exchange_weak(last, trials_done))
+        ;
+    }
+    else if (tc.shared_->stable_trials_ > 0)
+    {
+      unsigned int last = tc.shared_->last_discovery_.load();
+      if (trials_done > last && trials_done - last >= tc.shared_->stable_trials_)
+        break;
     }
   }
 }
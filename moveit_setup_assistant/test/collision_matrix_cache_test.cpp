@@ -0,0 +1,128 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, the MoveIt! contributors
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <gtest/gtest.h>
+#include <fstream>
+#include <string>
+#include <urdf_parser/urdf_parser.h>
+#include <boost/filesystem/path.hpp>
+#include <moveit_resources/config.h>
+#include <moveit/setup_assistant/tools/collision_matrix_cache.h>
+
+class CollisionMatrixCacheTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    boost::filesystem::path res_path(MOVEIT_TEST_RESOURCES_DIR);
+
+    std::ifstream xml_file((res_path / "pr2_description/urdf/robot.xml").string().c_str());
+    std::string xml_string((std::istreambuf_iterator<char>(xml_file)), std::istreambuf_iterator<char>());
+    urdf::ModelInterfaceSharedPtr urdf_model = urdf::parseURDF(xml_string);
+    srdf::ModelSharedPtr srdf_model(new srdf::Model());
+    srdf_model->initFile(*urdf_model, (res_path / "pr2_description/srdf/robot.xml").string());
+    robot_model_.reset(new moveit::core::RobotModel(urdf_model, srdf_model));
+    scene_.reset(new planning_scene::PlanningScene(robot_model_));
+  }
+
+  moveit::core::RobotModelPtr robot_model_;
+  planning_scene::PlanningScenePtr scene_;
+};
+
+TEST_F(CollisionMatrixCacheTest, StoreAndLookup)
+{
+  moveit_setup_assistant::CollisionMatrixCache cache;
+  moveit_setup_assistant::LinkPairData data;
+  EXPECT_FALSE(cache.getLinkPairData("pair", data));
+
+  data.reason = moveit_setup_assistant::NEVER;
+  data.disable_check = true;
+  cache.setLinkPairData("pair", data);
+  EXPECT_EQ(cache.size(), 1u);
+
+  moveit_setup_assistant::LinkPairData stored;
+  ASSERT_TRUE(cache.getLinkPairData("pair", stored));
+  EXPECT_EQ(stored.reason, moveit_setup_assistant::NEVER);
+  EXPECT_TRUE(stored.disable_check);
+
+  cache.clear();
+  EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST_F(CollisionMatrixCacheTest, SignaturesAreStable)
+{
+  moveit_setup_assistant::LinkPairMap link_pairs;
+  moveit_setup_assistant::computeLinkPairs(*scene_, link_pairs);
+
+  moveit_setup_assistant::LinkPairSignatureMap signatures, other_signatures;
+  moveit_setup_assistant::computeLinkPairSignatures(*robot_model_, link_pairs, signatures);
+  moveit_setup_assistant::computeLinkPairSignatures(*robot_model_, link_pairs, other_signatures);
+
+  EXPECT_EQ(signatures.size(), link_pairs.size());
+  EXPECT_EQ(signatures, other_signatures);
+}
+
+TEST_F(CollisionMatrixCacheTest, ReusesCachedPairs)
+{
+  moveit_setup_assistant::CollisionMatrixCache cache;
+  unsigned int progress;
+  moveit_setup_assistant::LinkPairMap computed =
+      moveit_setup_assistant::computeDefaultCollisions(scene_, cache, &progress, true, 1000, 0.95, false);
+  EXPECT_EQ(progress, 100u);
+  EXPECT_GT(cache.size(), 0u);
+  EXPECT_LE(cache.size(), computed.size());
+
+  // all pairs are cached now, so the second run has to reproduce the first one exactly
+  std::size_t cache_size = cache.size();
+  moveit_setup_assistant::LinkPairMap reused =
+      moveit_setup_assistant::computeDefaultCollisions(scene_, cache, &progress, true, 1000, 0.95, false);
+  EXPECT_EQ(cache.size(), cache_size);
+  ASSERT_EQ(reused.size(), computed.size());
+  for (moveit_setup_assistant::LinkPairMap::const_iterator it = computed.begin(); it != computed.end(); ++it)
+  {
+    ASSERT_TRUE(reused.count(it->first));
+    EXPECT_EQ(reused[it->first].reason, it->second.reason);
+    EXPECT_EQ(reused[it->first].disable_check, it->second.disable_check);
+  }
+
+  // other parameters must not reuse these results
+  moveit_setup_assistant::computeDefaultCollisions(scene_, cache, &progress, false, 0, 0.95, false);
+  EXPECT_GT(cache.size(), cache_size);
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}